@@ -0,0 +1,191 @@
+/**
+ * @file bench_main.cpp
+ *
+ * The mlpack_bench program, which runs the benchmarks and writes their results
+ * as JSON.
+ */
+#include <mlpack/core.hpp>
+
+#include "benchmark.hpp"
+
+#include <fstream>
+
+PROGRAM_INFO("mlpack Benchmarks", "This program runs the benchmarks of mlpack "
+    "and writes their results as JSON, so that the performance of different "
+    "releases (or of different compilers and machines) can be tracked and "
+    "compared."
+    "\n\n"
+    "There are microbenchmarks of the building blocks of the methods (metric "
+    "evaluations, bound distances, neighbor candidate lists, and Gaussian "
+    "densities), named 'metric/...', 'bound/...', 'candidate_list/...', and "
+    "'gaussian/...', and end-to-end benchmarks of complete methods: "
+    "'allknn/...' (for each tree type), 'kmeans/...' (for each Lloyd step "
+    "type), 'emst', 'gmm/em', 'hmm/baum_welch', 'lsh', and 'cf/grouplens'.  "
+    "Only the benchmarks whose name contains --filter are run."
+    "\n\n"
+    "The end-to-end benchmarks run on synthetic datasets generated from --seed,"
+    " whose sizes are multiplied by --scale, except 'cf/grouplens', which runs "
+    "on the ratings in --ratings_file (in the format of the GroupLens datasets)"
+    ", or on synthetic ratings of the same size if that file cannot be loaded."
+    "\n\n"
+    "Each benchmark is run once to warm up, and then --repetitions times; the "
+    "minimum, median, mean and maximum times of the runs are written to "
+    "--output_file, or to the standard output if it is not given, with the "
+    "throughput, the peak memory of the memory accounts, and the counters of "
+    "the benchmark (such as the base cases of a traversal)."
+    "\n\n"
+    "With --scaling, the scaling benchmarks of the parallel methods are run "
+    "too: 'scaling/allknn', 'scaling/kmeans', 'scaling/gmm/em', "
+    "'scaling/hmm/baum_welch', 'scaling/emst' and 'scaling/lsh'.  Each is run "
+    "on datasets whose default sizes are multiplied by each factor in "
+    "--scaling_sizes (a comma-separated list), and with each number of "
+    "threads in --thread_counts (by default 1, 2, 4, ... up to the number of "
+    "threads available).  The parallel efficiency of each run is the time on "
+    "one thread divided by the number of threads and by the time of the run."
+    "\n\n"
+    "The results can be saved as a baseline with --save_baseline_file, and "
+    "compared with a baseline saved before with --baseline_file: each "
+    "benchmark whose throughput or parallel efficiency is lower, or whose peak "
+    "memory is higher, than in the baseline by more than the fraction "
+    "--tolerance is reported, and the program exits with a nonzero status if "
+    "there is any.");
+
+PARAM_STRING("filter", "Only run the benchmarks whose name contains this "
+    "string.", "f", "");
+PARAM_INT("repetitions", "Number of timed runs of each benchmark.", "r", 5);
+PARAM_INT("seed", "Seed of the datasets and the random number generators.",
+    "s", 42);
+PARAM_DOUBLE("scale", "Factor for the size of the datasets.", "S", 1.0);
+PARAM_STRING("ratings_file", "File containing the ratings for the "
+    "'cf/grouplens' benchmark.", "R", "GroupLens100k.csv");
+PARAM_STRING("output_file", "File to write the results to, as JSON.", "o", "");
+PARAM_FLAG("scaling", "Also run the scaling benchmarks of the parallel "
+    "methods.", "c");
+PARAM_STRING("thread_counts", "Comma-separated numbers of threads for the "
+    "scaling benchmarks (by default, powers of two up to the number of threads "
+    "available).", "T", "");
+PARAM_STRING("scaling_sizes", "Comma-separated factors of the dataset sizes "
+    "for the scaling benchmarks.", "z", "1");
+PARAM_STRING("baseline_file", "File containing a baseline to compare the "
+    "results with.", "b", "");
+PARAM_STRING("save_baseline_file", "File to save the results to as a "
+    "baseline.", "B", "");
+PARAM_DOUBLE("tolerance", "Largest relative change from the baseline which is "
+    "not a regression.", "t", 0.1);
+
+using namespace mlpack;
+using namespace mlpack::bench;
+using namespace std;
+
+// Parse a comma-separated list of positive numbers.
+template<typename T>
+static vector<T> ParseList(const string& option)
+{
+  vector<T> values;
+  istringstream stream(CLI::GetParam<string>(option));
+  string field;
+  while (getline(stream, field, ','))
+  {
+    istringstream fieldStream(field);
+    T value;
+    if (!(fieldStream >> value) || !(value > 0))
+      Log::Fatal << "Invalid value '" << field << "' in --" << option << "!  "
+          << "Must be a comma-separated list of positive numbers." << endl;
+    values.push_back(value);
+  }
+
+  return values;
+}
+
+int main(int argc, char** argv)
+{
+  CLI::ParseCommandLine(argc, argv);
+
+  const int repetitions = CLI::GetParam<int>("repetitions");
+  if (repetitions < 1)
+    Log::Fatal << "Invalid number of repetitions (" << repetitions << ")!  Must "
+        << "be at least 1." << endl;
+
+  const int seed = CLI::GetParam<int>("seed");
+  if (seed < 0)
+    Log::Fatal << "Invalid seed (" << seed << ")!  Must be nonnegative." << endl;
+
+  const double scale = CLI::GetParam<double>("scale");
+  if (scale <= 0.0)
+    Log::Fatal << "Invalid scale (" << scale << ")!  Must be positive." << endl;
+
+  BenchmarkRunner runner(CLI::GetParam<string>("filter"), (size_t) repetitions,
+      (uint64_t) seed, scale);
+
+  const double tolerance = CLI::GetParam<double>("tolerance");
+  if (tolerance < 0.0)
+    Log::Fatal << "Invalid tolerance (" << tolerance << ")!  Must be "
+        << "nonnegative." << endl;
+
+  RunMicroBenchmarks(runner);
+  RunMethodBenchmarks(runner, CLI::GetParam<string>("ratings_file"));
+
+  if (CLI::HasParam("scaling"))
+  {
+    vector<size_t> threads = ParseList<size_t>("thread_counts");
+    if (threads.empty())
+    {
+      const size_t maxThreads = util::NumThreads();
+      for (size_t t = 1; t < maxThreads; t *= 2)
+        threads.push_back(t);
+      threads.push_back(maxThreads);
+    }
+
+    const vector<double> sizes = ParseList<double>("scaling_sizes");
+    RunScalingBenchmarks(runner, threads, sizes);
+  }
+
+  if (runner.Results().empty())
+    Log::Warn << "No benchmark name contains '"
+        << CLI::GetParam<string>("filter") << "'." << endl;
+
+  const string outputFile = CLI::GetParam<string>("output_file");
+  if (outputFile.empty())
+  {
+    runner.WriteJSON(cout);
+  }
+  else
+  {
+    ofstream output(outputFile.c_str());
+    if (!output.is_open())
+      Log::Fatal << "Could not open '" << outputFile << "' for writing."
+          << endl;
+
+    runner.WriteJSON(output);
+  }
+
+  const string saveBaselineFile = CLI::GetParam<string>("save_baseline_file");
+  if (!saveBaselineFile.empty())
+  {
+    ofstream baseline(saveBaselineFile.c_str());
+    if (!baseline.is_open())
+      Log::Fatal << "Could not open '" << saveBaselineFile << "' for writing."
+          << endl;
+
+    runner.WriteBaseline(baseline);
+  }
+
+  const string baselineFile = CLI::GetParam<string>("baseline_file");
+  if (!baselineFile.empty())
+  {
+    ifstream baseline(baselineFile.c_str());
+    if (!baseline.is_open())
+      Log::Fatal << "Could not open '" << baselineFile << "' for reading."
+          << endl;
+
+    const size_t regressions = runner.CompareBaseline(baseline, tolerance);
+    if (regressions > 0)
+    {
+      Log::Warn << regressions << " regressions from the baseline in '"
+          << baselineFile << "'." << endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
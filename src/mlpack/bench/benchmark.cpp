@@ -0,0 +1,307 @@
+/**
+ * @file benchmark.cpp
+ *
+ * Implementation of the non-template parts of BenchmarkRunner, and of
+ * BenchmarkResult.
+ */
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <map>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::bench;
+
+double BenchmarkResult::Min() const
+{
+  return times.empty() ? 0.0 : *std::min_element(times.begin(), times.end());
+}
+
+double BenchmarkResult::Median() const
+{
+  if (times.empty())
+    return 0.0;
+
+  std::vector<double> sorted(times);
+  std::sort(sorted.begin(), sorted.end());
+  const size_t middle = sorted.size() / 2;
+  return (sorted.size() % 2 == 1) ? sorted[middle] :
+      (sorted[middle - 1] + sorted[middle]) / 2.0;
+}
+
+double BenchmarkResult::Mean() const
+{
+  double sum = 0.0;
+  for (size_t i = 0; i < times.size(); ++i)
+    sum += times[i];
+  return times.empty() ? 0.0 : sum / times.size();
+}
+
+double BenchmarkResult::Max() const
+{
+  return times.empty() ? 0.0 : *std::max_element(times.begin(), times.end());
+}
+
+double BenchmarkResult::Throughput() const
+{
+  const double median = Median();
+  return (median > 0.0) ? items / median : 0.0;
+}
+
+std::string BenchmarkResult::Configuration() const
+{
+  std::string configuration = name + "[";
+  const std::vector<BenchmarkParameters::Parameter>& list =
+      parameters.Parameters();
+  for (size_t i = 0; i < list.size(); ++i)
+  {
+    configuration += ((i == 0) ? "" : ",") + list[i].name + "=" +
+        list[i].value;
+  }
+  return configuration + "]";
+}
+
+std::string BenchmarkResult::Key() const
+{
+  std::ostringstream key;
+  key << Configuration() << "[threads=" << threads << "]";
+  return key.str();
+}
+
+BenchmarkRunner::BenchmarkRunner(const std::string& filter,
+                                 const size_t repetitions,
+                                 const uint64_t seed,
+                                 const double scale) :
+    filter(filter),
+    repetitions(repetitions),
+    seed(seed),
+    scale(scale)
+{
+  if (repetitions == 0)
+    Log::Fatal << "BenchmarkRunner: the number of repetitions must be positive!"
+        << std::endl;
+  if (scale <= 0.0)
+    Log::Fatal << "BenchmarkRunner: the scale must be positive!" << std::endl;
+}
+
+bool BenchmarkRunner::Selected(const std::string& name) const
+{
+  return (name.find(filter) != std::string::npos);
+}
+
+size_t BenchmarkRunner::Scaled(const size_t size) const
+{
+  return std::max((size_t) 1, (size_t) (scale * size + 0.5));
+}
+
+double BenchmarkRunner::Efficiency(const BenchmarkResult& result) const
+{
+  if (result.threads == 1)
+    return 1.0;
+
+  // Find the latest result of the same configuration on one thread.
+  const std::string configuration = result.Configuration();
+  for (size_t i = results.size(); i > 0; --i)
+  {
+    const BenchmarkResult& single = results[i - 1];
+    if (single.threads == 1 && single.Configuration() == configuration)
+    {
+      return (result.Median() > 0.0) ? single.Median() /
+          (result.threads * result.Median()) : -1.0;
+    }
+  }
+
+  return -1.0;
+}
+
+// Write the given string as a JSON string, with quotes and escapes.
+static void WriteJSONString(std::ostream& stream, const std::string& str)
+{
+  stream << '"';
+  for (size_t i = 0; i < str.size(); ++i)
+  {
+    const unsigned char c = (unsigned char) str[i];
+    if (c == '"' || c == '\\')
+    {
+      stream << '\\' << str[i];
+    }
+    else if (c < 0x20)
+    {
+      const char* hex = "0123456789abcdef";
+      stream << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+    }
+    else
+    {
+      stream << str[i];
+    }
+  }
+  stream << '"';
+}
+
+void BenchmarkRunner::WriteJSON(std::ostream& stream) const
+{
+  const std::streamsize oldPrecision = stream.precision(9);
+
+#ifdef _OPENMP
+  const size_t threads = omp_get_max_threads();
+#else
+  const size_t threads = 1;
+#endif
+
+  stream << "{" << std::endl;
+  stream << "  \"mlpack_version\": ";
+  WriteJSONString(stream, util::GetVersion());
+  stream << "," << std::endl;
+  stream << "  \"seed\": " << seed << "," << std::endl;
+  stream << "  \"scale\": " << scale << "," << std::endl;
+  stream << "  \"threads\": " << threads << "," << std::endl;
+  stream << "  \"repetitions\": " << repetitions << "," << std::endl;
+  stream << "  \"benchmarks\": [";
+
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const BenchmarkResult& result = results[i];
+    stream << ((i == 0) ? "" : ",") << std::endl << "    {" << std::endl;
+
+    stream << "      \"name\": ";
+    WriteJSONString(stream, result.name);
+    stream << "," << std::endl;
+
+    stream << "      \"parameters\": {";
+    const std::vector<BenchmarkParameters::Parameter>& parameters =
+        result.parameters.Parameters();
+    for (size_t j = 0; j < parameters.size(); ++j)
+    {
+      stream << ((j == 0) ? "" : ", ");
+      WriteJSONString(stream, parameters[j].name);
+      stream << ": ";
+      if (parameters[j].numeric)
+        stream << parameters[j].value;
+      else
+        WriteJSONString(stream, parameters[j].value);
+    }
+    stream << "}," << std::endl;
+
+    stream << "      \"items\": " << result.items << "," << std::endl;
+    stream << "      \"min\": " << result.Min() << "," << std::endl;
+    stream << "      \"median\": " << result.Median() << "," << std::endl;
+    stream << "      \"mean\": " << result.Mean() << "," << std::endl;
+    stream << "      \"max\": " << result.Max() << "," << std::endl;
+    stream << "      \"items_per_second\": " << result.Throughput() << ","
+        << std::endl;
+    stream << "      \"threads\": " << result.threads << "," << std::endl;
+    stream << "      \"efficiency\": ";
+    if (result.efficiency < 0.0)
+      stream << "null";
+    else
+      stream << result.efficiency;
+    stream << "," << std::endl;
+    stream << "      \"peak_memory\": " << result.peakMemory << ","
+        << std::endl;
+    stream << "      \"peak_resident_memory\": " << result.peakResidentMemory
+        << "," << std::endl;
+
+    stream << "      \"counters\": {";
+    const std::vector<BenchmarkParameters::Parameter>& counters =
+        result.counters.Parameters();
+    for (size_t j = 0; j < counters.size(); ++j)
+    {
+      stream << ((j == 0) ? "" : ", ");
+      WriteJSONString(stream, counters[j].name);
+      stream << ": " << counters[j].value;
+    }
+    stream << "}" << std::endl;
+    stream << "    }";
+  }
+
+  stream << std::endl << "  ]" << std::endl << "}" << std::endl;
+  stream.precision(oldPrecision);
+}
+
+void BenchmarkRunner::WriteBaseline(std::ostream& stream) const
+{
+  const std::streamsize oldPrecision = stream.precision(9);
+
+  stream << "# mlpack_bench baseline (" << util::GetVersion() << ", seed "
+      << seed << ", scale " << scale << ")." << std::endl;
+  stream << "# key\tthroughput\tefficiency\tpeak memory" << std::endl;
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const BenchmarkResult& result = results[i];
+    stream << result.Key() << "\t" << result.Throughput() << "\t"
+        << result.efficiency << "\t" << result.peakMemory << std::endl;
+  }
+
+  stream.precision(oldPrecision);
+}
+
+size_t BenchmarkRunner::CompareBaseline(std::istream& stream,
+                                        const double tolerance) const
+{
+  // Read the throughput, efficiency and peak memory of each benchmark.
+  std::map<std::string, std::vector<double> > baseline;
+  std::string line;
+  while (std::getline(stream, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    const size_t tab = line.find('\t');
+    std::vector<double> values(3);
+    std::istringstream fields((tab == std::string::npos) ? "" :
+        line.substr(tab + 1));
+    if (!(fields >> values[0] >> values[1] >> values[2]))
+    {
+      Log::Warn << "Ignoring invalid baseline line '" << line << "'."
+          << std::endl;
+      continue;
+    }
+
+    baseline[line.substr(0, tab)] = values;
+  }
+
+  size_t compared = 0;
+  size_t regressions = 0;
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const BenchmarkResult& result = results[i];
+    const std::string key = result.Key();
+    std::map<std::string, std::vector<double> >::const_iterator it =
+        baseline.find(key);
+    if (it == baseline.end())
+      continue;
+
+    ++compared;
+    const std::vector<double>& values = it->second;
+    if (result.Throughput() < (1.0 - tolerance) * values[0])
+    {
+      Log::Warn << "Regression in '" << key << "': throughput "
+          << result.Throughput() << " items/s, baseline " << values[0]
+          << " items/s." << std::endl;
+      ++regressions;
+    }
+    if (result.efficiency >= 0.0 && values[1] >= 0.0 &&
+        result.efficiency < (1.0 - tolerance) * values[1])
+    {
+      Log::Warn << "Regression in '" << key << "': parallel efficiency "
+          << result.efficiency << ", baseline " << values[1] << "."
+          << std::endl;
+      ++regressions;
+    }
+    if (values[2] > 0.0 && result.peakMemory > (1.0 + tolerance) * values[2])
+    {
+      Log::Warn << "Regression in '" << key << "': peak memory "
+          << MemoryUsage::Format(result.peakMemory) << ", baseline "
+          << MemoryUsage::Format((size_t) values[2]) << "." << std::endl;
+      ++regressions;
+    }
+  }
+
+  Log::Info << "Compared " << compared << " benchmarks with the baseline; "
+      << regressions << " regressions." << std::endl;
+  return regressions;
+}
@@ -0,0 +1,286 @@
+/**
+ * @file benchmark.hpp
+ *
+ * The BenchmarkRunner class, which times benchmarks and collects their results
+ * for the mlpack_bench program.
+ */
+#ifndef __MLPACK_BENCH_BENCHMARK_HPP
+#define __MLPACK_BENCH_BENCHMARK_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/util/sfinae_utility.hpp>
+
+#include <boost/type_traits/is_arithmetic.hpp>
+
+namespace mlpack {
+namespace bench {
+
+/**
+ * The parameters of a benchmark (the tree type, the number of points, ...),
+ * written with its results so that results of different releases can be
+ * matched up.  Parameters are kept in the order they are added.
+ *
+ * @code
+ * runner.Run("allknn", benchmark, BenchmarkParameters().Add("tree", "kd")
+ *     .Add("points", points).Add("k", 5));
+ * @endcode
+ */
+class BenchmarkParameters
+{
+ public:
+  //! A single parameter.
+  struct Parameter
+  {
+    //! The name of the parameter.
+    std::string name;
+    //! The value of the parameter.
+    std::string value;
+    //! Whether the value is a number (otherwise it is a string).
+    bool numeric;
+  };
+
+  /**
+   * Add a parameter.  Numbers are written as numbers in the results, and
+   * anything else as a string.
+   *
+   * @param name Name of the parameter.
+   * @param value Value of the parameter.
+   */
+  template<typename T>
+  BenchmarkParameters& Add(const std::string& name, const T& value)
+  {
+    std::ostringstream stream;
+    stream.precision(15);
+    stream << value;
+
+    Parameter parameter;
+    parameter.name = name;
+    parameter.value = stream.str();
+    parameter.numeric = boost::is_arithmetic<T>::value;
+    parameters.push_back(parameter);
+    return *this;
+  }
+
+  //! Get the parameters.
+  const std::vector<Parameter>& Parameters() const { return parameters; }
+
+ private:
+  //! The parameters.
+  std::vector<Parameter> parameters;
+};
+
+/**
+ * The results of one benchmark.  Times are in seconds, and memory is in bytes.
+ */
+struct BenchmarkResult
+{
+  //! The name of the benchmark.
+  std::string name;
+  //! The parameters of the benchmark.
+  BenchmarkParameters parameters;
+  //! The number of items (distance evaluations, points, ...) processed by one
+  //! run.
+  size_t items;
+  //! The time of each timed run.
+  std::vector<double> times;
+  //! The number of threads the parallel regions of mlpack could use.
+  size_t threads;
+  //! The parallel efficiency: the median time of the same benchmark (with the
+  //! same parameters) on one thread, divided by the number of threads and by
+  //! the median time.  This is negative if the benchmark was not run on one
+  //! thread before.
+  double efficiency;
+  //! The largest number of bytes in the memory accounts (see MemoryUsage) at
+  //! once during the runs.
+  size_t peakMemory;
+  //! The peak resident set size of the process after the runs (which also
+  //! covers the benchmarks run before).
+  size_t peakResidentMemory;
+  //! Counters reported by the last run (base cases, scores, ...), if the
+  //! benchmark has any.
+  BenchmarkParameters counters;
+
+  //! Get the number of items processed per second by the median run.
+  double Throughput() const;
+
+  //! Get a string identifying the benchmark and its parameters (but not the
+  //! number of threads).
+  std::string Configuration() const;
+  //! Get a string identifying the benchmark, its parameters and the number of
+  //! threads, which matches the results of different runs up in baselines.
+  std::string Key() const;
+
+  //! Get the time of the fastest run.
+  double Min() const;
+  //! Get the median time of a run.
+  double Median() const;
+  //! Get the mean time of a run.
+  double Mean() const;
+  //! Get the time of the slowest run.
+  double Max() const;
+};
+
+/**
+ * The BenchmarkRunner times benchmarks and collects their results, which can
+ * then be written as JSON.  A benchmark is any class with two methods:
+ *
+ * @code
+ * // Prepare a run; this is not timed.
+ * void Reset();
+ * // Do the timed work, and return the number of items processed.
+ * size_t Run();
+ * @endcode
+ *
+ * A benchmark may also report counters of its last run (such as the number
+ * of base cases of a tree traversal), which are written with its results:
+ *
+ * @code
+ * void Counters(BenchmarkParameters& counters) const;
+ * @endcode
+ *
+ * Each benchmark is run once to warm up, and then the given number of times.
+ * Before every call to Reset(), the random number generators are seeded with
+ * the seed of the runner, so the runs do the same work every time; the
+ * synthetic datasets (see datasets.hpp) are generated from the same seed, so
+ * results from different builds of mlpack can be compared.
+ *
+ * Only benchmarks with a name containing the filter given to the constructor
+ * are run; the expensive setup of a benchmark (generating its dataset) should
+ * be skipped when Selected() returns false.
+ */
+class BenchmarkRunner
+{
+ public:
+  /**
+   * Create the runner.
+   *
+   * @param filter Only run benchmarks whose name contains this string.
+   * @param repetitions Number of timed runs of each benchmark.
+   * @param seed Seed for the random number generators and the datasets.
+   * @param scale Factor for the size of the synthetic datasets.
+   */
+  BenchmarkRunner(const std::string& filter,
+                  const size_t repetitions,
+                  const uint64_t seed,
+                  const double scale);
+
+  //! Return whether the benchmark with the given name will be run.
+  bool Selected(const std::string& name) const;
+
+  /**
+   * Run the given benchmark, if it is selected, and record its results.
+   *
+   * @param name Name of the benchmark.
+   * @param benchmark The benchmark.
+   * @param parameters Parameters of the benchmark, written with its results.
+   */
+  template<typename BenchmarkType>
+  void Run(const std::string& name,
+           BenchmarkType& benchmark,
+           const BenchmarkParameters& parameters = BenchmarkParameters());
+
+  //! Get the seed for the random number generators and the datasets.
+  uint64_t Seed() const { return seed; }
+  //! Get the size of a dataset with the given default size, after scaling.
+  size_t Scaled(const size_t size) const;
+
+  //! Get the results of the benchmarks that were run.
+  const std::vector<BenchmarkResult>& Results() const { return results; }
+
+  /**
+   * Write the results of all benchmarks to the given stream as a JSON object,
+   * along with the version of mlpack, the seed, and the number of threads.
+   */
+  void WriteJSON(std::ostream& stream) const;
+
+  /**
+   * Write the results of all benchmarks to the given stream as a baseline for
+   * later runs (see CompareBaseline()): one line for each benchmark, with its
+   * key, its throughput, its parallel efficiency and its peak memory,
+   * separated by tabs.
+   */
+  void WriteBaseline(std::ostream& stream) const;
+
+  /**
+   * Compare the results with the baseline in the given stream (written by
+   * WriteBaseline()), and warn about each benchmark whose throughput or
+   * parallel efficiency is lower, or whose peak memory is higher, than in the
+   * baseline by more than the given fraction.  Benchmarks which are not in the
+   * baseline are not checked.
+   *
+   * @param stream Stream to read the baseline from.
+   * @param tolerance Largest relative change which is not a regression.
+   * @return The number of regressions.
+   */
+  size_t CompareBaseline(std::istream& stream, const double tolerance) const;
+
+ private:
+  HAS_MEM_FUNC(Counters, HasCounters)
+
+  //! Get the counters of the last run of the benchmark, if it has any.
+  template<typename BenchmarkType>
+  static void GetCounters(const BenchmarkType& benchmark,
+      BenchmarkParameters& counters,
+      typename boost::enable_if<HasCounters<BenchmarkType,
+          void(BenchmarkType::*)(BenchmarkParameters&) const> >::type* = 0);
+
+  //! Otherwise, there are no counters.
+  template<typename BenchmarkType>
+  static void GetCounters(const BenchmarkType& /* benchmark */,
+      BenchmarkParameters& /* counters */,
+      typename boost::disable_if<HasCounters<BenchmarkType,
+          void(BenchmarkType::*)(BenchmarkParameters&) const> >::type* = 0)
+  { }
+
+  //! Compute the parallel efficiency of the given result, from the result of
+  //! the same configuration on one thread.
+  double Efficiency(const BenchmarkResult& result) const;
+
+  //! The filter for benchmark names.
+  std::string filter;
+  //! The number of timed runs of each benchmark.
+  size_t repetitions;
+  //! The seed.
+  uint64_t seed;
+  //! The factor for the size of the datasets.
+  double scale;
+  //! The results.
+  std::vector<BenchmarkResult> results;
+};
+
+//! Run the microbenchmarks (metrics, bounds, candidate lists, distributions).
+void RunMicroBenchmarks(BenchmarkRunner& runner);
+
+/**
+ * Run the benchmarks of complete methods on synthetic datasets, and of
+ * collaborative filtering on the given ratings (in the format of the GroupLens
+ * datasets).  If the ratings cannot be loaded, synthetic ratings of the size of
+ * GroupLens100k are used instead.
+ */
+void RunMethodBenchmarks(BenchmarkRunner& runner,
+                         const std::string& ratingsFile);
+
+/**
+ * Run the scaling benchmarks of the parallel methods (all-k-nearest-neighbors
+ * with kd-trees, k-means, EM for Gaussian mixtures, Baum-Welch training of
+ * hidden Markov models, the dual-tree Boruvka EMST, and LSH search), named
+ * 'scaling/...'.  Each is run on datasets of the given sizes (factors of the
+ * default size, before the scale of the runner), and on each of them, with
+ * each of the given numbers of threads; the parallel efficiency is computed
+ * when one of them is 1 and comes first.
+ *
+ * @param runner Runner of the benchmarks.
+ * @param threads Numbers of threads to run each benchmark with.
+ * @param sizes Factors of the sizes of the datasets.
+ */
+void RunScalingBenchmarks(BenchmarkRunner& runner,
+                          const std::vector<size_t>& threads,
+                          const std::vector<double>& sizes);
+
+}; // namespace bench
+}; // namespace mlpack
+
+// Include implementation.
+#include "benchmark_impl.hpp"
+
+#endif
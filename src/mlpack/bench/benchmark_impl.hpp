@@ -0,0 +1,73 @@
+/**
+ * @file benchmark_impl.hpp
+ *
+ * Implementation of BenchmarkRunner::Run().
+ */
+#ifndef __MLPACK_BENCH_BENCHMARK_IMPL_HPP
+#define __MLPACK_BENCH_BENCHMARK_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "benchmark.hpp"
+
+namespace mlpack {
+namespace bench {
+
+template<typename BenchmarkType>
+void BenchmarkRunner::Run(const std::string& name,
+                          BenchmarkType& benchmark,
+                          const BenchmarkParameters& parameters)
+{
+  if (!Selected(name))
+    return;
+
+  Log::Info << "Running benchmark '" << name << "'..." << std::endl;
+
+  BenchmarkResult result;
+  result.name = name;
+  result.parameters = parameters;
+  result.items = 0;
+  result.threads = util::NumThreads();
+
+  // Only the memory used from now on counts for this benchmark.
+  MemoryUsage::ResetPeak();
+
+  // The first run is not timed; it fills the caches and lets the allocator
+  // settle.
+  for (size_t i = 0; i <= repetitions; ++i)
+  {
+    math::RandomSeed((size_t) seed);
+    benchmark.Reset();
+
+    const uint64_t start = ScopedTimer::Now();
+    result.items = benchmark.Run();
+    const uint64_t end = ScopedTimer::Now();
+
+    if (i > 0)
+      result.times.push_back((end - start) / 1e9);
+  }
+
+  result.peakMemory = MemoryUsage::Peak();
+  result.peakResidentMemory = util::PeakMemory();
+  GetCounters(benchmark, result.counters);
+  result.efficiency = Efficiency(result);
+
+  Log::Info << "Benchmark '" << name << "': median " << result.Median()
+      << "s over " << repetitions << " runs." << std::endl;
+
+  results.push_back(result);
+}
+
+template<typename BenchmarkType>
+void BenchmarkRunner::GetCounters(
+    const BenchmarkType& benchmark,
+    BenchmarkParameters& counters,
+    typename boost::enable_if<HasCounters<BenchmarkType,
+        void(BenchmarkType::*)(BenchmarkParameters&) const> >::type*)
+{
+  benchmark.Counters(counters);
+}
+
+}; // namespace bench
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * @file datasets.cpp
+ *
+ * Implementation of the synthetic dataset generators.
+ */
+#include "datasets.hpp"
+
+#include <set>
+
+using namespace mlpack;
+using namespace mlpack::bench;
+
+// The streams used by the generators, so that different datasets with the same
+// seed are not built from the same random numbers.
+static const uint64_t UniformStream = 0;
+static const uint64_t GaussianClusterStream = 1;
+static const uint64_t HMMStream = 2;
+static const uint64_t RatingsStream = 3;
+
+void mlpack::bench::UniformDataset(const size_t dimensionality,
+                                   const size_t points,
+                                   const uint64_t seed,
+                                   arma::mat& data)
+{
+  math::RandomStream stream(seed, UniformStream);
+
+  data.set_size(dimensionality, points);
+  for (size_t i = 0; i < data.n_elem; ++i)
+    data[i] = stream.Random();
+}
+
+void mlpack::bench::GaussianClusterDataset(const size_t dimensionality,
+                                           const size_t points,
+                                           const size_t clusters,
+                                           const uint64_t seed,
+                                           arma::mat& data,
+                                           arma::Col<size_t>* labels)
+{
+  math::RandomStream stream(seed, GaussianClusterStream);
+
+  arma::mat means(dimensionality, clusters);
+  for (size_t i = 0; i < means.n_elem; ++i)
+    means[i] = stream.Random(0.0, 10.0);
+  arma::vec deviations(clusters);
+  for (size_t c = 0; c < clusters; ++c)
+    deviations[c] = stream.Random(0.5, 1.5);
+
+  data.set_size(dimensionality, points);
+  if (labels != NULL)
+    labels->set_size(points);
+
+  for (size_t i = 0; i < points; ++i)
+  {
+    const size_t c = (size_t) stream.RandInt((int) clusters);
+    for (size_t d = 0; d < dimensionality; ++d)
+      data(d, i) = means(d, c) + deviations[c] * stream.RandNormal();
+
+    if (labels != NULL)
+      (*labels)[i] = c;
+  }
+}
+
+void mlpack::bench::HMMDataset(const size_t states,
+                               const size_t dimensionality,
+                               const size_t sequences,
+                               const size_t length,
+                               const uint64_t seed,
+                               std::vector<arma::mat>& data)
+{
+  math::RandomStream stream(seed, HMMStream);
+
+  arma::mat means(dimensionality, states);
+  for (size_t i = 0; i < means.n_elem; ++i)
+    means[i] = stream.Random(0.0, 10.0);
+
+  data.resize(sequences);
+  for (size_t s = 0; s < sequences; ++s)
+  {
+    data[s].set_size(dimensionality, length);
+    size_t state = (size_t) stream.RandInt((int) states);
+    for (size_t t = 0; t < length; ++t)
+    {
+      // Move to another state with probability 0.2.
+      if (t > 0 && states > 1 && stream.Random() < 0.2)
+        state = (state + 1 + stream.RandInt((int) states - 1)) % states;
+
+      for (size_t d = 0; d < dimensionality; ++d)
+        data[s](d, t) = means(d, state) + stream.RandNormal();
+    }
+  }
+}
+
+void mlpack::bench::RatingsDataset(const size_t users,
+                                   const size_t items,
+                                   const size_t ratings,
+                                   const uint64_t seed,
+                                   arma::mat& data)
+{
+  if (ratings > users * items)
+  {
+    Log::Fatal << "RatingsDataset(): cannot generate " << ratings << " ratings "
+        << "for " << users << " users and " << items << " items!" << std::endl;
+  }
+
+  math::RandomStream stream(seed, RatingsStream);
+
+  // The low-rank model of the ratings.
+  const size_t rank = 3;
+  arma::mat userFactors(rank, users);
+  for (size_t i = 0; i < userFactors.n_elem; ++i)
+    userFactors[i] = 0.6 * stream.RandNormal();
+  arma::mat itemFactors(rank, items);
+  for (size_t i = 0; i < itemFactors.n_elem; ++i)
+    itemFactors[i] = 0.6 * stream.RandNormal();
+
+  std::set<std::pair<size_t, size_t> > rated;
+  data.set_size(3, ratings);
+  for (size_t i = 0; i < ratings; ++i)
+  {
+    // Popular items are chosen more often.  If the user has rated the item
+    // already, choose again, uniformly.
+    size_t user = (size_t) stream.RandInt((int) users);
+    const double u = stream.Random();
+    size_t item = std::min((size_t) (u * u * items), items - 1);
+    while (!rated.insert(std::make_pair(user, item)).second)
+    {
+      user = (size_t) stream.RandInt((int) users);
+      item = (size_t) stream.RandInt((int) items);
+    }
+
+    const double rating = 3.0 + arma::dot(userFactors.col(user),
+        itemFactors.col(item)) + 0.5 * stream.RandNormal();
+
+    data(0, i) = user;
+    data(1, i) = item;
+    data(2, i) = std::min(5.0, std::max(1.0, round(rating)));
+  }
+}
@@ -0,0 +1,91 @@
+/**
+ * @file datasets.hpp
+ *
+ * Generators of the synthetic datasets used by the mlpack_bench program.  Each
+ * dataset is a pure function of its size and the seed, so the same benchmark
+ * runs on the same data in every build and on every machine.
+ */
+#ifndef __MLPACK_BENCH_DATASETS_HPP
+#define __MLPACK_BENCH_DATASETS_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace bench {
+
+/**
+ * Generate points uniformly distributed in the unit hypercube.
+ *
+ * @param dimensionality Dimensionality of the points.
+ * @param points Number of points.
+ * @param seed Seed of the dataset.
+ * @param data Matrix to store the points in, one per column.
+ */
+void UniformDataset(const size_t dimensionality,
+                    const size_t points,
+                    const uint64_t seed,
+                    arma::mat& data);
+
+/**
+ * Generate points from a mixture of spherical Gaussians with equal weights,
+ * whose means are uniformly distributed in [0, 10]^dimensionality, and whose
+ * standard deviations are between 0.5 and 1.5.
+ *
+ * @param dimensionality Dimensionality of the points.
+ * @param points Number of points.
+ * @param clusters Number of Gaussians.
+ * @param seed Seed of the dataset.
+ * @param data Matrix to store the points in, one per column.
+ * @param labels If not NULL, vector to store the Gaussian of each point in.
+ */
+void GaussianClusterDataset(const size_t dimensionality,
+                            const size_t points,
+                            const size_t clusters,
+                            const uint64_t seed,
+                            arma::mat& data,
+                            arma::Col<size_t>* labels = NULL);
+
+/**
+ * Generate observation sequences from a hidden Markov model with Gaussian
+ * emissions.  The model stays in its state with probability 0.8 and otherwise
+ * moves to another state uniformly at random; the emission of each state is a
+ * spherical Gaussian with unit variance and a mean uniformly distributed in
+ * [0, 10]^dimensionality.
+ *
+ * @param states Number of hidden states.
+ * @param dimensionality Dimensionality of the observations.
+ * @param sequences Number of sequences.
+ * @param length Length of each sequence.
+ * @param seed Seed of the dataset.
+ * @param data Vector to store the sequences in, each with one observation per
+ *     column.
+ */
+void HMMDataset(const size_t states,
+                const size_t dimensionality,
+                const size_t sequences,
+                const size_t length,
+                const uint64_t seed,
+                std::vector<arma::mat>& data);
+
+/**
+ * Generate ratings in the format of the GroupLens datasets (one (user, item,
+ * rating) triple per column).  Each user rates distinct items, with ratings
+ * between 1 and 5 from a low-rank model plus noise; popular items (those with
+ * small indices) are rated more often, as in real data.
+ *
+ * @param users Number of users.
+ * @param items Number of items.
+ * @param ratings Number of ratings (at most users * items).
+ * @param seed Seed of the dataset.
+ * @param data Matrix to store the ratings in.
+ */
+void RatingsDataset(const size_t users,
+                    const size_t items,
+                    const size_t ratings,
+                    const uint64_t seed,
+                    arma::mat& data);
+
+}; // namespace bench
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,561 @@
+/**
+ * @file method_benchmarks.cpp
+ *
+ * End-to-end benchmarks of complete methods (including tree building and model
+ * initialization), on seeded synthetic datasets and on GroupLens ratings, and
+ * the scaling benchmarks of the parallel methods.
+ */
+#include "benchmark.hpp"
+#include "datasets.hpp"
+
+#include <mlpack/core/tree/cover_tree.hpp>
+#include <mlpack/core/tree/rectangle_tree.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+#include <mlpack/methods/kmeans/kmeans.hpp>
+#include <mlpack/methods/kmeans/elkan_kmeans.hpp>
+#include <mlpack/methods/kmeans/hamerly_kmeans.hpp>
+#include <mlpack/methods/kmeans/pelleg_moore_kmeans.hpp>
+#include <mlpack/methods/kmeans/dual_tree_kmeans.hpp>
+#include <mlpack/methods/kmeans/dtnn_kmeans.hpp>
+#include <mlpack/methods/emst/dtb.hpp>
+#include <mlpack/methods/gmm/gmm.hpp>
+#include <mlpack/methods/hmm/hmm.hpp>
+#include <mlpack/methods/lsh/lsh_search.hpp>
+#include <mlpack/methods/cf/cf.hpp>
+
+using namespace mlpack;
+using namespace mlpack::bench;
+using namespace mlpack::bound;
+using namespace mlpack::distribution;
+using namespace mlpack::metric;
+using namespace mlpack::neighbor;
+using namespace mlpack::tree;
+using namespace mlpack::kmeans;
+
+/**
+ * Build the trees and find the k nearest neighbors of every point of a
+ * dataset, with dual-tree search on the given number of threads (0 means
+ * util::NumThreads()).  The base cases and scores of the traversal are
+ * reported as counters.
+ */
+template<typename TreeType>
+class AllkNNBenchmark
+{
+ public:
+  AllkNNBenchmark(const arma::mat& data,
+                  const size_t k,
+                  const size_t threads = 1) :
+      data(data), k(k), threads(threads), baseCases(0), scores(0) { }
+
+  void Reset() { }
+
+  size_t Run()
+  {
+    NeighborSearch<NearestNeighborSort, EuclideanDistance, TreeType>
+        allknn(data);
+    allknn.NumThreads() = threads;
+    allknn.Search(k, neighbors, distances);
+    baseCases = allknn.BaseCases();
+    scores = allknn.Scores();
+    return data.n_cols;
+  }
+
+  void Counters(BenchmarkParameters& counters) const
+  {
+    counters.Add("base_cases", baseCases).Add("scores", scores);
+  }
+
+ private:
+  const arma::mat& data;
+  size_t k;
+  size_t threads;
+  size_t baseCases;
+  size_t scores;
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+};
+
+/**
+ * The same as AllkNNBenchmark, for the R* tree, which is not built by
+ * NeighborSearch.
+ */
+class RStarTreeAllkNNBenchmark
+{
+ public:
+  typedef RectangleTree<RStarTreeSplit<RStarTreeDescentHeuristic,
+      NeighborSearchStat<NearestNeighborSort>, arma::mat>,
+      RStarTreeDescentHeuristic, NeighborSearchStat<NearestNeighborSort>,
+      arma::mat> TreeType;
+
+  RStarTreeAllkNNBenchmark(const arma::mat& data, const size_t k) :
+      data(data), k(k) { }
+
+  // The tree may modify its dataset, so it gets a fresh copy every run.
+  void Reset() { dataCopy = data; }
+
+  size_t Run()
+  {
+    // The parameters used by the allknn program, with a leaf size of 20.
+    TreeType tree(dataCopy, 20, 8, 5, 2, 0);
+    NeighborSearch<NearestNeighborSort, EuclideanDistance, TreeType>
+        allknn(&tree, dataCopy);
+    allknn.Search(k, neighbors, distances);
+    return data.n_cols;
+  }
+
+ private:
+  const arma::mat& data;
+  size_t k;
+  arma::mat dataCopy;
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+};
+
+/**
+ * Run a fixed number of Lloyd iterations of k-means from fixed initial
+ * centroids, so that every LloydStepType does the same iterations.
+ */
+template<template<class, class> class LloydStepType>
+class KMeansBenchmark
+{
+ public:
+  KMeansBenchmark(const arma::mat& data,
+                  const size_t clusters,
+                  const size_t iterations) :
+      data(data), clusters(clusters), iterations(iterations) { }
+
+  void Reset() { centroids = data.cols(0, clusters - 1); }
+
+  size_t Run()
+  {
+    KMeans<EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+        LloydStepType> kmeans(iterations);
+    kmeans.Cluster(data, clusters, assignments, centroids, false, true);
+    return data.n_cols * iterations;
+  }
+
+ private:
+  const arma::mat& data;
+  size_t clusters;
+  size_t iterations;
+  arma::mat centroids;
+  arma::Col<size_t> assignments;
+};
+
+/**
+ * Compute the Euclidean minimum spanning tree with the dual-tree Boruvka
+ * algorithm.
+ */
+class EMSTBenchmark
+{
+ public:
+  EMSTBenchmark(const arma::mat& data) : data(data) { }
+
+  void Reset() { }
+
+  size_t Run()
+  {
+    emst::DualTreeBoruvka<> dtb(data);
+    dtb.ComputeMST(results);
+    return data.n_cols;
+  }
+
+ private:
+  const arma::mat& data;
+  arma::mat results;
+};
+
+/**
+ * Fit a Gaussian mixture model with EM, from the k-means initialization, for a
+ * fixed maximum number of iterations.
+ */
+class GMMBenchmark
+{
+ public:
+  GMMBenchmark(const arma::mat& data,
+               const size_t gaussians,
+               const size_t iterations) :
+      data(data), gaussians(gaussians), iterations(iterations) { }
+
+  void Reset() { }
+
+  size_t Run()
+  {
+    gmm::EMFit<> fitter(iterations);
+    gmm::GMM<> model(gaussians, data.n_rows, fitter);
+    model.Estimate(data);
+    return data.n_cols;
+  }
+
+ private:
+  const arma::mat& data;
+  size_t gaussians;
+  size_t iterations;
+};
+
+/**
+ * Train a hidden Markov model with Gaussian emissions by Baum-Welch, from an
+ * initial model built from the first observations.
+ */
+class HMMBenchmark
+{
+ public:
+  HMMBenchmark(const std::vector<arma::mat>& sequences, const size_t states) :
+      sequences(sequences), states(states) { }
+
+  void Reset() { }
+
+  size_t Run()
+  {
+    const size_t dimensionality = sequences[0].n_rows;
+    const arma::vec initial = arma::ones<arma::vec>(states) / states;
+    const arma::mat transition = arma::ones<arma::mat>(states, states) / states;
+    std::vector<GaussianDistribution> emissions;
+    for (size_t i = 0; i < states; ++i)
+    {
+      const arma::vec mean = sequences[i % sequences.size()].col(0);
+      emissions.push_back(GaussianDistribution(mean,
+          arma::eye<arma::mat>(dimensionality, dimensionality)));
+    }
+
+    hmm::HMM<GaussianDistribution> model(initial, transition, emissions);
+    model.Train(sequences);
+
+    size_t observations = 0;
+    for (size_t i = 0; i < sequences.size(); ++i)
+      observations += sequences[i].n_cols;
+    return observations;
+  }
+
+ private:
+  const std::vector<arma::mat>& sequences;
+  size_t states;
+};
+
+/**
+ * Build the hash tables and find approximate nearest neighbors of every point
+ * of a dataset with locality-sensitive hashing, on the given number of threads
+ * (0 means util::NumThreads()).
+ */
+class LSHBenchmark
+{
+ public:
+  LSHBenchmark(const arma::mat& data,
+               const size_t k,
+               const size_t projections,
+               const size_t tables,
+               const size_t threads = 1) :
+      data(data), k(k), projections(projections), tables(tables),
+      threads(threads) { }
+
+  void Reset() { }
+
+  size_t Run()
+  {
+    LSHSearch<> lsh(data, projections, tables);
+    lsh.NumThreads() = threads;
+    lsh.Search(k, neighbors, distances);
+    return data.n_cols;
+  }
+
+ private:
+  const arma::mat& data;
+  size_t k;
+  size_t projections;
+  size_t tables;
+  size_t threads;
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+};
+
+/**
+ * Factorize a ratings matrix and compute recommendations for every user with
+ * collaborative filtering.
+ */
+class CFBenchmark
+{
+ public:
+  CFBenchmark(const arma::mat& ratings,
+              const size_t rank,
+              const size_t recommendations) :
+      ratings(ratings), rank(rank), recommendations(recommendations) { }
+
+  // CF takes a modifiable matrix.
+  void Reset() { ratingsCopy = ratings; }
+
+  size_t Run()
+  {
+    cf::CF<> recommender(ratingsCopy, amf::NMFALSFactorizer(), 5, rank);
+    recommender.GetRecommendations(recommendations, results);
+    return ratings.n_cols;
+  }
+
+ private:
+  const arma::mat& ratings;
+  size_t rank;
+  size_t recommendations;
+  arma::mat ratingsCopy;
+  arma::Mat<size_t> results;
+};
+
+template<typename TreeType>
+static void RunAllkNNBenchmark(BenchmarkRunner& runner,
+                               const std::string& tree,
+                               const arma::mat& data,
+                               const size_t k)
+{
+  AllkNNBenchmark<TreeType> benchmark(data, k);
+  runner.Run("allknn/" + tree, benchmark, BenchmarkParameters()
+      .Add("tree", tree).Add("points", data.n_cols)
+      .Add("dimensionality", data.n_rows).Add("k", k));
+}
+
+template<template<class, class> class LloydStepType>
+static void RunKMeansBenchmark(BenchmarkRunner& runner,
+                               const std::string& algorithm,
+                               const arma::mat& data,
+                               const size_t clusters)
+{
+  const size_t iterations = 10;
+  KMeansBenchmark<LloydStepType> benchmark(data, clusters, iterations);
+  runner.Run("kmeans/" + algorithm, benchmark, BenchmarkParameters()
+      .Add("algorithm", algorithm).Add("points", data.n_cols)
+      .Add("dimensionality", data.n_rows).Add("clusters", clusters)
+      .Add("iterations", iterations));
+}
+
+/**
+ * Run the given benchmark with each of the given numbers of threads.
+ */
+template<typename BenchmarkType>
+static void RunWithThreads(BenchmarkRunner& runner,
+                           const std::string& name,
+                           BenchmarkType& benchmark,
+                           const BenchmarkParameters& parameters,
+                           const std::vector<size_t>& threads)
+{
+  for (size_t t = 0; t < threads.size(); ++t)
+  {
+    util::SetNumThreads(threads[t]);
+    runner.Run(name, benchmark, parameters);
+  }
+}
+
+void mlpack::bench::RunMethodBenchmarks(BenchmarkRunner& runner,
+                                        const std::string& ratingsFile)
+{
+  const uint64_t seed = runner.Seed();
+
+  // All-k-nearest-neighbors, with every tree type.
+  if (runner.Selected("allknn/kd") || runner.Selected("allknn/ball") ||
+      runner.Selected("allknn/cover") || runner.Selected("allknn/rstar"))
+  {
+    const size_t k = 5;
+    arma::mat data;
+    GaussianClusterDataset(5, runner.Scaled(20000), 20, seed, data);
+
+    RunAllkNNBenchmark<BinarySpaceTree<HRectBound<2>,
+        NeighborSearchStat<NearestNeighborSort> > >(runner, "kd", data, k);
+    RunAllkNNBenchmark<BinarySpaceTree<BallBound<>,
+        NeighborSearchStat<NearestNeighborSort> > >(runner, "ball", data, k);
+    RunAllkNNBenchmark<CoverTree<EuclideanDistance, FirstPointIsRoot,
+        NeighborSearchStat<NearestNeighborSort> > >(runner, "cover", data, k);
+
+    RStarTreeAllkNNBenchmark rStarBenchmark(data, k);
+    runner.Run("allknn/rstar", rStarBenchmark, BenchmarkParameters()
+        .Add("tree", "rstar").Add("points", data.n_cols)
+        .Add("dimensionality", data.n_rows).Add("k", k));
+  }
+
+  // k-means, with every Lloyd step type.
+  if (runner.Selected("kmeans/"))
+  {
+    const size_t clusters = 50;
+    arma::mat data;
+    GaussianClusterDataset(10, runner.Scaled(50000), clusters, seed, data);
+
+    RunKMeansBenchmark<NaiveKMeans>(runner, "naive", data, clusters);
+    RunKMeansBenchmark<ElkanKMeans>(runner, "elkan", data, clusters);
+    RunKMeansBenchmark<HamerlyKMeans>(runner, "hamerly", data, clusters);
+    RunKMeansBenchmark<PellegMooreKMeans>(runner, "pelleg-moore", data,
+        clusters);
+    RunKMeansBenchmark<DefaultDualTreeKMeans>(runner, "dualtree", data,
+        clusters);
+    RunKMeansBenchmark<DefaultDTNNKMeans>(runner, "dtnn", data, clusters);
+    RunKMeansBenchmark<CoverTreeDTNNKMeans>(runner, "dtnn-covertree", data,
+        clusters);
+  }
+
+  if (runner.Selected("emst"))
+  {
+    arma::mat data;
+    GaussianClusterDataset(3, runner.Scaled(20000), 20, seed, data);
+
+    EMSTBenchmark benchmark(data);
+    runner.Run("emst", benchmark, BenchmarkParameters()
+        .Add("points", data.n_cols).Add("dimensionality", data.n_rows));
+  }
+
+  if (runner.Selected("gmm/em"))
+  {
+    const size_t gaussians = 5;
+    const size_t iterations = 50;
+    arma::mat data;
+    GaussianClusterDataset(5, runner.Scaled(20000), gaussians, seed, data);
+
+    GMMBenchmark benchmark(data, gaussians, iterations);
+    runner.Run("gmm/em", benchmark, BenchmarkParameters()
+        .Add("points", data.n_cols).Add("dimensionality", data.n_rows)
+        .Add("gaussians", gaussians).Add("iterations", iterations));
+  }
+
+  if (runner.Selected("hmm/baum_welch"))
+  {
+    const size_t states = 5;
+    std::vector<arma::mat> sequences;
+    HMMDataset(states, 3, runner.Scaled(50), 500, seed, sequences);
+
+    HMMBenchmark benchmark(sequences, states);
+    runner.Run("hmm/baum_welch", benchmark, BenchmarkParameters()
+        .Add("states", states).Add("dimensionality", 3)
+        .Add("sequences", sequences.size()).Add("length", 500));
+  }
+
+  if (runner.Selected("lsh"))
+  {
+    const size_t k = 5;
+    const size_t projections = 10;
+    const size_t tables = 30;
+    arma::mat data;
+    GaussianClusterDataset(10, runner.Scaled(20000), 20, seed, data);
+
+    LSHBenchmark benchmark(data, k, projections, tables);
+    runner.Run("lsh", benchmark, BenchmarkParameters()
+        .Add("points", data.n_cols).Add("dimensionality", data.n_rows)
+        .Add("k", k).Add("projections", projections).Add("tables", tables));
+  }
+
+  // Collaborative filtering on GroupLens, or on synthetic ratings of the same
+  // size if the file is not there.
+  if (runner.Selected("cf/grouplens"))
+  {
+    const size_t rank = 10;
+    const size_t recommendations = 10;
+
+    arma::mat ratings;
+    std::string dataset = ratingsFile;
+    if (ratingsFile.empty() || !data::Load(ratingsFile, ratings))
+    {
+      Log::Warn << "Could not load ratings from '" << ratingsFile << "'; using "
+          << "synthetic ratings." << std::endl;
+      RatingsDataset(943, 1682, 100000, seed, ratings);
+      dataset = "synthetic";
+    }
+
+    CFBenchmark benchmark(ratings, rank, recommendations);
+    runner.Run("cf/grouplens", benchmark, BenchmarkParameters()
+        .Add("dataset", dataset).Add("ratings", ratings.n_cols)
+        .Add("rank", rank).Add("recommendations", recommendations));
+  }
+}
+
+void mlpack::bench::RunScalingBenchmarks(BenchmarkRunner& runner,
+                                         const std::vector<size_t>& threads,
+                                         const std::vector<double>& sizes)
+{
+  const uint64_t seed = runner.Seed();
+
+  // The benchmarks change the number of threads, which is restored at the end.
+  const size_t defaultThreads = util::NumThreads();
+
+  for (size_t s = 0; s < sizes.size(); ++s)
+  {
+    const double size = sizes[s];
+
+    if (runner.Selected("scaling/allknn"))
+    {
+      const size_t k = 5;
+      arma::mat data;
+      GaussianClusterDataset(5, runner.Scaled((size_t) (size * 20000)), 20,
+          seed, data);
+
+      AllkNNBenchmark<BinarySpaceTree<HRectBound<2>,
+          NeighborSearchStat<NearestNeighborSort> > > benchmark(data, k, 0);
+      RunWithThreads(runner, "scaling/allknn", benchmark, BenchmarkParameters()
+          .Add("tree", "kd").Add("points", data.n_cols)
+          .Add("dimensionality", data.n_rows).Add("k", k), threads);
+    }
+
+    if (runner.Selected("scaling/kmeans"))
+    {
+      const size_t clusters = 50;
+      const size_t iterations = 10;
+      arma::mat data;
+      GaussianClusterDataset(10, runner.Scaled((size_t) (size * 50000)),
+          clusters, seed, data);
+
+      KMeansBenchmark<NaiveKMeans> benchmark(data, clusters, iterations);
+      RunWithThreads(runner, "scaling/kmeans", benchmark, BenchmarkParameters()
+          .Add("algorithm", "naive").Add("points", data.n_cols)
+          .Add("dimensionality", data.n_rows).Add("clusters", clusters)
+          .Add("iterations", iterations), threads);
+    }
+
+    if (runner.Selected("scaling/gmm/em"))
+    {
+      const size_t gaussians = 5;
+      const size_t iterations = 50;
+      arma::mat data;
+      GaussianClusterDataset(5, runner.Scaled((size_t) (size * 20000)),
+          gaussians, seed, data);
+
+      GMMBenchmark benchmark(data, gaussians, iterations);
+      RunWithThreads(runner, "scaling/gmm/em", benchmark, BenchmarkParameters()
+          .Add("points", data.n_cols).Add("dimensionality", data.n_rows)
+          .Add("gaussians", gaussians).Add("iterations", iterations), threads);
+    }
+
+    if (runner.Selected("scaling/hmm/baum_welch"))
+    {
+      const size_t states = 5;
+      std::vector<arma::mat> sequences;
+      HMMDataset(states, 3, runner.Scaled((size_t) (size * 50)), 500, seed,
+          sequences);
+
+      HMMBenchmark benchmark(sequences, states);
+      RunWithThreads(runner, "scaling/hmm/baum_welch", benchmark,
+          BenchmarkParameters().Add("states", states).Add("dimensionality", 3)
+          .Add("sequences", sequences.size()).Add("length", 500), threads);
+    }
+
+    if (runner.Selected("scaling/emst"))
+    {
+      arma::mat data;
+      GaussianClusterDataset(3, runner.Scaled((size_t) (size * 20000)), 20,
+          seed, data);
+
+      EMSTBenchmark benchmark(data);
+      RunWithThreads(runner, "scaling/emst", benchmark, BenchmarkParameters()
+          .Add("points", data.n_cols).Add("dimensionality", data.n_rows),
+          threads);
+    }
+
+    if (runner.Selected("scaling/lsh"))
+    {
+      const size_t k = 5;
+      const size_t projections = 10;
+      const size_t tables = 30;
+      arma::mat data;
+      GaussianClusterDataset(10, runner.Scaled((size_t) (size * 20000)), 20,
+          seed, data);
+
+      LSHBenchmark benchmark(data, k, projections, tables, 0);
+      RunWithThreads(runner, "scaling/lsh", benchmark, BenchmarkParameters()
+          .Add("points", data.n_cols).Add("dimensionality", data.n_rows)
+          .Add("k", k).Add("projections", projections).Add("tables", tables),
+          threads);
+    }
+  }
+
+  util::SetNumThreads(defaultThreads);
+}
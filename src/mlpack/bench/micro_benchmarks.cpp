@@ -0,0 +1,291 @@
+/**
+ * @file micro_benchmarks.cpp
+ *
+ * Microbenchmarks of the building blocks that dominate the running time of the
+ * tree-based methods and the mixture models: metrics, bounds, the candidate
+ * lists of neighbor search, and the Gaussian density.
+ */
+#include "benchmark.hpp"
+#include "datasets.hpp"
+
+#include <mlpack/core/tree/ballbound.hpp>
+#include <mlpack/core/tree/hrectbound.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+
+using namespace mlpack;
+using namespace mlpack::bench;
+using namespace mlpack::bound;
+using namespace mlpack::distribution;
+using namespace mlpack::metric;
+using namespace mlpack::neighbor;
+
+// The dimensionalities the microbenchmarks are run in.
+static const size_t Dimensionalities[] = { 3, 32 };
+static const size_t NumDimensionalities = 2;
+
+/**
+ * Evaluate the metric between consecutive points of a dataset.
+ */
+template<typename MetricType>
+class MetricBenchmark
+{
+ public:
+  MetricBenchmark(const arma::mat& data, const size_t evaluations) :
+      data(data), evaluations(evaluations), sum(0.0) { }
+
+  void Reset() { sum = 0.0; }
+
+  size_t Run()
+  {
+    double total = 0.0;
+    for (size_t i = 0, j = 0; i < evaluations; ++i)
+    {
+      const size_t next = (j + 1 == data.n_cols) ? 0 : j + 1;
+      total += MetricType::Evaluate(data.unsafe_col(j), data.unsafe_col(next));
+      j = next;
+    }
+
+    sum = total;
+    return evaluations;
+  }
+
+ private:
+  const arma::mat& data;
+  size_t evaluations;
+  //! The sum of the distances, so that they must be computed.
+  volatile double sum;
+};
+
+/**
+ * Compute the minimum and maximum distances between every pair of a set of
+ * bounds, and between every bound and a set of points.
+ */
+template<typename BoundType>
+class BoundBenchmark
+{
+ public:
+  BoundBenchmark(const arma::mat& data,
+                 const arma::mat& points,
+                 const size_t pointsPerBound) :
+      points(points), sum(0.0)
+  {
+    for (size_t begin = 0; begin + pointsPerBound <= data.n_cols;
+         begin += pointsPerBound)
+    {
+      bounds.push_back(BoundType(data.n_rows));
+      bounds.back() |= data.cols(begin, begin + pointsPerBound - 1);
+    }
+  }
+
+  void Reset() { sum = 0.0; }
+
+  size_t Run()
+  {
+    double total = 0.0;
+    for (size_t i = 0; i < bounds.size(); ++i)
+    {
+      for (size_t j = 0; j < bounds.size(); ++j)
+        total += bounds[i].MinDistance(bounds[j]) +
+            bounds[i].MaxDistance(bounds[j]);
+
+      for (size_t j = 0; j < points.n_cols; ++j)
+      {
+        const arma::vec point = points.unsafe_col(j);
+        total += bounds[i].MinDistance(point) + bounds[i].MaxDistance(point);
+      }
+    }
+
+    sum = total;
+    return bounds.size() * (bounds.size() + points.n_cols);
+  }
+
+ private:
+  std::vector<BoundType> bounds;
+  const arma::mat& points;
+  volatile double sum;
+};
+
+/**
+ * Insert a stream of candidate distances into the candidate lists of a set of
+ * queries, as NeighborSearchRules::BaseCase() does.
+ */
+template<typename CandidateListType>
+class CandidateListBenchmark
+{
+ public:
+  CandidateListBenchmark(const arma::mat& candidates,
+                         const size_t k,
+                         const size_t queries,
+                         const size_t candidatesPerQuery) :
+      candidates(candidates),
+      candidatesPerQuery(candidatesPerQuery),
+      distances(k, queries),
+      neighbors(k, queries)
+  { }
+
+  void Reset()
+  {
+    distances.fill(NearestNeighborSort::WorstDistance());
+    neighbors.fill(size_t() - 1);
+  }
+
+  size_t Run()
+  {
+    for (size_t q = 0; q < distances.n_cols; ++q)
+    {
+      // Each query sees a different window of the candidates.
+      size_t c = (q * 7919) % candidates.n_elem;
+      for (size_t i = 0; i < candidatesPerQuery; ++i)
+      {
+        CandidateListType::Insert(distances, neighbors, q, i, candidates[c]);
+        if (++c == candidates.n_elem)
+          c = 0;
+      }
+    }
+    CandidateListType::Finalize(distances, neighbors);
+
+    return distances.n_cols * candidatesPerQuery;
+  }
+
+ private:
+  const arma::mat& candidates;
+  size_t candidatesPerQuery;
+  arma::mat distances;
+  arma::Mat<size_t> neighbors;
+};
+
+/**
+ * Compute the density of a full-covariance Gaussian at a set of points, one
+ * point at a time or all at once.
+ */
+class GaussianBenchmark
+{
+ public:
+  GaussianBenchmark(const GaussianDistribution& gaussian,
+                    const arma::mat& points,
+                    const bool batch) :
+      gaussian(gaussian), points(points), batch(batch), sum(0.0) { }
+
+  void Reset() { sum = 0.0; }
+
+  size_t Run()
+  {
+    if (batch)
+    {
+      gaussian.Probability(points, probabilities);
+      sum = arma::accu(probabilities);
+    }
+    else
+    {
+      double total = 0.0;
+      for (size_t i = 0; i < points.n_cols; ++i)
+        total += gaussian.Probability(points.unsafe_col(i));
+      sum = total;
+    }
+
+    return points.n_cols;
+  }
+
+ private:
+  const GaussianDistribution& gaussian;
+  const arma::mat& points;
+  bool batch;
+  arma::vec probabilities;
+  volatile double sum;
+};
+
+template<typename MetricType>
+static void RunMetricBenchmark(BenchmarkRunner& runner,
+                               const std::string& name,
+                               const arma::mat& data)
+{
+  MetricBenchmark<MetricType> benchmark(data, runner.Scaled(1000000));
+  runner.Run(name, benchmark,
+      BenchmarkParameters().Add("dimensionality", data.n_rows));
+}
+
+template<typename BoundType>
+static void RunBoundBenchmark(BenchmarkRunner& runner,
+                              const std::string& name,
+                              const arma::mat& data,
+                              const arma::mat& points)
+{
+  const size_t pointsPerBound = 16;
+  BoundBenchmark<BoundType> benchmark(data, points, pointsPerBound);
+  runner.Run(name, benchmark, BenchmarkParameters()
+      .Add("dimensionality", data.n_rows)
+      .Add("bounds", data.n_cols / pointsPerBound)
+      .Add("points", points.n_cols));
+}
+
+template<typename CandidateListType>
+static void RunCandidateListBenchmark(BenchmarkRunner& runner,
+                                      const std::string& name,
+                                      const arma::mat& candidates,
+                                      const size_t k)
+{
+  const size_t queries = runner.Scaled(1000);
+  const size_t candidatesPerQuery = 2000;
+  CandidateListBenchmark<CandidateListType> benchmark(candidates, k, queries,
+      candidatesPerQuery);
+  runner.Run(name, benchmark, BenchmarkParameters()
+      .Add("k", k)
+      .Add("queries", queries)
+      .Add("candidates_per_query", candidatesPerQuery));
+}
+
+void mlpack::bench::RunMicroBenchmarks(BenchmarkRunner& runner)
+{
+  for (size_t i = 0; i < NumDimensionalities; ++i)
+  {
+    const size_t d = Dimensionalities[i];
+
+    arma::mat data;
+    UniformDataset(d, 4096, runner.Seed(), data);
+
+    RunMetricBenchmark<EuclideanDistance>(runner, "metric/euclidean", data);
+    RunMetricBenchmark<SquaredEuclideanDistance>(runner,
+        "metric/squared_euclidean", data);
+    RunMetricBenchmark<ManhattanDistance>(runner, "metric/manhattan", data);
+
+    const arma::mat points = data.cols(0, 255);
+    RunBoundBenchmark<HRectBound<2> >(runner, "bound/hrect", data, points);
+    RunBoundBenchmark<BallBound<> >(runner, "bound/ball", data, points);
+
+    // A full covariance, with correlated dimensions.
+    arma::mat factor;
+    UniformDataset(d, d, runner.Seed() + 1, factor);
+    const arma::mat covariance = factor * trans(factor) +
+        arma::eye<arma::mat>(d, d);
+    arma::vec mean(d);
+    mean.fill(0.5);
+    const GaussianDistribution gaussian(mean, covariance);
+
+    arma::mat gaussianPoints;
+    UniformDataset(d, runner.Scaled(100000), runner.Seed(), gaussianPoints);
+
+    GaussianBenchmark pointBenchmark(gaussian, gaussianPoints, false);
+    runner.Run("gaussian/probability", pointBenchmark, BenchmarkParameters()
+        .Add("dimensionality", d).Add("points", gaussianPoints.n_cols));
+
+    GaussianBenchmark batchBenchmark(gaussian, gaussianPoints, true);
+    runner.Run("gaussian/probability_batch", batchBenchmark,
+        BenchmarkParameters().Add("dimensionality", d)
+        .Add("points", gaussianPoints.n_cols));
+  }
+
+  // The candidate distances, one per column.
+  arma::mat candidates;
+  UniformDataset(1, 65536, runner.Seed(), candidates);
+
+  const size_t ks[] = { 1, 10, 100 };
+  for (size_t i = 0; i < 3; ++i)
+  {
+    RunCandidateListBenchmark<SortedCandidateList<NearestNeighborSort> >(
+        runner, "candidate_list/sorted", candidates, ks[i]);
+    RunCandidateListBenchmark<HeapCandidateList<NearestNeighborSort> >(
+        runner, "candidate_list/heap", candidates, ks[i]);
+    RunCandidateListBenchmark<AdaptiveCandidateList<NearestNeighborSort> >(
+        runner, "candidate_list/adaptive", candidates, ks[i]);
+  }
+}
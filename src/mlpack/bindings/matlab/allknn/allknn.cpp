@@ -2,23 +2,195 @@
  * @file allknn.cpp
  * @author Patrick Mason
  *
- * MEX function for MATLAB All-kNN binding.
+ * MEX function for MATLAB All-kNN binding.  Called with the arguments of
+ * allknn.m, it builds the trees and finds the neighbors in one call.  Called
+ * with a command as the first argument, it manages a reference kd-tree which is
+ * kept between calls (see allknn_model.m):
+ *
+ *   handle = mex_allknn('build', referencePoints, leafSize);
+ *   [distances neighbors] = mex_allknn('search', handle, queryPoints, k,
+ *       singleMode);
+ *   mex_allknn('free', handle);
+ *
+ * As with the other form, points are columns, and neighbors are 0-based.
  */
 #include "mex.h"
 
 #include <mlpack/core.hpp>
 #include <mlpack/core/tree/cover_tree.hpp>
 #include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+#include <mlpack/methods/neighbor_search/unmap.hpp>
+
+#include "../mex_util.hpp"
 
 using namespace std;
 using namespace mlpack;
 using namespace mlpack::neighbor;
 using namespace mlpack::tree;
+using namespace mlpack::matlab;
+
+typedef BinarySpaceTree<bound::HRectBound<2>,
+    NeighborSearchStat<NearestNeighborSort> > TreeType;
+
+/**
+ * A reference kd-tree, with its own copy of the reference points (which the
+ * tree rearranges).
+ */
+class ReferenceModel
+{
+ public:
+  ReferenceModel(const mxArray* points, const size_t leafSize) :
+      referenceData(mxGetPr(points), mxGetM(points), mxGetN(points)),
+      tree(new TreeType(referenceData, oldFromNewRefs, leafSize)),
+      leafSize(leafSize)
+  { }
+
+  ~ReferenceModel() { delete tree; }
+
+  //! The (rearranged) reference points.
+  arma::mat referenceData;
+  //! The original index of each rearranged reference point.
+  std::vector<size_t> oldFromNewRefs;
+  //! The reference tree.
+  TreeType* tree;
+  //! The leaf size, also used for the query trees.
+  size_t leafSize;
+};
+
+//! Raise an error unless 1 <= k <= the number of reference points.
+static void CheckK(const size_t k, const size_t referencePoints)
+{
+  if (k == 0 || k > referencePoints)
+  {
+    stringstream os;
+    os << "Invalid k: " << k << "; must be greater than 0 and less "
+        << "than or equal to the number of reference points ("
+        << referencePoints << ").";
+    mexErrMsgTxt(os.str().c_str());
+  }
+}
+
+//! Write neighbor indices (mapped to the original reference indices, if a map
+//! is given) to a new MATLAB matrix.
+static void ReturnNeighbors(const arma::Mat<size_t>& neighbors,
+                            const std::vector<size_t>* referenceMap,
+                            mxArray*& array)
+{
+  double* out = CreateMatrix(neighbors.n_rows, neighbors.n_cols, array);
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+    out[i] = (referenceMap == NULL) ? neighbors[i] :
+        (*referenceMap)[neighbors[i]];
+}
+
+/**
+ * Find the k nearest neighbors of the given query points in the reference
+ * model.  The distances are computed directly into the MATLAB output.  With
+ * single-tree search, the query points are not rearranged, so they are used in
+ * place; otherwise a query tree is built on a copy of them.
+ */
+static void SearchQueries(ReferenceModel& model,
+                          const mxArray* queries,
+                          const size_t k,
+                          const bool singleMode,
+                          mxArray* plhs[])
+{
+  CheckMatrix(queries, "queryPoints");
+  const size_t numQueries = mxGetN(queries);
+  if (numQueries > 0 && mxGetM(queries) != model.referenceData.n_rows)
+    mexErrMsgTxt("The query points must have the dimensionality of the "
+        "reference points.");
+
+  arma::mat distances(CreateMatrix(k, numQueries, plhs[0]), k, numQueries,
+      false, true);
+  if (numQueries == 0)
+  {
+    CreateMatrix(k, 0, plhs[1]);
+    return;
+  }
+
+  arma::Mat<size_t> neighborsOut;
+  if (singleMode && !model.tree->IsLeaf())
+  {
+    const arma::mat queryData(mxGetPr(queries), mxGetM(queries), numQueries,
+        false, true);
+    AllkNN allknn(model.tree, NULL, model.referenceData, queryData, true);
+    allknn.Search(k, neighborsOut, distances);
+
+    ReturnNeighbors(neighborsOut, &model.oldFromNewRefs, plhs[1]);
+  }
+  else
+  {
+    arma::mat queryData(mxGetPr(queries), mxGetM(queries), numQueries);
+    std::vector<size_t> oldFromNewQueries;
+    TreeType queryTree(queryData, oldFromNewQueries, model.leafSize);
+
+    AllkNN allknn(model.tree, &queryTree, model.referenceData, queryData);
+    arma::mat distancesOut;
+    allknn.Search(k, neighborsOut, distancesOut);
+
+    arma::Mat<size_t> neighbors;
+    Unmap(neighborsOut, distancesOut, model.oldFromNewRefs, oldFromNewQueries,
+        neighbors, distances);
+    ReturnNeighbors(neighbors, NULL, plhs[1]);
+  }
+}
+
+//! Handle the 'build', 'search' and 'free' commands.
+static void RunCommand(int nlhs, mxArray *plhs[],
+                       int nrhs, const mxArray *prhs[])
+{
+  const string command = GetString(prhs[0]);
+  if (command == "build")
+  {
+    if (nrhs != 3 || nlhs != 1)
+      mexErrMsgTxt("Usage: handle = mex_allknn('build', referencePoints, "
+          "leafSize).");
+
+    CheckMatrix(prhs[1], "referencePoints");
+    const int leafSize = (int) mxGetScalar(prhs[2]);
+    if (leafSize < 1)
+      mexErrMsgTxt("The leaf size must be greater than 0.");
+    if (mxGetN(prhs[1]) == 0)
+      mexErrMsgTxt("There must be at least one reference point.");
+
+    plhs[0] = CreateHandle(new ReferenceModel(prhs[1], (size_t) leafSize));
+  }
+  else if (command == "search")
+  {
+    if (nrhs != 5 || nlhs != 2)
+      mexErrMsgTxt("Usage: [distances neighbors] = mex_allknn('search', "
+          "handle, queryPoints, k, singleMode).");
+
+    ReferenceModel* model = GetHandle<ReferenceModel>(prhs[1]);
+    const size_t k = (size_t) mxGetScalar(prhs[3]);
+    CheckK(k, model->referenceData.n_cols);
+
+    SearchQueries(*model, prhs[2], k, (mxGetScalar(prhs[4]) == 1.0), plhs);
+  }
+  else if (command == "free")
+  {
+    if (nrhs != 2)
+      mexErrMsgTxt("Usage: mex_allknn('free', handle).");
+
+    DestroyHandle<ReferenceModel>(prhs[1]);
+  }
+  else
+  {
+    mexErrMsgTxt("Unknown command; the commands are 'build', 'search', and "
+        "'free'.");
+  }
+}
 
 // the gateway, required by all mex functions
 void mexFunction(int nlhs, mxArray *plhs[],
                  int nrhs, const mxArray *prhs[])
 {
+  if (nrhs >= 1 && mxIsChar(prhs[0]))
+  {
+    RunCommand(nlhs, plhs, nrhs, prhs);
+    return;
+  }
+
   // checking inputs
   if (nrhs != 7)
   {
@@ -30,24 +202,15 @@ void mexFunction(int nlhs, mxArray *plhs[],
     mexErrMsgTxt("Two outputs required.");
   }
 
-  // getting the dimensions of the reference matrix
-  size_t numPoints = mxGetN(prhs[0]);
-  size_t numDimensions = mxGetM(prhs[0]);
-
-  // feeding the referenceData matrix
-  arma::mat referenceData(numDimensions, numPoints);
-  // setting the values.
-  double * mexDataPoints = mxGetPr(prhs[0]);
-  for (int i = 0, n = numPoints * numDimensions; i < n; ++i)
-  {
-    referenceData(i) = mexDataPoints[i];
-  }
+  CheckMatrix(prhs[0], "dataPoints");
+  CheckMatrix(prhs[2], "queryPoints");
+  const size_t numPoints = mxGetN(prhs[0]);
 
   // getting the leafsize
   int lsInt = (int) mxGetScalar(prhs[3]);
 
   // getting k
-  size_t k = (int) mxGetScalar(prhs[1]);
+  size_t k = (size_t) mxGetScalar(prhs[1]);
 
   // naive algorithm?
   bool naive = (mxGetScalar(prhs[4]) == 1.0);
@@ -55,9 +218,6 @@ void mexFunction(int nlhs, mxArray *plhs[],
   // single mode?
   bool singleMode = (mxGetScalar(prhs[5]) == 1.0);
 
-  // the query matrix
-  double * mexQueryPoints = mxGetPr(prhs[2]);
-  arma::mat queryData;
   bool hasQueryData = ((mxGetM(prhs[2]) != 0) && (mxGetN(prhs[2]) != 0));
 
   // cover-tree?
@@ -65,14 +225,7 @@ void mexFunction(int nlhs, mxArray *plhs[],
 
   // Sanity check on k value: must be greater than 0, must be less than the
   // number of reference points.
-  if (k > referenceData.n_cols)
-  {
-    stringstream os;
-    os << "Invalid k: " << k << "; must be greater than 0 and less ";
-    os << "than or equal to the number of reference points (";
-    os << referenceData.n_cols << ")." << endl;
-    mexErrMsgTxt(os.str().c_str());
-  }
+  CheckK(k, numPoints);
 
   // Sanity check on leaf size.
   if (lsInt < 0)
@@ -88,192 +241,87 @@ void mexFunction(int nlhs, mxArray *plhs[],
   if (singleMode && naive)
   {
      mexWarnMsgTxt("single_mode ignored because naive is present.");
+     singleMode = false;
   }
 
+  // In naive mode, each tree is a single leaf.
   if (naive)
-    leafSize = referenceData.n_cols;
+    leafSize = std::max(numPoints, (size_t) mxGetN(prhs[2]));
 
-  arma::Mat<size_t> neighbors;
-  arma::mat distances;
-
-  //if (!CLI::HasParam("cover_tree"))
-  if (usesCoverTree)
+  if (!usesCoverTree)
   {
-    // Because we may construct it differently, we need a pointer.
-    AllkNN* allknn = NULL;
-
-    // Mappings for when we build the tree.
-    std::vector<size_t> oldFromNewRefs;
-
-    // Build trees by hand, so we can save memory: if we pass a tree to
-    // NeighborSearch, it does not copy the matrix.
-
-    BinarySpaceTree<bound::HRectBound<2>, QueryStat<NearestNeighborSort> >
-      refTree(referenceData, oldFromNewRefs, leafSize);
-    BinarySpaceTree<bound::HRectBound<2>, QueryStat<NearestNeighborSort> >*
-      queryTree = NULL; // Empty for now.
-
-    std::vector<size_t> oldFromNewQueries;
+    // The tree rearranges the reference points, so they are copied once.
+    ReferenceModel model(prhs[0], leafSize);
 
     if (hasQueryData)
     {
-      // setting the values.
-      mexDataPoints = mxGetPr(prhs[2]);
-      numPoints = mxGetN(prhs[2]);
-      numDimensions = mxGetM(prhs[2]);
-      queryData = arma::mat(numDimensions, numPoints);
-      for (int i = 0, n = numPoints * numDimensions; i < n; ++i)
-      {
-        queryData(i) = mexDataPoints[i];
-      }
-
-      if (naive && leafSize < queryData.n_cols)
-        leafSize = queryData.n_cols;
-
-      // Build trees by hand, so we can save memory: if we pass a tree to
-      // NeighborSearch, it does not copy the matrix.
-      if (!singleMode)
-      {
-        queryTree = new BinarySpaceTree<bound::HRectBound<2>,
-            QueryStat<NearestNeighborSort> >(queryData, oldFromNewQueries,
-            leafSize);
-      }
-
-      allknn = new AllkNN(&refTree, queryTree, referenceData, queryData,
-          singleMode);
-    }
-    else
-    {
-      allknn = new AllkNN(&refTree, referenceData, singleMode);
-    }
-
-    arma::mat distancesOut;
-    arma::Mat<size_t> neighborsOut;
-
-    allknn->Search(k, neighborsOut, distancesOut);
-
-    // We have to map back to the original indices from before the tree
-    // construction.
-    neighbors.set_size(neighborsOut.n_rows, neighborsOut.n_cols);
-    distances.set_size(distancesOut.n_rows, distancesOut.n_cols);
-
-    // Do the actual remapping.
-    if ((hasQueryData) && !singleMode)
-    {
-      for (size_t i = 0; i < distancesOut.n_cols; ++i)
-      {
-        // Map distances (copy a column) and square root.
-        distances.col(oldFromNewQueries[i]) = sqrt(distancesOut.col(i));
-
-        // Map indices of neighbors.
-        for (size_t j = 0; j < distancesOut.n_rows; ++j)
-        {
-          neighbors(j, oldFromNewQueries[i]) =
-              oldFromNewRefs[neighborsOut(j, i)];
-        }
-      }
-    }
-    else if ((hasQueryData) && singleMode)
-    {
-      // No remapping of queries is necessary.  So distances are the same.
-      distances = sqrt(distancesOut);
-
-      // The neighbor indices must be mapped.
-      for (size_t j = 0; j < neighborsOut.n_elem; ++j)
-      {
-        neighbors[j] = oldFromNewRefs[neighborsOut[j]];
-      }
+      SearchQueries(model, prhs[2], k, singleMode, plhs);
     }
     else
     {
-      for (size_t i = 0; i < distancesOut.n_cols; ++i)
-      {
-        // Map distances (copy a column).
-        distances.col(oldFromNewRefs[i]) = sqrt(distancesOut.col(i));
-
-        // Map indices of neighbors.
-        for (size_t j = 0; j < distancesOut.n_rows; ++j)
-        {
-          neighbors(j, oldFromNewRefs[i]) = oldFromNewRefs[neighborsOut(j, i)];
-        }
-      }
+      AllkNN allknn(model.tree, model.referenceData, singleMode);
+
+      arma::mat distancesOut;
+      arma::Mat<size_t> neighborsOut;
+      allknn.Search(k, neighborsOut, distancesOut);
+
+      // We have to map back to the original indices from before the tree
+      // construction; the distances are mapped directly into the output.
+      arma::mat distances(CreateMatrix(k, numPoints, plhs[0]), k, numPoints,
+          false, true);
+      arma::Mat<size_t> neighbors;
+      Unmap(neighborsOut, distancesOut, model.oldFromNewRefs,
+          model.oldFromNewRefs, neighbors, distances);
+      ReturnNeighbors(neighbors, NULL, plhs[1]);
     }
-
-    // Clean up.
-    if (queryTree)
-      delete queryTree;
-
-    delete allknn;
   }
   else // Cover trees.
   {
+    typedef CoverTree<metric::LMetric<2, true>, tree::FirstPointIsRoot,
+        NeighborSearchStat<NearestNeighborSort> > CoverTreeType;
+    typedef NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>,
+        CoverTreeType> CoverTreeAllkNN;
+
+    // Cover trees do not rearrange the points, so the MATLAB matrices are used
+    // in place.
+    const arma::mat referenceData(mxGetPr(prhs[0]), mxGetM(prhs[0]),
+        numPoints, false, true);
+    const size_t numQueries = hasQueryData ? mxGetN(prhs[2]) : numPoints;
+
     // Build our reference tree.
-    CoverTree<metric::LMetric<2, true>, tree::FirstPointIsRoot,
-        QueryStat<NearestNeighborSort> > referenceTree(referenceData, 1.3);
-    CoverTree<metric::LMetric<2, true>, tree::FirstPointIsRoot,
-        QueryStat<NearestNeighborSort> >* queryTree = NULL;
+    CoverTreeType referenceTree(referenceData, 1.3);
+    CoverTreeType* queryTree = NULL;
+    CoverTreeAllkNN* allknn = NULL;
 
-    NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>,
-        CoverTree<metric::LMetric<2, true>, tree::FirstPointIsRoot,
-        QueryStat<NearestNeighborSort> > >* allknn = NULL;
+    arma::mat distances(CreateMatrix(k, numQueries, plhs[0]), k, numQueries,
+        false, true);
+    arma::Mat<size_t> neighbors;
 
     // See if we have query data.
     if (hasQueryData)
     {
-      // setting the values.
-      mexDataPoints = mxGetPr(prhs[2]);
-      numPoints = mxGetN(prhs[2]);
-      numDimensions = mxGetM(prhs[2]);
-      queryData = arma::mat(numDimensions, numPoints);
-      for (int i = 0, n = numPoints * numDimensions; i < n; ++i)
-      {
-        queryData(i) = mexDataPoints[i];
-      }
+      const arma::mat queryData(mxGetPr(prhs[2]), mxGetM(prhs[2]), numQueries,
+          false, true);
 
       // Build query tree.
       if (!singleMode)
-      {
-        queryTree = new CoverTree<metric::LMetric<2, true>,
-            tree::FirstPointIsRoot, QueryStat<NearestNeighborSort> >(queryData,
-            1.3);
-      }
-
-      allknn = new NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>,
-          CoverTree<metric::LMetric<2, true>, tree::FirstPointIsRoot,
-          QueryStat<NearestNeighborSort> > >(&referenceTree, queryTree,
-          referenceData, queryData, singleMode);
+        queryTree = new CoverTreeType(queryData, 1.3);
+
+      allknn = new CoverTreeAllkNN(&referenceTree, queryTree, referenceData,
+          queryData, singleMode);
+      allknn->Search(k, neighbors, distances);
     }
     else
     {
-      allknn = new NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>,
-          CoverTree<metric::LMetric<2, true>, tree::FirstPointIsRoot,
-          QueryStat<NearestNeighborSort> > >(&referenceTree, referenceData,
-          singleMode);
+      allknn = new CoverTreeAllkNN(&referenceTree, referenceData, singleMode);
+      allknn->Search(k, neighbors, distances);
     }
 
-    allknn->Search(k, neighbors, distances);
+    ReturnNeighbors(neighbors, NULL, plhs[1]);
 
     delete allknn;
 
     if (queryTree)
       delete queryTree;
   }
-
-  // writing back to matlab
-  // constructing matrix to return to matlab
-  plhs[0] = mxCreateDoubleMatrix(distances.n_rows, distances.n_cols, mxREAL);
-  plhs[1] = mxCreateDoubleMatrix(neighbors.n_rows, neighbors.n_cols, mxREAL);
-
-  // setting the values
-  double * out = mxGetPr(plhs[0]);
-  for (int i = 0, n = distances.n_rows * distances.n_cols; i < n; ++i)
-  {
-    out[i] = distances(i);
-  }
-  out = mxGetPr(plhs[1]);
-  for (int i = 0, n = neighbors.n_rows * neighbors.n_cols; i < n; ++i)
-  {
-    out[i] = neighbors(i);
-  }
-
 }
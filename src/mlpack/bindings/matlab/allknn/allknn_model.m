@@ -0,0 +1,55 @@
+classdef allknn_model < handle
+%All K-Nearest-Neighbors with a persistent reference tree
+%
+%  An allknn_model builds a kd-tree on the reference points once; each call to
+%  search() then only costs the search itself, so the model should be used
+%  instead of allknn() when neighbors are found for many query sets with the
+%  same reference set.  The tree is freed when the model is deleted.
+%
+% Parameters:
+% referencePoints - the matrix of reference points.  Rows represent points,
+%                   columns represent dimensions.
+% leafSize        - leaf size of the kd-tree (default 20).
+%
+% Examples:
+% model = allknn_model(referencePoints);
+% [distances neighbors] = model.search(queryPoints, 5);
+% [distances neighbors] = model.search(queryPoints, 5, 'singleMode', true);
+% delete(model);
+
+  properties (Access = private)
+    handle % the handle of the tree in the mex function
+  end
+
+  methods
+    function this = allknn_model(referencePoints, varargin)
+      p = inputParser;
+      p.addParamValue('leafSize', 20, @isscalar);
+      p.parse(varargin{:});
+
+      this.handle = mex_allknn('build', referencePoints', p.Results.leafSize);
+    end
+
+    function [distances neighbors] = search(this, queryPoints, k, varargin)
+      % With singleMode, the query points are searched one at a time, without
+      % building a tree on them; this is faster for few query points.
+      p = inputParser;
+      p.addParamValue('singleMode', false, @(x) (x == true) || (x == false));
+      p.parse(varargin{:});
+
+      [distances neighbors] = mex_allknn('search', this.handle, queryPoints', ...
+          k, p.Results.singleMode);
+
+      % transposing results
+      distances = distances';
+      neighbors = neighbors' + 1; % matlab indices begin at 1, not zero
+    end
+
+    function delete(this)
+      if ~isempty(this.handle)
+        mex_allknn('free', this.handle);
+        this.handle = [];
+      end
+    end
+  end
+end
@@ -9,6 +9,8 @@
 #include <mlpack/core.hpp>
 #include <mlpack/methods/gmm/gmm.hpp>
 
+#include "../mex_util.hpp"
+
 using namespace mlpack;
 using namespace mlpack::gmm;
 using namespace mlpack::util;
@@ -34,15 +36,12 @@ void mexFunction(int nlhs, mxArray *plhs[],
   else
     math::RandomSeed((size_t) std::time(NULL));
 
-  // loading the data
-  double * mexDataPoints = mxGetPr(prhs[0]);
+  // The data is only read, so the MATLAB matrix is used in place.
+  matlab::CheckMatrix(prhs[0], "dataPoints");
   size_t numPoints = mxGetN(prhs[0]);
   size_t numDimensions = mxGetM(prhs[0]);
-  arma::mat dataPoints(numDimensions, numPoints);
-  for (int i = 0, n = numPoints * numDimensions; i < n; ++i)
-  {
-    dataPoints(i) = mexDataPoints[i];
-  }
+  const arma::mat dataPoints(mxGetPr(prhs[0]), numDimensions, numPoints,
+      false, true);
 
   int gaussians = (int) mxGetScalar(prhs[1]);
   if (gaussians <= 0)
@@ -10,6 +10,8 @@
 #include <mlpack/methods/kmeans/kmeans.hpp>
 #include <mlpack/methods/kmeans/allow_empty_clusters.hpp>
 
+#include "../mex_util.hpp"
+
 using namespace mlpack;
 using namespace mlpack::kmeans;
 using namespace std;
@@ -82,17 +84,12 @@ void mexFunction(int nlhs, mxArray *plhs[],
   }
   */
 
-  // Load our dataset.
+  // Load our dataset.  It is only read, so the MATLAB matrix is used in place.
+  matlab::CheckMatrix(prhs[0], "dataPoints");
   const size_t numPoints = mxGetN(prhs[0]);
   const size_t numDimensions = mxGetM(prhs[0]);
-  arma::mat dataset(numDimensions, numPoints);
-
-  // setting the values.
-  double * mexDataPoints = mxGetPr(prhs[0]);
-  for (int i = 0, n = numPoints * numDimensions; i < n; ++i)
-  {
-    dataset(i) = mexDataPoints[i];
-  }
+  const arma::mat dataset(mxGetPr(prhs[0]), numDimensions, numPoints, false,
+      true);
 
   // Now create the KMeans object.  Because we could be using different types,
   // it gets a little weird...
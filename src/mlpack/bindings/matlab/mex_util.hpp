@@ -0,0 +1,142 @@
+/**
+ * @file mex_util.hpp
+ *
+ * Utilities shared by the MEX functions of the MATLAB bindings: passing
+ * matrices between MATLAB and Armadillo without copying them, and handles to
+ * objects (trees, models) that are kept alive between calls.
+ */
+#ifndef __MLPACK_BINDINGS_MATLAB_MEX_UTIL_HPP
+#define __MLPACK_BINDINGS_MATLAB_MEX_UTIL_HPP
+
+#include "mex.h"
+
+#include <mlpack/core.hpp>
+
+#include <set>
+#include <stdint.h>
+
+namespace mlpack {
+namespace matlab {
+
+/**
+ * Make sure the given argument is a real, dense matrix of doubles, whose
+ * memory can be used directly by an Armadillo matrix:
+ *
+ * @code
+ * CheckMatrix(prhs[0], "dataPoints");
+ * const arma::mat data(mxGetPr(prhs[0]), mxGetM(prhs[0]), mxGetN(prhs[0]),
+ *     false, true);
+ * @endcode
+ *
+ * MATLAB does not allow the arguments of a MEX function to be modified, so such
+ * a matrix must only be read; data which is rearranged (by building a tree on
+ * it) must be copied first.
+ *
+ * @param array The argument.
+ * @param name The name of the argument, for the error message.
+ */
+inline void CheckMatrix(const mxArray* array, const char* name)
+{
+  if (!mxIsDouble(array) || mxIsComplex(array) || mxIsSparse(array))
+  {
+    std::ostringstream error;
+    error << name << " must be a real, full matrix of doubles.";
+    mexErrMsgTxt(error.str().c_str());
+  }
+}
+
+/**
+ * Create a matrix of doubles to return to MATLAB, and return its memory, so
+ * that the results can be computed directly into it:
+ *
+ * @code
+ * arma::mat distances(CreateMatrix(k, n, plhs[0]), k, n, false, true);
+ * @endcode
+ *
+ * @param rows Number of rows.
+ * @param cols Number of columns.
+ * @param array Set to the new matrix.
+ */
+inline double* CreateMatrix(const size_t rows,
+                            const size_t cols,
+                            mxArray*& array)
+{
+  array = mxCreateDoubleMatrix(rows, cols, mxREAL);
+  return mxGetPr(array);
+}
+
+//! Get the string in the given argument (the command of a MEX function).
+inline std::string GetString(const mxArray* array)
+{
+  if (!mxIsChar(array))
+    mexErrMsgTxt("Expected a string.");
+
+  char* chars = mxArrayToString(array);
+  const std::string result(chars);
+  mxFree(chars);
+  return result;
+}
+
+/**
+ * The objects of the given type that were created with CreateHandle() and not
+ * destroyed yet.  Handles passed in from MATLAB are checked against these
+ * before they are used, so a stale or invalid handle gives an error instead of
+ * a crash.
+ */
+template<typename ObjectType>
+std::set<ObjectType*>& LiveObjects()
+{
+  static std::set<ObjectType*> objects;
+  return objects;
+}
+
+/**
+ * Return a handle to the given object, which is kept alive (along with the MEX
+ * file, which MATLAB would otherwise unload on 'clear mex') until the handle
+ * is given to DestroyHandle().
+ *
+ * @param object The object, allocated with new; it is now owned by the handle.
+ */
+template<typename ObjectType>
+mxArray* CreateHandle(ObjectType* object)
+{
+  LiveObjects<ObjectType>().insert(object);
+  mexLock();
+
+  mxArray* handle = mxCreateNumericMatrix(1, 1, mxUINT64_CLASS, mxREAL);
+  *((uint64_t*) mxGetData(handle)) = (uint64_t) (uintptr_t) object;
+  return handle;
+}
+
+/**
+ * Get the object of the given handle; if it is not a handle to a live object
+ * of this type, an error is raised in MATLAB.
+ */
+template<typename ObjectType>
+ObjectType* GetHandle(const mxArray* handle)
+{
+  if (!mxIsUint64(handle) || mxGetNumberOfElements(handle) != 1)
+    mexErrMsgTxt("Invalid handle.");
+
+  ObjectType* object = (ObjectType*) (uintptr_t)
+      *((const uint64_t*) mxGetData(handle));
+  if (LiveObjects<ObjectType>().count(object) == 0)
+    mexErrMsgTxt("Invalid handle; the object may have been freed already.");
+
+  return object;
+}
+
+//! Destroy the object of the given handle.
+template<typename ObjectType>
+void DestroyHandle(const mxArray* handle)
+{
+  ObjectType* object = GetHandle<ObjectType>(handle);
+  LiveObjects<ObjectType>().erase(object);
+  delete object;
+  mexUnlock();
+}
+
+}; // namespace matlab
+}; // namespace mlpack
+
+#endif
@@ -148,22 +148,35 @@
 #include <mlpack/core/util/arma_traits.hpp>
 #include <mlpack/core/util/log.hpp>
 #include <mlpack/core/util/cli.hpp>
+#include <mlpack/core/util/parallel.hpp>
+#include <mlpack/core/util/numa.hpp>
+#include <mlpack/core/util/huge_pages.hpp>
+#include <mlpack/core/util/memory_usage.hpp>
 #include <mlpack/core/util/ostream_extra.hpp>
 #include <mlpack/core/data/load.hpp>
 #include <mlpack/core/data/save.hpp>
+#include <mlpack/core/data/mapped_matrix.hpp>
+#include <mlpack/core/data/columnar_matrix.hpp>
+#include <mlpack/core/data/streaming_reader.hpp>
 #include <mlpack/core/data/normalize_labels.hpp>
+#include <mlpack/core/data/space_filling_curve.hpp>
 #include <mlpack/core/math/clamp.hpp>
+#include <mlpack/core/math/fast_exp.hpp>
 #include <mlpack/core/math/random.hpp>
+#include <mlpack/core/math/alias_table.hpp>
 #include <mlpack/core/math/lin_alg.hpp>
+#include <mlpack/core/math/quantile_bins.hpp>
 #include <mlpack/core/math/range.hpp>
 #include <mlpack/core/math/round.hpp>
 #include <mlpack/core/util/save_restore_utility.hpp>
+#include <mlpack/core/dists/distribution_traits.hpp>
 #include <mlpack/core/dists/discrete_distribution.hpp>
 #include <mlpack/core/dists/gaussian_distribution.hpp>
 #include <mlpack/core/dists/laplace_distribution.hpp>
 
 // Include kernel traits.
 #include <mlpack/core/kernels/kernel_traits.hpp>
+#include <mlpack/core/kernels/kernel_cache.hpp>
 #include <mlpack/core/kernels/linear_kernel.hpp>
 #include <mlpack/core/kernels/polynomial_kernel.hpp>
 #include <mlpack/core/kernels/cosine_distance.hpp>
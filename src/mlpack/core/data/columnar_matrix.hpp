@@ -0,0 +1,125 @@
+/**
+ * @file columnar_matrix.hpp
+ *
+ * Declaration of the ColumnarMatrix class, which gives a matrix whose elements
+ * come from in-memory columnar buffers (such as the buffers of an Apache Arrow
+ * record batch), without exporting them to a file and parsing them again.
+ */
+#ifndef __MLPACK_CORE_DATA_COLUMNAR_MATRIX_HPP
+#define __MLPACK_CORE_DATA_COLUMNAR_MATRIX_HPP
+
+#include <mlpack/core/util/log.hpp>
+#include <mlpack/core/arma_extend/arma_extend.hpp> // Includes Armadillo.
+#include <vector>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * A read-only matrix, with one point per column, whose elements come from
+ * buffers in memory, in either of the layouts of columnar data:
+ *
+ *  - point-major: the values of each point are contiguous, and the points
+ *    follow each other (the values buffer of an Arrow fixed-size list column,
+ *    or a row-major points x dimensions array).  This is already the
+ *    column-major layout of the matrix, so if the values are of type eT they
+ *    are used in place, without copying.
+ *  - feature-major: each dimension is a separate contiguous buffer with one
+ *    value per point (the columns of an Arrow record batch of numeric
+ *    columns).  The buffers are gathered into the matrix by a single blocked
+ *    transpose, in parallel if OpenMP is available.
+ *
+ * Values of another type (such as float32 buffers for a matrix of doubles) are
+ * converted while they are copied.  The buffers must not have null values
+ * (the validity bitmaps of Arrow arrays are not examined).
+ *
+ * The buffers must stay valid and must not be modified while the
+ * ColumnarMatrix is in use, since the matrix may use them in place.
+ *
+ * @code
+ * // An Arrow FixedSizeList<double>[10] column of n points.
+ * extern const double* values;
+ * data::ColumnarMatrix<double> points(values, 10, n);
+ * kmeans.Cluster(points.Matrix(), 5, assignments);
+ * @endcode
+ *
+ * @tparam eT Type of the elements of the matrix.
+ */
+template<typename eT>
+class ColumnarMatrix
+{
+ public:
+  /**
+   * Use the given point-major buffer, which holds the values of each point one
+   * after another, as a matrix with the given number of rows (dimensionality)
+   * and columns (points).  If InputType is eT, the buffer is used in place;
+   * otherwise it is converted.
+   *
+   * @param values Buffer of dimensionality * points values.
+   * @param dimensionality Number of values of each point.
+   * @param points Number of points.
+   */
+  template<typename InputType>
+  ColumnarMatrix(const InputType* values,
+                 const size_t dimensionality,
+                 const size_t points);
+
+  /**
+   * Gather the given feature-major buffers, one for each dimension and each
+   * holding one value per point, into a matrix with one row for each buffer
+   * and one column for each point.
+   *
+   * @param features Buffers of the dimensions.
+   * @param points Number of points (the length of each buffer).
+   */
+  template<typename InputType>
+  ColumnarMatrix(const std::vector<const InputType*>& features,
+                 const size_t points);
+
+  //! Get the matrix.
+  const arma::Mat<eT>& Matrix() const { return matrix; }
+
+  //! Return whether the elements are used in place from the given buffer
+  //! (false if they were copied).
+  bool InPlace() const { return copy.empty(); }
+
+ private:
+  //! Copying is not allowed (the matrix may point into the buffer).
+  ColumnarMatrix(const ColumnarMatrix& other);
+  //! Copying is not allowed (the matrix may point into the buffer).
+  ColumnarMatrix& operator=(const ColumnarMatrix& other);
+
+  //! Return the given point-major buffer of elements of type eT, to be used in
+  //! place.
+  static eT* PointMajor(const eT* values,
+                        const size_t dimensionality,
+                        const size_t points,
+                        std::vector<eT>& copy);
+
+  //! Convert the given point-major buffer into copy, and return it.
+  template<typename InputType>
+  static eT* PointMajor(const InputType* values,
+                        const size_t dimensionality,
+                        const size_t points,
+                        std::vector<eT>& copy);
+
+  //! Gather the given feature-major buffers into copy (one point after
+  //! another), and return it.
+  template<typename InputType>
+  static eT* FeatureMajor(const std::vector<const InputType*>& features,
+                          const size_t points,
+                          std::vector<eT>& copy);
+
+  //! The elements, if they are not used in place.
+  std::vector<eT> copy;
+  //! The matrix, which uses the given buffer or copy.
+  arma::Mat<eT> matrix;
+};
+
+}; // namespace data
+}; // namespace mlpack
+
+// Include implementation.
+#include "columnar_matrix_impl.hpp"
+
+#endif
@@ -0,0 +1,119 @@
+/**
+ * @file columnar_matrix_impl.hpp
+ *
+ * Implementation of the ColumnarMatrix class.
+ */
+#ifndef __MLPACK_CORE_DATA_COLUMNAR_MATRIX_IMPL_HPP
+#define __MLPACK_CORE_DATA_COLUMNAR_MATRIX_IMPL_HPP
+
+// In case it hasn't already been included.
+#include "columnar_matrix.hpp"
+
+#include <mlpack/core/util/parallel.hpp>
+
+#include <algorithm>
+
+namespace mlpack {
+namespace data {
+
+template<typename eT>
+template<typename InputType>
+ColumnarMatrix<eT>::ColumnarMatrix(const InputType* values,
+                                   const size_t dimensionality,
+                                   const size_t points) :
+    matrix(PointMajor(values, dimensionality, points, copy), dimensionality,
+        points, false, true)
+{
+  // Nothing to do.
+}
+
+template<typename eT>
+template<typename InputType>
+ColumnarMatrix<eT>::ColumnarMatrix(
+    const std::vector<const InputType*>& features,
+    const size_t points) :
+    matrix(FeatureMajor(features, points, copy), features.size(), points,
+        false, true)
+{
+  // Nothing to do.
+}
+
+template<typename eT>
+eT* ColumnarMatrix<eT>::PointMajor(const eT* values,
+                                   const size_t /* dimensionality */,
+                                   const size_t /* points */,
+                                   std::vector<eT>& /* copy */)
+{
+  // The matrix does not modify its elements.
+  return const_cast<eT*>(values);
+}
+
+template<typename eT>
+template<typename InputType>
+eT* ColumnarMatrix<eT>::PointMajor(const InputType* values,
+                                   const size_t dimensionality,
+                                   const size_t points,
+                                   std::vector<eT>& copy)
+{
+  const size_t elements = dimensionality * points;
+  if (elements == 0)
+    return NULL;
+
+  copy.resize(elements);
+
+  #ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+  #endif
+
+  #pragma omp parallel for schedule(static) num_threads(threads) \
+      if(threads > 1 && elements > 65536)
+  for (size_t i = 0; i < elements; ++i)
+    copy[i] = eT(values[i]);
+
+  return &copy[0];
+}
+
+template<typename eT>
+template<typename InputType>
+eT* ColumnarMatrix<eT>::FeatureMajor(
+    const std::vector<const InputType*>& features,
+    const size_t points,
+    std::vector<eT>& copy)
+{
+  const size_t dimensionality = features.size();
+  if (dimensionality * points == 0)
+    return NULL;
+
+  copy.resize(dimensionality * points);
+
+  // The points are transposed a block at a time, so that the values read from
+  // each buffer and the points written stay in cache.
+  const size_t blockSize = 256;
+  const size_t blocks = (points + blockSize - 1) / blockSize;
+
+  #ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+  #endif
+
+  #pragma omp parallel for schedule(static) num_threads(threads) \
+      if(threads > 1 && blocks > 1)
+  for (size_t b = 0; b < blocks; ++b)
+  {
+    const size_t begin = b * blockSize;
+    const size_t end = std::min(begin + blockSize, points);
+    for (size_t d = 0; d < dimensionality; ++d)
+    {
+      const InputType* feature = features[d];
+      eT* out = &copy[begin * dimensionality + d];
+      for (size_t i = begin; i < end; ++i, out += dimensionality)
+        *out = eT(feature[i]);
+    }
+  }
+
+  return &copy[0];
+}
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
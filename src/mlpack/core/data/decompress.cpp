@@ -0,0 +1,335 @@
+/**
+ * @file decompress.cpp
+ *
+ * Implementation of DetectCompression(), UncompressedFilename() and
+ * Decompress().
+ */
+#include "decompress.hpp"
+
+#include <mlpack/core/util/log.hpp>
+#include <mlpack/core/util/parallel.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#ifdef MLPACK_HAS_ZLIB
+  #include <zlib.h>
+#endif
+
+#ifdef MLPACK_HAS_ZSTD
+  #include <zstd.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::data;
+
+//! The first bytes of a gzip file.
+static const unsigned char GzipMagic[2] = { 0x1f, 0x8b };
+//! The first bytes of a zstd frame.
+static const unsigned char ZstdMagic[4] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+//! Return the lowercase extension of the given filename (after the last '.').
+static std::string Extension(const std::string& filename)
+{
+  const size_t ext = filename.rfind('.');
+  if (ext == std::string::npos)
+    return "";
+
+  std::string extension = filename.substr(ext + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+      ::tolower);
+  return extension;
+}
+
+#if defined(MLPACK_HAS_ZLIB) || defined(MLPACK_HAS_ZSTD)
+//! Make room for at least one more byte after the first size bytes of the
+//! buffer, doubling it if it is full.
+static void Grow(std::vector<double>& buffer, const size_t size)
+{
+  if (size >= buffer.size() * sizeof(double))
+    buffer.resize(2 * buffer.size() + 1);
+}
+#endif
+
+Compression mlpack::data::DetectCompression(const std::string& filename,
+                                            std::istream& stream)
+{
+  unsigned char magic[4] = { 0, 0, 0, 0 };
+  std::streampos pos = stream.tellg();
+  stream.read((char*) magic, 4);
+  stream.clear();
+  stream.seekg(pos); // Reset stream position after peeking.
+
+  if (memcmp(magic, GzipMagic, 2) == 0)
+    return GzipCompression;
+  if (memcmp(magic, ZstdMagic, 4) == 0)
+    return ZstdCompression;
+
+  // Files which are not what their extension says are left to Decompress() to
+  // report.
+  const std::string extension = Extension(filename);
+  if (extension == "gz" || extension == "gzip")
+    return GzipCompression;
+  if (extension == "zst" || extension == "zstd")
+    return ZstdCompression;
+
+  return NoCompression;
+}
+
+std::string mlpack::data::UncompressedFilename(const std::string& filename)
+{
+  const std::string extension = Extension(filename);
+  if (extension == "gz" || extension == "gzip" || extension == "zst" ||
+      extension == "zstd")
+    return filename.substr(0, filename.rfind('.'));
+
+  return filename;
+}
+
+#ifdef MLPACK_HAS_ZLIB
+//! The most bytes handed to zlib at once (it counts them with 32-bit
+//! integers).
+static const size_t MaxStep = size_t(1) << 30;
+
+//! Decompress the gzip file into the buffer; size is set to the number of
+//! bytes of the decompressed data.
+static bool DecompressGzip(const util::MappedFile& file,
+                           std::vector<double>& buffer,
+                           size_t& size)
+{
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  // 15 + 32: the largest window, and detect the gzip (or zlib) header.
+  if (inflateInit2(&zs, 15 + 32) != Z_OK)
+  {
+    Log::Warn << "Cannot decompress '" << file.Filename() << "': "
+        << "zlib could not be initialized." << std::endl;
+    return false;
+  }
+
+  // The last four bytes of a gzip file hold the size of the last member's
+  // data (modulo 2^32), which is usually the size of all of it.
+  size_t guess = 4 * file.Size();
+  if (file.Size() >= 18)
+  {
+    const unsigned char* end = (const unsigned char*) file.Data() +
+        file.Size();
+    const size_t stored = size_t(end[-4]) | (size_t(end[-3]) << 8) |
+        (size_t(end[-2]) << 16) | (size_t(end[-1]) << 24);
+    guess = std::max(guess, stored + 1);
+  }
+  buffer.resize(guess / sizeof(double) + 1);
+
+  const char* input = file.Data();
+  size_t inputLeft = file.Size();
+  size = 0;
+  bool success = true;
+  while (true)
+  {
+    if (zs.avail_in == 0 && inputLeft > 0)
+    {
+      const size_t step = std::min(inputLeft, MaxStep);
+      zs.next_in = (Bytef*) input;
+      zs.avail_in = uInt(step);
+      input += step;
+      inputLeft -= step;
+    }
+
+    Grow(buffer, size);
+    const size_t space = std::min(buffer.size() * sizeof(double) - size,
+        MaxStep);
+    zs.next_out = (Bytef*) ((char*) &buffer[0] + size);
+    zs.avail_out = uInt(space);
+
+    const int status = inflate(&zs, Z_NO_FLUSH);
+    size += space - zs.avail_out;
+
+    if (status == Z_STREAM_END)
+    {
+      // Concatenated gzip members (as written by bgzip, for instance) are
+      // decompressed one after another.
+      if (zs.avail_in == 0 && inputLeft == 0)
+        break;
+      inflateReset(&zs);
+    }
+    else if (status == Z_BUF_ERROR && zs.avail_in == 0 && inputLeft == 0)
+    {
+      Log::Warn << "Cannot decompress '" << file.Filename() << "': "
+          << "the file is truncated." << std::endl;
+      success = false;
+      break;
+    }
+    else if (status != Z_OK && status != Z_BUF_ERROR)
+    {
+      Log::Warn << "Cannot decompress '" << file.Filename() << "': "
+          << ((zs.msg != NULL) ? zs.msg : "invalid gzip data") << "."
+          << std::endl;
+      success = false;
+      break;
+    }
+  }
+
+  inflateEnd(&zs);
+  return success;
+}
+#endif
+
+#ifdef MLPACK_HAS_ZSTD
+//! Decompress the zstd file into the buffer; size is set to the number of
+//! bytes of the decompressed data.
+static bool DecompressZstd(const util::MappedFile& file,
+                           std::vector<double>& buffer,
+                           size_t& size)
+{
+  // Find the frames and, if they record them, their decompressed sizes.
+  std::vector<size_t> frameBegin, frameSize, contentBegin, contentSize;
+  bool sizesKnown = true;
+  size_t offset = 0;
+  size = 0;
+  while (offset < file.Size())
+  {
+    const char* frame = file.Data() + offset;
+    const size_t compressed = ZSTD_findFrameCompressedSize(frame,
+        file.Size() - offset);
+    if (ZSTD_isError(compressed))
+    {
+      Log::Warn << "Cannot decompress '" << file.Filename() << "': "
+          << ZSTD_getErrorName(compressed) << "." << std::endl;
+      return false;
+    }
+
+    const unsigned long long content = ZSTD_getFrameContentSize(frame,
+        compressed);
+    if (content == ZSTD_CONTENTSIZE_ERROR)
+    {
+      Log::Warn << "Cannot decompress '" << file.Filename() << "': "
+          << "invalid zstd frame." << std::endl;
+      return false;
+    }
+    if (content == ZSTD_CONTENTSIZE_UNKNOWN)
+      sizesKnown = false;
+
+    frameBegin.push_back(offset);
+    frameSize.push_back(compressed);
+    contentBegin.push_back(size);
+    contentSize.push_back(sizesKnown ? size_t(content) : 0);
+    size += contentSize.back();
+    offset += compressed;
+  }
+
+  if (sizesKnown)
+  {
+    // Every frame has its place in the buffer, so the frames are decompressed
+    // independently.
+    buffer.resize(size / sizeof(double) + 1);
+    char* output = (char*) &buffer[0];
+    bool failed = false;
+
+    #ifdef _OPENMP
+    const size_t threads = util::NumThreads();
+    #endif
+
+    #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+        if(threads > 1) reduction(||:failed)
+    for (size_t i = 0; i < frameBegin.size(); ++i)
+    {
+      const size_t result = ZSTD_decompress(output + contentBegin[i],
+          contentSize[i], file.Data() + frameBegin[i], frameSize[i]);
+      if (ZSTD_isError(result) || result != contentSize[i])
+        failed = true;
+    }
+
+    if (failed)
+    {
+      Log::Warn << "Cannot decompress '" << file.Filename() << "': "
+          << "invalid zstd data." << std::endl;
+      return false;
+    }
+
+    return true;
+  }
+
+  // Otherwise, the whole file is decompressed as a stream.
+  ZSTD_DStream* stream = ZSTD_createDStream();
+  if (stream == NULL || ZSTD_isError(ZSTD_initDStream(stream)))
+  {
+    Log::Warn << "Cannot decompress '" << file.Filename() << "': "
+        << "zstd could not be initialized." << std::endl;
+    if (stream != NULL)
+      ZSTD_freeDStream(stream);
+    return false;
+  }
+
+  buffer.resize(4 * file.Size() / sizeof(double) + 1);
+  ZSTD_inBuffer input = { file.Data(), file.Size(), 0 };
+  size = 0;
+  size_t status = 0;
+  while (true)
+  {
+    Grow(buffer, size);
+    ZSTD_outBuffer output = { &buffer[0], buffer.size() * sizeof(double),
+        size };
+    status = ZSTD_decompressStream(stream, &output, &input);
+    size = output.pos;
+
+    if (ZSTD_isError(status))
+    {
+      Log::Warn << "Cannot decompress '" << file.Filename() << "': "
+          << ZSTD_getErrorName(status) << "." << std::endl;
+      ZSTD_freeDStream(stream);
+      return false;
+    }
+
+    // If the output was not filled, everything that can be decompressed has
+    // been.
+    if (input.pos == input.size && output.pos < output.size)
+      break;
+  }
+  ZSTD_freeDStream(stream);
+
+  // A nonzero status means the last frame is incomplete.
+  if (status != 0)
+  {
+    Log::Warn << "Cannot decompress '" << file.Filename() << "': "
+        << "the file is truncated." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+#endif
+
+bool mlpack::data::Decompress(const std::string& filename,
+                              const Compression compression,
+                              util::MappedFile& contents)
+{
+  util::MappedFile file(filename);
+  std::vector<double> buffer;
+  size_t size = 0;
+  bool success = false;
+
+  if (compression == GzipCompression)
+  {
+#ifdef MLPACK_HAS_ZLIB
+    success = DecompressGzip(file, buffer, size);
+#else
+    Log::Warn << "Cannot decompress '" << filename << "': mlpack was compiled "
+        << "without zlib support." << std::endl;
+#endif
+  }
+  else if (compression == ZstdCompression)
+  {
+#ifdef MLPACK_HAS_ZSTD
+    success = DecompressZstd(file, buffer, size);
+#else
+    Log::Warn << "Cannot decompress '" << filename << "': mlpack was compiled "
+        << "without zstd support." << std::endl;
+#endif
+  }
+
+  if (success)
+    contents.Assign(filename, buffer, size);
+
+  return success;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file decompress.hpp
+ *
+ * Detection and in-memory decompression of gzip- and zstd-compressed data
+ * files, as data::Load() does.
+ */
+#ifndef __MLPACK_CORE_DATA_DECOMPRESS_HPP
+#define __MLPACK_CORE_DATA_DECOMPRESS_HPP
+
+#include <mlpack/core/util/mapped_file.hpp>
+#include <istream>
+#include <string>
+
+namespace mlpack {
+namespace data {
+
+//! The compression formats data::Load() can read through.
+enum Compression
+{
+  NoCompression,
+  GzipCompression,
+  ZstdCompression
+};
+
+/**
+ * Detect the compression of the given file from its first bytes (the gzip or
+ * zstd magic number), or, if they are neither, from its extension (.gz or
+ * .zst).
+ *
+ * @param filename Name of the file.
+ * @param stream Open stream for the file, which is left at the same position.
+ * @return The compression of the file, or NoCompression.
+ */
+Compression DetectCompression(const std::string& filename,
+                              std::istream& stream);
+
+/**
+ * Return the name of the given compressed file without its compression
+ * extension (.gz or .zst), so that the type of its contents can be detected
+ * from the extension that remains: "data.csv.gz" gives "data.csv".  Names
+ * without a compression extension are returned unchanged.
+ *
+ * @param filename Name of the file.
+ */
+std::string UncompressedFilename(const std::string& filename);
+
+/**
+ * Decompress the given file into memory; contents is then the decompressed
+ * data (and its Filename() is still the name of the compressed file).  The
+ * compressed file is memory-mapped, so it is read while it is decompressed,
+ * without any temporary file.  Files of several zstd frames which record their
+ * decompressed sizes (such as those written by pzstd) are decompressed in
+ * parallel, one frame per thread, if OpenMP is available; other zstd files and
+ * gzip files (including concatenated gzip members) are decompressed serially.
+ *
+ * If mlpack was compiled without zlib (for gzip) or zstd, or the file is not
+ * valid, a warning is given and false is returned.
+ *
+ * @param filename Name of the compressed file.
+ * @param compression Compression of the file (see DetectCompression()).
+ * @param contents MappedFile to hold the decompressed data.
+ * @return Whether the file was decompressed.
+ */
+bool Decompress(const std::string& filename,
+                const Compression compression,
+                util::MappedFile& contents);
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
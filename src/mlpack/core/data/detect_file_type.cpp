@@ -0,0 +1,101 @@
+/**
+ * @file detect_file_type.cpp
+ *
+ * Implementation of DetectFileType().
+ */
+#include "detect_file_type.hpp"
+
+#include <algorithm>
+
+using namespace mlpack;
+using namespace mlpack::data;
+
+//! Read the first bytes of the stream and return whether they are the given
+//! header; the position of the stream is restored.
+static bool PeekHeader(std::istream& stream, const std::string& header)
+{
+  std::string rawHeader(header.length(), '\0');
+  std::streampos pos = stream.tellg();
+
+  stream.read(&rawHeader[0], std::streamsize(header.length()));
+  stream.clear();
+  stream.seekg(pos); // Reset stream position after peeking.
+
+  return (rawHeader == header);
+}
+
+arma::file_type mlpack::data::DetectFileType(const std::string& filename,
+                                             std::istream& stream,
+                                             std::string& stringType)
+{
+  stringType = "";
+
+  // We discriminate by file extension.
+  const size_t ext = filename.rfind('.');
+  if (ext == std::string::npos)
+    return arma::file_type_unknown;
+
+  // Get the extension and force it to lowercase.
+  std::string extension = filename.substr(ext + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+      ::tolower);
+
+  if (extension == "csv")
+  {
+    stringType = "CSV data";
+    return arma::csv_ascii;
+  }
+  else if (extension == "txt")
+  {
+    // This could be raw ASCII or Armadillo ASCII (ASCII with size header).
+    // We'll let Armadillo do its guessing (although we have to check if it is
+    // arma_ascii ourselves) and see what we come up with.
+
+    // This is taken from load_auto_detect() in diskio_meat.hpp
+    if (PeekHeader(stream, "ARMA_MAT_TXT"))
+    {
+      stringType = "Armadillo ASCII formatted data";
+      return arma::arma_ascii;
+    }
+
+    // It's not arma_ascii.  Now we let Armadillo guess.
+    const arma::file_type loadType = arma::diskio::guess_file_type(stream);
+
+    if (loadType == arma::raw_ascii) // Raw ASCII (space-separated).
+      stringType = "raw ASCII formatted data";
+    else if (loadType == arma::csv_ascii) // CSV can be .txt too.
+      stringType = "CSV data";
+    else // Unknown .txt...
+      return arma::file_type_unknown;
+
+    return loadType;
+  }
+  else if (extension == "bin")
+  {
+    // This could be raw binary or Armadillo binary (binary with header).  We
+    // will check to see if it is Armadillo binary.
+    if (PeekHeader(stream, "ARMA_MAT_BIN"))
+    {
+      stringType = "Armadillo binary formatted data";
+      return arma::arma_binary;
+    }
+
+    // We can only assume it's raw binary.
+    stringType = "raw binary formatted data";
+    return arma::raw_binary;
+  }
+  else if (extension == "pgm")
+  {
+    stringType = "PGM data";
+    return arma::pgm_binary;
+  }
+  else if (extension == "h5" || extension == "hdf5" || extension == "hdf" ||
+           extension == "he5")
+  {
+    stringType = "HDF5 data";
+    return arma::hdf5_binary;
+  }
+
+  // Unknown extension...
+  return arma::file_type_unknown;
+}
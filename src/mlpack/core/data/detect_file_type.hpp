@@ -0,0 +1,37 @@
+/**
+ * @file detect_file_type.hpp
+ *
+ * Guess the type of a data file from its extension, as data::Load() does.
+ */
+#ifndef __MLPACK_CORE_DATA_DETECT_FILE_TYPE_HPP
+#define __MLPACK_CORE_DATA_DETECT_FILE_TYPE_HPP
+
+#include <mlpack/core/arma_extend/arma_extend.hpp> // Includes Armadillo.
+#include <istream>
+#include <string>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Guess the type of the given file from its extension; for .txt and .bin
+ * files, the beginning of the file is also examined to tell Armadillo's
+ * formats (with a header) apart from raw ASCII, CSV and raw binary.  HDF5
+ * files (.hdf, .hdf5, .h5 or .he5) are reported as arma::hdf5_binary whether
+ * or not Armadillo was compiled with HDF5 support.
+ *
+ * @param filename Name of the file.
+ * @param stream Open stream for the file (or for its contents, if it was
+ *     decompressed), which is left at the same position.
+ * @param stringType Set to a description of the type, for messages.
+ * @return The type of the file, or arma::file_type_unknown if the extension is
+ *     missing or unknown or the type of a .txt file cannot be guessed.
+ */
+arma::file_type DetectFileType(const std::string& filename,
+                               std::istream& stream,
+                               std::string& stringType);
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
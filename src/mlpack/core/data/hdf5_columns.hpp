@@ -0,0 +1,68 @@
+/**
+ * @file hdf5_columns.hpp
+ *
+ * Functions which read selected columns of the matrix stored in an HDF5 file
+ * through hyperslab selections, without reading the rest of the file.
+ */
+#ifndef __MLPACK_CORE_DATA_HDF5_COLUMNS_HPP
+#define __MLPACK_CORE_DATA_HDF5_COLUMNS_HPP
+
+#include <mlpack/core/arma_extend/arma_extend.hpp> // Includes Armadillo.
+#include <string>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Get the size of the matrix Armadillo would load from the given HDF5 file:
+ * the dataset named "dataset" (which Armadillo writes), or otherwise the first
+ * dataset in the root group.  This does not read any elements.
+ *
+ * Like the other functions here, this does not issue any messages (so it can be
+ * used from any thread); if the file cannot be read, or Armadillo was compiled
+ * without HDF5 support, error is set and false is returned.
+ *
+ * @param filename Name of the HDF5 file.
+ * @param rows Set to the number of rows of the stored matrix.
+ * @param cols Set to the number of columns of the stored matrix.
+ * @param error Set to a description of the error, if there is one.
+ * @return Whether the size could be read.
+ */
+inline bool HDF5MatrixSize(const std::string& filename,
+                           size_t& rows,
+                           size_t& cols,
+                           std::string& error);
+
+/**
+ * Load the given columns of the matrix data::Load() would load from the given
+ * HDF5 file (with the same transpose parameter), in the given order; indices
+ * may be repeated.  Only the selected columns are read: each run of
+ * consecutive indices is one hyperslab of the dataset, and HDF5 converts the
+ * elements to eT as they are read.
+ *
+ * If transpose is false, the columns of the stored matrix are its rows in the
+ * HDF5 file, so each selected column is contiguous on disk; otherwise (the
+ * default of data::Load()), they are strided.
+ *
+ * @param filename Name of the HDF5 file.
+ * @param matrix Matrix to load the columns into.
+ * @param columns Indices of the columns to load.
+ * @param transpose If true, the stored matrix is transposed (as in
+ *     data::Load()).
+ * @param error Set to a description of the error, if there is one.
+ * @return Whether the columns could be loaded.
+ */
+template<typename eT>
+bool LoadHDF5Columns(const std::string& filename,
+                     arma::Mat<eT>& matrix,
+                     const arma::Col<size_t>& columns,
+                     const bool transpose,
+                     std::string& error);
+
+}; // namespace data
+}; // namespace mlpack
+
+// Include implementation.
+#include "hdf5_columns_impl.hpp"
+
+#endif
@@ -0,0 +1,271 @@
+/**
+ * @file hdf5_columns_impl.hpp
+ *
+ * Implementation of HDF5MatrixSize() and LoadHDF5Columns().
+ */
+#ifndef __MLPACK_CORE_DATA_HDF5_COLUMNS_IMPL_HPP
+#define __MLPACK_CORE_DATA_HDF5_COLUMNS_IMPL_HPP
+
+// In case it hasn't already been included.
+#include "hdf5_columns.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+namespace mlpack {
+namespace data {
+namespace hdf5 {
+
+#ifdef ARMA_USE_HDF5
+
+/**
+ * The HDF5 objects used to read a dataset, which are closed when it is
+ * destroyed.
+ */
+struct Dataset
+{
+  Dataset() : file(-1), dataset(-1), space(-1), rank(0) { }
+
+  ~Dataset()
+  {
+    if (space >= 0)
+      H5Sclose(space);
+    if (dataset >= 0)
+      H5Oclose(dataset);
+    if (file >= 0)
+      H5Fclose(file);
+  }
+
+  //! The open file.
+  hid_t file;
+  //! The open dataset.
+  hid_t dataset;
+  //! The dataspace of the dataset.
+  hid_t space;
+  //! The rank of the dataset (1 or 2).
+  int rank;
+  //! The extent of each dimension of the dataset.
+  hsize_t dims[2];
+};
+
+/**
+ * Open the dataset Armadillo would load from the given file (the one named
+ * "dataset", or otherwise the first dataset in the root group), and get its
+ * dataspace and dimensions.
+ */
+inline bool OpenDataset(const std::string& filename,
+                        Dataset& d,
+                        std::string& error)
+{
+  d.file = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  if (d.file < 0)
+  {
+    error = "cannot open the file as HDF5";
+    return false;
+  }
+
+  if (H5Lexists(d.file, "dataset", H5P_DEFAULT) > 0)
+  {
+    d.dataset = H5Oopen(d.file, "dataset", H5P_DEFAULT);
+  }
+  else
+  {
+    H5G_info_t info;
+    if (H5Gget_info(d.file, &info) >= 0)
+    {
+      for (hsize_t i = 0; i < info.nlinks && d.dataset < 0; ++i)
+      {
+        const hid_t object = H5Oopen_by_idx(d.file, ".", H5_INDEX_NAME,
+            H5_ITER_INC, i, H5P_DEFAULT);
+        if (object >= 0 && H5Iget_type(object) == H5I_DATASET)
+          d.dataset = object;
+        else if (object >= 0)
+          H5Oclose(object);
+      }
+    }
+  }
+
+  if (d.dataset < 0)
+  {
+    error = "the file holds no dataset";
+    return false;
+  }
+
+  d.space = H5Dget_space(d.dataset);
+  d.rank = (d.space < 0) ? -1 : H5Sget_simple_extent_ndims(d.space);
+  if (d.rank != 1 && d.rank != 2)
+  {
+    error = "the dataset is not one- or two-dimensional";
+    return false;
+  }
+
+  H5Sget_simple_extent_dims(d.space, d.dims, NULL);
+  return true;
+}
+
+/**
+ * Get the size of the matrix stored in the dataset: the first dimension of
+ * the dataset is the slowest-varying, so a two-dimensional dataset holds one
+ * column of the matrix in each of its rows.
+ */
+inline void StoredSize(const Dataset& d, size_t& rows, size_t& cols)
+{
+  rows = (d.rank == 1) ? d.dims[0] : d.dims[1];
+  cols = (d.rank == 1) ? 1 : d.dims[0];
+}
+
+#endif
+
+}; // namespace hdf5
+
+inline bool HDF5MatrixSize(const std::string& filename,
+                           size_t& rows,
+                           size_t& cols,
+                           std::string& error)
+{
+#ifdef ARMA_USE_HDF5
+  hdf5::Dataset d;
+  if (!hdf5::OpenDataset(filename, d, error))
+    return false;
+
+  hdf5::StoredSize(d, rows, cols);
+  return true;
+#else
+  rows = 0;
+  cols = 0;
+  (void) filename;
+  error = "Armadillo was compiled without HDF5 support";
+  return false;
+#endif
+}
+
+template<typename eT>
+bool LoadHDF5Columns(const std::string& filename,
+                     arma::Mat<eT>& matrix,
+                     const arma::Col<size_t>& columns,
+                     const bool transpose,
+                     std::string& error)
+{
+#ifdef ARMA_USE_HDF5
+  hdf5::Dataset d;
+  if (!hdf5::OpenDataset(filename, d, error))
+    return false;
+
+  size_t storedRows, storedCols;
+  hdf5::StoredSize(d, storedRows, storedCols);
+  const size_t rows = transpose ? storedCols : storedRows;
+  const size_t cols = transpose ? storedRows : storedCols;
+
+  for (size_t i = 0; i < columns.n_elem; ++i)
+  {
+    if (columns[i] >= cols)
+    {
+      std::ostringstream oss;
+      oss << "column index " << columns[i] << " is out of range (the matrix "
+          << "has " << cols << " columns)";
+      error = oss.str();
+      return false;
+    }
+  }
+
+  // The distinct columns are read in increasing order, which is the order in
+  // which HDF5 returns the selected elements.
+  std::vector<size_t> distinct(columns.begin(), columns.end());
+  std::sort(distinct.begin(), distinct.end());
+  distinct.erase(std::unique(distinct.begin(), distinct.end()),
+      distinct.end());
+
+  // The columns of the loaded matrix lie along the first dimension of a
+  // two-dimensional dataset if it is not transposed, and along the second if
+  // it is.  (A one-dimensional dataset is read completely; it is a single
+  // column of the stored matrix.)
+  arma::Mat<eT> block;
+  if (d.rank == 1)
+  {
+    block.set_size(storedRows, storedCols);
+  }
+  else
+  {
+    const int dim = transpose ? 1 : 0;
+    H5Sselect_none(d.space);
+    for (size_t begin = 0; begin < distinct.size(); )
+    {
+      size_t end = begin + 1;
+      while (end < distinct.size() && distinct[end] == distinct[end - 1] + 1)
+        ++end;
+
+      hsize_t start[2] = { 0, 0 };
+      hsize_t count[2] = { d.dims[0], d.dims[1] };
+      start[dim] = distinct[begin];
+      count[dim] = end - begin;
+      H5Sselect_hyperslab(d.space, H5S_SELECT_OR, start, NULL, count, NULL);
+      begin = end;
+    }
+
+    // The elements arrive in row-major order, so the block is the selected
+    // columns of the stored matrix, or the selected rows if it is transposed.
+    if (transpose)
+      block.set_size(distinct.size(), storedCols);
+    else
+      block.set_size(storedRows, distinct.size());
+  }
+
+  if (block.n_elem > 0)
+  {
+    const hsize_t elements = block.n_elem;
+    const hid_t memSpace = H5Screate_simple(1, &elements, NULL);
+    const hid_t memType = arma::hdf5_misc::get_hdf5_type<eT>();
+    const herr_t status = H5Dread(d.dataset, memType, memSpace,
+        (d.rank == 1) ? H5S_ALL : d.space, H5P_DEFAULT, block.memptr());
+    H5Tclose(memType);
+    H5Sclose(memSpace);
+
+    if (status < 0)
+    {
+      error = "cannot read the dataset";
+      return false;
+    }
+  }
+
+  // For a one-dimensional dataset, every column of the loaded matrix was
+  // read.
+  if (d.rank == 1)
+  {
+    distinct.resize(cols);
+    for (size_t i = 0; i < cols; ++i)
+      distinct[i] = i;
+  }
+  if (transpose)
+    block = trans(block);
+
+  if (distinct.size() == columns.n_elem &&
+      std::equal(distinct.begin(), distinct.end(), columns.begin()))
+  {
+    matrix = block;
+    return true;
+  }
+
+  matrix.set_size(rows, columns.n_elem);
+  for (size_t i = 0; i < columns.n_elem; ++i)
+  {
+    const size_t position = std::lower_bound(distinct.begin(), distinct.end(),
+        columns[i]) - distinct.begin();
+    matrix.col(i) = block.col(position);
+  }
+
+  return true;
+#else
+  (void) filename;
+  (void) matrix;
+  (void) columns;
+  (void) transpose;
+  error = "Armadillo was compiled without HDF5 support";
+  return false;
+#endif
+}
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
@@ -32,6 +32,18 @@ namespace data /** Functions to load and save matrices. */ {
  *  - Armadillo binary (arma_binary), denoted by .bin
  *  - HDF5, denoted by .hdf, .hdf5, .h5, or .he5
  *
+ * Files in the mlpack mapped matrix format (see SaveMapped()), which
+ * data::Save() writes for the .mapped extension, are recognized by their
+ * contents, whatever their extension.  They hold one point per column, so they
+ * are only transposed if transpose is false.
+ *
+ * Files compressed with gzip or zstd (recognized by their first bytes, or by a
+ * .gz or .zst extension) are decompressed into memory, without a temporary
+ * file, and their type is then found from the extension before the compression
+ * extension (so "data.csv.gz" is loaded as CSV data).  This needs mlpack to be
+ * compiled with zlib or zstd; see Decompress().  Compressed HDF5 files are not
+ * supported.
+ *
  * If the file extension is not one of those types, an error will be given.
  * This is preferable to Armadillo's default behavior of loading an unknown
  * filetype as raw_binary, which can have very confusing effects.
@@ -54,6 +66,86 @@ bool Load(const std::string& filename,
           bool fatal = false,
           bool transpose = true);
 
+/**
+ * Loads a sparse matrix from a coordinate list file: each non-blank line holds
+ * the row index, the column index and the value of one nonzero element
+ * (indices start at 0), separated by whitespace, or by commas if the file has
+ * a .csv extension.  This is the coord_ascii format of Armadillo.  Each
+ * location may appear only once.  The size of the matrix is given by the
+ * largest indices.  The file is parsed in parallel if OpenMP is available, and
+ * the sparse matrix is built directly, without a dense intermediate.
+ *
+ * Files in the mlpack sparse matrix format (written by data::Save() with a
+ * .bin or .mapped extension, or by SaveMapped()) are recognized by their
+ * contents, whatever their extension, and are memory-mapped and copied into
+ * the matrix without any parsing.  As for dense matrices, files compressed
+ * with gzip or zstd are decompressed into memory first.
+ *
+ * As for dense matrices, the matrix is transposed at load time if transpose is
+ * true, so each row of the file's matrix (that is, each distinct row index) is
+ * a point, and the program exits with an error on failure if fatal is true.
+ * (The mlpack sparse matrix format already holds one point per column, so it
+ * is only transposed if transpose is false.)
+ *
+ * @param filename Name of file to load.
+ * @param matrix Sparse matrix to load contents of file into.
+ * @param fatal If an error should be reported as fatal (default false).
+ * @param transpose If true, transpose the matrix after loading.
+ * @return Boolean value indicating success or failure of load.
+ */
+template<typename eT>
+bool Load(const std::string& filename,
+          arma::SpMat<eT>& matrix,
+          bool fatal = false,
+          bool transpose = true);
+
+/**
+ * Loads only the given columns (points) of the matrix that data::Load() would
+ * load from the given file, in the given order (indices may be repeated).
+ * HDF5 files are read through hyperslab selections, so only the selected
+ * columns are read from disk; this is useful when each of several workers
+ * needs only its own shard of a very large dataset.  Files of other types are
+ * loaded completely, and then the columns are selected.
+ *
+ * If transpose is true (the default), each column of the loaded matrix is a
+ * row of the stored matrix, and the selected columns are strided in an HDF5
+ * file; with transpose = false they are contiguous.  See also
+ * StreamingReader, which reads HDF5 files a block of columns at a time.
+ *
+ * @param filename Name of file to load.
+ * @param matrix Matrix to load the selected columns into.
+ * @param columns Indices of the columns to load.
+ * @param fatal If an error should be reported as fatal (default false).
+ * @param transpose If true, transpose the matrix after loading.
+ * @return Boolean value indicating success or failure of load.
+ */
+template<typename eT>
+bool Load(const std::string& filename,
+          arma::Mat<eT>& matrix,
+          const arma::Col<size_t>& columns,
+          bool fatal = false,
+          bool transpose = true);
+
+/**
+ * Loads the given range of columns (points) of the matrix that data::Load()
+ * would load from the given file, as the overload above does; for instance,
+ * Load("data.h5", shard, arma::span(1000, 1999)) loads the second thousand
+ * points.
+ *
+ * @param filename Name of file to load.
+ * @param matrix Matrix to load the selected columns into.
+ * @param columns Range of columns to load.
+ * @param fatal If an error should be reported as fatal (default false).
+ * @param transpose If true, transpose the matrix after loading.
+ * @return Boolean value indicating success or failure of load.
+ */
+template<typename eT>
+bool Load(const std::string& filename,
+          arma::Mat<eT>& matrix,
+          const arma::span& columns,
+          bool fatal = false,
+          bool transpose = true);
+
 }; // namespace data
 }; // namespace mlpack
 
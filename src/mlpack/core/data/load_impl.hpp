@@ -10,8 +10,19 @@
 // In case it hasn't already been included.
 #include "load.hpp"
 
-#include <algorithm>
 #include <mlpack/core/util/timers.hpp>
+#include <mlpack/core/util/huge_pages.hpp>
+#include <mlpack/core/util/mapped_file.hpp>
+#include "decompress.hpp"
+#include "detect_file_type.hpp"
+#include "hdf5_columns.hpp"
+#include "mapped_matrix.hpp"
+#include "parse_text.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 
 namespace mlpack {
 namespace data {
@@ -39,11 +50,6 @@ bool Load(const std::string& filename,
     return false;
   }
 
-  // Get the extension and force it to lowercase.
-  std::string extension = filename.substr(ext + 1);
-  std::transform(extension.begin(), extension.end(), extension.begin(),
-      ::tolower);
-
   // Catch nonexistent files by opening the stream ourselves.
   std::fstream stream;
   stream.open(filename.c_str(), std::fstream::in);
@@ -60,88 +66,110 @@ bool Load(const std::string& filename,
     return false;
   }
 
-  bool unknownType = false;
-  arma::file_type loadType;
-  std::string stringType;
-
-  if (extension == "csv")
+  // Compressed files (gzip or zstd) are decompressed into memory, and then
+  // loaded as the file without the compression extension would be.
+  const Compression compression = DetectCompression(filename, stream);
+  const bool compressed = (compression != NoCompression);
+  util::MappedFile contents;
+  if (compressed)
   {
-    loadType = arma::csv_ascii;
-    stringType = "CSV data";
-  }
-  else if (extension == "txt")
-  {
-    // This could be raw ASCII or Armadillo ASCII (ASCII with size header).
-    // We'll let Armadillo do its guessing (although we have to check if it is
-    // arma_ascii ourselves) and see what we come up with.
+    stream.close();
+    if (!Decompress(filename, compression, contents))
+    {
+      Timer::Stop("loading_data");
+      if (fatal)
+        Log::Fatal << "Loading from '" << filename << "' failed." << std::endl;
+      else
+        Log::Warn << "Loading from '" << filename << "' failed." << std::endl;
 
-    // This is taken from load_auto_detect() in diskio_meat.hpp
-    const std::string ARMA_MAT_TXT = "ARMA_MAT_TXT";
-    char* rawHeader = new char[ARMA_MAT_TXT.length() + 1];
-    std::streampos pos = stream.tellg();
+      return false;
+    }
+  }
 
-    stream.read(rawHeader, std::streamsize(ARMA_MAT_TXT.length()));
-    rawHeader[ARMA_MAT_TXT.length()] = '\0';
-    stream.clear();
-    stream.seekg(pos); // Reset stream position after peeking.
+  // Files in the mlpack mapped matrix format (written by data::Save() with a
+  // .mapped extension, or by SaveMapped()) are recognized by their contents.
+  // They hold one point per column, so they are only transposed if transpose
+  // is false.
+  char magic[8];
+  const bool mappedFormat = compressed ? (contents.Size() >= 8 &&
+      memcmp(contents.Data(), mapped_matrix::MappedMagic, 8) == 0) :
+      (stream.read(magic, 8) &&
+      memcmp(magic, mapped_matrix::MappedMagic, 8) == 0);
+  if (mappedFormat)
+  {
+    stream.close();
+    Log::Info << "Loading '" << filename << "' as mapped matrix format.  "
+        << std::flush;
 
-    if (std::string(rawHeader) == ARMA_MAT_TXT)
+    bool success;
+    if (compressed)
     {
-      loadType = arma::arma_ascii;
-      stringType = "Armadillo ASCII formatted data";
+      success = LoadMapped(contents, matrix);
     }
-    else // It's not arma_ascii.  Now we let Armadillo guess.
+    else
     {
-      loadType = arma::diskio::guess_file_type(stream);
-
-      if (loadType == arma::raw_ascii) // Raw ASCII (space-separated).
-        stringType = "raw ASCII formatted data";
-      else if (loadType == arma::csv_ascii) // CSV can be .txt too.
-        stringType = "CSV data";
-      else // Unknown .txt... we will throw an error.
-        unknownType = true;
+      util::MappedFile file(filename);
+      success = LoadMapped(file, matrix);
     }
+    if (success && !transpose)
+      matrix = trans(matrix);
 
-    delete[] rawHeader;
-  }
-  else if (extension == "bin")
-  {
-    // This could be raw binary or Armadillo binary (binary with header).  We
-    // will check to see if it is Armadillo binary.
-    const std::string ARMA_MAT_BIN = "ARMA_MAT_BIN";
-    char *rawHeader = new char[ARMA_MAT_BIN.length() + 1];
-
-    std::streampos pos = stream.tellg();
-
-    stream.read(rawHeader, std::streamsize(ARMA_MAT_BIN.length()));
-    rawHeader[ARMA_MAT_BIN.length()] = '\0';
-    stream.clear();
-    stream.seekg(pos); // Reset stream position after peeking.
-
-    if (std::string(rawHeader) == ARMA_MAT_BIN)
+    if (success)
+    {
+      Log::Info << "Size is " << (transpose ? matrix.n_cols : matrix.n_rows)
+          << " x " << (transpose ? matrix.n_rows : matrix.n_cols) << ".\n";
+    }
+    else
     {
-      stringType = "Armadillo binary formatted data";
-      loadType = arma::arma_binary;
+      Log::Info << std::endl;
     }
-    else // We can only assume it's raw binary.
+
+    Timer::Stop("loading_data");
+    if (!success)
     {
-      stringType = "raw binary formatted data";
-      loadType = arma::raw_binary;
+      if (fatal)
+        Log::Fatal << "Loading from '" << filename << "' failed." << std::endl;
+      else
+        Log::Warn << "Loading from '" << filename << "' failed." << std::endl;
     }
 
-    delete[] rawHeader;
+    return success;
   }
-  else if (extension == "pgm")
+  stream.clear();
+  stream.seekg(0);
+
+  // The type of a compressed file is detected from the extension before the
+  // compression extension and the beginning (the first megabyte) of its
+  // contents.
+  std::istringstream memory;
+  if (compressed)
   {
-    loadType = arma::pgm_binary;
-    stringType = "PGM data";
+    memory.str(std::string(contents.Data(),
+        std::min(contents.Size(), size_t(1) << 20)));
   }
-  else if (extension == "h5" || extension == "hdf5" || extension == "hdf" ||
-           extension == "he5")
+  std::istream& input = compressed ? (std::istream&) memory :
+      (std::istream&) stream;
+
+  std::string stringType;
+  const arma::file_type loadType = DetectFileType(compressed ?
+      UncompressedFilename(filename) : filename, input, stringType);
+
+  if (loadType == arma::hdf5_binary && compressed)
+  {
+    Timer::Stop("loading_data");
+    if (fatal)
+      Log::Fatal << "Attempted to load '" << filename << "' as compressed "
+          << "HDF5 data, which is not supported.  Load failed." << std::endl;
+    else
+      Log::Warn << "Attempted to load '" << filename << "' as compressed "
+          << "HDF5 data, which is not supported.  Load failed." << std::endl;
+
+    return false;
+  }
+
+  if (loadType == arma::hdf5_binary)
   {
 #ifdef ARMA_USE_HDF5
-    loadType = arma::hdf5_binary;
-    stringType = "HDF5 data";
   #if ARMA_VERSION_MAJOR == 4 && \
       (ARMA_VERSION_MINOR >= 300 && ARMA_VERSION_MINOR <= 400)
     Timer::Stop("loading_data");
@@ -172,15 +200,9 @@ bool Load(const std::string& filename,
     return false;
 #endif
   }
-  else // Unknown extension...
-  {
-    unknownType = true;
-    loadType = arma::raw_binary; // Won't be used; prevent a warning.
-    stringType = "";
-  }
 
   // Provide error if we don't know the type.
-  if (unknownType)
+  if (loadType == arma::file_type_unknown)
   {
     Timer::Stop("loading_data");
     if (fatal)
@@ -201,7 +223,34 @@ bool Load(const std::string& filename,
     Log::Info << "Loading '" << filename << "' as " << stringType << ".  "
         << std::flush;
 
-  const bool success = matrix.load(stream, loadType);
+  // Numeric CSV and raw ASCII files are parsed in parallel by ParseText(),
+  // which also writes the transposed matrix directly.  If it gives up (for
+  // instance, if the number of columns is not the same on every line), let
+  // Armadillo try.
+  bool parsed = false;
+  if (loadType == arma::csv_ascii || loadType == arma::raw_ascii)
+  {
+    if (compressed)
+    {
+      parsed = ParseText(contents, matrix, (loadType == arma::csv_ascii),
+          transpose);
+    }
+    else
+    {
+      util::MappedFile file(filename);
+      parsed = ParseText(file, matrix, (loadType == arma::csv_ascii),
+          transpose);
+    }
+  }
+
+  // Armadillo reads compressed files from a copy of all of their contents.
+  if (compressed && !parsed)
+  {
+    memory.clear();
+    memory.str(std::string(contents.Data(), contents.Size()));
+  }
+
+  const bool success = parsed || matrix.load(input, loadType);
 
   if (!success)
   {
@@ -215,19 +264,226 @@ bool Load(const std::string& filename,
     return false;
   }
   else
-    Log::Info << "Size is " << (transpose ? matrix.n_cols : matrix.n_rows)
-        << " x " << (transpose ? matrix.n_rows : matrix.n_cols) << ".\n";
+    Log::Info << "Size is " << (transpose && !parsed ? matrix.n_cols :
+        matrix.n_rows) << " x " << (transpose && !parsed ? matrix.n_rows :
+        matrix.n_cols) << ".\n";
 
-  // Now transpose the matrix, if necessary.
-  if (transpose)
+  // Now transpose the matrix, if necessary (ParseText() already did).
+  if (transpose && !parsed)
     matrix = trans(matrix);
 
+  // A matrix loaded by Armadillo has already been written, so if huge pages
+  // are enabled the kernel moves it into them later.
+  if (!parsed)
+    util::AdviseHugePages(matrix.memptr(), matrix.n_elem * sizeof(eT));
+  util::SampleHugePageMemory();
+
   Timer::Stop("loading_data");
 
   // Finally, return the success indicator.
   return success;
 }
 
+template<typename eT>
+bool Load(const std::string& filename,
+          arma::SpMat<eT>& matrix,
+          bool fatal,
+          bool transpose)
+{
+  Timer::Start("loading_data");
+
+  // Catch nonexistent files by opening the stream ourselves.
+  std::fstream stream;
+  stream.open(filename.c_str(), std::fstream::in);
+
+  if (!stream.is_open())
+  {
+    Timer::Stop("loading_data");
+    if (fatal)
+      Log::Fatal << "Cannot open file '" << filename << "'. " << std::endl;
+    else
+      Log::Warn << "Cannot open file '" << filename << "'; load failed."
+          << std::endl;
+
+    return false;
+  }
+
+  // Compressed files (gzip or zstd) are decompressed into memory, and then
+  // loaded as the file without the compression extension would be.
+  const Compression compression = DetectCompression(filename, stream);
+  const bool compressed = (compression != NoCompression);
+  stream.close();
+
+  util::MappedFile contents;
+  if (compressed && !Decompress(filename, compression, contents))
+  {
+    Timer::Stop("loading_data");
+    if (fatal)
+      Log::Fatal << "Loading from '" << filename << "' failed." << std::endl;
+    else
+      Log::Warn << "Loading from '" << filename << "' failed." << std::endl;
+
+    return false;
+  }
+
+  util::MappedFile* mapped = compressed ? NULL :
+      new util::MappedFile(filename);
+  const util::MappedFile& file = compressed ? contents : *mapped;
+
+  bool success;
+  if (IsMappedSparse(file))
+  {
+    // The file holds the matrix with one point per column, so it only has to
+    // be transposed if transpose is false.
+    Log::Info << "Loading '" << filename << "' as sparse matrix format.  "
+        << std::flush;
+    success = LoadMapped(file, matrix);
+    if (success && !transpose)
+      matrix = arma::trans(matrix);
+  }
+  else
+  {
+    // Values are separated by commas in .csv files.
+    const std::string name = UncompressedFilename(filename);
+    const size_t ext = name.rfind('.');
+    std::string extension = (ext == std::string::npos) ? "" :
+        name.substr(ext + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+        ::tolower);
+    const bool csv = (extension == "csv");
+
+    Log::Info << "Loading '" << filename << "' as coordinate list.  "
+        << std::flush;
+    success = ParseCoordinates(file, matrix, csv, transpose);
+  }
+  delete mapped;
+
+  if (success)
+  {
+    Log::Info << "Size is " << (transpose ? matrix.n_cols : matrix.n_rows)
+        << " x " << (transpose ? matrix.n_rows : matrix.n_cols) << ", with "
+        << matrix.n_nonzero << " nonzero elements.\n";
+  }
+  else
+  {
+    Log::Info << std::endl;
+  }
+
+  Timer::Stop("loading_data");
+
+  if (!success)
+  {
+    if (fatal)
+      Log::Fatal << "Loading from '" << filename << "' failed." << std::endl;
+    else
+      Log::Warn << "Loading from '" << filename << "' failed." << std::endl;
+  }
+
+  return success;
+}
+
+template<typename eT>
+bool Load(const std::string& filename,
+          arma::Mat<eT>& matrix,
+          const arma::Col<size_t>& columns,
+          bool fatal,
+          bool transpose)
+{
+  std::fstream stream;
+  stream.open(filename.c_str(), std::fstream::in);
+
+  if (!stream.is_open())
+  {
+    if (fatal)
+      Log::Fatal << "Cannot open file '" << filename << "'. " << std::endl;
+    else
+      Log::Warn << "Cannot open file '" << filename << "'; load failed."
+          << std::endl;
+
+    return false;
+  }
+
+  std::string stringType;
+  const arma::file_type loadType = DetectFileType(filename, stream,
+      stringType);
+  stream.close();
+
+  if (loadType == arma::hdf5_binary)
+  {
+    Timer::Start("loading_data");
+    Log::Info << "Loading " << columns.n_elem << " columns of '" << filename
+        << "' as HDF5 data.  " << std::flush;
+
+    std::string error;
+    const bool success = LoadHDF5Columns(filename, matrix, columns, transpose,
+        error);
+    Timer::Stop("loading_data");
+
+    if (success)
+    {
+      Log::Info << "Size is " << matrix.n_rows << " x " << matrix.n_cols
+          << ".\n";
+    }
+    else
+    {
+      Log::Info << std::endl;
+      if (fatal)
+        Log::Fatal << "Loading from '" << filename << "' failed: " << error
+            << "." << std::endl;
+      else
+        Log::Warn << "Loading from '" << filename << "' failed: " << error
+            << "." << std::endl;
+    }
+
+    return success;
+  }
+
+  // Other files are loaded completely, and then the columns are selected.
+  arma::Mat<eT> all;
+  if (!Load(filename, all, fatal, transpose))
+    return false;
+
+  for (size_t i = 0; i < columns.n_elem; ++i)
+  {
+    if (columns[i] >= all.n_cols)
+    {
+      if (fatal)
+        Log::Fatal << "Column index " << columns[i] << " is out of range ('"
+            << filename << "' has " << all.n_cols << " columns)." << std::endl;
+      else
+        Log::Warn << "Column index " << columns[i] << " is out of range ('"
+            << filename << "' has " << all.n_cols << " columns); load failed."
+            << std::endl;
+
+      return false;
+    }
+  }
+
+  matrix.set_size(all.n_rows, columns.n_elem);
+  for (size_t i = 0; i < columns.n_elem; ++i)
+    matrix.col(i) = all.col(columns[i]);
+
+  return true;
+}
+
+template<typename eT>
+bool Load(const std::string& filename,
+          arma::Mat<eT>& matrix,
+          const arma::span& columns,
+          bool fatal,
+          bool transpose)
+{
+  if (columns.whole)
+    return Load(filename, matrix, fatal, transpose);
+
+  arma::Col<size_t> indices((columns.b >= columns.a) ?
+      (columns.b - columns.a + 1) : 0);
+  for (size_t i = 0; i < indices.n_elem; ++i)
+    indices[i] = columns.a + i;
+
+  return Load(filename, matrix, indices, fatal, transpose);
+}
+
 }; // namespace data
 }; // namespace mlpack
 
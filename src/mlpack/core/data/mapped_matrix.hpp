@@ -0,0 +1,169 @@
+/**
+ * @file mapped_matrix.hpp
+ *
+ * Declaration of the MappedMatrix class, which gives a matrix stored in a
+ * binary file without reading the file into memory, of SaveMapped(), which
+ * saves a matrix in the mlpack mapped matrix format, and of the functions which
+ * save and read sparse matrices in the mlpack sparse matrix format.
+ */
+#ifndef __MLPACK_CORE_DATA_MAPPED_MATRIX_HPP
+#define __MLPACK_CORE_DATA_MAPPED_MATRIX_HPP
+
+#include <mlpack/core/util/log.hpp>
+#include <mlpack/core/util/mapped_file.hpp>
+#include <mlpack/core/arma_extend/arma_extend.hpp> // Includes Armadillo.
+#include <string>
+#include <vector>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * A read-only matrix whose elements are used in place from a memory-mapped file
+ * (see util::MappedFile), instead of being loaded into freshly allocated
+ * memory as data::Load() does.  Opening even a very large file is fast, pages
+ * are only read from disk when they are used, and every process that maps the
+ * same file shares one copy of it in the page cache.
+ *
+ * Two formats can be mapped:
+ *
+ *  - the mlpack mapped matrix format, written by SaveMapped(): a 32-byte
+ *    header followed by the elements in column-major order;
+ *  - Armadillo binary (arma_binary), as written by arma::Mat<eT>::save() or by
+ *    data::Save() with transpose = false.
+ *
+ * Unlike data::Load(), the matrix is not transposed, so the file must hold the
+ * matrix with one point per column.  The element type of the file must be eT;
+ * otherwise a fatal error is issued, as it is when the file cannot be mapped
+ * or is truncated.  If the elements of an Armadillo binary file are not
+ * suitably aligned for eT (its text header has an arbitrary length), they are
+ * copied instead, with a warning; the mlpack format is always aligned.
+ *
+ * The matrix must not be modified; the file stays mapped until the
+ * MappedMatrix is destroyed.  Because tree construction rearranges the
+ * dataset for some trees, a mapped reference set is best used with trees that
+ * do not (such as the cover tree), or with trees that were built beforehand.
+ *
+ * @tparam eT Type of the elements of the matrix.
+ */
+template<typename eT>
+class MappedMatrix
+{
+ public:
+  /**
+   * Map the matrix stored in the given file.
+   *
+   * @param filename Name of the file to map.
+   */
+  MappedMatrix(const std::string& filename);
+
+  //! Get the matrix.
+  const arma::Mat<eT>& Matrix() const { return matrix; }
+
+  //! Return whether the elements are used in place from the mapped file
+  //! (false if they had to be copied).
+  bool InPlace() const { return layout.copy.empty() || matrix.n_elem == 0; }
+
+ private:
+  //! Copying is not allowed (the matrix would point into the mapping).
+  MappedMatrix(const MappedMatrix& other);
+  //! Copying is not allowed (the matrix would point into the mapping).
+  MappedMatrix& operator=(const MappedMatrix& other);
+
+  //! Where the matrix is in the mapped file.
+  struct Layout
+  {
+    //! Find the matrix in the given mapped file (see FindLayout()).
+    Layout(const util::MappedFile& file) { FindLayout(file, *this); }
+
+    //! The number of rows.
+    size_t rows;
+    //! The number of columns.
+    size_t cols;
+    //! The elements (in the mapping, or in copy).
+    eT* memory;
+    //! A copy of the elements, if they are not aligned in the file.
+    std::vector<eT> copy;
+  };
+
+  //! Find the matrix in the given mapped file, copying its elements if they
+  //! are not aligned, and issue a fatal error if there is no usable matrix.
+  static void FindLayout(const util::MappedFile& file, Layout& layout);
+
+  //! The mapped file.
+  util::MappedFile file;
+  //! Where the matrix is.
+  Layout layout;
+  //! The matrix, which uses the memory given by the layout.
+  arma::Mat<eT> matrix;
+};
+
+/**
+ * Save the given matrix in the mlpack mapped matrix format, which can be mapped
+ * with MappedMatrix.  The matrix is not transposed.
+ *
+ * @param filename Name of file to save to.
+ * @param matrix Matrix to save.
+ * @param fatal If an error should be reported as fatal (default false).
+ * @return Boolean value indicating success or failure of save.
+ */
+template<typename eT>
+bool SaveMapped(const std::string& filename,
+                const arma::Mat<eT>& matrix,
+                bool fatal = false);
+
+/**
+ * Read the matrix in the given mapped file, in the mlpack mapped matrix format
+ * (see SaveMapped()), by copying its elements into the matrix; this is what
+ * data::Load() does for such files.  Unlike MappedMatrix, if the file is
+ * truncated or holds elements of another type, a warning is issued, false is
+ * returned and the matrix is left empty.
+ *
+ * @param file Mapped file to read.
+ * @param matrix Matrix to store the contents of the file in.
+ * @return Whether the matrix was read.
+ */
+template<typename eT>
+bool LoadMapped(const util::MappedFile& file, arma::Mat<eT>& matrix);
+
+/**
+ * Save the given sparse matrix in the mlpack sparse matrix format: a 40-byte
+ * header, followed by the column pointers and the row indices (as 64-bit
+ * integers) and the values of the compressed sparse column form of the matrix.
+ * Every array is suitably aligned, so the file can be read with LoadMapped()
+ * straight from a mapping, without any parsing.  The matrix is not transposed.
+ *
+ * @param filename Name of file to save to.
+ * @param matrix Sparse matrix to save.
+ * @param fatal If an error should be reported as fatal (default false).
+ * @return Boolean value indicating success or failure of save.
+ */
+template<typename eT>
+bool SaveMapped(const std::string& filename,
+                const arma::SpMat<eT>& matrix,
+                bool fatal = false);
+
+//! Return whether the given mapped file is in the mlpack sparse matrix format.
+inline bool IsMappedSparse(const util::MappedFile& file);
+
+/**
+ * Read the sparse matrix in the given mapped file, in the mlpack sparse matrix
+ * format (see SaveMapped()).  The arrays are checked and then copied once,
+ * from the mapping into the matrix.  If the file is truncated, holds elements
+ * of another type, or does not hold a valid compressed sparse column matrix, a
+ * warning is issued, false is returned and the matrix is left empty.
+ *
+ * @param file Mapped file to read.
+ * @param matrix Sparse matrix to store the contents of the file in.
+ * @return Whether the matrix was read.
+ */
+template<typename eT>
+bool LoadMapped(const util::MappedFile& file, arma::SpMat<eT>& matrix);
+
+}; // namespace data
+}; // namespace mlpack
+
+// Include implementation.
+#include "mapped_matrix_impl.hpp"
+
+#endif
@@ -0,0 +1,452 @@
+/**
+ * @file mapped_matrix_impl.hpp
+ *
+ * Implementation of the MappedMatrix class, of SaveMapped(), and of the mlpack
+ * sparse matrix format.
+ */
+#ifndef __MLPACK_CORE_DATA_MAPPED_MATRIX_IMPL_HPP
+#define __MLPACK_CORE_DATA_MAPPED_MATRIX_IMPL_HPP
+
+// In case it hasn't already been included.
+#include "mapped_matrix.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace mlpack {
+namespace data {
+
+// The layout of a file in the mlpack mapped matrix format: a header of
+// MappedHeaderSize 8-byte fields, followed by the elements of the matrix in
+// column-major order.  The header is a multiple of 8 bytes long, so the
+// elements are suitably aligned to be used in place.
+namespace mapped_matrix {
+
+//! The magic string at the beginning of every mapped matrix file.
+static const char MappedMagic[8] = { 'M', 'L', 'P', 'K', 'M', 'A', 'T', '1' };
+
+//! Fields of the header.
+enum HeaderField
+{
+  MagicField = 0,
+  ElemTypeField, // The Armadillo type code of the elements (such as "FN008").
+  RowsField,
+  ColsField,
+  MappedHeaderSize
+};
+
+//! The magic string at the beginning of every sparse matrix file.
+static const char SparseMagic[8] = { 'M', 'L', 'P', 'K', 'S', 'P', 'M', '1' };
+
+//! Fields of the header of a sparse matrix file, which is followed by the
+//! column pointers (one more than the number of columns) and the row indices,
+//! as 64-bit integers, and then the values.
+enum SparseHeaderField
+{
+  SparseMagicField = 0,
+  SparseElemTypeField,
+  SparseRowsField,
+  SparseColsField,
+  SparseNonzeroField,
+  SparseHeaderSize
+};
+
+//! Return the Armadillo binary header for matrices with the given element
+//! type (such as "ARMA_MAT_BIN_FN008").
+template<typename eT>
+std::string ArmaHeader()
+{
+  return arma::diskio::gen_bin_header(arma::Mat<eT>());
+}
+
+//! Return the element type field of the header for the given element type:
+//! the type code from the Armadillo binary header, padded with zeros.
+template<typename eT>
+uint64_t ElemTypeCode()
+{
+  const std::string header = ArmaHeader<eT>();
+  const std::string code = header.substr(header.rfind('_') + 1, 8);
+
+  uint64_t field = 0;
+  memcpy(&field, code.data(), code.size());
+  return field;
+}
+
+/**
+ * Write the given indices to the given stream as 64-bit integers, converting
+ * them in blocks if arma::uword is smaller.
+ */
+inline void WriteIndices(std::ostream& stream,
+                         const arma::uword* indices,
+                         const size_t count)
+{
+  if (sizeof(arma::uword) == sizeof(uint64_t))
+  {
+    stream.write((const char*) indices, count * sizeof(uint64_t));
+    return;
+  }
+
+  uint64_t block[1024];
+  for (size_t begin = 0; begin < count; begin += 1024)
+  {
+    const size_t blockCount = std::min(count - begin, (size_t) 1024);
+    for (size_t i = 0; i < blockCount; ++i)
+      block[i] = indices[begin + i];
+    stream.write((const char*) block, blockCount * sizeof(uint64_t));
+  }
+}
+
+//! Return a vector with the given 64-bit indices from a mapped file; they are
+//! used in place if arma::uword is 64 bits wide, and converted otherwise.
+inline arma::Col<arma::uword> ReadIndices(const uint64_t* indices,
+                                          const size_t count)
+{
+  if (sizeof(arma::uword) == sizeof(uint64_t))
+  {
+    // Armadillo will not modify the memory, since the vector is only read.
+    return arma::Col<arma::uword>((arma::uword*) indices, count, false, true);
+  }
+
+  arma::Col<arma::uword> converted(count);
+  for (size_t i = 0; i < count; ++i)
+    converted[i] = (arma::uword) indices[i];
+  return converted;
+}
+
+}; // namespace mapped_matrix
+
+template<typename eT>
+MappedMatrix<eT>::MappedMatrix(const std::string& filename) :
+    file(filename),
+    layout(file),
+    matrix(layout.memory, layout.rows, layout.cols, false, true)
+{
+  Log::Info << "Mapped " << layout.rows << 'x' << layout.cols << " matrix from "
+      << "'" << filename << "'." << std::endl;
+}
+
+template<typename eT>
+void MappedMatrix<eT>::FindLayout(const util::MappedFile& file, Layout& layout)
+{
+  using namespace mapped_matrix;
+
+  const char* data = file.Data();
+  const size_t size = file.Size();
+  size_t offset;
+
+  if (size >= MappedHeaderSize * sizeof(uint64_t) &&
+      memcmp(data, MappedMagic, 8) == 0)
+  {
+    uint64_t header[MappedHeaderSize];
+    memcpy(header, data, sizeof(header));
+
+    if (header[ElemTypeField] != ElemTypeCode<eT>())
+    {
+      Log::Fatal << "The elements of the matrix in '" << file.Filename()
+          << "' are not of the requested type." << std::endl;
+    }
+
+    layout.rows = header[RowsField];
+    layout.cols = header[ColsField];
+    offset = sizeof(header);
+  }
+  else
+  {
+    // Otherwise it must be an Armadillo binary file: one line with the type
+    // header, one line with the size, and then the elements.
+    const std::string armaHeader = ArmaHeader<eT>();
+    const char* headerEnd = (size == 0) ? NULL : (const char*) memchr(data,
+        '\n', std::min(size, (size_t) 64));
+    if (headerEnd == NULL || (headerEnd - data) < 13 ||
+        strncmp(data, "ARMA_MAT_BIN_", 13) != 0)
+    {
+      Log::Fatal << "File '" << file.Filename() << "' is not a mappable matrix "
+          << "(Armadillo binary or mlpack mapped matrix format)." << std::endl;
+    }
+
+    if (std::string(data, headerEnd - data) != armaHeader)
+    {
+      Log::Fatal << "The elements of the matrix in '" << file.Filename()
+          << "' are not of the requested type (file has '"
+          << std::string(data, headerEnd - data) << "'; expected '"
+          << armaHeader << "')." << std::endl;
+    }
+
+    const char* sizeBegin = headerEnd + 1;
+    const char* sizeEnd = (const char*) memchr(sizeBegin, '\n',
+        std::min(size - (sizeBegin - data), (size_t) 64));
+    std::istringstream sizeStream(sizeEnd == NULL ? std::string() :
+        std::string(sizeBegin, sizeEnd - sizeBegin));
+    if (!(sizeStream >> layout.rows >> layout.cols))
+    {
+      Log::Fatal << "Cannot read the size of the matrix in '"
+          << file.Filename() << "'." << std::endl;
+    }
+
+    offset = (sizeEnd + 1) - data;
+  }
+
+  const size_t elements = layout.rows * layout.cols;
+  if (layout.cols != 0 && elements / layout.cols != layout.rows)
+  {
+    Log::Fatal << "The size of the matrix in '" << file.Filename() << "' is "
+        << "invalid." << std::endl;
+  }
+
+  if (offset > size || (size - offset) / sizeof(eT) < elements)
+  {
+    Log::Fatal << "File '" << file.Filename() << "' is truncated: it should "
+        << "hold a " << layout.rows << 'x' << layout.cols << " matrix."
+        << std::endl;
+  }
+
+  if (offset % sizeof(eT) == 0)
+  {
+    // MappedFile::Data() is aligned, so the elements can be used in place;
+    // Armadillo will not modify them, since the matrix is const.
+    layout.memory = (eT*) (data + offset);
+  }
+  else
+  {
+    Log::Warn << "The elements of the matrix in '" << file.Filename() << "' "
+        << "are not aligned; copying them instead of using them in place."
+        << std::endl;
+
+    layout.copy.resize(elements);
+    if (elements > 0)
+      memcpy(&layout.copy[0], data + offset, elements * sizeof(eT));
+    layout.memory = (elements > 0) ? &layout.copy[0] : NULL;
+  }
+}
+
+template<typename eT>
+bool SaveMapped(const std::string& filename,
+                const arma::Mat<eT>& matrix,
+                bool fatal)
+{
+  using namespace mapped_matrix;
+
+  std::ofstream stream(filename.c_str(), std::ios::out | std::ios::binary);
+  if (!stream.is_open())
+  {
+    if (fatal)
+      Log::Fatal << "Cannot open file '" << filename << "' for writing."
+          << std::endl;
+    else
+      Log::Warn << "Cannot open file '" << filename << "' for writing; save "
+          << "failed." << std::endl;
+
+    return false;
+  }
+
+  uint64_t header[MappedHeaderSize];
+  memcpy(&header[MagicField], MappedMagic, 8);
+  header[ElemTypeField] = ElemTypeCode<eT>();
+  header[RowsField] = matrix.n_rows;
+  header[ColsField] = matrix.n_cols;
+  stream.write((const char*) header, sizeof(header));
+  stream.write((const char*) matrix.memptr(), matrix.n_elem * sizeof(eT));
+
+  if (!stream.good())
+  {
+    if (fatal)
+      Log::Fatal << "Save to '" << filename << "' failed." << std::endl;
+    else
+      Log::Warn << "Save to '" << filename << "' failed." << std::endl;
+
+    return false;
+  }
+
+  Log::Info << "Saved " << matrix.n_rows << 'x' << matrix.n_cols << " matrix "
+      << "to '" << filename << "' (mapped matrix format)." << std::endl;
+
+  return true;
+}
+
+template<typename eT>
+bool LoadMapped(const util::MappedFile& file, arma::Mat<eT>& matrix)
+{
+  using namespace mapped_matrix;
+
+  matrix.reset();
+  const char* data = file.Data();
+  const size_t size = file.Size();
+
+  if (size < MappedHeaderSize * sizeof(uint64_t) ||
+      memcmp(data, MappedMagic, 8) != 0)
+  {
+    Log::Warn << "File '" << file.Filename() << "' is not in the mapped matrix "
+        << "format." << std::endl;
+    return false;
+  }
+
+  uint64_t header[MappedHeaderSize];
+  memcpy(header, data, sizeof(header));
+
+  if (header[ElemTypeField] != ElemTypeCode<eT>())
+  {
+    Log::Warn << "The elements of the matrix in '" << file.Filename()
+        << "' are not of the requested type." << std::endl;
+    return false;
+  }
+
+  const size_t rows = header[RowsField];
+  const size_t cols = header[ColsField];
+  const size_t available = (size - sizeof(header)) / sizeof(eT);
+  if (rows != 0 && cols > available / rows)
+  {
+    Log::Warn << "File '" << file.Filename() << "' is truncated: it should "
+        << "hold a " << rows << 'x' << cols << " matrix." << std::endl;
+    return false;
+  }
+
+  matrix.set_size(rows, cols);
+  if (matrix.n_elem > 0)
+    memcpy(matrix.memptr(), data + sizeof(header), matrix.n_elem * sizeof(eT));
+
+  return true;
+}
+
+template<typename eT>
+bool SaveMapped(const std::string& filename,
+                const arma::SpMat<eT>& matrix,
+                bool fatal)
+{
+  using namespace mapped_matrix;
+
+  std::ofstream stream(filename.c_str(), std::ios::out | std::ios::binary);
+  if (!stream.is_open())
+  {
+    if (fatal)
+      Log::Fatal << "Cannot open file '" << filename << "' for writing."
+          << std::endl;
+    else
+      Log::Warn << "Cannot open file '" << filename << "' for writing; save "
+          << "failed." << std::endl;
+
+    return false;
+  }
+
+  uint64_t header[SparseHeaderSize];
+  memcpy(&header[SparseMagicField], SparseMagic, 8);
+  header[SparseElemTypeField] = ElemTypeCode<eT>();
+  header[SparseRowsField] = matrix.n_rows;
+  header[SparseColsField] = matrix.n_cols;
+  header[SparseNonzeroField] = matrix.n_nonzero;
+  stream.write((const char*) header, sizeof(header));
+  WriteIndices(stream, matrix.col_ptrs, matrix.n_cols + 1);
+  WriteIndices(stream, matrix.row_indices, matrix.n_nonzero);
+  stream.write((const char*) matrix.values, matrix.n_nonzero * sizeof(eT));
+
+  if (!stream.good())
+  {
+    if (fatal)
+      Log::Fatal << "Save to '" << filename << "' failed." << std::endl;
+    else
+      Log::Warn << "Save to '" << filename << "' failed." << std::endl;
+
+    return false;
+  }
+
+  Log::Info << "Saved " << matrix.n_rows << 'x' << matrix.n_cols << " sparse "
+      << "matrix with " << matrix.n_nonzero << " nonzero elements to '"
+      << filename << "' (sparse matrix format)." << std::endl;
+
+  return true;
+}
+
+inline bool IsMappedSparse(const util::MappedFile& file)
+{
+  return (file.Size() >= mapped_matrix::SparseHeaderSize * sizeof(uint64_t) &&
+      memcmp(file.Data(), mapped_matrix::SparseMagic, 8) == 0);
+}
+
+template<typename eT>
+bool LoadMapped(const util::MappedFile& file, arma::SpMat<eT>& matrix)
+{
+  using namespace mapped_matrix;
+
+  matrix = arma::SpMat<eT>();
+  if (!IsMappedSparse(file))
+  {
+    Log::Warn << "File '" << file.Filename() << "' is not in the sparse matrix "
+        << "format." << std::endl;
+    return false;
+  }
+
+  const char* data = file.Data();
+  const size_t size = file.Size();
+
+  uint64_t header[SparseHeaderSize];
+  memcpy(header, data, sizeof(header));
+
+  if (header[SparseElemTypeField] != ElemTypeCode<eT>())
+  {
+    Log::Warn << "The elements of the sparse matrix in '" << file.Filename()
+        << "' are not of the requested type." << std::endl;
+    return false;
+  }
+
+  const size_t rows = header[SparseRowsField];
+  const size_t cols = header[SparseColsField];
+  const size_t nonzero = header[SparseNonzeroField];
+
+  // Check the sizes one at a time, so that nothing can overflow.
+  const size_t available = size - sizeof(header);
+  if (cols >= available / sizeof(uint64_t) ||
+      nonzero > (available - (cols + 1) * sizeof(uint64_t)) /
+          (sizeof(uint64_t) + sizeof(eT)))
+  {
+    Log::Warn << "File '" << file.Filename() << "' is truncated: it should "
+        << "hold a " << rows << 'x' << cols << " sparse matrix with "
+        << nonzero << " nonzero elements." << std::endl;
+    return false;
+  }
+
+  const uint64_t* colPtrs = (const uint64_t*) (data + sizeof(header));
+  const uint64_t* rowIndices = colPtrs + cols + 1;
+  const eT* values = (const eT*) (rowIndices + nonzero);
+
+  // Armadillo trusts the arrays, so make sure they are valid: the column
+  // pointers must increase from 0 to the number of nonzero elements, and the
+  // rows in each column must be increasing and in range.
+  bool valid = (colPtrs[0] == 0 && colPtrs[cols] == nonzero);
+  for (size_t c = 0; c < cols && valid; ++c)
+  {
+    if (colPtrs[c + 1] < colPtrs[c] || colPtrs[c + 1] > nonzero)
+    {
+      valid = false;
+      break;
+    }
+
+    for (size_t j = colPtrs[c]; j < colPtrs[c + 1]; ++j)
+    {
+      if (rowIndices[j] >= rows ||
+          (j > colPtrs[c] && rowIndices[j] <= rowIndices[j - 1]))
+      {
+        valid = false;
+        break;
+      }
+    }
+  }
+
+  if (!valid)
+  {
+    Log::Warn << "The sparse matrix in '" << file.Filename() << "' is "
+        << "invalid." << std::endl;
+    return false;
+  }
+
+  // Armadillo will not modify the values, since the vector is only read.
+  const arma::Col<eT> valueVector((eT*) values, nonzero, false, true);
+  matrix = arma::SpMat<eT>(ReadIndices(rowIndices, nonzero),
+      ReadIndices(colPtrs, cols + 1), valueVector, rows, cols);
+
+  return true;
+}
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
@@ -11,15 +11,74 @@
 // In case it hasn't been included yet.
 #include "normalize_labels.hpp"
 
+#include <unordered_map>
+
 namespace mlpack {
 namespace data {
 
+namespace aux {
+
+/**
+ * If every label is an integer and the labels span a range of values not much
+ * larger than the number of labels, normalize them with a table indexed by
+ * value, in O(n) time, and return true; otherwise, return false.
+ */
+template<typename eT>
+bool NormalizeLabelsByTable(const arma::Col<eT>& labelsIn,
+                            arma::Col<size_t>& labels,
+                            arma::Col<eT>& mapping)
+{
+  eT minLabel = labelsIn[0];
+  eT maxLabel = labelsIn[0];
+  for (size_t i = 0; i < labelsIn.n_elem; ++i)
+  {
+    // This also rejects NaNs and infinities.
+    const double label = (double) labelsIn[i];
+    if (label != std::floor(label) || std::fabs(label) > 1e15)
+      return false;
+
+    if (labelsIn[i] < minLabel)
+      minLabel = labelsIn[i];
+    else if (maxLabel < labelsIn[i])
+      maxLabel = labelsIn[i];
+  }
+
+  const double range = (double) maxLabel - (double) minLabel;
+  if (range > 2.0 * labelsIn.n_elem + 1024.0)
+    return false;
+
+  // The new label of each value, or labelsIn.n_elem if it hasn't been seen.
+  std::vector<size_t> table((size_t) range + 1, labelsIn.n_elem);
+  size_t curLabel = 0;
+  for (size_t i = 0; i < labelsIn.n_elem; ++i)
+  {
+    size_t& newLabel = table[(size_t) (labelsIn[i] - minLabel)];
+    if (newLabel == labelsIn.n_elem)
+    {
+      newLabel = curLabel;
+      mapping[curLabel++] = labelsIn[i];
+    }
+
+    labels[i] = newLabel;
+  }
+
+  mapping.resize(curLabel);
+  return true;
+}
+
+}; // namespace aux
+
 /**
  * Given a set of labels of a particular datatype, convert them to unsigned
  * labels in the range [0, n) where n is the number of different labels.  Also,
  * a reverse mapping from the new label to the old value is stored in the
  * 'mapping' vector.
  *
+ * The labels are numbered in the order they first appear in.  Integer labels
+ * (the usual case for class and ID labels) which span a range not much larger
+ * than the number of labels are normalized with a table; other labels are
+ * looked up in a hash map.  Either way, this takes O(n) (expected) time.
+ *
  * @param labelsIn Input labels of arbitrary datatype.
  * @param labels Vector that unsigned labels will be stored in.
  * @param mapping Reverse mapping to convert new labels back to old labels.
@@ -29,33 +88,35 @@ void NormalizeLabels(const arma::Col<eT>& labelsIn,
                      arma::Col<size_t>& labels,
                      arma::Col<eT>& mapping)
 {
-  // Loop over the input labels, and develop the mapping.  We'll first naively
-  // resize the mapping to the maximum possible size, and then when we fill it,
-  // we'll resize it back down to its actual size.
+  // We'll first naively resize the mapping to the maximum possible size, and
+  // then when we fill it, we'll resize it back down to its actual size.
   mapping.set_size(labelsIn.n_elem);
   labels.set_size(labelsIn.n_elem);
+  if (labelsIn.n_elem == 0)
+    return;
+
+  if (aux::NormalizeLabelsByTable(labelsIn, labels, mapping))
+    return;
+
+  // The new label of each label seen so far.  NaNs are not equal to anything,
+  // not even themselves, so each gets its own label.
+  std::unordered_map<eT, size_t> labelMap;
   size_t curLabel = 0;
   for (size_t i = 0; i < labelsIn.n_elem; ++i)
   {
-    bool found = false;
-    for (size_t j = 0; j < curLabel; ++j)
-    {
-      // Is the label already in the list of labels we have seen?
-      if (labelsIn[i] == mapping[j])
-      {
-        labels[i] = j;
-        found = true;
-        break;
-      }
-    }
-
-    // Do we need to add this new label?
-    if (!found)
+    if (labelsIn[i] != labelsIn[i])
     {
       mapping[curLabel] = labelsIn[i];
-      labels[i] = curLabel;
-      ++curLabel;
+      labels[i] = curLabel++;
+      continue;
     }
+
+    const std::pair<typename std::unordered_map<eT, size_t>::iterator, bool>
+        result = labelMap.insert(std::make_pair(labelsIn[i], curLabel));
+    if (result.second)
+      mapping[curLabel++] = labelsIn[i];
+
+    labels[i] = result.first->second;
   }
 
   // Resize mapping back down to necessary size.
@@ -0,0 +1,85 @@
+/**
+ * @file parse_text.hpp
+ *
+ * Parallel parsers for numeric CSV and raw ASCII files and for coordinate
+ * lists, used by data::Load().
+ */
+#ifndef __MLPACK_CORE_DATA_PARSE_TEXT_HPP
+#define __MLPACK_CORE_DATA_PARSE_TEXT_HPP
+
+#include <mlpack/core/util/log.hpp>
+#include <mlpack/core/util/huge_pages.hpp>
+#include <mlpack/core/util/mapped_file.hpp>
+#include <mlpack/core/util/parallel.hpp>
+#include <mlpack/core/arma_extend/arma_extend.hpp> // Includes Armadillo.
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Parse the given mapped CSV or raw ASCII file into the given matrix, with one
+ * number per element.  The file is split into line-aligned chunks, which are
+ * parsed in parallel (if OpenMP is available) into their own rows of the
+ * matrix, so no separate transposition pass is needed: if transpose is true,
+ * each line of the file becomes a column of the matrix.
+ *
+ * Numbers are parsed without regard to the locale.  Only files that Armadillo
+ * would load in the same way are accepted: every non-blank line must hold the
+ * same number of numbers (separated by commas if csv is true, and by
+ * whitespace otherwise), and there may be no non-blank line after a blank
+ * line.  Otherwise (or if eT is not float or double) false is returned and the
+ * matrix is left empty, and the caller should use Armadillo's parser instead.
+ *
+ * @param file Mapped file to parse.
+ * @param matrix Matrix to store the parsed numbers in.
+ * @param csv If true, numbers are separated by commas; otherwise, by
+ *     whitespace.
+ * @param transpose If true, each line of the file becomes a column of the
+ *     matrix; otherwise, a row.
+ * @return Whether the file was parsed.
+ */
+template<typename eT>
+bool ParseText(const util::MappedFile& file,
+               arma::Mat<eT>& matrix,
+               const bool csv,
+               const bool transpose);
+
+/**
+ * Parse the given mapped coordinate list file into the given sparse matrix.
+ * Each non-blank line holds the row index, the column index and the value of
+ * one element (separated by commas if csv is true, and by whitespace
+ * otherwise); blank lines are skipped, and elements whose value is zero are
+ * not stored.  The size of the matrix is given by the largest indices.
+ *
+ * The file is split into line-aligned chunks which are parsed in parallel (if
+ * OpenMP is available) straight into a list of elements; the elements are then
+ * bucketed by column, and the columns are sorted by row in parallel, which
+ * gives the compressed sparse column form of the matrix without the general
+ * batch insertion.  If transpose is true, the row and column indices of the
+ * file are swapped, so each distinct row index of the file becomes a column.
+ *
+ * If a line is not a pair of valid indices and a value, or if a location is
+ * given more than once, a warning is issued, false is returned and the matrix
+ * is left empty.
+ *
+ * @param file Mapped file to parse.
+ * @param matrix Sparse matrix to store the parsed elements in.
+ * @param csv If true, numbers are separated by commas; otherwise, by
+ *     whitespace.
+ * @param transpose If true, the row index of each line of the file is the
+ *     column index in the matrix, and vice versa.
+ * @return Whether the file was parsed.
+ */
+template<typename eT>
+bool ParseCoordinates(const util::MappedFile& file,
+                      arma::SpMat<eT>& matrix,
+                      const bool csv,
+                      const bool transpose);
+
+}; // namespace data
+}; // namespace mlpack
+
+// Include implementation.
+#include "parse_text_impl.hpp"
+
+#endif
@@ -0,0 +1,566 @@
+/**
+ * @file parse_text_impl.hpp
+ *
+ * Implementation of the parallel text parser used by data::Load().
+ */
+#ifndef __MLPACK_CORE_DATA_PARSE_TEXT_IMPL_HPP
+#define __MLPACK_CORE_DATA_PARSE_TEXT_IMPL_HPP
+
+// In case it hasn't already been included.
+#include "parse_text.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+namespace mlpack {
+namespace data {
+namespace text {
+
+//! The smallest number of bytes in a chunk that is parsed by one thread.
+static const size_t MinChunkSize = 1 << 20;
+
+//! Return whether the given character is whitespace within a line.
+inline bool IsSpace(const char c)
+{
+  return (c == ' ' || c == '\t' || c == '\r');
+}
+
+//! Return whether the given character may end a number.
+inline bool IsDelimiter(const char c)
+{
+  return (IsSpace(c) || c == '\n' || c == ',');
+}
+
+//! Skip whitespace within the current line.
+inline void SkipSpace(const char*& pos, const char* end)
+{
+  while (pos != end && IsSpace(*pos))
+    ++pos;
+}
+
+//! Return the beginning of the line after the one containing pos.
+inline const char* NextLine(const char* pos, const char* end)
+{
+  const char* newline = (const char*) memchr(pos, '\n', end - pos);
+  return (newline == NULL) ? end : newline + 1;
+}
+
+/**
+ * Parse the number at pos, and move pos past it.  Numbers with at most 19
+ * significant digits whose value is exactly representable after scaling by a
+ * power of ten up to 1e22 (which covers nearly everything written by a
+ * program) are converted directly, with correct rounding; everything else
+ * (long numbers, "inf", "nan") is converted by strtod().
+ *
+ * @return false if there is no valid number at pos.
+ */
+inline bool ParseNumber(const char*& pos, const char* end, double& value)
+{
+  static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+      1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+      1e20, 1e21, 1e22 };
+
+  const char* p = pos;
+  bool negative = false;
+  if (p != end && (*p == '-' || *p == '+'))
+  {
+    negative = (*p == '-');
+    ++p;
+  }
+
+  uint64_t mantissa = 0;
+  int digits = 0; // Significant digits in the mantissa.
+  int exponent = 0;
+  bool anyDigits = false;
+  bool exact = true;
+
+  while (p != end && *p >= '0' && *p <= '9')
+  {
+    if (digits < 19)
+    {
+      mantissa = 10 * mantissa + (*p - '0');
+      if (mantissa != 0)
+        ++digits;
+    }
+    else
+    {
+      exact = false;
+    }
+
+    anyDigits = true;
+    ++p;
+  }
+
+  if (p != end && *p == '.')
+  {
+    ++p;
+    while (p != end && *p >= '0' && *p <= '9')
+    {
+      if (digits < 19)
+      {
+        mantissa = 10 * mantissa + (*p - '0');
+        if (mantissa != 0)
+          ++digits;
+        --exponent;
+      }
+      else
+      {
+        exact = false;
+      }
+
+      anyDigits = true;
+      ++p;
+    }
+  }
+
+  if (anyDigits && p != end && (*p == 'e' || *p == 'E'))
+  {
+    ++p;
+    bool negativeExponent = false;
+    if (p != end && (*p == '-' || *p == '+'))
+    {
+      negativeExponent = (*p == '-');
+      ++p;
+    }
+
+    if (p == end || *p < '0' || *p > '9')
+      return false;
+
+    int e = 0;
+    while (p != end && *p >= '0' && *p <= '9')
+    {
+      if (e < 10000)
+        e = 10 * e + (*p - '0');
+      ++p;
+    }
+
+    exponent += (negativeExponent ? -e : e);
+  }
+
+  if (anyDigits && (p == end || IsDelimiter(*p)) && exact &&
+      mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+  {
+    value = (exponent < 0) ? double(mantissa) / powers[-exponent] :
+        double(mantissa) * powers[exponent];
+    if (negative)
+      value = -value;
+
+    pos = p;
+    return true;
+  }
+
+  // Take the slow path; find the end of the token first.
+  const char* tokenEnd = pos;
+  while (tokenEnd != end && !IsDelimiter(*tokenEnd))
+    ++tokenEnd;
+  if (tokenEnd == pos)
+    return false;
+
+  const std::string token(pos, tokenEnd);
+  char* converted;
+  value = strtod(token.c_str(), &converted);
+  if (converted != token.c_str() + token.size())
+    return false;
+
+  pos = tokenEnd;
+  return true;
+}
+
+/**
+ * Parse the line beginning at pos, and move pos to the end of the line (its
+ * newline, or the end of the file).  The first maxValues numbers are stored in
+ * out, stride elements apart.
+ *
+ * @return The number of numbers on the line, or (size_t) -1 if the line
+ *     cannot be parsed.
+ */
+template<typename eT>
+size_t ParseLine(const char*& pos,
+                 const char* end,
+                 const bool csv,
+                 eT* out,
+                 const size_t stride,
+                 const size_t maxValues)
+{
+  size_t count = 0;
+  SkipSpace(pos, end);
+  if (pos == end || *pos == '\n')
+    return 0;
+
+  while (true)
+  {
+    double value;
+    if (!ParseNumber(pos, end, value))
+      return size_t(-1);
+
+    if (count < maxValues)
+      out[count * stride] = eT(value);
+    ++count;
+
+    SkipSpace(pos, end);
+    if (pos == end || *pos == '\n')
+      return count;
+
+    if (csv)
+    {
+      if (*pos != ',')
+        return size_t(-1);
+
+      ++pos;
+      SkipSpace(pos, end);
+    }
+  }
+}
+
+//! Return whether the line beginning at pos is blank.
+inline bool BlankLine(const char* pos, const char* end)
+{
+  SkipSpace(pos, end);
+  return (pos == end || *pos == '\n');
+}
+
+/**
+ * Split the given file contents into line-aligned chunks, at least
+ * MinChunkSize bytes long (except for a short file), and at most four for each
+ * thread.  Chunk i is [chunkBegin[i], chunkBegin[i + 1]).
+ */
+inline void SplitChunks(const char* data,
+                        const size_t size,
+                        const size_t threads,
+                        std::vector<const char*>& chunkBegin)
+{
+  const char* end = data + size;
+  const size_t numChunks = std::max(std::min(4 * threads, size / MinChunkSize),
+      (size_t) 1);
+
+  chunkBegin.resize(numChunks + 1);
+  chunkBegin[0] = data;
+  chunkBegin[numChunks] = end;
+  for (size_t i = 1; i < numChunks; ++i)
+  {
+    const char* nominal = data + (size / numChunks) * i;
+    chunkBegin[i] = std::max(NextLine(nominal - 1, end), chunkBegin[i - 1]);
+  }
+}
+
+//! Return whether the given number is a valid index (a nonnegative integer
+//! which fits in an arma::uword).
+inline bool IsIndex(const double value)
+{
+  return (value >= 0.0 && value == std::floor(value) &&
+      value < (double) std::numeric_limits<arma::uword>::max());
+}
+
+//! Order (row, value) pairs by row only (the values need not be ordered).
+template<typename eT>
+struct RowLess
+{
+  bool operator()(const std::pair<arma::uword, eT>& a,
+                  const std::pair<arma::uword, eT>& b) const
+  {
+    return a.first < b.first;
+  }
+};
+
+}; // namespace text
+
+template<typename eT>
+bool ParseText(const util::MappedFile& file,
+               arma::Mat<eT>& matrix,
+               const bool csv,
+               const bool transpose)
+{
+  using namespace text;
+
+  matrix.reset();
+  if (!arma::is_float<eT>::value && !arma::is_double<eT>::value)
+    return false;
+
+  const char* data = file.Data();
+  const size_t size = file.Size();
+  if (size == 0)
+    return false;
+  const char* end = data + size;
+
+  // Split the file into line-aligned chunks.
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+  std::vector<const char*> chunkBegin;
+  SplitChunks(data, size, threads, chunkBegin);
+  const size_t numChunks = chunkBegin.size() - 1;
+
+  // Count the non-blank lines of each chunk.  Armadillo stops at the first
+  // blank line, so we give up if a non-blank line follows a blank one.
+  std::vector<size_t> chunkRows(numChunks, 0);
+  std::vector<char> chunkBlank(numChunks, 0); // Has a blank line.
+  std::vector<char> chunkValid(numChunks, 1);
+
+  #pragma omp parallel for schedule(dynamic) num_threads(threads)
+  for (size_t i = 0; i < numChunks; ++i)
+  {
+    for (const char* line = chunkBegin[i]; line != chunkBegin[i + 1];
+         line = NextLine(line, end))
+    {
+      if (BlankLine(line, end))
+      {
+        chunkBlank[i] = 1;
+      }
+      else
+      {
+        if (chunkBlank[i])
+          chunkValid[i] = 0;
+        ++chunkRows[i];
+      }
+    }
+  }
+
+  // Find the first row of each chunk.
+  std::vector<size_t> chunkFirstRow(numChunks + 1, 0);
+  bool blankSeen = false;
+  for (size_t i = 0; i < numChunks; ++i)
+  {
+    if (!chunkValid[i] || (blankSeen && chunkRows[i] > 0))
+      return false;
+    blankSeen = blankSeen || chunkBlank[i];
+    chunkFirstRow[i + 1] = chunkFirstRow[i] + chunkRows[i];
+  }
+
+  const size_t rows = chunkFirstRow[numChunks];
+  if (rows == 0)
+    return false;
+
+  // The number of columns is given by the first non-blank line.
+  const char* firstLine = data;
+  while (BlankLine(firstLine, end))
+    firstLine = NextLine(firstLine, end);
+  const size_t cols = ParseLine(firstLine, end, csv, (eT*) NULL, 0, 0);
+  if (cols == size_t(-1))
+    return false;
+
+  // Each line of the file is written straight into its place in the matrix.
+  if (transpose)
+    matrix.set_size(cols, rows);
+  else
+    matrix.set_size(rows, cols);
+  const size_t stride = transpose ? 1 : rows;
+
+  // Nothing has been written to the matrix yet, so if huge pages are enabled
+  // it gets them as the threads fill it in.
+  util::AdviseHugePages(matrix.memptr(), matrix.n_elem * sizeof(eT));
+
+  #pragma omp parallel for schedule(dynamic) num_threads(threads)
+  for (size_t i = 0; i < numChunks; ++i)
+  {
+    size_t row = chunkFirstRow[i];
+    for (const char* line = chunkBegin[i]; line != chunkBegin[i + 1];
+         line = NextLine(line, end))
+    {
+      if (BlankLine(line, end))
+        continue;
+
+      eT* out = transpose ? matrix.colptr(row) : matrix.memptr() + row;
+      const char* pos = line;
+      if (ParseLine(pos, end, csv, out, stride, cols) != cols)
+      {
+        chunkValid[i] = 0;
+        break;
+      }
+
+      ++row;
+    }
+  }
+
+  for (size_t i = 0; i < numChunks; ++i)
+  {
+    if (!chunkValid[i])
+    {
+      matrix.reset();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template<typename eT>
+bool ParseCoordinates(const util::MappedFile& file,
+                      arma::SpMat<eT>& matrix,
+                      const bool csv,
+                      const bool transpose)
+{
+  using namespace text;
+
+  matrix = arma::SpMat<eT>();
+
+  const char* data = file.Data();
+  const size_t size = file.Size();
+  if (size == 0)
+    return true;
+  const char* end = data + size;
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  std::vector<const char*> chunkBegin;
+  SplitChunks(data, size, threads, chunkBegin);
+  const size_t numChunks = chunkBegin.size() - 1;
+
+  // Count the lines and the non-blank lines (elements) of each chunk.
+  std::vector<size_t> chunkLines(numChunks, 0);
+  std::vector<size_t> chunkElements(numChunks, 0);
+
+  #pragma omp parallel for schedule(dynamic) num_threads(threads)
+  for (size_t i = 0; i < numChunks; ++i)
+  {
+    for (const char* line = chunkBegin[i]; line != chunkBegin[i + 1];
+         line = NextLine(line, end))
+    {
+      ++chunkLines[i];
+      if (!BlankLine(line, end))
+        ++chunkElements[i];
+    }
+  }
+
+  std::vector<size_t> chunkFirstLine(numChunks + 1, 0);
+  std::vector<size_t> chunkFirstElement(numChunks + 1, 0);
+  for (size_t i = 0; i < numChunks; ++i)
+  {
+    chunkFirstLine[i + 1] = chunkFirstLine[i] + chunkLines[i];
+    chunkFirstElement[i + 1] = chunkFirstElement[i] + chunkElements[i];
+  }
+
+  const size_t elements = chunkFirstElement[numChunks];
+  if (elements == 0)
+    return true;
+
+  // Parse each chunk into its part of the element list.  The number of the
+  // first invalid line of each chunk (counting from 1) is kept, or 0.
+  std::vector<arma::uword> rowIndices(elements);
+  std::vector<arma::uword> colIndices(elements);
+  std::vector<eT> values(elements);
+  std::vector<size_t> chunkRows(numChunks, 0);
+  std::vector<size_t> chunkCols(numChunks, 0);
+  std::vector<size_t> chunkBadLine(numChunks, 0);
+
+  #pragma omp parallel for schedule(dynamic) num_threads(threads)
+  for (size_t i = 0; i < numChunks; ++i)
+  {
+    size_t element = chunkFirstElement[i];
+    size_t lineNumber = chunkFirstLine[i];
+    for (const char* line = chunkBegin[i]; line != chunkBegin[i + 1];
+         line = NextLine(line, end))
+    {
+      ++lineNumber;
+      double entry[3];
+      const char* pos = line;
+      const size_t count = ParseLine(pos, end, csv, entry, 1, 3);
+      if (count == 0)
+        continue; // Blank line.
+
+      if (count != 3 || !IsIndex(entry[0]) || !IsIndex(entry[1]))
+      {
+        chunkBadLine[i] = lineNumber;
+        break;
+      }
+
+      const size_t row = (size_t) entry[transpose ? 1 : 0];
+      const size_t col = (size_t) entry[transpose ? 0 : 1];
+      rowIndices[element] = row;
+      colIndices[element] = col;
+      values[element] = eT(entry[2]);
+      chunkRows[i] = std::max(chunkRows[i], row + 1);
+      chunkCols[i] = std::max(chunkCols[i], col + 1);
+      ++element;
+    }
+  }
+
+  size_t rows = 0;
+  size_t cols = 0;
+  for (size_t i = 0; i < numChunks; ++i)
+  {
+    if (chunkBadLine[i] != 0)
+    {
+      Log::Warn << "Line " << chunkBadLine[i] << " of '" << file.Filename()
+          << "' is not a row index, a column index and a value." << std::endl;
+      return false;
+    }
+
+    rows = std::max(rows, chunkRows[i]);
+    cols = std::max(cols, chunkCols[i]);
+  }
+
+  // Bucket the nonzero elements by column, in the order of the file.
+  arma::Col<arma::uword> colPtrs(cols + 1);
+  colPtrs.zeros();
+  for (size_t i = 0; i < elements; ++i)
+    if (values[i] != eT(0))
+      ++colPtrs[colIndices[i] + 1];
+  for (size_t c = 0; c < cols; ++c)
+    colPtrs[c + 1] += colPtrs[c];
+
+  const size_t nonzero = colPtrs[cols];
+  std::vector<std::pair<arma::uword, eT> > cells(nonzero);
+  std::vector<arma::uword> next(colPtrs.begin(), colPtrs.end() - 1);
+  for (size_t i = 0; i < elements; ++i)
+    if (values[i] != eT(0))
+      cells[next[colIndices[i]]++] = std::make_pair(rowIndices[i], values[i]);
+
+  // Free the element list before the matrix is built.
+  std::vector<arma::uword>().swap(rowIndices);
+  std::vector<arma::uword>().swap(colIndices);
+  std::vector<eT>().swap(values);
+
+  // Sort each column by row; a location which is given twice is an error.
+  arma::Col<arma::uword> cellRows(nonzero);
+  arma::Col<eT> cellValues(nonzero);
+  bool duplicate = false;
+
+  #pragma omp parallel for schedule(dynamic, 256) num_threads(threads) \
+      reduction(||:duplicate)
+  for (size_t c = 0; c < cols; ++c)
+  {
+    std::sort(cells.begin() + colPtrs[c], cells.begin() + colPtrs[c + 1],
+        RowLess<eT>());
+    for (size_t j = colPtrs[c]; j < colPtrs[c + 1]; ++j)
+    {
+      if (j > colPtrs[c] && cells[j].first == cells[j - 1].first)
+        duplicate = true;
+
+      cellRows[j] = cells[j].first;
+      cellValues[j] = cells[j].second;
+    }
+  }
+
+  if (duplicate)
+  {
+    Log::Warn << "A location is given more than once in '" << file.Filename()
+        << "'." << std::endl;
+    return false;
+  }
+
+  std::vector<std::pair<arma::uword, eT> >().swap(cells);
+  matrix = arma::SpMat<eT>(cellRows, colPtrs, cellValues, rows, cols);
+
+  return true;
+}
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
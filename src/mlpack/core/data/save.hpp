@@ -31,6 +31,13 @@ namespace data /** Functions to load and save matrices. */ {
  *  - Raw binary (raw_binary), denoted by .bin
  *  - Armadillo binary (arma_binary), denoted by .bin
  *  - HDF5 (hdf5_binary), denoted by .hdf5, .hdf, .h5, or .he5
+ *  - mlpack mapped matrix format (see SaveMapped()), denoted by .mapped
+ *
+ * CSV and raw ASCII files of integers, floats and doubles are formatted in
+ * parallel (see WriteText()), with enough digits to be read back exactly.  A
+ * .mapped file is compact, and can be memory-mapped with MappedMatrix; it holds
+ * one point per column, so the matrix is only transposed for it if transpose
+ * is false.
  *
  * If the file extension is not one of those types, an error will be given.  If
  * the 'fatal' parameter is set to true, an error will cause the program to
@@ -51,6 +58,31 @@ bool Save(const std::string& filename,
           bool fatal = false,
           bool transpose = true);
 
+/**
+ * Saves a sparse matrix to file.  If the file has a .bin or .mapped extension,
+ * the matrix is saved in the mlpack sparse matrix format (see SaveMapped()),
+ * which data::Load() reads without any parsing; otherwise it is saved as a
+ * coordinate list (see data::Load()), with one line for each nonzero element,
+ * holding its row index, its column index and its value, separated by commas
+ * if the file has a .csv extension and by spaces otherwise.
+ *
+ * As for dense matrices, the matrix is transposed at save time if transpose is
+ * true, so each point (column) of the matrix is a row of the file's matrix.
+ * (The mlpack sparse matrix format holds one point per column, so the matrix
+ * is only transposed for it if transpose is false.)
+ *
+ * @param filename Name of file to save to.
+ * @param matrix Sparse matrix to save into file.
+ * @param fatal If an error should be reported as fatal (default false).
+ * @param transpose If true, transpose the matrix before saving.
+ * @return Boolean value indicating success or failure of save.
+ */
+template<typename eT>
+bool Save(const std::string& filename,
+          const arma::SpMat<eT>& matrix,
+          bool fatal = false,
+          bool transpose = true);
+
 }; // namespace data
 }; // namespace mlpack
 
@@ -10,6 +10,13 @@
 // In case it hasn't already been included.
 #include "save.hpp"
 
+#include "mapped_matrix.hpp"
+#include "write_text.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
 namespace mlpack {
 namespace data {
 
@@ -39,6 +46,15 @@ bool Save(const std::string& filename,
   // Get the actual extension.
   std::string extension = filename.substr(ext + 1);
 
+  // The mapped matrix format holds one point per column.
+  if (extension == "mapped")
+  {
+    const bool success = transpose ? SaveMapped(filename, matrix, fatal) :
+        SaveMapped(filename, arma::Mat<eT>(trans(matrix)), fatal);
+    Timer::Stop("saving_data");
+    return success;
+  }
+
   // Catch errors opening the file.
   std::fstream stream;
   stream.open(filename.c_str(), std::fstream::out);
@@ -125,6 +141,24 @@ bool Save(const std::string& filename,
   Log::Info << "Saving " << stringType << " to '" << filename << "'."
       << std::endl;
 
+  // Numeric text is written in parallel, without transposing the matrix.
+  if ((saveType == arma::csv_ascii || saveType == arma::raw_ascii) &&
+      WriteText(stream, matrix, (saveType == arma::csv_ascii), transpose))
+  {
+    Timer::Stop("saving_data");
+    if (!stream.good())
+    {
+      if (fatal)
+        Log::Fatal << "Save to '" << filename << "' failed." << std::endl;
+      else
+        Log::Warn << "Save to '" << filename << "' failed." << std::endl;
+
+      return false;
+    }
+
+    return true;
+  }
+
   // Transpose the matrix.
   if (transpose)
   {
@@ -161,6 +195,76 @@ bool Save(const std::string& filename,
   return true;
 }
 
+template<typename eT>
+bool Save(const std::string& filename,
+          const arma::SpMat<eT>& matrix,
+          bool fatal,
+          bool transpose)
+{
+  Timer::Start("saving_data");
+
+  const size_t ext = filename.rfind('.');
+  std::string extension = (ext == std::string::npos) ? "" :
+      filename.substr(ext + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+      ::tolower);
+
+  if (extension == "bin" || extension == "mapped")
+  {
+    // The sparse matrix format holds one point per column.
+    const bool success = transpose ? SaveMapped(filename, matrix, fatal) :
+        SaveMapped(filename, arma::SpMat<eT>(arma::trans(matrix)), fatal);
+    Timer::Stop("saving_data");
+    return success;
+  }
+
+  std::fstream stream;
+  stream.open(filename.c_str(), std::fstream::out);
+
+  if (!stream.is_open())
+  {
+    Timer::Stop("saving_data");
+    if (fatal)
+      Log::Fatal << "Cannot open file '" << filename << "' for writing. "
+          << "Save failed." << std::endl;
+    else
+      Log::Warn << "Cannot open file '" << filename << "' for writing; save "
+          << "failed." << std::endl;
+
+    return false;
+  }
+
+  Log::Info << "Saving coordinate list to '" << filename << "'." << std::endl;
+
+  // Write enough digits for the values to be read back exactly.
+  const char separator = (extension == "csv") ? ',' : ' ';
+  stream.precision(std::numeric_limits<eT>::digits10 + 2);
+  for (size_t c = 0; c < matrix.n_cols; ++c)
+  {
+    for (size_t j = matrix.col_ptrs[c]; j < matrix.col_ptrs[c + 1]; ++j)
+    {
+      const size_t r = matrix.row_indices[j];
+      stream << (transpose ? c : r) << separator << (transpose ? r : c)
+          << separator << matrix.values[j] << '\n';
+    }
+  }
+
+  if (!stream.good())
+  {
+    Timer::Stop("saving_data");
+    if (fatal)
+      Log::Fatal << "Save to '" << filename << "' failed." << std::endl;
+    else
+      Log::Warn << "Save to '" << filename << "' failed." << std::endl;
+
+    return false;
+  }
+
+  Timer::Stop("saving_data");
+
+  return true;
+}
+
 }; // namespace data
 }; // namespace mlpack
 
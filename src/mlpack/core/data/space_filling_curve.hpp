@@ -0,0 +1,98 @@
+/**
+ * @file space_filling_curve.hpp
+ *
+ * Functions to order the points of a dataset along a space-filling curve (the
+ * Morton or Hilbert curve), so that points which are close together in space
+ * are also close together in memory, and to map results computed on the
+ * reordered points back to the original order.
+ */
+#ifndef __MLPACK_CORE_DATA_SPACE_FILLING_CURVE_HPP
+#define __MLPACK_CORE_DATA_SPACE_FILLING_CURVE_HPP
+
+#include <mlpack/prereqs.hpp>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Compute the order of the points (columns) of the given dataset along the
+ * Morton (Z-order) curve.  Each dimension is scaled to the bounding box of the
+ * data and quantized to the given number of bits, and the points are sorted by
+ * the interleaved bits of their coordinates.  After the call, oldFromNew[i] is
+ * the index of the point which comes i'th along the curve, as with the
+ * mappings returned by the trees.
+ *
+ * @param data Dataset to order.
+ * @param oldFromNew Vector to store the order of the points in.
+ * @param bitsPerDimension Number of bits to quantize each dimension to (at most
+ *     32); if 0, 64 bits are divided between the dimensions, with at most 16
+ *     and at least 1 bit per dimension.
+ */
+template<typename eT>
+void MortonOrder(const arma::Mat<eT>& data,
+                 std::vector<size_t>& oldFromNew,
+                 const size_t bitsPerDimension = 0);
+
+/**
+ * Compute the order of the points (columns) of the given dataset along the
+ * Hilbert curve.  This is like MortonOrder(), but consecutive cells of the
+ * Hilbert curve are always adjacent, so the curve does not jump across the
+ * space as the Morton curve does, and neighboring points are usually closer
+ * together in the order.  The Hilbert index of each point is computed with
+ * Skilling's transform (J. Skilling, "Programming the Hilbert curve", 2004).
+ *
+ * @param data Dataset to order.
+ * @param oldFromNew Vector to store the order of the points in.
+ * @param bitsPerDimension Number of bits to quantize each dimension to (at most
+ *     32); if 0, 64 bits are divided between the dimensions, with at most 16
+ *     and at least 1 bit per dimension.
+ */
+template<typename eT>
+void HilbertOrder(const arma::Mat<eT>& data,
+                  std::vector<size_t>& oldFromNew,
+                  const size_t bitsPerDimension = 0);
+
+/**
+ * Rearrange the columns of the given matrix in the given order, so that column
+ * i of the result is column oldFromNew[i] of the input.
+ *
+ * @param data Matrix to rearrange.
+ * @param oldFromNew Original index of each column of the result.
+ */
+template<typename eT>
+void ReorderColumns(arma::Mat<eT>& data, const std::vector<size_t>& oldFromNew);
+
+/**
+ * Put the columns of the given matrix, which were computed for points
+ * rearranged with ReorderColumns() (for instance, the neighbors or distances
+ * of rearranged query points), back in the original order of the points: column
+ * i of the input becomes column oldFromNew[i] of the result.
+ *
+ * @param results Matrix of results, one column per rearranged point.
+ * @param oldFromNew Original index of each rearranged point.
+ */
+template<typename eT>
+void UnmapColumns(arma::Mat<eT>& results,
+                  const std::vector<size_t>& oldFromNew);
+
+/**
+ * Replace each index in the given matrix, which refers to a point of a
+ * rearranged dataset (for instance, the neighbors found among rearranged
+ * reference points), by the original index of that point.  Indices which are
+ * not less than the number of points (such as the index returned for a
+ * neighbor which was not found) are left as they are.
+ *
+ * @param indices Matrix of indices into the rearranged dataset.
+ * @param oldFromNew Original index of each rearranged point.
+ */
+template<typename eT>
+void UnmapIndices(arma::Mat<eT>& indices,
+                  const std::vector<size_t>& oldFromNew);
+
+}; // namespace data
+}; // namespace mlpack
+
+// Include implementation.
+#include "space_filling_curve_impl.hpp"
+
+#endif
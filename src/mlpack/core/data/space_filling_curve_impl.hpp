@@ -0,0 +1,228 @@
+/**
+ * @file space_filling_curve_impl.hpp
+ *
+ * Implementation of the functions which order a dataset along a space-filling
+ * curve.
+ */
+#ifndef __MLPACK_CORE_DATA_SPACE_FILLING_CURVE_IMPL_HPP
+#define __MLPACK_CORE_DATA_SPACE_FILLING_CURVE_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "space_filling_curve.hpp"
+
+#include <mlpack/core/util/log.hpp>
+#include <mlpack/core/util/parallel.hpp>
+#include <algorithm>
+
+namespace mlpack {
+namespace data {
+
+namespace aux {
+
+//! Orders the indices of points by their keys (which are the given number of
+//! words long, most significant word first), then by their index.
+class CurveKeyLess
+{
+ public:
+  CurveKeyLess(const std::vector<uint64_t>& keys, const size_t words) :
+      keys(keys), words(words) { }
+
+  bool operator()(const size_t a, const size_t b) const
+  {
+    for (size_t w = 0; w < words; ++w)
+    {
+      const uint64_t keyA = keys[a * words + w];
+      const uint64_t keyB = keys[b * words + w];
+      if (keyA != keyB)
+        return keyA < keyB;
+    }
+
+    return a < b;
+  }
+
+ private:
+  const std::vector<uint64_t>& keys;
+  const size_t words;
+};
+
+/**
+ * Transform the quantized coordinates of a point (of the given number of bits
+ * each) in place, so that interleaving their bits, as for the Morton curve,
+ * gives the Hilbert index of the point.  This is the AxesToTranspose()
+ * function of Skilling (2004).
+ */
+inline void HilbertTranspose(std::vector<uint32_t>& x, const size_t bits)
+{
+  const size_t d = x.size();
+  const uint32_t top = uint32_t(1) << (bits - 1);
+
+  // Undo the excess work of the Gray code.
+  for (uint32_t q = top; q > 1; q >>= 1)
+  {
+    const uint32_t p = q - 1;
+    for (size_t i = 0; i < d; ++i)
+    {
+      if (x[i] & q)
+      {
+        x[0] ^= p; // Invert.
+      }
+      else
+      {
+        const uint32_t t = (x[0] ^ x[i]) & p; // Exchange.
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+    }
+  }
+
+  // Gray encode.
+  for (size_t i = 1; i < d; ++i)
+    x[i] ^= x[i - 1];
+
+  uint32_t t = 0;
+  for (uint32_t q = top; q > 1; q >>= 1)
+    if (x[d - 1] & q)
+      t ^= q - 1;
+
+  for (size_t i = 0; i < d; ++i)
+    x[i] ^= t;
+}
+
+/**
+ * Order the points of the dataset along the Morton or Hilbert curve: compute
+ * the key of each point (in parallel, if OpenMP is available), then sort the
+ * indices of the points by their keys.
+ */
+template<typename eT>
+void CurveOrder(const arma::Mat<eT>& data,
+                std::vector<size_t>& oldFromNew,
+                const size_t bitsPerDimension,
+                const bool hilbert)
+{
+  const size_t d = data.n_rows;
+  const size_t n = data.n_cols;
+
+  oldFromNew.resize(n);
+  for (size_t i = 0; i < n; ++i)
+    oldFromNew[i] = i;
+
+  if (d == 0 || n < 2)
+    return;
+
+  if (bitsPerDimension > 32)
+  {
+    Log::Fatal << "Cannot quantize each dimension to " << bitsPerDimension
+        << " bits; at most 32 bits are allowed." << std::endl;
+  }
+
+  const size_t bits = (bitsPerDimension != 0) ? bitsPerDimension :
+      std::max((size_t) 1, std::min((size_t) 16, 64 / d));
+  const size_t words = (d * bits + 63) / 64;
+
+  // Scale each dimension so that the bounding box is divided into 2^bits cells
+  // along it.
+  const double cells = std::pow(2.0, (double) bits);
+  const arma::Col<eT> minima = arma::min(data, 1);
+  const arma::Col<eT> maxima = arma::max(data, 1);
+  arma::vec scales(d);
+  for (size_t j = 0; j < d; ++j)
+  {
+    const double range = (double) maxima[j] - (double) minima[j];
+    scales[j] = (range > 0.0) ? cells / range : 0.0;
+  }
+
+  std::vector<uint64_t> keys(n * words, 0);
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  #pragma omp parallel num_threads(threads) if(threads > 1)
+  {
+    std::vector<uint32_t> coords(d);
+
+    #pragma omp for schedule(static)
+    for (size_t i = 0; i < n; ++i)
+    {
+      for (size_t j = 0; j < d; ++j)
+      {
+        const double cell = ((double) data(j, i) - (double) minima[j]) *
+            scales[j];
+        coords[j] = (cell >= cells - 1.0) ? (uint32_t) (cells - 1.0) :
+            (uint32_t) cell;
+      }
+
+      if (hilbert)
+        HilbertTranspose(coords, bits);
+
+      // Interleave the bits of the coordinates, most significant first.
+      uint64_t* key = &keys[i * words];
+      size_t position = 0;
+      for (size_t level = bits; level-- > 0; )
+      {
+        for (size_t j = 0; j < d; ++j, ++position)
+        {
+          if ((coords[j] >> level) & 1)
+            key[position / 64] |= uint64_t(1) << (63 - position % 64);
+        }
+      }
+    }
+  }
+
+  std::sort(oldFromNew.begin(), oldFromNew.end(), CurveKeyLess(keys, words));
+}
+
+}; // namespace aux
+
+template<typename eT>
+void MortonOrder(const arma::Mat<eT>& data,
+                 std::vector<size_t>& oldFromNew,
+                 const size_t bitsPerDimension)
+{
+  aux::CurveOrder(data, oldFromNew, bitsPerDimension, false);
+}
+
+template<typename eT>
+void HilbertOrder(const arma::Mat<eT>& data,
+                  std::vector<size_t>& oldFromNew,
+                  const size_t bitsPerDimension)
+{
+  aux::CurveOrder(data, oldFromNew, bitsPerDimension, true);
+}
+
+template<typename eT>
+void ReorderColumns(arma::Mat<eT>& data, const std::vector<size_t>& oldFromNew)
+{
+  arma::Mat<eT> reordered(data.n_rows, data.n_cols);
+  for (size_t i = 0; i < oldFromNew.size(); ++i)
+    reordered.col(i) = data.col(oldFromNew[i]);
+
+  data.swap(reordered);
+}
+
+template<typename eT>
+void UnmapColumns(arma::Mat<eT>& results,
+                  const std::vector<size_t>& oldFromNew)
+{
+  arma::Mat<eT> unmapped(results.n_rows, results.n_cols);
+  for (size_t i = 0; i < oldFromNew.size(); ++i)
+    unmapped.col(oldFromNew[i]) = results.col(i);
+
+  results.swap(unmapped);
+}
+
+template<typename eT>
+void UnmapIndices(arma::Mat<eT>& indices,
+                  const std::vector<size_t>& oldFromNew)
+{
+  for (size_t i = 0; i < indices.n_elem; ++i)
+    if ((size_t) indices[i] < oldFromNew.size())
+      indices[i] = (eT) oldFromNew[(size_t) indices[i]];
+}
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,673 @@
+/**
+ * @file streaming_reader.cpp
+ *
+ * Implementation of the StreamingReader class.
+ */
+#include "streaming_reader.hpp"
+#include "detect_file_type.hpp"
+#include "hdf5_columns.hpp"
+#include "load.hpp"
+#include "mapped_matrix.hpp"
+#include "parse_text.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+  #include <pthread.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::data;
+
+/**
+ * A source of blocks of points.  Sources do not issue errors themselves, since
+ * they may be used from the prefetching thread; instead, Read() returns a
+ * message, and StreamingReader issues the error.
+ */
+class StreamingReader::Source
+{
+ public:
+  virtual ~Source() { }
+
+  /**
+   * Read the next block of at most blockSize points into block.
+   *
+   * @return false if there are no more points (if error is empty) or if the
+   *     block could not be read (and then error is set).
+   */
+  virtual bool Read(arma::mat& block,
+                    const size_t blockSize,
+                    std::string& error) = 0;
+
+  //! Go back to the first point.
+  virtual void Rewind() = 0;
+
+  //! Get the dimensionality of the points.
+  size_t Dimensionality() const { return dimensionality; }
+
+ protected:
+  //! The dimensionality of the points.
+  size_t dimensionality;
+};
+
+/**
+ * Read CSV or raw ASCII files, with one point per non-blank line.
+ */
+class StreamingReader::TextSource : public StreamingReader::Source
+{
+ public:
+  TextSource(const std::string& filename, const bool csv) :
+      filename(filename),
+      csv(csv),
+      stream(filename.c_str(), std::ios::in | std::ios::binary),
+      lineNumber(0)
+  {
+    if (!stream.is_open())
+      Log::Fatal << "Cannot open file '" << filename << "'." << std::endl;
+
+    // The dimensionality is given by the first non-blank line.
+    dimensionality = 0;
+    std::string line;
+    while (dimensionality == 0 && std::getline(stream, line))
+    {
+      const char* pos = line.data();
+      dimensionality = text::ParseLine(pos, pos + line.size(), csv,
+          (double*) NULL, 0, 0);
+      if (dimensionality == size_t(-1))
+      {
+        Log::Fatal << "Cannot parse the first line of '" << filename << "'."
+            << std::endl;
+      }
+    }
+
+    Rewind();
+  }
+
+  bool Read(arma::mat& block, const size_t blockSize, std::string& error)
+  {
+    block.set_size(dimensionality, blockSize);
+    size_t points = 0;
+    std::string line;
+    while (points < blockSize && std::getline(stream, line))
+    {
+      ++lineNumber;
+      const char* pos = line.data();
+      const char* end = pos + line.size();
+      if (text::BlankLine(pos, end))
+        continue;
+
+      const size_t count = text::ParseLine(pos, end, csv, block.colptr(points),
+          1, dimensionality);
+      if (count != dimensionality)
+      {
+        std::ostringstream message;
+        message << "Line " << lineNumber << " of '" << filename << "' ";
+        if (count == size_t(-1))
+          message << "cannot be parsed.";
+        else
+          message << "has " << count << " values; expected " << dimensionality
+              << ".";
+
+        error = message.str();
+        return false;
+      }
+
+      ++points;
+    }
+
+    if (points == 0)
+      return false;
+
+    if (points < blockSize)
+      block.resize(dimensionality, points);
+
+    return true;
+  }
+
+  void Rewind()
+  {
+    stream.clear();
+    stream.seekg(0, std::ios::beg);
+    lineNumber = 0;
+  }
+
+ private:
+  //! The name of the file.
+  std::string filename;
+  //! Whether values are separated by commas.
+  bool csv;
+  //! The file.
+  std::ifstream stream;
+  //! The number of the last line read.
+  size_t lineNumber;
+};
+
+/**
+ * Read Armadillo binary files and mlpack mapped matrix files of doubles, a
+ * block at a time.
+ */
+class StreamingReader::BinarySource : public StreamingReader::Source
+{
+ public:
+  BinarySource(const std::string& filename, const bool transpose) :
+      filename(filename),
+      transpose(transpose),
+      stream(filename.c_str(), std::ios::in | std::ios::binary),
+      position(0)
+  {
+    if (!stream.is_open())
+      Log::Fatal << "Cannot open file '" << filename << "'." << std::endl;
+
+    // The header gives the size of the stored matrix, and where its elements
+    // begin.
+    char magic[8];
+    stream.read(magic, 8);
+    if (stream.good() && memcmp(magic, mapped_matrix::MappedMagic, 8) == 0)
+    {
+      uint64_t header[mapped_matrix::MappedHeaderSize];
+      stream.seekg(0, std::ios::beg);
+      stream.read((char*) header, sizeof(header));
+      if (!stream.good())
+      {
+        Log::Fatal << "Cannot read the header of '" << filename << "'."
+            << std::endl;
+      }
+
+      if (header[mapped_matrix::ElemTypeField] !=
+          mapped_matrix::ElemTypeCode<double>())
+      {
+        Log::Fatal << "The matrix in '" << filename << "' does not hold "
+            << "doubles; only double-precision binary files can be streamed."
+            << std::endl;
+      }
+
+      rows = header[mapped_matrix::RowsField];
+      cols = header[mapped_matrix::ColsField];
+      offset = sizeof(header);
+    }
+    else
+    {
+      // An Armadillo binary file: one line with the type, one line with the
+      // size, and then the elements.
+      stream.clear();
+      stream.seekg(0, std::ios::beg);
+
+      std::string type;
+      stream >> type;
+      if (type.compare(0, 13, "ARMA_MAT_BIN_") != 0)
+      {
+        Log::Fatal << "'" << filename << "' is not an Armadillo binary or "
+            << "mlpack mapped matrix file; raw binary files cannot be "
+            << "streamed, because the size of the matrix is unknown."
+            << std::endl;
+      }
+
+      if (type != mapped_matrix::ArmaHeader<double>())
+      {
+        Log::Fatal << "The matrix in '" << filename << "' does not hold "
+            << "doubles (its type is '" << type << "'); only "
+            << "double-precision binary files can be streamed." << std::endl;
+      }
+
+      stream >> rows >> cols;
+      stream.get(); // The newline after the size.
+      if (!stream.good())
+      {
+        Log::Fatal << "Cannot read the header of '" << filename << "'."
+            << std::endl;
+      }
+
+      offset = stream.tellg();
+    }
+
+    stream.seekg(0, std::ios::end);
+    const std::streamoff size = stream.tellg();
+    if (size < offset + std::streamoff(rows * cols * sizeof(double)))
+    {
+      Log::Fatal << "File '" << filename << "' is truncated: it should hold a "
+          << rows << 'x' << cols << " matrix." << std::endl;
+    }
+
+    dimensionality = transpose ? cols : rows;
+    points = transpose ? rows : cols;
+  }
+
+  bool Read(arma::mat& block, const size_t blockSize, std::string& error)
+  {
+    if (position >= points)
+      return false;
+
+    const size_t count = std::min(blockSize, points - position);
+    if (transpose)
+    {
+      // Each point is a row of the stored matrix, so read the part of each
+      // column that holds the points of the block.
+      arma::mat storedRows(count, dimensionality);
+      for (size_t j = 0; j < dimensionality; ++j)
+      {
+        stream.seekg(offset + std::streamoff((j * rows + position) *
+            sizeof(double)), std::ios::beg);
+        stream.read((char*) storedRows.colptr(j), count * sizeof(double));
+      }
+
+      block = trans(storedRows);
+    }
+    else
+    {
+      block.set_size(dimensionality, count);
+      stream.seekg(offset + std::streamoff(position * rows * sizeof(double)),
+          std::ios::beg);
+      stream.read((char*) block.memptr(), block.n_elem * sizeof(double));
+    }
+
+    if (!stream.good())
+    {
+      error = "Error while reading '" + filename + "'.";
+      return false;
+    }
+
+    position += count;
+    return true;
+  }
+
+  void Rewind()
+  {
+    stream.clear();
+    position = 0;
+  }
+
+ private:
+  //! The name of the file.
+  std::string filename;
+  //! Whether each point is a row of the stored matrix.
+  bool transpose;
+  //! The file.
+  std::ifstream stream;
+  //! The number of rows of the stored matrix.
+  size_t rows;
+  //! The number of columns of the stored matrix.
+  size_t cols;
+  //! The position of the elements in the file.
+  std::streamoff offset;
+  //! The number of points.
+  size_t points;
+  //! The index of the next point to read.
+  size_t position;
+};
+
+#ifdef ARMA_USE_HDF5
+
+/**
+ * Read HDF5 files a block at a time, through hyperslab selections of the
+ * columns of the loaded matrix.
+ */
+class StreamingReader::HDF5Source : public StreamingReader::Source
+{
+ public:
+  HDF5Source(const std::string& filename, const bool transpose) :
+      filename(filename),
+      transpose(transpose),
+      position(0)
+  {
+    size_t rows, cols;
+    std::string error;
+    if (!HDF5MatrixSize(filename, rows, cols, error))
+    {
+      Log::Fatal << "Cannot read '" << filename << "': " << error << "."
+          << std::endl;
+    }
+
+    dimensionality = transpose ? cols : rows;
+    points = transpose ? rows : cols;
+  }
+
+  bool Read(arma::mat& block, const size_t blockSize, std::string& error)
+  {
+    if (position >= points)
+      return false;
+
+    const size_t count = std::min(blockSize, points - position);
+    arma::Col<size_t> columns(count);
+    for (size_t i = 0; i < count; ++i)
+      columns[i] = position + i;
+
+    if (!LoadHDF5Columns(filename, block, columns, transpose, error))
+    {
+      error = "Cannot read '" + filename + "': " + error + ".";
+      return false;
+    }
+
+    position += count;
+    return true;
+  }
+
+  void Rewind() { position = 0; }
+
+ private:
+  //! The name of the file.
+  std::string filename;
+  //! Whether the stored matrix is transposed.
+  bool transpose;
+  //! The number of points in the file.
+  size_t points;
+  //! The index of the next point to read.
+  size_t position;
+};
+
+#endif
+
+/**
+ * Return the blocks of a matrix that is loaded completely, for files that
+ * Armadillo can only read as a whole.
+ */
+class StreamingReader::MatrixSource : public StreamingReader::Source
+{
+ public:
+  MatrixSource(const std::string& filename, const bool transpose) :
+      position(0)
+  {
+    Load(filename, matrix, true, transpose);
+    dimensionality = matrix.n_rows;
+  }
+
+  bool Read(arma::mat& block, const size_t blockSize, std::string& /* error */)
+  {
+    if (position >= matrix.n_cols)
+      return false;
+
+    const size_t count = std::min(blockSize, matrix.n_cols - position);
+    block = matrix.cols(position, position + count - 1);
+    position += count;
+    return true;
+  }
+
+  void Rewind() { position = 0; }
+
+ private:
+  //! The whole dataset.
+  arma::mat matrix;
+  //! The index of the next point to return.
+  size_t position;
+};
+
+#ifndef _WIN32
+
+/**
+ * A background thread that reads the next block from the source while the
+ * current block is in use.  The thread starts reading as soon as the block it
+ * read last has been taken (or the source has been rewound); at the end of the
+ * data (or after an error), it waits until the source is rewound.
+ */
+struct StreamingReader::Prefetcher
+{
+  Prefetcher(Source& source, const size_t blockSize) :
+      source(source),
+      blockSize(blockSize),
+      started(false),
+      stop(false),
+      reading(false),
+      full(false),
+      hasBlock(false)
+  {
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+  }
+
+  ~Prefetcher()
+  {
+    if (started)
+    {
+      pthread_mutex_lock(&mutex);
+      stop = true;
+      pthread_cond_broadcast(&cond);
+      pthread_mutex_unlock(&mutex);
+      pthread_join(thread, NULL);
+    }
+
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+  }
+
+  //! Start the thread; return false if it cannot be started.
+  bool Start()
+  {
+    started = (pthread_create(&thread, NULL, &Prefetcher::Run, this) == 0);
+    return started;
+  }
+
+  //! Take the next block, waiting for it if necessary (as Source::Read()).
+  bool Next(arma::mat& block, std::string& blockError)
+  {
+    pthread_mutex_lock(&mutex);
+    while (!full)
+      pthread_cond_wait(&cond, &mutex);
+
+    // At the end of the data, or after an error, the state is kept until the
+    // source is rewound.
+    const bool result = hasBlock;
+    if (hasBlock)
+    {
+      block.steal_mem(pending);
+      hasBlock = false;
+      full = false;
+      pthread_cond_broadcast(&cond);
+    }
+    else
+    {
+      blockError = error;
+    }
+
+    pthread_mutex_unlock(&mutex);
+    return result;
+  }
+
+  //! Rewind the source, dropping any block that was read already.
+  void Reset()
+  {
+    pthread_mutex_lock(&mutex);
+    while (reading)
+      pthread_cond_wait(&cond, &mutex);
+
+    source.Rewind();
+    pending.reset();
+    error.clear();
+    hasBlock = false;
+    full = false;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+  }
+
+  //! The body of the thread.
+  static void* Run(void* prefetcherPtr)
+  {
+    Prefetcher& p = *((Prefetcher*) prefetcherPtr);
+
+    pthread_mutex_lock(&p.mutex);
+    while (true)
+    {
+      while (!p.stop && p.full)
+        pthread_cond_wait(&p.cond, &p.mutex);
+      if (p.stop)
+        break;
+
+      p.reading = true;
+      pthread_mutex_unlock(&p.mutex);
+
+      arma::mat block;
+      std::string blockError;
+      const bool read = p.source.Read(block, p.blockSize, blockError);
+
+      pthread_mutex_lock(&p.mutex);
+      p.reading = false;
+      p.full = true;
+      p.hasBlock = read;
+      if (read)
+        p.pending.steal_mem(block);
+      else
+        p.error = blockError;
+      pthread_cond_broadcast(&p.cond);
+    }
+    pthread_mutex_unlock(&p.mutex);
+
+    return NULL;
+  }
+
+  //! The source to read from.
+  Source& source;
+  //! The maximum number of points in a block.
+  size_t blockSize;
+
+  //! The thread.
+  pthread_t thread;
+  //! The mutex protecting everything below.
+  pthread_mutex_t mutex;
+  //! Signalled whenever the state changes.
+  pthread_cond_t cond;
+
+  //! Whether the thread was started.
+  bool started;
+  //! Whether the thread should stop.
+  bool stop;
+  //! Whether the thread is reading a block.
+  bool reading;
+  //! Whether a block, or the end of the data, or an error, is waiting.
+  bool full;
+  //! Whether pending holds a block.
+  bool hasBlock;
+  //! The block that was read.
+  arma::mat pending;
+  //! The error message, if the block could not be read.
+  std::string error;
+};
+
+#else
+
+//! Prefetching is not available without POSIX threads.
+struct StreamingReader::Prefetcher
+{
+  bool Next(arma::mat& /* block */, std::string& /* error */) { return false; }
+  void Reset() { }
+};
+
+#endif
+
+StreamingReader::StreamingReader(const std::string& filename,
+                                 const size_t blockSize,
+                                 const bool transpose,
+                                 const bool prefetch) :
+    filename(filename),
+    blockSize(blockSize),
+    source(NULL),
+    prefetcher(NULL)
+{
+  if (blockSize == 0)
+    Log::Fatal << "The block size must be positive." << std::endl;
+
+  std::fstream stream(filename.c_str(), std::fstream::in);
+  if (!stream.is_open())
+    Log::Fatal << "Cannot open file '" << filename << "'." << std::endl;
+
+  std::string stringType;
+  const arma::file_type type = DetectFileType(filename, stream, stringType);
+  stream.close();
+
+  switch (type)
+  {
+    case arma::csv_ascii:
+    case arma::raw_ascii:
+      if (!transpose)
+      {
+        Log::Fatal << "Cannot stream '" << filename << "' without transposing "
+            << "it: each line of a text file must be a point." << std::endl;
+      }
+
+      source = new TextSource(filename, (type == arma::csv_ascii));
+      break;
+
+    case arma::arma_binary:
+    case arma::raw_binary:
+      source = new BinarySource(filename, transpose);
+      break;
+
+#ifdef ARMA_USE_HDF5
+    case arma::hdf5_binary:
+      source = new HDF5Source(filename, transpose);
+      break;
+#endif
+
+    case arma::file_type_unknown:
+      Log::Fatal << "Unable to detect type of '" << filename << "'; "
+          << "incorrect extension?" << std::endl;
+      break;
+
+    default:
+      Log::Warn << "'" << filename << "' (" << stringType << ") cannot be "
+          << "read in parts; loading all of it." << std::endl;
+      source = new MatrixSource(filename, transpose);
+      break;
+  }
+
+  Log::Info << "Streaming '" << filename << "' (" << stringType << ") in blocks "
+      << "of " << blockSize << " points of dimensionality "
+      << source->Dimensionality() << "." << std::endl;
+
+#ifndef _WIN32
+  if (prefetch)
+  {
+    prefetcher = new Prefetcher(*source, blockSize);
+    if (!prefetcher->Start())
+    {
+      Log::Warn << "Cannot start the prefetching thread; blocks of '"
+          << filename << "' will be read when they are requested." << std::endl;
+      delete prefetcher;
+      prefetcher = NULL;
+    }
+  }
+#else
+  (void) prefetch;
+#endif
+}
+
+StreamingReader::~StreamingReader()
+{
+  // The prefetching thread uses the source, so it must be stopped first.
+  delete prefetcher;
+  delete source;
+}
+
+bool StreamingReader::NextBlock(arma::mat& block)
+{
+  std::string error;
+  bool read;
+  if (prefetcher != NULL)
+  {
+    read = prefetcher->Next(block, error);
+  }
+  else
+  {
+    arma::mat next;
+    read = source->Read(next, blockSize, error);
+    if (read)
+      block.steal_mem(next);
+  }
+
+  if (!read && !error.empty())
+    Log::Fatal << error << std::endl;
+
+  return read;
+}
+
+void StreamingReader::Reset()
+{
+  if (prefetcher != NULL)
+    prefetcher->Reset();
+  else
+    source->Rewind();
+}
+
+size_t StreamingReader::Dimensionality() const
+{
+  return source->Dimensionality();
+}
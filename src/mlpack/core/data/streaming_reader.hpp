@@ -0,0 +1,127 @@
+/**
+ * @file streaming_reader.hpp
+ *
+ * Declaration of the StreamingReader class, which reads a dataset from a file
+ * in blocks of points, for algorithms that do not need the whole dataset in
+ * memory at once.
+ */
+#ifndef __MLPACK_CORE_DATA_STREAMING_READER_HPP
+#define __MLPACK_CORE_DATA_STREAMING_READER_HPP
+
+#include <mlpack/core/util/log.hpp>
+#include <mlpack/core/arma_extend/arma_extend.hpp> // Includes Armadillo.
+#include <string>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Read a dataset from a file in blocks of at most a given number of points,
+ * so that out-of-core algorithms can make one or more passes over datasets
+ * that do not fit in memory.  Each block is a matrix with one point per
+ * column, exactly as the corresponding columns of the matrix loaded by
+ * data::Load(filename, matrix, true, transpose) would be.
+ *
+ * The type of the file is detected as data::Load() does it (see
+ * DetectFileType()):
+ *
+ *  - CSV and raw ASCII files are read line by line, and each (non-blank) line
+ *    is one point, so transpose must be true;
+ *  - Armadillo binary files, and files in the mlpack mapped matrix format (see
+ *    SaveMapped()) with a .bin extension, are read a block at a time; if
+ *    transpose is true, each row of the stored matrix is a point (this is what
+ *    data::Save() writes by default);
+ *  - HDF5 files are read a block at a time through hyperslab selections (see
+ *    LoadHDF5Columns()), if Armadillo was compiled with HDF5 support;
+ *  - other files (Armadillo ASCII, PGM) cannot be read in parts through
+ *    Armadillo, so they are loaded completely with data::Load() and then
+ *    returned in blocks.
+ *
+ * If prefetching is enabled, the next block is read by a background thread
+ * while the current block is in use.  (Prefetching is not available on
+ * Windows, where blocks are always read when they are requested.)
+ *
+ * A fatal error is issued (see Log::Fatal) if the file cannot be opened, its
+ * type is not supported, or it is malformed (such as a line with the wrong
+ * number of values).
+ *
+ * @code
+ * data::StreamingReader reader("dataset.csv", 10000);
+ * arma::mat block;
+ * while (reader.NextBlock(block))
+ * {
+ *   // Process the points in block.
+ * }
+ * @endcode
+ */
+class StreamingReader
+{
+ public:
+  /**
+   * Open the given file for reading in blocks.
+   *
+   * @param filename Name of the file to read.
+   * @param blockSize Maximum number of points in each block.
+   * @param transpose If true, the stored matrix is transposed (as in
+   *     data::Load()), so each row of the stored matrix (or each line of a
+   *     text file) is a point.
+   * @param prefetch If true, read the next block in the background while the
+   *     current one is used.
+   */
+  StreamingReader(const std::string& filename,
+                  const size_t blockSize,
+                  const bool transpose = true,
+                  const bool prefetch = true);
+
+  //! Stop prefetching (if necessary) and close the file.
+  ~StreamingReader();
+
+  /**
+   * Get the next block of points.  Every block has BlockSize() points, except
+   * maybe the last.
+   *
+   * @param block Matrix to store the block in (one point per column).
+   * @return false if there are no more points (block is left unchanged).
+   */
+  bool NextBlock(arma::mat& block);
+
+  //! Go back to the first point, in order to make another pass over the data.
+  void Reset();
+
+  //! Get the dimensionality of the points.
+  size_t Dimensionality() const;
+  //! Get the maximum number of points in a block.
+  size_t BlockSize() const { return blockSize; }
+  //! Get the name of the file.
+  const std::string& Filename() const { return filename; }
+
+ private:
+  //! Copying is not allowed.
+  StreamingReader(const StreamingReader& other);
+  //! Copying is not allowed.
+  StreamingReader& operator=(const StreamingReader& other);
+
+  //! A source of blocks of points, and the sources for each kind of file
+  //! (defined in streaming_reader.cpp).
+  class Source;
+  class TextSource;
+  class BinarySource;
+  class HDF5Source;
+  class MatrixSource;
+  //! The state of the background prefetching thread.
+  struct Prefetcher;
+
+  //! The name of the file.
+  std::string filename;
+  //! The maximum number of points in a block.
+  size_t blockSize;
+  //! The source of blocks.
+  Source* source;
+  //! The prefetching thread (NULL if blocks are read when requested).
+  Prefetcher* prefetcher;
+};
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
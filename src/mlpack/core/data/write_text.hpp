@@ -0,0 +1,50 @@
+/**
+ * @file write_text.hpp
+ *
+ * A parallel writer for numeric CSV and raw ASCII files, used by data::Save().
+ */
+#ifndef __MLPACK_CORE_DATA_WRITE_TEXT_HPP
+#define __MLPACK_CORE_DATA_WRITE_TEXT_HPP
+
+#include <mlpack/core/util/parallel.hpp>
+#include <mlpack/core/arma_extend/arma_extend.hpp> // Includes Armadillo.
+#include <ostream>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Write the given matrix to the given stream as CSV or raw ASCII text, with one
+ * line for each column of the matrix if transpose is true (so no transposed
+ * copy is made), and for each row otherwise.  The lines are formatted in
+ * chunks, in parallel (if OpenMP is available), and the chunks are written in
+ * order, a few at a time so that the formatted text never has to be held in
+ * memory at once.
+ *
+ * Integers (and floating-point numbers with an integral value) are formatted
+ * directly; other floating-point numbers are formatted with enough digits (17
+ * for double, 9 for float) to be read back exactly.  If eT is neither an
+ * integral type nor float or double, nothing is written and false is
+ * returned, and the caller should use Armadillo's writer instead.
+ *
+ * @param stream Stream to write to.
+ * @param matrix Matrix to write.
+ * @param csv If true, numbers are separated by commas; otherwise, by spaces.
+ * @param transpose If true, each column of the matrix becomes a line of the
+ *     file; otherwise, each row.
+ * @return Whether the matrix was written (the stream must still be checked
+ *     for errors).
+ */
+template<typename eT>
+bool WriteText(std::ostream& stream,
+               const arma::Mat<eT>& matrix,
+               const bool csv,
+               const bool transpose);
+
+}; // namespace data
+}; // namespace mlpack
+
+// Include implementation.
+#include "write_text_impl.hpp"
+
+#endif
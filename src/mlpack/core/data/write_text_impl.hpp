@@ -0,0 +1,170 @@
+/**
+ * @file write_text_impl.hpp
+ *
+ * Implementation of the parallel text writer used by data::Save().
+ */
+#ifndef __MLPACK_CORE_DATA_WRITE_TEXT_IMPL_HPP
+#define __MLPACK_CORE_DATA_WRITE_TEXT_IMPL_HPP
+
+// In case it hasn't already been included.
+#include "write_text.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+namespace mlpack {
+namespace data {
+namespace text {
+
+//! The number of elements in a chunk that is formatted by one thread.
+static const size_t ChunkElements = 1 << 16;
+
+//! The most characters a formatted element takes, with its separator (and
+//! with room for the terminating null character written by sprintf()).
+static const size_t MaxElementLength = 32;
+
+//! Format the given nonnegative integer at out, and return the number of
+//! characters written.
+inline size_t FormatUnsigned(char* out, uint64_t value)
+{
+  char digits[20];
+  size_t count = 0;
+  do
+  {
+    digits[count++] = char('0' + (value % 10));
+    value /= 10;
+  } while (value != 0);
+
+  for (size_t i = 0; i < count; ++i)
+    out[i] = digits[count - 1 - i];
+  return count;
+}
+
+//! Format the given integer at out, and return the number of characters
+//! written.
+template<typename eT>
+inline size_t FormatInteger(char* out, const eT value)
+{
+  // (value < 1 && value != 0) is written instead of (value < 0), which is
+  // always false for unsigned types and would draw a warning.
+  if (value < eT(1) && value != eT(0))
+  {
+    *out = '-';
+    // Negate in unsigned arithmetic, so the smallest value does not overflow.
+    return 1 + FormatUnsigned(out + 1, uint64_t(0) - uint64_t(value));
+  }
+
+  return FormatUnsigned(out, uint64_t(value));
+}
+
+//! Format the given floating-point number at out with the given number of
+//! significant digits, and return the number of characters written.
+inline size_t FormatReal(char* out, const double value, const int digits)
+{
+  // Integral values (such as labels, or indices stored as doubles) are common,
+  // and much faster to format directly.
+  if (std::fabs(value) < 1e15 && value == std::floor(value))
+    return FormatInteger(out, (int64_t) value);
+
+  // The shortest representation which reads back exactly would need
+  // std::to_chars(), which is C++17; the build uses C++11, so enough digits for
+  // any value are written instead.
+  return (size_t) sprintf(out, "%.*g", digits, value);
+}
+
+//! Format the given element at out, and return the number of characters
+//! written.
+template<typename eT>
+inline size_t FormatElement(char* out, const eT value)
+{
+  if (std::numeric_limits<eT>::is_integer)
+    return FormatInteger(out, value);
+  else if (arma::is_float<eT>::value)
+    return FormatReal(out, double(value), 9);
+  else
+    return FormatReal(out, double(value), 17);
+}
+
+}; // namespace text
+
+template<typename eT>
+bool WriteText(std::ostream& stream,
+               const arma::Mat<eT>& matrix,
+               const bool csv,
+               const bool transpose)
+{
+  using namespace text;
+
+  if (!std::numeric_limits<eT>::is_integer && !arma::is_float<eT>::value &&
+      !arma::is_double<eT>::value)
+    return false;
+
+  const size_t lines = transpose ? matrix.n_cols : matrix.n_rows;
+  const size_t lineLength = transpose ? matrix.n_rows : matrix.n_cols;
+  const char separator = csv ? ',' : ' ';
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  // Each round formats up to four chunks for each thread into their own
+  // buffers, which are then written in order.
+  const size_t chunkLines = std::max(ChunkElements / std::max(lineLength,
+      (size_t) 1), (size_t) 1);
+  const size_t roundChunks = 4 * threads;
+  std::vector<std::string> buffers(roundChunks);
+
+  for (size_t roundBegin = 0; roundBegin < lines;
+       roundBegin += roundChunks * chunkLines)
+  {
+    const size_t chunks = std::min(roundChunks,
+        (lines - roundBegin + chunkLines - 1) / chunkLines);
+
+    #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+        if(threads > 1)
+    for (size_t c = 0; c < chunks; ++c)
+    {
+      const size_t begin = roundBegin + c * chunkLines;
+      const size_t end = std::min(begin + chunkLines, lines);
+
+      std::string& buffer = buffers[c];
+      buffer.resize((end - begin) * (lineLength * MaxElementLength + 1));
+      char* const start = &buffer[0];
+      char* out = start;
+      for (size_t line = begin; line < end; ++line)
+      {
+        for (size_t j = 0; j < lineLength; ++j)
+        {
+          if (j > 0)
+            *out++ = separator;
+          out += FormatElement(out, transpose ? matrix(j, line) :
+              matrix(line, j));
+        }
+
+        *out++ = '\n';
+      }
+
+      buffer.resize(out - start);
+    }
+
+    for (size_t c = 0; c < chunks; ++c)
+      stream.write(buffers[c].data(), buffers[c].size());
+  }
+
+  return true;
+}
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
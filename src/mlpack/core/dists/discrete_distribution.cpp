@@ -9,6 +9,51 @@
 using namespace mlpack;
 using namespace mlpack::distribution;
 
+/**
+ * Look up the value of each observation in the given table.
+ */
+static void LookUp(const arma::vec& table,
+                   const arma::mat& x,
+                   arma::vec& values)
+{
+  values.set_size(x.n_cols);
+  for (size_t i = 0; i < x.n_cols; ++i)
+  {
+    // Adding 0.5 helps ensure that we cast the floating point to a size_t
+    // correctly.
+    const size_t obs = size_t(x(0, i) + 0.5);
+
+    // Ensure that the observation is within the bounds.
+    if (obs >= table.n_elem)
+    {
+      Log::Debug << "DiscreteDistribution::Probability(): received observation "
+          << obs << "; observation must be in [0, " << table.n_elem
+          << "] for this distribution." << std::endl;
+    }
+
+    values[i] = table(obs);
+  }
+}
+
+/**
+ * Calculate the probability of each observation in the given matrix.
+ */
+void DiscreteDistribution::Probability(const arma::mat& x,
+                                       arma::vec& probabilities) const
+{
+  LookUp(this->probabilities, x, probabilities);
+}
+
+/**
+ * Calculate the log-probability of each observation in the given matrix.
+ */
+void DiscreteDistribution::LogProbability(const arma::mat& x,
+                                          arma::vec& logProbabilities) const
+{
+  const arma::vec logTable = arma::log(probabilities);
+  LookUp(logTable, x, logProbabilities);
+}
+
 /**
  * Return a randomly generated observation according to the probability
  * distribution defined by this object.
@@ -34,6 +79,21 @@ arma::vec DiscreteDistribution::Random() const
   return result;
 }
 
+/**
+ * Draw many random observations with an alias table, so that each one takes
+ * constant time.
+ */
+void DiscreteDistribution::Random(const size_t n,
+                                  math::RandomStream& stream,
+                                  arma::mat& observations) const
+{
+  const math::AliasTable table(probabilities);
+
+  observations.set_size(1, n);
+  for (size_t i = 0; i < n; ++i)
+    observations[i] = table.Sample(stream);
+}
+
 /**
  * Estimate the probability distribution directly from the given observations.
  */
@@ -9,6 +9,7 @@
 #define __MLPACK_METHODS_HMM_DISTRIBUTIONS_DISCRETE_DISTRIBUTION_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/dists/distribution_traits.hpp>
 
 namespace mlpack {
 namespace distribution /** Probability distributions. */ {
@@ -104,6 +105,38 @@ class DiscreteDistribution
     return probabilities(obs);
   }
 
+  /**
+   * Return the log-probability of the given observation.  As with
+   * Probability(), bounds checking is not performed.
+   *
+   * @param observation Observation to return the log-probability of.
+   * @return Log-probability of the given observation.
+   */
+  double LogProbability(const arma::vec& observation) const
+  {
+    return std::log(Probability(observation));
+  }
+
+  /**
+   * Calculate the probability of each observation (column) in the given
+   * matrix, by looking up each observation in the table of probabilities.
+   *
+   * @param x List of observations.
+   * @param probabilities Output probabilities for each input observation.
+   */
+  void Probability(const arma::mat& x, arma::vec& probabilities) const;
+
+  /**
+   * Calculate the log-probability of each observation (column) in the given
+   * matrix.  The logs of the probabilities are computed once, and then each
+   * observation is looked up in that table.
+   *
+   * @param x List of observations.
+   * @param logProbabilities Output log-probabilities for each input
+   *     observation.
+   */
+  void LogProbability(const arma::mat& x, arma::vec& logProbabilities) const;
+
   /**
    * Return a randomly generated observation (one-dimensional vector; one
    * observation) according to the probability distribution defined by this
@@ -113,6 +146,20 @@ class DiscreteDistribution
    */
   arma::vec Random() const;
 
+  /**
+   * Draw the given number of random observations, one per column (so the
+   * matrix has one row), from the given stream of random numbers (see
+   * math::RandomStream), so that several threads can draw observations at
+   * once.  Each observation takes constant time, with an alias table.
+   *
+   * @param n Number of observations to draw.
+   * @param stream Stream of random numbers to draw from.
+   * @param observations Matrix to store the observations in.
+   */
+  void Random(const size_t n,
+              math::RandomStream& stream,
+              arma::mat& observations) const;
+
   /**
    * Estimate the probability distribution directly from the given observations.
    * If any of the observations is greater than numObservations, a crash is
@@ -155,6 +202,15 @@ class DiscreteDistribution
   arma::vec probabilities;
 };
 
+//! Distribution traits for the discrete distribution.
+template<>
+class DistributionTraits<DiscreteDistribution>
+{
+ public:
+  //! Estimation only counts the observations.
+  static const bool ParallelEstimate = true;
+};
+
 }; // namespace distribution
 }; // namespace mlpack
 
@@ -0,0 +1,36 @@
+/**
+ * @file distribution_traits.hpp
+ *
+ * This provides the DistributionTraits class, a template class to get
+ * information about various probability distributions.
+ */
+#ifndef __MLPACK_CORE_DISTS_DISTRIBUTION_TRAITS_HPP
+#define __MLPACK_CORE_DISTS_DISTRIBUTION_TRAITS_HPP
+
+namespace mlpack {
+namespace distribution {
+
+/**
+ * This is a template class that can provide information about various
+ * distributions.  By default, this class will provide the weakest possible
+ * assumptions on distributions, and each distribution should override values
+ * as necessary.  If a distribution doesn't need to override a value, then
+ * there's no need to write a DistributionTraits specialization for that class.
+ */
+template<typename DistributionType>
+class DistributionTraits
+{
+ public:
+  /**
+   * If true, then several distributions of this type can be estimated at the
+   * same time by different threads (Estimate() does not use the global random
+   * number generator or any other shared state).  The HMM then estimates the
+   * emission distributions of its states in parallel.
+   */
+  static const bool ParallelEstimate = false;
+};
+
+}; // namespace distribution
+}; // namespace mlpack
+
+#endif
@@ -10,36 +10,138 @@
 using namespace mlpack;
 using namespace mlpack::distribution;
 
-/**
- * Calculates the multivariate Gaussian probability density function for each
- * data point (column) in the given matrix, with respect to the given mean and
- * variance.
- *
- * @param x List of observations.
- * @param mean Mean of multivariate Gaussian.
- * @param cov Covariance of multivariate Gaussian.
- * @param probabilities Output probabilities for each input observation.
- */
+double GaussianDistribution::LogProbability(const arma::vec& observation)
+    const
+{
+  arma::mat diff = observation - mean;
+  arma::vec distance;
+  MahalanobisDistances(diff, distance);
 
-double GaussianDistribution::Probability(const arma::vec& observation) const
+  return -0.5 * (observation.n_elem * std::log(2 * M_PI) + logDetCov +
+      distance[0]);
+}
+
+void GaussianDistribution::LogProbability(const arma::mat& x,
+                                          arma::vec& logProbabilities) const
 {
-  arma::vec diff = mean - observation;
+  // Column i of 'diffs' is the difference between x.col(i) and the mean.
+  arma::mat diffs = x;
+  diffs.each_col() -= mean;
 
-  arma::vec exponent = -0.5 * (trans(diff) * inv(covariance) * diff);
+  MahalanobisDistances(diffs, logProbabilities);
+  logProbabilities = -0.5 * (logProbabilities + (x.n_rows *
+      std::log(2 * M_PI) + logDetCov));
+}
 
-  // TODO: What if det(cov) < 0?
-  return pow(2 * M_PI, (double) observation.n_elem / -2.0) *
-      pow(det(covariance), -0.5) * exp(exponent[0]);
+void GaussianDistribution::MahalanobisDistances(arma::mat& diffs,
+                                                arma::vec& distances) const
+{
+  if (!invDiagCov.is_empty())
+  {
+    // Diagonal covariance: scale each dimension.
+    distances = arma::trans(arma::trans(invDiagCov) * arma::square(diffs));
+  }
+  else if (!covLower.is_empty())
+  {
+    // With cov = L L^T, the distance of d is ||L^-1 d||^2; one triangular
+    // solve handles every column.
+    diffs = arma::solve(arma::trimatl(covLower), diffs);
+    distances = arma::trans(arma::sum(arma::square(diffs), 0));
+  }
+  else
+  {
+    // We only want the diagonal elements of (diffs' * cov^-1 * diffs).
+    const arma::mat rhs = invCov * diffs;
+    distances = arma::trans(arma::sum(diffs % rhs, 0));
+  }
 }
 
+void GaussianDistribution::FactorCovariance()
+{
+  covLower.reset();
+  invDiagCov.reset();
+  invCov.reset();
+  logDetCov = 0.0;
+
+  if (covariance.n_elem == 0)
+    return;
+
+  bool diagonal = true;
+  bool symmetric = true;
+  for (size_t j = 0; j < covariance.n_cols; ++j)
+  {
+    for (size_t i = j + 1; i < covariance.n_rows; ++i)
+    {
+      if (covariance(i, j) != 0.0 || covariance(j, i) != 0.0)
+        diagonal = false;
+      if (covariance(i, j) != covariance(j, i))
+        symmetric = false;
+    }
+  }
+
+  // A diagonal covariance (as given by gmm::DiagonalConstraint) only needs
+  // elementwise operations.
+  if (diagonal && covariance.diag().min() > 0.0)
+  {
+    invDiagCov = 1.0 / covariance.diag();
+    logDetCov = arma::accu(arma::log(covariance.diag()));
+    return;
+  }
+
+  arma::mat upper;
+  if (symmetric && arma::chol(upper, covariance))
+  {
+    covLower = arma::trans(upper);
+    logDetCov = 2.0 * arma::accu(arma::log(covLower.diag()));
+    return;
+  }
 
+  // The covariance is not symmetric positive definite, so it is inverted
+  // directly.
+  if (!arma::inv(invCov, covariance))
+    invCov = arma::pinv(covariance);
+  logDetCov = std::log(arma::det(covariance));
+}
 
 arma::vec GaussianDistribution::Random() const
 {
-  // Should we store chol(covariance) for easier calculation later?
+  if (!invDiagCov.is_empty())
+    return arma::sqrt(covariance.diag()) % arma::randn<arma::vec>(mean.n_elem)
+        + mean;
+  else if (!covLower.is_empty())
+    return covLower * arma::randn<arma::vec>(mean.n_elem) + mean;
+
   return trans(chol(covariance)) * arma::randn<arma::vec>(mean.n_elem) + mean;
 }
 
+void GaussianDistribution::Random(const size_t n,
+                                  math::RandomStream& stream,
+                                  arma::mat& observations) const
+{
+  arma::mat standard(mean.n_elem, n);
+  for (size_t i = 0; i < standard.n_elem; ++i)
+    standard[i] = stream.RandNormal();
+
+  // The factor of the covariance is applied to all the observations at once.
+  if (!invDiagCov.is_empty())
+  {
+    const arma::vec stddev = arma::sqrt(covariance.diag());
+    for (size_t d = 0; d < mean.n_elem; ++d)
+      standard.row(d) *= stddev[d];
+    observations.steal_mem(standard);
+  }
+  else if (!covLower.is_empty())
+  {
+    observations = covLower * standard;
+  }
+  else
+  {
+    observations = trans(chol(covariance)) * standard;
+  }
+
+  observations.each_col() += mean;
+}
+
 /**
  * Estimate the Gaussian distribution directly from the given observations.
  *
@@ -56,26 +158,14 @@ void GaussianDistribution::Estimate(const arma::mat& observations)
   {
     mean.zeros(0);
     covariance.zeros(0);
+    FactorCovariance();
     return;
   }
 
-  // Calculate the mean.
-  for (size_t i = 0; i < observations.n_cols; i++)
-    mean += observations.col(i);
-
-  // Normalize the mean.
-  mean /= observations.n_cols;
-
-  // Now calculate the covariance.
-  for (size_t i = 0; i < observations.n_cols; i++)
-  {
-    arma::vec obsNoMean = observations.col(i) - mean;
-    covariance += obsNoMean * trans(obsNoMean);
-  }
-
-  // Finish estimating the covariance by normalizing, with the (1 / (n - 1)) so
-  // that it is the unbiased estimator.
-  covariance /= (observations.n_cols - 1);
+  // Calculate the mean and the unbiased estimate of the covariance (normalized
+  // by n - 1), in parallel for large datasets.
+  math::Mean(observations, mean);
+  math::Covariance(observations, covariance);
 
   // Ensure that the covariance is positive definite.
   if (det(covariance) <= 1e-50)
@@ -90,6 +180,8 @@ void GaussianDistribution::Estimate(const arma::mat& observations)
       perturbation *= 10; // Slow, but we don't want to add too much.
     }
   }
+
+  FactorCovariance();
 }
 
 /**
@@ -109,39 +201,23 @@ void GaussianDistribution::Estimate(const arma::mat& observations,
   {
     mean.zeros(0);
     covariance.zeros(0);
+    FactorCovariance();
     return;
   }
 
-  double sumProb = 0;
-
-  // First calculate the mean, and save the sum of all the probabilities for
-  // later normalization.
-  for (size_t i = 0; i < observations.n_cols; i++)
-  {
-    mean += probabilities[i] * observations.col(i);
-    sumProb += probabilities[i];
-  }
-
-  if (sumProb == 0)
+  if (arma::accu(probabilities) == 0)
   {
     // Nothing in this Gaussian!  At least set the covariance so that it's
     // invertible.
     covariance.diag() += 1e-50;
+    FactorCovariance();
     return;
   }
 
-  // Normalize.
-  mean /= sumProb;
-
-  // Now find the covariance.
-  for (size_t i = 0; i < observations.n_cols; i++)
-  {
-    arma::vec obsNoMean = observations.col(i) - mean;
-    covariance += probabilities[i] * (obsNoMean * trans(obsNoMean));
-  }
-
-  // This is probably biased, but I don't know how to unbias it.
-  covariance /= sumProb;
+  // The mean and covariance are weighted by the probabilities (the covariance
+  // is probably biased, but I don't know how to unbias it).  Neither the
+  // observations nor the probabilities are copied.
+  math::Covariance(observations, probabilities, mean, covariance);
 
   // Ensure that the covariance is positive definite.
   if (det(covariance) <= 1e-50)
@@ -156,6 +232,8 @@ void GaussianDistribution::Estimate(const arma::mat& observations,
       perturbation *= 10; // Slow, but we don't want to add too much.
     }
   }
+
+  FactorCovariance();
 }
 
 /**
@@ -193,4 +271,5 @@ void GaussianDistribution::Load(const util::SaveRestoreUtility& sr)
 {
   sr.LoadParameter(mean, "mean");
   sr.LoadParameter(covariance, "covariance");
+  FactorCovariance();
 }
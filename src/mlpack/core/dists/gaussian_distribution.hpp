@@ -9,6 +9,7 @@
 #define __MLPACK_METHODS_HMM_DISTRIBUTIONS_GAUSSIAN_DISTRIBUTION_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/dists/distribution_traits.hpp>
 
 namespace mlpack {
 namespace distribution {
@@ -23,12 +24,21 @@ class GaussianDistribution
   arma::vec mean;
   //! Covariance of the distribution.
   arma::mat covariance;
+  //! Lower Cholesky factor of the covariance (empty if the covariance is
+  //! diagonal or not positive definite).
+  arma::mat covLower;
+  //! Inverse of the diagonal of the covariance, if the covariance is diagonal.
+  arma::vec invDiagCov;
+  //! Inverse of the covariance, if it is not positive definite.
+  arma::mat invCov;
+  //! Log-determinant of the covariance.
+  double logDetCov;
 
  public:
   /**
    * Default constructor, which creates a Gaussian with zero dimension.
    */
-  GaussianDistribution() { /* nothing to do */ }
+  GaussianDistribution() : logDetCov(0.0) { /* nothing to do */ }
 
   /**
    * Create a Gaussian distribution with zero mean and identity covariance with
@@ -37,13 +47,18 @@ class GaussianDistribution
   GaussianDistribution(const size_t dimension) :
       mean(arma::zeros<arma::vec>(dimension)),
       covariance(arma::eye<arma::mat>(dimension, dimension))
-  { /* Nothing to do. */ }
+  {
+    FactorCovariance();
+  }
 
   /**
    * Create a Gaussian distribution with the given mean and covariance.
    */
   GaussianDistribution(const arma::vec& mean, const arma::mat& covariance) :
-      mean(mean), covariance(covariance) { /* Nothing to do. */ }
+      mean(mean), covariance(covariance)
+  {
+    FactorCovariance();
+  }
 
   //! Return the dimensionality of this distribution.
   size_t Dimensionality() const { return mean.n_elem; }
@@ -51,8 +66,16 @@ class GaussianDistribution
   /**
    * Return the probability of the given observation.
    */
-  double Probability(const arma::vec& observation) const;
-  
+  double Probability(const arma::vec& observation) const
+  {
+    return std::exp(LogProbability(observation));
+  }
+
+  /**
+   * Return the log-probability of the given observation.
+   */
+  double LogProbability(const arma::vec& observation) const;
+
   /**
    * Calculates the multivariate Gaussian probability density function for each
    * data point (column) in the given matrix
@@ -60,8 +83,25 @@ class GaussianDistribution
    * @param x List of observations.
    * @param probabilities Output probabilities for each input observation.
    */
-  void Probability(const arma::mat& x, arma::vec& probabilities) const;
-  
+  void Probability(const arma::mat& x, arma::vec& probabilities) const
+  {
+    LogProbability(x, probabilities);
+    probabilities = arma::exp(probabilities);
+  }
+
+  /**
+   * Calculate the log of the multivariate Gaussian probability density
+   * function for each data point (column) in the given matrix.  This takes
+   * one triangular solve with the cached Cholesky factor of the covariance
+   * for the whole matrix (or elementwise operations, if the covariance is
+   * diagonal).
+   *
+   * @param x List of observations.
+   * @param logProbabilities Output log-probabilities for each input
+   *     observation.
+   */
+  void LogProbability(const arma::mat& x, arma::vec& logProbabilities) const;
+
   /**
    * Return a randomly generated observation according to the probability
    * distribution defined by this object.
@@ -70,6 +110,19 @@ class GaussianDistribution
    */
   arma::vec Random() const;
 
+  /**
+   * Draw the given number of random observations, one per column, from
+   * the given stream of random numbers (see math::RandomStream), so that
+   * several threads can draw observations at once.
+   *
+   * @param n Number of observations to draw.
+   * @param stream Stream of random numbers to draw from.
+   * @param observations Matrix to store the observations in.
+   */
+  void Random(const size_t n,
+              math::RandomStream& stream,
+              arma::mat& observations) const;
+
   /**
    * Estimate the Gaussian distribution directly from the given observations.
    *
@@ -101,9 +154,15 @@ class GaussianDistribution
   const arma::mat& Covariance() const { return covariance; }
 
   /**
-   * Return a modifiable copy of the covariance.
+   * Set the covariance matrix.  Its Cholesky factor and log-determinant are
+   * computed and cached, so that the probability of each observation is
+   * cheap to compute.
    */
-  arma::mat& Covariance() { return covariance; }
+  void Covariance(const arma::mat& newCovariance)
+  {
+    covariance = newCovariance;
+    FactorCovariance();
+  }
 
   /**
    * Returns a string representation of this object.
@@ -116,37 +175,31 @@ class GaussianDistribution
   void Save(util::SaveRestoreUtility& n) const;
   void Load(const util::SaveRestoreUtility& n);
   static std::string const Type() { return "GaussianDistribution"; }
-  
-  
-    
+
+ private:
+  /**
+   * Compute and cache the factorization of the covariance: the inverse of its
+   * diagonal if it is diagonal (as with gmm::DiagonalConstraint), its lower
+   * Cholesky factor otherwise, or its inverse if it is not positive definite;
+   * and its log-determinant.
+   */
+  void FactorCovariance();
+
+  /**
+   * Compute the squared Mahalanobis distance between the mean and each column
+   * of the given matrix of differences from the mean, which may be modified.
+   */
+  void MahalanobisDistances(arma::mat& diffs, arma::vec& distances) const;
 };
 
-/**
-* Calculates the multivariate Gaussian probability density function for each
-* data point (column) in the given matrix
-*
-* @param x List of observations.
-* @param probabilities Output probabilities for each input observation.
-*/
-inline void GaussianDistribution::Probability(const arma::mat& x,
-                                              arma::vec& probabilities) const
+//! Distribution traits for the Gaussian distribution.
+template<>
+class DistributionTraits<GaussianDistribution>
 {
-  // Column i of 'diffs' is the difference between x.col(i) and the mean.
-  arma::mat diffs = x - (mean * arma::ones<arma::rowvec>(x.n_cols));
-  
-  // Now, we only want to calculate the diagonal elements of (diffs' * cov^-1 *
-  // diffs).  We just don't need any of the other elements.  We can calculate
-  // the right hand part of the equation (instead of the left side) so that
-  // later we are referencing columns, not rows -- that is faster.
-  arma::mat rhs = -0.5 * inv(covariance) * diffs;
-  arma::vec exponents(diffs.n_cols); // We will now fill this.
-  for (size_t i = 0; i < diffs.n_cols; i++)
-    exponents(i) = exp(accu(diffs.unsafe_col(i) % rhs.unsafe_col(i)));
-  
-  probabilities = pow(2 * M_PI, (double) mean.n_elem / -2.0) *
-  pow(arma::det(covariance), -0.5) * exponents;
-}
-  
+ public:
+  //! Estimation only computes moments of the observations.
+  static const bool ParallelEstimate = true;
+};
 
 }; // namespace distribution
 }; // namespace mlpack
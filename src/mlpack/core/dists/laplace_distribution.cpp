@@ -12,12 +12,44 @@ using namespace mlpack;
 using namespace mlpack::distribution;
 
 /**
- * Return the probability of the given observation.
+ * Return the log-probability of the given observation.
  */
-double LaplaceDistribution::Probability(const arma::vec& observation) const
+double LaplaceDistribution::LogProbability(const arma::vec& observation) const
 {
-  // Evaluate the PDF of the Laplace distribution to determine the probability.
-  return (0.5 / scale) * std::exp(arma::norm(observation - mean, 2) / scale);
+  // Evaluate the log of the PDF of the Laplace distribution.
+  return -std::log(2.0 * scale) - arma::norm(observation - mean, 2) / scale;
+}
+
+/**
+ * Calculate the log-probability of each observation in the given matrix.
+ */
+void LaplaceDistribution::LogProbability(const arma::mat& x,
+                                         arma::vec& logProbabilities) const
+{
+  arma::mat diffs = x;
+  diffs.each_col() -= mean;
+
+  logProbabilities = -std::log(2.0 * scale) -
+      arma::trans(arma::sqrt(arma::sum(arma::square(diffs), 0))) / scale;
+}
+
+void LaplaceDistribution::Random(const size_t n,
+                                 math::RandomStream& stream,
+                                 arma::mat& observations) const
+{
+  observations.set_size(mean.n_elem, n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    for (size_t d = 0; d < mean.n_elem; ++d)
+    {
+      // Convert from the uniform distribution, as in Random().
+      const double u = stream.Random() - 0.5;
+      if (u < 0.0)
+        observations(d, i) = mean[d] + scale * std::log(1 + 2.0 * u);
+      else
+        observations(d, i) = mean[d] - scale * std::log(1 - 2.0 * u);
+    }
+  }
 }
 
 /**
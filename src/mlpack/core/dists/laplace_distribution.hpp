@@ -8,6 +8,8 @@
 #ifndef __MLPACK_CORE_OPTIMIZER_SA_LAPLACE_DISTRIBUTION_HPP
 #define __MLPACK_CORE_OPTIMIZER_SA_LAPLACE_DISTRIBUTION_HPP
 
+#include <mlpack/core/dists/distribution_traits.hpp>
+
 namespace mlpack {
 namespace distribution {
 
@@ -75,7 +77,38 @@ class LaplaceDistribution
   /**
    * Return the probability of the given observation.
    */
-  double Probability(const arma::vec& observation) const;
+  double Probability(const arma::vec& observation) const
+  {
+    return std::exp(LogProbability(observation));
+  }
+
+  /**
+   * Return the log-probability of the given observation.
+   */
+  double LogProbability(const arma::vec& observation) const;
+
+  /**
+   * Calculate the probability of each observation (column) in the given
+   * matrix.
+   *
+   * @param x List of observations.
+   * @param probabilities Output probabilities for each input observation.
+   */
+  void Probability(const arma::mat& x, arma::vec& probabilities) const
+  {
+    LogProbability(x, probabilities);
+    probabilities = arma::exp(probabilities);
+  }
+
+  /**
+   * Calculate the log-probability of each observation (column) in the given
+   * matrix, with elementwise operations on the whole matrix.
+   *
+   * @param x List of observations.
+   * @param logProbabilities Output log-probabilities for each input
+   *     observation.
+   */
+  void LogProbability(const arma::mat& x, arma::vec& logProbabilities) const;
 
   /**
    * Return a randomly generated observation according to the probability
@@ -102,6 +135,19 @@ class LaplaceDistribution
     return result;
   }
 
+  /**
+   * Draw the given number of random observations, one per column, from
+   * the given stream of random numbers (see math::RandomStream), so that
+   * several threads can draw observations at once.
+   *
+   * @param n Number of observations to draw.
+   * @param stream Stream of random numbers to draw from.
+   * @param observations Matrix to store the observations in.
+   */
+  void Random(const size_t n,
+              math::RandomStream& stream,
+              arma::mat& observations) const;
+
   /**
    * Estimate the Laplace distribution directly from the given observations.
    *
@@ -145,6 +191,15 @@ class LaplaceDistribution
 
 };
 
+//! Distribution traits for the Laplace distribution.
+template<>
+class DistributionTraits<LaplaceDistribution>
+{
+ public:
+  //! Estimation only computes moments of the observations.
+  static const bool ParallelEstimate = true;
+};
+
 }; // namespace distribution
 }; // namespace mlpack
 
@@ -35,12 +35,14 @@ std::string RegressionDistribution::ToString() const
  */
 void RegressionDistribution::Estimate(const arma::mat& observations)
 {
-  regression::LinearRegression lr(observations.rows(1, observations.n_rows - 1),
-      (observations.row(0)).t(), 0, true);
-  rf = lr;
+  // The predictors are copied out of the observations only once.
+  const arma::mat predictors = observations.rows(1, observations.n_rows - 1);
+  const arma::vec responses = arma::trans(observations.row(0));
+
+  rf = regression::LinearRegression(predictors, responses, 0, true);
   arma::vec fitted;
-  lr.Predict(observations.rows(1, observations.n_rows - 1), fitted);
-  err.Estimate(observations.row(0) - fitted.t());
+  rf.Predict(predictors, fitted);
+  err.Estimate(arma::trans(responses - fitted));
 }
 
 /**
@@ -51,12 +53,14 @@ void RegressionDistribution::Estimate(const arma::mat& observations)
 void RegressionDistribution::Estimate(const arma::mat& observations,
                              const arma::vec& weights)
 {
-  regression::LinearRegression lr(observations.rows(1, observations.n_rows - 1),
-      (observations.row(0)).t(), 0, true, weights);
-  rf = lr;
+  // The predictors are copied out of the observations only once.
+  const arma::mat predictors = observations.rows(1, observations.n_rows - 1);
+  const arma::vec responses = arma::trans(observations.row(0));
+
+  rf = regression::LinearRegression(predictors, responses, 0, true, weights);
   arma::vec fitted;
-  lr.Predict(observations.rows(1, observations.n_rows - 1), fitted);
-  err.Estimate(observations.row(0) - fitted.t(), weights);
+  rf.Predict(predictors, fitted);
+  err.Estimate(arma::trans(responses - fitted), weights);
 }
 
 /**
@@ -71,6 +75,41 @@ double RegressionDistribution::Probability(const arma::vec& observation) const
   return err.Probability(observation(0)-fitted);
 }
 
+/**
+ * Evaluate the log of the probability density function of given observation.
+ *
+ * @param observation point to evaluate log-probability at
+ */
+double RegressionDistribution::LogProbability(const arma::vec& observation)
+    const
+{
+  arma::vec fitted;
+  rf.Predict(observation.rows(1, observation.n_rows - 1), fitted);
+  return err.LogProbability(observation(0) - fitted);
+}
+
+/**
+ * Evaluate probability density function of each given observation.
+ */
+void RegressionDistribution::Probability(const arma::mat& x,
+                                         arma::vec& probabilities) const
+{
+  LogProbability(x, probabilities);
+  probabilities = arma::exp(probabilities);
+}
+
+/**
+ * Evaluate the log of the probability density function of each given
+ * observation; the residuals of all the observations are evaluated together.
+ */
+void RegressionDistribution::LogProbability(const arma::mat& x,
+                                            arma::vec& logProbabilities) const
+{
+  arma::vec fitted;
+  rf.Predict(x.rows(1, x.n_rows - 1), fitted);
+  err.LogProbability(x.row(0) - arma::trans(fitted), logProbabilities);
+}
+
 void RegressionDistribution::Predict(const arma::mat& points,
                                      arma::vec& predictions) const
 {
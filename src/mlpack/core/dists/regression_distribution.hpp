@@ -9,6 +9,7 @@
 
 #include <mlpack/core.hpp>
 #include <mlpack/core/dists/gaussian_distribution.hpp>
+#include <mlpack/core/dists/distribution_traits.hpp>
 #include <mlpack/methods/linear_regression/linear_regression.hpp>
 
 namespace mlpack {
@@ -48,7 +49,8 @@ class RegressionDistribution
       rf(regression::LinearRegression(predictors, responses))
   {
     err = GaussianDistribution(1);
-    err.Covariance() = rf.ComputeError(predictors, responses);
+    err.Covariance(rf.ComputeError(predictors, responses) *
+        arma::ones<arma::mat>(1, 1));
   }
 
   /**
@@ -80,6 +82,33 @@ class RegressionDistribution
   */
   double Probability(const arma::vec& observation) const;
 
+  /**
+   * Evaluate the log of the probability density function of the given
+   * observation.
+   *
+   * @param observation Point to evaluate the log-probability at.
+   */
+  double LogProbability(const arma::vec& observation) const;
+
+  /**
+   * Evaluate the probability density function of each observation (column) in
+   * the given matrix.
+   *
+   * @param x List of observations.
+   * @param probabilities Output probabilities for each input observation.
+   */
+  void Probability(const arma::mat& x, arma::vec& probabilities) const;
+
+  /**
+   * Evaluate the log of the probability density function of each observation
+   * (column) in the given matrix, with one prediction for the whole matrix.
+   *
+   * @param x List of observations.
+   * @param logProbabilities Output log-probabilities for each input
+   *     observation.
+   */
+  void LogProbability(const arma::mat& x, arma::vec& logProbabilities) const;
+
   /**
    * Calculate y_i for each data point in points.
    *
@@ -96,6 +125,15 @@ class RegressionDistribution
 };
 
 
+//! Distribution traits for the regression distribution.
+template<>
+class DistributionTraits<RegressionDistribution>
+{
+ public:
+  //! Estimation solves a weighted least-squares problem.
+  static const bool ParallelEstimate = true;
+};
+
 }; // namespace distribution
 }; // namespace mlpack
 
@@ -0,0 +1,275 @@
+/**
+ * @file kernel_cache.cpp
+ *
+ * Implementation of the KernelCache class.
+ */
+#include "kernel_cache.hpp"
+
+#include <list>
+#include <map>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::kernel;
+
+namespace mlpack {
+namespace kernel {
+
+//! A cached kernel evaluation.
+struct KernelCacheEntry
+{
+  //! The pair of indices.
+  std::pair<size_t, size_t> key;
+  //! The kernel evaluation.
+  double value;
+};
+
+/**
+ * One shard of a KernelCache: its evaluations, from the most recently used to
+ * the least recently used, an index of them, and the lock which protects both.
+ */
+struct KernelCacheShard
+{
+  typedef std::list<KernelCacheEntry> EntryList;
+
+  KernelCacheShard(const size_t capacity) :
+      capacity(capacity), hits(0), misses(0)
+  {
+#ifdef _OPENMP
+    omp_init_lock(&lock);
+#endif
+  }
+
+  ~KernelCacheShard()
+  {
+#ifdef _OPENMP
+    omp_destroy_lock(&lock);
+#endif
+  }
+
+  void Lock()
+  {
+#ifdef _OPENMP
+    omp_set_lock(&lock);
+#endif
+  }
+
+  void Unlock()
+  {
+#ifdef _OPENMP
+    omp_unset_lock(&lock);
+#endif
+  }
+
+  //! The maximum number of evaluations of the shard.
+  size_t capacity;
+  //! The evaluations, most recently used first.
+  EntryList entries;
+  //! The position of each evaluation in the list.
+  std::map<std::pair<size_t, size_t>, EntryList::iterator> index;
+  //! The number of lookups which found the evaluation.
+  size_t hits;
+  //! The number of lookups which did not find the evaluation.
+  size_t misses;
+#ifdef _OPENMP
+  //! Held while the shard is accessed.
+  omp_lock_t lock;
+#endif
+};
+
+}; // namespace kernel
+}; // namespace mlpack
+
+// The statistics of the caches destroyed so far.  They are only accessed in
+// the critical sections below.
+static size_t totalHits = 0;
+static size_t totalMisses = 0;
+
+KernelCache::KernelCache(const size_t capacity, const size_t numShards) :
+    capacity(capacity),
+    boundData(NULL),
+    boundRows(0),
+    boundCols(0)
+{
+  // Each shard holds at least one evaluation.
+  const size_t count = std::max(std::min(numShards, capacity), (size_t) 1);
+  for (size_t i = 0; i < count; ++i)
+  {
+    const size_t begin = (i * capacity) / count;
+    const size_t end = ((i + 1) * capacity) / count;
+    shards.push_back(new KernelCacheShard(end - begin));
+  }
+}
+
+KernelCache::~KernelCache()
+{
+  const size_t hits = Hits();
+  const size_t misses = Misses();
+
+  #pragma omp critical(mlpack_kernel_cache_total)
+  {
+    totalHits += hits;
+    totalMisses += misses;
+  }
+
+  for (size_t i = 0; i < shards.size(); ++i)
+    delete shards[i];
+}
+
+bool KernelCache::Lookup(const size_t a, const size_t b, double& value)
+{
+  KernelCacheShard& shard = Shard(a, b);
+  shard.Lock();
+
+  std::map<std::pair<size_t, size_t>,
+      KernelCacheShard::EntryList::iterator>::iterator it =
+      shard.index.find(std::make_pair(a, b));
+  const bool found = (it != shard.index.end());
+  if (found)
+  {
+    // Move the evaluation to the front, as the most recently used.
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    value = it->second->value;
+    ++shard.hits;
+  }
+  else
+  {
+    ++shard.misses;
+  }
+
+  shard.Unlock();
+  return found;
+}
+
+void KernelCache::Insert(const size_t a, const size_t b, const double value)
+{
+  KernelCacheShard& shard = Shard(a, b);
+  if (shard.capacity == 0)
+    return;
+
+  shard.Lock();
+
+  const std::pair<size_t, size_t> key(a, b);
+  std::map<std::pair<size_t, size_t>,
+      KernelCacheShard::EntryList::iterator>::iterator it =
+      shard.index.find(key);
+  if (it != shard.index.end())
+  {
+    // Another thread may have inserted the same pair.
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    it->second->value = value;
+  }
+  else
+  {
+    // Drop the least recently used evaluation if the shard is full.
+    if (shard.entries.size() >= shard.capacity)
+    {
+      shard.index.erase(shard.entries.back().key);
+      shard.entries.pop_back();
+    }
+
+    KernelCacheEntry entry;
+    entry.key = key;
+    entry.value = value;
+    shard.entries.push_front(entry);
+    shard.index[key] = shard.entries.begin();
+  }
+
+  shard.Unlock();
+}
+
+void KernelCache::Bind(const arma::mat& data)
+{
+  if (boundData == (const void*) &data && boundRows == data.n_rows &&
+      boundCols == data.n_cols)
+    return;
+
+  Clear();
+  boundData = (const void*) &data;
+  boundRows = data.n_rows;
+  boundCols = data.n_cols;
+}
+
+void KernelCache::Clear()
+{
+  for (size_t i = 0; i < shards.size(); ++i)
+  {
+    shards[i]->Lock();
+    shards[i]->entries.clear();
+    shards[i]->index.clear();
+    shards[i]->Unlock();
+  }
+}
+
+size_t KernelCache::Size() const
+{
+  size_t size = 0;
+  for (size_t i = 0; i < shards.size(); ++i)
+  {
+    shards[i]->Lock();
+    size += shards[i]->entries.size();
+    shards[i]->Unlock();
+  }
+
+  return size;
+}
+
+size_t KernelCache::Hits() const
+{
+  size_t hits = 0;
+  for (size_t i = 0; i < shards.size(); ++i)
+  {
+    shards[i]->Lock();
+    hits += shards[i]->hits;
+    shards[i]->Unlock();
+  }
+
+  return hits;
+}
+
+size_t KernelCache::Misses() const
+{
+  size_t misses = 0;
+  for (size_t i = 0; i < shards.size(); ++i)
+  {
+    shards[i]->Lock();
+    misses += shards[i]->misses;
+    shards[i]->Unlock();
+  }
+
+  return misses;
+}
+
+double KernelCache::HitRate() const
+{
+  const size_t hits = Hits();
+  const size_t lookups = hits + Misses();
+  return (lookups == 0) ? 0.0 : (double) hits / lookups;
+}
+
+size_t KernelCache::TotalHits()
+{
+  size_t hits;
+  #pragma omp critical(mlpack_kernel_cache_total)
+  hits = totalHits;
+  return hits;
+}
+
+size_t KernelCache::TotalMisses()
+{
+  size_t misses;
+  #pragma omp critical(mlpack_kernel_cache_total)
+  misses = totalMisses;
+  return misses;
+}
+
+KernelCacheShard& KernelCache::Shard(const size_t a, const size_t b) const
+{
+  // Mix the indices, so that the pairs of one point are spread over the
+  // shards.
+  const size_t hash = (a * 2654435761UL) ^ (b + 0x9e3779b9UL + (a << 6));
+  return *shards[hash % shards.size()];
+}
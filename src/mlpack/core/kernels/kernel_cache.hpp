@@ -0,0 +1,135 @@
+/**
+ * @file kernel_cache.hpp
+ *
+ * Definition of the KernelCache class, a bounded cache of kernel evaluations
+ * between points of a dataset, keyed by the indices of the points.
+ */
+#ifndef __MLPACK_CORE_KERNELS_KERNEL_CACHE_HPP
+#define __MLPACK_CORE_KERNELS_KERNEL_CACHE_HPP
+
+#include <mlpack/prereqs.hpp>
+
+namespace mlpack {
+namespace kernel {
+
+//! One shard of a KernelCache (defined in kernel_cache.cpp).
+struct KernelCacheShard;
+
+/**
+ * A bounded cache of kernel evaluations K(a, b), keyed by the pair of indices
+ * (a, b) of the points.  This is useful for kernels which are much more
+ * expensive than a distance (like PSpectrumStringKernel, or a
+ * PolynomialKernel on high-dimensional data), when the same pairs are
+ * evaluated many times: for instance, by the traversals of FastMKS, or by
+ * repeated KernelPCA runs on the same data.  For cheap kernels, looking a pair
+ * up costs more than evaluating the kernel, so the cache should not be used.
+ *
+ * The cache holds at most the given number of evaluations; when it is full,
+ * the least recently used evaluation is dropped.  The pairs are split between
+ * several shards, each with its own lock, so that the cache can be used by
+ * many OpenMP threads at once.  Each cache counts its hits and misses, and
+ * adds them to a process-wide total when it is destroyed; the command-line
+ * programs print the total with --verbose.
+ *
+ * The indices only mean something for a given dataset, so a cache must only
+ * be used with one dataset (or one pair of datasets); Bind() clears the cache
+ * when it is used with a different dataset.  The cache does not know whether
+ * the kernel is symmetric: the caller can store only the pairs with a <= b.
+ *
+ * @code
+ * kernel::KernelCache cache(1000000);
+ * double value;
+ * if (!cache.Lookup(a, b, value))
+ * {
+ *   value = k.Evaluate(data.unsafe_col(a), data.unsafe_col(b));
+ *   cache.Insert(a, b, value);
+ * }
+ * @endcode
+ */
+class KernelCache
+{
+ public:
+  /**
+   * Create an empty cache.
+   *
+   * @param capacity Maximum number of kernel evaluations held.
+   * @param numShards Number of independently locked parts of the cache.
+   */
+  KernelCache(const size_t capacity, const size_t numShards = 16);
+
+  //! Record the statistics of the cache, and free it.
+  ~KernelCache();
+
+  /**
+   * Look up the kernel evaluation of the given pair.
+   *
+   * @param a Index of the first point.
+   * @param b Index of the second point.
+   * @param value Set to the kernel evaluation, if it is cached.
+   * @return Whether the kernel evaluation is cached.
+   */
+  bool Lookup(const size_t a, const size_t b, double& value);
+
+  /**
+   * Store the kernel evaluation of the given pair, dropping the least recently
+   * used evaluation of its shard if the shard is full.
+   *
+   * @param a Index of the first point.
+   * @param b Index of the second point.
+   * @param value Kernel evaluation.
+   */
+  void Insert(const size_t a, const size_t b, const double value);
+
+  /**
+   * Use the cache with the given dataset: if it was used with another dataset
+   * (at another address or of another size), it is cleared.
+   *
+   * @param data Dataset whose indices are the keys of the cache.
+   */
+  void Bind(const arma::mat& data);
+
+  //! Drop all the kernel evaluations (the statistics are kept).
+  void Clear();
+
+  //! Get the maximum number of kernel evaluations held.
+  size_t Capacity() const { return capacity; }
+  //! Get the number of kernel evaluations held.
+  size_t Size() const;
+  //! Get the number of lookups which found the kernel evaluation.
+  size_t Hits() const;
+  //! Get the number of lookups which did not find the kernel evaluation.
+  size_t Misses() const;
+  //! Get the fraction of lookups which found the kernel evaluation.
+  double HitRate() const;
+
+  //! Get the total hits of all the caches destroyed so far.
+  static size_t TotalHits();
+  //! Get the total misses of all the caches destroyed so far.
+  static size_t TotalMisses();
+
+ private:
+  //! Get the shard of the given pair.
+  KernelCacheShard& Shard(const size_t a, const size_t b) const;
+
+  //! The maximum number of kernel evaluations held.
+  size_t capacity;
+  //! The shards.
+  std::vector<KernelCacheShard*> shards;
+
+  //! The dataset the cache is used with.
+  const void* boundData;
+  //! The number of rows of the dataset the cache is used with.
+  size_t boundRows;
+  //! The number of columns of the dataset the cache is used with.
+  size_t boundCols;
+
+  //! The shards hold locks, so the cache can't be copied.
+  KernelCache(const KernelCache& other);
+  //! The shards hold locks, so the cache can't be copied.
+  KernelCache& operator=(const KernelCache& other);
+};
+
+}; // namespace kernel
+}; // namespace mlpack
+
+#endif
@@ -42,7 +42,9 @@ mlpack::kernel::PSpectrumStringKernel::PSpectrumStringKernel(
     // Resize for number of strings in dataset.
     counts[dataset].resize(set.size());
 
-    // Inspect each string in the dataset.
+    // Inspect each string in the dataset.  The strings are independent, so
+    // this is done in parallel.
+    #pragma omp parallel for schedule(dynamic, 64)
     for (size_t index = 0; index < set.size(); ++index)
     {
       // Convenience references.
@@ -80,4 +82,59 @@ mlpack::kernel::PSpectrumStringKernel::PSpectrumStringKernel(
   }
 
   Log::Info << "Substring extraction complete." << std::endl;
+
+  BuildIndex();
+}
+
+void mlpack::kernel::PSpectrumStringKernel::BuildIndex()
+{
+  // Give each distinct substring an ID, in alphabetical order, so that the
+  // substrings of each string (which its map holds in alphabetical order) get
+  // increasing IDs.
+  std::map<std::string, size_t> ids;
+  size_t totalSubstrings = 0;
+  for (size_t dataset = 0; dataset < counts.size(); ++dataset)
+  {
+    for (size_t index = 0; index < counts[dataset].size(); ++index)
+    {
+      const std::map<std::string, int>& mapping = counts[dataset][index];
+      for (std::map<std::string, int>::const_iterator it = mapping.begin();
+           it != mapping.end(); ++it)
+        ids.insert(std::make_pair((*it).first, 0));
+
+      totalSubstrings += mapping.size();
+    }
+  }
+
+  numSubstrings = 0;
+  for (std::map<std::string, size_t>::iterator it = ids.begin();
+       it != ids.end(); ++it)
+    (*it).second = numSubstrings++;
+
+  // Now fill the arena with the IDs and counts of each string.
+  substringIds.resize(totalSubstrings);
+  substringCounts.resize(totalSubstrings);
+  offsets.resize(counts.size());
+
+  size_t position = 0;
+  for (size_t dataset = 0; dataset < counts.size(); ++dataset)
+  {
+    offsets[dataset].resize(counts[dataset].size() + 1);
+    for (size_t index = 0; index < counts[dataset].size(); ++index)
+    {
+      offsets[dataset][index] = position;
+
+      const std::map<std::string, int>& mapping = counts[dataset][index];
+      for (std::map<std::string, int>::const_iterator it = mapping.begin();
+           it != mapping.end(); ++it, ++position)
+      {
+        substringIds[position] = ids[(*it).first];
+        substringCounts[position] = (*it).second;
+      }
+    }
+    offsets[dataset][counts[dataset].size()] = position;
+  }
+
+  Log::Info << numSubstrings << " distinct substrings of length " << p
+      << " indexed." << std::endl;
 }
@@ -55,6 +55,14 @@ namespace kernel {
  * the data according to the fake data matrix -- resulting in a meaningless
  * tree.  This kernel was originally written for the FastMKS method; so, at the
  * very least, it will work with that.
+ *
+ * At construction, every distinct substring of length p in the datasets is
+ * given an integer ID, in alphabetical order, and the substring counts of each
+ * string are stored as an array of IDs and an array of counts, sorted by ID;
+ * the arrays of all the strings are held in one contiguous arena.  Evaluate()
+ * is then a merge of two sorted integer arrays, with no string comparisons.
+ * The counts are also available as maps from substrings (see Counts()); if
+ * these are modified, BuildIndex() must be called before Evaluate().
  */
 class PSpectrumStringKernel
 {
@@ -90,6 +98,16 @@ class PSpectrumStringKernel
   std::vector<std::vector<std::map<std::string, int> > >& Counts()
   { return counts; }
 
+  /**
+   * Build the sorted arrays of substring IDs and counts used by Evaluate() from
+   * the maps of substring counts.  This is done by the constructor, and only
+   * needs to be called again if Counts() has been modified.
+   */
+  void BuildIndex();
+
+  //! Get the number of distinct substrings in the datasets.
+  size_t NumSubstrings() const { return numSubstrings; }
+
   //! Access the value of p.
   size_t P() const { return p; }
   //! Modify the value of p.
@@ -119,6 +137,17 @@ class PSpectrumStringKernel
 
   //! The value of p to use in calculation.
   size_t p;
+
+  //! The number of distinct substrings in the datasets.
+  size_t numSubstrings;
+  //! The IDs of the substrings of every string, sorted for each string.
+  std::vector<size_t> substringIds;
+  //! The counts of the substrings of every string, in the order of
+  //! substringIds.
+  std::vector<double> substringCounts;
+  //! For each dataset, the position in substringIds of the substrings of each
+  //! string; the substrings of string i are in [offsets[i], offsets[i + 1]).
+  std::vector<std::vector<size_t> > offsets;
 };
 
 }; // namespace kernel
@@ -31,40 +31,32 @@ template<typename VecType>
 double PSpectrumStringKernel::Evaluate(const VecType& a,
                                        const VecType& b) const
 {
-  // Get the map of substrings for the two strings we are interested in.
-  const std::map<std::string, int>& aMap = counts[a[0]][a[1]];
-  const std::map<std::string, int>& bMap = counts[b[0]][b[1]];
+  // Get the ranges of the substring arrays for the two strings we are
+  // interested in.
+  const size_t aDataset = (size_t) a[0];
+  const size_t aIndex = (size_t) a[1];
+  const size_t bDataset = (size_t) b[0];
+  const size_t bIndex = (size_t) b[1];
 
-  double eval = 0;
+  size_t i = offsets[aDataset][aIndex];
+  const size_t aEnd = offsets[aDataset][aIndex + 1];
+  size_t j = offsets[bDataset][bIndex];
+  const size_t bEnd = offsets[bDataset][bIndex + 1];
 
-  // Loop through the two maps (which, when iterated through, are sorted
-  // alphabetically).
-  std::map<std::string, int>::const_iterator aIt = aMap.begin();
-  std::map<std::string, int>::const_iterator bIt = bMap.begin();
+  double eval = 0;
 
-  while ((aIt != aMap.end()) && (bIt != bMap.end()))
+  // Merge the two arrays of IDs (which are sorted).  The smaller ID (or both,
+  // if they are the same substring) is advanced without a branch.
+  while ((i < aEnd) && (j < bEnd))
   {
-    // Compare alphabetically (this is how std::map is ordered).
-    int result = (*aIt).first.compare((*bIt).first);
+    const size_t aId = substringIds[i];
+    const size_t bId = substringIds[j];
 
-    if (result == 0) // The same substring.
-    {
-      eval += ((*aIt).second * (*bIt).second);
+    if (aId == bId)
+      eval += substringCounts[i] * substringCounts[j];
 
-      // Now increment both.
-      ++aIt;
-      ++bIt;
-    }
-    else if (result > 0)
-    {
-      // aIt is "ahead" of bIt (alphabetically); so increment bIt to "catch up".
-      ++bIt;
-    }
-    else
-    {
-      // bIt is "ahead" of aIt (alphabetically); so increment aIt to "catch up".
-      ++aIt;
-    }
+    i += (aId <= bId);
+    j += (bId <= aId);
   }
 
   return eval;
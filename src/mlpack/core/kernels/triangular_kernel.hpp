@@ -10,6 +10,8 @@
 #include <mlpack/core.hpp>
 #include <mlpack/core/metrics/lmetric.hpp>
 
+#include <boost/math/special_functions/gamma.hpp>
+
 namespace mlpack {
 namespace kernel {
 
@@ -53,7 +55,20 @@ class TriangularKernel
    */
   double Evaluate(const double distance) const
   {
-    return std::max(0.0, (1 - distance) / bandwidth);
+    return std::max(0.0, 1 - distance / bandwidth);
+  }
+
+  /**
+   * Obtain the normalization constant of the triangular kernel: the integral of
+   * the kernel over the space of the given dimension, which is the volume of
+   * the ball of radius b divided by (dimension + 1).
+   *
+   * @param dimension Dimension of the space.
+   */
+  double Normalizer(const size_t dimension) const
+  {
+    return pow(bandwidth, (double) dimension) * pow(M_PI, dimension / 2.0) /
+        (boost::math::tgamma(dimension / 2.0 + 1.0) * (dimension + 1.0));
   }
 
   //! Get the bandwidth of the kernel.
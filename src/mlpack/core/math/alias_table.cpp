@@ -0,0 +1,83 @@
+/**
+ * @file alias_table.cpp
+ *
+ * Implementation of the AliasTable class.
+ */
+#include "alias_table.hpp"
+#include <mlpack/core.hpp>
+
+using namespace mlpack;
+using namespace mlpack::math;
+
+void AliasTable::Build(const arma::vec& weights)
+{
+  // Only the outcomes with positive weight get buckets.
+  size_t count = 0;
+  double total = 0.0;
+  for (size_t i = 0; i < weights.n_elem; ++i)
+  {
+    if (weights[i] < 0.0)
+      Log::Fatal << "AliasTable::Build(): weight " << i << " is negative ("
+          << weights[i] << ")." << std::endl;
+    if (weights[i] > 0.0)
+    {
+      ++count;
+      total += weights[i];
+    }
+  }
+
+  if (count == 0)
+    Log::Fatal << "AliasTable::Build(): no weight is positive." << std::endl;
+
+  outcomes.set_size(count);
+  probabilities.set_size(count);
+  aliases.set_size(count);
+
+  // Scale the weights so that their mean is 1; buckets with a scaled weight
+  // below 1 are filled up by the outcomes with a scaled weight above 1.
+  arma::vec scaled(count);
+  std::vector<size_t> small, large;
+  for (size_t i = 0, bucket = 0; i < weights.n_elem; ++i)
+  {
+    if (weights[i] == 0.0)
+      continue;
+
+    outcomes[bucket] = i;
+    scaled[bucket] = weights[i] * count / total;
+    if (scaled[bucket] < 1.0)
+      small.push_back(bucket);
+    else
+      large.push_back(bucket);
+    ++bucket;
+  }
+
+  while (!small.empty() && !large.empty())
+  {
+    const size_t less = small.back();
+    small.pop_back();
+    const size_t more = large.back();
+
+    probabilities[less] = scaled[less];
+    aliases[less] = more;
+
+    // The rest of the bucket is taken from the larger outcome.
+    scaled[more] = (scaled[more] + scaled[less]) - 1.0;
+    if (scaled[more] < 1.0)
+    {
+      large.pop_back();
+      small.push_back(more);
+    }
+  }
+
+  // The remaining buckets are full, up to rounding errors.
+  for (size_t i = 0; i < large.size(); ++i)
+  {
+    probabilities[large[i]] = 1.0;
+    aliases[large[i]] = large[i];
+  }
+  for (size_t i = 0; i < small.size(); ++i)
+  {
+    probabilities[small[i]] = 1.0;
+    aliases[small[i]] = small[i];
+  }
+}
@@ -0,0 +1,87 @@
+/**
+ * @file alias_table.hpp
+ *
+ * Definition of the AliasTable class, which draws samples from a discrete
+ * distribution in constant time.
+ */
+#ifndef __MLPACK_CORE_MATH_ALIAS_TABLE_HPP
+#define __MLPACK_CORE_MATH_ALIAS_TABLE_HPP
+
+#include <mlpack/prereqs.hpp>
+#include "random.hpp"
+
+namespace mlpack {
+namespace math {
+
+/**
+ * A table for sampling from a discrete distribution over a fixed set of
+ * outcomes with the alias method (Walker, 1977; the table is built with Vose's
+ * algorithm).  Building the table takes time linear in the number of
+ * outcomes; then each sample takes constant time, with one uniform random
+ * number, instead of a search through the cumulative probabilities.  Outcomes
+ * with zero probability are not stored, so a sparse distribution only takes
+ * memory proportional to its number of possible outcomes.
+ *
+ * @code
+ * math::AliasTable table(weights);
+ * const size_t outcome = table.Sample(); // From the global generator.
+ *
+ * math::RandomStream stream(key, i);
+ * const size_t other = table.Sample(stream); // From an independent stream.
+ * @endcode
+ */
+class AliasTable
+{
+ public:
+  //! Create an empty table; Build() must be called before sampling.
+  AliasTable() { }
+
+  /**
+   * Build the table for the given weights; see Build().
+   *
+   * @param weights Weight of each outcome.
+   */
+  AliasTable(const arma::vec& weights) { Build(weights); }
+
+  /**
+   * Build the table for the given weights.  The weights do not need to sum to
+   * 1, since they are normalized, but they must not be negative, and at least
+   * one must be positive.
+   *
+   * @param weights Weight of each outcome.
+   */
+  void Build(const arma::vec& weights);
+
+  //! Draw an outcome from the global generator.
+  size_t Sample() const { return Lookup(math::Random()); }
+
+  //! Draw an outcome from the given stream (see RandomStream).
+  template<typename StreamType>
+  size_t Sample(StreamType& stream) const { return Lookup(stream.Random()); }
+
+  //! Get the number of outcomes with nonzero probability.
+  size_t Outcomes() const { return outcomes.n_elem; }
+
+ private:
+  //! Draw an outcome with the given uniform random number in [0, 1).
+  size_t Lookup(const double random) const
+  {
+    const double scaled = random * probabilities.n_elem;
+    const size_t bucket = std::min((size_t) scaled,
+        (size_t) probabilities.n_elem - 1);
+    return (scaled - bucket < probabilities[bucket]) ? outcomes[bucket] :
+        outcomes[aliases[bucket]];
+  }
+
+  //! The outcome of each bucket.
+  arma::Col<size_t> outcomes;
+  //! The probability of keeping the outcome of each bucket.
+  arma::vec probabilities;
+  //! The bucket whose outcome is taken otherwise.
+  arma::Col<size_t> aliases;
+};
+
+}; // namespace math
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,129 @@
+/**
+ * @file fast_exp.hpp
+ *
+ * Definition of the ExactExp and FastExp policies, which compute the
+ * exponential function either with std::exp() or with a polynomial
+ * approximation.
+ */
+#ifndef __MLPACK_CORE_MATH_FAST_EXP_HPP
+#define __MLPACK_CORE_MATH_FAST_EXP_HPP
+
+#include <mlpack/prereqs.hpp>
+#include <cstring>
+
+namespace mlpack {
+namespace math {
+
+/**
+ * The exponential function computed with std::exp().  This is the default
+ * exponential policy of the classes which take one (like EMFit and
+ * NaiveKernelRule), so their results do not change unless FastExp is asked
+ * for.
+ */
+class ExactExp
+{
+ public:
+  //! Compute exp(x).
+  static double Evaluate(const double x) { return std::exp(x); }
+
+  //! Replace each element of the given matrix with its exponential.
+  static void Apply(arma::mat& values) { values = arma::exp(values); }
+};
+
+/**
+ * The exponential function computed with a polynomial approximation, for loops
+ * which call exp() on every element (like the construction of a Gaussian
+ * kernel matrix, or the E-step of EM) and do not need the last bits of
+ * precision.  x is reduced to x = k log(2) + r, with |r| <= log(2) / 2; then
+ * exp(r) is approximated by its Taylor polynomial of the given degree, and
+ * multiplied by 2^k by setting the exponent bits of the result.  There is no
+ * call and no table lookup, so the loop of Apply() can be vectorized by the
+ * compiler.
+ *
+ * The degree sets the accuracy.  The largest relative error is about 6e-5 for
+ * degree 4, 7e-9 for degree 7 (the default), 3e-13 for degree 10, and is
+ * within a few ulps of std::exp() for degree 12.  For x <= -708, where exp(x)
+ * is subnormal, 0 is returned; for x >= 709, where exp(x) overflows, and for
+ * NaN, std::exp() is used.
+ *
+ * @code
+ * // Construct a Gaussian kernel matrix with the fast exponential.
+ * arma::mat kernelMatrix;
+ * kpca::NaiveKernelRule<kernel::GaussianKernel, math::FastExp<> >::
+ *     KernelMatrix(data, kernel, kernelMatrix);
+ * @endcode
+ *
+ * @tparam Degree Degree of the polynomial approximation.
+ */
+template<size_t Degree = 7>
+class FastExp
+{
+ public:
+  //! Compute an approximation of exp(x).
+  static double Evaluate(const double x)
+  {
+    if (!(x < 709.0))
+      return std::exp(x);
+
+    return Approximate(x);
+  }
+
+  //! Replace each element of the given matrix with an approximation of its
+  //! exponential.
+  static void Apply(arma::mat& values)
+  {
+    double* x = values.memptr();
+    const size_t n = values.n_elem;
+
+    // Check the range first, so that the loop over the values has no branch
+    // in the common case.
+    bool inRange = true;
+    for (size_t i = 0; i < n; ++i)
+      inRange &= (x[i] < 709.0);
+
+    if (inRange)
+    {
+      for (size_t i = 0; i < n; ++i)
+        x[i] = Approximate(x[i]);
+    }
+    else
+    {
+      for (size_t i = 0; i < n; ++i)
+        x[i] = Evaluate(x[i]);
+    }
+  }
+
+ private:
+  //! Approximate exp(x), for x < 709 (not NaN).
+  static double Approximate(const double x)
+  {
+    // log(2), split in two so that k log(2) is exact in the first part
+    // (Cody and Waite's reduction).
+    const double log2e = 1.44269504088896338700;
+    const double ln2Hi = 6.93147180369123816490e-01;
+    const double ln2Lo = 1.90821492927058770002e-10;
+
+    // Clamp x, so that 2^k below is a normal double; the result is replaced
+    // with 0 if x was clamped.
+    const double y = std::max(x, -708.0);
+    const double k = std::floor(y * log2e + 0.5);
+    const double r = (y - k * ln2Hi) - k * ln2Lo;
+
+    // 1 + r (1 + r / 2 (1 + r / 3 (...))).
+    double p = 1.0;
+    for (size_t d = Degree; d > 0; --d)
+      p = 1.0 + p * (r * (1.0 / d));
+
+    // Multiply by 2^k; k is in [-1021, 1023], so 2^k is a normal double.
+    const uint64_t bits = uint64_t((long long) k + 1023) << 52;
+    double scale;
+    std::memcpy(&scale, &bits, sizeof(double));
+
+    return (x > -708.0) ? p * scale : 0.0;
+  }
+};
+
+}; // namespace math
+}; // namespace mlpack
+
+#endif
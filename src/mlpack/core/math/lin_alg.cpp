@@ -10,6 +10,11 @@
 using namespace mlpack;
 using namespace math;
 
+//! The number of columns summed together by one thread.
+static const size_t ColumnBlockSize = 256;
+//! The number of elements above which the computations are done in parallel.
+static const size_t ParallelSize = 100000;
+
 /**
  * Auxiliary function to raise vector elements to a specific power.  The sign
  * is ignored in the power operation and then re-added.  Useful for
@@ -27,6 +32,170 @@ void mlpack::math::VectorPower(arma::vec& vec, const double power)
   }
 }
 
+/**
+ * Sum the columns of a matrix, each multiplied by its weight if weights is not
+ * NULL.  One partial sum is computed for each block (in parallel for large
+ * matrices), and they are added in order afterwards, so the result is the same
+ * for any number of threads.
+ */
+static void SumColumns(const arma::mat& x,
+                       const arma::vec* weights,
+                       arma::vec& sum)
+{
+  const size_t numBlocks = (x.n_cols + ColumnBlockSize - 1) / ColumnBlockSize;
+  arma::mat blockSums(x.n_rows, numBlocks);
+
+  #pragma omp parallel for schedule(static) if (x.n_elem >= ParallelSize)
+  for (size_t b = 0; b < numBlocks; ++b)
+  {
+    const size_t begin = b * ColumnBlockSize;
+    const size_t end = std::min(begin + ColumnBlockSize, (size_t) x.n_cols);
+
+    double* blockSum = blockSums.colptr(b);
+    for (size_t d = 0; d < x.n_rows; ++d)
+      blockSum[d] = 0.0;
+
+    for (size_t i = begin; i < end; ++i)
+    {
+      const double* column = x.colptr(i);
+      const double weight = (weights == NULL) ? 1.0 : (*weights)[i];
+      for (size_t d = 0; d < x.n_rows; ++d)
+        blockSum[d] += weight * column[d];
+    }
+  }
+
+  sum.zeros(x.n_rows);
+  for (size_t b = 0; b < numBlocks; ++b)
+    sum += blockSums.unsafe_col(b);
+}
+
+/**
+ * Sum the outer products of the columns of a matrix, centered on the given
+ * mean and each multiplied by its weight if weights is not NULL.  Each block of
+ * columns is centered (and scaled by the square roots of the weights) in a
+ * thread-local buffer, and its outer products are added with one matrix
+ * product.
+ */
+static void SumOuterProducts(const arma::mat& x,
+                             const arma::vec* weights,
+                             const arma::vec& mean,
+                             arma::mat& sum)
+{
+  const size_t numBlocks = (x.n_cols + ColumnBlockSize - 1) / ColumnBlockSize;
+
+#ifdef _OPENMP
+  const size_t threads = (x.n_elem >= ParallelSize) ? util::NumThreads() :
+      1;
+#else
+  const size_t threads = 1;
+#endif
+
+  // Each thread accumulates the outer products of its blocks.
+  std::vector<arma::mat> threadSums(threads);
+
+  #pragma omp parallel num_threads(threads)
+  {
+#ifdef _OPENMP
+    const size_t thread = omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+
+    threadSums[thread].zeros(x.n_rows, x.n_rows);
+    arma::mat block;
+
+    #pragma omp for schedule(static)
+    for (size_t b = 0; b < numBlocks; ++b)
+    {
+      const size_t begin = b * ColumnBlockSize;
+      const size_t end = std::min(begin + ColumnBlockSize, (size_t) x.n_cols);
+
+      block.set_size(x.n_rows, end - begin);
+      for (size_t i = begin; i < end; ++i)
+      {
+        const double* column = x.colptr(i);
+        double* centered = block.colptr(i - begin);
+        const double scale = (weights == NULL) ? 1.0 :
+            std::sqrt((*weights)[i]);
+        for (size_t d = 0; d < x.n_rows; ++d)
+          centered[d] = scale * (column[d] - mean[d]);
+      }
+
+      threadSums[thread] += block * trans(block);
+    }
+  }
+
+  sum = threadSums[0];
+  for (size_t t = 1; t < threads; ++t)
+    sum += threadSums[t];
+}
+
+/**
+ * Compute the mean of the columns of a matrix, summing blocks of columns in
+ * parallel.
+ */
+void mlpack::math::Mean(const arma::mat& x, arma::vec& mean)
+{
+  SumColumns(x, NULL, mean);
+
+  if (x.n_cols > 0)
+    mean /= x.n_cols;
+}
+
+/**
+ * Compute the covariance matrix of the columns of a matrix, centering and
+ * accumulating one block of columns at a time.
+ */
+void mlpack::math::Covariance(const arma::mat& x, arma::mat& covariance)
+{
+  arma::vec mean;
+  Mean(x, mean);
+
+  SumOuterProducts(x, NULL, mean, covariance);
+
+  if (x.n_cols > 1)
+    covariance /= (x.n_cols - 1);
+}
+
+/**
+ * Compute the weighted mean of the columns of a matrix.
+ */
+void mlpack::math::Mean(const arma::mat& x,
+                        const arma::vec& weights,
+                        arma::vec& mean)
+{
+  Log::Assert(weights.n_elem == x.n_cols);
+
+  SumColumns(x, &weights, mean);
+
+  const double sumWeights = arma::accu(weights);
+  if (sumWeights > 0.0)
+    mean /= sumWeights;
+  else
+    mean.zeros();
+}
+
+/**
+ * Compute the weighted mean and covariance matrix of the columns of a matrix.
+ */
+void mlpack::math::Covariance(const arma::mat& x,
+                              const arma::vec& weights,
+                              arma::vec& mean,
+                              arma::mat& covariance)
+{
+  Mean(x, weights, mean);
+
+  const double sumWeights = arma::accu(weights);
+  if (sumWeights == 0.0)
+  {
+    covariance.zeros(x.n_rows, x.n_rows);
+    return;
+  }
+
+  SumOuterProducts(x, &weights, mean, covariance);
+  covariance /= sumWeights;
+}
+
 /**
  * Creates a centered matrix, where centering is done by subtracting
  * the sum over the columns (a column vector) from each column of the matrix.
@@ -37,9 +206,28 @@ void mlpack::math::VectorPower(arma::vec& vec, const double power)
 void mlpack::math::Center(const arma::mat& x, arma::mat& xCentered)
 {
   // Get the mean of the elements in each row.
-  arma::vec rowMean = arma::sum(x, 1) / x.n_cols;
+  arma::vec rowMean;
+  Mean(x, rowMean);
 
-  xCentered = x - arma::repmat(rowMean, 1, x.n_cols);
+  // This does nothing if x and xCentered are the same matrix.
+  xCentered.set_size(x.n_rows, x.n_cols);
+
+  #pragma omp parallel for schedule(static) if (x.n_elem >= ParallelSize)
+  for (size_t i = 0; i < x.n_cols; ++i)
+  {
+    const double* column = x.colptr(i);
+    double* centered = xCentered.colptr(i);
+    for (size_t d = 0; d < x.n_rows; ++d)
+      centered[d] = column[d] - rowMean[d];
+  }
+}
+
+/**
+ * Center a matrix in-place.
+ */
+void mlpack::math::Center(arma::mat& x)
+{
+  Center(x, x);
 }
 
 /**
@@ -54,7 +242,7 @@ void mlpack::math::WhitenUsingSVD(const arma::mat& x,
   arma::mat covX, u, v, invSMatrix, temp1;
   arma::vec sVector;
 
-  covX = ccov(x);
+  Covariance(x, covX);
 
   svd(u, sVector, v, covX);
 
@@ -75,11 +263,12 @@ void mlpack::math::WhitenUsingEig(const arma::mat& x,
                                   arma::mat& xWhitened,
                                   arma::mat& whiteningMatrix)
 {
-  arma::mat diag, eigenvectors;
+  arma::mat diag, eigenvectors, covX;
   arma::vec eigenvalues;
 
   // Get eigenvectors of covariance of input matrix.
-  eig_sym(eigenvalues, eigenvectors, ccov(x));
+  Covariance(x, covX);
+  eig_sym(eigenvalues, eigenvectors, covX);
 
   // Generate diagonal matrix using 1 / sqrt(eigenvalues) for each value.
   VectorPower(eigenvalues, -0.5);
@@ -127,9 +316,10 @@ void mlpack::math::Orthogonalize(const arma::mat& x, arma::mat& W)
 {
   // For a matrix A, A^N = V * D^N * V', where VDV' is the
   // eigendecomposition of the matrix A.
-  arma::mat eigenvalues, eigenvectors;
+  arma::mat eigenvalues, eigenvectors, covX;
   arma::vec egval;
-  eig_sym(egval, eigenvectors, ccov(x));
+  Covariance(x, covX);
+  eig_sym(egval, eigenvectors, covX);
   VectorPower(egval, -0.5);
 
   eigenvalues.zeros(egval.n_elem, egval.n_elem);
@@ -141,14 +331,45 @@ void mlpack::math::Orthogonalize(const arma::mat& x, arma::mat& W)
 }
 
 /**
- * Orthogonalize x in-place.  This could be sped up by a custom
- * implementation.
+ * Orthogonalize x in-place.
  */
 void mlpack::math::Orthogonalize(arma::mat& x)
 {
   Orthogonalize(x, x);
 }
 
+/**
+ * Generate a random rotation of R^d.
+ */
+void mlpack::math::RandomBasis(arma::mat& basis, const size_t d)
+{
+  while (true)
+  {
+    // [Q, R] = qr(randn(d, d));
+    // Q = Q * diag(sign(diag(R)));
+    arma::mat r;
+    if (arma::qr(basis, r, arma::randn<arma::mat>(d, d)))
+    {
+      arma::vec rDiag(r.n_rows);
+      for (size_t i = 0; i < rDiag.n_elem; ++i)
+      {
+        if (r(i, i) < 0)
+          rDiag(i) = -1;
+        else if (r(i, i) > 0)
+          rDiag(i) = 1;
+        else
+          rDiag(i) = 0;
+      }
+
+      basis *= arma::diagmat(rDiag);
+
+      // Check if the determinant is positive.
+      if (arma::det(basis) >= 0)
+        break;
+    }
+  }
+}
+
 /**
  * Remove a certain set of rows in a matrix while copying to a second matrix.
  *
@@ -22,15 +22,73 @@ namespace math {
  */
 void VectorPower(arma::vec& vec, const double power);
 
+/**
+ * Compute the mean of the columns of a matrix.  The columns are summed in
+ * blocks, in parallel for large matrices, and the block sums are added in a
+ * fixed order, so the result does not depend on the number of threads.
+ *
+ * @param x Input matrix (one point per column).
+ * @param mean Vector to store the mean in.
+ */
+void Mean(const arma::mat& x, arma::vec& mean);
+
+/**
+ * Compute the covariance matrix of the columns of a matrix (normalized by
+ * n - 1, like arma::ccov()), without making a centered copy of the whole
+ * matrix: blocks of columns are centered and accumulated one at a time, in
+ * parallel for large matrices.
+ *
+ * @param x Input matrix (one point per column).
+ * @param covariance Matrix to store the covariance in.
+ */
+void Covariance(const arma::mat& x, arma::mat& covariance);
+
+/**
+ * Compute the weighted mean of the columns of a matrix (normalized by the sum
+ * of the weights), in blocks like the unweighted Mean().  If the weights sum to
+ * zero, the mean is zero.
+ *
+ * @param x Input matrix (one point per column).
+ * @param weights Non-negative weight of each point.
+ * @param mean Vector to store the weighted mean in.
+ */
+void Mean(const arma::mat& x, const arma::vec& weights, arma::vec& mean);
+
+/**
+ * Compute the weighted mean and the weighted covariance matrix of the columns
+ * of a matrix, both normalized by the sum of the weights (this is the maximum
+ * likelihood estimate used by EM).  Neither the matrix nor the weights are
+ * copied or scaled as a whole: each block of columns is centered and scaled by
+ * the square roots of the weights in a small buffer, in parallel for large
+ * matrices.  If the weights sum to zero, the mean and covariance are zero.
+ *
+ * @param x Input matrix (one point per column).
+ * @param weights Non-negative weight of each point.
+ * @param mean Vector to store the weighted mean in.
+ * @param covariance Matrix to store the weighted covariance in.
+ */
+void Covariance(const arma::mat& x,
+                const arma::vec& weights,
+                arma::vec& mean,
+                arma::mat& covariance);
+
 /**
  * Creates a centered matrix, where centering is done by subtracting
  * the sum over the columns (a column vector) from each column of the matrix.
+ * x and xCentered may be the same matrix.
  *
  * @param x Input matrix
  * @param xCentered Matrix to write centered output into
  */
 void Center(const arma::mat& x, arma::mat& xCentered);
 
+/**
+ * Center a matrix in-place, so no second matrix is allocated.
+ *
+ * @param x Matrix to center.
+ */
+void Center(arma::mat& x);
+
 /**
  * Whitens a matrix using the singular value decomposition of the covariance
  * matrix. Whitening means the covariance matrix of the result is the identity
@@ -60,11 +118,19 @@ void RandVector(arma::vec& v);
 void Orthogonalize(const arma::mat& x, arma::mat& W);
 
 /**
- * Orthogonalize x in-place.  This could be sped up by a custom
- * implementation.
+ * Orthogonalize x in-place.
  */
 void Orthogonalize(arma::mat& x);
 
+/**
+ * Generate a uniformly random orthogonal basis of R^d with determinant 1 (a
+ * random rotation), from the QR decomposition of a Gaussian matrix.
+ *
+ * @param basis Matrix to store the basis in (d x d).
+ * @param d Dimensionality of the basis.
+ */
+void RandomBasis(arma::mat& basis, const size_t d);
+
 /**
  * Remove a certain set of rows in a matrix while copying to a second matrix.
  *
@@ -0,0 +1,80 @@
+/**
+ * @file quantile_bins.cpp
+ *
+ * Implementation of the QuantileBins class.
+ */
+#include "quantile_bins.hpp"
+#include <mlpack/core.hpp>
+
+using namespace mlpack;
+using namespace mlpack::math;
+
+QuantileBins::QuantileBins(const arma::mat& data,
+                           const size_t maxBins,
+                           const size_t sampleSize) :
+    edges(data.n_rows)
+{
+  if (maxBins < 2 || maxBins > MaxBins)
+    Log::Fatal << "QuantileBins::QuantileBins(): the number of bins must be "
+        << "between 2 and " << MaxBins << " (" << maxBins << " given)."
+        << std::endl;
+  if (data.n_cols == 0)
+    return;
+
+  // Take every step-th point, so that at most sampleSize points are sampled.
+  const size_t step = (data.n_cols + sampleSize - 1) / std::max(sampleSize,
+      (size_t) 1);
+  const size_t samples = (data.n_cols + step - 1) / step;
+
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t dim = 0; dim < data.n_rows; ++dim)
+  {
+    arma::vec sample(samples);
+    for (size_t i = 0; i < samples; ++i)
+      sample[i] = data(dim, i * step);
+    sample = arma::sort(sample);
+
+    // The k-th edge is the smallest sampled value which is at least as large
+    // as k / maxBins of the sample.  Equal quantiles give one edge, and the
+    // largest value gives none, since nothing sampled is above it.
+    std::vector<double> dimEdges;
+    for (size_t k = 1; k < maxBins; ++k)
+    {
+      const size_t index = (k * samples + maxBins - 1) / maxBins;
+      if (index == 0)
+        continue;
+
+      const double edge = sample[index - 1];
+      if (edge < sample[samples - 1] &&
+          (dimEdges.empty() || edge > dimEdges.back()))
+        dimEdges.push_back(edge);
+    }
+
+    edges[dim] = arma::conv_to<arma::vec>::from(dimEdges);
+  }
+}
+
+void QuantileBins::Quantize(const arma::mat& data,
+                            arma::Mat<unsigned char>& bins) const
+{
+  if (data.n_rows != edges.size())
+    Log::Fatal << "QuantileBins::Quantize(): the data has " << data.n_rows
+        << " dimensions, but the bins have " << edges.size() << "."
+        << std::endl;
+
+  bins.set_size(data.n_rows, data.n_cols);
+
+  #pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < data.n_cols; ++i)
+    for (size_t dim = 0; dim < data.n_rows; ++dim)
+      bins(dim, i) = (unsigned char) Bin(dim, data(dim, i));
+}
+
+size_t QuantileBins::MaxNumBins() const
+{
+  size_t bins = 1;
+  for (size_t dim = 0; dim < edges.size(); ++dim)
+    bins = std::max(bins, NumBins(dim));
+
+  return bins;
+}
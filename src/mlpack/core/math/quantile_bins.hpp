@@ -0,0 +1,94 @@
+/**
+ * @file quantile_bins.hpp
+ *
+ * Definition of the QuantileBins class, which quantizes each dimension of a
+ * dataset into a small number of bins of roughly equal population.
+ */
+#ifndef __MLPACK_CORE_MATH_QUANTILE_BINS_HPP
+#define __MLPACK_CORE_MATH_QUANTILE_BINS_HPP
+
+#include <mlpack/prereqs.hpp>
+#include <algorithm>
+
+namespace mlpack {
+namespace math {
+
+/**
+ * Bins for each dimension of a dataset, at (approximate) quantiles of the
+ * values of that dimension, so that each bin holds about the same number of
+ * points.  This is what histogram-based split search (as in DTree and
+ * DecisionStump) uses: the points are quantized once, and then the best split
+ * of a node is searched among the bin edges only, by a scan of a histogram of
+ * the node, instead of among all the values, which have to be sorted.
+ *
+ * The bins of a dimension are given by its edges e_0 < e_1 < ... < e_{k-1}:
+ * bin b holds the values in (e_{b-1}, e_b], so that the values of bins 0 to b
+ * are exactly the values which are at most e_b.  The quantiles are taken from
+ * a sample of the values of each dimension (every (n / sampleSize)-th value,
+ * so the bins do not depend on the random seed), which bounds the time and
+ * memory taken for large datasets.  If a dimension has fewer distinct values
+ * than bins (and all of them are sampled), each value gets its own bin, so
+ * splits on the edges are exact.
+ *
+ * @code
+ * math::QuantileBins quantizer(data, 256);
+ * arma::Mat<unsigned char> bins;
+ * quantizer.Quantize(data, bins);
+ * @endcode
+ */
+class QuantileBins
+{
+ public:
+  //! The largest number of bins of a dimension (so a bin fits in a byte).
+  static const size_t MaxBins = 256;
+
+  //! Create empty bins (with no dimensions).
+  QuantileBins() { }
+
+  /**
+   * Find the bins of each dimension of the given data.
+   *
+   * @param data Dataset (one point per column).
+   * @param maxBins Maximum number of bins of each dimension (at most 256).
+   * @param sampleSize Number of values of each dimension to find the
+   *     quantiles of; all of them are used if there are not more.
+   */
+  QuantileBins(const arma::mat& data,
+               const size_t maxBins = MaxBins,
+               const size_t sampleSize = 65536);
+
+  //! Get the bin of the given value in the given dimension.
+  size_t Bin(const size_t dim, const double value) const
+  {
+    const arma::vec& dimEdges = edges[dim];
+    return std::lower_bound(dimEdges.memptr(), dimEdges.memptr() +
+        dimEdges.n_elem, value) - dimEdges.memptr();
+  }
+
+  /**
+   * Get the bin of each value of the given data (in parallel, with OpenMP).
+   *
+   * @param data Dataset to quantize (with the dimensionality of the bins).
+   * @param bins Matrix to store the bin of each value in.
+   */
+  void Quantize(const arma::mat& data, arma::Mat<unsigned char>& bins) const;
+
+  //! Get the number of dimensions.
+  size_t Dimensionality() const { return edges.size(); }
+  //! Get the number of bins of the given dimension.
+  size_t NumBins(const size_t dim) const { return edges[dim].n_elem + 1; }
+  //! Get the largest number of bins of any dimension.
+  size_t MaxNumBins() const;
+  //! Get the edges of the bins of the given dimension (the largest value of
+  //! each bin but the last).
+  const arma::vec& Edges(const size_t dim) const { return edges[dim]; }
+
+ private:
+  //! The edges of the bins of each dimension.
+  std::vector<arma::vec> edges;
+};
+
+}; // namespace math
+}; // namespace mlpack
+
+#endif
@@ -38,6 +38,16 @@ namespace math /** Miscellaneous math routines. */ {
   extern boost::normal_distribution<> randNormalDist;
 #endif
 
+/**
+ * The functions below draw from the global generator randGen, so they must not
+ * be called from several threads at once.  Parallel code should instead draw
+ * from independent streams (see RandomStream): take one key from the global
+ * generator with NewStreamKey() before the parallel region, and give each unit
+ * of work (not each thread) the stream with its own index.  The results then
+ * only depend on the seed given to RandomSeed(), and not on the number of
+ * threads or the order the units are run in.
+ */
+
 /**
  * Set the random seed used by the random functions (Random() and RandInt()).
  * The seed is casted to a 32-bit integer before being given to the random
@@ -136,6 +146,93 @@ inline double RandNormal(const double mean, const double variance)
   return variance * randNormalDist(randGen) + mean;
 }
 
+/**
+ * Draw the key of a new family of random number streams from the global
+ * generator.  This must be called serially, like the other global functions.
+ */
+inline uint64_t NewStreamKey()
+{
+  const uint64_t high = (uint64_t) randGen();
+  return (high << 32) | (uint64_t) randGen();
+}
+
+/**
+ * Return the seed of the given stream of a family of random number streams.
+ * This is a pure function of the key and the stream index, so streams can be
+ * created in any order, by any thread.  The key and the index are combined by
+ * the SplitMix64 finalizer, which scatters consecutive indices over the whole
+ * seed space.
+ *
+ * @param key Key of the family of streams (see NewStreamKey()).
+ * @param stream Index of the stream.
+ */
+inline uint32_t StreamSeed(const uint64_t key, const uint64_t stream)
+{
+  uint64_t z = key + (stream + 1) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return (uint32_t) ((z ^ (z >> 31)) >> 32);
+}
+
+/**
+ * An independent stream of random numbers, with its own generator, for use by
+ * one thread at a time.  It offers the same functions as the global generator.
+ *
+ * @code
+ * const uint64_t key = math::NewStreamKey();
+ * #pragma omp parallel for
+ * for (size_t i = 0; i < n; ++i)
+ * {
+ *   math::RandomStream stream(key, i);
+ *   values[i] = stream.RandNormal();
+ * }
+ * @endcode
+ */
+class RandomStream
+{
+ public:
+  /**
+   * Create the given stream of the family of streams with the given key.
+   *
+   * @param key Key of the family of streams (see NewStreamKey()).
+   * @param stream Index of the stream.
+   */
+  RandomStream(const uint64_t key, const uint64_t stream) :
+      generator(StreamSeed(key, stream)) { }
+
+  //! Generate a uniform random number between 0 and 1.
+  double Random() { return uniformDist(generator); }
+
+  //! Generate a uniform random number in the specified range.
+  double Random(const double lo, const double hi)
+  { return lo + (hi - lo) * uniformDist(generator); }
+
+  //! Generate a uniform random integer in [0, hiExclusive).
+  int RandInt(const int hiExclusive)
+  { return (int) std::floor((double) hiExclusive * uniformDist(generator)); }
+
+  //! Generate a uniform random integer in [lo, hiExclusive).
+  int RandInt(const int lo, const int hiExclusive)
+  {
+    return lo + (int) std::floor((double) (hiExclusive - lo) *
+        uniformDist(generator));
+  }
+
+  //! Generate a normally distributed random number with mean 0 and variance 1.
+  double RandNormal() { return normalDist(generator); }
+
+  //! Modify the underlying generator (to use it with other distributions).
+  boost::mt19937& Generator() { return generator; }
+
+ private:
+  //! The generator of this stream.
+  boost::mt19937 generator;
+  //! The uniform distribution.
+  boost::uniform_01<> uniformDist;
+  //! The normal distribution (it keeps the second value of each pair).
+  boost::normal_distribution<> normalDist;
+};
+
 }; // namespace math
 }; // namespace mlpack
 
@@ -9,6 +9,7 @@
 
 // In case it hasn't been included.
 #include "lmetric.hpp"
+#include "lmetric_kernels.hpp"
 
 namespace mlpack {
 namespace metric {
@@ -55,19 +56,20 @@ double LMetric<1, false>::Evaluate(const VecType1& a, const VecType2& b)
   return accu(abs(a - b));
 }
 
-// L2-metric specializations.
+// L2-metric specializations.  Dense vectors of doubles or floats use the
+// vectorized kernel in lmetric_kernels.hpp.
 template<>
 template<typename VecType1, typename VecType2>
 double LMetric<2, true>::Evaluate(const VecType1& a, const VecType2& b)
 {
-  return sqrt(accu(square(a - b)));
+  return sqrt(SquaredEuclideanEvaluator<VecType1, VecType2>::Evaluate(a, b));
 }
 
 template<>
 template<typename VecType1, typename VecType2>
 double LMetric<2, false>::Evaluate(const VecType1& a, const VecType2& b)
 {
-  return accu(square(a - b));
+  return SquaredEuclideanEvaluator<VecType1, VecType2>::Evaluate(a, b);
 }
 
 // L3-metric specialization (not very likely to be used, but just in case).
@@ -0,0 +1,339 @@
+/**
+ * @file lmetric_kernels.hpp
+ *
+ * Vectorized kernels for the squared Euclidean distance between dense vectors
+ * of doubles or floats, which the L2 specializations of LMetric use, and a
+ * block kernel that computes all pairwise squared Euclidean distances between
+ * two sets of points.
+ *
+ * When mlpack is compiled for a processor with AVX-512 or AVX (for instance
+ * with the NATIVE_ARCH CMake option, which adds -march=native), the kernels use
+ * explicitly vectorized code.  Otherwise, they use a loop with several
+ * independent accumulators.
+ */
+#ifndef __MLPACK_CORE_METRICS_LMETRIC_KERNELS_HPP
+#define __MLPACK_CORE_METRICS_LMETRIC_KERNELS_HPP
+
+#include <mlpack/core.hpp>
+
+#if defined(__AVX512F__) || defined(__AVX__)
+  #include <immintrin.h>
+#endif
+
+namespace mlpack {
+namespace metric {
+
+#if defined(__AVX512F__)
+
+//! Add the squared differences of a and b to acc.
+inline __m512d SquaredDifferenceAdd(const __m512d acc,
+                                    const __m512d a,
+                                    const __m512d b)
+{
+  const __m512d d = _mm512_sub_pd(a, b);
+  return _mm512_fmadd_pd(d, d, acc);
+}
+
+//! Add the squared differences of a and b to acc.
+inline __m512 SquaredDifferenceAdd(const __m512 acc,
+                                   const __m512 a,
+                                   const __m512 b)
+{
+  const __m512 d = _mm512_sub_ps(a, b);
+  return _mm512_fmadd_ps(d, d, acc);
+}
+
+#elif defined(__AVX__)
+
+//! Add the squared differences of a and b to acc.
+inline __m256d SquaredDifferenceAdd(const __m256d acc,
+                                    const __m256d a,
+                                    const __m256d b)
+{
+  const __m256d d = _mm256_sub_pd(a, b);
+#ifdef __FMA__
+  return _mm256_fmadd_pd(d, d, acc);
+#else
+  return _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+#endif
+}
+
+//! Add the squared differences of a and b to acc.
+inline __m256 SquaredDifferenceAdd(const __m256 acc,
+                                   const __m256 a,
+                                   const __m256 b)
+{
+  const __m256 d = _mm256_sub_ps(a, b);
+#ifdef __FMA__
+  return _mm256_fmadd_ps(d, d, acc);
+#else
+  return _mm256_add_ps(acc, _mm256_mul_ps(d, d));
+#endif
+}
+
+#endif
+
+/**
+ * Return the squared Euclidean distance between the n-element arrays a and b.
+ *
+ * @param a First array.
+ * @param b Second array.
+ * @param n Number of elements in each array.
+ */
+inline double SquaredDistanceKernel(const double* a,
+                                    const double* b,
+                                    const size_t n)
+{
+  size_t i = 0;
+  double sum;
+
+#if defined(__AVX512F__)
+  __m512d acc0 = _mm512_setzero_pd();
+  __m512d acc1 = _mm512_setzero_pd();
+  for (; i + 16 <= n; i += 16)
+  {
+    acc0 = SquaredDifferenceAdd(acc0, _mm512_loadu_pd(a + i),
+        _mm512_loadu_pd(b + i));
+    acc1 = SquaredDifferenceAdd(acc1, _mm512_loadu_pd(a + i + 8),
+        _mm512_loadu_pd(b + i + 8));
+  }
+  if (i + 8 <= n)
+  {
+    acc0 = SquaredDifferenceAdd(acc0, _mm512_loadu_pd(a + i),
+        _mm512_loadu_pd(b + i));
+    i += 8;
+  }
+  sum = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+#elif defined(__AVX__)
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  for (; i + 8 <= n; i += 8)
+  {
+    acc0 = SquaredDifferenceAdd(acc0, _mm256_loadu_pd(a + i),
+        _mm256_loadu_pd(b + i));
+    acc1 = SquaredDifferenceAdd(acc1, _mm256_loadu_pd(a + i + 4),
+        _mm256_loadu_pd(b + i + 4));
+  }
+  if (i + 4 <= n)
+  {
+    acc0 = SquaredDifferenceAdd(acc0, _mm256_loadu_pd(a + i),
+        _mm256_loadu_pd(b + i));
+    i += 4;
+  }
+  double lanes[4];
+  _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+  sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+  double sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+  for (; i + 4 <= n; i += 4)
+  {
+    const double d0 = a[i] - b[i];
+    const double d1 = a[i + 1] - b[i + 1];
+    const double d2 = a[i + 2] - b[i + 2];
+    const double d3 = a[i + 3] - b[i + 3];
+    sum0 += d0 * d0;
+    sum1 += d1 * d1;
+    sum2 += d2 * d2;
+    sum3 += d3 * d3;
+  }
+  sum = (sum0 + sum1) + (sum2 + sum3);
+#endif
+
+  // Now handle the elements that did not fill a whole vector.
+  for (; i < n; ++i)
+  {
+    const double d = a[i] - b[i];
+    sum += d * d;
+  }
+
+  return sum;
+}
+
+/**
+ * Return the squared Euclidean distance between the n-element arrays a and b.
+ * The sum is accumulated in single precision.
+ *
+ * @param a First array.
+ * @param b Second array.
+ * @param n Number of elements in each array.
+ */
+inline double SquaredDistanceKernel(const float* a,
+                                    const float* b,
+                                    const size_t n)
+{
+  size_t i = 0;
+  float sum;
+
+#if defined(__AVX512F__)
+  __m512 acc0 = _mm512_setzero_ps();
+  __m512 acc1 = _mm512_setzero_ps();
+  for (; i + 32 <= n; i += 32)
+  {
+    acc0 = SquaredDifferenceAdd(acc0, _mm512_loadu_ps(a + i),
+        _mm512_loadu_ps(b + i));
+    acc1 = SquaredDifferenceAdd(acc1, _mm512_loadu_ps(a + i + 16),
+        _mm512_loadu_ps(b + i + 16));
+  }
+  if (i + 16 <= n)
+  {
+    acc0 = SquaredDifferenceAdd(acc0, _mm512_loadu_ps(a + i),
+        _mm512_loadu_ps(b + i));
+    i += 16;
+  }
+  sum = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+#elif defined(__AVX__)
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  for (; i + 16 <= n; i += 16)
+  {
+    acc0 = SquaredDifferenceAdd(acc0, _mm256_loadu_ps(a + i),
+        _mm256_loadu_ps(b + i));
+    acc1 = SquaredDifferenceAdd(acc1, _mm256_loadu_ps(a + i + 8),
+        _mm256_loadu_ps(b + i + 8));
+  }
+  if (i + 8 <= n)
+  {
+    acc0 = SquaredDifferenceAdd(acc0, _mm256_loadu_ps(a + i),
+        _mm256_loadu_ps(b + i));
+    i += 8;
+  }
+  float lanes[8];
+  _mm256_storeu_ps(lanes, _mm256_add_ps(acc0, acc1));
+  sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) +
+      ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+#else
+  float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+  for (; i + 4 <= n; i += 4)
+  {
+    const float d0 = a[i] - b[i];
+    const float d1 = a[i + 1] - b[i + 1];
+    const float d2 = a[i + 2] - b[i + 2];
+    const float d3 = a[i + 3] - b[i + 3];
+    sum0 += d0 * d0;
+    sum1 += d1 * d1;
+    sum2 += d2 * d2;
+    sum3 += d3 * d3;
+  }
+  sum = (sum0 + sum1) + (sum2 + sum3);
+#endif
+
+  // Now handle the elements that did not fill a whole vector.
+  for (; i < n; ++i)
+  {
+    const float d = a[i] - b[i];
+    sum += d * d;
+  }
+
+  return sum;
+}
+
+/**
+ * DenseColumn<VecType>::Value is true when VecType is an Armadillo column, row,
+ * or column view (such as the result of dataset.col(i) or
+ * dataset.unsafe_col(i)) of doubles or floats, whose elements are stored
+ * contiguously; then Memory() returns a pointer to the elements.
+ */
+template<typename VecType>
+struct DenseColumn
+{
+  static const bool Value = false;
+  typedef void ElemType;
+};
+
+//! The members of DenseColumn for dense types with elements of type eT.
+template<typename eT>
+struct DenseColumnOf
+{
+  static const bool Value = (boost::is_same<eT, double>::value ||
+                             boost::is_same<eT, float>::value);
+  typedef eT ElemType;
+};
+
+//! Armadillo columns.
+template<typename eT>
+struct DenseColumn<arma::Col<eT> > : public DenseColumnOf<eT>
+{
+  static const eT* Memory(const arma::Col<eT>& v) { return v.memptr(); }
+};
+
+//! Armadillo rows.
+template<typename eT>
+struct DenseColumn<arma::Row<eT> > : public DenseColumnOf<eT>
+{
+  static const eT* Memory(const arma::Row<eT>& v) { return v.memptr(); }
+};
+
+//! Armadillo column views.
+template<typename eT>
+struct DenseColumn<arma::subview_col<eT> > : public DenseColumnOf<eT>
+{
+  static const eT* Memory(const arma::subview_col<eT>& v) { return v.colmem; }
+};
+
+/**
+ * Compute the squared Euclidean distance between a and b.  If both are dense
+ * columns (see DenseColumn) of the same element type, SquaredDistanceKernel()
+ * is used; otherwise, an Armadillo expression is used.
+ */
+template<typename VecType1,
+         typename VecType2,
+         bool UseKernel = (DenseColumn<VecType1>::Value &&
+                           DenseColumn<VecType2>::Value &&
+                           boost::is_same<
+                               typename DenseColumn<VecType1>::ElemType,
+                               typename DenseColumn<VecType2>::ElemType
+                           >::value)>
+struct SquaredEuclideanEvaluator
+{
+  static double Evaluate(const VecType1& a, const VecType2& b)
+  {
+    return accu(square(a - b));
+  }
+};
+
+//! Dense vectors of the same element type use the vectorized kernel.
+template<typename VecType1, typename VecType2>
+struct SquaredEuclideanEvaluator<VecType1, VecType2, true>
+{
+  static double Evaluate(const VecType1& a, const VecType2& b)
+  {
+    return SquaredDistanceKernel(DenseColumn<VecType1>::Memory(a),
+        DenseColumn<VecType2>::Memory(b), a.n_elem);
+  }
+};
+
+/**
+ * Compute the squared Euclidean distances between each column of a and each
+ * column of b, storing them in distances (of size a.n_cols x b.n_cols), using
+ * the expansion ||a_i||^2 + ||b_j||^2 - 2 a_i^T b_j, so that almost all of the
+ * work is one matrix multiplication.  For large blocks this is much faster than
+ * computing each distance separately, but it is less accurate for points that
+ * are close together compared to their norms; negative results (from
+ * cancellation) are set to 0.
+ *
+ * @param a First set of points.
+ * @param b Second set of points.
+ * @param distances Matrix to store the squared distances in.
+ */
+template<typename eT>
+void SquaredDistanceBlock(const arma::Mat<eT>& a,
+                          const arma::Mat<eT>& b,
+                          arma::Mat<eT>& distances)
+{
+  const arma::Col<eT> aNorms = arma::trans(arma::sum(arma::square(a), 0));
+  const arma::Row<eT> bNorms = arma::sum(arma::square(b), 0);
+
+  distances = arma::trans(a) * b;
+  distances *= -2;
+  distances.each_col() += aNorms;
+  distances.each_row() += bNorms;
+
+  for (size_t i = 0; i < distances.n_elem; ++i)
+    if (distances[i] < 0)
+      distances[i] = 0;
+}
+
+}; // namespace metric
+}; // namespace mlpack
+
+#endif
@@ -27,8 +27,20 @@ namespace metric {
  *
  * Because each evaluation multiplies (x_1 - x_2) by the covariance matrix, it
  * may be much quicker to use an LMetric and simply stretch the actual dataset
- * itself before performing any evaluations.  However, this class is provided
- * for convenience.
+ * itself before performing any evaluations.  Factor() computes a matrix
+ * @f$ L @f$ with @f$ L^T L = Q @f$, so that
+ *
+ * @f[
+ * d(x, y) = || L x - L y ||_2;
+ * @f]
+ *
+ * Transform() applies it to a whole dataset.  A tree-based search with the
+ * (vectorized) Euclidean distance on the transformed dataset then returns
+ * exactly the neighbors and distances under this Mahalanobis distance; this is
+ * the fast way to search with a metric learned by NCA.  Only the symmetric part
+ * of Q matters for the distance, and if Q is singular, L has fewer rows than Q,
+ * so the transformed dataset also has fewer dimensions.  Evaluate() works on the
+ * original points, for convenience.
  *
  * Similar to the LMetric class, this offers a template parameter TakeRoot
  * which, when set to false, will instead evaluate the distance
@@ -52,7 +64,7 @@ class MahalanobisDistance
    * Initialize the Mahalanobis distance with the empty matrix as covariance.
    * Don't call Evaluate() until you set the covariance with Covariance()!
    */
-  MahalanobisDistance() { }
+  MahalanobisDistance() : factored(false) { }
 
   /**
    * Initialize the Mahalanobis distance with the identity matrix of the given
@@ -61,7 +73,8 @@ class MahalanobisDistance
    * @param dimensionality Dimesnsionality of the covariance matrix.
    */
   MahalanobisDistance(const size_t dimensionality) :
-      covariance(arma::eye<arma::mat>(dimensionality, dimensionality)) { }
+      covariance(arma::eye<arma::mat>(dimensionality, dimensionality)),
+      factored(false) { }
 
   /**
    * Initialize the Mahalanobis distance with the given covariance matrix.  The
@@ -69,7 +82,9 @@ class MahalanobisDistance
    *
    * @param covariance The covariance matrix to use for this distance.
    */
-  MahalanobisDistance(const arma::mat& covariance) : covariance(covariance) { }
+  MahalanobisDistance(const arma::mat& covariance) :
+      covariance(covariance),
+      factored(false) { }
 
   /**
    * Evaluate the distance between the two given points using this Mahalanobis
@@ -94,14 +109,44 @@ class MahalanobisDistance
   const arma::mat& Covariance() const { return covariance; }
 
   /**
-   * Modify the covariance matrix.
+   * Modify the covariance matrix.  This discards the factorization computed by
+   * Factor(), if any.
    *
    * @return Reference to the covariance matrix.
    */
-  arma::mat& Covariance() { return covariance; }
+  arma::mat& Covariance() { factored = false; return covariance; }
+
+  /**
+   * Factor the covariance matrix as Q = L^T L, where L has one row for each
+   * positive eigenvalue of the symmetric part of Q.  If Q has negative
+   * eigenvalues, it does not define a distance; they are ignored, with a
+   * warning.
+   */
+  void Factor();
+
+  /**
+   * Transform the given points by L (see Factor()), so that the Euclidean
+   * distance between two transformed points is the Mahalanobis distance
+   * between the original points.  The covariance matrix is factored first, if
+   * necessary.
+   *
+   * @param data Points to transform, one per column.
+   * @param transformed Matrix to store the transformed points in.
+   */
+  void Transform(const arma::mat& data, arma::mat& transformed);
+
+  //! Get the factor L of the covariance matrix (only valid after Factor()).
+  const arma::mat& Transformation() const { return transformation; }
+  //! Return whether the factor L is up to date with the covariance matrix.
+  bool Factored() const { return factored; }
+
  private:
   //! The covariance matrix associated with this distance.
   arma::mat covariance;
+  //! The factor L of the covariance matrix, with Q = L^T L.
+  arma::mat transformation;
+  //! Whether transformation has been computed for the current covariance.
+  bool factored;
 };
 
 }; // namespace distance
@@ -35,13 +35,58 @@ double MahalanobisDistance<true>::Evaluate(const VecType1& a,
 {
   // Check if covariance matrix has been initialized.
   if (covariance.n_rows == 0)
+  {
     covariance = arma::eye<arma::mat>(a.n_elem, a.n_elem);
+    factored = false;
+  }
 
   arma::vec m = (a - b);
   arma::mat out = trans(m) * covariance * m; // 1x1;
   return sqrt(out[0]);
 }
 
+template<bool TakeRoot>
+void MahalanobisDistance<TakeRoot>::Factor()
+{
+  // (x - y)^T Q (x - y) only depends on the symmetric part of Q, so that is what
+  // we factor: if (Q + Q^T) / 2 = V diag(lambda) V^T, then
+  // L = diag(sqrt(lambda)) V^T.
+  arma::vec eigval;
+  arma::mat eigvec;
+  arma::eig_sym(eigval, eigvec, 0.5 * (covariance + trans(covariance)));
+
+  // Eigenvalues which are zero up to rounding are dropped; this also removes
+  // the dimensions that a low-rank Q ignores.
+  const double tolerance = 1e-10 * std::max(arma::max(arma::abs(eigval)),
+      1.0);
+  if (arma::min(eigval) < -tolerance)
+  {
+    Log::Warn << "MahalanobisDistance::Factor(): covariance matrix is not "
+        << "positive semidefinite (smallest eigenvalue " << arma::min(eigval)
+        << "); ignoring its negative eigenvalues." << std::endl;
+  }
+
+  const arma::uvec positive = arma::find(eigval > tolerance);
+  transformation.set_size(positive.n_elem, covariance.n_cols);
+  for (size_t i = 0; i < positive.n_elem; ++i)
+  {
+    transformation.row(i) = std::sqrt(eigval[positive[i]]) *
+        trans(eigvec.col(positive[i]));
+  }
+
+  factored = true;
+}
+
+template<bool TakeRoot>
+void MahalanobisDistance<TakeRoot>::Transform(const arma::mat& data,
+                                              arma::mat& transformed)
+{
+  if (!factored)
+    Factor();
+
+  transformed = transformation * data;
+}
+
 // Convert object into string.
 template<bool TakeRoot>
 std::string MahalanobisDistance<TakeRoot>::ToString() const
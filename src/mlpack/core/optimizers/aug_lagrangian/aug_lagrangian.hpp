@@ -36,7 +36,9 @@ namespace optimization {
  * The number of constraints must be greater than or equal to 0, and
  * EvaluateConstraint() should evaluate the constraint at the given index for
  * the given coordinates.  Evaluate() should provide the objective function
- * value for the given coordinates.
+ * value for the given coordinates.  The constraints (and their gradients) are
+ * evaluated in parallel when there are many of them, so EvaluateConstraint()
+ * and GradientConstraint() must be safe to call from several threads at once.
  *
  * @tparam LagrangianFunction Function which can be optimized by this class.
  */
@@ -103,7 +105,8 @@ class AugLagrangian
   //! Modify the LagrangianFunction.
   LagrangianFunction& Function() { return function; }
 
-  //! Get the L-BFGS object used for the actual optimization.
+  //! Get the L-BFGS object used for the actual optimization.  Optimize() sets
+  //! its WarmStart() option before each inner solve.
   const L_BFGSType& LBFGS() const { return lbfgs; }
   //! Modify the L-BFGS object used for the actual optimization.
   L_BFGSType& LBFGS() { return lbfgs; }
@@ -71,6 +71,22 @@ class AugLagrangianFunction
    */
   void Gradient(const arma::mat& coordinates, arma::mat& gradient) const;
 
+  /**
+   * Evaluate every constraint at the given coordinates, and store c_i(x) in
+   * constraints[i].  The constraints are evaluated in parallel, in blocks of
+   * ConstraintBlockSize, so EvaluateConstraint() of the LagrangianFunction
+   * must be safe to call from several threads at once.
+   *
+   * @param coordinates Coordinates to evaluate the constraints at.
+   * @param constraints Vector to store the values of the constraints into.
+   */
+  void EvaluateConstraints(const arma::mat& coordinates,
+                           arma::vec& constraints) const;
+
+  //! The number of constraints each thread evaluates at once.  Problems with
+  //! fewer constraints than this are evaluated serially.
+  static const size_t ConstraintBlockSize = 256;
+
   /**
    * Get the initial point of the optimization (supplied by the
    * LagrangianFunction).
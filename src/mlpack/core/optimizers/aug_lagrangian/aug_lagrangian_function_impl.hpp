@@ -14,6 +14,72 @@
 
 namespace mlpack {
 namespace optimization {
+namespace aux {
+
+//! Evaluate one block of the constraints of a LagrangianFunction.
+template<typename LagrangianFunction>
+class ConstraintBlock
+{
+ public:
+  ConstraintBlock(LagrangianFunction& function,
+                  const arma::mat& coordinates,
+                  arma::vec& constraints,
+                  const size_t blockSize) :
+      function(function),
+      coordinates(coordinates),
+      constraints(constraints),
+      blockSize(blockSize) { }
+
+  void operator()(const size_t block)
+  {
+    const size_t end = std::min((block + 1) * blockSize,
+        (size_t) constraints.n_elem);
+    for (size_t i = block * blockSize; i < end; ++i)
+      constraints[i] = function.EvaluateConstraint(i, coordinates);
+  }
+
+ private:
+  LagrangianFunction& function;
+  const arma::mat& coordinates;
+  arma::vec& constraints;
+  size_t blockSize;
+};
+
+//! Add the gradients of one block of the constraints, scaled by
+//! (-lambda_i + sigma * c_i(x)), to a partial gradient.
+template<typename LagrangianFunction>
+class ConstraintGradientBlock
+{
+ public:
+  ConstraintGradientBlock(LagrangianFunction& function,
+                          const arma::mat& coordinates,
+                          const arma::vec& scales,
+                          const size_t blockSize) :
+      function(function),
+      coordinates(coordinates),
+      scales(scales),
+      blockSize(blockSize) { }
+
+  void operator()(const size_t block, arma::mat& gradient)
+  {
+    const size_t end = std::min((block + 1) * blockSize,
+        (size_t) scales.n_elem);
+    arma::mat constraintGradient;
+    for (size_t i = block * blockSize; i < end; ++i)
+    {
+      function.GradientConstraint(i, coordinates, constraintGradient);
+      gradient += scales[i] * constraintGradient;
+    }
+  }
+
+ private:
+  LagrangianFunction& function;
+  const arma::mat& coordinates;
+  const arma::vec& scales;
+  size_t blockSize;
+};
+
+}; // namespace aux
 
 // Initialize the AugLagrangianFunction.
 template<typename LagrangianFunction>
@@ -51,14 +117,10 @@ double AugLagrangianFunction<LagrangianFunction>::Evaluate(
   // First get the function's objective value.
   double objective = function.Evaluate(coordinates);
 
-  // Now loop for each constraint.
-  for (size_t i = 0; i < function.NumConstraints(); ++i)
-  {
-    double constraint = function.EvaluateConstraint(i, coordinates);
-
-    objective += (-lambda[i] * constraint) +
-        sigma * std::pow(constraint, 2) / 2;
-  }
+  // Now add the terms of the constraints, which are evaluated in parallel.
+  arma::vec constraints;
+  EvaluateConstraints(coordinates, constraints);
+  objective += arma::dot(-lambda + (sigma / 2) * constraints, constraints);
 
   return objective;
 }
@@ -74,17 +136,34 @@ void AugLagrangianFunction<LagrangianFunction>::Gradient(
   gradient.zeros();
   function.Gradient(coordinates, gradient);
 
-  arma::mat constraintGradient; // Temporary for constraint gradients.
-  for (size_t i = 0; i < function.NumConstraints(); i++)
-  {
-    function.GradientConstraint(i, coordinates, constraintGradient);
+  // Each constraint is evaluated once, and then each thread adds the scaled
+  // gradients of its blocks of constraints to its own partial gradient.
+  arma::vec scales;
+  EvaluateConstraints(coordinates, scales);
+  scales = -lambda + sigma * scales;
+
+  aux::ConstraintGradientBlock<LagrangianFunction> block(function,
+      coordinates, scales, ConstraintBlockSize);
+  const size_t blocks = (scales.n_elem + ConstraintBlockSize - 1) /
+      ConstraintBlockSize;
+  const arma::mat zero = arma::zeros<arma::mat>(coordinates.n_rows,
+      coordinates.n_cols);
+  gradient += util::ParallelReduce(0, blocks, block, zero);
+}
 
-    // Now calculate scaling factor and add to existing gradient.
-    arma::mat tmpGradient;
-    tmpGradient = (-lambda[i] + sigma *
-        function.EvaluateConstraint(i, coordinates)) * constraintGradient;
-    gradient += tmpGradient;
-  }
+// Evaluate each of the constraints at the given coordinates.
+template<typename LagrangianFunction>
+void AugLagrangianFunction<LagrangianFunction>::EvaluateConstraints(
+    const arma::mat& coordinates,
+    arma::vec& constraints) const
+{
+  constraints.set_size(function.NumConstraints());
+
+  aux::ConstraintBlock<LagrangianFunction> block(function, coordinates,
+      constraints, ConstraintBlockSize);
+  const size_t blocks = (constraints.n_elem + ConstraintBlockSize - 1) /
+      ConstraintBlockSize;
+  util::ParallelFor(0, blocks, block);
 }
 
 // Get the initial point.
@@ -72,14 +72,18 @@ bool AugLagrangian<LagrangianFunction>::Optimize(arma::mat& coordinates,
   // Track the last objective to compare for convergence.
   double lastObjective = function.Evaluate(coordinates);
 
-  // Then, calculate the current penalty.
-  double penalty = 0;
-  for (size_t i = 0; i < function.NumConstraints(); i++)
-    penalty += std::pow(function.EvaluateConstraint(i, coordinates), 2);
+  // Then, calculate the current penalty.  The constraints are evaluated (in
+  // parallel) once, and kept for the update of lambda.
+  arma::vec constraints;
+  augfunc.EvaluateConstraints(coordinates, constraints);
+  double penalty = arma::dot(constraints, constraints);
 
   Log::Debug << "Penalty is " << penalty << " (threshold " << penaltyThreshold
       << ")." << std::endl;
 
+  // Whether the next inner solve may start from the memory of the last one.
+  bool warmStart = false;
+
   // The odd comparison allows user to pass maxIterations = 0 (i.e. no limit on
   // number of iterations).
   size_t it;
@@ -92,6 +96,11 @@ bool AugLagrangian<LagrangianFunction>::Optimize(arma::mat& coordinates,
 
 //    Log::Warn << trans(coordinates) * coordinates << std::endl;
 
+    // After an update of lambda only, the augmented Lagrangian is close to the
+    // one L-BFGS just minimized, so it starts from the curvature pairs it
+    // stored; after an update of sigma (and at first), it starts over.
+    lbfgs.WarmStart() = warmStart;
+
     if (!lbfgs.Optimize(coordinates))
       Log::Warn << "L-BFGS reported an error during optimization."
           << std::endl;
@@ -109,13 +118,8 @@ bool AugLagrangian<LagrangianFunction>::Optimize(arma::mat& coordinates,
     // term is too high, and we update lambda otherwise.
 
     // First, calculate the current penalty.
-    double penalty = 0;
-    for (size_t i = 0; i < function.NumConstraints(); i++)
-    {
-      penalty += std::pow(function.EvaluateConstraint(i, coordinates), 2);
-//      Log::Debug << "Constraint " << i << " is " <<
-//          function.EvaluateConstraint(i, coordinates) << std::endl;
-    }
+    augfunc.EvaluateConstraints(coordinates, constraints);
+    penalty = arma::dot(constraints, constraints);
 
     Log::Warn << "Penalty is " << penalty << " (threshold "
         << penaltyThreshold << ")." << std::endl;
@@ -130,11 +134,9 @@ bool AugLagrangian<LagrangianFunction>::Optimize(arma::mat& coordinates,
 
     if (penalty < penaltyThreshold) // We update lambda.
     {
-      // We use the update: lambda_{k + 1} = lambda_k - sigma * c(coordinates),
-      // but we have to write a loop to do this for each constraint.
-      for (size_t i = 0; i < function.NumConstraints(); i++)
-        augfunc.Lambda()[i] -= augfunc.Sigma() *
-            function.EvaluateConstraint(i, coordinates);
+      // We use the update: lambda_{k + 1} = lambda_k - sigma * c(coordinates).
+      augfunc.Lambda() -= augfunc.Sigma() * constraints;
+      warmStart = true;
 
       // We also update the penalty threshold to be a factor of the current
       // penalty.  TODO: this factor should be a parameter (from CLI).  The
@@ -148,6 +150,7 @@ bool AugLagrangian<LagrangianFunction>::Optimize(arma::mat& coordinates,
       // parameter (from CLI).  The value of 10 is taken from Burer and Monteiro
       // (2002).
       augfunc.Sigma() *= 10;
+      warmStart = false;
       Log::Warn << "Updated sigma to " << augfunc.Sigma() << "." << std::endl;
     }
   }
@@ -9,6 +9,7 @@
 #define __MLPACK_CORE_OPTIMIZERS_LBFGS_LBFGS_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/util/sfinae_utility.hpp>
 
 namespace mlpack {
 namespace optimization {
@@ -24,6 +25,15 @@ namespace optimization {
  *  - double Evaluate(const arma::mat& coordinates);
  *  - void Gradient(const arma::mat& coordinates, arma::mat& gradient);
  *  - arma::mat& GetInitialPoint();
+ *
+ * The function may also implement
+ *
+ *  - double EvaluateWithGradient(const arma::mat& coordinates,
+ *                                arma::mat& gradient);
+ *
+ * which returns the objective and stores the gradient, with a single pass over
+ * the data.  If it is available (const or not), it is used instead of separate
+ * calls to Evaluate() and Gradient().
  */
 template<typename FunctionType>
 class L_BFGS
@@ -139,6 +149,27 @@ class L_BFGS
   //! Modify the maximum line search step size.
   double& MaxStep() { return maxStep; }
 
+  /**
+   * Get whether Optimize() starts from the curvature pairs (the s and y
+   * matrices) of the previous run instead of from an empty memory.  This helps
+   * when the function is optimized many times while changing only slightly
+   * between runs (as in the inner solves of the augmented Lagrangian method),
+   * and is ignored by a run whose dimensions differ from the previous one.
+   */
+  bool WarmStart() const { return warmStart; }
+  //! Modify whether Optimize() starts from the memory of the previous run.
+  bool& WarmStart() { return warmStart; }
+
+  /**
+   * Get whether the curvature pairs (the s and y matrices) are stored in single
+   * precision.  This halves the memory of the history, which dominates the
+   * memory use of L-BFGS for large problems; the iterate, the gradient and all
+   * of the dot products are still computed in double precision.
+   */
+  bool FloatHistory() const { return floatHistory; }
+  //! Modify whether the curvature pairs are stored in single precision.
+  bool& FloatHistory() { return floatHistory; }
+
   // convert the obkect into a string
   std::string ToString() const;
 
@@ -152,6 +183,23 @@ class L_BFGS
   arma::cube s;
   //! Stores all the y matrices in memory.
   arma::cube y;
+  //! Stores all the s matrices in memory, if floatHistory is set.
+  arma::fcube sFloat;
+  //! Stores all the y matrices in memory, if floatHistory is set.
+  arma::fcube yFloat;
+
+  //! The iterate at the start of the current iteration.
+  arma::mat oldIterate;
+  //! The gradient at the current iterate.
+  arma::mat gradient;
+  //! The gradient at the start of the current iteration.
+  arma::mat oldGradient;
+  //! The search direction of the current iteration.
+  arma::mat searchDirection;
+  //! The rho coefficients of the two-loop recursion.
+  arma::vec rho;
+  //! The alpha coefficients of the two-loop recursion.
+  arma::vec alpha;
 
   //! Size of memory for this L-BFGS optimizer.
   size_t numBasis;
@@ -169,6 +217,13 @@ class L_BFGS
   double minStep;
   //! Maximum step of the line search.
   double maxStep;
+  //! Whether to start from the memory of the previous run.
+  bool warmStart;
+  //! Whether to store the curvature pairs in single precision.
+  bool floatHistory;
+  //! The number of curvature pairs stored so far (by all of the runs since
+  //! the memory was last cleared).
+  size_t historyIterations;
 
   //! Best point found so far.
   std::pair<arma::mat, double> minPointIterate;
@@ -181,6 +236,78 @@ class L_BFGS
    */
   double Evaluate(const arma::mat& iterate);
 
+  /**
+   * Evaluate the function and its gradient at the given iterate point, and
+   * store the result if it is a new minimum.
+   *
+   * @return The value of the function.
+   */
+  double EvaluateWithGradient(const arma::mat& iterate, arma::mat& gradient);
+
+  HAS_MEM_FUNC(EvaluateWithGradient, HasEvaluateWithGradient)
+
+  //! Compute the objective and the gradient with one call, if the function
+  //! can do that.
+  template<typename Function>
+  static double ObjectiveAndGradient(Function& function,
+      const arma::mat& iterate,
+      arma::mat& gradient,
+      typename boost::enable_if_c<HasEvaluateWithGradient<Function,
+          double(Function::*)(const arma::mat&, arma::mat&) const>::value ||
+          HasEvaluateWithGradient<Function,
+          double(Function::*)(const arma::mat&, arma::mat&)>::value>::type* =
+          0);
+
+  //! Otherwise, call Evaluate() and Gradient().
+  template<typename Function>
+  static double ObjectiveAndGradient(Function& function,
+      const arma::mat& iterate,
+      arma::mat& gradient,
+      typename boost::enable_if_c<!HasEvaluateWithGradient<Function,
+          double(Function::*)(const arma::mat&, arma::mat&) const>::value &&
+          !HasEvaluateWithGradient<Function,
+          double(Function::*)(const arma::mat&, arma::mat&)>::value>::type* =
+          0);
+
+  //! Compute the dot product of two matrices of the same precision.
+  static double Dot(const arma::mat& a, const arma::mat& b);
+  //! Compute the dot product of two single-precision matrices in double
+  //! precision.
+  static double Dot(const arma::fmat& a, const arma::fmat& b);
+  //! Compute the dot product of a single-precision and a double-precision
+  //! matrix in double precision.
+  static double Dot(const arma::fmat& a, const arma::mat& b);
+
+  //! Add factor * v to x in place.
+  static void AddScaled(arma::mat& x, const double factor, const arma::mat& v);
+  //! Add factor * v to x in place, for a single-precision v.
+  static void AddScaled(arma::mat& x, const double factor, const arma::fmat& v);
+
+  //! Store a - b in the given slice of the history.
+  static void StoreDifference(arma::mat& out,
+                              const arma::mat& a,
+                              const arma::mat& b);
+  //! Store a - b in the given slice of a single-precision history.
+  static void StoreDifference(arma::fmat& out,
+                              const arma::mat& a,
+                              const arma::mat& b);
+
+  //! Calculate the scaling factor from the given history.
+  template<typename CubeType>
+  double ChooseScalingFactor(const CubeType& s,
+                             const CubeType& y,
+                             const size_t iterationNum,
+                             const arma::mat& gradient);
+
+  //! Find the search direction from the given history.
+  template<typename CubeType>
+  void SearchDirection(const CubeType& s,
+                       const CubeType& y,
+                       const arma::mat& gradient,
+                       const size_t iterationNum,
+                       const double scalingFactor,
+                       arma::mat& searchDirection);
+
   /**
    * Calculate the scaling factor, gamma, which is used to scale the Hessian
    * approximation matrix.  See method M3 in Section 4 of Liu and Nocedal
@@ -45,7 +45,10 @@ L_BFGS<FunctionType>::L_BFGS(FunctionType& function,
     minGradientNorm(minGradientNorm),
     maxLineSearchTrials(maxLineSearchTrials),
     minStep(minStep),
-    maxStep(maxStep)
+    maxStep(maxStep),
+    warmStart(false),
+    floatHistory(false),
+    historyIterations(0)
 {
   // Get the dimensions of the coordinates of the function; GetInitialPoint()
   // might return an arma::vec, but that's okay because then n_cols will simply
@@ -57,6 +60,15 @@ L_BFGS<FunctionType>::L_BFGS(FunctionType& function,
   s.set_size(rows, cols, numBasis);
   y.set_size(rows, cols, numBasis);
 
+  // Allocate the workspace of an iteration; Optimize() only reallocates it if
+  // the dimensions change.
+  oldIterate.set_size(rows, cols);
+  gradient.set_size(rows, cols);
+  oldGradient.set_size(rows, cols);
+  searchDirection.set_size(rows, cols);
+  rho.set_size(numBasis);
+  alpha.set_size(numBasis);
+
   // Allocate the pair holding the min iterate information.
   minPointIterate.first.zeros(rows, cols);
   minPointIterate.second = std::numeric_limits<double>::max();
@@ -84,6 +96,133 @@ double L_BFGS<FunctionType>::Evaluate(const arma::mat& iterate)
   return functionValue;
 }
 
+/**
+ * Evaluate the function and its gradient at the given iterate point and store
+ * the result if it is a new minimum.
+ *
+ * @return The value of the function
+ */
+template<typename FunctionType>
+double L_BFGS<FunctionType>::EvaluateWithGradient(const arma::mat& iterate,
+                                                  arma::mat& gradient)
+{
+  const double functionValue = ObjectiveAndGradient(function, iterate,
+      gradient);
+
+  if (functionValue < minPointIterate.second)
+  {
+    minPointIterate.first = iterate;
+    minPointIterate.second = functionValue;
+  }
+
+  return functionValue;
+}
+
+template<typename FunctionType>
+template<typename Function>
+double L_BFGS<FunctionType>::ObjectiveAndGradient(
+    Function& function,
+    const arma::mat& iterate,
+    arma::mat& gradient,
+    typename boost::enable_if_c<HasEvaluateWithGradient<Function,
+        double(Function::*)(const arma::mat&, arma::mat&) const>::value ||
+        HasEvaluateWithGradient<Function,
+        double(Function::*)(const arma::mat&, arma::mat&)>::value>::type*)
+{
+  return function.EvaluateWithGradient(iterate, gradient);
+}
+
+template<typename FunctionType>
+template<typename Function>
+double L_BFGS<FunctionType>::ObjectiveAndGradient(
+    Function& function,
+    const arma::mat& iterate,
+    arma::mat& gradient,
+    typename boost::enable_if_c<!HasEvaluateWithGradient<Function,
+        double(Function::*)(const arma::mat&, arma::mat&) const>::value &&
+        !HasEvaluateWithGradient<Function,
+        double(Function::*)(const arma::mat&, arma::mat&)>::value>::type*)
+{
+  const double functionValue = function.Evaluate(iterate);
+  function.Gradient(iterate, gradient);
+  return functionValue;
+}
+
+template<typename FunctionType>
+inline double L_BFGS<FunctionType>::Dot(const arma::mat& a,
+                                        const arma::mat& b)
+{
+  return arma::dot(a, b);
+}
+
+template<typename FunctionType>
+inline double L_BFGS<FunctionType>::Dot(const arma::fmat& a,
+                                        const arma::fmat& b)
+{
+  // Accumulate in double precision, so that long histories do not lose the
+  // accuracy of the curvature information.
+  const float* aMem = a.memptr();
+  const float* bMem = b.memptr();
+  double result = 0.0;
+  for (size_t i = 0; i < a.n_elem; ++i)
+    result += double(aMem[i]) * double(bMem[i]);
+
+  return result;
+}
+
+template<typename FunctionType>
+inline double L_BFGS<FunctionType>::Dot(const arma::fmat& a,
+                                        const arma::mat& b)
+{
+  const float* aMem = a.memptr();
+  const double* bMem = b.memptr();
+  double result = 0.0;
+  for (size_t i = 0; i < a.n_elem; ++i)
+    result += double(aMem[i]) * bMem[i];
+
+  return result;
+}
+
+template<typename FunctionType>
+inline void L_BFGS<FunctionType>::AddScaled(arma::mat& x,
+                                            const double factor,
+                                            const arma::mat& v)
+{
+  // Armadillo evaluates this in place, without a temporary.
+  x += factor * v;
+}
+
+template<typename FunctionType>
+inline void L_BFGS<FunctionType>::AddScaled(arma::mat& x,
+                                            const double factor,
+                                            const arma::fmat& v)
+{
+  double* xMem = x.memptr();
+  const float* vMem = v.memptr();
+  for (size_t i = 0; i < x.n_elem; ++i)
+    xMem[i] += factor * double(vMem[i]);
+}
+
+template<typename FunctionType>
+inline void L_BFGS<FunctionType>::StoreDifference(arma::mat& out,
+                                                  const arma::mat& a,
+                                                  const arma::mat& b)
+{
+  out = a - b;
+}
+
+template<typename FunctionType>
+inline void L_BFGS<FunctionType>::StoreDifference(arma::fmat& out,
+                                                  const arma::mat& a,
+                                                  const arma::mat& b)
+{
+  float* outMem = out.memptr();
+  const double* aMem = a.memptr();
+  const double* bMem = b.memptr();
+  for (size_t i = 0; i < out.n_elem; ++i)
+    outMem[i] = float(aMem[i] - bMem[i]);
+}
+
 /**
  * Calculate the scaling factor gamma which is used to scale the Hessian
  * approximation matrix.  See method M3 in Section 4 of Liu and Nocedal (1989).
@@ -93,15 +232,29 @@ double L_BFGS<FunctionType>::Evaluate(const arma::mat& iterate)
 template<typename FunctionType>
 double L_BFGS<FunctionType>::ChooseScalingFactor(const size_t iterationNum,
                                                  const arma::mat& gradient)
+{
+  if (floatHistory)
+    return ChooseScalingFactor(sFloat, yFloat, iterationNum, gradient);
+  else
+    return ChooseScalingFactor(s, y, iterationNum, gradient);
+}
+
+template<typename FunctionType>
+template<typename CubeType>
+double L_BFGS<FunctionType>::ChooseScalingFactor(const CubeType& s,
+                                                 const CubeType& y,
+                                                 const size_t iterationNum,
+                                                 const arma::mat& gradient)
 {
   double scalingFactor = 1.0;
   if (iterationNum > 0)
   {
     int previousPos = (iterationNum - 1) % numBasis;
     // Get s and y matrices once instead of multiple times.
-    arma::mat& sMat = s.slice(previousPos);
-    arma::mat& yMat = y.slice(previousPos);
-    scalingFactor = dot(sMat, yMat) / dot(yMat, yMat);
+    typedef arma::Mat<typename CubeType::elem_type> SliceType;
+    const SliceType& sMat = s.slice(previousPos);
+    const SliceType& yMat = y.slice(previousPos);
+    scalingFactor = Dot(sMat, yMat) / Dot(yMat, yMat);
   }
   else
   {
@@ -120,7 +273,9 @@ double L_BFGS<FunctionType>::ChooseScalingFactor(const size_t iterationNum,
 template<typename FunctionType>
 bool L_BFGS<FunctionType>::GradientNormTooSmall(const arma::mat& gradient)
 {
-  double norm = arma::norm(gradient, 2);
+  // This is the Frobenius norm; arma::norm(gradient, 2) would compute the
+  // largest singular value of a matrix-shaped gradient instead.
+  double norm = std::sqrt(arma::dot(gradient, gradient));
 
   return (norm < minGradientNorm);
 }
@@ -178,10 +333,10 @@ bool L_BFGS<FunctionType>::LineSearch(double& functionValue,
   {
     // Perform a step and evaluate the gradient and the function values at that
     // point.
+    // newIterateTmp already has the right size, so this does not allocate.
     newIterateTmp = iterate;
-    newIterateTmp += stepSize * searchDirection;
-    functionValue = Evaluate(newIterateTmp);
-    function.Gradient(newIterateTmp, gradient);
+    AddScaled(newIterateTmp, stepSize, searchDirection);
+    functionValue = EvaluateWithGradient(newIterateTmp, gradient);
     numIterations++;
 
     if (functionValue > initialFunctionValue + stepSize *
@@ -218,6 +373,8 @@ bool L_BFGS<FunctionType>::LineSearch(double& functionValue,
     if ((stepSize < minStep) || (stepSize > maxStep) ||
         (numIterations >= maxLineSearchTrials))
     {
+      // The iterate is unchanged, so its objective is too.
+      functionValue = initialFunctionValue;
       return false;
     }
 
@@ -243,26 +400,45 @@ void L_BFGS<FunctionType>::SearchDirection(const arma::mat& gradient,
                                            const size_t iterationNum,
                                            const double scalingFactor,
                                            arma::mat& searchDirection)
+{
+  if (floatHistory)
+  {
+    SearchDirection(sFloat, yFloat, gradient, iterationNum, scalingFactor,
+        searchDirection);
+  }
+  else
+  {
+    SearchDirection(s, y, gradient, iterationNum, scalingFactor,
+        searchDirection);
+  }
+}
+
+template<typename FunctionType>
+template<typename CubeType>
+void L_BFGS<FunctionType>::SearchDirection(const CubeType& s,
+                                           const CubeType& y,
+                                           const arma::mat& gradient,
+                                           const size_t iterationNum,
+                                           const double scalingFactor,
+                                           arma::mat& searchDirection)
 {
   // Start from this point.
   searchDirection = gradient;
 
   // See "A Recursive Formula to Compute H * g" in "Updating quasi-Newton
-  // matrices with limited storage" (Nocedal, 1980).
-
-  // Temporary variables.
-  arma::vec rho(numBasis);
-  arma::vec alpha(numBasis);
-
+  // matrices with limited storage" (Nocedal, 1980).  The coefficients are
+  // stored in rho and alpha, which are members so that they are not allocated
+  // on each iteration.
   size_t limit = (numBasis > iterationNum) ? 0 : (iterationNum - numBasis);
   for (size_t i = iterationNum; i != limit; i--)
   {
     int translatedPosition = (i + (numBasis - 1)) % numBasis;
-    rho[iterationNum - i] = 1.0 / arma::dot(y.slice(translatedPosition),
-                                            s.slice(translatedPosition));
+    rho[iterationNum - i] = 1.0 / Dot(y.slice(translatedPosition),
+                                      s.slice(translatedPosition));
     alpha[iterationNum - i] = rho[iterationNum - i] *
-        arma::dot(s.slice(translatedPosition), searchDirection);
-    searchDirection -= alpha[iterationNum - i] * y.slice(translatedPosition);
+        Dot(s.slice(translatedPosition), searchDirection);
+    AddScaled(searchDirection, -alpha[iterationNum - i],
+        y.slice(translatedPosition));
   }
 
   searchDirection *= scalingFactor;
@@ -271,9 +447,9 @@ void L_BFGS<FunctionType>::SearchDirection(const arma::mat& gradient,
   {
     int translatedPosition = i % numBasis;
     double beta = rho[iterationNum - i - 1] *
-        arma::dot(y.slice(translatedPosition), searchDirection);
-    searchDirection += (alpha[iterationNum - i - 1] - beta) *
-        s.slice(translatedPosition);
+        Dot(y.slice(translatedPosition), searchDirection);
+    AddScaled(searchDirection, alpha[iterationNum - i - 1] - beta,
+        s.slice(translatedPosition));
   }
 
   // Negate the search direction so that it is a descent direction.
@@ -301,8 +477,16 @@ void L_BFGS<FunctionType>::UpdateBasisSet(const size_t iterationNum,
   // Overwrite a certain position instead of pushing everything in the vector
   // back one position.
   int overwritePos = iterationNum % numBasis;
-  s.slice(overwritePos) = iterate - oldIterate;
-  y.slice(overwritePos) = gradient - oldGradient;
+  if (floatHistory)
+  {
+    StoreDifference(sFloat.slice(overwritePos), iterate, oldIterate);
+    StoreDifference(yFloat.slice(overwritePos), gradient, oldGradient);
+  }
+  else
+  {
+    StoreDifference(s.slice(overwritePos), iterate, oldIterate);
+    StoreDifference(y.slice(overwritePos), gradient, oldGradient);
+  }
 }
 
 /**
@@ -342,39 +526,60 @@ double L_BFGS<FunctionType>::Optimize(arma::mat& iterate,
   const size_t rows = function.GetInitialPoint().n_rows;
   const size_t cols = function.GetInitialPoint().n_cols;
 
-  s.set_size(rows, cols, numBasis);
-  y.set_size(rows, cols, numBasis);
+  // The memory of the previous run is kept for a warm start, unless it has
+  // different dimensions or precision.  The iteration numbers of this run then
+  // continue from the number of curvature pairs already stored.
+  const bool sameHistory = floatHistory ?
+      (sFloat.n_rows == rows && sFloat.n_cols == cols &&
+       sFloat.n_slices == numBasis) :
+      (s.n_rows == rows && s.n_cols == cols && s.n_slices == numBasis);
+  if (!warmStart || !sameHistory)
+  {
+    // Only one of the histories is kept, so that single precision storage
+    // really saves the memory.
+    if (floatHistory)
+    {
+      s.reset();
+      y.reset();
+      sFloat.set_size(rows, cols, numBasis);
+      yFloat.set_size(rows, cols, numBasis);
+    }
+    else
+    {
+      sFloat.reset();
+      yFloat.reset();
+      s.set_size(rows, cols, numBasis);
+      y.set_size(rows, cols, numBasis);
+    }
+    historyIterations = 0;
+  }
+  const size_t history = historyIterations;
   minPointIterate.second = std::numeric_limits<double>::max();
 
-  // The old iterate to be saved.
-  arma::mat oldIterate;
+  // The workspace of an iteration: the old iterate, the current and the old
+  // gradient, the search direction and the coefficients of the recursion.
+  // These are members which keep their memory between runs, so that they are
+  // only reallocated when the dimensions change.
   oldIterate.zeros(iterate.n_rows, iterate.n_cols);
-
-  // Whether to optimize until convergence.
-  bool optimizeUntilConvergence = (maxIterations == 0);
-
-  // The initial function value.
-  double functionValue = Evaluate(iterate);
-
-  // The gradient: the current and the old.
-  arma::mat gradient;
-  arma::mat oldGradient;
   gradient.zeros(iterate.n_rows, iterate.n_cols);
   oldGradient.zeros(iterate.n_rows, iterate.n_cols);
-
-  // The search direction.
-  arma::mat searchDirection;
   searchDirection.zeros(iterate.n_rows, iterate.n_cols);
+  newIterateTmp.set_size(iterate.n_rows, iterate.n_cols);
+  rho.set_size(numBasis);
+  alpha.set_size(numBasis);
 
-  // The initial gradient value.
-  function.Gradient(iterate, gradient);
+  // Whether to optimize until convergence.
+  bool optimizeUntilConvergence = (maxIterations == 0);
+
+  // The initial function and gradient values.
+  double functionValue = EvaluateWithGradient(iterate, gradient);
 
   // The main optimization loop.
   for (size_t itNum = 0; optimizeUntilConvergence || (itNum != maxIterations);
        ++itNum)
   {
     Log::Debug << "L-BFGS iteration " << itNum << "; objective " <<
-        function.Evaluate(iterate) << "." << std::endl;
+        functionValue << "." << std::endl;
 
     // Break when the norm of the gradient becomes too small.
     if (GradientNormTooSmall(gradient))
@@ -385,11 +590,12 @@ double L_BFGS<FunctionType>::Optimize(arma::mat& iterate,
     }
 
     // Choose the scaling factor.
-    double scalingFactor = ChooseScalingFactor(itNum, gradient);
+    double scalingFactor = ChooseScalingFactor(history + itNum, gradient);
 
     // Build an approximation to the Hessian and choose the search
     // direction for the current iteration.
-    SearchDirection(gradient, itNum, scalingFactor, searchDirection);
+    SearchDirection(gradient, history + itNum, scalingFactor,
+        searchDirection);
 
     // Save the old iterate and the gradient before stepping.
     oldIterate = iterate;
@@ -404,7 +610,7 @@ double L_BFGS<FunctionType>::Optimize(arma::mat& iterate,
 
     // It is possible that the difference between the two coordinates is zero.
     // In this case we terminate successfully.
-    if (accu(iterate != oldIterate) == 0)
+    if (std::equal(iterate.begin(), iterate.end(), oldIterate.begin()))
     {
       Log::Debug << "L-BFGS step size of 0 (terminating successfully)."
           << std::endl;
@@ -412,11 +618,15 @@ double L_BFGS<FunctionType>::Optimize(arma::mat& iterate,
     }
 
     // Overwrite an old basis set.
-    UpdateBasisSet(itNum, iterate, oldIterate, gradient, oldGradient);
+    UpdateBasisSet(history + itNum, iterate, oldIterate, gradient,
+        oldGradient);
+    historyIterations = history + itNum + 1;
 
   } // End of the optimization loop.
 
-  return function.Evaluate(iterate);
+  // functionValue always holds the objective at iterate, so there is no need to
+  // evaluate the function again.
+  return functionValue;
 }
 
 // Convert the object to a string.
@@ -428,14 +638,23 @@ std::string L_BFGS<FunctionType>::ToString() const
   convert << "  Function:" << std::endl;
   convert << util::Indent(function.ToString(), 2);
   convert << "  Memory size: " << numBasis << std::endl;
-  convert << "  Cube size: " << s.n_rows << "x" << s.n_cols << "x"
-      << s.n_slices << std::endl;
+  if (floatHistory)
+  {
+    convert << "  Cube size: " << sFloat.n_rows << "x" << sFloat.n_cols << "x"
+        << sFloat.n_slices << " (single precision)" << std::endl;
+  }
+  else
+  {
+    convert << "  Cube size: " << s.n_rows << "x" << s.n_cols << "x"
+        << s.n_slices << std::endl;
+  }
   convert << "  Maximum iterations: " << maxIterations << std::endl;
   convert << "  Armijo condition constant: " << armijoConstant << std::endl;
   convert << "  Wolfe parameter: " << wolfe << std::endl;
   convert << "  Minimum gradient norm: " << minGradientNorm << std::endl;
   convert << "  Minimum step for line search: " << minStep << std::endl;
   convert << "  Maximum step for line search: " << maxStep << std::endl;
+  convert << "  Warm start: " << (warmStart ? "true" : "false") << std::endl;
   return convert.str();
 }
 
@@ -62,11 +62,22 @@ class LRSDP
   //! Modify the objective function matrix (C).
   arma::mat& C() { return function.C(); }
 
+  //! Return the sparse part of the objective function matrix (C).
+  const arma::sp_mat& SparseC() const { return function.SparseC(); }
+  //! Modify the sparse part of the objective function matrix (C).
+  arma::sp_mat& SparseC() { return function.SparseC(); }
+
   //! Return the vector of A matrices (which correspond to the constraints).
   const std::vector<arma::mat>& A() const { return function.A(); }
   //! Modify the veector of A matrices (which correspond to the constraints).
   std::vector<arma::mat>& A() { return function.A(); }
 
+  //! Return the vector of sparse A matrices (used for constraints of mode 2).
+  const std::vector<arma::sp_mat>& SparseA() const
+  { return function.SparseA(); }
+  //! Modify the vector of sparse A matrices (used for constraints of mode 2).
+  std::vector<arma::sp_mat>& SparseA() { return function.SparseA(); }
+
   //! Return the vector of modes for the A matrices.
   const arma::uvec& AModes() const { return function.AModes(); }
   //! Modify the vector of modes for the A matrices.
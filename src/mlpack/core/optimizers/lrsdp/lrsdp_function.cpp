@@ -14,14 +14,117 @@ using namespace mlpack::optimization;
 LRSDPFunction::LRSDPFunction(const size_t numConstraints,
                              const arma::mat& initialPoint):
     a(numConstraints),
+    sparseA(numConstraints),
     b(numConstraints),
     initialPoint(initialPoint),
     aModes(numConstraints)
 { }
 
+namespace mlpack {
+namespace optimization {
+
+// Tr(A (R R^T)) for a dense A, which is the sum of the entries of R % (A R).
+// This takes O(n^2 r) time, instead of O(n^2 r + n^3) for the product with
+// R R^T.
+static double DenseTrace(const arma::mat& a, const arma::mat& coordinates)
+{
+  return accu(coordinates % (a * coordinates));
+}
+
+// The dot product of rows i and j of R.  If Transposed is true, R^T is given,
+// and the rows of R are its (contiguous) columns.
+template<bool Transposed>
+static double RowDot(const arma::mat& coordinates,
+                     const size_t i,
+                     const size_t j)
+{
+  if (Transposed)
+    return dot(coordinates.unsafe_col(i), coordinates.unsafe_col(j));
+
+  double product = 0.0;
+  for (size_t k = 0; k < coordinates.n_cols; ++k)
+    product += coordinates(i, k) * coordinates(j, k);
+
+  return product;
+}
+
+// Tr(A (R R^T)) for a sparse A: each nonzero A(i, j) contributes A(i, j) times
+// the dot product of rows i and j of R.
+template<bool Transposed>
+static double SparseTrace(const arma::sp_mat& a,
+                          const arma::mat& coordinates)
+{
+  double trace = 0.0;
+  for (arma::sp_mat::const_iterator it = a.begin(); it != a.end(); ++it)
+    trace += (*it) * RowDot<Transposed>(coordinates, it.row(), it.col());
+
+  return trace;
+}
+
+// Tr(A (R R^T)) for an A given as a list of entries (mode 1).
+template<bool Transposed>
+static double EntryTrace(const arma::mat& a, const arma::mat& coordinates)
+{
+  double trace = 0.0;
+  for (size_t j = 0; j < a.n_cols; ++j)
+    trace += a(2, j) * RowDot<Transposed>(coordinates, (size_t) a(0, j),
+        (size_t) a(1, j));
+
+  return trace;
+}
+
+// Tr(A (R R^T)) for a low-rank A = U U^T (mode 3), which is the squared
+// Frobenius norm of U^T R.
+static double LowRankTrace(const arma::mat& u, const arma::mat& coordinates)
+{
+  return accu(square(trans(u) * coordinates));
+}
+
+// Add 2 * scale * (A R) to the gradient, for a sparse A.  The gradient is
+// stored transposed, so that the rows of R and of the gradient are contiguous.
+static void AddSparseGradient(const arma::sp_mat& a,
+                              const double scale,
+                              const arma::mat& coordinatesT,
+                              arma::mat& gradientT)
+{
+  for (arma::sp_mat::const_iterator it = a.begin(); it != a.end(); ++it)
+    gradientT.unsafe_col(it.row()) += (2 * scale * (*it)) *
+        coordinatesT.unsafe_col(it.col());
+}
+
+// Add 2 * scale * (A R) to the (transposed) gradient, for an A given as a list
+// of entries (mode 1).
+static void AddEntryGradient(const arma::mat& a,
+                             const double scale,
+                             const arma::mat& coordinatesT,
+                             arma::mat& gradientT)
+{
+  for (size_t j = 0; j < a.n_cols; ++j)
+    gradientT.unsafe_col((size_t) a(0, j)) += (2 * scale * a(2, j)) *
+        coordinatesT.unsafe_col((size_t) a(1, j));
+}
+
+// Tr(C (R R^T)), where C is the sum of the dense and the sparse objective
+// matrices (each of which may be empty).
+static double ObjectiveTrace(const LRSDPFunction& function,
+                             const arma::mat& coordinates,
+                             const arma::mat& coordinatesT)
+{
+  double objective = 0.0;
+  if (function.C().n_elem > 0)
+    objective += DenseTrace(function.C(), coordinates);
+  if (function.SparseC().n_nonzero > 0)
+    objective += SparseTrace<true>(function.SparseC(), coordinatesT);
+
+  return objective;
+}
+
+}; // namespace optimization
+}; // namespace mlpack
+
 double LRSDPFunction::Evaluate(const arma::mat& coordinates) const
 {
-  return -accu(coordinates * trans(coordinates));
+  return ObjectiveTrace(*this, coordinates, trans(coordinates));
 }
 
 void LRSDPFunction::Gradient(const arma::mat& /* coordinates */,
@@ -34,17 +137,30 @@ void LRSDPFunction::Gradient(const arma::mat& /* coordinates */,
 double LRSDPFunction::EvaluateConstraint(const size_t index,
                                  const arma::mat& coordinates) const
 {
-  arma::mat rrt = coordinates * trans(coordinates);
+  // AugLagrangian calls this once for each constraint, so R is not transposed
+  // here: that would cost O(n r) for a constraint with a few nonzeros.
   if (aModes[index] == 0)
-    return trace(a[index] * rrt) - b[index];
+    return DenseTrace(a[index], coordinates) - b[index];
+  else if (aModes[index] == 1)
+    return EntryTrace<false>(a[index], coordinates) - b[index];
+  else if (aModes[index] == 2)
+    return SparseTrace<false>(sparseA[index], coordinates) - b[index];
   else
-  {
-    double value = -b[index];
-    for (size_t i = 0; i < a[index].n_cols; ++i)
-      value += a[index](2, i) * rrt(a[index](0, i), a[index](1, i));
+    return LowRankTrace(a[index], coordinates) - b[index];
+}
 
-    return value;
-  }
+double LRSDPFunction::EvaluateConstraint(const size_t index,
+                                         const arma::mat& coordinates,
+                                         const arma::mat& coordinatesT) const
+{
+  if (aModes[index] == 0)
+    return DenseTrace(a[index], coordinates) - b[index];
+  else if (aModes[index] == 1)
+    return EntryTrace<true>(a[index], coordinatesT) - b[index];
+  else if (aModes[index] == 2)
+    return SparseTrace<true>(sparseA[index], coordinatesT) - b[index];
+  else
+    return LowRankTrace(a[index], coordinates) - b[index];
 }
 
 void LRSDPFunction::GradientConstraint(const size_t /* index */,
@@ -67,13 +183,133 @@ std::string LRSDPFunction::ToString() const
   convert << "  Constraint b_i values: " << b.t();
   convert << "  Objective matrix (C) size: " << c.n_rows << "x" << c.n_cols
       << std::endl;
+  convert << "  Sparse objective matrix (C) size: " << sparseC.n_rows << "x"
+      << sparseC.n_cols << " (" << sparseC.n_nonzero << " nonzeros)"
+      << std::endl;
   return convert.str();
 }
 
 namespace mlpack {
 namespace optimization {
 
+// Evaluate one block of the constraints of the LRSDP, with the transpose of
+// the coordinates given.
+class LRSDPConstraintBlock
+{
+ public:
+  LRSDPConstraintBlock(const LRSDPFunction& function,
+                       const arma::mat& coordinates,
+                       const arma::mat& coordinatesT,
+                       arma::vec& constraints,
+                       const size_t blockSize) :
+      function(function),
+      coordinates(coordinates),
+      coordinatesT(coordinatesT),
+      constraints(constraints),
+      blockSize(blockSize) { }
+
+  void operator()(const size_t block)
+  {
+    const size_t end = std::min((block + 1) * blockSize,
+        (size_t) constraints.n_elem);
+    for (size_t i = block * blockSize; i < end; ++i)
+      constraints[i] = function.EvaluateConstraint(i, coordinates,
+          coordinatesT);
+  }
+
+ private:
+  const LRSDPFunction& function;
+  const arma::mat& coordinates;
+  const arma::mat& coordinatesT;
+  arma::vec& constraints;
+  size_t blockSize;
+};
+
+// A partial gradient of the augmented Lagrangian of the LRSDP: the dense terms
+// go to the gradient, and the sparse terms to its transpose.
+struct LRSDPGradient
+{
+  arma::mat gradient;
+  arma::mat gradientT;
+
+  LRSDPGradient& operator+=(const LRSDPGradient& other)
+  {
+    gradient += other.gradient;
+    gradientT += other.gradientT;
+    return *this;
+  }
+};
+
+// Add the terms of one block of the constraints to a partial gradient, where
+// y[i] is the updated Lagrange multiplier of constraint i.
+class LRSDPGradientBlock
+{
+ public:
+  LRSDPGradientBlock(const LRSDPFunction& function,
+                     const arma::mat& coordinates,
+                     const arma::mat& coordinatesT,
+                     const arma::vec& y,
+                     const size_t blockSize) :
+      function(function),
+      coordinates(coordinates),
+      coordinatesT(coordinatesT),
+      y(y),
+      blockSize(blockSize) { }
+
+  void operator()(const size_t block, LRSDPGradient& partial)
+  {
+    const size_t end = std::min((block + 1) * blockSize, (size_t) y.n_elem);
+    for (size_t i = block * blockSize; i < end; ++i)
+    {
+      if (function.AModes()[i] == 0)
+        partial.gradient -= (2 * y[i]) * (function.A()[i] * coordinates);
+      else if (function.AModes()[i] == 1)
+        AddEntryGradient(function.A()[i], -y[i], coordinatesT,
+            partial.gradientT);
+      else if (function.AModes()[i] == 2)
+        AddSparseGradient(function.SparseA()[i], -y[i], coordinatesT,
+            partial.gradientT);
+      else
+        partial.gradient -= (2 * y[i]) * (function.A()[i] *
+            (trans(function.A()[i]) * coordinates));
+    }
+  }
+
+ private:
+  const LRSDPFunction& function;
+  const arma::mat& coordinates;
+  const arma::mat& coordinatesT;
+  const arma::vec& y;
+  size_t blockSize;
+};
+
+// Evaluate all of the constraints in parallel, given the transpose of the
+// coordinates.
+static void EvaluateLRSDPConstraints(const LRSDPFunction& function,
+                                     const arma::mat& coordinates,
+                                     const arma::mat& coordinatesT,
+                                     arma::vec& constraints)
+{
+  const size_t blockSize =
+      AugLagrangianFunction<LRSDPFunction>::ConstraintBlockSize;
+  constraints.set_size(function.B().n_elem);
+
+  LRSDPConstraintBlock block(function, coordinates, coordinatesT, constraints,
+      blockSize);
+  util::ParallelFor(0, (constraints.n_elem + blockSize - 1) / blockSize,
+      block);
+}
+
 // Template specializations for function and gradient evaluation.
+template<>
+void AugLagrangianFunction<LRSDPFunction>::EvaluateConstraints(
+    const arma::mat& coordinates,
+    arma::vec& constraints) const
+{
+  EvaluateLRSDPConstraints(function, coordinates, trans(coordinates),
+      constraints);
+}
+
 template<>
 double AugLagrangianFunction<LRSDPFunction>::Evaluate(
     const arma::mat& coordinates) const
@@ -82,34 +318,15 @@ double AugLagrangianFunction<LRSDPFunction>::Evaluate(
   // L(R, y, s) = Tr(C * (R R^T)) -
   //     sum_{i = 1}^{m} (y_i (Tr(A_i * (R R^T)) - b_i)) +
   //     (sigma / 2) * sum_{i = 1}^{m} (Tr(A_i * (R R^T)) - b_i)^2
+  // None of the traces needs R R^T; sparse matrices only touch the rows of R
+  // their nonzero entries refer to.
+  const arma::mat coordinatesT = trans(coordinates);
+  double objective = ObjectiveTrace(function, coordinates, coordinatesT);
 
-  // Let's start with the objective: Tr(C * (R R^T)).
-  // Simple, possibly slow solution.
-  arma::mat rrt = coordinates * trans(coordinates);
-  double objective = trace(function.C() * rrt);
-
-  // Now each constraint.
-  for (size_t i = 0; i < function.B().n_elem; ++i)
-  {
-    // Take the trace subtracted by the b_i.
-    double constraint = -function.B()[i];
-
-    if (function.AModes()[i] == 0)
-    {
-      constraint += trace(function.A()[i] * rrt);
-    }
-    else
-    {
-      for (size_t j = 0; j < function.A()[i].n_cols; ++j)
-      {
-        constraint += function.A()[i](2, j) *
-            rrt(function.A()[i](0, j), function.A()[i](1, j));
-      }
-    }
-
-    objective -= (lambda[i] * constraint);
-    objective += (sigma / 2) * std::pow(constraint, 2.0);
-  }
+  // Now each constraint (the traces subtracted by the b_i), in parallel.
+  arma::vec constraints;
+  EvaluateLRSDPConstraints(function, coordinates, coordinatesT, constraints);
+  objective += arma::dot(-lambda + (sigma / 2) * constraints, constraints);
 
   return objective;
 }
@@ -125,45 +342,34 @@ void AugLagrangianFunction<LRSDPFunction>::Gradient(
   //   with
   // S' = C - sum_{i = 1}^{m} y'_i A_i
   // y'_i = y_i - sigma * (Trace(A_i * (R R^T)) - b_i)
-  arma::mat rrt = coordinates * trans(coordinates);
-  arma::mat s = function.C();
+  // S' is never formed: each term of 2 * S' * R is added separately, the dense
+  // ones to the gradient and the sparse ones, row by row, to its transpose.
+  // The constraints are evaluated in parallel, and then each thread adds the
+  // terms of its blocks of constraints to its own partial gradient.
+  const arma::mat coordinatesT = trans(coordinates);
+  arma::vec y;
+  EvaluateLRSDPConstraints(function, coordinates, coordinatesT, y);
+  y = lambda - sigma * y;
 
-  for (size_t i = 0; i < function.B().n_elem; ++i)
-  {
-    double constraint = -function.B()[i];
+  LRSDPGradient zero;
+  zero.gradient.zeros(coordinates.n_rows, coordinates.n_cols);
+  zero.gradientT.zeros(coordinates.n_cols, coordinates.n_rows);
 
-    if (function.AModes()[i] == 0)
-    {
-      constraint += trace(function.A()[i] * rrt);
-    }
-    else
-    {
-      for (size_t j = 0; j < function.A()[i].n_cols; ++j)
-      {
-        constraint += function.A()[i](2, j) *
-            rrt(function.A()[i](0, j), function.A()[i](1, j));
-      }
-    }
+  LRSDPGradientBlock block(function, coordinates, coordinatesT, y,
+      ConstraintBlockSize);
+  const size_t blocks = (y.n_elem + ConstraintBlockSize - 1) /
+      ConstraintBlockSize;
+  const LRSDPGradient terms = util::ParallelReduce(0, blocks, block, zero);
 
-    double y = lambda[i] - sigma * constraint;
+  gradient = terms.gradient;
+  arma::mat gradientT = terms.gradientT;
+  if (function.C().n_elem > 0)
+    gradient += 2 * function.C() * coordinates;
+  if (function.SparseC().n_nonzero > 0)
+    AddSparseGradient(function.SparseC(), 1.0, coordinatesT, gradientT);
 
-    if (function.AModes()[i] == 0)
-    {
-      s -= (y * function.A()[i]);
-    }
-    else
-    {
-      // We only need to subtract the entries which could be modified.
-      for (size_t j = 0; j < function.A()[i].n_cols; ++j)
-      {
-        s(function.A()[i](0, j), function.A()[i](1, j)) -= y;
-      }
-    }
-  }
-
-  gradient = 2 * s * coordinates;
+  gradient += trans(gradientT);
 }
 
 }; // namespace optimization
 }; // namespace mlpack
-
@@ -16,6 +16,21 @@ namespace optimization {
 
 /**
  * The objective function that LRSDP is trying to optimize.
+ *
+ * The objective matrix is C() + SparseC(); either of the two may be left empty.
+ * Each constraint matrix A_i is stored in one of three ways, given by
+ * AModes()[i]:
+ *
+ *  - 0: A()[i] is the dense (n x n) matrix A_i.
+ *  - 1: A()[i] is a (3 x k) list of the k nonzero entries of A_i; each column
+ *       holds the row, the column and the value of one entry.
+ *  - 2: SparseA()[i] is the sparse matrix A_i.
+ *  - 3: A()[i] is an (n x k) matrix U, and A_i = U U^T; a dense constraint of
+ *       low rank, such as 1 1^T, then costs O(n k r).
+ *
+ * The traces Tr(A_i (R R^T)) are computed from the rows of R, without forming
+ * the (n x n) matrix R R^T, so a sparse constraint costs O(k r) and a dense
+ * one O(n^2 r), where r is the rank of R.
  */
 class LRSDPFunction
 {
@@ -45,6 +60,17 @@ class LRSDPFunction
    */
   double EvaluateConstraint(const size_t index,
                             const arma::mat& coordinates) const;
+
+  /**
+   * Evaluate a particular constraint of the LRSDP at the given coordinates,
+   * when the transpose of the coordinates has already been computed (so that
+   * the rows of R are contiguous); this saves a transpose when many
+   * constraints are evaluated at the same coordinates.
+   */
+  double EvaluateConstraint(const size_t index,
+                            const arma::mat& coordinates,
+                            const arma::mat& coordinatesT) const;
+
   /**
    * Evaluate the gradient of a particular constraint of the LRSDP at the given
    * coordinates.
@@ -64,11 +90,21 @@ class LRSDPFunction
   //! Modify the objective function matrix (C).
   arma::mat& C() { return c; }
 
+  //! Return the sparse part of the objective function matrix (C).
+  const arma::sp_mat& SparseC() const { return sparseC; }
+  //! Modify the sparse part of the objective function matrix (C).
+  arma::sp_mat& SparseC() { return sparseC; }
+
   //! Return the vector of A matrices (which correspond to the constraints).
   const std::vector<arma::mat>& A() const { return a; }
   //! Modify the veector of A matrices (which correspond to the constraints).
   std::vector<arma::mat>& A() { return a; }
 
+  //! Return the vector of sparse A matrices (used for constraints of mode 2).
+  const std::vector<arma::sp_mat>& SparseA() const { return sparseA; }
+  //! Modify the vector of sparse A matrices (used for constraints of mode 2).
+  std::vector<arma::sp_mat>& SparseA() { return sparseA; }
+
   //! Return the vector of modes for the A matrices.
   const arma::uvec& AModes() const { return aModes; }
   //! Modify the vector of modes for the A matrices.
@@ -85,14 +121,18 @@ class LRSDPFunction
  private:
   //! Objective function matrix c.
   arma::mat c;
+  //! Sparse part of the objective function matrix c.
+  arma::sp_mat sparseC;
   //! A_i for each constraint.
   std::vector<arma::mat> a;
+  //! Sparse A_i for each constraint (of mode 2).
+  std::vector<arma::sp_mat> sparseA;
   //! b_i for each constraint.
   arma::vec b;
 
   //! Initial point.
   arma::mat initialPoint;
-  //! 1 if entries in matrix, 0 for normal.
+  //! 1 if entries in matrix, 2 for sparse, 3 for low rank, 0 for normal.
   arma::uvec aModes;
 };
 
@@ -106,6 +146,11 @@ void AugLagrangianFunction<LRSDPFunction>::Gradient(
     const arma::mat& coordinates,
     arma::mat& gradient) const;
 
+template<>
+void AugLagrangianFunction<LRSDPFunction>::EvaluateConstraints(
+    const arma::mat& coordinates,
+    arma::vec& constraints) const;
+
 };
 };
 
@@ -0,0 +1,202 @@
+/**
+ * @file minibatch_sgd.hpp
+ *
+ * Mini-batch Stochastic Gradient Descent.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_MINIBATCH_SGD_MINIBATCH_SGD_HPP
+#define __MLPACK_CORE_OPTIMIZERS_MINIBATCH_SGD_MINIBATCH_SGD_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/util/sfinae_utility.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * Mini-batch Stochastic Gradient Descent is a variant of SGD (see
+ * mlpack::optimization::SGD) in which each step uses the gradient of a batch of
+ * consecutive functions, instead of a single function.  For a batch size
+ * \f$ b \f$, each step is
+ *
+ * \f[
+ * A_{j + 1} = A_j - \frac{\alpha}{b} \sum_{i = k}^{k + b - 1} \nabla f_i(A_j)
+ * \f]
+ *
+ * where \f$ \alpha \f$ is the step size and \f$ k \f$ is the first function of
+ * the batch.  The functions are split into batches of consecutive indices (the
+ * last batch may be smaller), and the batches are visited either in linear
+ * order or in a random order.  As with SGD, the algorithm terminates when the
+ * maximum number of iterations (batches) is reached, or when a full pass over
+ * all the functions improves the objective by less than the tolerance.
+ *
+ * The DecomposableFunctionType template parameter must implement the same
+ * functions as for SGD:
+ *
+ *   size_t NumFunctions();
+ *   double Evaluate(const arma::mat& coordinates, const size_t i);
+ *   void Gradient(const arma::mat& coordinates,
+ *                 const size_t i,
+ *                 arma::mat& gradient);
+ *
+ * It may also implement batch versions of Evaluate() and Gradient(), which
+ * return the sum of the objectives (or of the gradients) of the functions
+ * begin, ..., begin + batchSize - 1:
+ *
+ *   double Evaluate(const arma::mat& coordinates,
+ *                   const size_t begin,
+ *                   const size_t batchSize) const;
+ *   void Gradient(const arma::mat& coordinates,
+ *                 const size_t begin,
+ *                 const size_t batchSize,
+ *                 arma::mat& gradient) const;
+ *
+ * If they are available, they are used (this allows the function to do the
+ * work for a batch with matrix operations); otherwise, the individual
+ * functions are evaluated and summed.
+ *
+ * @tparam DecomposableFunctionType Decomposable objective function type to be
+ *     minimized.
+ */
+template<typename DecomposableFunctionType>
+class MiniBatchSGD
+{
+ public:
+  /**
+   * Construct the mini-batch SGD optimizer with the given function and
+   * parameters.
+   *
+   * @param function Function to be optimized (minimized).
+   * @param stepSize Step size for each iteration.
+   * @param batchSize Number of functions in each batch.
+   * @param maxIterations Maximum number of iterations (batches) allowed (0
+   *     means no limit).
+   * @param tolerance Maximum absolute tolerance to terminate algorithm.
+   * @param shuffle If true, the batch order is shuffled; otherwise, each batch
+   *     is visited in linear order.
+   */
+  MiniBatchSGD(DecomposableFunctionType& function,
+               const double stepSize = 0.01,
+               const size_t batchSize = 1000,
+               const size_t maxIterations = 100000,
+               const double tolerance = 1e-5,
+               const bool shuffle = true);
+
+  /**
+   * Optimize the given function using mini-batch stochastic gradient descent.
+   * The given starting point will be modified to store the finishing point of
+   * the algorithm, and the final objective value is returned.
+   *
+   * @param iterate Starting point (will be modified).
+   * @return Objective value of the final point.
+   */
+  double Optimize(arma::mat& iterate);
+
+  //! Get the instantiated function to be optimized.
+  const DecomposableFunctionType& Function() const { return function; }
+  //! Modify the instantiated function.
+  DecomposableFunctionType& Function() { return function; }
+
+  //! Get the step size.
+  double StepSize() const { return stepSize; }
+  //! Modify the step size.
+  double& StepSize() { return stepSize; }
+
+  //! Get the batch size.
+  size_t BatchSize() const { return batchSize; }
+  //! Modify the batch size.
+  size_t& BatchSize() { return batchSize; }
+
+  //! Get the maximum number of iterations (0 indicates no limit).
+  size_t MaxIterations() const { return maxIterations; }
+  //! Modify the maximum number of iterations (0 indicates no limit).
+  size_t& MaxIterations() { return maxIterations; }
+
+  //! Get the tolerance for termination.
+  double Tolerance() const { return tolerance; }
+  //! Modify the tolerance for termination.
+  double& Tolerance() { return tolerance; }
+
+  //! Get whether or not the batches are shuffled.
+  bool Shuffle() const { return shuffle; }
+  //! Modify whether or not the batches are shuffled.
+  bool& Shuffle() { return shuffle; }
+
+  // Convert the object into a string.
+  std::string ToString() const;
+
+ private:
+  HAS_MEM_FUNC(Evaluate, HasBatchEvaluate)
+  HAS_MEM_FUNC(Gradient, HasBatchGradient)
+
+  //! Evaluate the sum of the objectives of a batch with one call, if the
+  //! function can do that.
+  template<typename FunctionType>
+  static double BatchEvaluate(const FunctionType& function,
+      const arma::mat& iterate,
+      const size_t begin,
+      const size_t batchSize,
+      typename boost::enable_if<HasBatchEvaluate<FunctionType,
+          double(FunctionType::*)(const arma::mat&, const size_t, const size_t)
+          const> >::type* = 0);
+
+  //! Otherwise, evaluate each function of the batch.
+  template<typename FunctionType>
+  static double BatchEvaluate(FunctionType& function,
+      const arma::mat& iterate,
+      const size_t begin,
+      const size_t batchSize,
+      typename boost::disable_if<HasBatchEvaluate<FunctionType,
+          double(FunctionType::*)(const arma::mat&, const size_t, const size_t)
+          const> >::type* = 0);
+
+  //! Compute the sum of the gradients of a batch with one call, if the
+  //! function can do that.
+  template<typename FunctionType>
+  static void BatchGradient(const FunctionType& function,
+      const arma::mat& iterate,
+      const size_t begin,
+      const size_t batchSize,
+      arma::mat& gradient,
+      arma::mat& /* pointGradient */,
+      typename boost::enable_if<HasBatchGradient<FunctionType,
+          void(FunctionType::*)(const arma::mat&, const size_t, const size_t,
+          arma::mat&) const> >::type* = 0);
+
+  //! Otherwise, compute the gradient of each function of the batch.
+  template<typename FunctionType>
+  static void BatchGradient(FunctionType& function,
+      const arma::mat& iterate,
+      const size_t begin,
+      const size_t batchSize,
+      arma::mat& gradient,
+      arma::mat& pointGradient,
+      typename boost::disable_if<HasBatchGradient<FunctionType,
+          void(FunctionType::*)(const arma::mat&, const size_t, const size_t,
+          arma::mat&) const> >::type* = 0);
+
+  //! The instantiated function.
+  DecomposableFunctionType& function;
+
+  //! The step size for each batch.
+  double stepSize;
+
+  //! The number of functions in each batch.
+  size_t batchSize;
+
+  //! The maximum number of allowed iterations.
+  size_t maxIterations;
+
+  //! The tolerance for termination.
+  double tolerance;
+
+  //! Controls whether or not the batches are shuffled when iterating.
+  bool shuffle;
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+// Include implementation.
+#include "minibatch_sgd_impl.hpp"
+
+#endif
@@ -0,0 +1,210 @@
+/**
+ * @file minibatch_sgd_impl.hpp
+ *
+ * Implementation of mini-batch stochastic gradient descent.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_MINIBATCH_SGD_MINIBATCH_SGD_IMPL_HPP
+#define __MLPACK_CORE_OPTIMIZERS_MINIBATCH_SGD_MINIBATCH_SGD_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "minibatch_sgd.hpp"
+
+namespace mlpack {
+namespace optimization {
+
+template<typename DecomposableFunctionType>
+MiniBatchSGD<DecomposableFunctionType>::MiniBatchSGD(
+    DecomposableFunctionType& function,
+    const double stepSize,
+    const size_t batchSize,
+    const size_t maxIterations,
+    const double tolerance,
+    const bool shuffle) :
+    function(function),
+    stepSize(stepSize),
+    batchSize(batchSize),
+    maxIterations(maxIterations),
+    tolerance(tolerance),
+    shuffle(shuffle)
+{ /* Nothing to do. */ }
+
+//! Optimize the function (minimize).
+template<typename DecomposableFunctionType>
+double MiniBatchSGD<DecomposableFunctionType>::Optimize(arma::mat& iterate)
+{
+  // Find the number of functions and batches to use.
+  const size_t numFunctions = function.NumFunctions();
+  const size_t effectiveBatchSize = std::max(std::min(batchSize, numFunctions),
+      (size_t) 1);
+  const size_t numBatches = (numFunctions + effectiveBatchSize - 1) /
+      effectiveBatchSize;
+
+  // This is used only if shuffle is true.
+  arma::Col<size_t> visitationOrder;
+  if (shuffle)
+    visitationOrder = arma::shuffle(arma::linspace<arma::Col<size_t> >(0,
+        numBatches - 1, numBatches));
+
+  // To keep track of where we are and how things are going.
+  size_t currentBatch = 0;
+  double overallObjective = 0;
+  double lastObjective = DBL_MAX;
+
+  // Calculate the first objective function.
+  for (size_t b = 0; b < numBatches; ++b)
+  {
+    const size_t begin = b * effectiveBatchSize;
+    overallObjective += BatchEvaluate(function, iterate, begin,
+        std::min(effectiveBatchSize, numFunctions - begin));
+  }
+
+  // Now iterate!
+  arma::mat gradient(iterate.n_rows, iterate.n_cols);
+  arma::mat pointGradient(iterate.n_rows, iterate.n_cols);
+  for (size_t i = 1; i != maxIterations; ++i, ++currentBatch)
+  {
+    // Is this iteration the start of a sequence?
+    if ((currentBatch % numBatches) == 0)
+    {
+      // Output current objective function.
+      Log::Info << "Mini-batch SGD: iteration " << i << ", objective "
+          << overallObjective << "." << std::endl;
+
+      if (overallObjective != overallObjective)
+      {
+        Log::Warn << "Mini-batch SGD: converged to " << overallObjective
+            << "; terminating with failure.  Try a smaller step size?"
+            << std::endl;
+        return overallObjective;
+      }
+
+      if (std::abs(lastObjective - overallObjective) < tolerance)
+      {
+        Log::Info << "Mini-batch SGD: minimized within tolerance "
+            << tolerance << "; terminating optimization." << std::endl;
+        return overallObjective;
+      }
+
+      // Reset the counter variables.
+      lastObjective = overallObjective;
+      overallObjective = 0;
+      currentBatch = 0;
+
+      if (shuffle) // Determine order of visitation.
+        visitationOrder = arma::shuffle(visitationOrder);
+    }
+
+    // Find the functions in this batch.
+    const size_t batch = shuffle ? visitationOrder[currentBatch] : currentBatch;
+    const size_t begin = batch * effectiveBatchSize;
+    const size_t size = std::min(effectiveBatchSize, numFunctions - begin);
+
+    // Evaluate the gradient for this iteration, and update the iterate.
+    BatchGradient(function, iterate, begin, size, gradient, pointGradient);
+    iterate -= (stepSize / size) * gradient;
+
+    // Now add that to the overall objective function.
+    overallObjective += BatchEvaluate(function, iterate, begin, size);
+  }
+
+  Log::Info << "Mini-batch SGD: maximum iterations (" << maxIterations << ") "
+      << "reached; terminating optimization." << std::endl;
+  // Calculate final objective.
+  overallObjective = 0;
+  for (size_t b = 0; b < numBatches; ++b)
+  {
+    const size_t begin = b * effectiveBatchSize;
+    overallObjective += BatchEvaluate(function, iterate, begin,
+        std::min(effectiveBatchSize, numFunctions - begin));
+  }
+  return overallObjective;
+}
+
+template<typename DecomposableFunctionType>
+template<typename FunctionType>
+double MiniBatchSGD<DecomposableFunctionType>::BatchEvaluate(
+    const FunctionType& function,
+    const arma::mat& iterate,
+    const size_t begin,
+    const size_t batchSize,
+    typename boost::enable_if<HasBatchEvaluate<FunctionType,
+        double(FunctionType::*)(const arma::mat&, const size_t, const size_t)
+        const> >::type*)
+{
+  return function.Evaluate(iterate, begin, batchSize);
+}
+
+template<typename DecomposableFunctionType>
+template<typename FunctionType>
+double MiniBatchSGD<DecomposableFunctionType>::BatchEvaluate(
+    FunctionType& function,
+    const arma::mat& iterate,
+    const size_t begin,
+    const size_t batchSize,
+    typename boost::disable_if<HasBatchEvaluate<FunctionType,
+        double(FunctionType::*)(const arma::mat&, const size_t, const size_t)
+        const> >::type*)
+{
+  double objective = 0;
+  for (size_t i = begin; i < begin + batchSize; ++i)
+    objective += function.Evaluate(iterate, i);
+  return objective;
+}
+
+template<typename DecomposableFunctionType>
+template<typename FunctionType>
+void MiniBatchSGD<DecomposableFunctionType>::BatchGradient(
+    const FunctionType& function,
+    const arma::mat& iterate,
+    const size_t begin,
+    const size_t batchSize,
+    arma::mat& gradient,
+    arma::mat& /* pointGradient */,
+    typename boost::enable_if<HasBatchGradient<FunctionType,
+        void(FunctionType::*)(const arma::mat&, const size_t, const size_t,
+        arma::mat&) const> >::type*)
+{
+  function.Gradient(iterate, begin, batchSize, gradient);
+}
+
+template<typename DecomposableFunctionType>
+template<typename FunctionType>
+void MiniBatchSGD<DecomposableFunctionType>::BatchGradient(
+    FunctionType& function,
+    const arma::mat& iterate,
+    const size_t begin,
+    const size_t batchSize,
+    arma::mat& gradient,
+    arma::mat& pointGradient,
+    typename boost::disable_if<HasBatchGradient<FunctionType,
+        void(FunctionType::*)(const arma::mat&, const size_t, const size_t,
+        arma::mat&) const> >::type*)
+{
+  function.Gradient(iterate, begin, gradient);
+  for (size_t i = begin + 1; i < begin + batchSize; ++i)
+  {
+    function.Gradient(iterate, i, pointGradient);
+    gradient += pointGradient;
+  }
+}
+
+// Convert the object to a string.
+template<typename DecomposableFunctionType>
+std::string MiniBatchSGD<DecomposableFunctionType>::ToString() const
+{
+  std::ostringstream convert;
+  convert << "MiniBatchSGD [" << this << "]" << std::endl;
+  convert << "  Function:" << std::endl;
+  convert << util::Indent(function.ToString(), 2);
+  convert << "  Step size: " << stepSize << std::endl;
+  convert << "  Batch size: " << batchSize << std::endl;
+  convert << "  Maximum iterations: " << maxIterations << std::endl;
+  convert << "  Tolerance: " << tolerance << std::endl;
+  convert << "  Shuffle batches: " << (shuffle ? "true" : "false") << std::endl;
+  return convert.str();
+}
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
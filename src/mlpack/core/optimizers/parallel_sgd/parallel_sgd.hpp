@@ -0,0 +1,191 @@
+/**
+ * @file parallel_sgd.hpp
+ *
+ * Parallel Stochastic Gradient Descent (Hogwild!).
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_PARALLEL_SGD_PARALLEL_SGD_HPP
+#define __MLPACK_CORE_OPTIMIZERS_PARALLEL_SGD_PARALLEL_SGD_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/util/sfinae_utility.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * Parallel stochastic gradient descent, with OpenMP.  This is a parallel
+ * version of SGD (see mlpack::optimization::SGD) for the same kind of
+ * decomposable functions, with two schemes:
+ *
+ *  - Hogwild! (the default), described in the paper 'Hogwild!: A Lock-Free
+ *    Approach to Parallelizing Stochastic Gradient Descent' by F. Niu, B.
+ *    Recht, C. Re and S. J. Wright.  The functions of each epoch are visited
+ *    in a random order, split between the threads, and every thread updates
+ *    the shared iterate without locking.  This works well when each gradient
+ *    only touches a few coordinates, so that the threads rarely update the same
+ *    coordinates at the same time; the result is not deterministic.
+ *
+ *  - Averaging, described in the paper 'Parallelized Stochastic Gradient
+ *    Descent' by M. Zinkevich, M. Weimer, A. Smola and L. Li.  The functions of
+ *    each epoch are split between a fixed number of workers, each of which runs
+ *    SGD on its own copy of the iterate; the copies are averaged at the end of
+ *    the epoch.  The result only depends on the random seed and the number of
+ *    threads, not on the scheduling of the threads.
+ *
+ * One epoch visits each of the \f$ n \f$ functions once.  After each epoch,
+ * the objective is computed (in parallel), and the algorithm terminates when
+ * it improves by less than the tolerance, or when the maximum number of
+ * iterations (individual function visits) is reached.
+ *
+ * The DecomposableFunctionType template parameter must implement
+ *
+ *   size_t NumFunctions();
+ *   double Evaluate(const arma::mat& coordinates, const size_t i) const;
+ *
+ * and either the gradient of SGD,
+ *
+ *   void Gradient(const arma::mat& coordinates,
+ *                 const size_t i,
+ *                 arma::mat& gradient) const;
+ *
+ * or a sparse gradient, given by the linear indices of its nonzero elements in
+ * the coordinates and by their values,
+ *
+ *   void Gradient(const arma::mat& coordinates,
+ *                 const size_t i,
+ *                 arma::uvec& indices,
+ *                 arma::vec& values) const;
+ *
+ * If the sparse gradient is available, it is used, and each step only writes
+ * the touched coordinates.  All of these functions are called from several
+ * threads at once, so they must be thread-safe.
+ *
+ * @tparam DecomposableFunctionType Decomposable objective function type to be
+ *     minimized.
+ */
+template<typename DecomposableFunctionType>
+class ParallelSGD
+{
+ public:
+  /**
+   * Construct the parallel SGD optimizer with the given function and
+   * parameters.
+   *
+   * @param function Function to be optimized (minimized).
+   * @param stepSize Step size for each iteration.
+   * @param maxIterations Maximum number of iterations (function visits)
+   *     allowed (0 means no limit).
+   * @param tolerance Maximum absolute tolerance to terminate algorithm.
+   * @param averaged If true, the deterministic averaging scheme is used;
+   *     otherwise, Hogwild! is used.
+   * @param threads Number of threads (or workers, for the averaging scheme); 0
+   *     means the number of OpenMP threads.
+   */
+  ParallelSGD(DecomposableFunctionType& function,
+              const double stepSize = 0.01,
+              const size_t maxIterations = 100000,
+              const double tolerance = 1e-5,
+              const bool averaged = false,
+              const size_t threads = 0);
+
+  /**
+   * Optimize the given function using parallel stochastic gradient descent.
+   * The given starting point will be modified to store the finishing point of
+   * the algorithm, and the final objective value is returned.
+   *
+   * @param iterate Starting point (will be modified).
+   * @return Objective value of the final point.
+   */
+  double Optimize(arma::mat& iterate);
+
+  //! Get the instantiated function to be optimized.
+  const DecomposableFunctionType& Function() const { return function; }
+  //! Modify the instantiated function.
+  DecomposableFunctionType& Function() { return function; }
+
+  //! Get the step size.
+  double StepSize() const { return stepSize; }
+  //! Modify the step size.
+  double& StepSize() { return stepSize; }
+
+  //! Get the maximum number of iterations (0 indicates no limit).
+  size_t MaxIterations() const { return maxIterations; }
+  //! Modify the maximum number of iterations (0 indicates no limit).
+  size_t& MaxIterations() { return maxIterations; }
+
+  //! Get the tolerance for termination.
+  double Tolerance() const { return tolerance; }
+  //! Modify the tolerance for termination.
+  double& Tolerance() { return tolerance; }
+
+  //! Get whether the averaging scheme is used (otherwise, Hogwild!).
+  bool Averaged() const { return averaged; }
+  //! Modify whether the averaging scheme is used (otherwise, Hogwild!).
+  bool& Averaged() { return averaged; }
+
+  //! Get the number of threads (0 means the number of OpenMP threads).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads (0 means the number of OpenMP threads).
+  size_t& Threads() { return threads; }
+
+  // Convert the object into a string.
+  std::string ToString() const;
+
+ private:
+  HAS_MEM_FUNC(Gradient, HasSparseGradient)
+
+  //! Compute the objective of all the functions, in parallel.
+  double Objective(const arma::mat& iterate) const;
+
+  //! Take a step on the given iterate with the sparse gradient of function i.
+  template<typename FunctionType>
+  static void Step(const FunctionType& function,
+      arma::mat& iterate,
+      const size_t i,
+      const double stepSize,
+      arma::mat& /* gradient */,
+      arma::uvec& indices,
+      arma::vec& values,
+      typename boost::enable_if<HasSparseGradient<FunctionType,
+          void(FunctionType::*)(const arma::mat&, const size_t, arma::uvec&,
+          arma::vec&) const> >::type* = 0);
+
+  //! Take a step on the given iterate with the gradient of function i.
+  template<typename FunctionType>
+  static void Step(const FunctionType& function,
+      arma::mat& iterate,
+      const size_t i,
+      const double stepSize,
+      arma::mat& gradient,
+      arma::uvec& /* indices */,
+      arma::vec& /* values */,
+      typename boost::disable_if<HasSparseGradient<FunctionType,
+          void(FunctionType::*)(const arma::mat&, const size_t, arma::uvec&,
+          arma::vec&) const> >::type* = 0);
+
+  //! The instantiated function.
+  DecomposableFunctionType& function;
+
+  //! The step size for each example.
+  double stepSize;
+
+  //! The maximum number of allowed iterations.
+  size_t maxIterations;
+
+  //! The tolerance for termination.
+  double tolerance;
+
+  //! Whether the averaging scheme is used (otherwise, Hogwild!).
+  bool averaged;
+
+  //! The number of threads (0 means the number of OpenMP threads).
+  size_t threads;
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+// Include implementation.
+#include "parallel_sgd_impl.hpp"
+
+#endif
@@ -0,0 +1,206 @@
+/**
+ * @file parallel_sgd_impl.hpp
+ *
+ * Implementation of parallel stochastic gradient descent.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_PARALLEL_SGD_PARALLEL_SGD_IMPL_HPP
+#define __MLPACK_CORE_OPTIMIZERS_PARALLEL_SGD_PARALLEL_SGD_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "parallel_sgd.hpp"
+
+namespace mlpack {
+namespace optimization {
+
+template<typename DecomposableFunctionType>
+ParallelSGD<DecomposableFunctionType>::ParallelSGD(
+    DecomposableFunctionType& function,
+    const double stepSize,
+    const size_t maxIterations,
+    const double tolerance,
+    const bool averaged,
+    const size_t threads) :
+    function(function),
+    stepSize(stepSize),
+    maxIterations(maxIterations),
+    tolerance(tolerance),
+    averaged(averaged),
+    threads(threads)
+{ /* Nothing to do. */ }
+
+//! Optimize the function (minimize).
+template<typename DecomposableFunctionType>
+double ParallelSGD<DecomposableFunctionType>::Optimize(arma::mat& iterate)
+{
+  // Find the number of functions to use.
+  const size_t numFunctions = function.NumFunctions();
+
+#ifdef _OPENMP
+  const size_t numThreads = util::NumThreads(threads);
+#else
+  const size_t numThreads = (threads == 0) ? 1 : threads;
+#endif
+
+  arma::uvec visitationOrder = arma::linspace<arma::uvec>(0,
+      numFunctions - 1, numFunctions);
+
+  // To keep track of how things are going.
+  size_t iterations = 0;
+  double overallObjective = Objective(iterate);
+  double lastObjective = DBL_MAX;
+
+  // The copies of the iterate, for the averaging scheme.
+  std::vector<arma::mat> iterates(averaged ? numThreads : 0);
+
+  size_t epoch = 0;
+  while (maxIterations == 0 || iterations < maxIterations)
+  {
+    // Output current objective function.
+    Log::Info << "Parallel SGD: epoch " << epoch << ", objective "
+        << overallObjective << "." << std::endl;
+
+    if (overallObjective != overallObjective)
+    {
+      Log::Warn << "Parallel SGD: converged to " << overallObjective << "; "
+          << "terminating with failure.  Try a smaller step size?"
+          << std::endl;
+      return overallObjective;
+    }
+
+    if (std::abs(lastObjective - overallObjective) < tolerance)
+    {
+      Log::Info << "Parallel SGD: minimized within tolerance " << tolerance
+          << "; terminating optimization." << std::endl;
+      return overallObjective;
+    }
+
+    // The number of functions visited in this epoch.
+    const size_t visits = (maxIterations == 0) ? numFunctions :
+        std::min(numFunctions, maxIterations - iterations);
+
+    // Determine order of visitation.
+    visitationOrder = arma::shuffle(visitationOrder);
+
+    if (averaged)
+    {
+      // Each worker runs SGD on its own copy of the iterate, with its own
+      // share of the functions.
+      #pragma omp parallel for num_threads(numThreads) schedule(static, 1)
+      for (size_t w = 0; w < numThreads; ++w)
+      {
+        arma::mat gradient(iterate.n_rows, iterate.n_cols);
+        arma::uvec indices;
+        arma::vec values;
+
+        iterates[w] = iterate;
+        for (size_t k = w; k < visits; k += numThreads)
+          Step(function, iterates[w], visitationOrder[k], stepSize, gradient,
+              indices, values);
+      }
+
+      iterate = iterates[0];
+      for (size_t w = 1; w < numThreads; ++w)
+        iterate += iterates[w];
+      iterate /= numThreads;
+    }
+    else
+    {
+      // Every thread updates the shared iterate without locking.
+      #pragma omp parallel num_threads(numThreads)
+      {
+        arma::mat gradient(iterate.n_rows, iterate.n_cols);
+        arma::uvec indices;
+        arma::vec values;
+
+        #pragma omp for schedule(static)
+        for (size_t k = 0; k < visits; ++k)
+          Step(function, iterate, visitationOrder[k], stepSize, gradient,
+              indices, values);
+      }
+    }
+
+    iterations += visits;
+    ++epoch;
+
+    lastObjective = overallObjective;
+    overallObjective = Objective(iterate);
+  }
+
+  Log::Info << "Parallel SGD: maximum iterations (" << maxIterations << ") "
+      << "reached; terminating optimization." << std::endl;
+  return overallObjective;
+}
+
+template<typename DecomposableFunctionType>
+double ParallelSGD<DecomposableFunctionType>::Objective(
+    const arma::mat& iterate) const
+{
+  const size_t numFunctions = function.NumFunctions();
+
+  double objective = 0;
+  #pragma omp parallel for schedule(static) reduction(+:objective)
+  for (size_t i = 0; i < numFunctions; ++i)
+    objective += function.Evaluate(iterate, i);
+
+  return objective;
+}
+
+template<typename DecomposableFunctionType>
+template<typename FunctionType>
+void ParallelSGD<DecomposableFunctionType>::Step(
+    const FunctionType& function,
+    arma::mat& iterate,
+    const size_t i,
+    const double stepSize,
+    arma::mat& /* gradient */,
+    arma::uvec& indices,
+    arma::vec& values,
+    typename boost::enable_if<HasSparseGradient<FunctionType,
+        void(FunctionType::*)(const arma::mat&, const size_t, arma::uvec&,
+        arma::vec&) const> >::type*)
+{
+  function.Gradient(iterate, i, indices, values);
+
+  // Only the touched coordinates are written.
+  for (size_t k = 0; k < indices.n_elem; ++k)
+    iterate[indices[k]] -= stepSize * values[k];
+}
+
+template<typename DecomposableFunctionType>
+template<typename FunctionType>
+void ParallelSGD<DecomposableFunctionType>::Step(
+    const FunctionType& function,
+    arma::mat& iterate,
+    const size_t i,
+    const double stepSize,
+    arma::mat& gradient,
+    arma::uvec& /* indices */,
+    arma::vec& /* values */,
+    typename boost::disable_if<HasSparseGradient<FunctionType,
+        void(FunctionType::*)(const arma::mat&, const size_t, arma::uvec&,
+        arma::vec&) const> >::type*)
+{
+  function.Gradient(iterate, i, gradient);
+  iterate -= stepSize * gradient;
+}
+
+// Convert the object to a string.
+template<typename DecomposableFunctionType>
+std::string ParallelSGD<DecomposableFunctionType>::ToString() const
+{
+  std::ostringstream convert;
+  convert << "ParallelSGD [" << this << "]" << std::endl;
+  convert << "  Function:" << std::endl;
+  convert << util::Indent(function.ToString(), 2);
+  convert << "  Step size: " << stepSize << std::endl;
+  convert << "  Maximum iterations: " << maxIterations << std::endl;
+  convert << "  Tolerance: " << tolerance << std::endl;
+  convert << "  Averaged: " << (averaged ? "true" : "false") << std::endl;
+  convert << "  Threads: " << threads << std::endl;
+  return convert.str();
+}
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
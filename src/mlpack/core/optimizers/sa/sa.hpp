@@ -8,6 +8,8 @@
 #define __MLPACK_CORE_OPTIMIZERS_SA_SA_HPP
 
 #include <mlpack/prereqs.hpp>
+#include <mlpack/core/util/sfinae_utility.hpp>
+#include <boost/random.hpp>
 
 #include "exponential_schedule.hpp"
 
@@ -50,6 +52,27 @@ namespace optimization {
  * which returns the next temperature given current temperature and the value
  * of the function being optimized.
  *
+ * If the FunctionType parameter also implements
+ *
+ *   double EvaluateDelta(const arma::mat& coordinates,
+ *                        const size_t i,
+ *                        const double move) const;
+ *
+ * which returns the change of the objective when coordinates[i] is increased
+ * by move, SA uses it instead of Evaluate() for each move, so a function whose
+ * terms only depend on a few coordinates does not need to be evaluated fully.
+ *
+ * With more than one chain, SA runs parallel tempering: independent chains run
+ * in parallel (with OpenMP), the chain c starting at the temperature
+ * initT * 2^c, each with its own copy of the cooling schedule and its own
+ * random number stream (see math::StreamSeed()).  Every exchangeSweeps sweeps,
+ * the states of adjacent chains are exchanged according to the Metropolis
+ * criterion, so that the low-energy states move to the cold chains and the hot
+ * chains keep exploring.  The optimization stops when the coldest
+ * chain is frozen, and the best final state of all the chains is returned.  In
+ * this mode, Evaluate() (or EvaluateDelta()) is called concurrently from
+ * several threads, so it must not modify the function.
+ *
  * @tparam FunctionType objective function type to be minimized.
  * @tparam CoolingScheduleType type for cooling schedule
  */
@@ -75,6 +98,9 @@ class SA
    * @param maxMoveCoef Maximum move size.
    * @param initMoveCoef Initial move size.
    * @param gain Proportional control in feedback move control.
+   * @param chains Number of chains run in parallel (parallel tempering).
+   * @param exchangeSweeps Sweeps between two exchanges of states between the
+   *      chains.
    */
   SA(FunctionType& function,
      CoolingScheduleType& coolingSchedule,
@@ -86,7 +112,9 @@ class SA
      const size_t maxToleranceSweep = 3,
      const double maxMoveCoef = 20,
      const double initMoveCoef = 0.3,
-     const double gain = 0.3);
+     const double gain = 0.3,
+     const size_t chains = 1,
+     const size_t exchangeSweeps = 10);
 
   /**
    * Optimize the given function using simulated annealing. The given starting
@@ -138,6 +166,16 @@ class SA
   //! Modify the maximum number of iterations.
   size_t& MaxIterations() { return maxIterations; }
 
+  //! Get the number of chains.
+  size_t Chains() const { return chains; }
+  //! Modify the number of chains.
+  size_t& Chains() { return chains; }
+
+  //! Get the number of sweeps between two exchanges of states.
+  size_t ExchangeSweeps() const { return exchangeSweeps; }
+  //! Modify the number of sweeps between two exchanges of states.
+  size_t& ExchangeSweeps() { return exchangeSweeps; }
+
   //! Get the maximum move size of each parameter.
   arma::mat MaxMove() const { return maxMove; }
   //! Modify the maximum move size of each parameter.
@@ -169,6 +207,10 @@ class SA
   size_t maxToleranceSweep;
   //! Proportional control in feedback move control.
   double gain;
+  //! Number of chains run in parallel.
+  size_t chains;
+  //! Number of sweeps between two exchanges of states between the chains.
+  size_t exchangeSweeps;
 
   //! Maximum move size of each parameter.
   arma::mat maxMove;
@@ -176,25 +218,48 @@ class SA
   arma::mat moveSize;
 
   /**
-   * GenerateMove proposes a move on element iterate(idx), and determines if
-   * that move is acceptable or not according to the Metropolis criterion.
-   * After that it increments idx so the next call will make a move on next
-   * parameters. When all elements of the state have been moved (a sweep), it
-   * resets idx and increments sweepCounter. When sweepCounter reaches
-   * moveCtrlSweep, it performs MoveControl() and resets sweepCounter.
+   * The state of one Markov chain: its position, its energy, its temperature
+   * and cooling schedule, its move control, and its random number generator.
+   */
+  struct Chain
+  {
+    Chain(const CoolingScheduleType& coolingSchedule) :
+        coolingSchedule(coolingSchedule) { }
+
+    //! Current optimization position.
+    arma::mat iterate;
+    //! Which parameters have had accepted moves since the last MoveControl().
+    arma::mat accept;
+    //! Move size of each parameter.
+    arma::mat moveSize;
+    //! Current energy of the system.
+    double energy;
+    //! Current temperature.
+    double temperature;
+    //! Current parameter to modify.
+    size_t idx;
+    //! Number of sweeps completed since the last MoveControl().
+    size_t sweepCounter;
+    //! Number of consecutive moves which changed the energy less than the
+    //! tolerance.
+    size_t frozenCount;
+    //! The cooling schedule of this chain.
+    CoolingScheduleType coolingSchedule;
+    //! The random number generator of this chain.
+    boost::mt19937 generator;
+  };
+
+  /**
+   * GenerateMove proposes a move on element iterate(idx) of the chain, and
+   * determines if that move is acceptable or not according to the Metropolis
+   * criterion.  After that it increments idx so the next call will make a move
+   * on next parameters. When all elements of the state have been moved (a
+   * sweep), it resets idx and increments sweepCounter. When sweepCounter
+   * reaches moveCtrlSweep, it performs MoveControl() and resets sweepCounter.
    *
-   * @param iterate Current optimization position.
-   * @param accept Matrix representing which parameters have had accepted moves.
-   * @param energy Current energy of the system.
-   * @param idx Current parameter to modify.
-   * @param sweepCounter Current counter representing how many sweeps have been
-   *      completed.
+   * @param chain Chain to move.
    */
-  void GenerateMove(arma::mat& iterate,
-                    arma::mat& accept,
-                    double& energy,
-                    size_t& idx,
-                    size_t& sweepCounter);
+  void GenerateMove(Chain& chain);
 
   /**
    * MoveControl() uses a proportional feedback control to determine the size
@@ -213,8 +278,42 @@ class SA
    *
    * @param nMoves Number of moves since last call.
    * @param accept Matrix representing which parameters have had accepted moves.
+   * @param moveSize Move size of each parameter (will be modified).
+   */
+  void MoveControl(const size_t nMoves, arma::mat& accept, arma::mat& moveSize);
+
+  /**
+   * Exchange the states of adjacent chains according to the Metropolis
+   * criterion for parallel tempering: the states of chains at inverse
+   * temperatures b_c and b_{c + 1} are exchanged with probability
+   * min{1, exp((b_c - b_{c + 1}) (E_c - E_{c + 1}))}.
    */
-  void MoveControl(const size_t nMoves, arma::mat& accept);
+  void ExchangeStates(std::vector<Chain>& chainStates);
+
+  HAS_MEM_FUNC(EvaluateDelta, HasEvaluateDelta)
+
+  //! Move iterate(idx) and return the new energy, using EvaluateDelta().
+  template<typename FunctionT>
+  static double MoveEnergy(FunctionT& function,
+      arma::mat& iterate,
+      const size_t idx,
+      const double move,
+      const double energy,
+      typename boost::enable_if<HasEvaluateDelta<FunctionT,
+          double(FunctionT::*)(const arma::mat&, const size_t, const double)
+          const> >::type* = 0);
+
+  //! Move iterate(idx) and return the new energy, evaluating the function at
+  //! the new position.
+  template<typename FunctionT>
+  static double MoveEnergy(FunctionT& function,
+      arma::mat& iterate,
+      const size_t idx,
+      const double move,
+      const double energy,
+      typename boost::disable_if<HasEvaluateDelta<FunctionT,
+          double(FunctionT::*)(const arma::mat&, const size_t, const double)
+          const> >::type* = 0);
 };
 
 }; // namespace optimization
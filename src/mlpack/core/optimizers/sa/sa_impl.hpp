@@ -27,7 +27,9 @@ SA<FunctionType, CoolingScheduleType>::SA(
     const size_t maxToleranceSweep,
     const double maxMoveCoef,
     const double initMoveCoef,
-    const double gain) :
+    const double gain,
+    const size_t chains,
+    const size_t exchangeSweeps) :
     function(function),
     coolingSchedule(coolingSchedule),
     maxIterations(maxIterations),
@@ -36,7 +38,9 @@ SA<FunctionType, CoolingScheduleType>::SA(
     moveCtrlSweep(moveCtrlSweep),
     tolerance(tolerance),
     maxToleranceSweep(maxToleranceSweep),
-    gain(gain)
+    gain(gain),
+    chains(chains),
+    exchangeSweeps(exchangeSweeps)
 {
   const size_t rows = function.GetInitialPoint().n_rows;
   const size_t cols = function.GetInitialPoint().n_cols;
@@ -57,48 +61,98 @@ double SA<FunctionType, CoolingScheduleType>::Optimize(arma::mat &iterate)
   const size_t rows = function.GetInitialPoint().n_rows;
   const size_t cols = function.GetInitialPoint().n_cols;
 
-  size_t frozenCount = 0;
-  double energy = function.Evaluate(iterate);
-  double oldEnergy = energy;
+  const double energy = function.Evaluate(iterate);
   math::RandomSeed(std::time(NULL));
 
-  size_t idx = 0;
-  size_t sweepCounter = 0;
+  // Set up each chain.  The random number generators are seeded serially, so
+  // the result only depends on the seed of math::randGen.
+  std::vector<Chain> chainStates(chains, Chain(coolingSchedule));
+  const uint64_t streamKey = math::NewStreamKey();
+  for (size_t c = 0; c < chains; ++c)
+  {
+    chainStates[c].iterate = iterate;
+    chainStates[c].accept.zeros(rows, cols);
+    chainStates[c].moveSize = moveSize;
+    chainStates[c].energy = energy;
+    chainStates[c].temperature = temperature * std::pow(2.0, (double) c);
+    chainStates[c].idx = 0;
+    chainStates[c].sweepCounter = 0;
+    chainStates[c].frozenCount = 0;
+    chainStates[c].generator.seed(math::StreamSeed(streamKey, c));
+  }
 
-  arma::mat accept(rows, cols);
-  accept.zeros();
+  const size_t frozenLimit = maxToleranceSweep * moveCtrlSweep *
+      iterate.n_elem;
+  const size_t exchangeMoves = std::max(exchangeSweeps, (size_t) 1) *
+      iterate.n_elem;
 
   // Initial moves to get rid of dependency of initial states.
-  for (size_t i = 0; i < initMoves; ++i)
-    GenerateMove(iterate, accept, energy, idx, sweepCounter);
+  #pragma omp parallel for schedule(static, 1) if (chains > 1)
+  for (size_t c = 0; c < chains; ++c)
+    for (size_t i = 0; i < initMoves; ++i)
+      GenerateMove(chainStates[c]);
 
-  // Iterating and cooling.
-  for (size_t i = 0; i != maxIterations; ++i)
+  // Iterating and cooling.  The chains run independently for exchangeMoves
+  // iterations, and then exchange their states.  The odd comparison allows the
+  // user to pass maxIterations = 0 (i.e. no limit on the number of
+  // iterations).
+  size_t iterations = 0;
+  while (iterations != maxIterations &&
+      chainStates[0].frozenCount < frozenLimit)
   {
-    oldEnergy = energy;
-    GenerateMove(iterate, accept, energy, idx, sweepCounter);
-    temperature = coolingSchedule.NextTemperature(temperature, energy);
-
-    // Determine if the optimization has entered (or continues to be in) a
-    // frozen state.
-    if (std::abs(energy - oldEnergy) < tolerance)
-      ++frozenCount;
-    else
-      frozenCount = 0;
-
-    // Terminate, if possible.
-    if (frozenCount >= maxToleranceSweep * moveCtrlSweep * iterate.n_elem)
+    size_t moves = exchangeMoves;
+    if (maxIterations != 0)
+      moves = std::min(moves, maxIterations - iterations);
+
+    #pragma omp parallel for schedule(static, 1) if (chains > 1)
+    for (size_t c = 0; c < chains; ++c)
     {
-      Log::Debug << "SA: minimized within tolerance " << tolerance << " for "
-          << maxToleranceSweep << " sweeps after " << i << " iterations; "
-          << "terminating optimization." << std::endl;
-      return energy;
+      Chain& chain = chainStates[c];
+      for (size_t i = 0; i < moves && chain.frozenCount < frozenLimit; ++i)
+      {
+        const double oldEnergy = chain.energy;
+        GenerateMove(chain);
+        chain.temperature = chain.coolingSchedule.NextTemperature(
+            chain.temperature, chain.energy);
+
+        // Determine if the chain has entered (or continues to be in) a frozen
+        // state.
+        if (std::abs(chain.energy - oldEnergy) < tolerance)
+          ++chain.frozenCount;
+        else
+          chain.frozenCount = 0;
+      }
     }
+
+    iterations += moves;
+
+    if (chains > 1)
+      ExchangeStates(chainStates);
+  }
+
+  if (chainStates[0].frozenCount >= frozenLimit)
+  {
+    Log::Debug << "SA: minimized within tolerance " << tolerance << " for "
+        << maxToleranceSweep << " sweeps after " << iterations << " iterations;"
+        << " terminating optimization." << std::endl;
+  }
+  else
+  {
+    Log::Debug << "SA: maximum iterations (" << maxIterations << ") reached; "
+        << "terminating optimization." << std::endl;
   }
 
-  Log::Debug << "SA: maximum iterations (" << maxIterations << ") reached; "
-      << "terminating optimization." << std::endl;
-  return energy;
+  // Keep the state of the coldest chain, but return the best final state.
+  temperature = chainStates[0].temperature;
+  moveSize = chainStates[0].moveSize;
+
+  size_t best = 0;
+  for (size_t c = 1; c < chains; ++c)
+    if (chainStates[c].energy < chainStates[best].energy)
+      best = c;
+
+  iterate = chainStates[best].iterate;
+  return chainStates[best].energy;
 }
 
 /**
@@ -113,53 +167,50 @@ template<
     typename FunctionType,
     typename CoolingScheduleType
 >
-void SA<FunctionType, CoolingScheduleType>::GenerateMove(
-    arma::mat& iterate,
-    arma::mat& accept,
-    double& energy,
-    size_t& idx,
-    size_t& sweepCounter)
+void SA<FunctionType, CoolingScheduleType>::GenerateMove(Chain& chain)
 {
-  const double prevEnergy = energy;
-  const double prevValue = iterate(idx);
+  const size_t idx = chain.idx;
+  const double prevEnergy = chain.energy;
+  const double prevValue = chain.iterate(idx);
 
   // It is possible to use a non-Laplace distribution here, but it is difficult
   // because the acceptance ratio should be as close to 0.44 as possible, and
   // MoveControl() is derived for the Laplace distribution.
 
   // Sample from a Laplace distribution with scale parameter moveSize(idx).
-  const double unif = 2.0 * math::Random() - 1.0;
-  const double move = (unif < 0) ? (moveSize(idx) * std::log(1 + unif)) :
-      (-moveSize(idx) * std::log(1 - unif));
+  boost::uniform_01<> uniform;
+  const double unif = 2.0 * uniform(chain.generator) - 1.0;
+  const double move = (unif < 0) ?
+      (chain.moveSize(idx) * std::log(1 + unif)) :
+      (-chain.moveSize(idx) * std::log(1 - unif));
 
-  iterate(idx) += move;
-  energy = function.Evaluate(iterate);
+  chain.energy = MoveEnergy(function, chain.iterate, idx, move, prevEnergy);
   // According to the Metropolis criterion, accept the move with probability
   // min{1, exp(-(E_new - E_old) / T)}.
-  const double xi = math::Random();
-  const double delta = energy - prevEnergy;
-  const double criterion = std::exp(-delta / temperature);
+  const double xi = uniform(chain.generator);
+  const double delta = chain.energy - prevEnergy;
+  const double criterion = std::exp(-delta / chain.temperature);
   if (delta <= 0. || criterion > xi)
   {
-    accept(idx) += 1.;
+    chain.accept(idx) += 1.;
   }
   else // Reject the move; restore previous state.
   {
-    iterate(idx) = prevValue;
-    energy = prevEnergy;
+    chain.iterate(idx) = prevValue;
+    chain.energy = prevEnergy;
   }
 
-  ++idx;
-  if (idx == iterate.n_elem) // Finished with a sweep.
+  ++chain.idx;
+  if (chain.idx == chain.iterate.n_elem) // Finished with a sweep.
   {
-    idx = 0;
-    ++sweepCounter;
+    chain.idx = 0;
+    ++chain.sweepCounter;
   }
 
-  if (sweepCounter == moveCtrlSweep) // Do MoveControl().
+  if (chain.sweepCounter == moveCtrlSweep) // Do MoveControl().
   {
-    MoveControl(moveCtrlSweep, accept);
-    sweepCounter = 0;
+    MoveControl(moveCtrlSweep, chain.accept, chain.moveSize);
+    chain.sweepCounter = 0;
   }
 }
 
@@ -182,7 +233,8 @@ template<
     typename CoolingScheduleType
 >
 void SA<FunctionType, CoolingScheduleType>::MoveControl(const size_t nMoves,
-                                                        arma::mat& accept)
+                                                        arma::mat& accept,
+                                                        arma::mat& moveSize)
 {
   arma::mat target;
   target.copy_size(accept);
@@ -199,6 +251,71 @@ void SA<FunctionType, CoolingScheduleType>::MoveControl(const size_t nMoves,
   accept.zeros();
 }
 
+template<
+    typename FunctionType,
+    typename CoolingScheduleType
+>
+void SA<FunctionType, CoolingScheduleType>::ExchangeStates(
+    std::vector<Chain>& chainStates)
+{
+  for (size_t c = 0; c + 1 < chainStates.size(); ++c)
+  {
+    Chain& cold = chainStates[c];
+    Chain& hot = chainStates[c + 1];
+
+    const double exponent = (1.0 / cold.temperature - 1.0 / hot.temperature) *
+        (cold.energy - hot.energy);
+    if (exponent >= 0. || std::exp(exponent) > math::Random())
+    {
+      // Only the states are exchanged; each chain keeps its temperature and
+      // its move control.
+      cold.iterate.swap(hot.iterate);
+      std::swap(cold.energy, hot.energy);
+      cold.frozenCount = 0;
+      hot.frozenCount = 0;
+    }
+  }
+}
+
+template<
+    typename FunctionType,
+    typename CoolingScheduleType
+>
+template<typename FunctionT>
+double SA<FunctionType, CoolingScheduleType>::MoveEnergy(
+    FunctionT& function,
+    arma::mat& iterate,
+    const size_t idx,
+    const double move,
+    const double energy,
+    typename boost::enable_if<HasEvaluateDelta<FunctionT,
+        double(FunctionT::*)(const arma::mat&, const size_t, const double)
+        const> >::type*)
+{
+  const double delta = function.EvaluateDelta(iterate, idx, move);
+  iterate(idx) += move;
+  return energy + delta;
+}
+
+template<
+    typename FunctionType,
+    typename CoolingScheduleType
+>
+template<typename FunctionT>
+double SA<FunctionType, CoolingScheduleType>::MoveEnergy(
+    FunctionT& function,
+    arma::mat& iterate,
+    const size_t idx,
+    const double move,
+    const double /* energy */,
+    typename boost::disable_if<HasEvaluateDelta<FunctionT,
+        double(FunctionT::*)(const arma::mat&, const size_t, const double)
+        const> >::type*)
+{
+  iterate(idx) += move;
+  return function.Evaluate(iterate);
+}
+
 template<
     typename FunctionType,
     typename CoolingScheduleType
@@ -220,6 +337,8 @@ ToString() const
       << std::endl;
   convert << "  Move control gain: " << gain << std::endl;
   convert << "  Maximum iterations: " << maxIterations << std::endl;
+  convert << "  Chains: " << chains << std::endl;
+  convert << "  Sweeps between exchanges: " << exchangeSweeps << std::endl;
   return convert.str();
 }
 
@@ -8,6 +8,13 @@
 #define __MLPACK_CORE_OPTIMIZERS_SGD_SGD_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/util/sfinae_utility.hpp>
+
+#include "update_policies/vanilla_update.hpp"
+#include "update_policies/momentum_update.hpp"
+#include "update_policies/adagrad_update.hpp"
+#include "update_policies/rmsprop_update.hpp"
+#include "update_policies/adam_update.hpp"
 
 namespace mlpack {
 namespace optimization {
@@ -27,7 +34,11 @@ namespace optimization {
  * A_{j + 1} = A_j + \alpha \nabla f_i(A)
  * \f]
  *
- * where \f$ \alpha \f$ is a parameter which specifies the step size.  \f$ i \f$
+ * where \f$ \alpha \f$ is a parameter which specifies the step size.  This is
+ * the plain update (VanillaUpdate); other step rules are given by the
+ * UpdatePolicyType template parameter (MomentumUpdate, AdaGradUpdate,
+ * RMSPropUpdate, AdamUpdate).  SGD, MomentumSGD, AdaGradSGD, RMSPropSGD and
+ * AdamSGD are shorthands for SGDType with each of them.  \f$ i \f$
  * is chosen according to \f$ j \f$ (the iteration number).  The SGD class
  * supports either scanning through each of the \f$ n \f$ functions \f$ f_i(A)
  * \f$ linearly, or in a random sequence.  The algorithm continues until \f$ j
@@ -64,11 +75,44 @@ namespace optimization {
  * objective function on the first point in the dataset (presumably, the dataset
  * is held internally in the DecomposableFunctionType).
  *
+ * The function may also implement
+ *
+ *   double EvaluateWithGradient(const arma::mat& coordinates,
+ *                               const size_t i,
+ *                               arma::mat& gradient) const;
+ *
+ * which computes the gradient of function i and returns its objective, both at
+ * the given coordinates.  If it is available, it is used in place of separate
+ * calls to Gradient() and Evaluate(); the running objective is then the sum of
+ * the objectives just before each step, instead of just after.
+ *
+ * By default, the objective of each epoch (the tolerance check) is the sum of
+ * the objectives of the functions as they are visited, which costs one
+ * Evaluate() per step.  This bookkeeping can be made cheaper with the
+ * objectiveSamples parameter: the objective is then estimated at the end of
+ * each epoch from a fixed random subset of the functions, scaled up to the
+ * number of functions.  It can also be turned off with the trackObjective
+ * parameter; then only the maximum number of iterations terminates the
+ * optimization, and the objective is only computed for the final point.
+ *
+ * If the function has a sparse gradient, given by the linear indices of its
+ * nonzero elements in the coordinates and by their values,
+ *
+ *   void Gradient(const arma::mat& coordinates,
+ *                 const size_t i,
+ *                 arma::uvec& indices,
+ *                 arma::vec& values) const;
+ *
+ * it is used, and the update policy only updates the touched coordinates (and
+ * its own state for them).
+ *
  * @tparam DecomposableFunctionType Decomposable objective function type to be
  *     minimized.
+ * @tparam UpdatePolicyType Step rule (see VanillaUpdate).
  */
-template<typename DecomposableFunctionType>
-class SGD
+template<typename DecomposableFunctionType,
+         typename UpdatePolicyType = VanillaUpdate>
+class SGDType
 {
  public:
   /**
@@ -81,12 +125,21 @@ class SGD
    * @param tolerance Maximum absolute tolerance to terminate algorithm.
    * @param shuffle If true, the function order is shuffled; otherwise, each
    *     function is visited in linear order.
+   * @param objectiveSamples If nonzero, the objective of each epoch is
+   *     estimated from this many randomly chosen functions at the end of the
+   *     epoch, instead of being summed at each step.
+   * @param trackObjective If false, the objective is not computed during the
+   *     optimization, and the tolerance is not checked.
+   * @param updatePolicy Instantiated step rule.
    */
-  SGD(DecomposableFunctionType& function,
-      const double stepSize = 0.01,
-      const size_t maxIterations = 100000,
-      const double tolerance = 1e-5,
-      const bool shuffle = true);
+  SGDType(DecomposableFunctionType& function,
+          const double stepSize = 0.01,
+          const size_t maxIterations = 100000,
+          const double tolerance = 1e-5,
+          const bool shuffle = true,
+          const size_t objectiveSamples = 0,
+          const bool trackObjective = true,
+          const UpdatePolicyType& updatePolicy = UpdatePolicyType());
 
   /**
    * Optimize the given function using stochastic gradient descent.  The given
@@ -123,10 +176,85 @@ class SGD
   //! Modify whether or not the individual functions are shuffled.
   bool& Shuffle() { return shuffle; }
 
+  //! Get the number of functions used to estimate the objective (0 means the
+  //! objective is summed at each step).
+  size_t ObjectiveSamples() const { return objectiveSamples; }
+  //! Modify the number of functions used to estimate the objective (0 means
+  //! the objective is summed at each step).
+  size_t& ObjectiveSamples() { return objectiveSamples; }
+
+  //! Get whether or not the objective is computed during the optimization.
+  bool TrackObjective() const { return trackObjective; }
+  //! Modify whether or not the objective is computed during the optimization.
+  bool& TrackObjective() { return trackObjective; }
+
+  //! Get the step rule.
+  const UpdatePolicyType& UpdatePolicy() const { return updatePolicy; }
+  //! Modify the step rule.
+  UpdatePolicyType& UpdatePolicy() { return updatePolicy; }
+
   // convert the obkect into a string
   std::string ToString() const;
 
  private:
+  HAS_MEM_FUNC(EvaluateWithGradient, HasEvaluateWithGradient)
+  HAS_MEM_FUNC(Gradient, HasSparseGradient)
+
+  //! Estimate the objective from the given functions, scaled up to the number
+  //! of functions.
+  double SampledObjective(const arma::mat& iterate,
+                          const arma::uvec& sample) const;
+
+  /**
+   * Take a step with the sparse gradient of function i, and return the
+   * objective of function i after the step if evaluate is true (0 otherwise).
+   */
+  template<typename FunctionType>
+  double Step(const FunctionType& function,
+      arma::mat& iterate,
+      const size_t i,
+      arma::mat& gradient,
+      const bool evaluate,
+      typename boost::enable_if_c<HasSparseGradient<FunctionType,
+          void(FunctionType::*)(const arma::mat&, const size_t, arma::uvec&,
+          arma::vec&) const>::value>::type* = 0);
+
+  /**
+   * Take a step with the gradient of function i, and return the objective of
+   * function i if evaluate is true (0 otherwise).  This version uses the fused
+   * EvaluateWithGradient() of the function.
+   */
+  template<typename FunctionType>
+  double Step(const FunctionType& function,
+      arma::mat& iterate,
+      const size_t i,
+      arma::mat& gradient,
+      const bool evaluate,
+      typename boost::enable_if_c<!HasSparseGradient<FunctionType,
+          void(FunctionType::*)(const arma::mat&, const size_t, arma::uvec&,
+          arma::vec&) const>::value && HasEvaluateWithGradient<FunctionType,
+          double(FunctionType::*)(const arma::mat&, const size_t, arma::mat&)
+          const>::value>::type* = 0);
+
+  //! Take a step with the gradient of function i, and return the objective of
+  //! function i after the step if evaluate is true (0 otherwise).
+  template<typename FunctionType>
+  double Step(FunctionType& function,
+      arma::mat& iterate,
+      const size_t i,
+      arma::mat& gradient,
+      const bool evaluate,
+      typename boost::enable_if_c<!HasSparseGradient<FunctionType,
+          void(FunctionType::*)(const arma::mat&, const size_t, arma::uvec&,
+          arma::vec&) const>::value && !HasEvaluateWithGradient<FunctionType,
+          double(FunctionType::*)(const arma::mat&, const size_t, arma::mat&)
+          const>::value>::type* = 0);
+
+  //! Sparse gradient of the current function, for the sparse version of
+  //! Step().
+  arma::uvec indices;
+  arma::vec values;
+
   //! The instantiated function.
   DecomposableFunctionType& function;
 
@@ -142,8 +270,39 @@ class SGD
   //! Controls whether or not the individual functions are shuffled when
   //! iterating.
   bool shuffle;
+
+  //! The number of functions used to estimate the objective at the end of each
+  //! epoch (0 means the objective is summed at each step).
+  size_t objectiveSamples;
+
+  //! Controls whether or not the objective is computed during the
+  //! optimization.
+  bool trackObjective;
+
+  //! The step rule.
+  UpdatePolicyType updatePolicy;
 };
 
+//! SGD with the plain update (a constant step size).
+template<typename DecomposableFunctionType>
+using SGD = SGDType<DecomposableFunctionType, VanillaUpdate>;
+
+//! SGD with momentum (or Nesterov momentum).
+template<typename DecomposableFunctionType>
+using MomentumSGD = SGDType<DecomposableFunctionType, MomentumUpdate>;
+
+//! SGD with AdaGrad step sizes.
+template<typename DecomposableFunctionType>
+using AdaGradSGD = SGDType<DecomposableFunctionType, AdaGradUpdate>;
+
+//! SGD with RMSProp step sizes.
+template<typename DecomposableFunctionType>
+using RMSPropSGD = SGDType<DecomposableFunctionType, RMSPropUpdate>;
+
+//! SGD with Adam steps.
+template<typename DecomposableFunctionType>
+using AdamSGD = SGDType<DecomposableFunctionType, AdamUpdate>;
+
 }; // namespace optimization
 }; // namespace mlpack
 
@@ -14,22 +14,30 @@
 namespace mlpack {
 namespace optimization {
 
-template<typename DecomposableFunctionType>
-SGD<DecomposableFunctionType>::SGD(DecomposableFunctionType& function,
-                                   const double stepSize,
-                                   const size_t maxIterations,
-                                   const double tolerance,
-                                   const bool shuffle) :
+template<typename DecomposableFunctionType, typename UpdatePolicyType>
+SGDType<DecomposableFunctionType, UpdatePolicyType>::SGDType(
+    DecomposableFunctionType& function,
+    const double stepSize,
+    const size_t maxIterations,
+    const double tolerance,
+    const bool shuffle,
+    const size_t objectiveSamples,
+    const bool trackObjective,
+    const UpdatePolicyType& updatePolicy) :
     function(function),
     stepSize(stepSize),
     maxIterations(maxIterations),
     tolerance(tolerance),
-    shuffle(shuffle)
+    shuffle(shuffle),
+    objectiveSamples(objectiveSamples),
+    trackObjective(trackObjective),
+    updatePolicy(updatePolicy)
 { /* Nothing to do. */ }
 
 //! Optimize the function (minimize).
-template<typename DecomposableFunctionType>
-double SGD<DecomposableFunctionType>::Optimize(arma::mat& iterate)
+template<typename DecomposableFunctionType, typename UpdatePolicyType>
+double SGDType<DecomposableFunctionType, UpdatePolicyType>::Optimize(
+    arma::mat& iterate)
 {
   // Find the number of functions to use.
   const size_t numFunctions = function.NumFunctions();
@@ -40,38 +48,61 @@ double SGD<DecomposableFunctionType>::Optimize(arma::mat& iterate)
     visitationOrder = arma::shuffle(arma::linspace(0, (numFunctions - 1),
         numFunctions));
 
+  // If the objective is estimated at the end of each epoch, choose the
+  // functions used for that once.
+  const bool sampleObjective = trackObjective && (objectiveSamples > 0);
+  arma::uvec objectiveSample;
+  if (sampleObjective)
+  {
+    const size_t numSamples = std::min(objectiveSamples, numFunctions);
+    const arma::uvec order = arma::shuffle(arma::linspace<arma::uvec>(0,
+        numFunctions - 1, numFunctions));
+    objectiveSample = order.subvec(0, numSamples - 1);
+  }
+
   // To keep track of where we are and how things are going.
   size_t currentFunction = 0;
   double overallObjective = 0;
   double lastObjective = DBL_MAX;
 
   // Calculate the first objective function.
-  for (size_t i = 0; i < numFunctions; ++i)
-    overallObjective += function.Evaluate(iterate, i);
+  if (sampleObjective)
+    overallObjective = SampledObjective(iterate, objectiveSample);
+  else if (trackObjective)
+    for (size_t i = 0; i < numFunctions; ++i)
+      overallObjective += function.Evaluate(iterate, i);
 
   // Now iterate!
+  updatePolicy.Initialize(iterate.n_rows, iterate.n_cols);
   arma::mat gradient(iterate.n_rows, iterate.n_cols);
   for (size_t i = 1; i != maxIterations; ++i, ++currentFunction)
   {
     // Is this iteration the start of a sequence?
     if ((currentFunction % numFunctions) == 0)
     {
-      // Output current objective function.
-      Log::Info << "SGD: iteration " << i << ", objective " << overallObjective
-          << "." << std::endl;
+      if (sampleObjective && i > 1)
+        overallObjective = SampledObjective(iterate, objectiveSample);
 
-      if (overallObjective != overallObjective)
+      if (trackObjective)
       {
-        Log::Warn << "SGD: converged to " << overallObjective << "; terminating"
-            << " with failure.  Try a smaller step size?" << std::endl;
-        return overallObjective;
-      }
-
-      if (std::abs(lastObjective - overallObjective) < tolerance)
-      {
-        Log::Info << "SGD: minimized within tolerance " << tolerance << "; "
-            << "terminating optimization." << std::endl;
-        return overallObjective;
+        // Output current objective function.
+        Log::Info << "SGD: iteration " << i << ", objective "
+            << overallObjective << "." << std::endl;
+
+        if (overallObjective != overallObjective)
+        {
+          Log::Warn << "SGD: converged to " << overallObjective << "; "
+              << "terminating with failure.  Try a smaller step size?"
+              << std::endl;
+          return overallObjective;
+        }
+
+        if (std::abs(lastObjective - overallObjective) < tolerance)
+        {
+          Log::Info << "SGD: minimized within tolerance " << tolerance << "; "
+              << "terminating optimization." << std::endl;
+          return overallObjective;
+        }
       }
 
       // Reset the counter variables.
@@ -83,21 +114,12 @@ double SGD<DecomposableFunctionType>::Optimize(arma::mat& iterate)
         visitationOrder = arma::shuffle(visitationOrder);
     }
 
-    // Evaluate the gradient for this iteration.
-    if (shuffle)
-      function.Gradient(iterate, visitationOrder[currentFunction], gradient);
-    else
-      function.Gradient(iterate, currentFunction, gradient);
-
-    // And update the iterate.
-    iterate -= stepSize * gradient;
-
-    // Now add that to the overall objective function.
-    if (shuffle)
-      overallObjective += function.Evaluate(iterate,
-          visitationOrder[currentFunction]);
-    else
-      overallObjective += function.Evaluate(iterate, currentFunction);
+    // Take the step for this iteration, and add the objective of the visited
+    // function to the overall objective function, if it is summed at each step.
+    const size_t visited = shuffle ? (size_t) visitationOrder[currentFunction]
+        : currentFunction;
+    overallObjective += Step(function, iterate, visited, gradient,
+        trackObjective && !sampleObjective);
   }
 
   Log::Info << "SGD: maximum iterations (" << maxIterations << ") reached; "
@@ -109,9 +131,83 @@ double SGD<DecomposableFunctionType>::Optimize(arma::mat& iterate)
   return overallObjective;
 }
 
+template<typename DecomposableFunctionType, typename UpdatePolicyType>
+double SGDType<DecomposableFunctionType, UpdatePolicyType>::SampledObjective(
+    const arma::mat& iterate,
+    const arma::uvec& sample) const
+{
+  double objective = 0;
+  for (size_t i = 0; i < sample.n_elem; ++i)
+    objective += function.Evaluate(iterate, sample[i]);
+
+  // Scale the objective of the sample up to the number of functions.
+  return objective * ((double) function.NumFunctions() / sample.n_elem);
+}
+
+template<typename DecomposableFunctionType, typename UpdatePolicyType>
+template<typename FunctionType>
+double SGDType<DecomposableFunctionType, UpdatePolicyType>::Step(
+    const FunctionType& function,
+    arma::mat& iterate,
+    const size_t i,
+    arma::mat& /* gradient */,
+    const bool evaluate,
+    typename boost::enable_if_c<HasSparseGradient<FunctionType,
+        void(FunctionType::*)(const arma::mat&, const size_t, arma::uvec&,
+        arma::vec&) const>::value>::type*)
+{
+  function.Gradient(iterate, i, indices, values);
+  updatePolicy.Update(iterate, stepSize, indices, values);
+  return evaluate ? function.Evaluate(iterate, i) : 0;
+}
+
+template<typename DecomposableFunctionType, typename UpdatePolicyType>
+template<typename FunctionType>
+double SGDType<DecomposableFunctionType, UpdatePolicyType>::Step(
+    const FunctionType& function,
+    arma::mat& iterate,
+    const size_t i,
+    arma::mat& gradient,
+    const bool evaluate,
+    typename boost::enable_if_c<!HasSparseGradient<FunctionType,
+        void(FunctionType::*)(const arma::mat&, const size_t, arma::uvec&,
+        arma::vec&) const>::value && HasEvaluateWithGradient<FunctionType,
+        double(FunctionType::*)(const arma::mat&, const size_t, arma::mat&)
+        const>::value>::type*)
+{
+  double objective = 0;
+  if (evaluate)
+    objective = function.EvaluateWithGradient(iterate, i, gradient);
+  else
+    function.Gradient(iterate, i, gradient);
+
+  updatePolicy.Update(iterate, stepSize, gradient);
+  return objective;
+}
+
+template<typename DecomposableFunctionType, typename UpdatePolicyType>
+template<typename FunctionType>
+double SGDType<DecomposableFunctionType, UpdatePolicyType>::Step(
+    FunctionType& function,
+    arma::mat& iterate,
+    const size_t i,
+    arma::mat& gradient,
+    const bool evaluate,
+    typename boost::enable_if_c<!HasSparseGradient<FunctionType,
+        void(FunctionType::*)(const arma::mat&, const size_t, arma::uvec&,
+        arma::vec&) const>::value && !HasEvaluateWithGradient<FunctionType,
+        double(FunctionType::*)(const arma::mat&, const size_t, arma::mat&)
+        const>::value>::type*)
+{
+  function.Gradient(iterate, i, gradient);
+  updatePolicy.Update(iterate, stepSize, gradient);
+  return evaluate ? function.Evaluate(iterate, i) : 0;
+}
+
 // Convert the object to a string.
-template<typename DecomposableFunctionType>
-std::string SGD<DecomposableFunctionType>::ToString() const
+template<typename DecomposableFunctionType, typename UpdatePolicyType>
+std::string SGDType<DecomposableFunctionType, UpdatePolicyType>::ToString()
+    const
 {
   std::ostringstream convert;
   convert << "SGD [" << this << "]" << std::endl;
@@ -121,6 +217,9 @@ std::string SGD<DecomposableFunctionType>::ToString() const
   convert << "  Maximum iterations: " << maxIterations << std::endl;
   convert << "  Tolerance: " << tolerance << std::endl;
   convert << "  Shuffle points: " << (shuffle ? "true" : "false") << std::endl;
+  convert << "  Objective samples: " << objectiveSamples << std::endl;
+  convert << "  Track objective: " << (trackObjective ? "true" : "false")
+      << std::endl;
   return convert.str();
 }
 
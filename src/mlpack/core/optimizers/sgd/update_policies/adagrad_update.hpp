@@ -0,0 +1,86 @@
+/**
+ * @file adagrad_update.hpp
+ *
+ * AdaGrad update policy for SGD.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_SGD_UPDATE_POLICIES_ADAGRAD_UPDATE_HPP
+#define __MLPACK_CORE_OPTIMIZERS_SGD_UPDATE_POLICIES_ADAGRAD_UPDATE_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * AdaGrad, described in the paper 'Adaptive Subgradient Methods for Online
+ * Learning and Stochastic Optimization' by J. Duchi, E. Hazan and Y. Singer.
+ * Each coordinate has its own step size, scaled by the inverse of the root of
+ * the sum of its squared gradients \f$ G \f$:
+ *
+ * \f[
+ * G_{j + 1} = G_j + (\nabla f_i(A_j))^2, \qquad
+ * A_{j + 1} = A_j - \frac{\alpha}{\sqrt{G_{j + 1}} + \epsilon}
+ *     \nabla f_i(A_j).
+ * \f]
+ *
+ * For a sparse gradient, only the touched coordinates are updated, which is
+ * exact for AdaGrad.
+ *
+ * @see VanillaUpdate
+ */
+class AdaGradUpdate
+{
+ public:
+  /**
+   * Create the AdaGrad update policy.
+   *
+   * @param epsilon Value added to the denominator, for numerical stability.
+   */
+  AdaGradUpdate(const double epsilon = 1e-8) : epsilon(epsilon) { }
+
+  //! Reset the sums of squared gradients before an optimization.
+  void Initialize(const size_t rows, const size_t cols)
+  {
+    squaredGradients.zeros(rows, cols);
+  }
+
+  //! Take a step with the given gradient.
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::mat& gradient)
+  {
+    squaredGradients += arma::square(gradient);
+    iterate -= stepSize * gradient / (arma::sqrt(squaredGradients) + epsilon);
+  }
+
+  //! Take a step with the given sparse gradient.
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::uvec& indices,
+              const arma::vec& values)
+  {
+    for (size_t k = 0; k < indices.n_elem; ++k)
+    {
+      const size_t index = indices[k];
+      squaredGradients[index] += values[k] * values[k];
+      iterate[index] -= stepSize * values[k] /
+          (std::sqrt(squaredGradients[index]) + epsilon);
+    }
+  }
+
+  //! Get the value added to the denominator.
+  double Epsilon() const { return epsilon; }
+  //! Modify the value added to the denominator.
+  double& Epsilon() { return epsilon; }
+
+ private:
+  //! The value added to the denominator.
+  double epsilon;
+  //! The sums of the squared gradients.
+  arma::mat squaredGradients;
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
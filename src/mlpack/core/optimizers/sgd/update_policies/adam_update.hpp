@@ -0,0 +1,133 @@
+/**
+ * @file adam_update.hpp
+ *
+ * Adam update policy for SGD.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_SGD_UPDATE_POLICIES_ADAM_UPDATE_HPP
+#define __MLPACK_CORE_OPTIMIZERS_SGD_UPDATE_POLICIES_ADAM_UPDATE_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * Adam, described in the paper 'Adam: A Method for Stochastic Optimization' by
+ * D. P. Kingma and J. Ba.  It keeps moving averages of the gradients \f$ m \f$
+ * and of the squared gradients \f$ v \f$, and corrects them for their bias
+ * towards zero at the beginning of the optimization:
+ *
+ * \f[
+ * m_{t} = \beta_1 m_{t - 1} + (1 - \beta_1) \nabla f_i(A), \qquad
+ * v_{t} = \beta_2 v_{t - 1} + (1 - \beta_2) (\nabla f_i(A))^2,
+ * \f]
+ * \f[
+ * A \leftarrow A - \alpha \frac{m_t / (1 - \beta_1^t)}
+ *     {\sqrt{v_t / (1 - \beta_2^t)} + \epsilon}.
+ * \f]
+ *
+ * For a sparse gradient, only the moving averages of the touched coordinates
+ * are updated (a lazy update); the bias correction uses the number of steps
+ * taken.
+ *
+ * @see RMSPropUpdate
+ */
+class AdamUpdate
+{
+ public:
+  /**
+   * Create the Adam update policy.
+   *
+   * @param beta1 Decay of the moving average of the gradients.
+   * @param beta2 Decay of the moving average of the squared gradients.
+   * @param epsilon Value added to the denominator, for numerical stability.
+   */
+  AdamUpdate(const double beta1 = 0.9,
+             const double beta2 = 0.999,
+             const double epsilon = 1e-8) :
+      beta1(beta1), beta2(beta2), epsilon(epsilon)
+  { }
+
+  //! Reset the moving averages before an optimization.
+  void Initialize(const size_t rows, const size_t cols)
+  {
+    mean.zeros(rows, cols);
+    meanSquared.zeros(rows, cols);
+    steps = 0;
+  }
+
+  //! Take a step with the given gradient.
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::mat& gradient)
+  {
+    ++steps;
+    mean = beta1 * mean + (1 - beta1) * gradient;
+    meanSquared = beta2 * meanSquared + (1 - beta2) * arma::square(gradient);
+
+    iterate -= CorrectedStepSize(stepSize) * mean / (arma::sqrt(meanSquared /
+        (1 - std::pow(beta2, (double) steps))) + epsilon);
+  }
+
+  //! Take a step with the given sparse gradient.
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::uvec& indices,
+              const arma::vec& values)
+  {
+    ++steps;
+    const double correctedStepSize = CorrectedStepSize(stepSize);
+    const double secondCorrection = 1 - std::pow(beta2, (double) steps);
+    for (size_t k = 0; k < indices.n_elem; ++k)
+    {
+      const size_t index = indices[k];
+      mean[index] = beta1 * mean[index] + (1 - beta1) * values[k];
+      meanSquared[index] = beta2 * meanSquared[index] +
+          (1 - beta2) * values[k] * values[k];
+      iterate[index] -= correctedStepSize * mean[index] /
+          (std::sqrt(meanSquared[index] / secondCorrection) + epsilon);
+    }
+  }
+
+  //! Get the decay of the moving average of the gradients.
+  double Beta1() const { return beta1; }
+  //! Modify the decay of the moving average of the gradients.
+  double& Beta1() { return beta1; }
+
+  //! Get the decay of the moving average of the squared gradients.
+  double Beta2() const { return beta2; }
+  //! Modify the decay of the moving average of the squared gradients.
+  double& Beta2() { return beta2; }
+
+  //! Get the value added to the denominator.
+  double Epsilon() const { return epsilon; }
+  //! Modify the value added to the denominator.
+  double& Epsilon() { return epsilon; }
+
+ private:
+  //! The step size corrected for the bias of the moving average of the
+  //! gradients.
+  double CorrectedStepSize(const double stepSize) const
+  {
+    return stepSize / (1 - std::pow(beta1, (double) steps));
+  }
+
+  //! The decay of the moving average of the gradients.
+  double beta1;
+  //! The decay of the moving average of the squared gradients.
+  double beta2;
+  //! The value added to the denominator.
+  double epsilon;
+
+  //! The moving average of the gradients.
+  arma::mat mean;
+  //! The moving average of the squared gradients.
+  arma::mat meanSquared;
+  //! The number of steps taken.
+  size_t steps;
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
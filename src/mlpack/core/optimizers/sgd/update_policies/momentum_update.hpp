@@ -0,0 +1,105 @@
+/**
+ * @file momentum_update.hpp
+ *
+ * Momentum (and Nesterov momentum) update policy for SGD.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_SGD_UPDATE_POLICIES_MOMENTUM_UPDATE_HPP
+#define __MLPACK_CORE_OPTIMIZERS_SGD_UPDATE_POLICIES_MOMENTUM_UPDATE_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * The momentum update keeps a velocity \f$ v \f$, a decaying sum of the past
+ * steps:
+ *
+ * \f[
+ * v_{j + 1} = \mu v_j - \alpha \nabla f_i(A_j), \qquad
+ * A_{j + 1} = A_j + v_{j + 1}.
+ * \f]
+ *
+ * With Nesterov momentum, the step looks ahead along the velocity instead:
+ * \f$ A_{j + 1} = A_j + \mu v_{j + 1} - \alpha \nabla f_i(A_j) \f$ (this is the
+ * usual reformulation of Nesterov's accelerated gradient, which only needs the
+ * gradient at the iterate).
+ *
+ * For a sparse gradient, only the velocity of the touched coordinates is
+ * updated (a lazy update); the velocity of the other coordinates does not
+ * decay until they are touched.
+ *
+ * @see VanillaUpdate
+ */
+class MomentumUpdate
+{
+ public:
+  /**
+   * Create the momentum update policy.
+   *
+   * @param momentum Decay of the velocity (mu).
+   * @param nesterov If true, Nesterov momentum is used.
+   */
+  MomentumUpdate(const double momentum = 0.9, const bool nesterov = false) :
+      momentum(momentum), nesterov(nesterov)
+  { }
+
+  //! Reset the velocity before an optimization.
+  void Initialize(const size_t rows, const size_t cols)
+  {
+    velocity.zeros(rows, cols);
+  }
+
+  //! Take a step with the given gradient.
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::mat& gradient)
+  {
+    velocity = momentum * velocity - stepSize * gradient;
+    if (nesterov)
+      iterate += momentum * velocity - stepSize * gradient;
+    else
+      iterate += velocity;
+  }
+
+  //! Take a step with the given sparse gradient, only updating the velocity of
+  //! the touched coordinates.
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::uvec& indices,
+              const arma::vec& values)
+  {
+    for (size_t k = 0; k < indices.n_elem; ++k)
+    {
+      const size_t index = indices[k];
+      velocity[index] = momentum * velocity[index] - stepSize * values[k];
+      if (nesterov)
+        iterate[index] += momentum * velocity[index] - stepSize * values[k];
+      else
+        iterate[index] += velocity[index];
+    }
+  }
+
+  //! Get the momentum.
+  double Momentum() const { return momentum; }
+  //! Modify the momentum.
+  double& Momentum() { return momentum; }
+
+  //! Get whether Nesterov momentum is used.
+  bool Nesterov() const { return nesterov; }
+  //! Modify whether Nesterov momentum is used.
+  bool& Nesterov() { return nesterov; }
+
+ private:
+  //! The decay of the velocity.
+  double momentum;
+  //! Whether Nesterov momentum is used.
+  bool nesterov;
+  //! The velocity.
+  arma::mat velocity;
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
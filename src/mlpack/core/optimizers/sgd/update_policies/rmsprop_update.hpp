@@ -0,0 +1,98 @@
+/**
+ * @file rmsprop_update.hpp
+ *
+ * RMSProp update policy for SGD.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_SGD_UPDATE_POLICIES_RMSPROP_UPDATE_HPP
+#define __MLPACK_CORE_OPTIMIZERS_SGD_UPDATE_POLICIES_RMSPROP_UPDATE_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * RMSProp, as proposed by G. Hinton in his 'Neural Networks for Machine
+ * Learning' lectures.  It is like AdaGrad, but the sum of the squared gradients
+ * is replaced by a moving average \f$ E \f$ with decay \f$ \rho \f$:
+ *
+ * \f[
+ * E_{j + 1} = \rho E_j + (1 - \rho) (\nabla f_i(A_j))^2, \qquad
+ * A_{j + 1} = A_j - \frac{\alpha}{\sqrt{E_{j + 1}} + \epsilon}
+ *     \nabla f_i(A_j).
+ * \f]
+ *
+ * For a sparse gradient, only the moving averages of the touched coordinates
+ * are updated (a lazy update).
+ *
+ * @see AdaGradUpdate
+ */
+class RMSPropUpdate
+{
+ public:
+  /**
+   * Create the RMSProp update policy.
+   *
+   * @param decay Decay of the moving average of the squared gradients (rho).
+   * @param epsilon Value added to the denominator, for numerical stability.
+   */
+  RMSPropUpdate(const double decay = 0.99, const double epsilon = 1e-8) :
+      decay(decay), epsilon(epsilon)
+  { }
+
+  //! Reset the moving averages before an optimization.
+  void Initialize(const size_t rows, const size_t cols)
+  {
+    meanSquaredGradients.zeros(rows, cols);
+  }
+
+  //! Take a step with the given gradient.
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::mat& gradient)
+  {
+    meanSquaredGradients = decay * meanSquaredGradients +
+        (1 - decay) * arma::square(gradient);
+    iterate -= stepSize * gradient / (arma::sqrt(meanSquaredGradients) +
+        epsilon);
+  }
+
+  //! Take a step with the given sparse gradient.
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::uvec& indices,
+              const arma::vec& values)
+  {
+    for (size_t k = 0; k < indices.n_elem; ++k)
+    {
+      const size_t index = indices[k];
+      meanSquaredGradients[index] = decay * meanSquaredGradients[index] +
+          (1 - decay) * values[k] * values[k];
+      iterate[index] -= stepSize * values[k] /
+          (std::sqrt(meanSquaredGradients[index]) + epsilon);
+    }
+  }
+
+  //! Get the decay of the moving average.
+  double Decay() const { return decay; }
+  //! Modify the decay of the moving average.
+  double& Decay() { return decay; }
+
+  //! Get the value added to the denominator.
+  double Epsilon() const { return epsilon; }
+  //! Modify the value added to the denominator.
+  double& Epsilon() { return epsilon; }
+
+ private:
+  //! The decay of the moving average.
+  double decay;
+  //! The value added to the denominator.
+  double epsilon;
+  //! The moving averages of the squared gradients.
+  arma::mat meanSquaredGradients;
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file vanilla_update.hpp
+ *
+ * The plain update policy for SGD: a step against the gradient with a constant
+ * step size.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_SGD_UPDATE_POLICIES_VANILLA_UPDATE_HPP
+#define __MLPACK_CORE_OPTIMIZERS_SGD_UPDATE_POLICIES_VANILLA_UPDATE_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * The plain SGD update: each step is
+ *
+ * \f[
+ * A_{j + 1} = A_j - \alpha \nabla f_i(A_j).
+ * \f]
+ *
+ * An update policy for SGDType must implement Initialize(), which is called
+ * once before the optimization with the size of the iterate, and two versions
+ * of Update(): one with a dense gradient, and one with a sparse gradient given
+ * by the linear indices of its nonzero elements and their values.  The sparse
+ * version must only modify the iterate at the given indices.
+ */
+class VanillaUpdate
+{
+ public:
+  /**
+   * Initialize the policy before an optimization.
+   *
+   * @param rows Number of rows of the iterate.
+   * @param cols Number of columns of the iterate.
+   */
+  void Initialize(const size_t /* rows */, const size_t /* cols */) { }
+
+  /**
+   * Take a step with the given gradient.
+   *
+   * @param iterate Iterate to be updated.
+   * @param stepSize Step size.
+   * @param gradient Gradient at the iterate.
+   */
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::mat& gradient)
+  {
+    iterate -= stepSize * gradient;
+  }
+
+  /**
+   * Take a step with the given sparse gradient.
+   *
+   * @param iterate Iterate to be updated.
+   * @param stepSize Step size.
+   * @param indices Linear indices of the nonzero elements of the gradient.
+   * @param values Values of the nonzero elements of the gradient.
+   */
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::uvec& indices,
+              const arma::vec& values)
+  {
+    for (size_t k = 0; k < indices.n_elem; ++k)
+      iterate[indices[k]] -= stepSize * values[k];
+  }
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
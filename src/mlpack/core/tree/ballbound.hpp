@@ -19,6 +19,11 @@ namespace bound {
  * specific point (center). TMetricType is the custom metric type that defaults
  * to the Euclidean (L2) distance.
  *
+ * The distances are computed by the metric directly on the center and on the
+ * given points (or columns of a dataset), without copying them, so for the
+ * Euclidean distance between dense points the vectorized kernel of LMetric is
+ * used.
+ *
  * @tparam VecType Type of vector (arma::vec or arma::sp_vec).
  * @tparam TMetricType metric type used in the distance measure.
  */
@@ -155,7 +160,8 @@ class BallBound
   math::Range RangeDistance(const BallBound& other) const;
 
   /**
-   * Expand the bound to include the given node.
+   * Expand the bound to include the given ball.  The result is the smallest
+   * ball that contains both balls.
    */
   const BallBound& operator|=(const BallBound& other);
 
@@ -180,6 +186,22 @@ class BallBound
    */
   TMetricType Metric() const { return *metric; }
 
+  /**
+   * Write the bound to the given stream in a binary format, so that it can be
+   * read back with Load().
+   *
+   * @param stream Stream to write the bound to.
+   */
+  void Save(std::ostream& stream) const;
+
+  /**
+   * Read a bound written with Save() from the given stream.  The bound must
+   * already have the same dimensionality as the saved bound.
+   *
+   * @param stream Stream to read the bound from.
+   */
+  void Load(std::istream& stream);
+
   /**
    * Returns a string representation of this object.
    */
@@ -67,10 +67,15 @@ template<typename VecType, typename TMetricType>
 BallBound<VecType, TMetricType>& BallBound<VecType, TMetricType>::operator=(
     const BallBound& other)
 {
+  if (ownsMetric && metric != other.metric)
+    delete metric;
+
   radius = other.radius;
   center = other.center;
   metric = other.metric;
   ownsMetric = false;
+
+  return *this;
 }
 
 //! Destructor to release allocated memory.
@@ -199,21 +204,38 @@ math::Range BallBound<VecType, TMetricType>::RangeDistance(
 }
 
 /**
- * Expand the bound to include the given bound.
- *
+ * Expand the bound to include the given bound.  The result is the smallest ball
+ * that contains both balls.
+ */
 template<typename VecType, typename TMetricType>
-const BallBound<VecType>&
-BallBound<VecType, TMetricType>::operator|=(
-    const BallBound<VecType>& other)
+const BallBound<VecType, TMetricType>&
+BallBound<VecType, TMetricType>::operator|=(const BallBound& other)
 {
-  double dist = metric->Evaluate(center, other);
+  if (other.radius < 0)
+    return *this;
+
+  const double dist = (radius < 0) ? 0.0 :
+      metric->Evaluate(center, other.center);
 
-  // Now expand the radius as necessary.
-  if (dist > radius)
-    radius = dist;
+  if (radius >= 0 && dist + other.radius <= radius)
+    return *this; // The other ball is inside of this one.
+
+  if (radius < 0 || dist + radius <= other.radius)
+  {
+    // This ball is inside of the other one (or empty).
+    center = other.center;
+    radius = other.radius;
+    return *this;
+  }
+
+  // The diameter of the new ball goes from the far side of this ball to the
+  // far side of the other ball, through both centers.
+  const double newRadius = 0.5 * (dist + radius + other.radius);
+  center += ((newRadius - radius) / dist) * (other.center - center);
+  radius = newRadius;
 
   return *this;
-}*/
+}
 
 /**
  * Expand the bound to include the given point. Algorithm adapted from
@@ -235,15 +257,16 @@ BallBound<VecType, TMetricType>::operator|=(const MatType& data)
   // Now iteratively add points.
   for (size_t i = 0; i < data.n_cols; ++i)
   {
-    const double dist = metric->Evaluate(center, (VecType) data.col(i));
+    // The column is passed to the metric as it is, without copying it, so for
+    // dense data the vectorized distance kernel is used.
+    const double dist = metric->Evaluate(center, data.col(i));
 
     // See if the new point lies outside the bound.
     if (dist > radius)
     {
       // Move towards the new point and increase the radius just enough to
       // accomodate the new point.
-      arma::vec diff = data.col(i) - center;
-      center += ((dist - radius) / (2 * dist)) * diff;
+      center += ((dist - radius) / (2 * dist)) * (data.col(i) - center);
       radius = 0.5 * (dist + radius);
     }
   }
@@ -251,6 +274,35 @@ BallBound<VecType, TMetricType>::operator|=(const MatType& data)
   return *this;
 }
 
+/**
+ * Write the bound to the given stream.
+ */
+template<typename VecType, typename TMetricType>
+void BallBound<VecType, TMetricType>::Save(std::ostream& stream) const
+{
+  stream.write((const char*) &radius, sizeof(double));
+  for (size_t i = 0; i < center.n_elem; ++i)
+  {
+    const double value = center[i];
+    stream.write((const char*) &value, sizeof(double));
+  }
+}
+
+/**
+ * Read the bound from the given stream.
+ */
+template<typename VecType, typename TMetricType>
+void BallBound<VecType, TMetricType>::Load(std::istream& stream)
+{
+  stream.read((char*) &radius, sizeof(double));
+  for (size_t i = 0; i < center.n_elem; ++i)
+  {
+    double value;
+    stream.read((char*) &value, sizeof(double));
+    center[i] = value;
+  }
+}
+
 /**
  * Returns a string representation of this object.
  */
@@ -7,9 +7,12 @@
 #define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_BINARY_SPACE_TREE_HPP
 
 #include <mlpack/core.hpp>
+#include <atomic>
+#include <map>
 #include "mean_split.hpp"
 
 #include "../statistic.hpp"
+#include "../node_arena.hpp"
 
 namespace mlpack {
 namespace tree /** Trees and tree-building procedures. */ {
@@ -20,13 +23,46 @@ namespace tree /** Trees and tree-building procedures. */ {
  * the constructor with the dataset to build the tree on, and the entire tree
  * will be built.
  *
- * This particular tree does not allow growth, so you cannot add or delete nodes
- * from it.  If you need to add or delete a node, the better procedure is to
- * rebuild the tree entirely.
+ * Points can be added to the tree with Insert(), which routes them to leaves,
+ * expands the bounds on the way and splits the leaves which grow too large.
+ * Points are never moved between the nodes which exist already, so after many
+ * insertions the tree may be much less balanced than a tree built on all of the
+ * points at once; Imbalance() measures this, so that the tree can be rebuilt
+ * when it gets too large.  Points cannot be deleted from the tree; if you need
+ * to delete points, the better procedure is to rebuild the tree entirely.
  *
  * This tree does take one runtime parameter in the constructor, which is the
  * max leaf size to be used.
  *
+ * The nodes of a tree (with the ranges of their bounds, for HRectBound) are
+ * allocated from a NodeArena owned by the root, a few large chunks at a time,
+ * and freed all at once when the root is deleted.  So only the root of a tree
+ * may be deleted; children assigned by hand with Left() and Right() are still
+ * deleted with their parent.
+ *
+ * The tree can also be built lazily (see the constructor which takes the lazy
+ * parameter): then each node only gets its bound and statistic when it is
+ * created, and is split the first time a traverser reaches it, so queries
+ * which only reach a small part of a large tree only pay for building that
+ * part.  Until it is split, a node is a leaf holding all of its points.
+ * Splitting a node rearranges its points (and the mapping given to the
+ * constructor), and splitting its descendants rearranges them again, so an
+ * index of a point is only final once every node above it is split.
+ * Point() and Descendant() therefore split all of the descendants of the node
+ * they are called on first (waiting for any split in progress in another
+ * thread), so the indices they return stay valid, even when a rule takes all
+ * of the descendants of a node which the traverser has not reached (as
+ * RangeSearchRules::Score() does for a node entirely in range).
+ *
+ * In a parallel traversal of a tree built lazily, the bound, the statistic,
+ * NumDescendants() and the parent distance of a node may be read at any time,
+ * and so may the points at the indices given by Point() and Descendant().  The
+ * children and the points of a node (IsLeaf(), NumChildren(), Left(),
+ * Right(), Child(), NumPoints()) may only be read after Expand() is called on
+ * it, as the traversers do.  Because Point() and Descendant() may split nodes,
+ * the constructors of statistics used with a lazily built tree must only call
+ * them on leaves.
+ *
  * @tparam BoundType The bound used for each node.  The valid types of bounds
  *     and the necessary skeleton interface for this class can be found in
  *     bounds/.
@@ -73,6 +109,28 @@ class BinarySpaceTree
   double minimumBoundDistance;
   //! The dataset.
   MatType& dataset;
+  //! If Compact() was called on this node, the block holding all of its
+  //! descendants (otherwise NULL).
+  BinarySpaceTree* nodeBlock;
+  //! The number of nodes in nodeBlock.
+  size_t nodeBlockSize;
+  //! If Compact() was called on this node, the ranges of the bounds of this
+  //! node and all of its descendants (if the bound type stores ranges).
+  std::vector<math::Range> boundBlock;
+  //! The arena the descendants of the root are allocated from (shared by all
+  //! of the nodes, and owned by the root), or NULL.
+  NodeArena* arena;
+  //! If the tree is built lazily, the mapping of the new point indices to the
+  //! old point indices given to the constructor, which is updated when nodes
+  //! are split (otherwise NULL).
+  std::vector<size_t>* lazyOldFromNew;
+  //! Whether this node is still to be split (only in a tree built lazily).
+  //! It is read without a lock, so it is atomic; it is cleared (with release
+  //! semantics) only once the children are complete.
+  std::atomic<bool> pendingSplit;
+  //! Whether this node and all of its descendants are split (only used in a
+  //! tree built lazily).
+  std::atomic<bool> subtreeSplit;
 
  public:
   //! So other classes can use TreeType::Mat.
@@ -104,14 +162,24 @@ class BinarySpaceTree
    * dataset.  This will modify the ordering of points in the dataset!  A
    * mapping of the old point indices to the new point indices is filled.
    *
+   * If lazy is true, only the root is built, and each node is split the first
+   * time a traverser reaches it (or when Expand() is called).  Then the dataset
+   * and oldFromNew are modified as the tree is used, so they must not go out
+   * of scope before the tree; the indices found by a search are valid for
+   * oldFromNew as it is after the search.  A lazily built tree is meant for
+   * reference sets: its points can't be used as the query points of a
+   * single-tree search, because they may move during the search.
+   *
    * @param data Dataset to create tree from.  This will be modified!
    * @param oldFromNew Vector which will be filled with the old positions for
    *     each new point.
    * @param maxLeafSize Size of each leaf in the tree.
+   * @param lazy If true, split the nodes only when they are first reached.
    */
   BinarySpaceTree(MatType& data,
                   std::vector<size_t>& oldFromNew,
-                  const size_t maxLeafSize = 20);
+                  const size_t maxLeafSize = 20,
+                  const bool lazy = false);
 
   /**
    * Construct this as the root node of a binary space tree using the given
@@ -165,13 +233,15 @@ class BinarySpaceTree
    * @param oldFromNew Vector which will be filled with the old positions for
    *     each new point.
    * @param maxLeafSize Size of each leaf in the tree.
+   * @param lazy If true, the node is not split until Expand() is called.
    */
   BinarySpaceTree(MatType& data,
                   const size_t begin,
                   const size_t count,
                   std::vector<size_t>& oldFromNew,
                   BinarySpaceTree* parent = NULL,
-                  const size_t maxLeafSize = 20);
+                  const size_t maxLeafSize = 20,
+                  const bool lazy = false);
 
   /**
    * Construct this node on a subset of the given matrix, starting at column
@@ -202,9 +272,30 @@ class BinarySpaceTree
                   BinarySpaceTree* parent = NULL,
                   const size_t maxLeafSize = 20);
 
+  /**
+   * Load a binary space tree that was saved with Save().  The dataset the tree
+   * was built on (in the order the tree building permuted it to) is read into
+   * the given matrix, and the mapping from the new point indices to the
+   * original point indices is read into oldFromNew.  No splitting is done and
+   * the dataset is not permuted again, so this is much faster than building
+   * the tree.  The statistics of each node are created as they are when the
+   * tree is built, so a tree can be loaded with a different StatisticType than
+   * the one it was saved with.
+   *
+   * @param filename File to load the tree from.
+   * @param data Matrix to load the dataset into.  The tree references this
+   *     matrix, so it must not be changed or go out of scope before the tree.
+   * @param oldFromNew Vector which will be filled with the old positions for
+   *     each new point.
+   */
+  BinarySpaceTree(const std::string& filename,
+                  MatType& data,
+                  std::vector<size_t>& oldFromNew);
+
   /**
    * Create a binary space tree by copying the other tree.  Be careful!  This
-   * can take a long time and use a lot of memory.
+   * can take a long time and use a lot of memory.  If the other tree is built
+   * lazily, only the nodes split so far are copied, and the copy is not lazy.
    *
    * @param other Tree to be replicated.
    */
@@ -217,6 +308,73 @@ class BinarySpaceTree
    */
   ~BinarySpaceTree();
 
+  /**
+   * Move all of the nodes of the tree into one contiguous block of memory, in
+   * depth-first order, so that the nodes visited one after another by a
+   * traversal are usually close together in memory.  For HRectBound, the
+   * ranges of the bounds of all of the nodes are stored in one block too, in
+   * the same order.  The tree is otherwise unchanged, so it can be used in
+   * exactly the same way afterwards.  This must be called on the root of the
+   * tree, and invalidates any pointers or references to any nodes other than
+   * the root.  After this, only the root may be deleted.  A tree built lazily
+   * is split completely first.
+   */
+  void Compact();
+
+  /**
+   * If this node of a tree built lazily is still to be split, split it
+   * (creating its children, which are not split themselves); otherwise, do
+   * nothing.  The traversers call this on each node they reach.  This is
+   * thread-safe: if several threads reach the node at once, one of them splits
+   * it while the others wait.  It must not be called from the constructor of a
+   * statistic, since it may already be called from a split.
+   */
+  void Expand();
+
+  //! Split this node and all of its descendants, if the tree is built lazily.
+  void ExpandAll();
+
+  //! Return whether this node is still to be split (so it is a leaf for now).
+  bool PendingSplit() const
+  { return pendingSplit.load(std::memory_order_acquire); }
+
+  /**
+   * Add the given points to the tree.  This must be called on the root of a
+   * tree which is not built lazily and was not compacted.  Each point is routed
+   * from the root to a leaf, through the child whose bound is closest to it,
+   * and the bound of each node on the way is expanded to hold it.  Then the
+   * dataset is rearranged so that the points of each node are still
+   * contiguous (the new points of a leaf follow its old points), and each leaf
+   * which holds more than the max leaf size is split, just like when the tree
+   * is built.  This changes the indices of the points in the dataset, but
+   * pointers to the nodes of the tree stay valid.
+   *
+   * @param points Points to add to the tree.
+   */
+  void Insert(const MatType& points);
+
+  /**
+   * Add the given points to the tree, updating the mapping of the new point
+   * indices to the old point indices; see the other overload.  Column i of the
+   * given points gets the old index oldFromNew.size() + i.
+   *
+   * @param points Points to add to the tree.
+   * @param oldFromNew Mapping filled when the tree was built (and by earlier
+   *     insertions), which is extended to hold the new points.
+   */
+  void Insert(const MatType& points, std::vector<size_t>& oldFromNew);
+
+  /**
+   * Return the ratio of the depth of the tree under this node to the depth of
+   * a perfectly balanced tree holding as many points with the same max leaf
+   * size.  A tree built on all of its points at once usually has a ratio not
+   * much larger than one; once Insert() has made the ratio large (say, over
+   * two), searches are faster with a tree rebuilt from Dataset().  The new
+   * tree can be built in the background, on a copy of the dataset, while this
+   * one is still searched.
+   */
+  double Imbalance() const;
+
   /**
    * Find a node in this tree by its begin and count (const).
    *
@@ -254,7 +412,8 @@ class BinarySpaceTree
   //! Return the statistic object for this node.
   StatisticType& Stat() { return stat; }
 
-  //! Return whether or not this node is a leaf (true if it has no children).
+  //! Return whether or not this node is a leaf (true if it has no children,
+  //! which is the case for a node still to be split).
   bool IsLeaf() const;
 
   //! Return the max leaf size.
@@ -345,7 +504,8 @@ class BinarySpaceTree
   /**
    * Return the index (with reference to the dataset) of a particular descendant
    * of this node.  The index should be greater than zero but less than the
-   * number of descendants.
+   * number of descendants.  In a tree built lazily, all of the descendants of
+   * this node are split first, so that the index is final.
    *
    * @param index Index of the descendant.
    */
@@ -355,7 +515,8 @@ class BinarySpaceTree
    * Return the index (with reference to the dataset) of a particular point in
    * this node.  This will happily return invalid indices if the given index is
    * greater than the number of points in this node (obtained with NumPoints())
-   * -- be careful.
+   * -- be careful.  In a tree built lazily, all of the descendants of this node
+   * are split first, so that the index is final.
    *
    * @param index Index of point for which a dataset index is wanted.
    */
@@ -440,6 +601,30 @@ class BinarySpaceTree
   //! Returns false: this tree type does not have self children.
   static bool HasSelfChildren() { return false; }
 
+  /**
+   * When mlpack is built with OpenMP, the tree is built in parallel: the
+   * children of each node with more than this many points are built by separate
+   * tasks, and the bounds of such nodes are computed in parallel too (for
+   * HRectBound).  The resulting tree is the same as the one built serially.
+   */
+  static const size_t ParallelBuildThreshold = 10000;
+
+  /**
+   * Save the tree to the given file in a binary format: the dataset (in its
+   * permuted order), the given mapping from new point indices to original
+   * point indices, and the begin, count, split dimension, bound and cached
+   * distances of each node.  The node statistics are not saved.  The tree can
+   * be loaded again with the constructor that takes a filename.  This should be
+   * called on the root of the tree.  Nodes of a lazily built tree which are
+   * still to be split are saved as leaves.
+   *
+   * @param filename File to save the tree to.
+   * @param oldFromNew Mapping from the new point indices to the original point
+   *     indices, as returned by the constructor which built the tree.
+   */
+  void Save(const std::string& filename,
+            const std::vector<size_t>& oldFromNew) const;
+
  private:
   /**
    * Private copy constructor, available only to fill (pad) the tree to a
@@ -456,13 +641,80 @@ class BinarySpaceTree
       count(count),
       bound(bound),
       stat(stat),
-      maxLeafSize(maxLeafSize) { }
+      maxLeafSize(maxLeafSize),
+      nodeBlock(NULL),
+      nodeBlockSize(0),
+      arena(NULL),
+      lazyOldFromNew(NULL),
+      pendingSplit(false),
+      subtreeSplit(false) { }
 
   BinarySpaceTree* CopyMe()
   {
     return new BinarySpaceTree(begin, count, bound, stat, maxLeafSize);
   }
 
+  /**
+   * Private constructor, used to load the children of a node in a saved tree.
+   *
+   * @param stream Stream to read the node from.
+   * @param data Dataset the tree is built on.
+   * @param parent Parent of this node.
+   * @param maxLeafSize Max leaf size of the tree.
+   */
+  BinarySpaceTree(std::istream& stream,
+                  MatType& data,
+                  BinarySpaceTree* parent,
+                  const size_t maxLeafSize);
+
+  /**
+   * Read this node (and, recursively, its children) from the given stream, in
+   * the format written by SaveNode().
+   *
+   * @param stream Stream to read the node from.
+   */
+  void LoadNode(std::istream& stream);
+
+  /**
+   * Write this node (and, recursively, its children) to the given stream.
+   *
+   * @param stream Stream to write the node to.
+   */
+  void SaveNode(std::ostream& stream) const;
+
+  /**
+   * Move the given node to the next free slot in nodeBlock, and then
+   * (recursively) its children after it.  The old node is deleted.
+   *
+   * @param node Node to move.
+   * @param newParent The parent of the moved node.
+   * @param index Index of the next free slot in nodeBlock.
+   * @return The moved node.
+   */
+  BinarySpaceTree* MoveToBlock(BinarySpaceTree* node,
+                               BinarySpaceTree* newParent,
+                               size_t& index);
+
+  /**
+   * Create the arena for the nodes of a tree on the given number of points,
+   * if it will have more than one node.  This is called by the root.
+   *
+   * @param points Number of points in the tree.
+   */
+  void CreateArena(const size_t points);
+
+  //! Get the memory for a new child node: a slot of the arena, if there is
+  //! one.
+  void* AllocateNode();
+
+  /**
+   * Get the memory for the ranges of the bound of the given node, which is
+   * being constructed with the given parent: the end of its slot, if it is
+   * allocated from the arena of the parent, and otherwise NULL.
+   */
+  static math::Range* ArenaRanges(const BinarySpaceTree* parent,
+                                  BinarySpaceTree* node);
+
   /**
    * Splits the current node, assigning its left and right children recursively.
    *
@@ -472,12 +724,70 @@ class BinarySpaceTree
 
   /**
    * Splits the current node, assigning its left and right children recursively.
-   * Also returns a list of the changed indices.
+   * Also returns a list of the changed indices.  If lazy is true, only the
+   * bound of the node is computed, and the node is marked to be split later.
+   *
+   * @param data Dataset which we are using.
+   * @param oldFromNew Vector holding permuted indices.
+   * @param lazy Whether to leave the splitting for later.
+   */
+  void SplitNode(MatType& data,
+                 std::vector<size_t>& oldFromNew,
+                 const bool lazy = false);
+
+  /**
+   * Split the points of the current node (whose bound is already computed)
+   * between two new children, which are built recursively, or only get their
+   * bounds if lazy is true.
    *
    * @param data Dataset which we are using.
    * @param oldFromNew Vector holding permuted indices.
+   * @param lazy Whether the children are to be split later.
+   */
+  void SplitChildren(MatType& data,
+                     std::vector<size_t>& oldFromNew,
+                     const bool lazy);
+
+  //! The indices of the points routed to each leaf by Insert().
+  typedef std::map<const BinarySpaceTree*, std::vector<size_t> > InsertMap;
+
+  /**
+   * Add the given points to the tree; see Insert().
+   *
+   * @param points Points to add to the tree.
+   * @param oldFromNew Mapping of the point indices to update, or NULL.
+   */
+  void InsertPoints(const MatType& points, std::vector<size_t>* oldFromNew);
+
+  /**
+   * Copy the points of this node, and the points routed to its leaves, into
+   * the new dataset starting at the given column, and update the begin and
+   * count of this node and its descendants.
+   *
+   * @param points Points being added to the tree.
+   * @param inserted Indices of the points routed to each leaf.
+   * @param newData Dataset being filled.
+   * @param oldFromNew Mapping of the point indices, or NULL.
+   * @param newOldFromNew Mapping being filled, or NULL.
+   * @param newBegin Column of the new dataset of the first point of this node.
+   */
+  void Relayout(const MatType& points,
+                const InsertMap& inserted,
+                MatType& newData,
+                const std::vector<size_t>* oldFromNew,
+                std::vector<size_t>* newOldFromNew,
+                const size_t newBegin);
+
+  /**
+   * Split the leaves under this node which received points and hold more than
+   * the max leaf size, and recompute the cached distances and the statistics
+   * of the nodes which received points.  Returns whether this node received
+   * points.
+   *
+   * @param inserted Indices of the points routed to each leaf.
+   * @param oldFromNew Mapping of the point indices to update, or NULL.
    */
-  void SplitNode(MatType& data, std::vector<size_t>& oldFromNew);
+  bool Grow(const InsertMap& inserted, std::vector<size_t>* oldFromNew);
 
  public:
   /**
@@ -13,9 +13,177 @@
 #include <mlpack/core/util/log.hpp>
 #include <mlpack/core/util/string_util.hpp>
 
+#include <cstring>
+#include <fstream>
+#include <new>
+
 namespace mlpack {
 namespace tree {
 
+/**
+ * Expand a bound to contain the points in the given columns of a dataset.  In
+ * general this is just done with operator|=().  This is used when building a
+ * BinarySpaceTree.
+ */
+template<typename BoundType>
+struct BoundExpansion
+{
+  template<typename MatType>
+  static void Expand(BoundType& bound,
+                     const MatType& data,
+                     const size_t begin,
+                     const size_t count,
+                     const size_t /* minChunkSize */)
+  {
+    bound |= data.cols(begin, begin + count - 1);
+  }
+};
+
+/**
+ * For hyperrectangle bounds the result does not depend on the order the points
+ * are added in, so when this is called inside of an OpenMP parallel region,
+ * large sets of points are split into chunks of at least minChunkSize points,
+ * and the bound of each chunk is computed by a separate task.
+ */
+template<int Power, bool TakeRoot, size_t Dimensionality>
+struct BoundExpansion<bound::HRectBound<Power, TakeRoot, Dimensionality> >
+{
+  typedef bound::HRectBound<Power, TakeRoot, Dimensionality> BoundType;
+
+  template<typename MatType>
+  static void Expand(BoundType& bound,
+                     const MatType& data,
+                     const size_t begin,
+                     const size_t count,
+                     const size_t minChunkSize)
+  {
+#ifdef _OPENMP
+    const size_t chunks = std::min((size_t) omp_get_num_threads(),
+        count / minChunkSize);
+#else
+    const size_t chunks = 1;
+#endif
+
+    if (chunks <= 1)
+    {
+      bound |= data.cols(begin, begin + count - 1);
+      return;
+    }
+
+    std::vector<BoundType> chunkBounds(chunks, BoundType(data.n_rows));
+    for (size_t c = 0; c < chunks; ++c)
+    {
+      const size_t chunkBegin = begin + (c * count) / chunks;
+      const size_t chunkEnd = begin + ((c + 1) * count) / chunks;
+
+      #pragma omp task shared(chunkBounds, data)
+      chunkBounds[c] |= data.cols(chunkBegin, chunkEnd - 1);
+    }
+    #pragma omp taskwait
+
+    for (size_t c = 0; c < chunks; ++c)
+      bound |= chunkBounds[c];
+  }
+};
+
+/**
+ * For ball bounds the result depends on the order the points are added in, so
+ * that the tree does not depend on the number of threads, large sets of points
+ * are always split into the same chunks of at least minChunkSize points.  The
+ * ball of each chunk is computed by a separate task (when this is called
+ * inside of an OpenMP parallel region), and then the balls are merged in
+ * order.
+ */
+template<typename VecType, typename TMetricType>
+struct BoundExpansion<bound::BallBound<VecType, TMetricType> >
+{
+  typedef bound::BallBound<VecType, TMetricType> BoundType;
+
+  template<typename MatType>
+  static void Expand(BoundType& bound,
+                     const MatType& data,
+                     const size_t begin,
+                     const size_t count,
+                     const size_t minChunkSize)
+  {
+    const size_t chunks = count / minChunkSize;
+    if (chunks <= 1)
+    {
+      bound |= data.cols(begin, begin + count - 1);
+      return;
+    }
+
+    // Copies of a ball bound share its metric, so each task makes its own
+    // bound, and only keeps the radius and center of it.
+    std::vector<double> radii(chunks);
+    std::vector<VecType> centers(chunks);
+    for (size_t c = 0; c < chunks; ++c)
+    {
+      const size_t chunkBegin = begin + (c * count) / chunks;
+      const size_t chunkEnd = begin + ((c + 1) * count) / chunks;
+
+      #pragma omp task shared(radii, centers, data)
+      {
+        BoundType chunkBound(data.n_rows);
+        chunkBound |= data.cols(chunkBegin, chunkEnd - 1);
+        radii[c] = chunkBound.Radius();
+        centers[c] = chunkBound.Center();
+      }
+    }
+    #pragma omp taskwait
+
+    for (size_t c = 0; c < chunks; ++c)
+      bound |= BoundType(radii[c], centers[c]);
+  }
+};
+
+/**
+ * Describe how the ranges of a bound can be stored in a contiguous block of
+ * memory by BinarySpaceTree::Compact().  In general, bounds cannot be, so the
+ * bound needs zero ranges.
+ */
+template<typename BoundType>
+struct BoundLayout
+{
+  //! Return the number of ranges needed to store the bound.
+  static size_t Ranges(const BoundType& /* bound */) { return 0; }
+
+  //! Move the ranges of the bound to the given memory.
+  static void Relocate(BoundType& /* bound */, math::Range* /* memory */) { }
+
+  //! Create an empty bound of the given dimensionality, with its ranges in the
+  //! given memory if it isn't NULL (and if the bound stores ranges).
+  static BoundType Create(const size_t dimension, math::Range* /* memory */)
+  {
+    return BoundType(dimension);
+  }
+};
+
+//! Hyperrectangle bounds store one range for each dimension.
+template<int Power, bool TakeRoot, size_t Dimensionality>
+struct BoundLayout<bound::HRectBound<Power, TakeRoot, Dimensionality> >
+{
+  typedef bound::HRectBound<Power, TakeRoot, Dimensionality> BoundType;
+
+  static size_t Ranges(const BoundType& bound)
+  {
+    return bound.Dim();
+  }
+
+  static void Relocate(BoundType& bound, math::Range* memory)
+  {
+    bound.UseMemory(memory);
+  }
+
+  static BoundType Create(const size_t dimension, math::Range* memory)
+  {
+    if (memory)
+      return BoundType(dimension, memory);
+    else
+      return BoundType(dimension);
+  }
+};
+
 // Each of these overloads is kept as a separate function to keep the overhead
 // from the two std::vectors out, if possible.
 template<typename BoundType,
@@ -33,10 +201,24 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     maxLeafSize(maxLeafSize),
     bound(data.n_rows),
     parentDistance(0), // Parent distance for the root is 0: it has no parent.
-    dataset(data)
+    dataset(data),
+    nodeBlock(NULL),
+    nodeBlockSize(0),
+    arena(NULL),
+    lazyOldFromNew(NULL),
+    pendingSplit(false),
+    subtreeSplit(false)
 {
-  // Do the actual splitting of this node.
-  SplitNode(data);
+  // The nodes are allocated from an arena owned by this root.
+  CreateArena(count);
+
+  // Do the actual splitting of this node.  Large subtrees are built by separate
+  // tasks; see SplitNode().
+  #pragma omp parallel if(data.n_cols > ParallelBuildThreshold)
+  {
+    #pragma omp single
+    SplitNode(data);
+  }
 
   // Create the statistic depending on if we are a leaf or not.
   stat = StatisticType(*this);
@@ -49,7 +231,8 @@ template<typename BoundType,
 BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     MatType& data,
     std::vector<size_t>& oldFromNew,
-    const size_t maxLeafSize) :
+    const size_t maxLeafSize,
+    const bool lazy) :
     left(NULL),
     right(NULL),
     parent(NULL),
@@ -58,15 +241,29 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     maxLeafSize(maxLeafSize),
     bound(data.n_rows),
     parentDistance(0), // Parent distance for the root is 0: it has no parent.
-    dataset(data)
+    dataset(data),
+    nodeBlock(NULL),
+    nodeBlockSize(0),
+    arena(NULL),
+    lazyOldFromNew(lazy ? &oldFromNew : NULL),
+    pendingSplit(false),
+    subtreeSplit(false)
 {
   // Initialize oldFromNew correctly.
   oldFromNew.resize(data.n_cols);
   for (size_t i = 0; i < data.n_cols; i++)
     oldFromNew[i] = i; // Fill with unharmed indices.
 
-  // Now do the actual splitting.
-  SplitNode(data, oldFromNew);
+  // The nodes are allocated from an arena owned by this root.
+  CreateArena(count);
+
+  // Now do the actual splitting (or, if the tree is built lazily, just compute
+  // the bound).  Large subtrees are built by separate tasks; see SplitNode().
+  #pragma omp parallel if(data.n_cols > ParallelBuildThreshold)
+  {
+    #pragma omp single
+    SplitNode(data, oldFromNew, lazy);
+  }
 
   // Create the statistic depending on if we are a leaf or not.
   stat = StatisticType(*this);
@@ -89,15 +286,29 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     maxLeafSize(maxLeafSize),
     bound(data.n_rows),
     parentDistance(0), // Parent distance for the root is 0: it has no parent.
-    dataset(data)
+    dataset(data),
+    nodeBlock(NULL),
+    nodeBlockSize(0),
+    arena(NULL),
+    lazyOldFromNew(NULL),
+    pendingSplit(false),
+    subtreeSplit(false)
 {
   // Initialize the oldFromNew vector correctly.
   oldFromNew.resize(data.n_cols);
   for (size_t i = 0; i < data.n_cols; i++)
     oldFromNew[i] = i; // Fill with unharmed indices.
 
-  // Now do the actual splitting.
-  SplitNode(data, oldFromNew);
+  // The nodes are allocated from an arena owned by this root.
+  CreateArena(count);
+
+  // Now do the actual splitting.  Large subtrees are built by separate tasks;
+  // see SplitNode().
+  #pragma omp parallel if(data.n_cols > ParallelBuildThreshold)
+  {
+    #pragma omp single
+    SplitNode(data, oldFromNew);
+  }
 
   // Create the statistic depending on if we are a leaf or not.
   stat = StatisticType(*this);
@@ -124,8 +335,15 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     begin(begin),
     count(count),
     maxLeafSize(maxLeafSize),
-    bound(data.n_rows),
-    dataset(data)
+    bound(BoundLayout<BoundType>::Create(data.n_rows,
+        ArenaRanges(parent, this))),
+    dataset(data),
+    nodeBlock(NULL),
+    nodeBlockSize(0),
+    arena(parent ? parent->arena : NULL),
+    lazyOldFromNew(NULL),
+    pendingSplit(false),
+    subtreeSplit(false)
 {
   // Perform the actual splitting.
   SplitNode(data);
@@ -144,22 +362,31 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     const size_t count,
     std::vector<size_t>& oldFromNew,
     BinarySpaceTree* parent,
-    const size_t maxLeafSize) :
+    const size_t maxLeafSize,
+    const bool lazy) :
     left(NULL),
     right(NULL),
     parent(parent),
     begin(begin),
     count(count),
     maxLeafSize(maxLeafSize),
-    bound(data.n_rows),
-    dataset(data)
+    bound(BoundLayout<BoundType>::Create(data.n_rows,
+        ArenaRanges(parent, this))),
+    dataset(data),
+    nodeBlock(NULL),
+    nodeBlockSize(0),
+    arena(parent ? parent->arena : NULL),
+    lazyOldFromNew(lazy ? &oldFromNew : NULL),
+    pendingSplit(false),
+    subtreeSplit(false)
 {
   // Hopefully the vector is initialized correctly!  We can't check that
   // entirely but we can do a minor sanity check.
   assert(oldFromNew.size() == data.n_cols);
 
-  // Perform the actual splitting.
-  SplitNode(data, oldFromNew);
+  // Perform the actual splitting (or just compute the bound, if the node is to
+  // be split later).
+  SplitNode(data, oldFromNew, lazy);
 
   // Create the statistic depending on if we are a leaf or not.
   stat = StatisticType(*this);
@@ -183,8 +410,15 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     begin(begin),
     count(count),
     maxLeafSize(maxLeafSize),
-    bound(data.n_rows),
-    dataset(data)
+    bound(BoundLayout<BoundType>::Create(data.n_rows,
+        ArenaRanges(parent, this))),
+    dataset(data),
+    nodeBlock(NULL),
+    nodeBlockSize(0),
+    arena(parent ? parent->arena : NULL),
+    lazyOldFromNew(NULL),
+    pendingSplit(false),
+    subtreeSplit(false)
 {
   // Hopefully the vector is initialized correctly!  We can't check that
   // entirely but we can do a minor sanity check.
@@ -202,6 +436,110 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     newFromOld[oldFromNew[i]] = i;
 }
 
+// The magic string at the beginning of every saved tree.
+static const char BinarySpaceTreeMagic[8] =
+    { 'M', 'L', 'P', 'K', 'B', 'S', 'T', '1' };
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
+    const std::string& filename,
+    MatType& data,
+    std::vector<size_t>& oldFromNew) :
+    left(NULL),
+    right(NULL),
+    parent(NULL),
+    begin(0),
+    count(0),
+    maxLeafSize(0),
+    parentDistance(0), // Parent distance for the root is 0: it has no parent.
+    dataset(data),
+    nodeBlock(NULL),
+    nodeBlockSize(0),
+    arena(NULL),
+    lazyOldFromNew(NULL),
+    pendingSplit(false),
+    subtreeSplit(false)
+{
+  std::ifstream stream(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!stream.is_open())
+  {
+    Log::Fatal << "Cannot open file '" << filename << "' to load the tree."
+        << std::endl;
+  }
+
+  // The header holds the magic string, the size of the dataset, the max leaf
+  // size, and the size of an element of the dataset.
+  char magic[8];
+  uint64_t header[4];
+  stream.read(magic, 8);
+  stream.read((char*) header, sizeof(header));
+  if (!stream.good() || memcmp(magic, BinarySpaceTreeMagic, 8) != 0)
+  {
+    Log::Fatal << "File '" << filename << "' does not contain a saved "
+        << "BinarySpaceTree!" << std::endl;
+  }
+  if (header[3] != sizeof(typename MatType::elem_type))
+  {
+    Log::Fatal << "The tree in '" << filename << "' was saved with "
+        << header[3] << "-byte elements, but the dataset has "
+        << sizeof(typename MatType::elem_type) << "-byte elements!"
+        << std::endl;
+  }
+
+  data.set_size(header[0], header[1]);
+  stream.read((char*) data.memptr(), data.n_elem *
+      sizeof(typename MatType::elem_type));
+
+  std::vector<uint64_t> mapping(data.n_cols);
+  if (data.n_cols > 0)
+    stream.read((char*) &mapping[0], data.n_cols * sizeof(uint64_t));
+  oldFromNew.assign(mapping.begin(), mapping.end());
+
+  maxLeafSize = header[2];
+  bound = BoundType(data.n_rows);
+  CreateArena(data.n_cols);
+
+  // Now read all of the nodes.
+  LoadNode(stream);
+
+  if (!stream.good())
+  {
+    Log::Fatal << "The tree in '" << filename << "' is truncated!"
+        << std::endl;
+  }
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
+    std::istream& stream,
+    MatType& data,
+    BinarySpaceTree* parent,
+    const size_t maxLeafSize) :
+    left(NULL),
+    right(NULL),
+    parent(parent),
+    begin(0),
+    count(0),
+    maxLeafSize(maxLeafSize),
+    bound(BoundLayout<BoundType>::Create(data.n_rows,
+        ArenaRanges(parent, this))),
+    dataset(data),
+    nodeBlock(NULL),
+    nodeBlockSize(0),
+    arena(parent ? parent->arena : NULL),
+    lazyOldFromNew(NULL),
+    pendingSplit(false),
+    subtreeSplit(false)
+{
+  LoadNode(stream);
+}
+
 /*
 template<typename BoundType, typename StatisticType, typename MatType>
 BinarySpaceTree<BoundType, StatisticType, MatType>::BinarySpaceTree() :
@@ -238,7 +576,13 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     splitDimension(other.splitDimension),
     parentDistance(other.parentDistance),
     furthestDescendantDistance(other.furthestDescendantDistance),
-    dataset(other.dataset)
+    dataset(other.dataset),
+    nodeBlock(NULL),
+    nodeBlockSize(0),
+    arena(NULL),
+    lazyOldFromNew(NULL),
+    pendingSplit(false),
+    subtreeSplit(false)
 {
   // Create left and right children (if any).
   if (other.Left())
@@ -266,10 +610,166 @@ template<typename BoundType,
 BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
   ~BinarySpaceTree()
 {
+  if (nodeBlock)
+  {
+    // The descendants of this node were moved into one block by Compact(), so
+    // destroy each of them without recursing, and then free the block.
+    for (size_t i = 0; i < nodeBlockSize; ++i)
+    {
+      nodeBlock[i].left = NULL;
+      nodeBlock[i].right = NULL;
+      nodeBlock[i].~BinarySpaceTree();
+    }
+
+    ::operator delete(nodeBlock);
+  }
+  else
+  {
+    // Children in the arena are destroyed by the root, with the arena.
+    if (left && !(arena && arena->Owns(left)))
+      delete left;
+    if (right && !(arena && arena->Owns(right)))
+      delete right;
+
+    if (arena && parent == NULL)
+    {
+      for (size_t c = 0; c < arena->Chunks(); ++c)
+      {
+        char* slot = (char*) arena->Chunk(c);
+        for (size_t i = 0; i < arena->ChunkSlots(c); ++i)
+          ((BinarySpaceTree*) (slot + i * arena->SlotSize()))->
+              ~BinarySpaceTree();
+      }
+
+      delete arena;
+    }
+  }
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::Compact()
+{
+  if (parent != NULL)
+  {
+    Log::Fatal << "BinarySpaceTree::Compact() must be called on the root of "
+        << "the tree!" << std::endl;
+  }
+
+  // The nodes still to be split would be allocated outside of the block.
+  ExpandAll();
+
+  // Nothing to do if this was already done or the tree is just one node.
+  if (nodeBlock != NULL || IsLeaf())
+    return;
+
+  // Move all of the descendants into one block, in depth-first order.
+  nodeBlockSize = TreeSize() - 1;
+  nodeBlock = (BinarySpaceTree*) ::operator new(nodeBlockSize *
+      sizeof(BinarySpaceTree));
+
+  size_t index = 0;
   if (left)
-    delete left;
+    left = MoveToBlock(left, this, index);
   if (right)
-    delete right;
+    right = MoveToBlock(right, this, index);
+
+  // All of the nodes in the arena have been moved out of it.
+  delete arena;
+  arena = NULL;
+
+  // Now store the bounds of all of the nodes, in the same order, in one block
+  // too (if the bound type allows this).
+  const size_t ranges = BoundLayout<BoundType>::Ranges(bound);
+  if (ranges > 0)
+  {
+    boundBlock.resize(ranges * (nodeBlockSize + 1));
+    BoundLayout<BoundType>::Relocate(bound, &boundBlock[0]);
+    for (size_t i = 0; i < nodeBlockSize; ++i)
+      BoundLayout<BoundType>::Relocate(nodeBlock[i].bound,
+          &boundBlock[(i + 1) * ranges]);
+  }
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>*
+BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::MoveToBlock(
+    BinarySpaceTree* node,
+    BinarySpaceTree* newParent,
+    size_t& index)
+{
+  // Detach the children, so that the copy constructor and the destructor only
+  // handle this one node.
+  BinarySpaceTree* oldLeft = node->left;
+  BinarySpaceTree* oldRight = node->right;
+  node->left = NULL;
+  node->right = NULL;
+
+  BinarySpaceTree* newNode = new (nodeBlock + index) BinarySpaceTree(*node);
+  ++index;
+  if (arena && arena->Owns(node))
+    node->~BinarySpaceTree();
+  else
+    delete node;
+
+  newNode->parent = newParent;
+  if (oldLeft)
+    newNode->left = MoveToBlock(oldLeft, newNode, index);
+  if (oldRight)
+    newNode->right = MoveToBlock(oldRight, newNode, index);
+
+  return newNode;
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+    CreateArena(const size_t points)
+{
+  if (points <= maxLeafSize)
+    return;
+
+  // Each slot holds a node and the ranges of its bound.  Leaves usually hold
+  // between half of the max leaf size and the max leaf size, so there are
+  // usually fewer than 4 * points / maxLeafSize nodes (and never more than
+  // 2 * points).
+  const size_t slotSize = NodeArena::Align(sizeof(BinarySpaceTree)) +
+      BoundLayout<BoundType>::Ranges(bound) * sizeof(math::Range);
+  const size_t expectedNodes = std::min(2 * points,
+      4 * points / std::max(maxLeafSize, (size_t) 1) + 2);
+  arena = new NodeArena(slotSize, expectedNodes);
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void* BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+    AllocateNode()
+{
+  return arena ? arena->Allocate() : ::operator new(sizeof(BinarySpaceTree));
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+math::Range* BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+    ArenaRanges(const BinarySpaceTree* parent, BinarySpaceTree* node)
+{
+  // The ranges follow the node in its slot.
+  if (parent == NULL || parent->arena == NULL)
+    return NULL;
+
+  return (math::Range*) ((char*) node +
+      NodeArena::Align(sizeof(BinarySpaceTree)));
 }
 
 /**
@@ -366,6 +866,255 @@ size_t BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::ExtendTree
   return nodesDuplicated;
 }
 
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+inline void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+    Expand()
+{
+  // Only nodes of a lazily built tree are ever split here.
+  if (lazyOldFromNew == NULL)
+    return;
+
+  // A node is split once, so the flag is checked without the lock first.  The
+  // flag is cleared with release semantics after the children are built, so a
+  // thread which sees it cleared here also sees the children.
+  if (!pendingSplit.load(std::memory_order_acquire))
+    return;
+
+  #pragma omp critical(mlpack_binary_space_tree_expand)
+  {
+    // The lock orders this load with the store of the thread which split the
+    // node.
+    if (pendingSplit.load(std::memory_order_relaxed))
+    {
+      SplitChildren(dataset, *lazyOldFromNew, true);
+      pendingSplit.store(false, std::memory_order_release);
+    }
+  }
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+    ExpandAll()
+{
+  if (lazyOldFromNew == NULL || subtreeSplit.load(std::memory_order_acquire))
+    return;
+
+  Expand();
+  if (left)
+    left->ExpandAll();
+  if (right)
+    right->ExpandAll();
+
+  // Once this is set, the points of this node are never moved again.
+  subtreeSplit.store(true, std::memory_order_release);
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::Insert(
+    const MatType& points)
+{
+  InsertPoints(points, NULL);
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::Insert(
+    const MatType& points,
+    std::vector<size_t>& oldFromNew)
+{
+  if (oldFromNew.size() != dataset.n_cols)
+  {
+    Log::Fatal << "BinarySpaceTree::Insert(): the mapping holds "
+        << oldFromNew.size() << " indices, but the tree holds "
+        << dataset.n_cols << " points!" << std::endl;
+  }
+
+  InsertPoints(points, &oldFromNew);
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+    InsertPoints(const MatType& points, std::vector<size_t>* oldFromNew)
+{
+  if (parent != NULL)
+  {
+    Log::Fatal << "BinarySpaceTree::Insert() must be called on the root of "
+        << "the tree!" << std::endl;
+  }
+
+  // New nodes would be allocated outside of the block of a compacted tree, and
+  // the nodes of a lazy tree are split with a mapping the tree does not own.
+  if (nodeBlock != NULL)
+    Log::Fatal << "Cannot insert points into a compacted tree!" << std::endl;
+  if (lazyOldFromNew != NULL)
+    Log::Fatal << "Cannot insert points into a lazy tree!" << std::endl;
+
+  if (points.n_rows != dataset.n_rows)
+  {
+    Log::Fatal << "Cannot insert points of dimensionality " << points.n_rows
+        << " into a tree of dimensionality " << dataset.n_rows << "!"
+        << std::endl;
+  }
+
+  if (points.n_cols == 0)
+    return;
+
+  // Route each point to a leaf, expanding the bounds on the way.
+  InsertMap inserted;
+  for (size_t i = 0; i < points.n_cols; ++i)
+  {
+    BinarySpaceTree* node = this;
+    node->bound |= points.cols(i, i);
+    while (!node->IsLeaf())
+    {
+      BinarySpaceTree* next = node->left;
+      if (node->right != NULL && node->right->bound.MinDistance(points.col(i))
+          < node->left->bound.MinDistance(points.col(i)))
+        next = node->right;
+
+      next->bound |= points.cols(i, i);
+      node = next;
+    }
+
+    inserted[node].push_back(i);
+  }
+
+  // Make room for the new points after the old points of each leaf.
+  MatType newData(dataset.n_rows, dataset.n_cols + points.n_cols);
+  std::vector<size_t> newOldFromNew(oldFromNew ? newData.n_cols : 0);
+  Relayout(points, inserted, newData, oldFromNew,
+      oldFromNew ? &newOldFromNew : NULL, 0);
+
+  dataset = newData;
+  if (oldFromNew)
+    oldFromNew->swap(newOldFromNew);
+
+  Grow(inserted, oldFromNew);
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::Relayout(
+    const MatType& points,
+    const InsertMap& inserted,
+    MatType& newData,
+    const std::vector<size_t>* oldFromNew,
+    std::vector<size_t>* newOldFromNew,
+    const size_t newBegin)
+{
+  if (!IsLeaf())
+  {
+    left->Relayout(points, inserted, newData, oldFromNew, newOldFromNew,
+        newBegin);
+    size_t newCount = left->count;
+    if (right != NULL)
+    {
+      right->Relayout(points, inserted, newData, oldFromNew, newOldFromNew,
+          newBegin + newCount);
+      newCount += right->count;
+    }
+
+    begin = newBegin;
+    count = newCount;
+    return;
+  }
+
+  // The old points of the leaf come first, then the points routed to it.
+  if (count > 0)
+  {
+    newData.cols(newBegin, newBegin + count - 1) =
+        dataset.cols(begin, begin + count - 1);
+  }
+  if (newOldFromNew)
+  {
+    for (size_t i = 0; i < count; ++i)
+      (*newOldFromNew)[newBegin + i] = (*oldFromNew)[begin + i];
+  }
+
+  size_t newCount = count;
+  typename InsertMap::const_iterator it = inserted.find(this);
+  if (it != inserted.end())
+  {
+    const std::vector<size_t>& indices = it->second;
+    for (size_t i = 0; i < indices.size(); ++i, ++newCount)
+    {
+      newData.col(newBegin + newCount) = points.col(indices[i]);
+      if (newOldFromNew)
+      {
+        (*newOldFromNew)[newBegin + newCount] = oldFromNew->size() +
+            indices[i];
+      }
+    }
+  }
+
+  begin = newBegin;
+  count = newCount;
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+bool BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::Grow(
+    const InsertMap& inserted,
+    std::vector<size_t>* oldFromNew)
+{
+  if (IsLeaf())
+  {
+    if (inserted.find(this) == inserted.end())
+      return false;
+
+    // This splits the leaf only if it holds too many points now, and updates
+    // the furthest descendant distance either way.
+    if (oldFromNew)
+      SplitNode(dataset, *oldFromNew, false);
+    else
+      SplitNode(dataset);
+  }
+  else
+  {
+    // Both children are visited, even if the left one received points.
+    const bool leftGrown = left->Grow(inserted, oldFromNew);
+    const bool rightGrown = (right != NULL) &&
+        right->Grow(inserted, oldFromNew);
+    if (!leftGrown && !rightGrown)
+      return false;
+
+    furthestDescendantDistance = 0.5 * bound.Diameter();
+
+    // The bounds have grown, so their centroids have moved.
+    arma::vec centroid, childCentroid;
+    Centroid(centroid);
+    left->Centroid(childCentroid);
+    left->ParentDistance() = bound.Metric().Evaluate(centroid, childCentroid);
+    if (right != NULL)
+    {
+      right->Centroid(childCentroid);
+      right->ParentDistance() = bound.Metric().Evaluate(centroid,
+          childCentroid);
+    }
+  }
+
+  stat = StatisticType(*this);
+  return true;
+}
+
 /* TODO: we can likely calculate this earlier, then store the
  *   result in a private member variable; for now, we can
  *   just calculate as needed...
@@ -399,6 +1148,23 @@ size_t BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
                       (right ? right->TreeDepth() : 0));
 }
 
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+double BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+    Imbalance() const
+{
+  // A balanced tree has one level for each halving of the points until they
+  // fit in a leaf.
+  const size_t leaves = (maxLeafSize == 0) ? count :
+      (count + maxLeafSize - 1) / maxLeafSize;
+  const double balancedDepth = 1.0 + ((leaves > 1) ?
+      std::ceil(std::log((double) leaves) / std::log(2.0)) : 0.0);
+
+  return TreeDepth() / balancedDepth;
+}
+
 template<typename BoundType,
          typename StatisticType,
          typename MatType,
@@ -529,6 +1295,11 @@ template<typename BoundType,
 inline size_t BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
     Descendant(const size_t index) const
 {
+  // The points of a lazily built node are moved until all of its descendants
+  // are split.
+  if (lazyOldFromNew != NULL && !subtreeSplit.load(std::memory_order_acquire))
+    const_cast<BinarySpaceTree*>(this)->ExpandAll();
+
   return (begin + index);
 }
 
@@ -542,6 +1313,11 @@ template<typename BoundType,
 inline size_t BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
     Point(const size_t index) const
 {
+  // A node which is still to be split is a leaf for now, but its points are
+  // moved when it is split.
+  if (lazyOldFromNew != NULL && !subtreeSplit.load(std::memory_order_acquire))
+    const_cast<BinarySpaceTree*>(this)->ExpandAll();
+
   return (begin + index);
 }
 
@@ -566,7 +1342,8 @@ void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::SplitNode(
     MatType& data)
 {
   // We need to expand the bounds of this node properly.
-  bound |= data.cols(begin, begin + count - 1);
+  BoundExpansion<BoundType>::Expand(bound, data, begin, count,
+      ParallelBuildThreshold);
 
   // Calculate the furthest descendant distance.
   furthestDescendantDistance = 0.5 * bound.Diameter();
@@ -591,11 +1368,16 @@ void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::SplitNode(
     return;
 
   // Now that we know the split column, we will recursively split the children
-  // by calling their constructors (which perform this splitting process).
-  left = new BinarySpaceTree<BoundType, StatisticType, MatType>(data, begin,
-      splitCol - begin, this, maxLeafSize);
-  right = new BinarySpaceTree<BoundType, StatisticType, MatType>(data, splitCol,
+  // by calling their constructors (which perform this splitting process).  The
+  // children hold disjoint ranges of the dataset, so if we are in a parallel
+  // region and this node is large, they are built by separate tasks.
+  #pragma omp task shared(data) if(count > ParallelBuildThreshold)
+  left = new (AllocateNode()) BinarySpaceTree(data, begin, splitCol - begin,
+      this, maxLeafSize);
+  #pragma omp task shared(data) if(count > ParallelBuildThreshold)
+  right = new (AllocateNode()) BinarySpaceTree(data, splitCol,
       begin + count - splitCol, this, maxLeafSize);
+  #pragma omp taskwait
 
   // Calculate parent distances for those two nodes.
   arma::vec centroid, leftCentroid, rightCentroid;
@@ -618,11 +1400,13 @@ template<typename BoundType,
          typename SplitType>
 void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::SplitNode(
     MatType& data,
-    std::vector<size_t>& oldFromNew)
+    std::vector<size_t>& oldFromNew,
+    const bool lazy)
 {
   // This should be a single function for Bound.
   // We need to expand the bounds of this node properly.
-  bound |= data.cols(begin, begin + count - 1);
+  BoundExpansion<BoundType>::Expand(bound, data, begin, count,
+      ParallelBuildThreshold);
 
   // Calculate the furthest descendant distance.
   furthestDescendantDistance = 0.5 * bound.Diameter();
@@ -631,6 +1415,21 @@ void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::SplitNode(
   if (count <= maxLeafSize)
     return; // We can't split this.
 
+  if (lazy)
+    pendingSplit.store(true, std::memory_order_relaxed);
+  else
+    SplitChildren(data, oldFromNew, false);
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+    SplitChildren(MatType& data,
+                  std::vector<size_t>& oldFromNew,
+                  const bool lazy)
+{
   // splitCol denotes the two partitions of the dataset after the split. The
   // points on its left go to the left child and the others go to the right
   // child.
@@ -648,11 +1447,17 @@ void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::SplitNode(
     return;
 
   // Now that we know the split column, we will recursively split the children
-  // by calling their constructors (which perform this splitting process).
-  left = new BinarySpaceTree<BoundType, StatisticType, MatType>(data, begin,
-      splitCol - begin, oldFromNew, this, maxLeafSize);
-  right = new BinarySpaceTree<BoundType, StatisticType, MatType>(data, splitCol,
-      begin + count - splitCol, oldFromNew, this, maxLeafSize);
+  // by calling their constructors (which perform this splitting process).  The
+  // children hold disjoint ranges of the dataset and of oldFromNew, so if we
+  // are in a parallel region and this node is large, they are built by
+  // separate tasks.
+  #pragma omp task shared(data, oldFromNew) if(count > ParallelBuildThreshold)
+  left = new (AllocateNode()) BinarySpaceTree(data, begin, splitCol - begin,
+      oldFromNew, this, maxLeafSize, lazy);
+  #pragma omp task shared(data, oldFromNew) if(count > ParallelBuildThreshold)
+  right = new (AllocateNode()) BinarySpaceTree(data, splitCol,
+      begin + count - splitCol, oldFromNew, this, maxLeafSize, lazy);
+  #pragma omp taskwait
 
   // Calculate parent distances for those two nodes.
   arma::vec centroid, leftCentroid, rightCentroid;
@@ -669,6 +1474,113 @@ void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::SplitNode(
   right->ParentDistance() = rightParentDistance;
 }
 
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::Save(
+    const std::string& filename,
+    const std::vector<size_t>& oldFromNew) const
+{
+  if (oldFromNew.size() != dataset.n_cols)
+  {
+    Log::Fatal << "BinarySpaceTree::Save(): mapping has " << oldFromNew.size()
+        << " elements, but the dataset has " << dataset.n_cols << " points!"
+        << std::endl;
+  }
+
+  std::ofstream stream(filename.c_str(), std::ios::out | std::ios::binary);
+  if (!stream.is_open())
+  {
+    Log::Fatal << "Cannot open file '" << filename << "' to save the tree."
+        << std::endl;
+  }
+
+  uint64_t header[4];
+  header[0] = dataset.n_rows;
+  header[1] = dataset.n_cols;
+  header[2] = maxLeafSize;
+  header[3] = sizeof(typename MatType::elem_type);
+  stream.write(BinarySpaceTreeMagic, 8);
+  stream.write((const char*) header, sizeof(header));
+
+  stream.write((const char*) dataset.memptr(), dataset.n_elem *
+      sizeof(typename MatType::elem_type));
+
+  const std::vector<uint64_t> mapping(oldFromNew.begin(), oldFromNew.end());
+  if (mapping.size() > 0)
+    stream.write((const char*) &mapping[0], mapping.size() * sizeof(uint64_t));
+
+  // Now write all of the nodes, in depth-first order.
+  SaveNode(stream);
+
+  if (!stream.good())
+  {
+    Log::Fatal << "Error while saving the tree to '" << filename << "'."
+        << std::endl;
+  }
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::LoadNode(
+    std::istream& stream)
+{
+  uint64_t fields[4];
+  stream.read((char*) fields, sizeof(fields));
+  begin = fields[0];
+  count = fields[1];
+  splitDimension = fields[2];
+  const size_t numChildren = fields[3];
+
+  stream.read((char*) &parentDistance, sizeof(double));
+  stream.read((char*) &furthestDescendantDistance, sizeof(double));
+  bound.Load(stream);
+
+  if (!stream.good() || begin + count > dataset.n_cols || numChildren > 2)
+  {
+    Log::Fatal << "BinarySpaceTree: saved tree is corrupt or truncated!"
+        << std::endl;
+  }
+
+  // Load the children, if there are any.
+  if (numChildren > 0)
+    left = new (AllocateNode()) BinarySpaceTree(stream, dataset, this,
+        maxLeafSize);
+  if (numChildren > 1)
+    right = new (AllocateNode()) BinarySpaceTree(stream, dataset, this,
+        maxLeafSize);
+
+  // Create the statistic depending on if we are a leaf or not.
+  stat = StatisticType(*this);
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::SaveNode(
+    std::ostream& stream) const
+{
+  uint64_t fields[4];
+  fields[0] = begin;
+  fields[1] = count;
+  fields[2] = (left ? splitDimension : 0);
+  fields[3] = NumChildren();
+  stream.write((const char*) fields, sizeof(fields));
+
+  stream.write((const char*) &parentDistance, sizeof(double));
+  stream.write((const char*) &furthestDescendantDistance, sizeof(double));
+  bound.Save(stream);
+
+  if (left)
+    left->SaveNode(stream);
+  if (right)
+    right->SaveNode(stream);
+}
+
 /**
  * Returns a string representation of this object.
  */
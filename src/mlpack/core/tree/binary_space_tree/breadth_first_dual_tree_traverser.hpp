@@ -6,6 +6,12 @@
  * This is a nested class of BinarySpaceTree which traverses two trees in a
  * breadth-first manner with a given set of rules which indicate the branches
  * which can be pruned and the order in which to recurse.
+ *
+ * The traversal proceeds one level of node combinations at a time.  The
+ * combinations of two leaves found at a level are not evaluated immediately;
+ * they are collected, sorted by query and reference node so that consecutive
+ * base cases touch neighbouring points, and then evaluated together, possibly
+ * with several threads.
  */
 #ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_BREADTH_FIRST_DUAL_TREE_TRAVERSER_HPP
 #define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_BREADTH_FIRST_DUAL_TREE_TRAVERSER_HPP
@@ -13,6 +19,9 @@
 #include <mlpack/core.hpp>
 
 #include "binary_space_tree.hpp"
+#include "../traversal_statistics.hpp"
+
+#include <vector>
 
 namespace mlpack {
 namespace tree {
@@ -31,6 +40,12 @@ class BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
    */
   BreadthFirstDualTreeTraverser(RuleType& rule);
 
+  /**
+   * Add the statistics of this traversal to the process-wide total (see
+   * TraversalStatistics::Record()).
+   */
+  ~BreadthFirstDualTreeTraverser() { TraversalStatistics::Record(statistics); }
+
   /**
    * Traverse the two trees.  This does not reset the number of prunes.
    *
@@ -41,6 +56,29 @@ class BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
   void Traverse(BinarySpaceTree& queryNode,
                 BinarySpaceTree& referenceNode);
 
+  /**
+   * Traverse the two trees, evaluating the base cases of each level with the
+   * given number of threads (0 means util::NumThreads(); without OpenMP, the
+   * traversal is serial).  The node combinations are still scored
+   * by a single thread, with the given rules; each thread evaluates the base
+   * cases of whole query leaves with its own copy of the rules.
+   *
+   * This is only correct for rules whose BaseCase() modifies nothing but the
+   * results of its query point, such as NeighborSearchRules and
+   * RangeSearchRules.  Rules which modify state of the reference points (such
+   * as DualTreeKMeansRules) or shared state (such as DTBRules) must use the
+   * serial traversal.  Counters kept by the rules (like
+   * NeighborSearchRules::BaseCases()) do not include the base cases evaluated
+   * by the copies of the rules; NumBaseCases() counts all of them.
+   *
+   * @param queryNode The query node to be traversed.
+   * @param referenceNode The reference node to be traversed.
+   * @param numThreads Number of threads to evaluate base cases with.
+   */
+  void Traverse(BinarySpaceTree& queryNode,
+                BinarySpaceTree& referenceNode,
+                const size_t numThreads);
+
   //! Get the number of prunes.
   size_t NumPrunes() const { return numPrunes; }
   //! Modify the number of prunes.
@@ -61,13 +99,60 @@ class BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
   //! Modify the number of times a base case was calculated.
   size_t& NumBaseCases() { return numBaseCases; }
 
+  //! Get the statistics of the traversal.
+  const TraversalStatistics& Statistics() const { return statistics; }
+  //! Modify the statistics of the traversal.
+  TraversalStatistics& Statistics() { return statistics; }
+
  private:
+  //! A node combination still to be visited, with the traversal information
+  //! of its parent combination.
+  struct NodePair
+  {
+    BinarySpaceTree* queryNode;
+    BinarySpaceTree* referenceNode;
+    typename RuleType::TraversalInfoType traversalInfo;
+  };
+
+  //! Order node combinations by the first query point, then by the first
+  //! reference point.
+  static bool PairOrder(const NodePair& a, const NodePair& b)
+  {
+    if (a.queryNode->Begin() != b.queryNode->Begin())
+      return (a.queryNode->Begin() < b.queryNode->Begin());
+    return (a.referenceNode->Begin() < b.referenceNode->Begin());
+  }
+
+  /**
+   * Score the children of the reference node against the query node, and add
+   * those which are not pruned to the next level, in the order given by the
+   * rules.  The rules' traversal information must be that of the parent
+   * combination.
+   */
+  void PushReferenceChildren(BinarySpaceTree& queryNode,
+                             BinarySpaceTree& referenceNode);
+
+  //! Score the combination of the two nodes and add it to the next level
+  //! unless it is pruned.
+  void PushPair(BinarySpaceTree& queryNode, BinarySpaceTree& referenceNode);
+
+  //! Add the combination of the two nodes, with the current traversal
+  //! information of the rules, to the next level.
+  void Push(BinarySpaceTree& queryNode, BinarySpaceTree& referenceNode);
+
+  //! Evaluate the base cases of the leaf combinations of the current level,
+  //! with the given number of threads.
+  void EvaluateLeafPairs(const size_t numThreads);
+
   //! Reference to the rules with which the trees will be traversed.
   RuleType& rule;
 
   //! The number of prunes.
   size_t numPrunes;
 
+  //! The statistics of the traversal.
+  TraversalStatistics statistics;
+
   //! The number of node combinations that have been visited during traversal.
   size_t numVisited;
 
@@ -80,6 +165,16 @@ class BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
   //! Traversal information, held in the class so that it isn't continually
   //! being reallocated.
   typename RuleType::TraversalInfoType traversalInfo;
+
+  //! The node combinations of the current level.  The lists are held in the
+  //! class so that they aren't reallocated for every level.
+  std::vector<NodePair> frontier;
+  //! The node combinations of the next level.
+  std::vector<NodePair> nextFrontier;
+  //! The combinations of two leaves of the current level.
+  std::vector<NodePair> leafPairs;
+  //! The index in leafPairs of the first combination of each query leaf.
+  std::vector<size_t> queryLeafStarts;
 };
 
 }; // namespace tree
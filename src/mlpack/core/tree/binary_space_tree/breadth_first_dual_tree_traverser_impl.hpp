@@ -12,7 +12,7 @@
 // In case it hasn't been included yet.
 #include "breadth_first_dual_tree_traverser.hpp"
 
-#include <queue>
+#include <algorithm>
 
 namespace mlpack {
 namespace tree {
@@ -42,6 +42,21 @@ BreadthFirstDualTreeTraverser<RuleType>::Traverse(
     BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>& queryRoot,
     BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>&
         referenceRoot)
+{
+  Traverse(queryRoot, referenceRoot, 1);
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+template<typename RuleType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+BreadthFirstDualTreeTraverser<RuleType>::Traverse(
+    BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>& queryRoot,
+    BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>&
+        referenceRoot,
+    const size_t numThreads)
 {
   // Increment the visit counter.
   ++numVisited;
@@ -49,391 +64,258 @@ BreadthFirstDualTreeTraverser<RuleType>::Traverse(
   // Store the current traversal info.
   traversalInfo = rule.TraversalInfo();
 
-  typedef BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>
-      TreeType;
+  frontier.clear();
+  nextFrontier.clear();
 
-  std::queue<TreeType*> queryList;
-  std::queue<TreeType*> referenceList;
-  std::queue<typename RuleType::TraversalInfoType> traversalInfos;
-  queryList.push(&queryRoot);
-  referenceList.push(&referenceRoot);
-  traversalInfos.push(rule.TraversalInfo());
+  NodePair root;
+  root.queryNode = &queryRoot;
+  root.referenceNode = &referenceRoot;
+  root.traversalInfo = rule.TraversalInfo();
+  frontier.push_back(root);
 
-  while (!queryList.empty())
+  while (!frontier.empty())
   {
-    TreeType& queryNode = *queryList.front();
-    TreeType& referenceNode = *referenceList.front();
-    typename RuleType::TraversalInfoType ti = traversalInfos.front();
-
-    queryList.pop();
-    referenceList.pop();
-    traversalInfos.pop();
+    leafPairs.clear();
 
-    rule.TraversalInfo() = ti;
-
-    // If both are leaves, we must evaluate the base case.
-    if (queryNode.IsLeaf() && referenceNode.IsLeaf())
+    for (size_t i = 0; i < frontier.size(); ++i)
     {
-      // Loop through each of the points in each node.
-      for (size_t query = queryNode.Begin(); query < queryNode.End(); ++query)
-      {
-        // See if we need to investigate this point (this function should be
-        // implemented for the single-tree recursion too).  Restore the traversal
-        // information first.
-//        const double childScore = rule.Score(query, referenceNode);
+      BinarySpaceTree& queryNode = *frontier[i].queryNode;
+      BinarySpaceTree& referenceNode = *frontier[i].referenceNode;
 
-//        if (childScore == DBL_MAX)
-//          continue; // We can't improve this particular point.
+      rule.TraversalInfo() = frontier[i].traversalInfo;
+      statistics.AddVisit();
 
-        for (size_t ref = referenceNode.Begin(); ref < referenceNode.End(); ++ref)
-          rule.BaseCase(query, ref);
+      // In trees built lazily, the nodes are split when they are first
+      // reached.
+      queryNode.Expand();
+      referenceNode.Expand();
 
-        numBaseCases += referenceNode.Count();
-      }
-    }
-    else if ((!queryNode.IsLeaf()) && referenceNode.IsLeaf())
-    {
-      // We have to recurse down the query node.  In this case the recursion order
-      // does not matter.
-      const double leftScore = rule.Score(*queryNode.Left(), referenceNode);
-      ++numScores;
-
-      if (leftScore != DBL_MAX)
+      if (queryNode.IsLeaf() && referenceNode.IsLeaf())
       {
-        queryList.push(queryNode.Left());
-        referenceList.push(&referenceNode);
-        traversalInfos.push(rule.TraversalInfo());
-//        Log::Debug << "Push1 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
+        // The base cases are evaluated once the whole level has been seen.
+        leafPairs.push_back(frontier[i]);
       }
-      else
+      else if (referenceNode.IsLeaf())
       {
-        ++numPrunes;
+        // We have to recurse down the query node.  In this case the recursion
+        // order does not matter.
+        PushPair(*queryNode.Left(), referenceNode);
+        rule.TraversalInfo() = frontier[i].traversalInfo;
+        PushPair(*queryNode.Right(), referenceNode);
       }
-
-      // Before recursing, we have to set the traversal information correctly.
-      rule.TraversalInfo() = ti;
-      const double rightScore = rule.Score(*queryNode.Right(), referenceNode);
-      ++numScores;
-
-      if (rightScore != DBL_MAX)
+      else if (queryNode.IsLeaf())
       {
-        queryList.push(queryNode.Right());
-        referenceList.push(&referenceNode);
-        traversalInfos.push(rule.TraversalInfo());
-//        Log::Debug << "Push2 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
+        // We have to recurse down the reference node, in the order given by
+        // the scores.
+        PushReferenceChildren(queryNode, referenceNode);
       }
       else
-        ++numPrunes;
-    }
-    else if (queryNode.IsLeaf() && (!referenceNode.IsLeaf()))
-    {
-      // We have to recurse down the reference node.  In this case the recursion
-      // order does matter.  Before recursing, though, we have to set the
-      // traversal information correctly.
-      double leftScore = rule.Score(queryNode, *referenceNode.Left());
-      typename RuleType::TraversalInfoType leftInfo = rule.TraversalInfo();
-      rule.TraversalInfo() = ti;
-      double rightScore = rule.Score(queryNode, *referenceNode.Right());
-      numScores += 2;
-
-      if (leftScore < rightScore)
       {
-        // Recurse to the left.  Restore the left traversal info.  Store the right
-        // traversal info.
-        queryList.push(&queryNode);
-        referenceList.push(referenceNode.Left());
-        traversalInfos.push(leftInfo);
-//        Log::Debug << "Push3 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-
-        // Is it still valid to recurse to the right?
-        rightScore = rule.Rescore(queryNode, *referenceNode.Right(), rightScore);
-
-        if (rightScore != DBL_MAX)
-        {
-          // Restore the right traversal info.
-          queryList.push(&queryNode);
-          referenceList.push(referenceNode.Right());
-          traversalInfos.push(rule.TraversalInfo());
-//        Log::Debug << "Push4 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-        }
-        else
-          ++numPrunes;
+        // We have to recurse down both nodes.  The query descent order does
+        // not matter, so the left query child goes first.
+        PushReferenceChildren(*queryNode.Left(), referenceNode);
+        rule.TraversalInfo() = frontier[i].traversalInfo;
+        PushReferenceChildren(*queryNode.Right(), referenceNode);
       }
-      else if (rightScore < leftScore)
+    }
+
+    EvaluateLeafPairs(numThreads);
+
+    frontier.swap(nextFrontier);
+    nextFrontier.clear();
+  }
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+template<typename RuleType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+BreadthFirstDualTreeTraverser<RuleType>::PushReferenceChildren(
+    BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>& queryNode,
+    BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>&
+        referenceNode)
+{
+  // Each child must be scored with the traversal information of the parent
+  // combination.
+  const typename RuleType::TraversalInfoType parentInfo = rule.TraversalInfo();
+  double leftScore = rule.Score(queryNode, *referenceNode.Left());
+  const typename RuleType::TraversalInfoType leftInfo = rule.TraversalInfo();
+  rule.TraversalInfo() = parentInfo;
+  double rightScore = rule.Score(queryNode, *referenceNode.Right());
+  numScores += 2;
+  statistics.AddScores(2);
+
+  if (leftScore == DBL_MAX && rightScore == DBL_MAX)
+  {
+    numPrunes += 2;
+    statistics.AddPrunes(*referenceNode.Left(), 2);
+  }
+  else if (rightScore < leftScore)
+  {
+    // Recurse to the right first.
+    Push(queryNode, *referenceNode.Right());
+
+    // Is it still valid to recurse to the left?
+    leftScore = rule.Rescore(queryNode, *referenceNode.Left(), leftScore);
+    if (leftScore != DBL_MAX)
     {
-      // Recurse to the right.
-      queryList.push(&queryNode);
-      referenceList.push(referenceNode.Right());
-      traversalInfos.push(rule.TraversalInfo());
-//        Log::Debug << "Push5 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-
-      // Is it still valid to recurse to the left?
-      leftScore = rule.Rescore(queryNode, *referenceNode.Left(), leftScore);
-
-      if (leftScore != DBL_MAX)
-      {
-        // Restore the left traversal info.
-        queryList.push(&queryNode);
-        referenceList.push(referenceNode.Left());
-        traversalInfos.push(leftInfo);
-//        Log::Debug << "Push6 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-      }
-      else
-        ++numPrunes;
+      rule.TraversalInfo() = leftInfo;
+      Push(queryNode, *referenceNode.Left());
     }
-    else // leftScore is equal to rightScore.
+    else
     {
-      if (leftScore == DBL_MAX)
-      {
-        numPrunes += 2;
-      }
-      else
-      {
-        // Choose the left first.  Restore the left traversal info.  Store the
-        // right traversal info.
-        queryList.push(&queryNode);
-        referenceList.push(referenceNode.Left());
-        traversalInfos.push(leftInfo);
-//        Log::Debug << "Push7 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-
-        rightScore = rule.Rescore(queryNode, *referenceNode.Right(),
-            rightScore);
-
-        if (rightScore != DBL_MAX)
-        {
-          // Restore the right traversal info.
-          queryList.push(&queryNode);
-          referenceList.push(referenceNode.Right());
-          traversalInfos.push(rule.TraversalInfo());
-//        Log::Debug << "Push8 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-        }
-        else
-          ++numPrunes;
-      }
+      ++numPrunes;
+      statistics.AddPrunes(*referenceNode.Left());
     }
   }
   else
   {
-    // We have to recurse down both query and reference nodes.  Because the
-    // query descent order does not matter, we will go to the left query child
-    // first.  Before recursing, we have to set the traversal information
-    // correctly.
-    double leftScore = rule.Score(*queryNode.Left(), *referenceNode.Left());
-    typename RuleType::TraversalInfoType leftInfo = rule.TraversalInfo();
-    rule.TraversalInfo() = ti;
-    double rightScore = rule.Score(*queryNode.Left(), *referenceNode.Right());
-    typename RuleType::TraversalInfoType rightInfo;
-    numScores += 2;
-
-    if (leftScore < rightScore)
+    // Recurse to the left first (also if the scores are equal).
+    const typename RuleType::TraversalInfoType rightInfo =
+        rule.TraversalInfo();
+    rule.TraversalInfo() = leftInfo;
+    Push(queryNode, *referenceNode.Left());
+    rule.TraversalInfo() = rightInfo;
+
+    // Is it still valid to recurse to the right?
+    rightScore = rule.Rescore(queryNode, *referenceNode.Right(), rightScore);
+    if (rightScore != DBL_MAX)
     {
-      // Recurse to the left.  Restore the left traversal info.  Store the right
-      // traversal info.
-      queryList.push(queryNode.Left());
-      referenceList.push(referenceNode.Left());
-      traversalInfos.push(leftInfo);
-//        Log::Debug << "Push9 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-
-      // Is it still valid to recurse to the right?
-      rightScore = rule.Rescore(*queryNode.Left(), *referenceNode.Right(),
-          rightScore);
-
-      if (rightScore != DBL_MAX)
-      {
-        // Restore the right traversal info.
-        queryList.push(queryNode.Left());
-        referenceList.push(referenceNode.Right());
-        traversalInfos.push(rule.TraversalInfo());
-//        Log::Debug << "Push10 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-      }
-      else
-        ++numPrunes;
-    }
-    else if (rightScore < leftScore)
-    {
-      // Recurse to the right.
-      queryList.push(queryNode.Left());
-      referenceList.push(referenceNode.Right());
-      traversalInfos.push(rule.TraversalInfo());
-//        Log::Debug << "Push11 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-
-      // Is it still valid to recurse to the left?
-      leftScore = rule.Rescore(*queryNode.Left(), *referenceNode.Left(),
-          leftScore);
-
-      if (leftScore != DBL_MAX)
-      {
-        // Restore the left traversal info.
-        queryList.push(queryNode.Left());
-        referenceList.push(referenceNode.Left());
-        traversalInfos.push(leftInfo);
-//        Log::Debug << "Push12 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-      }
-      else
-        ++numPrunes;
+      Push(queryNode, *referenceNode.Right());
     }
     else
     {
-      if (leftScore == DBL_MAX)
-      {
-        numPrunes += 2;
-      }
-      else
-      {
-        // Choose the left first.  Restore the left traversal info and store the
-        // right traversal info.
-        queryList.push(queryNode.Left());
-        referenceList.push(referenceNode.Left());
-        traversalInfos.push(leftInfo);
-//        Log::Debug << "Push13 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-
-        // Is it still valid to recurse to the right?
-        rightScore = rule.Rescore(*queryNode.Left(), *referenceNode.Right(),
-            rightScore);
-
-        if (rightScore != DBL_MAX)
-        {
-          // Restore the right traversal information.
-          queryList.push(queryNode.Left());
-          referenceList.push(referenceNode.Right());
-          traversalInfos.push(rule.TraversalInfo());
-//        Log::Debug << "Push14 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-        }
-        else
-          ++numPrunes;
-      }
+      ++numPrunes;
+      statistics.AddPrunes(*referenceNode.Right());
     }
+  }
+}
 
-    // Restore the main traversal information.
-    rule.TraversalInfo() = ti;
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+template<typename RuleType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+BreadthFirstDualTreeTraverser<RuleType>::PushPair(
+    BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>& queryNode,
+    BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>&
+        referenceNode)
+{
+  const double score = rule.Score(queryNode, referenceNode);
+  ++numScores;
+  statistics.AddScores(1);
 
-    // Now recurse down the right query node.
-    leftScore = rule.Score(*queryNode.Right(), *referenceNode.Left());
-    leftInfo = rule.TraversalInfo();
-    rule.TraversalInfo() = ti;
-    rightScore = rule.Score(*queryNode.Right(), *referenceNode.Right());
-    numScores += 2;
+  if (score != DBL_MAX)
+  {
+    Push(queryNode, referenceNode);
+  }
+  else
+  {
+    ++numPrunes;
+    statistics.AddPrunes(referenceNode);
+  }
+}
 
-    if (leftScore < rightScore)
-    {
-      // Recurse to the left.  Restore the left traversal info.  Store the right
-      // traversal info.
-      queryList.push(queryNode.Right());
-      referenceList.push(referenceNode.Left());
-      traversalInfos.push(leftInfo);
-//        Log::Debug << "Push15 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-
-      // Is it still valid to recurse to the right?
-      rightScore = rule.Rescore(*queryNode.Right(), *referenceNode.Right(),
-          rightScore);
-
-      if (rightScore != DBL_MAX)
-      {
-        // Restore the right traversal info.
-        queryList.push(queryNode.Right());
-        referenceList.push(referenceNode.Right());
-        traversalInfos.push(rule.TraversalInfo());
-//        Log::Debug << "Push16 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-      }
-      else
-        ++numPrunes;
-    }
-    else if (rightScore < leftScore)
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+template<typename RuleType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+BreadthFirstDualTreeTraverser<RuleType>::Push(
+    BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>& queryNode,
+    BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>&
+        referenceNode)
+{
+  nextFrontier.push_back(NodePair());
+  nextFrontier.back().queryNode = &queryNode;
+  nextFrontier.back().referenceNode = &referenceNode;
+  nextFrontier.back().traversalInfo = rule.TraversalInfo();
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+template<typename RuleType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+BreadthFirstDualTreeTraverser<RuleType>::EvaluateLeafPairs(
+    const size_t numThreads)
+{
+  if (leafPairs.empty())
+    return;
+
+  // Evaluate the combinations of each query leaf together, and those in order
+  // of the reference points, so that consecutive base cases use points which
+  // are close in memory.
+  std::sort(leafPairs.begin(), leafPairs.end(), PairOrder);
+
+  queryLeafStarts.clear();
+  for (size_t i = 0; i < leafPairs.size(); ++i)
+    if (i == 0 || leafPairs[i].queryNode != leafPairs[i - 1].queryNode)
+      queryLeafStarts.push_back(i);
+  const size_t queryLeaves = queryLeafStarts.size();
+  queryLeafStarts.push_back(leafPairs.size());
+
+#ifdef _OPENMP
+  const size_t threads = std::min(util::NumThreads(numThreads), queryLeaves);
+#else
+  const size_t threads = 1;
+#endif
+
+  size_t baseCases = 0;
+  if (threads <= 1)
+  {
+    for (size_t i = 0; i < leafPairs.size(); ++i)
     {
-      // Recurse to the right.
-      queryList.push(queryNode.Right());
-      referenceList.push(referenceNode.Right());
-      traversalInfos.push(rule.TraversalInfo());
-//        Log::Debug << "Push17 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-
-      // Is it still valid to recurse to the left?
-      leftScore = rule.Rescore(*queryNode.Right(), *referenceNode.Left(),
-          leftScore);
-
-      if (leftScore != DBL_MAX)
-      {
-        // Restore the left traversal info.
-        queryList.push(queryNode.Right());
-        referenceList.push(referenceNode.Left());
-        traversalInfos.push(leftInfo);
-//        Log::Debug << "Push18 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-      }
-      else
-        ++numPrunes;
+      const BinarySpaceTree& queryNode = *leafPairs[i].queryNode;
+      const BinarySpaceTree& referenceNode = *leafPairs[i].referenceNode;
+
+      rule.TraversalInfo() = leafPairs[i].traversalInfo;
+      for (size_t query = queryNode.Begin(); query < queryNode.End(); ++query)
+        for (size_t ref = referenceNode.Begin(); ref < referenceNode.End();
+            ++ref)
+          rule.BaseCase(query, ref);
+
+      baseCases += queryNode.Count() * referenceNode.Count();
     }
-    else
+  }
+  else
+  {
+    // The query leaves are handed out to the threads dynamically, so that a
+    // thread which finishes early takes over the remaining leaves.  Each
+    // thread only evaluates base cases of its own query points.
+    #pragma omp parallel num_threads(threads) reduction(+:baseCases)
     {
-      if (leftScore == DBL_MAX)
-      {
-        numPrunes += 2;
-      }
-      else
+      RuleType threadRule(rule);
+
+      #pragma omp for schedule(dynamic)
+      for (size_t leaf = 0; leaf < queryLeaves; ++leaf)
       {
-        // Choose the left first.  Restore the left traversal info.  Store the
-        // right traversal info.
-        queryList.push(queryNode.Right());
-        referenceList.push(referenceNode.Left());
-        traversalInfos.push(leftInfo);
-//        Log::Debug << "Push19 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
-
-        // Is it still valid to recurse to the right?
-        rightScore = rule.Rescore(*queryNode.Right(), *referenceNode.Right(),
-            rightScore);
-
-        if (rightScore != DBL_MAX)
+        for (size_t i = queryLeafStarts[leaf]; i < queryLeafStarts[leaf + 1];
+            ++i)
         {
-          // Restore the right traversal info.
-          queryList.push(queryNode.Right());
-          referenceList.push(referenceNode.Right());
-          traversalInfos.push(rule.TraversalInfo());
-//        Log::Debug << "Push20 " << queryList.back()->Begin() << ", " <<
-//queryList.back()->Count() << "; " << referenceList.back()->Begin() << ", "
-//    << referenceList.back()->Count() << "\n";
+          const BinarySpaceTree& queryNode = *leafPairs[i].queryNode;
+          const BinarySpaceTree& referenceNode = *leafPairs[i].referenceNode;
+
+          threadRule.TraversalInfo() = leafPairs[i].traversalInfo;
+          for (size_t query = queryNode.Begin(); query < queryNode.End();
+              ++query)
+            for (size_t ref = referenceNode.Begin(); ref < referenceNode.End();
+                ++ref)
+              threadRule.BaseCase(query, ref);
+
+          baseCases += queryNode.Count() * referenceNode.Count();
         }
-        else
-          ++numPrunes;
       }
     }
-    }
   }
+
+  numBaseCases += baseCases;
+  statistics.AddBaseCases(baseCases);
 }
 
 }; // namespace tree
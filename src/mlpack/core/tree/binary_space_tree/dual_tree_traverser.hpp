@@ -13,6 +13,7 @@
 #include <mlpack/core.hpp>
 
 #include "binary_space_tree.hpp"
+#include "../traversal_statistics.hpp"
 
 namespace mlpack {
 namespace tree {
@@ -31,6 +32,12 @@ class BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
    */
   DualTreeTraverser(RuleType& rule);
 
+  /**
+   * Add the statistics of this traversal to the process-wide total (see
+   * TraversalStatistics::Record()).
+   */
+  ~DualTreeTraverser() { TraversalStatistics::Record(statistics); }
+
   /**
    * Traverse the two trees.  This does not reset the number of prunes.
    *
@@ -61,6 +68,11 @@ class BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
   //! Modify the number of times a base case was calculated.
   size_t& NumBaseCases() { return numBaseCases; }
 
+  //! Get the statistics of the traversal.
+  const TraversalStatistics& Statistics() const { return statistics; }
+  //! Modify the statistics of the traversal.
+  TraversalStatistics& Statistics() { return statistics; }
+
  private:
   //! Reference to the rules with which the trees will be traversed.
   RuleType& rule;
@@ -68,6 +80,9 @@ class BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
   //! The number of prunes.
   size_t numPrunes;
 
+  //! The statistics of the traversal.
+  TraversalStatistics statistics;
+
   //! The number of node combinations that have been visited during traversal.
   size_t numVisited;
 
@@ -42,10 +42,15 @@ DualTreeTraverser<RuleType>::Traverse(
 {
   // Increment the visit counter.
   ++numVisited;
+  statistics.AddVisit();
 
   // Store the current traversal info.
   traversalInfo = rule.TraversalInfo();
 
+  // In trees built lazily, the nodes are split when they are first reached.
+  queryNode.Expand();
+  referenceNode.Expand();
+
   // If both are leaves, we must evaluate the base case.
   if (queryNode.IsLeaf() && referenceNode.IsLeaf())
   {
@@ -57,6 +62,7 @@ DualTreeTraverser<RuleType>::Traverse(
       // information first.
       rule.TraversalInfo() = traversalInfo;
       const double childScore = rule.Score(query, referenceNode);
+      statistics.AddScores(1);
 
       if (childScore == DBL_MAX)
         continue; // We can't improve this particular point.
@@ -65,6 +71,7 @@ DualTreeTraverser<RuleType>::Traverse(
         rule.BaseCase(query, ref);
 
       numBaseCases += referenceNode.Count();
+      statistics.AddBaseCases(referenceNode.Count());
     }
   }
   else if ((!queryNode.IsLeaf()) && referenceNode.IsLeaf())
@@ -73,21 +80,29 @@ DualTreeTraverser<RuleType>::Traverse(
     // does not matter.
     const double leftScore = rule.Score(*queryNode.Left(), referenceNode);
     ++numScores;
+    statistics.AddScores(1);
 
     if (leftScore != DBL_MAX)
       Traverse(*queryNode.Left(), referenceNode);
     else
+    {
       ++numPrunes;
+      statistics.AddPrunes(referenceNode);
+    }
 
     // Before recursing, we have to set the traversal information correctly.
     rule.TraversalInfo() = traversalInfo;
     const double rightScore = rule.Score(*queryNode.Right(), referenceNode);
     ++numScores;
+    statistics.AddScores(1);
 
     if (rightScore != DBL_MAX)
       Traverse(*queryNode.Right(), referenceNode);
     else
+    {
       ++numPrunes;
+      statistics.AddPrunes(referenceNode);
+    }
   }
   else if (queryNode.IsLeaf() && (!referenceNode.IsLeaf()))
   {
@@ -99,6 +114,7 @@ DualTreeTraverser<RuleType>::Traverse(
     rule.TraversalInfo() = traversalInfo;
     double rightScore = rule.Score(queryNode, *referenceNode.Right());
     numScores += 2;
+    statistics.AddScores(2);
 
     if (leftScore < rightScore)
     {
@@ -118,7 +134,10 @@ DualTreeTraverser<RuleType>::Traverse(
         Traverse(queryNode, *referenceNode.Right());
       }
       else
+      {
         ++numPrunes;
+        statistics.AddPrunes(*referenceNode.Right());
+      }
     }
     else if (rightScore < leftScore)
     {
@@ -135,13 +154,17 @@ DualTreeTraverser<RuleType>::Traverse(
         Traverse(queryNode, *referenceNode.Left());
       }
       else
+      {
         ++numPrunes;
+        statistics.AddPrunes(*referenceNode.Left());
+      }
     }
     else // leftScore is equal to rightScore.
     {
       if (leftScore == DBL_MAX)
       {
         numPrunes += 2;
+        statistics.AddPrunes(*referenceNode.Left(), 2);
       }
       else
       {
@@ -161,7 +184,10 @@ DualTreeTraverser<RuleType>::Traverse(
           Traverse(queryNode, *referenceNode.Right());
         }
         else
+        {
           ++numPrunes;
+          statistics.AddPrunes(*referenceNode.Right());
+        }
       }
     }
   }
@@ -177,6 +203,7 @@ DualTreeTraverser<RuleType>::Traverse(
     double rightScore = rule.Score(*queryNode.Left(), *referenceNode.Right());
     typename RuleType::TraversalInfoType rightInfo;
     numScores += 2;
+    statistics.AddScores(2);
 
     if (leftScore < rightScore)
     {
@@ -197,7 +224,10 @@ DualTreeTraverser<RuleType>::Traverse(
         Traverse(*queryNode.Left(), *referenceNode.Right());
       }
       else
+      {
         ++numPrunes;
+        statistics.AddPrunes(*referenceNode.Right());
+      }
     }
     else if (rightScore < leftScore)
     {
@@ -215,13 +245,17 @@ DualTreeTraverser<RuleType>::Traverse(
         Traverse(*queryNode.Left(), *referenceNode.Left());
       }
       else
+      {
         ++numPrunes;
+        statistics.AddPrunes(*referenceNode.Left());
+      }
     }
     else
     {
       if (leftScore == DBL_MAX)
       {
         numPrunes += 2;
+        statistics.AddPrunes(*referenceNode.Left(), 2);
       }
       else
       {
@@ -242,7 +276,10 @@ DualTreeTraverser<RuleType>::Traverse(
           Traverse(*queryNode.Left(), *referenceNode.Right());
         }
         else
+        {
           ++numPrunes;
+          statistics.AddPrunes(*referenceNode.Right());
+        }
       }
     }
 
@@ -255,6 +292,7 @@ DualTreeTraverser<RuleType>::Traverse(
     rule.TraversalInfo() = traversalInfo;
     rightScore = rule.Score(*queryNode.Right(), *referenceNode.Right());
     numScores += 2;
+    statistics.AddScores(2);
 
     if (leftScore < rightScore)
     {
@@ -275,7 +313,10 @@ DualTreeTraverser<RuleType>::Traverse(
         Traverse(*queryNode.Right(), *referenceNode.Right());
       }
       else
+      {
         ++numPrunes;
+        statistics.AddPrunes(*referenceNode.Right());
+      }
     }
     else if (rightScore < leftScore)
     {
@@ -293,13 +334,17 @@ DualTreeTraverser<RuleType>::Traverse(
         Traverse(*queryNode.Right(), *referenceNode.Left());
       }
       else
+      {
         ++numPrunes;
+        statistics.AddPrunes(*referenceNode.Left());
+      }
     }
     else
     {
       if (leftScore == DBL_MAX)
       {
         numPrunes += 2;
+        statistics.AddPrunes(*referenceNode.Left(), 2);
       }
       else
       {
@@ -320,7 +365,10 @@ DualTreeTraverser<RuleType>::Traverse(
           Traverse(*queryNode.Right(), *referenceNode.Right());
         }
         else
+        {
           ++numPrunes;
+          statistics.AddPrunes(*referenceNode.Right());
+        }
       }
     }
   }
@@ -12,6 +12,7 @@
 #include <mlpack/core.hpp>
 
 #include "binary_space_tree.hpp"
+#include "../traversal_statistics.hpp"
 
 namespace mlpack {
 namespace tree {
@@ -30,6 +31,12 @@ class BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
    */
   SingleTreeTraverser(RuleType& rule);
 
+  /**
+   * Add the statistics of this traversal to the process-wide total (see
+   * TraversalStatistics::Record()).
+   */
+  ~SingleTreeTraverser() { TraversalStatistics::Record(statistics); }
+
   /**
    * Traverse the tree with the given point.
    *
@@ -44,12 +51,20 @@ class BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
   //! Modify the number of prunes.
   size_t& NumPrunes() { return numPrunes; }
 
+  //! Get the statistics of the traversal.
+  const TraversalStatistics& Statistics() const { return statistics; }
+  //! Modify the statistics of the traversal.
+  TraversalStatistics& Statistics() { return statistics; }
+
  private:
   //! Reference to the rules with which the tree will be traversed.
   RuleType& rule;
 
   //! The number of nodes which have been pruned during traversal.
   size_t numPrunes;
+
+  //! The statistics of the traversal.
+  TraversalStatistics statistics;
 };
 
 }; // namespace tree
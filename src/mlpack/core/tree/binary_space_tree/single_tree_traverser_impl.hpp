@@ -39,17 +39,25 @@ SingleTreeTraverser<RuleType>::Traverse(
     BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>&
         referenceNode)
 {
+  statistics.AddVisit();
+
+  // In a tree built lazily, the node is split when it is first reached.
+  referenceNode.Expand();
+
   // If we are a leaf, run the base case as necessary.
   if (referenceNode.IsLeaf())
   {
     for (size_t i = referenceNode.Begin(); i < referenceNode.End(); ++i)
       rule.BaseCase(queryIndex, i);
+
+    statistics.AddBaseCases(referenceNode.Count());
   }
   else
   {
     // If either score is DBL_MAX, we do not recurse into that node.
     double leftScore = rule.Score(queryIndex, *referenceNode.Left());
     double rightScore = rule.Score(queryIndex, *referenceNode.Right());
+    statistics.AddScores(2);
 
     if (leftScore < rightScore)
     {
@@ -60,9 +68,14 @@ SingleTreeTraverser<RuleType>::Traverse(
       rightScore = rule.Rescore(queryIndex, *referenceNode.Right(), rightScore);
 
       if (rightScore != DBL_MAX)
+      {
         Traverse(queryIndex, *referenceNode.Right()); // Recurse to the right.
+      }
       else
+      {
         ++numPrunes;
+        statistics.AddPrunes(*referenceNode.Right());
+      }
     }
     else if (rightScore < leftScore)
     {
@@ -73,15 +86,21 @@ SingleTreeTraverser<RuleType>::Traverse(
       leftScore = rule.Rescore(queryIndex, *referenceNode.Left(), leftScore);
 
       if (leftScore != DBL_MAX)
+      {
         Traverse(queryIndex, *referenceNode.Left()); // Recurse to the left.
+      }
       else
+      {
         ++numPrunes;
+        statistics.AddPrunes(*referenceNode.Left());
+      }
     }
     else // leftScore is equal to rightScore.
     {
       if (leftScore == DBL_MAX)
       {
         numPrunes += 2; // Pruned both left and right.
+        statistics.AddPrunes(*referenceNode.Left(), 2);
       }
       else
       {
@@ -93,9 +112,14 @@ SingleTreeTraverser<RuleType>::Traverse(
             rightScore);
 
         if (rightScore != DBL_MAX)
+        {
           Traverse(queryIndex, *referenceNode.Right());
+        }
         else
+        {
           ++numPrunes;
+          statistics.AddPrunes(*referenceNode.Right());
+        }
       }
     }
   }
@@ -1,5 +1,5 @@
 /**
- * @file cosine_tree_impl.hpp
+ * @file cosine_tree.cpp
  * @author Siddharth Agrawal
  *
  * Implementation of cosine tree.
@@ -22,18 +22,22 @@ CosineTree::CosineTree(const arma::mat& dataset) :
   indices.resize(numColumns);
   l2NormsSquared.zeros(numColumns);
 
-  // Set indices and calculate squared norms of the columns.
-  for(size_t i = 0; i < numColumns; i++)
+  // Set indices and calculate squared norms of the columns.  They are computed
+  // once here; the other nodes take them from their parents.
+  #pragma omp parallel for if (numColumns >= ParallelColumnSize)
+  for (size_t i = 0; i < numColumns; i++)
   {
     indices[i] = i;
-    double l2Norm = arma::norm(dataset.col(i), 2);
+    double l2Norm = arma::norm(dataset.unsafe_col(i), 2);
     l2NormsSquared(i) = l2Norm * l2Norm;
   }
 
   // Frobenius norm of columns in the node.
   frobNormSquared = arma::accu(l2NormsSquared);
 
-  // Calculate centroid of columns in the node.
+  // Calculate the length-squared distribution and the centroid of columns in
+  // the node.
+  CalculateDistribution();
   CalculateCentroid();
 
   splitPointIndex = ColumnSampleLS();
@@ -61,7 +65,9 @@ CosineTree::CosineTree(CosineTree& parentNode,
   // Frobenius norm of columns in the node.
   frobNormSquared = arma::accu(l2NormsSquared);
 
-  // Calculate centroid of columns in the node.
+  // Calculate the length-squared distribution and the centroid of columns in
+  // the node.
+  CalculateDistribution();
   CalculateCentroid();
 
   splitPointIndex = ColumnSampleLS();
@@ -104,27 +110,36 @@ CosineTree::CosineTree(const arma::mat& dataset,
     currentLeft = currentNode->Left();
     currentRight = currentNode->Right();
 
+    // Gather the basis vectors of the nodes in the queue into one matrix, so
+    // the projections on them are matrix products.
+    ConstructBasis(treeQueue);
+
     // Calculate basis vectors of left and right children.
     arma::vec lBasisVector, rBasisVector;
 
-    ModifiedGramSchmidt(treeQueue, currentLeft->Centroid(), lBasisVector);
-    ModifiedGramSchmidt(treeQueue, currentRight->Centroid(), rBasisVector,
+    ModifiedGramSchmidt(basis, currentLeft->Centroid(), lBasisVector);
+    ModifiedGramSchmidt(basis, currentRight->Centroid(), rBasisVector,
                         &lBasisVector);
 
     // Add basis vectors to their respective nodes.
     currentLeft->BasisVector(lBasisVector);
     currentRight->BasisVector(rBasisVector);
 
+    // The basis now also holds the basis vectors of the children.
+    basis.resize(dataset.n_rows, basis.n_cols + 2);
+    basis.col(basis.n_cols - 2) = lBasisVector;
+    basis.col(basis.n_cols - 1) = rBasisVector;
+
     // Calculate Monte Carlo error estimates for child nodes.
-    MonteCarloError(currentLeft, treeQueue, &lBasisVector, &rBasisVector);
-    MonteCarloError(currentRight, treeQueue, &lBasisVector, &rBasisVector);
+    MonteCarloError(currentLeft, basis);
+    MonteCarloError(currentRight, basis);
 
     // Push child nodes into the priority queue.
     treeQueue.push(currentLeft);
     treeQueue.push(currentRight);
 
     // Calculate Monte Carlo error estimate for the root node.
-    monteCarloError = MonteCarloError(&root, treeQueue);
+    monteCarloError = MonteCarloError(&root, basis);
   }
 
   // Construct the subspace basis from the current priority queue.
@@ -144,22 +159,23 @@ void CosineTree::ModifiedGramSchmidt(CosineNodeQueue& treeQueue,
                                      arma::vec& newBasisVector,
                                      arma::vec* addBasisVector)
 {
-  // Set new basis vector to centroid.
-  newBasisVector = centroid;
+  // Gather the current basis and delegate.
+  arma::mat currentBasis;
+  QueueBasis(treeQueue, currentBasis);
 
-  // Variables for iterating throught the priority queue.
-  CosineTree *currentNode;
-  CosineNodeQueue::const_iterator i = treeQueue.begin();
+  ModifiedGramSchmidt(currentBasis, centroid, newBasisVector, addBasisVector);
+}
 
+void CosineTree::ModifiedGramSchmidt(const arma::mat& currentBasis,
+                                     const arma::vec& centroid,
+                                     arma::vec& newBasisVector,
+                                     const arma::vec* addBasisVector)
+{
   // For every vector in the current basis, remove its projection from the
-  // centroid.
-  for(; i != treeQueue.end(); i++)
-  {
-    currentNode = *i;
-
-    double projection = arma::dot(currentNode->BasisVector(), centroid);
-    newBasisVector -= projection * currentNode->BasisVector();
-  }
+  // centroid.  All the projections are taken with one product.
+  newBasisVector = centroid;
+  if (currentBasis.n_cols > 0)
+    newBasisVector -= currentBasis * (trans(currentBasis) * centroid);
 
   // If additional basis vector is passed, take it into account.
   if(addBasisVector)
@@ -177,6 +193,23 @@ double CosineTree::MonteCarloError(CosineTree* node,
                                    CosineNodeQueue& treeQueue,
                                    arma::vec* addBasisVector1,
                                    arma::vec* addBasisVector2)
+{
+  // Gather the current basis, with the additional vectors, and delegate.
+  arma::mat currentBasis;
+  QueueBasis(treeQueue, currentBasis);
+
+  if(addBasisVector1 && addBasisVector2)
+  {
+    currentBasis.resize(node->GetDataset().n_rows, currentBasis.n_cols + 2);
+    currentBasis.col(currentBasis.n_cols - 2) = *addBasisVector1;
+    currentBasis.col(currentBasis.n_cols - 1) = *addBasisVector2;
+  }
+
+  return MonteCarloError(node, currentBasis);
+}
+
+double CosineTree::MonteCarloError(CosineTree* node,
+                                   const arma::mat& currentBasis)
 {
   std::vector<size_t> sampledIndices;
   arma::vec probabilities;
@@ -186,55 +219,21 @@ double CosineTree::MonteCarloError(CosineTree* node,
   size_t numSamples = log(node->NumColumns()) + 1;
   node->ColumnSamplesLS(sampledIndices, probabilities, numSamples);
 
-  // Get pointer to the original dataset.
-  arma::mat dataset = node->GetDataset();
+  // Gather the sampled columns of the dataset.
+  const arma::mat& dataset = node->GetDataset();
+  arma::mat samples(dataset.n_rows, numSamples);
+  for(size_t i = 0; i < numSamples; i++)
+    samples.col(i) = dataset.unsafe_col(sampledIndices[i]);
 
-  // Initialize weighted projection magnitudes as zeros.
+  // For each sample, calculate the weighted squared norm of its projection onto
+  // the current basis.  All the projections are taken with one product.
   arma::vec weightedMagnitudes;
   weightedMagnitudes.zeros(numSamples);
-
-  // Set size of projection vector, depending on whether additional basis
-  // vectors are passed.
-  size_t projectionSize;
-  if(addBasisVector1 && addBasisVector2)
-    projectionSize = treeQueue.size() + 2;
-  else
-    projectionSize = treeQueue.size();
-
-  // For each sample, calculate the weighted projection onto the current basis.
-  for(size_t i = 0; i < numSamples; i++)
+  if (currentBasis.n_cols > 0)
   {
-    // Initialize projection as a vector of zeros.
-    arma::vec projection;
-    projection.zeros(projectionSize);
-
-    CosineTree *currentNode;
-    CosineNodeQueue::const_iterator j = treeQueue.begin();
-
-    size_t k = 0;
-    // Compute the projection of the sampled vector onto the existing subspace.
-    for(; j != treeQueue.end(); j++, k++)
-    {
-      currentNode = *j;
-
-      projection(k) = arma::dot(dataset.col(sampledIndices[i]),
-                                currentNode->BasisVector());
-    }
-    // If two additional vectors are passed, take their projections.
-    if(addBasisVector1 && addBasisVector2)
-    {
-      projection(k++) = arma::dot(dataset.col(sampledIndices[i]),
-                                  *addBasisVector1);
-      projection(k) = arma::dot(dataset.col(sampledIndices[i]),
-                                *addBasisVector2);
-    }
-
-    // Calculate the Frobenius norm squared of the projected vector.
-    double frobProjection = arma::norm(projection, "frob");
-    double frobProjectionSquared = frobProjection * frobProjection;
-
-    // Calculate the weighted projection magnitude.
-    weightedMagnitudes(i) = frobProjectionSquared / probabilities(i);
+    const arma::mat projections = trans(currentBasis) * samples;
+    weightedMagnitudes = trans(arma::sum(arma::square(projections), 0)) /
+        probabilities;
   }
 
   // Compute mean and standard deviation of the weighted samples.
@@ -259,9 +258,14 @@ double CosineTree::MonteCarloError(CosineTree* node,
 }
 
 void CosineTree::ConstructBasis(CosineNodeQueue& treeQueue)
+{
+  QueueBasis(treeQueue, basis);
+}
+
+void CosineTree::QueueBasis(CosineNodeQueue& treeQueue, arma::mat& queueBasis)
 {
   // Initialize basis as matrix of zeros.
-  basis.zeros(dataset.n_rows, treeQueue.size());
+  queueBasis.zeros(dataset.n_rows, treeQueue.size());
 
   // Variables for iterating through the priority queue.
   CosineTree *currentNode;
@@ -272,7 +276,7 @@ void CosineTree::ConstructBasis(CosineNodeQueue& treeQueue)
   for(; i != treeQueue.end(); i++, j++)
   {
     currentNode = *i;
-    basis.col(j) = currentNode->BasisVector();
+    queueBasis.col(j) = currentNode->BasisVector();
   }
 }
 
@@ -316,16 +320,6 @@ void CosineTree::ColumnSamplesLS(std::vector<size_t>& sampledIndices,
                                  arma::vec& probabilities,
                                  size_t numSamples)
 {
-  // Initialize the cumulative distribution vector size.
-  arma::vec cDistribution;
-  cDistribution.zeros(numColumns + 1);
-
-  // Calculate cumulative length-squared distribution for the node.
-  for(size_t i = 0; i < numColumns; i++)
-  {
-    cDistribution(i+1) = cDistribution(i) + l2NormsSquared(i) / frobNormSquared;
-  }
-
   // Intialize sizes of the 'sampledIndices' and 'probabilities' vectors.
   sampledIndices.resize(numSamples);
   probabilities.zeros(numSamples);
@@ -351,16 +345,6 @@ size_t CosineTree::ColumnSampleLS()
     return 0;
   }
 
-  // Initialize the cumulative distribution vector size.
-  arma::vec cDistribution;
-  cDistribution.zeros(numColumns + 1);
-
-  // Calculate cumulative length-squared distribution for the node.
-  for(size_t i = 0; i < numColumns; i++)
-  {
-    cDistribution(i+1) = cDistribution(i) + l2NormsSquared(i) / frobNormSquared;
-  }
-
   // Generate a random value for sampling.
   double randValue = arma::randu();
   size_t start = 0, end = numColumns;
@@ -402,7 +386,10 @@ void CosineTree::CalculateCosines(arma::vec& cosines)
   // Initialize cosine vector as a vector of zeros.
   cosines.zeros(numColumns);
 
-  for(size_t i = 0; i < numColumns; i++)
+  const arma::vec splitPoint = dataset.col(indices[splitPointIndex]);
+
+  #pragma omp parallel for if (numColumns >= ParallelColumnSize)
+  for (size_t i = 0; i < numColumns; i++)
   {
     // If norm is zero, store cosine value as zero. Else, calculate cosine value
     // between two vectors.
@@ -412,23 +399,55 @@ void CosineTree::CalculateCosines(arma::vec& cosines)
     }
     else
     {
-      cosines(i) = arma::norm_dot(dataset.col(indices[splitPointIndex]),
-                                  dataset.col(indices[i]));
+      cosines(i) = arma::norm_dot(splitPoint,
+                                  dataset.unsafe_col(indices[i]));
     }
   }
 }
 
 void CosineTree::CalculateCentroid()
 {
-  // Initialize centroid as vector of zeros.
-  centroid.zeros(dataset.n_rows);
+  // Each thread sums a contiguous range of the columns; the sums are then added
+  // in order, so the centroid does not depend on the scheduling.
+#ifdef _OPENMP
+  const size_t threads = (numColumns >= ParallelColumnSize) ?
+      util::NumThreads() : 1;
+#else
+  const size_t threads = 1;
+#endif
+
+  std::vector<arma::vec> threadSums(threads);
+
+  #pragma omp parallel num_threads(threads)
+  {
+#ifdef _OPENMP
+    const size_t thread = omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+
+    threadSums[thread].zeros(dataset.n_rows);
+
+    #pragma omp for schedule(static)
+    for (size_t i = 0; i < numColumns; i++)
+      threadSums[thread] += dataset.unsafe_col(indices[i]);
+  }
 
   // Calculate centroid of columns in the node.
+  centroid.zeros(dataset.n_rows);
+  for (size_t t = 0; t < threads; t++)
+    centroid += threadSums[t];
+  centroid /= numColumns;
+}
+
+void CosineTree::CalculateDistribution()
+{
+  // Calculate cumulative length-squared distribution for the node.
+  cDistribution.zeros(numColumns + 1);
   for(size_t i = 0; i < numColumns; i++)
   {
-    centroid += dataset.col(indices[i]);
+    cDistribution(i+1) = cDistribution(i) + l2NormsSquared(i) / frobNormSquared;
   }
-  centroid /= numColumns;
 }
 
 }; // namespace tree
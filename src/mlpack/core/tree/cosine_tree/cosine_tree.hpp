@@ -82,6 +82,22 @@ class CosineTree
                            arma::vec& newBasisVector,
                            arma::vec* addBasisVector = NULL);
 
+  /**
+   * Calculates the orthonormalization of the passed centroid, with respect to
+   * the subspace spanned by the (orthonormal) columns of the given matrix.  The
+   * projections on all of the basis vectors are computed with one
+   * matrix-vector product.
+   *
+   * @param currentBasis Matrix whose columns are the current basis vectors.
+   * @param centroid Centroid of the node being added to the basis.
+   * @param newBasisVector Orthonormalized centroid of the node.
+   * @param addBasisVector Address to additional basis vector.
+   */
+  void ModifiedGramSchmidt(const arma::mat& currentBasis,
+                           const arma::vec& centroid,
+                           arma::vec& newBasisVector,
+                           const arma::vec* addBasisVector = NULL);
+
   /**
    * Estimates the squared error of the projection of the input node's matrix
    * onto the current vector subspace. A normal distribution is fit using
@@ -99,6 +115,17 @@ class CosineTree
                          arma::vec* addBasisVector1 = NULL,
                          arma::vec* addBasisVector2 = NULL);
 
+  /**
+   * Estimates the squared error of the projection of the input node's matrix
+   * onto the subspace spanned by the (orthonormal) columns of the given matrix,
+   * as above.  The projections of all the samples are computed with one matrix
+   * product.
+   *
+   * @param node Node for which Monte Carlo estimate is calculated.
+   * @param currentBasis Matrix whose columns are the current basis vectors.
+   */
+  double MonteCarloError(CosineTree* node, const arma::mat& currentBasis);
+
   /**
    * Constructs the final basis matrix, after the cosine tree construction.
    *
@@ -115,8 +142,8 @@ class CosineTree
 
   /**
    * Sample 'numSamples' points from the Length-Squared distribution of the
-   * cosine node. The function uses 'l2NormsSquared' to calculate the cumulative
-   * probability distribution of the column vectors. The sampling is based on a
+   * cosine node. The function uses the cumulative probability distribution of
+   * the column vectors, which is calculated once when the node is created. The sampling is based on a
    * randomly generated values in the range [0, 1].
    */
   void ColumnSamplesLS(std::vector<size_t>& sampledIndices,
@@ -124,8 +151,8 @@ class CosineTree
 
   /**
    * Sample a point from the Length-Squared distribution of the cosine node. The
-   * function uses 'l2NormsSquared' to calculate the cumulative probability
-   * distribution of the column vectors. The sampling is based on a randomly
+   * function uses the cumulative probability distribution of the column
+   * vectors, which is calculated once when the node is created. The sampling is based on a randomly
    * generated value in the range [0, 1].
    */
   size_t ColumnSampleLS();
@@ -157,9 +184,17 @@ class CosineTree
   /**
    * Calculate centroid of the columns present in the node. The calculated
    * centroid is used as a basis vector for the cosine tree being constructed.
+   * For large nodes, the columns are summed in parallel.
    */
   void CalculateCentroid();
 
+  /**
+   * Calculate the cumulative Length-Squared distribution of the columns present
+   * in the node, from 'l2NormsSquared'.  It is used for every sample drawn from
+   * the node.
+   */
+  void CalculateDistribution();
+
   //! Returns the basis of the constructed subspace.
   void GetFinalBasis(arma::mat& finalBasis) { finalBasis = basis; }
 
@@ -200,6 +235,18 @@ class CosineTree
   size_t SplitPointIndex() const { return indices[splitPointIndex]; }
 
  private:
+  //! The number of columns from which the work on a node is done in parallel.
+  static const size_t ParallelColumnSize = 10000;
+
+  /**
+   * Gather the basis vectors of the nodes in the queue as the columns of a
+   * matrix.
+   *
+   * @param treeQueue Priority queue of cosine nodes.
+   * @param queueBasis Matrix to store the basis vectors in.
+   */
+  void QueueBasis(CosineNodeQueue& treeQueue, arma::mat& queueBasis);
+
   //! Matrix for which cosine tree is constructed.
   const arma::mat& dataset;
   //! Error tolerance fraction for calculated subspace.
@@ -218,6 +265,8 @@ class CosineTree
   std::vector<size_t> indices;
   //! L2-norm squared of columns in the node.
   arma::vec l2NormsSquared;
+  //! Cumulative Length-Squared distribution of columns in the node.
+  arma::vec cDistribution;
   //! Centroid of columns of input matrix in the node.
   arma::vec centroid;
   //! Orthonormalized basis vector of the node.
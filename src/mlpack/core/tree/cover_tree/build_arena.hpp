@@ -0,0 +1,109 @@
+/**
+ * @file build_arena.hpp
+ *
+ * Scratch memory used while building a cover tree, so the index and distance
+ * vectors of the near and far sets are not allocated anew for every child.
+ */
+#ifndef __MLPACK_CORE_TREE_COVER_TREE_BUILD_ARENA_HPP
+#define __MLPACK_CORE_TREE_COVER_TREE_BUILD_ARENA_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace tree {
+
+/**
+ * The scratch memory for building a cover tree.  When a node creates its
+ * children, it needs one set of index and distance vectors for the child it is
+ * currently building; the children are built one after another, and the
+ * recursion below each child uses vectors one level deeper.  So, the arena
+ * keeps one pair of vectors for each level of the recursion, handed out in
+ * stack order with Acquire() and Release(), and each pair is reused (and only
+ * grown, never shrunk) by every node built at that level.
+ *
+ * The vectors may be larger than requested; the tree building code always
+ * passes the sizes of the sets it uses explicitly.
+ */
+class CoverTreeBuildArena
+{
+ public:
+  //! Create an empty arena.
+  CoverTreeBuildArena() : depth(0) { }
+
+  //! Free all of the vectors.
+  ~CoverTreeBuildArena()
+  {
+    for (size_t i = 0; i < indexVectors.size(); ++i)
+    {
+      delete indexVectors[i];
+      delete distanceVectors[i];
+    }
+  }
+
+  /**
+   * Get the vectors for the next level of the recursion, with at least the
+   * given number of elements.  They stay valid until the matching Release().
+   *
+   * @param size Minimum number of elements of the vectors.
+   * @param indices Set to the index vector.
+   * @param distances Set to the distance vector.
+   */
+  void Acquire(const size_t size,
+               arma::Col<size_t>*& indices,
+               arma::vec*& distances)
+  {
+    // The vectors are held by pointer, so that adding a level does not move
+    // the vectors of the levels that are in use.
+    if (depth == indexVectors.size())
+    {
+      indexVectors.push_back(new arma::Col<size_t>());
+      distanceVectors.push_back(new arma::vec());
+    }
+
+    if (indexVectors[depth]->n_elem < size)
+    {
+      indexVectors[depth]->set_size(size);
+      distanceVectors[depth]->set_size(size);
+    }
+
+    indices = indexVectors[depth];
+    distances = distanceVectors[depth];
+    ++depth;
+  }
+
+  //! Give back the vectors of the deepest level in use.
+  void Release() { --depth; }
+
+  //! Get a buffer of at least the given number of indices (for reordering).
+  size_t* IndexBuffer(const size_t size)
+  {
+    if (indexBuffer.size() < size)
+      indexBuffer.resize(size);
+    return &indexBuffer[0];
+  }
+
+  //! Get a buffer of at least the given number of distances (for reordering).
+  double* DistanceBuffer(const size_t size)
+  {
+    if (distanceBuffer.size() < size)
+      distanceBuffer.resize(size);
+    return &distanceBuffer[0];
+  }
+
+ private:
+  //! The number of levels in use.
+  size_t depth;
+  //! The index vector of each level.
+  std::vector<arma::Col<size_t>*> indexVectors;
+  //! The distance vector of each level.
+  std::vector<arma::vec*> distanceVectors;
+  //! A buffer for reordering indices.
+  std::vector<size_t> indexBuffer;
+  //! A buffer for reordering distances.
+  std::vector<double> distanceBuffer;
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
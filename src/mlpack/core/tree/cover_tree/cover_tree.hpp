@@ -10,6 +10,7 @@
 #include <mlpack/core.hpp>
 #include <mlpack/core/metrics/lmetric.hpp>
 #include "first_point_is_root.hpp"
+#include "build_arena.hpp"
 #include "../statistic.hpp"
 
 namespace mlpack {
@@ -42,6 +43,17 @@ namespace tree {
  * -- non-leaf nodes with more than one child.  A leaf node has no children, and
  * its scale level is INT_MIN.
  *
+ * So this is a compressed cover tree: the scale of each child is found from
+ * the distances to the points it covers, and a child may be many scales below
+ * its parent; the chain of implicit nodes in between is never built (or is
+ * removed as soon as it is, by RemoveNewImplicitNodes()).  Every non-leaf node
+ * has at least two children, and each point has exactly one leaf, so the tree
+ * has fewer than two nodes for each point.  The traversers keep the nodes to
+ * visit in maps keyed by scale, so the skipped scales cost nothing.  The only
+ * repeated points are the self-children of the explicit nodes, which the
+ * rules use to reuse the base case of their parent (see
+ * TreeTraits::HasSelfChildren).
+ *
  * For more information on cover trees, see
  *
  * @code
@@ -147,6 +159,9 @@ class CoverTree
    * @param farSetSize Size of the far set; may be modified (if this node uses
    *     any points in the far set).
    * @param usedSetSize The number of points used will be added to this number.
+   * @param metric Instantiated metric to use during tree building.
+   * @param arena Scratch memory shared by the whole tree building procedure;
+   *     if NULL, this node uses its own.
    */
   CoverTree(const arma::mat& dataset,
             const double base,
@@ -159,7 +174,8 @@ class CoverTree
             size_t nearSetSize,
             size_t& farSetSize,
             size_t& usedSetSize,
-            MetricType& metric = NULL);
+            MetricType& metric = NULL,
+            CoverTreeBuildArena* arena = NULL);
 
   /**
    * Manually construct a cover tree node; no tree assembly is done in this
@@ -330,6 +346,10 @@ class CoverTree
   //! Get the instantiated metric.
   MetricType& Metric() const { return *metric; }
 
+  //! Distances to at least this many points are computed in parallel during
+  //! tree building (when OpenMP is available).
+  static const size_t ParallelDistanceSize = 1024;
+
  private:
   //! Reference to the matrix which this tree is built on.
   const arma::mat& dataset;
@@ -368,13 +388,14 @@ class CoverTree
   MetricType* metric;
 
   /**
-   * Create the children for this node.
+   * Create the children for this node, using the given scratch memory.
    */
   void CreateChildren(arma::Col<size_t>& indices,
                       arma::vec& distances,
                       size_t nearSetSize,
                       size_t& farSetSize,
-                      size_t& usedSetSize);
+                      size_t& usedSetSize,
+                      CoverTreeBuildArena& arena);
 
   /**
    * Fill the vector of distances with the distances between the point specified
@@ -428,12 +449,14 @@ class CoverTree
    * @param childFarSetSize Number of points in child far set (childFarSet).
    * @param childUsedSetSize Number of points in child used set (childUsedSet).
    * @param farSetSize Number of points in far set (farSet).
+   * @param arena Scratch memory to use as a buffer.
    */
   size_t SortPointSet(arma::Col<size_t>& indices,
                       arma::vec& distances,
                       const size_t childFarSetSize,
                       const size_t childUsedSetSize,
-                      const size_t farSetSize);
+                      const size_t farSetSize,
+                      CoverTreeBuildArena& arena);
 
   void MoveToUsedSet(arma::Col<size_t>& indices,
                      arma::vec& distances,
@@ -55,11 +55,13 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
   // Build the initial distances.
   ComputeDistances(point, indices, distances, dataset.n_cols - 1);
 
-  // Create the children.
+  // Create the children.  All of the nodes share one arena for their near and
+  // far sets.
   size_t farSetSize = 0;
   size_t usedSetSize = 0;
+  CoverTreeBuildArena arena;
   CreateChildren(indices, distances, dataset.n_cols - 1, farSetSize,
-      usedSetSize);
+      usedSetSize, arena);
 
   // If we ended up creating only one child, remove the implicit node.
   while (children.size() == 1)
@@ -132,11 +134,13 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
   // Build the initial distances.
   ComputeDistances(point, indices, distances, dataset.n_cols - 1);
 
-  // Create the children.
+  // Create the children.  All of the nodes share one arena for their near and
+  // far sets.
   size_t farSetSize = 0;
   size_t usedSetSize = 0;
+  CoverTreeBuildArena arena;
   CreateChildren(indices, distances, dataset.n_cols - 1, farSetSize,
-      usedSetSize);
+      usedSetSize, arena);
 
   // If we ended up creating only one child, remove the implicit node.
   while (children.size() == 1)
@@ -188,7 +192,8 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
     size_t nearSetSize,
     size_t& farSetSize,
     size_t& usedSetSize,
-    MetricType& metric) :
+    MetricType& metric,
+    CoverTreeBuildArena* arena) :
     dataset(dataset),
     point(pointIndex),
     scale(scale),
@@ -211,7 +216,17 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
   }
 
   // Otherwise, create the children.
-  CreateChildren(indices, distances, nearSetSize, farSetSize, usedSetSize);
+  if (arena)
+  {
+    CreateChildren(indices, distances, nearSetSize, farSetSize, usedSetSize,
+        *arena);
+  }
+  else
+  {
+    CoverTreeBuildArena localArena;
+    CreateChildren(indices, distances, nearSetSize, farSetSize, usedSetSize,
+        localArena);
+  }
 
   // Initialize statistic.
   stat = StatisticType(*this);
@@ -453,7 +468,8 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
     arma::vec& distances,
     size_t nearSetSize,
     size_t& farSetSize,
-    size_t& usedSetSize)
+    size_t& usedSetSize,
+    CoverTreeBuildArena& arena)
 {
   // Determine the next scale level.  This should be the first level where there
   // are any points in the far set.  So, if we know the maximum distance in the
@@ -471,7 +487,7 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
     // This should not modify farSetSize or usedSetSize.
     size_t tempSize = 0;
     children.push_back(new CoverTree(dataset, base, point, INT_MIN, this, 0,
-        indices, distances, 0, tempSize, usedSetSize, *metric));
+        indices, distances, 0, tempSize, usedSetSize, *metric, &arena));
     distanceComps += children.back()->DistanceComps();
 
     // Every point in the near set should be a leaf.
@@ -480,7 +496,7 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
       // farSetSize and usedSetSize will not be modified.
       children.push_back(new CoverTree(dataset, base, indices[i],
           INT_MIN, this, distances[i], indices, distances, 0, tempSize,
-          usedSetSize, *metric));
+          usedSetSize, *metric, &arena));
       distanceComps += children.back()->DistanceComps();
       usedSetSize++;
     }
@@ -493,7 +509,7 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
     // [ used | far | other used ]
     // and we want
     // [ far | all used ].
-    SortPointSet(indices, distances, 0, usedSetSize, farSetSize);
+    SortPointSet(indices, distances, 0, usedSetSize, farSetSize, arena);
 
     return;
   }
@@ -512,7 +528,7 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
   size_t childUsedSetSize = 0;
   children.push_back(new CoverTree(dataset, base, point, nextScale, this, 0,
       indices, distances, childNearSetSize, childFarSetSize, childUsedSetSize,
-      *metric));
+      *metric, &arena));
   // Don't double-count the self-child (so, subtract one).
   numDescendants += children[0]->NumDescendants();
 
@@ -533,7 +549,7 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
   // [ near | far | childUsed + used ]
   // is what we are trying to make.
   SortPointSet(indices, distances, childFarSetSize, childUsedSetSize,
-      farSetSize);
+      farSetSize, arena);
 
   // Update size of near set and used set.
   nearSetSize -= childUsedSetSize;
@@ -543,6 +559,16 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
   // computation later, we'll create an array holding the points in the near
   // set, and then after each run we'll check which of those (if any) were used
   // and we will remove them.  ...if that's faster.  I think it is.
+  //
+  // The near and far sets of each child are built in the same vectors from the
+  // arena; they can only shrink from one child to the next, so we get them
+  // once, with room for the largest.
+  arma::Col<size_t>* childIndicesPtr;
+  arma::vec* childDistancesPtr;
+  arena.Acquire(nearSetSize + farSetSize, childIndicesPtr, childDistancesPtr);
+  arma::Col<size_t>& childIndices = *childIndicesPtr;
+  arma::vec& childDistances = *childDistancesPtr;
+
   while (nearSetSize > 0)
   {
     size_t newPointIndex = nearSetSize - 1;
@@ -570,7 +596,7 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
       size_t childNearSetSize = 0;
       children.push_back(new CoverTree(dataset, base, indices[0], nextScale,
           this, distances[0], indices, distances, childNearSetSize, farSetSize,
-          usedSetSize, *metric));
+          usedSetSize, *metric, &arena));
       distanceComps += children.back()->DistanceComps();
       numDescendants += children.back()->NumDescendants();
 
@@ -583,12 +609,10 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
       break;
     }
 
-    // Create the near and far set indices and distance vectors.  We don't fill
-    // in the self-point, yet.
-    arma::Col<size_t> childIndices(nearSetSize + farSetSize);
+    // Fill the near and far set indices for the child.  We don't fill in the
+    // self-point, yet.
     childIndices.rows(0, (nearSetSize + farSetSize - 2)) = indices.rows(1,
         nearSetSize + farSetSize - 1);
-    arma::vec childDistances(nearSetSize + farSetSize);
 
     // Build distances for the child.
     ComputeDistances(indices[0], childIndices, childDistances, nearSetSize
@@ -612,7 +636,7 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
     childUsedSetSize = 1; // Mark self point as used.
     children.push_back(new CoverTree(dataset, base, indices[0], nextScale,
         this, distances[0], childIndices, childDistances, childNearSetSize,
-        childFarSetSize, childUsedSetSize, *metric));
+        childFarSetSize, childUsedSetSize, *metric, &arena));
     numDescendants += children.back()->NumDescendants();
 
     // Remove any implicit nodes.
@@ -629,6 +653,8 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
         childIndices, childFarSetSize, childUsedSetSize);
   }
 
+  arena.Release();
+
   // Calculate furthest descendant.
   for (size_t i = (nearSetSize + farSetSize); i < (nearSetSize + farSetSize +
       usedSetSize); ++i)
@@ -697,8 +723,11 @@ void CoverTree<MetricType, RootPointPolicy, StatisticType>::ComputeDistances(
     const size_t pointSetSize)
 {
   // For each point, rebuild the distances.  The indices do not need to be
-  // modified.
+  // modified.  In high dimensions this is most of the work of building the
+  // tree, so large point sets are split between threads; each distance only
+  // depends on its own point, so the tree is the same either way.
   distanceComps += pointSetSize;
+  #pragma omp parallel for if (pointSetSize >= ParallelDistanceSize)
   for (size_t i = 0; i < pointSetSize; ++i)
   {
     distances[i] = metric->Evaluate(dataset.unsafe_col(pointIndex),
@@ -712,7 +741,8 @@ size_t CoverTree<MetricType, RootPointPolicy, StatisticType>::SortPointSet(
     arma::vec& distances,
     const size_t childFarSetSize,
     const size_t childUsedSetSize,
-    const size_t farSetSize)
+    const size_t farSetSize,
+    CoverTreeBuildArena& arena)
 {
   // We'll use low-level memcpy calls ourselves, just to ensure it's done
   // quickly and the way we want it to be.  Unfortunately this takes up more
@@ -725,8 +755,9 @@ size_t CoverTree<MetricType, RootPointPolicy, StatisticType>::SortPointSet(
   if (bufferSize == 0)
     return (childFarSetSize + farSetSize);
 
-  size_t* indicesBuffer = new size_t[bufferSize];
-  double* distancesBuffer = new double[bufferSize];
+  // The buffers belong to the arena, so they are reused by every node.
+  size_t* indicesBuffer = arena.IndexBuffer(bufferSize);
+  double* distancesBuffer = arena.DistanceBuffer(bufferSize);
 
   // The start of the memory region to copy to the buffer.
   const size_t bufferFromLocation = ((bufferSize == farSetSize) ?
@@ -759,9 +790,6 @@ size_t CoverTree<MetricType, RootPointPolicy, StatisticType>::SortPointSet(
   memcpy(distances.memptr() + bufferToLocation, distancesBuffer,
       sizeof(double) * bufferSize);
 
-  delete[] indicesBuffer;
-  delete[] distancesBuffer;
-
   // This returns the complete size of the far set.
   return (childFarSetSize + farSetSize);
 }
@@ -10,6 +10,8 @@
 #include <mlpack/core.hpp>
 #include <queue>
 
+#include "../traversal_statistics.hpp"
+
 namespace mlpack {
 namespace tree {
 
@@ -23,6 +25,12 @@ class CoverTree<MetricType, RootPointPolicy, StatisticType>::DualTreeTraverser
    */
   DualTreeTraverser(RuleType& rule);
 
+  /**
+   * Add the statistics of this traversal to the process-wide total (see
+   * TraversalStatistics::Record()).
+   */
+  ~DualTreeTraverser() { TraversalStatistics::Record(statistics); }
+
   /**
    * Traverse the two specified trees.
    *
@@ -31,6 +39,30 @@ class CoverTree<MetricType, RootPointPolicy, StatisticType>::DualTreeTraverser
    */
   void Traverse(CoverTree& queryNode, CoverTree& referenceNode);
 
+  /**
+   * Traverse the two specified trees with the given number of threads (if
+   * OpenMP is available; 0 means the OpenMP default).  The top of the query
+   * tree is traversed as usual; once the query nodes are small enough, each
+   * query subtree, with the reference nodes that are left for it, becomes a
+   * task, and the tasks are traversed in parallel.  The subtrees are disjoint,
+   * so they hold disjoint sets of query points.
+   *
+   * Each task uses its own copy of the rule.  So, RuleType must be copyable,
+   * copies of the rule must be safe to use at the same time as long as they
+   * handle different query points (the metric they share must be safe to call
+   * from several threads), and the rule must have modifiable BaseCases() and
+   * Scores() counters, which are added back into the original rule.  The rules
+   * of mlpack's dual-tree algorithms for nearest neighbor search satisfy
+   * these.
+   *
+   * @param queryNode Root of query tree.
+   * @param referenceNode Root of reference tree.
+   * @param numThreads Number of threads to use.
+   */
+  void Traverse(CoverTree& queryNode,
+                CoverTree& referenceNode,
+                const size_t numThreads);
+
   //! Get the number of pruned nodes.
   size_t NumPrunes() const { return numPrunes; }
   //! Modify the number of pruned nodes.
@@ -42,6 +74,11 @@ class CoverTree<MetricType, RootPointPolicy, StatisticType>::DualTreeTraverser
   size_t NumScores() const { return 0; }
   size_t NumBaseCases() const { return 0; }
 
+  //! Get the statistics of the traversal.
+  const TraversalStatistics& Statistics() const { return statistics; }
+  //! Modify the statistics of the traversal.
+  TraversalStatistics& Statistics() { return statistics; }
+
  private:
   //! The instantiated rule set for pruning branches.
   RuleType& rule;
@@ -49,6 +86,9 @@ class CoverTree<MetricType, RootPointPolicy, StatisticType>::DualTreeTraverser
   //! The number of pruned nodes.
   size_t numPrunes;
 
+  //! The statistics of the traversal.
+  TraversalStatistics statistics;
+
   //! Struct used for traversal.
   struct DualCoverTreeMapEntry
   {
@@ -71,6 +111,15 @@ class CoverTree<MetricType, RootPointPolicy, StatisticType>::DualTreeTraverser
     }
   };
 
+  //! A part of a parallel traversal: a query node and its reference map.
+  struct DualCoverTreeTask
+  {
+    //! The query node.
+    CoverTree* queryNode;
+    //! The reference nodes that are left for the query node.
+    std::map<int, std::vector<DualCoverTreeMapEntry> > referenceMap;
+  };
+
   /**
    * Helper function for traversal of the two trees.
    */
@@ -88,6 +137,17 @@ class CoverTree<MetricType, RootPointPolicy, StatisticType>::DualTreeTraverser
   void ReferenceRecursion(CoverTree& queryNode,
                           std::map<int, std::vector<DualCoverTreeMapEntry> >&
                               referenceMap);
+
+  /**
+   * Traverse as Traverse() does, but stop at query nodes with no more than
+   * grain descendants (or query leaves), and add them to the list of tasks
+   * instead of traversing them.
+   */
+  void GatherTasks(CoverTree& queryNode,
+                   std::map<int, std::vector<DualCoverTreeMapEntry> >&
+                       referenceMap,
+                   const size_t grain,
+                   std::vector<DualCoverTreeTask>& tasks);
 };
 
 }; // namespace tree
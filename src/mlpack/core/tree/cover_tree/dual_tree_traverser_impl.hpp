@@ -40,12 +40,93 @@ DualTreeTraverser<RuleType>::Traverse(
   rootRefEntry.baseCase = rule.BaseCase(queryNode.Point(),
       referenceNode.Point());
   rootRefEntry.traversalInfo = rule.TraversalInfo();
+  statistics.AddScores(1);
+  statistics.AddBaseCases(1);
 
   refMap[referenceNode.Scale()].push_back(rootRefEntry);
 
   Traverse(queryNode, refMap);
 }
 
+template<typename MetricType, typename RootPointPolicy, typename StatisticType>
+template<typename RuleType>
+void CoverTree<MetricType, RootPointPolicy, StatisticType>::
+DualTreeTraverser<RuleType>::Traverse(
+    CoverTree<MetricType, RootPointPolicy, StatisticType>& queryNode,
+    CoverTree<MetricType, RootPointPolicy, StatisticType>& referenceNode,
+    const size_t numThreads)
+{
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads(numThreads);
+#else
+  const size_t threads = 1;
+#endif
+
+  if (threads == 1)
+  {
+    Traverse(queryNode, referenceNode);
+    return;
+  }
+
+  // Start the same way as the serial traversal.
+  std::map<int, std::vector<DualCoverTreeMapEntry> > refMap;
+
+  DualCoverTreeMapEntry rootRefEntry;
+
+  rootRefEntry.referenceNode = &referenceNode;
+  rootRefEntry.score = rule.Score(queryNode, referenceNode);
+  rootRefEntry.baseCase = rule.BaseCase(queryNode.Point(),
+      referenceNode.Point());
+  rootRefEntry.traversalInfo = rule.TraversalInfo();
+  statistics.AddScores(1);
+  statistics.AddBaseCases(1);
+
+  refMap[referenceNode.Scale()].push_back(rootRefEntry);
+
+  // Traverse the top of the query tree with this rule, collecting the tasks.
+  // We ask for many more tasks than threads, so that the load is balanced when
+  // some tasks are much more expensive than others.
+  const size_t grain = std::max(queryNode.NumDescendants() / (16 * threads),
+      (size_t) 1);
+  std::vector<DualCoverTreeTask> tasks;
+  GatherTasks(queryNode, refMap, grain, tasks);
+
+  Log::Info << "Traversing " << tasks.size() << " query subtrees with "
+      << threads << " threads.\n";
+
+  size_t totalScores = 0;
+  size_t totalBaseCases = 0;
+  size_t totalPrunes = 0;
+  #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+      reduction(+:totalScores, totalBaseCases, totalPrunes)
+  for (size_t i = 0; i < tasks.size(); ++i)
+  {
+    RuleType threadRule(rule);
+    threadRule.BaseCases() = 0;
+    threadRule.Scores() = 0;
+
+    DualTreeTraverser<RuleType> traverser(threadRule);
+    traverser.Traverse(*tasks[i].queryNode, tasks[i].referenceMap);
+
+    totalScores += threadRule.Scores();
+    totalBaseCases += threadRule.BaseCases();
+    totalPrunes += traverser.NumPrunes();
+
+    // Move the statistics of the task into this traverser, so that they are
+    // recorded only once.
+    if (TraversalStatistics::Enabled)
+    {
+      #pragma omp critical(mlpack_cover_tree_traversal_statistics)
+      statistics.Merge(traverser.Statistics());
+      traverser.Statistics().Reset();
+    }
+  }
+
+  rule.Scores() += totalScores;
+  rule.BaseCases() += totalBaseCases;
+  numPrunes += totalPrunes;
+}
+
 template<typename MetricType, typename RootPointPolicy, typename StatisticType>
 template<typename RuleType>
 void CoverTree<MetricType, RootPointPolicy, StatisticType>::
@@ -56,6 +137,8 @@ DualTreeTraverser<RuleType>::Traverse(
   if (referenceMap.size() == 0)
     return; // Nothing to do!
 
+  statistics.AddVisit();
+
   // First recurse down the reference nodes as necessary.
   ReferenceRecursion(queryNode, referenceMap);
 
@@ -109,6 +192,7 @@ DualTreeTraverser<RuleType>::Traverse(
         (queryNode.Point() == queryNode.Parent()->Point()))
     {
       ++numPrunes;
+      statistics.AddPrunes(*refNode);
       continue;
     }
 
@@ -116,15 +200,59 @@ DualTreeTraverser<RuleType>::Traverse(
     // info.
     rule.TraversalInfo() = frame.traversalInfo;
     double score = rule.Score(queryNode, *refNode);
+    statistics.AddScores(1);
 
     if (score == DBL_MAX)
     {
       ++numPrunes;
+      statistics.AddPrunes(*refNode);
       continue;
     }
 
     // If not, compute the base case.
     rule.BaseCase(queryNode.Point(), pointVector[i].referenceNode->Point());
+    statistics.AddBaseCases(1);
+  }
+}
+
+template<typename MetricType, typename RootPointPolicy, typename StatisticType>
+template<typename RuleType>
+void CoverTree<MetricType, RootPointPolicy, StatisticType>::
+DualTreeTraverser<RuleType>::GatherTasks(
+    CoverTree<MetricType, RootPointPolicy, StatisticType>& queryNode,
+    std::map<int, std::vector<DualCoverTreeMapEntry> >& referenceMap,
+    const size_t grain,
+    std::vector<DualCoverTreeTask>& tasks)
+{
+  if (referenceMap.size() == 0)
+    return; // Nothing to do!
+
+  // A small enough query subtree is traversed as a whole by one thread.
+  if ((queryNode.NumDescendants() <= grain) || (queryNode.Scale() == INT_MIN))
+  {
+    tasks.push_back(DualCoverTreeTask());
+    tasks.back().queryNode = &queryNode;
+    tasks.back().referenceMap.swap(referenceMap);
+    return;
+  }
+
+  // Otherwise, do what Traverse() does for a node that is not a leaf.
+  ReferenceRecursion(queryNode, referenceMap);
+
+  if (referenceMap.size() == 0)
+    return; // Nothing to do!
+
+  if (queryNode.Scale() >= (*referenceMap.rbegin()).first)
+  {
+    for (size_t i = 1; i < queryNode.NumChildren(); ++i)
+    {
+      std::map<int, std::vector<DualCoverTreeMapEntry> > childMap;
+      PruneMap(queryNode.Child(i), referenceMap, childMap);
+      GatherTasks(queryNode.Child(i), childMap, grain, tasks);
+    }
+    std::map<int, std::vector<DualCoverTreeMapEntry> > selfChildMap;
+    PruneMap(queryNode.Child(0), referenceMap, selfChildMap);
+    GatherTasks(queryNode.Child(0), selfChildMap, grain, tasks);
   }
 }
 
@@ -165,17 +293,20 @@ DualTreeTraverser<RuleType>::PruneMap(
       // Perform the actual scoring, after restoring the traversal info.
       rule.TraversalInfo() = frame.traversalInfo;
       double score = rule.Score(queryNode, *refNode);
+      statistics.AddScores(1);
 
       if (score == DBL_MAX)
       {
         // Pruned.  Move on.
         ++numPrunes;
+        statistics.AddPrunes(*refNode);
         continue;
       }
 
       // If it isn't pruned, we must evaluate the base case.
       const double baseCase = rule.BaseCase(queryNode.Point(),
           refNode->Point());
+      statistics.AddBaseCases(1);
 
       // Add to child map.
       newScaleVector.push_back(frame);
@@ -219,17 +350,20 @@ DualTreeTraverser<RuleType>::PruneMap(
       // Perform the actual scoring, after restoring the traversal info.
       rule.TraversalInfo() = frame.traversalInfo;
       double score = rule.Score(queryNode, *refNode);
+      statistics.AddScores(1);
 
       if (score == DBL_MAX)
       {
         // Pruned.  Move on.
         ++numPrunes;
+        statistics.AddPrunes(*refNode);
         continue;
       }
 
       // If it isn't pruned, we must evaluate the base case.
       const double baseCase = rule.BaseCase(queryNode.Point(),
           refNode->Point());
+      statistics.AddBaseCases(1);
 
       // Add to child map.
       newScaleVector.push_back(frame);
@@ -293,6 +427,7 @@ DualTreeTraverser<RuleType>::ReferenceRecursion(
       if (score == DBL_MAX)
       {
         ++numPrunes;
+        statistics.AddPrunes(*refNode);
         continue;
       }
 
@@ -303,15 +438,18 @@ DualTreeTraverser<RuleType>::ReferenceRecursion(
       {
         rule.TraversalInfo() = frame.traversalInfo;
         double childScore = rule.Score(queryNode, refNode->Child(j));
+        statistics.AddScores(1);
         if (childScore == DBL_MAX)
         {
           ++numPrunes;
+          statistics.AddPrunes(refNode->Child(j));
           continue;
         }
 
         // It wasn't pruned; evaluate the base case.
         const double baseCase = rule.BaseCase(queryNode.Point(),
             refNode->Child(j).Point());
+        statistics.AddBaseCases(1);
 
         DualCoverTreeMapEntry newFrame;
         newFrame.referenceNode = &refNode->Child(j);
@@ -12,6 +12,7 @@
 #include <mlpack/core.hpp>
 
 #include "cover_tree.hpp"
+#include "../traversal_statistics.hpp"
 
 namespace mlpack {
 namespace tree {
@@ -26,6 +27,12 @@ class CoverTree<MetricType, RootPointPolicy, StatisticType>::SingleTreeTraverser
    */
   SingleTreeTraverser(RuleType& rule);
 
+  /**
+   * Add the statistics of this traversal to the process-wide total (see
+   * TraversalStatistics::Record()).
+   */
+  ~SingleTreeTraverser() { TraversalStatistics::Record(statistics); }
+
   /**
    * Traverse the tree with the given point.
    *
@@ -40,12 +47,20 @@ class CoverTree<MetricType, RootPointPolicy, StatisticType>::SingleTreeTraverser
   //! Set the number of prunes (good for a reset to 0).
   size_t& NumPrunes() { return numPrunes; }
 
+  //! Get the statistics of the traversal.
+  const TraversalStatistics& Statistics() const { return statistics; }
+  //! Modify the statistics of the traversal.
+  TraversalStatistics& Statistics() { return statistics; }
+
  private:
   //! Reference to the rules with which the tree will be traversed.
   RuleType& rule;
 
   //! The number of nodes which have been pruned during traversal.
   size_t numPrunes;
+
+  //! The statistics of the traversal.
+  TraversalStatistics statistics;
 };
 
 }; // namespace tree
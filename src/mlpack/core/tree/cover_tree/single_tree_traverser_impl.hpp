@@ -66,10 +66,13 @@ SingleTreeTraverser<RuleType>::Traverse(
 
   // Create the score for the children.
   double rootChildScore = rule.Score(queryIndex, referenceNode);
+  statistics.AddVisit();
+  statistics.AddScores(1);
 
   if (rootChildScore == DBL_MAX)
   {
     numPrunes += referenceNode.NumChildren();
+    statistics.AddPrunes(referenceNode.Child(0), referenceNode.NumChildren());
   }
   else
   {
@@ -78,12 +81,14 @@ SingleTreeTraverser<RuleType>::Traverse(
     // using TreeTraits::FirstPointIsCentroid; this is an optimization that
     // (theoretically) the compiler should get right.
     double rootBaseCase = rule.BaseCase(queryIndex, referenceNode.Point());
+    statistics.AddBaseCases(1);
 
     // Don't add the self-leaf.
     size_t i = 0;
     if (referenceNode.Child(0).NumChildren() == 0)
     {
       ++numPrunes;
+      statistics.AddPrunes(referenceNode.Child(0));
       i = 1;
     }
 
@@ -131,17 +136,21 @@ SingleTreeTraverser<RuleType>::Traverse(
       if (rule.Rescore(queryIndex, *node, score) == DBL_MAX)
       {
         ++numPrunes;
+        statistics.AddPrunes(*node);
         continue;
       }
 
       // Create the score for the children.
       const double childScore = rule.Score(queryIndex, *node);
+      statistics.AddVisit();
+      statistics.AddScores(1);
 
       // Now if this childScore is DBL_MAX we can prune all children.  In this
       // recursion setup pruning is all or nothing for children.
       if (childScore == DBL_MAX)
       {
         numPrunes += node->NumChildren();
+        statistics.AddPrunes(node->Child(0), node->NumChildren());
         continue;
       }
 
@@ -150,13 +159,17 @@ SingleTreeTraverser<RuleType>::Traverse(
       // trees using TreeTraits::FirstPointIsCentroid; this is an optimization
       // that (theoretically) the compiler should get right.
       if (point != parent)
+      {
         baseCase = rule.BaseCase(queryIndex, point);
+        statistics.AddBaseCases(1);
+      }
 
       // Don't add the self-leaf.
       size_t j = 0;
       if (node->Child(0).NumChildren() == 0)
       {
         ++numPrunes;
+        statistics.AddPrunes(node->Child(0));
         j = 1;
       }
 
@@ -191,6 +204,7 @@ SingleTreeTraverser<RuleType>::Traverse(
     if (rescore == DBL_MAX)
     {
       ++numPrunes;
+      statistics.AddPrunes(*node);
       continue;
     }
 
@@ -198,10 +212,13 @@ SingleTreeTraverser<RuleType>::Traverse(
     // combination, even if pruning it will make no difference.  It's the
     // definition.
     const double actualScore = rule.Score(queryIndex, *node);
+    statistics.AddVisit();
+    statistics.AddScores(1);
 
     if (actualScore == DBL_MAX)
     {
       ++numPrunes;
+      statistics.AddPrunes(*node);
       continue;
     }
     else
@@ -211,6 +228,7 @@ SingleTreeTraverser<RuleType>::Traverse(
       // trees using TreeTraits::FirstPointIsCentroid; this is an optimization
       // that (theoretically) the compiler should get right.
       rule.BaseCase(queryIndex, point);
+      statistics.AddBaseCases(1);
     }
   }
 }
@@ -0,0 +1,64 @@
+/**
+ * @file gather_subtrees.hpp
+ *
+ * Split the top levels of a tree into disjoint subtrees, so that a dual-tree
+ * traversal can be run on each of them in parallel.
+ */
+#ifndef __MLPACK_CORE_TREE_GATHER_SUBTREES_HPP
+#define __MLPACK_CORE_TREE_GATHER_SUBTREES_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace mlpack {
+namespace tree {
+
+/**
+ * Split the top levels of the query tree into at least minSubtrees disjoint
+ * subtrees (if possible), so that each can be traversed independently.  Only
+ * nodes which hold no points themselves are expanded, so the points held by
+ * the returned subtrees are exactly the points held by the tree.  For trees
+ * where every node holds points (like the cover tree), only the root will be
+ * returned.
+ *
+ * @param root Root of the tree to split.
+ * @param minSubtrees Number of subtrees to split the tree into, if possible.
+ * @param subtrees Vector to store the subtrees in.
+ */
+template<typename TreeType>
+void GatherQuerySubtrees(TreeType& root,
+                         const size_t minSubtrees,
+                         std::vector<TreeType*>& subtrees)
+{
+  subtrees.clear();
+  subtrees.push_back(&root);
+
+  while (subtrees.size() < minSubtrees)
+  {
+    std::vector<TreeType*> nextLevel;
+    bool expanded = false;
+    for (size_t i = 0; i < subtrees.size(); ++i)
+    {
+      if (subtrees[i]->NumChildren() > 0 && subtrees[i]->NumPoints() == 0)
+      {
+        for (size_t j = 0; j < subtrees[i]->NumChildren(); ++j)
+          nextLevel.push_back(&subtrees[i]->Child(j));
+        expanded = true;
+      }
+      else
+      {
+        nextLevel.push_back(subtrees[i]);
+      }
+    }
+
+    if (!expanded)
+      break; // We can't split the tree any further.
+
+    subtrees.swap(nextLevel);
+  }
+}
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
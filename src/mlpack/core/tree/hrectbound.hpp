@@ -21,11 +21,22 @@ namespace bound {
  * with the LMetric class.  Be sure to use the same template parameters for
  * LMetric as you do for HRectBound -- otherwise odd results may occur.
  *
+ * If the dimensionality of the data is known at compile time (for instance,
+ * 2 or 3 for geographic data or point clouds), it can be given as the
+ * Dimensionality template parameter: then the loops over the dimensions in the
+ * distance calculations have a constant trip count, and are unrolled by the
+ * compiler, and expanding the bound to include points needs no temporary
+ * vectors.  A tree using the bound, such as
+ * BinarySpaceTree<HRectBound<2, true, 3>, StatisticType>, can then only be
+ * built on data with that many dimensions.
+ *
  * @tparam Power The metric to use; use 2 for Euclidean (L2).
  * @tparam TakeRoot Whether or not the root should be taken (see LMetric
  *     documentation).
+ * @tparam Dimensionality Fixed dimensionality of the bound, or 0 for a bound of
+ *     any dimensionality.
  */
-template<int Power = 2, bool TakeRoot = true>
+template<int Power = 2, bool TakeRoot = true, size_t Dimensionality = 0>
 class HRectBound
 {
  public:
@@ -33,7 +44,8 @@ class HRectBound
   typedef metric::LMetric<Power, TakeRoot> MetricType;
 
   /**
-   * Empty constructor; creates a bound of dimensionality 0.
+   * Empty constructor; creates a bound of dimensionality 0 (or of the fixed
+   * dimensionality, if it is given).
    */
   HRectBound();
 
@@ -43,6 +55,16 @@ class HRectBound
    */
   HRectBound(const size_t dimension);
 
+  /**
+   * Initializes to specified dimensionality with each dimension the empty
+   * set, storing the ranges in the given memory (which must hold at least
+   * dimension ranges) instead of allocating it, as with UseMemory().
+   *
+   * @param dimension Dimensionality of the bound.
+   * @param memory Memory to store the ranges in.
+   */
+  HRectBound(const size_t dimension, math::Range* memory);
+
   //! Copy constructor; necessary to prevent memory leaks.
   HRectBound(const HRectBound& other);
   //! Same as copy constructor; necessary to prevent memory leaks.
@@ -57,8 +79,8 @@ class HRectBound
    */
   void Clear();
 
-  //! Gets the dimensionality.
-  size_t Dim() const { return dim; }
+  //! Gets the dimensionality (a compile-time constant, if it is fixed).
+  size_t Dim() const { return (Dimensionality != 0) ? Dimensionality : dim; }
 
   //! Get the range for a particular dimension.  No bounds checking.  Be
   //! careful: this may make MinWidth() invalid.
@@ -66,6 +88,17 @@ class HRectBound
   //! Modify the range for a particular dimension.  No bounds checking.
   const math::Range& operator[](const size_t i) const { return bounds[i]; }
 
+  /**
+   * Store the ranges of the bound in the given memory, which must have room for
+   * Dim() ranges, instead of in memory owned by the bound.  The current ranges
+   * are copied there.  The memory must not be freed while the bound uses it.
+   * This is used to lay out the bounds of all of the nodes of a tree in one
+   * contiguous block.
+   *
+   * @param memory Memory to store the ranges in.
+   */
+  void UseMemory(math::Range* memory);
+
   //! Get the minimum width of the bound.
   double MinWidth() const { return minWidth; }
   //! Modify the minimum width of the bound.
@@ -101,6 +134,20 @@ class HRectBound
    */
   double MinDistance(const HRectBound& other) const;
 
+  /**
+   * Calculates the minimum distances to several bounds at once (usually the
+   * children of a node, which are scored together).  This is faster than
+   * calling MinDistance() for each bound, because each range of this bound is
+   * only read once.
+   *
+   * @param others The bounds to which the minimum distances are requested.
+   * @param count The number of bounds.
+   * @param distances Array of count elements to store the distances in.
+   */
+  void MinDistance(const HRectBound* const* others,
+                   const size_t count,
+                   double* distances) const;
+
   /**
    * Calculates maximum bound-to-point squared distance.
    *
@@ -117,6 +164,18 @@ class HRectBound
    */
   double MaxDistance(const HRectBound& other) const;
 
+  /**
+   * Calculates the maximum distances to several bounds at once; see the
+   * MinDistance() overload for several bounds.
+   *
+   * @param others The bounds to which the maximum distances are requested.
+   * @param count The number of bounds.
+   * @param distances Array of count elements to store the distances in.
+   */
+  void MaxDistance(const HRectBound* const* others,
+                   const size_t count,
+                   double* distances) const;
+
   /**
    * Calculates minimum and maximum bound-to-bound distance.
    *
@@ -162,6 +221,22 @@ class HRectBound
    */
   double Diameter() const;
 
+  /**
+   * Write the bound to the given stream in a binary format, so that it can be
+   * read back with Load().
+   *
+   * @param stream Stream to write the bound to.
+   */
+  void Save(std::ostream& stream) const;
+
+  /**
+   * Read a bound written with Save() from the given stream.  The bound must
+   * already have the same dimensionality as the saved bound.
+   *
+   * @param stream Stream to read the bound from.
+   */
+  void Load(std::istream& stream);
+
   /**
    * Returns a string representation of this object.
    */
@@ -175,12 +250,18 @@ class HRectBound
   static MetricType Metric() { return metric::LMetric<Power, TakeRoot>(); }
 
  private:
+  //! Fail if the bound has fixed dimensionality, and it is not the given one.
+  static void CheckDimensionality(const size_t dimension);
+
   //! The dimensionality of the bound.
   size_t dim;
   //! The bounds for each dimension.
   math::Range* bounds;
   //! Cached minimum width of bound.
   double minWidth;
+  //! Whether or not the bound owns the memory of the ranges (this is true
+  //! unless UseMemory() was called).
+  bool ownsBounds;
 };
 
 }; // namespace bound
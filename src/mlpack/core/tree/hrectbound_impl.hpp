@@ -10,42 +10,147 @@
 #define __MLPACK_CORE_TREE_HRECTBOUND_IMPL_HPP
 
 #include <math.h>
+#include <new>
 
 // In case it has not been included yet.
 #include "hrectbound.hpp"
 
 namespace mlpack {
 namespace bound {
+namespace aux {
 
 /**
- * Empty constructor.
+ * The per-dimension power and the final root of the distances of an LMetric
+ * with the given power.  The general case uses pow(); the common powers are
+ * specialized so that the distance loops have no calls and no branches, and
+ * can be vectorized by the compiler.
  */
-template<int Power, bool TakeRoot>
-inline HRectBound<Power, TakeRoot>::HRectBound() :
-    dim(0),
-    bounds(NULL),
-    minWidth(0)
+template<int Power>
+struct LPower
+{
+  //! Raise the nonnegative value to the power.
+  static double Pow(const double x) { return pow(x, (double) Power); }
+  //! Take the root of a sum of powers.
+  static double Root(const double sum)
+  {
+    return pow(sum, 1.0 / (double) Power);
+  }
+};
+
+template<>
+struct LPower<1>
+{
+  static double Pow(const double x) { return x; }
+  static double Root(const double sum) { return sum; }
+};
+
+template<>
+struct LPower<2>
+{
+  static double Pow(const double x) { return x * x; }
+  static double Root(const double sum) { return sqrt(sum); }
+};
+
+/**
+ * Find the smallest and largest value in each dimension of the points, for a
+ * bound of fixed dimensionality; the extremes are kept in arrays of the fixed
+ * size, so no temporary vectors are allocated and the loop over the dimensions
+ * is unrolled.  Bounds of any dimensionality (0) use Armadillo instead, in
+ * HRectBound::operator|=().
+ */
+template<size_t Dimensionality>
+struct FixedExtremes
+{
+  template<typename MatType>
+  static void Expand(math::Range* bounds, const MatType& data)
+  {
+    if (data.n_cols == 0)
+      return;
+
+    double lo[Dimensionality];
+    double hi[Dimensionality];
+    for (size_t d = 0; d < Dimensionality; ++d)
+      lo[d] = hi[d] = data(d, 0);
+
+    for (size_t i = 1; i < data.n_cols; ++i)
+    {
+      for (size_t d = 0; d < Dimensionality; ++d)
+      {
+        const double x = data(d, i);
+        lo[d] = std::min(lo[d], x);
+        hi[d] = std::max(hi[d], x);
+      }
+    }
+
+    for (size_t d = 0; d < Dimensionality; ++d)
+      bounds[d] |= math::Range(lo[d], hi[d]);
+  }
+};
+
+template<>
+struct FixedExtremes<0>
+{
+  template<typename MatType>
+  static void Expand(math::Range* /* bounds */, const MatType& /* data */) { }
+};
+
+}; // namespace aux
+
+/**
+ * Empty constructor.  A bound of fixed dimensionality always has its ranges.
+ */
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline HRectBound<Power, TakeRoot, Dimensionality>::HRectBound() :
+    dim(Dimensionality),
+    bounds((Dimensionality != 0) ? new math::Range[Dimensionality] : NULL),
+    minWidth(0),
+    ownsBounds(true)
 { /* Nothing to do. */ }
 
 /**
  * Initializes to specified dimensionality with each dimension the empty
  * set.
  */
-template<int Power, bool TakeRoot>
-inline HRectBound<Power, TakeRoot>::HRectBound(const size_t dimension) :
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline HRectBound<Power, TakeRoot, Dimensionality>::HRectBound(
+    const size_t dimension) :
     dim(dimension),
     bounds(new math::Range[dim]),
-    minWidth(0)
-{ /* Nothing to do. */ }
+    minWidth(0),
+    ownsBounds(true)
+{
+  CheckDimensionality(dimension);
+}
+
+/**
+ * Initializes to specified dimensionality with each dimension the empty set,
+ * with the ranges in the given memory.
+ */
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline HRectBound<Power, TakeRoot, Dimensionality>::HRectBound(
+    const size_t dimension,
+    math::Range* memory) :
+    dim(dimension),
+    bounds(memory),
+    minWidth(0),
+    ownsBounds(false)
+{
+  CheckDimensionality(dimension);
+
+  for (size_t i = 0; i < dim; i++)
+    new (bounds + i) math::Range();
+}
 
 /***
  * Copy constructor necessary to prevent memory leaks.
  */
-template<int Power, bool TakeRoot>
-inline HRectBound<Power, TakeRoot>::HRectBound(const HRectBound& other) :
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline HRectBound<Power, TakeRoot, Dimensionality>::HRectBound(
+    const HRectBound& other) :
     dim(other.Dim()),
     bounds(new math::Range[dim]),
-    minWidth(other.MinWidth())
+    minWidth(other.MinWidth()),
+    ownsBounds(true)
 {
   // Copy other bounds over.
   for (size_t i = 0; i < dim; i++)
@@ -55,18 +160,19 @@ inline HRectBound<Power, TakeRoot>::HRectBound(const HRectBound& other) :
 /***
  * Same as the copy constructor.
  */
-template<int Power, bool TakeRoot>
-inline HRectBound<Power, TakeRoot>& HRectBound<Power, TakeRoot>::operator=(
-    const HRectBound& other)
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline HRectBound<Power, TakeRoot, Dimensionality>&
+HRectBound<Power, TakeRoot, Dimensionality>::operator=(const HRectBound& other)
 {
   if (dim != other.Dim())
   {
     // Reallocation is necessary.
-    if (bounds)
+    if (bounds && ownsBounds)
       delete[] bounds;
 
     dim = other.Dim();
     bounds = new math::Range[dim];
+    ownsBounds = true;
   }
 
   // Now copy each of the bound values.
@@ -81,20 +187,53 @@ inline HRectBound<Power, TakeRoot>& HRectBound<Power, TakeRoot>::operator=(
 /**
  * Destructor: clean up memory.
  */
-template<int Power, bool TakeRoot>
-inline HRectBound<Power, TakeRoot>::~HRectBound()
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline HRectBound<Power, TakeRoot, Dimensionality>::~HRectBound()
+{
+  if (bounds && ownsBounds)
+    delete[] bounds;
+}
+
+/**
+ * Make sure that a bound of fixed dimensionality is not created with a
+ * different dimensionality.
+ */
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline void HRectBound<Power, TakeRoot, Dimensionality>::CheckDimensionality(
+    const size_t dimension)
+{
+  if (Dimensionality != 0 && dimension != Dimensionality)
+  {
+    Log::Fatal << "HRectBound: cannot create a bound of dimensionality "
+        << dimension << " with fixed dimensionality " << Dimensionality << "!"
+        << std::endl;
+  }
+}
+
+/**
+ * Move the ranges to the given memory.
+ */
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline void HRectBound<Power, TakeRoot, Dimensionality>::UseMemory(
+    math::Range* memory)
 {
-  if (bounds)
+  for (size_t i = 0; i < Dim(); i++)
+    memory[i] = bounds[i];
+
+  if (bounds && ownsBounds)
     delete[] bounds;
+
+  bounds = memory;
+  ownsBounds = false;
 }
 
 /**
  * Resets all dimensions to the empty set.
  */
-template<int Power, bool TakeRoot>
-inline void HRectBound<Power, TakeRoot>::Clear()
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline void HRectBound<Power, TakeRoot, Dimensionality>::Clear()
 {
-  for (size_t i = 0; i < dim; i++)
+  for (size_t i = 0; i < Dim(); i++)
     bounds[i] = math::Range();
   minWidth = 0;
 }
@@ -104,14 +243,15 @@ inline void HRectBound<Power, TakeRoot>::Clear()
  *
  * @param centroid Vector which the centroid will be written to.
  */
-template<int Power, bool TakeRoot>
-inline void HRectBound<Power, TakeRoot>::Centroid(arma::vec& centroid) const
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline void HRectBound<Power, TakeRoot, Dimensionality>::Centroid(
+    arma::vec& centroid) const
 {
   // Set size correctly if necessary.
   if (!(centroid.n_elem == dim))
     centroid.set_size(dim);
 
-  for (size_t i = 0; i < dim; i++)
+  for (size_t i = 0; i < Dim(); i++)
     centroid(i) = bounds[i].Mid();
 }
 
@@ -120,11 +260,11 @@ inline void HRectBound<Power, TakeRoot>::Centroid(arma::vec& centroid) const
  *
  * @return Volume of the hyperrectangle.
  */
-template<int Power, bool TakeRoot>
-inline double HRectBound<Power, TakeRoot>::Volume() const
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline double HRectBound<Power, TakeRoot, Dimensionality>::Volume() const
 {
   double volume = 1.0;
-  for (size_t i = 0; i < dim; ++i)
+  for (size_t i = 0; i < Dim(); ++i)
     volume *= (bounds[i].Hi() - bounds[i].Lo());
 
   return volume;
@@ -133,78 +273,100 @@ inline double HRectBound<Power, TakeRoot>::Volume() const
 /**
  * Calculates minimum bound-to-point squared distance.
  */
-template<int Power, bool TakeRoot>
+template<int Power, bool TakeRoot, size_t Dimensionality>
 template<typename VecType>
-inline double HRectBound<Power, TakeRoot>::MinDistance(
+inline double HRectBound<Power, TakeRoot, Dimensionality>::MinDistance(
     const VecType& point,
     typename boost::enable_if<IsVector<VecType> >* /* junk */) const
 {
   Log::Assert(point.n_elem == dim);
 
   double sum = 0;
-
-  double lower, higher;
-  for (size_t d = 0; d < dim; d++)
+  for (size_t d = 0; d < Dim(); d++)
   {
-    lower = bounds[d].Lo() - point[d];
-    higher = point[d] - bounds[d].Hi();
-
-    // Since only one of 'lower' or 'higher' is negative, if we add each's
-    // absolute value to itself and then sum those two, our result is the
-    // nonnegative half of the equation times two; then we raise to power Power.
-    sum += pow((lower + fabs(lower)) + (higher + fabs(higher)), (double) Power);
+    // At most one of these is positive (the point is below or above the
+    // range), and that one is the distance in this dimension.
+    const double lower = bounds[d].Lo() - point[d];
+    const double higher = point[d] - bounds[d].Hi();
+    sum += aux::LPower<Power>::Pow(std::max(lower, 0.0) +
+        std::max(higher, 0.0));
   }
 
-  // Now take the Power'th root (but make sure our result is squared if it needs
-  // to be); then cancel out the constant of 2 (which may have been squared now)
-  // that was introduced earlier.  The compiler should optimize out the if
-  // statement entirely.
+  // The compiler should optimize out this if statement entirely.
   if (TakeRoot)
-    return pow(sum, 1.0 / (double) Power) / 2.0;
+    return aux::LPower<Power>::Root(sum);
   else
-    return sum / pow(2.0, Power);
+    return sum;
 }
 
 /**
  * Calculates minimum bound-to-bound squared distance.
  */
-template<int Power, bool TakeRoot>
-double HRectBound<Power, TakeRoot>::MinDistance(const HRectBound& other) const
+template<int Power, bool TakeRoot, size_t Dimensionality>
+double HRectBound<Power, TakeRoot, Dimensionality>::MinDistance(
+    const HRectBound& other) const
 {
   Log::Assert(dim == other.dim);
 
   double sum = 0;
-  const math::Range* mbound = bounds;
-  const math::Range* obound = other.bounds;
-
-  double lower, higher;
-  for (size_t d = 0; d < dim; d++)
+  for (size_t d = 0; d < Dim(); d++)
   {
-    lower = obound->Lo() - mbound->Hi();
-    higher = mbound->Lo() - obound->Hi();
-    // We invoke the following:
-    //   x + fabs(x) = max(x * 2, 0)
-    //   (x * 2)^2 / 4 = x^2
-    sum += pow((lower + fabs(lower)) + (higher + fabs(higher)), (double) Power);
-
-    // Move bound pointers.
-    mbound++;
-    obound++;
+    // At most one of these is positive (the ranges don't overlap), and that
+    // one is the gap between the ranges.
+    const double lower = other.bounds[d].Lo() - bounds[d].Hi();
+    const double higher = bounds[d].Lo() - other.bounds[d].Hi();
+    sum += aux::LPower<Power>::Pow(std::max(lower, 0.0) +
+        std::max(higher, 0.0));
   }
 
   // The compiler should optimize out this if statement entirely.
   if (TakeRoot)
-    return pow(sum, 1.0 / (double) Power) / 2.0;
+    return aux::LPower<Power>::Root(sum);
   else
-    return sum / pow(2.0, Power);
+    return sum;
+}
+
+/**
+ * Calculates the minimum distances to several bounds at once.
+ */
+template<int Power, bool TakeRoot, size_t Dimensionality>
+void HRectBound<Power, TakeRoot, Dimensionality>::MinDistance(
+    const HRectBound* const* others,
+    const size_t count,
+    double* distances) const
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    Log::Assert(dim == others[i]->dim);
+    distances[i] = 0;
+  }
+
+  // Each range of this bound is read once for all of the other bounds.
+  for (size_t d = 0; d < Dim(); d++)
+  {
+    const double lo = bounds[d].Lo();
+    const double hi = bounds[d].Hi();
+    for (size_t i = 0; i < count; ++i)
+    {
+      const double lower = others[i]->bounds[d].Lo() - hi;
+      const double higher = lo - others[i]->bounds[d].Hi();
+      distances[i] += aux::LPower<Power>::Pow(std::max(lower, 0.0) +
+          std::max(higher, 0.0));
+    }
+  }
+
+  // The compiler should optimize out this if statement entirely.
+  if (TakeRoot)
+    for (size_t i = 0; i < count; ++i)
+      distances[i] = aux::LPower<Power>::Root(distances[i]);
 }
 
 /**
  * Calculates maximum bound-to-point squared distance.
  */
-template<int Power, bool TakeRoot>
+template<int Power, bool TakeRoot, size_t Dimensionality>
 template<typename VecType>
-inline double HRectBound<Power, TakeRoot>::MaxDistance(
+inline double HRectBound<Power, TakeRoot, Dimensionality>::MaxDistance(
     const VecType& point,
     typename boost::enable_if<IsVector<VecType> >* /* junk */) const
 {
@@ -212,16 +374,16 @@ inline double HRectBound<Power, TakeRoot>::MaxDistance(
 
   Log::Assert(point.n_elem == dim);
 
-  for (size_t d = 0; d < dim; d++)
+  for (size_t d = 0; d < Dim(); d++)
   {
-    double v = std::max(fabs(point[d] - bounds[d].Lo()),
+    const double v = std::max(fabs(point[d] - bounds[d].Lo()),
         fabs(bounds[d].Hi() - point[d]));
-    sum += pow(v, (double) Power);
+    sum += aux::LPower<Power>::Pow(v);
   }
 
   // The compiler should optimize out this if statement entirely.
   if (TakeRoot)
-    return pow(sum, 1.0 / (double) Power);
+    return aux::LPower<Power>::Root(sum);
   else
     return sum;
 }
@@ -229,34 +391,67 @@ inline double HRectBound<Power, TakeRoot>::MaxDistance(
 /**
  * Computes maximum distance.
  */
-template<int Power, bool TakeRoot>
-inline double HRectBound<Power, TakeRoot>::MaxDistance(const HRectBound& other)
-    const
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline double HRectBound<Power, TakeRoot, Dimensionality>::MaxDistance(
+    const HRectBound& other) const
 {
   double sum = 0;
 
   Log::Assert(dim == other.dim);
 
-  double v;
-  for (size_t d = 0; d < dim; d++)
+  for (size_t d = 0; d < Dim(); d++)
   {
-    v = std::max(fabs(other.bounds[d].Hi() - bounds[d].Lo()),
+    const double v = std::max(fabs(other.bounds[d].Hi() - bounds[d].Lo()),
         fabs(bounds[d].Hi() - other.bounds[d].Lo()));
-    sum += pow(v, (double) Power); // v is non-negative.
+    sum += aux::LPower<Power>::Pow(v); // v is non-negative.
   }
 
   // The compiler should optimize out this if statement entirely.
   if (TakeRoot)
-    return pow(sum, 1.0 / (double) Power);
+    return aux::LPower<Power>::Root(sum);
   else
     return sum;
 }
 
+/**
+ * Calculates the maximum distances to several bounds at once.
+ */
+template<int Power, bool TakeRoot, size_t Dimensionality>
+void HRectBound<Power, TakeRoot, Dimensionality>::MaxDistance(
+    const HRectBound* const* others,
+    const size_t count,
+    double* distances) const
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    Log::Assert(dim == others[i]->dim);
+    distances[i] = 0;
+  }
+
+  // Each range of this bound is read once for all of the other bounds.
+  for (size_t d = 0; d < Dim(); d++)
+  {
+    const double lo = bounds[d].Lo();
+    const double hi = bounds[d].Hi();
+    for (size_t i = 0; i < count; ++i)
+    {
+      const double v = std::max(fabs(others[i]->bounds[d].Hi() - lo),
+          fabs(hi - others[i]->bounds[d].Lo()));
+      distances[i] += aux::LPower<Power>::Pow(v);
+    }
+  }
+
+  // The compiler should optimize out this if statement entirely.
+  if (TakeRoot)
+    for (size_t i = 0; i < count; ++i)
+      distances[i] = aux::LPower<Power>::Root(distances[i]);
+}
+
 /**
  * Calculates minimum and maximum bound-to-bound squared distance.
  */
-template<int Power, bool TakeRoot>
-inline math::Range HRectBound<Power, TakeRoot>::RangeDistance(
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline math::Range HRectBound<Power, TakeRoot, Dimensionality>::RangeDistance(
     const HRectBound& other) const
 {
   double loSum = 0;
@@ -264,30 +459,21 @@ inline math::Range HRectBound<Power, TakeRoot>::RangeDistance(
 
   Log::Assert(dim == other.dim);
 
-  double v1, v2, vLo, vHi;
-  for (size_t d = 0; d < dim; d++)
+  for (size_t d = 0; d < Dim(); d++)
   {
-    v1 = other.bounds[d].Lo() - bounds[d].Hi();
-    v2 = bounds[d].Lo() - other.bounds[d].Hi();
-    // One of v1 or v2 is negative.
-    if (v1 >= v2)
-    {
-      vHi = -v2; // Make it nonnegative.
-      vLo = (v1 > 0) ? v1 : 0; // Force to be 0 if negative.
-    }
-    else
-    {
-      vHi = -v1; // Make it nonnegative.
-      vLo = (v2 > 0) ? v2 : 0; // Force to be 0 if negative.
-    }
-
-    loSum += pow(vLo, (double) Power);
-    hiSum += pow(vHi, (double) Power);
+    // One of v1 or v2 is negative; the larger one, if it is positive, is the
+    // gap between the ranges, and the other one is the negated distance
+    // between their far ends.
+    const double v1 = other.bounds[d].Lo() - bounds[d].Hi();
+    const double v2 = bounds[d].Lo() - other.bounds[d].Hi();
+
+    loSum += aux::LPower<Power>::Pow(std::max(std::max(v1, v2), 0.0));
+    hiSum += aux::LPower<Power>::Pow(-std::min(v1, v2));
   }
 
   if (TakeRoot)
-    return math::Range(pow(loSum, 1.0 / (double) Power),
-                       pow(hiSum, 1.0 / (double) Power));
+    return math::Range(aux::LPower<Power>::Root(loSum),
+                       aux::LPower<Power>::Root(hiSum));
   else
     return math::Range(loSum, hiSum);
 }
@@ -295,9 +481,9 @@ inline math::Range HRectBound<Power, TakeRoot>::RangeDistance(
 /**
  * Calculates minimum and maximum bound-to-point squared distance.
  */
-template<int Power, bool TakeRoot>
+template<int Power, bool TakeRoot, size_t Dimensionality>
 template<typename VecType>
-inline math::Range HRectBound<Power, TakeRoot>::RangeDistance(
+inline math::Range HRectBound<Power, TakeRoot, Dimensionality>::RangeDistance(
     const VecType& point,
     typename boost::enable_if<IsVector<VecType> >* /* junk */) const
 {
@@ -306,38 +492,21 @@ inline math::Range HRectBound<Power, TakeRoot>::RangeDistance(
 
   Log::Assert(point.n_elem == dim);
 
-  double v1, v2, vLo, vHi;
-  for (size_t d = 0; d < dim; d++)
+  for (size_t d = 0; d < Dim(); d++)
   {
-    v1 = bounds[d].Lo() - point[d]; // Negative if point[d] > lo.
-    v2 = point[d] - bounds[d].Hi(); // Negative if point[d] < hi.
-    // One of v1 or v2 (or both) is negative.
-    if (v1 >= 0) // point[d] <= bounds_[d].Lo().
-    {
-      vHi = -v2; // v2 will be larger but must be negated.
-      vLo = v1;
-    }
-    else // point[d] is between lo and hi, or greater than hi.
-    {
-      if (v2 >= 0)
-      {
-        vHi = -v1; // v1 will be larger, but must be negated.
-        vLo = v2;
-      }
-      else
-      {
-        vHi = -std::min(v1, v2); // Both are negative, but we need the larger.
-        vLo = 0;
-      }
-    }
-
-    loSum += pow(vLo, (double) Power);
-    hiSum += pow(vHi, (double) Power);
+    // One of v1 or v2 (or both) is negative.  The larger one, if it is
+    // positive, is the distance to the range; the smaller one is the negated
+    // distance to the far end of the range.
+    const double v1 = bounds[d].Lo() - point[d]; // Negative if point[d] > lo.
+    const double v2 = point[d] - bounds[d].Hi(); // Negative if point[d] < hi.
+
+    loSum += aux::LPower<Power>::Pow(std::max(std::max(v1, v2), 0.0));
+    hiSum += aux::LPower<Power>::Pow(-std::min(v1, v2));
   }
 
   if (TakeRoot)
-    return math::Range(pow(loSum, 1.0 / (double) Power),
-                       pow(hiSum, 1.0 / (double) Power));
+    return math::Range(aux::LPower<Power>::Root(loSum),
+                       aux::LPower<Power>::Root(hiSum));
   else
     return math::Range(loSum, hiSum);
 }
@@ -345,20 +514,31 @@ inline math::Range HRectBound<Power, TakeRoot>::RangeDistance(
 /**
  * Expands this region to include a new point.
  */
-template<int Power, bool TakeRoot>
+template<int Power, bool TakeRoot, size_t Dimensionality>
 template<typename MatType>
-inline HRectBound<Power, TakeRoot>& HRectBound<Power, TakeRoot>::operator|=(
-    const MatType& data)
+inline HRectBound<Power, TakeRoot, Dimensionality>&
+HRectBound<Power, TakeRoot, Dimensionality>::operator|=(const MatType& data)
 {
   Log::Assert(data.n_rows == dim);
 
-  arma::vec mins(min(data, 1));
-  arma::vec maxs(max(data, 1));
+  // The data may not be double-precision; the ranges are, and every float is
+  // exactly representable as a double.
+  if (Dimensionality != 0)
+  {
+    aux::FixedExtremes<Dimensionality>::Expand(bounds, data);
+  }
+  else
+  {
+    typedef typename MatType::elem_type ElemType;
+    arma::Col<ElemType> mins(min(data, 1));
+    arma::Col<ElemType> maxs(max(data, 1));
+    for (size_t i = 0; i < dim; i++)
+      bounds[i] |= math::Range(mins[i], maxs[i]);
+  }
 
   minWidth = DBL_MAX;
-  for (size_t i = 0; i < dim; i++)
+  for (size_t i = 0; i < Dim(); i++)
   {
-    bounds[i] |= math::Range(mins[i], maxs[i]);
     const double width = bounds[i].Width();
     if (width < minWidth)
       minWidth = width;
@@ -370,14 +550,14 @@ inline HRectBound<Power, TakeRoot>& HRectBound<Power, TakeRoot>::operator|=(
 /**
  * Expands this region to encompass another bound.
  */
-template<int Power, bool TakeRoot>
-inline HRectBound<Power, TakeRoot>& HRectBound<Power, TakeRoot>::operator|=(
-    const HRectBound& other)
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline HRectBound<Power, TakeRoot, Dimensionality>&
+HRectBound<Power, TakeRoot, Dimensionality>::operator|=(const HRectBound& other)
 {
   assert(other.dim == dim);
 
   minWidth = DBL_MAX;
-  for (size_t i = 0; i < dim; i++)
+  for (size_t i = 0; i < Dim(); i++)
   {
     bounds[i] |= other.bounds[i];
     const double width = bounds[i].Width();
@@ -391,9 +571,10 @@ inline HRectBound<Power, TakeRoot>& HRectBound<Power, TakeRoot>::operator|=(
 /**
  * Determines if a point is within this bound.
  */
-template<int Power, bool TakeRoot>
+template<int Power, bool TakeRoot, size_t Dimensionality>
 template<typename VecType>
-inline bool HRectBound<Power, TakeRoot>::Contains(const VecType& point) const
+inline bool HRectBound<Power, TakeRoot, Dimensionality>::Contains(
+    const VecType& point) const
 {
   for (size_t i = 0; i < point.n_elem; i++)
   {
@@ -407,24 +588,57 @@ inline bool HRectBound<Power, TakeRoot>::Contains(const VecType& point) const
 /**
  * Returns the diameter of the hyperrectangle (that is, the longest diagonal).
  */
-template<int Power, bool TakeRoot>
-inline double HRectBound<Power, TakeRoot>::Diameter() const
+template<int Power, bool TakeRoot, size_t Dimensionality>
+inline double HRectBound<Power, TakeRoot, Dimensionality>::Diameter() const
 {
   double d = 0;
-  for (size_t i = 0; i < dim; ++i)
-    d += std::pow(bounds[i].Hi() - bounds[i].Lo(), (double) Power);
+  for (size_t i = 0; i < Dim(); ++i)
+    d += aux::LPower<Power>::Pow(bounds[i].Hi() - bounds[i].Lo());
 
   if (TakeRoot)
-    return std::pow(d, 1.0 / (double) Power);
+    return aux::LPower<Power>::Root(d);
   else
     return d;
 }
 
+/**
+ * Write the bound to the given stream.
+ */
+template<int Power, bool TakeRoot, size_t Dimensionality>
+void HRectBound<Power, TakeRoot, Dimensionality>::Save(
+    std::ostream& stream) const
+{
+  for (size_t i = 0; i < Dim(); ++i)
+  {
+    const double lo = bounds[i].Lo();
+    const double hi = bounds[i].Hi();
+    stream.write((const char*) &lo, sizeof(double));
+    stream.write((const char*) &hi, sizeof(double));
+  }
+  stream.write((const char*) &minWidth, sizeof(double));
+}
+
+/**
+ * Read the bound from the given stream.
+ */
+template<int Power, bool TakeRoot, size_t Dimensionality>
+void HRectBound<Power, TakeRoot, Dimensionality>::Load(std::istream& stream)
+{
+  for (size_t i = 0; i < Dim(); ++i)
+  {
+    double lo, hi;
+    stream.read((char*) &lo, sizeof(double));
+    stream.read((char*) &hi, sizeof(double));
+    bounds[i] = math::Range(lo, hi);
+  }
+  stream.read((char*) &minWidth, sizeof(double));
+}
+
 /**
  * Returns a string representation of this object.
  */
-template<int Power, bool TakeRoot>
-std::string HRectBound<Power, TakeRoot>::ToString() const
+template<int Power, bool TakeRoot, size_t Dimensionality>
+std::string HRectBound<Power, TakeRoot, Dimensionality>::ToString() const
 {
   std::ostringstream convert;
   convert << "HRectBound [" << this << "]" << std::endl;
@@ -432,7 +646,7 @@ std::string HRectBound<Power, TakeRoot>::ToString() const
   convert << "  TakeRoot: " << (TakeRoot ? "true" : "false") << std::endl;
   convert << "  Dimensionality: " << dim << std::endl;
   convert << "  Bounds: " << std::endl;
-  for (size_t i = 0; i < dim; ++i)
+  for (size_t i = 0; i < Dim(); ++i)
     convert << util::Indent(bounds[i].ToString()) << std::endl;
   convert << "  Minimum width: " << minWidth << std::endl;
 
@@ -15,7 +15,9 @@ MRKDStatistic::MRKDStatistic() :
     count(0),
     leftStat(NULL),
     rightStat(NULL),
-    parentStat(NULL)
+    parentStat(NULL),
+    sumOfSquaredNorms(0.0),
+    weight(0.0)
 { }
 
 /**
@@ -29,6 +31,7 @@ std::string MRKDStatistic::ToString() const
   convert << "begin: " << begin << std::endl;
   convert << "count: " << count << std::endl;
   convert << "sumOfSquaredNorms: " << sumOfSquaredNorms << std::endl;
+  convert << "weight: " << weight << std::endl;
   if (leftStat != NULL)
   {
     convert << "leftStat:" << std::endl;
@@ -49,6 +49,18 @@ class MRKDStatistic
   //! Modify the center of mass.
   arma::colvec& CenterOfMass() { return centerOfMass; }
 
+  //! Get the total weight of the points (their number, if they are not
+  //! weighted).
+  double Weight() const { return weight; }
+  //! Modify the total weight of the points.
+  double& Weight() { return weight; }
+
+  //! Get the weighted scatter matrix of the points: the sum of
+  //! w (x - c)(x - c)^T, where c is the center of mass.
+  const arma::mat& Scatter() const { return scatter; }
+  //! Modify the weighted scatter matrix of the points.
+  arma::mat& Scatter() { return scatter; }
+
   //! Get the index of the dominating centroid.
   size_t DominatingCentroid() const { return dominatingCentroid; }
   //! Modify the index of the dominating centroid.
@@ -78,6 +90,10 @@ class MRKDStatistic
   arma::colvec centerOfMass;
   //! The sum of the squared Euclidean norms for this dataset.
   double sumOfSquaredNorms;
+  //! The total weight of the points.
+  double weight;
+  //! The weighted scatter matrix of the points.
+  arma::mat scatter;
 
   // There may be a better place to store this -- HRectBound?
   //! The index of the dominating centroid of the associated hyperrectangle.
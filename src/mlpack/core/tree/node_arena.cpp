@@ -0,0 +1,88 @@
+/**
+ * @file node_arena.cpp
+ *
+ * Implementation of the NodeArena class.
+ */
+#include "node_arena.hpp"
+#include "../util/huge_pages.hpp"
+#include "../util/memory_usage.hpp"
+
+#include <new>
+
+using namespace mlpack;
+using namespace mlpack::tree;
+
+//! Get the memory account of the nodes of all trees.
+static size_t MemoryAccount()
+{
+  static const size_t account = MemoryUsage::Register("tree_nodes");
+  return account;
+}
+
+NodeArena::NodeArena(const size_t slotSize, const size_t expectedSlots) :
+    slotSize(Align(slotSize)),
+    nextChunkSlots((expectedSlots > 0) ? expectedSlots : 1),
+    slots(0),
+    lastChunkUsed(0)
+{ }
+
+NodeArena::~NodeArena()
+{
+  for (size_t i = 0; i < chunks.size(); ++i)
+  {
+    MemoryUsage::Free(MemoryAccount(), chunkCapacities[i] * slotSize);
+    if (hugeChunks[i])
+      util::FreeHugePages(chunks[i], chunkCapacities[i] * slotSize);
+    else
+      ::operator delete(chunks[i]);
+  }
+}
+
+void* NodeArena::Allocate()
+{
+  void* slot;
+
+  #pragma omp critical(mlpack_node_arena)
+  {
+    if (chunks.empty() || lastChunkUsed == chunkCapacities.back())
+    {
+      // Large chunks are backed by huge pages, if they are enabled (the memory
+      // is page-aligned).  Otherwise, ::operator new() returns memory aligned
+      // for any fundamental type.
+      const size_t bytes = nextChunkSlots * slotSize;
+      char* chunk = (util::HugePages() && bytes >= util::HugePageSize()) ?
+          (char*) util::AllocateHugePages(bytes) : NULL;
+      hugeChunks.push_back(chunk != NULL);
+      if (chunk == NULL)
+        chunk = (char*) ::operator new(bytes);
+
+      chunks.push_back(chunk);
+      chunkCapacities.push_back(nextChunkSlots);
+      MemoryUsage::Allocate(MemoryAccount(), bytes);
+      lastChunkUsed = 0;
+      nextChunkSlots = slots + nextChunkSlots;
+    }
+
+    slot = chunks.back() + lastChunkUsed * slotSize;
+    ++lastChunkUsed;
+    ++slots;
+  }
+
+  return slot;
+}
+
+bool NodeArena::Owns(const void* pointer) const
+{
+  const char* p = (const char*) pointer;
+  for (size_t i = 0; i < chunks.size(); ++i)
+    if (p >= chunks[i] && p < chunks[i] + chunkCapacities[i] * slotSize)
+      return true;
+
+  return false;
+}
+
+size_t NodeArena::ChunkSlots(const size_t chunk) const
+{
+  return (chunk + 1 == chunks.size()) ? lastChunkUsed :
+      chunkCapacities[chunk];
+}
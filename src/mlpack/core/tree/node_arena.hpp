@@ -0,0 +1,100 @@
+/**
+ * @file node_arena.hpp
+ *
+ * Memory for the nodes of a tree, allocated in large chunks and freed all at
+ * once when the tree is destroyed, instead of one node at a time.
+ */
+#ifndef __MLPACK_CORE_TREE_NODE_ARENA_HPP
+#define __MLPACK_CORE_TREE_NODE_ARENA_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace mlpack {
+namespace tree {
+
+/**
+ * An arena of fixed-size slots for the nodes of a tree (and anything stored
+ * with each node, such as the ranges of its bound).  The slots are carved out
+ * of a few large chunks, so building a tree with millions of nodes makes a few
+ * allocations instead of millions, consecutive nodes are next to each other in
+ * memory, and the whole tree is freed at once.  The first chunk holds the
+ * expected number of slots; each later chunk holds as many slots as all of the
+ * previous ones together.
+ *
+ * The arena only provides memory: the tree constructs its nodes in the slots
+ * with placement new, and must call their destructors itself (see Chunk()
+ * and ChunkSlots()) before the arena is destroyed.  Slots are aligned for any
+ * of the types a node holds (doubles, pointers and size_ts).  If huge pages
+ * are enabled (see util::SetHugePages()), chunks of at least a huge page are
+ * backed by huge pages.
+ *
+ * Allocate() is thread-safe, so a tree can be built by several threads; the
+ * other methods must not be called while another thread is allocating.
+ */
+class NodeArena
+{
+ public:
+  /**
+   * Create an empty arena.  No memory is allocated until the first slot is.
+   *
+   * @param slotSize Size of each slot, in bytes.
+   * @param expectedSlots Number of slots of the first chunk.
+   */
+  NodeArena(const size_t slotSize, const size_t expectedSlots);
+
+  //! Free all of the chunks (without destroying anything in them).
+  ~NodeArena();
+
+  //! Get a new slot.  This is thread-safe.
+  void* Allocate();
+
+  //! Return whether the given pointer points into a slot of this arena.
+  bool Owns(const void* pointer) const;
+
+  //! Get the size of each slot, in bytes (a multiple of Alignment).
+  size_t SlotSize() const { return slotSize; }
+  //! Get the number of slots allocated so far.
+  size_t Slots() const { return slots; }
+
+  //! Get the number of chunks.
+  size_t Chunks() const { return chunks.size(); }
+  //! Get the first slot of the given chunk.
+  void* Chunk(const size_t chunk) const { return chunks[chunk]; }
+  //! Get the number of slots in use in the given chunk.
+  size_t ChunkSlots(const size_t chunk) const;
+
+  //! The alignment of each slot, in bytes.
+  static const size_t Alignment = 16;
+
+  //! Round the given size up to a multiple of Alignment.
+  static size_t Align(const size_t size)
+  {
+    return (size + Alignment - 1) / Alignment * Alignment;
+  }
+
+ private:
+  //! The size of each slot.
+  size_t slotSize;
+  //! The number of slots of the next chunk.
+  size_t nextChunkSlots;
+  //! The number of slots allocated.
+  size_t slots;
+  //! The number of slots used in the last chunk.
+  size_t lastChunkUsed;
+  //! The chunks.
+  std::vector<char*> chunks;
+  //! The number of slots of each chunk.
+  std::vector<size_t> chunkCapacities;
+  //! Whether each chunk was allocated with util::AllocateHugePages().
+  std::vector<bool> hugeChunks;
+
+  // An arena can't be copied.
+  NodeArena(const NodeArena& other);
+  NodeArena& operator=(const NodeArena& other);
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
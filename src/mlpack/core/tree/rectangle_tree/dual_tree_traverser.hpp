@@ -12,6 +12,7 @@
 #include <mlpack/core.hpp>
 
 #include "rectangle_tree.hpp"
+#include "../traversal_statistics.hpp"
 
 namespace mlpack {
 namespace tree {
@@ -30,6 +31,12 @@ class RectangleTree<SplitType, DescentType, StatisticType, MatType>::
    */
   DualTreeTraverser(RuleType& rule);
 
+  /**
+   * Add the statistics of this traversal to the process-wide total (see
+   * TraversalStatistics::Record()).
+   */
+  ~DualTreeTraverser() { TraversalStatistics::Record(statistics); }
+
   /**
    * Traverse the two trees.  This does not reset the number of prunes.
    *
@@ -40,6 +47,30 @@ class RectangleTree<SplitType, DescentType, StatisticType, MatType>::
   void Traverse(RectangleTree<SplitType, DescentType, StatisticType, MatType>& queryNode,
 		RectangleTree<SplitType, DescentType, StatisticType, MatType>& referenceNode);
 
+  /**
+   * Traverse the two specified trees with the given number of threads (if
+   * OpenMP is available; 0 means the OpenMP default).  The top of the query
+   * tree is traversed first; once the query nodes are small enough, each query
+   * subtree, with the reference nodes that are left for it, becomes a task, and
+   * the tasks are traversed in parallel.  The children of a node (even of an
+   * X-tree supernode, which may have very many) go to separate tasks, and there
+   * are many more tasks than threads, so the load is balanced even though the
+   * fan-out of the tree is irregular.
+   *
+   * Each task uses its own copy of the rule, with the same requirements as the
+   * parallel traversal of the cover tree: RuleType must be copyable, copies of
+   * the rule must be safe to use at the same time as long as they handle
+   * different query points, and the rule must have modifiable BaseCases() and
+   * Scores() counters, which are added back into the original rule.
+   *
+   * @param queryNode Root of query tree.
+   * @param referenceNode Root of reference tree.
+   * @param numThreads Number of threads to use.
+   */
+  void Traverse(RectangleTree& queryNode,
+                RectangleTree& referenceNode,
+                const size_t numThreads);
+
   //! Get the number of prunes.
   size_t NumPrunes() const { return numPrunes; }
   //! Modify the number of prunes.
@@ -60,6 +91,11 @@ class RectangleTree<SplitType, DescentType, StatisticType, MatType>::
   //! Modify the number of times a base case was calculated.
   size_t& NumBaseCases() { return numBaseCases; }
 
+  //! Get the statistics of the traversal.
+  const TraversalStatistics& Statistics() const { return statistics; }
+  //! Modify the statistics of the traversal.
+  TraversalStatistics& Statistics() { return statistics; }
+
  private:
    
   //We use this struct and this function to make the sorting and scoring easy and efficient:
@@ -75,13 +111,41 @@ class RectangleTree<SplitType, DescentType, StatisticType, MatType>::
   {
     return obj1.score < obj2.score;
   }
-  
+
+  //! A part of a parallel traversal: a query node and the reference nodes
+  //! that are left for it, sorted by score.
+  struct DualTreeTask
+  {
+    //! The query node.
+    RectangleTree* queryNode;
+    //! The reference nodes to traverse with the query node.
+    std::vector<NodeAndScore> references;
+  };
+
+  /**
+   * Traverse as Traverse() does, but stop at query nodes with no more than
+   * grain descendants (or query leaves), and add them to the list of tasks
+   * instead of traversing them.  The given reference nodes (sorted by score)
+   * are the ones left for the query node.
+   */
+  void GatherTasks(RectangleTree& queryNode,
+                   std::vector<NodeAndScore>& references,
+                   const size_t grain,
+                   std::vector<DualTreeTask>& tasks);
+
+  //! Traverse the query node of the given task with each of its reference
+  //! nodes, in order.
+  void TraverseTask(DualTreeTask& task);
+
   //! Reference to the rules with which the trees will be traversed.
   RuleType& rule;
 
   //! The number of prunes.
   size_t numPrunes;
 
+  //! The statistics of the traversal.
+  TraversalStatistics statistics;
+
   //! The number of node combinations that have been visited during traversal.
   size_t numVisited;
 
@@ -43,6 +43,7 @@ DualTreeTraverser<RuleType>::Traverse(
 {
   // Increment the visit counter.
   ++numVisited;
+  statistics.AddVisit();
 
   // Store the current traversal info.
   traversalInfo = rule.TraversalInfo();
@@ -63,6 +64,7 @@ DualTreeTraverser<RuleType>::Traverse(
       // Restore the traversal information.
       rule.TraversalInfo() = traversalInfo;
       const double childScore = rule.Score(queryNode.Points()[query], referenceNode);
+      statistics.AddScores(1);
 
       if(childScore == DBL_MAX)
         continue;  // This point doesn't require a search in this reference node.
@@ -71,6 +73,7 @@ DualTreeTraverser<RuleType>::Traverse(
         rule.BaseCase(queryNode.Points()[query], referenceNode.Points()[ref]);
 
       numBaseCases += referenceNode.Count();
+      statistics.AddBaseCases(referenceNode.Count());
     }
   }
   else if(!queryNode.IsLeaf() && referenceNode.IsLeaf())
@@ -81,10 +84,16 @@ DualTreeTraverser<RuleType>::Traverse(
       // Before recursing, we have to set the traversal information correctly.
       rule.TraversalInfo() = traversalInfo;
       ++numScores;
+      statistics.AddScores(1);
       if(rule.Score(queryNode.Child(i), referenceNode) < DBL_MAX)
+      {
         Traverse(queryNode.Child(i), referenceNode);
+      }
       else
+      {
         numPrunes++;
+        statistics.AddPrunes(referenceNode);
+      }
     }
   }
   else if(queryNode.IsLeaf() && !referenceNode.IsLeaf())
@@ -102,6 +111,7 @@ DualTreeTraverser<RuleType>::Traverse(
     }
     std::sort(nodesAndScores.begin(), nodesAndScores.end(), nodeComparator);
     numScores += nodesAndScores.size();
+    statistics.AddScores(nodesAndScores.size());
 
     for (size_t i = 0; i < nodesAndScores.size(); i++)
     {
@@ -110,6 +120,7 @@ DualTreeTraverser<RuleType>::Traverse(
         Traverse(queryNode, *(nodesAndScores[i].node));
       } else {
         numPrunes += nodesAndScores.size() - i;
+        statistics.AddPrunes(*(nodesAndScores[i].node), nodesAndScores.size() - i);
         break;
       }
     }
@@ -133,6 +144,7 @@ DualTreeTraverser<RuleType>::Traverse(
       }
       std::sort(nodesAndScores.begin(), nodesAndScores.end(), nodeComparator);
       numScores += nodesAndScores.size();
+      statistics.AddScores(nodesAndScores.size());
 
       for (size_t i = 0; i < nodesAndScores.size(); i++)
       {
@@ -141,6 +153,7 @@ DualTreeTraverser<RuleType>::Traverse(
           Traverse(queryNode.Child(j), *(nodesAndScores[i].node));
         } else {
           numPrunes += nodesAndScores.size() - i;
+          statistics.AddPrunes(*(nodesAndScores[i].node), nodesAndScores.size() - i);
           break;
         }
       }
@@ -148,6 +161,194 @@ DualTreeTraverser<RuleType>::Traverse(
   }
 }
 
+template<typename SplitType,
+         typename DescentType,
+         typename StatisticType,
+         typename MatType>
+template<typename RuleType>
+void RectangleTree<SplitType, DescentType, StatisticType, MatType>::
+DualTreeTraverser<RuleType>::Traverse(
+    RectangleTree& queryNode,
+    RectangleTree& referenceNode,
+    const size_t numThreads)
+{
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads(numThreads);
+#else
+  const size_t threads = 1;
+#endif
+
+  if (threads == 1 || queryNode.IsLeaf())
+  {
+    Traverse(queryNode, referenceNode);
+    return;
+  }
+
+  // The roots are not scored, as in the serial traversal.
+  std::vector<NodeAndScore> references(1);
+  references[0].node = &referenceNode;
+  references[0].score = 0.0;
+  references[0].travInfo = rule.TraversalInfo();
+
+  // Traverse the top of the query tree with this rule, collecting the tasks.
+  // We ask for many more tasks than threads, so that the load is balanced when
+  // some tasks are much more expensive than others.
+  const size_t grain = std::max(queryNode.NumDescendants() / (16 * threads),
+      (size_t) 1);
+  std::vector<DualTreeTask> tasks;
+  GatherTasks(queryNode, references, grain, tasks);
+
+  Log::Info << "Traversing " << tasks.size() << " query subtrees with "
+      << threads << " threads.\n";
+
+  size_t totalScores = 0;
+  size_t totalBaseCases = 0;
+  size_t totalPrunes = 0;
+  size_t totalVisited = 0;
+  size_t totalTraverserScores = 0;
+  size_t totalTraverserBaseCases = 0;
+  #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+      reduction(+:totalScores, totalBaseCases, totalPrunes, totalVisited, \
+      totalTraverserScores, totalTraverserBaseCases)
+  for (size_t i = 0; i < tasks.size(); ++i)
+  {
+    RuleType threadRule(rule);
+    threadRule.BaseCases() = 0;
+    threadRule.Scores() = 0;
+
+    DualTreeTraverser<RuleType> traverser(threadRule);
+    traverser.TraverseTask(tasks[i]);
+
+    totalScores += threadRule.Scores();
+    totalBaseCases += threadRule.BaseCases();
+    totalPrunes += traverser.NumPrunes();
+    totalVisited += traverser.NumVisited();
+    totalTraverserScores += traverser.NumScores();
+    totalTraverserBaseCases += traverser.NumBaseCases();
+
+    // Move the statistics of the task into this traverser, so that they are
+    // recorded only once.
+    if (TraversalStatistics::Enabled)
+    {
+      #pragma omp critical(mlpack_rectangle_tree_traversal_statistics)
+      statistics.Merge(traverser.Statistics());
+      traverser.Statistics().Reset();
+    }
+  }
+
+  rule.Scores() += totalScores;
+  rule.BaseCases() += totalBaseCases;
+  numPrunes += totalPrunes;
+  numVisited += totalVisited;
+  numScores += totalTraverserScores;
+  numBaseCases += totalTraverserBaseCases;
+}
+
+template<typename SplitType,
+         typename DescentType,
+         typename StatisticType,
+         typename MatType>
+template<typename RuleType>
+void RectangleTree<SplitType, DescentType, StatisticType, MatType>::
+DualTreeTraverser<RuleType>::GatherTasks(
+    RectangleTree& queryNode,
+    std::vector<NodeAndScore>& references,
+    const size_t grain,
+    std::vector<DualTreeTask>& tasks)
+{
+  if (references.empty())
+    return; // Nothing to do!
+
+  // A small enough query subtree is traversed as a whole by one thread.
+  if (queryNode.IsLeaf() || (queryNode.NumDescendants() <= grain))
+  {
+    tasks.push_back(DualTreeTask());
+    tasks.back().queryNode = &queryNode;
+    tasks.back().references.swap(references);
+    return;
+  }
+
+  // Drop the reference nodes which can be pruned now.  They are sorted by
+  // score, so the rest can be pruned too.
+  ++numVisited;
+  statistics.AddVisit();
+  size_t numReferences = 0;
+  while (numReferences < references.size())
+  {
+    const NodeAndScore& reference = references[numReferences];
+    rule.TraversalInfo() = reference.travInfo;
+    if (rule.Rescore(queryNode, *reference.node, reference.score) == DBL_MAX)
+    {
+      numPrunes += references.size() - numReferences;
+      statistics.AddPrunes(*reference.node, references.size() - numReferences);
+      break;
+    }
+
+    ++numReferences;
+  }
+
+  // Score each query child with the reference nodes (or their children, for
+  // reference nodes which are not leaves), as Traverse() does.
+  for (size_t j = 0; j < queryNode.NumChildren(); ++j)
+  {
+    std::vector<NodeAndScore> childReferences;
+    for (size_t i = 0; i < numReferences; ++i)
+    {
+      RectangleTree& referenceNode = *references[i].node;
+      const size_t numScored = referenceNode.IsLeaf() ? 1 :
+          referenceNode.NumChildren();
+      for (size_t k = 0; k < numScored; ++k)
+      {
+        NodeAndScore child;
+        child.node = referenceNode.IsLeaf() ? &referenceNode :
+            referenceNode.Children()[k];
+        rule.TraversalInfo() = references[i].travInfo;
+        child.score = rule.Score(queryNode.Child(j), *child.node);
+        child.travInfo = rule.TraversalInfo();
+
+        if (child.score == DBL_MAX)
+        {
+          ++numPrunes;
+          statistics.AddPrunes(*child.node);
+          continue;
+        }
+
+        childReferences.push_back(child);
+      }
+
+      numScores += numScored;
+      statistics.AddScores(numScored);
+    }
+
+    std::sort(childReferences.begin(), childReferences.end(), nodeComparator);
+    GatherTasks(queryNode.Child(j), childReferences, grain, tasks);
+  }
+}
+
+template<typename SplitType,
+         typename DescentType,
+         typename StatisticType,
+         typename MatType>
+template<typename RuleType>
+void RectangleTree<SplitType, DescentType, StatisticType, MatType>::
+DualTreeTraverser<RuleType>::TraverseTask(DualTreeTask& task)
+{
+  std::vector<NodeAndScore>& references = task.references;
+  for (size_t i = 0; i < references.size(); ++i)
+  {
+    rule.TraversalInfo() = references[i].travInfo;
+    if (rule.Rescore(*task.queryNode, *references[i].node,
+        references[i].score) == DBL_MAX)
+    {
+      numPrunes += references.size() - i;
+      statistics.AddPrunes(*references[i].node, references.size() - i);
+      break;
+    }
+
+    Traverse(*task.queryNode, *references[i].node);
+  }
+}
+
 }; // namespace tree
 }; // namespace mlpack
 
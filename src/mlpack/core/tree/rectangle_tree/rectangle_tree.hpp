@@ -77,6 +77,9 @@ class RectangleTree
   //! The number of points in the dataset contained in this node (and its
   //! children).
   size_t count;
+  //! The number of points in the leaves under this node, so that Descendant()
+  //! does not have to count them (CountDescendants() updates it).
+  size_t numDescendants;
   //! The max leaf size.
   size_t maxLeafSize;
   //! The minimum leaf size.
@@ -123,13 +126,18 @@ class RectangleTree
    *      have.
    * @param firstDataIndex The index of the first data point.  UNUSED UNLESS WE
    *      ADD SUPPORT FOR HAVING A "CENTERAL" DATA MATRIX.
+   * @param bulkLoad If true, build the tree bottom-up with the Sort-Tile-
+   *      Recursive algorithm instead of inserting the points one at a time.
+   *      This is much faster for large datasets, and points can still be
+   *      inserted and deleted afterwards.
    */
   RectangleTree(MatType& data,
                 const size_t maxLeafSize = 20,
                 const size_t minLeafSize = 8,
                 const size_t maxNumChildren = 5,
                 const size_t minNumChildren = 2,
-                const size_t firstDataIndex = 0);
+                const size_t firstDataIndex = 0,
+                const bool bulkLoad = false);
 
   /**
    * Construct this as an empty node with the specified parent.  Copying the
@@ -387,16 +395,20 @@ class RectangleTree
   size_t NumPoints() const;
 
   /**
-   * Return the number of descendants of this node.  For a non-leaf in a binary
-   * space tree, this is the number of points at the descendant leaves.  For a
-   * leaf, this is the number of points in the leaf.
+   * Return the number of descendants of this node.  For a non-leaf, this is
+   * the number of points in the leaves under it.  For a leaf, this is the
+   * number of points in the leaf.  The count is kept up to date as points are
+   * inserted and deleted, so this takes constant time.
    */
   size_t NumDescendants() const;
 
   /**
    * Return the index (with reference to the dataset) of a particular descendant
    * of this node.  The index should be greater than zero but less than the
-   * number of descendants.
+   * number of descendants.  The descendants are numbered leaf by leaf, and the
+   * right leaf is found with the descendant counts of the children, so this
+   * takes time proportional to the depth of the node times the number of
+   * children of each node.
    *
    * @param index Index of the descendant.
    */
@@ -502,6 +514,58 @@ class RectangleTree
     return new RectangleTree(begin, count, bound, stat, maxLeafSize);
   }
 
+  /**
+   * Build the tree below this empty root node with the Sort-Tile-Recursive
+   * (STR) algorithm of Leutenegger, Lopez and Edgington: the points are sorted
+   * into slabs along the first dimension, each slab is sorted into slabs along
+   * the second dimension, and so on, and each final slab becomes a leaf.  The
+   * leaves are then grouped into parents in the same way (using their
+   * centroids), level by level, until at most maxNumChildren nodes are left;
+   * these become the children of this node.  Every leaf is on the same level,
+   * and every node satisfies the fill requirements (as long as minLeafSize and
+   * minNumChildren are at most half of the maximums).
+   *
+   * @param firstDataIndex The index of the first point to add to the tree.
+   */
+  void BulkLoad(const size_t firstDataIndex);
+
+  /**
+   * Sort the items order[Boundary(firstGroup)] to order[Boundary(lastGroup) -
+   * 1] into slabs along the given dimension and recurse into each slab with the
+   * next dimension, so that afterwards each group of consecutive items is one
+   * tile.  Group g holds the items order[Boundary(g)] to order[Boundary(g + 1)
+   * - 1], where Boundary(g) = floor(numItems * g / numGroups), so all of the
+   * groups have nearly the same number of items.
+   *
+   * @param centers Matrix whose columns are the centers of the items.
+   * @param order Indices of the items (columns of centers); this is reordered.
+   * @param numGroups The total number of groups.
+   * @param firstGroup The first group to sort.
+   * @param lastGroup One past the last group to sort.
+   * @param dim The dimension to sort along.
+   */
+  static void TileSort(const arma::mat& centers,
+                       std::vector<size_t>& order,
+                       const size_t numGroups,
+                       const size_t firstGroup,
+                       const size_t lastGroup,
+                       const size_t dim);
+
+  //! Compare two items by their center in one dimension (for TileSort()).
+  struct CenterComparator
+  {
+    CenterComparator(const arma::mat& centers, const size_t dim) :
+        centers(centers), dim(dim) { }
+
+    bool operator()(const size_t a, const size_t b) const
+    {
+      return centers(dim, a) < centers(dim, b);
+    }
+
+    const arma::mat& centers;
+    size_t dim;
+  };
+
   /**
    * Splits the current node, recursing up the tree.
    *
@@ -509,6 +573,18 @@ class RectangleTree
    */
   void SplitNode(std::vector<bool>& relevels);
 
+  //! The value of numDescendants for a node whose descendants changed.
+  static const size_t UnknownDescendants = size_t(-1);
+
+  /**
+   * Update the descendant counts of this node and of the nodes under it whose
+   * descendants changed.  Inserting or deleting a point (or node) marks each
+   * node it passes through, and new nodes start marked; the nodes which are
+   * not marked still have the right count, so only the changed paths are
+   * recounted.
+   */
+  void CountDescendants();
+
  public:
   /**
    * Condense the bounding rectangles for this node based on the removal of the
@@ -27,7 +27,8 @@ RectangleTree<SplitType, DescentType, StatisticType, MatType>::RectangleTree(
     const size_t minLeafSize,
     const size_t maxNumChildren,
     const size_t minNumChildren,
-    const size_t firstDataIndex) :
+    const size_t firstDataIndex,
+    const bool bulkLoad) :
     maxNumChildren(maxNumChildren),
     minNumChildren(minNumChildren),
     numChildren(0),
@@ -35,6 +36,7 @@ RectangleTree<SplitType, DescentType, StatisticType, MatType>::RectangleTree(
     parent(NULL),
     begin(0),
     count(0),
+    numDescendants(UnknownDescendants),
     maxLeafSize(maxLeafSize),
     minLeafSize(minLeafSize),
     bound(data.n_rows),
@@ -46,7 +48,14 @@ RectangleTree<SplitType, DescentType, StatisticType, MatType>::RectangleTree(
 {
   stat = StatisticType(*this);
 
-  // For now, just insert the points in order.
+  if (bulkLoad)
+  {
+    BulkLoad(firstDataIndex);
+    CountDescendants();
+    return;
+  }
+
+  // Otherwise, just insert the points in order.
   RectangleTree* root = this;
 
   for (size_t i = firstDataIndex; i < data.n_cols; i++)
@@ -66,6 +75,7 @@ RectangleTree<SplitType, DescentType, StatisticType, MatType>::RectangleTree(
     parent(parentNode),
     begin(0),
     count(0),
+    numDescendants(UnknownDescendants),
     maxLeafSize(parentNode->MaxLeafSize()),
     minLeafSize(parentNode->MinLeafSize()),
     bound(parentNode->Bound().Dim()),
@@ -97,6 +107,7 @@ RectangleTree<SplitType, DescentType, StatisticType, MatType>::RectangleTree(
     parent(other.Parent()),
     begin(other.Begin()),
     count(other.Count()),
+    numDescendants(other.numDescendants),
     maxLeafSize(other.MaxLeafSize()),
     minLeafSize(other.MinLeafSize()),
     bound(other.bound),
@@ -190,6 +201,7 @@ void RectangleTree<SplitType, DescentType, StatisticType, MatType>::InsertPoint(
 {
   // Expand the bound regardless of whether it is a leaf node.
   bound |= dataset.col(point);
+  numDescendants = UnknownDescendants;
 
   std::vector<bool> lvls(TreeDepth());
   for (size_t i = 0; i < lvls.size(); i++)
@@ -201,14 +213,21 @@ void RectangleTree<SplitType, DescentType, StatisticType, MatType>::InsertPoint(
     localDataset->col(count) = dataset.col(point);
     points[count++] = point;
     SplitNode(lvls);
-    return;
+  }
+  else
+  {
+    // If it is not a leaf node, we use the DescentHeuristic to choose a child
+    // to which we recurse.
+    const size_t descentNode = DescentType::ChooseDescentNode(this,
+        dataset.col(point));
+    children[descentNode]->InsertPoint(point, lvls);
   }
 
-  // If it is not a leaf node, we use the DescentHeuristic to choose a child
-  // to which we recurse.
-  const size_t descentNode = DescentType::ChooseDescentNode(this,
-      dataset.col(point));
-  children[descentNode]->InsertPoint(point, lvls);
+  // Recount the descendants of the nodes the insertion changed.  Splits insert
+  // points into the new nodes directly; then the counts are updated when the
+  // insertion at the root is done.
+  if (parent == NULL)
+    CountDescendants();
 }
 
 /**
@@ -227,6 +246,7 @@ void RectangleTree<SplitType, DescentType, StatisticType, MatType>::InsertPoint(
 {
   // Expand the bound regardless of whether it is a leaf node.
   bound |= dataset.col(point);
+  numDescendants = UnknownDescendants;
 
   // If this is a leaf node, we stop here and add the point.
   if (numChildren == 0)
@@ -263,6 +283,7 @@ void RectangleTree<SplitType, DescentType, StatisticType, MatType>::InsertNode(
 {
   // Expand the bound regardless of the level.
   bound |= node->Bound();
+  numDescendants = UnknownDescendants;
   if (level == TreeDepth())
   {
     children[numChildren++] = node;
@@ -297,6 +318,9 @@ bool RectangleTree<SplitType, DescentType, StatisticType, MatType>::DeletePoint(
   for (size_t i = 0; i < lvls.size(); i++)
     lvls[i] = true;
 
+  numDescendants = UnknownDescendants;
+  bool deleted = false;
+
   if (numChildren == 0)
   {
     for (size_t i = 0; i < count; i++)
@@ -305,19 +329,22 @@ bool RectangleTree<SplitType, DescentType, StatisticType, MatType>::DeletePoint(
       {
         localDataset->col(i) = localDataset->col(--count); // Decrement count.
         points[i] = points[count];
-        // This function wil ensure that minFill is satisfied.
+        // This function wil ensure that minFill is satisfied.  It may delete
+        // this node.
         CondenseTree(dataset.col(point), lvls, true);
-        return true;
+        deleted = true;
+        break;
       }
     }
   }
 
-  for (size_t i = 0; i < numChildren; i++)
+  for (size_t i = 0; !deleted && i < numChildren; i++)
     if (children[i]->Bound().Contains(dataset.col(point)))
-      if (children[i]->DeletePoint(point, lvls))
-        return true;
+      deleted = children[i]->DeletePoint(point, lvls);
 
-  return false;
+  // Recount the descendants of the nodes the deletion changed.
+  root->CountDescendants();
+  return deleted;
 }
 
 /**
@@ -332,6 +359,8 @@ bool RectangleTree<SplitType, DescentType, StatisticType, MatType>::DeletePoint(
     const size_t point,
     std::vector<bool>& relevels)
 {
+  numDescendants = UnknownDescendants;
+
   if (numChildren == 0)
   {
     for (size_t i = 0; i < count; i++)
@@ -367,6 +396,8 @@ bool RectangleTree<SplitType, DescentType, StatisticType, MatType>::RemoveNode(
     const RectangleTree* node,
     std::vector<bool>& relevels)
 {
+  numDescendants = UnknownDescendants;
+
   for (size_t i = 0; i < numChildren; i++)
   {
     if (children[i] == node)
@@ -496,17 +527,18 @@ inline size_t RectangleTree<SplitType, DescentType, StatisticType, MatType>::
     NumDescendants() const
 {
   if (numChildren == 0)
-  {
     return count;
-  }
-  else
-  {
-    size_t n = 0;
-    for (size_t i = 0; i < numChildren; i++)
-      n += children[i]->NumDescendants();
 
-    return n;
-  }
+  if (numDescendants != UnknownDescendants)
+    return numDescendants;
+
+  // The tree was changed without recounting (which only happens in the middle
+  // of an insertion or deletion), so count the points.
+  size_t n = 0;
+  for (size_t i = 0; i < numChildren; i++)
+    n += children[i]->NumDescendants();
+
+  return n;
 }
 
 /**
@@ -519,7 +551,44 @@ template<typename SplitType,
 inline size_t RectangleTree<SplitType, DescentType, StatisticType, MatType>::
     Descendant(const size_t index) const
 {
-  return (points[index]);
+  if (numChildren == 0)
+    return points[index];
+
+  // Find the child the descendant is under.
+  size_t childIndex = index;
+  for (size_t i = 0; i < numChildren; i++)
+  {
+    const size_t childDescendants = children[i]->NumDescendants();
+    if (childIndex < childDescendants)
+      return children[i]->Descendant(childIndex);
+    childIndex -= childDescendants;
+  }
+
+  return dataset.n_cols; // The index is out of range.
+}
+
+template<typename SplitType,
+         typename DescentType,
+         typename StatisticType,
+         typename MatType>
+void RectangleTree<SplitType, DescentType, StatisticType, MatType>::
+    CountDescendants()
+{
+  if (numChildren == 0)
+  {
+    numDescendants = count;
+    return;
+  }
+
+  if (numDescendants != UnknownDescendants)
+    return;
+
+  numDescendants = 0;
+  for (size_t i = 0; i < numChildren; i++)
+  {
+    children[i]->CountDescendants();
+    numDescendants += children[i]->numDescendants;
+  }
 }
 
 /**
@@ -535,6 +604,137 @@ inline size_t RectangleTree<SplitType, DescentType, StatisticType, MatType>::
   return points[index];
 }
 
+/**
+ * Build the tree with the Sort-Tile-Recursive algorithm, bottom-up.
+ */
+template<typename SplitType,
+         typename DescentType,
+         typename StatisticType,
+         typename MatType>
+void RectangleTree<SplitType, DescentType, StatisticType, MatType>::BulkLoad(
+    const size_t firstDataIndex)
+{
+  const size_t numPoints = (dataset.n_cols > firstDataIndex) ?
+      dataset.n_cols - firstDataIndex : 0;
+
+  // If everything fits in one leaf, this node is that leaf.
+  if (numPoints <= maxLeafSize)
+  {
+    for (size_t i = firstDataIndex; i < dataset.n_cols; i++)
+    {
+      bound |= dataset.col(i);
+      localDataset->col(count) = dataset.col(i);
+      points[count++] = i;
+    }
+    return;
+  }
+
+  // Tile the points into leaves.
+  std::vector<size_t> order(numPoints);
+  for (size_t i = 0; i < numPoints; i++)
+    order[i] = firstDataIndex + i;
+
+  size_t numGroups = (numPoints + maxLeafSize - 1) / maxLeafSize;
+  TileSort(dataset, order, numGroups, 0, numGroups, 0);
+
+  std::vector<RectangleTree*> nodes(numGroups);
+  for (size_t g = 0; g < numGroups; g++)
+  {
+    RectangleTree* leaf = new RectangleTree(this);
+    for (size_t i = numPoints * g / numGroups;
+         i < numPoints * (g + 1) / numGroups; i++)
+    {
+      leaf->bound |= dataset.col(order[i]);
+      leaf->localDataset->col(leaf->count) = dataset.col(order[i]);
+      leaf->points[leaf->count++] = order[i];
+    }
+    nodes[g] = leaf;
+  }
+
+  // Now tile each level into the parents of its nodes, until the remaining
+  // nodes fit in this node.
+  arma::vec centroid;
+  while (nodes.size() > maxNumChildren)
+  {
+    const size_t numNodes = nodes.size();
+    arma::mat centroids(bound.Dim(), numNodes);
+    order.resize(numNodes);
+    for (size_t i = 0; i < numNodes; i++)
+    {
+      nodes[i]->Bound().Centroid(centroid);
+      centroids.col(i) = centroid;
+      order[i] = i;
+    }
+
+    numGroups = (numNodes + maxNumChildren - 1) / maxNumChildren;
+    TileSort(centroids, order, numGroups, 0, numGroups, 0);
+
+    std::vector<RectangleTree*> parents(numGroups);
+    for (size_t g = 0; g < numGroups; g++)
+    {
+      RectangleTree* node = new RectangleTree(this);
+      for (size_t i = numNodes * g / numGroups;
+           i < numNodes * (g + 1) / numGroups; i++)
+      {
+        RectangleTree* child = nodes[order[i]];
+        child->Parent() = node;
+        node->bound |= child->Bound();
+        node->children[node->numChildren++] = child;
+      }
+      parents[g] = node;
+    }
+
+    nodes.swap(parents);
+  }
+
+  for (size_t i = 0; i < nodes.size(); i++)
+  {
+    nodes[i]->Parent() = this;
+    bound |= nodes[i]->Bound();
+    children[numChildren++] = nodes[i];
+  }
+}
+
+/**
+ * Sort one range of groups into tiles, one dimension at a time.
+ */
+template<typename SplitType,
+         typename DescentType,
+         typename StatisticType,
+         typename MatType>
+void RectangleTree<SplitType, DescentType, StatisticType, MatType>::TileSort(
+    const arma::mat& centers,
+    std::vector<size_t>& order,
+    const size_t numGroups,
+    const size_t firstGroup,
+    const size_t lastGroup,
+    const size_t dim)
+{
+  const size_t groups = lastGroup - firstGroup;
+  if (groups <= 1 || dim >= centers.n_rows)
+    return;
+
+  const size_t numItems = order.size();
+  std::sort(order.begin() + numItems * firstGroup / numGroups,
+            order.begin() + numItems * lastGroup / numGroups,
+            CenterComparator(centers, dim));
+
+  // Split the groups into about groups^(1 / remaining dimensions) slabs, so the
+  // tiles are roughly square.  In the last dimension, each group is a slab.
+  size_t slabs = (size_t) std::ceil(std::pow((double) groups,
+      1.0 / (centers.n_rows - dim)));
+  if (slabs < 1)
+    slabs = 1;
+  else if (slabs > groups)
+    slabs = groups;
+
+  for (size_t s = 0; s < slabs; s++)
+  {
+    TileSort(centers, order, numGroups, firstGroup + groups * s / slabs,
+        firstGroup + groups * (s + 1) / slabs, dim + 1);
+  }
+}
+
 /**
  * Split the tree.  This calls the SplitType code to split a node.  This method
  * should only be called on a leaf node.
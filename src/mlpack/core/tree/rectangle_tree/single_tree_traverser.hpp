@@ -12,6 +12,7 @@
 #include <mlpack/core.hpp>
 
 #include "rectangle_tree.hpp"
+#include "../traversal_statistics.hpp"
 
 namespace mlpack {
 namespace tree {
@@ -30,6 +31,12 @@ class RectangleTree<SplitType, DescentType, StatisticType, MatType>::
    */
   SingleTreeTraverser(RuleType& rule);
 
+  /**
+   * Add the statistics of this traversal to the process-wide total (see
+   * TraversalStatistics::Record()).
+   */
+  ~SingleTreeTraverser() { TraversalStatistics::Record(statistics); }
+
   /**
    * Traverse the tree with the given point.
    *
@@ -44,6 +51,11 @@ class RectangleTree<SplitType, DescentType, StatisticType, MatType>::
   //! Modify the number of prunes.
   size_t& NumPrunes() { return numPrunes; }
 
+  //! Get the statistics of the traversal.
+  const TraversalStatistics& Statistics() const { return statistics; }
+  //! Modify the statistics of the traversal.
+  TraversalStatistics& Statistics() { return statistics; }
+
  private:
   
   // We use this class and this function to make the sorting and scoring easy
@@ -64,6 +76,9 @@ class RectangleTree<SplitType, DescentType, StatisticType, MatType>::
 
   //! The number of nodes which have been prenud during traversal.
   size_t numPrunes;
+
+  //! The statistics of the traversal.
+  TraversalStatistics statistics;
 };
 
 }; // namespace tree
@@ -39,6 +39,7 @@ SingleTreeTraverser<RuleType>::Traverse(
     const RectangleTree<SplitType, DescentType, StatisticType, MatType>&
         referenceNode)
 {
+  statistics.AddVisit();
 
   // If we reach a leaf node, we need to run the base case.
   if (referenceNode.IsLeaf())
@@ -46,6 +47,7 @@ SingleTreeTraverser<RuleType>::Traverse(
     for (size_t i = 0; i < referenceNode.Count(); i++)
       rule.BaseCase(queryIndex, referenceNode.Points()[i]);
 
+    statistics.AddBaseCases(referenceNode.Count());
     return;
   }
 
@@ -57,6 +59,7 @@ SingleTreeTraverser<RuleType>::Traverse(
     nodesAndScores[i].node = referenceNode.Children()[i];
     nodesAndScores[i].score = rule.Score(queryIndex, *nodesAndScores[i].node);
   }
+  statistics.AddScores(referenceNode.NumChildren());
 
   std::sort(nodesAndScores.begin(), nodesAndScores.end(), NodeComparator);
 
@@ -72,6 +75,8 @@ SingleTreeTraverser<RuleType>::Traverse(
     else
     {
       numPrunes += referenceNode.NumChildren() - i;
+      statistics.AddPrunes(*nodesAndScores[i].node,
+          referenceNode.NumChildren() - i);
       return;
     }
   }
@@ -18,9 +18,11 @@ namespace tree {
  * help write tree-independent (but still optimized) tree-based algorithms.  See
  * mlpack/core/tree/tree_traits.hpp for more information.
  */
-template<typename StatisticType,
+template<typename SplitType,
+         typename DescentType,
+         typename StatisticType,
          typename MatType>
-class TreeTraits<RectangleTree<StatisticType, MatType> >
+class TreeTraits<RectangleTree<SplitType, DescentType, StatisticType, MatType> >
 {
  public:
   /**
@@ -39,11 +41,10 @@ class TreeTraits<RectangleTree<StatisticType, MatType> >
   static const bool HasSelfChildren = false;
 
   /**
-   * Points are rearranged during building of the tree.
-   * THIS MAY NOT BE TRUE.  IT'S HARD TO DYNAMICALLY INSERT POINTS
-   * AND REARRANGE THE MATRIX
+   * Points are not rearranged during building of the tree (the tree holds the
+   * indices of the points, so points can be inserted and deleted).
    */
-  static const bool RearrangesDataset = true;
+  static const bool RearrangesDataset = false;
 };
 
 }; // namespace tree
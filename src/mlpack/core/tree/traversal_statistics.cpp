@@ -0,0 +1,64 @@
+/**
+ * @file traversal_statistics.cpp
+ *
+ * Implementation of the TraversalStatistics class, when it is compiled in.
+ */
+#include "traversal_statistics.hpp"
+
+#ifdef MLPACK_TRAVERSAL_STATISTICS
+
+using namespace mlpack;
+using namespace mlpack::tree;
+
+// The process-wide total.  It is only accessed in the critical sections below.
+static TraversalStatistics total;
+
+void TraversalStatistics::Merge(const TraversalStatistics& other)
+{
+  baseCases += other.baseCases;
+  scores += other.scores;
+  visits += other.visits;
+
+  if (other.prunes.size() > prunes.size())
+    prunes.resize(other.prunes.size(), 0);
+  for (size_t i = 0; i < other.prunes.size(); ++i)
+    prunes[i] += other.prunes[i];
+}
+
+void TraversalStatistics::Reset()
+{
+  baseCases = 0;
+  scores = 0;
+  visits = 0;
+  prunes.clear();
+}
+
+size_t TraversalStatistics::Prunes() const
+{
+  size_t sum = 0;
+  for (size_t i = 0; i < prunes.size(); ++i)
+    sum += prunes[i];
+  return sum;
+}
+
+void TraversalStatistics::Record(const TraversalStatistics& statistics)
+{
+  #pragma omp critical(mlpack_traversal_statistics)
+  total.Merge(statistics);
+}
+
+TraversalStatistics TraversalStatistics::Total()
+{
+  TraversalStatistics result;
+  #pragma omp critical(mlpack_traversal_statistics)
+  result = total;
+  return result;
+}
+
+void TraversalStatistics::ResetTotal()
+{
+  #pragma omp critical(mlpack_traversal_statistics)
+  total.Reset();
+}
+
+#endif
@@ -0,0 +1,148 @@
+/**
+ * @file traversal_statistics.hpp
+ *
+ * Counters of the work done by a tree traversal (base cases, scores, node
+ * visits, and prunes by level), collected by every traverser when mlpack is
+ * compiled with MLPACK_TRAVERSAL_STATISTICS.
+ */
+#ifndef __MLPACK_CORE_TREE_TRAVERSAL_STATISTICS_HPP
+#define __MLPACK_CORE_TREE_TRAVERSAL_STATISTICS_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace mlpack {
+namespace tree {
+
+#ifdef MLPACK_TRAVERSAL_STATISTICS
+
+/**
+ * The TraversalStatistics class counts what a tree traversal did, in the same
+ * way for every tree type and every rule set:
+ *
+ *  - the number of base cases (calls to RuleType::BaseCase()),
+ *  - the number of scores (calls to RuleType::Score()),
+ *  - the number of visits (node combinations, or nodes for a single-tree
+ *    traversal, that the traversal descended into),
+ *  - the number of prunes, by the level of the pruned reference node (its
+ *    depth in the reference tree, where the root is at level 0).
+ *
+ * Each traverser holds one of these, available through its Statistics()
+ * method, and adds it to a process-wide total when it is destroyed.  The total
+ * (see Total()) is printed beside the timers by the command-line programs when
+ * --verbose is given, which makes it easy to compare leaf sizes and tree types
+ * on a dataset.
+ *
+ * The counters are only compiled in when MLPACK_TRAVERSAL_STATISTICS is
+ * defined (with the CMake option TRAVERSAL_STATISTICS).  Otherwise, this class
+ * is empty, every counting method does nothing, and every counter is 0, so the
+ * traversals cost exactly what they cost without instrumentation.
+ */
+class TraversalStatistics
+{
+ public:
+  //! Whether the counters are compiled in.
+  static const bool Enabled = true;
+
+  //! Create the statistics, with all counters at 0.
+  TraversalStatistics() : baseCases(0), scores(0), visits(0) { }
+
+  //! Count the given number of base cases.
+  void AddBaseCases(const size_t n) { baseCases += n; }
+  //! Count the given number of scores.
+  void AddScores(const size_t n) { scores += n; }
+  //! Count one visit.
+  void AddVisit() { ++visits; }
+
+  /**
+   * Count the given number of prunes of the given reference node (or of nodes
+   * at the same level as it).  The level is found by walking up the tree.
+   */
+  template<typename TreeType>
+  void AddPrunes(const TreeType& node, const size_t n = 1)
+  {
+    size_t level = 0;
+    for (const TreeType* p = node.Parent(); p != NULL; p = p->Parent())
+      ++level;
+
+    if (level >= prunes.size())
+      prunes.resize(level + 1, 0);
+    prunes[level] += n;
+  }
+
+  //! Add the counters of another object to these.
+  void Merge(const TraversalStatistics& other);
+  //! Set all counters to 0.
+  void Reset();
+
+  //! Get the number of base cases.
+  size_t BaseCases() const { return baseCases; }
+  //! Get the number of scores.
+  size_t Scores() const { return scores; }
+  //! Get the number of visits.
+  size_t Visits() const { return visits; }
+  //! Get the total number of prunes.
+  size_t Prunes() const;
+  //! Get the number of prunes at each level of the reference tree.
+  const std::vector<size_t>& PrunesByLevel() const { return prunes; }
+
+  //! Add the given statistics to the process-wide total (thread-safe).
+  static void Record(const TraversalStatistics& statistics);
+  //! Get the process-wide total of all recorded statistics.
+  static TraversalStatistics Total();
+  //! Reset the process-wide total.
+  static void ResetTotal();
+
+ private:
+  //! The number of base cases.
+  size_t baseCases;
+  //! The number of scores.
+  size_t scores;
+  //! The number of visits.
+  size_t visits;
+  //! The number of prunes at each level.
+  std::vector<size_t> prunes;
+};
+
+#else
+
+/**
+ * The TraversalStatistics class without counters, used when mlpack is not
+ * compiled with MLPACK_TRAVERSAL_STATISTICS.  It has the same interface as the
+ * real one, but all its methods do nothing and all counters are 0.
+ */
+class TraversalStatistics
+{
+ public:
+  static const bool Enabled = false;
+
+  void AddBaseCases(const size_t /* n */) { }
+  void AddScores(const size_t /* n */) { }
+  void AddVisit() { }
+  template<typename TreeType>
+  void AddPrunes(const TreeType& /* node */, const size_t /* n */ = 1) { }
+
+  void Merge(const TraversalStatistics& /* other */) { }
+  void Reset() { }
+
+  size_t BaseCases() const { return 0; }
+  size_t Scores() const { return 0; }
+  size_t Visits() const { return 0; }
+  size_t Prunes() const { return 0; }
+  const std::vector<size_t>& PrunesByLevel() const
+  {
+    static const std::vector<size_t> empty;
+    return empty;
+  }
+
+  static void Record(const TraversalStatistics& /* statistics */) { }
+  static TraversalStatistics Total() { return TraversalStatistics(); }
+  static void ResetTotal() { }
+};
+
+#endif
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
@@ -15,6 +15,14 @@
 #include "log.hpp"
 
 #include "option.hpp"
+#include "huge_pages.hpp"
+#include "memory_usage.hpp"
+#include "numa.hpp"
+#include "trace.hpp"
+#include "parallel.hpp"
+
+#include "../tree/traversal_statistics.hpp"
+#include "../kernels/kernel_cache.hpp"
 
 using namespace mlpack;
 using namespace mlpack::util;
@@ -57,6 +65,9 @@ CLI::~CLI()
   // Terminate the program timer.
   Timer::Stop("total_time");
 
+  // Write the trace, if one was recorded.
+  Trace::Close();
+
   // Did the user ask for verbose output?  If so we need to print everything.
   // But only if the user did not ask for help or info.
   if (HasParam("verbose") && !HasParam("help") && !HasParam("info"))
@@ -73,6 +84,78 @@ CLI::~CLI()
       Log::Info << "  " << i << ": ";
       timer.PrintTimer((*it).first);
     }
+
+    // The scoped timers are only printed if they were used.
+    for (size_t i = 0; i < ScopedTimer::NumTimers(); ++i)
+    {
+      const TimerStatistics statistics = ScopedTimer::Statistics(i);
+      if (statistics.count == 0)
+        continue;
+
+      Log::Info << "  " << ScopedTimer::Name(i) << ": " << statistics.total
+          << "s (" << statistics.count << " scopes; min " << statistics.min
+          << "s, mean " << statistics.Mean() << "s, max " << statistics.max
+          << "s)" << std::endl;
+    }
+
+    // The peak memory in huge pages shows whether --huge_pages worked.
+    Log::Info << "Memory:" << std::endl;
+    Log::Info << "  peak usage: " << MemoryUsage::Format(PeakMemory())
+        << std::endl;
+    if (HugePages())
+    {
+      SampleHugePageMemory();
+      Log::Info << "  peak in huge pages: "
+          << MemoryUsage::Format(PeakHugePageMemory()) << std::endl;
+    }
+
+    // The memory accounts are only printed if they were used.
+    if (MemoryUsage::Peak() > 0)
+    {
+      Log::Info << "  peak of all accounts: "
+          << MemoryUsage::Format(MemoryUsage::Peak()) << std::endl;
+    }
+    for (size_t i = 0; i < MemoryUsage::NumAccounts(); ++i)
+    {
+      const MemoryStatistics statistics = MemoryUsage::Statistics(i);
+      if (statistics.count == 0)
+        continue;
+
+      Log::Info << "  " << MemoryUsage::Name(i) << ": peak "
+          << MemoryUsage::Format(statistics.peak) << " ("
+          << MemoryUsage::Format(statistics.total) << " in "
+          << statistics.count << " allocations)" << std::endl;
+    }
+
+    // The tree traversal statistics are only printed if they were compiled in
+    // and some traversal was done.
+    const tree::TraversalStatistics traversals =
+        tree::TraversalStatistics::Total();
+    if (traversals.Visits() > 0)
+    {
+      Log::Info << "Tree traversals:" << std::endl;
+      Log::Info << "  base cases: " << traversals.BaseCases() << std::endl;
+      Log::Info << "  scores: " << traversals.Scores() << std::endl;
+      Log::Info << "  visits: " << traversals.Visits() << std::endl;
+      Log::Info << "  prunes: " << traversals.Prunes() << std::endl;
+      for (size_t i = 0; i < traversals.PrunesByLevel().size(); ++i)
+      {
+        Log::Info << "    level " << i << ": "
+            << traversals.PrunesByLevel()[i] << std::endl;
+      }
+    }
+
+    // The kernel caches are only printed if one was used.
+    const size_t cacheHits = kernel::KernelCache::TotalHits();
+    const size_t cacheMisses = kernel::KernelCache::TotalMisses();
+    if (cacheHits + cacheMisses > 0)
+    {
+      Log::Info << "Kernel caches:" << std::endl;
+      Log::Info << "  hits: " << cacheHits << std::endl;
+      Log::Info << "  misses: " << cacheMisses << std::endl;
+      Log::Info << "  hit rate: " << (100.0 * cacheHits) /
+          (cacheHits + cacheMisses) << "%" << std::endl;
+    }
   }
 
   // Notify the user if we are debugging, but only if we actually parsed the
@@ -81,6 +164,9 @@ CLI::~CLI()
   if (didParse)
     Log::Debug << "Compiled with debugging symbols." << std::endl;
 
+  // If the output was written by a background thread, write what is left.
+  util::PrefixedOutStream::StopAsynchronousOutput();
+
   return;
 }
 
@@ -224,6 +310,36 @@ void CLI::DefaultMessages()
     Log::Info.ignoreInput = false;
   }
 
+  // Set the number of threads of every parallel algorithm.
+  if (HasParam("threads"))
+  {
+    const int threads = GetParam<int>("threads");
+    if (threads < 0)
+      Log::Fatal << "Invalid number of threads (" << threads << "); must be "
+          << "greater than or equal to 0." << std::endl;
+
+    SetNumThreads((size_t) threads);
+  }
+
+  // Pin the threads to cores, so that they stay on their NUMA nodes.
+  if (HasParam("pin_threads") && !PinThreads())
+    Log::Warn << "Threads cannot be pinned to cores on this system." << std::endl;
+
+  // Back large matrices, mapped files and tree nodes with huge pages.
+  if (HasParam("huge_pages"))
+    SetHugePages(true);
+
+  // Record a trace of the timers and tasks of each thread.
+  const std::string traceFile = GetParam<std::string>("trace_file");
+  if (traceFile != "")
+  {
+    if (!Trace::Open(traceFile))
+      Log::Warn << "Cannot write trace to '" << traceFile << "'." << std::endl;
+    else if (HasParam("trace_counters") && !Trace::EnableCounters())
+      Log::Warn << "Hardware counters are not available on this system."
+          << std::endl;
+  }
+
   // Notify the user if we are debugging.  This is not done in the constructor
   // because the output streams may not be set up yet.  We also don't want this
   // message twice if the user just asked for help or information.
@@ -742,3 +858,14 @@ PARAM_STRING("info", "Get help on a specific module or option.", "", "");
 PARAM_FLAG("verbose", "Display informational messages and the full list of "
     "parameters and timers at the end of execution.", "v");
 PARAM_FLAG("version", "Display the version of mlpack.", "V");
+PARAM_INT("threads", "Number of threads used by parallel algorithms (0 uses "
+    "all available threads).", "", 0);
+PARAM_FLAG("pin_threads", "Pin the threads used by parallel algorithms to "
+    "cores, so that each stays on its NUMA node.", "");
+PARAM_FLAG("huge_pages", "Back large matrices, mapped files and tree nodes "
+    "with huge pages.", "");
+PARAM_STRING("trace_file", "File to write a trace of the timers and parallel "
+    "tasks of each thread to, in the Chrome trace format (which Perfetto also "
+    "reads).", "", "");
+PARAM_FLAG("trace_counters", "Record hardware counters (cycles, instructions "
+    "and cache misses) for each region of the trace.", "");
@@ -0,0 +1,126 @@
+/**
+ * @file communicator.cpp
+ *
+ * Implementation of the FileCommunicator class.
+ */
+#include "communicator.hpp"
+#include <mlpack/core.hpp>
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+  #include <unistd.h>
+#else
+  #include <windows.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::util;
+
+//! Wait for a short while before looking for the files again.
+static void Pause()
+{
+#ifndef _WIN32
+  usleep(10000);
+#else
+  Sleep(10);
+#endif
+}
+
+FileCommunicator::FileCommunicator(const std::string& directory,
+                                   const size_t rank,
+                                   const size_t size,
+                                   const std::string& id,
+                                   const double timeout) :
+    directory(directory),
+    rank(rank),
+    size(size),
+    id(id),
+    timeout(timeout),
+    round(0)
+{
+  if (size == 0 || rank >= size)
+    Log::Fatal << "FileCommunicator: invalid rank " << rank << " of " << size
+        << " processes." << std::endl;
+
+  // The identifier is part of the file names, so it can't hold separators.
+  if (id.empty() || id.find_first_not_of("abcdefghijklmnopqrstuvwxyz"
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789._-") != std::string::npos)
+    Log::Fatal << "FileCommunicator: invalid identifier '" << id << "'; use "
+        << "letters, digits, '.', '_' and '-' only." << std::endl;
+
+  // The files of an earlier computation with the same identifier would be
+  // taken for the files of this one.
+  if (std::ifstream(FileName(0, rank).c_str()).good())
+    Log::Fatal << "FileCommunicator: '" << FileName(0, rank) << "' is left "
+        << "from an earlier computation with the identifier '" << id << "'; "
+        << "use another identifier." << std::endl;
+}
+
+void FileCommunicator::AllReduce(arma::mat& values)
+{
+  // Write the file under a temporary name first, so that the other processes
+  // only see it when it is complete.
+  const std::string name = FileName(round, rank);
+  const std::string temporary = name + ".tmp";
+  if (!values.save(temporary, arma::arma_binary) ||
+      std::rename(temporary.c_str(), name.c_str()) != 0)
+    Log::Fatal << "FileCommunicator::AllReduce(): cannot write '" << name
+        << "'." << std::endl;
+
+  // Add the matrices up in the order of the ranks, so that the sum is the same
+  // on every process.
+  arma::mat sum(values.n_rows, values.n_cols);
+  sum.zeros();
+  for (size_t r = 0; r < size; ++r)
+  {
+    if (r == rank)
+    {
+      sum += values;
+      continue;
+    }
+
+    const std::string otherName = FileName(round, r);
+    const std::time_t start = std::time(NULL);
+    while (!std::ifstream(otherName.c_str()).good())
+    {
+      if (std::difftime(std::time(NULL), start) > timeout)
+        Log::Fatal << "FileCommunicator::AllReduce(): process " << r
+            << " did not write '" << otherName << "' within " << timeout
+            << " seconds." << std::endl;
+      Pause();
+    }
+
+    arma::mat other;
+    if (!other.load(otherName, arma::arma_binary))
+      Log::Fatal << "FileCommunicator::AllReduce(): cannot read '"
+          << otherName << "'." << std::endl;
+    if (other.n_rows != values.n_rows || other.n_cols != values.n_cols)
+      Log::Fatal << "FileCommunicator::AllReduce(): process " << r << " gave a "
+          << other.n_rows << "x" << other.n_cols << " matrix, but this process "
+          << "gave a " << values.n_rows << "x" << values.n_cols << " matrix."
+          << std::endl;
+
+    sum += other;
+  }
+
+  values.swap(sum);
+
+  // Every process has written its file of this round, so every process has
+  // read all of the files of the last round.
+  if (round > 0)
+    std::remove(FileName(round - 1, rank).c_str());
+  ++round;
+}
+
+std::string FileCommunicator::FileName(const size_t fileRound,
+                                       const size_t fileRank) const
+{
+  std::ostringstream name;
+  name << directory << "/allreduce-" << id << "-" << size << "-" << fileRound
+      << "-" << fileRank << ".bin";
+  return name.str();
+}
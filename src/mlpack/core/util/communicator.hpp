@@ -0,0 +1,136 @@
+/**
+ * @file communicator.hpp
+ *
+ * Communicators, which sum matrices across the processes of a distributed
+ * computation (an allreduce): LocalCommunicator, for a single process, and
+ * FileCommunicator, which exchanges the matrices through files in a directory
+ * shared by all of the processes.
+ */
+#ifndef __MLPACK_CORE_UTIL_COMMUNICATOR_HPP
+#define __MLPACK_CORE_UTIL_COMMUNICATOR_HPP
+
+#include <mlpack/prereqs.hpp>
+
+namespace mlpack {
+namespace util {
+
+/**
+ * The communicator of a computation which runs in a single process: there is
+ * one rank, and AllReduce() leaves its argument as it is.
+ *
+ * A communicator class (like this one and FileCommunicator, or a wrapper
+ * around MPI_Allreduce()) must implement the following methods:
+ *
+ * @code
+ * // Get the index of this process (between 0 and Size() - 1).
+ * size_t Rank() const;
+ * // Get the number of processes.
+ * size_t Size() const;
+ * // Replace the given matrix with the sum of the matrices given by all of the
+ * // processes (which must all have the same size).  Every process must call
+ * // this the same number of times, in the same order, and every process gets
+ * // the same result, to the last bit.
+ * void AllReduce(arma::mat& values);
+ * @endcode
+ */
+class LocalCommunicator
+{
+ public:
+  //! Get the index of this process (always 0).
+  size_t Rank() const { return 0; }
+  //! Get the number of processes (always 1).
+  size_t Size() const { return 1; }
+  //! The sum over one process is the matrix itself.
+  void AllReduce(arma::mat& /* values */) { }
+};
+
+/**
+ * A communicator for processes which share a directory (for instance, on a
+ * network file system), but no other means of communication.  Each call to
+ * AllReduce() is a round: each process writes its matrix to a file of the
+ * round in the directory, waits for the files of all of the other processes,
+ * and adds them up in the order of the ranks, so that every process gets the
+ * same sum.  The files are written under a temporary name and then renamed,
+ * so a file is never read before it is complete; each process removes its file
+ * of a round once all of the processes have written the next round (so that
+ * they have all read it).
+ *
+ * Each round costs a few file operations per process, and the waiting is done
+ * by polling, so this is meant for computations with few, large rounds (like
+ * the iterations of distributed k-means), not for fine-grained communication.
+ *
+ * The names of the files hold an identifier of the computation, which all of
+ * its processes must be given, so that files left in the directory by an
+ * earlier computation (the files of its last round are not removed, and a
+ * computation which was stopped leaves more) are never read.  The identifier
+ * must be different for every computation which uses the directory; a job ID
+ * given by the scheduler which started the processes is a good choice.
+ *
+ * @code
+ * // On process 'rank' of 'size', with the same 'jobId' on every process:
+ * util::FileCommunicator communicator("/shared/kmeans", rank, size, jobId);
+ * arma::mat sums = ...;
+ * communicator.AllReduce(sums);
+ * @endcode
+ */
+class FileCommunicator
+{
+ public:
+  /**
+   * Create the communicator of one process.
+   *
+   * @param directory Directory shared by all of the processes.
+   * @param rank Index of this process (between 0 and size - 1).
+   * @param size Number of processes.
+   * @param id Identifier of the computation, the same for all of its processes
+   *     and different from that of any other computation using the directory
+   *     (letters, digits, '.', '_' and '-' only).
+   * @param timeout Number of seconds to wait for the other processes in each
+   *     round before a fatal error is issued (see Log::Fatal).
+   */
+  FileCommunicator(const std::string& directory,
+                   const size_t rank,
+                   const size_t size,
+                   const std::string& id,
+                   const double timeout = 86400.0);
+
+  //! Get the index of this process.
+  size_t Rank() const { return rank; }
+  //! Get the number of processes.
+  size_t Size() const { return size; }
+  //! Get the identifier of the computation.
+  const std::string& ID() const { return id; }
+  //! Get the number of rounds done so far.
+  size_t Rounds() const { return round; }
+
+  /**
+   * Replace the given matrix with the sum of the matrices given by all of the
+   * processes in this round.  If another process does not write its file in
+   * time, or gives a matrix of another size, a fatal error is issued.
+   *
+   * @param values Matrix to sum.
+   */
+  void AllReduce(arma::mat& values);
+
+ private:
+  //! Get the name of the file of the given process in the given round.
+  std::string FileName(const size_t fileRound, const size_t fileRank) const;
+
+  //! The shared directory.
+  std::string directory;
+  //! The index of this process.
+  size_t rank;
+  //! The number of processes.
+  size_t size;
+  //! The identifier of the computation.
+  std::string id;
+  //! The number of seconds to wait for the other processes.
+  double timeout;
+  //! The number of rounds done so far.
+  size_t round;
+};
+
+}; // namespace util
+}; // namespace mlpack
+
+#endif
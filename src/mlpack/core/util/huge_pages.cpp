@@ -0,0 +1,215 @@
+/**
+ * @file huge_pages.cpp
+ *
+ * Implementation of the huge page functions.
+ */
+#include "huge_pages.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifndef _WIN32
+  #include <sys/mman.h>
+  #include <sys/resource.h>
+  #include <stdint.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::util;
+
+// Whether large buffers are backed with huge pages.
+static bool hugePagesEnabled = false;
+
+// The largest amount of memory found in huge pages by SampleHugePageMemory().
+static size_t peakHugePageMemory = 0;
+
+void mlpack::util::SetHugePages(const bool enabled)
+{
+  hugePagesEnabled = enabled;
+}
+
+bool mlpack::util::HugePages()
+{
+  return hugePagesEnabled;
+}
+
+//! Get the sum of the values (in kB) of the given fields of a /proc file, over
+//! all of the lines they appear on; return whether any was found.
+static bool ReadProcFields(const char* filename,
+                           const char* const* fields,
+                           const size_t numFields,
+                           size_t& kilobytes)
+{
+  std::ifstream file(filename);
+  if (!file)
+    return false;
+
+  bool found = false;
+  kilobytes = 0;
+  std::string line;
+  while (std::getline(file, line))
+  {
+    for (size_t i = 0; i < numFields; ++i)
+    {
+      const std::string field(fields[i]);
+      if (line.compare(0, field.size(), field) != 0)
+        continue;
+
+      std::istringstream value(line.substr(field.size()));
+      size_t size;
+      if (value >> size)
+      {
+        kilobytes += size;
+        found = true;
+      }
+    }
+  }
+
+  return found;
+}
+
+size_t mlpack::util::HugePageSize()
+{
+  static size_t size = 0;
+  if (size == 0)
+  {
+    const char* field = "Hugepagesize:";
+    size_t kilobytes;
+    const bool found = ReadProcFields("/proc/meminfo", &field, 1, kilobytes);
+    size = (found && kilobytes > 0) ? 1024 * kilobytes : 2 * 1024 * 1024;
+  }
+
+  return size;
+}
+
+bool mlpack::util::AdviseHugePages(const void* memory, const size_t size)
+{
+#if !defined(_WIN32) && defined(MADV_HUGEPAGE)
+  if (!hugePagesEnabled || memory == NULL)
+    return false;
+
+  // madvise() needs page-aligned memory, and only whole huge pages can be
+  // backed by huge pages anyway.
+  const uintptr_t pageSize = HugePageSize();
+  const uintptr_t begin = ((uintptr_t) memory + pageSize - 1) / pageSize *
+      pageSize;
+  const uintptr_t end = ((uintptr_t) memory + size) / pageSize * pageSize;
+  if (end <= begin)
+    return false;
+
+  return (madvise((void*) begin, end - begin, MADV_HUGEPAGE) == 0);
+#else
+  (void) memory;
+  (void) size;
+  return false;
+#endif
+}
+
+//! Round the given size up to a whole number of huge pages.
+static size_t HugePageRound(const size_t size)
+{
+  const size_t pageSize = HugePageSize();
+  return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+void* mlpack::util::AllocateHugePages(const size_t size)
+{
+#if !defined(_WIN32) && defined(MADV_HUGEPAGE)
+  if (!hugePagesEnabled || size == 0)
+    return NULL;
+
+  // Both kinds of mapping are the same (rounded) size, so FreeHugePages()
+  // doesn't need to know which one was made.
+  const size_t length = HugePageRound(size);
+
+  #ifdef MAP_HUGETLB
+  void* memory = mmap(NULL, length, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (memory != MAP_FAILED)
+    return memory;
+  #endif
+
+  // The explicit pool is empty (or too small), so use transparent huge pages.
+  // The mapping is only aligned to normal pages, so its first and last huge
+  // page may be normal pages.
+  void* mapping = mmap(NULL, length, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED)
+    return NULL;
+
+  AdviseHugePages(mapping, length);
+  return mapping;
+#else
+  (void) size;
+  return NULL;
+#endif
+}
+
+void mlpack::util::FreeHugePages(void* memory, const size_t size)
+{
+#ifndef _WIN32
+  if (memory != NULL)
+  {
+    SampleHugePageMemory();
+    munmap(memory, HugePageRound(size));
+  }
+#else
+  (void) memory;
+  (void) size;
+#endif
+}
+
+size_t mlpack::util::PeakMemory()
+{
+#ifndef _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+
+  #ifdef __APPLE__
+  return (size_t) usage.ru_maxrss; // In bytes.
+  #else
+  return 1024 * (size_t) usage.ru_maxrss; // In kB.
+  #endif
+#else
+  return 0;
+#endif
+}
+
+size_t mlpack::util::HugePageMemory()
+{
+  // The summary of all mappings is much shorter to read, but only newer
+  // kernels have it.
+  const char* filename = "/proc/self/smaps_rollup";
+  if (!std::ifstream(filename))
+    filename = "/proc/self/smaps";
+
+  const char* fields[] = { "AnonHugePages:", "ShmemPmdMapped:",
+      "FilePmdMapped:", "Shared_Hugetlb:", "Private_Hugetlb:" };
+  size_t kilobytes;
+  if (!ReadProcFields(filename, fields, sizeof(fields) / sizeof(fields[0]),
+      kilobytes))
+    return 0;
+
+  return 1024 * kilobytes;
+}
+
+void mlpack::util::SampleHugePageMemory()
+{
+  if (!hugePagesEnabled)
+    return;
+
+  const size_t memory = HugePageMemory();
+
+  #pragma omp critical(mlpack_huge_page_memory)
+  {
+    if (memory > peakHugePageMemory)
+      peakHugePageMemory = memory;
+  }
+}
+
+size_t mlpack::util::PeakHugePageMemory()
+{
+  return peakHugePageMemory;
+}
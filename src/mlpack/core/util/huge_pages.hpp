@@ -0,0 +1,99 @@
+/**
+ * @file huge_pages.hpp
+ *
+ * Backing large buffers (the elements of loaded matrices, mapped files and
+ * the node arenas of trees) with huge pages, and reporting how much memory was
+ * used.
+ *
+ * A search which reads a large dataset or tree in random order misses the TLB
+ * on nearly every access with normal 4 KB pages; with 2 MB pages the TLB
+ * covers 512 times as much memory.  Huge pages are off by default, and are
+ * turned on with SetHugePages() (or the --huge_pages option of the
+ * command-line programs).  When they are on, buffers of at least
+ * HugePageSize() bytes are advised to use transparent huge pages, and node
+ * arenas are allocated from the explicit huge page pool (see
+ * /proc/sys/vm/nr_hugepages) if it has room, and otherwise from transparent
+ * huge pages.
+ *
+ * Huge pages are only available on Linux; elsewhere these functions do
+ * nothing.
+ */
+#ifndef __MLPACK_CORE_UTIL_HUGE_PAGES_HPP
+#define __MLPACK_CORE_UTIL_HUGE_PAGES_HPP
+
+#include <cstddef>
+
+namespace mlpack {
+namespace util {
+
+/**
+ * Set whether large buffers are backed with huge pages.  This only affects
+ * buffers allocated (or matrices loaded) afterwards.
+ *
+ * @param enabled Whether to use huge pages.
+ */
+void SetHugePages(const bool enabled);
+
+//! Get whether large buffers are backed with huge pages.
+bool HugePages();
+
+//! Get the size of a huge page, in bytes (2 MB if it cannot be found).
+size_t HugePageSize();
+
+/**
+ * Advise the kernel to back the given memory with transparent huge pages, if
+ * huge pages are enabled.  Only the whole huge pages inside the memory are
+ * advised, so this does nothing for buffers smaller than HugePageSize().
+ * Memory which has not been written yet gets huge pages when it is first
+ * written; memory already in use is collapsed into huge pages later by the
+ * kernel.
+ *
+ * @param memory Start of the memory.
+ * @param size Size of the memory, in bytes.
+ * @return Whether any memory was advised.
+ */
+bool AdviseHugePages(const void* memory, const size_t size);
+
+/**
+ * Allocate memory backed by huge pages: from the explicit huge page pool if
+ * it has room, and otherwise with transparent huge pages.  The memory must be
+ * freed with FreeHugePages().  NULL is returned if huge pages are disabled or
+ * unavailable, or if the memory cannot be allocated, so that the caller can
+ * allocate normally instead.
+ *
+ * @param size Number of bytes to allocate.
+ */
+void* AllocateHugePages(const size_t size);
+
+/**
+ * Free memory allocated with AllocateHugePages().
+ *
+ * @param memory Memory to free.
+ * @param size Number of bytes that were allocated.
+ */
+void FreeHugePages(void* memory, const size_t size);
+
+//! Get the largest amount of memory the process has used so far (its peak
+//! resident set size), in bytes (0 if it cannot be found).
+size_t PeakMemory();
+
+//! Get the amount of memory the process currently has in huge pages (both
+//! transparent and explicit), in bytes (0 if it cannot be found).
+size_t HugePageMemory();
+
+/**
+ * If huge pages are enabled, find the amount of memory the process currently
+ * has in huge pages, so that PeakHugePageMemory() includes it.  This is done
+ * after a matrix is loaded and before memory from AllocateHugePages() is
+ * freed, which is when most of the data is in memory.
+ */
+void SampleHugePageMemory();
+
+//! Get the largest amount of memory found in huge pages by
+//! SampleHugePageMemory(), in bytes.
+size_t PeakHugePageMemory();
+
+}; // namespace util
+}; // namespace mlpack
+
+#endif
@@ -45,6 +45,11 @@ namespace mlpack {
  * mode.  Messages to Log::Info will only be shown when the --verbose flag is
  * given to the program (or rather, the CLI class).
  *
+ * The streams can be used from inside OpenMP parallel regions: each thread's
+ * lines are buffered and written whole.  To keep threads from waiting on the
+ * terminal, call util::PrefixedOutStream::StartAsynchronousOutput(); the CLI
+ * class stops the background thread at the end of the program.
+ *
  * @see PrefixedOutStream, NullOutStream, CLI
  */
 class Log
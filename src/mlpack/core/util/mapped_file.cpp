@@ -0,0 +1,118 @@
+/**
+ * @file mapped_file.cpp
+ *
+ * Implementation of the MappedFile class.
+ */
+#include "mapped_file.hpp"
+#include "log.hpp"
+#include "huge_pages.hpp"
+
+#include <fstream>
+
+#ifndef _WIN32
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::util;
+
+MappedFile::MappedFile() :
+    data(NULL),
+    size(0),
+    mapped(false)
+{
+  // Nothing to do.
+}
+
+MappedFile::MappedFile(const std::string& filename) :
+    filename(filename),
+    data(NULL),
+    size(0),
+    mapped(false)
+{
+#ifndef _WIN32
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+  {
+    Log::Fatal << "Cannot open file '" << filename << "' for mapping."
+        << std::endl;
+  }
+
+  struct stat fileInfo;
+  if (fstat(fd, &fileInfo) == -1)
+  {
+    close(fd);
+    Log::Fatal << "Cannot determine size of file '" << filename << "'."
+        << std::endl;
+  }
+
+  size = (size_t) fileInfo.st_size;
+  if (size > 0)
+  {
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+      close(fd);
+      Log::Fatal << "Cannot map file '" << filename << "' into memory."
+          << std::endl;
+    }
+
+    data = (const char*) mapping;
+    mapped = true;
+
+    // Large files are read in random order by tree searches, so use huge
+    // pages for them if they are enabled (and the filesystem supports it).
+    AdviseHugePages(data, size);
+  }
+
+  // The mapping stays valid after the file descriptor is closed.
+  close(fd);
+#else
+  // There is no mmap(), so just read the whole file.  We use a buffer of
+  // doubles so that the data is suitably aligned.
+  std::ifstream stream(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!stream.is_open())
+  {
+    Log::Fatal << "Cannot open file '" << filename << "' for mapping."
+        << std::endl;
+  }
+
+  stream.seekg(0, std::ios::end);
+  size = (size_t) stream.tellg();
+  stream.seekg(0, std::ios::beg);
+
+  buffer.resize((size + sizeof(double) - 1) / sizeof(double));
+  if (size > 0)
+  {
+    stream.read((char*) &buffer[0], size);
+    data = (const char*) &buffer[0];
+  }
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+  if (mapped)
+    munmap((void*) data, size);
+#endif
+}
+
+void MappedFile::Assign(const std::string& filename,
+                        std::vector<double>& contents,
+                        const size_t size)
+{
+#ifndef _WIN32
+  if (mapped)
+    munmap((void*) data, this->size);
+#endif
+
+  this->filename = filename;
+  buffer.swap(contents);
+  this->size = size;
+  data = (size > 0) ? (const char*) &buffer[0] : NULL;
+  mapped = false;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file mapped_file.hpp
+ *
+ * Declaration of the MappedFile class, which maps a file into memory
+ * read-only so that large arrays stored in it can be used without copying.
+ */
+#ifndef __MLPACK_CORE_UTIL_MAPPED_FILE_HPP
+#define __MLPACK_CORE_UTIL_MAPPED_FILE_HPP
+
+#include <string>
+#include <vector>
+
+namespace mlpack {
+namespace util {
+
+/**
+ * A read-only view of the contents of a file.  On POSIX systems the file is
+ * mapped into memory with mmap(), so that opening even a very large file is
+ * fast, pages are only read from disk when they are used, and several
+ * processes mapping the same file share the same physical pages.  On other
+ * systems the file is simply read into memory.
+ *
+ * The data is at least 8-byte aligned, so arrays of doubles or size_ts stored
+ * at 8-byte aligned offsets in the file can be used in place (for instance, as
+ * the auxiliary memory of an Armadillo matrix).
+ */
+class MappedFile
+{
+ public:
+  //! Create an empty MappedFile, which does not map anything.
+  MappedFile();
+
+  /**
+   * Map the given file.  If the file cannot be opened or mapped, a fatal error
+   * is issued (see Log::Fatal).
+   *
+   * @param filename Name of the file to map.
+   */
+  MappedFile(const std::string& filename);
+
+  //! Unmap the file.
+  ~MappedFile();
+
+  /**
+   * Replace the contents with the given data (such as the decompressed
+   * contents of the named file) instead of a mapping.  The given buffer is
+   * swapped into the MappedFile (and so left with the previous buffer); its
+   * first size bytes are the contents.  A buffer of doubles is used so that
+   * the data is suitably aligned.
+   *
+   * @param filename Name of the file the data came from (for messages).
+   * @param contents Buffer holding the data.
+   * @param size Size of the data in bytes.
+   */
+  void Assign(const std::string& filename,
+              std::vector<double>& contents,
+              const size_t size);
+
+  //! Get the contents of the file (NULL if nothing is mapped).
+  const char* Data() const { return data; }
+  //! Get the size of the file in bytes.
+  size_t Size() const { return size; }
+  //! Get the name of the mapped file.
+  const std::string& Filename() const { return filename; }
+
+ private:
+  //! Copying is not allowed (the file would be unmapped twice).
+  MappedFile(const MappedFile& other);
+  //! Copying is not allowed (the file would be unmapped twice).
+  MappedFile& operator=(const MappedFile& other);
+
+  //! The name of the mapped file.
+  std::string filename;
+  //! The contents of the file.
+  const char* data;
+  //! The size of the file in bytes.
+  size_t size;
+  //! If the file could not be mapped (or the contents were given with
+  //! Assign()), this holds its contents instead.
+  std::vector<double> buffer;
+  //! Whether data is a mapping (which must be unmapped).
+  bool mapped;
+};
+
+}; // namespace util
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,169 @@
+/**
+ * @file memory_usage.cpp
+ *
+ * Implementation of the MemoryUsage class.
+ */
+#include "memory_usage.hpp"
+
+#include <cstdio>
+#include <vector>
+
+using namespace mlpack;
+
+//! The registered accounts.
+struct Accounts
+{
+  Accounts() : current(0), peak(0) { }
+
+  //! The name of each account.
+  std::vector<std::string> names;
+  //! The statistics of each account.
+  std::vector<MemoryStatistics> statistics;
+  //! The number of bytes in use by all of the accounts.
+  size_t current;
+  //! The largest number of bytes in use by all of the accounts at once.
+  size_t peak;
+};
+
+//! Get the registered accounts (created when they are first used, so that
+//! accounts can be registered during static initialization).
+static Accounts& GetAccounts()
+{
+  static Accounts accounts;
+  return accounts;
+}
+
+size_t MemoryUsage::Register(const std::string& name)
+{
+  Accounts& accounts = GetAccounts();
+  size_t handle;
+
+  #pragma omp critical(mlpack_memory_usage)
+  {
+    for (handle = 0; handle < accounts.names.size(); ++handle)
+      if (accounts.names[handle] == name)
+        break;
+
+    if (handle == accounts.names.size())
+    {
+      const MemoryStatistics empty = { 0, 0, 0, 0 };
+      accounts.names.push_back(name);
+      accounts.statistics.push_back(empty);
+    }
+  }
+
+  return handle;
+}
+
+void MemoryUsage::Allocate(const size_t handle, const size_t bytes)
+{
+  Accounts& accounts = GetAccounts();
+
+  #pragma omp critical(mlpack_memory_usage)
+  {
+    MemoryStatistics& statistics = accounts.statistics[handle];
+    statistics.current += bytes;
+    statistics.total += bytes;
+    ++statistics.count;
+    if (statistics.current > statistics.peak)
+      statistics.peak = statistics.current;
+
+    accounts.current += bytes;
+    if (accounts.current > accounts.peak)
+      accounts.peak = accounts.current;
+  }
+}
+
+void MemoryUsage::Free(const size_t handle, const size_t bytes)
+{
+  Accounts& accounts = GetAccounts();
+
+  #pragma omp critical(mlpack_memory_usage)
+  {
+    accounts.statistics[handle].current -= bytes;
+    accounts.current -= bytes;
+  }
+}
+
+MemoryStatistics MemoryUsage::Statistics(const size_t handle)
+{
+  Accounts& accounts = GetAccounts();
+  MemoryStatistics statistics;
+
+  #pragma omp critical(mlpack_memory_usage)
+  statistics = accounts.statistics[handle];
+
+  return statistics;
+}
+
+size_t MemoryUsage::Current()
+{
+  size_t current;
+
+  #pragma omp critical(mlpack_memory_usage)
+  current = GetAccounts().current;
+
+  return current;
+}
+
+size_t MemoryUsage::Peak()
+{
+  size_t peak;
+
+  #pragma omp critical(mlpack_memory_usage)
+  peak = GetAccounts().peak;
+
+  return peak;
+}
+
+void MemoryUsage::ResetPeak()
+{
+  Accounts& accounts = GetAccounts();
+
+  #pragma omp critical(mlpack_memory_usage)
+  {
+    for (size_t i = 0; i < accounts.statistics.size(); ++i)
+      accounts.statistics[i].peak = accounts.statistics[i].current;
+    accounts.peak = accounts.current;
+  }
+}
+
+std::string MemoryUsage::Name(const size_t handle)
+{
+  std::string name;
+
+  #pragma omp critical(mlpack_memory_usage)
+  name = GetAccounts().names[handle];
+
+  return name;
+}
+
+size_t MemoryUsage::NumAccounts()
+{
+  size_t accounts;
+
+  #pragma omp critical(mlpack_memory_usage)
+  accounts = GetAccounts().names.size();
+
+  return accounts;
+}
+
+std::string MemoryUsage::Format(const size_t bytes)
+{
+  const char* units[] = { "B", "kB", "MB", "GB", "TB" };
+  double value = (double) bytes;
+  size_t unit = 0;
+  while (value >= 1024.0 && unit < 4)
+  {
+    value /= 1024.0;
+    ++unit;
+  }
+
+  char buffer[32];
+  if (unit == 0)
+    sprintf(buffer, "%lu B", (unsigned long) bytes);
+  else
+    sprintf(buffer, "%.1f %s", value, units[unit]);
+
+  return buffer;
+}
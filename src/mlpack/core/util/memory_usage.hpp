@@ -0,0 +1,135 @@
+/**
+ * @file memory_usage.hpp
+ *
+ * Accounting of the memory used by the major phases of mlpack's algorithms
+ * (tree nodes, search results, kernel matrices, model parameters), reported
+ * with the timers at the end of the program.
+ */
+#ifndef __MLPACK_CORE_UTIL_MEMORY_USAGE_HPP
+#define __MLPACK_CORE_UTIL_MEMORY_USAGE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace mlpack {
+
+/**
+ * The statistics of a memory account (see MemoryUsage), in bytes.
+ */
+struct MemoryStatistics
+{
+  //! The number of bytes currently in use.
+  size_t current;
+  //! The largest number of bytes in use at once.
+  size_t peak;
+  //! The total number of bytes allocated.
+  size_t total;
+  //! The number of allocations.
+  size_t count;
+};
+
+/**
+ * Named accounts of the memory used by the major phases of the algorithms.
+ * Unlike the peak resident set size of the process, the accounts tell which
+ * phase a job's memory went to.  An account is registered once by name, which
+ * gives a handle; then the algorithm tells the account when it allocates and
+ * frees its large buffers (directly, or with a ScopedMemory object for a
+ * buffer used by one scope).  Only large buffers are accounted, so the cost is
+ * negligible.  CLI prints the peak of every account that was used with the
+ * timers at the end of the program (with --verbose), along with the peak of
+ * all of the accounts together.
+ *
+ * All of the methods are thread-safe.
+ *
+ * @code
+ * static const size_t resultMemory = MemoryUsage::Register("search_results");
+ *
+ * ScopedMemory memory(resultMemory, k * n * sizeof(double));
+ * arma::mat distances(k, n);
+ * @endcode
+ */
+class MemoryUsage
+{
+ public:
+  /**
+   * Register the account with the given name, and return its handle.  If an
+   * account with this name is already registered, its handle is returned.
+   *
+   * @param name Name of the account.
+   */
+  static size_t Register(const std::string& name);
+
+  /**
+   * Record that the given number of bytes was allocated for the given account.
+   *
+   * @param handle Handle of the account (see Register()).
+   * @param bytes Number of bytes allocated.
+   */
+  static void Allocate(const size_t handle, const size_t bytes);
+
+  /**
+   * Record that the given number of bytes of the given account was freed.
+   *
+   * @param handle Handle of the account (see Register()).
+   * @param bytes Number of bytes freed.
+   */
+  static void Free(const size_t handle, const size_t bytes);
+
+  //! Get the statistics of the given account.
+  static MemoryStatistics Statistics(const size_t handle);
+
+  //! Get the number of bytes currently in use by all of the accounts.
+  static size_t Current();
+
+  //! Get the largest number of bytes in use by all of the accounts at once.
+  static size_t Peak();
+
+  /**
+   * Set the peak of each account, and of all of the accounts together, to the
+   * number of bytes currently in use, so that the peak of a phase (such as one
+   * benchmark) can be measured.
+   */
+  static void ResetPeak();
+
+  //! Get the name of the given account.
+  static std::string Name(const size_t handle);
+
+  //! Get the number of registered accounts; their handles are 0 to this - 1.
+  static size_t NumAccounts();
+
+  //! Format the given number of bytes for printing (like "12.5 MB").
+  static std::string Format(const size_t bytes);
+};
+
+/**
+ * An allocation of a memory account (see MemoryUsage) for the lifetime of the
+ * object, such as a buffer used by one scope.
+ */
+class ScopedMemory
+{
+ public:
+  /**
+   * Record the allocation of the given number of bytes for the given account.
+   *
+   * @param handle Handle of the account.
+   * @param bytes Number of bytes allocated.
+   */
+  ScopedMemory(const size_t handle, const size_t bytes) :
+      handle(handle), bytes(bytes)
+  {
+    MemoryUsage::Allocate(handle, bytes);
+  }
+
+  //! Record that the bytes were freed.
+  ~ScopedMemory() { MemoryUsage::Free(handle, bytes); }
+
+ private:
+  //! The handle of the account.
+  size_t handle;
+  //! The number of bytes allocated.
+  size_t bytes;
+};
+
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * @file numa.cpp
+ *
+ * Implementation of the NUMA topology functions and PinThreads().
+ */
+#include "numa.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+  #include <sched.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::util;
+
+//! The NUMA topology of the machine.
+struct Topology
+{
+  //! The number of nodes.
+  size_t nodes;
+  //! The node of each core (by its operating system number).
+  std::vector<size_t> nodeOfCpu;
+  //! The cores the process may run on, node by node, in the order PinThreads()
+  //! binds threads to them.
+  std::vector<int> pinOrder;
+};
+
+#ifdef __linux__
+//! Parse a list of numbers and ranges, like "0-3,8,10-11", as used by /sys.
+static std::vector<size_t> ParseList(const std::string& list)
+{
+  std::vector<size_t> values;
+  std::istringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ','))
+  {
+    size_t first, last;
+    char dash;
+    std::istringstream range(item);
+    if (!(range >> first))
+      continue;
+    if (!(range >> dash >> last) || dash != '-')
+      last = first;
+
+    for (size_t i = first; i <= last; ++i)
+      values.push_back(i);
+  }
+
+  return values;
+}
+#endif
+
+//! Read the topology of the machine (a single node if it can't be read).
+static Topology ReadTopology()
+{
+  Topology topology;
+  topology.nodes = 1;
+
+#ifdef __linux__
+  std::string line;
+  std::ifstream online("/sys/devices/system/node/online");
+  const std::vector<size_t> ids = (online && std::getline(online, line)) ?
+      ParseList(line) : std::vector<size_t>();
+
+  for (size_t n = 0; n < ids.size(); ++n)
+  {
+    std::ostringstream path;
+    path << "/sys/devices/system/node/node" << ids[n] << "/cpulist";
+    std::ifstream cpuList(path.str().c_str());
+    if (!cpuList || !std::getline(cpuList, line))
+      continue;
+
+    const std::vector<size_t> cpus = ParseList(line);
+    for (size_t i = 0; i < cpus.size(); ++i)
+    {
+      if (cpus[i] >= topology.nodeOfCpu.size())
+        topology.nodeOfCpu.resize(cpus[i] + 1, 0);
+      topology.nodeOfCpu[cpus[i]] = n;
+    }
+  }
+  if (!ids.empty())
+    topology.nodes = ids.size();
+
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+  {
+    for (size_t n = 0; n < topology.nodes; ++n)
+    {
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      {
+        const size_t node = ((size_t) cpu < topology.nodeOfCpu.size()) ?
+            topology.nodeOfCpu[cpu] : 0;
+        if (CPU_ISSET(cpu, &allowed) && node == n)
+          topology.pinOrder.push_back(cpu);
+      }
+    }
+  }
+#endif
+
+  return topology;
+}
+
+//! Get the topology of the machine, which is read once (before any thread is
+//! pinned, so the cores the process may run on are all known).
+static const Topology& GetTopology()
+{
+  static const Topology topology = ReadTopology();
+  return topology;
+}
+
+size_t mlpack::util::NumNodes()
+{
+  return GetTopology().nodes;
+}
+
+size_t mlpack::util::CurrentNode()
+{
+#ifdef __linux__
+  const Topology& topology = GetTopology();
+  const int cpu = sched_getcpu();
+  if (cpu >= 0 && (size_t) cpu < topology.nodeOfCpu.size())
+    return topology.nodeOfCpu[cpu];
+#endif
+
+  return 0;
+}
+
+bool mlpack::util::PinThreads(const size_t threads)
+{
+#if defined(_OPENMP) && defined(__linux__)
+  const Topology& topology = GetTopology();
+  if (topology.pinOrder.empty())
+    return false;
+
+  const size_t numThreads = NumThreads(threads);
+  bool failed = false;
+
+  #pragma omp parallel num_threads(numThreads) reduction(||:failed)
+  {
+    const size_t thread = omp_get_thread_num();
+    cpu_set_t core;
+    CPU_ZERO(&core);
+    CPU_SET(topology.pinOrder[thread % topology.pinOrder.size()], &core);
+    if (sched_setaffinity(0, sizeof(core), &core) != 0)
+      failed = true;
+  }
+
+  return !failed;
+#else
+  (void) threads;
+  return false;
+#endif
+}
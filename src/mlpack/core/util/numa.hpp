@@ -0,0 +1,140 @@
+/**
+ * @file numa.hpp
+ *
+ * Helpers for machines with several NUMA nodes (sockets with their own
+ * memory): the topology of the nodes, pinning threads to cores, placing
+ * matrices by first touch, and replicating read-only data on every node.
+ *
+ * Memory is placed on the node of the thread that first writes to it, so data
+ * built by one thread (such as a dataset loaded and a tree built before a
+ * parallel search) is on that thread's node, and threads on the other nodes
+ * pay remote-memory latency for every access.  These helpers let the threads
+ * of each node work on memory of their own.
+ *
+ * The topology is read from /sys on Linux; on other systems (or if it cannot
+ * be read) the machine is treated as a single node, and pinning threads does
+ * nothing.
+ */
+#ifndef __MLPACK_CORE_UTIL_NUMA_HPP
+#define __MLPACK_CORE_UTIL_NUMA_HPP
+
+#include <mlpack/core/arma_extend/arma_extend.hpp> // Includes Armadillo.
+#include <cstddef>
+#include <vector>
+
+namespace mlpack {
+namespace util {
+
+//! Get the number of NUMA nodes of the machine (1 if it cannot be found).
+size_t NumNodes();
+
+//! Get the NUMA node (from 0 to NumNodes() - 1) of the core the calling thread
+//! is running on.
+size_t CurrentNode();
+
+/**
+ * Pin the threads of the parallel regions of mlpack to cores: thread t of a
+ * team of the given number of threads is bound to the t'th core the process
+ * may run on (cores are taken node by node, so consecutive threads share a
+ * node).  OpenMP keeps its threads between parallel regions, so the threads
+ * stay pinned as long as regions use at most that many threads.  This is what
+ * the --pin_threads option of the command-line programs does.  (Setting
+ * OMP_PROC_BIND=close has the same effect.)
+ *
+ * @param threads Number of threads to pin (0 means NumThreads()).
+ * @return Whether the threads were pinned (false without OpenMP, or on systems
+ *     other than Linux).
+ */
+bool PinThreads(const size_t threads = 0);
+
+/**
+ * Copy the given matrix into dest in parallel, a block of columns per thread
+ * in the same order as a parallel loop over the columns with static
+ * scheduling, so that each block is placed on the node of the thread which
+ * copied it (if dest is newly allocated).  A later statically scheduled loop
+ * over the columns with the same number of (pinned) threads then only accesses
+ * memory on its own node.
+ *
+ * @param source Matrix to copy.
+ * @param dest Matrix to copy into.
+ * @param threads Number of threads to use (0 means NumThreads()).
+ */
+template<typename eT>
+void FirstTouchCopy(const arma::Mat<eT>& source,
+                    arma::Mat<eT>& dest,
+                    const size_t threads = 0);
+
+/**
+ * A copy of a read-only object (such as a reference set and its tree) on each
+ * NUMA node.  Build() makes the copies in a parallel region: the first thread
+ * found running on each node calls the factory, so the copy is allocated and
+ * written, and therefore placed, on that node.  The threads of a later
+ * parallel search then use the copy on their own node with Local().  Threads
+ * should be pinned (see PinThreads()) so that they stay on their nodes.
+ *
+ * @code
+ * struct CopyTree
+ * {
+ *   CopyTree(const TreeType& tree) : tree(tree) { }
+ *   TreeType* operator()() const { return new TreeType(tree); }
+ *   const TreeType& tree;
+ * };
+ *
+ * util::NodeReplicas<TreeType> replicas;
+ * CopyTree factory(*tree);
+ * replicas.Build(factory);
+ * // In each thread of the search:
+ * const TreeType& local = (replicas.Local() != NULL) ? *replicas.Local() :
+ *     *tree;
+ * @endcode
+ *
+ * @tparam T Type of the replicated object.
+ */
+template<typename T>
+class NodeReplicas
+{
+ public:
+  //! Create an empty set of replicas.
+  NodeReplicas() { }
+
+  //! Delete the replicas.
+  ~NodeReplicas() { Clear(); }
+
+  /**
+   * Make a copy on each node which has a thread in a team of the given number
+   * of threads.  The factory is a function object which returns a new T (or
+   * NULL, if no copy can be made); it is called by threads on different nodes
+   * at the same time, so it must be thread-safe.
+   *
+   * @param factory Function object making a copy.
+   * @param threads Number of threads to use (0 means NumThreads()).
+   */
+  template<typename FactoryType>
+  void Build(FactoryType& factory, const size_t threads = 0);
+
+  //! Get the copy on the node of the calling thread (NULL if there is none).
+  T* Local() const;
+
+  //! Return whether there are no copies.
+  bool Empty() const { return replicas.empty(); }
+
+  //! Delete the copies.
+  void Clear();
+
+ private:
+  //! Copying is not allowed (the replicas would be deleted twice).
+  NodeReplicas(const NodeReplicas& other);
+  //! Copying is not allowed (the replicas would be deleted twice).
+  NodeReplicas& operator=(const NodeReplicas& other);
+
+  //! The copy on each node (NULL for nodes without one).
+  std::vector<T*> replicas;
+};
+
+}; // namespace util
+}; // namespace mlpack
+
+// Include implementation.
+#include "numa_impl.hpp"
+
+#endif
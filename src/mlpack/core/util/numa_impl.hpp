@@ -0,0 +1,84 @@
+/**
+ * @file numa_impl.hpp
+ *
+ * Implementation of the templated NUMA helpers.
+ */
+#ifndef __MLPACK_CORE_UTIL_NUMA_IMPL_HPP
+#define __MLPACK_CORE_UTIL_NUMA_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "numa.hpp"
+
+#include "parallel.hpp"
+
+#include <cstring>
+
+namespace mlpack {
+namespace util {
+
+template<typename eT>
+void FirstTouchCopy(const arma::Mat<eT>& source,
+                    arma::Mat<eT>& dest,
+                    const size_t threads)
+{
+  dest.set_size(source.n_rows, source.n_cols);
+
+  const size_t numThreads = NumThreads(threads);
+  const size_t rows = source.n_rows;
+
+  #pragma omp parallel for schedule(static) num_threads(numThreads) \
+      if(numThreads > 1)
+  for (size_t c = 0; c < source.n_cols; ++c)
+    memcpy(dest.colptr(c), source.colptr(c), rows * sizeof(eT));
+}
+
+template<typename T>
+template<typename FactoryType>
+void NodeReplicas<T>::Build(FactoryType& factory, const size_t threads)
+{
+  Clear();
+  replicas.resize(NumNodes(), NULL);
+
+  const size_t numThreads = NumThreads(threads);
+  std::vector<char> claimed(replicas.size(), 0);
+
+  #pragma omp parallel num_threads(numThreads) if(numThreads > 1)
+  {
+    const size_t node = CurrentNode();
+    bool mine = false;
+
+    #pragma omp critical(node_replicas)
+    {
+      if (!claimed[node])
+      {
+        claimed[node] = 1;
+        mine = true;
+      }
+    }
+
+    if (mine)
+      replicas[node] = factory();
+  }
+}
+
+template<typename T>
+T* NodeReplicas<T>::Local() const
+{
+  if (replicas.empty())
+    return NULL;
+
+  return replicas[CurrentNode()];
+}
+
+template<typename T>
+void NodeReplicas<T>::Clear()
+{
+  for (size_t i = 0; i < replicas.size(); ++i)
+    delete replicas[i];
+  replicas.clear();
+}
+
+}; // namespace util
+}; // namespace mlpack
+
+#endif
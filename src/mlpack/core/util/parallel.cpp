@@ -0,0 +1,63 @@
+/**
+ * @file parallel.cpp
+ *
+ * Implementation of the thread settings shared by mlpack's parallel code.
+ */
+#include "parallel.hpp"
+
+using namespace mlpack;
+using namespace mlpack::util;
+
+// The number of threads set with SetNumThreads(), or 0 for the default.
+static size_t threadSetting = 0;
+#ifdef _OPENMP
+// The number of threads OpenMP allowed before SetNumThreads() was first
+// called, or 0 if it has not been called.
+static size_t defaultThreads = 0;
+#endif
+
+size_t mlpack::util::NumThreads()
+{
+  return NumThreads(0);
+}
+
+size_t mlpack::util::NumThreads(const size_t requested)
+{
+#ifdef _OPENMP
+  // A parallel region inside a parallel region would start a team of threads
+  // in each thread of the outer team.
+  if (omp_in_parallel())
+    return 1;
+
+  if (requested != 0)
+    return requested;
+
+  return (threadSetting != 0) ? threadSetting : (size_t) omp_get_max_threads();
+#else
+  (void) requested;
+  return 1;
+#endif
+}
+
+void mlpack::util::SetNumThreads(const size_t threads)
+{
+  threadSetting = threads;
+
+#ifdef _OPENMP
+  // Parallel regions which don't ask NumThreads() (in Armadillo or in user
+  // code) use the same number of threads.
+  if (defaultThreads == 0)
+    defaultThreads = (size_t) omp_get_max_threads();
+  omp_set_num_threads((int) ((threads != 0) ? threads : defaultThreads));
+#endif
+}
+
+void TaskGroup::Wait()
+{
+#ifdef _OPENMP
+  if (omp_in_parallel())
+  {
+    #pragma omp taskwait
+  }
+#endif
+}
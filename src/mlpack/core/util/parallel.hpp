@@ -0,0 +1,176 @@
+/**
+ * @file parallel.hpp
+ *
+ * The thread settings shared by all of mlpack's parallel code, and helpers to
+ * run loops, reductions and recursive tasks in parallel with OpenMP.
+ *
+ * Every parallel region in mlpack asks NumThreads() how many threads it may
+ * use.  This is the number set with SetNumThreads() (or the --threads option
+ * of the command-line programs), and 1 inside a region which is already
+ * running in parallel, so that nested parallel code (a parallel search called
+ * from a parallel loop, which builds trees in parallel) runs serially in the
+ * threads it is called from instead of starting more threads than there are
+ * cores.
+ *
+ * Without OpenMP, everything here runs serially in the calling thread.
+ */
+#ifndef __MLPACK_CORE_UTIL_PARALLEL_HPP
+#define __MLPACK_CORE_UTIL_PARALLEL_HPP
+
+#include <cstddef>
+#include <vector>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+namespace mlpack {
+namespace util {
+
+/**
+ * Get the number of threads a parallel region started now should use: 1 if
+ * the caller is already running in a parallel region, and otherwise the
+ * number of threads set with SetNumThreads() (by default, all the threads
+ * OpenMP allows).
+ */
+size_t NumThreads();
+
+/**
+ * Get the number of threads a parallel region started now should use, if the
+ * algorithm asked for the given number (0 means the default).  This is still 1
+ * if the caller is already running in a parallel region.
+ *
+ * @param requested Number of threads requested, or 0 for NumThreads().
+ */
+size_t NumThreads(const size_t requested);
+
+/**
+ * Set the number of threads the parallel regions of mlpack use.  0 restores
+ * the default, which is the number of threads OpenMP allows (usually the
+ * number of cores, or OMP_NUM_THREADS).
+ *
+ * @param threads Number of threads, or 0 for the default.
+ */
+void SetNumThreads(const size_t threads);
+
+/**
+ * Call function(i) for each i in [begin, end), in parallel.  The indices are
+ * handed out to the threads dynamically, so each should be a fair amount of
+ * work (a block of points rather than a single point); the function is shared
+ * by the threads, so calling it must be thread-safe.
+ *
+ * @code
+ * struct Normalize
+ * {
+ *   Normalize(arma::mat& data) : data(data) { }
+ *   void operator()(const size_t i) { data.col(i) /= norm(data.col(i), 2); }
+ *   arma::mat& data;
+ * };
+ *
+ * Normalize normalize(data);
+ * util::ParallelFor(0, data.n_cols, normalize);
+ * @endcode
+ *
+ * @param begin First index.
+ * @param end One past the last index.
+ * @param function Function to call with each index.
+ * @param threads Number of threads to use (0 means NumThreads()).
+ */
+template<typename FunctionType>
+void ParallelFor(const size_t begin,
+                 const size_t end,
+                 FunctionType& function,
+                 const size_t threads = 0);
+
+/**
+ * Compute a result from each i in [begin, end) in parallel and combine the
+ * results.  Each thread starts from a copy of the identity, calls
+ * function(i, partial) to add the result of index i to it, and the partial
+ * results of the threads are then added together with operator+=, in the order
+ * of the threads.  Which indices each thread handles is not fixed, so floating
+ * point results may differ slightly between runs.
+ *
+ * @param begin First index.
+ * @param end One past the last index.
+ * @param function Function adding the result of an index to a partial result.
+ * @param identity The result of an empty range (0 for a sum).
+ * @param threads Number of threads to use (0 means NumThreads()).
+ */
+template<typename ResultType, typename FunctionType>
+ResultType ParallelReduce(const size_t begin,
+                          const size_t end,
+                          FunctionType& function,
+                          const ResultType& identity,
+                          const size_t threads = 0);
+
+/**
+ * Run the given task (a function object without arguments) with a team of
+ * threads which run the tasks it starts with TaskGroup.  The task itself runs
+ * in one thread; idle threads of the team take the tasks started by the
+ * others, so recursive algorithms (like building a tree) balance their load
+ * across the threads.  This returns when the task and all the tasks it started
+ * have finished.  If the caller is already running in a parallel region, the
+ * task runs in the calling thread and its tasks are run by the existing team.
+ *
+ * @param task The task to run.
+ * @param threads Number of threads to use (0 means NumThreads()).
+ */
+template<typename TaskType>
+void RunTasks(TaskType& task, const size_t threads = 0);
+
+/**
+ * A group of tasks started by a recursive algorithm.  Run() starts a task,
+ * which is a copy of the given function object; if the caller is running under
+ * RunTasks() (or any other parallel region), another thread of the team may
+ * run it, and otherwise it runs immediately.  Wait() returns when all of the
+ * tasks started by the calling task have finished, and is called by the
+ * destructor.
+ *
+ * @code
+ * void Build(Node& node)
+ * {
+ *   if (node.Count() <= leafSize)
+ *     return;
+ *
+ *   Split(node);
+ *   util::TaskGroup group;
+ *   group.Run(BuildTask(*node.Left()));
+ *   Build(*node.Right());
+ *   group.Wait();
+ * }
+ * @endcode
+ *
+ * A TaskGroup must be waited on by the task which created it.
+ */
+class TaskGroup
+{
+ public:
+  //! Create an empty group of tasks.
+  TaskGroup() { }
+
+  //! Wait for the tasks of the group.
+  ~TaskGroup() { Wait(); }
+
+  /**
+   * Start the given task.  It is copied, so the copy must remain valid (hold
+   * no references to local variables of the caller) until Wait().
+   */
+  template<typename TaskType>
+  void Run(const TaskType& task);
+
+  //! Wait until all tasks started by the calling task have finished.
+  void Wait();
+
+ private:
+  // A group can't be copied.
+  TaskGroup(const TaskGroup& other);
+  TaskGroup& operator=(const TaskGroup& other);
+};
+
+}; // namespace util
+}; // namespace mlpack
+
+// Include implementation.
+#include "parallel_impl.hpp"
+
+#endif
@@ -0,0 +1,114 @@
+/**
+ * @file parallel_impl.hpp
+ *
+ * Implementation of the templated parallel helpers.
+ */
+#ifndef __MLPACK_CORE_UTIL_PARALLEL_IMPL_HPP
+#define __MLPACK_CORE_UTIL_PARALLEL_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "parallel.hpp"
+#include "trace.hpp"
+
+namespace mlpack {
+namespace util {
+
+template<typename FunctionType>
+void ParallelFor(const size_t begin,
+                 const size_t end,
+                 FunctionType& function,
+                 const size_t threads)
+{
+  const size_t numThreads = NumThreads(threads);
+  if (numThreads <= 1 || end <= begin + 1)
+  {
+    for (size_t i = begin; i < end; ++i)
+      function(i);
+    return;
+  }
+
+  #pragma omp parallel for schedule(dynamic) num_threads(numThreads)
+  for (size_t i = begin; i < end; ++i)
+    function(i);
+}
+
+template<typename ResultType, typename FunctionType>
+ResultType ParallelReduce(const size_t begin,
+                          const size_t end,
+                          FunctionType& function,
+                          const ResultType& identity,
+                          const size_t threads)
+{
+  const size_t numThreads = NumThreads(threads);
+  if (numThreads <= 1 || end <= begin + 1)
+  {
+    ResultType result(identity);
+    for (size_t i = begin; i < end; ++i)
+      function(i, result);
+    return result;
+  }
+
+  std::vector<ResultType> partials(numThreads, identity);
+  #pragma omp parallel num_threads(numThreads)
+  {
+#ifdef _OPENMP
+    const size_t thread = omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+
+    #pragma omp for schedule(dynamic)
+    for (size_t i = begin; i < end; ++i)
+      function(i, partials[thread]);
+  }
+
+  ResultType result(identity);
+  for (size_t t = 0; t < partials.size(); ++t)
+    result += partials[t];
+
+  return result;
+}
+
+template<typename TaskType>
+void RunTasks(TaskType& task, const size_t threads)
+{
+  const size_t numThreads = NumThreads(threads);
+  if (numThreads <= 1)
+  {
+    task();
+    return;
+  }
+
+  // One thread runs the task; the others wait at the end of the single
+  // construct, where they run the tasks it starts.
+  #pragma omp parallel num_threads(numThreads)
+  {
+    #pragma omp single
+    task();
+  }
+}
+
+template<typename TaskType>
+void TaskGroup::Run(const TaskType& task)
+{
+#ifdef _OPENMP
+  if (omp_in_parallel())
+  {
+    TaskType copy(task);
+    #pragma omp task firstprivate(copy)
+    {
+      TraceScope scope("task");
+      copy();
+    }
+    return;
+  }
+#endif
+
+  TaskType copy(task);
+  copy();
+}
+
+}; // namespace util
+}; // namespace mlpack
+
+#endif
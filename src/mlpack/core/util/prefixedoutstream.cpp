@@ -10,11 +10,353 @@
 #include <streambuf>
 #include <string.h>
 #include <stdlib.h>
+#include <deque>
+#include <map>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+#ifndef _WIN32
+  #include <pthread.h>
+#endif
 
 #include "prefixedoutstream.hpp"
 
+// Thread-local storage for plain types.
+#if defined(_MSC_VER)
+  #define MLPACK_THREAD_LOCAL __declspec(thread)
+#else
+  #define MLPACK_THREAD_LOCAL __thread
+#endif
+
 using namespace mlpack::util;
 
+// The incomplete lines that this thread wrote inside parallel regions, by the
+// id of the stream.  This is allocated when the thread first needs it.
+static MLPACK_THREAD_LOCAL std::map<size_t, std::string>* threadLines = NULL;
+
+#ifndef _WIN32
+
+// Held while anything is written to a destination.
+static pthread_mutex_t outputMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * The background thread that writes the output of every stream when
+ * PrefixedOutStream::StartAsynchronousOutput() has been called.
+ */
+struct AsynchronousOutput
+{
+  AsynchronousOutput() : stop(false), writing(false)
+  {
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+  }
+
+  ~AsynchronousOutput()
+  {
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+  }
+
+  //! Queue the given text for the given destination.
+  void Push(std::ostream* destination, const std::string& text)
+  {
+    pthread_mutex_lock(&mutex);
+    queue.push_back(std::make_pair(destination, text));
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+  }
+
+  //! Wait until the queue is empty and nothing is being written.
+  void Wait()
+  {
+    pthread_mutex_lock(&mutex);
+    while (!queue.empty() || writing)
+      pthread_cond_wait(&cond, &mutex);
+    pthread_mutex_unlock(&mutex);
+  }
+
+  //! The body of the thread.
+  static void* Run(void* outputPtr)
+  {
+    AsynchronousOutput& o = *((AsynchronousOutput*) outputPtr);
+
+    pthread_mutex_lock(&o.mutex);
+    while (true)
+    {
+      while (!o.stop && o.queue.empty())
+        pthread_cond_wait(&o.cond, &o.mutex);
+      if (o.queue.empty())
+        break; // We were asked to stop, and everything is written.
+
+      // Take everything that is waiting, and write it without holding the
+      // mutex, so that other threads can keep queueing lines.
+      std::deque<std::pair<std::ostream*, std::string> > batch;
+      batch.swap(o.queue);
+      o.writing = true;
+      pthread_mutex_unlock(&o.mutex);
+
+      pthread_mutex_lock(&outputMutex);
+      for (size_t i = 0; i < batch.size(); ++i)
+        (*batch[i].first) << batch[i].second;
+      for (size_t i = 0; i < batch.size(); ++i)
+        batch[i].first->flush();
+      pthread_mutex_unlock(&outputMutex);
+
+      pthread_mutex_lock(&o.mutex);
+      o.writing = false;
+      pthread_cond_broadcast(&o.cond);
+    }
+    pthread_mutex_unlock(&o.mutex);
+
+    return NULL;
+  }
+
+  //! The thread.
+  pthread_t thread;
+  //! The mutex protecting everything below.
+  pthread_mutex_t mutex;
+  //! Signalled whenever the state changes.
+  pthread_cond_t cond;
+
+  //! The text waiting to be written, with its destination.
+  std::deque<std::pair<std::ostream*, std::string> > queue;
+  //! Whether the thread should stop once the queue is empty.
+  bool stop;
+  //! Whether the thread is writing a batch.
+  bool writing;
+};
+
+// The background thread, if it is running.
+static AsynchronousOutput* asynchronousOutput = NULL;
+
+#elif defined(_OPENMP)
+
+// Held while anything is written to a destination.  It is initialized the first
+// time it is needed.
+static omp_lock_t* OutputLock()
+{
+  static omp_lock_t lock;
+  static bool initialized = false;
+
+  #pragma omp critical(mlpack_prefixed_out_stream_lock)
+  {
+    if (!initialized)
+    {
+      omp_init_lock(&lock);
+      initialized = true;
+    }
+  }
+
+  return &lock;
+}
+
+#endif
+
+// The id of the next stream.
+static size_t nextId = 0;
+
+PrefixedOutStream::~PrefixedOutStream()
+{
+  // The background thread may still have to write to our destination.
+  Flush();
+
+  if (threadLines != NULL)
+    threadLines->erase(id);
+}
+
+bool PrefixedOutStream::StartAsynchronousOutput()
+{
+#ifndef _WIN32
+  if (asynchronousOutput != NULL)
+    return true;
+
+  AsynchronousOutput* output = new AsynchronousOutput();
+  if (pthread_create(&output->thread, NULL, &AsynchronousOutput::Run,
+      output) != 0)
+  {
+    delete output;
+    return false;
+  }
+
+  asynchronousOutput = output;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void PrefixedOutStream::StopAsynchronousOutput()
+{
+#ifndef _WIN32
+  if (asynchronousOutput == NULL)
+    return;
+
+  AsynchronousOutput* output = asynchronousOutput;
+  pthread_mutex_lock(&output->mutex);
+  output->stop = true;
+  pthread_cond_broadcast(&output->cond);
+  pthread_mutex_unlock(&output->mutex);
+  pthread_join(output->thread, NULL);
+
+  asynchronousOutput = NULL;
+  delete output;
+#endif
+}
+
+void PrefixedOutStream::Flush()
+{
+#ifndef _WIN32
+  if (asynchronousOutput != NULL)
+    asynchronousOutput->Wait();
+#endif
+}
+
+void PrefixedOutStream::Write(const std::string& text)
+{
+  // We will use this to track whether or not we need to terminate at the end of
+  // this call (only for streams which terminate after a newline).
+  bool newlined = false;
+
+#ifdef _OPENMP
+  const bool inParallel = omp_in_parallel();
+#else
+  const bool inParallel = false;
+#endif
+
+  if (inParallel)
+  {
+    // Complete the line of this thread, and write every line that ends here,
+    // each in one piece.
+    if (threadLines == NULL)
+      threadLines = new std::map<size_t, std::string>();
+    std::string& line = (*threadLines)[id];
+
+    size_t nl;
+    size_t pos = 0;
+    while ((nl = text.find('\n', pos)) != std::string::npos)
+    {
+      line.append(text, pos, nl - pos);
+      if (!ignoreInput)
+        Emit(prefix + line + "\n", true);
+      line.clear();
+      newlined = true;
+
+      pos = nl + 1;
+    }
+
+    line.append(text, pos, std::string::npos);
+  }
+  else
+  {
+    // Check for newlines in the text.  Each time we find one, add the text up
+    // until the newline, then the newline and (on the next line) the prefix.
+    std::string output;
+    if (carriageReturned)
+    {
+      output = prefix;
+      carriageReturned = false;
+    }
+
+    size_t nl;
+    size_t pos = 0;
+    while ((nl = text.find('\n', pos)) != std::string::npos)
+    {
+      if (carriageReturned)
+        output += prefix;
+      output.append(text, pos, nl - pos + 1);
+      carriageReturned = true; // Regardless of whether or not we display it.
+      newlined = true;
+
+      pos = nl + 1;
+    }
+
+    if (pos != text.length()) // We need to display the rest.
+    {
+      if (carriageReturned)
+        output += prefix;
+      output.append(text, pos, std::string::npos);
+      carriageReturned = false;
+    }
+
+    // Only output if the user wants it.
+    if (!ignoreInput)
+      Emit(output, newlined);
+  }
+
+  // If we displayed a newline and we need to terminate afterwards, do that.
+  if (fatal && newlined)
+  {
+    Flush();
+    exit(1);
+  }
+}
+
+void PrefixedOutStream::Emit(const std::string& text, const bool newlined)
+{
+#ifndef _WIN32
+  if (asynchronousOutput != NULL && !fatal)
+  {
+    asynchronousOutput->Push(&destination, text);
+    return;
+  }
+#endif
+
+  LockOutput();
+  destination << text;
+  if (newlined)
+    destination.flush();
+  UnlockOutput();
+}
+
+void PrefixedOutStream::PrefixIfNeeded()
+{
+  // Inside a parallel region, the prefix is added when the line is written.
+#ifdef _OPENMP
+  if (omp_in_parallel())
+    return;
+#endif
+
+  // If we need to, output a prefix.
+  if (carriageReturned)
+  {
+    if (!ignoreInput) // But only if we are allowed to.
+      Emit(prefix, false);
+
+    carriageReturned = false; // Denote that the prefix has been displayed.
+  }
+}
+
+void PrefixedOutStream::LockOutput()
+{
+  // Whatever the background thread still has to write comes first.
+  Flush();
+
+#ifndef _WIN32
+  pthread_mutex_lock(&outputMutex);
+#elif defined(_OPENMP)
+  omp_set_lock(OutputLock());
+#endif
+}
+
+void PrefixedOutStream::UnlockOutput()
+{
+#ifndef _WIN32
+  pthread_mutex_unlock(&outputMutex);
+#elif defined(_OPENMP)
+  omp_unset_lock(OutputLock());
+#endif
+}
+
+size_t PrefixedOutStream::NewId()
+{
+  size_t newId;
+  #pragma omp critical(mlpack_prefixed_out_stream_id)
+  newId = nextId++;
+  return newId;
+}
+
 /**
  * These are all necessary because gcc's template mechanism does not seem smart
  * enough to figure out what I want to pass into operator<< without these.  That
@@ -47,6 +47,20 @@ namespace util {
  *
  * These objects are used for the mlpack::Log levels (DEBUG, INFO, WARN, and
  * FATAL).
+ *
+ * A PrefixedOutStream can be written to from several threads.  Inside an OpenMP
+ * parallel region, each thread collects what it writes in its own line buffer,
+ * and a line is only written to the destination when it is complete (with its
+ * prefix), in one piece; so lines from different threads are never mixed, but
+ * a thread should end its lines before the parallel region ends.  Outside of
+ * parallel regions, output is written as soon as it is given, as before.
+ *
+ * Nothing is formatted for a stream whose ignoreInput flag is set, so writing
+ * to a disabled stream (like Log::Info without --verbose) is cheap.
+ *
+ * Optionally, the writes to the destinations can be done by a background thread
+ * (see StartAsynchronousOutput()), so that threads writing to a slow terminal
+ * or file do not wait for it.
  */
 class PrefixedOutStream
 {
@@ -69,9 +83,17 @@ class PrefixedOutStream
       // We want the first call to operator<< to prefix the prefix so we set
       // carriageReturned to true.
       carriageReturned(true),
-      fatal(fatal)
+      fatal(fatal),
+      id(NewId())
     { /* nothing to do */ }
 
+  /**
+   * Wait until everything written to the stream has reached the destination,
+   * and drop any incomplete line that the calling thread wrote inside a
+   * parallel region.
+   */
+  ~PrefixedOutStream();
+
   //! Write a bool to the stream.
   PrefixedOutStream& operator<<(bool val);
   //! Write a short to the stream.
@@ -111,6 +133,27 @@ class PrefixedOutStream
   template<typename T>
   PrefixedOutStream& operator<<(const T& s);
 
+  /**
+   * Start a background thread that does all writes to the destinations of all
+   * PrefixedOutStreams, until StopAsynchronousOutput() is called.  Lines are
+   * still written in the order they are completed.  This must be called while
+   * no other thread writes to a stream.  It returns false (and the output stays
+   * synchronous) if the thread cannot be started, or on Windows.
+   */
+  static bool StartAsynchronousOutput();
+
+  /**
+   * Write everything that is waiting and stop the background thread, if it was
+   * started.  This must be called while no other thread writes to a stream.
+   */
+  static void StopAsynchronousOutput();
+
+  /**
+   * Wait until the background thread, if it was started, has written
+   * everything that is waiting.
+   */
+  static void Flush();
+
   //! The output stream that all data is to be sent too; example: std::cout.
   std::ostream& destination;
 
@@ -157,10 +200,34 @@ class PrefixedOutStream
   template<typename T>
   void BaseLogic(const T& val);
 
+  /**
+   * Write the given formatted text, which is not empty: directly (with the
+   * prefix after each newline) outside of parallel regions, or into the line
+   * buffer of the calling thread inside of them.
+   */
+  void Write(const std::string& text);
+
+  /**
+   * Send the given text to the destination, in one piece, or queue it for the
+   * background thread.
+   */
+  void Emit(const std::string& text, const bool newlined);
+
   /**
    * Output the prefix, but only if we need to and if we are allowed to.
    */
-  inline void PrefixIfNeeded();
+  void PrefixIfNeeded();
+
+  /**
+   * Wait for the background thread to finish writing, and keep other threads
+   * from writing to the destinations until UnlockOutput() is called.
+   */
+  static void LockOutput();
+  //! Allow other threads to write to the destinations again.
+  static void UnlockOutput();
+
+  //! Get a new, unique, stream id.
+  static size_t NewId();
 
   //! Contains the prefix we must prepend to each line.
   std::string prefix;
@@ -172,6 +239,9 @@ class PrefixedOutStream
   //! If true, the application will terminate with an error code when a CR is
   //! encountered.
   bool fatal;
+
+  //! The id of the stream, used to find the line buffers of each thread.
+  size_t id;
 };
 
 }; // namespace util
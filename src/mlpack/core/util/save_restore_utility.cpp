@@ -4,15 +4,121 @@
  * @author Michael Fox
  *
  * The SaveRestoreUtility provides helper functions in saving and
- *   restoring models.  The current output file type is XML.
+ *   restoring models.  The output file type is XML, or a binary format for
+ *   files with the extension .bin.
  */
 #include <mlpack/core.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
 using namespace mlpack;
 using namespace mlpack::util;
 
+//! The magic string at the beginning of every binary model file.
+static const char BinaryMagic[8] = { 'M', 'L', 'P', 'K', 'S', 'R', 'U', '1' };
+
+//! Return whether the given file is in the binary format (extension .bin).
+static bool IsBinaryFile(const std::string& filename)
+{
+  const size_t dot = filename.rfind('.');
+  if (dot == std::string::npos)
+    return false;
+
+  std::string extension = filename.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+      ::tolower);
+  return (extension == "bin");
+}
+
+//! Write an 8-byte field of the binary format.
+static void WriteField(std::ofstream& stream, const uint64_t value)
+{
+  stream.write((const char*) &value, sizeof(uint64_t));
+}
+
+//! Write a string of the binary format: its length, then its characters,
+//! padded to a multiple of 8 bytes so the next field stays aligned.
+static void WriteString(std::ofstream& stream, const std::string& str)
+{
+  static const char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+  WriteField(stream, str.size());
+  stream.write(str.data(), str.size());
+  stream.write(padding, (8 - str.size() % 8) % 8);
+}
+
+//! Check that the given number of bytes are left in the file.
+static void CheckSize(const size_t size,
+                      const size_t offset,
+                      const uint64_t bytes)
+{
+  if (offset > size || bytes > size - offset)
+  {
+    Log::Fatal << "SaveRestoreUtility: binary model file is truncated or "
+        << "corrupt!" << std::endl;
+  }
+}
+
+//! Read an 8-byte field of the binary format, and move the offset past it.
+static uint64_t ReadField(const char* data, const size_t size, size_t& offset)
+{
+  CheckSize(size, offset, sizeof(uint64_t));
+
+  uint64_t value;
+  std::memcpy(&value, data + offset, sizeof(uint64_t));
+  offset += sizeof(uint64_t);
+  return value;
+}
+
+//! Read a string of the binary format, and move the offset past it.
+static std::string ReadString(const char* data,
+                              const size_t size,
+                              size_t& offset)
+{
+  const uint64_t length = ReadField(data, size, offset);
+  CheckSize(size, offset, length);
+
+  const std::string str(data + offset, length);
+  offset += length + (8 - length % 8) % 8;
+  return str;
+}
+
+//! Convert a matrix to the text representation used in XML files.
+static std::string MatrixToString(const arma::mat& mat)
+{
+  std::ostringstream output;
+  size_t columns = mat.n_cols;
+  size_t rows = mat.n_rows;
+  for (size_t r = 0; r < rows; ++r)
+  {
+    for (size_t c = 0; c < columns - 1; ++c)
+    {
+      output << std::setprecision(15) << mat(r, c) << ",";
+    }
+    output << std::setprecision(15) << mat(r, columns - 1) << std::endl;
+  }
+  return output.str();
+}
+
 bool SaveRestoreUtility::ReadFile(const std::string& filename)
 {
+  if (IsBinaryFile(filename))
+  {
+    boost::shared_ptr<MappedFile> file(new MappedFile(filename));
+    if (file->Size() < sizeof(BinaryMagic) ||
+        std::memcmp(file->Data(), BinaryMagic, sizeof(BinaryMagic)) != 0)
+    {
+      Log::Fatal << "'" << filename << "' is not a binary model file!"
+          << std::endl;
+    }
+
+    size_t offset = sizeof(BinaryMagic);
+    ReadBinary(file, offset);
+    return true;
+  }
+
   xmlDocPtr xmlDocTree = NULL;
   if (NULL == (xmlDocTree = xmlReadFile(filename.c_str(), NULL, 0)))
   {
@@ -28,6 +134,9 @@ bool SaveRestoreUtility::ReadFile(const std::string& filename)
 void SaveRestoreUtility::ReadFile(xmlNode* n)
 {
   parameters.clear();
+  matrices.clear();
+  mappedMatrices.clear();
+  mapping.reset();
   xmlNodePtr current = NULL;
   for (current = n; current; current = current->next)
   {
@@ -49,6 +158,26 @@ void SaveRestoreUtility::ReadFile(xmlNode* n)
 
 bool SaveRestoreUtility::WriteFile(const std::string& filename)
 {
+  // Overwriting the file the model is mapped from would pull the matrices out
+  // from under us.
+  if (mapping && mapping->Filename() == filename)
+    Unmap();
+
+  if (IsBinaryFile(filename))
+  {
+    std::ofstream stream(filename.c_str(), std::ios::out | std::ios::binary);
+    if (!stream.is_open())
+    {
+      Log::Warn << "Could not open '" << filename << "' for writing."
+          << std::endl;
+      return false;
+    }
+
+    stream.write(BinaryMagic, sizeof(BinaryMagic));
+    WriteBinary(stream);
+    return stream.good();
+  }
+
   bool success = false;
   xmlDocPtr xmlDocTree = xmlNewDoc(BAD_CAST "1.0");
   xmlNodePtr root = xmlNewNode(NULL, BAD_CAST "root");
@@ -70,6 +199,20 @@ void SaveRestoreUtility::WriteFile(xmlNode* n)
     xmlNewChild(n, NULL, BAD_CAST(*it).first.c_str(),
         BAD_CAST(*it).second.c_str());
   }
+  for (std::map<std::string, arma::mat>::reverse_iterator it =
+       matrices.rbegin(); it != matrices.rend(); ++it)
+  {
+    xmlNewChild(n, NULL, BAD_CAST(*it).first.c_str(),
+        BAD_CAST MatrixToString((*it).second).c_str());
+  }
+  for (std::map<std::string, MatrixView>::reverse_iterator it =
+       mappedMatrices.rbegin(); it != mappedMatrices.rend(); ++it)
+  {
+    const arma::mat view((double*) (*it).second.memory, (*it).second.rows,
+        (*it).second.cols, false, true);
+    xmlNewChild(n, NULL, BAD_CAST(*it).first.c_str(),
+        BAD_CAST MatrixToString(view).c_str());
+  }
   xmlNodePtr child;
   for (std::map<std::string, SaveRestoreUtility>::iterator it =
        children.begin(); it != children.end(); ++it)
@@ -79,9 +222,137 @@ void SaveRestoreUtility::WriteFile(xmlNode* n)
   }
 }
 
+void SaveRestoreUtility::WriteBinary(std::ofstream& stream) const
+{
+  WriteField(stream, parameters.size());
+  WriteField(stream, matrices.size() + mappedMatrices.size());
+  WriteField(stream, children.size());
+
+  for (std::map<std::string, std::string>::const_iterator it =
+       parameters.begin(); it != parameters.end(); ++it)
+  {
+    WriteString(stream, (*it).first);
+    WriteString(stream, (*it).second);
+  }
+
+  for (std::map<std::string, arma::mat>::const_iterator it = matrices.begin();
+       it != matrices.end(); ++it)
+  {
+    const arma::mat& matrix = (*it).second;
+    WriteString(stream, (*it).first);
+    WriteField(stream, matrix.n_rows);
+    WriteField(stream, matrix.n_cols);
+    stream.write((const char*) matrix.memptr(), matrix.n_elem *
+        sizeof(double));
+  }
+
+  for (std::map<std::string, MatrixView>::const_iterator it =
+       mappedMatrices.begin(); it != mappedMatrices.end(); ++it)
+  {
+    const MatrixView& view = (*it).second;
+    WriteString(stream, (*it).first);
+    WriteField(stream, view.rows);
+    WriteField(stream, view.cols);
+    stream.write((const char*) view.memory, view.rows * view.cols *
+        sizeof(double));
+  }
+
+  for (std::map<std::string, SaveRestoreUtility>::const_iterator it =
+       children.begin(); it != children.end(); ++it)
+  {
+    WriteString(stream, (*it).first);
+    (*it).second.WriteBinary(stream);
+  }
+}
+
+void SaveRestoreUtility::ReadBinary(const boost::shared_ptr<MappedFile>& file,
+                                    size_t& offset)
+{
+  parameters.clear();
+  matrices.clear();
+  mappedMatrices.clear();
+  children.clear();
+  mapping = file;
+
+  const char* data = file->Data();
+  const size_t size = file->Size();
+
+  const uint64_t numParameters = ReadField(data, size, offset);
+  const uint64_t numMatrices = ReadField(data, size, offset);
+  const uint64_t numChildren = ReadField(data, size, offset);
+
+  for (uint64_t i = 0; i < numParameters; ++i)
+  {
+    const std::string name = ReadString(data, size, offset);
+    parameters[name] = ReadString(data, size, offset);
+  }
+
+  // The matrices are not copied; the file is mapped at an 8-byte aligned
+  // address, and every matrix starts at an 8-byte aligned offset.
+  for (uint64_t i = 0; i < numMatrices; ++i)
+  {
+    const std::string name = ReadString(data, size, offset);
+    const uint64_t rows = ReadField(data, size, offset);
+    const uint64_t cols = ReadField(data, size, offset);
+
+    // Check each dimension first, so that their product cannot overflow.
+    CheckSize(size, offset, rows);
+    CheckSize(size, offset, cols);
+    CheckSize(size, offset, rows * cols * sizeof(double));
+
+    MatrixView& view = mappedMatrices[name];
+    view.memory = (const double*) (data + offset);
+    view.rows = rows;
+    view.cols = cols;
+    offset += rows * cols * sizeof(double);
+  }
+
+  for (uint64_t i = 0; i < numChildren; ++i)
+  {
+    const std::string name = ReadString(data, size, offset);
+    children[name].ReadBinary(file, offset);
+  }
+}
+
+void SaveRestoreUtility::Unmap()
+{
+  for (std::map<std::string, MatrixView>::const_iterator it =
+       mappedMatrices.begin(); it != mappedMatrices.end(); ++it)
+  {
+    const MatrixView& view = (*it).second;
+    matrices[(*it).first] = arma::mat((double*) view.memory, view.rows,
+        view.cols);
+  }
+
+  mappedMatrices.clear();
+  mapping.reset();
+
+  for (std::map<std::string, SaveRestoreUtility>::iterator it =
+       children.begin(); it != children.end(); ++it)
+    (*it).second.Unmap();
+}
+
 arma::mat& SaveRestoreUtility::LoadParameter(arma::mat& matrix,
                                              const std::string& name) const
 {
+  // Matrices saved with SaveParameter() or read from a binary file are stored
+  // as they are.
+  std::map<std::string, arma::mat>::const_iterator matrixIt =
+      matrices.find(name);
+  if (matrixIt != matrices.end())
+    return matrix = (*matrixIt).second;
+
+  // Matrices in a mapped binary file are copied straight from the mapping.
+  std::map<std::string, MatrixView>::const_iterator viewIt =
+      mappedMatrices.find(name);
+  if (viewIt != mappedMatrices.end())
+  {
+    const MatrixView& view = (*viewIt).second;
+    matrix.set_size(view.rows, view.cols);
+    std::memcpy(matrix.memptr(), view.memory, matrix.n_elem * sizeof(double));
+    return matrix;
+  }
+
   std::map<std::string, std::string>::const_iterator it = parameters.find(name);
   if (it != parameters.end())
   {
@@ -177,23 +448,17 @@ void SaveRestoreUtility::SaveParameter(const char c, const std::string& name)
   std::ostringstream output;
   output << temp;
   parameters[name] = output.str();
+  matrices.erase(name);
+  mappedMatrices.erase(name);
 }
 
 void SaveRestoreUtility::SaveParameter(const arma::mat& mat,
                                        const std::string& name)
 {
-  std::ostringstream output;
-  size_t columns = mat.n_cols;
-  size_t rows = mat.n_rows;
-  for (size_t r = 0; r < rows; ++r)
-  {
-    for (size_t c = 0; c < columns - 1; ++c)
-    {
-      output << std::setprecision(15) << mat(r, c) << ",";
-    }
-    output << std::setprecision(15) << mat(r, columns - 1) << std::endl;
-  }
-  parameters[name] = output.str();
+  // The matrix is only converted to text if it is written to an XML file.
+  matrices[name] = mat;
+  parameters.erase(name);
+  mappedMatrices.erase(name);
 }
 
 // Special template specializations for vectors.
@@ -3,7 +3,8 @@
  * @author Neil Slagle
  *
  * The SaveRestoreUtility provides helper functions in saving and
- *   restoring models.  The current output file type is XML.
+ *   restoring models.  The output file type is XML, or a binary format for
+ *   files with the extension .bin.
  *
  * @experimental
  */
@@ -11,6 +12,7 @@
 #define __MLPACK_CORE_UTIL_SAVE_RESTORE_UTILITY_HPP
 
 #include <mlpack/prereqs.hpp>
+#include <fstream>
 #include <list>
 #include <map>
 #include <sstream>
@@ -19,8 +21,11 @@
 #include <libxml/parser.h>
 #include <libxml/tree.h>
 
+#include <boost/shared_ptr.hpp>
 #include <boost/tokenizer.hpp>
 
+#include "mapped_file.hpp"
+
 namespace mlpack {
 namespace util {
 
@@ -38,6 +43,33 @@ class SaveRestoreUtility
    */
   std::map<std::string, SaveRestoreUtility> children;
 
+  /**
+   * matrices contains the matrices saved with SaveParameter(), which are only
+   * converted to text if the model is written to an XML file.
+   */
+  std::map<std::string, arma::mat> matrices;
+
+  //! A read-only matrix in a mapped binary file.
+  struct MatrixView
+  {
+    //! The elements, in column-major order.
+    const double* memory;
+    //! The number of rows.
+    size_t rows;
+    //! The number of columns.
+    size_t cols;
+  };
+
+  /**
+   * mappedMatrices contains the matrices of a model read from a binary file.
+   * They stay in the mapped file, and are only copied out by LoadParameter().
+   */
+  std::map<std::string, MatrixView> mappedMatrices;
+
+  //! The mapped binary file this model was read from (shared with its
+  //! children), or NULL.
+  boost::shared_ptr<MappedFile> mapping;
+
   /**
    * RecurseOnNodes performs a depth first search of the XML tree.
    */
@@ -49,12 +81,26 @@ class SaveRestoreUtility
   ~SaveRestoreUtility() { parameters.clear(); }
 
   /**
-   * ReadFile reads an XML tree from a file.
+   * ReadFile reads a model from a file.  Files with the extension .bin are read
+   * in the binary format (see WriteFile()); other files are read as XML.  A
+   * binary file is mapped into memory (see MappedFile) rather than read, so
+   * this takes time proportional to the number of parameters, regardless of
+   * the size of the matrices; LoadParameter() then copies each matrix straight
+   * from the mapped pages, which are shared by all the processes that read the
+   * same file.  The file stays mapped until this object (and every copy of it
+   * or of its children) is destroyed.
    */
   bool ReadFile(const std::string& filename);
 
   /**
-   * WriteFile writes the XML tree to a file.
+   * WriteFile writes the model to a file.  If the extension of the file is
+   * .bin, the model is written in a binary format: a header of 8-byte fields
+   * for each model (the number of parameters, matrices and children), then the
+   * names and values of the parameters, then each matrix as its size followed
+   * by its elements, in their in-memory representation, 8-byte aligned; then
+   * the children, recursively.  This is much smaller and faster to read than
+   * XML for models with large matrices, but it is only portable between
+   * machines with the same byte order.  Otherwise, the model is written as XML.
    */
   bool WriteFile(const std::string& filename);
 
@@ -116,13 +162,13 @@ class SaveRestoreUtility
   /**
    * Return the children.
    */
-  const std::map<std::string, SaveRestoreUtility> Children() const { return
-    children; }
+  const std::map<std::string, SaveRestoreUtility>& Children() const
+  { return children; }
 
   /**
-   * Return modifiable copy of the children.
+   * Modify the children.
    */
-  std::map<std::string, SaveRestoreUtility> Children() { return children; }
+  std::map<std::string, SaveRestoreUtility>& Children() { return children; }
 
  private:
   /**
@@ -135,6 +181,23 @@ class SaveRestoreUtility
    */
   void ReadFile(xmlNode* n);
 
+  /**
+   * Write the model and its children, recursively, in the binary format.
+   */
+  void WriteBinary(std::ofstream& stream) const;
+
+  /**
+   * Read the model and its children, recursively, in the binary format, from
+   * the given offset of the mapped file.  The offset is moved past the model.
+   */
+  void ReadBinary(const boost::shared_ptr<MappedFile>& file, size_t& offset);
+
+  /**
+   * Copy the mapped matrices of the model and its children into memory, and
+   * release the mapped file.
+   */
+  void Unmap();
+
 };
 
 //! Specialization for arma::vec.
@@ -0,0 +1,470 @@
+/**
+ * @file server.cpp
+ *
+ * Implementation of the protocol of the Server class, and of the
+ * ServerEndpoint class.
+ */
+#include "server.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#ifndef _WIN32
+  #include <sys/socket.h>
+  #include <sys/stat.h>
+  #include <sys/un.h>
+  #include <csignal>
+  #include <unistd.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::util;
+
+namespace mlpack {
+namespace util {
+
+#ifndef _WIN32
+
+/**
+ * A stream buffer which reads from and writes to a file descriptor (a socket,
+ * or the standard output).
+ */
+class FileDescriptorBuffer : public std::streambuf
+{
+ public:
+  FileDescriptorBuffer(const int fd) : fd(fd)
+  {
+    setg(inBuffer, inBuffer, inBuffer);
+    setp(outBuffer, outBuffer + BufferSize);
+  }
+
+  ~FileDescriptorBuffer() { Flush(); }
+
+ protected:
+  int_type underflow()
+  {
+    if (gptr() < egptr())
+      return traits_type::to_int_type(*gptr());
+
+    ssize_t count;
+    do
+    {
+      count = read(fd, inBuffer, BufferSize);
+    } while (count == -1 && errno == EINTR);
+
+    if (count <= 0)
+      return traits_type::eof();
+
+    setg(inBuffer, inBuffer, inBuffer + count);
+    return traits_type::to_int_type(*gptr());
+  }
+
+  int_type overflow(int_type c)
+  {
+    if (Flush() == -1)
+      return traits_type::eof();
+
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+  }
+
+  int sync() { return Flush(); }
+
+ private:
+  //! Write everything in the output buffer.  Returns -1 on failure.
+  int Flush()
+  {
+    const char* next = pbase();
+    while (next < pptr())
+    {
+      const ssize_t count = write(fd, next, pptr() - next);
+      if (count == -1)
+      {
+        if (errno == EINTR)
+          continue;
+
+        setp(outBuffer, outBuffer + BufferSize);
+        return -1;
+      }
+
+      next += count;
+    }
+
+    setp(outBuffer, outBuffer + BufferSize);
+    return 0;
+  }
+
+  //! The size of each buffer.
+  static const size_t BufferSize = 65536;
+
+  //! The file descriptor (not owned).
+  int fd;
+  //! The buffer of read characters.
+  char inBuffer[BufferSize];
+  //! The buffer of characters to write.
+  char outBuffer[BufferSize];
+};
+
+#else
+
+// Only the standard streams are used on Windows.
+class FileDescriptorBuffer { };
+
+#endif
+
+}; // namespace util
+}; // namespace mlpack
+
+//! Parse a number of points; returns false if the token is not one.
+static bool ParseCount(const std::string& token, size_t& count)
+{
+  if (token.empty() ||
+      token.find_first_not_of("0123456789") != std::string::npos)
+    return false;
+
+  errno = 0;
+  const unsigned long value = strtoul(token.c_str(), NULL, 10);
+  if (errno == ERANGE)
+    return false;
+
+  count = (size_t) value;
+  return true;
+}
+
+//! Parse the numbers on a line into values; returns the number of values, or
+//! -1 if something on the line is not a number.
+static int ParsePoint(std::string& line, std::vector<double>& values)
+{
+  for (size_t i = 0; i < line.size(); ++i)
+    if (line[i] == ',' || line[i] == '\t' || line[i] == '\r')
+      line[i] = ' ';
+
+  int count = 0;
+  const char* next = line.c_str();
+  while (true)
+  {
+    while (*next == ' ')
+      ++next;
+    if (*next == '\0')
+      return count;
+
+    char* end;
+    const double value = strtod(next, &end);
+    if (end == next || (*end != ' ' && *end != '\0'))
+      return -1;
+
+    values.push_back(value);
+    ++count;
+    next = end;
+  }
+}
+
+bool mlpack::util::ReadRequest(std::istream& stream,
+                               ServerRequest& request,
+                               std::string& error)
+{
+  request.command.clear();
+  request.options.clear();
+  request.data.reset();
+  error.clear();
+
+  // Find the header, skipping empty lines and comments.
+  std::string line;
+  std::vector<std::string> tokens;
+  while (tokens.empty())
+  {
+    if (!std::getline(stream, line))
+      return false;
+
+    const size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string::npos || line[start] == '#')
+      continue;
+
+    std::istringstream header(line);
+    std::string token;
+    while (header >> token)
+      tokens.push_back(token);
+  }
+
+  request.command = tokens[0];
+  size_t points = 0;
+  bool pointsGiven = false;
+  for (size_t i = 1; i < tokens.size(); ++i)
+  {
+    const size_t equals = tokens[i].find('=');
+    if (equals == std::string::npos)
+    {
+      if (pointsGiven || !ParseCount(tokens[i], points))
+        error = "invalid number of points '" + tokens[i] + "'";
+      pointsGiven = true;
+    }
+    else if (equals == 0)
+    {
+      error = "option without a name '" + tokens[i] + "'";
+    }
+    else
+    {
+      request.options[tokens[i].substr(0, equals)] = tokens[i].substr(equals +
+          1);
+    }
+  }
+
+  // Read all the points, even if the header is invalid, so that the next
+  // request is read from its start.
+  std::vector<double> values;
+  size_t dimensionality = 0;
+  for (size_t i = 0; i < points; ++i)
+  {
+    if (!std::getline(stream, line))
+    {
+      error = "the input ended before all points of the request were read";
+      return true;
+    }
+
+    const int count = ParsePoint(line, values);
+    if (!error.empty())
+      continue;
+
+    std::ostringstream message;
+    if (count == -1)
+    {
+      message << "point " << i << " contains something that is not a number";
+      error = message.str();
+    }
+    else if (count == 0)
+    {
+      message << "point " << i << " is empty";
+      error = message.str();
+    }
+    else if (i == 0)
+    {
+      dimensionality = (size_t) count;
+    }
+    else if ((size_t) count != dimensionality)
+    {
+      message << "point " << i << " has " << count << " dimensions, but point "
+          << "0 has " << dimensionality;
+      error = message.str();
+    }
+  }
+
+  // Each point is stored contiguously, so it becomes a column.
+  if (error.empty() && points > 0)
+    request.data = arma::mat(&values[0], dimensionality, points);
+
+  return true;
+}
+
+void mlpack::util::WriteResponse(std::ostream& stream,
+                                 const ServerResponse& response)
+{
+  if (!response.error.empty())
+  {
+    // The message must stay on one line.
+    std::string message = response.error;
+    for (size_t i = 0; i < message.size(); ++i)
+      if (message[i] == '\n' || message[i] == '\r')
+        message[i] = ' ';
+
+    stream << "ERROR " << message << "\n";
+  }
+  else
+  {
+    // Enough digits that the values read back are exactly the same.
+    const std::streamsize precision = stream.precision(
+        std::numeric_limits<double>::digits10 + 2);
+
+    const arma::mat& data = response.data;
+    stream << "OK " << data.n_cols << "\n";
+    for (size_t i = 0; i < data.n_cols; ++i)
+    {
+      for (size_t j = 0; j < data.n_rows; ++j)
+      {
+        if (j > 0)
+          stream << ",";
+        stream << data(j, i);
+      }
+      stream << "\n";
+    }
+
+    stream.precision(precision);
+  }
+
+  stream.flush();
+}
+
+ServerEndpoint::ServerEndpoint(const std::string& address) :
+    address(address),
+    listener(-1),
+    connection(-1),
+    savedOutput(-1),
+    accepted(false),
+    inputBuffer(NULL),
+    outputBuffer(NULL),
+    input(NULL),
+    output(NULL)
+{
+#ifndef _WIN32
+  // Writing to a client that went away must be an error of the write, not a
+  // signal that ends the program.
+  signal(SIGPIPE, SIG_IGN);
+#endif
+
+  if (address == "-")
+    return;
+
+#ifndef _WIN32
+  sockaddr_un socketAddress;
+  memset(&socketAddress, 0, sizeof(socketAddress));
+  socketAddress.sun_family = AF_UNIX;
+  if (address.empty() || address.size() >= sizeof(socketAddress.sun_path))
+  {
+    Log::Fatal << "Invalid socket path '" << address << "'; it must have 1 to "
+        << sizeof(socketAddress.sun_path) - 1 << " characters." << std::endl;
+  }
+  strcpy(socketAddress.sun_path, address.c_str());
+
+  // Remove a socket left behind by an earlier server, but nothing else.
+  struct stat fileInfo;
+  if (lstat(address.c_str(), &fileInfo) == 0 && S_ISSOCK(fileInfo.st_mode))
+    unlink(address.c_str());
+
+  listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener == -1)
+  {
+    Log::Fatal << "Cannot create socket: " << strerror(errno) << "."
+        << std::endl;
+  }
+
+  if (bind(listener, (sockaddr*) &socketAddress, sizeof(socketAddress)) == -1 ||
+      listen(listener, 16) == -1)
+  {
+    const int bindError = errno;
+    close(listener);
+    listener = -1;
+    Log::Fatal << "Cannot listen on socket '" << address << "': "
+        << strerror(bindError) << "." << std::endl;
+  }
+#else
+  Log::Fatal << "Unix sockets are not available on Windows; use '-' to serve "
+      << "requests on the standard input and output." << std::endl;
+#endif
+}
+
+ServerEndpoint::~ServerEndpoint()
+{
+  Close();
+
+#ifndef _WIN32
+  if (listener != -1)
+  {
+    close(listener);
+    unlink(address.c_str());
+  }
+#endif
+}
+
+bool ServerEndpoint::Accept()
+{
+  Close();
+
+  if (listener == -1)
+  {
+    // The standard input and output are a single connection.
+    if (accepted)
+      return false;
+    accepted = true;
+
+    input = &std::cin;
+    output = &std::cout;
+
+#ifndef _WIN32
+    // Keep the standard output for the responses, and send everything else
+    // written to it to the standard error.
+    std::cout.flush();
+    savedOutput = dup(1);
+    if (savedOutput != -1 && dup2(2, 1) != -1)
+    {
+      outputBuffer = new FileDescriptorBuffer(savedOutput);
+      output = new std::ostream(outputBuffer);
+    }
+    else
+    {
+      Log::Warn << "Cannot redirect the standard output; log output may be "
+          << "mixed with the responses." << std::endl;
+      if (savedOutput != -1)
+      {
+        close(savedOutput);
+        savedOutput = -1;
+      }
+    }
+#endif
+
+    return true;
+  }
+
+#ifndef _WIN32
+  do
+  {
+    connection = accept(listener, NULL, NULL);
+  } while (connection == -1 && errno == EINTR);
+
+  if (connection == -1)
+  {
+    Log::Warn << "Cannot accept a connection: " << strerror(errno) << "."
+        << std::endl;
+    return false;
+  }
+
+  inputBuffer = new FileDescriptorBuffer(connection);
+  outputBuffer = new FileDescriptorBuffer(connection);
+  input = new std::istream(inputBuffer);
+  output = new std::ostream(outputBuffer);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ServerEndpoint::Close()
+{
+  if (output != NULL)
+    output->flush();
+
+  // The streams are only owned if they have their own buffers.
+  if (inputBuffer != NULL)
+    delete input;
+  if (outputBuffer != NULL)
+    delete output;
+  delete inputBuffer;
+  delete outputBuffer;
+
+  input = NULL;
+  output = NULL;
+  inputBuffer = NULL;
+  outputBuffer = NULL;
+
+#ifndef _WIN32
+  if (connection != -1)
+  {
+    close(connection);
+    connection = -1;
+  }
+
+  if (savedOutput != -1)
+  {
+    // Restore the standard output.
+    std::cout.flush();
+    dup2(savedOutput, 1);
+    close(savedOutput);
+    savedOutput = -1;
+  }
+#endif
+}
@@ -0,0 +1,267 @@
+/**
+ * @file server.hpp
+ *
+ * The Server class, which keeps a program's loaded data, trees and models in
+ * memory and answers batches of queries sent to it over a Unix socket or the
+ * standard input, and the protocol it speaks.
+ */
+#ifndef __MLPACK_CORE_UTIL_SERVER_HPP
+#define __MLPACK_CORE_UTIL_SERVER_HPP
+
+#include <mlpack/core.hpp>
+
+#include <map>
+
+namespace mlpack {
+namespace util {
+
+/**
+ * A request to a Server: a command, named options, and a batch of points (one
+ * per column).
+ */
+struct ServerRequest
+{
+  //! The command.
+  std::string command;
+  //! The options given with the command, by name.
+  std::map<std::string, std::string> options;
+  //! The points sent with the command, one per column.
+  arma::mat data;
+
+  /**
+   * Get the value of the given option.  If the option was not given, value is
+   * not modified, so it can hold a default beforehand.
+   *
+   * @param name Name of the option.
+   * @param value Variable to store the value of the option in.
+   * @return false if the option was given but its value is not a valid T.
+   */
+  template<typename T>
+  bool GetOption(const std::string& name, T& value) const;
+};
+
+/**
+ * The response of a Server to a request: either a matrix of results (one
+ * column per line of the response), or an error message.
+ */
+struct ServerResponse
+{
+  //! The results, one per column.
+  arma::mat data;
+  //! The error message, if the request failed.
+  std::string error;
+};
+
+/**
+ * Read a request from the given stream, in the protocol described with the
+ * Server class.  If the request is malformed, all of its lines are still read,
+ * and the error is returned.
+ *
+ * @param stream Stream to read from.
+ * @param request Request to fill.
+ * @param error Set to an error message if the request is malformed, or to the
+ *     empty string otherwise.
+ * @return false if the end of the stream was reached before a request.
+ */
+bool ReadRequest(std::istream& stream,
+                 ServerRequest& request,
+                 std::string& error);
+
+/**
+ * Write a response to the given stream, in the protocol described with the
+ * Server class, and flush the stream.
+ *
+ * @param stream Stream to write to.
+ * @param response Response to write.
+ */
+void WriteResponse(std::ostream& stream, const ServerResponse& response);
+
+class FileDescriptorBuffer;
+
+/**
+ * The place where a Server receives requests: either the standard input and
+ * output (address "-"), or a Unix socket created at the given path, which
+ * clients connect to one after another.  Only the standard input and output
+ * are available on Windows.
+ *
+ * When the standard output is used for responses, it is moved to another file
+ * descriptor first, and file descriptor 1 is pointed at the standard error, so
+ * that nothing written by the Log streams (which write to std::cout) can be
+ * mixed with the responses.
+ */
+class ServerEndpoint
+{
+ public:
+  /**
+   * Open the endpoint at the given address.  If a Unix socket cannot be
+   * created, a fatal error is issued (see Log::Fatal).
+   *
+   * @param address "-" for the standard input and output, or the path of a
+   *     Unix socket.
+   */
+  ServerEndpoint(const std::string& address);
+
+  //! Close the endpoint, and remove its socket, if there is one.
+  ~ServerEndpoint();
+
+  /**
+   * Wait for the next connection.  The standard input and output are a single
+   * connection.
+   *
+   * @return false if there will be no more connections.
+   */
+  bool Accept();
+
+  //! End the current connection.
+  void Close();
+
+  //! Get the stream requests of the current connection are read from.
+  std::istream& Input() { return *input; }
+  //! Get the stream responses of the current connection are written to.
+  std::ostream& Output() { return *output; }
+
+ private:
+  //! Copying is not allowed (the socket would be closed twice).
+  ServerEndpoint(const ServerEndpoint& other);
+  //! Copying is not allowed (the socket would be closed twice).
+  ServerEndpoint& operator=(const ServerEndpoint& other);
+
+  //! The address of the endpoint.
+  std::string address;
+  //! The listening socket, or -1 for the standard input and output.
+  int listener;
+  //! The socket of the current connection, or -1.
+  int connection;
+  //! The descriptor the standard output was moved to, or -1.
+  int savedOutput;
+  //! Whether the standard input and output have been used already.
+  bool accepted;
+  //! The buffer for reading from the current connection.
+  FileDescriptorBuffer* inputBuffer;
+  //! The buffer for writing to the current connection.
+  FileDescriptorBuffer* outputBuffer;
+  //! The stream of requests of the current connection.
+  std::istream* input;
+  //! The stream of responses of the current connection.
+  std::ostream* output;
+};
+
+/**
+ * A Server keeps what a command-line program has loaded or built (datasets,
+ * trees, trained models) in memory and answers requests with it, so that each
+ * batch of queries costs only the queries themselves instead of the loading
+ * and building of a whole program run.  The requests are read from a
+ * ServerEndpoint: the standard input and output, or a Unix socket.
+ *
+ * The protocol is line-based text.  A request is a header line, of the form
+ *
+ * @code
+ * <command> [<points>] [<option>=<value> ...]
+ * @endcode
+ *
+ * followed by the given number of lines (0 if not given), each holding one
+ * point as numbers separated by commas or spaces, like a row of a CSV file.
+ * Empty lines and lines starting with '#' between requests are ignored.  The
+ * response to a request is either
+ *
+ * @code
+ * OK <lines>
+ * @endcode
+ *
+ * followed by the given number of lines of comma-separated numbers, or a
+ * single line
+ *
+ * @code
+ * ERROR <message>
+ * @endcode
+ *
+ * The commands 'ping' (answered with "OK 0"), 'quit' (which ends the
+ * connection) and 'shutdown' (which ends the connection and stops the server)
+ * are handled by the server itself; every other command is given to the
+ * handler.  Requests are served one at a time; the methods can still use all
+ * threads for each request.
+ *
+ * The HandlerType class must implement the following method:
+ *
+ * @code
+ * // Answer the request, and return true; or set response.error and return
+ * // false.  This must not issue fatal errors for invalid requests.
+ * bool Handle(const ServerRequest& request, ServerResponse& response);
+ * @endcode
+ *
+ * For instance, a k-means model can be served with
+ *
+ * @code
+ * class AssignHandler
+ * {
+ *  public:
+ *   AssignHandler(const KMeansModel& model) : model(model) { }
+ *
+ *   bool Handle(const ServerRequest& request, ServerResponse& response)
+ *   {
+ *     if (request.command != "assign")
+ *     {
+ *       response.error = "unknown command '" + request.command + "'";
+ *       return false;
+ *     }
+ *     ...
+ *   }
+ * };
+ *
+ * AssignHandler handler(model);
+ * Server<AssignHandler> server(handler);
+ * server.Run("/tmp/kmeans.sock");
+ * @endcode
+ *
+ * and queried with, for instance, 'printf "assign 2\n1,2\n3,4\n" | nc -U
+ * /tmp/kmeans.sock'.
+ *
+ * @tparam HandlerType The class which answers the requests.
+ */
+template<typename HandlerType>
+class Server
+{
+ public:
+  /**
+   * Create the server.
+   *
+   * @param handler The object which answers the requests.
+   */
+  Server(HandlerType& handler) : handler(handler), requests(0) { }
+
+  /**
+   * Serve the requests received at the given address until a 'shutdown'
+   * request is received (or, for the standard input, until its end).
+   *
+   * @param address "-" for the standard input and output, or the path of a
+   *     Unix socket to create.
+   */
+  void Run(const std::string& address);
+
+  /**
+   * Serve the requests read from the given stream until its end, or until a
+   * 'quit' or 'shutdown' request.
+   *
+   * @param input Stream to read the requests from.
+   * @param output Stream to write the responses to.
+   * @return true if a 'shutdown' request was received.
+   */
+  bool Serve(std::istream& input, std::ostream& output);
+
+  //! Get the number of requests served.
+  size_t Requests() const { return requests; }
+
+ private:
+  //! The object which answers the requests.
+  HandlerType& handler;
+  //! The number of requests served.
+  size_t requests;
+};
+
+}; // namespace util
+}; // namespace mlpack
+
+// Include implementation.
+#include "server_impl.hpp"
+
+#endif
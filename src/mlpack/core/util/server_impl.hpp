@@ -0,0 +1,90 @@
+/**
+ * @file server_impl.hpp
+ *
+ * Implementation of the templated parts of the Server class.
+ */
+#ifndef __MLPACK_CORE_UTIL_SERVER_IMPL_HPP
+#define __MLPACK_CORE_UTIL_SERVER_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "server.hpp"
+
+namespace mlpack {
+namespace util {
+
+template<typename T>
+bool ServerRequest::GetOption(const std::string& name, T& value) const
+{
+  std::map<std::string, std::string>::const_iterator it = options.find(name);
+  if (it == options.end())
+    return true;
+
+  std::istringstream stream(it->second);
+  T result;
+  stream >> result;
+  if (stream.fail() || !(stream >> std::ws).eof())
+    return false;
+
+  value = result;
+  return true;
+}
+
+template<typename HandlerType>
+void Server<HandlerType>::Run(const std::string& address)
+{
+  ServerEndpoint endpoint(address);
+  Log::Info << "Serving requests on '" << address << "'." << std::endl;
+
+  bool shutdown = false;
+  while (!shutdown && endpoint.Accept())
+  {
+    shutdown = Serve(endpoint.Input(), endpoint.Output());
+    endpoint.Close();
+  }
+
+  Log::Info << requests << " requests served." << std::endl;
+}
+
+template<typename HandlerType>
+bool Server<HandlerType>::Serve(std::istream& input, std::ostream& output)
+{
+  static const size_t requestTimer = ScopedTimer::Register("server_request");
+
+  ServerRequest request;
+  std::string error;
+  while (ReadRequest(input, request, error))
+  {
+    ServerResponse response;
+    if (!error.empty())
+    {
+      response.error = error;
+    }
+    else if (request.command == "quit" || request.command == "shutdown")
+    {
+      WriteResponse(output, response);
+      return (request.command == "shutdown");
+    }
+    else if (request.command != "ping")
+    {
+      ScopedTimer t(requestTimer);
+      if (!handler.Handle(request, response) && response.error.empty())
+        response.error = "request failed";
+    }
+
+    ++requests;
+    WriteResponse(output, response);
+    if (!output.good())
+    {
+      Log::Warn << "Could not write the response to a request; closing the "
+          << "connection." << std::endl;
+      return false;
+    }
+  }
+
+  return false;
+}
+
+}; // namespace util
+}; // namespace mlpack
+
+#endif
@@ -9,6 +9,8 @@
 #include "cli.hpp"
 #include "log.hpp"
 
+#include <algorithm>
+#include <limits>
 #include <map>
 #include <string>
 
@@ -34,6 +36,8 @@ inline void timersub(const timeval* tvp, const timeval* uvp, timeval* vvp)
 void Timer::Start(const std::string& name)
 {
   CLI::GetSingleton().timer.StartTimer(name);
+  if (util::Trace::Enabled())
+    util::Trace::Begin(name);
 }
 
 /**
@@ -42,6 +46,8 @@ void Timer::Start(const std::string& name)
 void Timer::Stop(const std::string& name)
 {
   CLI::GetSingleton().timer.StopTimer(name);
+  if (util::Trace::Enabled())
+    util::Trace::End(name);
 }
 
 /**
@@ -255,3 +261,128 @@ void Timers::StopTimer(const std::string& timerName)
   timersub(&b, &a, &delta);
   timers[timerName] = delta;
 }
+
+ScopedTimer::Accumulator* ScopedTimer::accumulators[ScopedTimer::MaxTimers];
+std::vector<std::string> ScopedTimer::names;
+
+size_t ScopedTimer::Register(const std::string& name)
+{
+  size_t handle = MaxTimers;
+
+  #pragma omp critical(mlpack_scoped_timer_register)
+  {
+    for (size_t i = 0; i < names.size(); ++i)
+      if (names[i] == name)
+        handle = i;
+
+    if (handle == MaxTimers && names.size() < MaxTimers)
+    {
+      // The accumulators live until the end of the program, since handles to
+      // them may be kept in static variables anywhere.
+      Accumulator* timerAccumulators = new Accumulator[MaxThreads];
+      for (size_t t = 0; t < MaxThreads; ++t)
+      {
+        timerAccumulators[t].count = 0;
+        timerAccumulators[t].total = 0;
+        timerAccumulators[t].min = std::numeric_limits<uint64_t>::max();
+        timerAccumulators[t].max = 0;
+        timerAccumulators[t].depth = 0;
+      }
+
+      handle = names.size();
+      accumulators[handle] = timerAccumulators;
+      names.push_back(name);
+    }
+  }
+
+  if (handle == MaxTimers)
+  {
+    Log::Fatal << "ScopedTimer::Register(): cannot register timer '" << name
+        << "'; at most " << MaxTimers << " timers can be registered."
+        << std::endl;
+  }
+
+  return handle;
+}
+
+TimerStatistics ScopedTimer::Statistics(const size_t handle)
+{
+  uint64_t count = 0;
+  uint64_t total = 0;
+  uint64_t min = std::numeric_limits<uint64_t>::max();
+  uint64_t max = 0;
+  for (size_t t = 0; t < MaxThreads; ++t)
+  {
+    const Accumulator& a = accumulators[handle][t];
+    count += a.count;
+    total += a.total;
+    min = std::min(min, a.min);
+    max = std::max(max, a.max);
+  }
+
+  TimerStatistics statistics;
+  statistics.count = (size_t) count;
+  statistics.total = 1e-9 * total;
+  statistics.min = (count == 0) ? 0.0 : 1e-9 * min;
+  statistics.max = 1e-9 * max;
+  return statistics;
+}
+
+void ScopedTimer::Reset(const size_t handle)
+{
+  for (size_t t = 0; t < MaxThreads; ++t)
+  {
+    accumulators[handle][t].count = 0;
+    accumulators[handle][t].total = 0;
+    accumulators[handle][t].min = std::numeric_limits<uint64_t>::max();
+    accumulators[handle][t].max = 0;
+  }
+}
+
+std::string ScopedTimer::Name(const size_t handle)
+{
+  std::string name;
+  #pragma omp critical(mlpack_scoped_timer_register)
+  name = names[handle];
+  return name;
+}
+
+size_t ScopedTimer::NumTimers()
+{
+  size_t numTimers;
+  #pragma omp critical(mlpack_scoped_timer_register)
+  numTimers = names.size();
+  return numTimers;
+}
+
+uint64_t ScopedTimer::Now()
+{
+#if defined(__MACH__) && defined(__APPLE__)
+  static mach_timebase_info_data_t info;
+  if (info.denom == 0)
+    (void) mach_timebase_info(&info);
+
+  return mach_absolute_time() * info.numer / info.denom;
+#elif defined(_POSIX_VERSION) && defined(_POSIX_TIMERS) && (_POSIX_TIMERS > 0)
+  struct timespec ts;
+#if defined(CLOCK_MONOTONIC)
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+  clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+  return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+#elif defined(_WIN32)
+  static LARGE_INTEGER frequency;
+  if (frequency.QuadPart == 0)
+    QueryPerformanceFrequency(&frequency);
+
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  return (uint64_t) ((double) counter.QuadPart * 1e9 /
+      (double) frequency.QuadPart);
+#else
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t) tv.tv_sec * 1000000000 + (uint64_t) tv.tv_usec * 1000;
+#endif
+}
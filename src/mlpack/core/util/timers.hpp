@@ -10,14 +10,23 @@
 
 #include <map>
 #include <string>
+#include <vector>
+
+#include "trace.hpp"
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
 
 #if defined(__unix__) || defined(__unix)
+  #include <stdint.h>     // uint64_t
   #include <time.h>       // clock_gettime()
   #include <sys/time.h>   // timeval, gettimeofday()
   #include <unistd.h>     // flags like  _POSIX_VERSION
 #elif defined(__MACH__) && defined(__APPLE__)
   #include <mach/mach_time.h>   // mach_timebase_info,
                                 // mach_absolute_time()
+  #include <stdint.h>           // uint64_t
 
   // TEMPORARY
   #include <time.h>       // clock_gettime()
@@ -138,6 +147,172 @@ class Timers
   void GetTime(timeval* tv);
 };
 
+/**
+ * The statistics of a scoped timer (see ScopedTimer), merged over all threads.
+ * Times are in seconds.
+ */
+struct TimerStatistics
+{
+  //! The number of timed scopes.
+  size_t count;
+  //! The total time spent in the timed scopes.
+  double total;
+  //! The time of the shortest scope.
+  double min;
+  //! The time of the longest scope.
+  double max;
+
+  //! Get the mean time of a scope.
+  double Mean() const { return (count == 0) ? 0.0 : total / count; }
+};
+
+/**
+ * A timer for code that may run in parallel, where Timer (which looks names up
+ * in a map, and is not thread-safe) cannot be used.  A timer is registered once
+ * by name, which gives a handle; then a ScopedTimer object created with the
+ * handle times its own lifetime.  Each thread adds its times to its own
+ * accumulator (on its own cache line), so timing a scope costs two reads of a
+ * monotonic clock and no locking; the accumulators are merged by Statistics(),
+ * and CLI prints every scoped timer with the other timers at the end of the
+ * program (with --verbose).  If a trace is being recorded (see util::Trace),
+ * each outermost scope is also a region of the trace.
+ *
+ * Scopes of the same timer may be nested in one thread; only the outermost
+ * scope is timed, so the time is not counted twice.  Threads are told apart by
+ * their OpenMP thread number, so nested parallel regions (and threads not
+ * created by OpenMP) share accumulators and must not time the same timer at
+ * once.
+ *
+ * @code
+ * static const size_t searchTimer = ScopedTimer::Register("chunk_search");
+ *
+ * #pragma omp parallel for
+ * for (size_t i = 0; i < numChunks; ++i)
+ * {
+ *   ScopedTimer t(searchTimer);
+ *   SearchChunk(i);
+ * }
+ *
+ * Log::Info << "Mean time per chunk: "
+ *     << ScopedTimer::Statistics(searchTimer).Mean() << "s." << std::endl;
+ * @endcode
+ */
+class ScopedTimer
+{
+ public:
+  /**
+   * Register the timer with the given name, and return its handle.  If a
+   * timer with this name is already registered, its handle is returned.  This
+   * is thread-safe, but slow, so it should be done once, before timing.
+   *
+   * @param name Name of the timer.
+   */
+  static size_t Register(const std::string& name);
+
+  /**
+   * Start timing the scope for the given timer.
+   *
+   * @param handle Handle of the timer (see Register()).
+   */
+  ScopedTimer(const size_t handle) :
+      handle(handle),
+      accumulator(ThreadAccumulator(handle))
+  {
+    if (accumulator.depth++ == 0)
+    {
+      start = Now();
+      if (util::Trace::Enabled())
+        util::Trace::Begin(Name(handle));
+    }
+  }
+
+  //! Stop timing the scope, and add its time to the timer.
+  ~ScopedTimer()
+  {
+    if (--accumulator.depth == 0)
+    {
+      accumulator.Add(Now() - start);
+      if (util::Trace::Enabled())
+        util::Trace::End(Name(handle));
+    }
+  }
+
+  /**
+   * Get the statistics of the given timer, merged over all threads.  This
+   * should not be called while the timer is running in other threads.
+   *
+   * @param handle Handle of the timer.
+   */
+  static TimerStatistics Statistics(const size_t handle);
+
+  //! Reset the statistics of the given timer (not while it is running).
+  static void Reset(const size_t handle);
+
+  //! Get the name of the given timer.
+  static std::string Name(const size_t handle);
+
+  //! Get the number of registered timers; their handles are 0 to this - 1.
+  static size_t NumTimers();
+
+  //! Get the value of a monotonic clock, in nanoseconds.
+  static uint64_t Now();
+
+ private:
+  //! The maximum number of timers.
+  static const size_t MaxTimers = 1024;
+  //! The number of accumulators of each timer; threads with numbers at least
+  //! this large share them.
+  static const size_t MaxThreads = 256;
+
+  //! The times of one timer in one thread, in nanoseconds, on a cache line.
+  struct Accumulator
+  {
+    //! The number of timed scopes.
+    uint64_t count;
+    //! The total time.
+    uint64_t total;
+    //! The shortest time.
+    uint64_t min;
+    //! The longest time.
+    uint64_t max;
+    //! The number of open scopes (more than one if they are nested).
+    size_t depth;
+    //! Padding, so that the accumulators of two threads never share a line.
+    char padding[64 - 4 * sizeof(uint64_t) - sizeof(size_t)];
+
+    //! Add the time of one scope.
+    void Add(const uint64_t time)
+    {
+      ++count;
+      total += time;
+      min = (time < min) ? time : min;
+      max = (time > max) ? time : max;
+    }
+  };
+
+  //! Get the accumulator of the given timer for the calling thread.
+  static Accumulator& ThreadAccumulator(const size_t handle)
+  {
+#ifdef _OPENMP
+    return accumulators[handle][omp_get_thread_num() % MaxThreads];
+#else
+    return accumulators[handle][0];
+#endif
+  }
+
+  //! The accumulators of each registered timer (MaxThreads for each).
+  static Accumulator* accumulators[MaxTimers];
+  //! The names of the registered timers.
+  static std::vector<std::string> names;
+
+  //! The handle of the timer.
+  size_t handle;
+  //! The accumulator of this scope.
+  Accumulator& accumulator;
+  //! The time the scope started at.
+  uint64_t start;
+};
+
 }; // namespace mlpack
 
 #endif // __MLPACK_CORE_UTILITIES_TIMERS_HPP
@@ -0,0 +1,307 @@
+/**
+ * @file trace.cpp
+ *
+ * Implementation of the Trace class.
+ */
+#include "trace.hpp"
+#include "timers.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#ifdef __linux__
+  #include <linux/perf_event.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+  #include <cstring>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::util;
+
+bool Trace::enabled = false;
+
+//! The number of hardware counters of each region.
+static const size_t NumCounters = 3;
+
+//! A region which has started, but not ended.
+struct OpenRegion
+{
+  //! The name of the region.
+  std::string name;
+  //! The time the region started at.
+  uint64_t start;
+  //! The hardware counters when the region started.
+  uint64_t counters[NumCounters];
+};
+
+//! A region which has ended.
+struct Region
+{
+  //! The name of the region.
+  std::string name;
+  //! The thread which ran the region.
+  long thread;
+  //! The time the region started at.
+  uint64_t start;
+  //! The duration of the region.
+  uint64_t duration;
+  //! Whether the hardware counters were recorded.
+  bool hasCounters;
+  //! The hardware counters of the region.
+  uint64_t counters[NumCounters];
+};
+
+//! The state of the trace of one thread.
+struct ThreadTrace
+{
+  ThreadTrace() : countersOpened(false)
+  {
+    for (size_t i = 0; i < NumCounters; ++i)
+      counterFiles[i] = -1;
+  }
+
+  //! The regions which have started, but not ended.
+  std::vector<OpenRegion> open;
+  //! Whether the hardware counters of the thread were opened.
+  bool countersOpened;
+  //! The file descriptors of the hardware counters (-1 if not available).
+  int counterFiles[NumCounters];
+};
+
+//! The names of the hardware counters.
+static const char* counterNames[NumCounters] = { "cycles", "instructions",
+    "cache_misses" };
+
+//! The file the trace is written to.
+static std::string traceFilename;
+//! Whether the hardware counters are recorded.
+static bool countersEnabled = false;
+//! The time the trace started at.
+static uint64_t traceStart = 0;
+//! The regions which have ended.
+static std::vector<Region> regions;
+//! The state of each thread.
+static std::map<long, ThreadTrace> threadTraces;
+
+//! Get an identifier of the calling thread.
+static long ThreadID()
+{
+#ifdef __linux__
+  return (long) syscall(SYS_gettid);
+#elif defined(_OPENMP)
+  return (long) omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+#ifdef __linux__
+//! Open a hardware counter of the calling thread; return -1 if it can't be.
+static int OpenCounter(const uint64_t config)
+{
+  struct perf_event_attr attributes;
+  memset(&attributes, 0, sizeof(attributes));
+  attributes.size = sizeof(attributes);
+  attributes.type = PERF_TYPE_HARDWARE;
+  attributes.config = config;
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+
+  return (int) syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+#endif
+
+//! Read the hardware counters of the calling thread (opening them the first
+//! time); return whether they are available.
+static bool ReadCounters(ThreadTrace& thread, uint64_t* counters)
+{
+#ifdef __linux__
+  if (!thread.countersOpened)
+  {
+    const uint64_t configs[NumCounters] = { PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES };
+    for (size_t i = 0; i < NumCounters; ++i)
+      thread.counterFiles[i] = OpenCounter(configs[i]);
+    thread.countersOpened = true;
+  }
+
+  for (size_t i = 0; i < NumCounters; ++i)
+  {
+    if (thread.counterFiles[i] == -1 || read(thread.counterFiles[i],
+        &counters[i], sizeof(uint64_t)) != sizeof(uint64_t))
+      return false;
+  }
+
+  return true;
+#else
+  (void) thread;
+  (void) counters;
+  return false;
+#endif
+}
+
+//! Close the hardware counters of the given thread.
+static void CloseCounters(ThreadTrace& thread)
+{
+#ifdef __linux__
+  for (size_t i = 0; i < NumCounters; ++i)
+    if (thread.counterFiles[i] != -1)
+      close(thread.counterFiles[i]);
+#endif
+  thread.countersOpened = false;
+}
+
+//! Write the given string as a JSON string.
+static void WriteString(std::ofstream& stream, const std::string& value)
+{
+  stream << '"';
+  for (size_t i = 0; i < value.size(); ++i)
+  {
+    const char c = value[i];
+    if (c == '"' || c == '\\')
+    {
+      stream << '\\' << c;
+    }
+    else if ((unsigned char) c < 0x20)
+    {
+      char escaped[8];
+      sprintf(escaped, "\\u%04x", (unsigned int) c);
+      stream << escaped;
+    }
+    else
+    {
+      stream << c;
+    }
+  }
+  stream << '"';
+}
+
+bool Trace::Open(const std::string& filename)
+{
+  // Make sure the file can be written before anything is recorded.
+  std::ofstream stream(filename.c_str());
+  if (!stream.is_open())
+    return false;
+
+  #pragma omp critical(mlpack_trace)
+  {
+    traceFilename = filename;
+    traceStart = ScopedTimer::Now();
+    regions.clear();
+    threadTraces.clear();
+    enabled = true;
+  }
+
+  return true;
+}
+
+bool Trace::EnableCounters()
+{
+  uint64_t counters[NumCounters];
+  ThreadTrace test;
+  const bool available = ReadCounters(test, counters);
+  CloseCounters(test);
+
+  countersEnabled = available;
+  return available;
+}
+
+void Trace::Begin(const std::string& name)
+{
+  #pragma omp critical(mlpack_trace)
+  if (enabled)
+  {
+    ThreadTrace& thread = threadTraces[ThreadID()];
+    OpenRegion region;
+    region.name = name;
+    if (!countersEnabled || !ReadCounters(thread, region.counters))
+      region.counters[0] = uint64_t(-1);
+    region.start = ScopedTimer::Now();
+    thread.open.push_back(region);
+  }
+}
+
+void Trace::End(const std::string& name)
+{
+  const uint64_t end = ScopedTimer::Now();
+
+  #pragma omp critical(mlpack_trace)
+  if (enabled)
+  {
+    const long id = ThreadID();
+    ThreadTrace& thread = threadTraces[id];
+
+    // Find the last start of this region.
+    size_t i = thread.open.size();
+    while (i > 0 && thread.open[i - 1].name != name)
+      --i;
+
+    if (i > 0)
+    {
+      const OpenRegion& start = thread.open[i - 1];
+      Region region;
+      region.name = name;
+      region.thread = id;
+      region.start = start.start;
+      region.duration = end - start.start;
+
+      uint64_t counters[NumCounters];
+      region.hasCounters = (start.counters[0] != uint64_t(-1)) &&
+          ReadCounters(thread, counters);
+      for (size_t c = 0; region.hasCounters && c < NumCounters; ++c)
+        region.counters[c] = counters[c] - start.counters[c];
+
+      regions.push_back(region);
+      thread.open.erase(thread.open.begin() + (i - 1));
+    }
+  }
+}
+
+void Trace::Close()
+{
+  if (!enabled)
+    return;
+
+  #pragma omp critical(mlpack_trace)
+  enabled = false;
+
+  std::ofstream stream(traceFilename.c_str());
+  stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+  // Each region is a complete event, with its start and duration in
+  // microseconds.
+  char time[64];
+  for (size_t i = 0; i < regions.size(); ++i)
+  {
+    const Region& region = regions[i];
+    stream << ((i == 0) ? "\n" : ",\n") << "{\"name\":";
+    WriteString(stream, region.name);
+    sprintf(time, "%.3f,\"dur\":%.3f", (region.start - traceStart) / 1000.0,
+        region.duration / 1000.0);
+    stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << region.thread << ",\"ts\":"
+        << time;
+
+    if (region.hasCounters)
+    {
+      stream << ",\"args\":{";
+      for (size_t c = 0; c < NumCounters; ++c)
+        stream << "\"" << counterNames[c] << "\":" << region.counters[c] << ",";
+      sprintf(time, "%.3f", (region.counters[0] == 0) ? 0.0 :
+          (double) region.counters[1] / region.counters[0]);
+      stream << "\"ipc\":" << time << "}";
+    }
+
+    stream << "}";
+  }
+  stream << "\n]}\n";
+
+  std::map<long, ThreadTrace>::iterator it;
+  for (it = threadTraces.begin(); it != threadTraces.end(); ++it)
+    CloseCounters(it->second);
+
+  regions.clear();
+  threadTraces.clear();
+}
@@ -0,0 +1,104 @@
+/**
+ * @file trace.hpp
+ *
+ * Recording of a trace of the timed regions and parallel tasks of each thread,
+ * written in the Chrome trace event format.
+ */
+#ifndef __MLPACK_CORE_UTIL_TRACE_HPP
+#define __MLPACK_CORE_UTIL_TRACE_HPP
+
+#include <string>
+
+namespace mlpack {
+namespace util {
+
+/**
+ * A trace of the regions each thread runs: the Timer regions, the ScopedTimer
+ * scopes and the tasks started with TaskGroup.  Unlike the timers, which only
+ * add up the time of each name, the trace shows when each region ran and on
+ * which thread, so the overlap of phases, the utilization of the threads and
+ * stragglers can be seen.  The trace is written by Close() in the Chrome trace
+ * event format (JSON), which chrome://tracing and the Perfetto UI open.  This
+ * is what the --trace_file option of the command-line programs does.
+ *
+ * Optionally, the hardware counters of each region (cycles, instructions and
+ * cache misses, from perf_event on Linux) are recorded too, and shown with
+ * each region (with the instructions per cycle).  The counters count the
+ * thread which ran the region only, so for a region which starts a parallel
+ * region (like a Timer around a parallel search), the regions of the other
+ * threads must be looked at too.
+ *
+ * Recording is off until Open() is called; while it is off, each region costs
+ * a single test.  While it is on, regions are recorded under a lock, so very
+ * small regions (or very many tasks) slow the program down.
+ */
+class Trace
+{
+ public:
+  /**
+   * Start recording a trace, to be written to the given file by Close().
+   *
+   * @param filename File to write the trace to.
+   * @return Whether the file can be written.
+   */
+  static bool Open(const std::string& filename);
+
+  /**
+   * Record the hardware counters of each region too.
+   *
+   * @return Whether the counters are available (only on Linux, and only if the
+   *     kernel allows it; see /proc/sys/kernel/perf_event_paranoid).
+   */
+  static bool EnableCounters();
+
+  //! Write the trace and stop recording.
+  static void Close();
+
+  //! Return whether a trace is being recorded.
+  static bool Enabled() { return enabled; }
+
+  //! Record the start of the given region in the calling thread.
+  static void Begin(const std::string& name);
+
+  //! Record the end of the given region in the calling thread.  Regions may
+  //! overlap; the end is matched with the last start of the same name (and
+  //! ignored if there is none, as for a region which started before Open()).
+  static void End(const std::string& name);
+
+ private:
+  //! Whether a trace is being recorded.
+  static bool enabled;
+};
+
+/**
+ * A region of the trace for the lifetime of the object (if a trace is being
+ * recorded).
+ */
+class TraceScope
+{
+ public:
+  //! Start the given region.
+  TraceScope(const char* name) : name(name), active(Trace::Enabled())
+  {
+    if (active)
+      Trace::Begin(name);
+  }
+
+  //! End the region.
+  ~TraceScope()
+  {
+    if (active)
+      Trace::End(name);
+  }
+
+ private:
+  //! The name of the region.
+  const char* name;
+  //! Whether the start of the region was recorded.
+  bool active;
+};
+
+}; // namespace util
+}; // namespace mlpack
+
+#endif
@@ -59,13 +59,17 @@ AdaBoost<MatType, WeakLearner>::AdaBoost(
   // To be used for prediction by the Weak Learner for prediction.
   arma::Row<size_t> predictedLabels(labels.n_cols);
 
-  // Use tempData to modify input Data for incorporating weights.
-  MatType tempData(data);
-
   // This matrix is a helper matrix used to calculate the final hypothesis.
   arma::mat sumFinalH(predictedLabels.n_cols, numClasses);
   sumFinalH.fill(0.0);
 
+  // The signs added to the final hypothesis in each round: +1 for the label of
+  // each point, and -1 for the other classes.
+  arma::mat labelSigns(predictedLabels.n_cols, numClasses);
+  labelSigns.fill(-1.0);
+  for (size_t j = 0; j < labels.n_cols; j++)
+    labelSigns(j, labels(j)) = 1.0;
+
   // load the initial weights into a 2-D matrix
   const double initWeight = 1.0 / double(data.n_cols * numClasses);
   arma::mat D(data.n_cols, numClasses);
@@ -81,43 +85,21 @@ AdaBoost<MatType, WeakLearner>::AdaBoost(
   // now start the boosting rounds
   for (int i = 0; i < iterations; i++)
   {
-    // Initialized to zero in every round.
-    // rt is used for calculation of alphat, is the weighted error
-    // rt = (sum)D(i)y(i)ht(xi)
-    rt = 0.0;
-
-    // zt is used for weight normalization.
-    zt = 0.0;
-
     // Build the weight vectors
     BuildWeightMatrix(D, weights);
 
-    // call the other weak learner and train the labels.
-    WeakLearner w(other, tempData, weights, labels);
-    w.Classify(tempData, predictedLabels);
-
-    // Now from predictedLabels, build ht, the weak hypothesis
-    // buildClassificationMatrix(ht, predictedLabels);
+    // call the other weak learner and train the labels.  The weights are
+    // handed to the weak learner directly; the data is not copied.
+    WeakLearner w(other, data, weights, labels);
+    w.Classify(data, predictedLabels);
 
-    // Now, start calculation of alpha(t) using ht
+    // 1 for the points classified correctly, 0 for the others.
+    const arma::rowvec correct = arma::conv_to<arma::rowvec>::from(
+        predictedLabels == labels);
 
-    for (size_t j = 0;j < D.n_rows; j++) // instead of D, ht
-    {
-      if (predictedLabels(j) == labels(j))
-      {
-        // for (int k = 0;k < numClasses; k++)
-        //   rt += D(j,k);
-        rt += arma::accu(D.row(j));
-      }
-
-      else
-      {
-        // for (int k = 0;k < numClasses; k++)
-        //   rt -= D(j,k);
-        rt -= arma::accu(D.row(j));
-      }
-    }
-    // end calculation of rt
+    // rt is used for calculation of alphat, is the weighted error
+    // rt = (sum)D(i)y(i)ht(xi); the sums of the rows of D are the weights.
+    rt = arma::accu(weights % (2 * correct - 1));
 
     if (i > 0)
     {
@@ -134,45 +116,22 @@ AdaBoost<MatType, WeakLearner>::AdaBoost(
     alpha.push_back(alphat);
     wl.push_back(w);
 
-    // now start modifying weights
-    for (size_t j = 0;j < D.n_rows; j++)
-    {
-      double expo = exp(alphat);
-      if (predictedLabels(j) == labels(j))
-      {
-          for (size_t k = 0;k < D.n_cols; k++)
-          {
-            // we calculate zt, the normalization constant
-            zt += D(j,k) / expo; // * exp(-1 * alphat * yt(j,k) * ht(j,k));
-            D(j,k) = D(j,k) / expo;
-
-            // adding to the matrix of FinalHypothesis
-            // sumFinalH(j,k) += (alphat * ht(j,k));
-            if (k == labels(j))
-              sumFinalH(j,k) += (alphat);// * ht(j,k));
-            else
-              sumFinalH(j,k) -= (alphat);
-          }
-      }
-      else
-      {
-        for (size_t k = 0;k < D.n_cols; k++)
-          {
-            // we calculate zt, the normalization constant
-            zt += D(j,k) * expo;
-            D(j,k) = D(j,k) * expo;
-
-            // adding to the matrix of FinalHypothesis
-            if (k == labels(j))
-              sumFinalH(j,k) += (alphat);// * ht(j,k));
-            else
-              sumFinalH(j,k) -= (alphat);
-          }
-      }
-    }
+    // now start modifying weights: the weights of the points classified
+    // correctly are divided by exp(alphat), and the others are multiplied by
+    // it.
+    const double expo = exp(alphat);
+    const arma::vec scale = trans(correct / expo + (1 - correct) * expo);
+    for (size_t k = 0; k < D.n_cols; k++)
+      D.col(k) %= scale;
+
+    // we calculate zt, the normalization constant
+    zt = arma::accu(D);
+
+    // adding to the matrix of FinalHypothesis
+    sumFinalH += alphat * labelSigns;
 
     // normalization of D
-    D = D / zt;
+    D /= zt;
 
     // Accumulating the value of zt for the Hamming Loss bound.
     ztProduct *= zt;
@@ -205,26 +164,50 @@ void AdaBoost<MatType, WeakLearner>::Classify(
     const MatType& test,
     arma::Row<size_t>& predictedLabels)
 {
-  arma::Row<size_t> tempPredictedLabels(predictedLabels.n_cols);
-  arma::mat cMatrix(numClasses, test.n_cols);
+  predictedLabels.set_size(test.n_cols);
 
-  cMatrix.zeros();
-  predictedLabels.zeros();
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  // Each thread adds the alpha-weighted votes of some of the weak learners for
+  // every point.
+  std::vector<arma::mat> threadVotes(threads);
+  for (size_t t = 0; t < threads; t++)
+    threadVotes[t].zeros(numClasses, test.n_cols);
 
-  for (size_t i = 0;i < wl.size(); i++)
+  #pragma omp parallel num_threads(threads)
   {
-    wl[i].Classify(test, tempPredictedLabels);
+#ifdef _OPENMP
+    const size_t thread = omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+
+    arma::Row<size_t> tempPredictedLabels(test.n_cols);
 
-    for (size_t j = 0; j < tempPredictedLabels.n_cols; j++)
-      cMatrix(tempPredictedLabels(j), j) += (alpha[i] * tempPredictedLabels(j));
+    #pragma omp for schedule(static)
+    for (size_t i = 0; i < wl.size(); i++)
+    {
+      wl[i].Classify(test, tempPredictedLabels);
+
+      for (size_t j = 0; j < tempPredictedLabels.n_cols; j++)
+        threadVotes[thread](tempPredictedLabels(j), j) += alpha[i];
+    }
   }
-  
-  arma::colvec cMRow;
-  arma::uword max_index;
 
+  // Sum the votes in order, so the result does not depend on the scheduling.
+  arma::mat cMatrix = threadVotes[0];
+  for (size_t t = 1; t < threads; t++)
+    cMatrix += threadVotes[t];
+
+  #pragma omp parallel for schedule(static)
   for (size_t i = 0; i < predictedLabels.n_cols; i++)
   {
-    cMRow = cMatrix.col(i);
+    const arma::colvec cMRow = cMatrix.col(i);
+    arma::uword max_index;
     cMRow.max(max_index);
     predictedLabels(i) = max_index;
   }
@@ -244,14 +227,7 @@ void AdaBoost<MatType, WeakLearner>::BuildWeightMatrix(
     const arma::mat& D,
     arma::rowvec& weights)
 {
-  size_t i, j;
-  weights.fill(0.0);
-
-  for (i = 0; i < D.n_rows; i++)
-  {
-    for (j = 0; j < D.n_cols; j++)
-      weights(i) += D(i, j);
-  }
+  weights = trans(arma::sum(D, 1));
 }
 
 } // namespace adaboost
@@ -17,9 +17,11 @@
 
 #include <mlpack/methods/amf/update_rules/nmf_mult_dist.hpp>
 #include <mlpack/methods/amf/update_rules/nmf_als.hpp>
+#include <mlpack/methods/amf/update_rules/sparse_als.hpp>
 #include <mlpack/methods/amf/update_rules/svd_batch_learning.hpp>
 #include <mlpack/methods/amf/update_rules/svd_incomplete_incremental_learning.hpp>
 #include <mlpack/methods/amf/update_rules/svd_complete_incremental_learning.hpp>
+#include <mlpack/methods/amf/update_rules/svd_parallel_sgd_learning.hpp>
 
 #include <mlpack/methods/amf/init_rules/random_init.hpp>
 
@@ -136,6 +138,28 @@ typedef amf::AMF<amf::SimpleResidueTermination,
                  amf::RandomInitialization, 
                  amf::NMFALSUpdate> NMFALSFactorizer;
 
+/**
+ * SparseALSFactorizer factorizes the given sparse matrix V into two matrices
+ * W and H by alternating least squares on the observed entries of V only, with
+ * the columns (and rows) solved in parallel.
+ *
+ * @see SparseALSUpdate
+ */
+typedef amf::AMF<amf::SimpleToleranceTermination<arma::sp_mat>,
+                 amf::RandomInitialization,
+                 amf::SparseALSUpdate> SparseALSFactorizer;
+
+/**
+ * SparseSVDParallelSGDFactorizer factorizes the given sparse matrix V into two
+ * matrices W and H by stochastic gradient descent on the nonzero entries of V,
+ * run in parallel with the stratified schedule of DSGD.
+ *
+ * @see SVDParallelSGDLearning
+ */
+typedef amf::AMF<amf::SimpleToleranceTermination<arma::sp_mat>,
+                 amf::RandomInitialization,
+                 amf::SVDParallelSGDLearning> SparseSVDParallelSGDFactorizer;
+
 //! Add simple typedefs 
 #ifdef MLPACK_USE_CXX11
 
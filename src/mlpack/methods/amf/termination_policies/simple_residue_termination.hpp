@@ -21,6 +21,10 @@ namespace amf {
  * IsConverged() will return true.  This class is meant for use with the AMF
  * (alternating matrix factorization) class.
  *
+ * The norm of WH is computed without forming WH, as
+ * \f$ \| W H \|_F^2 = \sum_{ij} (W^T W)_{ij} (H H^T)_{ij} \f$, which only needs
+ * two r x r products.
+ *
  * @see AMF
  */
 class SimpleResidueTermination
@@ -62,8 +66,10 @@ class SimpleResidueTermination
    */
   bool IsConverged(arma::mat& W, arma::mat& H)
   {
-    // Calculate the norm and compute the residue
-    const double norm = arma::norm(W * H, "fro");
+    // Calculate the norm and compute the residue.  ||WH||_F^2 is the sum of
+    // the elementwise product of W^T W and H H^T.
+    const double norm = std::sqrt(std::max(arma::accu((W.t() * W) %
+        (H * H.t())), 0.0));
     residue = fabs(normOld - norm) / normOld;
 
     // Store the norm.
@@ -20,6 +20,9 @@ namespace amf {
  * Secondary termination criterion terminates algorithm when iteration count
  * goes above the threshold.
  *
+ * The residue is the RMSE over the nonzero entries of V; only the predictions
+ * for those entries are computed, so the full product WH is never formed.
+ *
  * @see AMF
  */
 template <class MatType>
@@ -63,30 +66,12 @@ class SimpleToleranceTermination
    */
   bool IsConverged(arma::mat& W, arma::mat& H)
   {
-    arma::mat WH;
-
-    WH = W * H;
-
     // compute residue
     residueOld = residue;
-    size_t n = V->n_rows;
-    size_t m = V->n_cols;
+    const arma::mat Wt = W.t();
     double sum = 0;
     size_t count = 0;
-    for(size_t i = 0;i < n;i++)
-    {
-        for(size_t j = 0;j < m;j++)
-        {
-            double temp = 0;
-            if((temp = (*V)(i,j)) != 0)
-            {
-                temp = (temp - WH(i, j));
-                temp = temp * temp;
-                sum += temp;
-                count++;
-            }
-        }
-    }
+    SquaredError(*V, Wt, H, sum, count);
     residue = sum / count;
     residue = sqrt(residue);
 
@@ -153,6 +138,46 @@ class SimpleToleranceTermination
   double& Tolerance() { return tolerance; }
 
  private:
+  //! Sum the squared errors of the predictions for the nonzero entries of a
+  //! dense matrix.
+  template<typename DenseMatType>
+  static void SquaredError(const DenseMatType& V,
+                           const arma::mat& Wt,
+                           const arma::mat& H,
+                           double& sum,
+                           size_t& count)
+  {
+    for(size_t j = 0; j < V.n_cols; j++)
+    {
+      for(size_t i = 0; i < V.n_rows; i++)
+      {
+        const double value = V(i, j);
+        if(value != 0)
+        {
+          const double temp = value - arma::dot(Wt.col(i), H.col(j));
+          sum += temp * temp;
+          count++;
+        }
+      }
+    }
+  }
+
+  //! Sum the squared errors of the predictions for the nonzero entries of a
+  //! sparse matrix.
+  static void SquaredError(const arma::sp_mat& V,
+                           const arma::mat& Wt,
+                           const arma::mat& H,
+                           double& sum,
+                           size_t& count)
+  {
+    for(arma::sp_mat::const_iterator it = V.begin(); it != V.end(); ++it)
+    {
+      const double temp = (*it) - arma::dot(Wt.col(it.row()), H.col(it.col()));
+      sum += temp * temp;
+      count++;
+    }
+  }
+
   //! tolerance
   double tolerance;
   //! iteration threshold
@@ -24,6 +24,9 @@ namespace amf
  * with reverseStepCount. Secondary termination criterion terminates algorithm 
  * when iteration count goes above the threshold. 
  *
+ * Only the predictions for the validation entries are computed; the full
+ * product WH is never formed.
+ *
  * @note The input matrix is modified by this termination policy.
  *
  * @see AMF
@@ -108,10 +111,6 @@ class ValidationRMSETermination
    */
   bool IsConverged(arma::mat& W, arma::mat& H)
   {
-    arma::mat WH;
-
-    WH = W * H;
-
     // compute validation RMSE
     if (iteration != 0)
     {
@@ -122,7 +121,7 @@ class ValidationRMSETermination
         size_t t_row = test_points(i, 0);
         size_t t_col = test_points(i, 1);
         double t_val = test_points(i, 2);
-        double temp = (t_val - WH(t_row, t_col));
+        double temp = (t_val - arma::dot(W.row(t_row), H.col(t_col)));
         temp *= temp;
         rmse += temp;
       }
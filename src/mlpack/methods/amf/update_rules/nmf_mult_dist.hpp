@@ -19,18 +19,37 @@ namespace amf {
  * that the Frobenius norm \f$ \sqrt{\sum_i \sum_j(V-WH)^2} \f$ is
  * non-increasing between subsequent iterations. Both of the update rules
  * for W and H are defined in this file.
+ *
+ * The products are grouped so that no m x n matrix is formed: W H H^T is
+ * computed as W (H H^T) and W^T W H as (W^T W) H.  If the input matrix is an
+ * arma::sp_mat, V H^T and W^T V are computed from the nonzero entries of V
+ * only, one column at a time (in parallel, if OpenMP is available); V H^T is
+ * computed from the transpose of V, which is stored by Initialize().
  */
 class NMFMultiplicativeDistanceUpdate
 {
  public:
-  // Empty constructor required for the UpdateRule template. 
+  // Empty constructor required for the UpdateRule template.
   NMFMultiplicativeDistanceUpdate() { }
 
+  //! Initialize the update rule for a dense input matrix; nothing is stored.
   template<typename MatType>
-  void Initialize(const MatType& dataset, const size_t rank)
+  void Initialize(const MatType& /* dataset */, const size_t /* rank */)
+  {
+    dataT.reset();
+  }
+
+  /**
+   * Initialize the update rule for a sparse input matrix; this stores the
+   * transpose of the input matrix, whose columns are the rows of the input
+   * matrix.
+   *
+   * @param dataset Input matrix to be factorized.
+   * @param rank Rank of the factorization.
+   */
+  void Initialize(const arma::sp_mat& dataset, const size_t /* rank */)
   {
-        (void)dataset;
-        (void)rank;
+    dataT = arma::sp_mat(trans(dataset));
   }
 
   /**
@@ -50,7 +69,28 @@ class NMFMultiplicativeDistanceUpdate
                              arma::mat& W,
                              const arma::mat& H)
   {
-    W = (W % (V * H.t())) / (W * H * H.t());
+    W = (W % (V * H.t())) / (W * (H * H.t()));
+  }
+
+  /**
+   * The update rule for the basis matrix W, for a sparse input matrix; V H^T
+   * is computed as the transpose of H V^T, from the stored transpose of V.
+   *
+   * @param V Input matrix to be factorized.
+   * @param W Basis matrix to be updated.
+   * @param H Encoding matrix.
+   */
+  inline void WUpdate(const arma::sp_mat& V,
+                      arma::mat& W,
+                      const arma::mat& H)
+  {
+    // In case Initialize() was not called with this matrix.
+    if (dataT.n_rows != V.n_cols || dataT.n_cols != V.n_rows)
+      dataT = arma::sp_mat(trans(V));
+
+    arma::mat product;
+    SparseProduct(dataT, H, product);
+    W = (W % trans(product)) / (W * (H * H.t()));
   }
 
   /**
@@ -70,8 +110,57 @@ class NMFMultiplicativeDistanceUpdate
                              const arma::mat& W,
                              arma::mat& H)
   {
-    H = (H % (W.t() * V)) / (W.t() * W * H);
+    H = (H % (W.t() * V)) / ((W.t() * W) * H);
   }
+
+  /**
+   * The update rule for the encoding matrix H, for a sparse input matrix.
+   *
+   * @param V Input matrix to be factorized.
+   * @param W Basis matrix.
+   * @param H Encoding matrix to be updated.
+   */
+  inline static void HUpdate(const arma::sp_mat& V,
+                             const arma::mat& W,
+                             arma::mat& H)
+  {
+    arma::mat product;
+    SparseProduct(V, trans(W), product);
+    H = (H % product) / ((W.t() * W) * H);
+  }
+
+ private:
+  /**
+   * Compute F X for a sparse matrix X, one column at a time, from the nonzero
+   * entries of X only.
+   */
+  static void SparseProduct(const arma::sp_mat& x,
+                            const arma::mat& f,
+                            arma::mat& product)
+  {
+    product.zeros(f.n_rows, x.n_cols);
+
+#ifdef _OPENMP
+    const size_t threads = util::NumThreads();
+#else
+    const size_t threads = 1;
+#endif
+
+    #pragma omp parallel for schedule(dynamic, 64) num_threads(threads) \
+        if(threads > 1)
+    for (size_t j = 0; j < x.n_cols; ++j)
+    {
+      for (size_t k = x.col_ptrs[j]; k < x.col_ptrs[j + 1]; ++k)
+      {
+        const size_t row = x.row_indices[k];
+        for (size_t a = 0; a < f.n_rows; ++a)
+          product(a, j) += x.values[k] * f(a, row);
+      }
+    }
+  }
+
+  //! The transpose of the input matrix, if it is sparse.
+  arma::sp_mat dataT;
 };
 
 }; // namespace amf
@@ -20,9 +20,13 @@ namespace amf {
  * is non-increasing between subsequent iterations. Both of the update rules
  * for W and H are defined in this file.
  *
- * This set of update rules is not meant to work with sparse matrices.  Using
- * sparse matrices often causes NaNs in the output, so other choices of update
- * rules are better in that situation.
+ * If the input matrix is an arma::sp_mat, only the nonzero entries of V
+ * contribute to the sums in the numerators, so (WH)_{i\mu} is only evaluated
+ * at those entries, as the dot product of row i of W and column \mu of H, and
+ * WH is never formed.  The columns of H (and the rows of W, from the
+ * transpose of V, which is stored by Initialize()) are updated in parallel, if
+ * OpenMP is available.  Since the zeros of V are skipped, this also avoids the
+ * 0/0 that the dense update computes where both V and WH are zero.
  */
 class NMFMultiplicativeDivergenceUpdate
 {
@@ -30,11 +34,24 @@ class NMFMultiplicativeDivergenceUpdate
   // Empty constructor required for the WUpdateRule template.
   NMFMultiplicativeDivergenceUpdate() { }
 
+  //! Initialize the update rule for a dense input matrix; nothing is stored.
   template<typename MatType>
-  void Initialize(const MatType& dataset, const size_t rank)
+  void Initialize(const MatType& /* dataset */, const size_t /* rank */)
   {
-    (void)dataset;
-    (void)rank;
+    dataT.reset();
+  }
+
+  /**
+   * Initialize the update rule for a sparse input matrix; this stores the
+   * transpose of the input matrix, whose columns are the rows of the input
+   * matrix.
+   *
+   * @param dataset Input matrix to be factorized.
+   * @param rank Rank of the factorization.
+   */
+  void Initialize(const arma::sp_mat& dataset, const size_t /* rank */)
+  {
+    dataT = arma::sp_mat(trans(dataset));
   }
 
   /**
@@ -79,6 +96,28 @@ class NMFMultiplicativeDivergenceUpdate
     }
   }
 
+  /**
+   * The update rule for the basis matrix W, for a sparse input matrix; each
+   * row of W is updated from the nonzero entries of the corresponding row of
+   * V (a column of the stored transpose of V).
+   *
+   * @param V Input matrix to be factorized.
+   * @param W Basis matrix to be updated.
+   * @param H Encoding matrix.
+   */
+  inline void WUpdate(const arma::sp_mat& V,
+                      arma::mat& W,
+                      const arma::mat& H)
+  {
+    // In case Initialize() was not called with this matrix.
+    if (dataT.n_rows != V.n_cols || dataT.n_cols != V.n_rows)
+      dataT = arma::sp_mat(trans(V));
+
+    arma::mat wt = trans(W);
+    UpdateColumns(dataT, H, wt);
+    W = trans(wt);
+  }
+
   /**
    * The update rule for the encoding matrix H. The formula used is
    * \f[
@@ -120,6 +159,70 @@ class NMFMultiplicativeDivergenceUpdate
       }
     }
   }
+
+  /**
+   * The update rule for the encoding matrix H, for a sparse input matrix; each
+   * column of H is updated from the nonzero entries of the corresponding
+   * column of V.
+   *
+   * @param V Input matrix to be factorized.
+   * @param W Basis matrix.
+   * @param H Encoding matrix to be updated.
+   */
+  inline static void HUpdate(const arma::sp_mat& V,
+                             const arma::mat& W,
+                             arma::mat& H)
+  {
+    UpdateColumns(V, trans(W), H);
+  }
+
+ private:
+  /**
+   * Update each column a_j of A (a column of H, or a row of W) as
+   * \f[
+   * a_j \leftarrow a_j \frac{\sum_k B_k X_{kj} / (B_k^T a_j)}{\sum_k B_k},
+   * \f]
+   * where B_k is column k of B and the sums in the numerator are over the
+   * nonzero entries of column j of X.
+   */
+  static void UpdateColumns(const arma::sp_mat& x,
+                            const arma::mat& b,
+                            arma::mat& a)
+  {
+    const arma::vec sums = arma::sum(b, 1);
+
+#ifdef _OPENMP
+    const size_t threads = util::NumThreads();
+#else
+    const size_t threads = 1;
+#endif
+
+    #pragma omp parallel for schedule(dynamic, 64) num_threads(threads) \
+        if(threads > 1)
+    for (size_t j = 0; j < x.n_cols; ++j)
+    {
+      arma::vec numerator(a.n_rows);
+      numerator.zeros();
+      for (size_t k = x.col_ptrs[j]; k < x.col_ptrs[j + 1]; ++k)
+      {
+        // The approximation (WH) is only evaluated at the nonzero entries.
+        const size_t row = x.row_indices[k];
+        double approximation = 0.0;
+        for (size_t c = 0; c < a.n_rows; ++c)
+          approximation += a(c, j) * b(c, row);
+
+        const double ratio = x.values[k] / approximation;
+        for (size_t c = 0; c < a.n_rows; ++c)
+          numerator[c] += ratio * b(c, row);
+      }
+
+      for (size_t c = 0; c < a.n_rows; ++c)
+        a(c, j) *= numerator[c] / sums[c];
+    }
+  }
+
+  //! The transpose of the input matrix, if it is sparse.
+  arma::sp_mat dataT;
 };
 
 }; // namespace amf
@@ -0,0 +1,164 @@
+/**
+ * @file sparse_als.hpp
+ *
+ * Alternating least squares update rules on the observed entries of a sparse
+ * matrix, for AMF (Alternating Matrix Factorization).
+ */
+#ifndef __MLPACK_METHODS_AMF_UPDATE_RULES_SPARSE_ALS_HPP
+#define __MLPACK_METHODS_AMF_UPDATE_RULES_SPARSE_ALS_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace amf {
+
+/**
+ * This class implements alternating least squares on the observed (nonzero)
+ * entries of the input matrix only, with weighted-lambda regularization, as
+ * described in the paper 'Large-scale Parallel Collaborative Filtering for the
+ * Netflix Prize' by Y. Zhou, D. Wilkinson, R. Schreiber and R. Pan.  Each
+ * column h_j of H is the solution of the normal equations
+ *
+ * \f[
+ * (W_{I_j}^T W_{I_j} + \lambda n_j I) h_j = W_{I_j}^T v_{I_j},
+ * \f]
+ *
+ * where I_j is the set of observed entries of column j of V and n_j is their
+ * number, and each row of W is found the same way from the observed entries of
+ * the corresponding row of V.  Unlike NMFALSUpdate, the unobserved entries are
+ * not treated as zeros, which is what is wanted for rating matrices; the
+ * columns (and rows) are solved in parallel, if OpenMP is available.  The
+ * factors are not constrained to be nonnegative.
+ *
+ * A dense input matrix is treated as a sparse matrix whose zeros are the
+ * unobserved entries.
+ */
+class SparseALSUpdate
+{
+ public:
+  /**
+   * Create the update rule with the given regularization parameter.
+   *
+   * @param lambda Regularization parameter (multiplied by the number of
+   *     observed entries of each row or column).
+   */
+  SparseALSUpdate(const double lambda = 0.05) : lambda(lambda) { }
+
+  /**
+   * Initialize the update rule before a factorization; this stores the
+   * transpose of the input matrix, whose columns are the rows of the input
+   * matrix.
+   *
+   * @param dataset Input matrix to be factorized.
+   * @param rank Rank of the factorization.
+   */
+  template<typename MatType>
+  void Initialize(const MatType& dataset, const size_t /* rank */)
+  {
+    dataT = arma::sp_mat(trans(dataset));
+  }
+
+  /**
+   * The update rule for the basis matrix W: each row of W is solved from the
+   * observed entries of the corresponding row of V, with H fixed.
+   *
+   * @param V Input matrix to be factorized (its transpose was stored by
+   *     Initialize()).
+   * @param W Basis matrix to be updated.
+   * @param H Encoding matrix.
+   */
+  template<typename MatType>
+  inline void WUpdate(const MatType& /* V */,
+                      arma::mat& W,
+                      const arma::mat& H)
+  {
+    arma::mat wt;
+    SolveColumns(dataT, H, wt);
+    W = trans(wt);
+  }
+
+  /**
+   * The update rule for the encoding matrix H: each column of H is solved
+   * from the observed entries of the corresponding column of V, with W fixed.
+   *
+   * @param V Input matrix to be factorized.
+   * @param W Basis matrix.
+   * @param H Encoding matrix to be updated.
+   */
+  inline void HUpdate(const arma::sp_mat& V,
+                      const arma::mat& W,
+                      arma::mat& H)
+  {
+    SolveColumns(V, trans(W), H);
+  }
+
+  //! The update rule for H, for a dense input matrix.
+  template<typename MatType>
+  inline void HUpdate(const MatType& V,
+                      const arma::mat& W,
+                      arma::mat& H)
+  {
+    HUpdate(arma::sp_mat(V), W, H);
+  }
+
+  //! Get the regularization parameter.
+  double Lambda() const { return lambda; }
+  //! Modify the regularization parameter.
+  double& Lambda() { return lambda; }
+
+ private:
+  /**
+   * Solve the regularized least-squares problem of each column of X, against
+   * the columns of the fixed factor corresponding to its observed entries.
+   * Columns without observed entries are set to zero.
+   */
+  void SolveColumns(const arma::sp_mat& x,
+                    const arma::mat& fixed,
+                    arma::mat& out) const
+  {
+    const size_t rank = fixed.n_rows;
+    out.set_size(rank, x.n_cols);
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (size_t j = 0; j < x.n_cols; ++j)
+    {
+      const size_t count = x.col_ptrs[j + 1] - x.col_ptrs[j];
+      if (count == 0)
+      {
+        out.col(j).zeros();
+        continue;
+      }
+
+      // Gather the fixed factors of the observed entries.
+      arma::uvec observed(count);
+      arma::vec values(count);
+      size_t k = 0;
+      for (arma::sp_mat::const_iterator it = x.begin_col(j);
+           it != x.end_col(j); ++it, ++k)
+      {
+        observed[k] = it.row();
+        values[k] = (*it);
+      }
+      const arma::mat factors = fixed.cols(observed);
+
+      arma::mat a = factors * trans(factors);
+      a.diag() += lambda * count;
+
+      arma::vec solution;
+      if (arma::solve(solution, a, factors * values))
+        out.col(j) = solution;
+      else
+        out.col(j).zeros();
+    }
+  }
+
+  //! Regularization parameter.
+  double lambda;
+  //! The transpose of the input matrix.
+  arma::sp_mat dataT;
+}; // class SparseALSUpdate
+
+}; // namespace amf
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,247 @@
+/**
+ * @file svd_parallel_sgd_learning.hpp
+ *
+ * Parallel stochastic gradient descent for SVD with a stratified schedule, for
+ * AMF (Alternating Matrix Factorization).
+ */
+#ifndef __MLPACK_METHODS_AMF_UPDATE_RULES_SVD_PARALLEL_SGD_LEARNING_HPP
+#define __MLPACK_METHODS_AMF_UPDATE_RULES_SVD_PARALLEL_SGD_LEARNING_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace amf {
+
+/**
+ * This class computes SVD with stochastic gradient descent on the nonzero
+ * entries of the input matrix, in parallel, with the stratified schedule of
+ * distributed SGD (DSGD), described in the paper 'Large-Scale Matrix
+ * Factorization with Distributed Stochastic Gradient Descent' by R. Gemulla, E.
+ * Nijkamp, P. Haas and Y. Sismanis.  As with SVDCompleteIncrementalLearning,
+ * each score v_ij updates the feature vectors w_i and h_j:
+ *
+ * \f[
+ * w_i \leftarrow w_i + u ((v_{ij} - w_i h_j) h_j^T - k_w w_i),
+ * h_j \leftarrow h_j + u ((v_{ij} - w_i h_j) w_i^T - k_h h_j).
+ * \f]
+ *
+ * The rows and the columns of the matrix are randomly split into p strata each,
+ * so the scores are split into p x p blocks.  Each pass over the scores is made
+ * of p sub-epochs; in each sub-epoch, p blocks which share no rows or columns
+ * are processed in parallel, one per thread.  So no two threads ever update
+ * the same feature vector and no locking is needed, and each thread sweeps its
+ * block sequentially, as the serial algorithm does.  The scores of each block
+ * are visited in a random order, and the order of the sub-epochs is drawn again
+ * for each pass.
+ *
+ * WUpdate() makes a whole pass over the scores, updating both W and a copy of
+ * H, and HUpdate() stores the new H; so each iteration of AMF is one pass over
+ * the scores, and the rule can be used with any of the termination policies for
+ * whole iterations (such as SimpleToleranceTermination or
+ * ValidationRMSETermination).
+ *
+ * @see SVDCompleteIncrementalLearning
+ */
+class SVDParallelSGDLearning
+{
+ public:
+  /**
+   * Create the update rule.
+   *
+   * @param u Step size.
+   * @param kw Regularization constant for the W matrix.
+   * @param kh Regularization constant for the H matrix.
+   * @param strata Number of strata of the rows and of the columns; 0 means the
+   *     number of OpenMP threads.
+   */
+  SVDParallelSGDLearning(const double u = 0.001,
+                         const double kw = 0,
+                         const double kh = 0,
+                         const size_t strata = 0) :
+      u(u), kw(kw), kh(kh), strata(strata)
+  { }
+
+  /**
+   * Initialize the update rule before a factorization: the nonzero entries of
+   * the input matrix are split into blocks, in a random order.
+   *
+   * @param dataset Input matrix to be factorized.
+   * @param rank Rank of the factorization.
+   */
+  void Initialize(const arma::sp_mat& dataset, const size_t /* rank */)
+  {
+    size_t p = strata;
+    if (p == 0)
+    {
+      #ifdef _OPENMP
+      p = util::NumThreads();
+      #else
+      p = 1;
+      #endif
+    }
+    p = std::max((size_t) 1, std::min(p, std::min(dataset.n_rows,
+        dataset.n_cols)));
+    usedStrata = p;
+
+    // Assign the rows and the columns to strata at random, in equal numbers.
+    const arma::uvec rowOrder = arma::shuffle(arma::linspace<arma::uvec>(0,
+        dataset.n_rows - 1, dataset.n_rows));
+    const arma::uvec colOrder = arma::shuffle(arma::linspace<arma::uvec>(0,
+        dataset.n_cols - 1, dataset.n_cols));
+    arma::Col<size_t> rowStratum(dataset.n_rows);
+    arma::Col<size_t> colStratum(dataset.n_cols);
+    for (size_t i = 0; i < dataset.n_rows; ++i)
+      rowStratum[rowOrder[i]] = i % p;
+    for (size_t j = 0; j < dataset.n_cols; ++j)
+      colStratum[colOrder[j]] = j % p;
+
+    // Find the block of each score, and the number of scores in each block.
+    const size_t n = dataset.n_nonzero;
+    arma::Col<size_t> entryBlock(n);
+    arma::Col<size_t> entryCol(n);
+    blockStart.zeros(p * p + 1);
+    for (size_t j = 0; j < dataset.n_cols; ++j)
+    {
+      for (size_t k = dataset.col_ptrs[j]; k < dataset.col_ptrs[j + 1]; ++k)
+      {
+        entryCol[k] = j;
+        entryBlock[k] = rowStratum[dataset.row_indices[k]] * p + colStratum[j];
+        ++blockStart[entryBlock[k] + 1];
+      }
+    }
+    for (size_t b = 0; b < p * p; ++b)
+      blockStart[b + 1] += blockStart[b];
+
+    // Sort the scores by block, visiting them in a random order so that the
+    // scores of each block are shuffled.
+    rows.set_size(n);
+    cols.set_size(n);
+    values.set_size(n);
+    arma::Col<size_t> next = blockStart.subvec(0, p * p - 1);
+    const arma::uvec order = (n == 0) ? arma::uvec() :
+        arma::shuffle(arma::linspace<arma::uvec>(0, n - 1, n));
+    for (size_t o = 0; o < n; ++o)
+    {
+      const size_t k = order[o];
+      const size_t position = next[entryBlock[k]]++;
+      rows[position] = dataset.row_indices[k];
+      cols[position] = entryCol[k];
+      values[position] = dataset.values[k];
+    }
+  }
+
+  //! Initialize the update rule for a dense input matrix, whose zeros are not
+  //! scores.
+  template<typename MatType>
+  void Initialize(const MatType& dataset, const size_t rank)
+  {
+    Initialize(arma::sp_mat(dataset), rank);
+  }
+
+  /**
+   * Make a pass over all the scores, updating W and H; the new H is stored by
+   * HUpdate(), since H may not be modified here.
+   *
+   * @param V Input matrix to be factorized (its scores were stored by
+   *     Initialize()).
+   * @param W Basis matrix to be updated.
+   * @param H Encoding matrix.
+   */
+  template<typename MatType>
+  inline void WUpdate(const MatType& /* V */,
+                      arma::mat& W,
+                      const arma::mat& H)
+  {
+    h = H;
+
+    const size_t p = usedStrata;
+    const arma::uvec shifts = arma::shuffle(arma::linspace<arma::uvec>(0,
+        p - 1, p));
+    for (size_t s = 0; s < p; ++s)
+    {
+      // Block (b, b + shift) for each row stratum b; these blocks share no rows
+      // and no columns.
+      const size_t shift = shifts[s];
+
+      #pragma omp parallel for schedule(dynamic, 1)
+      for (size_t b = 0; b < p; ++b)
+      {
+        const size_t block = b * p + ((b + shift) % p);
+        for (size_t k = blockStart[block]; k < blockStart[block + 1]; ++k)
+          Step(rows[k], cols[k], values[k], W);
+      }
+    }
+  }
+
+  /**
+   * Store the H matrix computed by the last pass of WUpdate().
+   *
+   * @param V Input matrix to be factorized.
+   * @param W Basis matrix.
+   * @param H Encoding matrix to be updated.
+   */
+  template<typename MatType>
+  inline void HUpdate(const MatType& /* V */,
+                      const arma::mat& /* W */,
+                      arma::mat& H)
+  {
+    H = h;
+  }
+
+  //! Get the step size.
+  double StepSize() const { return u; }
+  //! Modify the step size.
+  double& StepSize() { return u; }
+
+  //! Get the number of strata (0 means the number of threads).
+  size_t Strata() const { return strata; }
+  //! Modify the number of strata (0 means the number of threads).
+  size_t& Strata() { return strata; }
+
+ private:
+  //! Update w_i and h_j with the score v_ij.
+  void Step(const size_t i, const size_t j, const double v, arma::mat& W)
+  {
+    const size_t rank = W.n_cols;
+    double* hj = h.colptr(j);
+
+    double error = v;
+    for (size_t r = 0; r < rank; ++r)
+      error -= W(i, r) * hj[r];
+
+    for (size_t r = 0; r < rank; ++r)
+    {
+      const double wir = W(i, r);
+      W(i, r) += u * (error * hj[r] - kw * wir);
+      hj[r] += u * (error * wir - kh * hj[r]);
+    }
+  }
+
+  //! Step size.
+  double u;
+  //! Regularization parameter for the W matrix.
+  double kw;
+  //! Regularization parameter for the H matrix.
+  double kh;
+  //! Number of strata requested (0 means the number of threads).
+  size_t strata;
+  //! Number of strata of the current factorization.
+  size_t usedStrata;
+
+  //! Rows of the scores, sorted by block.
+  arma::Col<size_t> rows;
+  //! Columns of the scores, sorted by block.
+  arma::Col<size_t> cols;
+  //! Values of the scores, sorted by block.
+  arma::vec values;
+  //! Index of the first score of each block (and the number of scores, last).
+  arma::Col<size_t> blockStart;
+
+  //! The H matrix being updated by the current pass.
+  arma::mat h;
+}; // class SVDParallelSGDLearning
+
+}; // namespace amf
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,215 @@
+/**
+ * @file qdafn.cpp
+ *
+ * Implementation of the QDAFN class.
+ */
+#include "qdafn.hpp"
+
+#include <mlpack/core/metrics/lmetric.hpp>
+#include <algorithm>
+#include <limits>
+
+using namespace mlpack;
+using namespace mlpack::neighbor;
+
+namespace {
+
+//! Orders the reference points by decreasing projection, then by index.
+class ProjectionGreater
+{
+ public:
+  ProjectionGreater(const arma::rowvec& projections) :
+      projections(projections) { }
+
+  bool operator()(const size_t a, const size_t b) const
+  {
+    return (projections[a] != projections[b]) ?
+        (projections[a] > projections[b]) : (a < b);
+  }
+
+ private:
+  const arma::rowvec& projections;
+};
+
+} // anonymous namespace
+
+QDAFN::QDAFN(const arma::mat& referenceSet,
+             const size_t numProjections,
+             const size_t numCandidates) :
+    size(referenceSet.n_cols),
+    candidateSets(numProjections),
+    numThreads(1)
+{
+  if (numProjections == 0)
+    Log::Fatal << "QDAFN: the number of projections must be positive."
+        << std::endl;
+
+  if (numCandidates == 0 || numCandidates > size)
+  {
+    Log::Fatal << "QDAFN: the number of candidates must be between 1 and the "
+        << "number of reference points (" << size << ")." << std::endl;
+  }
+
+  lines.randn(referenceSet.n_rows, numProjections);
+  candidateIndices.set_size(numCandidates, numProjections);
+  candidateValues.set_size(numCandidates, numProjections);
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads(numThreads);
+#else
+  const size_t threads = 1;
+#endif
+
+  // Only the largest projections onto each direction are kept, so they are
+  // selected with a partial sort instead of sorting every point.
+  #pragma omp parallel for num_threads(threads) if(threads > 1) \
+      schedule(dynamic)
+  for (size_t p = 0; p < numProjections; ++p)
+  {
+    const arma::rowvec projections = arma::trans(lines.col(p)) * referenceSet;
+
+    std::vector<size_t> order(size);
+    for (size_t i = 0; i < size; ++i)
+      order[i] = i;
+    std::partial_sort(order.begin(), order.begin() + numCandidates,
+        order.end(), ProjectionGreater(projections));
+
+    candidateSets[p].set_size(referenceSet.n_rows, numCandidates);
+    for (size_t j = 0; j < numCandidates; ++j)
+    {
+      candidateIndices(j, p) = order[j];
+      candidateValues(j, p) = projections[order[j]];
+      candidateSets[p].col(j) = referenceSet.col(order[j]);
+    }
+  }
+}
+
+void QDAFN::Search(const arma::mat& querySet,
+                   const size_t k,
+                   arma::Mat<size_t>& neighbors,
+                   arma::mat& distances) const
+{
+  if (k == 0)
+    Log::Fatal << "QDAFN::Search(): k must be positive." << std::endl;
+
+  if (querySet.n_rows != lines.n_rows)
+  {
+    Log::Fatal << "QDAFN::Search(): the query points have " << querySet.n_rows
+        << " dimensions, but the reference points have " << lines.n_rows
+        << "." << std::endl;
+  }
+
+  neighbors.set_size(k, querySet.n_cols);
+  distances.set_size(k, querySet.n_cols);
+  neighbors.fill(size);
+  distances.zeros();
+
+  const size_t numProjections = NumProjections();
+  const size_t budget = NumCandidates();
+  const arma::mat queryProjections = arma::trans(lines) * querySet;
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads(numThreads);
+#else
+  const size_t threads = 1;
+#endif
+
+  Timer::Start("computing_neighbors");
+
+  #pragma omp parallel num_threads(threads) if(threads > 1)
+  {
+    // The next candidate of each projection, and a max-heap of the projections
+    // ordered by how far their next candidate is from the query along them.
+    std::vector<size_t> positions(numProjections);
+    std::vector<std::pair<double, size_t> > queue;
+    queue.reserve(numProjections);
+
+    #pragma omp for schedule(dynamic, 16)
+    for (size_t q = 0; q < querySet.n_cols; ++q)
+    {
+      const double* queryProjection = queryProjections.colptr(q);
+
+      queue.clear();
+      for (size_t p = 0; p < numProjections; ++p)
+      {
+        positions[p] = 0;
+        queue.push_back(std::make_pair(candidateValues(0, p) -
+            queryProjection[p], p));
+      }
+      std::make_heap(queue.begin(), queue.end());
+
+      double* queryDistances = distances.colptr(q);
+      size_t* queryNeighbors = neighbors.colptr(q);
+      size_t found = 0;
+      for (size_t examined = 0; examined < budget && !queue.empty();
+           ++examined)
+      {
+        std::pop_heap(queue.begin(), queue.end());
+        const size_t p = queue.back().second;
+        queue.pop_back();
+
+        const size_t position = positions[p]++;
+        if (positions[p] < budget)
+        {
+          queue.push_back(std::make_pair(candidateValues(positions[p], p) -
+              queryProjection[p], p));
+          std::push_heap(queue.begin(), queue.end());
+        }
+
+        // A point may be a candidate of several projections.
+        const size_t candidate = candidateIndices(position, p);
+        if (std::find(queryNeighbors, queryNeighbors + found, candidate) !=
+            queryNeighbors + found)
+          continue;
+
+        const double distance = metric::EuclideanDistance::Evaluate(
+            querySet.unsafe_col(q), candidateSets[p].unsafe_col(position));
+        if (found == k && distance <= queryDistances[k - 1])
+          continue;
+
+        // Keep the list in decreasing order of distance.
+        size_t pos = (found < k) ? found++ : k - 1;
+        while (pos > 0 && queryDistances[pos - 1] < distance)
+        {
+          queryDistances[pos] = queryDistances[pos - 1];
+          queryNeighbors[pos] = queryNeighbors[pos - 1];
+          --pos;
+        }
+
+        queryDistances[pos] = distance;
+        queryNeighbors[pos] = candidate;
+      }
+    }
+  }
+
+  Timer::Stop("computing_neighbors");
+}
+
+double QDAFN::ApproximationRatio(const arma::mat& approximateDistances,
+                                 const arma::mat& exactDistances)
+{
+  if (approximateDistances.n_rows != exactDistances.n_rows ||
+      approximateDistances.n_cols != exactDistances.n_cols)
+  {
+    Log::Fatal << "QDAFN::ApproximationRatio(): the approximate distances are "
+        << approximateDistances.n_rows << " x " << approximateDistances.n_cols
+        << ", but the exact distances are " << exactDistances.n_rows << " x "
+        << exactDistances.n_cols << "." << std::endl;
+  }
+
+  if (exactDistances.n_elem == 0)
+    return 1.0;
+
+  double sum = 0.0;
+  for (size_t i = 0; i < exactDistances.n_elem; ++i)
+  {
+    if (approximateDistances[i] > 0.0)
+      sum += exactDistances[i] / approximateDistances[i];
+    else if (exactDistances[i] > 0.0)
+      return std::numeric_limits<double>::infinity();
+    else
+      sum += 1.0; // Both are zero.
+  }
+
+  return sum / exactDistances.n_elem;
+}
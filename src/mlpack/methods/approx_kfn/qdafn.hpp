@@ -0,0 +1,147 @@
+/**
+ * @file qdafn.hpp
+ *
+ * Defines the QDAFN class, which finds approximate furthest neighbors with
+ * random projections, ranking the candidates of each projection by how far
+ * they are from the query along it (query-dependent approximate furthest
+ * neighbor search).
+ *
+ * The details of this method can be found in the following paper:
+ *
+ * @inproceedings{pagh2015approximate,
+ *  title={Approximate furthest neighbor in high dimensions},
+ *  author={Pagh, R. and Silvestri, F. and Sivertsen, J. and Skala, M.},
+ *  booktitle={Similarity Search and Applications (SISAP 2015)},
+ *  pages={3--14},
+ *  year={2015},
+ *  organization={Springer}
+ * }
+ */
+#ifndef __MLPACK_METHODS_APPROX_KFN_QDAFN_HPP
+#define __MLPACK_METHODS_APPROX_KFN_QDAFN_HPP
+
+#include <mlpack/core.hpp>
+#include <vector>
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * The QDAFN class finds approximate furthest neighbors (under the Euclidean
+ * distance) without a tree, whose pruning is weak for furthest neighbors in
+ * high dimensions.  NumProjections() random Gaussian directions are drawn, and
+ * for each direction the NumCandidates() reference points with the largest
+ * projections onto it are stored, in decreasing order of projection.
+ *
+ * To search, the query is projected onto every direction, and the stored
+ * candidates are examined in decreasing order of their projection minus the
+ * projection of the query (a lower bound on their distance to the query, up to
+ * the length of the direction): a priority queue holds the next candidate of
+ * each direction.  At most NumCandidates() candidates are examined for each
+ * query (the candidate budget), and the k furthest of them are returned with
+ * their exact distances.  The search costs O(NumProjections() * d +
+ * NumCandidates() * (d + log NumProjections())) per query, instead of the
+ * O(n d) of brute force.  More projections and candidates give results closer
+ * to the exact furthest neighbors; ApproximationRatio() measures how close.
+ *
+ * Since the candidates are copied into the index, the reference set is not
+ * needed after the index is built.
+ *
+ * @code
+ * extern arma::mat references, queries;
+ * QDAFN qdafn(references, 10, 100); // 10 projections, 100 candidates.
+ *
+ * arma::Mat<size_t> neighbors;
+ * arma::mat distances;
+ * qdafn.Search(queries, 5, neighbors, distances);
+ * @endcode
+ *
+ * If OpenMP is available, the index is built and the queries are searched in
+ * parallel, with NumThreads() threads.
+ */
+class QDAFN
+{
+ public:
+  /**
+   * Draw the random projections and store the candidates of each projection
+   * from the given reference set.
+   *
+   * @param referenceSet Set of reference points.
+   * @param numProjections Number of random projections.
+   * @param numCandidates Number of candidates stored for each projection, and
+   *     examined for each query (at most the number of reference points).
+   */
+  QDAFN(const arma::mat& referenceSet,
+        const size_t numProjections = 10,
+        const size_t numCandidates = 100);
+
+  /**
+   * Find the approximate k furthest neighbors of each query point among the
+   * reference points, furthest first.  Neighbors which are not found (because
+   * fewer than k distinct candidates were examined) have the index Size() and
+   * the distance 0.
+   *
+   * @param querySet Set of query points.
+   * @param k Number of neighbors to find.
+   * @param neighbors Matrix to store the indices of the neighbors in.
+   * @param distances Matrix to store the distances in.
+   */
+  void Search(const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& neighbors,
+              arma::mat& distances) const;
+
+  /**
+   * Return the average, over every query and rank, of the exact distance of
+   * the furthest neighbor of that rank divided by the distance of the returned
+   * neighbor.  This is at least 1, and 1 if the search was exact; it is
+   * infinite if a neighbor was not found.
+   *
+   * @param approximateDistances Distances returned by Search().
+   * @param exactDistances Distances returned by exact search (for instance, by
+   *     AllkFN).
+   */
+  static double ApproximationRatio(const arma::mat& approximateDistances,
+                                   const arma::mat& exactDistances);
+
+  //! Get the number of random projections.
+  size_t NumProjections() const { return lines.n_cols; }
+  //! Get the number of candidates of each projection (the candidate budget).
+  size_t NumCandidates() const { return candidateIndices.n_rows; }
+  //! Get the number of reference points.
+  size_t Size() const { return size; }
+  //! Get the random directions (one per column).
+  const arma::mat& Lines() const { return lines; }
+  //! Get the indices of the candidates of each projection (one projection per
+  //! column, in decreasing order of projection).
+  const arma::Mat<size_t>& CandidateIndices() const { return candidateIndices; }
+  //! Get the projections of the candidates, in the order of
+  //! CandidateIndices().
+  const arma::mat& CandidateValues() const { return candidateValues; }
+
+  //! Get the number of threads used (0 means all available threads).
+  size_t NumThreads() const { return numThreads; }
+  //! Modify the number of threads used (0 means all available threads).  This
+  //! only has an effect if OpenMP is available.
+  size_t& NumThreads() { return numThreads; }
+
+ private:
+  //! The number of reference points.
+  size_t size;
+  //! The random directions, dimensionality x numProjections.
+  arma::mat lines;
+  //! The candidates of each projection.
+  arma::Mat<size_t> candidateIndices;
+  //! The projections of the candidates of each projection.
+  arma::mat candidateValues;
+  //! The candidate points of each projection (one matrix per projection), so
+  //! that the reference set is not needed to search.
+  std::vector<arma::mat> candidateSets;
+  //! The number of threads used.
+  size_t numThreads;
+};
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
@@ -16,7 +16,9 @@
 #include <mlpack/methods/amf/amf.hpp>
 #include <mlpack/methods/amf/update_rules/nmf_als.hpp>
 #include <mlpack/methods/amf/termination_policies/simple_residue_termination.hpp>
+#include "neighbor_search_policies/kd_tree_search_policy.hpp"
 #include <set>
+#include <queue>
 #include <map>
 #include <iostream>
 
@@ -67,14 +69,32 @@ class FactorizerTraits
  * should have three rows.  The first represents the user; the second represents
  * the item; and the third represents the rating.  The user and item, while they
  * are in a matrix that holds doubles, should hold integer (or size_t) values.
- * The user and item indices are assumed to start at 0.
+ * The user and item indices are assumed to start at 0.  Alternately, the
+ * sparse rating matrix itself (with one row per item and one column per user)
+ * can be given, as loaded from a (user, item, rating) coordinate list by
+ * data::Load(); then no dense table is needed at all.
+ *
+ * The neighborhood of each user is found in the latent space of the
+ * factorization with the NeighborSearchPolicy: exactly, with
+ * KDTreeSearchPolicy (the default), CoverTreeSearchPolicy or
+ * BruteForceSearchPolicy, or approximately (trading accuracy for speed when
+ * there are many users), with RASearchPolicy or LSHSearchPolicy.  For
+ * instance,
+ *
+ * @code
+ * CF<amf::NMFALSFactorizer, LSHSearchPolicy> cf(data, amf::NMFALSFactorizer(),
+ *     5, 0, LSHSearchPolicy(10, 20));
+ * @endcode
  *
  * @tparam FactorizerType The type of matrix factorization to use to decompose
  *     the rating matrix (a W and H matrix).  This must implement the method
  *     Apply(arma::sp_mat& data, size_t rank, arma::mat& W, arma::mat& H).
+ * @tparam NeighborSearchPolicy The policy used to find the neighborhoods of
+ *     users; see KDTreeSearchPolicy.
  */
 template<
-    typename FactorizerType = amf::NMFALSFactorizer>
+    typename FactorizerType = amf::NMFALSFactorizer,
+    typename NeighborSearchPolicy = KDTreeSearchPolicy>
 class CF
 {
  public:
@@ -89,11 +109,32 @@ class CF
    * @param factorizer Instantiated factorizer object.
    * @param numUsersForSimilarity Size of the neighborhood.
    * @param rank Rank parameter for matrix factorization.
+   * @param searchPolicy Instantiated neighbor search policy.
    */
   CF(arma::mat& data,
      FactorizerType factorizer = FactorizerType(),
      const size_t numUsersForSimilarity = 5,
-     const size_t rank = 0);
+     const size_t rank = 0,
+     const NeighborSearchPolicy& searchPolicy = NeighborSearchPolicy());
+
+  /**
+   * Initialize the CF object with the sparse rating matrix, which has one row
+   * for each item and one column for each user (so the rating of item i by
+   * user u is data(i, u)).  This is the matrix data::Load() gives for a (user,
+   * item, rating) coordinate list.  The other parameters are the same as
+   * above.
+   *
+   * @param data Sparse rating matrix.
+   * @param factorizer Instantiated factorizer object.
+   * @param numUsersForSimilarity Size of the neighborhood.
+   * @param rank Rank parameter for matrix factorization.
+   * @param searchPolicy Instantiated neighbor search policy.
+   */
+  CF(const arma::sp_mat& data,
+     FactorizerType factorizer = FactorizerType(),
+     const size_t numUsersForSimilarity = 5,
+     const size_t rank = 0,
+     const NeighborSearchPolicy& searchPolicy = NeighborSearchPolicy());
    
   /*void ApplyFactorizer(arma::mat& data, const typename boost::enable_if_c<
       FactorizerTraits<FactorizerType>::IsCleaned == false, int*>::type);
@@ -137,12 +178,15 @@ class CF
     this->factorizer = f;
   }
 
+  //! Get the neighbor search policy.
+  const NeighborSearchPolicy& SearchPolicy() const { return searchPolicy; }
+  //! Modify the neighbor search policy.
+  NeighborSearchPolicy& SearchPolicy() { return searchPolicy; }
+
   //! Get the User Matrix.
   const arma::mat& W() const { return w; }
   //! Get the Item Matrix.
   const arma::mat& H() const { return h; }
-  //! Get the Rating Matrix.
-  const arma::mat& Rating() const { return rating; }
   //! Get the cleaned data matrix.
   const arma::sp_mat& CleanedData() const { return cleanedData; }
 
@@ -166,6 +210,31 @@ class CF
                           arma::Mat<size_t>& recommendations,
                           arma::Col<size_t>& users);
 
+  /**
+   * Fold new ratings, possibly of new users or new items, into the model
+   * without factorizing the rating matrix again.  The data is a (user, item,
+   * rating) table, like the one given to the constructor; a new rating of an
+   * already-rated item replaces the old rating.  The latent vector (column of
+   * H) of each user with new ratings is found by ridge regression of the
+   * user's ratings against the fixed rows of W for the items it rated, and
+   * then the latent vector (row of W) of each new item is found the same way
+   * against the updated columns of H.  Optionally, a few passes of stochastic
+   * gradient descent over the new ratings then refine the affected rows of W
+   * and columns of H together.
+   *
+   * Only the users and items of the new ratings are updated, so this is fast;
+   * the rest of the model is not changed until the next factorization.
+   *
+   * @param data New (user, item, rating) table.
+   * @param lambda Regularization parameter of the ridge regression and SGD.
+   * @param sgdPasses Number of SGD passes over the new ratings.
+   * @param stepSize Step size of SGD.
+   */
+  void AddRatings(const arma::mat& data,
+                  const double lambda = 0.01,
+                  const size_t sgdPasses = 0,
+                  const double stepSize = 0.01);
+
   /**
    * Returns a string representation of this object.
    */
@@ -178,32 +247,48 @@ class CF
   size_t rank;
   //! Instantiated factorizer object.
   FactorizerType factorizer;
+  //! Instantiated neighbor search policy.
+  NeighborSearchPolicy searchPolicy;
   //! User matrix.
   arma::mat w;
   //! Item matrix.
   arma::mat h;
-  //! Rating matrix.
-  arma::mat rating;
   //! Cleaned data matrix.
   arma::sp_mat cleanedData;
   //! Converts the User, Item, Value Matrix to User-Item Table
   void CleanData(const arma::mat& data);
 
+  //! Check the neighborhood size, and choose the rank with the density
+  //! heuristic if it is 0; cleanedData must be set.
+  void CheckParameters();
+
   /**
-   * Helper function to insert a point into the recommendation matrices.
-   *
-   * @param queryIndex Index of point whose recommendations we are inserting
-   *     into.
-   * @param pos Position in list to insert into.
-   * @param neighbor Index of item being inserted as a recommendation.
-   * @param value Value of recommendation.
+   * Find the latent vector of the given user by ridge regression against the
+   * rows of W of the items (with index less than knownItems) it rated.
    */
-  void InsertNeighbor(const size_t queryIndex,
-                      const size_t pos,
-                      const size_t neighbor,
-                      const double value,
-                      arma::Mat<size_t>& recommendations,
-                      arma::mat& values) const;
+  void FoldInUser(const size_t user,
+                  const size_t knownItems,
+                  const double lambda);
+
+  /**
+   * Orders recommendation candidates so that the worst candidate (the lowest
+   * value, and for equal values the greatest item index) is at the top of a
+   * priority queue.
+   */
+  struct CandidateCompare
+  {
+    bool operator()(const std::pair<double, size_t>& a,
+                    const std::pair<double, size_t>& b) const
+    {
+      return (a.first > b.first) ||
+          ((a.first == b.first) && (a.second < b.second));
+    }
+  };
+
+  //! A bounded heap of (value, item) recommendation candidates.
+  typedef std::priority_queue<std::pair<double, size_t>,
+      std::vector<std::pair<double, size_t> >, CandidateCompare>
+      CandidateQueue;
 
 }; // class CF
 
@@ -54,16 +54,99 @@ void ApplyFactorizer(arma::mat& data,
 }
 
 /**
- * Construct the CF object using an instantiated factorizer.
+ * This function is used to factorize the rating matrix into the user and item
+ * matrices when only the rating matrix was given, and UsesCoordinateList of the
+ * factorizer is false.
+ */
+template<typename FactorizerType>
+void ApplyFactorizer(arma::sp_mat& cleanedData,
+    FactorizerType& factorizer,
+    const size_t rank,
+    arma::mat& w,
+    arma::mat& h,
+    const typename boost::enable_if_c<
+        FactorizerTraits<FactorizerType>::UsesCoordinateList == false,
+        int*>::type = 0)
+{
+  factorizer.Apply(cleanedData, rank, w, h);
+}
+
+/**
+ * This function is used to factorize the rating matrix into the user and item
+ * matrices when only the rating matrix was given, and UsesCoordinateList of the
+ * factorizer is true; the (user, item, rating) list is built from the rating
+ * matrix.
  */
 template<typename FactorizerType>
-CF<FactorizerType>::CF(arma::mat& data,
-                       FactorizerType factorizer,
-                       const size_t numUsersForSimilarity,
-                       const size_t rank) :
+void ApplyFactorizer(arma::sp_mat& cleanedData,
+    FactorizerType& factorizer,
+    const size_t rank,
+    arma::mat& w,
+    arma::mat& h,
+    const typename boost::enable_if_c<
+        FactorizerTraits<FactorizerType>::UsesCoordinateList == true,
+        int*>::type = 0)
+{
+  arma::mat data(3, cleanedData.n_nonzero);
+  size_t i = 0;
+  for (arma::sp_mat::const_iterator it = cleanedData.begin();
+       it != cleanedData.end(); ++it, ++i)
+  {
+    data(0, i) = it.col();
+    data(1, i) = it.row();
+    data(2, i) = *it;
+  }
+
+  factorizer.Apply(data, rank, w, h);
+}
+
+/**
+ * Construct the CF object using an instantiated factorizer.
+ */
+template<typename FactorizerType, typename NeighborSearchPolicy>
+CF<FactorizerType, NeighborSearchPolicy>::
+CF(arma::mat& data,
+   FactorizerType factorizer,
+   const size_t numUsersForSimilarity,
+   const size_t rank,
+   const NeighborSearchPolicy& searchPolicy) :
+    numUsersForSimilarity(numUsersForSimilarity),
+    rank(rank),
+    factorizer(factorizer),
+    searchPolicy(searchPolicy)
+{
+  CleanData(data);
+  CheckParameters();
+
+  // Operations independent of the query:
+  // Decompose the sparse data matrix to user and data matrices.
+  ApplyFactorizer<FactorizerType>(data, cleanedData, factorizer, this->rank, w, h);
+}
+
+/**
+ * Construct the CF object from the sparse rating matrix.
+ */
+template<typename FactorizerType, typename NeighborSearchPolicy>
+CF<FactorizerType, NeighborSearchPolicy>::
+CF(const arma::sp_mat& data,
+   FactorizerType factorizer,
+   const size_t numUsersForSimilarity,
+   const size_t rank,
+   const NeighborSearchPolicy& searchPolicy) :
     numUsersForSimilarity(numUsersForSimilarity),
     rank(rank),
-    factorizer(factorizer)
+    factorizer(factorizer),
+    searchPolicy(searchPolicy),
+    cleanedData(data)
+{
+  CheckParameters();
+
+  // Decompose the sparse data matrix to user and data matrices.
+  ApplyFactorizer<FactorizerType>(cleanedData, factorizer, this->rank, w, h);
+}
+
+template<typename FactorizerType, typename NeighborSearchPolicy>
+void CF<FactorizerType, NeighborSearchPolicy>::CheckParameters()
 {
   // Validate neighbourhood size.
   if(numUsersForSimilarity < 1)
@@ -74,8 +157,6 @@ CF<FactorizerType>::CF(arma::mat& data,
     this->numUsersForSimilarity = 5;
   }
 
-  CleanData(data);
-
   // Check if the user wanted us to choose a rank for them.
   if(rank == 0)
   {
@@ -90,15 +171,12 @@ CF<FactorizerType>::CF(arma::mat& data,
         << std::endl;
     this->rank = rankEstimate;
   }
-
-  // Operations independent of the query:
-  // Decompose the sparse data matrix to user and data matrices.
-  ApplyFactorizer<FactorizerType>(data, cleanedData, factorizer, this->rank, w, h);
 }
 
-template<typename FactorizerType>
-void CF<FactorizerType>::GetRecommendations(const size_t numRecs,
-                                            arma::Mat<size_t>& recommendations)
+template<typename FactorizerType, typename NeighborSearchPolicy>
+void CF<FactorizerType, NeighborSearchPolicy>::
+GetRecommendations(const size_t numRecs,
+                   arma::Mat<size_t>& recommendations)
 {
   // Generate list of users.  Maybe it would be more efficient to pass an empty
   // users list, and then have the other overload of GetRecommendations() assume
@@ -111,91 +189,161 @@ void CF<FactorizerType>::GetRecommendations(const size_t numRecs,
   GetRecommendations(numRecs, recommendations, users);
 }
 
-template<typename FactorizerType>
-void CF<FactorizerType>::GetRecommendations(const size_t numRecs,
-                                            arma::Mat<size_t>& recommendations,
-                                            arma::Col<size_t>& users)
+template<typename FactorizerType, typename NeighborSearchPolicy>
+void CF<FactorizerType, NeighborSearchPolicy>::
+GetRecommendations(const size_t numRecs,
+                   arma::Mat<size_t>& recommendations,
+                   arma::Col<size_t>& users)
 {
-  // Generate new table by multiplying approximate values.
-  rating = w * h;
+  // The approximate ratings w * h are never computed all at once; we only use
+  // the factors.  The distance between the estimated ratings of two users a
+  // and b is || w (h_a - h_b) ||, and with the thin QR decomposition w = Q R,
+  // that is || R (h_a - h_b) ||.  So the neighborhoods can be found in the
+  // rank-r latent space.
+  arma::mat q, r;
+  arma::qr_econ(q, r, w);
+  q.reset();
+  arma::mat latent = r * h;
 
-  // Now, we will use the decomposed w and h matrices to estimate what the user
-  // would have rated items as, and then pick the best items.
+  if (numUsersForSimilarity > latent.n_cols)
+    Log::Fatal << "CF::GetRecommendations(): neighborhood size ("
+        << numUsersForSimilarity << ") is greater than the number of users ("
+        << latent.n_cols << ")!" << std::endl;
 
-  // Temporarily store feature vector of queried users.
-  arma::mat query(rating.n_rows, users.n_elem);
+  // Temporarily store feature vectors of queried users.
+  arma::mat query(latent.n_rows, users.n_elem);
 
   // Select feature vectors of queried users.
   for (size_t i = 0; i < users.n_elem; i++)
-    query.col(i) = rating.col(users(i));
+    query.col(i) = latent.col(users(i));
 
-  // Temporary storage for neighborhood of the queried users.
+  // Calculate the neighborhood of the queried users among the latent vectors
+  // of all users with the neighbor search policy.
   arma::Mat<size_t> neighborhood;
+  arma::mat resultingDistances;
+  searchPolicy.Search(latent, query, numUsersForSimilarity, neighborhood,
+      resultingDistances);
 
-  // Calculate the neighborhood of the queried users.
-  // This should be a templatized option.
-  neighbor::AllkNN a(rating, query);
-  arma::mat resultingDistances; // Temporary storage.
-  a.Search(numUsersForSimilarity, neighborhood, resultingDistances);
-
-  // Temporary storage for storing the average rating for each user in their
-  // neighborhood.
-  arma::mat averages = arma::zeros<arma::mat>(rating.n_rows, query.n_cols);
+  // The average estimated rating of the neighborhood of each queried user is
+  // w times the average of the neighborhood's columns of h.  An approximate
+  // policy may not find every neighbor; those are skipped.
+  arma::mat averages = arma::zeros<arma::mat>(h.n_rows, query.n_cols);
 
   // Iterate over each query user.
+  #pragma omp parallel for schedule(static)
   for (size_t i = 0; i < neighborhood.n_cols; ++i)
   {
     // Iterate over each neighbor of the query user.
+    size_t found = 0;
     for (size_t j = 0; j < neighborhood.n_rows; ++j)
-      averages.col(i) += rating.col(neighborhood(j, i));
+    {
+      if (neighborhood(j, i) < h.n_cols)
+      {
+        averages.col(i) += h.col(neighborhood(j, i));
+        ++found;
+      }
+    }
+
     // Normalize average.
-    averages.col(i) /= neighborhood.n_rows;
+    if (found > 0)
+      averages.col(i) /= found;
   }
 
   // Generate recommendations for each query user by finding the maximum numRecs
-  // elements in the averages matrix.
+  // estimated ratings of the items it has not rated.  The ratings are computed
+  // for a block of items and a batch of users at a time, and the best
+  // candidates of each user are kept in a bounded heap.
   recommendations.set_size(numRecs, users.n_elem);
   recommendations.fill(cleanedData.n_rows); // Invalid item number.
-  arma::mat values(numRecs, users.n_elem);
-  values.fill(-DBL_MAX); // The smallest possible value.
-  for (size_t i = 0; i < users.n_elem; i++)
+  if (numRecs == 0)
+    return;
+
+  const size_t numItems = w.n_rows;
+  const size_t itemBlockSize = 4096;
+  const size_t userBatchSize = 256;
+  const size_t batches = (users.n_elem + userBatchSize - 1) / userBatchSize;
+
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t batch = 0; batch < batches; ++batch)
   {
-    // Look through the averages column corresponding to the current user.
-    for (size_t j = 0; j < averages.n_rows; ++j)
+    const size_t begin = batch * userBatchSize;
+    const size_t end = std::min(begin + userBatchSize, (size_t) users.n_elem);
+
+    // The rated items of each user, in increasing order, with a cursor to skip
+    // them as the blocks of items are scored in order.
+    const arma::sp_mat& ratings = cleanedData;
+    std::vector<std::vector<size_t> > rated(end - begin);
+    std::vector<size_t> cursors(end - begin, 0);
+    for (size_t i = begin; i < end; ++i)
+    {
+      for (arma::sp_mat::const_iterator it = ratings.begin_col(users(i));
+           it != ratings.end_col(users(i)); ++it)
+        if ((*it) != 0.0)
+          rated[i - begin].push_back(it.row());
+    }
+
+    std::vector<CandidateQueue> candidates(end - begin);
+    for (size_t itemBegin = 0; itemBegin < numItems;
+        itemBegin += itemBlockSize)
     {
-      // Ensure that the user hasn't already rated the item.
-      if (cleanedData(j, users(i)) != 0.0)
-        continue; // The user already rated the item.
+      const size_t itemEnd = std::min(itemBegin + itemBlockSize, numItems);
+      const arma::mat scores = w.rows(itemBegin, itemEnd - 1) *
+          averages.cols(begin, end - 1);
 
-      // Is the estimated value better than the worst candidate?
-      const double value = averages(j, i);
-      if (value > values(values.n_rows - 1, i))
+      for (size_t i = 0; i < end - begin; ++i)
       {
-        // It should be inserted.  Which position?
-        size_t insertPosition = values.n_rows - 1;
-        while (insertPosition > 0)
+        const std::vector<size_t>& userRated = rated[i];
+        size_t& cursor = cursors[i];
+        CandidateQueue& queue = candidates[i];
+
+        for (size_t j = itemBegin; j < itemEnd; ++j)
         {
-          if (value <= values(insertPosition - 1, i))
-            break; // The current value is the right one.
-          insertPosition--;
-        }
+          // Ensure that the user hasn't already rated the item.
+          while (cursor < userRated.size() && userRated[cursor] < j)
+            ++cursor;
+          if (cursor < userRated.size() && userRated[cursor] == j)
+            continue; // The user already rated the item.
 
-        // Now insert it into the list.
-        InsertNeighbor(i, insertPosition, j, value, recommendations,
-            values);
+          const double value = scores(j - itemBegin, i);
+          if (queue.size() < numRecs)
+          {
+            queue.push(std::make_pair(value, j));
+          }
+          else if (value > queue.top().first)
+          {
+            queue.pop();
+            queue.push(std::make_pair(value, j));
+          }
+        }
       }
     }
 
-    // If we were not able to come up with enough recommendations, issue a
-    // warning.
-    if (recommendations(values.n_rows - 1, i) == cleanedData.n_rows + 1)
-      Log::Warn << "Could not provide " << values.n_rows << " recommendations "
-          << "for user " << users(i) << " (not enough un-rated items)!" << std::endl;
+    // The worst candidate is at the top of each heap.
+    for (size_t i = 0; i < end - begin; ++i)
+    {
+      CandidateQueue& queue = candidates[i];
+
+      // If we were not able to come up with enough recommendations, issue a
+      // warning.
+      if (queue.size() < numRecs)
+      {
+        #pragma omp critical(cf_warn)
+        Log::Warn << "Could not provide " << numRecs << " recommendations "
+            << "for user " << users(begin + i) << " (not enough un-rated "
+            << "items)!" << std::endl;
+      }
+
+      for (size_t pos = queue.size(); pos > 0; --pos)
+      {
+        recommendations(pos - 1, begin + i) = queue.top().second;
+        queue.pop();
+      }
+    }
   }
 }
 
-template<typename FactorizerType>
-void CF<FactorizerType>::CleanData(const arma::mat& data)
+template<typename FactorizerType, typename NeighborSearchPolicy>
+void CF<FactorizerType, NeighborSearchPolicy>::CleanData(const arma::mat& data)
 {
   // Generate list of locations for batch insert constructor for sparse
   // matrices.
@@ -217,42 +365,173 @@ void CF<FactorizerType>::CleanData(const arma::mat& data)
   cleanedData = arma::sp_mat(locations, values, maxItemID, maxUserID);
 }
 
-/**
- * Helper function to insert a point into the recommendation matrices.
- *
- * @param queryIndex Index of point whose recommendations we are inserting into.
- * @param pos Position in list to insert into.
- * @param neighbor Index of item being inserted as a recommendation.
- * @param value Value of recommendation.
- */
-template<typename FactorizerType>
-void CF<FactorizerType>::InsertNeighbor(const size_t queryIndex,
-                                        const size_t pos,
-                                        const size_t neighbor,
-                                        const double value,
-                                        arma::Mat<size_t>& recommendations,
-                                        arma::mat& values) const
+template<typename FactorizerType, typename NeighborSearchPolicy>
+void CF<FactorizerType, NeighborSearchPolicy>::
+AddRatings(const arma::mat& data,
+           const double lambda,
+           const size_t sgdPasses,
+           const double stepSize)
 {
-  // We only memmove() if there is actually a need to shift something.
-  if (pos < (recommendations.n_rows - 1))
+  if (data.n_cols == 0)
+    return;
+  if (data.n_rows != 3)
+    Log::Fatal << "CF::AddRatings(): data must be a (user, item, rating) table"
+        << " with three rows (" << data.n_rows << " rows given)!" << std::endl;
+
+  // Collect the new ratings (by item, then user); a later rating of the same
+  // item by the same user replaces an earlier one.
+  typedef std::map<std::pair<size_t, size_t>, double> RatingMap;
+  RatingMap newRatings;
+  size_t numItems = cleanedData.n_rows;
+  size_t numUsers = cleanedData.n_cols;
+  for (size_t i = 0; i < data.n_cols; ++i)
   {
-    const int len = (values.n_rows - 1) - pos;
-    memmove(values.colptr(queryIndex) + (pos + 1),
-        values.colptr(queryIndex) + pos,
-        sizeof(double) * len);
-    memmove(recommendations.colptr(queryIndex) + (pos + 1),
-        recommendations.colptr(queryIndex) + pos,
-        sizeof(size_t) * len);
+    const size_t user = (size_t) data(0, i);
+    const size_t item = (size_t) data(1, i);
+    newRatings[std::make_pair(item, user)] = data(2, i);
+
+    numItems = std::max(numItems, item + 1);
+    numUsers = std::max(numUsers, user + 1);
   }
 
-  // Now put the new information in the right index.
-  values(pos, queryIndex) = value;
-  recommendations(pos, queryIndex) = neighbor;
+  // Rebuild the rating table with the new ratings in one batch insertion.
+  arma::umat locations(2, cleanedData.n_nonzero + newRatings.size());
+  arma::vec values(cleanedData.n_nonzero + newRatings.size());
+  size_t count = 0;
+  for (arma::sp_mat::const_iterator it = cleanedData.begin();
+       it != cleanedData.end(); ++it)
+  {
+    if (newRatings.count(std::make_pair((size_t) it.row(), (size_t) it.col())))
+      continue; // This rating is replaced.
+
+    locations(0, count) = it.row();
+    locations(1, count) = it.col();
+    values(count) = (*it);
+    ++count;
+  }
+  for (typename RatingMap::const_iterator it = newRatings.begin();
+       it != newRatings.end(); ++it)
+  {
+    locations(0, count) = it->first.first;
+    locations(1, count) = it->first.second;
+    values(count) = it->second;
+    ++count;
+  }
+  cleanedData = arma::sp_mat(locations, values, numItems, numUsers);
+
+  // New items and users start with zero latent vectors.
+  const size_t knownItems = w.n_rows;
+  if (numItems > w.n_rows)
+    w.resize(numItems, w.n_cols);
+  if (numUsers > h.n_cols)
+    h.resize(h.n_rows, numUsers);
+
+  std::set<size_t> users;
+  std::map<size_t, std::vector<std::pair<size_t, double> > > newItems;
+  for (typename RatingMap::const_iterator it = newRatings.begin();
+       it != newRatings.end(); ++it)
+  {
+    users.insert(it->first.second);
+    if (it->first.first >= knownItems)
+      newItems[it->first.first].push_back(std::make_pair(it->first.second,
+          it->second));
+  }
+
+  // Fold in the users against the items known before; then fold in the new
+  // items (which were only rated by the new ratings) against the users.
+  for (std::set<size_t>::const_iterator it = users.begin(); it != users.end();
+       ++it)
+    FoldInUser(*it, knownItems, lambda);
+
+  const arma::mat regularization = lambda * arma::eye<arma::mat>(w.n_cols,
+      w.n_cols);
+  for (typename std::map<size_t, std::vector<std::pair<size_t, double> > >::
+       const_iterator it = newItems.begin(); it != newItems.end(); ++it)
+  {
+    const std::vector<std::pair<size_t, double> >& itemRatings = it->second;
+    arma::mat userFactors(h.n_rows, itemRatings.size());
+    arma::vec ratings(itemRatings.size());
+    for (size_t i = 0; i < itemRatings.size(); ++i)
+    {
+      userFactors.col(i) = h.col(itemRatings[i].first);
+      ratings[i] = itemRatings[i].second;
+    }
+
+    arma::vec itemFactor;
+    if (arma::solve(itemFactor, userFactors * trans(userFactors) +
+        regularization, userFactors * ratings))
+      w.row(it->first) = trans(itemFactor);
+    else
+      Log::Warn << "CF::AddRatings(): could not fold in item " << it->first
+          << "; increase lambda." << std::endl;
+  }
+
+  // Refine the affected factors with stochastic gradient descent.
+  for (size_t pass = 0; pass < sgdPasses; ++pass)
+  {
+    for (typename RatingMap::const_iterator it = newRatings.begin();
+         it != newRatings.end(); ++it)
+    {
+      const size_t item = it->first.first;
+      const size_t user = it->first.second;
+
+      const arma::rowvec itemFactor = w.row(item);
+      const double error = it->second - arma::as_scalar(itemFactor *
+          h.col(user));
+
+      w.row(item) += stepSize * (error * trans(h.col(user)) - lambda *
+          itemFactor);
+      h.col(user) += stepSize * (error * trans(itemFactor) - lambda *
+          h.col(user));
+    }
+  }
+}
+
+template<typename FactorizerType, typename NeighborSearchPolicy>
+void CF<FactorizerType, NeighborSearchPolicy>::
+FoldInUser(const size_t user,
+           const size_t knownItems,
+           const double lambda)
+{
+  // Collect the known items the user rated.
+  std::vector<size_t> items;
+  std::vector<double> ratings;
+  const arma::sp_mat& data = cleanedData;
+  for (arma::sp_mat::const_iterator it = data.begin_col(user);
+       it != data.end_col(user); ++it)
+  {
+    if (it.row() < knownItems)
+    {
+      items.push_back(it.row());
+      ratings.push_back(*it);
+    }
+  }
+
+  if (items.empty())
+    return;
+
+  // Solve (W_I^T W_I + lambda I) h_u = W_I^T r_I.
+  arma::mat itemFactors(items.size(), w.n_cols);
+  arma::vec userRatings(items.size());
+  for (size_t i = 0; i < items.size(); ++i)
+  {
+    itemFactors.row(i) = w.row(items[i]);
+    userRatings[i] = ratings[i];
+  }
+
+  arma::vec userFactor;
+  if (arma::solve(userFactor, trans(itemFactors) * itemFactors + lambda *
+      arma::eye<arma::mat>(w.n_cols, w.n_cols), trans(itemFactors) *
+      userRatings))
+    h.col(user) = userFactor;
+  else
+    Log::Warn << "CF::AddRatings(): could not fold in user " << user
+        << "; increase lambda." << std::endl;
 }
 
 // Return string of object.
-template<typename FactorizerType>
-std::string CF<FactorizerType>::ToString() const
+template<typename FactorizerType, typename NeighborSearchPolicy>
+std::string CF<FactorizerType, NeighborSearchPolicy>::ToString() const
 {
   std::ostringstream convert;
   convert << "Collaborative Filtering [" << this << "]" << std::endl;
@@ -6,15 +6,21 @@
  */
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/util/server.hpp>
 
 #include <mlpack/methods/amf/amf.hpp>
 #include <mlpack/methods/regularized_svd/regularized_svd.hpp>
 #include "cf.hpp"
+#include "neighbor_search_policies/cover_tree_search_policy.hpp"
+#include "neighbor_search_policies/brute_force_search_policy.hpp"
+#include "neighbor_search_policies/ra_search_policy.hpp"
+#include "neighbor_search_policies/lsh_search_policy.hpp"
 
 using namespace mlpack;
 using namespace mlpack::cf;
 using namespace mlpack::amf;
 using namespace mlpack::svd;
+using namespace mlpack::util;
 using namespace std;
 
 // Document program.
@@ -34,12 +40,35 @@ PROGRAM_INFO("Collaborating Filtering", "This program performs collaborative "
     "first column is the user, the second column is the item, and the third "
     "column is that user's rating of that item.  Both the users and items "
     "should be numeric indices, not names. The indices are assumed to start "
-    "from 0."
+    "from 0.  The ratings are loaded directly into a sparse matrix, and each "
+    "(user, item) pair may appear only once.  The input file may also be a "
+    "sparse matrix saved in the mlpack sparse matrix format, which is read "
+    "without parsing."
     "\n\n"
     "The following optimization algorithms can be used with --algorithm (-a) "
     "parameter: "
     "\n"
-    "RegSVD -- Regularized SVD using a SGD optimizer ");
+    "RegSVD -- Regularized SVD using a SGD optimizer\n"
+    "ALS -- Alternating least squares on the observed ratings only, in "
+    "parallel\n"
+    "SVDParallelSGD -- SGD on the observed ratings, in parallel with a "
+    "stratified (DSGD) schedule "
+    "\n\n"
+    "The neighborhoods of the users are found among the latent vectors of the "
+    "factorization with the method given by --neighbor_search (-s): 'kd' "
+    "(exact, with a kd-tree; the default), 'cover' (exact, with cover trees), "
+    "'brute' (exact, with matrix products), 'ra' (rank-approximate, see "
+    "allkrann) or 'lsh' (approximate, with locality-sensitive hashing).  The "
+    "approximate methods are faster when there are many users."
+    "\n\n"
+    "With --server, the factorization is computed once and kept in memory, and "
+    "recommendations are generated as they are requested, on the standard "
+    "input and output (--server -) or on a Unix socket created at the given "
+    "path, instead of for --query_file.  Each request is a line 'recommend <n>"
+    " [recommendations=<r>]' followed by n lines with one user each; the "
+    "response is a line 'OK <n>' followed by a line with the recommended items"
+    " for each user.  The default number of recommendations is "
+    "--recommendations.");
 
 // Parameters for program.
 PARAM_STRING_REQ("input_file", "Input dataset to perform CF on.", "i");
@@ -60,15 +89,101 @@ PARAM_INT("neighborhood", "Size of the neighborhood of similar users to "
 
 PARAM_INT("rank", "Rank of decomposed matrices.", "R", 2);
 
-template<typename Factorizer>
+PARAM_STRING("neighbor_search", "Method used to find the neighborhoods: 'kd', "
+    "'cover', 'brute', 'ra' or 'lsh'.", "s", "kd");
+
+PARAM_STRING("server", "If specified, serve recommendation requests on the "
+    "standard input and output ('-') or on a Unix socket created at this path."
+    , "", "");
+
+/**
+ * Answers 'recommend' requests for the Server with a computed factorization;
+ * the points of a request are user indices.
+ */
+template<typename CFType>
+class RecommendHandler
+{
+ public:
+  RecommendHandler(CFType& recommender, const size_t numRecs) :
+      recommender(recommender),
+      numRecs(numRecs)
+  { }
+
+  bool Handle(const ServerRequest& request, ServerResponse& response)
+  {
+    if (request.command != "recommend")
+    {
+      response.error = "unknown command '" + request.command + "'; the only "
+          "command is 'recommend'";
+      return false;
+    }
+
+    size_t recommendations = numRecs;
+    if (!request.GetOption("recommendations", recommendations) ||
+        recommendations == 0)
+    {
+      response.error = "invalid number of recommendations";
+      return false;
+    }
+
+    if (request.data.n_cols == 0)
+      return true;
+
+    if (request.data.n_rows != 1)
+    {
+      response.error = "each point must be a single user";
+      return false;
+    }
+
+    const size_t numUsers = recommender.H().n_cols;
+    arma::Col<size_t> users(request.data.n_cols);
+    for (size_t i = 0; i < request.data.n_cols; ++i)
+    {
+      const double user = request.data(0, i);
+      if (user < 0 || user >= numUsers || user != std::floor(user))
+      {
+        ostringstream error;
+        error << "invalid user " << user << "; users are 0 to "
+            << numUsers - 1;
+        response.error = error.str();
+        return false;
+      }
+      users[i] = (size_t) user;
+    }
+
+    arma::Mat<size_t> recommended;
+    recommender.GetRecommendations(recommendations, recommended, users);
+
+    response.data = arma::conv_to<arma::mat>::from(recommended);
+    return true;
+  }
+
+ private:
+  //! The recommender, with its factorization computed.
+  CFType& recommender;
+  //! The default number of recommendations.
+  size_t numRecs;
+};
+
+template<typename Factorizer, typename SearchPolicy>
 void ComputeRecommendations(Factorizer factorizer,
-                            arma::mat& dataset,
+                            SearchPolicy searchPolicy,
+                            const arma::sp_mat& dataset,
                             const size_t numRecs,
                             const size_t neighbourhood,
                             const size_t rank,
                             arma::Mat<size_t>& recommendations)
 {
-  CF<Factorizer> c(dataset, factorizer, neighbourhood, rank);
+  typedef CF<Factorizer, SearchPolicy> CFType;
+  CFType c(dataset, factorizer, neighbourhood, rank, searchPolicy);
+
+  if (CLI::HasParam("server"))
+  {
+    RecommendHandler<CFType> handler(c, numRecs);
+    Server<RecommendHandler<CFType> > server(handler);
+    server.Run(CLI::GetParam<string>("server"));
+    return;
+  }
 
   // Reading users.
   const string queryFile = CLI::GetParam<string>("query_file");
@@ -90,6 +205,32 @@ void ComputeRecommendations(Factorizer factorizer,
     c.GetRecommendations(numRecs, recommendations);
   }
 }
+
+template<typename Factorizer>
+void ComputeRecommendations(Factorizer factorizer,
+                            const arma::sp_mat& dataset,
+                            const size_t numRecs,
+                            const size_t neighbourhood,
+                            const size_t rank,
+                            arma::Mat<size_t>& recommendations)
+{
+  const string search = CLI::GetParam<string>("neighbor_search");
+  if (search == "cover")
+    ComputeRecommendations(factorizer, CoverTreeSearchPolicy(), dataset,
+        numRecs, neighbourhood, rank, recommendations);
+  else if (search == "brute")
+    ComputeRecommendations(factorizer, BruteForceSearchPolicy(), dataset,
+        numRecs, neighbourhood, rank, recommendations);
+  else if (search == "ra")
+    ComputeRecommendations(factorizer, RASearchPolicy(), dataset, numRecs,
+        neighbourhood, rank, recommendations);
+  else if (search == "lsh")
+    ComputeRecommendations(factorizer, LSHSearchPolicy(), dataset, numRecs,
+        neighbourhood, rank, recommendations);
+  else
+    ComputeRecommendations(factorizer, KDTreeSearchPolicy(), dataset, numRecs,
+        neighbourhood, rank, recommendations);
+}
                             
 #define CR(x) ComputeRecommendations(x, dataset, numRecs, neighborhood, rank, recommendations)
 
@@ -99,8 +240,10 @@ int main(int argc, char** argv)
   CLI::ParseCommandLine(argc, argv);
 
   // Read from the input file.
+  // The (user, item, rating) list is loaded straight into the sparse rating
+  // matrix, with one row for each item and one column for each user.
   const string inputFile = CLI::GetParam<string>("input_file");
-  arma::mat dataset;
+  arma::sp_mat dataset;
   data::Load(inputFile, dataset, true);
 
   // Recommendation matrix.
@@ -111,6 +254,14 @@ int main(int argc, char** argv)
   const size_t neighborhood = (size_t) CLI::GetParam<int>("neighborhood");
   const size_t rank = (size_t) CLI::GetParam<int>("rank");
 
+  const string search = CLI::GetParam<string>("neighbor_search");
+  if (search != "kd" && search != "cover" && search != "brute" &&
+      search != "ra" && search != "lsh")
+  {
+    Log::Fatal << "Invalid neighbor search method '" << search << "'; must be "
+        << "'kd', 'cover', 'brute', 'ra' or 'lsh'." << endl;
+  }
+
   // Perform decomposition to prepare for recommendations.
   Log::Info << "Performing CF matrix decomposition on dataset..." << endl;
   
@@ -126,6 +277,14 @@ int main(int argc, char** argv)
     CR(SparseSVDCompleteIncrementalFactorizer());
   else if(algo == "RegSVD")
     CR(RegularizedSVD<>());
+  else if(algo == "ALS")
+    CR(SparseALSFactorizer());
+  else if(algo == "SVDParallelSGD")
+    CR(SparseSVDParallelSGDFactorizer());
+
+  // In server mode, the recommendations have been sent to the clients.
+  if (CLI::HasParam("server"))
+    return 0;
 
   const string outputFile = CLI::GetParam<string>("output_file");
   data::Save(outputFile, recommendations);
@@ -0,0 +1,43 @@
+/**
+ * @file brute_force_search_policy.hpp
+ *
+ * Neighbor search policy for CF which finds the exact neighborhoods by brute
+ * force, with matrix products.
+ */
+#ifndef __MLPACK_METHODS_CF_BRUTE_FORCE_SEARCH_POLICY_HPP
+#define __MLPACK_METHODS_CF_BRUTE_FORCE_SEARCH_POLICY_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+
+namespace mlpack {
+namespace cf {
+
+/**
+ * Find the exact neighborhoods of the query users by comparing them with every
+ * user, with the tiled matrix-product search of NeighborSearch's naive mode
+ * (see neighbor::BruteForceSearch()).  No tree is built, so this is the
+ * fastest exact policy when the rank is high or there are few users.  See
+ * KDTreeSearchPolicy for the interface of neighbor search policies.
+ */
+class BruteForceSearchPolicy
+{
+ public:
+  //! Find the k nearest neighbors of each query point among the reference
+  //! points; see KDTreeSearchPolicy::Search().
+  void Search(const arma::mat& referenceSet,
+              const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& neighbors,
+              arma::mat& distances) const
+  {
+    neighbor::NeighborSearch<neighbor::NearestNeighborSort,
+        metric::EuclideanDistance> search(referenceSet, querySet, true);
+    search.Search(k, neighbors, distances);
+  }
+};
+
+}; // namespace cf
+}; // namespace mlpack
+
+#endif
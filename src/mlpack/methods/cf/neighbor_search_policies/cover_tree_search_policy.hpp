@@ -0,0 +1,47 @@
+/**
+ * @file cover_tree_search_policy.hpp
+ *
+ * Neighbor search policy for CF which finds the exact neighborhoods with
+ * dual-tree search in cover trees.
+ */
+#ifndef __MLPACK_METHODS_CF_COVER_TREE_SEARCH_POLICY_HPP
+#define __MLPACK_METHODS_CF_COVER_TREE_SEARCH_POLICY_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/tree/cover_tree.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+
+namespace mlpack {
+namespace cf {
+
+/**
+ * Find the exact neighborhoods of the query users with dual-tree search in
+ * cover trees built on the latent vectors.  Cover trees do not depend on the
+ * dimensionality as much as kd-trees do, so this can be faster for a high
+ * rank.  See KDTreeSearchPolicy for the interface of neighbor search policies.
+ */
+class CoverTreeSearchPolicy
+{
+ public:
+  //! Find the k nearest neighbors of each query point among the reference
+  //! points; see KDTreeSearchPolicy::Search().
+  void Search(const arma::mat& referenceSet,
+              const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& neighbors,
+              arma::mat& distances) const
+  {
+    typedef tree::CoverTree<metric::EuclideanDistance, tree::FirstPointIsRoot,
+        neighbor::NeighborSearchStat<neighbor::NearestNeighborSort> >
+        TreeType;
+
+    neighbor::NeighborSearch<neighbor::NearestNeighborSort,
+        metric::EuclideanDistance, TreeType> search(referenceSet, querySet);
+    search.Search(k, neighbors, distances);
+  }
+};
+
+}; // namespace cf
+}; // namespace mlpack
+
+#endif
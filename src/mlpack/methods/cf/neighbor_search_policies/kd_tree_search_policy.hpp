@@ -0,0 +1,85 @@
+/**
+ * @file kd_tree_search_policy.hpp
+ *
+ * Neighbor search policy for CF which finds the exact neighborhoods with
+ * single-tree search in a kd-tree.
+ */
+#ifndef __MLPACK_METHODS_CF_KD_TREE_SEARCH_POLICY_HPP
+#define __MLPACK_METHODS_CF_KD_TREE_SEARCH_POLICY_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+
+namespace mlpack {
+namespace cf {
+
+/**
+ * Find the exact neighborhoods of the query users with single-tree search in a
+ * kd-tree built on (a copy of) the latent vectors of all users.  The queries
+ * are searched in parallel: each thread has its own rules object and
+ * traverser, the tree is not modified by single-tree search, and the rules only
+ * write to the column of the query point they are given, so no locking is
+ * necessary.
+ *
+ * This is the default neighbor search policy of CF.  Every neighbor search
+ * policy implements the Search() method below; the neighbors it returns are
+ * indices into the reference set, and any neighbor which could not be found
+ * has an index not less than the number of reference points.
+ */
+class KDTreeSearchPolicy
+{
+ public:
+  /**
+   * Find the k nearest neighbors (under the Euclidean distance) of each query
+   * point among the reference points.
+   *
+   * @param referenceSet Latent vectors of all users.
+   * @param querySet Latent vectors of the query users.
+   * @param k Number of neighbors to find.
+   * @param neighbors Matrix to store the indices of the neighbors in.
+   * @param distances Matrix to store the distances to the neighbors in.
+   */
+  void Search(const arma::mat& referenceSet,
+              const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& neighbors,
+              arma::mat& distances) const
+  {
+    typedef tree::BinarySpaceTree<bound::HRectBound<2>,
+        neighbor::NeighborSearchStat<neighbor::NearestNeighborSort> >
+        TreeType;
+    typedef neighbor::NeighborSearchRules<neighbor::NearestNeighborSort,
+        metric::EuclideanDistance, TreeType> RuleType;
+
+    // Building the tree rearranges the points.
+    arma::mat references(referenceSet);
+    std::vector<size_t> oldFromNew;
+    TreeType tree(references, oldFromNew);
+
+    neighbors.set_size(k, querySet.n_cols);
+    neighbors.fill(size_t() - 1);
+    distances.set_size(k, querySet.n_cols);
+    distances.fill(neighbor::NearestNeighborSort::WorstDistance());
+
+    #pragma omp parallel
+    {
+      metric::EuclideanDistance metric;
+      RuleType rules(references, querySet, neighbors, distances, metric);
+      TreeType::SingleTreeTraverser<RuleType> traverser(rules);
+
+      #pragma omp for schedule(dynamic, 256)
+      for (size_t i = 0; i < querySet.n_cols; ++i)
+        traverser.Traverse(i, tree);
+    }
+
+    // Map the neighbors back to the original indices of the users.
+    for (size_t i = 0; i < neighbors.n_elem; ++i)
+      if (neighbors[i] < oldFromNew.size())
+        neighbors[i] = oldFromNew[neighbors[i]];
+  }
+};
+
+}; // namespace cf
+}; // namespace mlpack
+
+#endif
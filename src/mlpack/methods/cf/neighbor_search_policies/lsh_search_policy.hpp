@@ -0,0 +1,89 @@
+/**
+ * @file lsh_search_policy.hpp
+ *
+ * Neighbor search policy for CF which finds approximate neighborhoods with
+ * locality-sensitive hashing.
+ */
+#ifndef __MLPACK_METHODS_CF_LSH_SEARCH_POLICY_HPP
+#define __MLPACK_METHODS_CF_LSH_SEARCH_POLICY_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/methods/lsh/lsh_search.hpp>
+
+namespace mlpack {
+namespace cf {
+
+/**
+ * Find approximate neighborhoods of the query users with LSHSearch.  Only the
+ * users in the buckets of a query user are compared with it, so this is the
+ * cheapest policy for many users, but a query user may get fewer than k
+ * neighbors (the missing ones have the index of the number of users, and CF
+ * averages over the neighbors which were found).  See KDTreeSearchPolicy for
+ * the interface of neighbor search policies.
+ */
+class LSHSearchPolicy
+{
+ public:
+  /**
+   * Set the parameters of the hash.
+   *
+   * @param numProj Number of projections in each hash table.
+   * @param numTables Number of hash tables.
+   * @param hashWidth The width of the hash (0 chooses it from the data).
+   * @param numProbes Number of additional buckets to probe in each table.
+   */
+  LSHSearchPolicy(const size_t numProj = 10,
+                  const size_t numTables = 30,
+                  const double hashWidth = 0.0,
+                  const size_t numProbes = 0) :
+      numProj(numProj),
+      numTables(numTables),
+      hashWidth(hashWidth),
+      numProbes(numProbes)
+  { }
+
+  //! Find the k approximate nearest neighbors of each query point among the
+  //! reference points; see KDTreeSearchPolicy::Search().
+  void Search(const arma::mat& referenceSet,
+              const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& neighbors,
+              arma::mat& distances) const
+  {
+    neighbor::LSHSearch<> search(referenceSet, querySet, numProj, numTables,
+        hashWidth);
+    search.Search(k, neighbors, distances, 0, numProbes);
+  }
+
+  //! Get the number of projections in each table.
+  size_t NumProj() const { return numProj; }
+  //! Modify the number of projections in each table.
+  size_t& NumProj() { return numProj; }
+  //! Get the number of hash tables.
+  size_t NumTables() const { return numTables; }
+  //! Modify the number of hash tables.
+  size_t& NumTables() { return numTables; }
+  //! Get the hash width (0 chooses it from the data).
+  double HashWidth() const { return hashWidth; }
+  //! Modify the hash width (0 chooses it from the data).
+  double& HashWidth() { return hashWidth; }
+  //! Get the number of additional buckets probed in each table.
+  size_t NumProbes() const { return numProbes; }
+  //! Modify the number of additional buckets probed in each table.
+  size_t& NumProbes() { return numProbes; }
+
+ private:
+  //! The number of projections in each table.
+  size_t numProj;
+  //! The number of hash tables.
+  size_t numTables;
+  //! The hash width.
+  double hashWidth;
+  //! The number of additional buckets probed in each table.
+  size_t numProbes;
+};
+
+}; // namespace cf
+}; // namespace mlpack
+
+#endif
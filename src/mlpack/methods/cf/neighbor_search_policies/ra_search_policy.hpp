@@ -0,0 +1,65 @@
+/**
+ * @file ra_search_policy.hpp
+ *
+ * Neighbor search policy for CF which finds rank-approximate neighborhoods
+ * with RASearch.
+ */
+#ifndef __MLPACK_METHODS_CF_RA_SEARCH_POLICY_HPP
+#define __MLPACK_METHODS_CF_RA_SEARCH_POLICY_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/methods/rann/ra_search.hpp>
+
+namespace mlpack {
+namespace cf {
+
+/**
+ * Find rank-approximate neighborhoods of the query users with RASearch: with
+ * probability at least alpha, each neighbor found is among the nearest tau
+ * percent of the users.  See KDTreeSearchPolicy for the interface of neighbor
+ * search policies.
+ */
+class RASearchPolicy
+{
+ public:
+  /**
+   * Set the parameters of the rank-approximate search.
+   *
+   * @param tau The rank-approximation, in percent of the number of users.
+   * @param alpha The desired success probability.
+   */
+  RASearchPolicy(const double tau = 5, const double alpha = 0.95) :
+      tau(tau), alpha(alpha) { }
+
+  //! Find the k approximate nearest neighbors of each query point among the
+  //! reference points; see KDTreeSearchPolicy::Search().
+  void Search(const arma::mat& referenceSet,
+              const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& neighbors,
+              arma::mat& distances) const
+  {
+    neighbor::RASearch<> search(referenceSet, querySet);
+    search.Search(k, neighbors, distances, tau, alpha);
+  }
+
+  //! Get the rank-approximation in percent.
+  double Tau() const { return tau; }
+  //! Modify the rank-approximation in percent.
+  double& Tau() { return tau; }
+  //! Get the desired success probability.
+  double Alpha() const { return alpha; }
+  //! Modify the desired success probability.
+  double& Alpha() { return alpha; }
+
+ private:
+  //! The rank-approximation in percent.
+  double tau;
+  //! The desired success probability.
+  double alpha;
+};
+
+}; // namespace cf
+}; // namespace mlpack
+
+#endif
@@ -31,17 +31,29 @@ class DecisionStump
  public:
   /**
    * Constructor. Train on the provided data. Generate a decision stump from
-   * data.
+   * data.  The sorted order of the points in each dimension is computed here
+   * and kept (see SortedIndices()), so that the stumps trained from this one on
+   * the same data with other weights (as in AdaBoost) do not sort again.
+   *
+   * If bins is nonzero, the stump is trained approximately instead: each
+   * attribute is quantized into at most that many bins (see
+   * math::QuantileBins), and the buckets of each attribute are made of whole
+   * bins, found by a scan of a histogram of the (weighted) classes of each bin,
+   * without any sorting.  The bins are kept (see Quantizer()), and the stumps
+   * trained from this one (as in AdaBoost) use them too.
    *
    * @param data Input, training data.
    * @param labels Labels of training data.
    * @param classes Number of distinct classes in labels.
    * @param inpBucketSize Minimum size of bucket when splitting.
+   * @param bins Maximum number of bins of each attribute (at most 256), or 0
+   *     for exact training.
    */
   DecisionStump(const MatType& data,
                 const arma::Row<size_t>& labels,
                 const size_t classes,
-                size_t inpBucketSize);
+                size_t inpBucketSize,
+                const size_t bins = 0);
 
   /**
    * Classification function. After training, classify test, and put the
@@ -56,7 +68,10 @@ class DecisionStump
   /**
    * Alternate constructor which copies parameters bucketSize and numClass from
    * an already initiated decision stump, other. It appropriately sets the
-   * weight vector.
+   * weight vector.  If the sorted orders kept by other are the sorted orders of
+   * data (which is checked in O(d n) time), they are reused, so that training
+   * takes O(d n) time instead of O(d n log n).  If other was trained with
+   * bins, this stump is trained with the same bins.
    *
    * @param other The other initiated Decision Stump object from
    *      which we copy the values.
@@ -85,6 +100,14 @@ class DecisionStump
   //! Modify the labels for each split bin (be careful!).
   arma::Col<size_t>& BinLabels() { return binLabels; }
 
+  //! Access the stable sorted order of the training points in each dimension
+  //! (one column per dimension); this is empty for a weighted stump.
+  const arma::umat& SortedIndices() const { return sortedIndices; }
+
+  //! Access the bins of each attribute; this is empty (with no dimensions)
+  //! unless the stump was trained with bins.
+  const math::QuantileBins& Quantizer() const { return quantizer; }
+
  private:
   //! Stores the number of classes.
   size_t numClass;
@@ -101,16 +124,38 @@ class DecisionStump
   //! Stores the labels for each splitting bin.
   arma::Col<size_t> binLabels;
 
+  //! The stable sorted order of the training points in each dimension.
+  arma::umat sortedIndices;
+
+  //! The bins of each attribute, if the stump is trained with bins.
+  math::QuantileBins quantizer;
+
+  /**
+   * Compute the stable sorted order of the points in each dimension, in
+   * parallel over the dimensions.
+   *
+   * @param data Dataset to sort.
+   * @param indices Matrix to store the order of each dimension in (one column
+   *     per dimension).
+   */
+  static void SortAttributes(const MatType& data, arma::umat& indices);
+
+  /**
+   * Return whether the given orders are the stable sorted orders of the points
+   * in each dimension of the given dataset.
+   */
+  static bool IsSortedOrder(const MatType& data, const arma::umat& indices);
+
   /**
    * Sets up attribute as if it were splitting on it and finds entropy when
    * splitting on attribute.
    *
-   * @param attribute A row from the training data, which might be a
-   *     candidate for the splitting attribute.
+   * @param order The stable sorted order of the points in the dimension which
+   *     might be a candidate for the splitting attribute.
    * @param isWeight Whether we need to run a weighted Decision Stump.
    */
   template <bool isWeight>
-  double SetupSplitAttribute(const arma::rowvec& attribute,
+  double SetupSplitAttribute(const arma::uvec& order,
                              const arma::Row<size_t>& labels,
                              const arma::rowvec& weightD);
 
@@ -120,8 +165,10 @@ class DecisionStump
    *
    * @param attribute attribute is the attribute decided by the constructor
    *      on which we now train the decision stump.
+   * @param order The stable sorted order of the points in that attribute.
    */
   template <typename rType> void TrainOnAtt(const arma::rowvec& attribute,
+                                            const arma::uvec& order,
                                             const arma::Row<size_t>& labels);
 
   /**
@@ -158,16 +205,71 @@ class DecisionStump
                           const arma::rowvec& tempD);
 
   /**
-   * Train the decision stump on the given data and labels.
+   * Train the decision stump on the given data and labels.  The candidate
+   * splitting attributes are evaluated in parallel.
    *
    * @param data Dataset to train on.
    * @param labels Labels for dataset.
    * @param isWeight Whether we need to run a weighted Decision Stump.
+   * @param indices The stable sorted order of the points in each dimension.
    */
   template <bool isWeight>
   void Train(const MatType& data, const arma::Row<size_t>& labels,
-             const arma::rowvec& weightD);
+             const arma::rowvec& weightD, const arma::umat& indices);
+
+  /**
+   * Train the decision stump on the given data and labels with the bins of
+   * the quantizer.  The candidate splitting attributes are evaluated in
+   * parallel.
+   *
+   * @param data Dataset to train on.
+   * @param labels Labels for dataset.
+   * @param isWeight Whether we need to run a weighted Decision Stump.
+   */
+  template <bool isWeight>
+  void TrainHistogram(const MatType& data, const arma::Row<size_t>& labels,
+                      const arma::rowvec& weightD);
+
+  /**
+   * Compute the (weighted) number of points of each class in each bin of the
+   * given attribute, and the number of points of each bin.
+   *
+   * @param binned Bin of each point (one column per attribute).
+   * @param attribute The attribute to compute the histogram of.
+   * @param classWeights Matrix to store the weight of each class (row) in each
+   *     bin (column) in.
+   * @param counts Vector to store the number of points of each bin in.
+   */
+  template <bool isWeight>
+  void BinHistogram(const arma::Mat<unsigned char>& binned,
+                    const size_t attribute,
+                    const arma::Row<size_t>& labels,
+                    const arma::rowvec& weightD,
+                    arma::mat& classWeights,
+                    arma::Col<size_t>& counts) const;
+
+  /**
+   * Group the bins of a histogram into buckets: like the buckets of the sorted
+   * points, a bucket ends where the majority class changes, once it has at
+   * least bucketSize points.  Only nonempty bins start a bucket.
+   *
+   * @param bucketStarts Vector to store the first bin of each bucket in.
+   */
+  void BinBuckets(const arma::mat& classWeights,
+                  const arma::Col<size_t>& counts,
+                  std::vector<size_t>& bucketStarts) const;
+
+  /**
+   * Calculate the entropy of a split of the histogram into the given buckets
+   * (the same quantity as the entropy of the buckets of the sorted points).
+   */
+  double BucketEntropy(const arma::mat& classWeights,
+                       const arma::Col<size_t>& counts,
+                       const std::vector<size_t>& bucketStarts) const;
 
+  //! Return the class with the largest weight (the largest such class on a
+  //! tie, like CountMostFreq()).
+  static size_t MajorityClass(const arma::vec& classWeights);
 };
 
 }; // namespace decision_stump
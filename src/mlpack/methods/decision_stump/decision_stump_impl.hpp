@@ -21,19 +21,30 @@ namespace decision_stump {
  * @param labels Labels of data.
  * @param classes Number of distinct classes in labels.
  * @param inpBucketSize Minimum size of bucket when splitting.
+ * @param bins Maximum number of bins of each attribute, or 0.
  */
 template<typename MatType>
 DecisionStump<MatType>::DecisionStump(const MatType& data,
                                       const arma::Row<size_t>& labels,
                                       const size_t classes,
-                                      size_t inpBucketSize)
+                                      size_t inpBucketSize,
+                                      const size_t bins)
 {
   numClass = classes;
   bucketSize = inpBucketSize;
 
   arma::rowvec weightD;
 
-  Train<false>(data, labels, weightD);
+  if (bins != 0)
+  {
+    quantizer = math::QuantileBins(data, bins);
+    TrainHistogram<false>(data, labels, weightD);
+  }
+  else
+  {
+    SortAttributes(data, sortedIndices);
+    Train<false>(data, labels, weightD, sortedIndices);
+  }
 }
 
 /**
@@ -42,29 +53,46 @@ DecisionStump<MatType>::DecisionStump(const MatType& data,
  * @param data Dataset to train on.
  * @param labels Labels for dataset.
  * @param isWeight Whether we need to run a weighted Decision Stump.
+ * @param indices The stable sorted order of the points in each dimension.
  */
 template<typename MatType>
 template <bool isWeight>
 void DecisionStump<MatType>::Train(const MatType& data, const arma::Row<size_t>& labels,
-                                    const arma::rowvec& weightD)
+                                    const arma::rowvec& weightD,
+                                    const arma::umat& indices)
 {
   // If classLabels are not all identical, proceed with training.
   int bestAtt = 0;
-  double entropy;
   const double rootEntropy = CalculateEntropy<size_t, isWeight>(
       labels.subvec(0, labels.n_elem - 1), 0, weightD);
 
+  // For each attribute with non-identical values, treat it as a potential
+  // splitting attribute and calculate entropy if split on it.  The attributes
+  // are independent, so this is done in parallel.
+  arma::vec entropies(data.n_rows);
+  std::vector<char> distinct(data.n_rows);
+
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < data.n_rows; i++)
+  {
+    // The values of the attribute are not all the same if the smallest and the
+    // largest are different.
+    distinct[i] = (data(i, indices(0, i)) !=
+        data(i, indices(data.n_cols - 1, i)));
+
+    if (distinct[i])
+      entropies[i] = SetupSplitAttribute<isWeight>(indices.unsafe_col(i),
+          labels, weightD);
+  }
+
+  // Go through each attribute of the data in order, so that ties are broken
+  // the same way as a serial search.
   double gain, bestGain = 0.0;
   for (size_t i = 0; i < data.n_rows; i++)
   {
-    // Go through each attribute of the data.
-    if (IsDistinct<double>(data.row(i)))
+    if (distinct[i])
     {
-      // For each attribute with non-identical values, treat it as a potential
-      // splitting attribute and calculate entropy if split on it.
-      entropy = SetupSplitAttribute<isWeight>(data.row(i), labels, weightD);
-
-      gain = rootEntropy - entropy;
+      gain = rootEntropy - entropies[i];
       // Find the attribute with the best entropy so that the gain is
       // maximized.
 
@@ -81,7 +109,8 @@ void DecisionStump<MatType>::Train(const MatType& data, const arma::Row<size_t>&
   splitAttribute = bestAtt;
 
   // Once the splitting column/attribute has been decided, train on it.
-  TrainOnAtt<double>(data.row(splitAttribute), labels);
+  TrainOnAtt<double>(data.row(splitAttribute),
+      indices.unsafe_col(splitAttribute), labels);
 }
 
 /**
@@ -142,45 +171,327 @@ DecisionStump<MatType>::DecisionStump(
   // weightD = weights;
   // tempD = weightD;
 
-  Train<true>(data, labels, weights);
+  // Train with the bins of the other stump, if it has them.
+  if (other.Quantizer().Dimensionality() != 0)
+  {
+    if (other.Quantizer().Dimensionality() != data.n_rows)
+      Log::Fatal << "DecisionStump::DecisionStump(): the data has "
+          << data.n_rows << " dimensions, but the bins of the other stump have "
+          << other.Quantizer().Dimensionality() << "." << std::endl;
+
+    quantizer = other.Quantizer();
+    TrainHistogram<true>(data, labels, weights);
+    return;
+  }
+
+  // Reuse the sorted orders of the other stump if they are those of this data
+  // (as in AdaBoost, where every round trains on the same points).
+  if (IsSortedOrder(data, other.SortedIndices()))
+  {
+    Train<true>(data, labels, weights, other.SortedIndices());
+  }
+  else
+  {
+    arma::umat indices;
+    SortAttributes(data, indices);
+    Train<true>(data, labels, weights, indices);
+  }
+}
+
+template <typename MatType>
+void DecisionStump<MatType>::SortAttributes(const MatType& data,
+                                            arma::umat& indices)
+{
+  indices.set_size(data.n_cols, data.n_rows);
+
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < data.n_rows; i++)
+  {
+    const arma::rowvec attribute = data.row(i);
+    indices.col(i) = arma::stable_sort_index(attribute.t());
+  }
+}
+
+template <typename MatType>
+bool DecisionStump<MatType>::IsSortedOrder(const MatType& data,
+                                           const arma::umat& indices)
+{
+  if ((indices.n_rows != data.n_cols) || (indices.n_cols != data.n_rows))
+    return false;
+
+  // An order is the stable sorted order if the values are nondecreasing and
+  // the indices of equal values are increasing; this also ensures that every
+  // point appears exactly once.
+  size_t unsorted = 0;
+
+  #pragma omp parallel for schedule(static) reduction(+:unsorted)
+  for (size_t i = 0; i < data.n_rows; i++)
+  {
+    for (size_t j = 0; j < data.n_cols; j++)
+    {
+      if (indices(j, i) >= data.n_cols)
+      {
+        ++unsorted;
+        break;
+      }
+
+      if (j == 0)
+        continue;
+
+      const double previous = data(i, indices(j - 1, i));
+      const double current = data(i, indices(j, i));
+      if ((previous > current) ||
+          ((previous == current) && (indices(j - 1, i) >= indices(j, i))))
+      {
+        ++unsorted;
+        break;
+      }
+    }
+  }
+
+  return (unsorted == 0);
+}
+
+/**
+ * Train the decision stump on the given data and labels with the bins of the
+ * quantizer.
+ *
+ * @param data Dataset to train on.
+ * @param labels Labels for dataset.
+ * @param isWeight Whether we need to run a weighted Decision Stump.
+ */
+template<typename MatType>
+template <bool isWeight>
+void DecisionStump<MatType>::TrainHistogram(const MatType& data,
+                                            const arma::Row<size_t>& labels,
+                                            const arma::rowvec& weightD)
+{
+  // Quantize the data once, with the bins of each attribute stored
+  // contiguously.
+  arma::Mat<unsigned char> binned;
+  quantizer.Quantize(data, binned);
+  binned = arma::trans(binned);
+
+  // The entropy of all of the points is the entropy of a single bucket with
+  // every bin (of any attribute).
+  double rootEntropy;
+  {
+    arma::mat classWeights;
+    arma::Col<size_t> counts;
+    BinHistogram<isWeight>(binned, 0, labels, weightD, classWeights, counts);
+    rootEntropy = BucketEntropy(classWeights, counts,
+        std::vector<size_t>(1, 0));
+  }
+
+  // Each attribute only needs a scan of its points to build its histogram,
+  // and a scan of its bins to find its buckets; the attributes are
+  // independent, so this is done in parallel.
+  arma::vec entropies(data.n_rows);
+  std::vector<char> distinct(data.n_rows);
+
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < data.n_rows; i++)
+  {
+    arma::mat classWeights;
+    arma::Col<size_t> counts;
+    BinHistogram<isWeight>(binned, i, labels, weightD, classWeights, counts);
+
+    // An attribute can only be split if its points are in more than one bin.
+    size_t nonempty = 0;
+    for (size_t b = 0; b < counts.n_elem; ++b)
+      if (counts[b] != 0)
+        ++nonempty;
+
+    distinct[i] = (nonempty > 1);
+    if (distinct[i])
+    {
+      std::vector<size_t> bucketStarts;
+      BinBuckets(classWeights, counts, bucketStarts);
+      entropies[i] = BucketEntropy(classWeights, counts, bucketStarts);
+    }
+  }
+
+  // Choose the attribute in order, as in Train().
+  int bestAtt = 0;
+  double gain, bestGain = 0.0;
+  for (size_t i = 0; i < data.n_rows; i++)
+  {
+    if (distinct[i])
+    {
+      gain = rootEntropy - entropies[i];
+      if (gain < bestGain)
+      {
+        bestAtt = i;
+        bestGain = gain;
+      }
+    }
+  }
+  splitAttribute = bestAtt;
+
+  // Train on the chosen attribute: each bucket starts at the smallest training
+  // value of its first bin (as the buckets of the sorted points start at their
+  // smallest value), and is labeled with its majority class.
+  arma::mat classWeights;
+  arma::Col<size_t> counts;
+  BinHistogram<isWeight>(binned, splitAttribute, labels, weightD,
+      classWeights, counts);
+  std::vector<size_t> bucketStarts;
+  BinBuckets(classWeights, counts, bucketStarts);
+
+  arma::vec minValues(counts.n_elem);
+  minValues.fill(DBL_MAX);
+  for (size_t j = 0; j < data.n_cols; j++)
+  {
+    const size_t bin = binned(j, splitAttribute);
+    minValues[bin] = std::min(minValues[bin], (double) data(splitAttribute,
+        j));
+  }
+
+  split.set_size(bucketStarts.size());
+  binLabels.set_size(bucketStarts.size());
+  for (size_t k = 0; k < bucketStarts.size(); ++k)
+  {
+    const size_t last = (k + 1 < bucketStarts.size()) ? bucketStarts[k + 1] - 1
+        : counts.n_elem - 1;
+    split[k] = minValues[bucketStarts[k]];
+    binLabels[k] = MajorityClass(arma::sum(classWeights.cols(bucketStarts[k],
+        last), 1));
+  }
+
+  MergeRanges();
+}
+
+template<typename MatType>
+template <bool isWeight>
+void DecisionStump<MatType>::BinHistogram(
+    const arma::Mat<unsigned char>& binned,
+    const size_t attribute,
+    const arma::Row<size_t>& labels,
+    const arma::rowvec& weightD,
+    arma::mat& classWeights,
+    arma::Col<size_t>& counts) const
+{
+  const size_t bins = quantizer.NumBins(attribute);
+  classWeights.zeros(numClass, bins);
+  counts.zeros(bins);
+
+  const unsigned char* pointBins = binned.colptr(attribute);
+  for (size_t j = 0; j < binned.n_rows; j++)
+  {
+    classWeights(labels[j], pointBins[j]) += isWeight ? weightD[j] : 1.0;
+    ++counts[pointBins[j]];
+  }
+}
+
+template<typename MatType>
+void DecisionStump<MatType>::BinBuckets(const arma::mat& classWeights,
+                                        const arma::Col<size_t>& counts,
+                                        std::vector<size_t>& bucketStarts)
+    const
+{
+  bucketStarts.clear();
+
+  arma::vec bucketWeights(numClass);
+  size_t bucketCount = 0;
+  for (size_t b = 0; b < counts.n_elem; ++b)
+  {
+    if (counts[b] == 0)
+      continue;
+
+    if (bucketCount == 0)
+    {
+      bucketStarts.push_back(b);
+      bucketWeights.zeros();
+    }
+    bucketWeights += classWeights.col(b);
+    bucketCount += counts[b];
+
+    // End the bucket if it is large enough and the next nonempty bin has
+    // another majority class.
+    size_t next = b + 1;
+    while (next < counts.n_elem && counts[next] == 0)
+      ++next;
+
+    if (next < counts.n_elem && bucketCount >= bucketSize &&
+        MajorityClass(classWeights.col(next)) != MajorityClass(bucketWeights))
+      bucketCount = 0;
+  }
+}
+
+template<typename MatType>
+double DecisionStump<MatType>::BucketEntropy(
+    const arma::mat& classWeights,
+    const arma::Col<size_t>& counts,
+    const std::vector<size_t>& bucketStarts) const
+{
+  const double points = (double) arma::accu(counts);
+
+  double entropy = 0.0;
+  for (size_t k = 0; k < bucketStarts.size(); ++k)
+  {
+    const size_t last = (k + 1 < bucketStarts.size()) ? bucketStarts[k + 1] - 1
+        : counts.n_elem - 1;
+    const arma::vec bucketWeights = arma::sum(classWeights.cols(
+        bucketStarts[k], last), 1);
+    const double bucketWeight = arma::accu(bucketWeights);
+    const double ratioEl = arma::accu(counts.subvec(bucketStarts[k], last)) /
+        points;
+
+    double bucketEntropy = 0.0;
+    for (size_t c = 0; c < numClass && bucketWeight > 0.0; ++c)
+    {
+      const double p1 = bucketWeights[c] / bucketWeight;
+      bucketEntropy += (p1 == 0) ? 0 : p1 * std::log(p1);
+    }
+
+    entropy += ratioEl * bucketEntropy;
+  }
+
+  return entropy / std::log(2.0);
+}
+
+template<typename MatType>
+size_t DecisionStump<MatType>::MajorityClass(const arma::vec& classWeights)
+{
+  size_t majority = 0;
+  for (size_t c = 1; c < classWeights.n_elem; ++c)
+    if (classWeights[c] >= classWeights[majority])
+      majority = c;
+
+  return majority;
 }
 
 /**
  * Sets up attribute as if it were splitting on it and finds entropy when
  * splitting on attribute.
  *
- * @param attribute A row from the training data, which might be a candidate for
- *      the splitting attribute.
+ * @param order The stable sorted order of the points in the dimension which
+ *      might be a candidate for the splitting attribute.
  * @param isWeight Whether we need to run a weighted Decision Stump.
  */
 template <typename MatType>
 template <bool isWeight>
 double DecisionStump<MatType>::SetupSplitAttribute(
-    const arma::rowvec& attribute,
+    const arma::uvec& order,
     const arma::Row<size_t>& labels,
     const arma::rowvec& weightD)
 {
   size_t i, count, begin, end;
   double entropy = 0.0;
 
-  // Sort the attribute in order to calculate splitting ranges.
-  arma::rowvec sortedAtt = arma::sort(attribute);
-
-  // Store the indices of the sorted attribute to build a vector of sorted
-  // labels.  This sort is stable.
-  arma::uvec sortedIndexAtt = arma::stable_sort_index(attribute.t());
-
-  arma::Row<size_t> sortedLabels(attribute.n_elem);
+  // Use the sorted order of the attribute to build a vector of sorted labels
+  // (and weights).
+  arma::Row<size_t> sortedLabels(order.n_elem);
   sortedLabels.fill(0);
 
   arma::rowvec tempD = arma::rowvec(weightD.n_cols);
 
-  for (i = 0; i < attribute.n_elem; i++)
+  for (i = 0; i < order.n_elem; i++)
   {
-    sortedLabels(i) = labels(sortedIndexAtt(i));
+    sortedLabels(i) = labels(order(i));
 
     if(isWeight)
-      tempD(i) = weightD(sortedIndexAtt(i));
+      tempD(i) = weightD(order(i));
   }
 
   i = 0;
@@ -246,23 +557,27 @@ double DecisionStump<MatType>::SetupSplitAttribute(
  *
  * @param attribute Attribute is the attribute decided by the constructor on
  *      which we now train the decision stump.
+ * @param order The stable sorted order of the points in that attribute.
  */
 template <typename MatType>
 template <typename rType>
 void DecisionStump<MatType>::TrainOnAtt(const arma::rowvec& attribute,
+                                        const arma::uvec& order,
                                         const arma::Row<size_t>& labels)
 {
   size_t i, count, begin, end;
 
-  arma::rowvec sortedSplitAtt = arma::sort(attribute);
-  arma::uvec sortedSplitIndexAtt = arma::stable_sort_index(attribute.t());
+  arma::rowvec sortedSplitAtt(attribute.n_elem);
   arma::Row<size_t> sortedLabels(attribute.n_elem);
   sortedLabels.fill(0);
   arma::vec tempSplit;
   arma::Row<size_t> tempLabel;
 
   for (i = 0; i < attribute.n_elem; i++)
-    sortedLabels(i) = labels(sortedSplitIndexAtt(i));
+  {
+    sortedSplitAtt(i) = attribute(order(i));
+    sortedLabels(i) = labels(order(i));
+  }
 
   arma::rowvec subCols;
   rType mostFreq;
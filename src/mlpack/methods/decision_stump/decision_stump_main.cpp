@@ -20,6 +20,10 @@ PROGRAM_INFO("Decision Stump",
     " number of training points in each bin can be specified with the "
     "--bin_size (-b) parameter.\n"
     "\n"
+    "For large datasets, the stump can be trained approximately, with each "
+    "dimension quantized into at most the number of bins given with the "
+    "--quantile_bins (-q) parameter (at most 256), which avoids sorting.\n"
+    "\n"
     "The decision stump is parameterized by a splitting dimension and a vector "
     "of values that denote the splitting values of each bin.\n"
     "\n"
@@ -46,6 +50,8 @@ PARAM_STRING("output_file", "The file in which the predicted labels for the "
 
 PARAM_INT("bin_size", "The minimum number of training points in each "
     "decision stump bin.", "b", 6);
+PARAM_INT("quantile_bins", "If nonzero, train approximately, with each "
+    "dimension quantized into at most this many bins.", "q", 0);
 
 int main(int argc, char *argv[])
 {
@@ -84,6 +90,10 @@ int main(int argc, char *argv[])
   const size_t inpBucketSize = CLI::GetParam<int>("bucket_size");
   const size_t numClasses = labels.max() + 1;
 
+  const int quantileBins = CLI::GetParam<int>("quantile_bins");
+  if (quantileBins < 0 || quantileBins == 1 || quantileBins > 256)
+    Log::Fatal << "--quantile_bins must be 0, or between 2 and 256." << endl;
+
   // Load the test file.
   const string testingDataFilename = CLI::GetParam<std::string>("test_file");
   mat testingData;
@@ -96,7 +106,7 @@ int main(int argc, char *argv[])
 
   Timer::Start("training");
   DecisionStump<> ds(trainingData, labels.t(), numClasses,
-                     inpBucketSize);
+                     inpBucketSize, quantileBins);
   Timer::Stop("training");
 
   Row<size_t> predictedLabels(testingData.n_cols);
@@ -57,6 +57,9 @@ PARAM_INT("min_leaf_size", "The minimum size of a leaf in the unpruned, fully "
     "grown DET.", "N", 5);
 PARAM_INT("max_leaf_size", "The maximum size of a leaf in the unpruned, fully "
     "grown DET.", "M", 10);
+PARAM_INT("bins", "If nonzero, search the splits approximately, among at most "
+    "this many quantile bins of each dimension (at most 256), which is faster "
+    "for large datasets.", "b", 0);
 /*
 PARAM_FLAG("volume_regularization", "This flag gives the used the option to use"
     "a form of regularization similar to the usual alpha-pruning in decision "
@@ -98,11 +101,14 @@ int main(int argc, char *argv[])
 //  const bool regularization = CLI::HasParam("volume_regularization");
   const int maxLeafSize = CLI::GetParam<int>("max_leaf_size");
   const int minLeafSize = CLI::GetParam<int>("min_leaf_size");
+  const int bins = CLI::GetParam<int>("bins");
+  if (bins < 0 || bins == 1 || bins > 256)
+    Log::Fatal << "--bins must be 0, or between 2 and 256." << endl;
 
   // Obtain the optimal tree.
   Timer::Start("det_training");
   DTree *dtreeOpt = Trainer(trainingData, folds, regularization, maxLeafSize,
-      minLeafSize, unprunedTreeEstimateFile);
+      minLeafSize, unprunedTreeEstimateFile, bins);
   Timer::Stop("det_training");
 
   // Compute densities for the training points in the optimal tree.
@@ -94,6 +94,26 @@ void mlpack::det::PrintVariableImportance(const DTree* dtree,
 }
 
 
+// Compute the sum of the log-densities of the given range of points of the
+// dataset, in parallel.  (When the folds of the cross-validation are already
+// processed in parallel, the nested parallel region is run by one thread.)
+static double TestValue(const DTree& tree,
+                        const arma::mat& dataset,
+                        const size_t start,
+                        const size_t end)
+{
+  double cvVal = 0.0;
+
+  #pragma omp parallel for schedule(static) reduction(+:cvVal)
+  for (size_t j = start; j < end; ++j)
+  {
+    const arma::vec testPoint = dataset.unsafe_col(j);
+    cvVal += tree.ComputeValue(testPoint);
+  }
+
+  return cvVal;
+}
+
 // This function trains the optimal decision tree using the given number of
 // folds.
 DTree* mlpack::det::Trainer(arma::mat& dataset,
@@ -101,7 +121,8 @@ DTree* mlpack::det::Trainer(arma::mat& dataset,
                             const bool useVolumeReg,
                             const size_t maxLeafSize,
                             const size_t minLeafSize,
-                            const std::string unprunedTreeOutput)
+                            const std::string unprunedTreeOutput,
+                            const size_t maxBins)
 {
   // Initialize the tree.
   DTree* dtree = new DTree(dataset);
@@ -117,7 +138,7 @@ DTree* mlpack::det::Trainer(arma::mat& dataset,
   // Growing the tree
   double oldAlpha = 0.0;
   double alpha = dtree->Grow(newDataset, oldFromNew, useVolumeReg, maxLeafSize,
-      minLeafSize);
+      minLeafSize, maxBins);
 
   Log::Info << dtree->SubtreeLeaves() << " leaf nodes in the tree using full "
       << "dataset; minimum alpha: " << alpha << "." << std::endl;
@@ -170,35 +191,31 @@ DTree* mlpack::det::Trainer(arma::mat& dataset,
 
   delete dtree;
 
-  arma::mat cvData(dataset);
-  size_t testSize = dataset.n_cols / folds;
+  const size_t testSize = dataset.n_cols / folds;
 
-  std::vector<double> regularizationConstants;
-  regularizationConstants.resize(prunedSequence.size(), 0);
+  // The cross-validation values of each tree in the sequence, for each fold.
+  // They are summed in order of fold afterwards, so the result does not depend
+  // on the order the folds are processed in.
+  arma::mat foldConstants(prunedSequence.size(), folds);
+  foldConstants.zeros();
 
-  // Go through each fold.
+  // The folds are independent, so they are trained concurrently.  The test
+  // points of each fold are a range of columns of the dataset, which is used
+  // directly; only the training set is copied, because growing a tree reorders
+  // its points.
+  #pragma omp parallel for schedule(dynamic)
   for (size_t fold = 0; fold < folds; fold++)
   {
     // Break up data into train and test sets.
-    size_t start = fold * testSize;
-    size_t end = std::min((fold + 1) * testSize, (size_t) cvData.n_cols);
+    const size_t start = fold * testSize;
+    const size_t end = std::min((fold + 1) * testSize, (size_t) dataset.n_cols);
 
-    arma::mat test = cvData.cols(start, end - 1);
-    arma::mat train(cvData.n_rows, cvData.n_cols - test.n_cols);
-
-    if (start == 0 && end < cvData.n_cols)
-    {
-      train.cols(0, train.n_cols - 1) = cvData.cols(end, cvData.n_cols - 1);
-    }
-    else if (start > 0 && end == cvData.n_cols)
-    {
-      train.cols(0, train.n_cols - 1) = cvData.cols(0, start - 1);
-    }
-    else
-    {
-      train.cols(0, start - 1) = cvData.cols(0, start - 1);
-      train.cols(start, train.n_cols - 1) = cvData.cols(end, cvData.n_cols - 1);
-    }
+    arma::mat train(dataset.n_rows, dataset.n_cols - (end - start));
+    if (start > 0)
+      train.cols(0, start - 1) = dataset.cols(0, start - 1);
+    if (end < dataset.n_cols)
+      train.cols(start, train.n_cols - 1) = dataset.cols(end,
+          dataset.n_cols - 1);
 
     // Initialize the tree.
     DTree* cvDTree = new DTree(train);
@@ -209,9 +226,8 @@ DTree* mlpack::det::Trainer(arma::mat& dataset,
       cvOldFromNew[i] = i;
 
     // Grow the tree.
-    oldAlpha = 0.0;
-    alpha = cvDTree->Grow(train, cvOldFromNew, useVolumeReg, maxLeafSize,
-        minLeafSize);
+    cvDTree->Grow(train, cvOldFromNew, useVolumeReg, maxLeafSize, minLeafSize,
+        maxBins);
 
     // Sequentially prune with all the values of available alphas and adding
     // values for test values.  Don't enter this loop if there are less than two
@@ -220,38 +236,33 @@ DTree* mlpack::det::Trainer(arma::mat& dataset,
          i < ((prunedSequence.size() < 2) ? 0 : prunedSequence.size() - 2); ++i)
     {
       // Compute test values for this state of the tree.
-      double cvVal = 0.0;
-      for (size_t j = 0; j < test.n_cols; j++)
-      {
-        arma::vec testPoint = test.unsafe_col(j);
-        cvVal += cvDTree->ComputeValue(testPoint);
-      }
+      const double cvVal = TestValue(*cvDTree, dataset, start, end);
 
       // Update the cv regularization constant.
-      regularizationConstants[i] += 2.0 * cvVal / (double) dataset.n_cols;
+      foldConstants(i, fold) = 2.0 * cvVal / (double) dataset.n_cols;
 
       // Determine the new alpha value and prune accordingly.
-      oldAlpha = 0.5 * (prunedSequence[i + 1].first +
+      const double foldAlpha = 0.5 * (prunedSequence[i + 1].first +
           prunedSequence[i + 2].first);
-      alpha = cvDTree->PruneAndUpdate(oldAlpha, train.n_cols, useVolumeReg);
+      cvDTree->PruneAndUpdate(foldAlpha, train.n_cols, useVolumeReg);
     }
 
     // Compute test values for this state of the tree.
-    double cvVal = 0.0;
-    for (size_t i = 0; i < test.n_cols; ++i)
-    {
-      arma::vec testPoint = test.unsafe_col(i);
-      cvVal += cvDTree->ComputeValue(testPoint);
-    }
+    const double cvVal = TestValue(*cvDTree, dataset, start, end);
 
     if (prunedSequence.size() > 2)
-      regularizationConstants[prunedSequence.size() - 2] += 2.0 * cvVal /
+      foldConstants(prunedSequence.size() - 2, fold) = 2.0 * cvVal /
           (double) dataset.n_cols;
 
-    test.reset();
     delete cvDTree;
   }
 
+  std::vector<double> regularizationConstants;
+  regularizationConstants.resize(prunedSequence.size(), 0);
+  for (size_t fold = 0; fold < folds; ++fold)
+    for (size_t i = 0; i < prunedSequence.size(); ++i)
+      regularizationConstants[i] += foldConstants(i, fold);
+
   double optimalAlpha = -1.0;
   long double cvBestError = -std::numeric_limits<long double>::max();
 
@@ -137,99 +137,234 @@ bool DTree::FindSplit(const arma::mat& data,
   assert(data.n_rows == maxVals.n_elem);
   assert(data.n_rows == minVals.n_elem);
 
+  // Sort the values of the points of this node in each dimension.
+  arma::mat sortedValues(end - start, data.n_rows);
+  for (size_t dim = 0; dim < data.n_rows; ++dim)
+    sortedValues.col(dim) = arma::sort(arma::trans(data.row(dim).subvec(start,
+        end - 1)));
+
+  return FindSortedSplit(sortedValues, start, data.n_cols, splitDim, splitValue,
+      leftError, rightError, minLeafSize);
+}
+
+// Find the best split given the sorted values of the points in each dimension.
+// Each dimension is searched independently (in parallel, if the node is large
+// enough), and then the best split is chosen in order of dimension, so that the
+// result does not depend on the number of threads.
+bool DTree::FindSortedSplit(const arma::mat& sortedValues,
+                            const size_t offset,
+                            const size_t totalPoints,
+                            size_t& splitDim,
+                            double& splitValue,
+                            double& leftError,
+                            double& rightError,
+                            const size_t minLeafSize) const
+{
   const size_t points = end - start;
+  const size_t dims = maxVals.n_elem;
+
+  std::vector<char> dimSplitFound(dims, false);
+  std::vector<double> dimErrors(dims);
+  std::vector<double> dimLeftErrors(dims);
+  std::vector<double> dimRightErrors(dims);
+  std::vector<double> dimSplitValues(dims);
+
+  for (size_t dim = 0; dim < dims; ++dim)
+  {
+    #pragma omp task shared(sortedValues, dimSplitFound, dimErrors, \
+        dimLeftErrors, dimRightErrors, dimSplitValues) \
+        if (points >= MinParallelPoints)
+    dimSplitFound[dim] = FindDimensionSplit(sortedValues.colptr(dim) +
+        (start - offset), dim, minLeafSize, dimErrors[dim], dimLeftErrors[dim],
+        dimRightErrors[dim], dimSplitValues[dim]);
+  }
+  #pragma omp taskwait
 
+  return ChooseSplit(dimSplitFound, dimErrors, dimLeftErrors, dimRightErrors,
+      dimSplitValues, totalPoints, splitDim, splitValue, leftError, rightError);
+}
+
+bool DTree::ChooseSplit(const std::vector<char>& dimSplitFound,
+                        const std::vector<double>& dimErrors,
+                        const std::vector<double>& dimLeftErrors,
+                        const std::vector<double>& dimRightErrors,
+                        const std::vector<double>& dimSplitValues,
+                        const size_t totalPoints,
+                        size_t& splitDim,
+                        double& splitValue,
+                        double& leftError,
+                        double& rightError) const
+{
   double minError = logNegError;
   bool splitFound = false;
 
-  // Loop through each dimension.
-  for (size_t dim = 0; dim < maxVals.n_elem; dim++)
+  for (size_t dim = 0; dim < dimSplitFound.size(); ++dim)
+  {
+    if (!dimSplitFound[dim])
+      continue;
+
+    // Find the log volume of all the other dimensions.
+    const double volumeWithoutDim = logVolume - std::log(maxVals[dim] -
+        minVals[dim]);
+
+    double actualMinDimError = std::log(dimErrors[dim])
+        - 2 * std::log((double) totalPoints) - volumeWithoutDim;
+
+    if (actualMinDimError > minError)
+    {
+      // Calculate actual error (in logspace) by adding terms back to our
+      // estimate.
+      minError = actualMinDimError;
+      splitDim = dim;
+      splitValue = dimSplitValues[dim];
+      leftError = std::log(dimLeftErrors[dim]) - 2 * std::log((double)
+          totalPoints) - volumeWithoutDim;
+      rightError = std::log(dimRightErrors[dim]) - 2 * std::log((double)
+          totalPoints) - volumeWithoutDim;
+      splitFound = true;
+    } // end if better split found in this dimension.
+  }
+
+  return splitFound;
+}
+
+// Find the best split among the bin edges, given the histogram of the points
+// of this node.  This is the same search as FindDimensionSplit(), but only the
+// bin edges are candidates (so a scan takes time proportional to the number of
+// bins, not to the number of points).
+bool DTree::FindHistogramSplit(const arma::Mat<size_t>& histogram,
+                               const math::QuantileBins& quantizer,
+                               const size_t totalPoints,
+                               size_t& splitDim,
+                               double& splitValue,
+                               double& leftError,
+                               double& rightError,
+                               const size_t minLeafSize) const
+{
+  const size_t points = end - start;
+  const size_t dims = maxVals.n_elem;
+
+  std::vector<char> dimSplitFound(dims, false);
+  std::vector<double> dimErrors(dims);
+  std::vector<double> dimLeftErrors(dims, 0.0);
+  std::vector<double> dimRightErrors(dims, 0.0);
+  std::vector<double> dimSplitValues(dims, 0.0);
+
+  for (size_t dim = 0; dim < dims; ++dim)
   {
-    // Have to deal with REAL, INTEGER, NOMINAL data differently, so we have to
-    // think of how to do that...
     const double min = minVals[dim];
     const double max = maxVals[dim];
 
     // If there is nothing to split in this dimension, move on.
     if (max - min == 0.0)
-      continue; // Skip to next dimension.
+      continue;
 
-    // Initializing all the stuff for this dimension.
-    bool dimSplitFound = false;
-    // Take an error estimate for this dimension.
-    double minDimError = std::pow(points, 2.0) / (max - min);
-    double dimLeftError = 0.0; // For -Wuninitialized.  These variables will
-    double dimRightError = 0.0; // always be set to something else before use.
-    double dimSplitValue = 0.0;
-
-    // Find the log volume of all the other dimensions.
-    double volumeWithoutDim = logVolume - std::log(max - min);
+    const arma::vec& edges = quantizer.Edges(dim);
+    dimErrors[dim] = std::pow(points, 2.0) / (max - min);
 
-    // Get the values for the dimension.
-    arma::rowvec dimVec = data.row(dim).subvec(start, end - 1);
-
-    // Sort the values in ascending order.
-    dimVec = arma::sort(dimVec);
-
-    // Find the best split for this dimension.  We need to figure out why
-    // there are spikes if this minLeafSize is enforced here...
-    for (size_t i = minLeafSize - 1; i < dimVec.n_elem - minLeafSize; ++i)
+    // The points left of edge b are the points of bins 0 to b.
+    size_t leftPoints = 0;
+    for (size_t b = 0; b < edges.n_elem; ++b)
     {
-      // This makes sense for real continuous data.  This kinda corrupts the
-      // data and estimation if the data is ordinal.
-      const double split = (dimVec[i] + dimVec[i + 1]) / 2.0;
+      leftPoints += histogram(b, dim);
+      if (leftPoints < minLeafSize)
+        continue;
+      if (points - leftPoints < minLeafSize)
+        break;
 
-      if (split == dimVec[i])
-        continue; // We can't split here (two points are the same).
-
-      // Another way of picking split is using this:
-      //   split = leftsplit;
+      const double split = edges[b];
       if ((split - min > 0.0) && (max - split > 0.0))
       {
-        // Ensure that the right node will have at least the minimum number of
-        // points.
-        Log::Assert((points - i - 1) >= minLeafSize);
-
-        // Now we have to see if the error will be reduced.  Simple manipulation
-        // of the error function gives us the condition we must satisfy:
-        //   |t_l|^2 / V_l + |t_r|^2 / V_r  >= |t|^2 / (V_l + V_r)
-        // and because the volume is only dependent on the dimension we are
-        // splitting, we can assume V_l is just the range of the left and V_r is
-        // just the range of the right.
-        double negLeftError = std::pow(i + 1, 2.0) / (split - min);
-        double negRightError = std::pow(points - i - 1, 2.0) / (max - split);
-
-        // If this is better, take it.
-        if ((negLeftError + negRightError) >= minDimError)
+        const double negLeftError = std::pow(leftPoints, 2.0) / (split - min);
+        const double negRightError = std::pow(points - leftPoints, 2.0) /
+            (max - split);
+
+        if ((negLeftError + negRightError) >= dimErrors[dim])
         {
-          minDimError = negLeftError + negRightError;
-          dimLeftError = negLeftError;
-          dimRightError = negRightError;
-          dimSplitValue = split;
-          dimSplitFound = true;
+          dimErrors[dim] = negLeftError + negRightError;
+          dimLeftErrors[dim] = negLeftError;
+          dimRightErrors[dim] = negRightError;
+          dimSplitValues[dim] = split;
+          dimSplitFound[dim] = true;
         }
       }
     }
+  }
+
+  return ChooseSplit(dimSplitFound, dimErrors, dimLeftErrors, dimRightErrors,
+      dimSplitValues, totalPoints, splitDim, splitValue, leftError, rightError);
+}
 
-    double actualMinDimError = std::log(minDimError)
-        - 2 * std::log((double) data.n_cols) - volumeWithoutDim;
+// Find the best split in one dimension, given the sorted values of the points
+// of this node in that dimension.
+bool DTree::FindDimensionSplit(const double* dimVec,
+                               const size_t dim,
+                               const size_t minLeafSize,
+                               double& minDimError,
+                               double& dimLeftError,
+                               double& dimRightError,
+                               double& dimSplitValue) const
+{
+  const size_t points = end - start;
 
-    if ((actualMinDimError > minError) && dimSplitFound)
+  // Have to deal with REAL, INTEGER, NOMINAL data differently, so we have to
+  // think of how to do that...
+  const double min = minVals[dim];
+  const double max = maxVals[dim];
+
+  // If there is nothing to split in this dimension, move on.
+  if (max - min == 0.0)
+    return false;
+
+  // Initializing all the stuff for this dimension.
+  bool dimSplitFound = false;
+  // Take an error estimate for this dimension.
+  minDimError = std::pow(points, 2.0) / (max - min);
+  dimLeftError = 0.0; // For -Wuninitialized.  These variables will always be
+  dimRightError = 0.0; // set to something else before use.
+  dimSplitValue = 0.0;
+
+  // Find the best split for this dimension.  We need to figure out why
+  // there are spikes if this minLeafSize is enforced here...
+  for (size_t i = minLeafSize - 1; i < points - minLeafSize; ++i)
+  {
+    // This makes sense for real continuous data.  This kinda corrupts the
+    // data and estimation if the data is ordinal.
+    const double split = (dimVec[i] + dimVec[i + 1]) / 2.0;
+
+    if (split == dimVec[i])
+      continue; // We can't split here (two points are the same).
+
+    // Another way of picking split is using this:
+    //   split = leftsplit;
+    if ((split - min > 0.0) && (max - split > 0.0))
     {
-      // Calculate actual error (in logspace) by adding terms back to our
-      // estimate.
-      minError = actualMinDimError;
-      splitDim = dim;
-      splitValue = dimSplitValue;
-      leftError = std::log(dimLeftError) - 2 * std::log((double) data.n_cols)
-          - volumeWithoutDim;
-      rightError = std::log(dimRightError) - 2 * std::log((double) data.n_cols)
-          - volumeWithoutDim;
-      splitFound = true;
-    } // end if better split found in this dimension.
+      // Ensure that the right node will have at least the minimum number of
+      // points.
+      Log::Assert((points - i - 1) >= minLeafSize);
+
+      // Now we have to see if the error will be reduced.  Simple manipulation
+      // of the error function gives us the condition we must satisfy:
+      //   |t_l|^2 / V_l + |t_r|^2 / V_r  >= |t|^2 / (V_l + V_r)
+      // and because the volume is only dependent on the dimension we are
+      // splitting, we can assume V_l is just the range of the left and V_r is
+      // just the range of the right.
+      double negLeftError = std::pow(i + 1, 2.0) / (split - min);
+      double negRightError = std::pow(points - i - 1, 2.0) / (max - split);
+
+      // If this is better, take it.
+      if ((negLeftError + negRightError) >= minDimError)
+      {
+        minDimError = negLeftError + negRightError;
+        dimLeftError = negLeftError;
+        dimRightError = negRightError;
+        dimSplitValue = split;
+        dimSplitFound = true;
+      }
+    }
   }
 
-  return splitFound;
+  return dimSplitFound;
 }
 
 size_t DTree::SplitData(arma::mat& data,
@@ -265,26 +400,149 @@ size_t DTree::SplitData(arma::mat& data,
   return left;
 }
 
-// Greedily expand the tree
+// Reorder the sorted values of each dimension (except the split dimension,
+// which is already in order) so that the points of the left child come first;
+// this is a stable partition, so both halves stay sorted.
+void DTree::PartitionSorted(arma::mat& sortedValues,
+                            arma::Mat<size_t>& sortedIds,
+                            const std::vector<char>& goesLeft,
+                            const size_t offset,
+                            const size_t leftPoints) const
+{
+  const size_t points = end - start;
+
+  for (size_t dim = 0; dim < sortedValues.n_cols; ++dim)
+  {
+    if (dim == splitDim)
+      continue;
+
+    #pragma omp task shared(sortedValues, sortedIds, goesLeft) \
+        if (points >= MinParallelPoints)
+    {
+      double* values = sortedValues.colptr(dim) + (start - offset);
+      size_t* ids = sortedIds.colptr(dim) + (start - offset);
+
+      std::vector<double> rightValues;
+      std::vector<size_t> rightIds;
+      rightValues.reserve(points - leftPoints);
+      rightIds.reserve(points - leftPoints);
+
+      size_t l = 0;
+      for (size_t i = 0; i < points; ++i)
+      {
+        if (goesLeft[ids[i]])
+        {
+          values[l] = values[i];
+          ids[l] = ids[i];
+          ++l;
+        }
+        else
+        {
+          rightValues.push_back(values[i]);
+          rightIds.push_back(ids[i]);
+        }
+      }
+
+      std::copy(rightValues.begin(), rightValues.end(), values + l);
+      std::copy(rightIds.begin(), rightIds.end(), ids + l);
+    }
+  }
+  #pragma omp taskwait
+}
+
+// Greedily expand the tree.
 double DTree::Grow(arma::mat& data,
                    arma::Col<size_t>& oldFromNew,
                    const bool useVolReg,
                    const size_t maxLeafSize,
-                   const size_t minLeafSize)
+                   const size_t minLeafSize,
+                   const size_t maxBins)
 {
   Log::Assert(data.n_rows == maxVals.n_elem);
   Log::Assert(data.n_rows == minVals.n_elem);
 
-  double leftG, rightG;
+  if (maxBins != 0)
+  {
+    // Quantize the points of this node once; the bins are stored by the
+    // original index of each point, like the sorted orders below.
+    const math::QuantileBins quantizer(data.cols(start, end - 1), maxBins);
+    arma::Mat<unsigned char> bins(data.n_rows, oldFromNew.n_elem);
+    arma::Mat<size_t> histogram(quantizer.MaxNumBins(), data.n_rows);
+    histogram.zeros();
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t dim = 0; dim < data.n_rows; ++dim)
+    {
+      for (size_t i = start; i < end; ++i)
+      {
+        const size_t bin = quantizer.Bin(dim, data(dim, i));
+        bins(dim, oldFromNew[i]) = (unsigned char) bin;
+        ++histogram(bin, dim);
+      }
+    }
 
-  // Compute points ratio.
-  ratio = (double) (end - start) / (double) oldFromNew.n_elem;
+    double result = 0.0;
+    #pragma omp parallel
+    {
+      #pragma omp single
+      result = GrowHistogramNode(data, oldFromNew, bins, quantizer, histogram,
+          useVolReg, maxLeafSize, minLeafSize);
+    }
 
-  // Compute the log of the volume of the node.
-  logVolume = 0;
-  for (size_t i = 0; i < maxVals.n_elem; ++i)
-    if (maxVals[i] - minVals[i] > 0.0)
-      logVolume += std::log(maxVals[i] - minVals[i]);
+    return result;
+  }
+
+  // Sort the points of this node in each dimension, once; the sorted orders of
+  // the children are obtained from the sorted orders of their parent by stable
+  // partitions, instead of sorting again at each node.  The points are
+  // identified by their index in the original dataset (oldFromNew[i]), which
+  // does not change when SplitData() moves them around.
+  const size_t points = end - start;
+  arma::mat sortedValues(points, data.n_rows);
+  arma::Mat<size_t> sortedIds(points, data.n_rows);
+
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t dim = 0; dim < data.n_rows; ++dim)
+  {
+    const arma::rowvec values = data.row(dim).subvec(start, end - 1);
+    const arma::uvec order = arma::sort_index(values);
+
+    for (size_t i = 0; i < points; ++i)
+    {
+      sortedValues(i, dim) = values[order[i]];
+      sortedIds(i, dim) = oldFromNew[start + order[i]];
+    }
+  }
+
+  // For each point, whether it goes to the left child of the node being split.
+  std::vector<char> goesLeft(oldFromNew.n_elem, false);
+
+  // Grow the tree with OpenMP tasks: the dimensions are searched in parallel
+  // in large nodes, and sibling subtrees are grown in parallel.
+  double result = 0.0;
+  #pragma omp parallel
+  {
+    #pragma omp single
+    result = GrowNode(data, oldFromNew, sortedValues, sortedIds, goesLeft,
+        start, useVolReg, maxLeafSize, minLeafSize);
+  }
+
+  return result;
+}
+
+// Recursively expand the tree.
+double DTree::GrowNode(arma::mat& data,
+                       arma::Col<size_t>& oldFromNew,
+                       arma::mat& sortedValues,
+                       arma::Mat<size_t>& sortedIds,
+                       std::vector<char>& goesLeft,
+                       const size_t offset,
+                       const bool useVolReg,
+                       const size_t maxLeafSize,
+                       const size_t minLeafSize)
+{
+  double leftG = 0.0, rightG = 0.0;
+  StartNode(oldFromNew.n_elem);
 
   // Check if node is large enough to split.
   if ((size_t) (end - start) > maxLeafSize) {
@@ -293,7 +551,8 @@ double DTree::Grow(arma::mat& data,
     size_t dim;
     double splitValueTmp;
     double leftError, rightError;
-    if (FindSplit(data, dim, splitValueTmp, leftError, rightError, minLeafSize))
+    if (FindSortedSplit(sortedValues, offset, data.n_cols, dim, splitValueTmp,
+        leftError, rightError, minLeafSize))
     {
       // Move the data around for the children to have points in a node lie
       // contiguously (to increase efficiency during the training).
@@ -312,42 +571,140 @@ double DTree::Grow(arma::mat& data,
       splitValue = splitValueTmp;
       splitDim = dim;
 
-      // Recursively grow the children.
+      // Keep the values of each dimension sorted within each child.
+      for (size_t i = start; i < end; ++i)
+        goesLeft[oldFromNew[i]] = (i < splitIndex);
+      PartitionSorted(sortedValues, sortedIds, goesLeft, offset,
+          splitIndex - start);
+
+      // Recursively grow the children; they own disjoint parts of the data and
+      // of the sorted values, so the left child can be grown in another task.
       left = new DTree(maxValsL, minValsL, start, splitIndex, leftError);
       right = new DTree(maxValsR, minValsR, splitIndex, end, rightError);
 
-      leftG = left->Grow(data, oldFromNew, useVolReg, maxLeafSize,
-          minLeafSize);
-      rightG = right->Grow(data, oldFromNew, useVolReg, maxLeafSize,
-          minLeafSize);
+      #pragma omp task shared(leftG, data, oldFromNew, sortedValues, \
+          sortedIds, goesLeft) if (end - start >= MinParallelPoints)
+      leftG = left->GrowNode(data, oldFromNew, sortedValues, sortedIds,
+          goesLeft, offset, useVolReg, maxLeafSize, minLeafSize);
+      rightG = right->GrowNode(data, oldFromNew, sortedValues, sortedIds,
+          goesLeft, offset, useVolReg, maxLeafSize, minLeafSize);
+      #pragma omp taskwait
+    }
+  }
 
-      // Store values of R(T~) and |T~|.
-      subtreeLeaves = left->SubtreeLeaves() + right->SubtreeLeaves();
+  return FinishNode(data.n_cols, useVolReg, leftG, rightG);
+}
 
-      // Find the log negative error of the subtree leaves.  This is kind of an
-      // odd one because we don't want to represent the error in non-log-space,
-      // but we have to calculate log(E_l + E_r).  So we multiply E_l and E_r by
-      // V_t (remember E_l has an inverse relationship to the volume of the
-      // nodes) and then subtract log(V_t) at the end of the whole expression.
-      // As a result we do leave log-space, but the largest quantity we
-      // represent is on the order of (V_t / V_i) where V_i is the smallest leaf
-      // node below this node, which depends heavily on the depth of the tree.
-      subtreeLeavesLogNegError = std::log(
-          std::exp(logVolume + left->SubtreeLeavesLogNegError()) +
-          std::exp(logVolume + right->SubtreeLeavesLogNegError()))
-          - logVolume;
-    }
-    else
+// Recursively expand the tree, with the splits searched among the bin edges.
+double DTree::GrowHistogramNode(arma::mat& data,
+                                arma::Col<size_t>& oldFromNew,
+                                const arma::Mat<unsigned char>& bins,
+                                const math::QuantileBins& quantizer,
+                                arma::Mat<size_t>& histogram,
+                                const bool useVolReg,
+                                const size_t maxLeafSize,
+                                const size_t minLeafSize)
+{
+  double leftG = 0.0, rightG = 0.0;
+  StartNode(oldFromNew.n_elem);
+
+  size_t dim;
+  double splitValueTmp;
+  double leftError, rightError;
+  if ((size_t) (end - start) > maxLeafSize && FindHistogramSplit(histogram,
+      quantizer, data.n_cols, dim, splitValueTmp, leftError, rightError,
+      minLeafSize))
+  {
+    // The points of bins up to the split edge are exactly the points which are
+    // not larger than the split value, so SplitData() agrees with the
+    // histogram.
+    const size_t splitIndex = SplitData(data, dim, splitValueTmp, oldFromNew);
+
+    arma::vec maxValsL(maxVals);
+    arma::vec maxValsR(maxVals);
+    arma::vec minValsL(minVals);
+    arma::vec minValsR(minVals);
+
+    maxValsL[dim] = splitValueTmp;
+    minValsR[dim] = splitValueTmp;
+
+    splitValue = splitValueTmp;
+    splitDim = dim;
+
+    // Scan the smaller child only; the histogram of the larger child is what
+    // is left of the histogram of this node.
+    const bool leftSmaller = (splitIndex - start <= end - splitIndex);
+    const size_t smallStart = leftSmaller ? start : splitIndex;
+    const size_t smallEnd = leftSmaller ? splitIndex : end;
+
+    arma::Mat<size_t> smallHistogram(histogram.n_rows, histogram.n_cols);
+    smallHistogram.zeros();
+    for (size_t i = smallStart; i < smallEnd; ++i)
     {
-      // No split found so make a leaf out of it.
-      subtreeLeaves = 1;
-      subtreeLeavesLogNegError = logNegError;
+      const unsigned char* pointBins = bins.colptr(oldFromNew[i]);
+      for (size_t d = 0; d < bins.n_rows; ++d)
+        ++smallHistogram(pointBins[d], d);
     }
+    histogram -= smallHistogram;
+
+    arma::Mat<size_t>& leftHistogram = leftSmaller ? smallHistogram :
+        histogram;
+    arma::Mat<size_t>& rightHistogram = leftSmaller ? histogram :
+        smallHistogram;
+
+    left = new DTree(maxValsL, minValsL, start, splitIndex, leftError);
+    right = new DTree(maxValsR, minValsR, splitIndex, end, rightError);
+
+    #pragma omp task shared(leftG, data, oldFromNew, bins, quantizer, \
+        leftHistogram) if (end - start >= MinParallelPoints)
+    leftG = left->GrowHistogramNode(data, oldFromNew, bins, quantizer,
+        leftHistogram, useVolReg, maxLeafSize, minLeafSize);
+    rightG = right->GrowHistogramNode(data, oldFromNew, bins, quantizer,
+        rightHistogram, useVolReg, maxLeafSize, minLeafSize);
+    #pragma omp taskwait
+  }
+
+  return FinishNode(data.n_cols, useVolReg, leftG, rightG);
+}
+
+void DTree::StartNode(const size_t totalPoints)
+{
+  // Compute points ratio.
+  ratio = (double) (end - start) / (double) totalPoints;
+
+  // Compute the log of the volume of the node.
+  logVolume = 0;
+  for (size_t i = 0; i < maxVals.n_elem; ++i)
+    if (maxVals[i] - minVals[i] > 0.0)
+      logVolume += std::log(maxVals[i] - minVals[i]);
+}
+
+double DTree::FinishNode(const size_t totalPoints,
+                         const bool useVolReg,
+                         const double leftG,
+                         const double rightG)
+{
+  if (left != NULL)
+  {
+    // Store values of R(T~) and |T~|.
+    subtreeLeaves = left->SubtreeLeaves() + right->SubtreeLeaves();
+
+    // Find the log negative error of the subtree leaves.  This is kind of an
+    // odd one because we don't want to represent the error in non-log-space,
+    // but we have to calculate log(E_l + E_r).  So we multiply E_l and E_r by
+    // V_t (remember E_l has an inverse relationship to the volume of the
+    // nodes) and then subtract log(V_t) at the end of the whole expression.
+    // As a result we do leave log-space, but the largest quantity we
+    // represent is on the order of (V_t / V_i) where V_i is the smallest leaf
+    // node below this node, which depends heavily on the depth of the tree.
+    subtreeLeavesLogNegError = std::log(
+        std::exp(logVolume + left->SubtreeLeavesLogNegError()) +
+        std::exp(logVolume + right->SubtreeLeavesLogNegError()))
+        - logVolume;
   }
   else
   {
-    // We can make this a leaf node.
-    assert((size_t) (end - start) >= minLeafSize);
+    // No split was made, so this is a leaf.
     subtreeLeaves = 1;
     subtreeLeavesLogNegError = logNegError;
   }
@@ -374,7 +731,7 @@ double DTree::Grow(arma::mat& data,
 
     if (left->SubtreeLeaves() > 1)
     {
-      const double exponent = 2 * std::log((double) data.n_cols) + logVolume +
+      const double exponent = 2 * std::log((double) totalPoints) + logVolume +
           left->AlphaUpper();
 
       // Whether or not this will overflow is highly dependent on the depth of
@@ -384,13 +741,13 @@ double DTree::Grow(arma::mat& data,
 
     if (right->SubtreeLeaves() > 1)
     {
-      const double exponent = 2 * std::log((double) data.n_cols) + logVolume +
+      const double exponent = 2 * std::log((double) totalPoints) + logVolume +
           right->AlphaUpper();
 
       tmpAlphaSum += std::exp(exponent);
     }
 
-    alphaUpper = std::log(tmpAlphaSum) - 2 * std::log((double) data.n_cols)
+    alphaUpper = std::log(tmpAlphaSum) - 2 * std::log((double) totalPoints)
         - logVolume;
 
     double gT;
@@ -108,17 +108,34 @@ class DTree
    * Greedily expand the tree.  The points in the dataset will be reordered
    * during tree growth.
    *
+   * The values of the points are sorted in each dimension once, at the start;
+   * the sorted orders are then kept up to date when nodes are split, so no
+   * node has to sort its points.  With OpenMP, the dimensions of large nodes
+   * are searched in parallel and sibling subtrees are grown in parallel (with
+   * tasks); the tree is the same as with one thread.
+   *
+   * If maxBins is nonzero, the splits are approximate instead: each dimension
+   * is quantized once into at most maxBins bins (see math::QuantileBins), and
+   * the splits of each node are searched among the bin edges only, with a
+   * histogram of the node (the histogram of the larger child is the histogram
+   * of its parent minus the histogram of its sibling, so only the smaller
+   * child is scanned).  This avoids sorting, and is much faster for large
+   * datasets, at the cost of slightly coarser splits.
+   *
    * @param data Dataset to build tree on.
    * @param oldFromNew Mappings from old points to new points.
    * @param useVolReg If true, volume regularization is used.
    * @param maxLeafSize Maximum size of a leaf.
    * @param minLeafSize Minimum size of a leaf.
+   * @param maxBins Maximum number of bins of each dimension (at most 256), or
+   *     0 for exact splits.
    */
   double Grow(arma::mat& data,
               arma::Col<size_t>& oldFromNew,
               const bool useVolReg = false,
               const size_t maxLeafSize = 10,
-              const size_t minLeafSize = 5);
+              const size_t minLeafSize = 5,
+              const size_t maxBins = 0);
 
   /**
    * Perform alpha pruning on a tree.  Returns the new value of alpha.
@@ -267,6 +284,8 @@ class DTree
   bool Root() const { return root; }
   //! Return the upper part of the alpha sum.
   double AlphaUpper() const { return alphaUpper; }
+  //! Return the tag of this leaf (set by TagTree()).
+  int BucketTag() const { return bucketTag; }
 
   //! Return the maximum values.
   const arma::vec& MaxVals() const { return maxVals; }
@@ -305,6 +324,123 @@ class DTree
                    const double splitValue,
                    arma::Col<size_t>& oldFromNew) const;
 
+  //! Nodes with fewer points than this are not split into parallel tasks.
+  static const size_t MinParallelPoints = 10000;
+
+  /**
+   * Recursively expand the tree (see Grow()), given the values of the points
+   * sorted in each dimension.
+   *
+   * @param sortedValues Values of the points, sorted in each dimension (one
+   *     column per dimension).
+   * @param sortedIds Original indices of the points in sortedValues.
+   * @param goesLeft Buffer for the side of each point (by original index).
+   * @param offset Index of the first point of sortedValues in the dataset.
+   */
+  double GrowNode(arma::mat& data,
+                  arma::Col<size_t>& oldFromNew,
+                  arma::mat& sortedValues,
+                  arma::Mat<size_t>& sortedIds,
+                  std::vector<char>& goesLeft,
+                  const size_t offset,
+                  const bool useVolReg,
+                  const size_t maxLeafSize,
+                  const size_t minLeafSize);
+
+  /**
+   * Find the dimension to split on, given the values of the points of this
+   * node sorted in each dimension (rows start - offset to end - offset - 1 of
+   * sortedValues).
+   */
+  bool FindSortedSplit(const arma::mat& sortedValues,
+                       const size_t offset,
+                       const size_t totalPoints,
+                       size_t& splitDim,
+                       double& splitValue,
+                       double& leftError,
+                       double& rightError,
+                       const size_t minLeafSize) const;
+
+  /**
+   * Find the best split in the given dimension, given the sorted values of the
+   * points of this node in that dimension.  Returns false if there is none.
+   */
+  bool FindDimensionSplit(const double* dimVec,
+                          const size_t dim,
+                          const size_t minLeafSize,
+                          double& minDimError,
+                          double& dimLeftError,
+                          double& dimRightError,
+                          double& dimSplitValue) const;
+
+  /**
+   * Recursively expand the tree (see Grow()) with approximate splits, given the
+   * histogram of the bins of the points of this node.
+   *
+   * @param bins Bin of each value of each point (by original index).
+   * @param quantizer Bins of each dimension.
+   * @param histogram Number of points of this node in each bin (one column per
+   *     dimension); it is overwritten.
+   */
+  double GrowHistogramNode(arma::mat& data,
+                           arma::Col<size_t>& oldFromNew,
+                           const arma::Mat<unsigned char>& bins,
+                           const math::QuantileBins& quantizer,
+                           arma::Mat<size_t>& histogram,
+                           const bool useVolReg,
+                           const size_t maxLeafSize,
+                           const size_t minLeafSize);
+
+  /**
+   * Find the dimension to split on among the bin edges, given the histogram of
+   * the points of this node.
+   */
+  bool FindHistogramSplit(const arma::Mat<size_t>& histogram,
+                          const math::QuantileBins& quantizer,
+                          const size_t totalPoints,
+                          size_t& splitDim,
+                          double& splitValue,
+                          double& leftError,
+                          double& rightError,
+                          const size_t minLeafSize) const;
+
+  /**
+   * Choose the best of the splits found in each dimension, in order of
+   * dimension; returns false if none is better than not splitting.
+   */
+  bool ChooseSplit(const std::vector<char>& dimSplitFound,
+                   const std::vector<double>& dimErrors,
+                   const std::vector<double>& dimLeftErrors,
+                   const std::vector<double>& dimRightErrors,
+                   const std::vector<double>& dimSplitValues,
+                   const size_t totalPoints,
+                   size_t& splitDim,
+                   double& splitValue,
+                   double& leftError,
+                   double& rightError) const;
+
+  //! Compute the ratio and the log volume of this node, before it is grown.
+  void StartNode(const size_t totalPoints);
+
+  /**
+   * Compute the statistics of the subtree of this node, once its children (if
+   * any) are grown, and return the smallest g_k(t) of the subtree.
+   */
+  double FinishNode(const size_t totalPoints,
+                    const bool useVolReg,
+                    const double leftG,
+                    const double rightG);
+
+  /**
+   * After this node was split, reorder the sorted values of each dimension so
+   * that the points of the left child come first, keeping both halves sorted.
+   */
+  void PartitionSorted(arma::mat& sortedValues,
+                       arma::Mat<size_t>& sortedIds,
+                       const std::vector<char>& goesLeft,
+                       const size_t offset,
+                       const size_t leftPoints) const;
+
 };
 
 }; // namespace det
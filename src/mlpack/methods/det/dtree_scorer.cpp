@@ -0,0 +1,164 @@
+/**
+ * @file dtree_scorer.cpp
+ *
+ * Implementation of the DTreeScorer class.
+ */
+#include "dtree_scorer.hpp"
+
+#include <queue>
+
+using namespace mlpack;
+using namespace det;
+
+DTreeScorer::DTreeScorer(const DTree& tree) :
+    minVals(tree.MinVals()),
+    maxVals(tree.MaxVals())
+{
+  // A tree with n leaves has 2n - 1 nodes.
+  nodes.reserve(2 * tree.SubtreeLeaves() - 1);
+  Log::Assert(2 * tree.SubtreeLeaves() - 1 <=
+      (size_t) std::numeric_limits<uint32_t>::max());
+
+  // Number the nodes in breadth-first order, so that the children of each node
+  // are adjacent, and the top levels of the tree (visited by every query) are
+  // together at the start of the array.
+  std::queue<std::pair<const DTree*, size_t> > pending;
+  nodes.push_back(Node());
+  pending.push(std::make_pair(&tree, 0));
+
+  while (!pending.empty())
+  {
+    const DTree* node = pending.front().first;
+    const size_t index = pending.front().second;
+    pending.pop();
+
+    if (node->SubtreeLeaves() == 1) // If this is a leaf...
+    {
+      nodes[index].dim = node->BucketTag();
+      nodes[index].child = 0;
+      nodes[index].value = std::exp(std::log(node->Ratio()) -
+          node->LogVolume());
+    }
+    else
+    {
+      const size_t child = nodes.size();
+      nodes[index].dim = (int32_t) node->SplitDim();
+      nodes[index].child = (uint32_t) child;
+      nodes[index].value = node->SplitValue();
+
+      nodes.push_back(Node());
+      nodes.push_back(Node());
+      pending.push(std::make_pair(node->Left(), child));
+      pending.push(std::make_pair(node->Right(), child + 1));
+    }
+  }
+}
+
+void DTreeScorer::ComputeValues(const arma::mat& queries,
+                                arma::vec& densities) const
+{
+  CheckDimensions(queries);
+
+  // This does not reallocate if the caller's vector already has the right
+  // size.
+  densities.set_size(queries.n_cols);
+
+  const size_t numBlocks = (queries.n_cols + PointBlockSize - 1) /
+      PointBlockSize;
+
+  #pragma omp parallel for schedule(static)
+  for (size_t b = 0; b < numBlocks; ++b)
+  {
+    const size_t begin = b * PointBlockSize;
+    const size_t size = std::min(begin + PointBlockSize,
+        (size_t) queries.n_cols) - begin;
+
+    uint32_t leaves[PointBlockSize];
+    FindLeaves(queries, begin, size, leaves);
+
+    for (size_t i = 0; i < size; ++i)
+    {
+      // As in DTree::ComputeValue(), points outside of the bounding box of the
+      // tree have density 0.
+      const double* query = queries.colptr(begin + i);
+      bool withinRange = true;
+      for (size_t d = 0; d < queries.n_rows; ++d)
+      {
+        if ((query[d] < minVals[d]) || (query[d] > maxVals[d]))
+        {
+          withinRange = false;
+          break;
+        }
+      }
+
+      densities[begin + i] = withinRange ? nodes[leaves[i]].value : 0.0;
+    }
+  }
+}
+
+void DTreeScorer::FindBuckets(const arma::mat& queries,
+                              arma::Col<int>& tags) const
+{
+  CheckDimensions(queries);
+
+  tags.set_size(queries.n_cols);
+
+  const size_t numBlocks = (queries.n_cols + PointBlockSize - 1) /
+      PointBlockSize;
+
+  #pragma omp parallel for schedule(static)
+  for (size_t b = 0; b < numBlocks; ++b)
+  {
+    const size_t begin = b * PointBlockSize;
+    const size_t size = std::min(begin + PointBlockSize,
+        (size_t) queries.n_cols) - begin;
+
+    uint32_t leaves[PointBlockSize];
+    FindLeaves(queries, begin, size, leaves);
+
+    for (size_t i = 0; i < size; ++i)
+      tags[begin + i] = nodes[leaves[i]].dim;
+  }
+}
+
+void DTreeScorer::FindLeaves(const arma::mat& queries,
+                             const size_t begin,
+                             const size_t size,
+                             uint32_t* leaves) const
+{
+  for (size_t i = 0; i < size; ++i)
+    leaves[i] = 0;
+
+  // Move every point of the block down one level per pass, until all of them
+  // have reached a leaf.  The next node of each point is prefetched, so that
+  // its load overlaps with the work on the other points of the block.
+  bool descending = true;
+  while (descending)
+  {
+    descending = false;
+    for (size_t i = 0; i < size; ++i)
+    {
+      const Node& node = nodes[leaves[i]];
+      if (node.child == 0)
+        continue;
+
+      const uint32_t next = node.child +
+          ((queries.at(node.dim, begin + i) <= node.value) ? 0 : 1);
+#ifdef __GNUC__
+      __builtin_prefetch(&nodes[next]);
+#endif
+      leaves[i] = next;
+      descending = true;
+    }
+  }
+}
+
+void DTreeScorer::CheckDimensions(const arma::mat& queries) const
+{
+  if (queries.n_rows != maxVals.n_elem)
+  {
+    Log::Fatal << "DTreeScorer: points have " << queries.n_rows
+        << " dimensions, but the tree has " << maxVals.n_elem << "!"
+        << std::endl;
+  }
+}
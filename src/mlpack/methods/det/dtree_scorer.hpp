@@ -0,0 +1,123 @@
+/**
+ * @file dtree_scorer.hpp
+ *
+ * The DTreeScorer class, a compiled copy of a density estimation tree for fast
+ * density queries on batches of points.
+ */
+#ifndef __MLPACK_METHODS_DET_DTREE_SCORER_HPP
+#define __MLPACK_METHODS_DET_DTREE_SCORER_HPP
+
+#include <mlpack/core.hpp>
+#include "dtree.hpp"
+
+namespace mlpack {
+namespace det {
+
+/**
+ * A throughput-oriented copy of a trained density estimation tree (see DTree).
+ * At construction, the tree is flattened into one contiguous array of nodes in
+ * breadth-first order, where the two children of a node are adjacent; each
+ * node holds only what a query needs (the split dimension and value, and the
+ * index of the left child, or the density and the tag of a leaf).  A query
+ * then walks the array without following pointers through the heap.
+ *
+ * The points are processed in blocks, in parallel (with OpenMP).  Inside a
+ * block, the points descend the tree together, one level at a time, so the
+ * memory accesses for the nodes of different points overlap instead of being
+ * serialized.
+ *
+ * The scorer does not depend on the tree after construction; if the tree is
+ * pruned or grown again, a new scorer must be created.
+ *
+ * @code
+ * DTree tree(trainingData);
+ * arma::Col<size_t> oldFromNew;
+ * tree.Grow(trainingData, oldFromNew, false, 10, 5);
+ * DTreeScorer scorer(tree);
+ *
+ * arma::mat batch; // Points to estimate the density of, one per column.
+ * arma::vec densities(batch.n_cols);
+ * scorer.ComputeValues(batch, densities);
+ * @endcode
+ */
+class DTreeScorer
+{
+ public:
+  /**
+   * Compile the given tree.
+   *
+   * @param tree Root of the trained tree.
+   */
+  DTreeScorer(const DTree& tree);
+
+  /**
+   * Compute the density estimate of each of the given points; this gives the
+   * same results as DTree::ComputeValue().  Points outside of the bounding box
+   * of the tree have density 0.
+   *
+   * @param queries Points to estimate the density of, one per column.
+   * @param densities Vector to store the densities in.
+   */
+  void ComputeValues(const arma::mat& queries, arma::vec& densities) const;
+
+  /**
+   * Find the tag of the leaf containing each of the given points; this gives
+   * the same results as DTree::FindBucket(), so the tree should have been
+   * tagged with DTree::TagTree() before the scorer was created.
+   *
+   * @param queries Points to search for, one per column.
+   * @param tags Vector to store the tags in.
+   */
+  void FindBuckets(const arma::mat& queries, arma::Col<int>& tags) const;
+
+  //! Return the number of nodes of the compiled tree.
+  size_t NumNodes() const { return nodes.size(); }
+
+ private:
+  //! The number of points processed together by one thread.
+  static const size_t PointBlockSize = 64;
+
+  /**
+   * A node of the compiled tree, in 16 bytes, so four nodes fit in a cache
+   * line.  For an internal node, the left child is at index child and the
+   * right child at index child + 1.  For a leaf, child is 0 (the root is never
+   * a child), value is the density of the leaf and dim is its tag.
+   */
+  struct Node
+  {
+    //! The split dimension, or the tag of a leaf.
+    int32_t dim;
+    //! The index of the left child, or 0 for a leaf.
+    uint32_t child;
+    //! The split value, or the density of a leaf.
+    double value;
+  };
+
+  /**
+   * Find the leaf containing each point of a block of queries.
+   *
+   * @param queries Points to search for, one per column.
+   * @param begin Index of the first point of the block.
+   * @param size Number of points in the block (at most PointBlockSize).
+   * @param leaves Array to store the index of the leaf of each point in.
+   */
+  void FindLeaves(const arma::mat& queries,
+                  const size_t begin,
+                  const size_t size,
+                  uint32_t* leaves) const;
+
+  //! Check that the points have the dimensionality of the tree.
+  void CheckDimensions(const arma::mat& queries) const;
+
+  //! The nodes of the tree, in breadth-first order.
+  std::vector<Node> nodes;
+  //! The minimum values of the bounding box of the tree.
+  arma::vec minVals;
+  //! The maximum values of the bounding box of the tree.
+  arma::vec maxVals;
+};
+
+}; // namespace det
+}; // namespace mlpack
+
+#endif // __MLPACK_METHODS_DET_DTREE_SCORER_HPP
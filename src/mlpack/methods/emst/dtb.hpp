@@ -122,7 +122,8 @@ class DualTreeBoruvka
  public:
   /**
    * Create the tree from the given dataset.  This copies the dataset to an
-   * internal copy, because tree-building modifies the dataset.
+   * internal copy, because tree-building modifies the dataset; to avoid the
+   * copy, use the constructor which rearranges the dataset in place.
    *
    * @param data Dataset to build a tree for.
    * @param naive Whether the computation should be done in O(n^2) naive mode.
@@ -132,6 +133,35 @@ class DualTreeBoruvka
                   const bool naive = false,
                   const MetricType metric = MetricType());
 
+  /**
+   * Create the tree on the given dataset in place, so that no copy of it is
+   * made.  If the tree type rearranges the dataset during tree-building, the
+   * matrix is rearranged, and the original index of each point is stored in
+   * oldFromNew (which is otherwise left empty).  The edges of the computed
+   * spanning tree still use the original indices.  The matrix must not be
+   * modified or destroyed while this object exists.
+   *
+   * @param dataset Dataset to build a tree for (rearranged in place).
+   * @param oldFromNew Filled with the original index of each rearranged point.
+   * @param metric Instantiated metric.
+   */
+  DualTreeBoruvka(typename TreeType::Mat& dataset,
+                  std::vector<size_t>& oldFromNew,
+                  const MetricType metric = MetricType());
+
+  /**
+   * Create the tree on the given dataset, taking ownership of it, so that it
+   * is not copied; the tree is built on the moved matrix.  The edges of the
+   * computed spanning tree use the original indices.
+   *
+   * @param dataset Dataset to build a tree for (moved into this object).
+   * @param naive Whether the computation should be done in O(n^2) naive mode.
+   * @param metric Instantiated metric.
+   */
+  DualTreeBoruvka(typename TreeType::Mat&& dataset,
+                  const bool naive = false,
+                  const MetricType metric = MetricType());
+
   /**
    * Create the DualTreeBoruvka object with an already initialized tree.  This
    * will not copy the dataset, and can save a little processing power.  Naive
@@ -169,6 +199,22 @@ class DualTreeBoruvka
    */
   void ComputeMST(arma::mat& results);
 
+  /**
+   * Iteratively find the nearest neighbor of each component until the MST is
+   * complete, without copying the edges to a results matrix; the edges are
+   * then given by Edges().  This avoids a second copy of the edge list when
+   * the edges are written out one by one, or given to SingleLinkage.
+   */
+  void ComputeMST();
+
+  /**
+   * Get the edges of the minimum spanning tree, sorted by increasing distance,
+   * after ComputeMST() has been called.  If the tree was built by this object,
+   * the point indices are those of the original dataset; otherwise they are
+   * the indices of points in the given tree.
+   */
+  const std::vector<EdgePair>& Edges() const { return edges; }
+
   /**
    * Returns a string representation of this object.
    */
@@ -186,9 +232,14 @@ class DualTreeBoruvka
   void AddAllEdges();
 
   /**
-   * Unpermute the edge list and output it to results.
+   * Sort the edge list by distance (in parallel, if OpenMP is available).
+   */
+  void SortEdges();
+
+  /**
+   * Sort the edge list and unpermute it.
    */
-  void EmitResults(arma::mat& results);
+  void EmitResults();
 
   /**
    * This function resets the values in the nodes of the tree nearest neighbor
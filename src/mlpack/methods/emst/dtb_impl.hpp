@@ -7,6 +7,8 @@
 #ifndef __MLPACK_METHODS_EMST_DTB_IMPL_HPP
 #define __MLPACK_METHODS_EMST_DTB_IMPL_HPP
 
+#include <mlpack/core/tree/gather_subtrees.hpp>
+
 #include "dtb_rules.hpp"
 
 namespace mlpack {
@@ -74,6 +76,70 @@ DualTreeBoruvka<MetricType, TreeType>::DualTreeBoruvka(
   neighborsDistances.fill(DBL_MAX);
 } // Constructor
 
+/**
+ * Builds the tree on the given data set in place, and initializes all of the
+ * member variables.
+ */
+template<typename MetricType, typename TreeType>
+DualTreeBoruvka<MetricType, TreeType>::DualTreeBoruvka(
+    typename TreeType::Mat& dataset,
+    std::vector<size_t>& oldFromNewOut,
+    const MetricType metric) :
+    data(dataset),
+    ownTree(true),
+    naive(false),
+    connections(dataset.n_cols),
+    totalDist(0.0),
+    metric(metric)
+{
+  Timer::Start("emst/tree_building");
+  tree = BuildTree<TreeType>(dataset, oldFromNew);
+  Timer::Stop("emst/tree_building");
+
+  // The mapping is kept to map the edges back to the original indices.
+  oldFromNewOut = oldFromNew;
+
+  edges.reserve(data.n_cols - 1); // Set size.
+
+  neighborsInComponent.set_size(data.n_cols);
+  neighborsOutComponent.set_size(data.n_cols);
+  neighborsDistances.set_size(data.n_cols);
+  neighborsDistances.fill(DBL_MAX);
+} // Constructor
+
+/**
+ * Takes ownership of the data set, builds the tree on it, and initializes all
+ * of the member variables.
+ */
+template<typename MetricType, typename TreeType>
+DualTreeBoruvka<MetricType, TreeType>::DualTreeBoruvka(
+    typename TreeType::Mat&& dataset,
+    const bool naive,
+    const MetricType metric) :
+    dataCopy(std::move(dataset)),
+    data(dataCopy),
+    ownTree(!naive),
+    naive(naive),
+    connections(dataCopy.n_cols),
+    totalDist(0.0),
+    metric(metric)
+{
+  Timer::Start("emst/tree_building");
+
+  // The matrix is our own, so the tree is built on it in place.
+  if (!naive)
+    tree = BuildTree<TreeType>(dataCopy, oldFromNew);
+
+  Timer::Stop("emst/tree_building");
+
+  edges.reserve(data.n_cols - 1); // Set size.
+
+  neighborsInComponent.set_size(data.n_cols);
+  neighborsOutComponent.set_size(data.n_cols);
+  neighborsDistances.set_size(data.n_cols);
+  neighborsDistances.fill(DBL_MAX);
+} // Constructor
+
 template<typename MetricType, typename TreeType>
 DualTreeBoruvka<MetricType, TreeType>::DualTreeBoruvka(
     TreeType* tree,
@@ -107,29 +173,74 @@ DualTreeBoruvka<MetricType, TreeType>::~DualTreeBoruvka()
  * complete.
  */
 template<typename MetricType, typename TreeType>
-void DualTreeBoruvka<MetricType, TreeType>::ComputeMST(arma::mat& results)
+void DualTreeBoruvka<MetricType, TreeType>::ComputeMST()
 {
   Timer::Start("emst/mst_computation");
 
   totalDist = 0; // Reset distance.
 
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  // The query tree is split into disjoint subtrees, which are traversed in
+  // parallel; we ask for a few more subtrees than threads so that the load is
+  // balanced when some subtrees are much more expensive than others.
+  std::vector<TreeType*> querySubtrees;
+  if (!naive)
+    tree::GatherQuerySubtrees(*tree, 4 * threads, querySubtrees);
+
   typedef DTBRules<MetricType, TreeType> RuleType;
-  RuleType rules(data, connections, neighborsDistances, neighborsInComponent,
-                 neighborsOutComponent, metric);
+  size_t baseCases = 0;
+  size_t scores = 0;
   while (edges.size() < (data.n_cols - 1))
   {
+    // Each traversal gets its own rules object.  During the traversals the
+    // components do not change (the rules use the const UnionFind::Find()),
+    // and a better candidate neighbor of a component is stored in a critical
+    // section (see DTBRules::BaseCase()).
+    size_t roundBaseCases = 0;
+    size_t roundScores = 0;
     if (naive)
     {
       // Full O(N^2) traversal.
-      for (size_t i = 0; i < data.n_cols; ++i)
-        for (size_t j = 0; j < data.n_cols; ++j)
-          rules.BaseCase(i, j);
+      #pragma omp parallel num_threads(threads) \
+          reduction(+:roundBaseCases, roundScores)
+      {
+        MetricType threadMetric(metric);
+        RuleType rules(data, connections, neighborsDistances,
+            neighborsInComponent, neighborsOutComponent, threadMetric);
+
+        #pragma omp for schedule(dynamic, 64)
+        for (size_t i = 0; i < data.n_cols; ++i)
+          for (size_t j = 0; j < data.n_cols; ++j)
+            rules.BaseCase(i, j);
+
+        roundBaseCases += rules.BaseCases();
+        roundScores += rules.Scores();
+      }
     }
     else
     {
-      typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
-      traverser.Traverse(*tree, *tree);
+      #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+          reduction(+:roundBaseCases, roundScores)
+      for (size_t i = 0; i < querySubtrees.size(); ++i)
+      {
+        MetricType threadMetric(metric);
+        RuleType rules(data, connections, neighborsDistances,
+            neighborsInComponent, neighborsOutComponent, threadMetric);
+        typename TreeType::template DualTreeTraverser<RuleType>
+            traverser(rules);
+        traverser.Traverse(*querySubtrees[i], *tree);
+
+        roundBaseCases += rules.BaseCases();
+        roundScores += rules.Scores();
+      }
     }
+    baseCases += roundBaseCases;
+    scores += roundScores;
 
     AddAllEdges();
 
@@ -138,19 +249,33 @@ void DualTreeBoruvka<MetricType, TreeType>::ComputeMST(arma::mat& results)
     Log::Info << edges.size() << " edges found so far." << std::endl;
     if (!naive)
     {
-      Log::Info << rules.BaseCases() << " cumulative base cases." << std::endl;
-      Log::Info << rules.Scores() << " cumulative node combinations scored."
+      Log::Info << baseCases << " cumulative base cases." << std::endl;
+      Log::Info << scores << " cumulative node combinations scored."
           << std::endl;
     }
   }
 
   Timer::Stop("emst/mst_computation");
 
-  EmitResults(results);
+  EmitResults();
 
   Log::Info << "Total spanning tree length: " << totalDist << std::endl;
 }
 
+template<typename MetricType, typename TreeType>
+void DualTreeBoruvka<MetricType, TreeType>::ComputeMST(arma::mat& results)
+{
+  ComputeMST();
+
+  results.set_size(3, edges.size());
+  for (size_t i = 0; i < edges.size(); i++)
+  {
+    results(0, i) = edges[i].Lesser();
+    results(1, i) = edges[i].Greater();
+    results(2, i) = edges[i].Distance();
+  }
+}
+
 /**
  * Adds a single edge to the edge list
  */
@@ -191,21 +316,20 @@ void DualTreeBoruvka<MetricType, TreeType>::AddAllEdges()
 } // AddAllEdges
 
 /**
- * Unpermute the edge list (if necessary) and output it to results.
+ * Sort the edge list and unpermute it (if necessary).
  */
 template<typename MetricType, typename TreeType>
-void DualTreeBoruvka<MetricType, TreeType>::EmitResults(arma::mat& results)
+void DualTreeBoruvka<MetricType, TreeType>::EmitResults()
 {
   // Sort the edges.
-  std::sort(edges.begin(), edges.end(), SortFun);
+  SortEdges();
 
   Log::Assert(edges.size() == data.n_cols - 1);
-  results.set_size(3, edges.size());
 
   // Need to unpermute the point labels.
   if (!naive && ownTree && tree::TreeTraits<TreeType>::RearrangesDataset)
   {
-    for (size_t i = 0; i < (data.n_cols - 1); i++)
+    for (size_t i = 0; i < edges.size(); i++)
     {
       // Make sure the edge list stores the smaller index first to
       // make checking correctness easier
@@ -222,19 +346,6 @@ void DualTreeBoruvka<MetricType, TreeType>::EmitResults(arma::mat& results)
         edges[i].Lesser() = ind2;
         edges[i].Greater() = ind1;
       }
-
-      results(0, i) = edges[i].Lesser();
-      results(1, i) = edges[i].Greater();
-      results(2, i) = edges[i].Distance();
-    }
-  }
-  else
-  {
-    for (size_t i = 0; i < edges.size(); i++)
-    {
-      results(0, i) = edges[i].Lesser();
-      results(1, i) = edges[i].Greater();
-      results(2, i) = edges[i].Distance();
     }
   }
 } // EmitResults
@@ -281,13 +392,62 @@ void DualTreeBoruvka<MetricType, TreeType>::CleanupHelper(TreeType* tree)
 template<typename MetricType, typename TreeType>
 void DualTreeBoruvka<MetricType, TreeType>::Cleanup()
 {
+  // Compress the path of every point to its component, so that the const
+  // UnionFind::Find() used during the next traversals is fast.
   for (size_t i = 0; i < data.n_cols; i++)
+  {
     neighborsDistances[i] = DBL_MAX;
+    connections.Find(i);
+  }
 
   if (!naive)
     CleanupHelper(tree);
 }
 
+/**
+ * Sort the edges by distance.  With OpenMP, one run of edges per thread is
+ * sorted in parallel, then neighboring runs are merged in parallel, pairwise,
+ * until one run is left.
+ */
+template<typename MetricType, typename TreeType>
+void DualTreeBoruvka<MetricType, TreeType>::SortEdges()
+{
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  // Small edge lists are not worth splitting.
+  const size_t runs = std::min(threads, edges.size() / 10000 + 1);
+  if (runs <= 1)
+  {
+    std::sort(edges.begin(), edges.end(), SortFun);
+    return;
+  }
+
+  std::vector<size_t> bounds(runs + 1);
+  for (size_t i = 0; i <= runs; ++i)
+    bounds[i] = (i * edges.size()) / runs;
+
+  #pragma omp parallel for schedule(static) num_threads(threads)
+  for (size_t i = 0; i < runs; ++i)
+    std::sort(edges.begin() + bounds[i], edges.begin() + bounds[i + 1],
+        SortFun);
+
+  for (size_t width = 1; width < runs; width *= 2)
+  {
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (size_t i = 0; i < runs; i += 2 * width)
+    {
+      if (i + width < runs)
+        std::inplace_merge(edges.begin() + bounds[i],
+            edges.begin() + bounds[i + width],
+            edges.begin() + bounds[std::min(i + 2 * width, runs)], SortFun);
+    }
+  }
+}
+
 // convert the object to a string
 template<typename MetricType, typename TreeType>
 std::string DualTreeBoruvka<MetricType, TreeType>::ToString() const
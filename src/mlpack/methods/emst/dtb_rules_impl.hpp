@@ -13,7 +13,7 @@ namespace emst {
 template<typename MetricType, typename TreeType>
 DTBRules<MetricType, TreeType>::
 DTBRules(const arma::mat& dataSet,
-         UnionFind& connections,
+         const UnionFind& connections,
          arma::vec& neighborsDistances,
          arma::Col<size_t>& neighborsInComponent,
          arma::Col<size_t>& neighborsOutComponent,
@@ -52,13 +52,22 @@ double DTBRules<MetricType, TreeType>::BaseCase(const size_t queryIndex,
     double distance = metric.Evaluate(dataSet.col(queryIndex),
                                       dataSet.col(referenceIndex));
 
+    // When the query tree is traversed in parallel, the points of a
+    // component may be handled by several threads, so the candidate is
+    // checked again and replaced in a critical section.
     if (distance < neighborsDistances[queryComponentIndex])
     {
-      Log::Assert(queryIndex != referenceIndex);
-
-      neighborsDistances[queryComponentIndex] = distance;
-      neighborsInComponent[queryComponentIndex] = queryIndex;
-      neighborsOutComponent[queryComponentIndex] = referenceIndex;
+      #pragma omp critical(dtb_update_neighbor)
+      {
+        if (distance < neighborsDistances[queryComponentIndex])
+        {
+          Log::Assert(queryIndex != referenceIndex);
+
+          neighborsDistances[queryComponentIndex] = distance;
+          neighborsInComponent[queryComponentIndex] = queryIndex;
+          neighborsOutComponent[queryComponentIndex] = referenceIndex;
+        }
+      }
     }
   }
 
@@ -21,6 +21,7 @@
  */
 
 #include "dtb.hpp"
+#include "single_linkage.hpp"
 
 #include <mlpack/core.hpp>
 
@@ -31,7 +32,18 @@ PROGRAM_INFO("Fast Euclidean Minimum Spanning Tree", "This program can compute "
     "The output is saved in a three-column matrix, where each row indicates an "
     "edge.  The first column corresponds to the lesser index of the edge; the "
     "second column corresponds to the greater index of the edge; and the third "
-    "column corresponds to the distance between the two points.");
+    "column corresponds to the distance between the two points.  The edges are "
+    "sorted by increasing distance, and written out one at a time."
+    "\n\n"
+    "The edges also give the single-linkage hierarchical clustering of the "
+    "points.  If --dendrogram_file is specified, the dendrogram is saved to it "
+    "as a four-column matrix where each row is one merge, in order: the indices"
+    " of the two merged clusters, the distance at which they merge, and the "
+    "number of points of the new cluster.  Indices less than the number of "
+    "points are single points; the cluster created by the merge in row i has "
+    "index (number of points + i).  If --clusters or --cut_height is "
+    "specified, the dendrogram is cut into that many clusters, or at that "
+    "height, and the cluster of each point is saved to --labels_file.");
 
 PARAM_STRING_REQ("input_file", "Data input file.", "i");
 PARAM_STRING("output_file", "Data output file.  Stored as an edge list.", "o",
@@ -40,12 +52,88 @@ PARAM_FLAG("naive", "Compute the MST using O(n^2) naive algorithm.", "n");
 PARAM_INT("leaf_size", "Leaf size in the kd-tree.  One-element leaves give the "
     "empirically best performance, but at the cost of greater memory "
     "requirements.", "l", 1);
+PARAM_STRING("dendrogram_file", "If specified, the single-linkage dendrogram "
+    "will be saved to this file.", "d", "");
+PARAM_INT("clusters", "If nonzero, cut the single-linkage dendrogram into this "
+    "many clusters.", "k", 0);
+PARAM_DOUBLE("cut_height", "If specified, cut the single-linkage dendrogram at "
+    "this height (distance).", "c", -1.0);
+PARAM_STRING("labels_file", "File to save the cluster of each point to, when "
+    "the dendrogram is cut.", "L", "labels.csv");
 
 using namespace mlpack;
 using namespace mlpack::emst;
 using namespace mlpack::tree;
 using namespace std;
 
+/**
+ * Write the (sorted) edges and, if requested, the single-linkage dendrogram
+ * and flat clustering.
+ */
+void SaveResults(const vector<EdgePair>& edges, const size_t points)
+{
+  // Write the edges directly, so that no results matrix is needed.
+  const string outputFilename = CLI::GetParam<string>("output_file");
+  ofstream output(outputFilename.c_str());
+  if (!output.is_open())
+    Log::Fatal << "Could not open '" << outputFilename << "' for writing."
+        << endl;
+
+  Timer::Start("saving_data");
+  output.precision(16);
+  for (size_t i = 0; i < edges.size(); ++i)
+  {
+    output << edges[i].Lesser() << "," << edges[i].Greater() << ","
+        << edges[i].Distance() << "\n";
+  }
+  output.close();
+  Timer::Stop("saving_data");
+
+  const bool cutClusters = (CLI::GetParam<int>("clusters") != 0);
+  const bool cutHeight = CLI::HasParam("cut_height");
+  if (cutClusters && cutHeight)
+    Log::Fatal << "Only one of --clusters and --cut_height may be specified!"
+        << endl;
+  if (!CLI::HasParam("dendrogram_file") && !cutClusters && !cutHeight)
+    return;
+
+  SingleLinkage linkage(edges, points);
+
+  if (CLI::HasParam("dendrogram_file"))
+  {
+    arma::mat merges;
+    linkage.Dendrogram(merges);
+    data::Save(CLI::GetParam<string>("dendrogram_file"), merges, true);
+  }
+
+  arma::Col<size_t> assignments;
+  if (cutClusters)
+  {
+    const int clusters = CLI::GetParam<int>("clusters");
+    if (clusters < 1 || (size_t) clusters > points)
+      Log::Fatal << "Invalid number of clusters (" << clusters << ")!  Must "
+          << "be between 1 and the number of points (" << points << ")."
+          << endl;
+
+    linkage.Cluster((size_t) clusters, assignments);
+  }
+  else if (cutHeight)
+  {
+    const size_t clusters = linkage.Cluster(
+        CLI::GetParam<double>("cut_height"), assignments);
+    Log::Info << "Cutting the dendrogram at height "
+        << CLI::GetParam<double>("cut_height") << " gives " << clusters
+        << " clusters." << endl;
+  }
+  else
+  {
+    return;
+  }
+
+  arma::Mat<size_t> labels = trans(assignments);
+  data::Save(CLI::GetParam<string>("labels_file"), labels);
+}
+
 int main(int argc, char* argv[])
 {
   CLI::ParseCommandLine(argc, argv);
@@ -61,13 +149,9 @@ int main(int argc, char* argv[])
     Log::Info << "Running naive algorithm." << endl;
 
     DualTreeBoruvka<> naive(dataPoints, true);
+    naive.ComputeMST();
 
-    arma::mat naiveResults;
-    naive.ComputeMST(naiveResults);
-
-    const string outputFilename = CLI::GetParam<string>("output_file");
-
-    data::Save(outputFilename, naiveResults, true);
+    SaveResults(naive.Edges(), dataPoints.n_cols);
   }
   else
   {
@@ -95,33 +179,21 @@ int main(int argc, char* argv[])
 
     // Run the DTB algorithm.
     Log::Info << "Calculating minimum spanning tree." << endl;
-    arma::mat results;
-    dtb.ComputeMST(results);
+    dtb.ComputeMST();
 
-    // Unmap the results.
-    arma::mat unmappedResults(results.n_rows, results.n_cols);
-    for (size_t i = 0; i < results.n_cols; ++i)
+    // Unmap the edges; this does not change their order.
+    const vector<EdgePair>& edges = dtb.Edges();
+    vector<EdgePair> unmappedEdges;
+    unmappedEdges.reserve(edges.size());
+    for (size_t i = 0; i < edges.size(); ++i)
     {
-      const size_t indexA = oldFromNew[size_t(results(0, i))];
-      const size_t indexB = oldFromNew[size_t(results(1, i))];
-
-      if (indexA < indexB)
-      {
-        unmappedResults(0, i) = indexA;
-        unmappedResults(1, i) = indexB;
-      }
-      else
-      {
-        unmappedResults(0, i) = indexB;
-        unmappedResults(1, i) = indexA;
-      }
-
-      unmappedResults(2, i) = results(2, i);
-    }
+      const size_t indexA = oldFromNew[edges[i].Lesser()];
+      const size_t indexB = oldFromNew[edges[i].Greater()];
 
-    // Output the results.
-    const string outputFilename = CLI::GetParam<string>("output_file");
+      unmappedEdges.push_back(EdgePair(std::min(indexA, indexB),
+          std::max(indexA, indexB), edges[i].Distance()));
+    }
 
-    data::Save(outputFilename, unmappedResults, true);
+    SaveResults(unmappedEdges, dataPoints.n_cols);
   }
 }
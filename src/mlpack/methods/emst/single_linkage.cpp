@@ -0,0 +1,101 @@
+/**
+ * @file single_linkage.cpp
+ *
+ * Implementation of single-linkage hierarchical clustering from the edges of
+ * a minimum spanning tree.
+ */
+#include "single_linkage.hpp"
+
+using namespace mlpack;
+using namespace mlpack::emst;
+
+SingleLinkage::SingleLinkage(const std::vector<EdgePair>& edges,
+                             const size_t points) :
+    edges(edges),
+    points(points)
+{
+  if (points > 0 && edges.size() != points - 1)
+    Log::Fatal << "SingleLinkage::SingleLinkage(): " << edges.size() << " "
+        << "edges given, but a spanning tree of " << points << " points has "
+        << (points - 1) << " edges!" << std::endl;
+}
+
+void SingleLinkage::Dendrogram(arma::mat& merges) const
+{
+  merges.set_size(4, edges.size());
+
+  // The cluster index and the size of the cluster of each component.
+  UnionFind connections(points);
+  arma::Col<size_t> clusterIndex(points);
+  arma::Col<size_t> clusterSize(points);
+  for (size_t i = 0; i < points; ++i)
+  {
+    clusterIndex[i] = i;
+    clusterSize[i] = 1;
+  }
+
+  for (size_t i = 0; i < edges.size(); ++i)
+  {
+    const size_t lesserRoot = connections.Find(edges[i].Lesser());
+    const size_t greaterRoot = connections.Find(edges[i].Greater());
+
+    const size_t a = clusterIndex[lesserRoot];
+    const size_t b = clusterIndex[greaterRoot];
+    const size_t size = clusterSize[lesserRoot] + clusterSize[greaterRoot];
+
+    merges(0, i) = std::min(a, b);
+    merges(1, i) = std::max(a, b);
+    merges(2, i) = edges[i].Distance();
+    merges(3, i) = size;
+
+    connections.Union(lesserRoot, greaterRoot);
+    const size_t root = connections.Find(lesserRoot);
+    clusterIndex[root] = points + i;
+    clusterSize[root] = size;
+  }
+}
+
+void SingleLinkage::Cluster(const size_t clusters,
+                            arma::Col<size_t>& assignments) const
+{
+  if (clusters == 0 || clusters > points)
+    Log::Fatal << "SingleLinkage::Cluster(): number of clusters (" << clusters
+        << ") must be between 1 and the number of points (" << points << ")!"
+        << std::endl;
+
+  Components(points - clusters, assignments);
+}
+
+size_t SingleLinkage::Cluster(const double height,
+                              arma::Col<size_t>& assignments) const
+{
+  // The edges are sorted, so the edges to merge are a prefix.
+  size_t merges = 0;
+  while (merges < edges.size() && edges[merges].Distance() <= height)
+    ++merges;
+
+  return Components(merges, assignments);
+}
+
+size_t SingleLinkage::Components(const size_t merges,
+                                 arma::Col<size_t>& assignments) const
+{
+  UnionFind connections(points);
+  for (size_t i = 0; i < merges; ++i)
+    connections.Union(edges[i].Lesser(), edges[i].Greater());
+
+  // Number the components in the order of their first point.
+  arma::Col<size_t> componentIndex(points);
+  componentIndex.fill(size_t(-1));
+  assignments.set_size(points);
+  size_t components = 0;
+  for (size_t i = 0; i < points; ++i)
+  {
+    const size_t root = connections.Find(i);
+    if (componentIndex[root] == size_t(-1))
+      componentIndex[root] = components++;
+    assignments[i] = componentIndex[root];
+  }
+
+  return components;
+}
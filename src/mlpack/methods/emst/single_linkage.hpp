@@ -0,0 +1,99 @@
+/**
+ * @file single_linkage.hpp
+ *
+ * Single-linkage hierarchical clustering from the edges of a minimum spanning
+ * tree.
+ */
+#ifndef __MLPACK_METHODS_EMST_SINGLE_LINKAGE_HPP
+#define __MLPACK_METHODS_EMST_SINGLE_LINKAGE_HPP
+
+#include <mlpack/core.hpp>
+
+#include "edge_pair.hpp"
+#include "union_find.hpp"
+
+namespace mlpack {
+namespace emst {
+
+/**
+ * The single-linkage hierarchical clustering of a set of points is given by
+ * the edges of their minimum spanning tree, in order of increasing distance:
+ * each edge merges the two clusters holding its points.  This class gives the
+ * dendrogram and flat clusterings from the sorted edge list computed by
+ * DualTreeBoruvka, without computing any distance again.
+ *
+ * @code
+ * DualTreeBoruvka<> dtb(dataset);
+ * dtb.ComputeMST();
+ *
+ * SingleLinkage linkage(dtb.Edges(), dataset.n_cols);
+ * arma::mat merges;
+ * linkage.Dendrogram(merges);
+ *
+ * arma::Col<size_t> assignments;
+ * linkage.Cluster(5, assignments); // Five clusters.
+ * @endcode
+ */
+class SingleLinkage
+{
+ public:
+  /**
+   * Create the SingleLinkage object from the edges of a minimum spanning tree,
+   * sorted by increasing distance (as given by DualTreeBoruvka::Edges()).  The
+   * edges are not copied, so they must outlive this object.
+   *
+   * @param edges Edges of the minimum spanning tree, sorted by distance.
+   * @param points Number of points.
+   */
+  SingleLinkage(const std::vector<EdgePair>& edges, const size_t points);
+
+  /**
+   * Compute the dendrogram.  Each column of the output is one merge, in
+   * order: the first two rows are the (lesser and greater) indices of the
+   * merged clusters, the third row is the distance at which they merge, and
+   * the fourth row is the number of points of the new cluster.  The clusters
+   * with indices less than the number of points are single points; the
+   * cluster created by merge i has index (number of points + i).  (This is
+   * the "linkage matrix" format used by other tools, transposed.)
+   *
+   * @param merges Matrix to store the merges in.
+   */
+  void Dendrogram(arma::mat& merges) const;
+
+  /**
+   * Cut the dendrogram to get the given number of clusters.  The clusters are
+   * numbered in the order of their first point.
+   *
+   * @param clusters Number of clusters.
+   * @param assignments Vector to store the cluster of each point in.
+   */
+  void Cluster(const size_t clusters, arma::Col<size_t>& assignments) const;
+
+  /**
+   * Cut the dendrogram at the given height: points are in the same cluster if
+   * they are connected by edges no longer than the height.  The clusters are
+   * numbered in the order of their first point.
+   *
+   * @param height Height of the cut.
+   * @param assignments Vector to store the cluster of each point in.
+   * @return Number of clusters.
+   */
+  size_t Cluster(const double height, arma::Col<size_t>& assignments) const;
+
+ private:
+  /**
+   * Merge the given number of first edges, and number the resulting
+   * components; return the number of components.
+   */
+  size_t Components(const size_t merges, arma::Col<size_t>& assignments) const;
+
+  //! The edges of the minimum spanning tree, sorted by increasing distance.
+  const std::vector<EdgePair>& edges;
+  //! The number of points.
+  size_t points;
+};
+
+}; // namespace emst
+}; // namespace mlpack
+
+#endif
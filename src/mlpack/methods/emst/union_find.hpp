@@ -62,6 +62,22 @@ class UnionFind
     }
   }
 
+  /**
+   * Returns the component containing an element, without compressing the
+   * path to it, so that it can be called from several threads at once (as
+   * long as no Union() happens at the same time).  Calling the non-const
+   * Find() on every element first makes this fast.
+   *
+   * @param x the component to be found
+   * @return The index of the component containing x
+   */
+  size_t Find(size_t x) const
+  {
+    while (parent[x] != x)
+      x = parent[x];
+    return x;
+  }
+
   /**
    * Union the components containing x and y.
    *
@@ -42,6 +42,14 @@ namespace fastmks /** Fast max-kernel search. */ {
  * on points in the dataset (and not centroids of regions or anything like
  * that).
  *
+ * The search can be made approximate, which is much faster for kernels where
+ * the exact search cannot prune much (like the linear kernel on
+ * high-dimensional data): with Epsilon() set greater than 0, each result kernel
+ * is within a relative error of about epsilon of the true k'th maximum kernel,
+ * and with MaxBaseCases() set greater than 0, single-tree search stops after
+ * that many kernel evaluations for each query point.  Naive search is always
+ * exact.
+ *
  * @tparam KernelType Type of kernel to run FastMKS with.
  * @tparam TreeType Type of tree to run FastMKS with; it must have metric
  *     IPMetric<KernelType>.
@@ -166,6 +174,10 @@ class FastMKS
    * product to point 4 in the query set will be stored in row 0 and column 4 of
    * the indices matrix.
    *
+   * If CacheSize() is not 0, the kernel evaluations of the tree searches are
+   * kept in a KernelCache, so that later searches (for instance, with another
+   * k or epsilon) can reuse them.
+   *
    * @param k The number of maximum kernels to find.
    * @param indices Matrix to store resulting indices of max-kernel search in.
    * @param products Matrix to store resulting max-kernel values in.
@@ -174,6 +186,50 @@ class FastMKS
               arma::Mat<size_t>& indices,
               arma::mat& products);
 
+  /**
+   * Search for the maximum kernels of the given batch of query points in the
+   * reference set, reusing the reference tree and the reference self-kernels
+   * that were computed when this object was constructed; this is meant for
+   * many (possibly small) batches of queries against the same reference set.
+   * The query set given to the constructor (if any) is not used.  The queries
+   * of the batch are searched in parallel, if OpenMP is available: with
+   * single-tree search, each thread traverses its own copy of the reference
+   * tree (the copies are kept for the next batches); with dual-tree search,
+   * the batch is split into one part per thread, and a query tree is built on
+   * each part.  The kernel cache is not used, since the batches differ.
+   *
+   * @param querySet Batch of query points.
+   * @param k The number of maximum kernels to find.
+   * @param indices Matrix to store resulting indices of max-kernel search in.
+   * @param products Matrix to store resulting max-kernel values in.
+   */
+  void Search(const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& indices,
+              arma::mat& products);
+
+  //! Get the relative error allowed in the results (0 for exact search).
+  double Epsilon() const { return epsilon; }
+  //! Modify the relative error allowed in the results (0 for exact search).
+  double& Epsilon() { return epsilon; }
+
+  //! Get the maximum number of base cases for each query point in single-tree
+  //! search (0 for no limit).
+  size_t MaxBaseCases() const { return maxBaseCases; }
+  //! Modify the maximum number of base cases for each query point in
+  //! single-tree search (0 for no limit).
+  size_t& MaxBaseCases() { return maxBaseCases; }
+
+  //! Get the maximum number of kernel evaluations kept between searches of
+  //! the query set given to the constructor (0 for no cache).
+  size_t CacheSize() const { return cacheSize; }
+  //! Modify the maximum number of kernel evaluations kept between searches of
+  //! the query set given to the constructor (0 for no cache).
+  size_t& CacheSize() { return cacheSize; }
+
+  //! Get the self-kernels of the reference points (sqrt(K(r, r)) for each r).
+  const arma::vec& ReferenceKernels() const { return referenceKernels; }
+
   //! Get the inner-product metric induced by the given kernel.
   const metric::IPMetric<KernelType>& Metric() const { return metric; }
   //! Modify the inner-product metric induced by the given kernel.
@@ -204,9 +260,33 @@ class FastMKS
   //! If true, naive (brute-force) search is used.
   bool naive;
 
+  //! The relative error allowed in the results.
+  double epsilon;
+  //! The maximum number of base cases for each query point in single-tree
+  //! search (0 for no limit).
+  size_t maxBaseCases;
+  //! The maximum number of kernel evaluations to cache (0 for no cache).
+  size_t cacheSize;
+  //! The cache of kernel evaluations between the query and reference sets,
+  //! kept between searches (NULL if there is none yet).
+  kernel::KernelCache* cache;
+
   //! The instantiated inner-product metric induced by the given kernel.
   metric::IPMetric<KernelType> metric;
 
+  //! The self-kernels of the reference points, sqrt(K(r, r)) for each r.
+  arma::vec referenceKernels;
+  //! Copies of the reference tree for the threads of a parallel single-tree
+  //! search (the first thread uses the reference tree itself).
+  std::vector<TreeType*> threadTrees;
+
+  //! Create (or resize, or free) the cache so that it holds cacheSize kernel
+  //! evaluations, and return it (NULL if cacheSize is 0).
+  kernel::KernelCache* Cache();
+
+  //! Compute sqrt(K(p, p)) for each point p of the given set, in parallel.
+  void SelfKernels(const arma::mat& set, arma::vec& kernels);
+
   //! Utility function.  Copied too many times from too many places.
   void InsertNeighbor(arma::Mat<size_t>& indices,
                       arma::mat& products,
@@ -29,7 +29,11 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     queryTree(NULL),
     treeOwner(true),
     single(single),
-    naive(naive)
+    naive(naive),
+    epsilon(0.0),
+    maxBaseCases(0),
+    cacheSize(0),
+    cache(NULL)
 {
   Timer::Start("tree_building");
 
@@ -40,6 +44,8 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     queryTree = new TreeType(referenceSet);
 
   Timer::Stop("tree_building");
+
+  SelfKernels(referenceSet, referenceKernels);
 }
 
 // Two datasets, no instantiated kernel.
@@ -54,7 +60,11 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     queryTree(NULL),
     treeOwner(true),
     single(single),
-    naive(naive)
+    naive(naive),
+    epsilon(0.0),
+    maxBaseCases(0),
+    cacheSize(0),
+    cache(NULL)
 {
   Timer::Start("tree_building");
 
@@ -66,6 +76,8 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     queryTree = new TreeType(querySet);
 
   Timer::Stop("tree_building");
+
+  SelfKernels(referenceSet, referenceKernels);
 }
 
 // One dataset, instantiated kernel.
@@ -81,6 +93,10 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     treeOwner(true),
     single(single),
     naive(naive),
+    epsilon(0.0),
+    maxBaseCases(0),
+    cacheSize(0),
+    cache(NULL),
     metric(kernel)
 {
   Timer::Start("tree_building");
@@ -93,6 +109,8 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     queryTree = new TreeType(referenceSet, metric);
 
   Timer::Stop("tree_building");
+
+  SelfKernels(referenceSet, referenceKernels);
 }
 
 // Two datasets, instantiated kernel.
@@ -109,6 +127,10 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     treeOwner(true),
     single(single),
     naive(naive),
+    epsilon(0.0),
+    maxBaseCases(0),
+    cacheSize(0),
+    cache(NULL),
     metric(kernel)
 {
   Timer::Start("tree_building");
@@ -121,6 +143,8 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     queryTree = new TreeType(querySet, metric);
 
   Timer::Stop("tree_building");
+
+  SelfKernels(referenceSet, referenceKernels);
 }
 
 // One dataset, pre-built tree.
@@ -136,11 +160,17 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     treeOwner(false),
     single(single),
     naive(naive),
+    epsilon(0.0),
+    maxBaseCases(0),
+    cacheSize(0),
+    cache(NULL),
     metric(referenceTree->Metric())
 {
   // The query tree cannot be the same as the reference tree.
   if (referenceTree)
     queryTree = new TreeType(*referenceTree);
+
+  SelfKernels(referenceSet, referenceKernels);
 }
 
 // Two datasets, pre-built trees.
@@ -158,9 +188,13 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     treeOwner(false),
     single(single),
     naive(naive),
+    epsilon(0.0),
+    maxBaseCases(0),
+    cacheSize(0),
+    cache(NULL),
     metric(referenceTree->Metric())
 {
-  // Nothing to do.
+  SelfKernels(referenceSet, referenceKernels);
 }
 
 template<typename KernelType, typename TreeType>
@@ -180,6 +214,12 @@ FastMKS<KernelType, TreeType>::~FastMKS()
     if (queryTree)
       delete queryTree;
   }
+
+  for (size_t i = 0; i < threadTrees.size(); ++i)
+    delete threadTrees[i];
+
+  if (cache)
+    delete cache;
 }
 
 template<typename KernelType, typename TreeType>
@@ -227,10 +267,16 @@ void FastMKS<KernelType, TreeType>::Search(const size_t k,
   // Single-tree implementation.
   if (single)
   {
-    // Create rules object (this will store the results).  This constructor
-    // precalculates each self-kernel value.
+    // Create rules object (this will store the results).  The reference
+    // self-kernels were computed by the constructor.
+    arma::vec queryKernels;
+    if (&querySet != &referenceSet)
+      SelfKernels(querySet, queryKernels);
+
     typedef FastMKSRules<KernelType, TreeType> RuleType;
-    RuleType rules(referenceSet, querySet, indices, products, metric.Kernel());
+    RuleType rules(referenceSet, querySet, indices, products, metric.Kernel(),
+        (&querySet == &referenceSet) ? referenceKernels : queryKernels,
+        referenceKernels, epsilon, maxBaseCases, Cache());
 
     typename TreeType::template SingleTreeTraverser<RuleType> traverser(rules);
 
@@ -244,14 +290,23 @@ void FastMKS<KernelType, TreeType>::Search(const size_t k,
 
     Log::Info << rules.BaseCases() << " base cases." << std::endl;
     Log::Info << rules.Scores() << " scores." << std::endl;
+    if (cache)
+      Log::Info << "Kernel cache hit rate: " << 100.0 * cache->HitRate()
+          << "% (" << cache->Size() << " kernels cached)." << std::endl;
 
     Timer::Stop("computing_products");
     return;
   }
 
   // Dual-tree implementation.
+  arma::vec queryKernels;
+  if (&querySet != &referenceSet)
+    SelfKernels(querySet, queryKernels);
+
   typedef FastMKSRules<KernelType, TreeType> RuleType;
-  RuleType rules(referenceSet, querySet, indices, products, metric.Kernel());
+  RuleType rules(referenceSet, querySet, indices, products, metric.Kernel(),
+      (&querySet == &referenceSet) ? referenceKernels : queryKernels,
+      referenceKernels, epsilon, maxBaseCases, Cache());
 
   typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
 
@@ -262,11 +317,182 @@ void FastMKS<KernelType, TreeType>::Search(const size_t k,
   Log::Info << "Pruned " << numPrunes << " nodes." << std::endl;
   Log::Info << rules.BaseCases() << " base cases." << std::endl;
   Log::Info << rules.Scores() << " scores." << std::endl;
+  if (cache)
+    Log::Info << "Kernel cache hit rate: " << 100.0 * cache->HitRate()
+        << "% (" << cache->Size() << " kernels cached)." << std::endl;
 
   Timer::Stop("computing_products");
   return;
 }
 
+template<typename KernelType, typename TreeType>
+void FastMKS<KernelType, TreeType>::Search(const arma::mat& querySet,
+                                           const size_t k,
+                                           arma::Mat<size_t>& indices,
+                                           arma::mat& products)
+{
+  if (querySet.n_rows != referenceSet.n_rows)
+    Log::Fatal << "FastMKS::Search(): query points have dimensionality "
+        << querySet.n_rows << ", but the reference points have dimensionality "
+        << referenceSet.n_rows << "!" << std::endl;
+
+  indices.set_size(k, querySet.n_cols);
+  products.set_size(k, querySet.n_cols);
+  products.fill(-DBL_MAX);
+
+  if (querySet.n_cols == 0)
+    return;
+
+  Timer::Start("computing_products");
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  // Naive implementation; each query only writes to its own column.
+  if (naive)
+  {
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (size_t q = 0; q < querySet.n_cols; ++q)
+    {
+      for (size_t r = 0; r < referenceSet.n_cols; ++r)
+      {
+        const double eval = metric.Kernel().Evaluate(querySet.unsafe_col(q),
+            referenceSet.unsafe_col(r));
+
+        size_t insertPosition;
+        for (insertPosition = 0; insertPosition < indices.n_rows;
+            ++insertPosition)
+          if (eval > products(insertPosition, q))
+            break;
+
+        if (insertPosition < indices.n_rows)
+          InsertNeighbor(indices, products, q, insertPosition, r, eval);
+      }
+    }
+
+    Timer::Stop("computing_products");
+    return;
+  }
+
+  arma::vec queryKernels;
+  SelfKernels(querySet, queryKernels);
+
+  typedef FastMKSRules<KernelType, TreeType> RuleType;
+  size_t baseCases = 0;
+  size_t scores = 0;
+
+  if (single)
+  {
+    // Single-tree Score() stores the last kernel evaluation in the reference
+    // nodes, so the threads cannot share a reference tree.  Each thread copies
+    // the tree itself, so that its copy is placed on its own NUMA node.
+    if (threadTrees.size() + 1 < threads)
+      threadTrees.resize(threads - 1, NULL);
+
+    #pragma omp parallel num_threads(threads) reduction(+:baseCases, scores)
+    {
+#ifdef _OPENMP
+      const size_t thread = omp_get_thread_num();
+#else
+      const size_t thread = 0;
+#endif
+      if (thread > 0 && threadTrees[thread - 1] == NULL)
+        threadTrees[thread - 1] = new TreeType(*referenceTree);
+
+      // Thread 0 writes to the reference tree during its search, so it must
+      // wait until the other threads have copied it.
+      #pragma omp barrier
+
+      TreeType* tree = (thread == 0) ? referenceTree : threadTrees[thread - 1];
+
+      // Each query only writes to its own column of the results.
+      RuleType rules(referenceSet, querySet, indices, products, metric.Kernel(),
+          queryKernels, referenceKernels, epsilon, maxBaseCases);
+      typename TreeType::template SingleTreeTraverser<RuleType>
+          traverser(rules);
+
+      #pragma omp for schedule(dynamic, 16)
+      for (size_t i = 0; i < querySet.n_cols; ++i)
+        traverser.Traverse(i, *tree);
+
+      baseCases += rules.BaseCases();
+      scores += rules.Scores();
+    }
+  }
+  else
+  {
+    // Dual-tree search writes to the statistics of the query tree only, so
+    // each part of the batch gets its own query tree, and the reference tree
+    // is shared.
+    const size_t parts = std::min(threads, (size_t) querySet.n_cols);
+
+    #pragma omp parallel for schedule(static, 1) num_threads(threads) \
+        reduction(+:baseCases, scores)
+    for (size_t part = 0; part < parts; ++part)
+    {
+      const size_t begin = (part * querySet.n_cols) / parts;
+      const size_t end = ((part + 1) * querySet.n_cols) / parts;
+
+      const arma::mat partSet = querySet.cols(begin, end - 1);
+      const arma::vec partKernels = queryKernels.subvec(begin, end - 1);
+      arma::Mat<size_t> partIndices(k, end - begin);
+      arma::mat partProducts(k, end - begin);
+      partProducts.fill(-DBL_MAX);
+
+      TreeType partTree(partSet, metric);
+
+      RuleType rules(referenceSet, partSet, partIndices, partProducts,
+          metric.Kernel(), partKernels, referenceKernels, epsilon,
+          maxBaseCases);
+      typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
+      traverser.Traverse(partTree, *referenceTree);
+
+      indices.cols(begin, end - 1) = partIndices;
+      products.cols(begin, end - 1) = partProducts;
+
+      baseCases += rules.BaseCases();
+      scores += rules.Scores();
+    }
+  }
+
+  Log::Info << baseCases << " base cases." << std::endl;
+  Log::Info << scores << " scores." << std::endl;
+
+  Timer::Stop("computing_products");
+}
+
+template<typename KernelType, typename TreeType>
+kernel::KernelCache* FastMKS<KernelType, TreeType>::Cache()
+{
+  if (cacheSize == 0)
+  {
+    delete cache;
+    cache = NULL;
+  }
+  else if (cache == NULL || cache->Capacity() != cacheSize)
+  {
+    delete cache;
+    cache = new kernel::KernelCache(cacheSize);
+  }
+
+  return cache;
+}
+
+template<typename KernelType, typename TreeType>
+void FastMKS<KernelType, TreeType>::SelfKernels(const arma::mat& set,
+                                                arma::vec& kernels)
+{
+  kernels.set_size(set.n_cols);
+
+  #pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < set.n_cols; ++i)
+    kernels[i] = sqrt(metric.Kernel().Evaluate(set.unsafe_col(i),
+        set.unsafe_col(i)));
+}
+
 /**
  * Helper function to insert a point into the neighbors and distances matrices.
  *
@@ -308,6 +534,9 @@ std::string FastMKS<KernelType, TreeType>::ToString() const
   convert << "FastMKS [" << this << "]" << std::endl;
   convert << "  Naive: " << naive << std::endl;
   convert << "  Single: " << single << std::endl;
+  convert << "  Epsilon: " << epsilon << std::endl;
+  convert << "  Maximum base cases: " << maxBaseCases << std::endl;
+  convert << "  Kernel cache size: " << cacheSize << std::endl;
   convert << "  Metric: " << std::endl;
   convert << mlpack::util::Indent(metric.ToString(),2);
   convert << std::endl;
@@ -37,7 +37,17 @@ PROGRAM_INFO("FastMKS (Fast Max-Kernel Search)",
     "to the kernel evaluation between those two points."
     "\n\n"
     "This executable performs FastMKS using a cover tree.  The base used to "
-    "build the cover tree can be specified with the --base option.");
+    "build the cover tree can be specified with the --base option."
+    "\n\n"
+    "The search can be made approximate, and much faster, with --epsilon: each "
+    "kernel found is then within a relative error of about epsilon of the true"
+    " k'th maximum kernel.  With single-tree search, --max_base_cases also "
+    "limits the number of kernel evaluations for each query point.  If "
+    "--recall is given, the exact search is run too, and the recall of the "
+    "approximate search (the fraction of the true k maximum kernels that were "
+    "found) is printed with --verbose, along with the time taken by both "
+    "searches; running with several values of --epsilon gives the recall/time"
+    " tradeoff.");
 
 // Define our input parameters.
 PARAM_STRING_REQ("reference_file", "File containing the reference dataset.",
@@ -68,6 +78,73 @@ PARAM_DOUBLE("bandwidth", "Bandwidth (for Gaussian, Epanechnikov, and "
     "triangular kernels).", "w", 1.0);
 PARAM_DOUBLE("scale", "Scale of kernel (for hyptan kernel).", "s", 1.0);
 
+// Approximation parameters.
+PARAM_DOUBLE("epsilon", "Relative error allowed in the kernels found (0 for "
+    "exact search).", "e", 0.0);
+PARAM_INT("max_base_cases", "If nonzero, the maximum number of kernel "
+    "evaluations for each query point (single-tree search only).", "m", 0);
+PARAM_FLAG("recall", "If true, also run the exact search and print the recall "
+    "of the approximate search.", "R");
+
+PARAM_INT("cache_size", "If nonzero, the number of kernel evaluations to "
+    "cache, so that the exact search of --recall reuses the evaluations of the "
+    "approximate search (worth it only for expensive kernels).", "C", 0);
+
+/**
+ * Search with the given FastMKS object, with the approximation parameters
+ * given on the command line; if requested, compare with the exact search.
+ */
+template<typename KernelType>
+void Search(FastMKS<KernelType>& fastmks,
+            const size_t k,
+            arma::Mat<size_t>& indices,
+            arma::mat& products)
+{
+  const double epsilon = CLI::GetParam<double>("epsilon");
+  const int maxBaseCases = CLI::GetParam<int>("max_base_cases");
+  if (epsilon < 0.0 || epsilon >= 1.0)
+    Log::Fatal << "Invalid epsilon (" << epsilon << "); must be in [0, 1)."
+        << endl;
+  if (maxBaseCases < 0)
+    Log::Fatal << "Invalid maximum number of base cases (" << maxBaseCases
+        << "); must be greater than or equal to 0." << endl;
+  const int cacheSize = CLI::GetParam<int>("cache_size");
+  if (cacheSize < 0)
+    Log::Fatal << "Invalid kernel cache size (" << cacheSize << "); must be "
+        << "greater than or equal to 0." << endl;
+
+  fastmks.Epsilon() = epsilon;
+  fastmks.MaxBaseCases() = (size_t) maxBaseCases;
+  fastmks.CacheSize() = (size_t) cacheSize;
+
+  Timer::Start("approximate_search");
+  fastmks.Search(k, indices, products);
+  Timer::Stop("approximate_search");
+
+  if (!CLI::HasParam("recall"))
+    return;
+
+  fastmks.Epsilon() = 0.0;
+  fastmks.MaxBaseCases() = 0;
+
+  arma::Mat<size_t> exactIndices;
+  arma::mat exactProducts;
+  Timer::Start("exact_search");
+  fastmks.Search(k, exactIndices, exactProducts);
+  Timer::Stop("exact_search");
+
+  // Count the true maximum kernels which were found.
+  size_t found = 0;
+  for (size_t q = 0; q < indices.n_cols; ++q)
+    for (size_t i = 0; i < k; ++i)
+      for (size_t j = 0; j < k; ++j)
+        if (indices(i, q) == exactIndices(j, q))
+          ++found;
+
+  Log::Info << "Recall: " << ((double) found / (double) exactIndices.n_elem)
+      << " (" << found << " of " << exactIndices.n_elem << ")." << endl;
+}
+
 //! Run FastMKS on a single dataset for the given kernel type.
 template<typename KernelType>
 void RunFastMKS(const arma::mat& referenceData,
@@ -89,7 +166,7 @@ void RunFastMKS(const arma::mat& referenceData,
   FastMKS<KernelType> fastmks(referenceData, &tree, (single && !naive), naive);
 
   // Now search with it.
-  fastmks.Search(k, indices, products);
+  Search(fastmks, k, indices, products);
 }
 
 //! Run FastMKS for a given query and reference set using the given kernel type.
@@ -116,7 +193,7 @@ void RunFastMKS(const arma::mat& referenceData,
       &queryTree, (single && !naive), naive);
 
   // Now search with it.
-  fastmks.Search(k, indices, products);
+  Search(fastmks, k, indices, products);
 }
 
 int main(int argc, char** argv)
@@ -17,16 +17,78 @@ namespace fastmks {
 
 /**
  * The base case and pruning rules for FastMKS (fast max-kernel search).
+ *
+ * The search may be approximate, in two ways.  With a relative error epsilon
+ * greater than 0, a node is pruned when its bound on the maximum kernel,
+ * reduced by epsilon times its magnitude, cannot improve the results; so each
+ * result is within a relative error of about epsilon of the true k'th maximum
+ * kernel.  With maxBaseCases greater than 0, single-tree search stops for a
+ * query point once that many kernel evaluations have been done for it (the
+ * results are then the best candidates found so far).  Dual-tree search does
+ * not apply the base case limit.
+ *
+ * If a KernelCache is given, the kernel evaluations of BaseCase() are looked
+ * up in it (by the indices of the points) before they are computed, and stored
+ * in it after; this pays off for expensive kernels, when the same cache is used
+ * for many searches of the same sets.
  */
 template<typename KernelType, typename TreeType>
 class FastMKSRules
 {
  public:
+  /**
+   * Construct the rules, computing the self-kernel of each query and reference
+   * point.
+   *
+   * @param referenceSet Set of reference data.
+   * @param querySet Set of query data.
+   * @param indices Matrix to store the indices of the maximum kernels in.
+   * @param products Matrix to store the maximum kernels in.
+   * @param kernel Instantiated kernel.
+   * @param epsilon Relative error allowed in the results (0 for exact).
+   * @param maxBaseCases Maximum number of base cases for each query point in
+   *     single-tree search (0 for no limit).
+   * @param cache Cache of the kernel evaluations between the query and
+   *     reference points (NULL for none).
+   */
   FastMKSRules(const arma::mat& referenceSet,
                const arma::mat& querySet,
                arma::Mat<size_t>& indices,
                arma::mat& products,
-               KernelType& kernel);
+               KernelType& kernel,
+               const double epsilon = 0.0,
+               const size_t maxBaseCases = 0,
+               kernel::KernelCache* cache = NULL);
+
+  /**
+   * Construct the rules with the already-computed self-kernels of the query
+   * and reference points (sqrt(K(p, p)) for each point p).  The self-kernels
+   * are not copied, so they must outlive the rules; this allows many rules
+   * objects (one per thread, or one per batch of queries) to share them.
+   *
+   * @param referenceSet Set of reference data.
+   * @param querySet Set of query data.
+   * @param indices Matrix to store the indices of the maximum kernels in.
+   * @param products Matrix to store the maximum kernels in.
+   * @param kernel Instantiated kernel.
+   * @param queryKernels Self-kernels of the query points.
+   * @param referenceKernels Self-kernels of the reference points.
+   * @param epsilon Relative error allowed in the results (0 for exact).
+   * @param maxBaseCases Maximum number of base cases for each query point in
+   *     single-tree search (0 for no limit).
+   * @param cache Cache of the kernel evaluations between the query and
+   *     reference points (NULL for none).
+   */
+  FastMKSRules(const arma::mat& referenceSet,
+               const arma::mat& querySet,
+               arma::Mat<size_t>& indices,
+               arma::mat& products,
+               KernelType& kernel,
+               const arma::vec& queryKernels,
+               const arma::vec& referenceKernels,
+               const double epsilon = 0.0,
+               const size_t maxBaseCases = 0,
+               kernel::KernelCache* cache = NULL);
 
   //! Compute the base case (kernel value) between two points.
   double BaseCase(const size_t queryIndex, const size_t referenceIndex);
@@ -122,9 +184,25 @@ class FastMKSRules
   //! The last kernel evaluation resulting from BaseCase().
   double lastKernel;
 
+  //! The relative error allowed in the results.
+  double epsilon;
+  //! The maximum number of base cases for each query point (0 for no limit).
+  size_t maxBaseCases;
+  //! The number of base cases of each query point, if maxBaseCases > 0.
+  arma::Col<size_t> queryBaseCases;
+  //! The cache of kernel evaluations (NULL if there is none).
+  kernel::KernelCache* cache;
+
   //! Calculate the bound for a given query node.
   double CalculateBound(TreeType& queryNode) const;
 
+  //! Reduce the given bound on the maximum kernel by the allowed error.
+  double Relax(const double maxKernel) const
+  {
+    return (epsilon == 0.0) ? maxKernel :
+        (maxKernel - epsilon * std::abs(maxKernel));
+  }
+
   //! Utility function to insert neighbor into list of results.
   void InsertNeighbor(const size_t queryIndex,
                       const size_t pos,
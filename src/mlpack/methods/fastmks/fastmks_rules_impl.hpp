@@ -18,7 +18,10 @@ FastMKSRules<KernelType, TreeType>::FastMKSRules(const arma::mat& referenceSet,
                                                  const arma::mat& querySet,
                                                  arma::Mat<size_t>& indices,
                                                  arma::mat& products,
-                                                 KernelType& kernel) :
+                                                 KernelType& kernel,
+                                                 const double epsilon,
+                                                 const size_t maxBaseCases,
+                                                 kernel::KernelCache* cache) :
     referenceSet(referenceSet),
     querySet(querySet),
     indices(indices),
@@ -27,16 +30,24 @@ FastMKSRules<KernelType, TreeType>::FastMKSRules(const arma::mat& referenceSet,
     lastQueryIndex(-1),
     lastReferenceIndex(-1),
     lastKernel(0.0),
+    epsilon(epsilon),
+    maxBaseCases(maxBaseCases),
+    cache(cache),
     baseCases(0),
     scores(0)
 {
+  if (maxBaseCases > 0)
+    queryBaseCases.zeros(querySet.n_cols);
+
   // Precompute each self-kernel.
   queryKernels.set_size(querySet.n_cols);
+  #pragma omp parallel for schedule(static)
   for (size_t i = 0; i < querySet.n_cols; ++i)
     queryKernels[i] = sqrt(kernel.Evaluate(querySet.unsafe_col(i),
                                            querySet.unsafe_col(i)));
 
   referenceKernels.set_size(referenceSet.n_cols);
+  #pragma omp parallel for schedule(static)
   for (size_t i = 0; i < referenceSet.n_cols; ++i)
     referenceKernels[i] = sqrt(kernel.Evaluate(referenceSet.unsafe_col(i),
                                                referenceSet.unsafe_col(i)));
@@ -47,6 +58,49 @@ FastMKSRules<KernelType, TreeType>::FastMKSRules(const arma::mat& referenceSet,
   traversalInfo.LastReferenceNode() = (TreeType*) this;
 }
 
+template<typename KernelType, typename TreeType>
+FastMKSRules<KernelType, TreeType>::FastMKSRules(
+    const arma::mat& referenceSet,
+    const arma::mat& querySet,
+    arma::Mat<size_t>& indices,
+    arma::mat& products,
+    KernelType& kernel,
+    const arma::vec& queryKernels,
+    const arma::vec& referenceKernels,
+    const double epsilon,
+    const size_t maxBaseCases,
+    kernel::KernelCache* cache) :
+    referenceSet(referenceSet),
+    querySet(querySet),
+    indices(indices),
+    products(products),
+    // Alias the given self-kernels; they are never modified.
+    queryKernels(const_cast<double*>(queryKernels.memptr()),
+        queryKernels.n_elem, false, true),
+    referenceKernels(const_cast<double*>(referenceKernels.memptr()),
+        referenceKernels.n_elem, false, true),
+    kernel(kernel),
+    lastQueryIndex(-1),
+    lastReferenceIndex(-1),
+    lastKernel(0.0),
+    epsilon(epsilon),
+    maxBaseCases(maxBaseCases),
+    cache(cache),
+    baseCases(0),
+    scores(0)
+{
+  if (maxBaseCases > 0)
+    queryBaseCases.zeros(querySet.n_cols);
+
+  Log::Assert(queryKernels.n_elem == querySet.n_cols);
+  Log::Assert(referenceKernels.n_elem == referenceSet.n_cols);
+
+  // Set to invalid memory, so that the first node combination does not try to
+  // dereference null pointers.
+  traversalInfo.LastQueryNode() = (TreeType*) this;
+  traversalInfo.LastReferenceNode() = (TreeType*) this;
+}
+
 template<typename KernelType, typename TreeType>
 inline force_inline
 double FastMKSRules<KernelType, TreeType>::BaseCase(
@@ -69,8 +123,23 @@ double FastMKSRules<KernelType, TreeType>::BaseCase(
   }
 
   ++baseCases;
-  double kernelEval = kernel.Evaluate(querySet.unsafe_col(queryIndex),
-                                      referenceSet.unsafe_col(referenceIndex));
+  if (maxBaseCases > 0)
+    ++queryBaseCases[queryIndex];
+
+  // Look the kernel evaluation up in the cache, if there is one.  When the
+  // query and reference sets are the same, K(q, r) = K(r, q) is stored once.
+  double kernelEval;
+  const bool same = (&querySet == &referenceSet);
+  const size_t a = (same && referenceIndex < queryIndex) ? referenceIndex :
+      queryIndex;
+  const size_t b = (a == queryIndex) ? referenceIndex : queryIndex;
+  if (cache == NULL || !cache->Lookup(a, b, kernelEval))
+  {
+    kernelEval = kernel.Evaluate(querySet.unsafe_col(queryIndex),
+                                 referenceSet.unsafe_col(referenceIndex));
+    if (cache != NULL)
+      cache->Insert(a, b, kernelEval);
+  }
 
   // Update the last kernel value, if we need to.
   if (tree::TreeTraits<TreeType>::FirstPointIsCentroid)
@@ -100,6 +169,10 @@ template<typename KernelType, typename TreeType>
 double FastMKSRules<KernelType, TreeType>::Score(const size_t queryIndex,
                                                  TreeType& referenceNode)
 {
+  // Stop searching for this query point if it has used its base cases.
+  if (maxBaseCases > 0 && queryBaseCases[queryIndex] >= maxBaseCases)
+    return DBL_MAX;
+
   // Compare with the current best.
   const double bestKernel = products(products.n_rows - 1, queryIndex);
 
@@ -132,7 +205,7 @@ double FastMKSRules<KernelType, TreeType>::Score(const size_t queryIndex,
           combinedDistBound * queryKernels[queryIndex];
     }
 
-    if (maxKernelBound < bestKernel)
+    if (Relax(maxKernelBound) < bestKernel)
       return DBL_MAX;
   }
 
@@ -188,7 +261,7 @@ double FastMKSRules<KernelType, TreeType>::Score(const size_t queryIndex,
 
   // We return the inverse of the maximum kernel so that larger kernels are
   // recursed into first.
-  return (maxKernel > bestKernel) ? (1.0 / maxKernel) : DBL_MAX;
+  return (Relax(maxKernel) > bestKernel) ? (1.0 / maxKernel) : DBL_MAX;
 }
 
 template<typename KernelType, typename TreeType>
@@ -214,6 +287,7 @@ double FastMKSRules<KernelType, TreeType>::Score(TreeType& queryNode,
   const double refDistBound = (refParentDist + refDescDist);
   double dualQueryTerm;
   double dualRefTerm;
+  bool prunePossible = true;
 
   // The parent-child and parent-parent prunes work by applying the same pruning
   // condition as when the parent node was used, except they are tighter because
@@ -250,6 +324,7 @@ double FastMKSRules<KernelType, TreeType>::Score(TreeType& queryNode,
       // possible.
       dualQueryTerm = 0.0;
       adjustedScore = bestKernel;
+      prunePossible = false;
     }
   }
 
@@ -278,13 +353,14 @@ double FastMKSRules<KernelType, TreeType>::Score(TreeType& queryNode,
       // possible.
       dualRefTerm = 0.0;
       adjustedScore = bestKernel;
+      prunePossible = false;
     }
   }
 
   // Now add the dual term.
   adjustedScore += (dualQueryTerm * dualRefTerm);
 
-  if (adjustedScore < bestKernel)
+  if (prunePossible && Relax(adjustedScore) < bestKernel)
   {
     // It is not possible that this node combination can contain a point
     // combination with kernel value better than the minimum kernel value to
@@ -377,7 +453,7 @@ double FastMKSRules<KernelType, TreeType>::Score(TreeType& queryNode,
 
   // We return the inverse of the maximum kernel so that larger kernels are
   // recursed into first.
-  return (maxKernel > bestKernel) ? (1.0 / maxKernel) : DBL_MAX;
+  return (Relax(maxKernel) > bestKernel) ? (1.0 / maxKernel) : DBL_MAX;
 }
 
 template<typename KernelType, typename TreeType>
@@ -385,9 +461,12 @@ double FastMKSRules<KernelType, TreeType>::Rescore(const size_t queryIndex,
                                                    TreeType& /*referenceNode*/,
                                                    const double oldScore) const
 {
+  if (maxBaseCases > 0 && queryBaseCases[queryIndex] >= maxBaseCases)
+    return DBL_MAX;
+
   const double bestKernel = products(products.n_rows - 1, queryIndex);
 
-  return ((1.0 / oldScore) > bestKernel) ? oldScore : DBL_MAX;
+  return (Relax(1.0 / oldScore) > bestKernel) ? oldScore : DBL_MAX;
 }
 
 template<typename KernelType, typename TreeType>
@@ -398,7 +477,7 @@ double FastMKSRules<KernelType, TreeType>::Rescore(TreeType& queryNode,
   queryNode.Stat().Bound() = CalculateBound(queryNode);
   const double bestKernel = queryNode.Stat().Bound();
 
-  return ((1.0 / oldScore) > bestKernel) ? oldScore : DBL_MAX;
+  return (Relax(1.0 / oldScore) > bestKernel) ? oldScore : DBL_MAX;
 }
 
 /**
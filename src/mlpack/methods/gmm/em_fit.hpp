@@ -19,6 +19,46 @@
 namespace mlpack {
 namespace gmm {
 
+/**
+ * Get a pointer to the points observations.cols(begin, end - 1) in double
+ * precision.  For double-precision observations this points into the
+ * observations; otherwise the points are converted into the given buffer.
+ *
+ * @param observations Observations.
+ * @param begin Index of the first point.
+ * @param end Index after the last point.
+ * @param buffer Matrix to convert the points into, if needed.
+ */
+template<typename eT>
+inline const double* ObservationBlock(const arma::Mat<eT>& observations,
+                                      const size_t begin,
+                                      const size_t end,
+                                      arma::mat& buffer)
+{
+  buffer.set_size(observations.n_rows, end - begin);
+  const eT* source = observations.colptr(begin);
+  double* target = buffer.memptr();
+  for (size_t i = 0; i < buffer.n_elem; ++i)
+    target[i] = source[i];
+
+  return buffer.memptr();
+}
+
+//! Double-precision observations are used in place.
+inline const double* ObservationBlock(const arma::mat& observations,
+                                      const size_t begin,
+                                      const size_t /* end */,
+                                      arma::mat& /* buffer */)
+{
+  return observations.colptr(begin);
+}
+
+// Forward declarations; OnlineEMFit and MRKDEMFit use the E-step of EMFit.
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+class OnlineEMFit;
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+class MRKDEMFit;
+
 /**
  * This class contains methods which can fit a GMM to observations using the EM
  * algorithm.  It requires an initial clustering mechanism, which is by default
@@ -31,9 +71,32 @@ namespace gmm {
  *
  * This method should create 'clusters' clusters, and return the assignment of
  * each point to a cluster.
+ *
+ * Each iteration makes a single pass over the observations, in blocks of
+ * points which are processed in parallel if OpenMP is available; the
+ * responsibilities are computed in log-space, so they do not underflow when
+ * the densities of a point are all tiny.
+ *
+ * The observations may be stored in single precision (arma::fmat), which
+ * halves their memory; each block is converted to double precision when it is
+ * processed, and the model and its statistics are always in double precision.
+ * Then the clusterer must take arma::fmat too (for instance,
+ * kmeans::KMeans<metric::EuclideanDistance, kmeans::RandomPartition,
+ * kmeans::MaxVarianceNewCluster, kmeans::NaiveKMeans, arma::fmat>).
+ *
+ * The exponentials of the responsibilities are computed with ExpType, which
+ * must implement static void Apply(arma::mat&).  By default this is
+ * math::ExactExp; math::FastExp<> is a faster polynomial approximation (with
+ * a relative error of about 1e-8), which changes the fitted model only by
+ * rounding.
+ *
+ * @tparam InitialClusteringType Clusterer for the initial model.
+ * @tparam CovarianceConstraintPolicy Constraint applied to the covariances.
+ * @tparam ExpType Policy which computes the exponential function.
  */
 template<typename InitialClusteringType = kmeans::KMeans<>,
-         typename CovarianceConstraintPolicy = PositiveDefiniteConstraint>
+         typename CovarianceConstraintPolicy = PositiveDefiniteConstraint,
+         typename ExpType = math::ExactExp>
 class EMFit
 {
  public:
@@ -74,7 +137,8 @@ class EMFit
    * @param useInitialModel If true, the given model is used for the initial
    *      clustering.
    */
-  void Estimate(const arma::mat& observations,
+  template<typename eT>
+  void Estimate(const arma::Mat<eT>& observations,
                 std::vector<distribution::GaussianDistribution>& dists,
                 arma::vec& weights,
                 const bool useInitialModel = false);
@@ -96,12 +160,43 @@ class EMFit
    * @param useInitialModel If true, the given model is used for the initial
    *      clustering.
    */
-  void Estimate(const arma::mat& observations,
+  template<typename eT>
+  void Estimate(const arma::Mat<eT>& observations,
                 const arma::vec& probabilities,
                 std::vector<distribution::GaussianDistribution>& dists,
                 arma::vec& weights,
                 const bool useInitialModel = false);
 
+  /**
+   * Fit the observations to a GMM with the EM algorithm several times, from
+   * different initial clusterings, and keep the model with the greatest
+   * log-likelihood.  The initial clusterings are computed one after another
+   * (so that they draw from the global random number generator in the same
+   * order whatever the number of threads), and then the trials are iterated in
+   * parallel, if OpenMP is available, each on its own copy of the model.
+   *
+   * If AbandonIterations() is not 0, every trial is first run for that many
+   * iterations; the trials whose average log-likelihood per observation is
+   * then more than AbandonMargin() below that of the best trial are abandoned,
+   * and only the others are run to convergence.
+   *
+   * @param observations List of observations to train on.
+   * @param probabilities Probability of each point being from this model, or
+   *     an empty vector.
+   * @param trials Number of trials to perform.
+   * @param dists Distributions to train.
+   * @param weights Vector to store a priori weights in.
+   * @param useInitialModel If true, every trial starts from the given model.
+   * @return Log-likelihood of the best model.
+   */
+  template<typename eT>
+  double EstimateTrials(const arma::Mat<eT>& observations,
+                        const arma::vec& probabilities,
+                        const size_t trials,
+                        std::vector<distribution::GaussianDistribution>& dists,
+                        arma::vec& weights,
+                        const bool useInitialModel = false);
+
   //! Get the clusterer.
   const InitialClusteringType& Clusterer() const { return clusterer; }
   //! Modify the clusterer.
@@ -122,7 +217,26 @@ class EMFit
   //! Modify the tolerance for the convergence of the EM algorithm.
   double& Tolerance() { return tolerance; }
 
+  //! Get the number of iterations after which trials are compared in
+  //! EstimateTrials() (0 means no trial is abandoned).
+  size_t AbandonIterations() const { return abandonIterations; }
+  //! Modify the number of iterations after which trials are compared in
+  //! EstimateTrials() (0 means no trial is abandoned).
+  size_t& AbandonIterations() { return abandonIterations; }
+
+  //! Get the margin in average log-likelihood per observation by which a trial
+  //! must trail the best trial to be abandoned.
+  double AbandonMargin() const { return abandonMargin; }
+  //! Modify the margin in average log-likelihood per observation by which a
+  //! trial must trail the best trial to be abandoned.
+  double& AbandonMargin() { return abandonMargin; }
+
  private:
+  //! OnlineEMFit uses InitialClustering() and Accumulate().
+  template<typename, typename> friend class OnlineEMFit;
+  //! MRKDEMFit uses InitialClustering(), AccumulateBlock() and Update().
+  template<typename, typename> friend class MRKDEMFit;
+
   /**
    * Run the clusterer, and then turn the cluster assignments into Gaussians.
    * This is a helper function for both overloads of Estimate().  The vectors
@@ -133,24 +247,117 @@ class EMFit
    * @param covariances Vector to store covariances in.
    * @param weights Vector to store a priori weights in.
    */
-  void InitialClustering(const arma::mat& observations,
+  template<typename eT>
+  void InitialClustering(const arma::Mat<eT>& observations,
                          std::vector<distribution::GaussianDistribution>& dists,
                          arma::vec& weights);
 
   /**
-   * Calculate the log-likelihood of a model.  Yes, this is reimplemented in the
-   * GMM code.  Intuition suggests that the log-likelihood is not the best way
-   * to determine if the EM algorithm has converged.
+   * Iterate EM on the given model until the log-likelihood changes by no more
+   * than the tolerance, or until the iteration counter reaches lastIteration
+   * (0 means no limit).  The counter and the previous log-likelihood are
+   * updated, so that the iterations can be resumed with another call.
+   *
+   * @param observations List of observations.
+   * @param probabilities Probability of each observation, or an empty vector.
+   * @param dists Components to update.
+   * @param weights A priori weights to update.
+   * @param lastIteration Value of the counter at which to stop.
+   * @param iteration Iteration counter (1 before the first iteration).
+   * @param lOld Log-likelihood before the last iteration (-DBL_MAX before the
+   *     first iteration).
+   * @param verbose If true, the log-likelihood of each iteration is logged
+   *     (this must not be done from several threads at once).
+   * @return Log-likelihood of the model.
+   */
+  template<typename eT>
+  double Iterate(const arma::Mat<eT>& observations,
+                 const arma::vec& probabilities,
+                 std::vector<distribution::GaussianDistribution>& dists,
+                 arma::vec& weights,
+                 const size_t lastIteration,
+                 size_t& iteration,
+                 double& lOld,
+                 const bool verbose);
+
+  /**
+   * Make one pass over the observations, in blocks of points which are
+   * processed in parallel if OpenMP is available.  For each block, the
+   * responsibility of each component for each point is computed in log-space
+   * and normalized with the log-sum-exp trick, so that it does not underflow;
+   * then the responsibilities (times the probability of each point, if
+   * given) are accumulated into the weighted sufficient statistics of each
+   * component in thread-local storage.  The statistics are relative to the
+   * current mean of each component.
    *
-   * @param data Data matrix.
-   * @param means Vector of means.
-   * @param covariances Vector of covariance matrices.
-   * @param weights Vector of a priori weights.
+   * @param observations List of observations.
+   * @param probabilities Probability of each observation, or an empty vector.
+   * @param dists Current components.
+   * @param weights Current a priori weights.
+   * @param sumWeights Vector to store the sum of responsibilities of each
+   *     component in.
+   * @param sumDiffs Matrix to store the weighted sum of (x - mean) of each
+   *     component in.
+   * @param sumOuter Vector to store the weighted sum of (x - mean)(x - mean)^T
+   *     of each component in.
+   * @return Log-likelihood of the current model.
+   */
+  template<typename eT>
+  double Accumulate(const arma::Mat<eT>& observations,
+                    const arma::vec& probabilities,
+                    const std::vector<distribution::GaussianDistribution>&
+                        dists,
+                    const arma::vec& weights,
+                    arma::vec& sumWeights,
+                    arma::mat& sumDiffs,
+                    std::vector<arma::mat>& sumOuter) const;
+
+  /**
+   * Compute the responsibilities of the components for a block of points and
+   * add the weighted sufficient statistics of the block to the given sums (as
+   * in Accumulate(), which calls this for each block).
+   *
+   * @param block Block of observations.
+   * @param probabilities Probability of each observation of the block, or
+   *     NULL.
+   * @param dists Current components.
+   * @param logWeights Log of the current a priori weights.
+   * @param sumWeights Sum of responsibilities of each component to add to.
+   * @param sumDiffs Weighted sum of (x - mean) of each component to add to.
+   * @param sumOuter Weighted sum of (x - mean)(x - mean)^T of each component
+   *     to add to.
+   * @param logLikelihood Log-likelihood to add the log-likelihood of the block
+   *     to.
+   * @param zeroPoints Number of points with likelihood 0 to add to.
    */
-  double LogLikelihood(const arma::mat& data,
+  void AccumulateBlock(const arma::mat& block,
+                       const double* probabilities,
                        const std::vector<distribution::GaussianDistribution>&
                            dists,
-                       const arma::vec& weights) const;
+                       const arma::vec& logWeights,
+                       arma::vec& sumWeights,
+                       arma::mat& sumDiffs,
+                       std::vector<arma::mat>& sumOuter,
+                       double& logLikelihood,
+                       size_t& zeroPoints) const;
+
+  /**
+   * Compute the new means, covariances, and weights from the statistics given
+   * by Accumulate(), and apply the covariance constraint.
+   *
+   * @param sumWeights Sum of responsibilities of each component.
+   * @param sumDiffs Weighted sum of (x - mean) of each component.
+   * @param sumOuter Weighted sum of (x - mean)(x - mean)^T of each component.
+   * @param totalWeight Total weight of the observations.
+   * @param dists Components to update.
+   * @param weights A priori weights to update.
+   */
+  void Update(const arma::vec& sumWeights,
+              const arma::mat& sumDiffs,
+              const std::vector<arma::mat>& sumOuter,
+              const double totalWeight,
+              std::vector<distribution::GaussianDistribution>& dists,
+              arma::vec& weights);
 
   //! Maximum iterations of EM algorithm.
   size_t maxIterations;
@@ -160,6 +367,10 @@ class EMFit
   InitialClusteringType clusterer;
   //! Object which applies constraints to the covariance matrix.
   CovarianceConstraintPolicy constraint;
+  //! Iterations after which trials are compared (0 means never).
+  size_t abandonIterations;
+  //! Margin in average log-likelihood by which trials are abandoned.
+  double abandonMargin;
 };
 
 }; // namespace gmm
@@ -15,8 +15,10 @@ namespace mlpack {
 namespace gmm {
 
 //! Constructor.
-template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
-EMFit<InitialClusteringType, CovarianceConstraintPolicy>::EMFit(
+template<typename InitialClusteringType,
+         typename CovarianceConstraintPolicy,
+         typename ExpType>
+EMFit<InitialClusteringType, CovarianceConstraintPolicy, ExpType>::EMFit(
     const size_t maxIterations,
     const double tolerance,
     InitialClusteringType clusterer,
@@ -24,183 +26,205 @@ EMFit<InitialClusteringType, CovarianceConstraintPolicy>::EMFit(
     maxIterations(maxIterations),
     tolerance(tolerance),
     clusterer(clusterer),
-    constraint(constraint)
+    constraint(constraint),
+    abandonIterations(0),
+    abandonMargin(0.1)
 { /* Nothing to do. */ }
 
-template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
-void EMFit<InitialClusteringType, CovarianceConstraintPolicy>::Estimate(
-    const arma::mat& observations,
-    std::vector<distribution::GaussianDistribution>& dists,
-    arma::vec& weights,
-    const bool useInitialModel)
+template<typename InitialClusteringType,
+         typename CovarianceConstraintPolicy,
+         typename ExpType>
+template<typename eT>
+void EMFit<InitialClusteringType, CovarianceConstraintPolicy, ExpType>::
+Estimate(const arma::Mat<eT>& observations,
+         std::vector<distribution::GaussianDistribution>& dists,
+         arma::vec& weights,
+         const bool useInitialModel)
 {
   // Only perform initial clustering if the user wanted it.
   if (!useInitialModel)
     InitialClustering(observations, dists, weights);
 
-  double l = LogLikelihood(observations, dists, weights);
-
-  Log::Debug << "EMFit::Estimate(): initial clustering log-likelihood: "
-      << l << std::endl;
-
+  size_t iteration = 1;
   double lOld = -DBL_MAX;
-  arma::mat condProb(observations.n_cols, dists.size());
+  Iterate(observations, arma::vec(), dists, weights, maxIterations, iteration,
+      lOld, true);
+}
+
+template<typename InitialClusteringType,
+         typename CovarianceConstraintPolicy,
+         typename ExpType>
+template<typename eT>
+void EMFit<InitialClusteringType, CovarianceConstraintPolicy, ExpType>::
+Estimate(const arma::Mat<eT>& observations,
+         const arma::vec& probabilities,
+         std::vector<distribution::GaussianDistribution>& dists,
+         arma::vec& weights,
+         const bool useInitialModel)
+{
+  if (!useInitialModel)
+    InitialClustering(observations, dists, weights);
 
-  // Iterate to update the model until no more improvement is found.
   size_t iteration = 1;
-  while (std::abs(l - lOld) > tolerance && iteration != maxIterations)
-  {
-    Log::Info << "EMFit::Estimate(): iteration " << iteration << ", "
-        << "log-likelihood " << l << "." << std::endl;
+  double lOld = -DBL_MAX;
+  Iterate(observations, probabilities, dists, weights, maxIterations,
+      iteration, lOld, true);
+}
 
-    // Calculate the conditional probabilities of choosing a particular
-    // Gaussian given the observations and the present theta value.
-    for (size_t i = 0; i < dists.size(); i++)
-    {
-      // Store conditional probabilities into condProb vector for each
-      // Gaussian.  First we make an alias of the condProb vector.
-      arma::vec condProbAlias = condProb.unsafe_col(i);
-      dists[i].Probability(observations, condProbAlias);
-      condProbAlias *= weights[i];
-    }
+template<typename InitialClusteringType,
+         typename CovarianceConstraintPolicy,
+         typename ExpType>
+template<typename eT>
+double EMFit<InitialClusteringType, CovarianceConstraintPolicy, ExpType>::
+EstimateTrials(const arma::Mat<eT>& observations,
+               const arma::vec& probabilities,
+               const size_t trials,
+               std::vector<distribution::GaussianDistribution>& dists,
+               arma::vec& weights,
+               const bool useInitialModel)
+{
+  if (trials == 0)
+    return -DBL_MAX;
+
+  if (abandonMargin < 0.0)
+    Log::Fatal << "EMFit::EstimateTrials(): the margin to abandon trials ("
+        << abandonMargin << ") must not be negative!" << std::endl;
+
+  // Each trial has its own copy of the model.  The initial clusterings are
+  // computed in order; each of them may already run in parallel.
+  std::vector<std::vector<distribution::GaussianDistribution> >
+      trialDists(trials, dists);
+  std::vector<arma::vec> trialWeights(trials, weights);
+  if (!useInitialModel)
+    for (size_t t = 0; t < trials; ++t)
+      InitialClustering(observations, trialDists[t], trialWeights[t]);
 
-    // Normalize row-wise.
-    for (size_t i = 0; i < condProb.n_rows; i++)
-    {
-      // Avoid dividing by zero; if the probability for everything is 0, we
-      // don't want to make it NaN.
-      const double probSum = accu(condProb.row(i));
-      if (probSum != 0.0)
-        condProb.row(i) /= probSum;
-    }
+  std::vector<size_t> iterations(trials, 1);
+  std::vector<double> lOld(trials, -DBL_MAX);
+  arma::vec l(trials);
 
-    // Store the sum of the probability of each state over all the observations.
-    arma::vec probRowSums = trans(arma::sum(condProb, 0 /* columnwise */));
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
 
-    // Calculate the new value of the means using the updated conditional
-    // probabilities.
-    for (size_t i = 0; i < dists.size(); i++)
+  // If trials may be abandoned, run every trial up to the comparison first.
+  std::vector<bool> abandoned(trials, false);
+  if (abandonIterations != 0 && (maxIterations == 0 ||
+      abandonIterations < maxIterations))
+  {
+    #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+        if(threads > 1)
+    for (size_t t = 0; t < trials; ++t)
+      l[t] = Iterate(observations, probabilities, trialDists[t],
+          trialWeights[t], abandonIterations, iterations[t], lOld[t], false);
+
+    const double margin = abandonMargin * observations.n_cols;
+    for (size_t t = 0; t < trials; ++t)
     {
-      // Don't update if there's no probability of the Gaussian having points.
-      if (probRowSums[i] != 0)
-        dists[i].Mean() = (observations * condProb.col(i)) / probRowSums[i];
-
-      // Calculate the new value of the covariances using the updated
-      // conditional probabilities and the updated means.
-      arma::mat tmp = observations - (dists[i].Mean() *
-          arma::ones<arma::rowvec>(observations.n_cols));
-      arma::mat tmpB = tmp % (arma::ones<arma::vec>(observations.n_rows) *
-          trans(condProb.col(i)));
-
-      // Don't update if there's no probability of the Gaussian having points.
-      if (probRowSums[i] != 0.0)
-        dists[i].Covariance() = (tmp * trans(tmpB)) / probRowSums[i];
-
-      // Apply covariance constraint.
-      constraint.ApplyConstraint(dists[i].Covariance());
+      if (l[t] < l.max() - margin)
+      {
+        abandoned[t] = true;
+        Log::Info << "EMFit::EstimateTrials(): trial " << t << " abandoned "
+            << "with log-likelihood " << l[t] << "." << std::endl;
+      }
     }
+  }
 
-    // Calculate the new values for omega using the updated conditional
-    // probabilities.
-    weights = probRowSums / observations.n_cols;
+  #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+      if(threads > 1)
+  for (size_t t = 0; t < trials; ++t)
+  {
+    if (!abandoned[t])
+      l[t] = Iterate(observations, probabilities, trialDists[t],
+          trialWeights[t], maxIterations, iterations[t], lOld[t], false);
+  }
 
-    // Update values of l; calculate new log-likelihood.
-    lOld = l;
-    l = LogLikelihood(observations, dists, weights);
+  // Keep the best of the remaining trials (the first, in case of ties).
+  size_t best = trials;
+  for (size_t t = 0; t < trials; ++t)
+  {
+    if (abandoned[t])
+      continue;
 
-    iteration++;
+    Log::Info << "EMFit::EstimateTrials(): log-likelihood of trial " << t
+        << " is " << l[t] << "." << std::endl;
+    if (best == trials || l[t] > l[best])
+      best = t;
   }
+
+  dists = trialDists[best];
+  weights = trialWeights[best];
+  return l[best];
 }
 
-template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
-void EMFit<InitialClusteringType, CovarianceConstraintPolicy>::Estimate(
-    const arma::mat& observations,
-    const arma::vec& probabilities,
-    std::vector<distribution::GaussianDistribution>& dists,
-    arma::vec& weights,
-    const bool useInitialModel)
+template<typename InitialClusteringType,
+         typename CovarianceConstraintPolicy,
+         typename ExpType>
+template<typename eT>
+double EMFit<InitialClusteringType, CovarianceConstraintPolicy, ExpType>::
+Iterate(const arma::Mat<eT>& observations,
+        const arma::vec& probabilities,
+        std::vector<distribution::GaussianDistribution>& dists,
+        arma::vec& weights,
+        const size_t lastIteration,
+        size_t& iteration,
+        double& lOld,
+        const bool verbose)
 {
-  if (!useInitialModel)
-    InitialClustering(observations, dists, weights);
-
-  double l = LogLikelihood(observations, dists, weights);
-
-  Log::Debug << "EMFit::Estimate(): initial clustering log-likelihood: "
-      << l << std::endl;
-
-  double lOld = -DBL_MAX;
-  arma::mat condProb(observations.n_cols, dists.size());
+  // Each component holds its weight, mean, covariance and the factorization
+  // and inverse of its covariance.  (Trials fitted in parallel are each
+  // accounted.)
+  static const size_t modelAccount = MemoryUsage::Register("gmm_parameters");
+  const size_t dimension = observations.n_rows;
+  ScopedMemory modelMemory(modelAccount, dists.size() *
+      (1 + dimension + 3 * dimension * dimension) * sizeof(double));
+
+  // The statistics are weighted by the probability of each point, if given,
+  // but the log-likelihood is not.
+  const double totalWeight = probabilities.is_empty() ?
+      (double) observations.n_cols : arma::accu(probabilities);
+
+  // Each pass over the data computes the log-likelihood of the current model
+  // and the statistics needed to update it.
+  arma::vec sumWeights;
+  arma::mat sumDiffs;
+  std::vector<arma::mat> sumOuter;
+  double l = Accumulate(observations, probabilities, dists, weights,
+      sumWeights, sumDiffs, sumOuter);
+
+  if (verbose && iteration == 1)
+    Log::Debug << "EMFit::Estimate(): initial clustering log-likelihood: "
+        << l << std::endl;
 
   // Iterate to update the model until no more improvement is found.
-  size_t iteration = 1;
-  while (std::abs(l - lOld) > tolerance && iteration != maxIterations)
+  while (std::abs(l - lOld) > tolerance && iteration != lastIteration)
   {
-    // Calculate the conditional probabilities of choosing a particular
-    // Gaussian given the observations and the present theta value.
-    for (size_t i = 0; i < dists.size(); i++)
-    {
-      // Store conditional probabilities into condProb vector for each
-      // Gaussian.  First we make an alias of the condProb vector.
-      arma::vec condProbAlias = condProb.unsafe_col(i);
-      dists[i].Probability(observations, condProbAlias);
-      condProbAlias *= weights[i];
-    }
-
-    // Normalize row-wise.
-    for (size_t i = 0; i < condProb.n_rows; i++)
-    {
-      // Avoid dividing by zero; if the probability for everything is 0, we
-      // don't want to make it NaN.
-      const double probSum = accu(condProb.row(i));
-      if (probSum != 0.0)
-        condProb.row(i) /= probSum;
-    }
+    if (verbose)
+      Log::Info << "EMFit::Estimate(): iteration " << iteration << ", "
+          << "log-likelihood " << l << "." << std::endl;
 
-    // This will store the sum of probabilities of each state over all the
-    // observations.
-    arma::vec probRowSums(dists.size());
-
-    // Calculate the new value of the means using the updated conditional
-    // probabilities.
-    for (size_t i = 0; i < dists.size(); i++)
-    {
-      // Calculate the sum of probabilities of points, which is the
-      // conditional probability of each point being from Gaussian i
-      // multiplied by the probability of the point being from this mixture
-      // model.
-      probRowSums[i] = accu(condProb.col(i) % probabilities);
-
-      dists[i].Mean() = (observations * (condProb.col(i) % probabilities)) /
-        probRowSums[i];
-
-      // Calculate the new value of the covariances using the updated
-      // conditional probabilities and the updated means.
-      arma::mat tmp = observations - (dists[i].Mean() *
-          arma::ones<arma::rowvec>(observations.n_cols));
-      arma::mat tmpB = tmp % (arma::ones<arma::vec>(observations.n_rows) *
-          trans(condProb.col(i) % probabilities));
-
-      dists[i].Covariance() = (tmp * trans(tmpB)) / probRowSums[i];
-
-      // Apply covariance constraint.
-      constraint.ApplyConstraint(dists[i].Covariance());
-    }
-
-    // Calculate the new values for omega using the updated conditional
-    // probabilities.
-    weights = probRowSums / accu(probabilities);
+    // Calculate the new means, covariances and weights.
+    Update(sumWeights, sumDiffs, sumOuter, totalWeight, dists, weights);
 
     // Update values of l; calculate new log-likelihood.
     lOld = l;
-    l = LogLikelihood(observations, dists, weights);
+    l = Accumulate(observations, probabilities, dists, weights, sumWeights,
+        sumDiffs, sumOuter);
 
     iteration++;
   }
+
+  return l;
 }
 
-template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
-void EMFit<InitialClusteringType, CovarianceConstraintPolicy>::
-InitialClustering(const arma::mat& observations,
+template<typename InitialClusteringType,
+         typename CovarianceConstraintPolicy,
+         typename ExpType>
+template<typename eT>
+void EMFit<InitialClusteringType, CovarianceConstraintPolicy, ExpType>::
+InitialClustering(const arma::Mat<eT>& observations,
                   std::vector<distribution::GaussianDistribution>& dists,
                   arma::vec& weights)
 {
@@ -210,25 +234,28 @@ InitialClustering(const arma::mat& observations,
   // Run clustering algorithm.
   clusterer.Cluster(observations, dists.size(), assignments);
 
-  // Now calculate the means, covariances, and weights.
+  // Now calculate the means, covariances, and weights.  The covariances are
+  // only set in the distributions once they are complete, since each time
+  // one is set it is factorized.
   weights.zeros();
+  std::vector<arma::mat> covariances(dists.size(),
+      arma::zeros<arma::mat>(observations.n_rows, observations.n_rows));
   for (size_t i = 0; i < dists.size(); ++i)
-  {
     dists[i].Mean().zeros();
-    dists[i].Covariance().zeros();
-  }
 
-  // From the assignments, generate our means, covariances, and weights.
+  // From the assignments, generate our means, covariances, and weights.  The
+  // points are added in double precision.
+  arma::vec point;
   for (size_t i = 0; i < observations.n_cols; ++i)
   {
     const size_t cluster = assignments[i];
+    point = arma::conv_to<arma::vec>::from(observations.col(i));
 
     // Add this to the relevant mean.
-    dists[cluster].Mean() += observations.col(i);
+    dists[cluster].Mean() += point;
 
     // Add this to the relevant covariance.
-    dists[cluster].Covariance() += observations.col(i) *
-        trans(observations.col(i));
+    covariances[cluster] += point * trans(point);
 
     // Now add one to the weights (we will normalize).
     weights[cluster]++;
@@ -243,50 +270,259 @@ InitialClustering(const arma::mat& observations,
   for (size_t i = 0; i < observations.n_cols; ++i)
   {
     const size_t cluster = assignments[i];
-    const arma::vec normObs = observations.col(i) - dists[cluster].Mean();
-    dists[cluster].Covariance() += normObs * normObs.t();
+    const arma::vec normObs = arma::conv_to<arma::vec>::from(
+        observations.col(i)) - dists[cluster].Mean();
+    covariances[cluster] += normObs * normObs.t();
   }
 
   for (size_t i = 0; i < dists.size(); ++i)
   {
-    dists[i].Covariance() /= (weights[i] > 1) ? weights[i] : 1;
+    covariances[i] /= (weights[i] > 1) ? weights[i] : 1;
 
     // Apply constraints to covariance matrix.
-    constraint.ApplyConstraint(dists[i].Covariance());
+    constraint.ApplyConstraint(covariances[i]);
+    dists[i].Covariance(covariances[i]);
   }
 
   // Finally, normalize weights.
   weights /= accu(weights);
 }
 
-template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
-double EMFit<InitialClusteringType, CovarianceConstraintPolicy>::LogLikelihood(
-    const arma::mat& observations,
-    const std::vector<distribution::GaussianDistribution>& dists,
-    const arma::vec& weights) const
+template<typename InitialClusteringType,
+         typename CovarianceConstraintPolicy,
+         typename ExpType>
+template<typename eT>
+double EMFit<InitialClusteringType, CovarianceConstraintPolicy, ExpType>::
+Accumulate(const arma::Mat<eT>& observations,
+           const arma::vec& probabilities,
+           const std::vector<distribution::GaussianDistribution>& dists,
+           const arma::vec& weights,
+           arma::vec& sumWeights,
+           arma::mat& sumDiffs,
+           std::vector<arma::mat>& sumOuter) const
 {
-  double logLikelihood = 0;
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
 
-  arma::vec phis;
-  arma::mat likelihoods(dists.size(), observations.n_cols);
-  
-  for (size_t i = 0; i < dists.size(); ++i)
+  const size_t dimension = observations.n_rows;
+  const size_t components = dists.size();
+  const double negInfinity = -std::numeric_limits<double>::infinity();
+
+  // The log of the weight of each component; the distributions cache the
+  // factorization of their covariance.
+  arma::vec logWeights(components);
+  for (size_t i = 0; i < components; ++i)
+    logWeights[i] = (weights[i] > 0.0) ? std::log(weights[i]) : negInfinity;
+
+  // Thread-local statistics, relative to the current mean of each component
+  // (this avoids cancellation when the covariance is computed).
+  static const size_t statisticsAccount =
+      MemoryUsage::Register("gmm_statistics");
+  ScopedMemory statisticsMemory(statisticsAccount, threads * components *
+      (1 + dimension + dimension * dimension) * sizeof(double));
+  std::vector<arma::vec> threadWeights(threads,
+      arma::zeros<arma::vec>(components));
+  std::vector<arma::mat> threadDiffs(threads,
+      arma::zeros<arma::mat>(dimension, components));
+  std::vector<std::vector<arma::mat> > threadOuter(threads,
+      std::vector<arma::mat>(components,
+      arma::zeros<arma::mat>(dimension, dimension)));
+
+  // Blocks of points are large enough for the matrix products to be
+  // efficient, and small enough for the responsibilities to stay in cache.
+  const size_t blockSize = 1024;
+  const size_t blocks = (observations.n_cols + blockSize - 1) / blockSize;
+  double logLikelihood = 0.0;
+  size_t zeroPoints = 0;
+
+  #pragma omp parallel num_threads(threads) \
+      reduction(+:logLikelihood, zeroPoints)
   {
-    dists[i].Probability(observations, phis);
-    likelihoods.row(i) = weights(i) * trans(phis);
+#ifdef _OPENMP
+    const size_t thread = omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+    arma::vec& localWeights = threadWeights[thread];
+    arma::mat& localDiffs = threadDiffs[thread];
+    std::vector<arma::mat>& localOuter = threadOuter[thread];
+
+    arma::mat buffer;
+
+    #pragma omp for schedule(dynamic)
+    for (size_t b = 0; b < blocks; ++b)
+    {
+      const size_t begin = b * blockSize;
+      const size_t end = std::min(begin + blockSize, (size_t)
+          observations.n_cols);
+
+      // Single-precision blocks are converted to double precision.
+      const arma::mat block(const_cast<double*>(ObservationBlock(observations,
+          begin, end, buffer)), observations.n_rows, end - begin, false, true);
+      AccumulateBlock(block, probabilities.is_empty() ? NULL :
+          probabilities.memptr() + begin, dists, logWeights, localWeights,
+          localDiffs, localOuter, logLikelihood, zeroPoints);
+    }
   }
-  // Now sum over every point.
-  for (size_t j = 0; j < observations.n_cols; ++j)
+
+  // Reduce the thread-local statistics.
+  sumWeights = threadWeights[0];
+  sumDiffs = threadDiffs[0];
+  sumOuter = threadOuter[0];
+  for (size_t t = 1; t < threads; ++t)
   {
-    if (accu(likelihoods.col(j)) == 0)
-      Log::Info << "Likelihood of point " << j << " is 0!  It is probably an "
-          << "outlier." << std::endl;
-    logLikelihood += log(accu(likelihoods.col(j)));
+    sumWeights += threadWeights[t];
+    sumDiffs += threadDiffs[t];
+    for (size_t i = 0; i < components; ++i)
+      sumOuter[i] += threadOuter[t][i];
   }
-  
+
+  if (zeroPoints > 0)
+    Log::Info << "Likelihood of " << zeroPoints << " points is 0!  They are "
+        << "probably outliers." << std::endl;
+
   return logLikelihood;
 }
 
+template<typename InitialClusteringType,
+         typename CovarianceConstraintPolicy,
+         typename ExpType>
+void EMFit<InitialClusteringType, CovarianceConstraintPolicy, ExpType>::
+AccumulateBlock(const arma::mat& block,
+                const double* probabilities,
+                const std::vector<distribution::GaussianDistribution>& dists,
+                const arma::vec& logWeights,
+                arma::vec& sumWeights,
+                arma::mat& sumDiffs,
+                std::vector<arma::mat>& sumOuter,
+                double& logLikelihood,
+                size_t& zeroPoints) const
+{
+  const size_t dimension = block.n_rows;
+  const size_t components = dists.size();
+  const double negInfinity = -std::numeric_limits<double>::infinity();
+
+  // The log of the weighted density of each component at each point.
+  arma::mat responsibilities(components, block.n_cols);
+  arma::vec logProbabilities;
+  for (size_t i = 0; i < components; ++i)
+  {
+    if (logWeights[i] == negInfinity)
+    {
+      responsibilities.row(i).fill(negInfinity);
+      continue;
+    }
+
+    dists[i].LogProbability(block, logProbabilities);
+    responsibilities.row(i) = logWeights[i] + arma::trans(logProbabilities);
+  }
+
+  // Normalize each column with the log-sum-exp trick, so that nothing
+  // underflows.  The columns are shifted by their maximum first, and then the
+  // whole block is exponentiated at once with ExpType.
+  arma::vec maxLogProbs(block.n_cols);
+  for (size_t j = 0; j < block.n_cols; ++j)
+  {
+    double* column = responsibilities.colptr(j);
+    double maxLogProb = negInfinity;
+    for (size_t i = 0; i < components; ++i)
+      maxLogProb = std::max(maxLogProb, column[i]);
+
+    // If no component can have generated this point, every responsibility is
+    // exp(-inf) = 0.
+    maxLogProbs[j] = maxLogProb;
+    if (maxLogProb != negInfinity)
+      for (size_t i = 0; i < components; ++i)
+        column[i] -= maxLogProb;
+  }
+
+  ExpType::Apply(responsibilities);
+
+  for (size_t j = 0; j < block.n_cols; ++j)
+  {
+    if (maxLogProbs[j] == negInfinity)
+    {
+      logLikelihood += negInfinity;
+      ++zeroPoints;
+      continue;
+    }
+
+    double* column = responsibilities.colptr(j);
+    double sum = 0.0;
+    for (size_t i = 0; i < components; ++i)
+      sum += column[i];
+    logLikelihood += maxLogProbs[j] + std::log(sum);
+
+    const double scale = ((probabilities == NULL) ? 1.0 : probabilities[j]) /
+        sum;
+    for (size_t i = 0; i < components; ++i)
+      column[i] *= scale;
+  }
+
+  // Accumulate the weighted sufficient statistics.
+  sumWeights += arma::sum(responsibilities, 1);
+  arma::mat diffs(dimension, block.n_cols);
+  arma::vec rootResponsibilities(block.n_cols);
+  for (size_t i = 0; i < components; ++i)
+  {
+    if (logWeights[i] == negInfinity)
+      continue;
+
+    // Center the points and scale them by the square roots of their
+    // responsibilities, so that the weighted outer products are one symmetric
+    // matrix product (as in math::Covariance()).
+    const arma::vec& mean = dists[i].Mean();
+    for (size_t j = 0; j < block.n_cols; ++j)
+    {
+      const double* point = block.colptr(j);
+      double* diff = diffs.colptr(j);
+      const double root = std::sqrt(responsibilities(i, j));
+      for (size_t d = 0; d < dimension; ++d)
+        diff[d] = root * (point[d] - mean[d]);
+      rootResponsibilities[j] = root;
+    }
+
+    sumDiffs.col(i) += diffs * rootResponsibilities;
+    sumOuter[i] += diffs * arma::trans(diffs);
+  }
+}
+
+template<typename InitialClusteringType,
+         typename CovarianceConstraintPolicy,
+         typename ExpType>
+void EMFit<InitialClusteringType, CovarianceConstraintPolicy, ExpType>::
+Update(const arma::vec& sumWeights,
+       const arma::mat& sumDiffs,
+       const std::vector<arma::mat>& sumOuter,
+       const double totalWeight,
+       std::vector<distribution::GaussianDistribution>& dists,
+       arma::vec& weights)
+{
+  for (size_t i = 0; i < dists.size(); i++)
+  {
+    // Don't update if there's no probability of the Gaussian having points.
+    arma::mat covariance = dists[i].Covariance();
+    if (sumWeights[i] != 0.0)
+    {
+      // The statistics are relative to the old mean.
+      const arma::vec shift = sumDiffs.col(i) / sumWeights[i];
+      dists[i].Mean() += shift;
+      covariance = sumOuter[i] / sumWeights[i] - shift * arma::trans(shift);
+    }
+
+    // Apply covariance constraint.
+    constraint.ApplyConstraint(covariance);
+    dists[i].Covariance(covariance);
+  }
+
+  // Calculate the new values for omega using the updated conditional
+  // probabilities.
+  weights = sumWeights / totalWeight;
+}
+
 }; // namespace gmm
 }; // namespace mlpack
 
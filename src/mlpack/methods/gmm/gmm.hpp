@@ -47,6 +47,12 @@ namespace gmm /** Gaussian Mixture Models. */ {
  * For a sample implementation, see the EMFit class; this class uses the EM
  * algorithm to train a GMM, and is the default fitting type.
  *
+ * The observations given to Estimate(), Classify() and the probability
+ * functions may be single-precision matrices (arma::fmat), if FittingType
+ * accepts them (as EMFit does, with a clusterer for arma::fmat); they are
+ * converted to double precision in blocks, as they are processed, and the
+ * model itself is always in double precision.
+ *
  * The GMM, once trained, can be used to generate random points from the
  * distribution and estimate the probability of points being from the
  * distribution.  The parameters of the GMM can be obtained through the
@@ -187,14 +193,16 @@ class GMM
 
   /**
    * Load a GMM from an XML file.  The format of the XML file should be the same
-   * as is generated by the Save() method.
+   * as is generated by the Save() method.  A file with the extension .bin is
+   * read in the binary format of SaveRestoreUtility, which is mapped into
+   * memory instead of parsed.
    *
    * @param filename Name of XML file containing model to be loaded.
    */
   void Load(const std::string& filename);
 
   /**
-   * Save a GMM to an XML file.
+   * Save a GMM to an XML file (or to a binary file, if the extension is .bin).
    *
    * @param filename Name of XML file to write to.
    */
@@ -286,6 +294,31 @@ class GMM
    */
   double Probability(const arma::vec& observation) const;
 
+  /**
+   * Compute the probability of each of the given observations (one per
+   * column) being from this distribution.
+   *
+   * @param observations Observations to evaluate the probability of.
+   * @param probabilities Vector to store the probabilities in.
+   */
+  template<typename eT>
+  void Probability(const arma::Mat<eT>& observations,
+                   arma::vec& probabilities) const;
+
+  /**
+   * Compute the log-probability of each of the given observations (one per
+   * column) being from this distribution.  The observations are evaluated in
+   * blocks, in parallel if OpenMP is available; the log-probabilities of all
+   * the components for a block are computed together, and then summed with
+   * the log-sum-exp trick, so that they do not underflow far from the means.
+   *
+   * @param observations Observations to evaluate the log-probability of.
+   * @param logProbabilities Vector to store the log-probabilities in.
+   */
+  template<typename eT>
+  void LogProbability(const arma::Mat<eT>& observations,
+                      arma::vec& logProbabilities) const;
+
   /**
    * Return the probability that the given observation came from the given
    * Gaussian component in this distribution.
@@ -304,6 +337,34 @@ class GMM
    */
   arma::vec Random() const;
 
+  /**
+   * Draw the given number of random observations from this GMM, one per
+   * column.  The component of each observation is drawn from an alias table of
+   * the weights, and the observations of each component are generated together
+   * with its cached Cholesky factor.  If OpenMP is available, blocks of
+   * BlockSize observations are drawn in parallel, each from its own stream of
+   * random numbers, so the observations only depend on the random seed, and
+   * not on the number of threads.
+   *
+   * @param n Number of observations to draw.
+   * @param observations Matrix to store the observations in.
+   */
+  void Random(const size_t n, arma::mat& observations) const;
+
+  /**
+   * Draw the given number of random observations from this GMM, one per
+   * column, from the given stream of random numbers (see math::RandomStream).
+   * This is used by the other overload, and allows the GMM to be the emission
+   * distribution of an HMM whose sequences are generated in parallel.
+   *
+   * @param n Number of observations to draw.
+   * @param stream Stream of random numbers to draw from.
+   * @param observations Matrix to store the observations in.
+   */
+  void Random(const size_t n,
+              math::RandomStream& stream,
+              arma::mat& observations) const;
+
   /**
    * Estimate the probability distribution directly from the given observations,
    * using the given algorithm in the FittingType class to fit the data.
@@ -326,7 +387,8 @@ class GMM
    *      model for the estimation.
    * @return The log-likelihood of the best fit.
    */
-  double Estimate(const arma::mat& observations,
+  template<typename eT>
+  double Estimate(const arma::Mat<eT>& observations,
                   const size_t trials = 1,
                   const bool useExistingModel = false);
 
@@ -354,11 +416,35 @@ class GMM
    *     model for the estimation.
    * @return The log-likelihood of the best fit.
    */
-  double Estimate(const arma::mat& observations,
+  template<typename eT>
+  double Estimate(const arma::Mat<eT>& observations,
                   const arma::vec& probabilities,
                   const size_t trials = 1,
                   const bool useExistingModel = false);
 
+  /**
+   * Estimate the probability distribution from the observations read from a
+   * file in blocks by the given reader, so that they do not have to fit in
+   * memory.  This is only available if the FittingType class provides the
+   * method
+   *
+   * @code
+   * void Estimate(data::StreamingReader& reader,
+   *               std::vector<distribution::GaussianDistribution>& dists,
+   *               arma::vec& weights,
+   *               const bool useInitialModel);
+   * @endcode
+   *
+   * as OnlineEMFit does.  Since computing the log-likelihood would take
+   * another pass over the file, it is not returned.
+   *
+   * @param reader Reader of the observations.
+   * @param useExistingModel If true, the existing model is used as an initial
+   *     model for the estimation.
+   */
+  void Estimate(data::StreamingReader& reader,
+                const bool useExistingModel = false);
+
   /**
    * Classify the given observations as being from an individual component in
    * this GMM.  The resultant classifications are stored in the 'labels' object,
@@ -372,10 +458,14 @@ class GMM
    * double priorWeight = gmm.Weights()[2];
    * @endcode
    *
+   * Like LogProbability(), the observations are evaluated in blocks, in
+   * parallel if OpenMP is available.
+   *
    * @param observations List of observations to classify.
    * @param labels Object which will be filled with labels.
    */
-  void Classify(const arma::mat& observations,
+  template<typename eT>
+  void Classify(const arma::Mat<eT>& observations,
                 arma::Col<size_t>& labels) const;
 
   /**
@@ -398,10 +488,69 @@ class GMM
    * @param covars Covariances of the given mixture model.
    * @param weights Weights of the given mixture model.
    */
-  double LogLikelihood(const arma::mat& dataPoints,
+  template<typename eT>
+  double LogLikelihood(const arma::Mat<eT>& dataPoints,
                        const std::vector<distribution::GaussianDistribution>& distsL,
                        const arma::vec& weights) const;
 
+  HAS_MEM_FUNC(EstimateTrials, HasEstimateTrials)
+
+  //! The signature of FittingType::EstimateTrials(), if it has one.
+  typedef double(FittingType::*EstimateTrialsSignature)(const arma::mat&,
+      const arma::vec&, const size_t,
+      std::vector<distribution::GaussianDistribution>&, arma::vec&, const bool);
+
+  /**
+   * Fit the model several times and keep the fit with the greatest
+   * log-likelihood, with FittingType::EstimateTrials() (which may run the
+   * trials in parallel).  The probabilities may be empty.
+   */
+  template<typename FitterType, typename eT>
+  double EstimateTrials(FitterType& fitterL,
+      const arma::Mat<eT>& observations,
+      const arma::vec& probabilities,
+      const size_t trials,
+      const bool useExistingModel,
+      typename boost::enable_if<HasEstimateTrials<FitterType,
+          EstimateTrialsSignature> >::type* = 0);
+
+  /**
+   * Fit the model several times and keep the fit with the greatest
+   * log-likelihood, one trial after another, with FittingType::Estimate().
+   * The probabilities may be empty.
+   */
+  template<typename FitterType, typename eT>
+  double EstimateTrials(FitterType& fitterL,
+      const arma::Mat<eT>& observations,
+      const arma::vec& probabilities,
+      const size_t trials,
+      const bool useExistingModel,
+      typename boost::disable_if<HasEstimateTrials<FitterType,
+          EstimateTrialsSignature> >::type* = 0);
+
+  /**
+   * Evaluate the log-probability of each observation under the given mixture,
+   * and the component which is the most likely to have generated it, in
+   * blocks of BlockSize observations.  Either output may be NULL.
+   *
+   * @param observations Observations to evaluate.
+   * @param distsL Components of the mixture.
+   * @param weightsL Weights of the components of the mixture.
+   * @param logProbabilities Vector to store the log-probabilities in, or NULL.
+   * @param labels Vector to store the most likely components in, or NULL.
+   */
+  template<typename eT>
+  static void Score(const arma::Mat<eT>& observations,
+                    const std::vector<distribution::GaussianDistribution>&
+                        distsL,
+                    const arma::vec& weightsL,
+                    arma::vec* logProbabilities,
+                    arma::Col<size_t>* labels);
+
+  //! The number of observations evaluated together by Score(), and drawn
+  //! from one stream by Random().
+  static const size_t BlockSize = 1024;
+
   //! Locally-stored fitting object; in case the user did not pass one.
   FittingType localFitter;
 
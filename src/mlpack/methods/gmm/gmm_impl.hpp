@@ -195,6 +195,29 @@ double GMM<FittingType>::Probability(const arma::vec& observation) const
   return sum;
 }
 
+/**
+ * Return the probability of each of the given observations.
+ */
+template<typename FittingType>
+template<typename eT>
+void GMM<FittingType>::Probability(const arma::Mat<eT>& observations,
+                                   arma::vec& probabilities) const
+{
+  Score(observations, dists, weights, &probabilities, NULL);
+  probabilities = arma::exp(probabilities);
+}
+
+/**
+ * Return the log-probability of each of the given observations.
+ */
+template<typename FittingType>
+template<typename eT>
+void GMM<FittingType>::LogProbability(const arma::Mat<eT>& observations,
+                                      arma::vec& logProbabilities) const
+{
+  Score(observations, dists, weights, &logProbabilities, NULL);
+}
+
 /**
  * Return the probability of the given observation being from the given
  * component in the mixture.
@@ -230,15 +253,87 @@ arma::vec GMM<FittingType>::Random() const
     }
   }
 
-  return trans(chol(dists[gaussian].Covariance())) *
-      arma::randn<arma::vec>(dimensionality) + dists[gaussian].Mean();
+  return dists[gaussian].Random();
+}
+
+template<typename FittingType>
+void GMM<FittingType>::Random(const size_t n, arma::mat& observations) const
+{
+  observations.set_size(dimensionality, n);
+
+  // Each block of observations is drawn from its own stream.
+  const uint64_t streamKey = math::NewStreamKey();
+  const size_t numBlocks = (n + BlockSize - 1) / BlockSize;
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+      if(threads > 1 && numBlocks > 1)
+  for (size_t block = 0; block < numBlocks; ++block)
+  {
+    const size_t begin = block * BlockSize;
+    const size_t end = std::min(begin + BlockSize, n);
+
+    math::RandomStream stream(streamKey, block);
+    arma::mat blockObservations;
+    Random(end - begin, stream, blockObservations);
+    observations.cols(begin, end - 1) = blockObservations;
+  }
+}
+
+template<typename FittingType>
+void GMM<FittingType>::Random(const size_t n,
+                              math::RandomStream& stream,
+                              arma::mat& observations) const
+{
+  observations.set_size(dimensionality, n);
+  if (n == 0)
+    return;
+
+  // Draw the component of each observation.
+  const math::AliasTable table(weights);
+  arma::Col<size_t> components(n);
+  arma::Col<size_t> counts(gaussians);
+  counts.zeros();
+  for (size_t i = 0; i < n; ++i)
+  {
+    components[i] = table.Sample(stream);
+    ++counts[components[i]];
+  }
+
+  // Sort the observations by component, so that the observations of each
+  // component are generated together.
+  arma::Col<size_t> starts(gaussians);
+  for (size_t g = 0, start = 0; g < gaussians; start += counts[g], ++g)
+    starts[g] = start;
+
+  arma::Col<size_t> order(n);
+  arma::Col<size_t> next(starts);
+  for (size_t i = 0; i < n; ++i)
+    order[next[components[i]]++] = i;
+
+  arma::mat componentObservations;
+  for (size_t g = 0; g < gaussians; ++g)
+  {
+    if (counts[g] == 0)
+      continue;
+
+    dists[g].Random(counts[g], stream, componentObservations);
+    for (size_t i = 0; i < counts[g]; ++i)
+      observations.col(order[starts[g] + i]) = componentObservations.col(i);
+  }
 }
 
 /**
  * Fit the GMM to the given observations.
  */
 template<typename FittingType>
-double GMM<FittingType>::Estimate(const arma::mat& observations,
+template<typename eT>
+double GMM<FittingType>::Estimate(const arma::Mat<eT>& observations,
                                   const size_t trials,
                                   const bool useExistingModel)
 {
@@ -258,56 +353,8 @@ double GMM<FittingType>::Estimate(const arma::mat& observations,
     if (trials == 0)
       return -DBL_MAX; // It's what they asked for...
 
-    // If each trial must start from the same initial location, we must save it.
-    std::vector<distribution::GaussianDistribution> distsOrig;
-    arma::vec weightsOrig;
-    if (useExistingModel)
-    {
-      distsOrig = dists;
-      weightsOrig = weights;
-    }
-
-    // We need to keep temporary copies.  We'll do the first training into the
-    // actual model position, so that if it's the best we don't need to copy it.
-    fitter.Estimate(observations, dists, weights,
+    bestLikelihood = EstimateTrials(fitter, observations, arma::vec(), trials,
         useExistingModel);
-
-    bestLikelihood = LogLikelihood(observations, dists, weights);
-
-    Log::Info << "GMM::Estimate(): Log-likelihood of trial 0 is "
-        << bestLikelihood << "." << std::endl;
-
-    // Now the temporary model.
-    std::vector<distribution::GaussianDistribution> distsTrial(gaussians,
-        distribution::GaussianDistribution(dimensionality));
-    arma::vec weightsTrial(gaussians);
-
-    for (size_t trial = 1; trial < trials; ++trial)
-    {
-      if (useExistingModel)
-      {
-        distsTrial = distsOrig;
-        weightsTrial = weightsOrig;
-      }
-
-      fitter.Estimate(observations, distsTrial, weightsTrial, useExistingModel);
-
-      // Check to see if the log-likelihood of this one is better.
-      double newLikelihood = LogLikelihood(observations, distsTrial,
-          weightsTrial);
-
-      Log::Info << "GMM::Estimate(): Log-likelihood of trial " << trial
-          << " is " << newLikelihood << "." << std::endl;
-
-      if (newLikelihood > bestLikelihood)
-      {
-        // Save new likelihood and copy new model.
-        bestLikelihood = newLikelihood;
-
-        dists = distsTrial;
-        weights = weightsTrial;
-      }
-    }
   }
 
   // Report final log-likelihood and return it.
@@ -316,12 +363,28 @@ double GMM<FittingType>::Estimate(const arma::mat& observations,
   return bestLikelihood;
 }
 
+/**
+ * Fit the GMM to the observations read by the given reader.
+ */
+template<typename FittingType>
+void GMM<FittingType>::Estimate(data::StreamingReader& reader,
+                                const bool useExistingModel)
+{
+  if (reader.Dimensionality() != dimensionality)
+    Log::Fatal << "GMM::Estimate(): observations in '" << reader.Filename()
+        << "' have dimensionality " << reader.Dimensionality() << ", but the "
+        << "model has dimensionality " << dimensionality << "!" << std::endl;
+
+  fitter.Estimate(reader, dists, weights, useExistingModel);
+}
+
 /**
  * Fit the GMM to the given observations, each of which has a certain
  * probability of being from this distribution.
  */
 template<typename FittingType>
-double GMM<FittingType>::Estimate(const arma::mat& observations,
+template<typename eT>
+double GMM<FittingType>::Estimate(const arma::Mat<eT>& observations,
                                   const arma::vec& probabilities,
                                   const size_t trials,
                                   const bool useExistingModel)
@@ -342,62 +405,108 @@ double GMM<FittingType>::Estimate(const arma::mat& observations,
     if (trials == 0)
       return -DBL_MAX; // It's what they asked for...
 
-    // If each trial must start from the same initial location, we must save it.
-    std::vector<distribution::GaussianDistribution> distsOrig;
-    arma::vec weightsOrig;
-    if (useExistingModel)
-    {
-      distsOrig = dists;
-      weightsOrig = weights;
-    }
+    bestLikelihood = EstimateTrials(fitter, observations, probabilities,
+        trials, useExistingModel);
+  }
 
-    // We need to keep temporary copies.  We'll do the first training into the
-    // actual model position, so that if it's the best we don't need to copy it.
-    fitter.Estimate(observations, probabilities, dists, weights,
+  // Report final log-likelihood and return it.
+  Log::Info << "GMM::Estimate(): log-likelihood of trained GMM is "
+      << bestLikelihood << "." << std::endl;
+  return bestLikelihood;
+}
+
+/**
+ * Fit the GMM several times with the trials of the fitter.
+ */
+template<typename FittingType>
+template<typename FitterType, typename eT>
+double GMM<FittingType>::EstimateTrials(
+    FitterType& fitterL,
+    const arma::Mat<eT>& observations,
+    const arma::vec& probabilities,
+    const size_t trials,
+    const bool useExistingModel,
+    typename boost::enable_if<HasEstimateTrials<FitterType,
+        EstimateTrialsSignature> >::type*)
+{
+  fitterL.EstimateTrials(observations, probabilities, trials, dists, weights,
+      useExistingModel);
+  return LogLikelihood(observations, dists, weights);
+}
+
+/**
+ * Fit the GMM several times, one trial after another.
+ */
+template<typename FittingType>
+template<typename FitterType, typename eT>
+double GMM<FittingType>::EstimateTrials(
+    FitterType& fitterL,
+    const arma::Mat<eT>& observations,
+    const arma::vec& probabilities,
+    const size_t trials,
+    const bool useExistingModel,
+    typename boost::disable_if<HasEstimateTrials<FitterType,
+        EstimateTrialsSignature> >::type*)
+{
+  // If each trial must start from the same initial location, we must save it.
+  std::vector<distribution::GaussianDistribution> distsOrig;
+  arma::vec weightsOrig;
+  if (useExistingModel)
+  {
+    distsOrig = dists;
+    weightsOrig = weights;
+  }
+
+  // We need to keep temporary copies.  We'll do the first training into the
+  // actual model position, so that if it's the best we don't need to copy it.
+  if (probabilities.is_empty())
+    fitterL.Estimate(observations, dists, weights, useExistingModel);
+  else
+    fitterL.Estimate(observations, probabilities, dists, weights,
         useExistingModel);
 
-    bestLikelihood = LogLikelihood(observations, dists, weights);
+  double bestLikelihood = LogLikelihood(observations, dists, weights);
 
-    Log::Debug << "GMM::Estimate(): Log-likelihood of trial 0 is "
-        << bestLikelihood << "." << std::endl;
+  Log::Info << "GMM::Estimate(): Log-likelihood of trial 0 is "
+      << bestLikelihood << "." << std::endl;
 
-    // Now the temporary model.
-    std::vector<distribution::GaussianDistribution> distsTrial(gaussians,
-        distribution::GaussianDistribution(dimensionality));
-    arma::vec weightsTrial(gaussians);
+  // Now the temporary model.
+  std::vector<distribution::GaussianDistribution> distsTrial(gaussians,
+      distribution::GaussianDistribution(dimensionality));
+  arma::vec weightsTrial(gaussians);
 
-    for (size_t trial = 1; trial < trials; ++trial)
+  for (size_t trial = 1; trial < trials; ++trial)
+  {
+    if (useExistingModel)
     {
-      if (useExistingModel)
-      {
-        distsTrial = distsOrig;
-        weightsTrial = weightsOrig;
-      }
+      distsTrial = distsOrig;
+      weightsTrial = weightsOrig;
+    }
 
-      fitter.Estimate(observations, distsTrial, weightsTrial,
+    if (probabilities.is_empty())
+      fitterL.Estimate(observations, distsTrial, weightsTrial,
+          useExistingModel);
+    else
+      fitterL.Estimate(observations, probabilities, distsTrial, weightsTrial,
           useExistingModel);
 
-      // Check to see if the log-likelihood of this one is better.
-      double newLikelihood = LogLikelihood(observations, distsTrial,
-          weightsTrial);
+    // Check to see if the log-likelihood of this one is better.
+    double newLikelihood = LogLikelihood(observations, distsTrial,
+        weightsTrial);
 
-      Log::Debug << "GMM::Estimate(): Log-likelihood of trial " << trial
-          << " is " << newLikelihood << "." << std::endl;
+    Log::Info << "GMM::Estimate(): Log-likelihood of trial " << trial
+        << " is " << newLikelihood << "." << std::endl;
 
-      if (newLikelihood > bestLikelihood)
-      {
-        // Save new likelihood and copy new model.
-        bestLikelihood = newLikelihood;
+    if (newLikelihood > bestLikelihood)
+    {
+      // Save new likelihood and copy new model.
+      bestLikelihood = newLikelihood;
 
-        dists = distsTrial;
-        weights = weightsTrial;
-      }
+      dists = distsTrial;
+      weights = weightsTrial;
     }
   }
 
-  // Report final log-likelihood and return it.
-  Log::Info << "GMM::Estimate(): log-likelihood of trained GMM is "
-      << bestLikelihood << "." << std::endl;
   return bestLikelihood;
 }
 
@@ -406,53 +515,101 @@ double GMM<FittingType>::Estimate(const arma::mat& observations,
  * GMM.
  */
 template<typename FittingType>
-void GMM<FittingType>::Classify(const arma::mat& observations,
+template<typename eT>
+void GMM<FittingType>::Classify(const arma::Mat<eT>& observations,
                                 arma::Col<size_t>& labels) const
 {
-  // This is not the best way to do this!
-
-  // We should not have to fill this with values, because each one should be
-  // overwritten.
-  labels.set_size(observations.n_cols);
-  for (size_t i = 0; i < observations.n_cols; ++i)
-  {
-    // Find maximum probability component.
-    double probability = 0;
-    for (size_t j = 0; j < gaussians; ++j)
-    {
-      double newProb = Probability(observations.unsafe_col(i), j);
-      if (newProb >= probability)
-      {
-        probability = newProb;
-        labels[i] = j;
-      }
-    }
-  }
+  Score(observations, dists, weights, NULL, &labels);
 }
 
 /**
  * Get the log-likelihood of this data's fit to the model.
  */
 template<typename FittingType>
+template<typename eT>
 double GMM<FittingType>::LogLikelihood(
-    const arma::mat& data,
+    const arma::Mat<eT>& data,
     const std::vector<distribution::GaussianDistribution>& distsL,
     const arma::vec& weightsL) const
 {
-  double loglikelihood = 0;
-  arma::vec phis;
-  arma::mat likelihoods(gaussians, data.n_cols);
+  arma::vec logProbabilities;
+  Score(data, distsL, weightsL, &logProbabilities, NULL);
+  return arma::accu(logProbabilities);
+}
 
-  for (size_t i = 0; i < gaussians; i++)
+/**
+ * Evaluate every component on blocks of observations.
+ */
+template<typename FittingType>
+template<typename eT>
+void GMM<FittingType>::Score(
+    const arma::Mat<eT>& observations,
+    const std::vector<distribution::GaussianDistribution>& distsL,
+    const arma::vec& weightsL,
+    arma::vec* logProbabilities,
+    arma::Col<size_t>* labels)
+{
+  if (logProbabilities)
+    logProbabilities->set_size(observations.n_cols);
+  if (labels)
+    labels->set_size(observations.n_cols);
+
+  const arma::vec logWeights = arma::log(weightsL);
+  const size_t numBlocks = (observations.n_cols + BlockSize - 1) / BlockSize;
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  #pragma omp parallel num_threads(threads) if(threads > 1 && numBlocks > 1)
   {
-    distsL[i].Probability(data, phis);
-    likelihoods.row(i) = weightsL(i) * trans(phis);
-  }
+    // Row i of componentLogProbs holds the weighted log-probabilities of the
+    // observations of the block under component i.
+    arma::mat componentLogProbs;
+    arma::vec logProbs;
+    arma::mat buffer;
+
+    #pragma omp for schedule(static)
+    for (size_t block = 0; block < numBlocks; ++block)
+    {
+      const size_t begin = block * BlockSize;
+      const size_t end = std::min(begin + BlockSize,
+          (size_t) observations.n_cols);
 
-  // Now sum over every point.
-  for (size_t j = 0; j < data.n_cols; j++)
-    loglikelihood += log(accu(likelihoods.col(j)));
-  return loglikelihood;
+      // Single-precision blocks are converted to double precision.
+      const arma::mat blockObservations(const_cast<double*>(ObservationBlock(
+          observations, begin, end, buffer)), observations.n_rows, end - begin,
+          false, true);
+
+      componentLogProbs.set_size(distsL.size(), end - begin);
+      for (size_t i = 0; i < distsL.size(); ++i)
+      {
+        distsL[i].LogProbability(blockObservations, logProbs);
+        componentLogProbs.row(i) = logWeights[i] + arma::trans(logProbs);
+      }
+
+      for (size_t j = 0; j < end - begin; ++j)
+      {
+        arma::uword best;
+        const double maxLogProb = componentLogProbs.unsafe_col(j).max(best);
+
+        if (labels)
+          (*labels)[begin + j] = best;
+
+        if (logProbabilities)
+        {
+          // log(sum(exp(x))) = max + log(sum(exp(x - max))).
+          if (maxLogProb == -std::numeric_limits<double>::infinity())
+            (*logProbabilities)[begin + j] = maxLogProb;
+          else
+            (*logProbabilities)[begin + j] = maxLogProb + std::log(arma::accu(
+                arma::exp(componentLogProbs.col(j) - maxLogProb)));
+        }
+      }
+    }
+  }
 }
 
 /**
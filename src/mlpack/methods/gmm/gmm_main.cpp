@@ -5,9 +5,11 @@
  * This program trains a mixture of Gaussians on a given data matrix.
  */
 #include <mlpack/core.hpp>
+#include <mlpack/core/util/server.hpp>
 
 #include "gmm.hpp"
 #include "no_constraint.hpp"
+#include "online_em_fit.hpp"
 
 #include <mlpack/methods/kmeans/refined_start.hpp>
 
@@ -34,13 +36,41 @@ PROGRAM_INFO("Gaussian Mixture Model (GMM) Training",
     "iteration of the EM algorithm which ensure that the covariance matrices "
     "are positive definite.  Specifying the flag can cause faster runtime, "
     "but may also cause non-positive definite covariance matrices, which will "
-    "cause the program to crash.");
+    "cause the program to crash."
+    "\n\n"
+    "The model is fit --trials times, from different k-means clusterings, and "
+    "the fit with the greatest log-likelihood is kept; the trials run in "
+    "parallel.  If --abandon_iterations is not 0, the trials are compared "
+    "after that many iterations, and those whose log-likelihood per point "
+    "trails that of the best trial by more than --abandon_margin are not "
+    "iterated further."
+    "\n\n"
+    "If the 'online' flag is set, the model is fit with stepwise EM instead: "
+    "the dataset is read in blocks of --batch_size points, so it does not have "
+    "to fit in memory, and the model is updated after each block, with a step "
+    "size that decays as (t + 2)^(-decay) after t blocks.  The --passes option "
+    "gives the number of passes over the dataset.  Only one trial is performed,"
+    " and the --noise, --refined_start and --max_iterations options are not "
+    "used."
+    "\n\n"
+    "If --single_precision (-f) is specified, the dataset is loaded in single "
+    "precision, which halves its memory (without --online, which never holds "
+    "the whole dataset).  The model is still fit in double precision: the "
+    "points are converted in blocks as they are processed."
+    "\n\n"
+    "With --server, the trained model is kept in memory after it is saved, and "
+    "points are evaluated as they are requested, on the standard input and "
+    "output (--server -) or on a Unix socket created at the given path.  Each "
+    "request is a line 'probability <n>' or 'classify <n>' followed by n lines "
+    "of points (as in a CSV file); the response is a line 'OK <n>' followed by"
+    " the density of the model at each point, or the most probable Gaussian "
+    "of each point, one per line.");
 
 PARAM_STRING_REQ("input_file", "File containing the data on which the model "
     "will be fit.", "i");
 PARAM_INT("gaussians", "Number of Gaussians in the GMM.", "g", 1);
 PARAM_STRING("output_file", "The file to write the trained GMM parameters into "
-    "(as XML).", "o", "gmm.xml");
+    "(as XML, or in binary if the extension is .bin).", "o", "gmm.xml");
 PARAM_INT("seed", "Random seed.  If 0, 'std::time(NULL)' is used.", "s", 0);
 PARAM_INT("trials", "Number of trials to perform in training GMM.", "t", 10);
 
@@ -50,6 +80,24 @@ PARAM_FLAG("no_force_positive", "Do not force the covariance matrices to be "
     "positive definite.", "P");
 PARAM_INT("max_iterations", "Maximum number of iterations of EM algorithm "
     "(passing 0 will run until convergence).", "n", 250);
+PARAM_INT("abandon_iterations", "Number of iterations after which the trials "
+    "are compared, and those far behind the best are abandoned (0 never "
+    "abandons a trial).", "", 0);
+PARAM_DOUBLE("abandon_margin", "Margin in log-likelihood per point by which a "
+    "trial must trail the best trial to be abandoned.", "", 0.1);
+
+// Parameters for stepwise EM.
+PARAM_FLAG("online", "Fit the model with stepwise EM, reading the dataset in "
+    "blocks.", "O");
+PARAM_INT("batch_size", "If using --online, the number of points in each "
+    "block.", "b", 10000);
+PARAM_INT("passes", "If using --online, the number of passes over the "
+    "dataset.", "a", 1);
+PARAM_DOUBLE("decay", "If using --online, the exponent of the step size "
+    "(between 0.5 and 1).", "d", 0.6);
+
+PARAM_FLAG("single_precision", "Load the dataset in single precision (see "
+    "above).", "f");
 
 // Parameters for dataset modification.
 PARAM_DOUBLE("noise", "Variance of zero-mean Gaussian noise to add to data.",
@@ -64,33 +112,95 @@ PARAM_DOUBLE("percentage", "If using --refined_start, specify the percentage of"
     " the dataset used for each sampling (should be between 0.0 and 1.0).",
     "p", 0.02);
 
-int main(int argc, char* argv[])
+PARAM_STRING("server", "If specified, after training, serve requests for the "
+    "density of points and their most probable Gaussians on the standard "
+    "input and output ('-') or on a Unix socket created at this path.", "",
+    "");
+
+/**
+ * Answers 'probability' and 'classify' requests for the Server with a trained
+ * model.
+ */
+class GMMHandler
 {
-  CLI::ParseCommandLine(argc, argv);
+ public:
+  GMMHandler(const GMM<>& model) : model(model) { }
 
-  // Check parameters and load data.
-  if (CLI::GetParam<int>("seed") != 0)
-    math::RandomSeed((size_t) CLI::GetParam<int>("seed"));
-  else
-    math::RandomSeed((size_t) std::time(NULL));
+  bool Handle(const ServerRequest& request, ServerResponse& response)
+  {
+    if (request.command != "probability" && request.command != "classify")
+    {
+      response.error = "unknown command '" + request.command + "'; the "
+          "commands are 'probability' and 'classify'";
+      return false;
+    }
 
-  arma::mat dataPoints;
-  data::Load(CLI::GetParam<string>("input_file"), dataPoints,
-      true);
+    if (request.data.n_cols == 0)
+      return true;
 
-  const int gaussians = CLI::GetParam<int>("gaussians");
-  if (gaussians <= 0)
-  {
-    Log::Fatal << "Invalid number of Gaussians (" << gaussians << "); must "
-        "be greater than or equal to 1." << std::endl;
+    if (request.data.n_rows != model.Dimensionality())
+    {
+      ostringstream error;
+      error << "points have " << request.data.n_rows << " dimensions, but the "
+          << "model has " << model.Dimensionality();
+      response.error = error.str();
+      return false;
+    }
+
+    if (request.command == "probability")
+    {
+      arma::vec probabilities;
+      model.Probability(request.data, probabilities);
+      response.data = trans(probabilities);
+    }
+    else
+    {
+      arma::Col<size_t> labels;
+      model.Classify(request.data, labels);
+      response.data = trans(arma::conv_to<arma::vec>::from(labels));
+    }
+
+    return true;
   }
 
+ private:
+  //! The model.
+  const GMM<>& model;
+};
+
+//! Serve requests with the model saved in the given file, if --server is given.
+void ServeModel(const string& modelFile)
+{
+  if (!CLI::HasParam("server"))
+    return;
+
+  // The model types of the fitters differ, but all models are saved alike.
+  GMM<> model;
+  model.Load(modelFile);
+
+  GMMHandler handler(model);
+  Server<GMMHandler> server(handler);
+  server.Run(CLI::GetParam<string>("server"));
+}
+
+/**
+ * Load the dataset as the given matrix type, fit the model, and save it.
+ * Return the log-likelihood of the model.
+ */
+template<typename MatType>
+double FitModel(const int gaussians, const bool forcePositive)
+{
+  MatType dataPoints;
+  data::Load(CLI::GetParam<string>("input_file"), dataPoints,
+      true);
+
   // Do we need to add noise to the dataset?
   if (CLI::HasParam("noise"))
   {
     Timer::Start("noise_addition");
     const double noise = CLI::GetParam<double>("noise");
-    dataPoints += noise * arma::randn(dataPoints.n_rows, dataPoints.n_cols);
+    dataPoints += noise * arma::randn<MatType>(dataPoints.n_rows,
+        dataPoints.n_cols);
     Log::Info << "Added zero-mean Gaussian noise with variance " << noise
         << " to dataset." << std::endl;
     Timer::Stop("noise_addition");
@@ -99,7 +209,15 @@ int main(int argc, char* argv[])
   // Gather parameters for EMFit object.
   const size_t maxIterations = (size_t) CLI::GetParam<int>("max_iterations");
   const double tolerance = CLI::GetParam<double>("tolerance");
-  const bool forcePositive = !CLI::HasParam("no_force_positive");
+  const int abandonIterations = CLI::GetParam<int>("abandon_iterations");
+  const double abandonMargin = CLI::GetParam<double>("abandon_margin");
+  if (abandonIterations < 0)
+    Log::Fatal << "Invalid number of iterations before abandoning trials ("
+        << abandonIterations << "); must be greater than or equal to 0."
+        << std::endl;
+  if (abandonMargin < 0.0)
+    Log::Fatal << "Invalid margin to abandon trials (" << abandonMargin
+        << "); must be greater than or equal to 0." << std::endl;
 
   // This gets a bit weird because we need different types depending on whether
   // --refined_start is specified.
@@ -117,7 +235,8 @@ int main(int argc, char* argv[])
       Log::Fatal << "Percentage for sampling (" << percentage << ") must be "
           << "greater than 0.0 and less than or equal to 1.0!" << std::endl;
 
-    typedef KMeans<metric::SquaredEuclideanDistance, RefinedStart> KMeansType;
+    typedef KMeans<metric::SquaredEuclideanDistance, RefinedStart,
+        MaxVarianceNewCluster, NaiveKMeans, MatType> KMeansType;
 
     // These are default parameters.
     KMeansType k(1000, metric::SquaredEuclideanDistance(),
@@ -128,6 +247,8 @@ int main(int argc, char* argv[])
     if (forcePositive)
     {
       EMFit<KMeansType> em(maxIterations, tolerance, k);
+      em.AbandonIterations() = (size_t) abandonIterations;
+      em.AbandonMargin() = abandonMargin;
 
       GMM<EMFit<KMeansType> > gmm(size_t(gaussians), dataPoints.n_rows, em);
 
@@ -142,6 +263,8 @@ int main(int argc, char* argv[])
     else
     {
       EMFit<KMeansType, NoConstraint> em(maxIterations, tolerance, k);
+      em.AbandonIterations() = (size_t) abandonIterations;
+      em.AbandonMargin() = abandonMargin;
 
       GMM<EMFit<KMeansType, NoConstraint> > gmm(size_t(gaussians),
           dataPoints.n_rows, em);
@@ -157,13 +280,18 @@ int main(int argc, char* argv[])
   }
   else
   {
+    typedef KMeans<metric::EuclideanDistance, RandomPartition,
+        MaxVarianceNewCluster, NaiveKMeans, MatType> KMeansType;
+
     // Depending on the value of forcePositive, we have to use different types.
     if (forcePositive)
     {
-      EMFit<> em(maxIterations, tolerance);
+      EMFit<KMeansType> em(maxIterations, tolerance);
+      em.AbandonIterations() = (size_t) abandonIterations;
+      em.AbandonMargin() = abandonMargin;
 
       // Calculate mixture of Gaussians.
-      GMM<> gmm(size_t(gaussians), dataPoints.n_rows, em);
+      GMM<EMFit<KMeansType> > gmm(size_t(gaussians), dataPoints.n_rows, em);
 
       // Compute the parameters of the model using the EM algorithm.
       Timer::Start("em");
@@ -176,10 +304,12 @@ int main(int argc, char* argv[])
     else
     {
       // Use no constraints on the covariance matrix.
-      EMFit<KMeans<>, NoConstraint> em(maxIterations, tolerance);
+      EMFit<KMeansType, NoConstraint> em(maxIterations, tolerance);
+      em.AbandonIterations() = (size_t) abandonIterations;
+      em.AbandonMargin() = abandonMargin;
 
       // Calculate mixture of Gaussians.
-      GMM<EMFit<KMeans<>, NoConstraint> > gmm(size_t(gaussians),
+      GMM<EMFit<KMeansType, NoConstraint> > gmm(size_t(gaussians),
           dataPoints.n_rows, em);
 
       // Compute the parameters of the model using the EM algorithm.
@@ -192,5 +322,79 @@ int main(int argc, char* argv[])
     }
   }
 
+  return likelihood;
+}
+
+int main(int argc, char* argv[])
+{
+  CLI::ParseCommandLine(argc, argv);
+
+  // Check parameters and load data.
+  if (CLI::GetParam<int>("seed") != 0)
+    math::RandomSeed((size_t) CLI::GetParam<int>("seed"));
+  else
+    math::RandomSeed((size_t) std::time(NULL));
+
+  const int gaussians = CLI::GetParam<int>("gaussians");
+  if (gaussians <= 0)
+  {
+    Log::Fatal << "Invalid number of Gaussians (" << gaussians << "); must "
+        "be greater than or equal to 1." << std::endl;
+  }
+
+  const bool forcePositive = !CLI::HasParam("no_force_positive");
+
+  if (CLI::HasParam("online"))
+  {
+    const int batchSize = CLI::GetParam<int>("batch_size");
+    const int passes = CLI::GetParam<int>("passes");
+    if (batchSize <= 0)
+      Log::Fatal << "Invalid batch size (" << batchSize << "); must be greater"
+          << " than or equal to 1." << std::endl;
+    if (passes <= 0)
+      Log::Fatal << "Invalid number of passes (" << passes << "); must be "
+          << "greater than or equal to 1." << std::endl;
+    if (CLI::HasParam("noise") || CLI::HasParam("refined_start") ||
+        CLI::HasParam("single_precision"))
+      Log::Warn << "--noise, --refined_start and --single_precision are "
+          << "ignored with --online." << std::endl;
+
+    data::StreamingReader reader(CLI::GetParam<string>("input_file"),
+        (size_t) batchSize);
+    const double decay = CLI::GetParam<double>("decay");
+
+    Timer::Start("em");
+    if (forcePositive)
+    {
+      OnlineEMFit<> em((size_t) batchSize, (size_t) passes, decay);
+      GMM<OnlineEMFit<> > gmm(size_t(gaussians), reader.Dimensionality(), em);
+      gmm.Estimate(reader);
+      Timer::Stop("em");
+
+      gmm.Save(CLI::GetParam<string>("output_file"));
+    }
+    else
+    {
+      typedef OnlineEMFit<KMeans<>, NoConstraint> FitterType;
+      FitterType em((size_t) batchSize, (size_t) passes, decay);
+      GMM<FitterType> gmm(size_t(gaussians), reader.Dimensionality(), em);
+      gmm.Estimate(reader);
+      Timer::Stop("em");
+
+      gmm.Save(CLI::GetParam<string>("output_file"));
+    }
+
+    ServeModel(CLI::GetParam<string>("output_file"));
+    return 0;
+  }
+
+  double likelihood;
+  if (CLI::HasParam("single_precision"))
+    likelihood = FitModel<arma::fmat>(gaussians, forcePositive);
+  else
+    likelihood = FitModel<arma::mat>(gaussians, forcePositive);
+
   Log::Info << "Log-likelihood of estimate: " << likelihood << ".\n";
+
+  ServeModel(CLI::GetParam<string>("output_file"));
 }
@@ -0,0 +1,241 @@
+/**
+ * @file mrkd_em_fit.hpp
+ *
+ * Utility class to fit a GMM with EM, where the E-step is accelerated with a
+ * multi-resolution kd-tree.  Used by GMM::Estimate<>().
+ */
+#ifndef __MLPACK_METHODS_GMM_MRKD_EM_FIT_HPP
+#define __MLPACK_METHODS_GMM_MRKD_EM_FIT_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/tree/binary_space_tree.hpp>
+#include <mlpack/core/tree/mrkd_statistic.hpp>
+
+// The initial clustering and the M-step are those of EMFit.
+#include "em_fit.hpp"
+
+namespace mlpack {
+namespace gmm {
+
+/**
+ * This class fits a GMM to observations with EM, like EMFit, but the
+ * observations are organized in a multi-resolution kd-tree (Moore, 1999), so
+ * the E-step does not have to visit every point.  Each node of the tree stores
+ * the total weight, the center of mass and the scatter matrix of its points
+ * (in an MRKDStatistic), which are computed once, when the tree is built.  In
+ * each E-step, the tree is traversed from the root; for each node, the
+ * responsibility of each component for any point in the bounding box of the
+ * node is bounded, from the distances between the box and the mean of the
+ * component and the eigenvalues of its covariance.  If every responsibility
+ * is known within MaxResponsibilityError(), the node is not descended into:
+ * the responsibilities at the center of the box are used for all its points,
+ * and the sufficient statistics of the node are added at once.  Otherwise,
+ * the children are visited, and the responsibilities for the points of a leaf
+ * are computed exactly, as with EMFit.
+ *
+ * Far fewer than N responsibilities are computed in each iteration when the
+ * data has few dimensions and many points (for instance, GPS traces), since
+ * most nodes then lie well within one component or between few components.
+ * With many dimensions the bounds are loose and nearly every leaf is visited,
+ * so EMFit should be used instead.  The log-likelihood of the points of a
+ * summarized node is approximated by that of the center of its box, so the
+ * convergence tolerance should not be much smaller than the changes this
+ * causes.
+ *
+ * If OpenMP is available, the subtrees below the top of the tree are
+ * traversed in parallel.
+ */
+template<typename InitialClusteringType = kmeans::KMeans<>,
+         typename CovarianceConstraintPolicy = PositiveDefiniteConstraint>
+class MRKDEMFit
+{
+ public:
+  //! The type of tree the observations are organized in.
+  typedef tree::BinarySpaceTree<bound::HRectBound<2>, tree::MRKDStatistic>
+      TreeType;
+
+  /**
+   * Construct the MRKDEMFit object, optionally passing an
+   * InitialClusteringType object and a CovarianceConstraintPolicy object.
+   * Setting the maximum number of iterations to 0 means that the EM algorithm
+   * will iterate until convergence (with the given tolerance).
+   *
+   * @param maxIterations Maximum number of iterations for EM.
+   * @param tolerance Log-likelihood tolerance required for convergence.
+   * @param maxResponsibilityError Largest difference between the bounds on a
+   *     responsibility for which the points of a node are summarized.
+   * @param leafSize Maximum number of points in a leaf of the tree.
+   * @param clusterer Object which will perform the initial clustering.
+   * @param constraint Object which applies constraints to the covariances.
+   */
+  MRKDEMFit(const size_t maxIterations = 300,
+            const double tolerance = 1e-5,
+            const double maxResponsibilityError = 1e-3,
+            const size_t leafSize = 20,
+            InitialClusteringType clusterer = InitialClusteringType(),
+            CovarianceConstraintPolicy constraint =
+                CovarianceConstraintPolicy());
+
+  /**
+   * Fit the observations to a Gaussian mixture model (GMM) using the EM
+   * algorithm, building a tree on a copy of the observations.  The size of the
+   * vectors (indicating the number of components) must already be set.  If
+   * useInitialModel is set to true, then the given model is used as the
+   * initial model, instead of using the InitialClusteringType::Cluster()
+   * option.
+   *
+   * @param observations List of observations to train on.
+   * @param dists Distributions to train.
+   * @param weights Vector to store a priori weights in.
+   * @param useInitialModel If true, the given model is used as the initial
+   *      model.
+   */
+  void Estimate(const arma::mat& observations,
+                std::vector<distribution::GaussianDistribution>& dists,
+                arma::vec& weights,
+                const bool useInitialModel = false);
+
+  /**
+   * Fit the observations to a Gaussian mixture model (GMM) using the EM
+   * algorithm, taking into account the probability of each point being from
+   * this mixture.  See the other overload of Estimate().
+   *
+   * @param observations List of observations to train on.
+   * @param probabilities Probability of each point being from this model.
+   * @param dists Distributions to train.
+   * @param weights Vector to store a priori weights in.
+   * @param useInitialModel If true, the given model is used as the initial
+   *      model.
+   */
+  void Estimate(const arma::mat& observations,
+                const arma::vec& probabilities,
+                std::vector<distribution::GaussianDistribution>& dists,
+                arma::vec& weights,
+                const bool useInitialModel = false);
+
+  //! Get the clusterer.
+  const InitialClusteringType& Clusterer() const { return em.Clusterer(); }
+  //! Modify the clusterer.
+  InitialClusteringType& Clusterer() { return em.Clusterer(); }
+
+  //! Get the covariance constraint policy class.
+  const CovarianceConstraintPolicy& Constraint() const
+  { return em.Constraint(); }
+  //! Modify the covariance constraint policy class.
+  CovarianceConstraintPolicy& Constraint() { return em.Constraint(); }
+
+  //! Get the maximum number of iterations of the EM algorithm.
+  size_t MaxIterations() const { return maxIterations; }
+  //! Modify the maximum number of iterations of the EM algorithm.
+  size_t& MaxIterations() { return maxIterations; }
+
+  //! Get the tolerance for the convergence of the EM algorithm.
+  double Tolerance() const { return tolerance; }
+  //! Modify the tolerance for the convergence of the EM algorithm.
+  double& Tolerance() { return tolerance; }
+
+  //! Get the largest error in a responsibility for which nodes are summarized.
+  double MaxResponsibilityError() const { return maxResponsibilityError; }
+  //! Modify the largest error in a responsibility for which nodes are
+  //! summarized (0 computes every responsibility exactly).
+  double& MaxResponsibilityError() { return maxResponsibilityError; }
+
+  //! Get the maximum number of points in a leaf of the tree.
+  size_t LeafSize() const { return leafSize; }
+  //! Modify the maximum number of points in a leaf of the tree.
+  size_t& LeafSize() { return leafSize; }
+
+  //! Get the number of points whose responsibilities were computed exactly
+  //! during the last call to Estimate().
+  size_t BaseCases() const { return baseCases; }
+  //! Get the number of nodes which were summarized during the last call to
+  //! Estimate().
+  size_t Prunes() const { return prunes; }
+
+ private:
+  /**
+   * Fit the model; probabilities may be empty, in which case every observation
+   * has weight 1.
+   */
+  void Fit(const arma::mat& observations,
+           const arma::vec& probabilities,
+           std::vector<distribution::GaussianDistribution>& dists,
+           arma::vec& weights,
+           const bool useInitialModel);
+
+  /**
+   * Compute the weight, center of mass and scatter matrix of the points of
+   * each node, bottom-up.
+   *
+   * @param node Node to compute the statistics of.
+   * @param probabilities Weight of each point (in the order of the tree), or
+   *     an empty vector.
+   */
+  void ComputeStatistics(TreeType& node, const arma::vec& probabilities);
+
+  /**
+   * Make one pass over the tree, and compute the weighted sufficient
+   * statistics of each component relative to its current mean, as
+   * EMFit::Accumulate() does.
+   *
+   * @return Log-likelihood of the current model.
+   */
+  double Accumulate(TreeType& root,
+                    const arma::vec& probabilities,
+                    const std::vector<distribution::GaussianDistribution>&
+                        dists,
+                    const arma::vec& weights,
+                    arma::vec& sumWeights,
+                    arma::mat& sumDiffs,
+                    std::vector<arma::mat>& sumOuter);
+
+  /**
+   * Add the statistics of the points of the given node to the given sums,
+   * summarizing the node if the responsibilities are tight enough, and
+   * recursing otherwise.
+   */
+  void AccumulateNode(TreeType& node,
+                      const arma::vec& probabilities,
+                      const std::vector<distribution::GaussianDistribution>&
+                          dists,
+                      const arma::vec& logWeights,
+                      arma::vec& sumWeights,
+                      arma::mat& sumDiffs,
+                      std::vector<arma::mat>& sumOuter,
+                      double& logLikelihood,
+                      size_t& zeroPoints,
+                      size_t& nodeBaseCases,
+                      size_t& nodePrunes) const;
+
+  //! Maximum iterations of EM algorithm.
+  size_t maxIterations;
+  //! Tolerance for convergence of EM.
+  double tolerance;
+  //! Largest error in a responsibility for which nodes are summarized.
+  double maxResponsibilityError;
+  //! Maximum number of points in a leaf.
+  size_t leafSize;
+
+  //! Log of the density of each component at its mean.
+  arma::vec logPeaks;
+  //! Smallest eigenvalue of the inverse covariance of each component.
+  arma::vec minPrecisions;
+  //! Largest eigenvalue of the inverse covariance of each component.
+  arma::vec maxPrecisions;
+
+  //! Number of responsibilities computed exactly.
+  size_t baseCases;
+  //! Number of nodes summarized.
+  size_t prunes;
+
+  //! The EM fitter, for the initial clustering, leaves and the M-step.
+  EMFit<InitialClusteringType, CovarianceConstraintPolicy> em;
+};
+
+}; // namespace gmm
+}; // namespace mlpack
+
+// Include implementation.
+#include "mrkd_em_fit_impl.hpp"
+
+#endif
@@ -0,0 +1,459 @@
+/**
+ * @file mrkd_em_fit_impl.hpp
+ *
+ * Implementation of EM for fitting GMMs with a multi-resolution kd-tree.
+ */
+#ifndef __MLPACK_METHODS_GMM_MRKD_EM_FIT_IMPL_HPP
+#define __MLPACK_METHODS_GMM_MRKD_EM_FIT_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "mrkd_em_fit.hpp"
+
+namespace mlpack {
+namespace gmm {
+
+//! Constructor.
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::MRKDEMFit(
+    const size_t maxIterations,
+    const double tolerance,
+    const double maxResponsibilityError,
+    const size_t leafSize,
+    InitialClusteringType clusterer,
+    CovarianceConstraintPolicy constraint) :
+    maxIterations(maxIterations),
+    tolerance(tolerance),
+    maxResponsibilityError(maxResponsibilityError),
+    leafSize(leafSize),
+    baseCases(0),
+    prunes(0),
+    em(maxIterations, tolerance, clusterer, constraint)
+{ /* Nothing to do. */ }
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::Estimate(
+    const arma::mat& observations,
+    std::vector<distribution::GaussianDistribution>& dists,
+    arma::vec& weights,
+    const bool useInitialModel)
+{
+  Fit(observations, arma::vec(), dists, weights, useInitialModel);
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::Estimate(
+    const arma::mat& observations,
+    const arma::vec& probabilities,
+    std::vector<distribution::GaussianDistribution>& dists,
+    arma::vec& weights,
+    const bool useInitialModel)
+{
+  Fit(observations, probabilities, dists, weights, useInitialModel);
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::Fit(
+    const arma::mat& observations,
+    const arma::vec& probabilities,
+    std::vector<distribution::GaussianDistribution>& dists,
+    arma::vec& weights,
+    const bool useInitialModel)
+{
+  if (leafSize == 0)
+    Log::Fatal << "MRKDEMFit::Estimate(): leaf size must be greater than 0!"
+        << std::endl;
+  if (observations.n_cols == 0)
+    Log::Fatal << "MRKDEMFit::Estimate(): no observations!" << std::endl;
+
+  if (!useInitialModel)
+    em.InitialClustering(observations, dists, weights);
+
+  baseCases = 0;
+  prunes = 0;
+
+  // Build the tree on a copy of the observations; the probabilities are
+  // rearranged like the points.
+  arma::mat data(observations);
+  std::vector<size_t> oldFromNew;
+  TreeType tree(data, oldFromNew, leafSize);
+
+  arma::vec treeProbabilities;
+  if (!probabilities.is_empty())
+  {
+    treeProbabilities.set_size(probabilities.n_elem);
+    for (size_t i = 0; i < oldFromNew.size(); ++i)
+      treeProbabilities[i] = probabilities[oldFromNew[i]];
+  }
+
+  ComputeStatistics(tree, treeProbabilities);
+  const double totalWeight = tree.Stat().Weight();
+
+  arma::vec sumWeights;
+  arma::mat sumDiffs;
+  std::vector<arma::mat> sumOuter;
+  double l = Accumulate(tree, treeProbabilities, dists, weights, sumWeights,
+      sumDiffs, sumOuter);
+
+  Log::Debug << "MRKDEMFit::Estimate(): initial clustering log-likelihood: "
+      << l << std::endl;
+
+  double lOld = -DBL_MAX;
+
+  // Iterate to update the model until no more improvement is found.
+  size_t iteration = 1;
+  while (std::abs(l - lOld) > tolerance && iteration != maxIterations)
+  {
+    Log::Info << "MRKDEMFit::Estimate(): iteration " << iteration << ", "
+        << "log-likelihood " << l << "." << std::endl;
+
+    // Calculate the new means, covariances and weights.
+    em.Update(sumWeights, sumDiffs, sumOuter, totalWeight, dists, weights);
+
+    // Update values of l; calculate new log-likelihood.
+    lOld = l;
+    l = Accumulate(tree, treeProbabilities, dists, weights, sumWeights,
+        sumDiffs, sumOuter);
+
+    iteration++;
+  }
+
+  Log::Info << "MRKDEMFit::Estimate(): " << baseCases << " responsibilities "
+      << "computed and " << prunes << " nodes summarized in " << iteration
+      << " iterations." << std::endl;
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::
+ComputeStatistics(TreeType& node, const arma::vec& probabilities)
+{
+  tree::MRKDStatistic& stat = node.Stat();
+  stat.Begin() = node.Begin();
+  stat.Count() = node.Count();
+
+  const size_t dimension = node.Dataset().n_rows;
+  if (node.IsLeaf())
+  {
+    if (node.Count() == 0)
+    {
+      stat.Weight() = 0.0;
+      stat.CenterOfMass().zeros(dimension);
+      stat.Scatter().zeros(dimension, dimension);
+      return;
+    }
+
+    const size_t end = node.Begin() + node.Count() - 1;
+    const arma::mat points = node.Dataset().cols(node.Begin(), end);
+    const arma::vec pointWeights = probabilities.is_empty() ?
+        arma::vec(arma::ones<arma::vec>(node.Count())) :
+        arma::vec(probabilities.subvec(node.Begin(), end));
+
+    math::Covariance(points, pointWeights, stat.CenterOfMass(),
+        stat.Scatter());
+    stat.Weight() = arma::accu(pointWeights);
+    stat.Scatter() *= stat.Weight();
+    return;
+  }
+
+  // Combine the statistics of the children; the scatter of each child is moved
+  // to the center of mass of the node.
+  stat.Weight() = 0.0;
+  stat.CenterOfMass().zeros(dimension);
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+  {
+    ComputeStatistics(node.Child(i), probabilities);
+    const tree::MRKDStatistic& childStat = node.Child(i).Stat();
+    stat.Weight() += childStat.Weight();
+    stat.CenterOfMass() += childStat.Weight() * childStat.CenterOfMass();
+  }
+
+  if (stat.Weight() > 0.0)
+    stat.CenterOfMass() /= stat.Weight();
+
+  stat.Scatter().zeros(dimension, dimension);
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+  {
+    const tree::MRKDStatistic& childStat = node.Child(i).Stat();
+    const arma::vec shift = childStat.CenterOfMass() - stat.CenterOfMass();
+    stat.Scatter() += childStat.Scatter() +
+        childStat.Weight() * (shift * arma::trans(shift));
+  }
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+double MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::Accumulate(
+    TreeType& root,
+    const arma::vec& probabilities,
+    const std::vector<distribution::GaussianDistribution>& dists,
+    const arma::vec& weights,
+    arma::vec& sumWeights,
+    arma::mat& sumDiffs,
+    std::vector<arma::mat>& sumOuter)
+{
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  const size_t dimension = root.Dataset().n_rows;
+  const size_t components = dists.size();
+  const double negInfinity = -std::numeric_limits<double>::infinity();
+
+  // The log of the weight of each component, and what is needed to bound its
+  // density over a box: the density at its mean, and the extreme eigenvalues
+  // of its inverse covariance.
+  arma::vec logWeights(components);
+  logPeaks.set_size(components);
+  minPrecisions.zeros(components);
+  maxPrecisions.zeros(components);
+  arma::vec eigenvalues;
+  for (size_t i = 0; i < components; ++i)
+  {
+    logWeights[i] = (weights[i] > 0.0) ? std::log(weights[i]) : negInfinity;
+    if (logWeights[i] == negInfinity)
+      continue;
+
+    logPeaks[i] = dists[i].LogProbability(dists[i].Mean());
+    if (arma::eig_sym(eigenvalues, dists[i].Covariance()) &&
+        eigenvalues.min() > 0.0)
+    {
+      minPrecisions[i] = 1.0 / eigenvalues.max();
+      maxPrecisions[i] = 1.0 / eigenvalues.min();
+    }
+    else
+    {
+      // Nothing can be bounded.
+      maxPrecisions[i] = std::numeric_limits<double>::infinity();
+    }
+  }
+
+  // Split the top of the tree into enough subtrees for the threads to share;
+  // the top nodes hold many components, so they are rarely summarized anyway.
+  std::vector<TreeType*> subtrees(1, &root);
+  while (threads > 1 && subtrees.size() < 4 * threads)
+  {
+    std::vector<TreeType*> nextSubtrees;
+    for (size_t i = 0; i < subtrees.size(); ++i)
+    {
+      if (subtrees[i]->IsLeaf())
+        nextSubtrees.push_back(subtrees[i]);
+      for (size_t j = 0; j < subtrees[i]->NumChildren(); ++j)
+        nextSubtrees.push_back(&subtrees[i]->Child(j));
+    }
+
+    if (nextSubtrees.size() == subtrees.size())
+      break; // Only leaves are left.
+    subtrees.swap(nextSubtrees);
+  }
+
+  // Thread-local statistics, relative to the current mean of each component.
+  std::vector<arma::vec> threadWeights(threads,
+      arma::zeros<arma::vec>(components));
+  std::vector<arma::mat> threadDiffs(threads,
+      arma::zeros<arma::mat>(dimension, components));
+  std::vector<std::vector<arma::mat> > threadOuter(threads,
+      std::vector<arma::mat>(components,
+      arma::zeros<arma::mat>(dimension, dimension)));
+
+  double logLikelihood = 0.0;
+  size_t zeroPoints = 0;
+  size_t totalBaseCases = 0;
+  size_t totalPrunes = 0;
+
+  #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+      reduction(+:logLikelihood, zeroPoints, totalBaseCases, totalPrunes)
+  for (size_t i = 0; i < subtrees.size(); ++i)
+  {
+#ifdef _OPENMP
+    const size_t thread = omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+
+    AccumulateNode(*subtrees[i], probabilities, dists, logWeights,
+        threadWeights[thread], threadDiffs[thread], threadOuter[thread],
+        logLikelihood, zeroPoints, totalBaseCases, totalPrunes);
+  }
+
+  // Reduce the thread-local statistics.
+  sumWeights = threadWeights[0];
+  sumDiffs = threadDiffs[0];
+  sumOuter = threadOuter[0];
+  for (size_t t = 1; t < threads; ++t)
+  {
+    sumWeights += threadWeights[t];
+    sumDiffs += threadDiffs[t];
+    for (size_t i = 0; i < components; ++i)
+      sumOuter[i] += threadOuter[t][i];
+  }
+
+  baseCases += totalBaseCases;
+  prunes += totalPrunes;
+
+  if (zeroPoints > 0)
+    Log::Info << "Likelihood of " << zeroPoints << " points is 0!  They are "
+        << "probably outliers." << std::endl;
+
+  return logLikelihood;
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::
+AccumulateNode(TreeType& node,
+               const arma::vec& probabilities,
+               const std::vector<distribution::GaussianDistribution>& dists,
+               const arma::vec& logWeights,
+               arma::vec& sumWeights,
+               arma::mat& sumDiffs,
+               std::vector<arma::mat>& sumOuter,
+               double& logLikelihood,
+               size_t& zeroPoints,
+               size_t& nodeBaseCases,
+               size_t& nodePrunes) const
+{
+  if (node.Count() == 0)
+    return;
+
+  if (node.IsLeaf())
+  {
+    // Compute the responsibilities for each point, as EMFit does.
+    const arma::mat block = node.Dataset().cols(node.Begin(),
+        node.Begin() + node.Count() - 1);
+    em.AccumulateBlock(block, probabilities.is_empty() ? NULL :
+        probabilities.memptr() + node.Begin(), dists, logWeights, sumWeights,
+        sumDiffs, sumOuter, logLikelihood, zeroPoints);
+    nodeBaseCases += node.Count();
+    return;
+  }
+
+  const size_t dimension = node.Dataset().n_rows;
+  const size_t components = dists.size();
+  const double negInfinity = -std::numeric_limits<double>::infinity();
+  const bound::HRectBound<2>& box = node.Bound();
+
+  // Bound the log of the weighted density of each component over the box of
+  // the node, with the smallest and largest distances between the box and the
+  // mean of the component.
+  arma::vec lower(components);
+  arma::vec upper(components);
+  double maxUpper = negInfinity;
+  for (size_t i = 0; i < components; ++i)
+  {
+    if (logWeights[i] == negInfinity)
+    {
+      lower[i] = negInfinity;
+      upper[i] = negInfinity;
+      continue;
+    }
+
+    const arma::vec& mean = dists[i].Mean();
+    double minDistance = 0.0;
+    double maxDistance = 0.0;
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      const double below = box[d].Lo() - mean[d];
+      const double above = mean[d] - box[d].Hi();
+      if (below > 0.0)
+        minDistance += below * below;
+      else if (above > 0.0)
+        minDistance += above * above;
+
+      const double furthest = std::max(mean[d] - box[d].Lo(),
+          box[d].Hi() - mean[d]);
+      maxDistance += furthest * furthest;
+    }
+
+    upper[i] = logWeights[i] + logPeaks[i] - 0.5 * minPrecisions[i] *
+        minDistance;
+    lower[i] = (maxPrecisions[i] == std::numeric_limits<double>::infinity()) ?
+        negInfinity : logWeights[i] + logPeaks[i] - 0.5 * maxPrecisions[i] *
+        maxDistance;
+    maxUpper = std::max(maxUpper, upper[i]);
+  }
+
+  // The responsibility of a component is smallest where its density is lowest
+  // and the others are highest, and largest in the opposite case.
+  bool summarize = (maxResponsibilityError > 0.0 && maxUpper != negInfinity);
+  if (summarize)
+  {
+    double sumLower = 0.0;
+    double sumUpper = 0.0;
+    for (size_t i = 0; i < components; ++i)
+    {
+      lower[i] = std::exp(lower[i] - maxUpper);
+      upper[i] = std::exp(upper[i] - maxUpper);
+      sumLower += lower[i];
+      sumUpper += upper[i];
+    }
+
+    for (size_t i = 0; i < components && summarize; ++i)
+    {
+      const double maxResponsibility = (upper[i] == 0.0) ? 0.0 :
+          upper[i] / (upper[i] + sumLower - lower[i]);
+      const double minResponsibility = (lower[i] == 0.0) ? 0.0 :
+          lower[i] / (lower[i] + sumUpper - upper[i]);
+      if (maxResponsibility - minResponsibility > maxResponsibilityError)
+        summarize = false;
+    }
+  }
+
+  if (summarize)
+  {
+    // Use the responsibilities at the center of the box (which are within the
+    // bounds) for every point of the node.
+    arma::vec center(dimension);
+    for (size_t d = 0; d < dimension; ++d)
+      center[d] = box[d].Mid();
+
+    arma::vec responsibilities(components);
+    double maxLogProb = negInfinity;
+    for (size_t i = 0; i < components; ++i)
+    {
+      responsibilities[i] = (logWeights[i] == negInfinity) ? negInfinity :
+          logWeights[i] + dists[i].LogProbability(center);
+      maxLogProb = std::max(maxLogProb, responsibilities[i]);
+    }
+
+    if (maxLogProb != negInfinity)
+    {
+      double sum = 0.0;
+      for (size_t i = 0; i < components; ++i)
+      {
+        responsibilities[i] = std::exp(responsibilities[i] - maxLogProb);
+        sum += responsibilities[i];
+      }
+      responsibilities /= sum;
+      logLikelihood += node.Count() * (maxLogProb + std::log(sum));
+
+      // Add the statistics of the whole node.
+      const tree::MRKDStatistic& stat = node.Stat();
+      for (size_t i = 0; i < components; ++i)
+      {
+        if (responsibilities[i] == 0.0)
+          continue;
+
+        const double weight = responsibilities[i] * stat.Weight();
+        const arma::vec diff = stat.CenterOfMass() - dists[i].Mean();
+        sumWeights[i] += weight;
+        sumDiffs.col(i) += weight * diff;
+        sumOuter[i] += responsibilities[i] * stat.Scatter() +
+            weight * (diff * arma::trans(diff));
+      }
+
+      ++nodePrunes;
+      return;
+    }
+  }
+
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+  {
+    AccumulateNode(node.Child(i), probabilities, dists, logWeights, sumWeights,
+        sumDiffs, sumOuter, logLikelihood, zeroPoints, nodeBaseCases,
+        nodePrunes);
+  }
+}
+
+}; // namespace gmm
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,217 @@
+/**
+ * @file online_em_fit.hpp
+ *
+ * Utility class to fit a GMM with stepwise (online) EM, one mini-batch of
+ * observations at a time.  Used by GMM::Estimate<>().
+ */
+#ifndef __MLPACK_METHODS_GMM_ONLINE_EM_FIT_HPP
+#define __MLPACK_METHODS_GMM_ONLINE_EM_FIT_HPP
+
+#include <mlpack/core.hpp>
+
+// The initial clustering and the E-step are those of EMFit.
+#include "em_fit.hpp"
+
+namespace mlpack {
+namespace gmm {
+
+/**
+ * This class fits a GMM to observations with stepwise EM (Cappe and Moulines,
+ * 2009; Liang and Klein, 2009).  Instead of making a full pass over the
+ * observations for each update, as EMFit does, the model is updated after
+ * each mini-batch of observations: the responsibilities of the components for
+ * the points of the batch are computed (in log-space, as with EMFit), and the
+ * sufficient statistics of the model are moved towards the statistics of the
+ * batch with the step size
+ *
+ *   eta_t = (t + 2)^(-decay),
+ *
+ * where t is the number of steps taken so far.  The decay must be in
+ * (0.5, 1] for the model to converge; smaller values forget old batches
+ * faster.
+ *
+ * The only state kept between batches is the number of steps, since the
+ * sufficient statistics are recovered from the current model; so a model can
+ * be kept up to date with new observations by calling Estimate() (or Step())
+ * with useInitialModel set to true, without fitting it again from scratch.
+ * The observations may also be read from a file in blocks, with a
+ * data::StreamingReader, so they do not have to fit in memory:
+ *
+ * @code
+ * GMM<OnlineEMFit<> > gmm(5, 10);
+ * data::StreamingReader reader("events.csv", 10000);
+ * gmm.Estimate(reader);
+ *
+ * // Later, update the model with new events.
+ * data::StreamingReader newReader("new_events.csv", 10000);
+ * gmm.Estimate(newReader, true);
+ * @endcode
+ *
+ * The initial model is found as with EMFit, with the given clustering
+ * mechanism (on the whole dataset, or on the first block of a reader).
+ */
+template<typename InitialClusteringType = kmeans::KMeans<>,
+         typename CovarianceConstraintPolicy = PositiveDefiniteConstraint>
+class OnlineEMFit
+{
+ public:
+  /**
+   * Construct the OnlineEMFit object, optionally passing an
+   * InitialClusteringType object and a CovarianceConstraintPolicy object.
+   *
+   * @param batchSize Number of observations in each mini-batch (when the
+   *     observations are given as a matrix).
+   * @param passes Number of passes over the observations.
+   * @param decay Exponent of the step size, in (0.5, 1].
+   * @param clusterer Object which will perform the initial clustering.
+   * @param constraint Object which applies constraints to the covariances.
+   */
+  OnlineEMFit(const size_t batchSize = 1000,
+              const size_t passes = 1,
+              const double decay = 0.6,
+              InitialClusteringType clusterer = InitialClusteringType(),
+              CovarianceConstraintPolicy constraint =
+                  CovarianceConstraintPolicy());
+
+  /**
+   * Fit the observations to a Gaussian mixture model (GMM) using stepwise EM,
+   * with mini-batches of observations drawn in a random order for each pass.
+   * The size of the vectors (indicating the number of components) must
+   * already be set.  If useInitialModel is set to true, then the given model
+   * is the initial model and the steps continue from those taken before;
+   * otherwise the InitialClusteringType::Cluster() method gives the initial
+   * model.
+   *
+   * @param observations List of observations to train on.
+   * @param dists Distributions to train.
+   * @param weights Vector to store a priori weights in.
+   * @param useInitialModel If true, the given model is used as the initial
+   *      model.
+   */
+  void Estimate(const arma::mat& observations,
+                std::vector<distribution::GaussianDistribution>& dists,
+                arma::vec& weights,
+                const bool useInitialModel = false);
+
+  /**
+   * Fit the observations to a Gaussian mixture model (GMM) using stepwise EM,
+   * taking into account the probability of each point being from this
+   * mixture.  See the other overload of Estimate().
+   *
+   * @param observations List of observations to train on.
+   * @param probabilities Probability of each point being from this model.
+   * @param dists Distributions to train.
+   * @param weights Vector to store a priori weights in.
+   * @param useInitialModel If true, the given model is used as the initial
+   *      model.
+   */
+  void Estimate(const arma::mat& observations,
+                const arma::vec& probabilities,
+                std::vector<distribution::GaussianDistribution>& dists,
+                arma::vec& weights,
+                const bool useInitialModel = false);
+
+  /**
+   * Fit the observations read by the given reader to a Gaussian mixture model
+   * (GMM) using stepwise EM, with one step for each block of the reader (so
+   * the batch size is the block size of the reader).  The reader is reset
+   * before each pass.  If useInitialModel is false, the initial model is
+   * found by clustering the first block.
+   *
+   * @param reader Reader of the observations.
+   * @param dists Distributions to train.
+   * @param weights Vector to store a priori weights in.
+   * @param useInitialModel If true, the given model is used as the initial
+   *      model.
+   */
+  void Estimate(data::StreamingReader& reader,
+                std::vector<distribution::GaussianDistribution>& dists,
+                arma::vec& weights,
+                const bool useInitialModel = false);
+
+  /**
+   * Take one step of stepwise EM with the given batch of observations,
+   * updating the given model.
+   *
+   * @param batch Batch of observations.
+   * @param dists Distributions to update.
+   * @param weights A priori weights to update.
+   */
+  void Step(const arma::mat& batch,
+            std::vector<distribution::GaussianDistribution>& dists,
+            arma::vec& weights);
+
+  /**
+   * Take one step of stepwise EM with the given batch of observations, each
+   * weighted by its probability of being from this mixture.
+   *
+   * @param batch Batch of observations.
+   * @param probabilities Probability of each observation of the batch.
+   * @param dists Distributions to update.
+   * @param weights A priori weights to update.
+   */
+  void Step(const arma::mat& batch,
+            const arma::vec& probabilities,
+            std::vector<distribution::GaussianDistribution>& dists,
+            arma::vec& weights);
+
+  //! Get the clusterer.
+  const InitialClusteringType& Clusterer() const { return em.Clusterer(); }
+  //! Modify the clusterer.
+  InitialClusteringType& Clusterer() { return em.Clusterer(); }
+
+  //! Get the covariance constraint policy class.
+  const CovarianceConstraintPolicy& Constraint() const
+  { return em.Constraint(); }
+  //! Modify the covariance constraint policy class.
+  CovarianceConstraintPolicy& Constraint() { return em.Constraint(); }
+
+  //! Get the number of observations in each mini-batch.
+  size_t BatchSize() const { return batchSize; }
+  //! Modify the number of observations in each mini-batch.
+  size_t& BatchSize() { return batchSize; }
+
+  //! Get the number of passes over the observations.
+  size_t Passes() const { return passes; }
+  //! Modify the number of passes over the observations.
+  size_t& Passes() { return passes; }
+
+  //! Get the exponent of the step size.
+  double Decay() const { return decay; }
+  //! Modify the exponent of the step size.
+  double& Decay() { return decay; }
+
+  //! Get the number of steps taken so far.
+  size_t Steps() const { return steps; }
+  //! Modify the number of steps taken so far (0 restarts the step sizes).
+  size_t& Steps() { return steps; }
+
+ private:
+  /**
+   * Take one step with the given batch; probabilities may be empty, in which
+   * case every observation has weight 1.
+   */
+  void TakeStep(const arma::mat& batch,
+                const arma::vec& probabilities,
+                std::vector<distribution::GaussianDistribution>& dists,
+                arma::vec& weights);
+
+  //! Number of observations in each mini-batch.
+  size_t batchSize;
+  //! Number of passes over the observations.
+  size_t passes;
+  //! Exponent of the step size.
+  double decay;
+  //! Number of steps taken so far.
+  size_t steps;
+  //! The EM fitter, for the initial clustering and the E-step.
+  EMFit<InitialClusteringType, CovarianceConstraintPolicy> em;
+};
+
+}; // namespace gmm
+}; // namespace mlpack
+
+// Include implementation.
+#include "online_em_fit_impl.hpp"
+
+#endif
@@ -0,0 +1,178 @@
+/**
+ * @file online_em_fit_impl.hpp
+ *
+ * Implementation of stepwise (online) EM for fitting GMMs.
+ */
+#ifndef __MLPACK_METHODS_GMM_ONLINE_EM_FIT_IMPL_HPP
+#define __MLPACK_METHODS_GMM_ONLINE_EM_FIT_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "online_em_fit.hpp"
+
+namespace mlpack {
+namespace gmm {
+
+//! Constructor.
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+OnlineEMFit<InitialClusteringType, CovarianceConstraintPolicy>::OnlineEMFit(
+    const size_t batchSize,
+    const size_t passes,
+    const double decay,
+    InitialClusteringType clusterer,
+    CovarianceConstraintPolicy constraint) :
+    batchSize(batchSize),
+    passes(passes),
+    decay(decay),
+    steps(0),
+    em(1, 0.0, clusterer, constraint)
+{
+  if (decay <= 0.5 || decay > 1.0)
+    Log::Warn << "OnlineEMFit::OnlineEMFit(): decay is " << decay << ", but "
+        << "it should be in (0.5, 1] for the model to converge." << std::endl;
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void OnlineEMFit<InitialClusteringType, CovarianceConstraintPolicy>::Estimate(
+    const arma::mat& observations,
+    std::vector<distribution::GaussianDistribution>& dists,
+    arma::vec& weights,
+    const bool useInitialModel)
+{
+  Estimate(observations, arma::vec(), dists, weights, useInitialModel);
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void OnlineEMFit<InitialClusteringType, CovarianceConstraintPolicy>::Estimate(
+    const arma::mat& observations,
+    const arma::vec& probabilities,
+    std::vector<distribution::GaussianDistribution>& dists,
+    arma::vec& weights,
+    const bool useInitialModel)
+{
+  if (batchSize == 0)
+    Log::Fatal << "OnlineEMFit::Estimate(): batch size must be greater than "
+        << "0!" << std::endl;
+
+  if (!useInitialModel)
+  {
+    em.InitialClustering(observations, dists, weights);
+    steps = 0;
+  }
+
+  const size_t n = observations.n_cols;
+  arma::mat batch;
+  arma::vec batchProbabilities;
+  for (size_t pass = 0; pass < passes; ++pass)
+  {
+    // Draw the batches in a different random order for each pass.
+    const arma::uvec order = arma::shuffle(arma::linspace<arma::uvec>(0,
+        n - 1, n));
+
+    for (size_t begin = 0; begin < n; begin += batchSize)
+    {
+      const size_t end = std::min(begin + batchSize, n);
+      const arma::uvec indices = order.subvec(begin, end - 1);
+
+      batch = observations.cols(indices);
+      if (!probabilities.is_empty())
+        batchProbabilities = probabilities.elem(indices);
+
+      TakeStep(batch, batchProbabilities, dists, weights);
+    }
+
+    Log::Info << "OnlineEMFit::Estimate(): pass " << pass << " done, "
+        << steps << " steps taken." << std::endl;
+  }
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void OnlineEMFit<InitialClusteringType, CovarianceConstraintPolicy>::Estimate(
+    data::StreamingReader& reader,
+    std::vector<distribution::GaussianDistribution>& dists,
+    arma::vec& weights,
+    const bool useInitialModel)
+{
+  arma::mat block;
+  if (!useInitialModel)
+  {
+    reader.Reset();
+    if (!reader.NextBlock(block))
+      Log::Fatal << "OnlineEMFit::Estimate(): no observations in '"
+          << reader.Filename() << "'!" << std::endl;
+
+    em.InitialClustering(block, dists, weights);
+    steps = 0;
+  }
+
+  for (size_t pass = 0; pass < passes; ++pass)
+  {
+    reader.Reset();
+    while (reader.NextBlock(block))
+      TakeStep(block, arma::vec(), dists, weights);
+
+    Log::Info << "OnlineEMFit::Estimate(): pass " << pass << " over '"
+        << reader.Filename() << "' done, " << steps << " steps taken."
+        << std::endl;
+  }
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void OnlineEMFit<InitialClusteringType, CovarianceConstraintPolicy>::Step(
+    const arma::mat& batch,
+    std::vector<distribution::GaussianDistribution>& dists,
+    arma::vec& weights)
+{
+  TakeStep(batch, arma::vec(), dists, weights);
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void OnlineEMFit<InitialClusteringType, CovarianceConstraintPolicy>::Step(
+    const arma::mat& batch,
+    const arma::vec& probabilities,
+    std::vector<distribution::GaussianDistribution>& dists,
+    arma::vec& weights)
+{
+  TakeStep(batch, probabilities, dists, weights);
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void OnlineEMFit<InitialClusteringType, CovarianceConstraintPolicy>::TakeStep(
+    const arma::mat& batch,
+    const arma::vec& probabilities,
+    std::vector<distribution::GaussianDistribution>& dists,
+    arma::vec& weights)
+{
+  const double batchWeight = probabilities.is_empty() ? (double) batch.n_cols :
+      arma::accu(probabilities);
+  if (!(batchWeight > 0.0))
+    return;
+
+  // The E-step: the statistics of the batch, relative to the current means.
+  arma::vec sumWeights;
+  arma::mat sumDiffs;
+  std::vector<arma::mat> sumOuter;
+  em.Accumulate(batch, probabilities, dists, weights, sumWeights, sumDiffs,
+      sumOuter);
+
+  // Relative to its own means, the current model has the (normalized)
+  // statistics weights[i], 0, and weights[i] * covariance; move them towards
+  // the normalized statistics of the batch.
+  const double eta = std::pow(steps + 2.0, -decay);
+  const double batchScale = eta / batchWeight;
+  sumWeights = (1.0 - eta) * weights + batchScale * sumWeights;
+  sumDiffs *= batchScale;
+  for (size_t i = 0; i < dists.size(); ++i)
+    sumOuter[i] = ((1.0 - eta) * weights[i]) * dists[i].Covariance() +
+        batchScale * sumOuter[i];
+
+  // The M-step is the same as for EMFit.
+  em.Update(sumWeights, sumDiffs, sumOuter, arma::accu(sumWeights), dists,
+      weights);
+
+  ++steps;
+}
+
+}; // namespace gmm
+}; // namespace mlpack
+
+#endif
@@ -10,10 +10,15 @@
 #define __MLPACK_METHODS_HMM_HMM_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/util/sfinae_utility.hpp>
 
 namespace mlpack {
 namespace hmm /** Hidden Markov Models. */ {
 
+// Forward declaration of the online filter, which uses the emission helpers.
+template<typename HMMType>
+class HMMFilter;
+
 /**
  * A class that represents a Hidden Markov Model with an arbitrary type of
  * emission distribution.  This HMM class supports training (supervised and
@@ -44,6 +49,27 @@ namespace hmm /** Hidden Markov Models. */ {
  * };
  * @endcode
  *
+ * The distribution may also implement
+ *
+ * @code
+ * void Probability(const arma::mat& observations,
+ *                  arma::vec& probabilities) const;
+ * @endcode
+ *
+ * to compute the probabilities of all the observations of a sequence at once
+ * (as every distribution in mlpack::distribution and gmm::GMM do); otherwise
+ * the observations are evaluated one at a time.  Either way, each inference
+ * routine (Estimate(), Predict(), LogLikelihood()) evaluates the emission
+ * probability of each state for each observation exactly once.  Predict()
+ * works with log-probabilities, so it uses
+ *
+ * @code
+ * void LogProbability(const arma::mat& observations,
+ *                     arma::vec& logProbabilities) const;
+ * @endcode
+ *
+ * instead, if the distribution implements it.
+ *
  * See the mlpack::distribution::DiscreteDistribution class for an example.  One
  * would use the DiscreteDistribution class when the observations are
  * non-negative integers.  Other distributions could be Gaussians, a mixture of
@@ -72,10 +98,54 @@ namespace hmm /** Hidden Markov Models. */ {
  * (with LogLikelihood()), predict the most likely sequence of hidden states
  * (with Predict()), generate a sequence (with Generate()), or estimate the
  * probabilities of each state for a sequence of observations (with Estimate()).
+ * To filter a stream of observations as they arrive, see HMMFilter.
+ *
+ * A discrete HMM (HMM<DiscreteDistribution>) can also be given its sequences
+ * as packed symbols (an arma::Row of an integer type, such as
+ * arma::Row<uint32_t>, with one element per observation), with the overloads
+ * of Train(), Estimate(), Predict() and LogLikelihood() which take them.  With
+ * uint32_t, these take half of the memory of an arma::mat of doubles, and the
+ * emission probabilities of all of the states for an observation are found by
+ * copying one column of a table of the emission probabilities of each state
+ * for each symbol, instead of one lookup per state.  A sequence held elsewhere
+ * (for instance, a memory-mapped file of tokens) can be used without a copy by
+ * constructing the arma::Row on its memory.
+ *
+ * @code
+ * extern std::vector<arma::Row<uint32_t> > tokens;
+ * HMM<DiscreteDistribution> hmm(10, DiscreteDistribution(50000));
+ * hmm.Train(tokens);
+ * @endcode
+ *
+ * The transition matrix is dense (arma::mat) by default.  For models where
+ * most transitions are impossible (such as left-to-right or banded
+ * topologies), the TransitionType template parameter can be set to
+ * arma::sp_mat; then the memory used by the transition matrix, and the time
+ * taken by each step of the Forward-Backward algorithm, of Viterbi decoding
+ * (which is done as with BeamPredict(), without pruning), and of Baum-Welch
+ * training, scale with the number of nonzero transitions instead of the square
+ * of the number of states.  Baum-Welch training never creates transitions that
+ * are zero in the initial transition matrix, so the sparsity pattern is kept.
+ *
+ * @code
+ * // A left-to-right topology: each state can only stay or go to the next.
+ * arma::sp_mat transition(1000, 1000);
+ * for (size_t i = 0; i < 1000; ++i)
+ * {
+ *   transition(i, i) = (i == 999) ? 1.0 : 0.5;
+ *   if (i < 999)
+ *     transition(i + 1, i) = 0.5;
+ * }
+ *
+ * HMM<GaussianDistribution, arma::sp_mat> hmm(initial, transition, emissions);
+ * @endcode
  *
  * @tparam Distribution Type of emission distribution for this HMM.
+ * @tparam TransitionType Type of the transition matrix (arma::mat or
+ *     arma::sp_mat).
  */
-template<typename Distribution = distribution::DiscreteDistribution>
+template<typename Distribution = distribution::DiscreteDistribution,
+         typename TransitionType = arma::mat>
 class HMM
 {
  public:
@@ -128,7 +198,7 @@ class HMM
    *      (Baum-Welch).
    */
   HMM(const arma::vec& initial,
-      const arma::mat& transition,
+      const TransitionType& transition,
       const std::vector<Distribution>& emission,
       const double tolerance = 1e-5);
 
@@ -152,6 +222,10 @@ class HMM
    * log-likelihood of the model between iterations is less than the tolerance,
    * the Baum-Welch algorithm terminates.
    *
+   * If OpenMP is available, the sequences are split between threads in each
+   * iteration; each thread runs the Forward-Backward algorithm on its own
+   * sequences and sums its own transition statistics.
+   *
    * @note
    * Train() can be called multiple times with different sequences; each time it
    * is called, it uses the current parameters of the HMM as a starting point
@@ -240,6 +314,38 @@ class HMM
                 arma::Col<size_t>& stateSequence,
                 const size_t startState = 0) const;
 
+  /**
+   * Generate the given number of random data sequences of the given length,
+   * each starting in the given state, as the other overload of Generate()
+   * does.  The next state is drawn from an alias table of the transitions out
+   * of the current state, so each step takes constant time.  If the emission
+   * distribution can draw observations from a stream of random numbers, as
+   * with
+   *
+   * @code
+   * void Random(const size_t n,
+   *             math::RandomStream& stream,
+   *             arma::mat& observations) const;
+   * @endcode
+   *
+   * (as every distribution in mlpack::distribution except
+   * RegressionDistribution, and gmm::GMM, can), the emissions of each state are
+   * drawn with one call, and, if OpenMP is available, the sequences are
+   * generated in parallel, each from its own stream, so they only depend on
+   * the random seed, and not on the number of threads.
+   *
+   * @param sequences Number of sequences to generate.
+   * @param length Length of each sequence.
+   * @param dataSequences Vector to store the data sequences in.
+   * @param stateSequences Vector to store the state sequences in.
+   * @param startState Hidden state to start each sequence in (default 0).
+   */
+  void Generate(const size_t sequences,
+                const size_t length,
+                std::vector<arma::mat>& dataSequences,
+                std::vector<arma::Col<size_t> >& stateSequences,
+                const size_t startState = 0) const;
+
   /**
    * Compute the most probable hidden state sequence for the given data
    * sequence, using the Viterbi algorithm, returning the log-likelihood of the
@@ -253,6 +359,31 @@ class HMM
   double Predict(const arma::mat& dataSeq,
                  arma::Col<size_t>& stateSeq) const;
 
+  /**
+   * Compute an approximation of the most probable hidden state sequence for
+   * the given data sequence, using the Viterbi algorithm with beam pruning:
+   * after each observation, only the (at most) beamWidth most probable states
+   * whose log-probability is within beamMargin of the best state are kept.
+   * The transitions are stored as a sparse matrix, and the emission
+   * probability of a state is only computed when one of the kept states can
+   * transition to it, so each step takes time proportional to the number of
+   * transitions out of the kept states, instead of the square of the number
+   * of states.  If both limits are disabled, the result is the same as
+   * Predict().
+   *
+   * @param dataSeq Sequence of observations.
+   * @param stateSeq Vector in which the state sequence will be stored.
+   * @param beamWidth Maximum number of states kept after each observation (0
+   *    means no limit).
+   * @param beamMargin Maximum difference between the log-probability of the
+   *    best state and of a kept state (DBL_MAX means no limit).
+   * @return Log-likelihood of the returned state sequence.
+   */
+  double BeamPredict(const arma::mat& dataSeq,
+                     arma::Col<size_t>& stateSeq,
+                     const size_t beamWidth,
+                     const double beamMargin = DBL_MAX) const;
+
   /**
    * Compute the log-likelihood of the given data sequence.
    *
@@ -261,6 +392,63 @@ class HMM
    */
   double LogLikelihood(const arma::mat& dataSeq) const;
 
+  /**
+   * Train a discrete HMM using the Baum-Welch algorithm, with the given
+   * sequences of packed symbols, as the overload of Train() which takes
+   * arma::mat sequences does.  The expected number of times each state emits
+   * each symbol is summed directly (by each thread, if OpenMP is available),
+   * so no copy of the observations is made.  This can only be used with
+   * DiscreteDistribution emissions; each symbol must be less than the number
+   * of observations of the distributions.
+   *
+   * @param dataSeq Vector of sequences of symbols.
+   */
+  template<typename eT>
+  void Train(const std::vector<arma::Row<eT> >& dataSeq,
+      typename boost::enable_if<boost::is_integral<eT> >::type* = 0);
+
+  /**
+   * Estimate the probabilities of each hidden state at each time step of the
+   * given sequence of packed symbols, as the overload of Estimate() which
+   * takes an arma::mat sequence does.  This can only be used with
+   * DiscreteDistribution emissions.
+   *
+   * @param dataSeq Sequence of symbols.
+   * @param stateProb Probabilities of each state at each time interval.
+   * @return Log-likelihood of the sequence.
+   */
+  template<typename eT>
+  double Estimate(const arma::Row<eT>& dataSeq,
+      arma::mat& stateProb,
+      typename boost::enable_if<boost::is_integral<eT> >::type* = 0) const;
+
+  /**
+   * Compute the most probable hidden state sequence for the given sequence of
+   * packed symbols, using the Viterbi algorithm, as the overload of Predict()
+   * which takes an arma::mat sequence does.  This can only be used with
+   * DiscreteDistribution emissions.
+   *
+   * @param dataSeq Sequence of symbols.
+   * @param stateSeq Vector in which the most probable state sequence will be
+   *    stored.
+   * @return Log-likelihood of most probable state sequence.
+   */
+  template<typename eT>
+  double Predict(const arma::Row<eT>& dataSeq,
+      arma::Col<size_t>& stateSeq,
+      typename boost::enable_if<boost::is_integral<eT> >::type* = 0) const;
+
+  /**
+   * Compute the log-likelihood of the given sequence of packed symbols.  This
+   * can only be used with DiscreteDistribution emissions.
+   *
+   * @param dataSeq Sequence of symbols to evaluate the likelihood of.
+   * @return Log-likelihood of the given sequence.
+   */
+  template<typename eT>
+  double LogLikelihood(const arma::Row<eT>& dataSeq,
+      typename boost::enable_if<boost::is_integral<eT> >::type* = 0) const;
+
   /**
    * HMM filtering. Computes the k-step-ahead expected emission at each time
    * conditioned only on prior observations. That is
@@ -297,9 +485,9 @@ class HMM
   arma::vec& Initial() { return initial; }
 
   //! Return the transition matrix.
-  const arma::mat& Transition() const { return transition; }
+  const TransitionType& Transition() const { return transition; }
   //! Return a modifiable transition matrix reference.
-  arma::mat& Transition() { return transition; }
+  TransitionType& Transition() { return transition; }
 
   //! Return the emission distributions.
   const std::vector<Distribution>& Emission() const { return emission; }
@@ -332,6 +520,10 @@ class HMM
   static std::string const Type() { return "HMM"; }
 
  protected:
+  //! The online filter computes emission probabilities like the HMM does.
+  template<typename HMMType>
+  friend class HMMFilter;
+
   // Helper functions.
   /**
    * The Forward algorithm (part of the Forward-Backward algorithm).  Computes
@@ -362,11 +554,262 @@ class HMM
                 const arma::vec& scales,
                 arma::mat& backwardProb) const;
 
+  /**
+   * Compute the emission probability of each observation in the given data
+   * sequence for each state.  The returned matrix has rows equal to the
+   * number of hidden states and columns equal to the number of observations.
+   *
+   * @param dataSeq Data sequence to compute probabilities for.
+   * @param emissionProb Matrix in which the emission probabilities will be
+   *     saved.
+   */
+  void EmissionProbabilities(const arma::mat& dataSeq,
+                             arma::mat& emissionProb) const;
+
+  /**
+   * Compute the log of the emission probability of each observation in the
+   * sequence for each state, as EmissionProbabilities() does.
+   *
+   * @param dataSeq Data sequence to compute log-probabilities for.
+   * @param logEmissionProb Matrix in which the log emission probabilities will
+   *     be saved.
+   */
+  void LogEmissionProbabilities(const arma::mat& dataSeq,
+                                arma::mat& logEmissionProb) const;
+
+  /**
+   * Return the table of the emission probabilities of a discrete HMM: element
+   * (i, j) is the probability that state i emits symbol j.
+   */
+  arma::mat EmissionTable() const;
+
+  /**
+   * Compute the emission probability of each symbol in the given sequence for
+   * each state, by copying the column of the symbol from the given table (see
+   * EmissionTable()).  The table may also hold log-probabilities.
+   *
+   * @param dataSeq Sequence of symbols.
+   * @param table Table of the emission probabilities of each state for each
+   *     symbol.
+   * @param emissionProb Matrix in which the emission probabilities will be
+   *     saved.
+   */
+  template<typename eT>
+  static void EmissionProbabilities(const arma::Row<eT>& dataSeq,
+                                    const arma::mat& table,
+                                    arma::mat& emissionProb);
+
+  /**
+   * The Viterbi algorithm (see Predict()), given the log of the emission
+   * probabilities of each state for each observation, for a dense transition
+   * matrix.
+   *
+   * @param logEmissionProb Log emission probabilities of the data sequence.
+   * @param stateSeq Vector in which the most probable state sequence will be
+   *    stored.
+   * @return Log-likelihood of most probable state sequence.
+   */
+  double PredictFromLogEmission(const arma::mat& logEmissionProb,
+                                arma::Col<size_t>& stateSeq) const;
+
+  /**
+   * Add the transition statistics of one sequence to the given statistics,
+   * for Baum-Welch training, from the emission probabilities and the result
+   * of EstimateFromEmission() for the sequence.
+   *
+   * @param emissionProb Emission probabilities of the sequence.
+   * @param forward Forward probabilities of the sequence.
+   * @param backward Backward probabilities of the sequence.
+   * @param scales Scaling factors of the sequence.
+   * @param scaledBackward Matrix to use as workspace.
+   * @param statistics Transition statistics to add to.
+   */
+  void AddSequenceStatistics(const arma::mat& emissionProb,
+                             const arma::mat& forward,
+                             const arma::mat& backward,
+                             const arma::vec& scales,
+                             arma::mat& scaledBackward,
+                             arma::mat& statistics) const;
+
+  /**
+   * The recursion of the Forward algorithm, given the emission probabilities
+   * of each state for each observation (from EmissionProbabilities()).  Each
+   * time step is one matrix-vector product with the transition matrix.
+   *
+   * @param emissionProb Emission probabilities of the data sequence.
+   * @param scales Vector in which scaling factors will be saved.
+   * @param forwardProb Matrix in which forward probabilities will be saved.
+   */
+  void ForwardRecursion(const arma::mat& emissionProb,
+                        arma::vec& scales,
+                        arma::mat& forwardProb) const;
+
+  /**
+   * The recursion of the Backward algorithm, given the emission probabilities
+   * of each state for each observation and the scaling factors from
+   * ForwardRecursion().  Each time step is one matrix-vector product with the
+   * transposed transition matrix.
+   *
+   * @param emissionProb Emission probabilities of the data sequence.
+   * @param scales Vector of scaling factors.
+   * @param backwardProb Matrix in which backward probabilities will be saved.
+   */
+  void BackwardRecursion(const arma::mat& emissionProb,
+                         const arma::vec& scales,
+                         arma::mat& backwardProb) const;
+
+  /**
+   * Run the Forward-Backward algorithm on the given emission probabilities
+   * (see Estimate()).
+   *
+   * @param emissionProb Emission probabilities of the data sequence.
+   * @param stateProb Matrix in which the state probabilities will be stored.
+   * @param forwardProb Matrix in which the forward probabilities will be
+   *     stored.
+   * @param backwardProb Matrix in which the backward probabilities will be
+   *     stored.
+   * @param scales Vector in which the scaling factors will be stored.
+   * @return Log-likelihood of the data sequence.
+   */
+  double EstimateFromEmission(const arma::mat& emissionProb,
+                              arma::mat& stateProb,
+                              arma::mat& forwardProb,
+                              arma::mat& backwardProb,
+                              arma::vec& scales) const;
+
+  //! Return the transition matrix as a dense matrix.
+  static const arma::mat& DenseTransition(const arma::mat& transition)
+  { return transition; }
+  //! Return the transition matrix as a dense matrix.
+  static arma::mat DenseTransition(const arma::sp_mat& transition)
+  { return arma::mat(transition); }
+
+  //! Return true if the transition matrix is sparse.
+  static bool SparseTransition(const arma::mat& /* transition */)
+  { return false; }
+  //! Return true if the transition matrix is sparse.
+  static bool SparseTransition(const arma::sp_mat& /* transition */)
+  { return true; }
+
+  /**
+   * Set the statistics used to re-estimate the transition matrix in
+   * Baum-Welch training to zero: for a dense transition matrix, a matrix of
+   * the same size; for a sparse one, a vector with one element for each
+   * nonzero transition (in the order of the iterator of the matrix).
+   */
+  static void ZeroTransitionStatistics(const arma::mat& transition,
+                                       arma::mat& statistics);
+  static void ZeroTransitionStatistics(const arma::sp_mat& transition,
+                                       arma::mat& statistics);
+
+  /**
+   * Add sum_t scaledBackward(i, t) * forward(j, t) to the transition
+   * statistics for each transition from state j to state i (only the nonzero
+   * transitions, for a sparse transition matrix).
+   */
+  static void AddTransitionStatistics(const arma::mat& transition,
+                                      const arma::mat& scaledBackward,
+                                      const arma::mat& forward,
+                                      arma::mat& statistics);
+  static void AddTransitionStatistics(const arma::sp_mat& transition,
+                                      const arma::mat& scaledBackward,
+                                      const arma::mat& forward,
+                                      arma::mat& statistics);
+
+  /**
+   * Multiply each transition by its statistic and normalize each column of
+   * the transition matrix, after Baum-Welch training.
+   */
+  static void UpdateTransition(arma::mat& transition,
+                               const arma::mat& statistics);
+  static void UpdateTransition(arma::sp_mat& transition,
+                               const arma::mat& statistics);
+
+  /**
+   * Set the transition matrix to the normalized counts of the transitions in
+   * the given state sequences, for labeled training.
+   */
+  static void CountTransitions(
+      const std::vector<arma::Col<size_t> >& stateSeq,
+      arma::mat& transition);
+  static void CountTransitions(
+      const std::vector<arma::Col<size_t> >& stateSeq,
+      arma::sp_mat& transition);
+
+  HAS_MEM_FUNC(Probability, HasBatchProbability)
+
+  //! Compute the probabilities of the observations with one call, if the
+  //! distribution can do that.
+  template<typename DistributionType>
+  static void BatchProbability(const DistributionType& distribution,
+      const arma::mat& observations,
+      arma::vec& probabilities,
+      typename boost::enable_if<HasBatchProbability<DistributionType,
+          void(DistributionType::*)(const arma::mat&, arma::vec&) const>
+      >::type* = 0);
+
+  //! Compute the probabilities of the observations one at a time.
+  template<typename DistributionType>
+  static void BatchProbability(const DistributionType& distribution,
+      const arma::mat& observations,
+      arma::vec& probabilities,
+      typename boost::disable_if<HasBatchProbability<DistributionType,
+          void(DistributionType::*)(const arma::mat&, arma::vec&) const>
+      >::type* = 0);
+
+  HAS_MEM_FUNC(LogProbability, HasBatchLogProbability)
+
+  //! Compute the log-probabilities of the observations with one call, if the
+  //! distribution can do that.
+  template<typename DistributionType>
+  static void BatchLogProbability(const DistributionType& distribution,
+      const arma::mat& observations,
+      arma::vec& logProbabilities,
+      typename boost::enable_if<HasBatchLogProbability<DistributionType,
+          void(DistributionType::*)(const arma::mat&, arma::vec&) const>
+      >::type* = 0);
+
+  //! Compute the log-probabilities of the observations from their
+  //! probabilities.
+  template<typename DistributionType>
+  static void BatchLogProbability(const DistributionType& distribution,
+      const arma::mat& observations,
+      arma::vec& logProbabilities,
+      typename boost::disable_if<HasBatchLogProbability<DistributionType,
+          void(DistributionType::*)(const arma::mat&, arma::vec&) const>
+      >::type* = 0);
+
+  HAS_MEM_FUNC(Random, HasStreamRandom)
+
+  //! Draw the emissions of the given state sequence from the given stream,
+  //! with one call per state, if the distribution can do that.
+  template<typename DistributionType>
+  static void GenerateEmissions(const std::vector<DistributionType>& emission,
+      const arma::Col<size_t>& stateSequence,
+      math::RandomStream& stream,
+      arma::mat& dataSequence,
+      typename boost::enable_if<HasStreamRandom<DistributionType,
+          void(DistributionType::*)(const size_t, math::RandomStream&,
+              arma::mat&) const>
+      >::type* = 0);
+
+  //! Draw the emissions of the given state sequence one at a time, from the
+  //! global random number generator.
+  template<typename DistributionType>
+  static void GenerateEmissions(const std::vector<DistributionType>& emission,
+      const arma::Col<size_t>& stateSequence,
+      math::RandomStream& stream,
+      arma::mat& dataSequence,
+      typename boost::disable_if<HasStreamRandom<DistributionType,
+          void(DistributionType::*)(const size_t, math::RandomStream&,
+              arma::mat&) const>
+      >::type* = 0);
+
   //! Set of emission probability distributions; one for each state.
   std::vector<Distribution> emission;
 
   //! Transition probability matrix.
-  arma::mat transition;
+  TransitionType transition;
   
  private:
   //! Initial state probability vector.
@@ -0,0 +1,130 @@
+/**
+ * @file hmm_filter.hpp
+ *
+ * Definition of the HMMFilter class, which filters a stream of observations
+ * with an HMM one observation (or a small block of observations) at a time.
+ */
+#ifndef __MLPACK_METHODS_HMM_HMM_FILTER_HPP
+#define __MLPACK_METHODS_HMM_HMM_FILTER_HPP
+
+#include <mlpack/core.hpp>
+#include "hmm.hpp"
+
+namespace mlpack {
+namespace hmm {
+
+/**
+ * An online version of the Forward algorithm for an HMM.  HMM::Estimate() and
+ * HMM::Filter() need the whole data sequence, and store a matrix with one
+ * column per observation; instead, HMMFilter only stores the current forward
+ * probabilities, P(X_t | o_{1:t}) for each state X_t, and updates them as each
+ * observation arrives.  Each update takes O(S^2) time (or time proportional
+ * to the number of nonzero transitions, if the transition matrix is sparse)
+ * and O(S) memory, where S is the number of states, no matter how many
+ * observations have been seen.  After each update, the forward probabilities
+ * are the same as the last column of the forward probabilities computed by
+ * HMM::Estimate() for all the observations so far.
+ *
+ * The filter can also give the distribution of the hidden state some steps
+ * after the last observation (with Predict()), and the predictive probability
+ * of the next observation (with Probability()).
+ *
+ * @code
+ * extern HMM<GaussianDistribution> hmm;
+ * HMMFilter<HMM<GaussianDistribution> > filter(hmm);
+ *
+ * arma::vec observation;
+ * while (ReadSensor(observation))
+ * {
+ *   const arma::vec& stateProb = filter.Update(observation);
+ *   ...
+ * }
+ * @endcode
+ *
+ * The filter holds a reference to the HMM, which must therefore outlive the
+ * filter, and must not be modified while observations are being filtered.
+ *
+ * @tparam HMMType Type of HMM to filter with.
+ */
+template<typename HMMType = HMM<> >
+class HMMFilter
+{
+ public:
+  /**
+   * Create a filter for the given HMM, which has not seen any observations.
+   *
+   * @param hmm HMM to filter observations with.
+   */
+  HMMFilter(const HMMType& hmm);
+
+  /**
+   * Update the forward probabilities with the given observations (one per
+   * column, in order; this may be a single observation), and return them.
+   * The emission probabilities of a block of observations are computed at
+   * once, so passing small blocks is faster than passing one observation at a
+   * time when the emission distributions can evaluate many observations at
+   * once; the memory used is proportional to the size of the block.
+   *
+   * @param observations Next observations of the sequence.
+   * @return Probability of each state given all observations so far.
+   */
+  const arma::vec& Update(const arma::mat& observations);
+
+  /**
+   * Compute the probability of each state the given number of steps after the
+   * last observation, P(X_{t+k} | o_{1:t}).  With ahead = 0, this is the
+   * current forward probabilities.  If no observations have been seen, the
+   * first state is distributed as the initial state probabilities of the HMM.
+   *
+   * @param stateProb Vector to store the state probabilities in.
+   * @param ahead Number of steps ahead (k).
+   */
+  void Predict(arma::vec& stateProb, const size_t ahead = 1) const;
+
+  /**
+   * Compute the predictive probability of the given observation being the
+   * next observation of the sequence, P(o_{t+1} | o_{1:t}).  This does not
+   * change the filter.
+   *
+   * @param observation Observation to evaluate.
+   */
+  double Probability(const arma::vec& observation) const;
+
+  //! Forget all observations, to start filtering a new sequence.
+  void Reset();
+
+  //! Get the probability of each state given all observations so far (empty
+  //! if no observations have been seen).
+  const arma::vec& State() const { return forward; }
+
+  //! Get the number of observations seen since the last Reset().
+  size_t Steps() const { return steps; }
+
+  //! Get the log-likelihood of the observations seen since the last Reset().
+  double LogLikelihood() const { return logLikelihood; }
+
+ private:
+  //! Advance the forward probabilities with the given emission probabilities
+  //! of the next observation.
+  void Step(const arma::vec& emissionProb);
+
+  //! The HMM to filter with.
+  const HMMType& hmm;
+
+  //! Probability of each state given all observations so far.
+  arma::vec forward;
+
+  //! Number of observations seen.
+  size_t steps;
+
+  //! Log-likelihood of the observations seen.
+  double logLikelihood;
+};
+
+}; // namespace hmm
+}; // namespace mlpack
+
+// Include implementation.
+#include "hmm_filter_impl.hpp"
+
+#endif
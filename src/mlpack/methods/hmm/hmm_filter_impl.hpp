@@ -0,0 +1,99 @@
+/**
+ * @file hmm_filter_impl.hpp
+ *
+ * Implementation of the HMMFilter class.
+ */
+#ifndef __MLPACK_METHODS_HMM_HMM_FILTER_IMPL_HPP
+#define __MLPACK_METHODS_HMM_HMM_FILTER_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "hmm_filter.hpp"
+
+namespace mlpack {
+namespace hmm {
+
+template<typename HMMType>
+HMMFilter<HMMType>::HMMFilter(const HMMType& hmm) :
+    hmm(hmm),
+    steps(0),
+    logLikelihood(0.0)
+{
+  // Nothing to do.
+}
+
+template<typename HMMType>
+const arma::vec& HMMFilter<HMMType>::Update(const arma::mat& observations)
+{
+  arma::mat emissionProb;
+  hmm.EmissionProbabilities(observations, emissionProb);
+
+  for (size_t t = 0; t < observations.n_cols; ++t)
+    Step(emissionProb.unsafe_col(t));
+
+  return forward;
+}
+
+template<typename HMMType>
+void HMMFilter<HMMType>::Predict(arma::vec& stateProb, const size_t ahead)
+    const
+{
+  // Before the first observation, the first state follows the initial state
+  // probabilities, so one less transition is taken.
+  stateProb = (steps == 0) ? hmm.Initial() : forward;
+  for (size_t i = (steps == 0) ? 1 : 0; i < ahead; ++i)
+  {
+    const arma::vec previous = stateProb;
+    stateProb = hmm.Transition() * previous;
+  }
+}
+
+template<typename HMMType>
+double HMMFilter<HMMType>::Probability(const arma::vec& observation) const
+{
+  arma::vec stateProb;
+  Predict(stateProb, 1);
+
+  double probability = 0.0;
+  for (size_t state = 0; state < stateProb.n_elem; ++state)
+  {
+    if (stateProb[state] > 0.0)
+      probability += stateProb[state] *
+          hmm.Emission()[state].Probability(observation);
+  }
+
+  return probability;
+}
+
+template<typename HMMType>
+void HMMFilter<HMMType>::Reset()
+{
+  forward.reset();
+  steps = 0;
+  logLikelihood = 0.0;
+}
+
+template<typename HMMType>
+void HMMFilter<HMMType>::Step(const arma::vec& emissionProb)
+{
+  // This is one iteration of HMM::ForwardRecursion().
+  if (steps == 0)
+  {
+    forward = hmm.Initial() % emissionProb;
+  }
+  else
+  {
+    const arma::vec previous = hmm.Transition() * forward;
+    forward = previous % emissionProb;
+  }
+
+  // Normalize, and keep the scaling factor for the log-likelihood.
+  const double scale = accu(forward);
+  forward /= scale;
+  logLikelihood += log(scale);
+  ++steps;
+}
+
+}; // namespace hmm
+}; // namespace mlpack
+
+#endif
@@ -19,10 +19,11 @@ namespace hmm {
  * Create the Hidden Markov Model with the given number of hidden states and the
  * given number of emission states.
  */
-template<typename Distribution>
-HMM<Distribution>::HMM(const size_t states,
-                       const Distribution emissions,
-                       const double tolerance) :
+template<typename Distribution, typename TransitionType>
+HMM<Distribution, TransitionType>::HMM(
+    const size_t states,
+    const Distribution emissions,
+    const double tolerance) :
     emission(states, /* default distribution */ emissions),
     transition(arma::ones<arma::mat>(states, states) / (double) states),
     initial(arma::ones<arma::vec>(states) / (double) states),
@@ -34,11 +35,12 @@ HMM<Distribution>::HMM(const size_t states,
  * Create the Hidden Markov Model with the given transition matrix and the given
  * emission probability matrix.
  */
-template<typename Distribution>
-HMM<Distribution>::HMM(const arma::vec& initial,
-                       const arma::mat& transition,
-                       const std::vector<Distribution>& emission,
-                       const double tolerance) :
+template<typename Distribution, typename TransitionType>
+HMM<Distribution, TransitionType>::HMM(
+    const arma::vec& initial,
+    const TransitionType& transition,
+    const std::vector<Distribution>& emission,
+    const double tolerance) :
     emission(emission),
     transition(transition),
     initial(initial),
@@ -71,8 +73,9 @@ HMM<Distribution>::HMM(const arma::vec& initial,
  *
  * @param dataSeq Set of data sequences to train on.
  */
-template<typename Distribution>
-void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq)
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::Train(
+    const std::vector<arma::mat>& dataSeq)
 {
   // We should allow a guess at the transition and emission matrices.
   double loglik = 0;
@@ -81,10 +84,14 @@ void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq)
   // Maximum iterations?
   size_t iterations = 1000;
 
-  // Find length of all sequences and ensure they are the correct size.
+  // Find length of all sequences and ensure they are the correct size.  Each
+  // sequence has its own range of columns in emissionList, starting at its
+  // offset.
   size_t totalLength = 0;
+  std::vector<size_t> offsets(dataSeq.size());
   for (size_t seq = 0; seq < dataSeq.size(); seq++)
   {
+    offsets[seq] = totalLength;
     totalLength += dataSeq[seq].n_cols;
 
     if (dataSeq[seq].n_rows != dimensionality)
@@ -99,80 +106,110 @@ void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq)
       arma::vec(totalLength));
   arma::mat emissionList(dimensionality, totalLength);
 
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+  const bool parallelEstimate =
+      distribution::DistributionTraits<Distribution>::ParallelEstimate;
+
   // This should be the Baum-Welch algorithm (EM for HMM estimation). This
   // follows the procedure outlined in Elliot, Aggoun, and Moore's book "Hidden
   // Markov Models: Estimation and Control", pp. 36-40.
   for (size_t iter = 0; iter < iterations; iter++)
   {
-    // Clear new transition matrix and emission probabilities.
-    arma::vec newInitial(transition.n_rows);
-    newInitial.zeros();
-    arma::mat newTransition(transition.n_rows, transition.n_cols);
-    newTransition.zeros();
+    // Clear new transition matrix and emission probabilities.  Each thread
+    // sums into its own matrices, which are reduced after the E-step.
+    std::vector<arma::vec> threadInitial(threads,
+        arma::zeros<arma::vec>(transition.n_rows));
+    std::vector<arma::mat> threadTransition(threads);
+    for (size_t t = 0; t < threads; t++)
+      ZeroTransitionStatistics(transition, threadTransition[t]);
 
     // Reset log likelihood.
     loglik = 0;
 
-    // Sum over time.
-    size_t sumTime = 0;
-
-    // Loop over each sequence.
-    for (size_t seq = 0; seq < dataSeq.size(); seq++)
+    // The sequences are independent given the current model, so they are
+    // split between the threads (dynamically, since their lengths differ).
+    // Each sequence writes to its own columns of emissionList and
+    // emissionProb.
+    #pragma omp parallel num_threads(threads) reduction(+:loglik)
     {
+#ifdef _OPENMP
+      const size_t thread = omp_get_thread_num();
+#else
+      const size_t thread = 0;
+#endif
+      arma::vec& newInitial = threadInitial[thread];
+      arma::mat& newTransition = threadTransition[thread];
+
+      arma::mat emissionProb;
       arma::mat stateProb;
       arma::mat forward;
       arma::mat backward;
       arma::vec scales;
+      arma::mat scaledBackward;
 
-      // Add the log-likelihood of this sequence.  This is the E-step.
-      loglik += Estimate(dataSeq[seq], stateProb, forward, backward, scales);
-
-      // Now re-estimate the parameters.  This is the M-step.
-      //   pi_i = sum_d ((1 / P(seq[d])) sum_t (f(i, 0) b(i, 0))
-      //   T_ij = sum_d ((1 / P(seq[d])) sum_t (f(i, t) T_ij E_i(seq[d][t]) b(i,
-      //           t + 1)))
-      //   E_ij = sum_d ((1 / P(seq[d])) sum_{t | seq[d][t] = j} f(i, t) b(i, t)
-      // We store the new estimates in a different matrix.
-      for (size_t t = 0; t < dataSeq[seq].n_cols; t++)
+      #pragma omp for schedule(dynamic)
+      for (size_t seq = 0; seq < dataSeq.size(); seq++)
       {
+        const arma::mat& observations = dataSeq[seq];
+
+        if (observations.n_cols == 0)
+          continue;
+
+        // Add the log-likelihood of this sequence.  This is the E-step.
+        EmissionProbabilities(observations, emissionProb);
+        loglik += EstimateFromEmission(emissionProb, stateProb, forward,
+            backward, scales);
+
+        // Now re-estimate the parameters.  This is the M-step.
+        //   pi_i = sum_d ((1 / P(seq[d])) sum_t (f(i, 0) b(i, 0))
+        //   T_ij = sum_d ((1 / P(seq[d])) sum_t (f(i, t) T_ij E_i(seq[d][t])
+        //           b(i, t + 1)))
+        //   E_ij = sum_d ((1 / P(seq[d])) sum_{t | seq[d][t] = j} f(i, t)
+        //           b(i, t)
+        // We store the new estimates in a different matrix.
+        newInitial += stateProb.col(0);
+
+        // Estimate of T_ij (probability of transition from state j to state
+        // i).  We postpone multiplication of the old T_ij until later.
+        AddSequenceStatistics(emissionProb, forward, backward, scales,
+            scaledBackward, newTransition);
+
+        // Add to list of emission observations, for Distribution::Estimate().
+        const size_t length = observations.n_cols;
+        const size_t offset = offsets[seq];
+        emissionList.cols(offset, offset + length - 1) = observations;
         for (size_t j = 0; j < transition.n_cols; j++)
-        {
-          // Add to estimate of initial probability for state j.
-          newInitial[j] = stateProb(j, 0);
-
-          if (t < dataSeq[seq].n_cols - 1)
-          {
-            // Estimate of T_ij (probability of transition from state j to state
-            // i).  We postpone multiplication of the old T_ij until later.
-            for (size_t i = 0; i < transition.n_rows; i++)
-              newTransition(i, j) += forward(j, t) * backward(i, t + 1) *
-                  emission[i].Probability(dataSeq[seq].unsafe_col(t + 1)) /
-                  scales[t + 1];
-          }
-
-          // Add to list of emission observations, for Distribution::Estimate().
-          emissionList.col(sumTime) = dataSeq[seq].col(t);
-          emissionProb[j][sumTime] = stateProb(j, t);
-        }
-        sumTime++;
+          emissionProb[j].subvec(offset, offset + length - 1) =
+              arma::trans(stateProb.row(j));
       }
     }
 
+    // Reduce the statistics of each thread.
+    arma::vec newInitial = threadInitial[0];
+    arma::mat newTransition = threadTransition[0];
+    for (size_t t = 1; t < threads; t++)
+    {
+      newInitial += threadInitial[t];
+      newTransition += threadTransition[t];
+    }
+
     // Normalize the new initial probabilities.
     if (dataSeq.size() == 0)
       initial = newInitial / dataSeq.size();
 
-    // Assign the new transition matrix.  We use %= (element-wise
-    // multiplication) because every element of the new transition matrix must
-    // still be multiplied by the old elements (this is the multiplication we
-    // earlier postponed).
-    transition %= newTransition;
+    // Assign the new transition matrix.  Every element of the new transition
+    // matrix must still be multiplied by the old elements (this is the
+    // multiplication we earlier postponed); then the columns are normalized.
+    UpdateTransition(transition, newTransition);
 
-    // Now we normalize the transition matrix.
-    for (size_t i = 0; i < transition.n_cols; i++)
-      transition.col(i) /= accu(transition.col(i));
-
-    // Now estimate emission probabilities.
+    // Now estimate emission probabilities.  The states are independent, so
+    // they are estimated in parallel if the distribution allows it.
+    #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+        if(threads > 1 && parallelEstimate)
     for (size_t state = 0; state < transition.n_cols; state++)
       emission[state].Estimate(emissionList, emissionProb[state]);
 
@@ -193,9 +230,10 @@ void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq)
  * Train the model using the given labeled observations; the transition and
  * emission matrices are directly estimated.
  */
-template<typename Distribution>
-void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq,
-                              const std::vector<arma::Col<size_t> >& stateSeq)
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::Train(
+    const std::vector<arma::mat>& dataSeq,
+    const std::vector<arma::Col<size_t> >& stateSeq)
 {
   // Simple error checking.
   if (dataSeq.size() != stateSeq.size())
@@ -206,7 +244,6 @@ void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq,
   }
 
   initial.zeros();
-  transition.zeros();
 
   // Estimate the transition and emission matrices directly from the
   // observations.  The emission list holds the time indices for observations
@@ -235,10 +272,7 @@ void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq,
     // transition matrix, we must ignore the last observation.
     initial[stateSeq[seq][0]]++;
     for (size_t t = 0; t < dataSeq[seq].n_cols - 1; t++)
-    {
-      transition(stateSeq[seq][t + 1], stateSeq[seq][t])++;
       emissionList[stateSeq[seq][t]].push_back(std::make_pair(seq, t));
-    }
 
     // Last observation.
     emissionList[stateSeq[seq][stateSeq[seq].n_elem - 1]].push_back(
@@ -248,18 +282,21 @@ void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq,
   // Normalize initial weights.
   initial /= accu(initial);
 
-  // Normalize transition matrix.
-  for (size_t col = 0; col < transition.n_cols; col++)
-  {
-    // If the transition probability sum is greater than 0 in this column, the
-    // emission probability sum will also be greater than 0.  We want to avoid
-    // division by 0.
-    double sum = accu(transition.col(col));
-    if (sum > 0)
-      transition.col(col) /= sum;
-  }
+  // Estimate the transition matrix from the counts of each transition.
+  CountTransitions(stateSeq, transition);
 
-  // Estimate emission matrix.
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+  const bool parallelEstimate =
+      distribution::DistributionTraits<Distribution>::ParallelEstimate;
+
+  // Estimate emission matrix.  The states are independent, so they are
+  // estimated in parallel if the distribution allows it.
+  #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+      if(threads > 1 && parallelEstimate)
   for (size_t state = 0; state < transition.n_cols; state++)
   {
     // Generate full sequence of observations for this state from the list of
@@ -275,20 +312,153 @@ void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq,
   }
 }
 
+/**
+ * Train a discrete HMM with the Baum-Welch algorithm on sequences of packed
+ * symbols.
+ */
+template<typename Distribution, typename TransitionType>
+template<typename eT>
+void HMM<Distribution, TransitionType>::Train(
+    const std::vector<arma::Row<eT> >& dataSeq,
+    typename boost::enable_if<boost::is_integral<eT> >::type*)
+{
+  double loglik = 0;
+  double oldLoglik = 0;
+
+  // Maximum iterations?
+  size_t iterations = 1000;
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  for (size_t iter = 0; iter < iterations; iter++)
+  {
+    const arma::mat table = EmissionTable();
+
+    // Each thread sums the transition statistics and the expected number of
+    // times each state emits each symbol of its own sequences.
+    std::vector<arma::mat> threadTransition(threads);
+    std::vector<arma::mat> threadEmission(threads,
+        arma::zeros<arma::mat>(table.n_rows, table.n_cols));
+    for (size_t t = 0; t < threads; t++)
+      ZeroTransitionStatistics(transition, threadTransition[t]);
+
+    loglik = 0;
+
+    #pragma omp parallel num_threads(threads) reduction(+:loglik)
+    {
+#ifdef _OPENMP
+      const size_t thread = omp_get_thread_num();
+#else
+      const size_t thread = 0;
+#endif
+      arma::mat& newTransition = threadTransition[thread];
+      arma::mat& newEmission = threadEmission[thread];
+
+      arma::mat emissionProb;
+      arma::mat stateProb;
+      arma::mat forward;
+      arma::mat backward;
+      arma::vec scales;
+      arma::mat scaledBackward;
+
+      #pragma omp for schedule(dynamic)
+      for (size_t seq = 0; seq < dataSeq.size(); seq++)
+      {
+        const arma::Row<eT>& observations = dataSeq[seq];
+
+        if (observations.n_elem == 0)
+          continue;
+
+        // The E-step.
+        EmissionProbabilities(observations, table, emissionProb);
+        loglik += EstimateFromEmission(emissionProb, stateProb, forward,
+            backward, scales);
+
+        AddSequenceStatistics(emissionProb, forward, backward, scales,
+            scaledBackward, newTransition);
+
+        for (size_t t = 0; t < observations.n_elem; t++)
+          newEmission.col(size_t(observations[t])) += stateProb.col(t);
+      }
+    }
+
+    // Reduce the statistics of each thread.
+    arma::mat newTransition = threadTransition[0];
+    arma::mat newEmission = threadEmission[0];
+    for (size_t t = 1; t < threads; t++)
+    {
+      newTransition += threadTransition[t];
+      newEmission += threadEmission[t];
+    }
+
+    // The initial probabilities are kept, as with the other overload of
+    // Train().
+    UpdateTransition(transition, newTransition);
+
+    // Normalize the expected counts of each state, as
+    // DiscreteDistribution::Estimate() does.
+    for (size_t state = 0; state < transition.n_cols; state++)
+    {
+      arma::vec& probabilities = emission[state].Probabilities();
+      probabilities = trans(newEmission.row(state));
+      const double sum = accu(probabilities);
+      if (sum > 0)
+        probabilities /= sum;
+      else
+        probabilities.fill(1.0 / probabilities.n_elem);
+    }
+
+    Log::Debug << "Iteration " << iter << ": log-likelihood " << loglik
+        << std::endl;
+
+    if (std::abs(oldLoglik - loglik) < tolerance)
+    {
+      Log::Debug << "Converged after " << iter << " iterations." << std::endl;
+      break;
+    }
+
+    oldLoglik = loglik;
+  }
+}
+
 /**
  * Estimate the probabilities of each hidden state at each time step for each
  * given data observation.
  */
-template<typename Distribution>
-double HMM<Distribution>::Estimate(const arma::mat& dataSeq,
-                                   arma::mat& stateProb,
-                                   arma::mat& forwardProb,
-                                   arma::mat& backwardProb,
-                                   arma::vec& scales) const
+template<typename Distribution, typename TransitionType>
+double HMM<Distribution, TransitionType>::Estimate(
+    const arma::mat& dataSeq,
+    arma::mat& stateProb,
+    arma::mat& forwardProb,
+    arma::mat& backwardProb,
+    arma::vec& scales) const
+{
+  // The emission probabilities are shared by the forward and backward passes.
+  arma::mat emissionProb;
+  EmissionProbabilities(dataSeq, emissionProb);
+
+  return EstimateFromEmission(emissionProb, stateProb, forwardProb,
+      backwardProb, scales);
+}
+
+/**
+ * Run the forward-backward algorithm on the given emission probabilities.
+ */
+template<typename Distribution, typename TransitionType>
+double HMM<Distribution, TransitionType>::EstimateFromEmission(
+    const arma::mat& emissionProb,
+    arma::mat& stateProb,
+    arma::mat& forwardProb,
+    arma::mat& backwardProb,
+    arma::vec& scales) const
 {
   // First run the forward-backward algorithm.
-  Forward(dataSeq, scales, forwardProb);
-  Backward(dataSeq, scales, backwardProb);
+  ForwardRecursion(emissionProb, scales, forwardProb);
+  BackwardRecursion(emissionProb, scales, backwardProb);
 
   // Now assemble the state probability matrix based on the forward and backward
   // probabilities.
@@ -302,9 +472,10 @@ double HMM<Distribution>::Estimate(const arma::mat& dataSeq,
  * Estimate the probabilities of each hidden state at each time step for each
  * given data observation.
  */
-template<typename Distribution>
-double HMM<Distribution>::Estimate(const arma::mat& dataSeq,
-                                   arma::mat& stateProb) const
+template<typename Distribution, typename TransitionType>
+double HMM<Distribution, TransitionType>::Estimate(
+    const arma::mat& dataSeq,
+    arma::mat& stateProb) const
 {
   // We don't need to save these.
   arma::mat forwardProb, backwardProb;
@@ -313,16 +484,37 @@ double HMM<Distribution>::Estimate(const arma::mat& dataSeq,
   return Estimate(dataSeq, stateProb, forwardProb, backwardProb, scales);
 }
 
+/**
+ * Estimate the probabilities of each hidden state at each time step of a
+ * sequence of packed symbols.
+ */
+template<typename Distribution, typename TransitionType>
+template<typename eT>
+double HMM<Distribution, TransitionType>::Estimate(
+    const arma::Row<eT>& dataSeq,
+    arma::mat& stateProb,
+    typename boost::enable_if<boost::is_integral<eT> >::type*) const
+{
+  arma::mat emissionProb;
+  EmissionProbabilities(dataSeq, EmissionTable(), emissionProb);
+
+  arma::mat forwardProb, backwardProb;
+  arma::vec scales;
+  return EstimateFromEmission(emissionProb, stateProb, forwardProb,
+      backwardProb, scales);
+}
+
 /**
  * Generate a random data sequence of a given length.  The data sequence is
  * stored in the dataSequence parameter, and the state sequence is stored in
  * the stateSequence parameter.
  */
-template<typename Distribution>
-void HMM<Distribution>::Generate(const size_t length,
-                                 arma::mat& dataSequence,
-                                 arma::Col<size_t>& stateSequence,
-                                 const size_t startState) const
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::Generate(
+    const size_t length,
+    arma::mat& dataSequence,
+    arma::Col<size_t>& stateSequence,
+    const size_t startState) const
 {
   // Set vectors to the right size.
   stateSequence.set_size(length);
@@ -362,41 +554,137 @@ void HMM<Distribution>::Generate(const size_t length,
   }
 }
 
+/**
+ * Generate many random data sequences, in parallel if the emissions can be
+ * drawn from independent streams.
+ */
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::Generate(
+    const size_t sequences,
+    const size_t length,
+    std::vector<arma::mat>& dataSequences,
+    std::vector<arma::Col<size_t> >& stateSequences,
+    const size_t startState) const
+{
+  dataSequences.resize(sequences);
+  stateSequences.resize(sequences);
+
+  // An alias table for the transitions out of each state; only the nonzero
+  // transitions are stored.
+  std::vector<math::AliasTable> transitionTables(transition.n_cols);
+  for (size_t state = 0; state < transition.n_cols; ++state)
+    transitionTables[state].Build(arma::vec(arma::mat(transition.col(state))));
+
+  // Each sequence is drawn from its own stream.  If the emissions can only be
+  // drawn from the global generator, the sequences are generated serially.
+  const uint64_t streamKey = math::NewStreamKey();
+  const bool parallelGenerate = HasStreamRandom<Distribution,
+      void(Distribution::*)(const size_t, math::RandomStream&, arma::mat&)
+      const>::value;
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+      if(threads > 1 && parallelGenerate)
+  for (size_t seq = 0; seq < sequences; ++seq)
+  {
+    math::RandomStream stream(streamKey, seq);
+
+    arma::Col<size_t>& stateSequence = stateSequences[seq];
+    stateSequence.set_size(length);
+    dataSequences[seq].set_size(dimensionality, length);
+    if (length == 0)
+      continue;
+
+    stateSequence[0] = startState;
+    for (size_t t = 1; t < length; ++t)
+      stateSequence[t] = transitionTables[stateSequence[t - 1]].Sample(stream);
+
+    GenerateEmissions(emission, stateSequence, stream, dataSequences[seq]);
+  }
+}
+
 /**
  * Compute the most probable hidden state sequence for the given observation
  * using the Viterbi algorithm. Returns the log-likelihood of the most likely
  * sequence.
  */
-template<typename Distribution>
-double HMM<Distribution>::Predict(const arma::mat& dataSeq,
-                                  arma::Col<size_t>& stateSeq) const
+template<typename Distribution, typename TransitionType>
+double HMM<Distribution, TransitionType>::Predict(
+    const arma::mat& dataSeq,
+    arma::Col<size_t>& stateSeq) const
+{
+  // With a sparse transition matrix, only the nonzero transitions are
+  // followed, as with beam pruning but without any pruning.
+  if (SparseTransition(transition))
+    return BeamPredict(dataSeq, stateSeq, 0);
+
+  // The log of the emission probability of each state for each observation.
+  arma::mat logEmissionProb;
+  LogEmissionProbabilities(dataSeq, logEmissionProb);
+
+  return PredictFromLogEmission(logEmissionProb, stateSeq);
+}
+
+/**
+ * Compute the most probable hidden state sequence for the given sequence of
+ * packed symbols.
+ */
+template<typename Distribution, typename TransitionType>
+template<typename eT>
+double HMM<Distribution, TransitionType>::Predict(
+    const arma::Row<eT>& dataSeq,
+    arma::Col<size_t>& stateSeq,
+    typename boost::enable_if<boost::is_integral<eT> >::type*) const
+{
+  // BeamPredict() evaluates the emissions of the reached states only, so it
+  // takes the symbols as an arma::mat.
+  if (SparseTransition(transition))
+    return BeamPredict(arma::conv_to<arma::mat>::from(dataSeq), stateSeq, 0);
+
+  arma::mat logEmissionProb;
+  EmissionProbabilities(dataSeq, arma::log(EmissionTable()),
+      logEmissionProb);
+
+  return PredictFromLogEmission(logEmissionProb, stateSeq);
+}
+
+/**
+ * The Viterbi algorithm, given the log emission probabilities.
+ */
+template<typename Distribution, typename TransitionType>
+double HMM<Distribution, TransitionType>::PredictFromLogEmission(
+    const arma::mat& logEmissionProb,
+    arma::Col<size_t>& stateSeq) const
 {
+  const size_t length = logEmissionProb.n_cols;
+
   // This is an implementation of the Viterbi algorithm for finding the most
   // probable sequence of states to produce the observed data sequence.  We
   // don't use log-likelihoods to save that little bit of time, but we'll
   // calculate the log-likelihood at the end of it all.
-  stateSeq.set_size(dataSeq.n_cols);
-  arma::mat logStateProb(transition.n_rows, dataSeq.n_cols);
-  arma::mat stateSeqBack(transition.n_rows, dataSeq.n_cols);
+  stateSeq.set_size(length);
+  arma::mat logStateProb(transition.n_rows, length);
+  arma::mat stateSeqBack(transition.n_rows, length);
 
   // Store the logs of the transposed transition matrix.  This is because we
   // will be using the rows of the transition matrix.
-  arma::mat logTrans(log(trans(transition)));
+  arma::mat logTrans(log(trans(DenseTransition(transition))));
 
   // The calculation of the first state is slightly different; the probability
   // of the first state being state j is the maximum probability that the state
   // came to be j from another state.
-  logStateProb.col(0).zeros();
+  logStateProb.col(0) = log(initial) + logEmissionProb.col(0);
   for (size_t state = 0; state < transition.n_rows; state++)
-  {
-    logStateProb(state, 0) = log(initial[state] *
-        emission[state].Probability(dataSeq.unsafe_col(0)));
     stateSeqBack(state, 0) = state;
-  }
 
   // Store the best first state.
   arma::uword index;
-  for (size_t t = 1; t < dataSeq.n_cols; t++)
+  for (size_t t = 1; t < length; t++)
   {
     // Assemble the state probability for this element.
     // Given that we are in state j, we use state with the highest probability
@@ -404,27 +692,162 @@ double HMM<Distribution>::Predict(const arma::mat& dataSeq,
     for (size_t j = 0; j < transition.n_rows; j++)
     {
       arma::vec prob = logStateProb.col(t - 1) + logTrans.col(j);
-      logStateProb(j, t) = prob.max(index) +
-          log(emission[j].Probability(dataSeq.unsafe_col(t)));
-        stateSeqBack(j, t) = index;
+      logStateProb(j, t) = prob.max(index) + logEmissionProb(j, t);
+      stateSeqBack(j, t) = index;
     }
   }
 
   // Backtrack to find the most probable state sequence.
-  logStateProb.unsafe_col(dataSeq.n_cols - 1).max(index);
-  stateSeq[dataSeq.n_cols - 1] = index;
-  for (size_t t = 2; t <= dataSeq.n_cols; t++)
-    stateSeq[dataSeq.n_cols - t] =
-        stateSeqBack(stateSeq[dataSeq.n_cols - t + 1], dataSeq.n_cols - t + 1);
+  logStateProb.unsafe_col(length - 1).max(index);
+  stateSeq[length - 1] = index;
+  for (size_t t = 2; t <= length; t++)
+    stateSeq[length - t] =
+        stateSeqBack(stateSeq[length - t + 1], length - t + 1);
 
-  return logStateProb(stateSeq(dataSeq.n_cols - 1), dataSeq.n_cols - 1);
+  return logStateProb(stateSeq(length - 1), length - 1);
+}
+
+/**
+ * Compute an approximation of the most probable hidden state sequence with
+ * beam pruning.
+ */
+template<typename Distribution, typename TransitionType>
+double HMM<Distribution, TransitionType>::BeamPredict(
+    const arma::mat& dataSeq,
+    arma::Col<size_t>& stateSeq,
+    const size_t beamWidth,
+    const double beamMargin) const
+{
+  const size_t states = transition.n_rows;
+  const double negInfinity = -std::numeric_limits<double>::infinity();
+
+  // Column i of the sparse transition matrix holds the transitions out of
+  // state i.
+  const arma::sp_mat sparseTransition(transition);
+
+  // The kept states at each time step, and the index (in the kept states of
+  // the previous time step) of the state each came from.
+  std::vector<std::vector<size_t> > keptStates(dataSeq.n_cols);
+  std::vector<std::vector<size_t> > keptParents(dataSeq.n_cols);
+  std::vector<double> keptLogProb;
+
+  // The best log-probability of each state reached at the current time step,
+  // and where it came from (size_t(-1) if the state is not reached).
+  arma::vec logProb(states);
+  std::vector<size_t> parent(states, size_t(-1));
+  std::vector<size_t> reached;
+  std::vector<std::pair<double, size_t> > candidates;
+
+  for (size_t t = 0; t < dataSeq.n_cols; t++)
+  {
+    reached.clear();
+    if (t == 0)
+    {
+      for (size_t state = 0; state < states; state++)
+      {
+        if (initial[state] > 0)
+        {
+          logProb[state] = log(initial[state]);
+          parent[state] = 0;
+          reached.push_back(state);
+        }
+      }
+    }
+    else
+    {
+      // Follow the transitions out of each kept state.
+      for (size_t k = 0; k < keptStates[t - 1].size(); k++)
+      {
+        const size_t from = keptStates[t - 1][k];
+        for (arma::sp_mat::const_iterator it =
+             sparseTransition.begin_col(from);
+             it != sparseTransition.end_col(from); ++it)
+        {
+          const size_t to = it.row();
+          const double candidate = keptLogProb[k] + log(*it);
+          if (parent[to] == size_t(-1))
+          {
+            reached.push_back(to);
+            logProb[to] = candidate;
+            parent[to] = k;
+          }
+          else if (candidate > logProb[to])
+          {
+            logProb[to] = candidate;
+            parent[to] = k;
+          }
+        }
+      }
+    }
+
+    if (reached.empty())
+      Log::Fatal << "HMM::BeamPredict(): no state can emit observation " << t
+          << "!" << std::endl;
+
+    // Only the reached states need their emission probability.
+    candidates.resize(reached.size());
+    double best = negInfinity;
+    for (size_t r = 0; r < reached.size(); r++)
+    {
+      const size_t state = reached[r];
+      const double p = logProb[state] +
+          log(emission[state].Probability(dataSeq.unsafe_col(t)));
+      candidates[r] = std::make_pair(-p, state);
+      best = std::max(best, p);
+    }
+
+    // Keep the beamWidth best states within the margin of the best state.
+    size_t kept = candidates.size();
+    if (beamWidth > 0 && beamWidth < kept)
+    {
+      std::nth_element(candidates.begin(), candidates.begin() + beamWidth,
+          candidates.end());
+      kept = beamWidth;
+    }
+
+    keptLogProb.clear();
+    for (size_t r = 0; r < kept; r++)
+    {
+      const double p = -candidates[r].first;
+      if (beamMargin != DBL_MAX && p < best - beamMargin)
+        continue;
+
+      keptStates[t].push_back(candidates[r].second);
+      keptParents[t].push_back(parent[candidates[r].second]);
+      keptLogProb.push_back(p);
+    }
+
+    // Reset the states reached at this time step.
+    for (size_t r = 0; r < reached.size(); r++)
+      parent[reached[r]] = size_t(-1);
+  }
+
+  // Backtrack from the best final state.
+  stateSeq.set_size(dataSeq.n_cols);
+  if (dataSeq.n_cols == 0)
+    return 0.0;
+
+  size_t index = 0;
+  for (size_t k = 1; k < keptLogProb.size(); k++)
+    if (keptLogProb[k] > keptLogProb[index])
+      index = k;
+  const double result = keptLogProb[index];
+
+  for (size_t t = dataSeq.n_cols; t > 0; t--)
+  {
+    stateSeq[t - 1] = keptStates[t - 1][index];
+    index = keptParents[t - 1][index];
+  }
+
+  return result;
 }
 
 /**
  * Compute the log-likelihood of the given data sequence.
  */
-template<typename Distribution>
-double HMM<Distribution>::LogLikelihood(const arma::mat& dataSeq) const
+template<typename Distribution, typename TransitionType>
+double HMM<Distribution, TransitionType>::LogLikelihood(
+    const arma::mat& dataSeq) const
 {
   arma::mat forward;
   arma::vec scales;
@@ -435,13 +858,33 @@ double HMM<Distribution>::LogLikelihood(const arma::mat& dataSeq) const
   return accu(log(scales));
 }
 
+/**
+ * Compute the log-likelihood of the given sequence of packed symbols.
+ */
+template<typename Distribution, typename TransitionType>
+template<typename eT>
+double HMM<Distribution, TransitionType>::LogLikelihood(
+    const arma::Row<eT>& dataSeq,
+    typename boost::enable_if<boost::is_integral<eT> >::type*) const
+{
+  arma::mat emissionProb;
+  EmissionProbabilities(dataSeq, EmissionTable(), emissionProb);
+
+  arma::mat forward;
+  arma::vec scales;
+  ForwardRecursion(emissionProb, scales, forward);
+
+  return accu(log(scales));
+}
+
 /**
  * HMM filtering.
  */
-template<typename Distribution>
-void HMM<Distribution>::Filter(const arma::mat& dataSeq,
-                               arma::mat& filterSeq,
-                               size_t ahead) const
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::Filter(
+    const arma::mat& dataSeq,
+    arma::mat& filterSeq,
+    size_t ahead) const
 {
   // First run the forward algorithm.
   arma::mat forwardProb;
@@ -462,9 +905,10 @@ void HMM<Distribution>::Filter(const arma::mat& dataSeq,
 /**
  * HMM smoothing.
  */
-template<typename Distribution>
-void HMM<Distribution>::Smooth(const arma::mat& dataSeq,
-                               arma::mat& smoothSeq) const
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::Smooth(
+    const arma::mat& dataSeq,
+    arma::mat& smoothSeq) const
 {
   // First run the forward algorithm.
   arma::mat stateProb;
@@ -480,41 +924,290 @@ void HMM<Distribution>::Smooth(const arma::mat& dataSeq,
 /**
  * The Forward procedure (part of the Forward-Backward algorithm).
  */
-template<typename Distribution>
-void HMM<Distribution>::Forward(const arma::mat& dataSeq,
-                                arma::vec& scales,
-                                arma::mat& forwardProb) const
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::Forward(
+    const arma::mat& dataSeq,
+    arma::vec& scales,
+    arma::mat& forwardProb) const
+{
+  arma::mat emissionProb;
+  EmissionProbabilities(dataSeq, emissionProb);
+  ForwardRecursion(emissionProb, scales, forwardProb);
+}
+
+/**
+ * The Backward procedure (part of the Forward-Backward algorithm).
+ */
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::Backward(
+    const arma::mat& dataSeq,
+    const arma::vec& scales,
+    arma::mat& backwardProb) const
+{
+  arma::mat emissionProb;
+  EmissionProbabilities(dataSeq, emissionProb);
+  BackwardRecursion(emissionProb, scales, backwardProb);
+}
+
+/**
+ * Compute the emission probability of each state for each observation, with
+ * one call per state if the distribution supports it.
+ */
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::EmissionProbabilities(
+    const arma::mat& dataSeq,
+    arma::mat& emissionProb) const
+{
+  emissionProb.set_size(transition.n_rows, dataSeq.n_cols);
+
+  arma::vec probabilities;
+  for (size_t state = 0; state < transition.n_rows; state++)
+  {
+    BatchProbability(emission[state], dataSeq, probabilities);
+    emissionProb.row(state) = trans(probabilities);
+  }
+}
+
+/**
+ * Compute the log of the emission probability of each state for each
+ * observation, with one call per state if the distribution supports it.
+ */
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::LogEmissionProbabilities(
+    const arma::mat& dataSeq,
+    arma::mat& logEmissionProb) const
+{
+  logEmissionProb.set_size(transition.n_rows, dataSeq.n_cols);
+
+  arma::vec logProbabilities;
+  for (size_t state = 0; state < transition.n_rows; state++)
+  {
+    BatchLogProbability(emission[state], dataSeq, logProbabilities);
+    logEmissionProb.row(state) = trans(logProbabilities);
+  }
+}
+
+/**
+ * Assemble the table of the emission probabilities of each state for each
+ * symbol, for a discrete HMM.
+ */
+template<typename Distribution, typename TransitionType>
+arma::mat HMM<Distribution, TransitionType>::EmissionTable() const
+{
+  const size_t symbols = (emission.size() > 0) ?
+      emission[0].Probabilities().n_elem : 0;
+
+  arma::mat table(emission.size(), symbols);
+  for (size_t state = 0; state < emission.size(); state++)
+  {
+    if (emission[state].Probabilities().n_elem != symbols)
+      Log::Fatal << "HMM::EmissionTable(): the distribution of state " << state
+          << " has " << emission[state].Probabilities().n_elem << " "
+          << "observations, but the distribution of state 0 has " << symbols
+          << "." << std::endl;
+
+    table.row(state) = trans(emission[state].Probabilities());
+  }
+
+  return table;
+}
+
+/**
+ * Compute the emission probability of each state for each symbol, by copying
+ * the column of the symbol from the table.
+ */
+template<typename Distribution, typename TransitionType>
+template<typename eT>
+void HMM<Distribution, TransitionType>::EmissionProbabilities(
+    const arma::Row<eT>& dataSeq,
+    const arma::mat& table,
+    arma::mat& emissionProb)
+{
+  emissionProb.set_size(table.n_rows, dataSeq.n_elem);
+  for (size_t t = 0; t < dataSeq.n_elem; t++)
+  {
+    // A negative symbol becomes too large to be valid.
+    const size_t symbol = size_t(dataSeq[t]);
+    if (symbol >= table.n_cols)
+      Log::Fatal << "HMM::EmissionProbabilities(): observation " << t << " is "
+          << "symbol " << dataSeq[t] << ", but the distributions only have "
+          << table.n_cols << " observations." << std::endl;
+
+    emissionProb.col(t) = table.col(symbol);
+  }
+}
+
+/**
+ * Add the transition statistics of one sequence, for Baum-Welch training.
+ */
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::AddSequenceStatistics(
+    const arma::mat& emissionProb,
+    const arma::mat& forward,
+    const arma::mat& backward,
+    const arma::vec& scales,
+    arma::mat& scaledBackward,
+    arma::mat& statistics) const
+{
+  // For a dense transition matrix, the sum over time is a matrix product.
+  const size_t length = emissionProb.n_cols;
+  if (length > 1)
+  {
+    scaledBackward = backward.cols(1, length - 1) %
+        emissionProb.cols(1, length - 1);
+    for (size_t t = 1; t < length; t++)
+      scaledBackward.col(t - 1) /= scales[t];
+
+    AddTransitionStatistics(transition, scaledBackward,
+        forward.cols(0, length - 2), statistics);
+  }
+}
+
+template<typename Distribution, typename TransitionType>
+template<typename DistributionType>
+void HMM<Distribution, TransitionType>::GenerateEmissions(
+    const std::vector<DistributionType>& emission,
+    const arma::Col<size_t>& stateSequence,
+    math::RandomStream& stream,
+    arma::mat& dataSequence,
+    typename boost::enable_if<HasStreamRandom<DistributionType,
+        void(DistributionType::*)(const size_t, math::RandomStream&,
+            arma::mat&) const>
+    >::type*)
+{
+  // Sort the time steps by state, so that the emissions of each state are
+  // drawn together.
+  arma::Col<size_t> counts(emission.size());
+  counts.zeros();
+  for (size_t t = 0; t < stateSequence.n_elem; ++t)
+    ++counts[stateSequence[t]];
+
+  arma::Col<size_t> starts(emission.size());
+  for (size_t state = 0, start = 0; state < emission.size();
+       start += counts[state], ++state)
+    starts[state] = start;
+
+  arma::Col<size_t> order(stateSequence.n_elem);
+  arma::Col<size_t> next(starts);
+  for (size_t t = 0; t < stateSequence.n_elem; ++t)
+    order[next[stateSequence[t]]++] = t;
+
+  arma::mat observations;
+  for (size_t state = 0; state < emission.size(); ++state)
+  {
+    if (counts[state] == 0)
+      continue;
+
+    emission[state].Random(counts[state], stream, observations);
+    for (size_t i = 0; i < counts[state]; ++i)
+      dataSequence.col(order[starts[state] + i]) = observations.col(i);
+  }
+}
+
+template<typename Distribution, typename TransitionType>
+template<typename DistributionType>
+void HMM<Distribution, TransitionType>::GenerateEmissions(
+    const std::vector<DistributionType>& emission,
+    const arma::Col<size_t>& stateSequence,
+    math::RandomStream& /* stream */,
+    arma::mat& dataSequence,
+    typename boost::disable_if<HasStreamRandom<DistributionType,
+        void(DistributionType::*)(const size_t, math::RandomStream&,
+            arma::mat&) const>
+    >::type*)
+{
+  for (size_t t = 0; t < stateSequence.n_elem; ++t)
+    dataSequence.col(t) = emission[stateSequence[t]].Random();
+}
+
+template<typename Distribution, typename TransitionType>
+template<typename DistributionType>
+void HMM<Distribution, TransitionType>::BatchProbability(
+    const DistributionType& distribution,
+    const arma::mat& observations,
+    arma::vec& probabilities,
+    typename boost::enable_if<HasBatchProbability<DistributionType,
+        void(DistributionType::*)(const arma::mat&, arma::vec&) const>
+    >::type*)
+{
+  distribution.Probability(observations, probabilities);
+}
+
+template<typename Distribution, typename TransitionType>
+template<typename DistributionType>
+void HMM<Distribution, TransitionType>::BatchProbability(
+    const DistributionType& distribution,
+    const arma::mat& observations,
+    arma::vec& probabilities,
+    typename boost::disable_if<HasBatchProbability<DistributionType,
+        void(DistributionType::*)(const arma::mat&, arma::vec&) const>
+    >::type*)
+{
+  probabilities.set_size(observations.n_cols);
+  for (size_t t = 0; t < observations.n_cols; t++)
+    probabilities[t] = distribution.Probability(observations.unsafe_col(t));
+}
+
+template<typename Distribution, typename TransitionType>
+template<typename DistributionType>
+void HMM<Distribution, TransitionType>::BatchLogProbability(
+    const DistributionType& distribution,
+    const arma::mat& observations,
+    arma::vec& logProbabilities,
+    typename boost::enable_if<HasBatchLogProbability<DistributionType,
+        void(DistributionType::*)(const arma::mat&, arma::vec&) const>
+    >::type*)
+{
+  distribution.LogProbability(observations, logProbabilities);
+}
+
+template<typename Distribution, typename TransitionType>
+template<typename DistributionType>
+void HMM<Distribution, TransitionType>::BatchLogProbability(
+    const DistributionType& distribution,
+    const arma::mat& observations,
+    arma::vec& logProbabilities,
+    typename boost::disable_if<HasBatchLogProbability<DistributionType,
+        void(DistributionType::*)(const arma::mat&, arma::vec&) const>
+    >::type*)
+{
+  BatchProbability(distribution, observations, logProbabilities);
+  logProbabilities = log(logProbabilities);
+}
+
+/**
+ * The recursion of the Forward procedure.
+ */
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::ForwardRecursion(
+    const arma::mat& emissionProb,
+    arma::vec& scales,
+    arma::mat& forwardProb) const
 {
   // Our goal is to calculate the forward probabilities:
   //  P(X_k | o_{1:k}) for all possible states X_k, for each time point k.
-  forwardProb.zeros(transition.n_rows, dataSeq.n_cols);
-  scales.zeros(dataSeq.n_cols);
+  forwardProb.set_size(transition.n_rows, emissionProb.n_cols);
+  scales.zeros(emissionProb.n_cols);
 
   // The first entry in the forward algorithm uses the initial state
   // probabilities.  Note that MATLAB assumes that the starting state (at
   // t = -1) is state 0; this is not our assumption here.  To force that
   // behavior, you could append a single starting state to every single data
   // sequence and that should produce results in line with MATLAB.
-  for (size_t state = 0; state < transition.n_rows; state++)
-    forwardProb(state, 0) = initial(state) *
-        emission[state].Probability(dataSeq.unsafe_col(0));
+  forwardProb.col(0) = initial % emissionProb.col(0);
 
   // Then normalize the column.
   scales[0] = accu(forwardProb.col(0));
   forwardProb.col(0) /= scales[0];
 
-  // Now compute the probabilities for each successive observation.
-  for (size_t t = 1; t < dataSeq.n_cols; t++)
+  // Now compute the probabilities for each successive observation.  The
+  // forward probability of state j at time t is the sum over all states of the
+  // probability of the previous state transitioning to the current state,
+  // times the probability of state j emitting the given observation.
+  for (size_t t = 1; t < emissionProb.n_cols; t++)
   {
-    for (size_t j = 0; j < transition.n_rows; j++)
-    {
-      // The forward probability of state j at time t is the sum over all states
-      // of the probability of the previous state transitioning to the current
-      // state and emitting the given observation.
-      forwardProb(j, t) = accu(forwardProb.col(t - 1) %
-          trans(transition.row(j))) *
-          emission[j].Probability(dataSeq.unsafe_col(t));
-    }
+    const arma::vec previous = transition * forwardProb.col(t - 1);
+    forwardProb.col(t) = previous % emissionProb.col(t);
 
     // Normalize probability.
     scales[t] = accu(forwardProb.col(t));
@@ -522,39 +1215,177 @@ void HMM<Distribution>::Forward(const arma::mat& dataSeq,
   }
 }
 
-template<typename Distribution>
-void HMM<Distribution>::Backward(const arma::mat& dataSeq,
-                                 const arma::vec& scales,
-                                 arma::mat& backwardProb) const
+/**
+ * The recursion of the Backward procedure.
+ */
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::BackwardRecursion(
+    const arma::mat& emissionProb,
+    const arma::vec& scales,
+    arma::mat& backwardProb) const
 {
   // Our goal is to calculate the backward probabilities:
   //  P(X_k | o_{k + 1:T}) for all possible states X_k, for each time point k.
-  backwardProb.zeros(transition.n_rows, dataSeq.n_cols);
+  backwardProb.set_size(transition.n_rows, emissionProb.n_cols);
 
   // The last element probability is 1.
-  backwardProb.col(dataSeq.n_cols - 1).fill(1);
+  backwardProb.col(emissionProb.n_cols - 1).fill(1);
+
+  // Now step backwards through all other observations.  The backward
+  // probability of state j at time t is the sum over all states of the
+  // probability of the next state having been a transition from the current
+  // state, multiplied by the probability of each of those states emitting the
+  // next observation, normalized by the weights from the forward algorithm.
+  const TransitionType transitionT = trans(transition);
+  arma::vec next;
+  for (size_t t = emissionProb.n_cols - 1; t > 0; t--)
+  {
+    next = backwardProb.col(t) % emissionProb.col(t);
+    backwardProb.col(t - 1) = (transitionT * next) / scales[t];
+  }
+}
+
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::ZeroTransitionStatistics(
+    const arma::mat& transition,
+    arma::mat& statistics)
+{
+  statistics.zeros(transition.n_rows, transition.n_cols);
+}
+
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::ZeroTransitionStatistics(
+    const arma::sp_mat& transition,
+    arma::mat& statistics)
+{
+  statistics.zeros(transition.n_nonzero, 1);
+}
 
-  // Now step backwards through all other observations.
-  for (size_t t = dataSeq.n_cols - 2; t + 1 > 0; t--)
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::AddTransitionStatistics(
+    const arma::mat& /* transition */,
+    const arma::mat& scaledBackward,
+    const arma::mat& forward,
+    arma::mat& statistics)
+{
+  statistics += scaledBackward * trans(forward);
+}
+
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::AddTransitionStatistics(
+    const arma::sp_mat& transition,
+    const arma::mat& scaledBackward,
+    const arma::mat& forward,
+    arma::mat& statistics)
+{
+  // Each statistic is a dot product of two rows; transposing first makes them
+  // contiguous.
+  const arma::mat scaledBackwardT = trans(scaledBackward);
+  const arma::mat forwardT = trans(forward);
+
+  size_t k = 0;
+  for (arma::sp_mat::const_iterator it = transition.begin();
+       it != transition.end(); ++it, ++k)
+    statistics[k] += dot(scaledBackwardT.col(it.row()),
+        forwardT.col(it.col()));
+}
+
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::UpdateTransition(
+    arma::mat& transition,
+    const arma::mat& statistics)
+{
+  // We use %= (element-wise multiplication).
+  transition %= statistics;
+
+  // Now we normalize the transition matrix.
+  for (size_t i = 0; i < transition.n_cols; i++)
+    transition.col(i) /= accu(transition.col(i));
+}
+
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::UpdateTransition(
+    arma::sp_mat& transition,
+    const arma::mat& statistics)
+{
+  // Multiply each nonzero transition by its statistic, and sum each column.
+  arma::umat locations(2, transition.n_nonzero);
+  arma::vec values(transition.n_nonzero);
+  arma::vec sums = arma::zeros<arma::vec>(transition.n_cols);
+  size_t k = 0;
+  for (arma::sp_mat::const_iterator it = transition.begin();
+       it != transition.end(); ++it, ++k)
   {
-    for (size_t j = 0; j < transition.n_rows; j++)
+    locations(0, k) = it.row();
+    locations(1, k) = it.col();
+    values[k] = (*it) * statistics[k];
+    sums[it.col()] += values[k];
+  }
+
+  // Now we normalize the transition matrix.
+  for (size_t i = 0; i < values.n_elem; i++)
+    values[i] /= sums[locations(1, i)];
+
+  transition = arma::sp_mat(locations, values, transition.n_rows,
+      transition.n_cols);
+}
+
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::CountTransitions(
+    const std::vector<arma::Col<size_t> >& stateSeq,
+    arma::mat& transition)
+{
+  transition.zeros();
+  for (size_t seq = 0; seq < stateSeq.size(); seq++)
+    for (size_t t = 0; t + 1 < stateSeq[seq].n_elem; t++)
+      transition(stateSeq[seq][t + 1], stateSeq[seq][t])++;
+
+  // Normalize transition matrix.
+  for (size_t col = 0; col < transition.n_cols; col++)
+  {
+    // If the transition probability sum is greater than 0 in this column, the
+    // emission probability sum will also be greater than 0.  We want to avoid
+    // division by 0.
+    double sum = accu(transition.col(col));
+    if (sum > 0)
+      transition.col(col) /= sum;
+  }
+}
+
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::CountTransitions(
+    const std::vector<arma::Col<size_t> >& stateSeq,
+    arma::sp_mat& transition)
+{
+  // Count each transition that appears, in column-major order.
+  std::map<std::pair<size_t, size_t>, double> counts;
+  arma::vec sums = arma::zeros<arma::vec>(transition.n_cols);
+  for (size_t seq = 0; seq < stateSeq.size(); seq++)
+  {
+    for (size_t t = 0; t + 1 < stateSeq[seq].n_elem; t++)
     {
-      // The backward probability of state j at time t is the sum over all state
-      // of the probability of the next state having been a transition from the
-      // current state multiplied by the probability of each of those states
-      // emitting the given observation.
-      for (size_t state = 0; state < transition.n_rows; state++)
-        backwardProb(j, t) += transition(state, j) * backwardProb(state, t + 1)
-            * emission[state].Probability(dataSeq.unsafe_col(t + 1));
-
-      // Normalize by the weights from the forward algorithm.
-      backwardProb(j, t) /= scales[t + 1];
+      counts[std::make_pair(stateSeq[seq][t], stateSeq[seq][t + 1])]++;
+      sums[stateSeq[seq][t]]++;
     }
   }
+
+  arma::umat locations(2, counts.size());
+  arma::vec values(counts.size());
+  size_t k = 0;
+  for (std::map<std::pair<size_t, size_t>, double>::const_iterator it =
+       counts.begin(); it != counts.end(); ++it, ++k)
+  {
+    locations(0, k) = it->first.second;
+    locations(1, k) = it->first.first;
+    values[k] = it->second / sums[it->first.first];
+  }
+
+  transition = arma::sp_mat(locations, values, transition.n_rows,
+      transition.n_cols);
 }
 
-template<typename Distribution>
-std::string HMM<Distribution>::ToString() const
+template<typename Distribution, typename TransitionType>
+std::string HMM<Distribution, TransitionType>::ToString() const
 {
   std::ostringstream convert;
   convert << "HMM [" << this << "]" << std::endl;
@@ -566,15 +1397,15 @@ std::string HMM<Distribution>::ToString() const
 }
 
 //! Save to SaveRestoreUtility
-template<typename Distribution>
-void HMM<Distribution>::Save(util::SaveRestoreUtility& sr) const
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::Save(util::SaveRestoreUtility& sr) const
 {
   //  Save parameters.
   sr.SaveParameter(Type(), "type");
   sr.SaveParameter(Emission()[0].Type(), "emission_type");
   sr.SaveParameter(dimensionality, "dimensionality");
   sr.SaveParameter(transition.n_rows, "states");
-  sr.SaveParameter(transition, "transition");
+  sr.SaveParameter(DenseTransition(transition), "transition");
 
   // Now the emissions.
   util::SaveRestoreUtility mn;
@@ -589,12 +1420,14 @@ void HMM<Distribution>::Save(util::SaveRestoreUtility& sr) const
 }
 
 //! Load from SaveRestoreUtility
-template<typename Distribution>
-void HMM<Distribution>::Load(const util::SaveRestoreUtility& sr)
+template<typename Distribution, typename TransitionType>
+void HMM<Distribution, TransitionType>::Load(const util::SaveRestoreUtility& sr)
 {
   // Load parameters.
   sr.LoadParameter(dimensionality, "dimensionality");
-  sr.LoadParameter(transition, "transition");
+  arma::mat denseTransition;
+  sr.LoadParameter(denseTransition, "transition");
+  transition = TransitionType(denseTransition);
 
   // Now each emission distribution.
   Emission().resize(transition.n_rows);
@@ -232,6 +232,24 @@ class HMMRegression : public HMM<distribution::RegressionDistribution>
   double Predict(const arma::mat& predictors,
                  const arma::vec& responses,
                  arma::Col<size_t>& stateSeq) const;
+
+  /**
+   * Compute the most probable hidden state sequence of each of the given
+   * sequences of predictors and responses, using the Viterbi algorithm.  The
+   * sequences are independent, so they are handled in parallel, if OpenMP is
+   * available.
+   *
+   * @param predictors Vector of predictor sequences.
+   * @param responses Vector of response sequences.
+   * @param stateSeq Vector in which the most probable state sequence of each
+   *    sequence will be stored.
+   * @param logLikelihoods Vector in which the log-likelihood of the most
+   *    probable state sequence of each sequence will be stored.
+   */
+  void Predict(const std::vector<arma::mat>& predictors,
+               const std::vector<arma::vec>& responses,
+               std::vector<arma::Col<size_t> >& stateSeq,
+               arma::vec& logLikelihoods) const;
   
   /**
    * Compute the log-likelihood of the given predictors and responses.
@@ -261,6 +279,22 @@ class HMMRegression : public HMM<distribution::RegressionDistribution>
               arma::vec& filterSeq,
               size_t ahead = 0) const;
 
+  /**
+   * HMMR filtering of each of the given sequences (see the other overload of
+   * Filter()).  The sequences are independent, so they are handled in
+   * parallel, if OpenMP is available.
+   *
+   * @param predictors Vector of predictor sequences.
+   * @param responses Vector of response sequences.
+   * @param filterSeq Vector in which the expected emission sequence of each
+   *    sequence will be stored.
+   * @param ahead Number of steps ahead (k) for expectations.
+   */
+  void Filter(const std::vector<arma::mat>& predictors,
+              const std::vector<arma::vec>& responses,
+              std::vector<arma::vec>& filterSeq,
+              size_t ahead = 0) const;
+
   /**
    * HMM smoothing. Computes expected emission at each time conditioned on all
    * observations. That is
@@ -76,6 +76,37 @@ double HMMRegression::Predict(const arma::mat& predictors,
   return this->HMM::Predict(dataSeq, stateSeq);
 }
 
+/**
+ * Compute the most probable hidden state sequence of each of the given
+ * sequences, in parallel.
+ */
+void HMMRegression::Predict(const std::vector<arma::mat>& predictors,
+                            const std::vector<arma::vec>& responses,
+                            std::vector<arma::Col<size_t> >& stateSeq,
+                            arma::vec& logLikelihoods) const
+{
+  if (predictors.size() != responses.size())
+    Log::Fatal << "HMMRegression::Predict(): number of predictor sequences ("
+        << predictors.size() << ") not equal to number of response sequences ("
+        << responses.size() << ")." << std::endl;
+
+  stateSeq.resize(predictors.size());
+  logLikelihoods.set_size(predictors.size());
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  // The sequences have different lengths, so they are scheduled dynamically.
+  #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+      if(threads > 1)
+  for (size_t seq = 0; seq < predictors.size(); seq++)
+    logLikelihoods[seq] = Predict(predictors[seq], responses[seq],
+        stateSeq[seq]);
+}
+
 /**
  * Compute the log-likelihood of the given data sequence.
  */
@@ -117,6 +148,34 @@ void HMMRegression::Filter(const arma::mat& predictors,
   }
 }
 
+/**
+ * HMMRegression filtering of each of the given sequences, in parallel.
+ */
+void HMMRegression::Filter(const std::vector<arma::mat>& predictors,
+                           const std::vector<arma::vec>& responses,
+                           std::vector<arma::vec>& filterSeq,
+                           size_t ahead) const
+{
+  if (predictors.size() != responses.size())
+    Log::Fatal << "HMMRegression::Filter(): number of predictor sequences ("
+        << predictors.size() << ") not equal to number of response sequences ("
+        << responses.size() << ")." << std::endl;
+
+  filterSeq.resize(predictors.size());
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  // The sequences have different lengths, so they are scheduled dynamically.
+  #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+      if(threads > 1)
+  for (size_t seq = 0; seq < predictors.size(); seq++)
+    Filter(predictors[seq], responses[seq], filterSeq[seq], ahead);
+}
+
 /**
  * HMM smoothing.
  */
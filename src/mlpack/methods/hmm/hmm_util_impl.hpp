@@ -115,7 +115,9 @@ void ConvertHMM(HMM<distribution::GaussianDistribution>& hmm,
 
     s.str("");
     s << "hmm_emission_covariance_" << i;
-    sr.LoadParameter(hmm.Emission()[i].Covariance(), s.str());
+    arma::mat covariance;
+    sr.LoadParameter(covariance, s.str());
+    hmm.Emission()[i].Covariance(covariance);
   }
 
   hmm.Dimensionality() = hmm.Emission()[0].Mean().n_elem;
@@ -167,7 +169,9 @@ void ConvertHMM(HMM<gmm::GMM<> >& hmm, const util::SaveRestoreUtility& sr)
 
       s.str("");
       s << "hmm_emission_" << i << "_gaussian_" << g << "_covariance";
-      sr.LoadParameter(hmm.Emission()[i].Component(g).Covariance(), s.str());
+      arma::mat covariance;
+      sr.LoadParameter(covariance, s.str());
+      hmm.Emission()[i].Component(g).Covariance(covariance);
     }
 
     s.str("");
@@ -6,6 +6,7 @@
  * sequence for a given HMM.
  */
 #include <mlpack/core.hpp>
+#include <mlpack/core/util/server.hpp>
 
 #include "hmm.hpp"
 #include "hmm_util.hpp"
@@ -16,12 +17,44 @@ PROGRAM_INFO("Hidden Markov Model (HMM) Viterbi State Prediction", "This "
     "utility takes an already-trained HMM (--model_file) and evaluates the "
     "most probably hidden state sequence of a given sequence of observations "
     "(--input_file), using the Viterbi algorithm.  The computed state sequence "
-    "is saved to the specified output file (--output_file).");
+    "is saved to the specified output file (--output_file)."
+    "\n\n"
+    "If --batch is given, --input_file is expected to contain a list of files "
+    "of observation sequences, one per line.  The model is loaded only once, "
+    "and the sequences are decoded in parallel (if OpenMP is available).  The "
+    "state sequence of each observation sequence is written to --output_file "
+    "as one line of comma-separated states, in the order of the list, as soon "
+    "as the sequence and those before it have been decoded.  A sequence which "
+    "cannot be loaded, or has the wrong dimensionality, gives an empty line."
+    "\n\n"
+    "For models with many states, an approximate state sequence can be found "
+    "faster with beam pruning: after each observation, only the --beam_width "
+    "most probable states, and only states whose log-probability is within "
+    "--beam_margin of the best state, are kept."
+    "\n\n"
+    "With --server, the model is kept in memory and sequences are decoded as "
+    "they are requested, on the standard input and output (--server -) or on "
+    "a Unix socket created at the given path, instead of from --input_file.  "
+    "A request is a line 'viterbi <n>' followed by the n observations of a "
+    "sequence, one per line (as in a CSV file); the response is a line 'OK "
+    "<n>' followed by the state of each observation, one per line.  A request "
+    "'loglik <n>' is answered with the log-likelihood of the sequence instead."
+    );
 
-PARAM_STRING_REQ("input_file", "File containing observations,", "i");
+PARAM_STRING("input_file", "File containing observations,", "i", "");
 PARAM_STRING_REQ("model_file", "File containing HMM (XML).", "m");
 PARAM_STRING("output_file", "File to save predicted state sequence to.", "o",
     "output.csv");
+PARAM_FLAG("batch", "If true, input_file is expected to contain a list of "
+    "files to use as observation sequences.", "b");
+PARAM_INT("beam_width", "If nonzero, the maximum number of states kept after "
+    "each observation (beam pruning).", "w", 0);
+PARAM_DOUBLE("beam_margin", "If positive, only keep the states whose "
+    "log-probability is within this margin of the best state (beam pruning).",
+    "M", 0.0);
+PARAM_STRING("server", "If specified, serve decoding requests on the standard "
+    "input and output ('-') or on a Unix socket created at this path, instead "
+    "of decoding --input_file.", "", "");
 
 using namespace mlpack;
 using namespace mlpack::hmm;
@@ -31,76 +64,287 @@ using namespace mlpack::gmm;
 using namespace arma;
 using namespace std;
 
+/**
+ * Make sure the given observations can be decoded with the given HMM,
+ * returning an error message if not.
+ */
+template<typename HMMType>
+string CheckSequence(const HMMType& hmm, mat& dataSeq)
+{
+  // Verify correct dimensionality.
+  if (dataSeq.n_rows != hmm.Emission()[0].Dimensionality())
+  {
+    ostringstream error;
+    error << "Observation dimensionality (" << dataSeq.n_rows << ") does not "
+        << "match HMM Gaussian dimensionality ("
+        << hmm.Emission()[0].Dimensionality() << ")!";
+    return error.str();
+  }
+
+  return "";
+}
+
+//! Discrete observations are one-dimensional, and may be stored as a column.
+string CheckSequence(const HMM<DiscreteDistribution>& /* hmm */, mat& dataSeq)
+{
+  // Verify only one row in observations.
+  if (dataSeq.n_cols == 1)
+    dataSeq = trans(dataSeq);
+
+  if (dataSeq.n_rows > 1)
+    return "Only one-dimensional discrete observations allowed for discrete "
+        "HMMs!";
+
+  return "";
+}
+
+/**
+ * Compute the state sequence of the given observations, with beam pruning if
+ * it was requested.
+ */
+template<typename HMMType>
+void Viterbi(const HMMType& hmm,
+             const mat& dataSeq,
+             arma::Col<size_t>& sequence,
+             const size_t beamWidth,
+             const double beamMargin)
+{
+  if (beamWidth == 0 && beamMargin == DBL_MAX)
+    hmm.Predict(dataSeq, sequence);
+  else
+    hmm.BeamPredict(dataSeq, sequence, beamWidth, beamMargin);
+}
+
+/**
+ * Decode the sequence in the input file and save the state sequence to the
+ * output file.
+ */
+template<typename HMMType>
+void DecodeSequence(const HMMType& hmm,
+                    const string& inputFile,
+                    const string& outputFile,
+                    const size_t beamWidth,
+                    const double beamMargin)
+{
+  mat dataSeq;
+  data::Load(inputFile, dataSeq, true);
+
+  const string error = CheckSequence(hmm, dataSeq);
+  if (error != "")
+    Log::Fatal << error << endl;
+
+  arma::Col<size_t> sequence;
+  Viterbi(hmm, dataSeq, sequence, beamWidth, beamMargin);
+
+  // Save output.
+  data::Save(outputFile, sequence, true);
+}
+
+/**
+ * Decode each sequence listed in the input file, in parallel, and write each
+ * state sequence to the output file as one line, in the order of the list.
+ */
+template<typename HMMType>
+void DecodeBatch(const HMMType& hmm,
+                 const string& inputFile,
+                 const string& outputFile,
+                 const size_t beamWidth,
+                 const double beamMargin)
+{
+  Log::Info << "Reading list of observation sequences from '" << inputFile
+      << "'." << endl;
+
+  fstream f(inputFile.c_str(), ios_base::in);
+  if (!f.is_open())
+    Log::Fatal << "Could not open '" << inputFile << "' for reading." << endl;
+
+  vector<string> files;
+  string line;
+  while (getline(f, line))
+    if (line != "")
+      files.push_back(line);
+  f.close();
+
+  ofstream output(outputFile.c_str());
+  if (!output.is_open())
+    Log::Fatal << "Could not open '" << outputFile << "' for writing." << endl;
+
+  Log::Info << "Decoding " << files.size() << " sequences." << endl;
+
+  // Loading uses the (shared) timers and logging is not synchronized, so
+  // those happen in critical sections; the sequences are decoded in parallel,
+  // and the results are written in order as they become available.
+  size_t failed = 0;
+  #pragma omp parallel for ordered schedule(dynamic) reduction(+:failed)
+  for (size_t i = 0; i < files.size(); ++i)
+  {
+    mat dataSeq;
+    bool loaded;
+    #pragma omp critical(hmm_viterbi_log)
+    loaded = data::Load(files[i], dataSeq, false);
+
+    string error = loaded ? CheckSequence(hmm, dataSeq) :
+        "Loading observation sequence failed.";
+
+    arma::Col<size_t> sequence;
+    if (error == "")
+      Viterbi(hmm, dataSeq, sequence, beamWidth, beamMargin);
+    else
+      ++failed;
+
+    #pragma omp ordered
+    {
+      if (error != "")
+      {
+        #pragma omp critical(hmm_viterbi_log)
+        Log::Warn << "Sequence '" << files[i] << "' ignored: " << error
+            << endl;
+      }
+
+      for (size_t t = 0; t < sequence.n_elem; ++t)
+        output << ((t == 0) ? "" : ",") << sequence[t];
+      output << "\n";
+      output.flush();
+    }
+  }
+
+  if (failed > 0)
+    Log::Warn << failed << " of " << files.size() << " sequences could not be "
+        << "decoded." << endl;
+}
+
+/**
+ * Answers 'viterbi' and 'loglik' requests for the Server with a loaded HMM;
+ * the points of a request are the observations of one sequence.
+ */
+template<typename HMMType>
+class DecodeHandler
+{
+ public:
+  DecodeHandler(const HMMType& hmm,
+                const size_t beamWidth,
+                const double beamMargin) :
+      hmm(hmm),
+      beamWidth(beamWidth),
+      beamMargin(beamMargin)
+  { }
+
+  bool Handle(const ServerRequest& request, ServerResponse& response)
+  {
+    if (request.command != "viterbi" && request.command != "loglik")
+    {
+      response.error = "unknown command '" + request.command + "'; the "
+          "commands are 'viterbi' and 'loglik'";
+      return false;
+    }
+
+    if (request.data.n_cols == 0)
+    {
+      response.error = "the sequence is empty";
+      return false;
+    }
+
+    // Each observation was sent as one point, so a sequence of discrete
+    // observations arrives as a single row already.
+    mat dataSeq(request.data);
+    response.error = CheckSequence(hmm, dataSeq);
+    if (response.error != "")
+      return false;
+
+    if (request.command == "loglik")
+    {
+      response.data.set_size(1, 1);
+      response.data(0, 0) = hmm.LogLikelihood(dataSeq);
+      return true;
+    }
+
+    arma::Col<size_t> sequence;
+    Viterbi(hmm, dataSeq, sequence, beamWidth, beamMargin);
+
+    response.data.set_size(1, sequence.n_elem);
+    for (size_t t = 0; t < sequence.n_elem; ++t)
+      response.data(0, t) = sequence[t];
+
+    return true;
+  }
+
+ private:
+  //! The model.
+  const HMMType& hmm;
+  //! The beam width (0 for no limit).
+  size_t beamWidth;
+  //! The beam margin (DBL_MAX for no limit).
+  double beamMargin;
+};
+
+//! Decode one sequence or a batch of sequences with the given HMM.
+template<typename HMMType>
+void Decode(const HMMType& hmm)
+{
+  const string inputFile = CLI::GetParam<string>("input_file");
+  const string outputFile = CLI::GetParam<string>("output_file");
+
+  const int beamWidth = CLI::GetParam<int>("beam_width");
+  if (beamWidth < 0)
+    Log::Fatal << "Invalid beam width (" << beamWidth << "); must be greater "
+        << "than or equal to 0." << endl;
+  const double beamMargin = (CLI::GetParam<double>("beam_margin") > 0.0) ?
+      CLI::GetParam<double>("beam_margin") : DBL_MAX;
+
+  if (CLI::HasParam("server"))
+  {
+    DecodeHandler<HMMType> handler(hmm, (size_t) beamWidth, beamMargin);
+    Server<DecodeHandler<HMMType> > server(handler);
+    server.Run(CLI::GetParam<string>("server"));
+  }
+  else if (inputFile == "")
+  {
+    Log::Fatal << "--input_file is required unless --server is given." << endl;
+  }
+  else if (CLI::HasParam("batch"))
+    DecodeBatch(hmm, inputFile, outputFile, (size_t) beamWidth, beamMargin);
+  else
+    DecodeSequence(hmm, inputFile, outputFile, (size_t) beamWidth,
+        beamMargin);
+}
+
 int main(int argc, char** argv)
 {
   // Parse command line options.
   CLI::ParseCommandLine(argc, argv);
 
-  // Load observations.
-  const string inputFile = CLI::GetParam<string>("input_file");
   const string modelFile = CLI::GetParam<string>("model_file");
 
-  mat dataSeq;
-  data::Load(inputFile, dataSeq, true);
-
   // Load model, but first we have to determine its type.
   SaveRestoreUtility sr;
   sr.ReadFile(modelFile);
   string type;
   sr.LoadParameter(type, "hmm_type");
 
-  arma::Col<size_t> sequence;
   if (type == "discrete")
   {
     HMM<DiscreteDistribution> hmm(1, DiscreteDistribution(1));
 
     LoadHMM(hmm, sr);
-
-    // Verify only one row in observations.
-    if (dataSeq.n_cols == 1)
-      dataSeq = trans(dataSeq);
-
-    if (dataSeq.n_rows > 1)
-      Log::Fatal << "Only one-dimensional discrete observations allowed for "
-          << "discrete HMMs!" << endl;
-
-    hmm.Predict(dataSeq, sequence);
+    Decode(hmm);
   }
   else if (type == "gaussian")
   {
     HMM<GaussianDistribution> hmm(1, GaussianDistribution(1));
 
     LoadHMM(hmm, sr);
-
-    // Verify correct dimensionality.
-    if (dataSeq.n_rows != hmm.Emission()[0].Mean().n_elem)
-      Log::Fatal << "Observation dimensionality (" << dataSeq.n_rows << ") "
-          << "does not match HMM Gaussian dimensionality ("
-          << hmm.Emission()[0].Mean().n_elem << ")!" << endl;
-
-    hmm.Predict(dataSeq, sequence);
+    Decode(hmm);
   }
   else if (type == "gmm")
   {
     HMM<GMM<> > hmm(1, GMM<>(1, 1));
 
     LoadHMM(hmm, sr);
-
-    // Verify correct dimensionality.
-    if (dataSeq.n_rows != hmm.Emission()[0].Dimensionality())
-      Log::Fatal << "Observation dimensionality (" << dataSeq.n_rows << ") "
-          << "does not match HMM Gaussian dimensionality ("
-          << hmm.Emission()[0].Dimensionality() << ")!" << endl;
-
-    hmm.Predict(dataSeq, sequence);
+    Decode(hmm);
   }
   else
   {
     Log::Fatal << "Unknown HMM type '" << type << "' in file '" << modelFile
         << "'!" << endl;
   }
-
-  // Save output.
-  const string outputFile = CLI::GetParam<string>("output_file");
-  data::Save(outputFile, sequence, true);
 }
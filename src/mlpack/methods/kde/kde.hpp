@@ -0,0 +1,205 @@
+/**
+ * @file kde.hpp
+ *
+ * Defines the KDE class, which performs kernel density estimation with
+ * single-tree or dual-tree algorithms.
+ */
+#ifndef __MLPACK_METHODS_KDE_KDE_HPP
+#define __MLPACK_METHODS_KDE_KDE_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/kernels/gaussian_kernel.hpp>
+#include <mlpack/core/tree/binary_space_tree.hpp>
+#include "kde_stat.hpp"
+
+namespace mlpack {
+namespace kde /** Kernel density estimation. */ {
+
+/**
+ * The KDE class performs kernel density estimation: the density at each query
+ * point q is estimated from the N reference points r_i as
+ *
+ * @f[
+ * f(q) = \frac{1}{N h} \sum_{i = 1}^{N} K(|| q - r_i ||),
+ * @f]
+ *
+ * where h is the normalizer of the kernel (KernelType::Normalizer()) in the
+ * dimension of the data.  Computing the sum exactly takes O(N) time for each
+ * query point, so instead the reference points (and, with dual-tree
+ * evaluation, the query points) are organized in trees, and groups of points
+ * whose kernel values are close enough are approximated together.  Each
+ * estimate is then within
+ *
+ * @f[
+ * \epsilon_{rel} f(q) + \epsilon_{abs}
+ * @f]
+ *
+ * of the true density, where the relative and absolute error bounds are given
+ * to the constructor.  With both bounds 0, the estimates are exact (up to
+ * floating-point error).
+ *
+ * The kernel must be a shift-invariant kernel which does not increase with the
+ * distance and which has a Normalizer() method: GaussianKernel,
+ * EpanechnikovKernel, TriangularKernel, or SphericalKernel.  The distances are
+ * always Euclidean.  Any tree type which the traversers support may be used;
+ * the tree statistic must be KDEStat.
+ *
+ * @tparam KernelType Kernel to estimate the density with.
+ * @tparam TreeType Type of tree to organize the points in.
+ */
+template<typename KernelType = kernel::GaussianKernel,
+         typename TreeType = tree::BinarySpaceTree<bound::HRectBound<2>,
+                                                   KDEStat> >
+class KDE
+{
+ public:
+  /**
+   * Initialize the KDE object with the given reference set, building the
+   * reference tree on a copy of it (unless naive evaluation is used).
+   *
+   * @param referenceSet Reference dataset.
+   * @param kernel Instantiated kernel.
+   * @param relError Relative error allowed in each estimate.
+   * @param absError Absolute error allowed in each estimate.
+   * @param naive If true, the estimates are computed with O(N) naive sums.
+   * @param singleMode If true, single-tree evaluation is used (as opposed to
+   *      dual-tree evaluation).
+   */
+  KDE(const typename TreeType::Mat& referenceSet,
+      const KernelType kernel = KernelType(),
+      const double relError = 0.05,
+      const double absError = 0.0,
+      const bool naive = false,
+      const bool singleMode = false);
+
+  /**
+   * Initialize the KDE object with the given reference dataset and
+   * pre-constructed tree.  It is assumed that the points in referenceSet
+   * correspond to the points in referenceTree; no mapping of indices is done,
+   * so the estimates of Evaluate() without a query set are in the order of the
+   * points in referenceSet.
+   *
+   * @param referenceTree Pre-built tree for reference points.
+   * @param referenceSet Set of reference points corresponding to referenceTree.
+   * @param kernel Instantiated kernel.
+   * @param relError Relative error allowed in each estimate.
+   * @param absError Absolute error allowed in each estimate.
+   * @param singleMode If true, single-tree evaluation is used (as opposed to
+   *      dual-tree evaluation).
+   */
+  KDE(TreeType* referenceTree,
+      const typename TreeType::Mat& referenceSet,
+      const KernelType kernel = KernelType(),
+      const double relError = 0.05,
+      const double absError = 0.0,
+      const bool singleMode = false);
+
+  /**
+   * Delete the KDE object, and the reference tree if it was built by this
+   * object.
+   */
+  ~KDE();
+
+  /**
+   * Estimate the density at each of the given query points.  With dual-tree
+   * evaluation, a query tree is built on a copy of the query set.
+   *
+   * If NumThreads() is not 1, the query points are split between threads: in
+   * single-tree mode in blocks, and in dual-tree mode as disjoint subtrees of
+   * the top of the query tree (for the cover tree, by its own parallel
+   * traverser).  Each thread owns the estimates of its query points, so no
+   * locking is necessary.
+   *
+   * @param querySet Set of query points.
+   * @param estimations Vector to store the estimated density of each query
+   *     point in.
+   */
+  void Evaluate(const typename TreeType::Mat& querySet,
+                arma::vec& estimations);
+
+  /**
+   * Estimate the density at each of the reference points, using the reference
+   * tree as the query tree too.  Each point contributes to its own estimate.
+   *
+   * @param estimations Vector to store the estimated density of each reference
+   *     point in.
+   */
+  void Evaluate(arma::vec& estimations);
+
+  //! Get the kernel.
+  const KernelType& Kernel() const { return kernel; }
+  //! Modify the kernel.
+  KernelType& Kernel() { return kernel; }
+
+  //! Get the relative error bound.
+  double RelativeError() const { return relError; }
+  //! Modify the relative error bound.
+  double& RelativeError() { return relError; }
+
+  //! Get the absolute error bound.
+  double AbsoluteError() const { return absError; }
+  //! Modify the absolute error bound.
+  double& AbsoluteError() { return absError; }
+
+  //! Get the number of threads used for evaluation (0 means all available
+  //! threads).
+  size_t NumThreads() const { return numThreads; }
+  //! Modify the number of threads used for evaluation (0 means all available
+  //! threads).  This only has an effect if OpenMP is available.
+  size_t& NumThreads() { return numThreads; }
+
+  //! Return the total number of base cases performed during evaluation.
+  size_t BaseCases() const { return baseCases; }
+  //! Return the total number of node combinations scored during evaluation.
+  size_t Scores() const { return scores; }
+
+  //! Returns a string representation of this object.
+  std::string ToString() const;
+
+ private:
+  //! Copy of the reference dataset, if tree building modifies it.
+  typename TreeType::Mat referenceCopy;
+  //! Reference set (data should be accessed using this).
+  const typename TreeType::Mat& referenceSet;
+
+  //! Reference tree (NULL in naive mode).
+  TreeType* referenceTree;
+  //! Mappings to old reference indices (used when this object builds the
+  //! tree).
+  std::vector<size_t> oldFromNewReferences;
+
+  //! If true, this object is responsible for deleting the reference tree.
+  bool treeOwner;
+  //! If true, the estimates are computed with naive sums.
+  bool naive;
+  //! If true, single-tree evaluation is used.
+  bool singleMode;
+
+  //! The instantiated kernel.
+  KernelType kernel;
+  //! Relative error bound.
+  double relError;
+  //! Absolute error bound.
+  double absError;
+  //! Number of threads to use.
+  size_t numThreads;
+
+  //! Total number of base cases.
+  size_t baseCases;
+  //! Total number of scores.
+  size_t scores;
+
+  //! Compute the kernel sums of the given query points, which may be organized
+  //! in the given query tree (NULL unless in dual-tree mode).
+  void ComputeSums(const typename TreeType::Mat& querySet,
+                   TreeType* queryTree,
+                   arma::vec& sums);
+};
+
+}; // namespace kde
+}; // namespace mlpack
+
+// Include implementation.
+#include "kde_impl.hpp"
+
+#endif
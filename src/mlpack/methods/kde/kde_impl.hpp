@@ -0,0 +1,307 @@
+/**
+ * @file kde_impl.hpp
+ *
+ * Implementation of the KDE class.
+ */
+#ifndef __MLPACK_METHODS_KDE_KDE_IMPL_HPP
+#define __MLPACK_METHODS_KDE_KDE_IMPL_HPP
+
+// Just in case it hasn't been included.
+#include "kde.hpp"
+
+#include <mlpack/core/tree/gather_subtrees.hpp>
+
+// The rules for traversal.
+#include "kde_rules.hpp"
+
+// For tree building and the parallel dual-tree traversal helpers.
+#include "../neighbor_search/neighbor_search.hpp"
+
+namespace mlpack {
+namespace kde {
+
+template<typename KernelType, typename TreeType>
+KDE<KernelType, TreeType>::KDE(const typename TreeType::Mat& referenceSetIn,
+                               const KernelType kernel,
+                               const double relError,
+                               const double absError,
+                               const bool naive,
+                               const bool singleMode) :
+    referenceSet((tree::TreeTraits<TreeType>::RearrangesDataset && !naive) ?
+        referenceCopy : referenceSetIn),
+    referenceTree(NULL),
+    treeOwner(!naive), // If in naive mode, we are not building any trees.
+    naive(naive),
+    singleMode(!naive && singleMode), // Naive overrides single mode.
+    kernel(kernel),
+    relError(relError),
+    absError(absError),
+    numThreads(1),
+    baseCases(0),
+    scores(0)
+{
+  if (relError < 0.0 || absError < 0.0)
+    Log::Fatal << "KDE: the error bounds must not be negative." << std::endl;
+
+  // If in naive mode, then we do not need to build a tree.
+  if (!naive)
+  {
+    Timer::Start("kde/tree_building");
+
+    // Copy the dataset, if it will be modified during tree building.
+    if (tree::TreeTraits<TreeType>::RearrangesDataset)
+      referenceCopy = referenceSetIn;
+
+    // The const_cast is safe; if RearrangesDataset == false, then it'll be
+    // casted back to const anyway, and if not, referenceSet points to
+    // referenceCopy, which isn't const.
+    referenceTree = neighbor::BuildTree<TreeType>(
+        const_cast<typename TreeType::Mat&>(referenceSet),
+        oldFromNewReferences);
+
+    Timer::Stop("kde/tree_building");
+  }
+}
+
+template<typename KernelType, typename TreeType>
+KDE<KernelType, TreeType>::KDE(TreeType* referenceTree,
+                               const typename TreeType::Mat& referenceSet,
+                               const KernelType kernel,
+                               const double relError,
+                               const double absError,
+                               const bool singleMode) :
+    referenceSet(referenceSet),
+    referenceTree(referenceTree),
+    treeOwner(false),
+    naive(false),
+    singleMode(singleMode),
+    kernel(kernel),
+    relError(relError),
+    absError(absError),
+    numThreads(1),
+    baseCases(0),
+    scores(0)
+{
+  if (relError < 0.0 || absError < 0.0)
+    Log::Fatal << "KDE: the error bounds must not be negative." << std::endl;
+}
+
+template<typename KernelType, typename TreeType>
+KDE<KernelType, TreeType>::~KDE()
+{
+  if (treeOwner && referenceTree)
+    delete referenceTree;
+}
+
+template<typename KernelType, typename TreeType>
+void KDE<KernelType, TreeType>::Evaluate(
+    const typename TreeType::Mat& querySetIn,
+    arma::vec& estimations)
+{
+  if (querySetIn.n_rows != referenceSet.n_rows)
+  {
+    Log::Fatal << "KDE::Evaluate(): the query points have " << querySetIn.n_rows
+        << " dimensions, but the reference points have " << referenceSet.n_rows
+        << "." << std::endl;
+  }
+
+  // Only dual-tree evaluation needs a query tree.
+  if (naive || singleMode)
+  {
+    ComputeSums(querySetIn, NULL, estimations);
+  }
+  else
+  {
+    Timer::Start("kde/tree_building");
+    typename TreeType::Mat queryCopy(querySetIn);
+    std::vector<size_t> oldFromNewQueries;
+    TreeType* queryTree = neighbor::BuildTree<TreeType>(queryCopy,
+        oldFromNewQueries);
+    Timer::Stop("kde/tree_building");
+
+    arma::vec sums;
+    ComputeSums(queryCopy, queryTree, sums);
+    delete queryTree;
+
+    // Map the estimates back to the original order of the query points.
+    if (tree::TreeTraits<TreeType>::RearrangesDataset)
+    {
+      estimations.set_size(sums.n_elem);
+      for (size_t i = 0; i < sums.n_elem; ++i)
+        estimations[oldFromNewQueries[i]] = sums[i];
+    }
+    else
+    {
+      estimations.steal_mem(sums);
+    }
+  }
+
+  estimations /= referenceSet.n_cols * kernel.Normalizer(referenceSet.n_rows);
+}
+
+template<typename KernelType, typename TreeType>
+void KDE<KernelType, TreeType>::Evaluate(arma::vec& estimations)
+{
+  arma::vec sums;
+  ComputeSums(referenceSet, (naive || singleMode) ? NULL : referenceTree,
+      sums);
+
+  // Map the estimates back to the original order of the reference points, if
+  // we built the tree and it rearranged them.
+  if (treeOwner && tree::TreeTraits<TreeType>::RearrangesDataset)
+  {
+    estimations.set_size(sums.n_elem);
+    for (size_t i = 0; i < sums.n_elem; ++i)
+      estimations[oldFromNewReferences[i]] = sums[i];
+  }
+  else
+  {
+    estimations.steal_mem(sums);
+  }
+
+  estimations /= referenceSet.n_cols * kernel.Normalizer(referenceSet.n_rows);
+}
+
+template<typename KernelType, typename TreeType>
+void KDE<KernelType, TreeType>::ComputeSums(
+    const typename TreeType::Mat& querySet,
+    TreeType* queryTree,
+    arma::vec& sums)
+{
+  typedef KDERules<KernelType, TreeType> RuleType;
+
+  Timer::Start("kde/computing_densities");
+
+  sums.zeros(querySet.n_cols);
+
+  // The bounds are on the density, so the absolute error allowed in each
+  // kernel value is scaled by the normalizer of the kernel (the relative error
+  // is the same for the kernel values and their sum).
+  const double kernelAbsError = absError *
+      kernel.Normalizer(referenceSet.n_rows);
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads(numThreads);
+#else
+  const size_t threads = 1;
+#endif
+
+  size_t totalBaseCases = 0;
+  size_t totalScores = 0;
+  if (naive)
+  {
+    // The naive brute-force solution; each query point is independent.
+    #pragma omp parallel for schedule(static) num_threads(threads) \
+        reduction(+:totalBaseCases) if(threads > 1)
+    for (size_t i = 0; i < querySet.n_cols; ++i)
+    {
+      RuleType rules(referenceSet, querySet, sums, relError, kernelAbsError,
+          kernel);
+      for (size_t j = 0; j < referenceSet.n_cols; ++j)
+        rules.BaseCase(i, j);
+
+      totalBaseCases += rules.BaseCases();
+    }
+  }
+  else if (singleMode)
+  {
+    // Trees which cache distances in the reference nodes during single-tree
+    // traversal (the cover tree) can only be traversed by one thread.
+    const size_t blockThreads =
+        tree::TreeTraits<TreeType>::FirstPointIsCentroid ? 1 : threads;
+    const size_t blockSize = 256;
+    const size_t blocks = (querySet.n_cols + blockSize - 1) / blockSize;
+
+    #pragma omp parallel for schedule(dynamic) num_threads(blockThreads) \
+        reduction(+:totalBaseCases, totalScores) if(blockThreads > 1)
+    for (size_t b = 0; b < blocks; ++b)
+    {
+      RuleType rules(referenceSet, querySet, sums, relError, kernelAbsError,
+          kernel);
+      typename TreeType::template SingleTreeTraverser<RuleType>
+          traverser(rules);
+
+      const size_t end = std::min((b + 1) * blockSize,
+          (size_t) querySet.n_cols);
+      for (size_t i = b * blockSize; i < end; ++i)
+        traverser.Traverse(i, *referenceTree);
+
+      totalBaseCases += rules.BaseCases();
+      totalScores += rules.Scores();
+    }
+  }
+  else
+  {
+    RuleType rules(referenceSet, querySet, sums, relError, kernelAbsError,
+        kernel);
+
+    if (threads == 1) // Dual-tree recursion.
+    {
+      typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
+      traverser.Traverse(*queryTree, *referenceTree);
+
+      totalBaseCases = rules.BaseCases();
+      totalScores = rules.Scores();
+    }
+    else if (neighbor::TreeParallelTraverse(*queryTree, *referenceTree, rules,
+        threads)) // Parallel dual-tree recursion with the tree's traverser.
+    {
+      totalBaseCases = rules.BaseCases();
+      totalScores = rules.Scores();
+    }
+    else // Parallel dual-tree recursion.
+    {
+      // Split the query tree into disjoint subtrees.  Each traversal gets its
+      // own rules object, which only ever adds to the sums of the points of its
+      // own subtree.
+      std::vector<TreeType*> querySubtrees;
+      tree::GatherQuerySubtrees(*queryTree, 4 * threads, querySubtrees);
+
+      #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+          reduction(+:totalBaseCases, totalScores)
+      for (size_t i = 0; i < querySubtrees.size(); ++i)
+      {
+        RuleType threadRules(referenceSet, querySet, sums, relError,
+            kernelAbsError, kernel);
+        typename TreeType::template DualTreeTraverser<RuleType>
+            traverser(threadRules);
+
+        traverser.Traverse(*querySubtrees[i], *referenceTree);
+
+        totalBaseCases += threadRules.BaseCases();
+        totalScores += threadRules.Scores();
+      }
+    }
+  }
+
+  baseCases += totalBaseCases;
+  scores += totalScores;
+
+  Timer::Stop("kde/computing_densities");
+
+  Log::Info << totalScores << " node combinations were scored.\n";
+  Log::Info << totalBaseCases << " base cases were calculated.\n";
+}
+
+template<typename KernelType, typename TreeType>
+std::string KDE<KernelType, TreeType>::ToString() const
+{
+  std::ostringstream convert;
+  convert << "KDE [" << this << "]" << std::endl;
+  if (treeOwner)
+    convert << "  Tree Owner: TRUE" << std::endl;
+  if (naive)
+    convert << "  Naive: TRUE" << std::endl;
+  if (singleMode)
+    convert << "  Single Mode: TRUE" << std::endl;
+  convert << "  Relative Error: " << relError << std::endl;
+  convert << "  Absolute Error: " << absError << std::endl;
+  convert << "  Kernel: " << std::endl <<
+      mlpack::util::Indent(kernel.ToString(), 2);
+  return convert.str();
+}
+
+}; // namespace kde
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,193 @@
+/**
+ * @file kde_main.cpp
+ *
+ * Executable for kernel density estimation with single-tree or dual-tree
+ * algorithms.
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/core/kernels/gaussian_kernel.hpp>
+#include <mlpack/core/kernels/epanechnikov_kernel.hpp>
+#include <mlpack/core/kernels/triangular_kernel.hpp>
+#include <mlpack/core/kernels/spherical_kernel.hpp>
+#include <mlpack/core/tree/cover_tree.hpp>
+
+#include "kde.hpp"
+
+using namespace std;
+using namespace mlpack;
+using namespace mlpack::kde;
+using namespace mlpack::kernel;
+using namespace mlpack::tree;
+
+// Information about the program itself.
+PROGRAM_INFO("Kernel Density Estimation",
+    "This program estimates the probability density at each query point from "
+    "a set of reference points with a kernel: the density at a point q is the "
+    "sum of K(||q - r||) over the reference points r, divided by the number of "
+    "reference points and by the normalizing constant of the kernel.  If no "
+    "query file is given, the density is estimated at each reference point.  "
+    "The estimated densities are saved to the output file, one per line."
+    "\n\n"
+    "The kernel is chosen with --kernel ('gaussian', 'epanechnikov', "
+    "'triangular' or 'spherical') and its bandwidth with --bandwidth.  Instead "
+    "of summing every kernel value, the points are organized in kd-trees (or "
+    "cover trees, with --tree=cover), and groups of points which are far "
+    "enough apart are approximated together; each estimate is within "
+    "rel_error * (the true density) + abs_error of the true density.  With "
+    "--naive, the exact sums are computed instead."
+    "\n\n"
+    "For example, the following will estimate the density at each point of "
+    "'data.csv' with a Gaussian kernel of bandwidth 0.5 within 1% of the true "
+    "density, and store the estimates in 'density.csv':"
+    "\n\n"
+    "$ kde --reference_file=data.csv --bandwidth=0.5 --rel_error=0.01\n"
+    "  --output_file=density.csv");
+
+PARAM_STRING_REQ("reference_file", "File containing the reference dataset.",
+    "r");
+PARAM_STRING("query_file", "File containing the query points (optional).",
+    "q", "");
+PARAM_STRING_REQ("output_file", "File to save the estimated densities to.",
+    "o");
+
+PARAM_STRING("kernel", "Kernel to use: 'gaussian', 'epanechnikov', "
+    "'triangular', or 'spherical'.", "k", "gaussian");
+PARAM_DOUBLE("bandwidth", "Bandwidth of the kernel.", "b", 1.0);
+PARAM_DOUBLE("rel_error", "Relative error allowed in each estimate.", "e",
+    0.05);
+PARAM_DOUBLE("abs_error", "Absolute error allowed in each estimate.", "E",
+    0.0);
+
+PARAM_STRING("tree", "Type of tree to use: 'kd' or 'cover'.", "t", "kd");
+PARAM_FLAG("naive", "If true, the exact sums are computed in O(n^2) time.",
+    "N");
+PARAM_FLAG("single_mode", "If true, single-tree evaluation is used (as opposed "
+    "to dual-tree evaluation).", "s");
+PARAM_INT("num_threads", "Number of threads to use (0 uses all available "
+    "threads).  This has no effect unless mlpack was built with OpenMP.", "T",
+    1);
+
+//! Estimate the densities with the given kernel and tree type.
+template<typename KernelType, typename TreeType>
+void EstimateWithTree(const arma::mat& referenceData,
+                      const arma::mat& queryData,
+                      const bool hasQueries,
+                      const KernelType& kernel,
+                      const size_t numThreads,
+                      arma::vec& estimations)
+{
+  const double relError = CLI::GetParam<double>("rel_error");
+  const double absError = CLI::GetParam<double>("abs_error");
+  const bool naive = CLI::HasParam("naive");
+  const bool singleMode = CLI::HasParam("single_mode");
+
+  KDE<KernelType, TreeType> kde(referenceData, kernel, relError, absError,
+      naive, singleMode);
+  kde.NumThreads() = numThreads;
+
+  if (hasQueries)
+    kde.Evaluate(queryData, estimations);
+  else
+    kde.Evaluate(estimations);
+}
+
+//! Estimate the densities with the given kernel and the tree type given on the
+//! command line.
+template<typename KernelType>
+void Estimate(const arma::mat& referenceData,
+              const arma::mat& queryData,
+              const bool hasQueries,
+              const KernelType& kernel,
+              const size_t numThreads,
+              arma::vec& estimations)
+{
+  typedef BinarySpaceTree<bound::HRectBound<2>, KDEStat> KDTreeType;
+  typedef CoverTree<metric::EuclideanDistance, FirstPointIsRoot, KDEStat>
+      CoverTreeType;
+
+  if (CLI::GetParam<string>("tree") == "cover")
+    EstimateWithTree<KernelType, CoverTreeType>(referenceData, queryData,
+        hasQueries, kernel, numThreads, estimations);
+  else
+    EstimateWithTree<KernelType, KDTreeType>(referenceData, queryData,
+        hasQueries, kernel, numThreads, estimations);
+}
+
+int main(int argc, char *argv[])
+{
+  // Give CLI the command line parameters the user passed in.
+  CLI::ParseCommandLine(argc, argv);
+
+  const string kernelType = CLI::GetParam<string>("kernel");
+  const string treeType = CLI::GetParam<string>("tree");
+  const double bandwidth = CLI::GetParam<double>("bandwidth");
+
+  // Sanity checks on the parameters.
+  if (kernelType != "gaussian" && kernelType != "epanechnikov" &&
+      kernelType != "triangular" && kernelType != "spherical")
+  {
+    Log::Fatal << "Invalid kernel type: '" << kernelType << "'; must be "
+        << "'gaussian', 'epanechnikov', 'triangular', or 'spherical'." << endl;
+  }
+
+  if (treeType != "kd" && treeType != "cover")
+  {
+    Log::Fatal << "Invalid tree type: '" << treeType << "'; must be 'kd' or "
+        << "'cover'." << endl;
+  }
+
+  if (bandwidth <= 0.0)
+  {
+    Log::Fatal << "Invalid bandwidth: " << bandwidth << ".  Must be greater "
+        << "than 0." << endl;
+  }
+
+  if (CLI::GetParam<double>("rel_error") < 0.0 ||
+      CLI::GetParam<double>("abs_error") < 0.0)
+    Log::Fatal << "The error bounds must not be negative." << endl;
+
+  if (CLI::GetParam<int>("num_threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: "
+        << CLI::GetParam<int>("num_threads") << ".  Must be greater than or "
+        << "equal to 0." << endl;
+  }
+  const size_t numThreads = (size_t) CLI::GetParam<int>("num_threads");
+
+  // Naive mode overrides single mode.
+  if (CLI::HasParam("single_mode") && CLI::HasParam("naive"))
+    Log::Warn << "--single_mode ignored because --naive is present." << endl;
+
+  arma::mat referenceData;
+  data::Load(CLI::GetParam<string>("reference_file"), referenceData, true);
+  Log::Info << "Loaded reference data from '"
+      << CLI::GetParam<string>("reference_file") << "' ("
+      << referenceData.n_rows << " x " << referenceData.n_cols << ")." << endl;
+
+  arma::mat queryData;
+  const bool hasQueries = (CLI::GetParam<string>("query_file") != "");
+  if (hasQueries)
+  {
+    data::Load(CLI::GetParam<string>("query_file"), queryData, true);
+    Log::Info << "Loaded query data from '"
+        << CLI::GetParam<string>("query_file") << "' (" << queryData.n_rows
+        << " x " << queryData.n_cols << ")." << endl;
+  }
+
+  arma::vec estimations;
+  if (kernelType == "gaussian")
+    Estimate(referenceData, queryData, hasQueries, GaussianKernel(bandwidth),
+        numThreads, estimations);
+  else if (kernelType == "epanechnikov")
+    Estimate(referenceData, queryData, hasQueries,
+        EpanechnikovKernel(bandwidth), numThreads, estimations);
+  else if (kernelType == "triangular")
+    Estimate(referenceData, queryData, hasQueries, TriangularKernel(bandwidth),
+        numThreads, estimations);
+  else
+    Estimate(referenceData, queryData, hasQueries, SphericalKernel(bandwidth),
+        numThreads, estimations);
+
+  // Save one estimate per line (the column vector is not transposed).
+  data::Save(CLI::GetParam<string>("output_file"), estimations, false, false);
+}
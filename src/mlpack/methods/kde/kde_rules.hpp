@@ -0,0 +1,176 @@
+/**
+ * @file kde_rules.hpp
+ *
+ * Rules for dual-tree and single-tree kernel density estimation, for use with
+ * the tree traversers.
+ */
+#ifndef __MLPACK_METHODS_KDE_KDE_RULES_HPP
+#define __MLPACK_METHODS_KDE_KDE_RULES_HPP
+
+#include "../neighbor_search/ns_traversal_info.hpp"
+
+namespace mlpack {
+namespace kde {
+
+/**
+ * The rules for kernel density estimation.  The base case adds the kernel value
+ * between a query point and a reference point to the kernel sum of the query
+ * point.  A combination of nodes is pruned when the kernel values between any
+ * of their points lie within an interval narrow enough for the error bounds;
+ * then the midpoint of the interval is added to the kernel sum of each query
+ * point for each reference point, so the error of each kernel value is at most
+ *
+ * @f[
+ * \epsilon_{rel} K(d(q, r)) + \epsilon_{abs}.
+ * @f]
+ *
+ * The kernel must not increase with the distance, which is true for all the
+ * shift-invariant kernels in mlpack (the Gaussian, Epanechnikov, triangular and
+ * spherical kernels).
+ */
+template<typename KernelType, typename TreeType>
+class KDERules
+{
+ public:
+  /**
+   * Construct the KDERules object.  This is usually done from within the KDE
+   * class at evaluation time.
+   *
+   * @param referenceSet Set of reference data.
+   * @param querySet Set of query data.
+   * @param sums Kernel sums of the query points, which are added to.
+   * @param relError Relative error allowed in each kernel value.
+   * @param absError Absolute error allowed in each kernel value.
+   * @param kernel Instantiated kernel.
+   */
+  KDERules(const arma::mat& referenceSet,
+           const arma::mat& querySet,
+           arma::vec& sums,
+           const double relError,
+           const double absError,
+           KernelType& kernel);
+
+  /**
+   * Compute the base case between the given query point and reference point.
+   *
+   * @param queryIndex Index of query point.
+   * @param referenceIndex Index of reference point.
+   */
+  double BaseCase(const size_t queryIndex, const size_t referenceIndex);
+
+  /**
+   * Get the score for recursion order.  A low score indicates priority for
+   * recursion, while DBL_MAX indicates that the node should not be recursed
+   * into at all (it should be pruned).
+   *
+   * @param queryIndex Index of query point.
+   * @param referenceNode Candidate node to be recursed into.
+   */
+  double Score(const size_t queryIndex, TreeType& referenceNode);
+
+  /**
+   * Re-evaluate the score for recursion order.  The contribution of a node is
+   * added when it is pruned, so the old score is returned.
+   *
+   * @param queryIndex Index of query point.
+   * @param referenceNode Candidate node to be recursed into.
+   * @param oldScore Old score produced by Score() (or Rescore()).
+   */
+  double Rescore(const size_t queryIndex,
+                 TreeType& referenceNode,
+                 const double oldScore) const;
+
+  /**
+   * Get the score for recursion order.  A low score indicates priority for
+   * recursion, while DBL_MAX indicates that the node should not be recursed
+   * into at all (it should be pruned).
+   *
+   * @param queryNode Candidate query node to recurse into.
+   * @param referenceNode Candidate reference node to recurse into.
+   */
+  double Score(TreeType& queryNode, TreeType& referenceNode);
+
+  /**
+   * Re-evaluate the score for recursion order.  The contribution of a node
+   * combination is added when it is pruned, so the old score is returned.
+   *
+   * @param queryNode Candidate query node to recurse into.
+   * @param referenceNode Candidate reference node to recurse into.
+   * @param oldScore Old score produced by Score() (or Rescore()).
+   */
+  double Rescore(TreeType& queryNode,
+                 TreeType& referenceNode,
+                 const double oldScore) const;
+
+  typedef neighbor::NeighborSearchTraversalInfo<TreeType> TraversalInfoType;
+
+  const TraversalInfoType& TraversalInfo() const { return traversalInfo; }
+  TraversalInfoType& TraversalInfo() { return traversalInfo; }
+
+  //! Get the number of base cases that have been performed.
+  size_t BaseCases() const { return baseCases; }
+  //! Modify the number of base cases that have been performed.
+  size_t& BaseCases() { return baseCases; }
+
+  //! Get the number of node combinations that have been scored.
+  size_t Scores() const { return scores; }
+  //! Modify the number of node combinations that have been scored.
+  size_t& Scores() { return scores; }
+
+ private:
+  //! The reference set.
+  const arma::mat& referenceSet;
+  //! The query set.
+  const arma::mat& querySet;
+
+  //! The kernel sums of the query points.
+  arma::vec& sums;
+
+  //! Relative error allowed in each kernel value.
+  const double relError;
+  //! Absolute error allowed in each kernel value.
+  const double absError;
+
+  //! The instantiated kernel.
+  KernelType& kernel;
+
+  //! The last query index.
+  size_t lastQueryIndex;
+  //! The last reference index.
+  size_t lastReferenceIndex;
+  //! The distance of the last base case.
+  double lastBaseCase;
+
+  TraversalInfoType traversalInfo;
+
+  //! The number of base cases.
+  size_t baseCases;
+  //! The number of scores.
+  size_t scores;
+
+  //! Prune the given reference node for the given query point if the kernel
+  //! values for the given range of distances are close enough, adding the
+  //! estimated contribution of the node; return whether it was pruned.
+  bool Approximate(const size_t queryIndex,
+                   TreeType& referenceNode,
+                   const math::Range& distances);
+
+  //! Prune the given node combination if the kernel values for the given range
+  //! of distances are close enough, adding the estimated contribution of the
+  //! reference node to each query point; return whether it was pruned.
+  bool Approximate(TreeType& queryNode,
+                   TreeType& referenceNode,
+                   const math::Range& distances);
+
+  //! Get the number of points of the given reference node whose contribution
+  //! to the given query point has not been calculated by a base case.
+  size_t Uncalculated(const size_t queryIndex, TreeType& referenceNode) const;
+};
+
+}; // namespace kde
+}; // namespace mlpack
+
+// Include implementation.
+#include "kde_rules_impl.hpp"
+
+#endif
@@ -0,0 +1,245 @@
+/**
+ * @file kde_rules_impl.hpp
+ *
+ * Implementation of the rules for kernel density estimation with generic trees.
+ */
+#ifndef __MLPACK_METHODS_KDE_KDE_RULES_IMPL_HPP
+#define __MLPACK_METHODS_KDE_KDE_RULES_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "kde_rules.hpp"
+
+namespace mlpack {
+namespace kde {
+
+template<typename KernelType, typename TreeType>
+KDERules<KernelType, TreeType>::KDERules(const arma::mat& referenceSet,
+                                         const arma::mat& querySet,
+                                         arma::vec& sums,
+                                         const double relError,
+                                         const double absError,
+                                         KernelType& kernel) :
+    referenceSet(referenceSet),
+    querySet(querySet),
+    sums(sums),
+    relError(relError),
+    absError(absError),
+    kernel(kernel),
+    lastQueryIndex(querySet.n_cols),
+    lastReferenceIndex(referenceSet.n_cols),
+    lastBaseCase(0.0),
+    baseCases(0),
+    scores(0)
+{
+  // Nothing to do.
+}
+
+//! The base case.  Evaluate the kernel between the two points and add it to the
+//! kernel sum of the query point.
+template<typename KernelType, typename TreeType>
+inline force_inline
+double KDERules<KernelType, TreeType>::BaseCase(const size_t queryIndex,
+                                                const size_t referenceIndex)
+{
+  // If we have just performed this base case, don't add it again.
+  if ((lastQueryIndex == queryIndex) && (lastReferenceIndex == referenceIndex))
+    return lastBaseCase;
+
+  const double distance = metric::EuclideanDistance::Evaluate(
+      querySet.unsafe_col(queryIndex), referenceSet.unsafe_col(referenceIndex));
+  ++baseCases;
+
+  // Update last indices, so we don't accidentally perform a base case twice.
+  lastQueryIndex = queryIndex;
+  lastReferenceIndex = referenceIndex;
+  lastBaseCase = distance;
+
+  sums[queryIndex] += kernel.Evaluate(distance);
+
+  return distance;
+}
+
+//! Single-tree scoring function.
+template<typename KernelType, typename TreeType>
+double KDERules<KernelType, TreeType>::Score(const size_t queryIndex,
+                                             TreeType& referenceNode)
+{
+  ++scores;
+
+  math::Range distances;
+  if (tree::TreeTraits<TreeType>::FirstPointIsCentroid)
+  {
+    // In this situation, we calculate the base case.  So we should check to be
+    // sure we haven't already done that.
+    double baseCase;
+    if (tree::TreeTraits<TreeType>::HasSelfChildren &&
+        (referenceNode.Parent() != NULL) &&
+        (referenceNode.Point(0) == referenceNode.Parent()->Point(0)))
+    {
+      // If the tree has self-children and this is a self-child, the base case
+      // was already calculated.
+      baseCase = referenceNode.Parent()->Stat().LastDistance();
+      lastQueryIndex = queryIndex;
+      lastReferenceIndex = referenceNode.Point(0);
+      lastBaseCase = baseCase;
+    }
+    else
+    {
+      // We must calculate the base case by hand.
+      baseCase = BaseCase(queryIndex, referenceNode.Point(0));
+    }
+
+    distances.Lo() = baseCase - referenceNode.FurthestDescendantDistance();
+    distances.Hi() = baseCase + referenceNode.FurthestDescendantDistance();
+
+    // Update last distance calculation.
+    referenceNode.Stat().LastDistance() = baseCase;
+  }
+  else
+  {
+    distances = referenceNode.RangeDistance(querySet.unsafe_col(queryIndex));
+  }
+
+  if (Approximate(queryIndex, referenceNode, distances))
+    return DBL_MAX; // The contribution of the node has been added.
+
+  // Closer nodes are visited first, although the order doesn't affect the
+  // result.
+  return std::max(distances.Lo(), 0.0);
+}
+
+//! Single-tree rescoring function.
+template<typename KernelType, typename TreeType>
+double KDERules<KernelType, TreeType>::Rescore(
+    const size_t /* queryIndex */,
+    TreeType& /* referenceNode */,
+    const double oldScore) const
+{
+  // If it wasn't pruned before, it isn't pruned now.
+  return oldScore;
+}
+
+//! Dual-tree scoring function.
+template<typename KernelType, typename TreeType>
+double KDERules<KernelType, TreeType>::Score(TreeType& queryNode,
+                                             TreeType& referenceNode)
+{
+  ++scores;
+
+  math::Range distances;
+  if (tree::TreeTraits<TreeType>::FirstPointIsCentroid)
+  {
+    // It is possible that the base case has already been calculated.
+    double baseCase = 0.0;
+    if ((traversalInfo.LastQueryNode() != NULL) &&
+        (traversalInfo.LastReferenceNode() != NULL) &&
+        (traversalInfo.LastQueryNode()->Point(0) == queryNode.Point(0)) &&
+        (traversalInfo.LastReferenceNode()->Point(0) == referenceNode.Point(0)))
+    {
+      baseCase = traversalInfo.LastBaseCase();
+
+      // Make sure that if BaseCase() is called, we don't add it again.
+      lastQueryIndex = queryNode.Point(0);
+      lastReferenceIndex = referenceNode.Point(0);
+      lastBaseCase = baseCase;
+    }
+    else
+    {
+      // We must calculate the base case.
+      baseCase = BaseCase(queryNode.Point(0), referenceNode.Point(0));
+    }
+
+    distances.Lo() = baseCase - queryNode.FurthestDescendantDistance()
+        - referenceNode.FurthestDescendantDistance();
+    distances.Hi() = baseCase + queryNode.FurthestDescendantDistance()
+        + referenceNode.FurthestDescendantDistance();
+
+    // Update the last distance performed for the query and reference node.
+    traversalInfo.LastBaseCase() = baseCase;
+  }
+  else
+  {
+    distances = referenceNode.RangeDistance(&queryNode);
+  }
+
+  if (Approximate(queryNode, referenceNode, distances))
+    return DBL_MAX; // The contribution of the node has been added.
+
+  traversalInfo.LastQueryNode() = &queryNode;
+  traversalInfo.LastReferenceNode() = &referenceNode;
+  return std::max(distances.Lo(), 0.0);
+}
+
+//! Dual-tree rescoring function.
+template<typename KernelType, typename TreeType>
+double KDERules<KernelType, TreeType>::Rescore(
+    TreeType& /* queryNode */,
+    TreeType& /* referenceNode */,
+    const double oldScore) const
+{
+  // If it wasn't pruned before, it isn't pruned now.
+  return oldScore;
+}
+
+template<typename KernelType, typename TreeType>
+bool KDERules<KernelType, TreeType>::Approximate(
+    const size_t queryIndex,
+    TreeType& referenceNode,
+    const math::Range& distances)
+{
+  // The kernel is largest at the smallest distance.
+  const double maxKernel = kernel.Evaluate(std::max(distances.Lo(), 0.0));
+  const double minKernel = kernel.Evaluate(distances.Hi());
+
+  // The midpoint of the interval is within half its width of every kernel
+  // value in it.
+  if (maxKernel - minKernel > 2.0 * (relError * minKernel + absError))
+    return false;
+
+  sums[queryIndex] += Uncalculated(queryIndex, referenceNode) *
+      (maxKernel + minKernel) / 2.0;
+  return true;
+}
+
+template<typename KernelType, typename TreeType>
+bool KDERules<KernelType, TreeType>::Approximate(
+    TreeType& queryNode,
+    TreeType& referenceNode,
+    const math::Range& distances)
+{
+  const double maxKernel = kernel.Evaluate(std::max(distances.Lo(), 0.0));
+  const double minKernel = kernel.Evaluate(distances.Hi());
+
+  if (maxKernel - minKernel > 2.0 * (relError * minKernel + absError))
+    return false;
+
+  const double estimate = (maxKernel + minKernel) / 2.0;
+  for (size_t i = 0; i < queryNode.NumDescendants(); ++i)
+  {
+    const size_t queryIndex = queryNode.Descendant(i);
+    sums[queryIndex] += Uncalculated(queryIndex, referenceNode) * estimate;
+  }
+
+  return true;
+}
+
+template<typename KernelType, typename TreeType>
+size_t KDERules<KernelType, TreeType>::Uncalculated(
+    const size_t queryIndex,
+    TreeType& referenceNode) const
+{
+  // Some types of trees calculate the base case evaluation before Score() is
+  // called, so if the base case has already been calculated, then we must avoid
+  // adding that point again.
+  if (tree::TreeTraits<TreeType>::FirstPointIsCentroid &&
+      (queryIndex == lastQueryIndex) &&
+      (referenceNode.Point(0) == lastReferenceIndex))
+    return referenceNode.NumDescendants() - 1;
+
+  return referenceNode.NumDescendants();
+}
+
+}; // namespace kde
+}; // namespace mlpack
+
+#endif
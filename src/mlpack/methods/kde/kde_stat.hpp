@@ -0,0 +1,49 @@
+/**
+ * @file kde_stat.hpp
+ *
+ * Defines the KDEStat class, the tree statistic used for kernel density
+ * estimation.
+ */
+#ifndef __MLPACK_METHODS_KDE_KDE_STAT_HPP
+#define __MLPACK_METHODS_KDE_KDE_STAT_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kde {
+
+/**
+ * Statistic class for KDE, to be set to the StatisticType of the tree type that
+ * kernel density estimation is performed with.  This class just holds the last
+ * base case result, which trees whose first point is the centroid (like the
+ * cover tree) reuse for their self-children during single-tree traversal.
+ */
+class KDEStat
+{
+ public:
+  /**
+   * Initialize the statistic.
+   */
+  KDEStat() : lastDistance(0.0) { }
+
+  /**
+   * Initialize the statistic given a tree node that this statistic belongs to.
+   * In this case, we ignore the node.
+   */
+  template<typename TreeType>
+  KDEStat(TreeType& /* node */) : lastDistance(0.0) { }
+
+  //! Get the last distance evaluation.
+  double LastDistance() const { return lastDistance; }
+  //! Modify the last distance evaluation.
+  double& LastDistance() { return lastDistance; }
+
+ private:
+  //! The last distance evaluation.
+  double lastDistance;
+};
+
+}; // namespace kde
+}; // namespace mlpack
+
+#endif
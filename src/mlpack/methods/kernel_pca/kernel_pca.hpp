@@ -110,6 +110,18 @@ class KernelPCA
   bool CenterTransformedData() const { return centerTransformedData; }
   //! Return whether or not the transformed data is centered.
   bool& CenterTransformedData() { return centerTransformedData; }
+
+  //! Get the cache of kernel evaluations (NULL if there is none).
+  kernel::KernelCache* Cache() const { return cache; }
+  /**
+   * Modify the cache of kernel evaluations (NULL for none).  With a cache,
+   * running Apply() again on the same data (for instance, with another new
+   * dimension) reuses the kernel evaluations of the previous runs.  The cache
+   * is not owned by this object, and is only useful for kernels more expensive
+   * than the lookup (the linear, polynomial and Gaussian kernels are computed
+   * from the Gram matrix of the data, and never use it).
+   */
+  kernel::KernelCache*& Cache() { return cache; }
    
   // Returns a string representation of this object. 
   std::string ToString() const;
@@ -120,6 +132,8 @@ class KernelPCA
   //! If true, the data will be scaled (by standard deviation) when Apply() is
   //! run.
   bool centerTransformedData;
+  //! The cache of kernel evaluations (NULL if there is none).
+  kernel::KernelCache* cache;
 
 }; // class KernelPCA
 
@@ -19,7 +19,8 @@ template <typename KernelType, typename KernelRule>
 KernelPCA<KernelType, KernelRule>::KernelPCA(const KernelType kernel,
                                  const bool centerTransformedData) :
       kernel(kernel),
-      centerTransformedData(centerTransformedData)
+      centerTransformedData(centerTransformedData),
+      cache(NULL)
 { }
 
 //! Apply Kernel Principal Component Analysis to the provided data set.
@@ -31,7 +32,7 @@ void KernelPCA<KernelType, KernelRule>::Apply(const arma::mat& data,
                                   const size_t newDimension)
 {
   KernelRule::ApplyKernelMatrix(data, transformedData, eigval,
-                                eigvec, newDimension, kernel);
+                                eigvec, newDimension, kernel, cache);
 
   // Center the transformed data, if the user asked for it.
   if (centerTransformedData)
@@ -72,7 +73,11 @@ void KernelPCA<KernelType, KernelRule>::Apply(arma::mat& data,
 
   Apply(data, data, eigVal, coeffs, newDimension);
 
-  if (newDimension < coeffs.n_rows && newDimension > 0)
+  // The data has been overwritten, so the cached kernels are not valid.
+  if (cache)
+    cache->Clear();
+
+  if (newDimension < data.n_rows && newDimension > 0)
     data.shed_rows(newDimension, data.n_rows - 1);
 }
 
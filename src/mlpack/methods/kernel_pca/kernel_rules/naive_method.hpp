@@ -10,10 +10,27 @@
 
 #include <mlpack/core.hpp>
 
+#include <mlpack/core/kernels/gaussian_kernel.hpp>
+#include <mlpack/core/kernels/linear_kernel.hpp>
+#include <mlpack/core/kernels/polynomial_kernel.hpp>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
 namespace mlpack {
 namespace kpca {
 
-template<typename KernelType>
+/**
+ * Construct the full kernel matrix and eigendecompose it.  The exponential
+ * used by the closed-form Gaussian kernel matrix is given by ExpType: the
+ * default, math::ExactExp, calls std::exp(), and math::FastExp<> is a faster
+ * polynomial approximation (with a relative error of about 1e-8).
+ *
+ * @tparam KernelType Kernel to use.
+ * @tparam ExpType Policy which computes the exponential function.
+ */
+template<typename KernelType, typename ExpType = math::ExactExp>
 class NaiveKernelRule
 {
   public:
@@ -26,46 +43,24 @@ class NaiveKernelRule
      * @param eigvec KPCA eigenvectors will be written to this matrix.
      * @param rank Rank to be used for matrix approximation.
      * @param kernel Kernel to be used for computation.
+     * @param cache Cache of kernel evaluations (NULL for none).
      */
     static void ApplyKernelMatrix(const arma::mat& data,
                                   arma::mat& transformedData,
                                   arma::vec& eigval,
                                   arma::mat& eigvec,
                                   const size_t /* unused */,
-                                  KernelType kernel = KernelType())
+                                  KernelType kernel = KernelType(),
+                                  kernel::KernelCache* cache = NULL)
   {
     // Construct the kernel matrix.
+    static const size_t kernelAccount = MemoryUsage::Register("kernel_matrix");
+    ScopedMemory kernelMemory(kernelAccount,
+        data.n_cols * data.n_cols * sizeof(double));
     arma::mat kernelMatrix;
-    // Resize the kernel matrix to the right size.
-    kernelMatrix.set_size(data.n_cols, data.n_cols);
-
-    // Note that we only need to calculate the upper triangular part of the 
-    // kernel matrix, since it is symmetric. This helps minimize the number of
-    // kernel evaluations.
-    for (size_t i = 0; i < data.n_cols; ++i)
-    {
-      for (size_t j = i; j < data.n_cols; ++j)
-      {
-        // Evaluate the kernel on these two points.
-        kernelMatrix(i, j) = kernel.Evaluate(data.unsafe_col(i),
-                                             data.unsafe_col(j));
-      }
-    }
+    KernelMatrix(data, kernel, kernelMatrix, cache);
 
-    // Copy to the lower triangular part of the matrix.
-    for (size_t i = 1; i < data.n_cols; ++i)
-      for (size_t j = 0; j < i; ++j)
-        kernelMatrix(i, j) = kernelMatrix(j, i);
-
-    // For PCA the data has to be centered, even if the data is centered. But it
-    // is not guaranteed that the data, when mapped to the kernel space, is also
-    // centered. Since we actually never work in the feature space we cannot
-    // center the data. So, we perform a "psuedo-centering" using the kernel
-    // matrix.
-    arma::rowvec rowMean = arma::sum(kernelMatrix, 0) / kernelMatrix.n_cols;
-    kernelMatrix.each_col() -= arma::sum(kernelMatrix, 1) / kernelMatrix.n_cols;
-    kernelMatrix.each_row() -= rowMean;
-    kernelMatrix += arma::sum(rowMean) / kernelMatrix.n_cols;
+    CenterKernelMatrix(kernelMatrix);
 
     // Eigendecompose the centered kernel matrix.
     arma::eig_sym(eigval, eigvec, kernelMatrix);
@@ -81,6 +76,153 @@ class NaiveKernelRule
     transformedData = eigvec.t() * kernelMatrix;
     transformedData.each_col() /= arma::sqrt(eigval);
   }
+
+    /**
+     * Center the given kernel matrix.
+     *
+     * @param kernelMatrix Kernel matrix to center.
+     */
+    static void CenterKernelMatrix(arma::mat& kernelMatrix)
+    {
+      // For PCA the data has to be centered, even if the data is centered. But
+      // it is not guaranteed that the data, when mapped to the kernel space, is
+      // also centered. Since we actually never work in the feature space we
+      // cannot center the data. So, we perform a "psuedo-centering" using the
+      // kernel matrix.
+      arma::rowvec rowMean = arma::sum(kernelMatrix, 0) / kernelMatrix.n_cols;
+      kernelMatrix.each_col() -= arma::sum(kernelMatrix, 1) /
+          kernelMatrix.n_cols;
+      kernelMatrix.each_row() -= rowMean;
+      kernelMatrix += arma::sum(rowMean) / kernelMatrix.n_cols;
+    }
+
+    /**
+     * Construct the full kernel matrix of the given data with the given
+     * kernel.  Since the kernel matrix is symmetric, only the blocks of the
+     * upper triangle are evaluated (in parallel, if OpenMP is available), and
+     * each block is copied to its mirror in the lower triangle.
+     *
+     * If a cache is given, each evaluation K(x_i, x_j) (i <= j) is looked up
+     * in it first, and stored in it otherwise; so building the kernel matrix
+     * of the same data again (for instance, to try another number of
+     * dimensions) only evaluates the kernels which were dropped from the
+     * cache.  The cache is cleared if it was used with other data.
+     *
+     * @param data Input data points.
+     * @param kernel Kernel to be used for computation.
+     * @param kernelMatrix Matrix to store the kernel matrix in.
+     * @param cache Cache of kernel evaluations (NULL for none).
+     */
+    template<typename OtherKernelType>
+    static void KernelMatrix(const arma::mat& data,
+                             OtherKernelType& kernel,
+                             arma::mat& kernelMatrix,
+                             kernel::KernelCache* cache = NULL)
+    {
+      if (cache)
+        cache->Bind(data);
+
+      const size_t n = data.n_cols;
+      kernelMatrix.set_size(n, n);
+
+      // Blocks of columns small enough that the points of two blocks stay in
+      // cache while the block of the kernel matrix is computed.
+      const size_t blockSize = 64;
+      const size_t blocks = (n + blockSize - 1) / blockSize;
+
+      // The pairs of blocks (bi <= bj) of the upper triangle.
+      std::vector<std::pair<size_t, size_t> > pairs;
+      for (size_t bj = 0; bj < blocks; ++bj)
+        for (size_t bi = 0; bi <= bj; ++bi)
+          pairs.push_back(std::make_pair(bi, bj));
+
+      #pragma omp parallel for schedule(dynamic)
+      for (size_t p = 0; p < pairs.size(); ++p)
+      {
+        const size_t iBegin = pairs[p].first * blockSize;
+        const size_t iEnd = std::min(iBegin + blockSize, n);
+        const size_t jBegin = pairs[p].second * blockSize;
+        const size_t jEnd = std::min(jBegin + blockSize, n);
+
+        for (size_t j = jBegin; j < jEnd; ++j)
+        {
+          // On a diagonal block, only the upper triangle is evaluated.
+          const size_t iLast = (iBegin == jBegin) ? (j + 1) : iEnd;
+          for (size_t i = iBegin; i < iLast; ++i)
+          {
+            double value;
+            if (cache == NULL || !cache->Lookup(i, j, value))
+            {
+              value = kernel.Evaluate(data.unsafe_col(i), data.unsafe_col(j));
+              if (cache != NULL)
+                cache->Insert(i, j, value);
+            }
+
+            kernelMatrix(i, j) = value;
+            kernelMatrix(j, i) = value;
+          }
+        }
+      }
+    }
+
+    /**
+     * Construct the kernel matrix for the linear kernel: this is the Gram
+     * matrix of the data, computed with one matrix multiplication (which is
+     * cheaper than any cache, so the cache is not used).
+     */
+    static void KernelMatrix(const arma::mat& data,
+                             kernel::LinearKernel& /* kernel */,
+                             arma::mat& kernelMatrix,
+                             kernel::KernelCache* /* cache */ = NULL)
+    {
+      kernelMatrix = trans(data) * data;
+    }
+
+    /**
+     * Construct the kernel matrix for the polynomial kernel from the Gram
+     * matrix of the data (the cache is not used).
+     */
+    static void KernelMatrix(const arma::mat& data,
+                             kernel::PolynomialKernel& kernel,
+                             arma::mat& kernelMatrix,
+                             kernel::KernelCache* /* cache */ = NULL)
+    {
+      kernelMatrix = trans(data) * data;
+      kernelMatrix = arma::pow(kernelMatrix + kernel.Offset(), kernel.Degree());
+    }
+
+    /**
+     * Construct the kernel matrix for the Gaussian kernel from the Gram matrix
+     * of the data, using ||a - b||^2 = ||a||^2 + ||b||^2 - 2 a^T b, and the
+     * exponential of ExpType (the cache is not used).
+     */
+    static void KernelMatrix(const arma::mat& data,
+                             kernel::GaussianKernel& kernel,
+                             arma::mat& kernelMatrix,
+                             kernel::KernelCache* /* cache */ = NULL)
+    {
+      kernelMatrix = trans(data) * data;
+      const arma::vec norms = kernelMatrix.diag();
+
+      const double gamma = kernel.Gamma();
+      #pragma omp parallel for schedule(static)
+      for (size_t j = 0; j < kernelMatrix.n_cols; ++j)
+      {
+        for (size_t i = 0; i < kernelMatrix.n_rows; ++i)
+        {
+          // Rounding may make the squared distance very slightly negative.
+          const double distance = std::max(norms[i] + norms[j] -
+              2.0 * kernelMatrix(i, j), 0.0);
+          kernelMatrix(i, j) = gamma * distance;
+        }
+
+        // Exponentiate the whole column at once, so that the loop of a
+        // vectorizable ExpType is not interrupted.
+        arma::mat column(kernelMatrix.colptr(j), kernelMatrix.n_rows, 1,
+            false, true);
+        ExpType::Apply(column);
+      }
+    }
 };
 
 }; // namespace kpca
@@ -31,13 +31,16 @@ class NystroemKernelRule
      * @param eigvec KPCA eigenvectors will be written to this matrix.
      * @param rank Rank to be used for matrix approximation.
      * @param kernel Kernel to be used for computation.
+     * @param cache Not used: the Nystroem method only evaluates the kernels
+     *     of the landmarks, which are chosen again each time.
      */
     static void ApplyKernelMatrix(const arma::mat& data,
                                   arma::mat& transformedData,
                                   arma::vec& eigval,
                                   arma::mat& eigvec,
                                   const size_t rank,
-                                  KernelType kernel = KernelType())
+                                  KernelType kernel = KernelType(),
+                                  kernel::KernelCache* /* cache */ = NULL)
     {
       arma::mat G, v;
       kernel::NystroemMethod<KernelType, PointSelectionPolicy> nm(data, kernel,
@@ -46,7 +49,7 @@ class NystroemKernelRule
       transformedData = G.t() * G;
 
       // Center the reconstructed approximation.
-      math::Center(transformedData, transformedData);
+      math::Center(transformedData);
 
       // For PCA the data has to be centered, even if the data is centered. But
       // it is not guaranteed that the data, when mapped to the kernel space, is
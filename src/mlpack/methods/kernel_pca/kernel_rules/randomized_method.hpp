@@ -0,0 +1,68 @@
+/**
+ * @file randomized_method.hpp
+ *
+ * Use a randomized SVD to find the largest eigenvalues of the kernel matrix.
+ */
+#ifndef __MLPACK_METHODS_KERNEL_PCA_RANDOMIZED_METHOD_HPP
+#define __MLPACK_METHODS_KERNEL_PCA_RANDOMIZED_METHOD_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/methods/randomized_svd/randomized_svd.hpp>
+
+#include "naive_method.hpp"
+
+namespace mlpack {
+namespace kpca {
+
+/**
+ * The full kernel matrix is built as with NaiveKernelRule, but only the
+ * requested number of eigenvalues (and eigenvectors) of the centered kernel
+ * matrix are computed, with a randomized SVD: since the centered kernel
+ * matrix is symmetric positive semidefinite, its singular values are its
+ * eigenvalues.  For n points and rank k, this takes O(n^2 k) time instead of
+ * the O(n^3) of a full eigendecomposition.
+ */
+template<typename KernelType>
+class RandomizedKernelRule
+{
+  public:
+    /**
+     * Construct the kernel matrix and find its rank largest eigenvalues.
+     *
+     * @param data Input data points.
+     * @param transformedData Matrix to output results into.
+     * @param eigval KPCA eigenvalues will be written to this vector.
+     * @param eigvec KPCA eigenvectors will be written to this matrix.
+     * @param rank Number of eigenvalues to compute.
+     * @param kernel Kernel to be used for computation.
+     * @param cache Cache of kernel evaluations (NULL for none).
+     */
+    static void ApplyKernelMatrix(const arma::mat& data,
+                                  arma::mat& transformedData,
+                                  arma::vec& eigval,
+                                  arma::mat& eigvec,
+                                  const size_t rank,
+                                  KernelType kernel = KernelType(),
+                                  kernel::KernelCache* cache = NULL)
+  {
+    // Construct and center the kernel matrix.
+    arma::mat kernelMatrix;
+    NaiveKernelRule<KernelType>::KernelMatrix(data, kernel, kernelMatrix,
+        cache);
+    NaiveKernelRule<KernelType>::CenterKernelMatrix(kernelMatrix);
+
+    // Find the largest eigenvalues, which are in decreasing order.
+    arma::mat v;
+    svd::RandomizedSVD rsvd;
+    rsvd.Apply(kernelMatrix, eigvec, eigval, v,
+        std::min(rank, (size_t) kernelMatrix.n_cols));
+
+    transformedData = eigvec.t() * kernelMatrix;
+    transformedData.each_col() /= arma::sqrt(eigval);
+  }
+};
+
+}; // namespace kpca
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,261 @@
+/**
+ * @file centroid_distance.hpp
+ *
+ * Helpers for the Lloyd step types that compute distances between points of
+ * the dataset and centroids, and sums of points, efficiently for sparse and
+ * single-precision datasets.  The centroids are always stored in double
+ * precision.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_CENTROID_DISTANCE_HPP
+#define __MLPACK_METHODS_KMEANS_CENTROID_DISTANCE_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/metrics/lmetric.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * Compute the dot product of the given point of a sparse dataset and the given
+ * (dense) centroid, in time linear in the number of nonzero elements of the
+ * point.
+ */
+inline double SparseDot(const arma::sp_mat& dataset,
+                        const size_t point,
+                        const arma::mat& centroids,
+                        const size_t centroid)
+{
+  const double* centroidMemory = centroids.colptr(centroid);
+  double dot = 0.0;
+  for (arma::sp_mat::const_iterator it = dataset.begin_col(point);
+       it != dataset.end_col(point); ++it)
+    dot += (*it) * centroidMemory[it.row()];
+
+  return dot;
+}
+
+/**
+ * Add the given point of the dataset to the given column of centroids.
+ */
+template<typename MatType>
+inline void AddPoint(const MatType& dataset,
+                     const size_t point,
+                     arma::mat& centroids,
+                     const size_t centroid)
+{
+  centroids.col(centroid) += arma::vec(dataset.col(point));
+}
+
+//! Add a point of a dense dataset to a centroid, without a temporary.
+inline void AddPoint(const arma::mat& dataset,
+                     const size_t point,
+                     arma::mat& centroids,
+                     const size_t centroid)
+{
+  centroids.col(centroid) += dataset.col(point);
+}
+
+//! Add a point of a single-precision dataset to a centroid.  The sum is kept in
+//! double precision, so it does not lose accuracy as points are added to it.
+inline void AddPoint(const arma::fmat& dataset,
+                     const size_t point,
+                     arma::mat& centroids,
+                     const size_t centroid)
+{
+  const float* pointMemory = dataset.colptr(point);
+  double* centroidMemory = centroids.colptr(centroid);
+  for (size_t d = 0; d < dataset.n_rows; ++d)
+    centroidMemory[d] += pointMemory[d];
+}
+
+//! Add a point of a sparse dataset to a centroid, in time linear in the number
+//! of nonzero elements of the point.
+inline void AddPoint(const arma::sp_mat& dataset,
+                     const size_t point,
+                     arma::mat& centroids,
+                     const size_t centroid)
+{
+  double* centroidMemory = centroids.colptr(centroid);
+  for (arma::sp_mat::const_iterator it = dataset.begin_col(point);
+       it != dataset.end_col(point); ++it)
+    centroidMemory[it.row()] += (*it);
+}
+
+/**
+ * Get the given point of the dataset as a dense column of doubles.
+ */
+template<typename MatType>
+inline arma::vec PointVector(const MatType& dataset, const size_t point)
+{
+  return arma::vec(dataset.col(point));
+}
+
+//! Get the given point of a single-precision dataset in double precision.
+inline arma::vec PointVector(const arma::fmat& dataset, const size_t point)
+{
+  return arma::conv_to<arma::vec>::from(dataset.col(point));
+}
+
+/**
+ * Compute the distance between every pair of centroids with the given metric,
+ * in parallel if OpenMP is available.  distances(i, j) is the distance between
+ * centroids i and j, except that the diagonal is set to DBL_MAX, so that a
+ * centroid is never its own closest centroid.  For the Euclidean distance on
+ * dense vectors, each distance is computed with the vectorized kernel of
+ * LMetric.
+ *
+ * @param centroids Centroids (one per column).
+ * @param metric Instantiated metric.
+ * @param distances Matrix to store the distances in.
+ */
+template<typename MetricType>
+void CentroidPairDistances(const arma::mat& centroids,
+                           MetricType& metric,
+                           arma::mat& distances)
+{
+  distances.set_size(centroids.n_cols, centroids.n_cols);
+  distances.diag().fill(DBL_MAX);
+
+  // The rows have decreasing numbers of distances to compute.
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < centroids.n_cols; ++i)
+  {
+    for (size_t j = i + 1; j < centroids.n_cols; ++j)
+    {
+      const double distance = metric.Evaluate(centroids.col(i),
+          centroids.col(j));
+      distances(i, j) = distance;
+      distances(j, i) = distance;
+    }
+  }
+}
+
+/**
+ * Evaluate the distance between points of a dataset and the current centroids
+ * with the given metric.  Call Centroids() each time the centroids change,
+ * before calling Evaluate().
+ *
+ * This general version simply calls MetricType::Evaluate(); for the Euclidean
+ * distance on sparse datasets, a specialization caches the squared norm of
+ * every point and centroid and computes
+ * ||x - c||^2 = ||x||^2 + ||c||^2 - 2 x^T c with a sparse dot product, so each
+ * distance calculation takes time linear in the number of nonzero elements of
+ * the point instead of the dimensionality.  For single-precision datasets, a
+ * specialization keeps a single-precision copy of the centroids.
+ *
+ * @tparam MetricType Type of metric.
+ * @tparam MatType Type of dataset (arma::mat, arma::fmat or arma::sp_mat).
+ */
+template<typename MetricType, typename MatType>
+class CentroidDistance
+{
+ public:
+  //! Prepare to evaluate distances between points of the dataset and
+  //! centroids.
+  CentroidDistance(const MatType& dataset, MetricType& metric) :
+      dataset(dataset), metric(metric), centroids(NULL) { }
+
+  //! Set the current centroids.
+  void Centroids(const arma::mat& newCentroids) { centroids = &newCentroids; }
+
+  //! Evaluate the distance between the given point and centroid.
+  double Evaluate(const size_t point, const size_t centroid) const
+  {
+    return metric.Evaluate(dataset.col(point), centroids->col(centroid));
+  }
+
+ private:
+  //! The dataset.
+  const MatType& dataset;
+  //! The instantiated metric.
+  MetricType& metric;
+  //! The current centroids.
+  const arma::mat* centroids;
+};
+
+/**
+ * Distances on single-precision datasets.  The centroids are converted to
+ * single precision when they are set, so the metric compares float columns
+ * with float columns (with the vectorized single-precision kernel, for the
+ * Euclidean distance) instead of converting each point to double precision.
+ */
+template<typename MetricType>
+class CentroidDistance<MetricType, arma::fmat>
+{
+ public:
+  //! Prepare to evaluate distances between points of the dataset and
+  //! centroids.
+  CentroidDistance(const arma::fmat& dataset, MetricType& metric) :
+      dataset(dataset), metric(metric) { }
+
+  //! Set the current centroids, converting them to single precision.
+  void Centroids(const arma::mat& newCentroids)
+  {
+    centroids = arma::conv_to<arma::fmat>::from(newCentroids);
+  }
+
+  //! Evaluate the distance between the given point and centroid.
+  double Evaluate(const size_t point, const size_t centroid) const
+  {
+    return metric.Evaluate(dataset.col(point), centroids.col(centroid));
+  }
+
+ private:
+  //! The dataset.
+  const arma::fmat& dataset;
+  //! The instantiated metric.
+  MetricType& metric;
+  //! The current centroids, in single precision.
+  arma::fmat centroids;
+};
+
+//! The Euclidean distance on sparse datasets, with cached squared norms.
+template<bool TakeRoot>
+class CentroidDistance<metric::LMetric<2, TakeRoot>, arma::sp_mat>
+{
+ public:
+  //! Prepare to evaluate distances, computing the squared norm of each point.
+  CentroidDistance(const arma::sp_mat& dataset,
+                   metric::LMetric<2, TakeRoot>& /* metric */) :
+      dataset(dataset), centroids(NULL)
+  {
+    pointNorms.zeros(dataset.n_cols);
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+      for (arma::sp_mat::const_iterator it = dataset.begin_col(i);
+           it != dataset.end_col(i); ++it)
+        pointNorms[i] += (*it) * (*it);
+  }
+
+  //! Set the current centroids, computing their squared norms.
+  void Centroids(const arma::mat& newCentroids)
+  {
+    centroids = &newCentroids;
+    centroidNorms = trans(sum(square(newCentroids), 0));
+  }
+
+  //! Evaluate the distance between the given point and centroid.
+  double Evaluate(const size_t point, const size_t centroid) const
+  {
+    // Cancellation may make the result slightly negative.
+    const double squared = std::max(pointNorms[point] +
+        centroidNorms[centroid] - 2 * SparseDot(dataset, point, *centroids,
+        centroid), 0.0);
+
+    return TakeRoot ? std::sqrt(squared) : squared;
+  }
+
+ private:
+  //! The dataset.
+  const arma::sp_mat& dataset;
+  //! The current centroids.
+  const arma::mat* centroids;
+  //! The squared norm of each point.
+  arma::vec pointNorms;
+  //! The squared norm of each current centroid.
+  arma::vec centroidNorms;
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
@@ -52,11 +52,42 @@ class DualTreeKMeans
   arma::vec distances;
   arma::Col<size_t> distanceIteration;
 
+  //! The centroids of the last iteration, to bound how far they have moved.
+  arma::mat lastCentroids;
+
   //! The current iteration.
   size_t iteration;
 
   //! Track distance calculations.
   size_t distanceCalculations;
+
+  /**
+   * Find the nodes of the tree that had an owner in the last iteration and
+   * whose owner cannot have changed with the given centroids, because the
+   * upper bound on the distance between the points and the owner is below the
+   * lower bound on the distance between the points and any other centroid.
+   * The bounds of a node skipped in the last iteration are loosened by how far
+   * the centroids moved; otherwise they are computed from the bound of the
+   * node.  Those nodes are marked so the traversal skips them entirely.
+   *
+   * @param node Node to start from.
+   * @param centroids Current centroids.
+   * @param movements Distance each centroid moved since the last iteration.
+   * @param maxMovement Largest distance any centroid moved.
+   * @return The number of points in the skipped nodes.
+   */
+  size_t SkipOwnedNodes(TreeType& node,
+                        const arma::mat& centroids,
+                        const arma::vec& movements,
+                        const double maxMovement);
+
+  /**
+   * Add the points of the nodes skipped in this iteration to the centroids of
+   * their owners, using the centroid of each node.
+   */
+  void AddSkippedNodes(const TreeType& node,
+                       arma::mat& newCentroids,
+                       arma::Col<size_t>& counts) const;
 };
 
 template<typename MetricType, typename MatType>
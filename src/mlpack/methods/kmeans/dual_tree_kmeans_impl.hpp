@@ -63,6 +63,25 @@ double DualTreeKMeans<MetricType, MatType, TreeType>::Iterate(
     clusterDistances.fill(DBL_MAX / 2.0); // To prevent overflow.
   }
 
+  // Skip the nodes whose owner cannot have changed since the last iteration.
+  // This has to happen before the centroid tree is built, because building
+  // it may rearrange the centroids.
+  size_t skippedPoints = 0;
+  if (iteration > 0 && lastCentroids.n_rows == centroids.n_rows &&
+      lastCentroids.n_cols == centroids.n_cols)
+  {
+    arma::vec movements(centroids.n_cols);
+    for (size_t c = 0; c < centroids.n_cols; ++c)
+      movements[c] = metric.Evaluate(centroids.col(c), lastCentroids.col(c));
+    distanceCalculations += centroids.n_cols;
+
+    skippedPoints = SkipOwnedNodes(*tree, centroids, movements,
+        movements.max());
+    Log::Info << "Skipped " << skippedPoints << " points whose owner cannot "
+        << "have changed." << std::endl;
+  }
+  lastCentroids = centroids;
+
   // Build a tree on the centroids.
   std::vector<size_t> oldFromNewCentroids;
   TreeType* centroidTree = BuildTree<TreeType>(
@@ -79,10 +98,15 @@ double DualTreeKMeans<MetricType, MatType, TreeType>::Iterate(
   typename TreeType::template BreadthFirstDualTreeTraverser<RulesType>
       traverser(rules);
 
-  traverser.Traverse(*centroidTree, *tree);
+  if (skippedPoints < dataset.n_cols)
+    traverser.Traverse(*centroidTree, *tree);
 
   distanceCalculations += rules.DistanceCalculations();
 
+  // The skipped nodes have not been added to any centroid yet.
+  if (skippedPoints > 0)
+    AddSkippedNodes(*tree, newCentroids, counts);
+
   // Now, calculate how far the clusters moved, after normalizing them.
   double residual = 0.0;
   clusterDistances.zeros();
@@ -112,6 +136,86 @@ double DualTreeKMeans<MetricType, MatType, TreeType>::Iterate(
   return std::sqrt(residual);
 }
 
+template<typename MetricType, typename MatType, typename TreeType>
+size_t DualTreeKMeans<MetricType, MatType, TreeType>::SkipOwnedNodes(
+    TreeType& node,
+    const arma::mat& centroids,
+    const arma::vec& movements,
+    const double maxMovement)
+{
+  if (node.Stat().OwnerIteration() + 1 != iteration)
+  {
+    // This node had no owner, but its descendants may have.
+    size_t skipped = 0;
+    for (size_t i = 0; i < node.NumChildren(); ++i)
+      skipped += SkipOwnedNodes(node.Child(i), centroids, movements,
+          maxMovement);
+
+    return skipped;
+  }
+
+  const size_t owner = node.Stat().Owner();
+  if (node.Stat().SkipIteration() + 1 == iteration)
+  {
+    // The owner moved by movements[owner] and any other centroid moved by
+    // at most maxMovement, so the bounds of the last iteration still hold
+    // after this adjustment.
+    node.Stat().OwnerUpperBound() += movements[owner];
+    node.Stat().OwnerLowerBound() -= maxMovement;
+  }
+
+  if (node.Stat().SkipIteration() + 1 != iteration ||
+      node.Stat().OwnerUpperBound() >= node.Stat().OwnerLowerBound())
+  {
+    // Compute tighter bounds from the bound of the node.
+    node.Stat().OwnerUpperBound() = node.MaxDistance(centroids.col(owner));
+    node.Stat().OwnerLowerBound() = DBL_MAX;
+    for (size_t c = 0; c < centroids.n_cols; ++c)
+    {
+      if (c == owner)
+        continue;
+
+      const double distance = node.MinDistance(centroids.col(c));
+      if (distance < node.Stat().OwnerLowerBound())
+        node.Stat().OwnerLowerBound() = distance;
+    }
+    distanceCalculations += centroids.n_cols;
+  }
+
+  if (node.Stat().OwnerUpperBound() < node.Stat().OwnerLowerBound())
+  {
+    node.Stat().SkipIteration() = iteration;
+    node.Stat().OwnerIteration() = iteration;
+    return node.NumDescendants();
+  }
+
+  // The traversal will have to find the owner again.
+  return 0;
+}
+
+template<typename MetricType, typename MatType, typename TreeType>
+void DualTreeKMeans<MetricType, MatType, TreeType>::AddSkippedNodes(
+    const TreeType& node,
+    arma::mat& newCentroids,
+    arma::Col<size_t>& counts) const
+{
+  if (node.Stat().SkipIteration() == iteration)
+  {
+    const size_t owner = node.Stat().Owner();
+    newCentroids.col(owner) += node.NumDescendants() * node.Stat().Centroid();
+    counts[owner] += node.NumDescendants();
+    return;
+  }
+
+  // If the traversal pruned every centroid but one for this node, its points
+  // (including any in skipped descendants) have already been added.
+  if (node.Stat().OwnerIteration() == iteration)
+    return;
+
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+    AddSkippedNodes(node.Child(i), newCentroids, counts);
+}
+
 } // namespace kmeans
 } // namespace mlpack
 
@@ -100,6 +100,10 @@ double DualTreeKMeansRules<MetricType, TreeType>::Score(
     const size_t queryIndex,
     TreeType& referenceNode)
 {
+  // Nodes whose owner cannot have changed are already accounted for.
+  if (referenceNode.Stat().SkipIteration() == iteration)
+    return DBL_MAX;
+
   // Update from previous iteration, if necessary.
   IterationUpdate(referenceNode);
 
@@ -112,6 +116,10 @@ double DualTreeKMeansRules<MetricType, TreeType>::Score(
     TreeType& queryNode,
     TreeType& referenceNode)
 {
+  // Nodes whose owner cannot have changed are already accounted for.
+  if (referenceNode.Stat().SkipIteration() == iteration)
+    return DBL_MAX;
+
   IterationUpdate(referenceNode);
 
   traversalInfo.LastReferenceNode() = &referenceNode;
@@ -157,6 +165,7 @@ double DualTreeKMeansRules<MetricType, TreeType>::Score(
       const size_t cluster = mappings[bestQueryNode->Descendant(0)];
 
       referenceNode.Stat().Owner() = cluster;
+      referenceNode.Stat().OwnerIteration() = iteration;
       newCentroids.col(cluster) += referenceNode.NumDescendants() *
           referenceNode.Stat().Centroid();
       counts(cluster) += referenceNode.NumDescendants();
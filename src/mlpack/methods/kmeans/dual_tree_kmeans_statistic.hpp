@@ -21,7 +21,12 @@ class DualTreeKMeansStatistic
       minQueryNodeDistance(DBL_MAX),
       maxQueryNodeDistance(DBL_MAX),
       clustersPruned(0),
-      iteration(size_t() - 1)
+      iteration(size_t() - 1),
+      owner(0),
+      ownerIteration(size_t() - 1),
+      skipIteration(size_t() - 1),
+      ownerUpperBound(DBL_MAX),
+      ownerLowerBound(0.0)
   {
     // Empirically calculate the centroid.
     centroid.zeros(node.Dataset().n_rows);
@@ -70,6 +75,30 @@ class DualTreeKMeansStatistic
   //! Modify the current owner (if any) of these reference points.
   size_t& Owner() { return owner; }
 
+  //! Get the last iteration in which Owner() owned all of the points.
+  size_t OwnerIteration() const { return ownerIteration; }
+  //! Modify the last iteration in which Owner() owned all of the points.
+  size_t& OwnerIteration() { return ownerIteration; }
+
+  //! Get the last iteration in which the node was skipped by the traversal
+  //! because its owner could not have changed.
+  size_t SkipIteration() const { return skipIteration; }
+  //! Modify the last iteration in which the node was skipped by the
+  //! traversal.
+  size_t& SkipIteration() { return skipIteration; }
+
+  //! Get the upper bound on the distance between the points and the owner.
+  double OwnerUpperBound() const { return ownerUpperBound; }
+  //! Modify the upper bound on the distance between the points and the owner.
+  double& OwnerUpperBound() { return ownerUpperBound; }
+
+  //! Get the lower bound on the distance between the points and any other
+  //! centroid.
+  double OwnerLowerBound() const { return ownerLowerBound; }
+  //! Modify the lower bound on the distance between the points and any other
+  //! centroid.
+  double& OwnerLowerBound() { return ownerLowerBound; }
+
  private:
   //! The empirically calculated centroid of the node.
   arma::vec centroid;
@@ -88,6 +117,16 @@ class DualTreeKMeansStatistic
   //! The owner of these reference nodes (centroids.n_cols if there is no
   //! owner).
   size_t owner;
+  //! The last iteration in which the owner owned all of the points.
+  size_t ownerIteration;
+  //! The last iteration in which the node was skipped by the traversal.
+  size_t skipIteration;
+  //! Upper bound on the distance between the points and the owner, for the
+  //! centroids of skipIteration.
+  double ownerUpperBound;
+  //! Lower bound on the distance between the points and any other centroid,
+  //! for the centroids of skipIteration.
+  double ownerLowerBound;
 };
 
 } // namespace kmeans
@@ -7,6 +7,8 @@
 #ifndef __MLPACK_METHODS_KMEANS_ELKAN_KMEANS_HPP
 #define __MLPACK_METHODS_KMEANS_ELKAN_KMEANS_HPP
 
+#include "centroid_distance.hpp"
+
 namespace mlpack {
 namespace kmeans {
 
@@ -16,6 +18,8 @@ class ElkanKMeans
  public:
   /**
    * Construct the ElkanKMeans object, which must store several sets of bounds.
+   * The bounds of each point are independent, so Iterate() processes the points
+   * in parallel if OpenMP is available.
    */
   ElkanKMeans(const MatType& dataset, MetricType& metric);
 
@@ -38,6 +42,8 @@ class ElkanKMeans
   const MatType& dataset;
   //! The instantiated metric.
   MetricType& metric;
+  //! Distances between points and the current centroids.
+  CentroidDistance<MetricType, MatType> distance;
 
   //! Holds intra-cluster distances.
   arma::mat clusterDistances;
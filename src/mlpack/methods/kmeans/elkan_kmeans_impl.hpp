@@ -18,9 +18,10 @@ ElkanKMeans<MetricType, MatType>::ElkanKMeans(const MatType& dataset,
                                               MetricType& metric) :
     dataset(dataset),
     metric(metric),
+    distance(dataset, metric),
     distanceCalculations(0)
 {
-
+  // Nothing to do.
 }
 
 // Run a single iteration of Elkan's algorithm for Lloyd iterations.
@@ -33,17 +34,6 @@ double ElkanKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
   newCentroids.zeros(centroids.n_rows, centroids.n_cols);
   counts.zeros(centroids.n_cols);
 
-  // At the beginning of the iteration, we must compute the distances between
-  // all centers.  This is O(k^2).
-  clusterDistances.set_size(centroids.n_cols, centroids.n_cols);
-
-  // Self-distances are always 0, but we set them to DBL_MAX to avoid the self
-  // being the closest cluster centroid.
-  clusterDistances.diag().fill(DBL_MAX);
-
-  // Initially set r(x) to true.
-  std::vector<bool> mustRecalculate(dataset.n_cols, true);
-
   // If this is the first iteration, we must reset all the bounds.
   if (lowerBounds.n_rows != centroids.n_cols)
   {
@@ -56,37 +46,59 @@ double ElkanKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
     assignments.fill(0);
   }
 
-  // Step 1: for all centers, compute between-cluster distances.  For all
-  // centers, compute s(c) = 1/2 min d(c, c').
-  for (size_t i = 0; i < centroids.n_cols; ++i)
-  {
-    for (size_t j = i + 1; j < centroids.n_cols; ++j)
-    {
-      const double distance = metric.Evaluate(centroids.col(i),
-                                              centroids.col(j));
-      distanceCalculations++;
-      clusterDistances(i, j) = distance;
-      clusterDistances(j, i) = distance;
-    }
-  }
+  // Step 1: for all centers, compute between-cluster distances.  This is
+  // O(k^2).  Self-distances are set to DBL_MAX to avoid the self being the
+  // closest cluster centroid.
+  CentroidPairDistances(centroids, metric, clusterDistances);
+  distanceCalculations += centroids.n_cols * (centroids.n_cols - 1) / 2;
 
   // Now find the closest cluster to each other cluster.  We multiply by 0.5 so
   // that this is equivalent to s(c) for each cluster c.
   minClusterDistances = 0.5 * arma::min(clusterDistances).t();
 
-  // Now loop over all points, and see which ones need to be updated.
-  for (size_t i = 0; i < dataset.n_cols; ++i)
+  distance.Centroids(centroids);
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  // The bounds of each point are independent of those of the other points, so
+  // the points are processed in parallel; each thread sums the points assigned
+  // to each cluster into its own accumulators.
+  std::vector<arma::mat> threadCentroids(threads,
+      arma::zeros<arma::mat>(centroids.n_rows, centroids.n_cols));
+  std::vector<arma::Col<size_t> > threadCounts(threads,
+      arma::zeros<arma::Col<size_t> >(centroids.n_cols));
+  size_t calculations = 0;
+
+  // Now loop over all points, and see which ones need to be updated.  The
+  // work for each point varies a lot, so the points are scheduled dynamically.
+  #pragma omp parallel num_threads(threads) reduction(+:calculations)
   {
-    // Step 2: identify all points such that u(x) <= s(c(x)).
-    if (upperBounds(i) <= minClusterDistances(assignments[i]))
-    {
-      // No change needed.  This point must still belong to that cluster.
-      counts(assignments[i])++;
-      newCentroids.col(assignments[i]) += arma::vec(dataset.col(i));
-      continue;
-    }
-    else
+#ifdef _OPENMP
+    const size_t thread = omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+    arma::mat& localCentroids = threadCentroids[thread];
+    arma::Col<size_t>& localCounts = threadCounts[thread];
+
+    #pragma omp for schedule(dynamic, 256)
+    for (size_t i = 0; i < dataset.n_cols; ++i)
     {
+      // Step 2: identify all points such that u(x) <= s(c(x)).
+      if (upperBounds(i) <= minClusterDistances(assignments[i]))
+      {
+        // No change needed.  This point must still belong to that cluster.
+        localCounts(assignments[i])++;
+        AddPoint(dataset, i, localCentroids, assignments[i]);
+        continue;
+      }
+
+      // r(x): whether u(x) must be recalculated.
+      bool mustRecalculate = true;
       for (size_t c = 0; c < centroids.n_cols; ++c)
       {
         // Step 3: for all remaining points x and centers c such that c != c(x),
@@ -103,13 +115,13 @@ double ElkanKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
         // Step 3a: if r(x) then compute d(x, c(x)) and assign r(x) = false.
         // Otherwise, d(x, c(x)) = u(x).
         double dist;
-        if (mustRecalculate[i])
+        if (mustRecalculate)
         {
-          mustRecalculate[i] = false;
-          dist = metric.Evaluate(dataset.col(i), centroids.col(assignments[i]));
+          mustRecalculate = false;
+          dist = distance.Evaluate(i, assignments[i]);
           lowerBounds(assignments[i], i) = dist;
           upperBounds(i) = dist;
-          distanceCalculations++;
+          calculations++;
 
           // Check if we can prune again.
           if (upperBounds(i) <= lowerBounds(c, i))
@@ -128,10 +140,9 @@ double ElkanKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
             dist > 0.5 * clusterDistances(assignments[i], c))
         {
           // Compute d(x, c).  If d(x, c) < d(x, c(x)) then assign c(x) = c.
-          const double pointDist = metric.Evaluate(dataset.col(i),
-                                                   centroids.col(c));
+          const double pointDist = distance.Evaluate(i, c);
           lowerBounds(c, i) = pointDist;
-          distanceCalculations++;
+          calculations++;
           if (pointDist < dist)
           {
             upperBounds(i) = pointDist;
@@ -139,13 +150,20 @@ double ElkanKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
           }
         }
       }
+
+      // At this point, we know the new cluster assignment.
+      // Step 4: for each center c, let m(c) be the mean of the points assigned
+      // to c.
+      AddPoint(dataset, i, localCentroids, assignments[i]);
+      localCounts[assignments[i]]++;
     }
+  }
 
-    // At this point, we know the new cluster assignment.
-    // Step 4: for each center c, let m(c) be the mean of the points assigned to
-    // c.
-    newCentroids.col(assignments[i]) += arma::vec(dataset.col(i));
-    counts[assignments[i]]++;
+  distanceCalculations += calculations;
+  for (size_t t = 0; t < threads; ++t)
+  {
+    newCentroids += threadCentroids[t];
+    counts += threadCounts[t];
   }
 
   // Now, normalize and calculate the distance each cluster has moved.
@@ -156,13 +174,14 @@ double ElkanKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
     if (counts[c] > 0)
       newCentroids.col(c) /= counts[c];
     else
-      newCentroids.fill(DBL_MAX); // Fill with invalid value.
+      newCentroids.col(c).fill(DBL_MAX); // Fill with invalid value.
 
     moveDistances(c) = metric.Evaluate(newCentroids.col(c), centroids.col(c));
     cNorm += std::pow(moveDistances(c), 2.0);
     distanceCalculations++;
   }
 
+  #pragma omp parallel for schedule(static) num_threads(threads)
   for (size_t i = 0; i < dataset.n_cols; ++i)
   {
     // Step 5: for each point x and center c, assign
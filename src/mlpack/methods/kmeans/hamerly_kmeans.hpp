@@ -7,6 +7,8 @@
 #ifndef __MLPACK_METHODS_KMEANS_HAMERLY_KMEANS_HPP
 #define __MLPACK_METHODS_KMEANS_HAMERLY_KMEANS_HPP
 
+#include "centroid_distance.hpp"
+
 namespace mlpack {
 namespace kmeans {
 
@@ -16,13 +18,19 @@ class HamerlyKMeans
  public:
   /**
    * Construct the HamerlyKMeans object, which must store several sets of
-   * bounds.
+   * bounds.  The dataset may be sparse; then distances to the centroids are
+   * computed in time linear in the number of nonzero elements of each point
+   * for the Euclidean distance (see CentroidDistance).  The bounds of each
+   * point are independent, so Iterate() processes the points in parallel if
+   * OpenMP is available.
    */
   HamerlyKMeans(const MatType& dataset, MetricType& metric);
 
   /**
    * Run a single iteration of Hamerly's algorithm, updating the given centroids
-   * into the newCentroids matrix.
+   * into the newCentroids matrix.  The bounds of the points are first moved by
+   * how far each centroid has moved since the last iteration, so the centroids
+   * given need not be the ones computed by the last iteration.
    *
    * @param centroids Current cluster centroids.
    * @param newCentroids New cluster centroids.
@@ -39,7 +47,11 @@ class HamerlyKMeans
   const MatType& dataset;
   //! The instantiated metric.
   MetricType& metric;
+  //! Distances between points and the current centroids.
+  CentroidDistance<MetricType, MatType> distance;
 
+  //! Distances between each pair of clusters.
+  arma::mat clusterDistances;
   //! Minimum cluster distances from each cluster.
   arma::vec minClusterDistances;
 
@@ -49,6 +61,8 @@ class HamerlyKMeans
   arma::vec lowerBounds;
   //! Assignments for each point.
   arma::Col<size_t> assignments;
+  //! The centroids of the last iteration (which the bounds are for).
+  arma::mat lastCentroids;
 
   //! Track distance calculations.
   size_t distanceCalculations;
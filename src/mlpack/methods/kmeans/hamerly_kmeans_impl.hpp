@@ -18,6 +18,7 @@ HamerlyKMeans<MetricType, MatType>::HamerlyKMeans(const MatType& dataset,
                                                   MetricType& metric) :
     dataset(dataset),
     metric(metric),
+    distance(dataset, metric),
     distanceCalculations(0)
 {
   // Nothing to do.
@@ -28,6 +29,12 @@ double HamerlyKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
                                                    arma::mat& newCentroids,
                                                    arma::Col<size_t>& counts)
 {
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
   // If this is the first iteration, we need to set all the bounds.
   if (minClusterDistances.n_elem != centroids.n_cols)
   {
@@ -37,93 +44,149 @@ double HamerlyKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
     assignments.zeros(dataset.n_cols);
     minClusterDistances.set_size(centroids.n_cols);
   }
-
-  // Reset new centroids.
-  newCentroids.zeros(centroids.n_rows, centroids.n_cols);
-  counts.zeros(centroids.n_cols);
-
-  // Calculate minimum intra-cluster distance for each cluster.
-  minClusterDistances.fill(DBL_MAX);
-  for (size_t i = 0; i < centroids.n_cols; ++i)
+  else
   {
-    for (size_t j = i + 1; j < centroids.n_cols; ++j)
+    // Update the bounds for the movement of the centroids since the last
+    // iteration (Update-Bounds()).  This is done here instead of at the end of
+    // the last iteration, because the centroids given may not be the ones it
+    // computed: an empty cluster policy may have moved some, or the centroids
+    // may have been combined with those of other shards (see ShardedKMeans).
+    double furthestMovement = 0.0;
+    double secondFurthestMovement = 0.0;
+    size_t furthestMovingCluster = 0;
+    arma::vec centroidMovements(centroids.n_cols);
+    for (size_t c = 0; c < centroids.n_cols; ++c)
     {
-      const double dist = metric.Evaluate(centroids.col(i), centroids.col(j)) /
-          2.0;
+      const double movement = metric.Evaluate(lastCentroids.col(c),
+                                              centroids.col(c));
+      centroidMovements(c) = movement;
       ++distanceCalculations;
 
-      // Update bounds, if this intra-cluster distance is smaller.
-      if (dist < minClusterDistances(i))
-        minClusterDistances(i) = dist;
-      if (dist < minClusterDistances(j))
-        minClusterDistances(j) = dist;
+      if (movement > furthestMovement)
+      {
+        secondFurthestMovement = furthestMovement;
+        furthestMovement = movement;
+        furthestMovingCluster = c;
+      }
+      else if (movement > secondFurthestMovement)
+      {
+        secondFurthestMovement = movement;
+      }
     }
-  }
 
-  for (size_t i = 0; i < dataset.n_cols; ++i)
-  {
-    const double m = std::max(minClusterDistances(assignments[i]),
-                              lowerBounds(i));
-
-    // First bound test.
-    if (upperBounds(i) <= m)
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (size_t i = 0; i < dataset.n_cols; ++i)
     {
-      newCentroids.col(assignments[i]) += dataset.col(i);
-      ++counts(assignments[i]);
-      continue;
+      upperBounds(i) += centroidMovements(assignments[i]);
+      if (assignments[i] == furthestMovingCluster)
+        lowerBounds(i) -= secondFurthestMovement;
+      else
+        lowerBounds(i) -= furthestMovement;
     }
+  }
+  lastCentroids = centroids;
 
-    // Tighten upper bound.
-    upperBounds(i) = metric.Evaluate(dataset.col(i),
-                                     centroids.col(assignments[i]));
-    ++distanceCalculations;
+  // Reset new centroids.
+  newCentroids.zeros(centroids.n_rows, centroids.n_cols);
+  counts.zeros(centroids.n_cols);
 
-    // Second bound test.
-    if (upperBounds(i) <= m)
-    {
-      newCentroids.col(assignments[i]) += dataset.col(i);
-      ++counts(assignments[i]);
-      continue;
-    }
+  // Calculate minimum intra-cluster distance for each cluster.
+  CentroidPairDistances(centroids, metric, clusterDistances);
+  distanceCalculations += centroids.n_cols * (centroids.n_cols - 1) / 2;
+  minClusterDistances = 0.5 * arma::min(clusterDistances).t();
+
+  distance.Centroids(centroids);
+
+  // The bounds of each point are independent of those of the other points, so
+  // the points are processed in parallel; each thread sums the points assigned
+  // to each cluster into its own accumulators.
+  std::vector<arma::mat> threadCentroids(threads,
+      arma::zeros<arma::mat>(centroids.n_rows, centroids.n_cols));
+  std::vector<arma::Col<size_t> > threadCounts(threads,
+      arma::zeros<arma::Col<size_t> >(centroids.n_cols));
+  size_t calculations = 0;
+
+  // The work for each point varies a lot, so the points are scheduled
+  // dynamically.
+  #pragma omp parallel num_threads(threads) reduction(+:calculations)
+  {
+#ifdef _OPENMP
+    const size_t thread = omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+    arma::mat& localCentroids = threadCentroids[thread];
+    arma::Col<size_t>& localCounts = threadCounts[thread];
 
-    // The bounds failed.  So test against all other clusters.
-    // This is Hamerly's Point-All-Ctrs() function from the paper.
-    // We have to reset the lower bound first.
-    lowerBounds(i) = DBL_MAX;
-    for (size_t c = 0; c < centroids.n_cols; ++c)
+    #pragma omp for schedule(dynamic, 256)
+    for (size_t i = 0; i < dataset.n_cols; ++i)
     {
-      if (c == assignments[i])
+      const double m = std::max(minClusterDistances(assignments[i]),
+                                lowerBounds(i));
+
+      // First bound test.
+      if (upperBounds(i) <= m)
+      {
+        AddPoint(dataset, i, localCentroids, assignments[i]);
+        ++localCounts(assignments[i]);
         continue;
+      }
 
-      const double dist = metric.Evaluate(dataset.col(i), centroids.col(c));
+      // Tighten upper bound.
+      upperBounds(i) = distance.Evaluate(i, assignments[i]);
+      ++calculations;
 
-      // Is this a better cluster?  At this point, upperBounds[i] = d(i, c(i)).
-      if (dist < upperBounds(i))
+      // Second bound test.
+      if (upperBounds(i) <= m)
       {
-        // lowerBounds holds the second closest cluster.
-        lowerBounds(i) = upperBounds(i);
-        upperBounds(i) = dist;
-        assignments[i] = c;
+        AddPoint(dataset, i, localCentroids, assignments[i]);
+        ++localCounts(assignments[i]);
+        continue;
       }
-      else if (dist < lowerBounds(i))
+
+      // The bounds failed.  So test against all other clusters.
+      // This is Hamerly's Point-All-Ctrs() function from the paper.
+      // We have to reset the lower bound first.
+      lowerBounds(i) = DBL_MAX;
+      for (size_t c = 0; c < centroids.n_cols; ++c)
       {
-        // This is a closer second-closest cluster.
-        lowerBounds(i) = dist;
+        if (c == assignments[i])
+          continue;
+
+        const double dist = distance.Evaluate(i, c);
+
+        // Is this a better cluster?  At this point, upperBounds[i] =
+        // d(i, c(i)).
+        if (dist < upperBounds(i))
+        {
+          // lowerBounds holds the second closest cluster.
+          lowerBounds(i) = upperBounds(i);
+          upperBounds(i) = dist;
+          assignments[i] = c;
+        }
+        else if (dist < lowerBounds(i))
+        {
+          // This is a closer second-closest cluster.
+          lowerBounds(i) = dist;
+        }
       }
+      calculations += centroids.n_cols - 1;
+
+      // Update new centroids.
+      AddPoint(dataset, i, localCentroids, assignments[i]);
+      ++localCounts(assignments[i]);
     }
-    distanceCalculations += centroids.n_cols - 1;
+  }
 
-    // Update new centroids.
-    newCentroids.col(assignments[i]) += dataset.col(i);
-    ++counts(assignments[i]);
+  distanceCalculations += calculations;
+  for (size_t t = 0; t < threads; ++t)
+  {
+    newCentroids += threadCentroids[t];
+    counts += threadCounts[t];
   }
 
-  // Normalize centroids and calculate cluster movement (contains parts of
-  // Move-Centers() and Update-Bounds()).
-  double furthestMovement = 0.0;
-  double secondFurthestMovement = 0.0;
-  size_t furthestMovingCluster = 0;
-  arma::vec centroidMovements(centroids.n_cols);
+  // Normalize centroids and calculate cluster movement (Move-Centers()).  The
+  // bounds are updated at the start of the next iteration.
   double centroidMovement = 0.0;
   for (size_t c = 0; c < centroids.n_cols; ++c)
   {
@@ -135,30 +198,8 @@ double HamerlyKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
     // Calculate movement.
     const double movement = metric.Evaluate(centroids.col(c),
                                             newCentroids.col(c));
-    centroidMovements(c) = movement;
     centroidMovement += std::pow(movement, 2.0);
     ++distanceCalculations;
-
-    if (movement > furthestMovement)
-    {
-      secondFurthestMovement = furthestMovement;
-      furthestMovement = movement;
-      furthestMovingCluster = c;
-    }
-    else if (movement > secondFurthestMovement)
-    {
-      secondFurthestMovement = movement;
-    }
-  }
-
-  // Now update bounds (lines 3-8 of Update-Bounds()).
-  for (size_t i = 0; i < dataset.n_cols; ++i)
-  {
-    upperBounds(i) += centroidMovements(assignments[i]);
-    if (assignments[i] == furthestMovingCluster)
-      lowerBounds(i) -= secondFurthestMovement;
-    else
-      lowerBounds(i) -= furthestMovement;
   }
 
   return std::sqrt(centroidMovement);
@@ -50,9 +50,17 @@ namespace kmeans /** K-Means clustering. */ {
  *     default constructor and 'void Cluster(const arma::mat&, const size_t,
  *     arma::Col<size_t>&)'.
  * @tparam EmptyClusterPolicy Policy for what to do on an empty cluster; must
- *     implement a default constructor and 'void EmptyCluster(const arma::mat&,
- *     arma::Col<size_t&)'.
+ *     implement a default constructor and 'size_t EmptyCluster(const MatType&
+ *     data, const size_t emptyCluster, arma::mat& centroids,
+ *     arma::Col<size_t>& clusterCounts, MetricType& metric, const size_t
+ *     iteration)', which may keep state between the calls of one iteration.
+ *     If it also implements 'void Reset()', that is called at the start of
+ *     each call to Cluster(), so that no state is kept from a previous run.
  * @tparam LloydStepType Implementation of single Lloyd step to use.
+ * @tparam MatType Type of the dataset.  With arma::fmat, the points are kept
+ *     in single precision (half the memory of arma::mat), and the naive, Elkan
+ *     and Hamerly steps compute distances in single precision; the centroids
+ *     and the sums of the points of each cluster are in double precision.
  *
  * @see RandomPartition, RefinedStart, AllowEmptyClusters,
  *      MaxVarianceNewCluster, NaiveKMeans, ElkanKMeans
@@ -90,7 +98,8 @@ class KMeans
    * initial guess of the cluster assignments; to do this, set initialGuess to
    * true.
    *
-   * @tparam MatType Type of matrix (arma::mat or arma::sp_mat).
+   * @tparam MatType Type of matrix (arma::mat, arma::fmat or
+   *     arma::sp_mat).
    * @param data Dataset to cluster.
    * @param clusters Number of clusters to compute.
    * @param assignments Vector to store cluster assignments in.
@@ -108,7 +117,8 @@ class KMeans
    * specified by filling the centroids matrix with the initial centroids and
    * specifying initialGuess = true.
    *
-   * @tparam MatType Type of matrix (arma::mat or arma::sp_mat).
+   * @tparam MatType Type of matrix (arma::mat, arma::fmat or
+   *     arma::sp_mat).
    * @param data Dataset to cluster.
    * @param clusters Number of clusters to compute.
    * @param centroids Matrix in which centroids are stored.
@@ -130,7 +140,8 @@ class KMeans
    * supersedes initialCentroidGuess, so if both are set to true, the
    * assignments vector is used.
    *
-   * @tparam MatType Type of matrix (arma::mat or arma::sp_mat).
+   * @tparam MatType Type of matrix (arma::mat, arma::fmat or
+   *     arma::sp_mat).
    * @param data Dataset to cluster.
    * @param clusters Number of clusters to compute.
    * @param assignments Vector to store cluster assignments in.
@@ -180,6 +191,20 @@ class KMeans
   InitialPartitionPolicy partitioner;
   //! Instantiated empty cluster policy.
   EmptyClusterPolicy emptyClusterAction;
+
+  HAS_MEM_FUNC(Reset, HasReset)
+
+  //! Reset the state of the empty cluster policy, if it has any.
+  template<typename PolicyType>
+  void ResetEmptyClusterAction(PolicyType& policy,
+      typename boost::enable_if<HasReset<PolicyType,
+          void(PolicyType::*)()> >::type* = 0);
+
+  //! Policies without Reset() keep no state between runs.
+  template<typename PolicyType>
+  void ResetEmptyClusterAction(PolicyType& policy,
+      typename boost::disable_if<HasReset<PolicyType,
+          void(PolicyType::*)()> >::type* = 0);
 };
 
 }; // namespace kmeans
@@ -0,0 +1,157 @@
+/**
+ * @file kmeans_assign_main.cpp
+ *
+ * Assign the points of a dataset to the clusters of a saved k-means model.
+ */
+#include <mlpack/core.hpp>
+
+#include <mlpack/core/util/server.hpp>
+
+#include "kmeans_model.hpp"
+
+using namespace mlpack;
+using namespace mlpack::kmeans;
+using namespace mlpack::util;
+using namespace std;
+
+PROGRAM_INFO("K-Means Cluster Assignment", "This program takes a k-means model"
+    " saved by the kmeans program (with --output_model_file) and assigns each "
+    "point of the given dataset (--input_file) to its closest cluster, without "
+    "clustering again.  The labels are saved to the given output file "
+    "(--output_file)."
+    "\n\n"
+    "The dataset is read in blocks of --batch_size points, so it does not have"
+    " to fit in memory; the next block is read while the points of the current"
+    " block are assigned.  When the model has many clusters, a kd-tree is "
+    "built on the centroids once, and each point is assigned with a "
+    "nearest-neighbor search in the tree.  Points are assigned in parallel if "
+    "OpenMP is available.  The distance between each point and its cluster can"
+    " also be saved (--distances_file)."
+    "\n\n"
+    "With --server, the model is kept in memory and points are assigned as "
+    "they are requested, on the standard input and output (--server -) or on "
+    "a Unix socket created at the given path, instead of from --input_file.  "
+    "Each request is a line 'assign <n>' followed by n lines of points (as in "
+    "a CSV file); the response is a line 'OK <n>' followed by a line "
+    "'<cluster>,<distance>' for each point.");
+
+PARAM_STRING("input_file", "File containing the points to assign.", "i", "");
+PARAM_STRING_REQ("model_file", "File containing the k-means model (XML).",
+    "m");
+PARAM_STRING("output_file", "File to save the labels to.", "o", "output.csv");
+PARAM_STRING("distances_file", "If specified, the distance between each point "
+    "and its cluster will be saved to the given file.", "d", "");
+PARAM_INT("batch_size", "Number of points read and assigned at a time.", "b",
+    100000);
+PARAM_STRING("server", "If specified, serve assignment requests on the "
+    "standard input and output ('-') or on a Unix socket created at this path,"
+    " instead of assigning the points of --input_file.", "", "");
+
+/**
+ * Answers 'assign' requests for the Server with a loaded model.
+ */
+class AssignHandler
+{
+ public:
+  AssignHandler(const KMeansModel& model) : model(model) { }
+
+  bool Handle(const ServerRequest& request, ServerResponse& response)
+  {
+    if (request.command != "assign")
+    {
+      response.error = "unknown command '" + request.command + "'; the only "
+          "command is 'assign'";
+      return false;
+    }
+
+    if (request.data.n_cols == 0)
+      return true;
+
+    if (request.data.n_rows != model.Dimensionality())
+    {
+      ostringstream error;
+      error << "points have " << request.data.n_rows << " dimensions, but the "
+          << "model has " << model.Dimensionality();
+      response.error = error.str();
+      return false;
+    }
+
+    arma::Col<size_t> assignments;
+    arma::vec distances;
+    model.Assign(request.data, assignments, distances);
+
+    response.data.set_size(2, request.data.n_cols);
+    for (size_t i = 0; i < request.data.n_cols; ++i)
+    {
+      response.data(0, i) = assignments[i];
+      response.data(1, i) = distances[i];
+    }
+
+    return true;
+  }
+
+ private:
+  const KMeansModel& model;
+};
+
+int main(int argc, char** argv)
+{
+  CLI::ParseCommandLine(argc, argv);
+
+  const string inputFile = CLI::GetParam<string>("input_file");
+  const bool serve = CLI::HasParam("server");
+  if (!serve && inputFile.empty())
+    Log::Fatal << "--input_file is required unless --server is given." << endl;
+
+  const int batchSize = CLI::GetParam<int>("batch_size");
+  if (batchSize < 1)
+  {
+    Log::Fatal << "Invalid batch size (" << batchSize << ")! Must be greater "
+        << "than or equal to 1." << endl;
+  }
+
+  KMeansModel model;
+  model.Load(CLI::GetParam<string>("model_file"));
+  Log::Info << "Loaded a model with " << model.Clusters() << " clusters in "
+      << model.Dimensionality() << " dimensions." << endl;
+
+  if (serve)
+  {
+    AssignHandler handler(model);
+    Server<AssignHandler> server(handler);
+    server.Run(CLI::GetParam<string>("server"));
+    return 0;
+  }
+
+  std::vector<size_t> allAssignments;
+  std::vector<double> allDistances;
+
+  Timer::Start("assignment");
+  data::StreamingReader reader(inputFile, (size_t) batchSize);
+  arma::mat block;
+  arma::Col<size_t> assignments;
+  arma::vec distances;
+  while (reader.NextBlock(block))
+  {
+    model.Assign(block, assignments, distances);
+
+    allAssignments.insert(allAssignments.end(), assignments.begin(),
+        assignments.end());
+    allDistances.insert(allDistances.end(), distances.begin(),
+        distances.end());
+  }
+  Timer::Stop("assignment");
+
+  arma::Mat<size_t> output(1, allAssignments.size());
+  for (size_t i = 0; i < allAssignments.size(); ++i)
+    output[i] = allAssignments[i];
+  data::Save(CLI::GetParam<string>("output_file"), output);
+
+  if (CLI::HasParam("distances_file"))
+  {
+    arma::mat distancesOutput(1, allDistances.size());
+    for (size_t i = 0; i < allDistances.size(); ++i)
+      distancesOutput[i] = allDistances[i];
+    data::Save(CLI::GetParam<string>("distances_file"), distancesOutput);
+  }
+}
@@ -65,6 +65,44 @@ Cluster(const MatType& data,
   Cluster(data, clusters, assignments, centroids, initialGuess);
 }
 
+template<typename MetricType,
+         typename InitialPartitionPolicy,
+         typename EmptyClusterPolicy,
+         template<class, class> class LloydStepType,
+         typename MatType>
+template<typename PolicyType>
+void KMeans<
+    MetricType,
+    InitialPartitionPolicy,
+    EmptyClusterPolicy,
+    LloydStepType,
+    MatType>::
+ResetEmptyClusterAction(PolicyType& policy,
+    typename boost::enable_if<HasReset<PolicyType,
+        void(PolicyType::*)()> >::type*)
+{
+  policy.Reset();
+}
+
+template<typename MetricType,
+         typename InitialPartitionPolicy,
+         typename EmptyClusterPolicy,
+         template<class, class> class LloydStepType,
+         typename MatType>
+template<typename PolicyType>
+void KMeans<
+    MetricType,
+    InitialPartitionPolicy,
+    EmptyClusterPolicy,
+    LloydStepType,
+    MatType>::
+ResetEmptyClusterAction(PolicyType& /* policy */,
+    typename boost::disable_if<HasReset<PolicyType,
+        void(PolicyType::*)()> >::type*)
+{
+  // Nothing to do.
+}
+
 /**
  * Perform k-means clustering on the data, returning a list of cluster
  * assignments and the centroids of each cluster.
@@ -123,7 +161,7 @@ Cluster(const MatType& data,
     centroids.zeros(data.n_rows, clusters);
     for (size_t i = 0; i < data.n_cols; ++i)
     {
-      centroids.col(assignments[i]) += arma::vec(data.col(i));
+      AddPoint(data, i, centroids, assignments[i]);
       counts[assignments[i]]++;
     }
 
@@ -135,6 +173,10 @@ Cluster(const MatType& data,
   // Counts of points in each cluster.
   arma::Col<size_t> counts(clusters);
 
+  // The iterations are counted from zero again, so anything the empty cluster
+  // policy cached during a previous run must be discarded.
+  ResetEmptyClusterAction(emptyClusterAction);
+
   size_t iteration = 0;
 
   LloydStepType<MetricType, MatType> lloydStep(data, metric);
@@ -159,9 +201,10 @@ Cluster(const MatType& data,
         Log::Info << "Cluster " << i << " is empty.\n";
         if (iteration % 2 == 0)
           emptyClusterAction.EmptyCluster(data, i, centroidsOther, counts,
-              metric);
+              metric, iteration);
         else
-          emptyClusterAction.EmptyCluster(data, i, centroids, counts, metric);
+          emptyClusterAction.EmptyCluster(data, i, centroids, counts, metric,
+              iteration);
       }
     }
 
@@ -227,7 +270,7 @@ Cluster(const MatType& data,
     centroids.zeros(data.n_rows, clusters);
     for (size_t i = 0; i < data.n_cols; ++i)
     {
-      centroids.col(assignments[i]) += arma::vec(data.col(i));
+      AddPoint(data, i, centroids, assignments[i]);
       counts[assignments[i]]++;
     }
 
@@ -240,6 +283,8 @@ Cluster(const MatType& data,
       initialAssignmentGuess || initialCentroidGuess);
 
   // Calculate final assignments.
+  CentroidDistance<MetricType, MatType> distances(data, metric);
+  distances.Centroids(centroids);
   assignments.set_size(data.n_cols);
   for (size_t i = 0; i < data.n_cols; ++i)
   {
@@ -249,7 +294,7 @@ Cluster(const MatType& data,
 
     for (size_t j = 0; j < centroids.n_cols; j++)
     {
-      const double distance = metric.Evaluate(data.col(i), centroids.col(j));
+      const double distance = distances.Evaluate(i, j);
 
       if (distance < minDistance)
       {
@@ -9,11 +9,16 @@
 #include "kmeans.hpp"
 #include "allow_empty_clusters.hpp"
 #include "refined_start.hpp"
+#include "kmeans_plus_plus.hpp"
+#include "kmeans_parallel.hpp"
 #include "elkan_kmeans.hpp"
 #include "hamerly_kmeans.hpp"
 #include "pelleg_moore_kmeans.hpp"
 #include "dtnn_kmeans.hpp"
 #include "dual_tree_kmeans.hpp"
+#include "mini_batch_kmeans.hpp"
+#include "kmeans_model.hpp"
+#include "sharded_kmeans.hpp"
 
 using namespace mlpack;
 using namespace mlpack::kmeans;
@@ -35,6 +40,12 @@ PROGRAM_INFO("K-Means Clustering", "This program performs K-Means clustering "
     "to be used in each sample, the --percentage parameter is used (it should "
     "be a value between 0.0 and 1.0)."
     "\n\n"
+    "The k-means++ seeding (Arthur and Vassilvitskii, 2007) can be used instead"
+    " by specifying the --kmeans_plus_plus (-K) option, and its scalable "
+    "variant k-means|| (Bahmani et al., 2012) by specifying the "
+    "--kmeans_parallel (-L) option; k-means|| draws about --oversampling times"
+    " the number of clusters candidate points in each of --rounds rounds."
+    "\n\n"
     "There are several options available for the algorithm used for each Lloyd "
     "iteration, specified with the --algorithm (-a) option.  The standard O(kN)"
     " approach can be used ('naive').  Other options include the Pelleg-Moore "
@@ -42,6 +53,42 @@ PROGRAM_INFO("K-Means Clustering", "This program performs K-Means clustering "
     "algorithm ('elkan'), and Hamerly's modification to Elkan's algorithm "
     "('hamerly')."
     "\n\n"
+    "Mini-batch k-means (Sculley, \"Web-scale k-means clustering\", 2010) can "
+    "be used by specifying 'minibatch'.  Then the dataset is not loaded into "
+    "memory; instead, it is read in batches of --batch_size points, and "
+    "--passes passes are made over it (the points should be in random order in"
+    " the file).  Only the centroids and the labels (with --labels_only) can "
+    "be saved in this case."
+    "\n\n"
+    "If --sparse (-z) is specified, the input dataset is a coordinate list: "
+    "each line holds the index of a point, the index of a dimension, and the "
+    "value of that (nonzero) element; it is then clustered as a sparse matrix "
+    "with the 'naive' or 'hamerly' algorithm.  Only the centroids and the "
+    "labels (with --labels_only) can be saved in this case."
+    "\n\n"
+    "If --single_precision (-f) is specified, the dataset is loaded and "
+    "clustered in single precision, which halves its memory; the distances "
+    "are computed in single precision, but the centroids are accumulated in "
+    "double precision.  The 'naive', 'elkan' and 'hamerly' algorithms support "
+    "this."
+    "\n\n"
+    "The trained model can be saved with --output_model_file (-M); the "
+    "kmeans_assign program then assigns new points to its clusters without "
+    "clustering again."
+    "\n\n"
+    "A dataset which does not fit on one machine can be clustered by several "
+    "processes, each with its own shard of the points in its --inputFile, with"
+    " the 'naive' or 'hamerly' algorithm.  Each process is started with the "
+    "same --sync_directory (a directory shared by all of them), the same "
+    "--sync_id (which must be different for each clustering using that "
+    "directory, such as the job ID given by a scheduler), the same --num_shards"
+    ", and its own --shard (from 0 to --num_shards - 1); in each iteration the "
+    "processes sum their cluster statistics through files in that directory, "
+    "so they all find the centroids k-means would find on the whole dataset.  "
+    "The initial centroids are chosen from the shard of process 0, and only "
+    "process 0 saves the centroids and the model; each process saves the "
+    "labels of its own shard."
+    "\n\n"
     "As of October 2014, the --overclustering option has been removed.  If you "
     "want this support back, let us know -- file a bug at "
     "http://www.mlpack.org/trac/ or get in touch through another means.");
@@ -58,6 +105,9 @@ PARAM_STRING("output_file", "File to write output labels or labeled data to.",
     "o", "");
 PARAM_STRING("centroid_file", "If specified, the centroids of each cluster will"
     " be written to the given file.", "C", "");
+PARAM_STRING("output_model_file", "If specified, the trained model will be "
+    "saved to the given file (XML), so that new points can be assigned with "
+    "the kmeans_assign program.", "M", "");
 
 // k-means configuration options.
 PARAM_FLAG("allow_empty_clusters", "Allow empty clusters to be created.", "e");
@@ -76,8 +126,41 @@ PARAM_INT("samplings", "Number of samplings to perform for refined start (use "
 PARAM_DOUBLE("percentage", "Percentage of dataset to use for each refined start"
     " sampling (use when --refined_start is specified).", "p", 0.02);
 
+// Parameters for k-means++ and k-means|| initial points.
+PARAM_FLAG("kmeans_plus_plus", "Use the k-means++ seeding to choose initial "
+    "points.", "K");
+PARAM_FLAG("kmeans_parallel", "Use the k-means|| seeding to choose initial "
+    "points.", "L");
+PARAM_DOUBLE("oversampling", "Number of candidates drawn in each k-means|| "
+    "round, divided by the number of clusters (use when --kmeans_parallel is "
+    "specified).", "O", 2.0);
+PARAM_INT("rounds", "Number of k-means|| rounds (use when --kmeans_parallel is "
+    "specified).", "R", 5);
+
 PARAM_STRING("algorithm", "Algorithm to use for the Lloyd iteration ('naive', "
-    "'pelleg-moore', 'elkan', 'hamerly', or 'dtnn').", "a", "naive");
+    "'pelleg-moore', 'elkan', 'hamerly', 'dtnn', or 'minibatch').", "a",
+    "naive");
+
+PARAM_FLAG("sparse", "The input dataset is a sparse coordinate list (see "
+    "above).", "z");
+PARAM_FLAG("single_precision", "Load and cluster the dataset in single "
+    "precision (see above).", "f");
+
+// Parameters for distributed k-means.
+PARAM_STRING("sync_directory", "Directory shared by the processes of a "
+    "distributed clustering (see above).", "", "");
+PARAM_STRING("sync_id", "Identifier of a distributed clustering, the same for "
+    "all of its processes (use when --sync_directory is specified).", "", "");
+PARAM_INT("shard", "Index of the shard of this process (use when "
+    "--sync_directory is specified).", "", 0);
+PARAM_INT("num_shards", "Number of shards (use when --sync_directory is "
+    "specified).", "", 1);
+
+// Parameters for mini-batch k-means.
+PARAM_INT("batch_size", "Number of points in each batch (use when --algorithm "
+    "is 'minibatch').", "b", 1000);
+PARAM_INT("passes", "Number of passes over the dataset (use when --algorithm "
+    "is 'minibatch').", "n", 1);
 
 // Given the type of initial partition policy, figure out the empty cluster
 // policy and run k-means.
@@ -92,9 +175,35 @@ void FindLloydStepType(const InitialPartitionPolicy& ipp);
 // Given the template parameters, sanitize/load input and run k-means.
 template<typename InitialPartitionPolicy,
          typename EmptyClusterPolicy,
-         template<class, class> class LloydStepType>
+         template<class, class> class LloydStepType,
+         typename MatType>
 void RunKMeans(const InitialPartitionPolicy& ipp);
 
+// Run k-means on the shard of this process, together with the other processes.
+template<typename InitialPartitionPolicy,
+         template<class, class> class LloydStepType,
+         typename MatType>
+void RunShardedKMeans(const InitialPartitionPolicy& ipp);
+
+// Save the assignments as the options ask for.
+template<typename MatType>
+void SaveAssignments(const string& inputFile,
+                     MatType& dataset,
+                     const arma::Col<size_t>& assignments);
+
+// Add the assignments to the dataset as its last dimension, and save it.
+template<typename eT>
+void SaveLabeledDataset(const string& filename,
+                        arma::Mat<eT>& dataset,
+                        const arma::Col<size_t>& assignments);
+// Labeled sparse datasets are not saved (main() checks this first).
+void SaveLabeledDataset(const string& filename,
+                        arma::sp_mat& dataset,
+                        const arma::Col<size_t>& assignments);
+
+// Run mini-batch k-means, reading the dataset in batches.
+void RunMiniBatchKMeans();
+
 int main(int argc, char** argv)
 {
   CLI::ParseCommandLine(argc, argv);
@@ -105,6 +214,24 @@ int main(int argc, char** argv)
   else
     math::RandomSeed((size_t) std::time(NULL));
 
+  // Only the centroids and the labels can be saved for sparse datasets.
+  if (CLI::HasParam("sparse") && (CLI::HasParam("in_place") ||
+      (CLI::HasParam("output_file") && !CLI::HasParam("labels_only"))))
+  {
+    Log::Fatal << "With --sparse, only labels can be saved; specify "
+        << "--labels_only and --output_file, or --centroid_file." << endl;
+  }
+
+  if (CLI::HasParam("sparse") && CLI::HasParam("single_precision"))
+    Log::Fatal << "--sparse and --single_precision cannot both be specified!"
+        << endl;
+
+  if ((int) CLI::HasParam("refined_start") +
+      (int) CLI::HasParam("kmeans_plus_plus") +
+      (int) CLI::HasParam("kmeans_parallel") > 1)
+    Log::Fatal << "Only one of --refined_start, --kmeans_plus_plus and "
+        << "--kmeans_parallel may be specified!" << endl;
+
   // Now, start building the KMeans type that we'll be using.  Start with the
   // initial partition policy.  The call to FindEmptyClusterPolicy<> results in
   // a call to RunKMeans<> and the algorithm is completed.
@@ -122,6 +249,25 @@ int main(int argc, char** argv)
 
     FindEmptyClusterPolicy<RefinedStart>(RefinedStart(samplings, percentage));
   }
+  else if (CLI::HasParam("kmeans_plus_plus"))
+  {
+    FindEmptyClusterPolicy<KMeansPlusPlus>(KMeansPlusPlus());
+  }
+  else if (CLI::HasParam("kmeans_parallel"))
+  {
+    const double oversampling = CLI::GetParam<double>("oversampling");
+    const int rounds = CLI::GetParam<int>("rounds");
+
+    if (oversampling <= 0.0)
+      Log::Fatal << "Oversampling factor (" << oversampling << ") must be "
+          << "greater than 0.0!" << endl;
+    if (rounds < 0)
+      Log::Fatal << "Number of rounds (" << rounds << ") must be greater than "
+          << "or equal to 0!" << endl;
+
+    FindEmptyClusterPolicy<KMeansParallel>(KMeansParallel(oversampling,
+        (size_t) rounds));
+  }
   else
   {
     FindEmptyClusterPolicy<RandomPartition>(RandomPartition());
@@ -145,33 +291,105 @@ template<typename InitialPartitionPolicy, typename EmptyClusterPolicy>
 void FindLloydStepType(const InitialPartitionPolicy& ipp)
 {
   const string algorithm = CLI::GetParam<string>("algorithm");
-  if (algorithm == "elkan")
-    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, ElkanKMeans>(ipp);
+  if (CLI::HasParam("sync_directory"))
+  {
+    // The empty cluster policy is given to ShardedKMeans as a flag.
+    if (algorithm != "naive" && algorithm != "hamerly")
+      Log::Fatal << "Algorithm '" << algorithm << "' does not support "
+          << "--sync_directory; use 'naive' or 'hamerly'." << endl;
+    if (!CLI::HasParam("sync_id"))
+      Log::Fatal << "--sync_id must be specified with --sync_directory."
+          << endl;
+
+    if (CLI::HasParam("sparse"))
+    {
+      if (algorithm == "hamerly")
+        RunShardedKMeans<InitialPartitionPolicy, HamerlyKMeans,
+            arma::sp_mat>(ipp);
+      else
+        RunShardedKMeans<InitialPartitionPolicy, NaiveKMeans,
+            arma::sp_mat>(ipp);
+    }
+    else if (CLI::HasParam("single_precision"))
+    {
+      if (algorithm == "hamerly")
+        RunShardedKMeans<InitialPartitionPolicy, HamerlyKMeans,
+            arma::fmat>(ipp);
+      else
+        RunShardedKMeans<InitialPartitionPolicy, NaiveKMeans,
+            arma::fmat>(ipp);
+    }
+    else
+    {
+      if (algorithm == "hamerly")
+        RunShardedKMeans<InitialPartitionPolicy, HamerlyKMeans,
+            arma::mat>(ipp);
+      else
+        RunShardedKMeans<InitialPartitionPolicy, NaiveKMeans,
+            arma::mat>(ipp);
+    }
+  }
+  else if (CLI::HasParam("sparse"))
+  {
+    if (algorithm == "hamerly")
+      RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, HamerlyKMeans,
+          arma::sp_mat>(ipp);
+    else if (algorithm == "naive")
+      RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, NaiveKMeans,
+          arma::sp_mat>(ipp);
+    else
+      Log::Fatal << "Algorithm '" << algorithm << "' does not support sparse "
+          << "datasets; use 'naive' or 'hamerly'." << endl;
+  }
+  else if (CLI::HasParam("single_precision"))
+  {
+    if (algorithm == "elkan")
+      RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, ElkanKMeans,
+          arma::fmat>(ipp);
+    else if (algorithm == "hamerly")
+      RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, HamerlyKMeans,
+          arma::fmat>(ipp);
+    else if (algorithm == "naive")
+      RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, NaiveKMeans,
+          arma::fmat>(ipp);
+    else
+      Log::Fatal << "Algorithm '" << algorithm << "' does not support "
+          << "--single_precision; use 'naive', 'elkan' or 'hamerly'." << endl;
+  }
+  else if (algorithm == "elkan")
+    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, ElkanKMeans,
+        arma::mat>(ipp);
   else if (algorithm == "hamerly")
-    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, HamerlyKMeans>(ipp);
+    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, HamerlyKMeans,
+        arma::mat>(ipp);
   else if (algorithm == "pelleg-moore")
     RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy,
-        PellegMooreKMeans>(ipp);
+        PellegMooreKMeans, arma::mat>(ipp);
   else if (algorithm == "dtnn")
     RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy,
-        DefaultDTNNKMeans>(ipp);
+        DefaultDTNNKMeans, arma::mat>(ipp);
   else if (algorithm == "dtnn-covertree")
     RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy,
-        CoverTreeDTNNKMeans>(ipp);
+        CoverTreeDTNNKMeans, arma::mat>(ipp);
   else if (algorithm == "dualtree")
     RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy,
-        DefaultDualTreeKMeans>(ipp);
+        DefaultDualTreeKMeans, arma::mat>(ipp);
   else if (algorithm == "naive")
-    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, NaiveKMeans>(ipp);
+    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, NaiveKMeans,
+        arma::mat>(ipp);
+  else if (algorithm == "minibatch")
+    RunMiniBatchKMeans();
   else
     Log::Fatal << "Unknown algorithm: '" << algorithm << "'.  Supported options"
-        << " are 'naive', 'pelleg-moore', 'elkan', and 'hamerly'." << endl;
+        << " are 'naive', 'pelleg-moore', 'elkan', 'hamerly', and 'minibatch'."
+        << endl;
 }
 
 // Given the template parameters, sanitize/load input and run k-means.
 template<typename InitialPartitionPolicy,
          typename EmptyClusterPolicy,
-         template<class, class> class LloydStepType>
+         template<class, class> class LloydStepType,
+         typename MatType>
 void RunKMeans(const InitialPartitionPolicy& ipp)
 {
   // Now, do validation of input options.
@@ -192,14 +410,15 @@ void RunKMeans(const InitialPartitionPolicy& ipp)
 
   // Make sure we have an output file if we're not doing the work in-place.
   if (!CLI::HasParam("in_place") && !CLI::HasParam("output_file") &&
-      !CLI::HasParam("centroid_file"))
+      !CLI::HasParam("centroid_file") && !CLI::HasParam("output_model_file"))
   {
-    Log::Warn << "--output_file, --in_place, and --centroid_file are not set; "
-        << "no results will be saved." << std::endl;
+    Log::Warn << "--output_file, --in_place, --centroid_file, and "
+        << "--output_model_file are not set; no results will be saved."
+        << std::endl;
   }
 
   // Load our dataset.
-  arma::mat dataset;
+  MatType dataset;
   data::Load(inputFile, dataset, true); // Fatal upon failure.
 
   arma::mat centroids;
@@ -211,9 +430,10 @@ void RunKMeans(const InitialPartitionPolicy& ipp)
     string initialCentroidsFile = CLI::GetParam<string>("initial_centroids");
     data::Load(initialCentroidsFile, centroids, true);
 
-    if (CLI::HasParam("refined_start"))
+    if (CLI::HasParam("refined_start") || CLI::HasParam("kmeans_plus_plus") ||
+        CLI::HasParam("kmeans_parallel"))
       Log::Warn << "Initial centroids are specified, but will be ignored "
-          << "because --refined_start is also specified!" << endl;
+          << "because an initial point strategy is also specified!" << endl;
     else
       Log::Info << "Using initial centroid guesses from '" <<
           initialCentroidsFile << "'." << endl;
@@ -222,7 +442,8 @@ void RunKMeans(const InitialPartitionPolicy& ipp)
   KMeans<metric::EuclideanDistance,
          InitialPartitionPolicy,
          EmptyClusterPolicy,
-         LloydStepType> kmeans(maxIterations, metric::EuclideanDistance(), ipp);
+         LloydStepType,
+         MatType> kmeans(maxIterations, metric::EuclideanDistance(), ipp);
 
   if (CLI::HasParam("output_file") || CLI::HasParam("in_place"))
   {
@@ -233,53 +454,253 @@ void RunKMeans(const InitialPartitionPolicy& ipp)
         false, initialCentroidGuess);
     Timer::Stop("clustering");
 
-    // Now figure out what to do with our results.
-    if (CLI::HasParam("in_place"))
-    {
-      // Add the column of assignments to the dataset; but we have to convert
-      // them to type double first.
-      arma::vec converted(assignments.n_elem);
-      for (size_t i = 0; i < assignments.n_elem; i++)
-        converted(i) = (double) assignments(i);
+    SaveAssignments(inputFile, dataset, assignments);
+  }
+  else
+  {
+    // Just save the centroids.
+    Timer::Start("clustering");
+    kmeans.Cluster(dataset, clusters, centroids, initialCentroidGuess);
+    Timer::Stop("clustering");
+  }
+
+  // Should we write the centroids to a file?
+  if (CLI::HasParam("centroid_file"))
+    data::Save(CLI::GetParam<std::string>("centroid_file"), centroids);
+
+  // Should we save the model?
+  if (CLI::HasParam("output_model_file"))
+    KMeansModel(centroids).Save(CLI::GetParam<string>("output_model_file"));
+}
+
+template<typename InitialPartitionPolicy,
+         template<class, class> class LloydStepType,
+         typename MatType>
+void RunShardedKMeans(const InitialPartitionPolicy& ipp)
+{
+  const string inputFile = CLI::GetParam<string>("inputFile");
+  const int clusters = CLI::GetParam<int>("clusters");
+  if (clusters < 1)
+  {
+    Log::Fatal << "Invalid number of clusters requested (" << clusters << ")! "
+        << "Must be greater than or equal to 1." << endl;
+  }
+
+  const int maxIterations = CLI::GetParam<int>("max_iterations");
+  if (maxIterations < 0)
+  {
+    Log::Fatal << "Invalid value for maximum iterations (" << maxIterations <<
+        ")! Must be greater than or equal to 0." << endl;
+  }
+
+  const int numShards = CLI::GetParam<int>("num_shards");
+  const int shard = CLI::GetParam<int>("shard");
+  if (numShards < 1 || shard < 0 || shard >= numShards)
+  {
+    Log::Fatal << "Invalid shard " << shard << " of " << numShards << "! "
+        << "--shard must be between 0 and --num_shards - 1." << endl;
+  }
+
+  if (!CLI::HasParam("in_place") && !CLI::HasParam("output_file") &&
+      !(shard == 0 && (CLI::HasParam("centroid_file") ||
+      CLI::HasParam("output_model_file"))))
+  {
+    Log::Warn << "--output_file and --in_place are not set, and only shard 0 "
+        << "saves the centroids and the model; no results will be saved by "
+        << "this process." << std::endl;
+  }
+
+  // Load the shard of this process.
+  MatType dataset;
+  data::Load(inputFile, dataset, true); // Fatal upon failure.
+
+  arma::mat centroids;
+  const bool initialCentroidGuess = CLI::HasParam("initial_centroids");
+  if (initialCentroidGuess)
+  {
+    string initialCentroidsFile = CLI::GetParam<string>("initial_centroids");
+    data::Load(initialCentroidsFile, centroids, true);
+
+    if (CLI::HasParam("refined_start") || CLI::HasParam("kmeans_plus_plus") ||
+        CLI::HasParam("kmeans_parallel"))
+      Log::Warn << "Initial centroids are specified, but will be ignored "
+          << "because an initial point strategy is also specified!" << endl;
+    else
+      Log::Info << "Using initial centroid guesses from '" <<
+          initialCentroidsFile << "'." << endl;
+  }
+
+  util::FileCommunicator communicator(
+      CLI::GetParam<string>("sync_directory"), (size_t) shard,
+      (size_t) numShards, CLI::GetParam<string>("sync_id"));
+  ShardedKMeans<util::FileCommunicator,
+                metric::EuclideanDistance,
+                InitialPartitionPolicy,
+                LloydStepType,
+                MatType> kmeans(communicator, maxIterations,
+      CLI::HasParam("allow_empty_clusters"), metric::EuclideanDistance(), ipp);
+
+  if (CLI::HasParam("output_file") || CLI::HasParam("in_place"))
+  {
+    arma::Col<size_t> assignments;
+    Timer::Start("clustering");
+    kmeans.Cluster(dataset, clusters, assignments, centroids,
+        initialCentroidGuess);
+    Timer::Stop("clustering");
 
-      dataset.insert_rows(dataset.n_rows, trans(converted));
+    SaveAssignments(inputFile, dataset, assignments);
+  }
+  else
+  {
+    Timer::Start("clustering");
+    kmeans.Cluster(dataset, clusters, centroids, initialCentroidGuess);
+    Timer::Stop("clustering");
+  }
 
-      // Save the dataset.
-      data::Save(inputFile, dataset);
+  // The centroids are the same on every process, so only one saves them.
+  if (shard != 0)
+    return;
+
+  if (CLI::HasParam("centroid_file"))
+    data::Save(CLI::GetParam<std::string>("centroid_file"), centroids);
+
+  if (CLI::HasParam("output_model_file"))
+    KMeansModel(centroids).Save(CLI::GetParam<string>("output_model_file"));
+}
+
+template<typename MatType>
+void SaveAssignments(const string& inputFile,
+                     MatType& dataset,
+                     const arma::Col<size_t>& assignments)
+{
+  if (CLI::HasParam("in_place"))
+  {
+    // Add the column of assignments to the dataset and save it.
+    SaveLabeledDataset(inputFile, dataset, assignments);
+  }
+  else
+  {
+    if (CLI::HasParam("labels_only"))
+    {
+      // Save only the labels.
+      string outputFile = CLI::GetParam<string>("output_file");
+      arma::Mat<size_t> output = trans(assignments);
+      data::Save(outputFile, output);
     }
     else
     {
-      if (CLI::HasParam("labels_only"))
-      {
-        // Save only the labels.
-        string outputFile = CLI::GetParam<string>("output_file");
-        arma::Mat<size_t> output = trans(assignments);
-        data::Save(outputFile, output);
-      }
-      else
-      {
-        // Convert the assignments to doubles.
-        arma::vec converted(assignments.n_elem);
-        for (size_t i = 0; i < assignments.n_elem; i++)
-          converted(i) = (double) assignments(i);
-
-        dataset.insert_rows(dataset.n_rows, trans(converted));
-
-        // Now save, in the different file.
-        string outputFile = CLI::GetParam<string>("output_file");
-        data::Save(outputFile, dataset);
-      }
+      // Save the labeled dataset, in the different file.
+      SaveLabeledDataset(CLI::GetParam<string>("output_file"), dataset,
+          assignments);
     }
   }
+}
+
+template<typename eT>
+void SaveLabeledDataset(const string& filename,
+                        arma::Mat<eT>& dataset,
+                        const arma::Col<size_t>& assignments)
+{
+  // We have to convert the assignments to the element type first.
+  arma::Col<eT> converted(assignments.n_elem);
+  for (size_t i = 0; i < assignments.n_elem; i++)
+    converted(i) = (eT) assignments(i);
+
+  dataset.insert_rows(dataset.n_rows, trans(converted));
+  data::Save(filename, dataset);
+}
+
+void SaveLabeledDataset(const string& /* filename */,
+                        arma::sp_mat& /* dataset */,
+                        const arma::Col<size_t>& /* assignments */)
+{
+  Log::Fatal << "Labeled sparse datasets cannot be saved." << endl;
+}
+
+// Run mini-batch k-means, reading the dataset in batches.
+void RunMiniBatchKMeans()
+{
+  const string inputFile = CLI::GetParam<string>("inputFile");
+  const int clusters = CLI::GetParam<int>("clusters");
+  if (clusters < 1)
+  {
+    Log::Fatal << "Invalid number of clusters requested (" << clusters << ")! "
+        << "Must be greater than or equal to 1." << endl;
+  }
+
+  const int batchSize = CLI::GetParam<int>("batch_size");
+  if (batchSize < 1)
+  {
+    Log::Fatal << "Invalid batch size (" << batchSize << ")! Must be greater "
+        << "than or equal to 1." << endl;
+  }
+
+  const int passes = CLI::GetParam<int>("passes");
+  if (passes < 1)
+  {
+    Log::Fatal << "Invalid number of passes (" << passes << ")! Must be "
+        << "greater than or equal to 1." << endl;
+  }
+
+  // The dataset is never in memory, so we cannot add the labels to it.
+  if (CLI::HasParam("in_place") || (CLI::HasParam("output_file") &&
+      !CLI::HasParam("labels_only")))
+  {
+    Log::Fatal << "With --algorithm minibatch, only labels can be saved; "
+        << "specify --labels_only and --output_file, or --centroid_file."
+        << endl;
+  }
+
+  if (!CLI::HasParam("output_file") && !CLI::HasParam("centroid_file") &&
+      !CLI::HasParam("output_model_file"))
+  {
+    Log::Warn << "--output_file, --centroid_file, and --output_model_file are "
+        << "not set; no results will be saved." << std::endl;
+  }
+
+  if (CLI::HasParam("refined_start") || CLI::HasParam("kmeans_plus_plus") ||
+      CLI::HasParam("kmeans_parallel"))
+    Log::Warn << "--refined_start, --kmeans_plus_plus and --kmeans_parallel "
+        << "are ignored with --algorithm minibatch." << endl;
+  if (CLI::HasParam("allow_empty_clusters"))
+    Log::Warn << "--allow_empty_clusters is ignored with --algorithm "
+        << "minibatch." << endl;
+
+  arma::mat centroids;
+  const bool initialCentroidGuess = CLI::HasParam("initial_centroids");
+  if (initialCentroidGuess)
+  {
+    string initialCentroidsFile = CLI::GetParam<string>("initial_centroids");
+    data::Load(initialCentroidsFile, centroids, true);
+    Log::Info << "Using initial centroid guesses from '" <<
+        initialCentroidsFile << "'." << endl;
+  }
+
+  data::StreamingReader reader(inputFile, (size_t) batchSize);
+  metric::EuclideanDistance metric;
+
+  Timer::Start("clustering");
+  MiniBatchCluster(reader, (size_t) clusters, centroids, (size_t) passes,
+      initialCentroidGuess, metric);
+
+  if (CLI::HasParam("output_file"))
+  {
+    arma::Col<size_t> assignments;
+    MiniBatchAssign(reader, centroids, assignments, metric);
+    Timer::Stop("clustering");
+
+    arma::Mat<size_t> output = trans(assignments);
+    data::Save(CLI::GetParam<string>("output_file"), output);
+  }
   else
   {
-    // Just save the centroids.
-    Timer::Start("clustering");
-    kmeans.Cluster(dataset, clusters, centroids, initialCentroidGuess);
     Timer::Stop("clustering");
   }
 
-  // Should we write the centroids to a file?
   if (CLI::HasParam("centroid_file"))
     data::Save(CLI::GetParam<std::string>("centroid_file"), centroids);
+
+  // Should we save the model?
+  if (CLI::HasParam("output_model_file"))
+    KMeansModel(centroids).Save(CLI::GetParam<string>("output_model_file"));
 }
@@ -0,0 +1,181 @@
+/**
+ * @file kmeans_model.cpp
+ *
+ * Implementation of the k-means model.
+ */
+#include "kmeans_model.hpp"
+
+using namespace mlpack;
+using namespace mlpack::kmeans;
+using namespace mlpack::neighbor;
+
+KMeansModel::KMeansModel() : tree(NULL)
+{
+  // Nothing to do.
+}
+
+KMeansModel::KMeansModel(const arma::mat& centroids) : tree(NULL)
+{
+  Centroids(centroids);
+}
+
+KMeansModel::KMeansModel(const KMeansModel& other) : tree(NULL)
+{
+  Centroids(other.centroids);
+}
+
+KMeansModel& KMeansModel::operator=(const KMeansModel& other)
+{
+  if (this != &other)
+    Centroids(other.centroids);
+
+  return *this;
+}
+
+KMeansModel::~KMeansModel()
+{
+  if (tree)
+    delete tree;
+}
+
+void KMeansModel::Centroids(const arma::mat& newCentroids)
+{
+  if (tree)
+    delete tree;
+  tree = NULL;
+
+  centroids = newCentroids;
+  oldFromNew.clear();
+  treeCentroids.reset();
+
+  // With few centroids, checking all of them is faster than searching a tree.
+  if (centroids.n_cols >= minTreeCentroids)
+  {
+    treeCentroids = centroids;
+    tree = new TreeType(treeCentroids, oldFromNew, 1);
+  }
+}
+
+void KMeansModel::Assign(const arma::mat& points,
+                         arma::Col<size_t>& assignments) const
+{
+  arma::vec distances;
+  Assign(points, assignments, distances);
+}
+
+void KMeansModel::Assign(const arma::mat& points,
+                         arma::Col<size_t>& assignments,
+                         arma::vec& distances) const
+{
+  if (centroids.n_cols == 0)
+    Log::Fatal << "KMeansModel::Assign(): the model has no centroids!"
+        << std::endl;
+  if (points.n_rows != centroids.n_rows)
+    Log::Fatal << "KMeansModel::Assign(): points have dimensionality "
+        << points.n_rows << ", but the centroids have dimensionality "
+        << centroids.n_rows << "!" << std::endl;
+
+  assignments.set_size(points.n_cols);
+  distances.set_size(points.n_cols);
+
+  if (tree == NULL)
+  {
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < points.n_cols; ++i)
+    {
+      double minDistance = DBL_MAX;
+      size_t closestCluster = 0;
+      for (size_t c = 0; c < centroids.n_cols; ++c)
+      {
+        const double distance = metric::EuclideanDistance::Evaluate(
+            points.col(i), centroids.col(c));
+        if (distance < minDistance)
+        {
+          minDistance = distance;
+          closestCluster = c;
+        }
+      }
+
+      assignments[i] = closestCluster;
+      distances[i] = minDistance;
+    }
+
+    return;
+  }
+
+  // Each thread has its own rules object and traverser; the rules only write
+  // to the column of the query point they are given, so no locking is
+  // necessary.  The kd-tree is not modified by single-tree search.
+  typedef NeighborSearchRules<NearestNeighborSort, metric::EuclideanDistance,
+      TreeType> RuleType;
+  arma::Mat<size_t> neighbors(1, points.n_cols);
+  neighbors.fill(size_t() - 1);
+  arma::mat neighborDistances(1, points.n_cols);
+  neighborDistances.fill(NearestNeighborSort::WorstDistance());
+
+  #pragma omp parallel
+  {
+    metric::EuclideanDistance metric;
+    RuleType rules(treeCentroids, points, neighbors, neighborDistances, metric);
+    TreeType::SingleTreeTraverser<RuleType> traverser(rules);
+
+    #pragma omp for schedule(dynamic, 256)
+    for (size_t i = 0; i < points.n_cols; ++i)
+      traverser.Traverse(i, *tree);
+  }
+
+  for (size_t i = 0; i < points.n_cols; ++i)
+  {
+    assignments[i] = oldFromNew[neighbors(0, i)];
+    distances[i] = neighborDistances(0, i);
+  }
+}
+
+void KMeansModel::Load(const std::string& filename)
+{
+  util::SaveRestoreUtility load;
+
+  if (!load.ReadFile(filename))
+    Log::Fatal << "KMeansModel::Load(): could not read file '" << filename
+        << "'!" << std::endl;
+  Load(load);
+}
+
+void KMeansModel::Save(const std::string& filename) const
+{
+  util::SaveRestoreUtility save;
+  Save(save);
+
+  if (!save.WriteFile(filename))
+    Log::Warn << "KMeansModel::Save(): error saving to '" << filename << "'."
+        << std::endl;
+}
+
+void KMeansModel::Load(const util::SaveRestoreUtility& sr)
+{
+  std::string type;
+  sr.LoadParameter(type, "type");
+  if (type != "kmeans")
+    Log::Fatal << "KMeansModel::Load(): model type is '" << type << "', not "
+        << "'kmeans'!" << std::endl;
+
+  arma::mat newCentroids;
+  sr.LoadParameter(newCentroids, "centroids");
+  Centroids(newCentroids);
+}
+
+void KMeansModel::Save(util::SaveRestoreUtility& sr) const
+{
+  sr.SaveParameter(std::string("kmeans"), "type");
+  sr.SaveParameter(centroids, "centroids");
+}
+
+std::string KMeansModel::ToString() const
+{
+  std::ostringstream convert;
+  convert << "KMeansModel [" << this << "]" << std::endl;
+  convert << "  Clusters: " << centroids.n_cols << std::endl;
+  convert << "  Dimensionality: " << centroids.n_rows << std::endl;
+  convert << "  Tree: " << ((tree == NULL) ? "no" : "yes") << std::endl;
+  return convert.str();
+}
@@ -0,0 +1,139 @@
+/**
+ * @file kmeans_model.hpp
+ *
+ * A trained k-means model: the centroids of the clusters, which can be saved
+ * to and loaded from a file, and used to assign new points to their closest
+ * cluster.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KMEANS_MODEL_HPP
+#define __MLPACK_METHODS_KMEANS_KMEANS_MODEL_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * A k-means model holds the centroids found by KMeans::Cluster(), so that new
+ * points can be assigned to their closest centroid without clustering again.
+ * The model can be saved to and loaded from an XML file (with
+ * util::SaveRestoreUtility).
+ *
+ * When there are enough centroids, a kd-tree is built on them once, when the
+ * centroids are set, and each point is assigned with a single-tree
+ * nearest-neighbor search; otherwise every centroid is checked.  Points are
+ * assigned in parallel if OpenMP is available.  Distances are Euclidean, as
+ * for KMeans<>.
+ *
+ * @code
+ * extern arma::mat data, newPoints;
+ * arma::mat centroids;
+ * KMeans<> k;
+ * k.Cluster(data, 100, centroids);
+ *
+ * KMeansModel model(centroids);
+ * model.Save("model.xml");
+ *
+ * arma::Col<size_t> assignments;
+ * model.Assign(newPoints, assignments);
+ * @endcode
+ */
+class KMeansModel
+{
+ public:
+  //! The type of tree built on the centroids.
+  typedef tree::BinarySpaceTree<bound::HRectBound<2>,
+      neighbor::NeighborSearchStat<neighbor::NearestNeighborSort> > TreeType;
+
+  //! Create an empty model; call Centroids() or Load() before Assign().
+  KMeansModel();
+
+  /**
+   * Create the model with the given centroids (one per column).
+   *
+   * @param centroids Centroids of the clusters.
+   */
+  KMeansModel(const arma::mat& centroids);
+
+  //! Copy the model (the tree is built again).
+  KMeansModel(const KMeansModel& other);
+
+  //! Copy the model (the tree is built again).
+  KMeansModel& operator=(const KMeansModel& other);
+
+  //! Delete the model.
+  ~KMeansModel();
+
+  //! Get the centroids.
+  const arma::mat& Centroids() const { return centroids; }
+
+  /**
+   * Set the centroids, and build the tree on them if there are enough of
+   * them.
+   *
+   * @param newCentroids Centroids of the clusters (one per column).
+   */
+  void Centroids(const arma::mat& newCentroids);
+
+  //! Get the number of clusters.
+  size_t Clusters() const { return centroids.n_cols; }
+  //! Get the dimensionality of the centroids.
+  size_t Dimensionality() const { return centroids.n_rows; }
+
+  /**
+   * Assign each of the given points to its closest centroid.
+   *
+   * @param points Points to assign (one per column).
+   * @param assignments Vector to store the index of the closest centroid to
+   *     each point in.
+   */
+  void Assign(const arma::mat& points, arma::Col<size_t>& assignments) const;
+
+  /**
+   * Assign each of the given points to its closest centroid, also storing the
+   * distance between each point and that centroid.
+   *
+   * @param points Points to assign (one per column).
+   * @param assignments Vector to store the index of the closest centroid to
+   *     each point in.
+   * @param distances Vector to store the distance between each point and its
+   *     closest centroid in.
+   */
+  void Assign(const arma::mat& points,
+              arma::Col<size_t>& assignments,
+              arma::vec& distances) const;
+
+  //! Load the model from an XML file; fatal if the file cannot be read.
+  void Load(const std::string& filename);
+
+  //! Save the model to an XML file.
+  void Save(const std::string& filename) const;
+
+  //! Load the model from a SaveRestoreUtility.
+  void Load(const util::SaveRestoreUtility& sr);
+
+  //! Save the model to a SaveRestoreUtility.
+  void Save(util::SaveRestoreUtility& sr) const;
+
+  //! Returns a string representation of this object.
+  std::string ToString() const;
+
+ private:
+  //! The centroids, in their original order.
+  arma::mat centroids;
+  //! The centroids, in the order of the tree (if there is a tree).
+  arma::mat treeCentroids;
+  //! The original index of each centroid of treeCentroids.
+  std::vector<size_t> oldFromNew;
+  //! The tree built on treeCentroids (NULL if there are few centroids).
+  TreeType* tree;
+
+  //! The smallest number of centroids for which a tree is built.
+  static const size_t minTreeCentroids = 32;
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
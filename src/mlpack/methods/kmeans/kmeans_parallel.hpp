@@ -0,0 +1,109 @@
+/**
+ * @file kmeans_parallel.hpp
+ *
+ * An implementation of the scalable k-means++ (k-means||) seeding of Bahmani
+ * et al., as an InitialPartitionPolicy for KMeans.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KMEANS_PARALLEL_HPP
+#define __MLPACK_METHODS_KMEANS_KMEANS_PARALLEL_HPP
+
+#include <mlpack/core.hpp>
+#include "kmeans_plus_plus.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * The k-means|| initial partition.  Instead of drawing k centers one after the
+ * other as k-means++ does (see KMeansPlusPlus), which needs k passes over the
+ * dataset, a few rounds are made; in each round, every point is independently
+ * taken as a candidate with probability (oversampling * k) times its squared
+ * distance to the closest candidate, divided by the sum of those squared
+ * distances.  The candidates are then weighted by the number of points closest
+ * to them, and k-means++ chooses k centers among the weighted candidates.
+ * Every point is finally assigned to its closest center.  This is an
+ * implementation of the following paper:
+ *
+ * @article{bahmani2012scalable,
+ *   title={Scalable k-means++},
+ *   author={Bahmani, Bahman and Moseley, Benjamin and Vattani, Andrea and
+ *       Kumar, Ravi and Vassilvitskii, Sergei},
+ *   journal={Proceedings of the VLDB Endowment},
+ *   volume={5},
+ *   number={7},
+ *   pages={622--633},
+ *   year={2012}
+ * }
+ *
+ * The squared distance of each point to its closest candidate is only updated
+ * with the candidates of the last round, and the points of each round are
+ * drawn in parallel if OpenMP is available.  The random draws for each point
+ * only depend on the random seed (see math::RandomSeed()), so the result does
+ * not depend on the number of threads.  Distances are always Euclidean.
+ */
+class KMeansParallel
+{
+ public:
+  /**
+   * Create the KMeansParallel object, optionally specifying the oversampling
+   * factor (the expected number of candidates drawn in each round, divided by
+   * the number of clusters) and the number of rounds.
+   */
+  KMeansParallel(const double oversampling = 2.0,
+                 const size_t rounds = 5) :
+      oversampling(oversampling), rounds(rounds) { }
+
+  /**
+   * Partition the given dataset into the given number of clusters with the
+   * k-means|| seeding.
+   *
+   * @tparam MatType Type of data (arma::mat, arma::fmat or arma::sp_mat).
+   * @param data Dataset to partition.
+   * @param clusters Number of clusters to split dataset into.
+   * @param assignments Vector to store cluster assignments into.  Values will
+   *     be between 0 and (clusters - 1).
+   */
+  template<typename MatType>
+  void Cluster(const MatType& data,
+               const size_t clusters,
+               arma::Col<size_t>& assignments) const;
+
+  //! Get the oversampling factor.
+  double Oversampling() const { return oversampling; }
+  //! Modify the oversampling factor.
+  double& Oversampling() { return oversampling; }
+
+  //! Get the number of rounds.
+  size_t Rounds() const { return rounds; }
+  //! Modify the number of rounds.
+  size_t& Rounds() { return rounds; }
+
+ private:
+  //! The expected number of candidates of each round, divided by the number
+  //! of clusters.
+  double oversampling;
+  //! The number of rounds.
+  size_t rounds;
+
+  /**
+   * Update the squared distance of each point to its closest candidate (and
+   * the index of that candidate) with the candidates from the given index on.
+   */
+  template<typename MatType>
+  static void UpdateDistances(const MatType& data,
+                              const std::vector<size_t>& candidates,
+                              const size_t firstNew,
+                              arma::vec& minDistances,
+                              arma::Col<size_t>& closest);
+
+  //! Get a uniform random number in [0, 1) for the given seed and index.
+  static double Uniform(const uint64_t seed, const uint64_t index);
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+// Include implementation.
+#include "kmeans_parallel_impl.hpp"
+
+#endif
@@ -0,0 +1,164 @@
+/**
+ * @file kmeans_parallel_impl.hpp
+ *
+ * Implementation of the k-means|| seeding.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KMEANS_PARALLEL_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_KMEANS_PARALLEL_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "kmeans_parallel.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+//! Partition the given dataset with the k-means|| seeding.
+template<typename MatType>
+void KMeansParallel::Cluster(const MatType& data,
+                             const size_t clusters,
+                             arma::Col<size_t>& assignments) const
+{
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  std::vector<size_t> candidates;
+  arma::vec minDistances(data.n_cols);
+  minDistances.fill(std::numeric_limits<double>::infinity());
+  arma::Col<size_t> closest(data.n_cols);
+
+  // The first candidate is a random point.
+  candidates.push_back((size_t) math::RandInt(data.n_cols));
+  UpdateDistances(data, candidates, 0, minDistances, closest);
+
+  const double expected = oversampling * clusters;
+  std::vector<std::vector<size_t> > threadCandidates(threads);
+  for (size_t round = 0; round < rounds; ++round)
+  {
+    const double cost = arma::accu(minDistances);
+    if (!(cost > 0.0))
+      break; // Every point is a candidate already.
+
+    // Take each point with probability expected * minDistances[i] / cost.
+    // With a static schedule each thread takes a contiguous range of points,
+    // so the candidates stay in order.
+    const uint64_t seed = (uint64_t) math::RandInt(
+        std::numeric_limits<int>::max());
+    #pragma omp parallel num_threads(threads)
+    {
+#ifdef _OPENMP
+      std::vector<size_t>& drawn = threadCandidates[omp_get_thread_num()];
+#else
+      std::vector<size_t>& drawn = threadCandidates[0];
+#endif
+      drawn.clear();
+
+      #pragma omp for schedule(static)
+      for (size_t i = 0; i < data.n_cols; ++i)
+        if (Uniform(seed, i) * cost < expected * minDistances[i])
+          drawn.push_back(i);
+    }
+
+    const size_t firstNew = candidates.size();
+    for (size_t t = 0; t < threads; ++t)
+      candidates.insert(candidates.end(), threadCandidates[t].begin(),
+          threadCandidates[t].end());
+
+    UpdateDistances(data, candidates, firstNew, minDistances, closest);
+  }
+
+  // There may be too few candidates for a small oversampling factor; then
+  // take more with the k-means++ rule.
+  while (candidates.size() < clusters)
+  {
+    candidates.push_back(KMeansPlusPlus::Sample(minDistances));
+    UpdateDistances(data, candidates, candidates.size() - 1, minDistances,
+        closest);
+  }
+
+  Log::Info << "KMeansParallel::Cluster(): " << candidates.size()
+      << " candidates after " << rounds << " rounds." << std::endl;
+
+  // Weight each candidate by the number of points it is closest to, and
+  // choose the centers among the candidates.
+  MatType candidateData(data.n_rows, candidates.size());
+  arma::vec weights(candidates.size());
+  weights.zeros();
+  for (size_t c = 0; c < candidates.size(); ++c)
+    candidateData.col(c) = data.col(candidates[c]);
+  for (size_t i = 0; i < data.n_cols; ++i)
+    ++weights[closest[i]];
+
+  arma::Col<size_t> centers;
+  arma::Col<size_t> candidateAssignments;
+  arma::vec candidateDistances;
+  KMeansPlusPlus::SelectCenters(candidateData, weights, clusters, centers,
+      candidateAssignments, candidateDistances);
+
+  // Assign each point to its closest center.
+  assignments.set_size(data.n_cols);
+  #pragma omp parallel for schedule(static) num_threads(threads)
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    double minDistance = std::numeric_limits<double>::infinity();
+    size_t closestCluster = 0;
+
+    for (size_t j = 0; j < clusters; ++j)
+    {
+      const double distance = metric::SquaredEuclideanDistance::Evaluate(
+          data.col(i), candidateData.col(centers[j]));
+
+      if (distance < minDistance)
+      {
+        minDistance = distance;
+        closestCluster = j;
+      }
+    }
+
+    assignments[i] = closestCluster;
+  }
+}
+
+template<typename MatType>
+void KMeansParallel::UpdateDistances(const MatType& data,
+                                     const std::vector<size_t>& candidates,
+                                     const size_t firstNew,
+                                     arma::vec& minDistances,
+                                     arma::Col<size_t>& closest)
+{
+  #pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    for (size_t c = firstNew; c < candidates.size(); ++c)
+    {
+      const double distance = metric::SquaredEuclideanDistance::Evaluate(
+          data.col(i), data.col(candidates[c]));
+
+      if (distance < minDistances[i])
+      {
+        minDistances[i] = distance;
+        closest[i] = c;
+      }
+    }
+  }
+}
+
+inline double KMeansParallel::Uniform(const uint64_t seed,
+                                      const uint64_t index)
+{
+  // The splitmix64 finalizer of the seed and index.
+  uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= (z >> 31);
+
+  // Use the 53 high bits as the mantissa.
+  return (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
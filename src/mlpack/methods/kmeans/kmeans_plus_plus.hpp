@@ -0,0 +1,103 @@
+/**
+ * @file kmeans_plus_plus.hpp
+ *
+ * An implementation of the k-means++ seeding of Arthur and Vassilvitskii,
+ * "k-means++: The Advantages of Careful Seeding", as an InitialPartitionPolicy
+ * for KMeans.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KMEANS_PLUS_PLUS_HPP
+#define __MLPACK_METHODS_KMEANS_KMEANS_PLUS_PLUS_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * The k-means++ initial partition.  The first center is a random point of the
+ * dataset; every following center is a point of the dataset drawn with
+ * probability proportional to its squared distance to the closest center
+ * chosen so far.  Every point is then assigned to its closest center.  The
+ * resulting clustering is O(log k)-competitive with the optimal clustering in
+ * expectation, and usually needs far fewer Lloyd iterations than a random
+ * partition.  It is an implementation of the following paper:
+ *
+ * @inproceedings{arthur2007k,
+ *   title={k-means++: The advantages of careful seeding},
+ *   author={Arthur, David and Vassilvitskii, Sergei},
+ *   booktitle={Proceedings of the Eighteenth Annual ACM-SIAM Symposium on
+ *       Discrete Algorithms (SODA 2007)},
+ *   pages={1027--1035},
+ *   year={2007}
+ * }
+ *
+ * The squared distance of each point to its closest center is kept and only
+ * updated with the newest center, so choosing k centers takes O(kN) distance
+ * calculations, which are done in parallel if OpenMP is available.  Distances
+ * are always Euclidean.
+ */
+class KMeansPlusPlus
+{
+ public:
+  //! Empty constructor, required by the InitialPartitionPolicy policy.
+  KMeansPlusPlus() { }
+
+  /**
+   * Partition the given dataset into the given number of clusters with the
+   * k-means++ seeding.
+   *
+   * @tparam MatType Type of data (arma::mat, arma::fmat or arma::sp_mat).
+   * @param data Dataset to partition.
+   * @param clusters Number of clusters to split dataset into.
+   * @param assignments Vector to store cluster assignments into.  Values will
+   *     be between 0 and (clusters - 1).
+   */
+  template<typename MatType>
+  static void Cluster(const MatType& data,
+                      const size_t clusters,
+                      arma::Col<size_t>& assignments);
+
+  /**
+   * Choose the given number of centers among the points of the given dataset
+   * with the k-means++ seeding, where each point may have a weight (the
+   * probability of drawing a point is then proportional to its weight times
+   * its squared distance to the closest center).  If every point is at
+   * distance zero of the centers chosen so far (that is, there are fewer
+   * distinct points than centers), the next center is drawn uniformly.
+   *
+   * @tparam MatType Type of data (arma::mat, arma::fmat or arma::sp_mat).
+   * @param data Dataset to choose the centers from.
+   * @param weights Weight of each point, or an empty vector for unit weights.
+   * @param clusters Number of centers to choose.
+   * @param centers Vector to store the indices of the centers into.
+   * @param assignments Vector to store the index (in centers) of the closest
+   *     center to each point into.
+   * @param minDistances Vector to store the squared distance of each point to
+   *     its closest center into.
+   */
+  template<typename MatType>
+  static void SelectCenters(const MatType& data,
+                            const arma::vec& weights,
+                            const size_t clusters,
+                            arma::Col<size_t>& centers,
+                            arma::Col<size_t>& assignments,
+                            arma::vec& minDistances);
+
+  /**
+   * Draw a random index with probability proportional to the given
+   * non-negative weights.  If all weights are zero, the index is drawn
+   * uniformly.
+   *
+   * @param weights Weight of each index.
+   * @return The index drawn.
+   */
+  static size_t Sample(const arma::vec& weights);
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+// Include implementation.
+#include "kmeans_plus_plus_impl.hpp"
+
+#endif
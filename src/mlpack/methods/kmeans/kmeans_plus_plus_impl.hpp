@@ -0,0 +1,96 @@
+/**
+ * @file kmeans_plus_plus_impl.hpp
+ *
+ * Implementation of the k-means++ seeding.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KMEANS_PLUS_PLUS_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_KMEANS_PLUS_PLUS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "kmeans_plus_plus.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+//! Partition the given dataset with the k-means++ seeding.
+template<typename MatType>
+void KMeansPlusPlus::Cluster(const MatType& data,
+                             const size_t clusters,
+                             arma::Col<size_t>& assignments)
+{
+  arma::Col<size_t> centers;
+  arma::vec minDistances;
+  SelectCenters(data, arma::vec(), clusters, centers, assignments,
+      minDistances);
+}
+
+template<typename MatType>
+void KMeansPlusPlus::SelectCenters(const MatType& data,
+                                   const arma::vec& weights,
+                                   const size_t clusters,
+                                   arma::Col<size_t>& centers,
+                                   arma::Col<size_t>& assignments,
+                                   arma::vec& minDistances)
+{
+  centers.set_size(clusters);
+  assignments.zeros(data.n_cols);
+  minDistances.set_size(data.n_cols);
+  minDistances.fill(std::numeric_limits<double>::infinity());
+
+  for (size_t c = 0; c < clusters; ++c)
+  {
+    // The first center only depends on the weights.
+    if (c == 0)
+      centers[c] = weights.is_empty() ? (size_t) math::RandInt(data.n_cols) :
+          Sample(weights);
+    else if (weights.is_empty())
+      centers[c] = Sample(minDistances);
+    else
+      centers[c] = Sample(weights % minDistances);
+
+    // Only the distances to the new center need to be calculated.
+    const size_t center = centers[c];
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < data.n_cols; ++i)
+    {
+      const double distance = metric::SquaredEuclideanDistance::Evaluate(
+          data.col(i), data.col(center));
+
+      if (distance < minDistances[i])
+      {
+        minDistances[i] = distance;
+        assignments[i] = c;
+      }
+    }
+  }
+}
+
+inline size_t KMeansPlusPlus::Sample(const arma::vec& weights)
+{
+  const double total = arma::accu(weights);
+  if (!(total > 0.0))
+    return (size_t) math::RandInt(weights.n_elem);
+
+  const double target = math::Random() * total;
+  double sum = 0.0;
+  size_t last = 0;
+  for (size_t i = 0; i < weights.n_elem; ++i)
+  {
+    if (weights[i] <= 0.0)
+      continue;
+
+    sum += weights[i];
+    if (sum > target)
+      return i;
+    last = i;
+  }
+
+  // Rounding errors may leave target just above the sum; take the last index
+  // with a nonzero weight.
+  return last;
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
@@ -11,18 +11,28 @@
 
 #include <mlpack/core.hpp>
 
+#include "centroid_distance.hpp"
+
 namespace mlpack {
 namespace kmeans {
 
 /**
  * When an empty cluster is detected, this class takes the point furthest from
  * the centroid of the cluster with maximum variance as a new cluster.
+ *
+ * The variances are found with one pass over the data, which assigns each
+ * point to its closest centroid; the assignments and the variances are then
+ * kept for the rest of the iteration of k-means, and updated as points are
+ * moved, so that each further empty cluster in the same iteration only takes
+ * time proportional to the size of the cluster with maximum variance.  KMeans
+ * calls Reset() at the start of each run, since the iterations of a new run
+ * are counted from zero again.
  */
 class MaxVarianceNewCluster
 {
  public:
   //! Default constructor required by EmptyClusterPolicy.
-  MaxVarianceNewCluster() { }
+  MaxVarianceNewCluster() : iteration(size_t(-1)) { }
 
   /**
    * Take the point furthest from the centroid of the cluster with maximum
@@ -33,16 +43,41 @@ class MaxVarianceNewCluster
    * @param emptyCluster Index of cluster which is empty.
    * @param centroids Centroids of each cluster (one per column).
    * @param clusterCounts Number of points in each cluster.
-   * @param assignments Cluster assignments of each point.
+   * @param metric Metric to use.
+   * @param iteration Number of the current iteration of k-means; the cached
+   *     variances are only reused within the same iteration.
    *
    * @return Number of points changed.
    */
   template<typename MetricType, typename MatType>
-  static size_t EmptyCluster(const MatType& data,
-                             const size_t emptyCluster,
-                             arma::mat& centroids,
-                             arma::Col<size_t>& clusterCounts,
-                             MetricType& metric);
+  size_t EmptyCluster(const MatType& data,
+                      const size_t emptyCluster,
+                      arma::mat& centroids,
+                      arma::Col<size_t>& clusterCounts,
+                      MetricType& metric,
+                      const size_t iteration);
+
+  //! Discard the cached assignments, so that they are recomputed by the next
+  //! call to EmptyCluster(), whatever its iteration.
+  void Reset() { iteration = size_t(-1); }
+
+ private:
+  /**
+   * Assign each point to its closest centroid, and sum the distances between
+   * the points of each cluster and its centroid.
+   */
+  template<typename MetricType, typename MatType>
+  void Precalculate(const MatType& data,
+                    const arma::mat& centroids,
+                    MetricType& metric);
+
+  //! The iteration the cached assignments were computed in.
+  size_t iteration;
+  //! The points of each cluster.
+  std::vector<std::vector<size_t> > members;
+  //! The sum of the distances between the points of each cluster and its
+  //! centroid.
+  arma::vec distanceSums;
 };
 
 }; // namespace kmeans
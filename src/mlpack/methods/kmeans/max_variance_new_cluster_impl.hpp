@@ -21,77 +21,73 @@ size_t MaxVarianceNewCluster::EmptyCluster(const MatType& data,
                                            const size_t emptyCluster,
                                            arma::mat& centroids,
                                            arma::Col<size_t>& clusterCounts,
-                                           MetricType& metric)
+                                           MetricType& metric,
+                                           const size_t iteration)
 {
-  // First, we need to find the cluster with maximum variance (by which I mean
-  // the sum of the covariance matrices).
-  arma::vec variances;
-  variances.zeros(clusterCounts.n_elem); // Start with 0.
-  arma::Col<size_t> assignments(data.n_cols);
-
-  // Add the variance of each point's distance away from the cluster.  I think
-  // this is the sensible thing to do.
-  for (size_t i = 0; i < data.n_cols; ++i)
+  // The assignments are only computed once per iteration.
+  if (iteration != this->iteration || members.size() != centroids.n_cols)
+    Precalculate(data, centroids, metric);
+  this->iteration = iteration;
+
+  // Now find the cluster with maximum variance (by which I mean the mean
+  // distance of its points from its centroid).  Clusters with only one point
+  // cannot give up a point.
+  size_t maxVarCluster = centroids.n_cols;
+  double maxVariance = -DBL_MAX;
+  for (size_t i = 0; i < centroids.n_cols; ++i)
   {
-    // Find the closest centroid to this point.
-    double minDistance = std::numeric_limits<double>::infinity();
-    size_t closestCluster = centroids.n_cols; // Invalid value.
+    if (clusterCounts[i] <= 1 || members[i].empty())
+      continue;
 
-    for (size_t j = 0; j < centroids.n_cols; j++)
+    const double variance = distanceSums[i] / clusterCounts[i];
+    if (variance > maxVariance)
     {
-      const double distance = metric.Evaluate(data.col(i), centroids.col(j));
-
-      if (distance < minDistance)
-      {
-        minDistance = distance;
-        closestCluster = j;
-      }
+      maxVariance = variance;
+      maxVarCluster = i;
     }
-
-    assignments[i] = closestCluster;
-    variances[closestCluster] += metric.Evaluate(data.col(i),
-        centroids.col(closestCluster));
   }
 
-  // Divide by the number of points in the cluster to produce the variance.
-  // Although a -nan will occur here for the empty cluster(s), this doesn't
-  // matter because variances.max() won't pick it up.  If the number of points
-  // in the cluster is 1, we ensure that cluster is not selected by forcing the
-  // variance to 0.
-  for (size_t i = 0; i < clusterCounts.n_elem; ++i)
-    variances[i] /= (clusterCounts[i] == 1) ? DBL_MAX : clusterCounts[i];
-
-  // Now find the cluster with maximum variance.
-  arma::uword maxVarCluster;
-  variances.max(maxVarCluster);
+  if (maxVarCluster == centroids.n_cols)
+  {
+    Log::Debug << "No cluster can give a point to empty cluster "
+        << emptyCluster << ".\n";
+    return 0;
+  }
 
   // Now, inside this cluster, find the point which is furthest away.
-  size_t furthestPoint = data.n_cols;
+  std::vector<size_t>& points = members[maxVarCluster];
+  size_t furthestIndex = 0;
   double maxDistance = -DBL_MAX;
-  for (size_t i = 0; i < data.n_cols; ++i)
+  for (size_t i = 0; i < points.size(); ++i)
   {
-    if (assignments[i] == maxVarCluster)
-    {
-      const double distance = metric.Evaluate(data.col(i),
-          centroids.col(maxVarCluster));
+    const double distance = metric.Evaluate(data.col(points[i]),
+        centroids.col(maxVarCluster));
 
-      if (distance > maxDistance)
-      {
-        maxDistance = distance;
-        furthestPoint = i;
-      }
+    if (distance > maxDistance)
+    {
+      maxDistance = distance;
+      furthestIndex = i;
     }
   }
+  const size_t furthestPoint = points[furthestIndex];
 
   // Take that point and add it to the empty cluster.
   centroids.col(maxVarCluster) *= (double(clusterCounts[maxVarCluster]) /
       double(clusterCounts[maxVarCluster] - 1));
   centroids.col(maxVarCluster) -= (1.0 / (clusterCounts[maxVarCluster] - 1.0)) *
-      arma::vec(data.col(furthestPoint));
+      PointVector(data, furthestPoint);
   clusterCounts[maxVarCluster]--;
   clusterCounts[emptyCluster]++;
-  centroids.col(emptyCluster) = arma::vec(data.col(furthestPoint));
-  assignments[furthestPoint] = emptyCluster;
+  centroids.col(emptyCluster) = PointVector(data, furthestPoint);
+
+  // Update the cached assignments and variances.  The distances of the other
+  // points to the moved centroid are not recomputed.
+  points[furthestIndex] = points.back();
+  points.pop_back();
+  distanceSums[maxVarCluster] = std::max(distanceSums[maxVarCluster] -
+      maxDistance, 0.0);
+  members[emptyCluster].assign(1, furthestPoint);
+  distanceSums[emptyCluster] = 0.0;
 
   // Output some debugging information.
   Log::Debug << "Point " << furthestPoint << " assigned to empty cluster " <<
@@ -100,6 +96,43 @@ size_t MaxVarianceNewCluster::EmptyCluster(const MatType& data,
   return 1; // We only changed one point.
 }
 
+template<typename MetricType, typename MatType>
+void MaxVarianceNewCluster::Precalculate(const MatType& data,
+                                         const arma::mat& centroids,
+                                         MetricType& metric)
+{
+  members.assign(centroids.n_cols, std::vector<size_t>());
+  distanceSums.zeros(centroids.n_cols);
+
+  // Add the distance of each point away from its closest centroid.
+  CentroidDistance<MetricType, MatType> distances(data, metric);
+  distances.Centroids(centroids);
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    // Find the closest centroid to this point.
+    double minDistance = std::numeric_limits<double>::infinity();
+    size_t closestCluster = centroids.n_cols; // Invalid value.
+
+    for (size_t j = 0; j < centroids.n_cols; j++)
+    {
+      const double distance = distances.Evaluate(i, j);
+
+      if (distance < minDistance)
+      {
+        minDistance = distance;
+        closestCluster = j;
+      }
+    }
+
+    // Points which are infinitely far from every centroid are not counted.
+    if (closestCluster == centroids.n_cols)
+      continue;
+
+    members[closestCluster].push_back(i);
+    distanceSums[closestCluster] += minDistance;
+  }
+}
+
 }; // namespace kmeans
 }; // namespace mlpack
 
@@ -0,0 +1,154 @@
+/**
+ * @file mini_batch_kmeans.hpp
+ *
+ * An implementation of mini-batch k-means (Sculley, "Web-scale k-means
+ * clustering", 2010), as a step type for KMeans and for clustering datasets
+ * that are read in blocks with data::StreamingReader.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_MINI_BATCH_KMEANS_HPP
+#define __MLPACK_METHODS_KMEANS_MINI_BATCH_KMEANS_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * An implementation of mini-batch k-means.  Instead of assigning every point
+ * at every iteration, each iteration draws a small random batch of points,
+ * assigns each point of the batch to its closest centroid, and moves that
+ * centroid towards the point with a per-centroid learning rate of 1 / (the
+ * number of points assigned to the centroid so far).  Each iteration therefore
+ * costs O(k * BatchSize()) instead of O(kN), and a usable clustering is
+ * usually found after a small fraction of the work of full Lloyd iterations
+ * (although the result is an approximation).
+ *
+ * This class can be used as the LloydStepType of KMeans; then each iteration
+ * of KMeans processes one batch, so the maximum number of iterations should be
+ * set accordingly.  The counts returned by Iterate() are the total number of
+ * points assigned to each centroid so far, so a cluster is only considered
+ * empty if no point was ever assigned to it.
+ *
+ * For datasets that do not fit in memory, see MiniBatchCluster(), which uses
+ * the blocks read by a data::StreamingReader as batches.
+ *
+ * @tparam MetricType Type of metric used with this implementation.
+ * @tparam MatType Matrix type (arma::mat or arma::sp_mat).
+ */
+template<typename MetricType, typename MatType>
+class MiniBatchKMeans
+{
+ public:
+  //! The default number of points in a batch.
+  static const size_t DefaultBatchSize = 1000;
+
+  /**
+   * Construct the MiniBatchKMeans object with the given dataset and metric.
+   *
+   * @param dataset Dataset.
+   * @param metric Instantiated metric.
+   * @param batchSize Number of points in each batch.
+   */
+  MiniBatchKMeans(const MatType& dataset,
+                  MetricType& metric,
+                  const size_t batchSize = DefaultBatchSize);
+
+  /**
+   * Draw a random batch of points (with replacement) and use it to update the
+   * given centroids into the newCentroids matrix.
+   *
+   * @param centroids Current cluster centroids.
+   * @param newCentroids New cluster centroids.
+   * @param counts Set to the number of points assigned to each cluster so far.
+   * @return The distance the centroids moved, as for NaiveKMeans.
+   */
+  double Iterate(const arma::mat& centroids,
+                 arma::mat& newCentroids,
+                 arma::Col<size_t>& counts);
+
+  /**
+   * Update the given centroids into the newCentroids matrix with the given
+   * batch of points: the columns of data with the given indices.
+   *
+   * @param data Matrix holding the points of the batch.
+   * @param batch Indices of the points of the batch in data.
+   * @param centroids Current cluster centroids.
+   * @param newCentroids New cluster centroids.
+   * @param counts Set to the number of points assigned to each cluster so far.
+   * @return The distance the centroids moved.
+   */
+  template<typename BatchMatType>
+  double Update(const BatchMatType& data,
+                const arma::Col<size_t>& batch,
+                const arma::mat& centroids,
+                arma::mat& newCentroids,
+                arma::Col<size_t>& counts);
+
+  //! Get the number of distance calculations.
+  size_t DistanceCalculations() const { return distanceCalculations; }
+
+  //! Get the number of points in each batch.
+  size_t BatchSize() const { return batchSize; }
+  //! Modify the number of points in each batch.
+  size_t& BatchSize() { return batchSize; }
+
+ private:
+  //! The dataset.
+  const MatType& dataset;
+  //! The instantiated metric.
+  MetricType& metric;
+  //! The number of points in each batch.
+  size_t batchSize;
+
+  //! The number of points assigned to each cluster so far.
+  arma::Col<size_t> clusterCounts;
+
+  //! Number of distance calculations.
+  size_t distanceCalculations;
+};
+
+/**
+ * Cluster the dataset read by the given reader with mini-batch k-means, using
+ * each block read as a batch.  The blocks are taken in the order of the file,
+ * so the points of the file should be in random order.  If initialGuess is
+ * false, the initial centroids are distinct random points of the first block
+ * (which must then have at least as many points as there are clusters).
+ *
+ * @param reader Reader for the dataset; it is reset before each pass.
+ * @param clusters Number of clusters to compute.
+ * @param centroids Matrix in which centroids are stored.
+ * @param passes Number of passes over the dataset.
+ * @param initialGuess If true, then it is assumed that centroids contains the
+ *     initial cluster centroids.
+ * @param metric Instantiated metric.
+ */
+template<typename MetricType>
+void MiniBatchCluster(data::StreamingReader& reader,
+                      const size_t clusters,
+                      arma::mat& centroids,
+                      const size_t passes,
+                      const bool initialGuess,
+                      MetricType& metric);
+
+/**
+ * Assign every point of the dataset read by the given reader to its closest
+ * centroid, with one more pass over the dataset.
+ *
+ * @param reader Reader for the dataset; it is reset first.
+ * @param centroids Cluster centroids.
+ * @param assignments Vector to store cluster assignments in.
+ * @param metric Instantiated metric.
+ */
+template<typename MetricType>
+void MiniBatchAssign(data::StreamingReader& reader,
+                     const arma::mat& centroids,
+                     arma::Col<size_t>& assignments,
+                     MetricType& metric);
+
+} // namespace kmeans
+} // namespace mlpack
+
+// Include implementation.
+#include "mini_batch_kmeans_impl.hpp"
+
+#endif
@@ -0,0 +1,223 @@
+/**
+ * @file mini_batch_kmeans_impl.hpp
+ *
+ * Implementation of mini-batch k-means.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_MINI_BATCH_KMEANS_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_MINI_BATCH_KMEANS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "mini_batch_kmeans.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MetricType, typename MatType>
+MiniBatchKMeans<MetricType, MatType>::MiniBatchKMeans(const MatType& dataset,
+                                                      MetricType& metric,
+                                                      const size_t batchSize) :
+    dataset(dataset),
+    metric(metric),
+    batchSize(batchSize),
+    distanceCalculations(0)
+{ /* Nothing to do. */ }
+
+template<typename MetricType, typename MatType>
+double MiniBatchKMeans<MetricType, MatType>::Iterate(
+    const arma::mat& centroids,
+    arma::mat& newCentroids,
+    arma::Col<size_t>& counts)
+{
+  // Draw the batch.
+  arma::Col<size_t> batch(std::min(batchSize, (size_t) dataset.n_cols));
+  for (size_t i = 0; i < batch.n_elem; ++i)
+    batch[i] = math::RandInt((int) dataset.n_cols);
+
+  return Update(dataset, batch, centroids, newCentroids, counts);
+}
+
+template<typename MetricType, typename MatType>
+template<typename BatchMatType>
+double MiniBatchKMeans<MetricType, MatType>::Update(
+    const BatchMatType& data,
+    const arma::Col<size_t>& batch,
+    const arma::mat& centroids,
+    arma::mat& newCentroids,
+    arma::Col<size_t>& counts)
+{
+  if (clusterCounts.n_elem != centroids.n_cols)
+    clusterCounts.zeros(centroids.n_cols);
+
+  // Find the closest centroid to each point of the batch.
+  arma::Col<size_t> assignments(batch.n_elem);
+  #pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < batch.n_elem; ++i)
+  {
+    double minDistance = std::numeric_limits<double>::infinity();
+    size_t closestCluster = 0;
+
+    for (size_t j = 0; j < centroids.n_cols; ++j)
+    {
+      const double distance = metric.Evaluate(data.col(batch[i]),
+          centroids.col(j));
+
+      if (distance < minDistance)
+      {
+        minDistance = distance;
+        closestCluster = j;
+      }
+    }
+
+    assignments[i] = closestCluster;
+  }
+
+  // Now move each centroid towards the points assigned to it, with a learning
+  // rate that decreases as more points are assigned to it.
+  newCentroids = centroids;
+  for (size_t i = 0; i < batch.n_elem; ++i)
+  {
+    const size_t cluster = assignments[i];
+    clusterCounts[cluster]++;
+
+    const double eta = 1.0 / clusterCounts[cluster];
+    newCentroids.col(cluster) += eta * (arma::vec(data.col(batch[i])) -
+        newCentroids.col(cluster));
+  }
+
+  counts = clusterCounts;
+  distanceCalculations += centroids.n_cols * batch.n_elem;
+
+  // Calculate how far the centroids moved.
+  double cNorm = 0.0;
+  for (size_t i = 0; i < centroids.n_cols; ++i)
+  {
+    cNorm += std::pow(metric.Evaluate(centroids.col(i), newCentroids.col(i)),
+        2.0);
+  }
+  distanceCalculations += centroids.n_cols;
+
+  return std::sqrt(cNorm);
+}
+
+template<typename MetricType>
+void MiniBatchCluster(data::StreamingReader& reader,
+                      const size_t clusters,
+                      arma::mat& centroids,
+                      const size_t passes,
+                      const bool initialGuess,
+                      MetricType& metric)
+{
+  // The step only uses its dataset in Iterate(), which we do not call.
+  const arma::mat noDataset;
+  MiniBatchKMeans<MetricType, arma::mat> step(noDataset, metric,
+      reader.BlockSize());
+
+  arma::mat block;
+  arma::mat newCentroids;
+  arma::Col<size_t> counts;
+  arma::Col<size_t> batch;
+
+  if (initialGuess)
+  {
+    if (centroids.n_cols != clusters)
+      Log::Fatal << "MiniBatchCluster(): wrong number of initial cluster "
+          << "centroids (" << centroids.n_cols << ", should be " << clusters
+          << ")!" << std::endl;
+
+    if (centroids.n_rows != reader.Dimensionality())
+      Log::Fatal << "MiniBatchCluster(): initial cluster centroids have wrong "
+          << "dimensionality (" << centroids.n_rows << ", should be "
+          << reader.Dimensionality() << ")!" << std::endl;
+  }
+
+  for (size_t pass = 0; pass < passes; ++pass)
+  {
+    reader.Reset();
+    size_t batches = 0;
+    double cNorm = 0.0;
+    while (reader.NextBlock(block))
+    {
+      if (!initialGuess && pass == 0 && batches == 0)
+      {
+        // Take distinct random points of the first block as the initial
+        // centroids.
+        if (block.n_cols < clusters)
+          Log::Fatal << "MiniBatchCluster(): the first block has fewer points "
+              << "(" << block.n_cols << ") than clusters (" << clusters
+              << ")!" << std::endl;
+
+        arma::Col<size_t> order(block.n_cols);
+        for (size_t i = 0; i < order.n_elem; ++i)
+          order[i] = i;
+        centroids.set_size(block.n_rows, clusters);
+        for (size_t i = 0; i < clusters; ++i)
+        {
+          const size_t chosen = i + math::RandInt((int) (block.n_cols - i));
+          std::swap(order[i], order[chosen]);
+          centroids.col(i) = block.col(order[i]);
+        }
+      }
+
+      batch.set_size(block.n_cols);
+      for (size_t i = 0; i < batch.n_elem; ++i)
+        batch[i] = i;
+
+      cNorm = step.Update(block, batch, centroids, newCentroids, counts);
+      centroids.steal_mem(newCentroids);
+      ++batches;
+    }
+
+    Log::Info << "MiniBatchCluster(): pass " << (pass + 1) << ", " << batches
+        << " batches, residual of last batch " << cNorm << ".\n";
+  }
+
+  Log::Info << step.DistanceCalculations() << " distance calculations."
+      << std::endl;
+}
+
+template<typename MetricType>
+void MiniBatchAssign(data::StreamingReader& reader,
+                     const arma::mat& centroids,
+                     arma::Col<size_t>& assignments,
+                     MetricType& metric)
+{
+  std::vector<size_t> allAssignments;
+  arma::mat block;
+
+  reader.Reset();
+  while (reader.NextBlock(block))
+  {
+    const size_t offset = allAssignments.size();
+    allAssignments.resize(offset + block.n_cols);
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < block.n_cols; ++i)
+    {
+      double minDistance = std::numeric_limits<double>::infinity();
+      size_t closestCluster = 0;
+
+      for (size_t j = 0; j < centroids.n_cols; ++j)
+      {
+        const double distance = metric.Evaluate(block.col(i),
+            centroids.col(j));
+
+        if (distance < minDistance)
+        {
+          minDistance = distance;
+          closestCluster = j;
+        }
+      }
+
+      allAssignments[offset + i] = closestCluster;
+    }
+  }
+
+  assignments.set_size(allAssignments.size());
+  for (size_t i = 0; i < allAssignments.size(); ++i)
+    assignments[i] = allAssignments[i];
+}
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
@@ -9,6 +9,8 @@
 #ifndef __MLPACK_METHODS_KMEANS_NAIVE_KMEANS_HPP
 #define __MLPACK_METHODS_KMEANS_NAIVE_KMEANS_HPP
 
+#include "centroid_distance.hpp"
+
 namespace mlpack {
 namespace kmeans {
 
@@ -18,8 +20,16 @@ namespace kmeans {
  * looking for the mlpack::kmeans::KMeans class instead of this one.  This class
  * is used by KMeans as the actual implementation of the Lloyd iteration.
  *
+ * The points are split into blocks, which are assigned to their closest
+ * centroids in parallel if OpenMP is available; each thread accumulates the
+ * new centroids of its own points, and the accumulators are summed at the end.
+ * For the Euclidean and squared Euclidean distances on dense data, the
+ * distances of a block of points to all the centroids are computed with one
+ * matrix multiplication instead of one call to MetricType::Evaluate() per
+ * pair.
+ *
  * @param MetricType Type of metric used with this implementation.
- * @param MatType Matrix type (arma::mat or arma::sp_mat).
+ * @param MatType Matrix type (arma::mat, arma::fmat or arma::sp_mat).
  */
 template<typename MetricType, typename MatType>
 class NaiveKMeans
@@ -46,6 +56,10 @@ class NaiveKMeans
 
   size_t DistanceCalculations() const { return distanceCalculations; }
 
+  //! The number of points assigned to their centroids at once (by one
+  //! thread, if OpenMP is available).
+  static const size_t PointBlockSize = 1024;
+
  private:
   //! The dataset.
   const MatType& dataset;
@@ -23,17 +23,21 @@ NaiveKMeans<MetricType, MatType>::NaiveKMeans(const MatType& dataset,
     distanceCalculations(0)
 { /* Nothing to do. */ }
 
-// Run a single iteration.
+/**
+ * Find the closest centroid (according to the metric) to each of the points
+ * dataset.cols(begin, end - 1), storing the index of the centroid in
+ * assignments.
+ */
 template<typename MetricType, typename MatType>
-double NaiveKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
-                                                 arma::mat& newCentroids,
-                                                 arma::Col<size_t>& counts)
+void NaiveAssign(const MatType& dataset,
+                 const size_t begin,
+                 const size_t end,
+                 const arma::mat& centroids,
+                 const arma::rowvec& /* centroidNorms */,
+                 MetricType& metric,
+                 arma::Col<size_t>& assignments)
 {
-  newCentroids.zeros(centroids.n_rows, centroids.n_cols);
-  counts.zeros(centroids.n_cols);
-
-  // Find the closest centroid to each point and update the new centroids.
-  for (size_t i = 0; i < dataset.n_cols; i++)
+  for (size_t i = begin; i < end; i++)
   {
     // Find the closest centroid to this point.
     double minDistance = std::numeric_limits<double>::infinity();
@@ -50,11 +54,196 @@ double NaiveKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
       }
     }
 
-    Log::Assert(closestCluster != centroids.n_cols);
+    assignments[i - begin] = closestCluster;
+  }
+}
+
+/**
+ * Find the closest centroid to each of the points dataset.cols(begin, end -
+ * 1) for the (squared) Euclidean distance on dense data.  Because
+ * ||x - c||^2 = ||x||^2 + ||c||^2 - 2 x^T c, the closest centroid is the one
+ * that minimizes ||c||^2 - 2 x^T c, so every dot product can be computed by a
+ * single matrix multiplication.
+ */
+template<bool TakeRoot>
+void NaiveAssign(const arma::mat& dataset,
+                 const size_t begin,
+                 const size_t end,
+                 const arma::mat& centroids,
+                 const arma::rowvec& centroidNorms,
+                 metric::LMetric<2, TakeRoot>& /* metric */,
+                 arma::Col<size_t>& assignments)
+{
+  const arma::mat products = trans(dataset.cols(begin, end - 1)) * centroids;
+
+  for (size_t i = 0; i < products.n_rows; i++)
+  {
+    double minDistance = std::numeric_limits<double>::infinity();
+    size_t closestCluster = centroids.n_cols; // Invalid value.
+
+    for (size_t j = 0; j < centroids.n_cols; j++)
+    {
+      const double distance = centroidNorms[j] - 2 * products(i, j);
+
+      if (distance < minDistance)
+      {
+        minDistance = distance;
+        closestCluster = j;
+      }
+    }
+
+    assignments[i] = closestCluster;
+  }
+}
+
+/**
+ * Find the closest centroid to each of the points dataset.cols(begin, end -
+ * 1) for the (squared) Euclidean distance on dense single-precision data.  As
+ * for double precision, the dot products are one matrix multiplication, done
+ * in single precision with a single-precision copy of the centroids.
+ */
+template<bool TakeRoot>
+void NaiveAssign(const arma::fmat& dataset,
+                 const size_t begin,
+                 const size_t end,
+                 const arma::mat& centroids,
+                 const arma::rowvec& centroidNorms,
+                 metric::LMetric<2, TakeRoot>& /* metric */,
+                 arma::Col<size_t>& assignments)
+{
+  const arma::fmat products = trans(dataset.cols(begin, end - 1)) *
+      arma::conv_to<arma::fmat>::from(centroids);
+
+  for (size_t i = 0; i < products.n_rows; i++)
+  {
+    double minDistance = std::numeric_limits<double>::infinity();
+    size_t closestCluster = centroids.n_cols; // Invalid value.
+
+    for (size_t j = 0; j < centroids.n_cols; j++)
+    {
+      const double distance = centroidNorms[j] - 2 * products(i, j);
 
-    // We now have the minimum distance centroid index.  Update that centroid.
-    newCentroids.col(closestCluster) += arma::vec(dataset.col(i));
-    counts(closestCluster)++;
+      if (distance < minDistance)
+      {
+        minDistance = distance;
+        closestCluster = j;
+      }
+    }
+
+    assignments[i] = closestCluster;
+  }
+}
+
+/**
+ * Find the closest centroid to each of the points dataset.cols(begin, end -
+ * 1) for the (squared) Euclidean distance on sparse data.  As for dense data,
+ * the closest centroid minimizes ||c||^2 - 2 x^T c, and each dot product only
+ * takes time linear in the number of nonzero elements of the point.
+ */
+template<bool TakeRoot>
+void NaiveAssign(const arma::sp_mat& dataset,
+                 const size_t begin,
+                 const size_t end,
+                 const arma::mat& centroids,
+                 const arma::rowvec& centroidNorms,
+                 metric::LMetric<2, TakeRoot>& /* metric */,
+                 arma::Col<size_t>& assignments)
+{
+  for (size_t i = begin; i < end; i++)
+  {
+    double minDistance = std::numeric_limits<double>::infinity();
+    size_t closestCluster = centroids.n_cols; // Invalid value.
+
+    for (size_t j = 0; j < centroids.n_cols; j++)
+    {
+      const double distance = centroidNorms[j] - 2 * SparseDot(dataset, i,
+          centroids, j);
+
+      if (distance < minDistance)
+      {
+        minDistance = distance;
+        closestCluster = j;
+      }
+    }
+
+    assignments[i - begin] = closestCluster;
+  }
+}
+
+// Run a single iteration.
+template<typename MetricType, typename MatType>
+double NaiveKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
+                                                 arma::mat& newCentroids,
+                                                 arma::Col<size_t>& counts)
+{
+  newCentroids.zeros(centroids.n_rows, centroids.n_cols);
+  counts.zeros(centroids.n_cols);
+
+  // This is only used for the Euclidean distance.
+  const arma::rowvec centroidNorms = sum(square(centroids), 0);
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  // Each thread sums the points assigned to each cluster into its own
+  // accumulators, which are added together afterwards.
+  std::vector<arma::mat> threadCentroids(threads,
+      arma::zeros<arma::mat>(centroids.n_rows, centroids.n_cols));
+  std::vector<arma::Col<size_t> > threadCounts(threads,
+      arma::zeros<arma::Col<size_t> >(centroids.n_cols));
+  size_t unassigned = 0;
+
+  const size_t numBlocks = (dataset.n_cols + PointBlockSize - 1) /
+      PointBlockSize;
+
+  // Find the closest centroid to each point and update the new centroids.
+  #pragma omp parallel num_threads(threads) reduction(+:unassigned)
+  {
+#ifdef _OPENMP
+    const size_t thread = omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+    arma::mat& localCentroids = threadCentroids[thread];
+    arma::Col<size_t>& localCounts = threadCounts[thread];
+    arma::Col<size_t> assignments(PointBlockSize);
+
+    #pragma omp for schedule(static)
+    for (size_t block = 0; block < numBlocks; block++)
+    {
+      const size_t begin = block * PointBlockSize;
+      const size_t end = std::min(begin + PointBlockSize,
+          (size_t) dataset.n_cols);
+
+      NaiveAssign(dataset, begin, end, centroids, centroidNorms, metric,
+          assignments);
+
+      // We now have the minimum distance centroid indices.  Update those
+      // centroids.
+      for (size_t i = begin; i < end; i++)
+      {
+        const size_t closestCluster = assignments[i - begin];
+        if (closestCluster == centroids.n_cols)
+        {
+          ++unassigned;
+          continue;
+        }
+
+        AddPoint(dataset, i, localCentroids, closestCluster);
+        localCounts(closestCluster)++;
+      }
+    }
+  }
+
+  Log::Assert(unassigned == 0);
+
+  for (size_t t = 0; t < threads; ++t)
+  {
+    newCentroids += threadCentroids[t];
+    counts += threadCounts[t];
   }
 
   // Now normalize the centroid.
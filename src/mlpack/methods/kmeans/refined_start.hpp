@@ -45,7 +45,7 @@ class RefinedStart
    * Partition the given dataset into the given number of clusters according to
    * the random sampling scheme outlined in Bradley and Fayyad's paper.
    *
-   * @tparam MatType Type of data (arma::mat or arma::sp_mat).
+   * @tparam MatType Type of data (arma::mat, arma::fmat or arma::sp_mat).
    * @param data Dataset to partition.
    * @param clusters Number of clusters to split dataset into.
    * @param assignments Vector to store cluster assignments into.  Values will
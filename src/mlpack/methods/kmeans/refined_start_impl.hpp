@@ -33,7 +33,9 @@ void RefinedStart::Cluster(const MatType& data,
   // We will use these objects repeatedly for clustering.
   arma::Col<size_t> sampledAssignments;
   arma::mat centroids;
-  KMeans<> kmeans;
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      NaiveKMeans, MatType> kmeans;
+  KMeans<> centroidKMeans;
 
   for (size_t i = 0; i < samplings; ++i)
   {
@@ -66,7 +68,8 @@ void RefinedStart::Cluster(const MatType& data,
   }
 
   // Now, we run k-means on the sampled centroids to get our final clusters.
-  kmeans.Cluster(sampledCentroids, clusters, sampledAssignments, centroids);
+  centroidKMeans.Cluster(sampledCentroids, clusters, sampledAssignments,
+      centroids);
 
   // Turn the final centroids into assignments.
   assignments.set_size(data.n_cols);
@@ -0,0 +1,175 @@
+/**
+ * @file sharded_kmeans.hpp
+ *
+ * Distributed k-means clustering, where each process holds a shard of the
+ * dataset and the processes sum their cluster statistics in each iteration.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_SHARDED_KMEANS_HPP
+#define __MLPACK_METHODS_KMEANS_SHARDED_KMEANS_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/util/communicator.hpp>
+#include <mlpack/core/metrics/lmetric.hpp>
+
+#include "random_partition.hpp"
+#include "naive_kmeans.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * Distributed k-means clustering, for datasets which do not fit on one
+ * machine.  Each process (rank) of the computation holds a shard of the
+ * dataset and creates a ShardedKMeans object with a communicator (see
+ * util::LocalCommunicator for the interface; util::FileCommunicator works
+ * through a shared directory).  Then all of the processes call Cluster() on
+ * their shards at the same time.
+ *
+ * In each iteration, each process runs one step of the Lloyd step type on its
+ * shard (in parallel, with OpenMP, for the step types which support it), and
+ * the per-cluster sums and counts of the points of all of the shards are summed
+ * with one AllReduce().  The new centroids are the summed means, so every
+ * process has the same centroids, and they are the centroids KMeans would
+ * compute on the whole dataset (up to rounding).  The convergence test (the
+ * movement of the centroids) is done on these global centroids, so all of the
+ * processes stop after the same iteration.
+ *
+ * Empty clusters are handled like MaxVarianceNewCluster does, across all of
+ * the shards: the distances of the points of each shard to their closest
+ * centroids are summed over the shards to find the cluster with maximum
+ * variance, each shard proposes its point of that cluster which is furthest
+ * from the centroid, and the furthest of those becomes the new cluster.  If
+ * empty clusters are allowed, an empty cluster keeps its last centroid.
+ *
+ * The Lloyd step object of each shard is kept for all of the iterations, so
+ * HamerlyKMeans keeps its bounds between iterations (it updates them for
+ * whatever centroids it is given, so the global centroids are fine).  Step
+ * types which assume that they are given the centroids they computed
+ * themselves (ElkanKMeans, and the tree-based steps) can't be used.
+ *
+ * @code
+ * // On each process, with its own shard of the data:
+ * util::FileCommunicator communicator("/shared/kmeans", rank, size, jobId);
+ * ShardedKMeans<util::FileCommunicator> kmeans(communicator);
+ * arma::mat centroids;
+ * kmeans.Cluster(shard, 100, centroids);
+ * @endcode
+ *
+ * @tparam CommunicatorType Communicator which sums matrices across the
+ *     processes; see util::LocalCommunicator.
+ * @tparam MetricType The distance metric to use.
+ * @tparam InitialPartitionPolicy Initial partitioning policy, as for KMeans; it
+ *     is run on the shard of the first process only.
+ * @tparam LloydStepType Implementation of a single Lloyd step to run on each
+ *     shard (NaiveKMeans or HamerlyKMeans).
+ * @tparam MatType Type of the shards (arma::mat, arma::fmat or
+ *     arma::sp_mat).
+ */
+template<typename CommunicatorType,
+         typename MetricType = metric::EuclideanDistance,
+         typename InitialPartitionPolicy = RandomPartition,
+         template<class, class> class LloydStepType = NaiveKMeans,
+         typename MatType = arma::mat>
+class ShardedKMeans
+{
+ public:
+  /**
+   * Create the ShardedKMeans object of one process.
+   *
+   * @param communicator Communicator of this process.
+   * @param maxIterations Maximum number of iterations (0 means no limit).
+   * @param allowEmptyClusters If true, empty clusters keep their last
+   *     centroid, instead of taking a point from the cluster with maximum
+   *     variance.
+   * @param metric Optional MetricType object.
+   * @param partitioner Optional InitialPartitionPolicy object.
+   */
+  ShardedKMeans(CommunicatorType& communicator,
+                const size_t maxIterations = 1000,
+                const bool allowEmptyClusters = false,
+                const MetricType metric = MetricType(),
+                const InitialPartitionPolicy partitioner =
+                    InitialPartitionPolicy());
+
+  /**
+   * Cluster the shard of this process together with the shards of the other
+   * processes, and return the centroids (the same on every process).  If
+   * initialGuess is false, the initial partitioning policy is run on the shard
+   * of the first process, and the centroids of its partition are sent to the
+   * others.  If initialGuess is true, every process must give the same
+   * centroids.
+   *
+   * @param shard Shard of the dataset held by this process.
+   * @param clusters Number of clusters.
+   * @param centroids Matrix to store the centroids in (and the initial
+   *     centroids, if initialGuess is true).
+   * @param initialGuess Whether to start from the given centroids.
+   */
+  void Cluster(const MatType& shard,
+               const size_t clusters,
+               arma::mat& centroids,
+               const bool initialGuess = false);
+
+  /**
+   * Cluster the shard of this process together with the shards of the other
+   * processes, and return the centroids (the same on every process) and the
+   * assignments of the points of this shard.
+   *
+   * @param shard Shard of the dataset held by this process.
+   * @param clusters Number of clusters.
+   * @param assignments Vector to store the cluster of each point of the shard
+   *     in.
+   * @param centroids Matrix to store the centroids in (and the initial
+   *     centroids, if initialGuess is true).
+   * @param initialGuess Whether to start from the given centroids.
+   */
+  void Cluster(const MatType& shard,
+               const size_t clusters,
+               arma::Col<size_t>& assignments,
+               arma::mat& centroids,
+               const bool initialGuess = false);
+
+  //! Get the maximum number of iterations.
+  size_t MaxIterations() const { return maxIterations; }
+  //! Modify the maximum number of iterations.
+  size_t& MaxIterations() { return maxIterations; }
+
+  //! Get whether empty clusters are allowed.
+  bool AllowEmptyClusters() const { return allowEmptyClusters; }
+  //! Modify whether empty clusters are allowed.
+  bool& AllowEmptyClusters() { return allowEmptyClusters; }
+
+  //! Get the number of iterations of the last call to Cluster().
+  size_t Iterations() const { return iterations; }
+
+ private:
+  /**
+   * Fill the given empty clusters with the points furthest from the centroid
+   * of the cluster with maximum variance, across all of the shards.  The
+   * centroids and counts are changed the same way on every process.
+   */
+  void FillEmptyClusters(const MatType& shard,
+                         arma::mat& centroids,
+                         arma::vec& counts);
+
+  //! The communicator.
+  CommunicatorType& communicator;
+  //! The maximum number of iterations.
+  size_t maxIterations;
+  //! Whether empty clusters are allowed.
+  bool allowEmptyClusters;
+  //! The distance metric.
+  MetricType metric;
+  //! The initial partitioning policy.
+  InitialPartitionPolicy partitioner;
+  //! The number of iterations of the last call to Cluster().
+  size_t iterations;
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+// Include implementation.
+#include "sharded_kmeans_impl.hpp"
+
+#endif
@@ -0,0 +1,367 @@
+/**
+ * @file sharded_kmeans_impl.hpp
+ *
+ * Implementation of the ShardedKMeans class.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_SHARDED_KMEANS_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_SHARDED_KMEANS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "sharded_kmeans.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename CommunicatorType,
+         typename MetricType,
+         typename InitialPartitionPolicy,
+         template<class, class> class LloydStepType,
+         typename MatType>
+ShardedKMeans<
+    CommunicatorType,
+    MetricType,
+    InitialPartitionPolicy,
+    LloydStepType,
+    MatType>::
+ShardedKMeans(CommunicatorType& communicator,
+              const size_t maxIterations,
+              const bool allowEmptyClusters,
+              const MetricType metric,
+              const InitialPartitionPolicy partitioner) :
+    communicator(communicator),
+    maxIterations(maxIterations),
+    allowEmptyClusters(allowEmptyClusters),
+    metric(metric),
+    partitioner(partitioner),
+    iterations(0)
+{
+  // Nothing to do.
+}
+
+template<typename CommunicatorType,
+         typename MetricType,
+         typename InitialPartitionPolicy,
+         template<class, class> class LloydStepType,
+         typename MatType>
+void ShardedKMeans<
+    CommunicatorType,
+    MetricType,
+    InitialPartitionPolicy,
+    LloydStepType,
+    MatType>::
+Cluster(const MatType& shard,
+        const size_t clusters,
+        arma::mat& centroids,
+        const bool initialGuess)
+{
+  const size_t dims = shard.n_rows;
+
+  if (initialGuess)
+  {
+    if (centroids.n_cols != clusters || centroids.n_rows != dims)
+      Log::Fatal << "ShardedKMeans::Cluster(): the initial centroids are "
+          << centroids.n_rows << "x" << centroids.n_cols << ", but should be "
+          << dims << "x" << clusters << "!" << std::endl;
+  }
+  else
+  {
+    // The first process partitions its shard, and the others add nothing to
+    // the centroids of that partition.
+    centroids.zeros(dims, clusters);
+    if (communicator.Rank() == 0)
+    {
+      arma::Col<size_t> assignments;
+      partitioner.Cluster(shard, clusters, assignments);
+
+      arma::Col<size_t> counts;
+      counts.zeros(clusters);
+      for (size_t i = 0; i < shard.n_cols; ++i)
+      {
+        AddPoint(shard, i, centroids, assignments[i]);
+        counts[assignments[i]]++;
+      }
+
+      for (size_t i = 0; i < clusters; ++i)
+        if (counts[i] != 0)
+          centroids.col(i) /= counts[i];
+    }
+
+    communicator.AllReduce(centroids);
+  }
+
+  LloydStepType<MetricType, MatType> lloydStep(shard, metric);
+  arma::mat newCentroids;
+  arma::Col<size_t> counts;
+
+  // The sum of the points of each cluster, with the number of points in the
+  // last row.
+  arma::mat statistics(dims + 1, clusters);
+
+  iterations = 0;
+  double cNorm;
+  do
+  {
+    lloydStep.Iterate(centroids, newCentroids, counts);
+
+    // The step gives the means of the clusters of this shard, so the sums are
+    // found again from them.
+    for (size_t c = 0; c < clusters; ++c)
+    {
+      if (counts[c] > 0)
+        statistics.col(c).rows(0, dims - 1) = newCentroids.col(c) * counts[c];
+      else
+        statistics.col(c).zeros();
+      statistics(dims, c) = counts[c];
+    }
+
+    communicator.AllReduce(statistics);
+
+    // Clusters which are empty on every shard keep their centroid until they
+    // are filled.
+    arma::mat nextCentroids(centroids);
+    arma::vec globalCounts = trans(statistics.row(dims));
+    bool empty = false;
+    for (size_t c = 0; c < clusters; ++c)
+    {
+      if (globalCounts[c] > 0)
+        nextCentroids.col(c) = statistics.col(c).rows(0, dims - 1) /
+            globalCounts[c];
+      else
+        empty = true;
+    }
+
+    if (empty && !allowEmptyClusters)
+      FillEmptyClusters(shard, nextCentroids, globalCounts);
+
+    cNorm = 0.0;
+    for (size_t c = 0; c < clusters; ++c)
+      cNorm += std::pow(metric.Evaluate(centroids.col(c),
+          nextCentroids.col(c)), 2.0);
+    cNorm = std::sqrt(cNorm);
+
+    centroids.swap(nextCentroids);
+    ++iterations;
+    Log::Info << "ShardedKMeans::Cluster(): iteration " << iterations
+        << ", residual " << cNorm << ".\n";
+
+  } while (cNorm > 1e-5 && iterations != maxIterations);
+
+  if (iterations != maxIterations)
+  {
+    Log::Info << "ShardedKMeans::Cluster(): converged after " << iterations
+        << " iterations." << std::endl;
+  }
+  else
+  {
+    Log::Info << "ShardedKMeans::Cluster(): terminated after limit of "
+        << iterations << " iterations." << std::endl;
+  }
+  Log::Info << lloydStep.DistanceCalculations() << " distance calculations on "
+      << "this shard." << std::endl;
+}
+
+template<typename CommunicatorType,
+         typename MetricType,
+         typename InitialPartitionPolicy,
+         template<class, class> class LloydStepType,
+         typename MatType>
+void ShardedKMeans<
+    CommunicatorType,
+    MetricType,
+    InitialPartitionPolicy,
+    LloydStepType,
+    MatType>::
+Cluster(const MatType& shard,
+        const size_t clusters,
+        arma::Col<size_t>& assignments,
+        arma::mat& centroids,
+        const bool initialGuess)
+{
+  Cluster(shard, clusters, centroids, initialGuess);
+
+  // Calculate the assignments of the points of this shard.
+  CentroidDistance<MetricType, MatType> distances(shard, metric);
+  distances.Centroids(centroids);
+  assignments.set_size(shard.n_cols);
+  for (size_t i = 0; i < shard.n_cols; ++i)
+  {
+    double minDistance = std::numeric_limits<double>::infinity();
+    size_t closestCluster = centroids.n_cols; // Invalid value.
+
+    for (size_t j = 0; j < centroids.n_cols; ++j)
+    {
+      const double distance = distances.Evaluate(i, j);
+      if (distance < minDistance)
+      {
+        minDistance = distance;
+        closestCluster = j;
+      }
+    }
+
+    Log::Assert(closestCluster != centroids.n_cols);
+    assignments[i] = closestCluster;
+  }
+}
+
+template<typename CommunicatorType,
+         typename MetricType,
+         typename InitialPartitionPolicy,
+         template<class, class> class LloydStepType,
+         typename MatType>
+void ShardedKMeans<
+    CommunicatorType,
+    MetricType,
+    InitialPartitionPolicy,
+    LloydStepType,
+    MatType>::
+FillEmptyClusters(const MatType& shard,
+                  arma::mat& centroids,
+                  arma::vec& counts)
+{
+  const size_t dims = shard.n_rows;
+  const size_t rank = communicator.Rank();
+  const size_t size = communicator.Size();
+
+  // Assign the points of this shard to their closest centroids, and sum the
+  // distances of the points of each cluster to its centroid over all shards.
+  std::vector<std::vector<size_t> > members(centroids.n_cols);
+  arma::mat distanceSums;
+  distanceSums.zeros(centroids.n_cols, 1);
+
+  CentroidDistance<MetricType, MatType> distances(shard, metric);
+  distances.Centroids(centroids);
+  for (size_t i = 0; i < shard.n_cols; ++i)
+  {
+    double minDistance = std::numeric_limits<double>::infinity();
+    size_t closestCluster = centroids.n_cols; // Invalid value.
+    for (size_t j = 0; j < centroids.n_cols; ++j)
+    {
+      const double distance = distances.Evaluate(i, j);
+      if (distance < minDistance)
+      {
+        minDistance = distance;
+        closestCluster = j;
+      }
+    }
+
+    // Points which are infinitely far from every centroid are not counted.
+    if (closestCluster == centroids.n_cols)
+      continue;
+
+    members[closestCluster].push_back(i);
+    distanceSums[closestCluster] += minDistance;
+  }
+
+  communicator.AllReduce(distanceSums);
+
+  for (size_t emptyCluster = 0; emptyCluster < centroids.n_cols;
+       ++emptyCluster)
+  {
+    if (counts[emptyCluster] > 0)
+      continue;
+
+    // Find the cluster with maximum variance (the mean distance of its points
+    // from its centroid).  Every process finds the same one.  Clusters with
+    // only one point cannot give up a point.
+    size_t maxVarCluster = centroids.n_cols;
+    double maxVariance = -DBL_MAX;
+    for (size_t c = 0; c < centroids.n_cols; ++c)
+    {
+      if (counts[c] <= 1)
+        continue;
+
+      const double variance = distanceSums[c] / counts[c];
+      if (variance > maxVariance)
+      {
+        maxVariance = variance;
+        maxVarCluster = c;
+      }
+    }
+
+    if (maxVarCluster == centroids.n_cols)
+    {
+      Log::Debug << "No cluster can give a point to empty cluster "
+          << emptyCluster << ".\n";
+      continue;
+    }
+
+    // Each shard proposes its point of that cluster which is furthest from the
+    // centroid, in its own column: whether it has one, its distance, and the
+    // point.
+    std::vector<size_t>& points = members[maxVarCluster];
+    size_t furthestIndex = 0;
+    double maxDistance = -DBL_MAX;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+      const double distance = metric.Evaluate(shard.col(points[i]),
+          centroids.col(maxVarCluster));
+      if (distance > maxDistance)
+      {
+        maxDistance = distance;
+        furthestIndex = i;
+      }
+    }
+
+    arma::mat candidates;
+    candidates.zeros(dims + 2, size);
+    if (!points.empty())
+    {
+      candidates(0, rank) = 1.0;
+      candidates(1, rank) = maxDistance;
+      candidates.col(rank).rows(2, dims + 1) = PointVector(shard,
+          points[furthestIndex]);
+    }
+
+    communicator.AllReduce(candidates);
+
+    // Take the furthest of the proposed points (the first one, on ties).
+    size_t owner = size;
+    double furthestDistance = -DBL_MAX;
+    for (size_t r = 0; r < size; ++r)
+    {
+      if (candidates(0, r) > 0.0 && candidates(1, r) > furthestDistance)
+      {
+        furthestDistance = candidates(1, r);
+        owner = r;
+      }
+    }
+
+    if (owner == size)
+    {
+      Log::Debug << "No point of cluster " << maxVarCluster << " can be "
+          << "given to empty cluster " << emptyCluster << ".\n";
+      continue;
+    }
+
+    // Take that point and add it to the empty cluster.
+    const arma::vec point = candidates.col(owner).rows(2, dims + 1);
+    centroids.col(maxVarCluster) *= (counts[maxVarCluster] /
+        (counts[maxVarCluster] - 1.0));
+    centroids.col(maxVarCluster) -= (1.0 / (counts[maxVarCluster] - 1.0)) *
+        point;
+    counts[maxVarCluster]--;
+    counts[emptyCluster]++;
+    centroids.col(emptyCluster) = point;
+
+    // Update the assignments and variances.  The distances of the other points
+    // to the moved centroid are not recomputed.
+    if (rank == owner)
+    {
+      const size_t furthestPoint = points[furthestIndex];
+      points[furthestIndex] = points.back();
+      points.pop_back();
+      members[emptyCluster].assign(1, furthestPoint);
+    }
+    distanceSums[maxVarCluster] = std::max(distanceSums[maxVarCluster] -
+        furthestDistance, 0.0);
+    distanceSums[emptyCluster] = 0.0;
+
+    Log::Debug << "A point of shard " << owner << " was assigned to empty "
+        << "cluster " << emptyCluster << ".\n";
+  }
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
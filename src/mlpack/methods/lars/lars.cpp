@@ -9,6 +9,78 @@
 using namespace mlpack;
 using namespace mlpack::regression;
 
+//! Products with fewer elements than this are not computed in parallel.
+static const size_t MinParallelElements = 65536;
+
+//! Compute out = X' v, with a dot product for each column of X, in parallel.
+static void TransposeMultiply(const arma::mat& X,
+                              const arma::vec& v,
+                              arma::vec& out)
+{
+  out.set_size(X.n_cols);
+
+  #pragma omp parallel for schedule(static) \
+      if (X.n_elem >= MinParallelElements)
+  for (size_t i = 0; i < X.n_cols; ++i)
+    out[i] = arma::dot(X.unsafe_col(i), v);
+}
+
+//! Compute out = X' v for sparse X, from the nonzero values of each column, in
+//! parallel.
+static void TransposeMultiply(const arma::sp_mat& X,
+                              const arma::vec& v,
+                              arma::vec& out)
+{
+  out.set_size(X.n_cols);
+
+  #pragma omp parallel for schedule(dynamic, 256) \
+      if (X.n_nonzero >= MinParallelElements)
+  for (size_t i = 0; i < X.n_cols; ++i)
+  {
+    double result = 0.0;
+    for (arma::sp_mat::const_iterator it = X.begin_col(i);
+         it != X.end_col(i); ++it)
+      result += (*it) * v[it.row()];
+
+    out[i] = result;
+  }
+}
+
+//! Store the given column of X in a dense vector.
+static void DenseColumn(const arma::mat& X, const size_t i, arma::vec& out)
+{
+  out = X.col(i);
+}
+
+//! Store the given column of sparse X in a dense vector.
+static void DenseColumn(const arma::sp_mat& X, const size_t i, arma::vec& out)
+{
+  out.zeros(X.n_rows);
+  for (arma::sp_mat::const_iterator it = X.begin_col(i); it != X.end_col(i);
+       ++it)
+    out[it.row()] = (*it);
+}
+
+//! Add scale times the given column of X to out.
+static void AddColumn(const arma::mat& X,
+                      const size_t i,
+                      const double scale,
+                      arma::vec& out)
+{
+  out += scale * X.col(i);
+}
+
+//! Add scale times the given column of sparse X to out.
+static void AddColumn(const arma::sp_mat& X,
+                      const size_t i,
+                      const double scale,
+                      arma::vec& out)
+{
+  for (arma::sp_mat::const_iterator it = X.begin_col(i); it != X.end_col(i);
+       ++it)
+    out[it.row()] += scale * (*it);
+}
+
 LARS::LARS(const bool useCholesky,
            const double lambda1,
            const double lambda2,
@@ -39,26 +111,63 @@ LARS::LARS(const bool useCholesky,
 void LARS::Regress(const arma::mat& matX,
                    const arma::vec& y,
                    arma::vec& beta,
-                   const bool transposeData)
+                   const bool transposeData,
+                   const bool reuseGram)
+{
+  RegressInternal(matX, y, beta, transposeData, reuseGram);
+}
+
+void LARS::Regress(const arma::sp_mat& matX,
+                   const arma::vec& y,
+                   arma::vec& beta,
+                   const bool transposeData,
+                   const bool reuseGram)
 {
-  Timer::Start("lars_regression");
+  RegressInternal(matX, y, beta, transposeData, reuseGram);
+}
+
+template<typename MatType>
+void LARS::RegressInternal(const MatType& matX,
+                           const arma::vec& y,
+                           arma::vec& beta,
+                           const bool transposeData,
+                           const bool reuseGram)
+{
+  // The timers are not thread-safe, so the regression is only timed when it is
+  // not run inside a parallel region (SparseCoding codes points in parallel).
+#ifdef _OPENMP
+  const bool timed = !omp_in_parallel();
+#else
+  const bool timed = true;
+#endif
+  if (timed)
+    Timer::Start("lars_regression");
 
   // This matrix may end up holding the transpose -- if necessary.
-  arma::mat dataTrans;
+  MatType dataTrans;
   // dataRef is row-major.
-  const arma::mat& dataRef = (transposeData ? dataTrans : matX);
+  const MatType& dataRef = (transposeData ? dataTrans : matX);
   if (transposeData)
     dataTrans = trans(matX);
 
   // Compute X' * y.
-  arma::vec vecXTy = trans(dataRef) * y;
+  arma::vec vecXTy;
+  TransposeMultiply(dataRef, y, vecXTy);
+
+  // Forget the results of any previous call, so that the same object can be
+  // used for many regressions (the containers keep their memory).
+  betaPath.clear();
+  lambdaPath.clear();
+  activeSet.clear();
+  ignoreSet.clear();
+  matUtriCholFactor.reset();
 
   // Set up active set variables.  In the beginning, the active set has size 0
   // (all dimensions are inactive).
-  isActive.resize(dataRef.n_cols, false);
+  isActive.assign(dataRef.n_cols, false);
 
   // Set up ignores set variables. Initialized empty.
-  isIgnored.resize(dataRef.n_cols, false);
+  isIgnored.assign(dataRef.n_cols, false);
 
   // Initialize yHat and beta.
   beta = arma::zeros(dataRef.n_cols);
@@ -87,19 +196,21 @@ void LARS::Regress(const arma::mat& matX,
   if (maxCorr < lambda1)
   {
     lambdaPath[0] = lambda1;
-    Timer::Stop("lars_regression");
+    if (timed)
+      Timer::Stop("lars_regression");
     return;
   }
 
-  // Compute the Gram matrix.  If this is the elastic net problem, we will add
-  // lambda2 * I_n to the matrix.
-  if (matGram.n_elem == 0)
+  // Unless a Gram matrix was given to the constructor, its columns are
+  // computed when they are needed (see GramColumn()).  The columns computed by
+  // a previous call are only kept if the caller asks for it (and the number of
+  // dimensions has not changed), since the data may be another matrix, or the
+  // same matrix modified in place.
+  if (((&matGram == &matGramInternal) || (matGram.n_elem == 0)) &&
+      (!reuseGram || (gramColumnIndices.size() != dataRef.n_cols)))
   {
-    // In this case, matGram should reference matGramInternal.
-    matGramInternal = trans(dataRef) * dataRef;
-
-    if (elasticNet && !useCholesky)
-      matGramInternal += lambda2 * arma::eye(dataRef.n_cols, dataRef.n_cols);
+    gramColumns.clear();
+    gramColumnIndices.assign(dataRef.n_cols, size_t(-1));
   }
 
   // Main loop.
@@ -121,16 +232,13 @@ void LARS::Regress(const arma::mat& matX,
     {
       if (useCholesky)
       {
-        // vec newGramCol = vec(activeSet.size());
-        // for (size_t i = 0; i < activeSet.size(); i++)
-        // {
-        //   newGramCol[i] = dot(matX.col(activeSet[i]), matX.col(changeInd));
-        // }
-        // This is equivalent to the above 5 lines.
-        arma::vec newGramCol = matGram.elem(changeInd * dataRef.n_cols +
-            arma::conv_to<arma::uvec>::from(activeSet));
-
-        CholeskyInsert(matGram(changeInd, changeInd), newGramCol);
+        // Only the entries of the active dimensions are needed.
+        const double* gramCol = GramColumn(dataRef, changeInd);
+        arma::vec newGramCol(activeSet.size());
+        for (size_t i = 0; i < activeSet.size(); i++)
+          newGramCol[i] = gramCol[activeSet[i]];
+
+        CholeskyInsert(gramCol[changeInd], newGramCol);
       }
 
       // Add variable to active set.
@@ -177,6 +285,7 @@ void LARS::Regress(const arma::mat& matX,
       {
         // Singularity, so remove variable from active set, add to ignores set,
         // and look for new variable to add.
+        #pragma omp critical
         Log::Warn << "Encountered singularity when adding variable "
             << changeInd << " to active set; permanently removing."
             << std::endl;
@@ -189,9 +298,12 @@ void LARS::Regress(const arma::mat& matX,
     else
     {
       arma::mat matGramActive = arma::mat(activeSet.size(), activeSet.size());
-      for (size_t i = 0; i < activeSet.size(); i++)
-        for (size_t j = 0; j < activeSet.size(); j++)
-          matGramActive(i, j) = matGram(activeSet[i], activeSet[j]);
+      for (size_t j = 0; j < activeSet.size(); j++)
+      {
+        const double* gramCol = GramColumn(dataRef, activeSet[j]);
+        for (size_t i = 0; i < activeSet.size(); i++)
+          matGramActive(i, j) = gramCol[activeSet[i]];
+      }
 
       // Check for singularity.
       arma::mat matS = s * arma::ones<arma::mat>(1, activeSet.size());
@@ -210,6 +322,7 @@ void LARS::Regress(const arma::mat& matX,
         // and look for new variable to add.
         Deactivate(activeSet.size() - 1);
         Ignore(changeInd);
+        #pragma omp critical
         Log::Warn << "Encountered singularity when adding variable "
             << changeInd << " to active set; permanently removing."
             << std::endl;
@@ -225,13 +338,16 @@ void LARS::Regress(const arma::mat& matX,
     // If not all variables are active.
     if ((activeSet.size() + ignoreSet.size()) < dataRef.n_cols)
     {
-      // Compute correlations with direction.
+      // Compute correlations with direction (in parallel).
+      arma::vec dirCorrs;
+      TransposeMultiply(dataRef, yHatDirection, dirCorrs);
+
       for (size_t ind = 0; ind < dataRef.n_cols; ind++)
       {
         if (isActive[ind] || isIgnored[ind])
           continue;
 
-        double dirCorr = dot(dataRef.col(ind), yHatDirection);
+        double dirCorr = dirCorrs[ind];
         double val1 = (maxCorr - corr(ind)) / (normalization - dirCorr);
         double val2 = (maxCorr + corr(ind)) / (normalization + dirCorr);
         if ((val1 > 0) && (val1 < gamma))
@@ -293,7 +409,8 @@ void LARS::Regress(const arma::mat& matX,
       Deactivate(changeInd);
     }
 
-    corr = vecXTy - trans(dataRef) * yHat;
+    TransposeMultiply(dataRef, yHat, corr);
+    corr = vecXTy - corr;
     if (elasticNet)
       corr -= lambda2 * beta;
 
@@ -319,7 +436,49 @@ void LARS::Regress(const arma::mat& matX,
   // Unfortunate copy...
   beta = betaPath.back();
 
-  Timer::Stop("lars_regression");
+  if (timed)
+    Timer::Stop("lars_regression");
+}
+
+void LARS::RegressPath(const arma::mat& matX,
+                       const arma::vec& y,
+                       const arma::vec& lambdas,
+                       arma::mat& betas,
+                       const bool transposeData,
+                       const bool reuseGram)
+{
+  // One run of the homotopy gives the whole path, from lambda1 = max |X' y|
+  // (where the solution is 0) down to the lambda1 of this object.
+  arma::vec beta;
+  Regress(matX, y, beta, transposeData, reuseGram);
+
+  betas.set_size(beta.n_elem, lambdas.n_elem);
+  for (size_t i = 0; i < lambdas.n_elem; ++i)
+  {
+    const double lambda = lambdas[i];
+
+    // The values of lambda along the path are decreasing.
+    if (lambda >= lambdaPath.front())
+    {
+      betas.col(i) = betaPath.front();
+      continue;
+    }
+    if (lambda <= lambdaPath.back())
+    {
+      betas.col(i) = betaPath.back();
+      continue;
+    }
+
+    // Find the segment of the path which contains lambda; the solution is
+    // linear in lambda along each segment.
+    size_t t = 0;
+    while (lambdaPath[t + 1] > lambda)
+      ++t;
+
+    const double interp = (lambdaPath[t] - lambda) /
+        (lambdaPath[t] - lambdaPath[t + 1]);
+    betas.col(i) = (1 - interp) * betaPath[t] + interp * betaPath[t + 1];
+  }
 }
 
 // Private functions.
@@ -341,13 +500,39 @@ void LARS::Ignore(const size_t varInd)
   ignoreSet.push_back(varInd);
 }
 
-void LARS::ComputeYHatDirection(const arma::mat& matX,
+template<typename MatType>
+const double* LARS::GramColumn(const MatType& dataRef, const size_t dim)
+{
+  if ((&matGram != &matGramInternal) && (matGram.n_elem != 0))
+    return matGram.colptr(dim);
+
+  // Compute X' x_dim, if it was not computed before.  If this is the elastic
+  // net problem, we add lambda2 to the diagonal, as if lambda2 * I_n had been
+  // added to the Gram matrix.
+  if (gramColumnIndices[dim] == size_t(-1))
+  {
+    arma::vec column;
+    DenseColumn(dataRef, dim, column);
+
+    gramColumnIndices[dim] = gramColumns.size();
+    gramColumns.push_back(arma::vec());
+    TransposeMultiply(dataRef, column, gramColumns.back());
+
+    if (elasticNet && !useCholesky)
+      gramColumns.back()[dim] += lambda2;
+  }
+
+  return gramColumns[gramColumnIndices[dim]].memptr();
+}
+
+template<typename MatType>
+void LARS::ComputeYHatDirection(const MatType& matX,
                                 const arma::vec& betaDirection,
                                 arma::vec& yHatDirection)
 {
   yHatDirection.fill(0);
   for (size_t i = 0; i < activeSet.size(); i++)
-    yHatDirection += betaDirection(i) * matX.col(activeSet[i]);
+    AddColumn(matX, activeSet[i], betaDirection(i), yHatDirection);
 }
 
 void LARS::InterpolateBeta()
@@ -130,11 +130,81 @@ class LARS
    * @param responses A vector of targets.
    * @param beta Vector to store the solution (the coefficients) in.
    * @param rowMajor Set to false if the data is row-major.
+   * @param reuseGram If true, keep the columns of the Gram matrix computed by
+   *     the previous call (the data must then be exactly the data of the
+   *     previous call).
+   *
+   * The results of any previous call are discarded, so one LARS object can be
+   * used for many regressions with the same parameters (and Gram matrix); its
+   * internal buffers are then reused.
+   *
+   * If no Gram matrix was given to the constructor, the full Gram matrix is
+   * never formed: the column of the Gram matrix of a dimension is computed
+   * when that dimension enters the active set, so the memory taken grows with
+   * the active set instead of with the square of the dimensionality.  The
+   * columns are computed again by every call, so the data may be modified in
+   * place between two calls; when many response vectors are regressed on the
+   * same data, pass reuseGram = true to keep the columns computed by the
+   * previous call instead.  The correlations with the data are computed in
+   * parallel over the dimensions (with OpenMP).
    */
   void Regress(const arma::mat& data,
                const arma::vec& responses,
                arma::vec& beta,
-               const bool transposeData = true);
+               const bool transposeData = true,
+               const bool reuseGram = false);
+
+  /**
+   * Run LARS on sparse data (for instance, a wide design of text features).
+   * This works like Regress() on dense data, but the data is never made dense:
+   * the correlations and the columns of the Gram matrix are computed from the
+   * nonzero values only.
+   *
+   * @param data Column-major input data (or row-major input data if
+   *     transposeData = false).
+   * @param responses A vector of targets.
+   * @param beta Vector to store the solution (the coefficients) in.
+   * @param transposeData Set to false if the data is row-major.
+   * @param reuseGram If true, keep the columns of the Gram matrix computed by
+   *     the previous call (the data must then be exactly the data of the
+   *     previous call).
+   */
+  void Regress(const arma::sp_mat& data,
+               const arma::vec& responses,
+               arma::vec& beta,
+               const bool transposeData = true,
+               const bool reuseGram = false);
+
+  /**
+   * Compute the solutions for several values of lambda1 with a single run of
+   * LARS.  The homotopy visits every solution from lambda1 = max |X' y| (where
+   * the solution is 0) down to the lambda1 given to the constructor, and the
+   * solution is linear in lambda1 between two steps, so the solution for each
+   * requested value is interpolated from the path.  This is much cheaper than
+   * one regression per value (for instance, to choose lambda1 by
+   * cross-validation).
+   *
+   * Values of lambda1 smaller than the one given to the constructor get the
+   * solution for the constructor's lambda1.  After the call, BetaPath() and
+   * LambdaPath() hold the whole path.
+   *
+   * @param data Column-major input data (or row-major input data if
+   *     transposeData = false).
+   * @param responses A vector of targets.
+   * @param lambdas Values of lambda1 to compute the solution for.
+   * @param betas Matrix to store the solutions in, one column per value of
+   *     lambda1.
+   * @param transposeData Set to false if the data is row-major.
+   * @param reuseGram If true, keep the columns of the Gram matrix computed by
+   *     the previous call (the data must then be exactly the data of the
+   *     previous call).
+   */
+  void RegressPath(const arma::mat& data,
+                   const arma::vec& responses,
+                   const arma::vec& lambdas,
+                   arma::mat& betas,
+                   const bool transposeData = true,
+                   const bool reuseGram = false);
 
   //! Access the set of active dimensions.
   const std::vector<size_t>& ActiveSet() const { return activeSet; }
@@ -154,12 +224,21 @@ class LARS
   std::string ToString() const;
 
  private:
-  //! Gram matrix.
+  //! Empty matrix, which matGram refers to when no Gram matrix is given (the
+  //! columns of the Gram matrix are then computed when needed).
   arma::mat matGramInternal;
 
   //! Reference to the Gram matrix we will use.
   const arma::mat& matGram;
 
+  //! The columns of the Gram matrix computed so far, if no Gram matrix is
+  //! given.
+  std::vector<arma::vec> gramColumns;
+
+  //! The index in gramColumns of the column of each dimension (or -1 if it
+  //! has not been computed).
+  std::vector<size_t> gramColumnIndices;
+
   //! Upper triangular cholesky factor; initially 0x0 matrix.
   arma::mat matUtriCholFactor;
 
@@ -220,8 +299,31 @@ class LARS
    */
   void Ignore(const size_t varInd);
 
+  /**
+   * Run LARS on dense or sparse data (see Regress()).
+   *
+   * @param matX Input data.
+   */
+  template<typename MatType>
+  void RegressInternal(const MatType& matX,
+                       const arma::vec& y,
+                       arma::vec& beta,
+                       const bool transposeData,
+                       const bool reuseGram);
+
+  /**
+   * Get the column of the Gram matrix of the given dimension, computing it if
+   * it is not known yet.  The memory is only valid until the next call.
+   *
+   * @param dataRef Row-major data.
+   * @param dim Dimension to get the column of.
+   */
+  template<typename MatType>
+  const double* GramColumn(const MatType& dataRef, const size_t dim);
+
   // compute "equiangular" direction in output space
-  void ComputeYHatDirection(const arma::mat& matX,
+  template<typename MatType>
+  void ComputeYHatDirection(const MatType& matX,
                             const arma::vec& betaDirection,
                             arma::vec& yHatDirection);
 
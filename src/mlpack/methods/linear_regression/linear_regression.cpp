@@ -14,11 +14,18 @@ LinearRegression::LinearRegression(const arma::mat& predictors,
                                    const arma::vec& responses,
                                    const double lambda,
                                    const bool intercept,
-                                   const arma::vec& weights
+                                   const arma::vec& weights,
+                                   const bool streaming
                                    ) :
     lambda(lambda),
     intercept(intercept)
 {
+  if (streaming)
+  {
+    SolveNormalEquations(predictors, responses, weights);
+    return;
+  }
+
   /*
    * We want to calculate the a_i coefficients of:
    * \sum_{i=0}^n (a_i * x_i^i)
@@ -58,9 +65,11 @@ LinearRegression::LinearRegression(const arma::mat& predictors,
   }
 
   // We compute the QR decomposition of the predictors.
-  // We transpose the predictors because they are in column major order.
+  // We transpose the predictors because they are in column major order.  Only
+  // the first columns of Q are needed, so the economical decomposition is used;
+  // the full Q would have one row and one column for each point.
   arma::mat Q, R;
-  arma::qr(Q, R, arma::trans(p));
+  arma::qr_econ(Q, R, arma::trans(p));
 
   // We compute the parameters, B, like so:
   // R * B = Q^T * responses
@@ -78,6 +87,120 @@ LinearRegression::LinearRegression(const arma::mat& predictors,
   }
 }
 
+void LinearRegression::SolveNormalEquations(const arma::mat& predictors,
+                                            const arma::vec& responses,
+                                            const arma::vec& weights)
+{
+  const size_t dims = predictors.n_rows;
+  const bool weighted = (weights.n_elem > 0);
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  // Each thread accumulates, over its blocks of points, X W X^T, X W y, the
+  // weighted sum of the points and the sums of the weights and of the weighted
+  // responses (the last three are only needed for the intercept).
+  std::vector<arma::mat> threadCov(threads);
+  std::vector<arma::vec> threadCross(threads);
+  std::vector<arma::vec> threadSum(threads);
+  arma::vec threadWeight(threads);
+  arma::vec threadResponse(threads);
+  for (size_t t = 0; t < threads; ++t)
+  {
+    threadCov[t].zeros(dims, dims);
+    threadCross[t].zeros(dims);
+    threadSum[t].zeros(dims);
+  }
+  threadWeight.zeros();
+  threadResponse.zeros();
+
+  const size_t numBlocks = (predictors.n_cols + PointBlockSize - 1) /
+      PointBlockSize;
+
+  #pragma omp parallel num_threads(threads)
+  {
+#ifdef _OPENMP
+    const size_t thread = omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+
+    arma::mat weightedBlock;
+
+    #pragma omp for schedule(static)
+    for (size_t b = 0; b < numBlocks; ++b)
+    {
+      const size_t begin = b * PointBlockSize;
+      const size_t size = std::min(begin + PointBlockSize,
+          (size_t) predictors.n_cols) - begin;
+
+      // Aliases of the block of points and of its responses, to avoid copies.
+      const arma::mat block(const_cast<double*>(predictors.colptr(begin)),
+          dims, size, false, true);
+      const arma::vec blockResponses(const_cast<double*>(
+          responses.memptr() + begin), size, false, true);
+
+      if (weighted)
+      {
+        const arma::vec blockWeights(const_cast<double*>(
+            weights.memptr() + begin), size, false, true);
+
+        weightedBlock = block;
+        for (size_t i = 0; i < size; ++i)
+          weightedBlock.col(i) *= blockWeights[i];
+
+        threadCov[thread] += weightedBlock * trans(block);
+        threadCross[thread] += weightedBlock * blockResponses;
+        threadSum[thread] += arma::sum(weightedBlock, 1);
+        threadWeight[thread] += arma::accu(blockWeights);
+        threadResponse[thread] += arma::dot(blockWeights, blockResponses);
+      }
+      else
+      {
+        threadCov[thread] += block * trans(block);
+        threadCross[thread] += block * blockResponses;
+        threadSum[thread] += arma::sum(block, 1);
+        threadWeight[thread] += size;
+        threadResponse[thread] += arma::accu(blockResponses);
+      }
+    }
+  }
+
+  // Merge the sums of the threads in order, so the result does not depend on
+  // the scheduling.
+  for (size_t t = 1; t < threads; ++t)
+  {
+    threadCov[0] += threadCov[t];
+    threadCross[0] += threadCross[t];
+    threadSum[0] += threadSum[t];
+  }
+
+  // Assemble the normal equations; the intercept is the first parameter, as if
+  // a row of ones had been added to the predictors.
+  const size_t offset = intercept ? 1 : 0;
+  arma::mat lhs(dims + offset, dims + offset);
+  arma::vec rhs(dims + offset);
+  lhs.submat(offset, offset, dims + offset - 1, dims + offset - 1) =
+      threadCov[0];
+  rhs.subvec(offset, dims + offset - 1) = threadCross[0];
+  if (intercept)
+  {
+    lhs(0, 0) = arma::accu(threadWeight);
+    lhs.submat(1, 0, dims, 0) = threadSum[0];
+    lhs.submat(0, 1, 0, dims) = trans(threadSum[0]);
+    rhs[0] = arma::accu(threadResponse);
+  }
+
+  // The intercept is not penalized.
+  for (size_t i = offset; i < lhs.n_rows; ++i)
+    lhs(i, i) += lambda;
+
+  arma::solve(parameters, lhs, rhs);
+}
+
 LinearRegression::LinearRegression(const std::string& filename) :
     lambda(0.0)
 {
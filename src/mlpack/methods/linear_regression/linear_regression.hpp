@@ -29,12 +29,16 @@ class LinearRegression
    * @param lambda regularization constant
    * @param intercept include intercept?
    * @param weights observation weights
+   * @param streaming If true, solve the normal equations, accumulated over
+   *     blocks of points in parallel, instead of computing the QR decomposition
+   *     of the (copied) predictors; see SolveNormalEquations().
    */
   LinearRegression(const arma::mat& predictors,
                    const arma::vec& responses,
                    const double lambda = 0,
                    const bool intercept = true,
-                   const arma::vec& weights = arma::vec()
+                   const arma::vec& weights = arma::vec(),
+                   const bool streaming = false
                    );
 
   /**
@@ -110,6 +114,26 @@ class LinearRegression
   double lambda;
   //! Indicates whether first parameter is intercept.
   bool intercept;
+
+  //! The number of points accumulated together by one thread.
+  static const size_t PointBlockSize = 4096;
+
+  /**
+   * Compute the parameters by solving the normal equations
+   *
+   *   (X W X^T + lambda I) B = X W y,
+   *
+   * where W is the diagonal matrix of the weights (or the identity).  The
+   * d x d matrix X W X^T and the vector X W y are accumulated over blocks of
+   * points, in parallel, without copying the predictors; the memory used does
+   * not depend on the number of points.  As with the QR solver, the intercept
+   * is not penalized.  The normal equations square the condition number of
+   * the problem, so the QR solver is more accurate for ill-conditioned
+   * predictors.
+   */
+  void SolveNormalEquations(const arma::mat& predictors,
+                            const arma::vec& responses,
+                            const arma::vec& weights);
 };
 
 }; // namespace linear_regression
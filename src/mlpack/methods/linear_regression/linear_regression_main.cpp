@@ -23,7 +23,13 @@ PROGRAM_INFO("Simple Linear Regression and Prediction",
     "   y' = X' * b\n\n"
     "and these predicted responses, y', are saved to a file "
     "(--output_predictions).  This type of regression is related to least-angle"
-    " regression, which mlpack implements with the 'lars' executable.");
+    " regression, which mlpack implements with the 'lars' executable.\n"
+    "\n"
+    "For datasets with many points, the --streaming (-S) option solves the "
+    "normal equations (X X' + lambda I) b = X y, accumulated over blocks of "
+    "points in parallel, instead of computing a QR decomposition of a copy of "
+    "X.  This uses memory independent of the number of points, but is less "
+    "accurate when X is ill-conditioned.");
 
 PARAM_STRING("input_file", "File containing X (regressors).", "i", "");
 PARAM_STRING("input_responses", "Optional file containing y (responses). If "
@@ -43,6 +49,9 @@ PARAM_STRING("output_predictions", "If --test_file is specified, this file is "
 PARAM_DOUBLE("lambda", "Tikhonov regularization for ridge regression.  If 0, "
     "the method reduces to linear regression.", "l", 0.0);
 
+PARAM_FLAG("streaming", "Solve the normal equations, accumulated over blocks of "
+    "points, instead of computing a QR decomposition of the regressors.", "S");
+
 using namespace mlpack;
 using namespace mlpack::regression;
 using namespace arma;
@@ -131,7 +140,8 @@ int main(int argc, char* argv[])
     }
 
     Timer::Start("regression");
-    lr = LinearRegression(regressors, responses.unsafe_col(0));
+    lr = LinearRegression(regressors, responses.unsafe_col(0), lambda, true,
+        arma::vec(), CLI::HasParam("streaming"));
     Timer::Stop("regression");
 
     // Save the parameters.
@@ -99,7 +99,8 @@ class LocalCoordinateCoding
               const double objTolerance = 0.01);
 
   /**
-   * Code each point via distance-weighted LARS.
+   * Code each point via distance-weighted LARS.  The points are coded in
+   * parallel (with OpenMP).
    */
   void OptimizeCode();
 
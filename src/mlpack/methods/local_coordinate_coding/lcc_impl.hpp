@@ -102,29 +102,44 @@ void LocalCoordinateCoding<DictionaryInitializer>::OptimizeCode()
       * data);
 
   arma::mat dictGram = trans(dictionary) * dictionary;
-  arma::mat dictGramTD(dictGram.n_rows, dictGram.n_cols);
 
-  for (size_t i = 0; i < data.n_cols; i++)
-  {
-    // report progress
-    if ((i % 100) == 0)
-    {
-      Log::Debug << "Optimization at point " << i << "." << std::endl;
-    }
-
-    arma::vec invW = invSqDists.unsafe_col(i);
-    arma::mat dictPrime = dictionary * diagmat(invW);
+  Log::Debug << "Optimizing the codes of " << data.n_cols << " points."
+      << std::endl;
 
-    arma::mat dictGramTD = diagmat(invW) * dictGram * diagmat(invW);
+  // The points are coded independently, so they are split between the threads,
+  // as in SparseCoding::OptimizeCode().  Each thread reuses one LARS object for
+  // all its points; that LARS object refers to the thread's reweighted Gram
+  // matrix, which is overwritten in place for each point.  The number of LARS
+  // iterations varies between points, hence the dynamic schedule.
+  #pragma omp parallel
+  {
+    arma::mat dictPrime(dictionary.n_rows, dictionary.n_cols);
+    arma::mat dictGramTD(dictGram.n_rows, dictGram.n_cols);
 
     bool useCholesky = false;
     regression::LARS lars(useCholesky, dictGramTD, 0.5 * lambda);
 
-    // Run LARS for this point, by making an alias of the point and passing
-    // that.
-    arma::vec beta = codes.unsafe_col(i);
-    lars.Regress(dictPrime, data.unsafe_col(i), beta, false);
-    beta %= invW; // Remember, beta is an alias of codes.col(i).
+    #pragma omp for schedule(dynamic, 16)
+    for (size_t i = 0; i < data.n_cols; i++)
+    {
+      const arma::vec invW = invSqDists.unsafe_col(i);
+
+      // Reweight the columns of the dictionary and the Gram matrix:
+      //   dictPrime = dictionary * diagmat(invW),
+      //   dictGramTD = diagmat(invW) * dictGram * diagmat(invW),
+      // without forming the diagonal matrices or any temporary.
+      for (size_t j = 0; j < atoms; ++j)
+      {
+        dictPrime.col(j) = invW[j] * dictionary.col(j);
+        dictGramTD.col(j) = invW[j] * (dictGram.col(j) % invW);
+      }
+
+      // Run LARS for this point, by making an alias of the point and passing
+      // that.
+      arma::vec beta = codes.unsafe_col(i);
+      lars.Regress(dictPrime, data.unsafe_col(i), beta, false);
+      beta %= invW; // Remember, beta is an alias of codes.col(i).
+    }
   }
 }
 
@@ -12,12 +12,21 @@
 #include <mlpack/core/optimizers/lbfgs/lbfgs.hpp>
 
 #include "logistic_regression_function.hpp"
+#include "logistic_regression_scorer.hpp"
 
 namespace mlpack {
 namespace regression {
 
+/**
+ * A logistic regression model, trained with the given optimizer.  The
+ * predictors may be dense (arma::mat, the default) or sparse (arma::sp_mat).
+ *
+ * @tparam OptimizerType Optimizer used to train the model.
+ * @tparam MatType Type of the predictor matrices (arma::mat or arma::sp_mat).
+ */
 template<
-  template<typename> class OptimizerType = mlpack::optimization::L_BFGS
+  template<typename> class OptimizerType = mlpack::optimization::L_BFGS,
+  typename MatType = arma::mat
 >
 class LogisticRegression
 {
@@ -32,7 +41,7 @@ class LogisticRegression
    * @param responses Outputs resulting from input training variables.
    * @param lambda L2-regularization parameter.
    */
-  LogisticRegression(const arma::mat& predictors,
+  LogisticRegression(const MatType& predictors,
                      const arma::vec& responses,
                      const double lambda = 0);
 
@@ -47,7 +56,7 @@ class LogisticRegression
    * @param initialPoint Initial model to train with.
    * @param lambda L2-regularization parameter.
    */
-  LogisticRegression(const arma::mat& predictors,
+  LogisticRegression(const MatType& predictors,
                      const arma::vec& responses,
                      const arma::mat& initialPoint,
                      const double lambda = 0);
@@ -63,7 +72,8 @@ class LogisticRegression
    *
    * @param optimizer Instantiated optimizer with instantiated error function.
    */
-  LogisticRegression(OptimizerType<LogisticRegressionFunction>& optimizer);
+  LogisticRegression(
+      OptimizerType<LogisticRegressionFunctionType<MatType> >& optimizer);
 
   /**
    * Construct a logistic regression model from the given parameters, without
@@ -97,7 +107,7 @@ class LogisticRegression
    * @param responses Vector to put output predictions of responses into.
    * @param decisionBoundary Decision boundary (default 0.5).
    */
-  void Predict(const arma::mat& predictors,
+  void Predict(const MatType& predictors,
                arma::vec& responses,
                const double decisionBoundary = 0.5) const;
 
@@ -115,7 +125,7 @@ class LogisticRegression
    * @param decisionBoundary Decision boundary (default 0.5).
    * @return Percentage of responses that are predicted correctly.
    */
-  double ComputeAccuracy(const arma::mat& predictors,
+  double ComputeAccuracy(const MatType& predictors,
                          const arma::vec& responses,
                          const double decisionBoundary = 0.5) const;
 
@@ -127,7 +137,7 @@ class LogisticRegression
    * @param predictors Input predictors.
    * @param responses Vector of responses.
    */
-  double ComputeError(const arma::mat& predictors,
+  double ComputeError(const MatType& predictors,
                       const arma::vec& responses) const;
 
   // Returns a string representation of this object. 
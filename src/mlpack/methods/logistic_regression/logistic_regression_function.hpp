@@ -18,18 +18,27 @@ namespace regression {
  * The log-likelihood function for the logistic regression objective function.
  * This is used by various mlpack optimizers to train a logistic regression
  * model.
+ *
+ * The predictors may be dense (arma::mat; see the LogisticRegressionFunction
+ * typedef) or sparse (arma::sp_mat; see SparseLogisticRegressionFunction).
+ * With sparse predictors, the objective and the gradients are computed with
+ * sparse-dense products, so the memory and the time scale with the number of
+ * nonzero features rather than with the dimensionality.
+ *
+ * @tparam MatType Type of the predictor matrix (arma::mat or arma::sp_mat).
  */
-class LogisticRegressionFunction
+template<typename MatType = arma::mat>
+class LogisticRegressionFunctionType
 {
  public:
-  LogisticRegressionFunction(const arma::mat& predictors,
-                             const arma::vec& responses,
-                             const double lambda = 0);
+  LogisticRegressionFunctionType(const MatType& predictors,
+                                 const arma::vec& responses,
+                                 const double lambda = 0);
 
-  LogisticRegressionFunction(const arma::mat& predictors,
-                             const arma::vec& responses,
-                             const arma::mat& initialPoint,
-                             const double lambda = 0);
+  LogisticRegressionFunctionType(const MatType& predictors,
+                                 const arma::vec& responses,
+                                 const arma::mat& initialPoint,
+                                 const double lambda = 0);
 
   //! Return the initial point for the optimization.
   const arma::mat& InitialPoint() const { return initialPoint; }
@@ -42,7 +51,7 @@ class LogisticRegressionFunction
   double& Lambda() { return lambda; }
 
   //! Return the matrix of predictors.
-  const arma::mat& Predictors() const { return predictors; }
+  const MatType& Predictors() const { return predictors; }
   //! Return the vector of responses.
   const arma::vec& Responses() const { return responses; }
 
@@ -75,6 +84,21 @@ class LogisticRegressionFunction
    */
   double Evaluate(const arma::mat& parameters, const size_t i) const;
 
+  /**
+   * Evaluate the sum of the logistic regression objective functions of the
+   * points begin, ..., begin + batchSize - 1, with the given parameters.  This
+   * is equal to the sum of Evaluate(parameters, i) over those points, but the
+   * batch is computed with matrix operations.  This is useful for optimizers
+   * such as MiniBatchSGD.
+   *
+   * @param parameters Vector of logistic regression parameters.
+   * @param begin Index of the first point of the batch.
+   * @param batchSize Number of points in the batch.
+   */
+  double Evaluate(const arma::mat& parameters,
+                  const size_t begin,
+                  const size_t batchSize) const;
+
   /**
    * Evaluate the gradient of the logistic regression log-likelihood function
    * with the given parameters.
@@ -98,6 +122,50 @@ class LogisticRegressionFunction
                 const size_t i,
                 arma::mat& gradient) const;
 
+  /**
+   * Evaluate the logistic regression objective function and its gradient with
+   * the given parameters.  This computes the sigmoids once for both, and is
+   * used by L_BFGS in place of separate calls to Evaluate() and Gradient().
+   *
+   * @param parameters Vector of logistic regression parameters.
+   * @param gradient Vector to output gradient into.
+   * @return Objective function.
+   */
+  double EvaluateWithGradient(const arma::mat& parameters,
+                              arma::mat& gradient) const;
+
+  /**
+   * Evaluate the logistic regression objective function and its gradient with
+   * respect to only one point in the dataset, with the given parameters.  This
+   * computes the sigmoid once for both, and is used by SGD in place of
+   * separate calls to Evaluate() and Gradient().
+   *
+   * @param parameters Vector of logistic regression parameters.
+   * @param i Index of the point to use.
+   * @param gradient Vector to output gradient into.
+   * @return Objective function for the point.
+   */
+  double EvaluateWithGradient(const arma::mat& parameters,
+                              const size_t i,
+                              arma::mat& gradient) const;
+
+  /**
+   * Evaluate the sum of the gradients of the logistic regression objective
+   * functions of the points begin, ..., begin + batchSize - 1, with the given
+   * parameters.  This is equal to the sum of Gradient(parameters, i, gradient)
+   * over those points, but the batch is computed with matrix operations.  This
+   * is useful for optimizers such as MiniBatchSGD.
+   *
+   * @param parameters Vector of logistic regression parameters.
+   * @param begin Index of the first point of the batch.
+   * @param batchSize Number of points in the batch.
+   * @param gradient Vector to output gradient into.
+   */
+  void Gradient(const arma::mat& parameters,
+                const size_t begin,
+                const size_t batchSize,
+                arma::mat& gradient) const;
+
   //! Return the initial point for the optimization.
   const arma::mat& GetInitialPoint() const { return initialPoint; }
 
@@ -105,17 +173,53 @@ class LogisticRegressionFunction
   size_t NumFunctions() const { return predictors.n_cols; }
 
  private:
+  /**
+   * Compute the objective function with the given parameters over the whole
+   * dataset, and the gradient too if the given pointer is not NULL.  The
+   * points are processed in blocks, in parallel (with OpenMP).
+   *
+   * @param parameters Vector of logistic regression parameters.
+   * @param gradient Vector to output gradient into, or NULL.
+   * @return Objective function.
+   */
+  double Accumulate(const arma::mat& parameters, arma::mat* gradient) const;
+
+  /**
+   * Compute the negative log-likelihood of the points begin, ..., begin +
+   * batchSize - 1 with the given parameters (without the regularization), and
+   * add its gradient to the given vector if the pointer is not NULL.
+   *
+   * @param parameters Vector of logistic regression parameters.
+   * @param begin Index of the first point.
+   * @param batchSize Number of points.
+   * @param gradient Vector to add the gradient to, or NULL.
+   * @return Negative log-likelihood of the points.
+   */
+  double AccumulateBatch(const arma::mat& parameters,
+                         const size_t begin,
+                         const size_t batchSize,
+                         arma::mat* gradient) const;
+
   //! The initial point, from which to start the optimization.
   arma::mat initialPoint;
   //! The matrix of data points (predictors).
-  const arma::mat& predictors;
+  const MatType& predictors;
   //! The vector of responses to the input data points.
   const arma::vec& responses;
   //! The regularization parameter for L2-regularization.
   double lambda;
 };
 
+//! The logistic regression function, with dense predictors.
+typedef LogisticRegressionFunctionType<arma::mat> LogisticRegressionFunction;
+//! The logistic regression function, with sparse predictors.
+typedef LogisticRegressionFunctionType<arma::sp_mat>
+    SparseLogisticRegressionFunction;
+
 }; // namespace regression
 }; // namespace mlpack
 
+// Include implementation.
+#include "logistic_regression_function_impl.hpp"
+
 #endif // __MLPACK_METHODS_LOGISTIC_REGRESSION_LOGISTIC_REGRESSION_FUNCTION_HPP
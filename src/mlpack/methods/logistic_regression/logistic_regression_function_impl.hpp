@@ -0,0 +1,276 @@
+/**
+ * @file logistic_regression_function_impl.hpp
+ * @author Sumedh Ghaisas
+ *
+ * Implementation of the LogisticRegressionFunctionType class.
+ */
+#ifndef __MLPACK_METHODS_LOGISTIC_REGRESSION_LOGISTIC_REGRESSION_FUNCTION_IMPL_HPP
+#define __MLPACK_METHODS_LOGISTIC_REGRESSION_LOGISTIC_REGRESSION_FUNCTION_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "logistic_regression_function.hpp"
+
+namespace mlpack {
+namespace regression {
+
+template<typename MatType>
+LogisticRegressionFunctionType<MatType>::LogisticRegressionFunctionType(
+    const MatType& predictors,
+    const arma::vec& responses,
+    const double lambda) :
+    predictors(predictors),
+    responses(responses),
+    lambda(lambda)
+{
+  initialPoint = arma::zeros<arma::mat>(predictors.n_rows + 1, 1);
+}
+
+template<typename MatType>
+LogisticRegressionFunctionType<MatType>::LogisticRegressionFunctionType(
+    const MatType& predictors,
+    const arma::vec& responses,
+    const arma::mat& initialPoint,
+    const double lambda) :
+    initialPoint(initialPoint),
+    predictors(predictors),
+    responses(responses),
+    lambda(lambda)
+{
+  //to check if initialPoint is compatible with predictors
+  if (initialPoint.n_rows != (predictors.n_rows + 1) ||
+      initialPoint.n_cols != 1)
+    this->initialPoint = arma::zeros<arma::mat>(predictors.n_rows + 1, 1);
+}
+
+/**
+ * Evaluate the logistic regression objective function given the estimated
+ * parameters.
+ */
+template<typename MatType>
+double LogisticRegressionFunctionType<MatType>::Evaluate(
+    const arma::mat& parameters) const
+{
+  // The objective function is the log-likelihood function (w is the parameters
+  // vector for the model; y is the responses; x is the predictors; sig() is the
+  // sigmoid function):
+  //   f(w) = sum(y log(sig(w'x)) + (1 - y) log(sig(1 - w'x))).
+  // We want to minimize this function.  L2-regularization is just lambda
+  // multiplied by the squared l2-norm of the parameters then divided by two.
+  return Accumulate(parameters, NULL);
+}
+
+/**
+ * Evaluate the logistic regression objective function, but with only one point.
+ * This is useful for optimizers that use a separable objective function, such
+ * as SGD.
+ */
+template<typename MatType>
+double LogisticRegressionFunctionType<MatType>::Evaluate(
+    const arma::mat& parameters,
+    const size_t i) const
+{
+  return Evaluate(parameters, i, 1);
+}
+
+/**
+ * Evaluate the logistic regression objective function for a batch of
+ * consecutive points.  This is useful for optimizers that use a batch of the
+ * separable objective functions, such as MiniBatchSGD.
+ */
+template<typename MatType>
+double LogisticRegressionFunctionType<MatType>::Evaluate(
+    const arma::mat& parameters,
+    const size_t begin,
+    const size_t batchSize) const
+{
+  // Calculate the regularization term, for each point of the batch.  We must
+  // divide by the number of points, so that the sum over all the points is
+  // equal to Evaluate(parameters).
+  const double regularization = lambda * (batchSize /
+      (2.0 * predictors.n_cols)) * arma::dot(parameters.col(0).subvec(1,
+      parameters.n_elem - 1), parameters.col(0).subvec(1,
+      parameters.n_elem - 1));
+
+  return AccumulateBatch(parameters, begin, batchSize, NULL) + regularization;
+}
+
+//! Evaluate the gradient of the logistic regression objective function.
+template<typename MatType>
+void LogisticRegressionFunctionType<MatType>::Gradient(
+    const arma::mat& parameters,
+    arma::mat& gradient) const
+{
+  Accumulate(parameters, &gradient);
+}
+
+/**
+ * Evaluate the logistic regression objective function and its gradient,
+ * computing the sigmoids only once.
+ */
+template<typename MatType>
+double LogisticRegressionFunctionType<MatType>::EvaluateWithGradient(
+    const arma::mat& parameters,
+    arma::mat& gradient) const
+{
+  return Accumulate(parameters, &gradient);
+}
+
+/**
+ * Evaluate the individual gradients of the logistic regression objective
+ * function with respect to individual points.  This is useful for optimizers
+ * that use a separable objective function, such as SGD.
+ */
+template<typename MatType>
+void LogisticRegressionFunctionType<MatType>::Gradient(
+    const arma::mat& parameters,
+    const size_t i,
+    arma::mat& gradient) const
+{
+  Gradient(parameters, i, 1, gradient);
+}
+
+/**
+ * Evaluate the logistic regression objective function and its gradient with
+ * respect to one point, computing the sigmoid only once.
+ */
+template<typename MatType>
+double LogisticRegressionFunctionType<MatType>::EvaluateWithGradient(
+    const arma::mat& parameters,
+    const size_t i,
+    arma::mat& gradient) const
+{
+  const arma::vec weights = parameters.col(0).subvec(1, parameters.n_elem - 1);
+
+  // The regularization term is divided by the number of points, as in
+  // Evaluate(parameters, i).
+  gradient.zeros(parameters.n_elem, 1);
+  const double result = AccumulateBatch(parameters, i, 1, &gradient);
+  gradient.col(0).subvec(1, parameters.n_elem - 1) +=
+      (lambda / predictors.n_cols) * weights;
+
+  return result + lambda * (1.0 / (2.0 * predictors.n_cols)) *
+      arma::dot(weights, weights);
+}
+
+/**
+ * Evaluate the sum of the gradients of the logistic regression objective
+ * function for a batch of consecutive points.  This is useful for optimizers
+ * that use a batch of the separable objective functions, such as MiniBatchSGD.
+ */
+template<typename MatType>
+void LogisticRegressionFunctionType<MatType>::Gradient(
+    const arma::mat& parameters,
+    const size_t begin,
+    const size_t batchSize,
+    arma::mat& gradient) const
+{
+  gradient.zeros(parameters.n_elem, 1);
+  AccumulateBatch(parameters, begin, batchSize, &gradient);
+
+  // Regularization term, for each point of the batch.
+  gradient.col(0).subvec(1, parameters.n_elem - 1) += lambda *
+      parameters.col(0).subvec(1, parameters.n_elem - 1) *
+      (double(batchSize) / predictors.n_cols);
+}
+
+/**
+ * Compute the objective function (and the gradient, if requested) over blocks
+ * of points, in parallel; each thread sums the gradient of its blocks into its
+ * own accumulator.
+ */
+template<typename MatType>
+double LogisticRegressionFunctionType<MatType>::Accumulate(
+    const arma::mat& parameters,
+    arma::mat* gradient) const
+{
+  // Enough points per block to make the matrix operations efficient, and few
+  // enough that the temporaries stay in cache.
+  const size_t blockSize = 4096;
+  const size_t numBlocks = (predictors.n_cols + blockSize - 1) / blockSize;
+
+  if (gradient)
+    gradient->zeros(parameters.n_elem, 1);
+
+  double result = 0.0;
+  #pragma omp parallel reduction(+:result)
+  {
+    arma::mat threadGradient;
+    if (gradient)
+      threadGradient.zeros(parameters.n_elem, 1);
+
+    #pragma omp for schedule(static)
+    for (size_t b = 0; b < numBlocks; ++b)
+    {
+      const size_t begin = b * blockSize;
+      const size_t size = std::min(blockSize, (size_t) predictors.n_cols -
+          begin);
+
+      result += AccumulateBatch(parameters, begin, size,
+          gradient ? &threadGradient : NULL);
+    }
+
+    if (gradient)
+    {
+      #pragma omp critical
+      *gradient += threadGradient;
+    }
+  }
+
+  // Add the regularization terms; the intercept term is not regularized.
+  // Often the objective function and the regularization as given are divided
+  // by the number of features, but this doesn't actually affect the
+  // optimization result, so we'll just ignore those terms for computational
+  // efficiency.
+  const arma::vec weights = parameters.col(0).subvec(1, parameters.n_elem - 1);
+  if (gradient)
+    gradient->col(0).subvec(1, parameters.n_elem - 1) += lambda * weights;
+
+  return result + 0.5 * lambda * arma::dot(weights, weights);
+}
+
+/**
+ * Compute the negative log-likelihood of a batch of consecutive points, and add
+ * its gradient if requested.  With sparse predictors, both products below are
+ * sparse-dense products.
+ */
+template<typename MatType>
+double LogisticRegressionFunctionType<MatType>::AccumulateBatch(
+    const arma::mat& parameters,
+    const size_t begin,
+    const size_t batchSize,
+    arma::mat* gradient) const
+{
+  const size_t end = begin + batchSize - 1;
+
+  // Calculate the sigmoids of the batch.  The intercept term is
+  // parameters(0, 0) and does not need to be multiplied by any of the
+  // predictors.
+  const arma::vec sigmoids = 1.0 / (1.0 + arma::exp(-parameters(0, 0) -
+      predictors.cols(begin, end).t() * parameters.col(0).subvec(1,
+      parameters.n_elem - 1)));
+
+  double result = 0.0;
+  for (size_t i = 0; i < batchSize; ++i)
+  {
+    if (responses[begin + i] == 1)
+      result += log(sigmoids[i]);
+    else
+      result += log(1.0 - sigmoids[i]);
+  }
+
+  if (gradient)
+  {
+    const arma::vec errors = responses.subvec(begin, end) - sigmoids;
+    (*gradient)[0] -= arma::accu(errors);
+    gradient->col(0).subvec(1, parameters.n_elem - 1) -=
+        predictors.cols(begin, end) * errors;
+  }
+
+  // Invert the result, because it's a minimization.
+  return -result;
+}
+
+}; // namespace regression
+}; // namespace mlpack
+
+#endif // __MLPACK_METHODS_LOGISTIC_REGRESSION_LOGISTIC_REGRESSION_FUNCTION_IMPL_HPP
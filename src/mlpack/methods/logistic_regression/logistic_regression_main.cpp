@@ -31,8 +31,9 @@ PROGRAM_INFO("L2-regularized Logistic Regression and Prediction",
     "specified when the --model_file parameter is given with --input_file or "
     "--input_responses.  The tolerance of the optimizer can be set with "
     "--tolerance; the maximum number of iterations of the optimizer can be set "
-    "with --max_iterations; and the type of the optimizer (SGD / L-BFGS) can be"
-    " set with " "the --optimizer option.  Both the SGD and L-BFGS optimizers "
+    "with --max_iterations; and the type of the optimizer (SGD / Adam / "
+    "L-BFGS) can be set with the --optimizer option ('adam' is SGD with Adam "
+    "steps, which usually needs far fewer passes over the data).  Both the SGD and L-BFGS optimizers "
     "have more options, but the C++ interface must be used for those.  For the "
     "SGD optimizer, the --step_size parameter controls the step size taken at "
     "each iteration by the optimizer.  If the objective function for your data "
@@ -73,8 +74,8 @@ PARAM_DOUBLE("decision_boundary", "Decision boundary for prediction; if the "
     "taken to be 0; otherwise, the class is 1.", "d", 0.5);
 
 PARAM_DOUBLE("lambda", "L2-regularization parameter for training.", "l", 0.0);
-PARAM_STRING("optimizer", "Optimizer to use for training ('lbfgs' or 'sgd').",
-    "O", "lbfgs");
+PARAM_STRING("optimizer", "Optimizer to use for training ('lbfgs', 'sgd', or "
+    "'adam').", "O", "lbfgs");
 PARAM_DOUBLE("tolerance", "Convergence tolerance for optimizer.", "T", 1e-10);
 PARAM_INT("max_iterations", "Maximum iterations for optimizer (0 indicates no "
     "limit).", "M", 0);
@@ -121,9 +122,10 @@ int main(int argc, char** argv)
     Log::Fatal << "Tolerance must be positive (received " << tolerance << ")."
         << endl;
 
-  // Optimizer has to be L-BFGS or SGD.
-  if (optimizerType != "lbfgs" && optimizerType != "sgd")
-    Log::Fatal << "--optimizer must be 'lbfgs' or 'sgd'." << endl;
+  // Optimizer has to be L-BFGS, SGD, or SGD with Adam steps.
+  if (optimizerType != "lbfgs" && optimizerType != "sgd" &&
+      optimizerType != "adam")
+    Log::Fatal << "--optimizer must be 'lbfgs', 'sgd', or 'adam'." << endl;
 
   // Lambda must be positive.
   if (lambda < 0.0)
@@ -135,7 +137,7 @@ int main(int argc, char** argv)
     Log::Fatal << "Decision boundary (--decision_boundary) must be between 0.0 "
         << "and 1.0 (received " << decisionBoundary << ")." << endl;
 
-  if ((stepSize < 0.0) && (optimizerType == "sgd"))
+  if ((stepSize < 0.0) && (optimizerType != "lbfgs"))
     Log::Fatal << "Step size (--step_size) must be positive (received "
         << stepSize << ")." << endl;
 
@@ -222,6 +224,19 @@ int main(int argc, char** argv)
       // Extract the newly trained model.
       model = lr.Parameters();
     }
+    else if (optimizerType == "adam")
+    {
+      AdamSGD<LogisticRegressionFunction> adamOpt(lrf);
+      adamOpt.MaxIterations() = maxIterations;
+      adamOpt.Tolerance() = tolerance;
+      adamOpt.StepSize() = stepSize;
+      Log::Info << "Training model with SGD optimizer (Adam steps)." << endl;
+
+      // This will train the model.
+      LogisticRegression<AdamSGD> lr(adamOpt);
+      // Extract the newly trained model.
+      model = lr.Parameters();
+    }
   }
 
   if (!testSet.empty())
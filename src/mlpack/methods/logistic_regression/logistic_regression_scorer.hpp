@@ -0,0 +1,99 @@
+/**
+ * @file logistic_regression_scorer.hpp
+ *
+ * The LogisticRegressionScorer class, which predicts with a trained logistic
+ * regression model, for online scoring of batches of points.
+ */
+#ifndef __MLPACK_METHODS_LOGISTIC_REGRESSION_LOGISTIC_REGRESSION_SCORER_HPP
+#define __MLPACK_METHODS_LOGISTIC_REGRESSION_LOGISTIC_REGRESSION_SCORER_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace regression {
+
+/**
+ * A throughput-oriented predictor for a trained logistic regression model (see
+ * LogisticRegression).  The model parameters are copied once, at construction,
+ * into the given element type; with ElemType = float, the parameters and the
+ * points are single precision, which halves the memory bandwidth of the
+ * prediction.
+ *
+ * The points are processed in blocks, in parallel (with OpenMP), and the scores
+ * of a block are computed with one matrix-vector product.  The results are
+ * written into a vector owned by the caller: if it already has the right size,
+ * no memory is allocated.
+ *
+ * @code
+ * LogisticRegression<> lr(trainingPredictors, trainingResponses);
+ * LogisticRegressionScorer<float> scorer(lr.Parameters());
+ *
+ * arma::fmat batch; // Points to score, one per column.
+ * arma::fvec probabilities(batch.n_cols);
+ * scorer.Probabilities(batch, probabilities);
+ * @endcode
+ *
+ * @tparam ElemType Element type of the parameters and the points (double or
+ *     float).
+ */
+template<typename ElemType = double>
+class LogisticRegressionScorer
+{
+ public:
+  /**
+   * Create the scorer from the parameters of a trained model (see
+   * LogisticRegression::Parameters()).
+   *
+   * @param parameters Parameters of the model, the intercept first.
+   */
+  LogisticRegressionScorer(const arma::vec& parameters);
+
+  /**
+   * Compute the probability that the response to each of the given points is
+   * 1.
+   *
+   * @param predictors Points to score, one per column.
+   * @param probabilities Vector to store the probabilities in.
+   */
+  void Probabilities(const arma::Mat<ElemType>& predictors,
+                     arma::Col<ElemType>& probabilities) const;
+
+  /**
+   * Predict the responses (0 or 1) to the given points.  If the probability of
+   * a response of 1 is greater than the decision boundary, the response is 1;
+   * otherwise, it is 0.
+   *
+   * @param predictors Points to predict, one per column.
+   * @param responses Vector to store the predicted responses in.
+   * @param decisionBoundary Decision boundary (default 0.5).
+   */
+  void Predict(const arma::Mat<ElemType>& predictors,
+               arma::Col<ElemType>& responses,
+               const double decisionBoundary = 0.5) const;
+
+  //! Get the intercept.
+  ElemType Intercept() const { return intercept; }
+  //! Get the weights (the parameters without the intercept).
+  const arma::Col<ElemType>& Weights() const { return weights; }
+
+ private:
+  //! The number of points scored together by one thread.
+  static const size_t PointBlockSize = 4096;
+
+  //! Compute the scores (w^T x + b) of the given points into the given vector.
+  void Scores(const arma::Mat<ElemType>& predictors,
+              arma::Col<ElemType>& scores) const;
+
+  //! The intercept of the model.
+  ElemType intercept;
+  //! The weights of the model.
+  arma::Col<ElemType> weights;
+};
+
+}; // namespace regression
+}; // namespace mlpack
+
+// Include implementation.
+#include "logistic_regression_scorer_impl.hpp"
+
+#endif // __MLPACK_METHODS_LOGISTIC_REGRESSION_LOGISTIC_REGRESSION_SCORER_HPP
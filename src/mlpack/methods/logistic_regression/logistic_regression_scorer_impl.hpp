@@ -0,0 +1,96 @@
+/**
+ * @file logistic_regression_scorer_impl.hpp
+ *
+ * Implementation of the LogisticRegressionScorer class.
+ */
+#ifndef __MLPACK_METHODS_LOGISTIC_REGRESSION_LOGISTIC_REGRESSION_SCORER_IMPL_HPP
+#define __MLPACK_METHODS_LOGISTIC_REGRESSION_LOGISTIC_REGRESSION_SCORER_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "logistic_regression_scorer.hpp"
+
+namespace mlpack {
+namespace regression {
+
+template<typename ElemType>
+LogisticRegressionScorer<ElemType>::LogisticRegressionScorer(
+    const arma::vec& parameters) :
+    intercept(ElemType(parameters[0])),
+    weights(arma::conv_to<arma::Col<ElemType> >::from(parameters.subvec(1,
+        parameters.n_elem - 1)))
+{ /* Nothing to do. */ }
+
+template<typename ElemType>
+void LogisticRegressionScorer<ElemType>::Probabilities(
+    const arma::Mat<ElemType>& predictors,
+    arma::Col<ElemType>& probabilities) const
+{
+  Scores(predictors, probabilities);
+
+  ElemType* p = probabilities.memptr();
+  #pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < predictors.n_cols; ++i)
+    p[i] = ElemType(1) / (ElemType(1) + std::exp(-p[i]));
+}
+
+template<typename ElemType>
+void LogisticRegressionScorer<ElemType>::Predict(
+    const arma::Mat<ElemType>& predictors,
+    arma::Col<ElemType>& responses,
+    const double decisionBoundary) const
+{
+  Scores(predictors, responses);
+
+  // sigmoid(s) > decisionBoundary is equivalent to s > logit(decisionBoundary),
+  // so the exponentials are not needed.
+  const ElemType threshold = ElemType(std::log(decisionBoundary /
+      (1.0 - decisionBoundary)));
+
+  ElemType* r = responses.memptr();
+  #pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < predictors.n_cols; ++i)
+    r[i] = (r[i] > threshold) ? ElemType(1) : ElemType(0);
+}
+
+template<typename ElemType>
+void LogisticRegressionScorer<ElemType>::Scores(
+    const arma::Mat<ElemType>& predictors,
+    arma::Col<ElemType>& scores) const
+{
+  if (predictors.n_rows != weights.n_elem)
+  {
+    Log::Fatal << "LogisticRegressionScorer: points have " << predictors.n_rows
+        << " dimensions, but the model has " << weights.n_elem << "!"
+        << std::endl;
+  }
+
+  // This does not reallocate if the caller's vector already has the right
+  // size.
+  scores.set_size(predictors.n_cols);
+
+  const size_t numBlocks = (predictors.n_cols + PointBlockSize - 1) /
+      PointBlockSize;
+
+  #pragma omp parallel for schedule(static)
+  for (size_t b = 0; b < numBlocks; ++b)
+  {
+    const size_t begin = b * PointBlockSize;
+    const size_t size = std::min(begin + PointBlockSize,
+        (size_t) predictors.n_cols) - begin;
+
+    // Aliases of the block of points and of its scores, so the product is
+    // computed in place, without copies.
+    const arma::Mat<ElemType> block(const_cast<ElemType*>(
+        predictors.colptr(begin)), predictors.n_rows, size, false, true);
+    arma::Col<ElemType> blockScores(scores.memptr() + begin, size, false,
+        true);
+
+    blockScores = block.t() * weights;
+    blockScores += intercept;
+  }
+}
+
+}; // namespace regression
+}; // namespace mlpack
+
+#endif // __MLPACK_METHODS_LOGISTIC_REGRESSION_LOGISTIC_REGRESSION_SCORER_IMPL_HPP
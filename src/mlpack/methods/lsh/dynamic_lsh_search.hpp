@@ -0,0 +1,235 @@
+/**
+ * @file dynamic_lsh_search.hpp
+ *
+ * Defines the DynamicLSHSearch class, an LSH index with the same hash family
+ * as LSHSearch (2-stable projections and a second hash), to which reference
+ * points can be added and from which they can be removed without rebuilding
+ * the index.
+ */
+#ifndef __MLPACK_METHODS_LSH_DYNAMIC_LSH_SEARCH_HPP
+#define __MLPACK_METHODS_LSH_DYNAMIC_LSH_SEARCH_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/metrics/lmetric_kernels.hpp>
+#include <mlpack/methods/neighbor_search/sort_policies/nearest_neighbor_sort.hpp>
+
+#include <deque>
+#include <vector>
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * The DynamicLSHSearch class is an LSH index which grows as reference points
+ * are added with Add(), and from which points can be removed with Remove().
+ * The points are hashed as in LSHSearch: each of NumTables() tables has
+ * NumProj() 2-stable projections, the key of a point in a table is the vector
+ * of its quantized projections, and the key is hashed to one of
+ * SecondHashSize() buckets.
+ *
+ * Unlike the buckets of LSHSearch, which are rows of a fixed-width table that
+ * is built once, each bucket is a chain of fixed-size blocks: a point added to
+ * a full bucket spills into a new block linked to the end of the chain, so
+ * buckets never drop points and adding points never moves the existing ones.
+ * The reference points are copied into the index in chunks of ChunkSize
+ * points, which are never reallocated either.  Removed points are only marked
+ * (tombstoned): they stay in their buckets, but are never returned.
+ *
+ * Points are added in batches: the batch is hashed in parallel, the (bucket,
+ * point) pairs are sorted by bucket, and then every bucket which receives
+ * points is extended in parallel, into blocks set aside for it beforehand.
+ * The result does not depend on the number of threads.
+ *
+ * @code
+ * extern arma::mat references, newReferences, queries;
+ * DynamicLSHSearch<> lsh(references, 10, 20);
+ * lsh.Add(newReferences); // Indices continue after those of references.
+ * lsh.Remove(3);
+ *
+ * arma::Mat<size_t> neighbors;
+ * arma::mat distances;
+ * lsh.Search(queries, 5, neighbors, distances);
+ * @endcode
+ *
+ * @tparam SortPolicy The sort policy for distances; see NearestNeighborSort.
+ */
+template<typename SortPolicy = NearestNeighborSort>
+class DynamicLSHSearch
+{
+ public:
+  /**
+   * Create the index and add the given reference points to it.
+   *
+   * @param referenceSet Initial set of reference points (copied into the
+   *     index).
+   * @param numProj Number of projections in each hash table.
+   * @param numTables Number of hash tables.
+   * @param hashWidth The width of the hash for every table.  If 0 (the
+   *     default), the average distance between 25 random pairs of the initial
+   *     reference points is used, as in LSHSearch.
+   * @param secondHashSize The number of buckets of the second hash.  This
+   *     should be a large prime number.
+   */
+  DynamicLSHSearch(const arma::mat& referenceSet,
+                   const size_t numProj,
+                   const size_t numTables,
+                   const double hashWidth = 0.0,
+                   const size_t secondHashSize = 99901);
+
+  /**
+   * Create an empty index for points of the given dimensionality.  Since there
+   * are no points to choose the hash width from, it must be given.
+   *
+   * @param dimensionality Dimensionality of the points.
+   * @param numProj Number of projections in each hash table.
+   * @param numTables Number of hash tables.
+   * @param hashWidth The width of the hash for every table.
+   * @param secondHashSize The number of buckets of the second hash.  This
+   *     should be a large prime number.
+   */
+  DynamicLSHSearch(const size_t dimensionality,
+                   const size_t numProj,
+                   const size_t numTables,
+                   const double hashWidth,
+                   const size_t secondHashSize = 99901);
+
+  /**
+   * Copy the given points into the index and hash them into every table.
+   * Their indices follow those of the points already added (including removed
+   * points).
+   *
+   * @param points Points to add.
+   */
+  void Add(const arma::mat& points);
+
+  /**
+   * Remove the point with the given index from the index.  The point is only
+   * marked as removed, so its index is never reused.
+   *
+   * @param index Index of the point to remove.
+   */
+  void Remove(const size_t index);
+
+  /**
+   * Find the approximate k nearest neighbors of each query point among the
+   * reference points which have not been removed.  The matrices will be set
+   * to k rows and one column per query point; neighbors which are not found
+   * have the index Size() and the worst distance of the sort policy.
+   *
+   * @param querySet Set of query points.
+   * @param k Number of neighbors to search for.
+   * @param resultingNeighbors Matrix to store the indices of the neighbors in.
+   * @param distances Matrix to store the squared Euclidean distances to the
+   *     neighbors in (as with LSHSearch).
+   * @param numTablesToSearch The number of hash tables to search (0, the
+   *     default, searches all of them).
+   */
+  void Search(const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& resultingNeighbors,
+              arma::mat& distances,
+              const size_t numTablesToSearch = 0) const;
+
+  //! Get the number of points added (including removed points).
+  size_t Size() const { return size; }
+  //! Get the number of points removed.
+  size_t NumRemoved() const { return numRemoved; }
+  //! Return whether the point with the given index was removed.
+  bool Removed(const size_t index) const { return removed[index] != 0; }
+  //! Get the dimensionality of the points.
+  size_t Dimensionality() const { return dimensionality; }
+
+  //! Get the number of projections in each table.
+  size_t NumProj() const { return numProj; }
+  //! Get the number of hash tables.
+  size_t NumTables() const { return numTables; }
+  //! Get the hash width.
+  double HashWidth() const { return hashWidth; }
+  //! Get the number of buckets of the second hash.
+  size_t SecondHashSize() const { return secondHashSize; }
+
+  //! Get the number of points in the given bucket (including removed points).
+  size_t BucketSize(const size_t bucket) const;
+
+  //! Get the number of threads used (0 means all available threads).
+  size_t NumThreads() const { return numThreads; }
+  //! Modify the number of threads used (0 means all available threads).  This
+  //! only has an effect if OpenMP is available.
+  size_t& NumThreads() { return numThreads; }
+
+ private:
+  /**
+   * Draw the projections, offsets and second hash weights.
+   */
+  void Initialize();
+
+  /**
+   * Hash the given points into the first numTablesToSearch tables: buckets(t,
+   * i) is the bucket of point i in table t.
+   */
+  void ComputeBuckets(const arma::mat& points,
+                      const size_t numTablesToSearch,
+                      arma::Mat<size_t>& buckets) const;
+
+  //! Return the reference point with the given index.
+  const double* Point(const size_t index) const
+  { return chunks[index / ChunkSize].colptr(index % ChunkSize); }
+
+  //! The number of reference points in each chunk of the storage.
+  static const size_t ChunkSize = 4096;
+  //! The number of point indices in each block of a bucket chain.
+  static const size_t BlockCapacity = 16;
+  //! The block index which marks the end of a chain (or an empty bucket).
+  static const size_t NoBlock = size_t(-1);
+  //! The number of points hashed or searched together.
+  static const size_t PointBlockSize = 1024;
+
+  //! The dimensionality of the points.
+  size_t dimensionality;
+  //! The number of projections in each table.
+  size_t numProj;
+  //! The number of hash tables.
+  size_t numTables;
+  //! The hash width.
+  double hashWidth;
+  //! The number of buckets of the second hash.
+  size_t secondHashSize;
+
+  //! The projection matrix of each table (dimensionality x numProj).
+  std::vector<arma::mat> projections;
+  //! The offset of each projection of each table (numProj x numTables).
+  arma::mat offsets;
+  //! The weights of the second hash.
+  arma::vec secondHashWeights;
+
+  //! The reference points, ChunkSize to a chunk.
+  std::deque<arma::mat> chunks;
+  //! The number of points added.
+  size_t size;
+  //! Whether each point was removed.
+  std::vector<char> removed;
+  //! The number of points removed.
+  size_t numRemoved;
+
+  //! The first block of the chain of each bucket.
+  std::vector<size_t> bucketHead;
+  //! The last block of the chain of each bucket.
+  std::vector<size_t> bucketTail;
+  //! The point indices in each block, BlockCapacity to a block.
+  std::vector<size_t> blockPoints;
+  //! The number of point indices in each block.
+  std::vector<size_t> blockCount;
+  //! The next block in the chain of each block.
+  std::vector<size_t> blockNext;
+
+  //! The number of threads used.
+  size_t numThreads;
+};
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+// Include implementation.
+#include "dynamic_lsh_search_impl.hpp"
+
+#endif
@@ -0,0 +1,398 @@
+/**
+ * @file dynamic_lsh_search_impl.hpp
+ *
+ * Implementation of the DynamicLSHSearch class.
+ */
+#ifndef __MLPACK_METHODS_LSH_DYNAMIC_LSH_SEARCH_IMPL_HPP
+#define __MLPACK_METHODS_LSH_DYNAMIC_LSH_SEARCH_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "dynamic_lsh_search.hpp"
+
+#include <algorithm>
+
+namespace mlpack {
+namespace neighbor {
+
+template<typename SortPolicy>
+const size_t DynamicLSHSearch<SortPolicy>::NoBlock;
+
+template<typename SortPolicy>
+DynamicLSHSearch<SortPolicy>::
+DynamicLSHSearch(const arma::mat& referenceSet,
+                 const size_t numProj,
+                 const size_t numTables,
+                 const double hashWidthIn,
+                 const size_t secondHashSize) :
+    dimensionality(referenceSet.n_rows),
+    numProj(numProj),
+    numTables(numTables),
+    hashWidth(hashWidthIn),
+    secondHashSize(secondHashSize),
+    size(0),
+    numRemoved(0),
+    numThreads(1)
+{
+  if (hashWidth == 0.0 && referenceSet.n_cols > 0)
+  {
+    // Compute a heuristic hash width from the data, as LSHSearch does.
+    for (size_t i = 0; i < 25; i++)
+    {
+      const size_t p1 = (size_t) math::RandInt(referenceSet.n_cols);
+      const size_t p2 = (size_t) math::RandInt(referenceSet.n_cols);
+
+      hashWidth += std::sqrt(metric::SquaredDistanceKernel(
+          referenceSet.colptr(p1), referenceSet.colptr(p2), dimensionality));
+    }
+
+    hashWidth /= 25;
+  }
+
+  Log::Info << "Hash width chosen as: " << hashWidth << std::endl;
+
+  Initialize();
+  Add(referenceSet);
+}
+
+template<typename SortPolicy>
+DynamicLSHSearch<SortPolicy>::
+DynamicLSHSearch(const size_t dimensionality,
+                 const size_t numProj,
+                 const size_t numTables,
+                 const double hashWidth,
+                 const size_t secondHashSize) :
+    dimensionality(dimensionality),
+    numProj(numProj),
+    numTables(numTables),
+    hashWidth(hashWidth),
+    secondHashSize(secondHashSize),
+    size(0),
+    numRemoved(0),
+    numThreads(1)
+{
+  Initialize();
+}
+
+template<typename SortPolicy>
+void DynamicLSHSearch<SortPolicy>::Initialize()
+{
+  if (numProj == 0 || numTables == 0)
+  {
+    Log::Fatal << "DynamicLSHSearch: the number of projections and the number "
+        << "of tables must be positive." << std::endl;
+  }
+
+  if (secondHashSize == 0)
+  {
+    Log::Fatal << "DynamicLSHSearch: the size of the second hash must be "
+        << "positive." << std::endl;
+  }
+
+  if (!(hashWidth > 0.0))
+  {
+    Log::Fatal << "DynamicLSHSearch: the hash width must be positive (it is "
+        << hashWidth << ")." << std::endl;
+  }
+
+  // The projections are 2-stable (Gaussian), and the offsets are in
+  // [0, hashWidth), as in LSHSearch.
+  projections.resize(numTables);
+  for (size_t i = 0; i < numTables; i++)
+    projections[i].randn(dimensionality, numProj);
+
+  offsets.randu(numProj, numTables);
+  offsets *= hashWidth;
+
+  secondHashWeights = arma::floor(arma::randu(numProj) *
+                                  (double) secondHashSize);
+
+  bucketHead.assign(secondHashSize, NoBlock);
+  bucketTail.assign(secondHashSize, NoBlock);
+}
+
+template<typename SortPolicy>
+void DynamicLSHSearch<SortPolicy>::Add(const arma::mat& points)
+{
+  if (points.n_rows != dimensionality)
+  {
+    Log::Fatal << "DynamicLSHSearch::Add(): the points have " << points.n_rows
+        << " dimensions, but the index has " << dimensionality << "."
+        << std::endl;
+  }
+
+  const size_t n = points.n_cols;
+  if (n == 0)
+    return;
+
+  // Copy the points into the chunks, starting new chunks as they fill up.
+  const size_t first = size;
+  for (size_t i = 0; i < n; )
+  {
+    const size_t offset = (first + i) % ChunkSize;
+    if (offset == 0)
+      chunks.push_back(arma::mat(dimensionality, ChunkSize));
+
+    const size_t count = std::min(n - i, ChunkSize - offset);
+    chunks.back().cols(offset, offset + count - 1) =
+        points.cols(i, i + count - 1);
+    i += count;
+  }
+
+  size += n;
+  removed.resize(size, 0);
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads(numThreads);
+#else
+  const size_t threads = 1;
+#endif
+
+  // Hash every new point into every table; entry (t * n + i) is the (bucket,
+  // index) pair of point i in table t.
+  std::vector<std::pair<size_t, size_t> > entries(numTables * n);
+  const size_t numBlocks = (n + PointBlockSize - 1) / PointBlockSize;
+
+  #pragma omp parallel num_threads(threads) if(threads > 1)
+  {
+    arma::Mat<size_t> buckets;
+
+    #pragma omp for schedule(static)
+    for (size_t block = 0; block < numBlocks; ++block)
+    {
+      const size_t begin = block * PointBlockSize;
+      const size_t end = std::min(begin + PointBlockSize, n);
+      ComputeBuckets(points.cols(begin, end - 1), numTables, buckets);
+
+      for (size_t i = begin; i < end; ++i)
+        for (size_t t = 0; t < numTables; ++t)
+          entries[t * n + i] = std::make_pair(buckets(t, i - begin), first + i);
+    }
+  }
+
+  // Group the entries by bucket; within a bucket, the points stay in the order
+  // they were added.
+  std::sort(entries.begin(), entries.end());
+
+  // Find the run of entries of each bucket, and set aside the new blocks each
+  // bucket will need once the free space of its last block is used up.
+  std::vector<size_t> runStart;
+  std::vector<size_t> runFirstBlock;
+  const size_t oldBlocks = blockCount.size();
+  size_t newBlocks = 0;
+  for (size_t e = 0; e < entries.size(); )
+  {
+    const size_t bucket = entries[e].first;
+    size_t end = e + 1;
+    while (end < entries.size() && entries[end].first == bucket)
+      ++end;
+
+    const size_t tail = bucketTail[bucket];
+    const size_t space = (tail == NoBlock) ? 0 :
+        BlockCapacity - blockCount[tail];
+    const size_t spill = (end - e > space) ? (end - e - space) : 0;
+
+    runStart.push_back(e);
+    runFirstBlock.push_back(oldBlocks + newBlocks);
+    newBlocks += (spill + BlockCapacity - 1) / BlockCapacity;
+    e = end;
+  }
+  runStart.push_back(entries.size());
+
+  blockPoints.resize((oldBlocks + newBlocks) * BlockCapacity);
+  blockCount.resize(oldBlocks + newBlocks, 0);
+  blockNext.resize(oldBlocks + newBlocks, NoBlock);
+
+  // Each run only touches the chain of its own bucket and the blocks set aside
+  // for it, so the runs can be inserted in parallel.
+  const size_t numRuns = runFirstBlock.size();
+  #pragma omp parallel for num_threads(threads) if(threads > 1) \
+      schedule(dynamic, 64)
+  for (size_t r = 0; r < numRuns; ++r)
+  {
+    const size_t bucket = entries[runStart[r]].first;
+    size_t block = bucketTail[bucket];
+    size_t nextBlock = runFirstBlock[r];
+
+    for (size_t e = runStart[r]; e < runStart[r + 1]; ++e)
+    {
+      if (block == NoBlock || blockCount[block] == BlockCapacity)
+      {
+        // Spill into the next block set aside for this bucket.
+        if (block == NoBlock)
+          bucketHead[bucket] = nextBlock;
+        else
+          blockNext[block] = nextBlock;
+        block = nextBlock++;
+      }
+
+      blockPoints[block * BlockCapacity + blockCount[block]] =
+          entries[e].second;
+      ++blockCount[block];
+    }
+
+    bucketTail[bucket] = block;
+  }
+
+  Log::Info << "Added " << n << " points to the LSH index (" << size
+      << " points in " << blockCount.size() << " blocks)." << std::endl;
+}
+
+template<typename SortPolicy>
+void DynamicLSHSearch<SortPolicy>::Remove(const size_t index)
+{
+  if (index >= size)
+  {
+    Log::Fatal << "DynamicLSHSearch::Remove(): there is no point with index "
+        << index << " (the index has " << size << " points)." << std::endl;
+  }
+
+  if (!removed[index])
+  {
+    removed[index] = 1;
+    ++numRemoved;
+  }
+}
+
+template<typename SortPolicy>
+size_t DynamicLSHSearch<SortPolicy>::BucketSize(const size_t bucket) const
+{
+  size_t count = 0;
+  for (size_t block = bucketHead[bucket]; block != NoBlock;
+       block = blockNext[block])
+    count += blockCount[block];
+
+  return count;
+}
+
+template<typename SortPolicy>
+void DynamicLSHSearch<SortPolicy>::
+ComputeBuckets(const arma::mat& points,
+               const size_t numTablesToSearch,
+               arma::Mat<size_t>& buckets) const
+{
+  buckets.set_size(numTablesToSearch, points.n_cols);
+
+  arma::mat projInTable;
+  for (size_t i = 0; i < numTablesToSearch; i++)
+  {
+    // Compute the key of every point in this table at once, and hash the keys
+    // with the second hash, as LSHSearch does.
+    projInTable = projections[i].t() * points;
+    projInTable.each_col() += offsets.unsafe_col(i);
+    projInTable /= hashWidth;
+
+    const arma::rowvec hashVec = secondHashWeights.t() *
+        arma::floor(projInTable);
+
+    for (size_t j = 0; j < hashVec.n_elem; j++)
+      buckets(i, j) = ((size_t) hashVec[j] % secondHashSize);
+  }
+}
+
+template<typename SortPolicy>
+void DynamicLSHSearch<SortPolicy>::
+Search(const arma::mat& querySet,
+       const size_t k,
+       arma::Mat<size_t>& resultingNeighbors,
+       arma::mat& distances,
+       const size_t numTablesToSearch) const
+{
+  if (querySet.n_rows != dimensionality)
+  {
+    Log::Fatal << "DynamicLSHSearch::Search(): the query points have "
+        << querySet.n_rows << " dimensions, but the index has "
+        << dimensionality << "." << std::endl;
+  }
+
+  if (k == 0)
+  {
+    Log::Fatal << "DynamicLSHSearch::Search(): k must be positive."
+        << std::endl;
+  }
+
+  const size_t tables = (numTablesToSearch == 0 ||
+      numTablesToSearch > numTables) ? numTables : numTablesToSearch;
+
+  resultingNeighbors.set_size(k, querySet.n_cols);
+  distances.set_size(k, querySet.n_cols);
+  resultingNeighbors.fill(size);
+  distances.fill(SortPolicy::WorstDistance());
+
+  const size_t numBlocks = (querySet.n_cols + PointBlockSize - 1) /
+      PointBlockSize;
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads(numThreads);
+#else
+  const size_t threads = 1;
+#endif
+
+  Timer::Start("computing_neighbors");
+
+  #pragma omp parallel num_threads(threads) if(threads > 1)
+  {
+    arma::Mat<size_t> buckets;
+    std::vector<size_t> candidates;
+
+    #pragma omp for schedule(dynamic)
+    for (size_t block = 0; block < numBlocks; ++block)
+    {
+      const size_t begin = block * PointBlockSize;
+      const size_t end = std::min(begin + PointBlockSize,
+          (size_t) querySet.n_cols);
+      ComputeBuckets(querySet.cols(begin, end - 1), tables, buckets);
+
+      for (size_t q = begin; q < end; ++q)
+      {
+        // Collect the points in the chains of the query's buckets which have
+        // not been removed.
+        candidates.clear();
+        for (size_t t = 0; t < tables; ++t)
+        {
+          for (size_t b = bucketHead[buckets(t, q - begin)]; b != NoBlock;
+               b = blockNext[b])
+          {
+            const size_t* points = &blockPoints[b * BlockCapacity];
+            for (size_t j = 0; j < blockCount[b]; ++j)
+              if (!removed[points[j]])
+                candidates.push_back(points[j]);
+          }
+        }
+
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()),
+            candidates.end());
+
+        arma::vec queryDist = distances.unsafe_col(q);
+        arma::Col<size_t> queryIndices = resultingNeighbors.unsafe_col(q);
+        for (size_t c = 0; c < candidates.size(); ++c)
+        {
+          const double distance = metric::SquaredDistanceKernel(
+              querySet.colptr(q), Point(candidates[c]), dimensionality);
+
+          // SortDistance() returns (size_t() - 1) if we shouldn't add it.
+          const size_t pos = SortPolicy::SortDistance(queryDist, queryIndices,
+              distance);
+          if (pos == (size_t() - 1))
+            continue;
+
+          for (size_t j = k - 1; j > pos; --j)
+          {
+            queryDist[j] = queryDist[j - 1];
+            queryIndices[j] = queryIndices[j - 1];
+          }
+
+          queryDist[pos] = distance;
+          queryIndices[pos] = candidates[c];
+        }
+      }
+    }
+  }
+
+  Timer::Stop("computing_neighbors");
+}
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
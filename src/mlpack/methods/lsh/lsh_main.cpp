@@ -41,7 +41,23 @@ PROGRAM_INFO("All K-Approximate-Nearest-Neighbor Search with LSH",
     "\n\n"
     "Because this is approximate-nearest-neighbors search, results may be "
     "different from run to run.  Thus, the --seed option can be specified to "
-    "set the random seed.");
+    "set the random seed."
+    "\n\n"
+    "The hash can be saved to a file with the --output_index_file option, and "
+    "a saved hash can be loaded again with the --input_index_file option, "
+    "instead of being rebuilt.  A loaded index file is memory-mapped, so it is "
+    "fast to load and its memory is shared between processes that use the "
+    "same index file.  The same reference set that the hash was built on must "
+    "be given."
+    "\n\n"
+    "With --curve_order ('morton' or 'hilbert'), the query and reference "
+    "points are rearranged along the Morton or Hilbert space-filling curve "
+    "before the search, so that consecutive queries are near each other and "
+    "probe the same buckets, and the points of a bucket are near each other in "
+    "memory; the results are saved with the original indices and in the "
+    "original order.  The reference set is not rearranged if the hash is "
+    "loaded or saved, since a saved hash refers to the points in their "
+    "original order.");
 
 // Define our input parameters that this program will take.
 PARAM_STRING_REQ("reference_file", "File containing the reference dataset.",
@@ -63,7 +79,21 @@ PARAM_INT("second_hash_size", "The size of the second level hash table.", "M",
     99901);
 PARAM_INT("bucket_size", "The size of a bucket in the second level hash.", "B",
     500);
+PARAM_STRING("input_index_file", "File containing a hash saved with "
+    "--output_index_file.  If given, the hash is not rebuilt, and "
+    "--projections, --tables, --hash_width, --second_hash_size and "
+    "--bucket_size are ignored.", "i", "");
+PARAM_STRING("output_index_file", "If specified, the hash will be saved to "
+    "this file.", "o", "");
+PARAM_INT("num_probes", "Number of additional buckets to probe in each hash "
+    "table (multiprobe LSH).  If 0, only the bucket the query hashes to is "
+    "searched.", "T", 0);
 PARAM_INT("seed", "Random seed.  If 0, 'std::time(NULL)' is used.", "s", 0);
+PARAM_INT("num_threads", "Number of threads to use for the search (0 uses all "
+    "available threads).  This has no effect unless mlpack was built with "
+    "OpenMP.", "t", 1);
+PARAM_STRING("curve_order", "Space-filling curve to rearrange the points along "
+    "before the search: 'none', 'morton', or 'hilbert'.", "", "none");
 
 int main(int argc, char *argv[])
 {
@@ -100,6 +130,29 @@ int main(int argc, char *argv[])
     Log::Fatal << referenceData.n_cols << ")." << endl;
   }
 
+  // Sanity check on the number of probes.
+  if (CLI::GetParam<int>("num_probes") < 0)
+  {
+    Log::Fatal << "Invalid number of probes: "
+        << CLI::GetParam<int>("num_probes") << ".  Must be greater than or "
+        << "equal to 0." << endl;
+  }
+
+  // Sanity check on the number of threads.
+  if (CLI::GetParam<int>("num_threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: "
+        << CLI::GetParam<int>("num_threads") << ".  Must be greater than or "
+        << "equal to 0." << endl;
+  }
+
+  const string curveOrder = CLI::GetParam<string>("curve_order");
+  if (curveOrder != "none" && curveOrder != "morton" && curveOrder != "hilbert")
+  {
+    Log::Fatal << "Invalid curve order: '" << curveOrder << "'; must be "
+        << "'none', 'morton', or 'hilbert'." << endl;
+  }
+
   // Pick up the LSH-specific parameters.
   const size_t numProj = CLI::GetParam<int>("projections");
   const size_t numTables = CLI::GetParam<int>("tables");
@@ -117,32 +170,95 @@ int main(int argc, char *argv[])
               << queryData.n_rows << " x " << queryData.n_cols << ")." << endl;
   }
 
-  if (hashWidth == 0.0)
-    Log::Info << "Using LSH with " << numProj << " projections (K) and " <<
-        numTables << " tables (L) with default hash width." << endl;
-  else
-    Log::Info << "Using LSH with " << numProj << " projections (K) and " <<
-        numTables << " tables (L) with hash width(r): " << hashWidth << endl;
+  // Rearrange the points along the space-filling curve.  The results are mapped
+  // back to the original indices and order before they are saved.
+  std::vector<size_t> oldFromNewRefs;
+  std::vector<size_t> oldFromNewQueries;
+  if (curveOrder != "none")
+  {
+    Timer::Start("curve_ordering");
+    const bool hilbert = (curveOrder == "hilbert");
+    const string inputIndexFile = CLI::GetParam<string>("input_index_file");
+    const string outputIndexFile = CLI::GetParam<string>("output_index_file");
+    if (inputIndexFile == "" && outputIndexFile == "")
+    {
+      if (hilbert)
+        data::HilbertOrder(referenceData, oldFromNewRefs);
+      else
+        data::MortonOrder(referenceData, oldFromNewRefs);
+      data::ReorderColumns(referenceData, oldFromNewRefs);
+    }
 
-  Timer::Start("hash_building");
+    if (CLI::GetParam<string>("query_file") != "")
+    {
+      if (hilbert)
+        data::HilbertOrder(queryData, oldFromNewQueries);
+      else
+        data::MortonOrder(queryData, oldFromNewQueries);
+      data::ReorderColumns(queryData, oldFromNewQueries);
+    }
+    else
+    {
+      // The reference points are the queries.
+      oldFromNewQueries = oldFromNewRefs;
+    }
+    Timer::Stop("curve_ordering");
+  }
 
   LSHSearch<>* allkann;
 
-  if (CLI::GetParam<string>("query_file") != "")
-    allkann = new LSHSearch<>(referenceData, queryData, numProj, numTables,
-                              hashWidth, secondHashSize, bucketSize);
+  const string inputIndexFile = CLI::GetParam<string>("input_index_file");
+  if (inputIndexFile != "")
+  {
+    Timer::Start("hash_loading");
+
+    if (CLI::GetParam<string>("query_file") != "")
+      allkann = new LSHSearch<>(referenceData, queryData, inputIndexFile);
+    else
+      allkann = new LSHSearch<>(referenceData, inputIndexFile);
+
+    Timer::Stop("hash_loading");
+  }
   else
-    allkann = new LSHSearch<>(referenceData, numProj, numTables, hashWidth,
-                              secondHashSize, bucketSize);
+  {
+    if (hashWidth == 0.0)
+      Log::Info << "Using LSH with " << numProj << " projections (K) and " <<
+          numTables << " tables (L) with default hash width." << endl;
+    else
+      Log::Info << "Using LSH with " << numProj << " projections (K) and " <<
+          numTables << " tables (L) with hash width(r): " << hashWidth << endl;
+
+    Timer::Start("hash_building");
 
-  Timer::Stop("hash_building");
+    if (CLI::GetParam<string>("query_file") != "")
+      allkann = new LSHSearch<>(referenceData, queryData, numProj, numTables,
+                                hashWidth, secondHashSize, bucketSize);
+    else
+      allkann = new LSHSearch<>(referenceData, numProj, numTables, hashWidth,
+                                secondHashSize, bucketSize);
+
+    Timer::Stop("hash_building");
+  }
+
+  if (CLI::GetParam<string>("output_index_file") != "")
+    allkann->Save(CLI::GetParam<string>("output_index_file"));
 
   Log::Info << "Computing " << k << " distance approximate nearest neighbors "
       << endl;
-  allkann->Search(k, neighbors, distances);
+  allkann->NumThreads() = (size_t) CLI::GetParam<int>("num_threads");
+  allkann->Search(k, neighbors, distances, 0,
+      (size_t) CLI::GetParam<int>("num_probes"));
 
   Log::Info << "Neighbors computed." << endl;
 
+  if (!oldFromNewRefs.empty())
+    data::UnmapIndices(neighbors, oldFromNewRefs);
+  if (!oldFromNewQueries.empty())
+  {
+    data::UnmapColumns(neighbors, oldFromNewQueries);
+    data::UnmapColumns(distances, oldFromNewQueries);
+  }
+
   // Save output.
   if (distancesFile != "")
     data::Save(distancesFile, distances);
@@ -28,6 +28,7 @@
 #include <string>
 
 #include <mlpack/core/metrics/lmetric.hpp>
+#include <mlpack/core/util/mapped_file.hpp>
 #include <mlpack/methods/neighbor_search/sort_policies/nearest_neighbor_sort.hpp>
 
 namespace mlpack {
@@ -100,6 +101,47 @@ class LSHSearch
             const size_t secondHashSize = 99901,
             const size_t bucketSize = 500);
 
+  /**
+   * This function initializes the LSH class with a hash that was previously
+   * built and saved with Save().  The index file is memory-mapped, and the
+   * second hash table (which is by far the largest part of the index) is used
+   * directly from the mapped memory without any copying.  This means that
+   * loading is fast, and that processes which load the same index file share
+   * the memory of the hash table.  The file must remain unchanged while this
+   * object exists.
+   *
+   * The given reference set must be the same as the reference set the hash was
+   * built on.
+   *
+   * @param referenceSet Set of reference points.
+   * @param querySet Set of query points.
+   * @param indexFile File containing the saved hash.
+   */
+  LSHSearch(const arma::mat& referenceSet,
+            const arma::mat& querySet,
+            const std::string& indexFile);
+
+  /**
+   * This function initializes the LSH class with a hash that was previously
+   * built and saved with Save(), using the reference set as the set of queries
+   * too.  See the constructor above for details.
+   *
+   * @param referenceSet Set of reference points and the set of queries.
+   * @param indexFile File containing the saved hash.
+   */
+  LSHSearch(const arma::mat& referenceSet,
+            const std::string& indexFile);
+
+  /**
+   * Save the hash (the projections, offsets, second hash weights and the
+   * second hash table) to the given file in a binary format, so that it can
+   * later be loaded with the constructors that take an index file.  The
+   * reference set itself is not saved.
+   *
+   * @param indexFile File to save the hash to.
+   */
+  void Save(const std::string& indexFile) const;
+
   /**
    * Compute the nearest neighbors and store the output in the given matrices.
    * The matrices will be set to the size of n columns by k rows, where n is
@@ -117,15 +159,34 @@ class LSHSearch
    *     available without having to build hashing for every table size.
    *     By default, this is set to zero in which case all tables are
    *     considered.
+   * @param numProbes The number of additional buckets to probe in each table
+   *     (multiprobe LSH).  For each table, the query's key is perturbed by +1
+   *     or -1 along the projections where the query lies closest to a bucket
+   *     boundary, and the buckets of the 'numProbes' closest perturbed keys
+   *     are searched too.  This lets a few tables reach the recall of many.
+   *     If 0 (the default), only the query's own bucket is searched.
+   *
+   * The queries are processed in blocks of QueryBlockSize points; for each
+   * block the buckets in every table are computed at once, and then the
+   * candidates of each query are evaluated.  If NumThreads() is not 1, the
+   * blocks are split across threads, each with its own scratch buffers.
    */
   void Search(const size_t k,
               arma::Mat<size_t>& resultingNeighbors,
               arma::mat& distances,
-              const size_t numTablesToSearch = 0);
+              const size_t numTablesToSearch = 0,
+              const size_t numProbes = 0);
 
   // Returns a string representation of this object. 
   std::string ToString() const;
 
+  //! Get the number of threads used for searching (0 means all available
+  //! threads).
+  size_t NumThreads() const { return numThreads; }
+  //! Modify the number of threads used for searching (0 means all available
+  //! threads).  This only has an effect if OpenMP is available.
+  size_t& NumThreads() { return numThreads; }
+
  private:
   /**
    * This function builds a hash table with two levels of hashing as presented
@@ -143,19 +204,53 @@ class LSHSearch
   void BuildHash();
 
   /**
-   * This function takes a query and hashes it into each of the hash tables to
-   * get keys for the query and then the key is hashed to a bucket of the second
-   * hash table and all the points (if any) in those buckets are collected as
-   * the potential neighbor candidates.
+   * This function sets up the hash from the mapped index file: the
+   * projections, offsets and second hash weights are copied out of the file,
+   * after checking that the index matches the reference set.  The second hash
+   * table and the bucket arrays are set up by the constructor, to use the
+   * mapped memory directly.
+   */
+  void LoadHash();
+
+  /**
+   * This function hashes a block of queries into each of the first
+   * 'numTablesToSearch' hash tables to get the keys for each query, and then
+   * hashes each key to a bucket of the second hash table.  The projection for
+   * each table is done for the whole block at once with a single matrix
+   * multiplication.
+   *
+   * If numProbes is greater than zero, then for each table the buckets of the
+   * 'numProbes' perturbed keys closest to the query are also returned.  A
+   * perturbed key differs from the query's key by +1 or -1 in one coordinate;
+   * the closest perturbed keys are those whose coordinate is nearest to the
+   * bucket boundary.
+   *
+   * @param queries The block of query points to hash.
+   * @param numTablesToSearch The number of tables to hash the queries into.
+   * @param numProbes The number of additional buckets to probe in each table.
+   * @param buckets The matrix to store the bucket indices in; this will be of
+   *    size (numTablesToSearch * (numProbes + 1)) x queries.n_cols.
+   */
+  void ComputeBuckets(const arma::mat& queries,
+                      const size_t numTablesToSearch,
+                      const size_t numProbes,
+                      arma::Mat<size_t>& buckets) const;
+
+  /**
+   * This function collects all the points (if any) in the second hash table
+   * buckets that a query was hashed into as the potential neighbor candidates.
+   * The candidates are deduplicated by sorting, so the cost depends only on the
+   * number of points in the buckets and not on the size of the reference set.
    *
-   * @param queryIndex The index of the query currently being processed.
+   * @param queryBuckets The buckets the query was hashed into (one for each
+   *    table to search), as computed by ComputeBuckets().
    * @param referenceIndices The list of neighbor candidates obtained from
    *    hashing the query into all the hash tables and eventually into
-   *    multiple buckets of the second hash table.
+   *    multiple buckets of the second hash table.  The memory of this vector
+   *    is reused between calls.
    */
-  void ReturnIndicesFromTable(const size_t queryIndex,
-                              arma::uvec& referenceIndices,
-                              size_t numTablesToSearch);
+  void ReturnIndicesFromTable(const arma::Col<size_t>& queryBuckets,
+                              std::vector<size_t>& referenceIndices) const;
 
   /**
    * This is a helper function that computes the distance of the query to the
@@ -166,6 +261,28 @@ class LSHSearch
    */
   double BaseCase(const size_t queryIndex, const size_t referenceIndex);
 
+  /**
+   * Return the given field of the header of a saved index file, checking that
+   * the file is actually a saved index.
+   *
+   * @param file The mapped index file.
+   * @param field The index of the field in the header.
+   */
+  static size_t IndexHeaderField(const util::MappedFile& file,
+                                 const size_t field);
+
+  /**
+   * Return a pointer to the beginning of the given array in a saved index file.
+   * The arrays are, in order: the offsets, the projections, the second hash
+   * weights, the bucket content sizes, the bucket rows, and the second hash
+   * table.
+   *
+   * @param file The mapped index file.
+   * @param array The index of the array.
+   */
+  static const char* IndexArray(const util::MappedFile& file,
+                                const size_t array);
+
   /**
    * This is a helper function that efficiently inserts better neighbor
    * candidates into an existing set of neighbor candidates. This function is
@@ -187,6 +304,9 @@ class LSHSearch
   //! Query dataset (may not be given).
   const arma::mat& querySet;
 
+  //! The mapped index file, if the hash was loaded from a file.
+  util::MappedFile indexFile;
+
   //! The number of projections
   const size_t numProj;
 
@@ -214,6 +334,9 @@ class LSHSearch
   //! Instantiation of the metric.
   metric::SquaredEuclideanDistance metric;
 
+  //! The number of queries hashed at once during Search().
+  static const size_t QueryBlockSize = 1024;
+
   //! The final hash table; should be (< secondHashSize) x bucketSize.
   arma::Mat<size_t> secondHashTable;
 
@@ -230,6 +353,9 @@ class LSHSearch
 
   //! The pointer to the nearest neighbor indices.
   arma::Mat<size_t>* neighborPtr;
+
+  //! The number of threads to use for searching.
+  size_t numThreads;
 }; // class LSHSearch
 
 }; // namespace neighbor
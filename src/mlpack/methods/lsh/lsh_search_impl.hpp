@@ -8,6 +8,8 @@
 #define __MLPACK_METHODS_NEIGHBOR_SEARCH_LSH_SEARCH_IMPL_HPP
 
 #include <mlpack/core.hpp>
+#include <cstring>
+#include <fstream>
 
 namespace mlpack {
 namespace neighbor {
@@ -28,7 +30,8 @@ LSHSearch(const arma::mat& referenceSet,
   numTables(numTables),
   hashWidth(hashWidthIn),
   secondHashSize(secondHashSize),
-  bucketSize(bucketSize)
+  bucketSize(bucketSize),
+  numThreads(1)
 {
   if (hashWidth == 0.0) // The user has not provided any value.
   {
@@ -64,7 +67,8 @@ LSHSearch(const arma::mat& referenceSet,
   numTables(numTables),
   hashWidth(hashWidthIn),
   secondHashSize(secondHashSize),
-  bucketSize(bucketSize)
+  bucketSize(bucketSize),
+  numThreads(1)
 {
   if (hashWidth == 0.0) // The user has not provided any value.
   {
@@ -86,6 +90,232 @@ LSHSearch(const arma::mat& referenceSet,
   BuildHash();
 }
 
+// The layout of a saved index file: a header of IndexHeaderSize 8-byte fields,
+// followed by the arrays of the index.  Every array holds 8-byte elements, so
+// each of them is suitably aligned to be used in place.
+namespace lsh_index {
+
+//! The magic string at the beginning of every index file.
+static const char IndexMagic[8] = { 'M', 'L', 'P', 'K', 'L', 'S', 'H', '1' };
+
+//! Fields of the header.
+enum HeaderField
+{
+  MagicField = 0,
+  SizeofSizeTField,
+  NumProjField,
+  NumTablesField,
+  DimensionalityField,
+  HashWidthField,
+  SecondHashSizeField,
+  BucketSizeField,
+  TableRowsField,
+  TableColsField,
+  IndexHeaderSize
+};
+
+//! Arrays following the header.
+enum Array
+{
+  OffsetsArray = 0,
+  ProjectionsArray,
+  SecondHashWeightsArray,
+  BucketContentSizeArray,
+  BucketRowInHashTableArray,
+  SecondHashTableArray,
+  NumArrays
+};
+
+}; // namespace lsh_index
+
+template<typename SortPolicy>
+LSHSearch<SortPolicy>::
+LSHSearch(const arma::mat& referenceSet,
+          const arma::mat& querySet,
+          const std::string& indexFilename) :
+  referenceSet(referenceSet),
+  querySet(querySet),
+  indexFile(indexFilename),
+  numProj(IndexHeaderField(indexFile, lsh_index::NumProjField)),
+  numTables(IndexHeaderField(indexFile, lsh_index::NumTablesField)),
+  secondHashSize(IndexHeaderField(indexFile, lsh_index::SecondHashSizeField)),
+  bucketSize(IndexHeaderField(indexFile, lsh_index::BucketSizeField)),
+  secondHashTable((size_t*) IndexArray(indexFile,
+      lsh_index::SecondHashTableArray),
+      IndexHeaderField(indexFile, lsh_index::TableRowsField),
+      IndexHeaderField(indexFile, lsh_index::TableColsField), false, true),
+  bucketContentSize((size_t*) IndexArray(indexFile,
+      lsh_index::BucketContentSizeArray), secondHashSize, false, true),
+  bucketRowInHashTable((size_t*) IndexArray(indexFile,
+      lsh_index::BucketRowInHashTableArray), secondHashSize, false, true),
+  numThreads(1)
+{
+  LoadHash();
+}
+
+template<typename SortPolicy>
+LSHSearch<SortPolicy>::
+LSHSearch(const arma::mat& referenceSet,
+          const std::string& indexFilename) :
+  referenceSet(referenceSet),
+  querySet(referenceSet),
+  indexFile(indexFilename),
+  numProj(IndexHeaderField(indexFile, lsh_index::NumProjField)),
+  numTables(IndexHeaderField(indexFile, lsh_index::NumTablesField)),
+  secondHashSize(IndexHeaderField(indexFile, lsh_index::SecondHashSizeField)),
+  bucketSize(IndexHeaderField(indexFile, lsh_index::BucketSizeField)),
+  secondHashTable((size_t*) IndexArray(indexFile,
+      lsh_index::SecondHashTableArray),
+      IndexHeaderField(indexFile, lsh_index::TableRowsField),
+      IndexHeaderField(indexFile, lsh_index::TableColsField), false, true),
+  bucketContentSize((size_t*) IndexArray(indexFile,
+      lsh_index::BucketContentSizeArray), secondHashSize, false, true),
+  bucketRowInHashTable((size_t*) IndexArray(indexFile,
+      lsh_index::BucketRowInHashTableArray), secondHashSize, false, true),
+  numThreads(1)
+{
+  LoadHash();
+}
+
+template<typename SortPolicy>
+void LSHSearch<SortPolicy>::LoadHash()
+{
+  const size_t dimensionality = IndexHeaderField(indexFile,
+      lsh_index::DimensionalityField);
+  if (dimensionality != referenceSet.n_rows)
+  {
+    Log::Fatal << "LSH index in '" << indexFile.Filename() << "' has "
+        << "dimensionality " << dimensionality << ", but the reference set has "
+        << "dimensionality " << referenceSet.n_rows << "!" << std::endl;
+  }
+
+  // The hash width is stored as a double.
+  const uint64_t hashWidthField = IndexHeaderField(indexFile,
+      lsh_index::HashWidthField);
+  memcpy(&hashWidth, &hashWidthField, sizeof(double));
+
+  // The small parts of the index are copied out of the file.
+  offsets = arma::mat((const double*) IndexArray(indexFile,
+      lsh_index::OffsetsArray), numProj, numTables);
+
+  const double* projPtr = (const double*) IndexArray(indexFile,
+      lsh_index::ProjectionsArray);
+  for (size_t i = 0; i < numTables; i++)
+    projections.push_back(arma::mat(projPtr + i * dimensionality * numProj,
+        dimensionality, numProj));
+
+  secondHashWeights = arma::vec((const double*) IndexArray(indexFile,
+      lsh_index::SecondHashWeightsArray), numProj);
+
+  Log::Info << "Loaded LSH index from '" << indexFile.Filename() << "' ("
+      << numTables << " tables, hash table size " << secondHashTable.n_rows
+      << " x " << secondHashTable.n_cols << ")." << std::endl;
+}
+
+template<typename SortPolicy>
+size_t LSHSearch<SortPolicy>::
+IndexHeaderField(const util::MappedFile& file, const size_t field)
+{
+  if (file.Size() < lsh_index::IndexHeaderSize * sizeof(uint64_t) ||
+      memcmp(file.Data(), lsh_index::IndexMagic, 8) != 0)
+  {
+    Log::Fatal << "File '" << file.Filename() << "' is not an LSH index!"
+        << std::endl;
+  }
+
+  const uint64_t* header = (const uint64_t*) file.Data();
+  if (header[lsh_index::SizeofSizeTField] != sizeof(size_t))
+  {
+    Log::Fatal << "LSH index in '" << file.Filename() << "' was saved on a "
+        << "platform with " << header[lsh_index::SizeofSizeTField] << "-byte "
+        << "size_t; it cannot be loaded here." << std::endl;
+  }
+
+  return (size_t) header[field];
+}
+
+template<typename SortPolicy>
+const char* LSHSearch<SortPolicy>::
+IndexArray(const util::MappedFile& file, const size_t array)
+{
+  const size_t numProj = IndexHeaderField(file, lsh_index::NumProjField);
+  const size_t numTables = IndexHeaderField(file, lsh_index::NumTablesField);
+  const size_t dimensionality = IndexHeaderField(file,
+      lsh_index::DimensionalityField);
+  const size_t secondHashSize = IndexHeaderField(file,
+      lsh_index::SecondHashSizeField);
+  const size_t tableSize = IndexHeaderField(file, lsh_index::TableRowsField) *
+      IndexHeaderField(file, lsh_index::TableColsField);
+
+  const size_t arraySizes[lsh_index::NumArrays] = {
+      numProj * numTables * sizeof(double),
+      numTables * dimensionality * numProj * sizeof(double),
+      numProj * sizeof(double),
+      secondHashSize * sizeof(size_t),
+      secondHashSize * sizeof(size_t),
+      tableSize * sizeof(size_t) };
+
+  size_t offset = lsh_index::IndexHeaderSize * sizeof(uint64_t);
+  for (size_t i = 0; i < array; i++)
+    offset += arraySizes[i];
+
+  if (offset + arraySizes[array] > file.Size())
+  {
+    Log::Fatal << "LSH index in '" << file.Filename() << "' is truncated!"
+        << std::endl;
+  }
+
+  return file.Data() + offset;
+}
+
+template<typename SortPolicy>
+void LSHSearch<SortPolicy>::
+Save(const std::string& filename) const
+{
+  std::ofstream stream(filename.c_str(), std::ios::out | std::ios::binary);
+  if (!stream.is_open())
+  {
+    Log::Fatal << "Cannot open file '" << filename << "' for writing the LSH "
+        << "index." << std::endl;
+  }
+
+  uint64_t header[lsh_index::IndexHeaderSize];
+  memcpy(&header[lsh_index::MagicField], lsh_index::IndexMagic, 8);
+  header[lsh_index::SizeofSizeTField] = sizeof(size_t);
+  header[lsh_index::NumProjField] = numProj;
+  header[lsh_index::NumTablesField] = numTables;
+  header[lsh_index::DimensionalityField] = referenceSet.n_rows;
+  memcpy(&header[lsh_index::HashWidthField], &hashWidth, sizeof(double));
+  header[lsh_index::SecondHashSizeField] = secondHashSize;
+  header[lsh_index::BucketSizeField] = bucketSize;
+  header[lsh_index::TableRowsField] = secondHashTable.n_rows;
+  header[lsh_index::TableColsField] = secondHashTable.n_cols;
+  stream.write((const char*) header, sizeof(header));
+
+  // Now write each array, in the order given by lsh_index::Array.
+  stream.write((const char*) offsets.memptr(), offsets.n_elem *
+      sizeof(double));
+  for (size_t i = 0; i < numTables; i++)
+    stream.write((const char*) projections[i].memptr(), projections[i].n_elem *
+        sizeof(double));
+  stream.write((const char*) secondHashWeights.memptr(),
+      secondHashWeights.n_elem * sizeof(double));
+  stream.write((const char*) bucketContentSize.memptr(),
+      bucketContentSize.n_elem * sizeof(size_t));
+  stream.write((const char*) bucketRowInHashTable.memptr(),
+      bucketRowInHashTable.n_elem * sizeof(size_t));
+  stream.write((const char*) secondHashTable.memptr(), secondHashTable.n_elem *
+      sizeof(size_t));
+
+  if (!stream.good())
+  {
+    Log::Fatal << "Error while writing the LSH index to '" << filename << "'."
+        << std::endl;
+  }
+
+  Log::Info << "Saved LSH index to '" << filename << "'." << std::endl;
+}
+
 template<typename SortPolicy>
 void LSHSearch<SortPolicy>::
 InsertNeighbor(const size_t queryIndex,
@@ -139,74 +369,118 @@ BaseCase(const size_t queryIndex, const size_t referenceIndex)
 
 template<typename SortPolicy>
 void LSHSearch<SortPolicy>::
-ReturnIndicesFromTable(const size_t queryIndex,
-                       arma::uvec& referenceIndices,
-                       size_t numTablesToSearch)
+ComputeBuckets(const arma::mat& queries,
+               const size_t numTablesToSearch,
+               const size_t numProbes,
+               arma::Mat<size_t>& buckets) const
 {
-  // Decide on the number of tables to look into.
-  if (numTablesToSearch == 0) // If no user input is given, search all.
-    numTablesToSearch = numTables;
-
-  // Sanity check to make sure that the existing number of tables is not
-  // exceeded.
-  if (numTablesToSearch > numTables)
-    numTablesToSearch = numTables;
-
-  // Hash the query in each of the 'numTablesToSearch' hash tables using the
+  // Hash the queries in each of the 'numTablesToSearch' hash tables using the
   // 'numProj' projections for each table. This gives us 'numTablesToSearch'
-  // keys for the query where each key is a 'numProj' dimensional integer
+  // keys for each query where each key is a 'numProj' dimensional integer
   // vector.
+  const size_t probesPerTable = numProbes + 1;
+  buckets.set_size(numTablesToSearch * probesPerTable, queries.n_cols);
 
-  // Compute the projection of the query in each table.
-  arma::mat allProjInTables(numProj, numTablesToSearch);
+  arma::mat projInTable;
+  arma::mat keys;
+  std::vector<std::pair<double, size_t> > perturbations(2 * numProj);
   for (size_t i = 0; i < numTablesToSearch; i++)
   {
-    allProjInTables.unsafe_col(i) = projections[i].t() *
-        querySet.unsafe_col(queryIndex);
-  }
-  allProjInTables += offsets.cols(0, numTablesToSearch - 1);
-  allProjInTables /= hashWidth;
+    // Compute the projection of every query in this table at once.
+    projInTable = projections[i].t() * queries;
+    projInTable.each_col() += offsets.unsafe_col(i);
+    projInTable /= hashWidth;
+    keys = arma::floor(projInTable);
+
+    // Compute the hash value of each key of the queries into a bucket of the
+    // 'secondHashTable' using the 'secondHashWeights'.
+    const arma::rowvec hashVec = secondHashWeights.t() * keys;
 
-  // Compute the hash value of each key of the query into a bucket of the
-  // 'secondHashTable' using the 'secondHashWeights'.
-  arma::rowvec hashVec = secondHashWeights.t() * arma::floor(allProjInTables);
+    for (size_t j = 0; j < hashVec.n_elem; j++)
+    {
+      buckets(i * probesPerTable, j) = ((size_t) hashVec[j] % secondHashSize);
+
+      if (numProbes == 0)
+        continue;
 
-  for (size_t i = 0; i < hashVec.n_elem; i++)
-    hashVec[i] = (double) ((size_t) hashVec[i] % secondHashSize);
+      // Score each of the perturbations of the key by how close the query is
+      // to the corresponding bucket boundary.  Perturbation 2c moves
+      // coordinate c down by one; perturbation 2c + 1 moves it up by one.
+      for (size_t c = 0; c < numProj; c++)
+      {
+        const double frac = projInTable(c, j) - keys(c, j);
+        perturbations[2 * c] = std::make_pair(frac, 2 * c);
+        perturbations[2 * c + 1] = std::make_pair(1.0 - frac, 2 * c + 1);
+      }
 
-  Log::Assert(hashVec.n_elem == numTablesToSearch);
+      // We can't probe more buckets than we have perturbations; any extra
+      // probes just search the query's own bucket again.
+      const size_t usedProbes = std::min(numProbes, 2 * numProj);
+      std::partial_sort(perturbations.begin(), perturbations.begin() +
+          usedProbes, perturbations.end());
+
+      for (size_t p = 0; p < numProbes; p++)
+      {
+        if (p >= usedProbes)
+        {
+          buckets(i * probesPerTable + p + 1, j) = buckets(i * probesPerTable,
+              j);
+          continue;
+        }
+
+        // The second hash is linear in the key, so perturbing one coordinate
+        // of the key changes the hash by the corresponding weight.
+        const size_t coord = perturbations[p].second / 2;
+        const double direction = (perturbations[p].second % 2 == 0) ? -1.0 :
+            1.0;
+        const double probeHash = hashVec[j] + direction *
+            secondHashWeights[coord];
+        buckets(i * probesPerTable + p + 1, j) = ((size_t) probeHash %
+            secondHashSize);
+      }
+    }
+  }
+}
 
+template<typename SortPolicy>
+void LSHSearch<SortPolicy>::
+ReturnIndicesFromTable(const arma::Col<size_t>& queryBuckets,
+                       std::vector<size_t>& referenceIndices) const
+{
   // For all the buckets that the query is hashed into, sequentially
   // collect the indices in those buckets.
-  arma::Col<size_t> refPointsConsidered;
-  refPointsConsidered.zeros(referenceSet.n_cols);
+  referenceIndices.clear();
 
-  for (size_t i = 0; i < hashVec.n_elem; i++) // For all tables.
+  for (size_t i = 0; i < queryBuckets.n_elem; i++) // For all tables.
   {
-    size_t hashInd = (size_t) hashVec[i];
+    const size_t hashInd = queryBuckets[i];
 
     if (bucketContentSize[hashInd] > 0)
     {
       // Pick the indices in the bucket corresponding to 'hashInd'.
-      size_t tableRow = bucketRowInHashTable[hashInd];
+      const size_t tableRow = bucketRowInHashTable[hashInd];
       assert(tableRow < secondHashSize);
       assert(tableRow < secondHashTable.n_rows);
 
       for (size_t j = 0; j < bucketContentSize[hashInd]; j++)
-        refPointsConsidered[secondHashTable(tableRow, j)]++;
+        referenceIndices.push_back(secondHashTable(tableRow, j));
     }
   }
 
-  referenceIndices = arma::find(refPointsConsidered > 0);
+  // The same point may be in the buckets of several tables, so remove any
+  // duplicates.
+  std::sort(referenceIndices.begin(), referenceIndices.end());
+  referenceIndices.erase(std::unique(referenceIndices.begin(),
+      referenceIndices.end()), referenceIndices.end());
 }
 
-
 template<typename SortPolicy>
 void LSHSearch<SortPolicy>::
 Search(const size_t k,
        arma::Mat<size_t>& resultingNeighbors,
        arma::mat& distances,
-       const size_t numTablesToSearch)
+       size_t numTablesToSearch,
+       const size_t numProbes)
 {
   neighborPtr = &resultingNeighbors;
   distancePtr = &distances;
@@ -217,26 +491,64 @@ Search(const size_t k,
   distancePtr->fill(SortPolicy::WorstDistance());
   neighborPtr->fill(referenceSet.n_cols);
 
+  // Decide on the number of tables to look into.
+  if (numTablesToSearch == 0) // If no user input is given, search all.
+    numTablesToSearch = numTables;
+
+  // Sanity check to make sure that the existing number of tables is not
+  // exceeded.
+  if (numTablesToSearch > numTables)
+    numTablesToSearch = numTables;
+
   size_t avgIndicesReturned = 0;
 
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads(numThreads);
+#else
+  const size_t threads = 1;
+#endif
+
   Timer::Start("computing_neighbors");
 
-  // Go through every query point sequentially.
-  for (size_t i = 0; i < querySet.n_cols; i++)
+  const size_t numBlocks = (querySet.n_cols + QueryBlockSize - 1) /
+      QueryBlockSize;
+
+  // Go through the query points in blocks.  Each block writes only to its own
+  // columns of the neighbor and distance matrices, so the blocks can be
+  // processed in parallel without any locking.
+  #pragma omp parallel num_threads(threads) reduction(+:avgIndicesReturned)
   {
-    // Hash every query into every hash table and eventually into the
-    // 'secondHashTable' to obtain the neighbor candidates.
-    arma::uvec refIndices;
-    ReturnIndicesFromTable(i, refIndices, numTablesToSearch);
-
-    // An informative book-keeping for the number of neighbor candidates
-    // returned on average.
-    avgIndicesReturned += refIndices.n_elem;
-
-    // Sequentially go through all the candidates and save the best 'k'
-    // candidates.
-    for (size_t j = 0; j < refIndices.n_elem; j++)
-      BaseCase(i, (size_t) refIndices[j]);
+    // These are reused for every query handled by this thread.
+    arma::Mat<size_t> buckets;
+    std::vector<size_t> refIndices;
+
+    #pragma omp for schedule(dynamic)
+    for (size_t block = 0; block < numBlocks; block++)
+    {
+      const size_t begin = block * QueryBlockSize;
+      const size_t end = std::min(begin + QueryBlockSize, (size_t)
+          querySet.n_cols);
+
+      // Hash every query in the block into every hash table and eventually
+      // into the 'secondHashTable'.
+      ComputeBuckets(querySet.cols(begin, end - 1), numTablesToSearch,
+          numProbes, buckets);
+
+      for (size_t i = begin; i < end; i++)
+      {
+        // Obtain the neighbor candidates from the buckets.
+        ReturnIndicesFromTable(buckets.unsafe_col(i - begin), refIndices);
+
+        // An informative book-keeping for the number of neighbor candidates
+        // returned on average.
+        avgIndicesReturned += refIndices.size();
+
+        // Sequentially go through all the candidates and save the best 'k'
+        // candidates.
+        for (size_t j = 0; j < refIndices.size(); j++)
+          BaseCase(i, refIndices[j]);
+      }
+    }
   }
 
   Timer::Stop("computing_neighbors");
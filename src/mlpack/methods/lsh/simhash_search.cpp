@@ -0,0 +1,248 @@
+/**
+ * @file simhash_search.cpp
+ *
+ * Implementation of the SimHashSearch class.
+ */
+#include "simhash_search.hpp"
+
+#include <algorithm>
+
+using namespace mlpack;
+using namespace mlpack::neighbor;
+
+namespace {
+
+//! Orders the reference points by their key in one table, then by index.
+class KeyLess
+{
+ public:
+  KeyLess(const std::vector<uint64_t>& codes,
+          const size_t numTables,
+          const size_t table) :
+      codes(codes), numTables(numTables), table(table) { }
+
+  bool operator()(const size_t a, const size_t b) const
+  {
+    const uint64_t keyA = codes[a * numTables + table];
+    const uint64_t keyB = codes[b * numTables + table];
+    return (keyA != keyB) ? (keyA < keyB) : (a < b);
+  }
+
+ private:
+  const std::vector<uint64_t>& codes;
+  const size_t numTables;
+  const size_t table;
+};
+
+//! Count the bits set in the given word.
+inline size_t Popcount(uint64_t x)
+{
+#ifdef __GNUC__
+  return (size_t) __builtin_popcountll(x);
+#else
+  size_t count = 0;
+  for (; x != 0; x &= x - 1)
+    ++count;
+  return count;
+#endif
+}
+
+} // anonymous namespace
+
+SimHashSearch::SimHashSearch(const arma::mat& referenceSet,
+                             const size_t numTables,
+                             const size_t keyBits) :
+    numTables(numTables),
+    keyBits(keyBits),
+    size(referenceSet.n_cols),
+    tableKeys(numTables),
+    tablePoints(numTables),
+    numThreads(1)
+{
+  if (numTables == 0)
+    Log::Fatal << "SimHashSearch: the number of tables must be positive."
+        << std::endl;
+
+  if (keyBits == 0 || keyBits > 64)
+    Log::Fatal << "SimHashSearch: the number of bits of each key must be "
+        << "between 1 and 64." << std::endl;
+
+  projections.randn(numTables * keyBits, referenceSet.n_rows);
+  Hash(referenceSet, codes);
+
+  // Each table is the reference points sorted by their key, so that the points
+  // with a given key are found with a binary search.
+  for (size_t t = 0; t < numTables; ++t)
+  {
+    std::vector<size_t>& points = tablePoints[t];
+    points.resize(size);
+    for (size_t i = 0; i < size; ++i)
+      points[i] = i;
+    std::sort(points.begin(), points.end(), KeyLess(codes, numTables, t));
+
+    tableKeys[t].resize(size);
+    for (size_t i = 0; i < size; ++i)
+      tableKeys[t][i] = codes[points[i] * numTables + t];
+  }
+}
+
+void SimHashSearch::Hash(const arma::mat& points,
+                         std::vector<uint64_t>& pointCodes) const
+{
+  if (points.n_rows != projections.n_cols)
+  {
+    Log::Fatal << "SimHashSearch::Hash(): the points have " << points.n_rows
+        << " dimensions, but the projections have " << projections.n_cols
+        << "." << std::endl;
+  }
+
+  pointCodes.assign(points.n_cols * numTables, 0);
+  const size_t numBlocks = (points.n_cols + BlockSize - 1) / BlockSize;
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads(numThreads);
+#else
+  const size_t threads = 1;
+#endif
+
+  // Each block of points is projected onto every direction at once.
+  #pragma omp parallel for num_threads(threads) if(threads > 1) \
+      schedule(static)
+  for (size_t block = 0; block < numBlocks; ++block)
+  {
+    const size_t begin = block * BlockSize;
+    const size_t end = std::min(begin + BlockSize, (size_t) points.n_cols);
+    const arma::mat projected = projections * points.cols(begin, end - 1);
+
+    for (size_t i = begin; i < end; ++i)
+    {
+      const double* signs = projected.colptr(i - begin);
+      for (size_t t = 0; t < numTables; ++t)
+      {
+        uint64_t key = 0;
+        for (size_t b = 0; b < keyBits; ++b)
+          if (signs[t * keyBits + b] > 0.0)
+            key |= uint64_t(1) << b;
+
+        pointCodes[i * numTables + t] = key;
+      }
+    }
+  }
+}
+
+size_t SimHashSearch::HammingDistance(const uint64_t* a,
+                                      const uint64_t* b,
+                                      const size_t words)
+{
+  size_t distance = 0;
+  for (size_t w = 0; w < words; ++w)
+    distance += Popcount(a[w] ^ b[w]);
+
+  return distance;
+}
+
+void SimHashSearch::Search(const arma::mat& querySet,
+                           const size_t k,
+                           arma::Mat<size_t>& neighbors,
+                           arma::mat& distances,
+                           const size_t probeRadius) const
+{
+  if (k == 0)
+    Log::Fatal << "SimHashSearch::Search(): k must be positive." << std::endl;
+
+  if (probeRadius > keyBits)
+  {
+    Log::Fatal << "SimHashSearch::Search(): the probe radius (" << probeRadius
+        << ") cannot be larger than the number of bits of each key ("
+        << keyBits << ")." << std::endl;
+  }
+
+  std::vector<uint64_t> queryCodes;
+  Hash(querySet, queryCodes);
+
+  neighbors.set_size(k, querySet.n_cols);
+  distances.set_size(k, querySet.n_cols);
+  neighbors.fill(size);
+  distances.fill(DBL_MAX);
+
+  const double bits = (double) (numTables * keyBits);
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads(numThreads);
+#else
+  const size_t threads = 1;
+#endif
+
+  Timer::Start("computing_neighbors");
+
+  #pragma omp parallel num_threads(threads) if(threads > 1)
+  {
+    std::vector<size_t> candidates;
+    std::vector<size_t> hamming(k);
+
+    #pragma omp for schedule(dynamic, 16)
+    for (size_t q = 0; q < querySet.n_cols; ++q)
+    {
+      const uint64_t* queryCode = &queryCodes[q * numTables];
+
+      candidates.clear();
+      for (size_t t = 0; t < numTables; ++t)
+        Probe(t, queryCode[t], 0, probeRadius, candidates);
+
+      std::sort(candidates.begin(), candidates.end());
+      candidates.erase(std::unique(candidates.begin(), candidates.end()),
+          candidates.end());
+
+      // Keep the k candidates with the smallest Hamming distance; since the
+      // candidates are sorted, ties go to the smaller index.
+      size_t* queryNeighbors = neighbors.colptr(q);
+      size_t found = 0;
+      for (size_t c = 0; c < candidates.size(); ++c)
+      {
+        const size_t distance = HammingDistance(queryCode,
+            &codes[candidates[c] * numTables], numTables);
+        if (found == k && distance >= hamming[k - 1])
+          continue;
+
+        size_t pos = (found < k) ? found++ : k - 1;
+        while (pos > 0 && hamming[pos - 1] > distance)
+        {
+          hamming[pos] = hamming[pos - 1];
+          queryNeighbors[pos] = queryNeighbors[pos - 1];
+          --pos;
+        }
+
+        hamming[pos] = distance;
+        queryNeighbors[pos] = candidates[c];
+      }
+
+      // The fraction of differing bits estimates the angle over pi.
+      for (size_t j = 0; j < found; ++j)
+        distances(j, q) = 1.0 - std::cos(M_PI * (double) hamming[j] / bits);
+    }
+  }
+
+  Timer::Stop("computing_neighbors");
+}
+
+void SimHashSearch::Probe(const size_t table,
+                          const uint64_t key,
+                          const size_t firstBit,
+                          const size_t radius,
+                          std::vector<size_t>& candidates) const
+{
+  const std::vector<uint64_t>& keys = tableKeys[table];
+  const std::vector<uint64_t>::const_iterator begin =
+      std::lower_bound(keys.begin(), keys.end(), key);
+  const std::vector<uint64_t>::const_iterator end =
+      std::upper_bound(begin, keys.end(), key);
+  candidates.insert(candidates.end(),
+      tablePoints[table].begin() + (begin - keys.begin()),
+      tablePoints[table].begin() + (end - keys.begin()));
+
+  if (radius == 0)
+    return;
+
+  for (size_t b = firstBit; b < keyBits; ++b)
+    Probe(table, key ^ (uint64_t(1) << b), b + 1, radius - 1, candidates);
+}
@@ -0,0 +1,166 @@
+/**
+ * @file simhash_search.hpp
+ *
+ * Defines the SimHashSearch class, which finds approximate nearest neighbors
+ * under the cosine distance with sign random projections (SimHash), storing
+ * each point as a few bit-packed 64-bit words.
+ *
+ * The details of this hash family can be found in the following paper:
+ *
+ * @inproceedings{charikar2002similarity,
+ *  title={Similarity estimation techniques from rounding algorithms},
+ *  author={Charikar, M.S.},
+ *  booktitle={Proceedings of the 34th Annual ACM Symposium on Theory of
+ *      Computing},
+ *  pages={380--388},
+ *  year={2002},
+ *  organization={ACM}
+ * }
+ */
+#ifndef __MLPACK_METHODS_LSH_SIMHASH_SEARCH_HPP
+#define __MLPACK_METHODS_LSH_SIMHASH_SEARCH_HPP
+
+#include <mlpack/core.hpp>
+#include <vector>
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * The SimHashSearch class finds approximate nearest neighbors under the cosine
+ * distance (one minus the cosine similarity).  Each bit of the code of a point
+ * is the sign of its projection onto a random Gaussian direction, so two
+ * points disagree on a bit with probability theta / pi, where theta is the
+ * angle between them.
+ *
+ * The index has NumTables() tables with KeyBits() bits (at most 64) each; the
+ * key of a point in a table is one 64-bit word, and the code of a point is the
+ * words of all its keys.  Unlike LSHSearch, the reference points themselves
+ * are not kept: a point takes NumTables() words in the index, plus its entries
+ * in the tables, and a candidate is scored with one XOR and popcount per word
+ * instead of a distance computation in double precision.
+ *
+ * To search, the points whose key matches the key of the query in any table
+ * are collected as candidates; with a positive probe radius, the keys within
+ * that Hamming distance of the query's key are probed too (multiprobe LSH).
+ * The candidates are ranked by the Hamming distance between their codes and
+ * the code of the query, and the cosine distance is estimated from it.
+ *
+ * @code
+ * extern arma::mat references, queries;
+ * SimHashSearch simhash(references, 8, 16); // 8 tables of 16 bits.
+ *
+ * arma::Mat<size_t> neighbors;
+ * arma::mat distances;
+ * simhash.Search(queries, 10, neighbors, distances, 1); // Radius 1.
+ * @endcode
+ *
+ * If OpenMP is available, the points are hashed and the queries are searched
+ * in parallel, with NumThreads() threads.
+ */
+class SimHashSearch
+{
+ public:
+  /**
+   * Draw the random projections and hash the given reference set into the
+   * tables.
+   *
+   * @param referenceSet Set of reference points.
+   * @param numTables Number of hash tables.
+   * @param keyBits Number of bits of the key of each table (at most 64).
+   */
+  SimHashSearch(const arma::mat& referenceSet,
+                const size_t numTables = 4,
+                const size_t keyBits = 16);
+
+  /**
+   * Find the approximate k nearest neighbors (under the cosine distance) of
+   * each query point among the reference points, nearest first.  Neighbors
+   * which are not found (because there are fewer than k candidates) have the
+   * index Size() and the distance DBL_MAX.
+   *
+   * @param querySet Set of query points.
+   * @param k Number of neighbors to find.
+   * @param neighbors Matrix to store the indices of the neighbors in.
+   * @param distances Matrix to store the estimated cosine distances in.
+   * @param probeRadius The Hamming radius of the keys probed in each table
+   *     around the key of the query (0 probes only the query's own key).  The
+   *     number of probes per table grows as KeyBits()^probeRadius.
+   */
+  void Search(const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& neighbors,
+              arma::mat& distances,
+              const size_t probeRadius = 0) const;
+
+  /**
+   * Compute the codes of the given points: the key of point i in table t is
+   * word (i * NumTables() + t) of the codes.
+   *
+   * @param points Points to hash.
+   * @param codes Vector to store the codes in.
+   */
+  void Hash(const arma::mat& points, std::vector<uint64_t>& codes) const;
+
+  /**
+   * Return the number of bits in which the given codes (of the given number of
+   * words) differ.
+   */
+  static size_t HammingDistance(const uint64_t* a,
+                                const uint64_t* b,
+                                const size_t words);
+
+  //! Get the number of tables.
+  size_t NumTables() const { return numTables; }
+  //! Get the number of bits of the key of each table.
+  size_t KeyBits() const { return keyBits; }
+  //! Get the number of reference points.
+  size_t Size() const { return size; }
+  //! Get the projections (one direction per row, KeyBits() rows per table).
+  const arma::mat& Projections() const { return projections; }
+  //! Get the codes of the reference points (NumTables() words per point).
+  const std::vector<uint64_t>& Codes() const { return codes; }
+
+  //! Get the number of threads used (0 means all available threads).
+  size_t NumThreads() const { return numThreads; }
+  //! Modify the number of threads used (0 means all available threads).  This
+  //! only has an effect if OpenMP is available.
+  size_t& NumThreads() { return numThreads; }
+
+ private:
+  /**
+   * Add the reference points of the given table whose key is within the given
+   * Hamming radius of the given key to the candidates.  Only the bits from
+   * firstBit on are flipped, so that each key is probed once.
+   */
+  void Probe(const size_t table,
+             const uint64_t key,
+             const size_t firstBit,
+             const size_t radius,
+             std::vector<size_t>& candidates) const;
+
+  //! The number of points hashed at once.
+  static const size_t BlockSize = 1024;
+
+  //! The number of tables.
+  size_t numTables;
+  //! The number of bits of the key of each table.
+  size_t keyBits;
+  //! The number of reference points.
+  size_t size;
+  //! The random directions, (numTables * keyBits) x dimensionality.
+  arma::mat projections;
+  //! The codes of the reference points.
+  std::vector<uint64_t> codes;
+  //! The keys of each table, sorted.
+  std::vector<std::vector<uint64_t> > tableKeys;
+  //! The reference points of each table, in the order of tableKeys.
+  std::vector<std::vector<size_t> > tablePoints;
+  //! The number of threads used.
+  size_t numThreads;
+};
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
@@ -3,12 +3,9 @@
  * @author Ryan Curtin
  *
  * Implementation of the MVU class and its auxiliary objective function class.
- *
- * Note: this implementation of MVU does not work.  See #189.
  */
 #include "mvu.hpp"
 
-//#include <mlpack/core/optimizers/aug_lagrangian/aug_lagrangian.hpp>
 #include <mlpack/core/optimizers/lrsdp/lrsdp.hpp>
 
 #include <mlpack/methods/neighbor_search/neighbor_search.hpp>
@@ -16,6 +13,7 @@
 using namespace mlpack;
 using namespace mlpack::mvu;
 using namespace mlpack::optimization;
+using namespace mlpack::neighbor;
 
 MVU::MVU(const arma::mat& data) : data(data)
 {
@@ -26,79 +24,109 @@ void MVU::Unfold(const size_t newDim,
                  const size_t numNeighbors,
                  arma::mat& outputData)
 {
-  // First we have to choose the output point.  We'll take a linear projection
-  // of the data for now (this is probably not a good final solution).
-//  outputData = trans(data.rows(0, newDim - 1));
-  // Following Nick's idea.
-  outputData.randu(data.n_cols, newDim);
-
-  // The number of constraints is the number of nearest neighbors plus one.
-  LRSDP mvuSolver(numNeighbors * data.n_cols + 1, outputData);
-
-  // Set up the objective.  Because we are maximizing the trace of (R R^T),
-  // we'll instead state it as min(-I_n * (R R^T)), meaning C() is -I_n.
-  mvuSolver.C().eye(data.n_cols, data.n_cols);
-  mvuSolver.C() *= -1;
-
-  // Now set up each of the constraints.
-  // The first constraint is trace(ones * R * R^T) = 0.
-  mvuSolver.B()[0] = 0;
-  mvuSolver.A()[0].ones(data.n_cols, data.n_cols);
-
-  // All of our other constraints will be sparse except the first.  So set that
-  // vector of modes accordingly.
-  mvuSolver.AModes().ones();
-  mvuSolver.AModes()[0] = 0;
-
-  // Now all of the other constraints.  We first have to run AllkNN to get the
-  // list of nearest neighbors.
+  // Find the nearest neighbors of each point once; they give the edges of the
+  // neighborhood graph, whose lengths the embedding must preserve.
   arma::Mat<size_t> neighbors;
   arma::mat distances;
 
+  Timer::Start("mvu_neighbor_search");
   AllkNN allknn(data);
   allknn.Search(numNeighbors, neighbors, distances);
+  Timer::Stop("mvu_neighbor_search");
 
-  // Add each of the other constraints.  They are sparse constraints:
-  //   Tr(A_ij K) = d_ij;
-  //   A_ij = zeros except for 1 at (i, i), (j, j); -1 at (i, j), (j, i).
+  // If j is a neighbor of i and i is a neighbor of j, the edge only needs one
+  // constraint.  Each edge is stored with its smaller index first.
+  std::vector<std::pair<std::pair<size_t, size_t>, double> > edges;
+  edges.reserve(neighbors.n_elem);
   for (size_t i = 0; i < neighbors.n_cols; ++i)
   {
     for (size_t j = 0; j < numNeighbors; ++j)
     {
-      // This is the index of the constraint.
-      const size_t index = (i * numNeighbors) + j + 1;
-
-      arma::mat& aRef = mvuSolver.A()[index];
-
-      aRef.set_size(3, 4);
-
-      // A_ij(i, i) = 1.
-      aRef(0, 0) = i;
-      aRef(1, 0) = i;
-      aRef(2, 0) = 1;
-
-      // A_ij(i, j) = -1.
-      aRef(0, 1) = i;
-      aRef(1, 1) = neighbors(j, i);
-      aRef(2, 1) = -1;
-
-      // A_ij(j, i) = -1.
-      aRef(0, 2) = neighbors(j, i);
-      aRef(1, 2) = i;
-      aRef(2, 2) = -1;
+      const size_t neighbor = neighbors(j, i);
+      edges.push_back(std::make_pair(std::make_pair(std::min(i, neighbor),
+          std::max(i, neighbor)), distances(j, i)));
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  size_t numEdges = 0;
+  for (size_t e = 0; e < edges.size(); ++e)
+    if (numEdges == 0 || edges[e].first != edges[numEdges - 1].first)
+      edges[numEdges++] = edges[e];
+  edges.resize(numEdges);
+
+  // The initial point is the projection of the centered data on its first
+  // newDim principal components.  It satisfies the centering constraint, and
+  // no neighbor distance is longer than in the data.
+  const arma::vec mean = arma::mean(data, 1);
+  arma::mat centered = data;
+  centered.each_col() -= mean;
+
+  arma::vec eigenvalues;
+  arma::mat eigenvectors;
+  arma::eig_sym(eigenvalues, eigenvectors, centered * trans(centered));
+  outputData = trans(centered) * arma::fliplr(eigenvectors.cols(
+      data.n_rows - newDim, data.n_rows - 1));
+
+  // The number of constraints is the number of edges plus one.
+  LRSDP mvuSolver(numEdges + 1, outputData);
 
-      // A_ij(j, j) = 1.
-      aRef(0, 3) = neighbors(j, i);
-      aRef(1, 3) = neighbors(j, i);
-      aRef(2, 3) = 1;
+  // Set up the objective.  Because we are maximizing the trace of (R R^T),
+  // we'll instead state it as min(-I_n * (R R^T)), meaning C() is -I_n.  It is
+  // stored as a sparse matrix, so its cost is O(n r) and not O(n^2 r).
+  mvuSolver.SparseC().eye(data.n_cols, data.n_cols);
+  mvuSolver.SparseC() *= -1;
+
+  // The first constraint centers the embedding: Tr(1 1^T (R R^T)) = 0.  1 1^T
+  // has rank one, so it is given by its factor 1 (mode 3) and costs O(n r),
+  // without an (n x n) matrix.
+  mvuSolver.AModes().ones();
+  mvuSolver.AModes()[0] = 3;
+  mvuSolver.A()[0].ones(data.n_cols, 1);
+  mvuSolver.B()[0] = 0;
 
-      // The constraint b_ij is the distance between these two points.
-      mvuSolver.B()[index] = distances(j, i);
-    }
+  // Each of the other constraints keeps the squared length of one edge (i, j):
+  //   Tr(A_ij K) = d_ij^2;
+  //   A_ij = zeros except for 1 at (i, i), (j, j); -1 at (i, j), (j, i).
+  // A_ij is stored as the list of its four entries (mode 1); an arma::sp_mat
+  // would hold n + 1 column pointers for each of the O(n k) constraints.
+  for (size_t e = 0; e < numEdges; ++e)
+  {
+    const size_t i = edges[e].first.first;
+    const size_t j = edges[e].first.second;
+
+    arma::mat& aRef = mvuSolver.A()[e + 1];
+    aRef.set_size(3, 4);
+
+    // A_ij(i, i) = 1.
+    aRef(0, 0) = i;
+    aRef(1, 0) = i;
+    aRef(2, 0) = 1;
+
+    // A_ij(i, j) = -1.
+    aRef(0, 1) = i;
+    aRef(1, 1) = j;
+    aRef(2, 1) = -1;
+
+    // A_ij(j, i) = -1.
+    aRef(0, 2) = j;
+    aRef(1, 2) = i;
+    aRef(2, 2) = -1;
+
+    // A_ij(j, j) = 1.
+    aRef(0, 3) = j;
+    aRef(1, 3) = j;
+    aRef(2, 3) = 1;
+
+    // AllkNN returns Euclidean distances, but the constraint is on the squared
+    // distance.
+    mvuSolver.B()[e + 1] = std::pow(edges[e].second, 2.0);
   }
 
-  // Now on with the solving.
-  double objective = mvuSolver.Optimize(outputData);
+  // Now on with the solving; the low-rank embedding is refined with L-BFGS
+  // inside the augmented Lagrangian method.
+  Timer::Start("mvu_optimization");
+  const double objective = mvuSolver.Optimize(outputData);
+  Timer::Stop("mvu_optimization");
 
   Log::Info << "Final objective is " << objective << "." << std::endl;
 
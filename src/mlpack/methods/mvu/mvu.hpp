@@ -3,11 +3,9 @@
  * @author Ryan Curtin
  *
  * An implementation of Maximum Variance Unfolding.  This file defines an MVU
- * class as well as a class representing the objective function (a semidefinite
- * program) which MVU seeks to minimize.  Minimization is performed by the
- * Augmented Lagrangian optimizer (which in turn uses the L-BFGS optimizer).
- *
- * Note: this implementation of MVU does not work.  See #189.
+ * class, which sets up the semidefinite program that MVU solves as a low-rank
+ * SDP (LRSDP).  Minimization is performed by the Augmented Lagrangian optimizer
+ * (which in turn uses the L-BFGS optimizer).
  */
 #ifndef __MLPACK_METHODS_MVU_MVU_HPP
 #define __MLPACK_METHODS_MVU_MVU_HPP
@@ -23,12 +21,34 @@ namespace mvu {
  *
  * - dataset
  * - new dimensionality
+ *
+ * MVU finds the embedding of maximum variance (trace of the Gram matrix
+ * K = R R^T) which is centered and keeps the distance from each point to each
+ * of its nearest neighbors.  The neighborhood graph is computed once with
+ * AllkNN, and each of its edges gives a constraint with four nonzero entries,
+ * so an evaluation of the objective costs O(n k r) for n points, k neighbors
+ * and the rank r = newDim of R.  The optimization starts from the projection
+ * of the data on its first newDim principal components.
  */
 class MVU
 {
  public:
+  /**
+   * Create the MVU object; a reference to the dataset is kept.
+   *
+   * @param dataIn Dataset to unfold (one point per column).
+   */
   MVU(const arma::mat& dataIn);
 
+  /**
+   * Unfold the dataset into the given number of dimensions.
+   *
+   * @param newDim Dimensionality of the unfolded dataset.
+   * @param numNeighbors Number of nearest neighbors of each point whose
+   *     distances are kept.
+   * @param outputCoordinates Matrix to store the unfolded dataset in (one point
+   *     per column).
+   */
   void Unfold(const size_t newDim,
               const size_t numNeighbors,
               arma::mat& outputCoordinates);
@@ -41,16 +41,6 @@ namespace naive_bayes /** The Naive Bayes Classifier. */ {
 template<typename MatType = arma::mat>
 class NaiveBayesClassifier
 {
- private:
-  //! Sample mean for each class.
-  MatType means;
-
-  //! Sample variances for each class.
-  MatType variances;
-
-  //! Class probabilities.
-  arma::vec probabilities;
-
  public:
   /**
    * Initializes the classifier as per the input and then trains it by
@@ -68,18 +58,49 @@ class NaiveBayesClassifier
    * @param data Training data points.
    * @param labels Labels corresponding to training data points.
    * @param classes Number of classes in this classifier.
-   * @param incrementalVariance If true, an incremental algorithm is used to
-   *     calculate the variance; this can prevent loss of precision in some
-   *     cases, but will be somewhat slower to calculate.
+   * @param incrementalVariance Kept for compatibility; the variances are
+   *     always calculated with the numerically stable one-pass algorithm (see
+   *     Train()).
    */
   NaiveBayesClassifier(const MatType& data,
                        const arma::Col<size_t>& labels,
                        const size_t classes,
                        const bool incrementalVariance = false);
 
+  /**
+   * Initialize an untrained classifier for the given dimensionality and number
+   * of classes; it can then be trained one batch of points at a time with
+   * Train().
+   *
+   * @param dimensionality Dimensionality of the points.
+   * @param classes Number of classes in this classifier.
+   */
+  NaiveBayesClassifier(const size_t dimensionality, const size_t classes);
+
+  /**
+   * Train the classifier on the given batch of points.  If incremental is
+   * true, the model is updated with the batch, so that training on several
+   * batches gives the same model as training on all the points at once;
+   * otherwise, the model is trained on the batch only.
+   *
+   * The means and variances of each class are computed in one pass over the
+   * points with Welford's algorithm, in parallel over blocks of points; the
+   * statistics of the blocks (and of the existing model) are then combined
+   * with the pairwise update of Chan et al.
+   *
+   * @param data Training data points.
+   * @param labels Labels corresponding to training data points.
+   * @param incremental Whether to update the existing model with the points.
+   */
+  void Train(const MatType& data,
+             const arma::Col<size_t>& labels,
+             const bool incremental = true);
+
   /**
    * Given a bunch of data points, this function evaluates the class of each of
-   * those data points, and puts it in the vector 'results'.
+   * those data points, and puts it in the vector 'results'.  The Gaussian
+   * log-likelihoods of a block of points for every class are computed with two
+   * matrix multiplications, and the blocks are processed in parallel.
    *
    * @code
    * arma::mat test_data; // each column is a test point
@@ -107,6 +128,37 @@ class NaiveBayesClassifier
   const arma::vec& Probabilities() const { return probabilities; }
   //! Modify the prior probabilities for each class.
   arma::vec& Probabilities() { return probabilities; }
+
+  //! Get the number of points the classifier has been trained on.
+  size_t TrainingPoints() const { return trainingPoints; }
+
+ private:
+  //! The number of points processed together by one thread.
+  static const size_t PointBlockSize = 256;
+
+  //! Sample mean for each class.
+  MatType means;
+
+  //! Sample variances for each class.
+  MatType variances;
+
+  //! Class probabilities.
+  arma::vec probabilities;
+
+  //! The number of points the classifier has been trained on.
+  size_t trainingPoints;
+
+  /**
+   * Merge the statistics (number of points, means and sums of squared
+   * differences from the means) of a set of points into the statistics of
+   * another set, for each class.
+   */
+  static void MergeStatistics(arma::vec& counts,
+                              arma::mat& classMeans,
+                              arma::mat& squares,
+                              const arma::vec& otherCounts,
+                              const arma::mat& otherMeans,
+                              const arma::mat& otherSquares);
 };
 
 }; // namespace naive_bayes
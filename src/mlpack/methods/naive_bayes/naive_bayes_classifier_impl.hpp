@@ -24,80 +24,124 @@ NaiveBayesClassifier<MatType>::NaiveBayesClassifier(
     const MatType& data,
     const arma::Col<size_t>& labels,
     const size_t classes,
-    const bool incrementalVariance)
+    const bool /* incrementalVariance */) :
+    trainingPoints(0)
 {
-  const size_t dimensionality = data.n_rows;
-
   // Update the variables according to the number of features and classes
   // present in the data.
+  probabilities.zeros(classes);
+  means.zeros(data.n_rows, classes);
+  variances.zeros(data.n_rows, classes);
+
+  Train(data, labels, false);
+}
+
+template<typename MatType>
+NaiveBayesClassifier<MatType>::NaiveBayesClassifier(
+    const size_t dimensionality,
+    const size_t classes) :
+    trainingPoints(0)
+{
   probabilities.zeros(classes);
   means.zeros(dimensionality, classes);
   variances.zeros(dimensionality, classes);
+}
+
+template<typename MatType>
+void NaiveBayesClassifier<MatType>::Train(const MatType& data,
+                                          const arma::Col<size_t>& labels,
+                                          const bool incremental)
+{
+  Log::Assert(data.n_rows == means.n_rows);
+  Log::Assert(labels.n_elem == data.n_cols);
+
+  const size_t dimensionality = data.n_rows;
+  const size_t classes = means.n_cols;
 
   Log::Info << "Training Naive Bayes classifier on " << data.n_cols
       << " examples with " << dimensionality << " features each." << std::endl;
 
-  // Calculate the class probabilities as well as the sample mean and variance
-  // for each of the features with respect to each of the labels.
-  if (incrementalVariance)
+  // The statistics of each class: the number of points, the mean, and the sum
+  // of the squared differences from the mean.  If the model is updated, they
+  // start as the statistics of the points it was trained on.
+  arma::vec counts;
+  arma::mat classMeans, squares;
+  counts.zeros(classes);
+  classMeans.zeros(dimensionality, classes);
+  squares.zeros(dimensionality, classes);
+  if (incremental && (trainingPoints > 0))
   {
-    // Use incremental algorithm.
-    for (size_t j = 0; j < data.n_cols; ++j)
-    {
-      const size_t label = labels[j];
-      ++probabilities[label];
+    counts = arma::round(probabilities * trainingPoints);
+    classMeans = means;
+    squares = variances;
+    for (size_t i = 0; i < classes; ++i)
+      squares.col(i) *= (counts[i] > 1) ? (counts[i] - 1) : 0.0;
+  }
 
-      arma::vec delta = data.col(j) - means.col(label);
-      means.col(label) += delta / probabilities[label];
-      variances.col(label) += delta % (data.col(j) - means.col(label));
-    }
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
 
-    for (size_t i = 0; i < classes; ++i)
-    {
-      if (probabilities[i] > 2)
-        variances.col(i) /= (probabilities[i] - 1);
-    }
+  // Each thread computes the statistics of a contiguous block of points, in one
+  // pass, with Welford's algorithm.
+  std::vector<arma::vec> threadCounts(threads);
+  std::vector<arma::mat> threadMeans(threads);
+  std::vector<arma::mat> threadSquares(threads);
+  for (size_t t = 0; t < threads; ++t)
+  {
+    threadCounts[t].zeros(classes);
+    threadMeans[t].zeros(dimensionality, classes);
+    threadSquares[t].zeros(dimensionality, classes);
   }
-  else
+
+  #pragma omp parallel num_threads(threads)
   {
-    // Don't use incremental algorithm.  This is a two-pass algorithm.  It is
-    // possible to calculate the means and variances using a faster one-pass
-    // algorithm but there are some precision and stability issues.  If this is
-    // too slow, it's an option to use the faster algorithm by default and then
-    // have this (and the incremental algorithm) be other options.
+#ifdef _OPENMP
+    const size_t thread = omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
 
-    // Calculate the means.
+    #pragma omp for schedule(static)
     for (size_t j = 0; j < data.n_cols; ++j)
     {
       const size_t label = labels[j];
-      ++probabilities[label];
-      means.col(label) += data.col(j);
+      const double n = ++threadCounts[thread][label];
+
+      const typename MatType::elem_type* point = data.colptr(j);
+      double* mean = threadMeans[thread].colptr(label);
+      double* square = threadSquares[thread].colptr(label);
+      for (size_t d = 0; d < dimensionality; ++d)
+      {
+        const double delta = point[d] - mean[d];
+        mean[d] += delta / n;
+        square[d] += delta * (point[d] - mean[d]);
+      }
     }
+  }
 
-    // Normalize means.
-    for (size_t i = 0; i < classes; ++i)
-      if (probabilities[i] != 0.0)
-        means.col(i) /= probabilities[i];
+  // Merge the statistics of the blocks in order, so that the model does not
+  // depend on the scheduling of the threads.
+  for (size_t t = 0; t < threads; ++t)
+    MergeStatistics(counts, classMeans, squares, threadCounts[t],
+        threadMeans[t], threadSquares[t]);
 
-    // Calculate variances.
-    for (size_t j = 0; j < data.n_cols; ++j)
-    {
-      const size_t label = labels[j];
-      variances.col(label) += square(data.col(j) - means.col(label));
-    }
+  trainingPoints = (incremental ? trainingPoints : 0) + data.n_cols;
 
-    // Normalize variances.
-    for (size_t i = 0; i < classes; ++i)
-      if (probabilities[i] > 1)
-        variances.col(i) /= (probabilities[i] - 1);
-  }
+  means = classMeans;
+  variances = squares;
+  for (size_t i = 0; i < classes; ++i)
+    if (counts[i] > 1)
+      variances.col(i) /= (counts[i] - 1);
 
   // Ensure that the variances are invertible.
   for (size_t i = 0; i < variances.n_elem; ++i)
     if (variances[i] == 0.0)
       variances[i] = 1e-50;
 
-  probabilities /= data.n_cols;
+  probabilities = counts / trainingPoints;
 }
 
 template<typename MatType>
@@ -108,46 +152,99 @@ void NaiveBayesClassifier<MatType>::Classify(const MatType& data,
   // training data.
   Log::Assert(data.n_rows == means.n_rows);
 
-  arma::vec probs = arma::log(probabilities);
-  arma::mat invVar = 1.0 / variances;
-
-  arma::mat testProbs = arma::repmat(probs.t(), data.n_cols, 1);
-
   results.set_size(data.n_cols); // No need to fill with anything yet.
 
   Log::Info << "Running Naive Bayes classifier on " << data.n_cols
       << " data points with " << data.n_rows << " features each." << std::endl;
 
-  // Calculate the joint probability for each of the data points for each of the
-  // means.n_cols.
-
-  // Loop over every class.
-  for (size_t i = 0; i < means.n_cols; i++)
+  // This is an adaptation of gmm::phi() for the case where the covariance is a
+  // diagonal matrix, in log space.  With the squared distance to the mean of
+  // class i expanded as
+  //   sum_d (x_d - mu_id)^2 / var_id = sum_d x_d^2 / var_id -
+  //       2 sum_d x_d mu_id / var_id + sum_d mu_id^2 / var_id,
+  // the log-probabilities of a block of points for every class are two matrix
+  // products, plus a constant for each class.
+  const arma::mat invVar = 1.0 / variances;
+  const arma::mat scaledMeans = means % invVar;
+
+  arma::vec constants(means.n_cols);
+  for (size_t i = 0; i < means.n_cols; ++i)
   {
-    // This is an adaptation of gmm::phi() for the case where the covariance is
-    // a diagonal matrix.
-    arma::mat diffs = data - arma::repmat(means.col(i), 1, data.n_cols);
-    arma::mat rhs = -0.5 * arma::diagmat(invVar.col(i)) * diffs;
-    arma::vec exponents(diffs.n_cols);
-    for (size_t j = 0; j < diffs.n_cols; ++j)
-      exponents(j) = std::exp(arma::accu(diffs.col(j) % rhs.unsafe_col(j)));
-
-    testProbs.col(i) += log(pow(2 * M_PI, (double) data.n_rows / -2.0) *
-        pow(det(arma::diagmat(invVar.col(i))), -0.5) * exponents);
+    constants[i] = std::log(probabilities[i]) +
+        ((double) data.n_rows / -2.0) * std::log(2 * M_PI) -
+        0.5 * arma::accu(arma::log(invVar.col(i))) -
+        0.5 * arma::accu(means.col(i) % scaledMeans.col(i));
   }
 
-  // Now calculate the label.
-  for (size_t i = 0; i < data.n_cols; ++i)
+  const size_t numBlocks = (data.n_cols + PointBlockSize - 1) / PointBlockSize;
+
+  #pragma omp parallel
   {
-    // Find the index of the class with maximum probability for this point.
-    arma::uword maxIndex = 0;
-    arma::vec pointProbs = testProbs.row(i).t();
-    pointProbs.max(maxIndex);
+    arma::mat squares(data.n_rows, PointBlockSize);
+    arma::mat scores;
 
-    results[i] = maxIndex;
+    #pragma omp for schedule(static)
+    for (size_t b = 0; b < numBlocks; ++b)
+    {
+      const size_t begin = b * PointBlockSize;
+      const size_t size = std::min(begin + PointBlockSize,
+          (size_t) data.n_cols) - begin;
+
+      // An alias of the block of points, to avoid a copy.
+      const MatType block(const_cast<typename MatType::elem_type*>(
+          data.colptr(begin)), data.n_rows, size, false, true);
+      arma::mat blockSquares(squares.memptr(), data.n_rows, size, false,
+          true);
+
+      blockSquares = arma::square(block);
+      scores = trans(scaledMeans) * block - 0.5 * trans(invVar) * blockSquares;
+
+      // Find the index of the class with maximum probability for each point.
+      for (size_t j = 0; j < size; ++j)
+      {
+        const double* pointScores = scores.colptr(j);
+        size_t maxIndex = 0;
+        for (size_t i = 1; i < means.n_cols; ++i)
+          if (pointScores[i] + constants[i] >
+              pointScores[maxIndex] + constants[maxIndex])
+            maxIndex = i;
+
+        results[begin + j] = maxIndex;
+      }
+    }
   }
+}
 
-  return;
+template<typename MatType>
+void NaiveBayesClassifier<MatType>::MergeStatistics(
+    arma::vec& counts,
+    arma::mat& classMeans,
+    arma::mat& squares,
+    const arma::vec& otherCounts,
+    const arma::mat& otherMeans,
+    const arma::mat& otherSquares)
+{
+  for (size_t i = 0; i < counts.n_elem; ++i)
+  {
+    if (otherCounts[i] == 0)
+      continue;
+
+    if (counts[i] == 0)
+    {
+      counts[i] = otherCounts[i];
+      classMeans.col(i) = otherMeans.col(i);
+      squares.col(i) = otherSquares.col(i);
+      continue;
+    }
+
+    // The pairwise update of Chan, Golub and LeVeque.
+    const double n = counts[i] + otherCounts[i];
+    const arma::vec delta = otherMeans.col(i) - classMeans.col(i);
+    classMeans.col(i) += (otherCounts[i] / n) * delta;
+    squares.col(i) += otherSquares.col(i) +
+        (counts[i] * otherCounts[i] / n) * arma::square(delta);
+    counts[i] = n;
+  }
 }
 
 }; // namespace naive_bayes
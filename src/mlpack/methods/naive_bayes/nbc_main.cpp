@@ -18,11 +18,7 @@ PROGRAM_INFO("Parametric Naive Bayes Classifier",
     "\n\n"
     "Labels are expected to be the last row of the training set (--train_file),"
     " but labels can also be passed in separately as their own file "
-    "(--labels_file)."
-    "\n\n"
-    "The '--incremental_variance' option can be used to force the training to "
-    "use an incremental algorithm for calculating variance.  This is slower, "
-    "but can help avoid loss of precision in some cases.");
+    "(--labels_file).");
 
 PARAM_STRING_REQ("train_file", "A file containing the training set.", "t");
 PARAM_STRING_REQ("test_file", "A file containing the test set.", "T");
@@ -31,8 +27,8 @@ PARAM_STRING("labels_file", "A file containing labels for the training set.",
     "l", "");
 PARAM_STRING("output", "The file in which the predicted labels for the test set"
     " will be written.", "o", "output.csv");
-PARAM_FLAG("incremental_variance", "The variance of each class will be "
-    "calculated incrementally.", "I");
+PARAM_FLAG("incremental_variance", "Kept for compatibility; the variance of "
+    "each class is always calculated incrementally.", "I");
 
 using namespace mlpack;
 using namespace mlpack::naive_bayes;
@@ -12,6 +12,7 @@
 #include <mlpack/core/optimizers/sgd/sgd.hpp>
 
 #include "nca_softmax_error_function.hpp"
+#include "nca_truncated_softmax_error_function.hpp"
 
 namespace mlpack {
 namespace nca /** Neighborhood Components Analysis. */ {
@@ -38,9 +39,21 @@ namespace nca /** Neighborhood Components Analysis. */ {
  *   year = {2004}
  * }
  * @endcode
+ *
+ * The objective function is given by ErrorFunctionType.  The default,
+ * SoftmaxErrorFunction, considers every pair of points, which is O(n^2) per
+ * evaluation; for large datasets, TruncatedSoftmaxErrorFunction only considers
+ * the nearest neighbors of each point, which can be configured through
+ * ErrorFunction().
+ *
+ * @tparam MetricType Metric to use in the projected space.
+ * @tparam OptimizerType Optimizer to use.
+ * @tparam ErrorFunctionType Objective function (SoftmaxErrorFunction or
+ *     TruncatedSoftmaxErrorFunction).
  */
 template<typename MetricType = metric::SquaredEuclideanDistance,
-         template<typename> class OptimizerType = optimization::SGD>
+         template<typename> class OptimizerType = optimization::SGD,
+         template<typename> class ErrorFunctionType = SoftmaxErrorFunction>
 class NCA
 {
  public:
@@ -77,10 +90,16 @@ class NCA
   //! Get the labels reference.
   const arma::Col<size_t>& Labels() const { return labels; }
 
+  //! Get the objective function.
+  const ErrorFunctionType<MetricType>& ErrorFunction() const
+  { return errorFunction; }
+  //! Modify the objective function.
+  ErrorFunctionType<MetricType>& ErrorFunction() { return errorFunction; }
+
   //! Get the optimizer.
-  const OptimizerType<SoftmaxErrorFunction<MetricType> >& Optimizer() const
+  const OptimizerType<ErrorFunctionType<MetricType> >& Optimizer() const
   { return optimizer; }
-  OptimizerType<SoftmaxErrorFunction<MetricType> >& Optimizer()
+  OptimizerType<ErrorFunctionType<MetricType> >& Optimizer()
   { return optimizer; }
 
   // Returns a string representation of this object. 
@@ -96,10 +115,10 @@ class NCA
   MetricType metric;
 
   //! The function to optimize.
-  SoftmaxErrorFunction<MetricType> errorFunction;
+  ErrorFunctionType<MetricType> errorFunction;
 
   //! The optimizer to use.
-  OptimizerType<SoftmaxErrorFunction<MetricType> > optimizer;
+  OptimizerType<ErrorFunctionType<MetricType> > optimizer;
 };
 
 }; // namespace nca
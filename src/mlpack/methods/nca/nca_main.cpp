@@ -10,6 +10,7 @@
 #include "nca.hpp"
 
 #include <mlpack/core/optimizers/lbfgs/lbfgs.hpp>
+#include <mlpack/core/optimizers/minibatch_sgd/minibatch_sgd.hpp>
 
 // Define parameters.
 PROGRAM_INFO("Neighborhood Components Analysis (NCA)",
@@ -59,13 +60,26 @@ PROGRAM_INFO("Neighborhood Components Analysis (NCA)",
     "documentation (in lbfgs.hpp) or the vast set of published literature on "
     "L-BFGS.\n"
     "\n"
-    "By default, the SGD optimizer is used.");
+    "Mini-batch SGD, specified by --optimizer \"minibatch\", takes the same "
+    "parameters as SGD, and --batch_size, the number of points whose "
+    "gradients are summed (in parallel) for each step.  The maximum number of "
+    "iterations is then the maximum number of batches.\n"
+    "\n"
+    "By default, the SGD optimizer is used.\n"
+    "\n"
+    "Each evaluation of the NCA objective function takes time quadratic in the "
+    "number of points.  For large datasets, the objective can be approximated "
+    "by only considering the nearest neighbors of each point in the projected "
+    "space: with --neighbors k (k > 0), only the k nearest neighbors of each "
+    "point are used, and they are searched for again every "
+    "--refresh_interval evaluations (or passes over the dataset, for SGD).");
 
 PARAM_STRING_REQ("input_file", "Input dataset to run NCA on.", "i");
 PARAM_STRING_REQ("output_file", "Output file for learned distance matrix.",
     "o");
 PARAM_STRING("labels_file", "File of labels for input dataset.", "l", "");
-PARAM_STRING("optimizer", "Optimizer to use; \"sgd\" or \"lbfgs\".", "O", "sgd");
+PARAM_STRING("optimizer", "Optimizer to use; \"sgd\", \"minibatch\", or "
+    "\"lbfgs\".", "O", "sgd");
 
 PARAM_FLAG("normalize", "Use a normalized starting point for optimization. This"
     " is useful for when points are far apart, or when SGD is returning NaN.",
@@ -80,6 +94,8 @@ PARAM_DOUBLE("step_size", "Step size for stochastic gradient descent (alpha).",
     "a", 0.01);
 PARAM_FLAG("linear_scan", "Don't shuffle the order in which data points are "
     "visited for SGD.", "L");
+PARAM_INT("batch_size", "Number of points in each batch for mini-batch SGD.",
+    "b", 100);
 
 PARAM_INT("num_basis", "Number of memory points to be stored for L-BFGS.", "B",
     5);
@@ -90,6 +106,12 @@ PARAM_INT("max_line_search_trials", "Maximum number of line search trials for "
 PARAM_DOUBLE("min_step", "Minimum step of line search for L-BFGS.", "m", 1e-20);
 PARAM_DOUBLE("max_step", "Maximum step of line search for L-BFGS.", "M", 1e20);
 
+PARAM_INT("neighbors", "If nonzero, approximate the objective function with "
+    "only this many nearest neighbors of each point.", "k", 0);
+PARAM_INT("refresh_interval", "Number of evaluations (or passes over the "
+    "dataset, for SGD) between two nearest neighbor searches, when --neighbors "
+    "is given.", "R", 10);
+
 PARAM_INT("seed", "Random seed.  If 0, 'std::time(NULL)' is used.", "s", 0);
 
 
@@ -99,6 +121,71 @@ using namespace mlpack::metric;
 using namespace mlpack::optimization;
 using namespace std;
 
+// Set the parameters of the objective function, if it has any.
+void ConfigureErrorFunction(SoftmaxErrorFunction<LMetric<2> >& /* function */)
+{ }
+
+void ConfigureErrorFunction(
+    TruncatedSoftmaxErrorFunction<LMetric<2> >& function)
+{
+  function.Neighbors() = (size_t) CLI::GetParam<int>("neighbors");
+  function.RefreshInterval() = (size_t) CLI::GetParam<int>("refresh_interval");
+}
+
+// Run NCA with the given objective function and the optimizer given on the
+// command line.
+template<template<typename> class ErrorFunctionType>
+void RunNCA(const arma::mat& data,
+            const arma::Col<size_t>& labels,
+            arma::mat& distance)
+{
+  const string optimizerType = CLI::GetParam<string>("optimizer");
+
+  if (optimizerType == "sgd")
+  {
+    NCA<LMetric<2>, SGD, ErrorFunctionType> nca(data, labels);
+    ConfigureErrorFunction(nca.ErrorFunction());
+    nca.Optimizer().StepSize() = CLI::GetParam<double>("step_size");
+    nca.Optimizer().MaxIterations() =
+        (size_t) CLI::GetParam<int>("max_iterations");
+    nca.Optimizer().Tolerance() = CLI::GetParam<double>("tolerance");
+    nca.Optimizer().Shuffle() = !CLI::HasParam("linear_scan");
+
+    nca.LearnDistance(distance);
+  }
+  else if (optimizerType == "minibatch")
+  {
+    NCA<LMetric<2>, MiniBatchSGD, ErrorFunctionType> nca(data, labels);
+    ConfigureErrorFunction(nca.ErrorFunction());
+    nca.Optimizer().StepSize() = CLI::GetParam<double>("step_size");
+    nca.Optimizer().BatchSize() = (size_t) CLI::GetParam<int>("batch_size");
+    nca.Optimizer().MaxIterations() =
+        (size_t) CLI::GetParam<int>("max_iterations");
+    nca.Optimizer().Tolerance() = CLI::GetParam<double>("tolerance");
+    nca.Optimizer().Shuffle() = !CLI::HasParam("linear_scan");
+
+    nca.LearnDistance(distance);
+  }
+  else if (optimizerType == "lbfgs")
+  {
+    NCA<LMetric<2>, L_BFGS, ErrorFunctionType> nca(data, labels);
+    ConfigureErrorFunction(nca.ErrorFunction());
+    nca.Optimizer().NumBasis() = CLI::GetParam<int>("num_basis");
+    nca.Optimizer().MaxIterations() =
+        (size_t) CLI::GetParam<int>("max_iterations");
+    nca.Optimizer().ArmijoConstant() =
+        CLI::GetParam<double>("armijo_constant");
+    nca.Optimizer().Wolfe() = CLI::GetParam<double>("wolfe");
+    nca.Optimizer().MinGradientNorm() = CLI::GetParam<double>("tolerance");
+    nca.Optimizer().MaxLineSearchTrials() =
+        CLI::GetParam<int>("max_line_search_trials");
+    nca.Optimizer().MinStep() = CLI::GetParam<double>("min_step");
+    nca.Optimizer().MaxStep() = CLI::GetParam<double>("max_step");
+
+    nca.LearnDistance(distance);
+  }
+}
+
 int main(int argc, char* argv[])
 {
   // Parse command line.
@@ -115,14 +202,23 @@ int main(int argc, char* argv[])
 
   const string optimizerType = CLI::GetParam<string>("optimizer");
 
-  if ((optimizerType != "sgd") && (optimizerType != "lbfgs"))
+  if ((optimizerType != "sgd") && (optimizerType != "minibatch") &&
+      (optimizerType != "lbfgs"))
   {
     Log::Fatal << "Optimizer type '" << optimizerType << "' unknown; must be "
-        << "'sgd' or 'lbfgs'!" << std::endl;
+        << "'sgd', 'minibatch', or 'lbfgs'!" << std::endl;
   }
 
+  if (optimizerType == "minibatch" && CLI::GetParam<int>("batch_size") <= 0)
+    Log::Fatal << "Invalid batch size " << CLI::GetParam<int>("batch_size")
+        << "; must be greater than 0." << std::endl;
+
   // Warn on unused parameters.
-  if (optimizerType == "sgd")
+  if (optimizerType != "minibatch" && CLI::HasParam("batch_size"))
+    Log::Warn << "Parameter --batch_size ignored (not using 'minibatch' "
+        << "optimizer)." << std::endl;
+
+  if (optimizerType == "sgd" || optimizerType == "minibatch")
   {
     if (CLI::HasParam("num_basis"))
       Log::Warn << "Parameter --num_basis ignored (not using 'lbfgs' "
@@ -158,17 +254,7 @@ int main(int argc, char* argv[])
           << "optimizer)." << std::endl;
   }
 
-  const double stepSize = CLI::GetParam<double>("step_size");
-  const size_t maxIterations = (size_t) CLI::GetParam<int>("max_iterations");
-  const double tolerance = CLI::GetParam<double>("tolerance");
   const bool normalize = CLI::HasParam("normalize");
-  const bool shuffle = !CLI::HasParam("linear_scan");
-  const int numBasis = CLI::GetParam<int>("num_basis");
-  const double armijoConstant = CLI::GetParam<double>("armijo_constant");
-  const double wolfe = CLI::GetParam<double>("wolfe");
-  const int maxLineSearchTrials = CLI::GetParam<int>("max_line_search_trials");
-  const double minStep = CLI::GetParam<double>("min_step");
-  const double maxStep = CLI::GetParam<double>("max_step");
 
   // Load data.
   arma::mat data;
@@ -220,29 +306,16 @@ int main(int argc, char* argv[])
   }
 
   // Now create the NCA object and run the optimization.
-  if (optimizerType == "sgd")
+  if (CLI::GetParam<int>("neighbors") > 0)
   {
-    NCA<LMetric<2> > nca(data, labels);
-    nca.Optimizer().StepSize() = stepSize;
-    nca.Optimizer().MaxIterations() = maxIterations;
-    nca.Optimizer().Tolerance() = tolerance;
-    nca.Optimizer().Shuffle() = shuffle;
-
-    nca.LearnDistance(distance);
+    Log::Info << "Approximating the objective with "
+        << CLI::GetParam<int>("neighbors") << " nearest neighbors of each "
+        << "point." << std::endl;
+    RunNCA<TruncatedSoftmaxErrorFunction>(data, labels, distance);
   }
-  else if (optimizerType == "lbfgs")
+  else
   {
-    NCA<LMetric<2>, L_BFGS> nca(data, labels);
-    nca.Optimizer().NumBasis() = numBasis;
-    nca.Optimizer().MaxIterations() = maxIterations;
-    nca.Optimizer().ArmijoConstant() = armijoConstant;
-    nca.Optimizer().Wolfe() = wolfe;
-    nca.Optimizer().MinGradientNorm() = tolerance;
-    nca.Optimizer().MaxLineSearchTrials() = maxLineSearchTrials;
-    nca.Optimizer().MinStep() = minStep;
-    nca.Optimizer().MaxStep() = maxStep;
-
-    nca.LearnDistance(distance);
+    RunNCA<SoftmaxErrorFunction>(data, labels, distance);
   }
 
   // Save the output.
@@ -31,7 +31,16 @@ namespace nca {
  * In addition to the standard Evaluate() and Gradient() functions which MLPACK
  * optimizers use, overloads of Evaluate() and Gradient() are given which only
  * operate on one point in the dataset.  This is useful for optimizers like
- * stochastic gradient descent (see mlpack::optimization::SGD).
+ * stochastic gradient descent (see mlpack::optimization::SGD).  Overloads
+ * which operate on a batch of consecutive points are given too, for
+ * mlpack::optimization::MiniBatchSGD.
+ *
+ * The separable overloads share the stretched dataset A X: it is only computed
+ * again when they are called with different coordinates, so that evaluating
+ * every point with the same coordinates (as SGD does to track the objective)
+ * or a whole batch takes one projection.  The non-separable gradient and the
+ * batch overloads are computed in parallel with OpenMP, with one accumulator
+ * for the gradient per thread.
  */
 template<typename MetricType = metric::SquaredEuclideanDistance>
 class SoftmaxErrorFunction
@@ -70,7 +79,22 @@ class SoftmaxErrorFunction
    * @param covariance Covariance matrix of Mahalanobis distance.
    * @param i Index of point to use for objective function.
    */
-  double Evaluate(const arma::mat& covariance, const size_t i);
+  double Evaluate(const arma::mat& covariance, const size_t i) const;
+
+  /**
+   * Evaluate the sum of the softmax objective functions of the points begin,
+   * ..., begin + batchSize - 1 for the given covariance matrix.  This is equal
+   * to the sum of Evaluate(covariance, i) over those points, but the points are
+   * evaluated in parallel.  This is useful for optimizers such as
+   * MiniBatchSGD.
+   *
+   * @param covariance Covariance matrix of Mahalanobis distance.
+   * @param begin Index of the first point of the batch.
+   * @param batchSize Number of points in the batch.
+   */
+  double Evaluate(const arma::mat& covariance,
+                  const size_t begin,
+                  const size_t batchSize) const;
 
   /**
    * Evaluate the gradient of the softmax function for the given covariance
@@ -95,7 +119,47 @@ class SoftmaxErrorFunction
    */
   void Gradient(const arma::mat& covariance,
                 const size_t i,
-                arma::mat& gradient);
+                arma::mat& gradient) const;
+
+  /**
+   * Evaluate the sum of the gradients of the softmax functions of the points
+   * begin, ..., begin + batchSize - 1 for the given covariance matrix, in
+   * parallel.  This is useful for optimizers such as MiniBatchSGD.
+   *
+   * @param covariance Covariance matrix of Mahalanobis distance.
+   * @param begin Index of the first point of the batch.
+   * @param batchSize Number of points in the batch.
+   * @param gradient Matrix to store the calculated gradient in.
+   */
+  void Gradient(const arma::mat& covariance,
+                const size_t begin,
+                const size_t batchSize,
+                arma::mat& gradient) const;
+
+  /**
+   * Evaluate the softmax function and its gradient for the given covariance
+   * matrix, with a single precalculation and without comparing the
+   * coordinates to the last ones twice.  This is the non-separable
+   * implementation, and it is used by L_BFGS.
+   *
+   * @param covariance Covariance matrix of Mahalanobis distance.
+   * @param gradient Matrix to store the calculated gradient in.
+   */
+  double EvaluateWithGradient(const arma::mat& covariance,
+                              arma::mat& gradient);
+
+  /**
+   * Evaluate the softmax objective function and its gradient for the given
+   * covariance matrix on only one point of the dataset, with a single scan over
+   * the dataset.  This is used by SGD.
+   *
+   * @param covariance Covariance matrix of Mahalanobis distance.
+   * @param i Index of point to use for objective function.
+   * @param gradient Matrix to store the calculated gradient in.
+   */
+  double EvaluateWithGradient(const arma::mat& covariance,
+                              const size_t i,
+                              arma::mat& gradient) const;
 
   /**
    * Get the initial point.
@@ -122,8 +186,12 @@ class SoftmaxErrorFunction
 
   //! Last coordinates.  Used for the non-separable Evaluate() and Gradient().
   arma::mat lastCoordinates;
+  //! Coordinates the stretched dataset was computed with.
+  mutable arma::mat stretchedCoordinates;
   //! Stretched dataset.  Kept internal to avoid memory reallocations.
-  arma::mat stretchedDataset;
+  mutable arma::mat stretchedDataset;
+  //! False if the dataset has never been stretched.
+  mutable bool stretched;
   //! Holds calculated p_i, for the non-separable Evaluate() and Gradient().
   arma::vec p;
   //! Holds denominators for calculation of p_ij, for the non-separable
@@ -147,6 +215,34 @@ class SoftmaxErrorFunction
    * @param coordinates Coordinates matrix to use for precalculation.
    */
   void Precalculate(const arma::mat& coordinates);
+
+  /**
+   * Compute the stretched dataset, but only if the coordinates matrix is
+   * different than the last coordinates it was computed with.
+   *
+   * @param coordinates Coordinates matrix to stretch the dataset with.
+   */
+  void Stretch(const arma::mat& coordinates) const;
+
+  /**
+   * Compute p_i with the stretched dataset and, if sum is given, add the term
+   * of point i to the sum whose product with -2 A is the gradient:
+   *
+   *   p_i sum_k (p_ik x_ik x_ik^T) - sum_{j in class of i} (p_ij x_ij x_ij^T).
+   *
+   * The differences x_ik are stored in the columns of the given workspace
+   * matrices, so that the sum is one matrix multiplication.
+   *
+   * @param i Index of point.
+   * @param differences Workspace for the differences x_ik.
+   * @param weightedDifferences Workspace for the weighted differences.
+   * @param sum Sum to add the term of point i to (NULL if not needed).
+   * @return p_i.
+   */
+  double SeparableTerms(const size_t i,
+                        arma::mat& differences,
+                        arma::mat& weightedDifferences,
+                        arma::mat* sum) const;
 };
 
 }; // namespace nca
@@ -22,6 +22,7 @@ SoftmaxErrorFunction<MetricType>::SoftmaxErrorFunction(
     dataset(dataset),
     labels(labels),
     metric(metric),
+    stretched(false),
     precalculated(false)
 { /* nothing to do */ }
 
@@ -39,43 +40,38 @@ double SoftmaxErrorFunction<MetricType>::Evaluate(const arma::mat& coordinates)
 //! The separated objective function, which does not use Precalculate().
 template<typename MetricType>
 double SoftmaxErrorFunction<MetricType>::Evaluate(const arma::mat& coordinates,
-                                                  const size_t i)
+                                                  const size_t i) const
 {
   // Unfortunately each evaluation will take O(N) time because it requires a
   // scan over all points in the dataset.  Our objective is to compute p_i.
-  double denominator = 0;
-  double numerator = 0;
-
-  // It's quicker to do this now than one point at a time later.
-  stretchedDataset = coordinates * dataset;
+  // The stretched dataset is kept for the next point.
+  Stretch(coordinates);
 
-  for (size_t k = 0; k < dataset.n_cols; ++k)
-  {
-    // Don't consider the case where the points are the same.
-    if (k == i)
-      continue;
-
-    // We want to evaluate exp(-D(A x_i, A x_k)).
-    double eval = std::exp(-metric.Evaluate(stretchedDataset.unsafe_col(i),
-                                            stretchedDataset.unsafe_col(k)));
-
-    // If they are in the same
-    if (labels[i] == labels[k])
-      numerator += eval;
+  // Negate because the optimizer is a minimizer.
+  arma::mat differences, weightedDifferences;
+  return -SeparableTerms(i, differences, weightedDifferences, NULL);
+}
 
-    denominator += eval;
-  }
+//! The objective function of a batch of points, evaluated in parallel.
+template<typename MetricType>
+double SoftmaxErrorFunction<MetricType>::Evaluate(const arma::mat& coordinates,
+                                                  const size_t begin,
+                                                  const size_t batchSize) const
+{
+  // All the points of the batch use the same stretched dataset.
+  Stretch(coordinates);
 
-  // Now the result is just a simple division, but we have to be sure that the
-  // denominator is not 0.
-  if (denominator == 0.0)
+  double result = 0;
+  #pragma omp parallel reduction(+:result)
   {
-    Log::Warn << "Denominator of p_" << i << " is 0!" << std::endl;
-    return 0;
+    arma::mat differences, weightedDifferences;
+
+    #pragma omp for schedule(static)
+    for (size_t i = begin; i < begin + batchSize; ++i)
+      result -= SeparableTerms(i, differences, weightedDifferences, NULL);
   }
 
-  return -(numerator / denominator); // Negate because the optimizer is a
-                                     // minimizer.
+  return result;
 }
 
 //! The non-separable implementation, where Precalculate() is used.
@@ -98,28 +94,51 @@ void SoftmaxErrorFunction<MetricType>::Gradient(const arma::mat& coordinates,
   //     (((p_i - (1 / p_i)) p_ik) + ((p_k - (1 / p_k)) p_ki)) x_ik x_ik^T
   //   otherwise, add
   //     (p_i p_ik + p_k p_ki) x_ik x_ik^T
+  //
+  // For each i, the differences x_ik (for k > i) are the columns of a matrix,
+  // so that the sum of the weighted outer products is one matrix
+  // multiplication.  The points are split between the threads, each of which
+  // has its own sum.  Points with a small i have more pairs, so the points are
+  // scheduled dynamically.
+  const size_t n = stretchedDataset.n_cols;
   arma::mat sum;
-  sum.zeros(stretchedDataset.n_rows, stretchedDataset.n_rows);
-  for (size_t i = 0; i < stretchedDataset.n_cols; i++)
+  sum.zeros(dataset.n_rows, dataset.n_rows);
+
+  #pragma omp parallel
   {
-    for (size_t k = (i + 1); k < stretchedDataset.n_cols; k++)
+    arma::mat threadSum;
+    threadSum.zeros(dataset.n_rows, dataset.n_rows);
+    arma::mat differences(dataset.n_rows, n);
+    arma::mat weightedDifferences(dataset.n_rows, n);
+
+    #pragma omp for schedule(dynamic)
+    for (size_t i = 0; i < n; ++i)
     {
-      // Calculate p_ik and p_ki first.
-      double eval = exp(-metric.Evaluate(stretchedDataset.unsafe_col(i),
-                                         stretchedDataset.unsafe_col(k)));
-      double p_ik = 0, p_ki = 0;
-      p_ik = eval / denominators(i);
-      p_ki = eval / denominators(k);
-
-      // Subtract x_i from x_k.  We are not using stretched points here.
-      arma::vec x_ik = dataset.col(i) - dataset.col(k);
-      arma::mat secondTerm = (x_ik * trans(x_ik));
-
-      if (labels[i] == labels[k])
-        sum += ((p[i] - 1) * p_ik + (p[k] - 1) * p_ki) * secondTerm;
-      else
-        sum += (p[i] * p_ik + p[k] * p_ki) * secondTerm;
+      if (i + 1 == n)
+        continue; // No pairs left.
+
+      for (size_t k = (i + 1); k < n; k++)
+      {
+        // Calculate p_ik and p_ki first.
+        const double eval = exp(-metric.Evaluate(stretchedDataset.unsafe_col(i),
+            stretchedDataset.unsafe_col(k)));
+        const double p_ik = eval / denominators(i);
+        const double p_ki = eval / denominators(k);
+        const double weight = (labels[i] == labels[k]) ?
+            (p[i] - 1) * p_ik + (p[k] - 1) * p_ki : p[i] * p_ik + p[k] * p_ki;
+
+        // Subtract x_i from x_k.  We are not using stretched points here.
+        const size_t col = k - i - 1;
+        differences.col(col) = dataset.col(i) - dataset.col(k);
+        weightedDifferences.col(col) = weight * differences.col(col);
+      }
+
+      threadSum += weightedDifferences.cols(0, n - i - 2) *
+          trans(differences.cols(0, n - i - 2));
     }
+
+    #pragma omp critical
+    sum += threadSum;
   }
 
   // Assemble the final gradient.
@@ -130,70 +149,75 @@ void SoftmaxErrorFunction<MetricType>::Gradient(const arma::mat& coordinates,
 template<typename MetricType>
 void SoftmaxErrorFunction<MetricType>::Gradient(const arma::mat& coordinates,
                                                 const size_t i,
-                                                arma::mat& gradient)
+                                                arma::mat& gradient) const
 {
-  // We will need to calculate p_i before this evaluation is done, so these two
-  // variables will hold the information necessary for that.
-  double numerator = 0;
-  double denominator = 0;
-
-  // The gradient involves two matrix terms which are eventually combined into
-  // one.
-  arma::mat firstTerm;
-  arma::mat secondTerm;
+  EvaluateWithGradient(coordinates, i, gradient);
+}
 
-  firstTerm.zeros(coordinates.n_rows, coordinates.n_cols);
-  secondTerm.zeros(coordinates.n_rows, coordinates.n_cols);
+//! The gradient of a batch of points, computed in parallel.
+template<typename MetricType>
+void SoftmaxErrorFunction<MetricType>::Gradient(const arma::mat& coordinates,
+                                                const size_t begin,
+                                                const size_t batchSize,
+                                                arma::mat& gradient) const
+{
+  // All the points of the batch use the same stretched dataset.
+  Stretch(coordinates);
 
-  // Compute the stretched dataset.
-  stretchedDataset = coordinates * dataset;
+  arma::mat sum;
+  sum.zeros(dataset.n_rows, dataset.n_rows);
 
-  for (size_t k = 0; k < dataset.n_cols; ++k)
+  #pragma omp parallel
   {
-    // Don't consider the case where the points are the same.
-    if (i == k)
-      continue;
+    arma::mat threadSum;
+    threadSum.zeros(dataset.n_rows, dataset.n_rows);
+    arma::mat differences, weightedDifferences;
 
-    // Calculate the numerator of p_ik.
-    double eval = exp(-metric.Evaluate(stretchedDataset.unsafe_col(i),
-                                       stretchedDataset.unsafe_col(k)));
+    #pragma omp for schedule(static)
+    for (size_t i = begin; i < begin + batchSize; ++i)
+      SeparableTerms(i, differences, weightedDifferences, &threadSum);
 
-    // If the points are in the same class, we must add to the second term of
-    // the gradient as well as the numerator of p_i.  We will divide by the
-    // denominator of p_ik later.  For x_ik we are not using stretched points.
-    arma::vec x_ik = dataset.col(i) - dataset.col(k);
-    if (labels[i] == labels[k])
-    {
-      numerator += eval;
-      secondTerm += eval * x_ik * trans(x_ik);
-    }
-
-    // We always have to add to the denominator of p_i and the first term of the
-    // gradient computation.  We will divide by the denominator of p_ik later.
-    denominator += eval;
-    firstTerm += eval * x_ik * trans(x_ik);
+    #pragma omp critical
+    sum += threadSum;
   }
 
-  // Calculate p_i.
-  double p = 0;
-  if (denominator == 0)
-  {
-    Log::Warn << "Denominator of p_" << i << " is 0!" << std::endl;
-    // If the denominator is zero, then all p_ik should be zero and there is
-    // no gradient contribution from this point.
-    gradient.zeros(coordinates.n_rows, coordinates.n_rows);
-    return;
-  }
-  else
-  {
-    p = numerator / denominator;
-    firstTerm /= denominator;
-    secondTerm /= denominator;
-  }
+  // Multiply the sum by 2 * A.  We negate it though, because our optimizer is a
+  // minimizer.
+  gradient = -2 * coordinates * sum;
+}
+
+//! The non-separable objective and gradient, sharing one Precalculate() call.
+template<typename MetricType>
+double SoftmaxErrorFunction<MetricType>::EvaluateWithGradient(
+    const arma::mat& coordinates,
+    arma::mat& gradient)
+{
+  // Gradient() calls Precalculate(), which leaves p_i ready for the objective.
+  Gradient(coordinates, gradient);
 
-  // Now multiply the first term by p_i, and add the two together and multiply
-  // all by 2 * A.  We negate it though, because our optimizer is a minimizer.
-  gradient = -2 * coordinates * (p * firstTerm - secondTerm);
+  return -accu(p); // Negate because our solver minimizes.
+}
+
+//! The separable objective and gradient, sharing one scan over the dataset.
+template<typename MetricType>
+double SoftmaxErrorFunction<MetricType>::EvaluateWithGradient(
+    const arma::mat& coordinates,
+    const size_t i,
+    arma::mat& gradient) const
+{
+  Stretch(coordinates);
+
+  arma::mat sum;
+  sum.zeros(dataset.n_rows, dataset.n_rows);
+  arma::mat differences, weightedDifferences;
+  const double p_i = SeparableTerms(i, differences, weightedDifferences, &sum);
+
+  // Now multiply the sum by 2 * A.  We negate it though, because our optimizer
+  // is a minimizer.  If the denominator of p_i was zero, the sum is zero, and
+  // there is no gradient contribution from this point.
+  gradient = -2 * coordinates * sum;
+
+  return -p_i;
 }
 
 template<typename MetricType>
@@ -206,45 +230,63 @@ template<typename MetricType>
 void SoftmaxErrorFunction<MetricType>::Precalculate(
     const arma::mat& coordinates)
 {
-  // Ensure it is the right size.
-  lastCoordinates.set_size(coordinates.n_rows, coordinates.n_cols);
+  // The stretched dataset may have been computed again by the separable
+  // functions since the last precalculation.
+  Stretch(coordinates);
 
   // Make sure the calculation is necessary.
-  if ((accu(coordinates == lastCoordinates) == coordinates.n_elem) &&
-      precalculated)
+  if (precalculated && (coordinates.n_rows == lastCoordinates.n_rows) &&
+      (coordinates.n_cols == lastCoordinates.n_cols) &&
+      (accu(coordinates == lastCoordinates) == coordinates.n_elem))
     return; // No need to calculate; we already have this stuff saved.
 
-  // Coordinates are different; save the new ones, and stretch the dataset.
+  // Coordinates are different; save the new ones.
   lastCoordinates = coordinates;
-  stretchedDataset = coordinates * dataset;
 
   // For each point i, we must evaluate the softmax function:
   //   p_ij = exp( -K(x_i, x_j) ) / ( sum_{k != i} ( exp( -K(x_i, x_k) )))
   //   p_i = sum_{j in class of i} p_ij
   // We will do this by keeping track of the denominators for each i as well as
   // the numerators (the sum for all j in class of i).  This will be on the
-  // order of O((n * (n + 1)) / 2), which really isn't all that great.
-  p.zeros(stretchedDataset.n_cols);
-  denominators.zeros(stretchedDataset.n_cols);
-  for (size_t i = 0; i < stretchedDataset.n_cols; i++)
-  {
-    for (size_t j = (i + 1); j < stretchedDataset.n_cols; j++)
-    {
-      // Evaluate exp(-d(x_i, x_j)).
-      double eval = exp(-metric.Evaluate(stretchedDataset.unsafe_col(i),
-                                         stretchedDataset.unsafe_col(j)));
+  // order of O((n * (n + 1)) / 2), which really isn't all that great, so the
+  // points are split between threads, which each have their own sums.
+  const size_t n = stretchedDataset.n_cols;
+  p.zeros(n);
+  denominators.zeros(n);
 
-      // Add this to the denominators of both p_i and p_j: K(i, j) = K(j, i).
-      denominators[i] += eval;
-      denominators[j] += eval;
+  #pragma omp parallel
+  {
+    arma::vec threadNumerators, threadDenominators;
+    threadNumerators.zeros(n);
+    threadDenominators.zeros(n);
 
-      // If i and j are the same class, add to numerator of both.
-      if (labels[i] == labels[j])
+    #pragma omp for schedule(dynamic)
+    for (size_t i = 0; i < n; i++)
+    {
+      for (size_t j = (i + 1); j < n; j++)
       {
-        p[i] += eval;
-        p[j] += eval;
+        // Evaluate exp(-d(x_i, x_j)).
+        double eval = exp(-metric.Evaluate(stretchedDataset.unsafe_col(i),
+                                           stretchedDataset.unsafe_col(j)));
+
+        // Add this to the denominators of both p_i and p_j: K(i, j) = K(j, i).
+        threadDenominators[i] += eval;
+        threadDenominators[j] += eval;
+
+        // If i and j are the same class, add to numerator of both.
+        if (labels[i] == labels[j])
+        {
+          threadNumerators[i] += eval;
+          threadNumerators[j] += eval;
+        }
       }
     }
+
+    #pragma omp critical
+    {
+      p += threadNumerators;
+      denominators += threadDenominators;
+    }
   }
 
   // Divide p_i by their denominators.
@@ -267,6 +309,84 @@ void SoftmaxErrorFunction<MetricType>::Precalculate(
   precalculated = true;
 }
 
+template<typename MetricType>
+void SoftmaxErrorFunction<MetricType>::Stretch(
+    const arma::mat& coordinates) const
+{
+  // Make sure the calculation is necessary.
+  if (stretched && (coordinates.n_rows == stretchedCoordinates.n_rows) &&
+      (coordinates.n_cols == stretchedCoordinates.n_cols) &&
+      (accu(coordinates == stretchedCoordinates) == coordinates.n_elem))
+    return;
+
+  stretchedCoordinates = coordinates;
+  stretchedDataset = coordinates * dataset;
+  stretched = true;
+}
+
+template<typename MetricType>
+double SoftmaxErrorFunction<MetricType>::SeparableTerms(
+    const size_t i,
+    arma::mat& differences,
+    arma::mat& weightedDifferences,
+    arma::mat* sum) const
+{
+  // Calculate the numerators of p_ik, and sum them into the numerator and the
+  // denominator of p_i.
+  arma::vec evals(dataset.n_cols);
+  double numerator = 0;
+  double denominator = 0;
+  for (size_t k = 0; k < dataset.n_cols; ++k)
+  {
+    // Don't consider the case where the points are the same.
+    if (k == i)
+    {
+      evals[k] = 0;
+      continue;
+    }
+
+    // We want to evaluate exp(-D(A x_i, A x_k)).
+    evals[k] = std::exp(-metric.Evaluate(stretchedDataset.unsafe_col(i),
+                                         stretchedDataset.unsafe_col(k)));
+
+    if (labels[i] == labels[k])
+      numerator += evals[k];
+
+    denominator += evals[k];
+  }
+
+  // Now p_i is just a simple division, but we have to be sure that the
+  // denominator is not 0.  If it is, then all p_ik should be zero and there is
+  // no gradient contribution from this point.
+  if (denominator == 0.0)
+  {
+    Log::Warn << "Denominator of p_" << i << " is 0!" << std::endl;
+    return 0;
+  }
+
+  const double p_i = numerator / denominator;
+  if (!sum)
+    return p_i;
+
+  // The term of x_ik x_ik^T is p_i p_ik, minus p_ik if k is in the class of i.
+  // For x_ik we are not using stretched points.
+  differences.set_size(dataset.n_rows, dataset.n_cols);
+  weightedDifferences.set_size(dataset.n_rows, dataset.n_cols);
+  for (size_t k = 0; k < dataset.n_cols; ++k)
+  {
+    const double p_ik = evals[k] / denominator;
+    const double weight = (labels[i] == labels[k]) ? (p_i - 1) * p_ik :
+        p_i * p_ik;
+
+    differences.col(k) = dataset.col(i) - dataset.col(k);
+    weightedDifferences.col(k) = weight * differences.col(k);
+  }
+
+  *sum += weightedDifferences * trans(differences);
+
+  return p_i;
+}
+
 template<typename MetricType>
 std::string SoftmaxErrorFunction<MetricType>::ToString() const{
   std::ostringstream convert;
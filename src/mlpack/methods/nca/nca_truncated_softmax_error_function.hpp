@@ -0,0 +1,221 @@
+/**
+ * @file nca_truncated_softmax_error_function.hpp
+ *
+ * An approximation of the stochastic neighbor assignment probability error
+ * function (the "softmax error"), where each point is only assigned to its
+ * nearest neighbors.
+ */
+#ifndef __MLPACK_METHODS_NCA_NCA_TRUNCATED_SOFTMAX_ERROR_FUNCTION_HPP
+#define __MLPACK_METHODS_NCA_NCA_TRUNCATED_SOFTMAX_ERROR_FUNCTION_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+
+namespace mlpack {
+namespace nca {
+
+/**
+ * The "softmax" stochastic neighbor assignment probability function, truncated
+ * to the nearest neighbors of each point.  The function is
+ *
+ * p_ij = (exp(-|| A x_i - A x_j || ^ 2)) /
+ *     (sum_{k in N_i} (exp(-|| A x_i - A x_k || ^ 2)))
+ *
+ * for j in N_i, and 0 otherwise, where N_i is the set of the k nearest
+ * neighbors of x_i in the projected space (the points A x).  The points far
+ * from x_i have a negligible p_ij, so this is a good approximation of the
+ * SoftmaxErrorFunction; but the cost of an evaluation is O(n k) instead of
+ * O(n^2), so NCA can be run on much larger datasets.
+ *
+ * The neighbors are found with an AllkNN search (a tree-based search, with the
+ * Euclidean distance) on the projected dataset.  Since the projection changes
+ * during the optimization, they are searched again after every
+ * RefreshInterval() evaluations at new coordinates for the non-separable
+ * Evaluate() and Gradient() (which L_BFGS uses), or after every
+ * RefreshInterval() passes over the dataset with the separable Gradient()
+ * (which SGD uses).  Between two searches, the objective is the exact
+ * truncated objective for the current neighbor sets, so the gradient is
+ * consistent with it.
+ *
+ * With Neighbors() >= n - 1, the function is equal to the SoftmaxErrorFunction.
+ *
+ * @tparam MetricType The metric d(A x_i, A x_j) used in place of the squared
+ *     Euclidean distance.
+ */
+template<typename MetricType = metric::SquaredEuclideanDistance>
+class TruncatedSoftmaxErrorFunction
+{
+ public:
+  /**
+   * Create the function.  A reference to the dataset we will be optimizing over
+   * is kept.
+   *
+   * @param dataset Matrix containing the dataset.
+   * @param labels Vector of class labels for each point in the dataset.
+   * @param metric Instantiated metric (optional).
+   * @param neighbors Number of nearest neighbors of each point to consider.
+   * @param refreshInterval Number of evaluations (or passes over the dataset)
+   *     between two searches for the nearest neighbors.
+   */
+  TruncatedSoftmaxErrorFunction(const arma::mat& dataset,
+                                const arma::Col<size_t>& labels,
+                                MetricType metric = MetricType(),
+                                const size_t neighbors = 50,
+                                const size_t refreshInterval = 10);
+
+  /**
+   * Evaluate the truncated softmax function for the given covariance matrix.
+   * This is the non-separable implementation.
+   *
+   * @param covariance Covariance matrix of Mahalanobis distance.
+   */
+  double Evaluate(const arma::mat& covariance);
+
+  /**
+   * Evaluate the truncated softmax objective function for the given covariance
+   * matrix on only one point of the dataset.  This takes O(k) time.
+   *
+   * @param covariance Covariance matrix of Mahalanobis distance.
+   * @param i Index of point to use for objective function.
+   */
+  double Evaluate(const arma::mat& covariance, const size_t i);
+
+  /**
+   * Evaluate the gradient of the truncated softmax function for the given
+   * covariance matrix.  This is the non-separable implementation.
+   *
+   * @param covariance Covariance matrix of Mahalanobis distance.
+   * @param gradient Matrix to store the calculated gradient in.
+   */
+  void Gradient(const arma::mat& covariance, arma::mat& gradient);
+
+  /**
+   * Evaluate the gradient of the truncated softmax function for the given
+   * covariance matrix on only one point of the dataset.  This takes O(k) time.
+   *
+   * @param covariance Covariance matrix of Mahalanobis distance.
+   * @param i Index of point to use for objective function.
+   * @param gradient Matrix to store the calculated gradient in.
+   */
+  void Gradient(const arma::mat& covariance,
+                const size_t i,
+                arma::mat& gradient);
+
+  /**
+   * Evaluate the truncated softmax function and its gradient for the given
+   * covariance matrix, with a single precalculation.  This is used by L_BFGS.
+   *
+   * @param covariance Covariance matrix of Mahalanobis distance.
+   * @param gradient Matrix to store the calculated gradient in.
+   */
+  double EvaluateWithGradient(const arma::mat& covariance,
+                              arma::mat& gradient);
+
+  /**
+   * Get the initial point.
+   */
+  const arma::mat GetInitialPoint() const;
+
+  /**
+   * Get the number of functions the objective function can be decomposed into.
+   * This is just the number of points in the dataset.
+   */
+  size_t NumFunctions() const { return dataset.n_cols; }
+
+  //! Get the number of nearest neighbors of each point.
+  size_t Neighbors() const { return neighbors; }
+  //! Modify the number of nearest neighbors of each point.
+  size_t& Neighbors() { return neighbors; }
+
+  //! Get the number of evaluations between two neighbor searches.
+  size_t RefreshInterval() const { return refreshInterval; }
+  //! Modify the number of evaluations between two neighbor searches.
+  size_t& RefreshInterval() { return refreshInterval; }
+
+  //! Get the nearest neighbors of each point (one column per point).
+  const arma::Mat<size_t>& NeighborIndices() const { return neighborIndices; }
+
+  // Convert the object into a string.
+  std::string ToString() const;
+
+ private:
+  //! The dataset.
+  const arma::mat& dataset;
+  //! Labels for each point in the dataset.
+  const arma::Col<size_t>& labels;
+
+  //! The instantiated metric.
+  MetricType metric;
+
+  //! Number of nearest neighbors of each point.
+  size_t neighbors;
+  //! Number of evaluations between two neighbor searches.
+  size_t refreshInterval;
+
+  //! The nearest neighbors of each point, in the projected space.
+  arma::Mat<size_t> neighborIndices;
+  //! Number of non-separable evaluations since the last neighbor search.
+  size_t evaluationsSinceSearch;
+  //! Number of separable gradient evaluations since the last neighbor search.
+  size_t separableEvaluationsSinceSearch;
+
+  //! Last coordinates.  Used for the non-separable Evaluate() and Gradient().
+  arma::mat lastCoordinates;
+  //! Stretched dataset.  Kept internal to avoid memory reallocations.
+  arma::mat stretchedDataset;
+  //! Holds calculated p_i, for the non-separable Evaluate() and Gradient().
+  arma::vec p;
+  //! Holds calculated p_ij for the neighbors j of each point i (one column per
+  //! point), for the non-separable Gradient().
+  arma::mat neighborProbabilities;
+
+  //! False if nothing has ever been precalculated (only at construction time).
+  bool precalculated;
+
+  /**
+   * Search for the nearest neighbors of each point in the given projected
+   * dataset, and reset the evaluation counters.
+   */
+  void SearchNeighbors(const arma::mat& projectedDataset);
+
+  /**
+   * Compute p_ij for each neighbor j of the point i from the distances to the
+   * neighbors, and return p_i.  The smallest distance is subtracted before the
+   * exponentials are taken, which does not change p_ij but keeps the
+   * denominator from underflowing to 0.
+   *
+   * @param i Index of the point.
+   * @param distances Distances from the point to each of its neighbors.
+   * @param probabilities Vector to store the p_ij in.
+   */
+  double PointProbabilities(const size_t i,
+                            const arma::vec& distances,
+                            arma::vec& probabilities) const;
+
+  /**
+   * Compute p_i and p_ij for one point with the given coordinates, without
+   * stretching the whole dataset (the separable implementation).
+   */
+  double SeparableProbabilities(const arma::mat& coordinates,
+                                const size_t i,
+                                arma::vec& probabilities);
+
+  /**
+   * Precalculate p_i and p_ij for every point, but only if the coordinates
+   * matrix is different than the last coordinates the Precalculate() method
+   * was run with.  This searches for the nearest neighbors again if
+   * RefreshInterval() evaluations at new coordinates have been done since the
+   * last search.  The calculation is O(n k), in parallel.
+   *
+   * @param coordinates Coordinates matrix to use for precalculation.
+   */
+  void Precalculate(const arma::mat& coordinates);
+};
+
+}; // namespace nca
+}; // namespace mlpack
+
+// Include implementation.
+#include "nca_truncated_softmax_error_function_impl.hpp"
+
+#endif
@@ -0,0 +1,286 @@
+/**
+ * @file nca_truncated_softmax_error_function_impl.hpp
+ *
+ * Implementation of the truncated softmax error function.
+ */
+#ifndef __MLPACK_METHODS_NCA_NCA_TRUNCATED_SOFTMAX_ERROR_FUNCTION_IMPL_HPP
+#define __MLPACK_METHODS_NCA_NCA_TRUNCATED_SOFTMAX_ERROR_FUNCTION_IMPL_HPP
+
+// In case it hasn't been included already.
+#include "nca_truncated_softmax_error_function.hpp"
+
+namespace mlpack {
+namespace nca {
+
+template<typename MetricType>
+TruncatedSoftmaxErrorFunction<MetricType>::TruncatedSoftmaxErrorFunction(
+    const arma::mat& dataset,
+    const arma::Col<size_t>& labels,
+    MetricType metric,
+    const size_t neighbors,
+    const size_t refreshInterval) :
+    dataset(dataset),
+    labels(labels),
+    metric(metric),
+    neighbors(neighbors),
+    refreshInterval(refreshInterval),
+    evaluationsSinceSearch(0),
+    separableEvaluationsSinceSearch(0),
+    precalculated(false)
+{ /* Nothing to do. */ }
+
+//! The non-separable implementation, which uses Precalculate() to save time.
+template<typename MetricType>
+double TruncatedSoftmaxErrorFunction<MetricType>::Evaluate(
+    const arma::mat& coordinates)
+{
+  Precalculate(coordinates);
+
+  return -accu(p); // Sum of p_i for all i.  We negate because our solver
+                   // minimizes, not maximizes.
+}
+
+//! The separable objective function, which only stretches the neighbors of i.
+template<typename MetricType>
+double TruncatedSoftmaxErrorFunction<MetricType>::Evaluate(
+    const arma::mat& coordinates,
+    const size_t i)
+{
+  arma::vec probabilities;
+  return -SeparableProbabilities(coordinates, i, probabilities);
+}
+
+//! The non-separable implementation, where Precalculate() is used.
+template<typename MetricType>
+void TruncatedSoftmaxErrorFunction<MetricType>::Gradient(
+    const arma::mat& coordinates,
+    arma::mat& gradient)
+{
+  Precalculate(coordinates);
+
+  // As in SoftmaxErrorFunction, the gradient is
+  //   -2 A sum_i (p_i sum_k (p_ik x_ik x_ik^T) -
+  //       sum_{j in class of i} (p_ij x_ij x_ij^T)),
+  // but the sums over k and j only run over the neighbors of i.  For each
+  // point, the differences x_ik are the columns of a matrix, so that the sum of
+  // the weighted outer products is one matrix multiplication.
+  const size_t k = neighborIndices.n_rows;
+  arma::mat sum;
+  sum.zeros(dataset.n_rows, dataset.n_rows);
+
+  #pragma omp parallel
+  {
+    arma::mat threadSum;
+    threadSum.zeros(dataset.n_rows, dataset.n_rows);
+    arma::mat differences(dataset.n_rows, k);
+    arma::mat weightedDifferences(dataset.n_rows, k);
+
+    #pragma omp for schedule(static)
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+    {
+      for (size_t j = 0; j < k; ++j)
+      {
+        const size_t neighbor = neighborIndices(j, i);
+        const double p_ij = neighborProbabilities(j, i);
+        const double weight = (labels[i] == labels[neighbor]) ?
+            (p[i] - 1) * p_ij : p[i] * p_ij;
+
+        // We are not using stretched points here.
+        differences.col(j) = dataset.col(i) - dataset.col(neighbor);
+        weightedDifferences.col(j) = weight * differences.col(j);
+      }
+
+      threadSum += weightedDifferences * trans(differences);
+    }
+
+    #pragma omp critical
+    sum += threadSum;
+  }
+
+  // Assemble the final gradient.
+  gradient = -2 * coordinates * sum;
+}
+
+//! The separable implementation.
+template<typename MetricType>
+void TruncatedSoftmaxErrorFunction<MetricType>::Gradient(
+    const arma::mat& coordinates,
+    const size_t i,
+    arma::mat& gradient)
+{
+  arma::vec probabilities;
+  const double p_i = SeparableProbabilities(coordinates, i, probabilities);
+
+  // The gradient for one point is
+  //   -2 A (p_i sum_k (p_ik x_ik x_ik^T) -
+  //       sum_{j in class of i} (p_ij x_ij x_ij^T)).
+  const size_t k = neighborIndices.n_rows;
+  arma::mat differences(dataset.n_rows, k);
+  arma::mat weightedDifferences(dataset.n_rows, k);
+  for (size_t j = 0; j < k; ++j)
+  {
+    const size_t neighbor = neighborIndices(j, i);
+    const double weight = (labels[i] == labels[neighbor]) ?
+        (p_i - 1) * probabilities[j] : p_i * probabilities[j];
+
+    differences.col(j) = dataset.col(i) - dataset.col(neighbor);
+    weightedDifferences.col(j) = weight * differences.col(j);
+  }
+
+  gradient = -2 * coordinates * (weightedDifferences * trans(differences));
+
+  // Count the passes over the dataset, to know when to search again.
+  if (++separableEvaluationsSinceSearch >= refreshInterval * dataset.n_cols)
+    SearchNeighbors(coordinates * dataset);
+}
+
+//! The non-separable objective and gradient, sharing one Precalculate() call.
+template<typename MetricType>
+double TruncatedSoftmaxErrorFunction<MetricType>::EvaluateWithGradient(
+    const arma::mat& coordinates,
+    arma::mat& gradient)
+{
+  // Gradient() calls Precalculate(), which leaves p_i ready for the objective.
+  Gradient(coordinates, gradient);
+
+  return -accu(p); // Negate because our solver minimizes.
+}
+
+template<typename MetricType>
+const arma::mat TruncatedSoftmaxErrorFunction<MetricType>::GetInitialPoint()
+    const
+{
+  return arma::eye<arma::mat>(dataset.n_rows, dataset.n_rows);
+}
+
+template<typename MetricType>
+void TruncatedSoftmaxErrorFunction<MetricType>::SearchNeighbors(
+    const arma::mat& projectedDataset)
+{
+  // A point is not its own neighbor, so there are at most n - 1 neighbors.
+  const size_t k = std::min(neighbors, (size_t) dataset.n_cols - 1);
+
+  Timer::Start("nca_neighbor_search");
+
+  neighbor::AllkNN knn(projectedDataset);
+  arma::mat distances;
+  knn.Search(k, neighborIndices, distances);
+
+  Timer::Stop("nca_neighbor_search");
+
+  evaluationsSinceSearch = 0;
+  separableEvaluationsSinceSearch = 0;
+}
+
+template<typename MetricType>
+double TruncatedSoftmaxErrorFunction<MetricType>::PointProbabilities(
+    const size_t i,
+    const arma::vec& distances,
+    arma::vec& probabilities) const
+{
+  const double minDistance = distances.min();
+
+  double numerator = 0;
+  double denominator = 0;
+  probabilities.set_size(distances.n_elem);
+  for (size_t j = 0; j < distances.n_elem; ++j)
+  {
+    // Evaluate exp(-d(x_i, x_j)), up to the constant factor exp(minDistance).
+    probabilities[j] = std::exp(-(distances[j] - minDistance));
+    denominator += probabilities[j];
+
+    if (labels[i] == labels[neighborIndices(j, i)])
+      numerator += probabilities[j];
+  }
+
+  // The denominator is at least 1, because of the shift.
+  probabilities /= denominator;
+  return numerator / denominator;
+}
+
+template<typename MetricType>
+double TruncatedSoftmaxErrorFunction<MetricType>::SeparableProbabilities(
+    const arma::mat& coordinates,
+    const size_t i,
+    arma::vec& probabilities)
+{
+  if (neighborIndices.n_cols != dataset.n_cols)
+    SearchNeighbors(coordinates * dataset);
+
+  // Only stretch the point and its neighbors.
+  const arma::vec stretchedPoint = coordinates * dataset.col(i);
+  arma::vec distances(neighborIndices.n_rows);
+  for (size_t j = 0; j < neighborIndices.n_rows; ++j)
+  {
+    const arma::vec stretchedNeighbor = coordinates *
+        dataset.col(neighborIndices(j, i));
+    distances[j] = metric.Evaluate(stretchedPoint, stretchedNeighbor);
+  }
+
+  return PointProbabilities(i, distances, probabilities);
+}
+
+template<typename MetricType>
+void TruncatedSoftmaxErrorFunction<MetricType>::Precalculate(
+    const arma::mat& coordinates)
+{
+  // Make sure the calculation is necessary.
+  if (precalculated && (coordinates.n_rows == lastCoordinates.n_rows) &&
+      (coordinates.n_cols == lastCoordinates.n_cols) &&
+      (accu(coordinates == lastCoordinates) == coordinates.n_elem))
+    return; // No need to calculate; we already have this stuff saved.
+
+  // Coordinates are different; save the new ones, and stretch the dataset.
+  lastCoordinates = coordinates;
+  stretchedDataset = coordinates * dataset;
+
+  // Search for the neighbors again, if it is time to.
+  if ((neighborIndices.n_cols != dataset.n_cols) ||
+      (++evaluationsSinceSearch >= refreshInterval))
+    SearchNeighbors(stretchedDataset);
+
+  // For each point i, evaluate p_ij for each of its neighbors j, and p_i.  The
+  // points are independent, so this is done in parallel.
+  const size_t k = neighborIndices.n_rows;
+  p.set_size(dataset.n_cols);
+  neighborProbabilities.set_size(k, dataset.n_cols);
+
+  #pragma omp parallel
+  {
+    arma::vec distances(k);
+    arma::vec probabilities(k);
+
+    #pragma omp for schedule(static)
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+    {
+      for (size_t j = 0; j < k; ++j)
+        distances[j] = metric.Evaluate(stretchedDataset.unsafe_col(i),
+            stretchedDataset.unsafe_col(neighborIndices(j, i)));
+
+      p[i] = PointProbabilities(i, distances, probabilities);
+      neighborProbabilities.col(i) = probabilities;
+    }
+  }
+
+  // We've done a precalculation.  Mark it as done.
+  precalculated = true;
+}
+
+template<typename MetricType>
+std::string TruncatedSoftmaxErrorFunction<MetricType>::ToString() const
+{
+  std::ostringstream convert;
+  convert << "Truncated Softmax Error Function [" << this << "]" << std::endl;
+  convert << "  Dataset: " << dataset.n_rows << "x" << dataset.n_cols
+      << std::endl;
+  convert << "  Labels: " << labels.n_elem << std::endl;
+  convert << "  Neighbors: " << neighbors << std::endl;
+  convert << "  Refresh interval: " << refreshInterval << std::endl;
+  convert << "  Precalculated: " << precalculated << std::endl;
+  return convert.str();
+}
+
+}; // namespace nca
+}; // namespace mlpack
+
+#endif
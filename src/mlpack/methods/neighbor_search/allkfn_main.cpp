@@ -6,12 +6,14 @@
  * options.
  */
 #include <mlpack/core.hpp>
+#include <mlpack/methods/approx_kfn/qdafn.hpp>
 
 #include <string>
 #include <fstream>
 #include <iostream>
 
 #include "neighbor_search.hpp"
+#include "stream_search.hpp"
 #include "unmap.hpp"
 
 using namespace std;
@@ -37,7 +39,35 @@ PROGRAM_INFO("All K-Furthest-Neighbors",
     "neighbors output file corresponds to the index of the point in the "
     "reference set which is the i'th furthest neighbor from the point in the "
     "query set with index j.  Row i and column j in the distances output file "
-    "corresponds to the distance between those two points.");
+    "corresponds to the distance between those two points."
+    "\n\n"
+    "With --epsilon, the tree-based search is approximate: each returned "
+    "distance is at least (1 - epsilon) times the distance to the true neighbor"
+    " of that rank, and the search prunes more of the trees."
+    "\n\n"
+    "With --ball_tree, ball trees are used instead of kd-trees: each node is "
+    "bounded by a ball instead of a hyperrectangle, which often prunes better "
+    "for high-dimensional data."
+    "\n\n"
+    "With --query_block_size, the query file is not loaded: it is read in "
+    "blocks of the given number of points, and each block is searched against "
+    "the reference tree (built once) and its results appended to "
+    "--distances_file and --neighbors_file, which are then written as CSV.  The"
+    " next block is read while the current one is searched, and the memory "
+    "used for the queries is proportional to the block size, so query sets "
+    "larger than memory can be searched."
+    "\n\n"
+    "Tree pruning is weak for furthest neighbors in high dimensions, so the "
+    "tree-based search may compute nearly every distance.  With --qdafn, the "
+    "neighbors are instead found approximately, without trees, by "
+    "query-dependent approximate furthest neighbor search: the reference "
+    "points with the largest projections onto each of --num_projections "
+    "random directions are stored (--num_candidates per direction), and for "
+    "each query at most --num_candidates of them are examined, in decreasing "
+    "order of how far they are from the query along their direction.  With "
+    "--calculate_error, the exact furthest neighbors are also found, and the "
+    "average approximation ratio (the exact distance over the returned "
+    "distance, which is 1 for exact results) is printed.");
 
 // Define our input parameters that this program will take.
 PARAM_STRING_REQ("reference_file", "File containing the reference dataset.",
@@ -54,6 +84,155 @@ PARAM_FLAG("single_mode", "If true, single-tree search is used (as opposed to "
     "dual-tree search).", "s");
 PARAM_FLAG("r_tree", "If true, use an R-Tree to perform the search "
     "(experimental, may be slow.).", "T");
+PARAM_FLAG("ball_tree", "If true, use ball trees to perform the search "
+    "(instead of kd-trees).", "b");
+PARAM_INT("num_threads", "Number of threads to use for dual-tree search (0 "
+    "uses all available threads).  This has no effect unless mlpack was built "
+    "with OpenMP.", "t", 1);
+PARAM_DOUBLE("epsilon", "Relative error allowed in the neighbor distances, "
+    "for approximate search (0 is exact search; must be less than 1).", "e",
+    0.0);
+PARAM_INT("query_block_size", "If nonzero, read the query file in blocks of "
+    "this many points and search them one at a time (see above).", "", 0);
+
+PARAM_FLAG("qdafn", "If true, find approximate furthest neighbors with random "
+    "projections instead of trees (see above).", "Q");
+PARAM_INT("num_projections", "Number of random projections for --qdafn.",
+    "L", 10);
+PARAM_INT("num_candidates", "Number of candidates stored for each projection, "
+    "and examined for each query, for --qdafn.", "m", 100);
+PARAM_FLAG("calculate_error", "If true, with --qdafn, also find the exact "
+    "furthest neighbors and print the average approximation ratio.", "E");
+PARAM_INT("seed", "Random seed for --qdafn (if 0, std::time(NULL) is used).",
+    "", 0);
+
+/**
+ * Run the search with the given type of BinarySpaceTree (a kd-tree or a ball
+ * tree), and save the results.
+ */
+template<typename TreeType>
+void TreeSearch(arma::mat& referenceData,
+                const size_t k,
+                size_t leafSize,
+                const bool naive,
+                const bool singleMode,
+                const size_t numThreads,
+                const double epsilon)
+{
+  typedef NeighborSearch<FurthestNeighborSort, metric::EuclideanDistance,
+      TreeType> TreeAllkFN;
+
+  TreeAllkFN* allkfn = NULL;
+  arma::mat queryData;
+
+  std::vector<size_t> oldFromNewRefs;
+
+  // Build trees by hand, so we can save memory: if we pass a tree to
+  // NeighborSearch, it does not copy the matrix.
+  Log::Info << "Building reference tree..." << endl;
+  Timer::Start("reference_tree_building");
+
+  TreeType refTree(referenceData, oldFromNewRefs, leafSize);
+  TreeType* queryTree = NULL; // Empty for now.
+
+  Timer::Stop("reference_tree_building");
+
+  // Search the query file a block at a time, appending the results to the
+  // output files.
+  const size_t queryBlockSize = (size_t) CLI::GetParam<int>("query_block_size");
+  if (queryBlockSize != 0)
+  {
+    const string queryFile = CLI::GetParam<string>("query_file");
+    const string neighborsFile = CLI::GetParam<string>("neighbors_file");
+    const string distancesFile = CLI::GetParam<string>("distances_file");
+
+    data::StreamingReader queries(queryFile, queryBlockSize);
+    ofstream neighborsOut(neighborsFile.c_str());
+    ofstream distancesOut(distancesFile.c_str());
+    if (!neighborsOut.is_open() || !distancesOut.is_open())
+      Log::Fatal << "Could not open '" << neighborsFile << "' and '"
+          << distancesFile << "' for writing." << endl;
+
+    Log::Info << "Computing " << k << " furthest neighbors of the points in '"
+        << queryFile << "' in blocks of " << queryBlockSize << " points..."
+        << endl;
+    const size_t points = StreamSearch<FurthestNeighborSort>(refTree,
+        referenceData, oldFromNewRefs, queries, k, neighborsOut, distancesOut,
+        leafSize, singleMode, numThreads, epsilon);
+    Log::Info << "Neighbors of " << points << " query points computed." << endl;
+    return;
+  }
+
+  std::vector<size_t> oldFromNewQueries;
+
+  if (CLI::GetParam<string>("query_file") != "")
+  {
+    string queryFile = CLI::GetParam<string>("query_file");
+
+    data::Load(queryFile, queryData, true);
+
+    Log::Info << "Loaded query data from '" << queryFile << "' ("
+        << queryData.n_rows << " x " << queryData.n_cols << ")." << endl;
+
+    Log::Info << "Building query tree..." << endl;
+
+    if (naive && leafSize < queryData.n_cols)
+      leafSize = queryData.n_cols;
+
+    // Build trees by hand, so we can save memory: if we pass a tree to
+    // NeighborSearch, it does not copy the matrix.
+    Timer::Start("query_tree_building");
+
+    queryTree = new TreeType(queryData, oldFromNewQueries, leafSize);
+
+    Timer::Stop("query_tree_building");
+
+    allkfn = new TreeAllkFN(&refTree, queryTree, referenceData, queryData,
+        singleMode);
+
+    Log::Info << "Tree built." << endl;
+  }
+  else
+  {
+    allkfn = new TreeAllkFN(&refTree, referenceData, singleMode);
+
+    Log::Info << "Trees built." << endl;
+  }
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+
+  Log::Info << "Computing " << k << " furthest neighbors..." << endl;
+  allkfn->NumThreads() = numThreads;
+  allkfn->Epsilon() = epsilon;
+  allkfn->Search(k, neighbors, distances);
+
+  Log::Info << "Neighbors computed." << endl;
+
+  // We have to map back to the original indices from before the tree
+  // construction.
+  Log::Info << "Re-mapping indices..." << endl;
+
+  // Map the points back to their original locations.
+  if ((CLI::GetParam<string>("query_file") != "") && !singleMode)
+    UnmapInPlace(neighbors, distances, oldFromNewRefs, oldFromNewQueries,
+        false, numThreads);
+  else if ((CLI::GetParam<string>("query_file") != "") && singleMode)
+    UnmapInPlace(neighbors, distances, oldFromNewRefs, false, numThreads);
+  else
+    UnmapInPlace(neighbors, distances, oldFromNewRefs, oldFromNewRefs, false,
+        numThreads);
+
+  // Clean up.
+  if (queryTree)
+    delete queryTree;
+
+  delete allkfn;
+
+  // Save output.
+  data::Save(CLI::GetParam<string>("distances_file"), distances);
+  data::Save(CLI::GetParam<string>("neighbors_file"), neighbors);
+}
 
 int main(int argc, char *argv[])
 {
@@ -73,6 +252,23 @@ int main(int argc, char *argv[])
   bool naive = CLI::HasParam("naive");
   bool singleMode = CLI::HasParam("single_mode");
 
+  // Sanity check on the number of threads.
+  if (CLI::GetParam<int>("num_threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: "
+        << CLI::GetParam<int>("num_threads") << ".  Must be greater than or "
+        << "equal to 0." << endl;
+  }
+  const size_t numThreads = (size_t) CLI::GetParam<int>("num_threads");
+
+  // Sanity check on epsilon.
+  const double epsilon = CLI::GetParam<double>("epsilon");
+  if (epsilon < 0 || epsilon >= 1)
+  {
+    Log::Fatal << "Invalid epsilon: " << epsilon << ".  Must be greater "
+        << "than or equal to 0 and less than 1." << endl;
+  }
+
   arma::mat referenceData;
   arma::mat queryData; // So it doesn't go out of scope.
   data::Load(referenceFile, referenceData, true);
@@ -103,102 +299,118 @@ int main(int argc, char *argv[])
     Log::Warn << "--single_mode ignored because --naive is present." << endl;
   }
 
-  if (naive)
-    leafSize = referenceData.n_cols;
-
-  arma::Mat<size_t> neighbors;
-  arma::mat distances;
-
-  if(!CLI::HasParam("r_tree"))
+  if (CLI::HasParam("ball_tree") && CLI::HasParam("r_tree"))
   {
-    AllkFN* allkfn = NULL;
-
-    std::vector<size_t> oldFromNewRefs;
-
-    // Build trees by hand, so we can save memory: if we pass a tree to
-    // NeighborSearch, it does not copy the matrix.
-    Log::Info << "Building reference tree..." << endl;
-    Timer::Start("reference_tree_building");
-
-    BinarySpaceTree<bound::HRectBound<2>,
-        NeighborSearchStat<FurthestNeighborSort> >
-        refTree(referenceData, oldFromNewRefs, leafSize);
-    BinarySpaceTree<bound::HRectBound<2>,
-        NeighborSearchStat<FurthestNeighborSort> >*
-        queryTree = NULL; // Empty for now.
-
-    Timer::Stop("reference_tree_building");
+    Log::Fatal << "--ball_tree cannot be used with --r_tree." << endl;
+  }
 
-    std::vector<size_t> oldFromNewQueries;
+  // Sanity check on the query block size.
+  if (CLI::GetParam<int>("query_block_size") < 0)
+  {
+    Log::Fatal << "Invalid query block size: "
+        << CLI::GetParam<int>("query_block_size") << ".  Must be greater than "
+        << "or equal to 0." << endl;
+  }
+  if (CLI::GetParam<int>("query_block_size") != 0)
+  {
+    if (CLI::GetParam<string>("query_file") == "")
+      Log::Fatal << "--query_block_size requires --query_file." << endl;
+    if (naive || CLI::HasParam("r_tree"))
+      Log::Fatal << "--query_block_size cannot be used with --naive or "
+          << "--r_tree." << endl;
+  }
 
-    if (CLI::GetParam<string>("query_file") != "")
+  if (CLI::HasParam("qdafn"))
+  {
+    if (CLI::GetParam<int>("num_projections") <= 0)
     {
-      string queryFile = CLI::GetParam<string>("query_file");
+      Log::Fatal << "Invalid number of projections: "
+          << CLI::GetParam<int>("num_projections") << ".  Must be greater "
+          << "than 0." << endl;
+    }
+    if (CLI::GetParam<int>("num_candidates") <= 0 ||
+        (size_t) CLI::GetParam<int>("num_candidates") > referenceData.n_cols)
+    {
+      Log::Fatal << "Invalid number of candidates: "
+          << CLI::GetParam<int>("num_candidates") << ".  Must be between 1 and "
+          << "the number of reference points (" << referenceData.n_cols << ")."
+          << endl;
+    }
+    if (CLI::GetParam<int>("query_block_size") != 0)
+      Log::Fatal << "--qdafn cannot be used with --query_block_size." << endl;
+    if (naive || singleMode || CLI::HasParam("r_tree") ||
+        CLI::HasParam("ball_tree") || epsilon != 0)
+      Log::Warn << "--naive, --single_mode, --r_tree, --ball_tree and "
+          << "--epsilon ignored because --qdafn is present." << endl;
+
+    if (CLI::GetParam<int>("seed") != 0)
+      math::RandomSeed((size_t) CLI::GetParam<int>("seed"));
+    else
+      math::RandomSeed((size_t) std::time(NULL));
 
+    const string queryFile = CLI::GetParam<string>("query_file");
+    if (queryFile != "")
+    {
       data::Load(queryFile, queryData, true);
-
       Log::Info << "Loaded query data from '" << queryFile << "' ("
           << queryData.n_rows << " x " << queryData.n_cols << ")." << endl;
-
-      Log::Info << "Building query tree..." << endl;
-
-      if (naive && leafSize < queryData.n_cols)
-        leafSize = queryData.n_cols;
-
-      // Build trees by hand, so we can save memory: if we pass a tree to
-      // NeighborSearch, it does not copy the matrix.
-      Timer::Start("query_tree_building");
-
-      queryTree = new BinarySpaceTree<bound::HRectBound<2>,
-          NeighborSearchStat<FurthestNeighborSort> >(queryData, oldFromNewQueries,
-          leafSize);
-
-      Timer::Stop("query_tree_building");
-
-      allkfn = new AllkFN(&refTree, queryTree, referenceData, queryData,
-          singleMode);
-
-      Log::Info << "Tree built." << endl;
-    }
-    else
-    {
-      allkfn = new AllkFN(&refTree, referenceData, singleMode);
-
-      Log::Info << "Trees built." << endl;
     }
-
-    Log::Info << "Computing " << k << " furthest neighbors..." << endl;
-    allkfn->Search(k, neighbors, distances);
-
+    const arma::mat& querySet = (queryFile != "") ? queryData : referenceData;
+
+    Log::Info << "Building the projection index..." << endl;
+    Timer::Start("index_building");
+    QDAFN qdafn(referenceData,
+        (size_t) CLI::GetParam<int>("num_projections"),
+        (size_t) CLI::GetParam<int>("num_candidates"));
+    Timer::Stop("index_building");
+
+    Log::Info << "Computing " << k << " approximate furthest neighbors..."
+        << endl;
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    qdafn.NumThreads() = numThreads;
+    qdafn.Search(querySet, k, neighbors, distances);
     Log::Info << "Neighbors computed." << endl;
 
-    // We have to map back to the original indices from before the tree
-    // construction.
-    Log::Info << "Re-mapping indices..." << endl;
+    if (CLI::HasParam("calculate_error"))
+    {
+      AllkFN* exact = (queryFile != "") ?
+          new AllkFN(referenceData, queryData) : new AllkFN(referenceData);
+      arma::Mat<size_t> exactNeighbors;
+      arma::mat exactDistances;
+      Log::Info << "Computing " << k << " exact furthest neighbors..." << endl;
+      exact->NumThreads() = numThreads;
+      exact->Search(k, exactNeighbors, exactDistances);
+      delete exact;
+
+      Log::Info << "Average approximation ratio: "
+          << QDAFN::ApproximationRatio(distances, exactDistances) << "."
+          << endl;
+    }
 
-    arma::mat distancesOut(distances.n_rows, distances.n_cols);
-    arma::Mat<size_t> neighborsOut(neighbors.n_rows, neighbors.n_cols);
+    data::Save(distancesFile, distances);
+    data::Save(neighborsFile, neighbors);
+    return 0;
+  }
 
-    // Map the points back to their original locations.
-    if ((CLI::GetParam<string>("query_file") != "") && !singleMode)
-      Unmap(neighbors, distances, oldFromNewRefs, oldFromNewQueries, neighborsOut,
-          distancesOut);
-    else if ((CLI::GetParam<string>("query_file") != "") && singleMode)
-      Unmap(neighbors, distances, oldFromNewRefs, neighborsOut, distancesOut);
-    else
-      Unmap(neighbors, distances, oldFromNewRefs, oldFromNewRefs, neighborsOut,
-          distancesOut);
+  if (naive)
+    leafSize = referenceData.n_cols;
 
-    // Clean up.
-    if (queryTree)
-      delete queryTree;
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
 
-    delete allkfn;
-    
-      // Save output.
-  data::Save(distancesFile, distancesOut);
-  data::Save(neighborsFile, neighborsOut);
-    
+  if (CLI::HasParam("ball_tree"))
+  {
+    Log::Info << "Using ball trees for furthest-neighbor calculation." << endl;
+    TreeSearch<BinarySpaceTree<bound::BallBound<>,
+        NeighborSearchStat<FurthestNeighborSort> > >(referenceData, k,
+        leafSize, naive, singleMode, numThreads, epsilon);
+  }
+  else if (!CLI::HasParam("r_tree"))
+  {
+    TreeSearch<BinarySpaceTree<bound::HRectBound<2>,
+        NeighborSearchStat<FurthestNeighborSort> > >(referenceData, k,
+        leafSize, naive, singleMode, numThreads, epsilon);
   } else {  // Use the R tree.
     Log::Info << "Using R tree for furthest-neighbor calculation." << endl;
 
@@ -273,6 +485,8 @@ int main(int argc, char *argv[])
     //arma::Mat<size_t> neighborsOut;
     
     Log::Info << "Computing " << k << " nearest neighbors..." << endl;
+    allkfn->NumThreads() = numThreads;
+    allkfn->Epsilon() = epsilon;
     allkfn->Search(k, neighbors, distances);
     
     Log::Info << "Neighbors computed." << endl;
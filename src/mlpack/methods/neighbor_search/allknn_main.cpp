@@ -7,18 +7,24 @@
  */
 #include <mlpack/core.hpp>
 #include <mlpack/core/tree/cover_tree.hpp>
+#include <mlpack/core/metrics/mahalanobis_distance.hpp>
+#include <mlpack/core/util/server.hpp>
 
 #include <string>
+#include <sstream>
 #include <fstream>
 #include <iostream>
 
 #include "neighbor_search.hpp"
+#include "neighbor_graph.hpp"
+#include "stream_search.hpp"
 #include "unmap.hpp"
 
 using namespace std;
 using namespace mlpack;
 using namespace mlpack::neighbor;
 using namespace mlpack::tree;
+using namespace mlpack::util;
 
 // Information about the program itself.
 PROGRAM_INFO("All K-Nearest-Neighbors",
@@ -39,29 +45,705 @@ PROGRAM_INFO("All K-Nearest-Neighbors",
     "neighbors output file corresponds to the index of the point in the "
     "reference set which is the i'th nearest neighbor from the point in the "
     "query set with index j.  Row i and column j in the distances output file "
-    "corresponds to the distance between those two points.");
+    "corresponds to the distance between those two points."
+    "\n\n"
+    "The reference kd-tree can be saved with --output_tree_file.  A saved tree "
+    "can be given with --input_tree_file instead of --reference_file; then the "
+    "reference set is loaded from the tree file and the tree is not rebuilt."
+    "\n\n"
+    "With --float, the data is loaded in single precision and searched with "
+    "single-precision kd-trees, and the distances are saved in single "
+    "precision."
+    "\n\n"
+    "With --mahalanobis_file, the neighbors are found under the Mahalanobis "
+    "distance sqrt((x - y)^T Q (x - y)) with the matrix Q in the given file (for "
+    "instance, A^T A for a transformation A learned by nca).  Q is factored as "
+    "L^T L, and the points are transformed by L before the trees are built, so "
+    "the search runs with the Euclidean distance and gives exact results."
+    "\n\n"
+    "With --server, the reference kd-tree is built (or loaded) once and kept in"
+    " memory, and the neighbors of query points are found as they are "
+    "requested, on the standard input and output (--server -) or on a Unix "
+    "socket created at the given path; --distances_file and --neighbors_file "
+    "are then not needed.  Each request is a line 'search <n> [k=<k>]' "
+    "followed by n lines of query points (as in a CSV file); the response is a"
+    " line 'OK <n>' followed by a line for each query point with the indices "
+    "of its k nearest neighbors and then the k distances.  The default k is "
+    "--k."
+    "\n\n"
+    "With --epsilon, the tree-based search is approximate: each returned "
+    "distance is at most (1 + epsilon) times the distance to the true neighbor "
+    "of that rank, and the search prunes more of the trees."
+    "\n\n"
+    "A reference set which is too large for one machine can be split into "
+    "shards of consecutive points, each searched by a separate run (with "
+    "--reference_offset set to the index of the first point of the shard, so "
+    "that the neighbor indices refer to the whole reference set); the results "
+    "of the runs are then merged with allknn_merge."
+    "\n\n"
+    "Without a query set, the k-nearest-neighbor graph of the reference set "
+    "can be saved with --graph_file, as a coordinate list of its symmetric "
+    "adjacency matrix: one line 'i, j, distance' for each pair of connected "
+    "points, in both orders.  Points are connected if either is one of the k "
+    "nearest neighbors of the other or, with --mutual, if both are.  "
+    "--distances_file and --neighbors_file are then optional."
+    "\n\n"
+    "With --auto, the tree type, leaf size, and single-tree, dual-tree or "
+    "brute-force search are chosen by timing trial searches of a sample of the "
+    "query points with each, and the fastest is used for the whole search "
+    "(--verbose shows the trials and the estimated intrinsic dimension of the "
+    "data).  --naive, --single_mode, --cover_tree, --r_tree, --ball_tree, and "
+    "--leaf_size are then ignored."
+    "\n\n"
+    "With --ball_tree, ball trees are used instead of kd-trees: each node is "
+    "bounded by a ball instead of a hyperrectangle, which often prunes better "
+    "for high-dimensional data."
+    "\n\n"
+    "With --curve_order ('morton' or 'hilbert'), the query points are "
+    "rearranged along the Morton or Hilbert space-filling curve before the "
+    "search, so that consecutive queries are near each other and the "
+    "single-tree and brute-force searches visit the same parts of the "
+    "reference set for them; the results are saved in the original order of "
+    "the query points.  This helps most with low-dimensional data."
+    "\n\n"
+    "With --query_block_size, the query file is not loaded: it is read in "
+    "blocks of the given number of points, and each block is searched against "
+    "the reference kd-tree (built or loaded once) and its results appended to "
+    "--distances_file and --neighbors_file, which are then written as CSV.  The"
+    " next block is read while the current one is searched, and the memory "
+    "used for the queries is proportional to the block size, so query sets "
+    "larger than memory can be searched.");
 
 // Define our input parameters that this program will take.
-PARAM_STRING_REQ("reference_file", "File containing the reference dataset.",
-    "r");
-PARAM_STRING_REQ("distances_file", "File to output distances into.", "d");
-PARAM_STRING_REQ("neighbors_file", "File to output neighbors into.", "n");
+PARAM_STRING("reference_file", "File containing the reference dataset.",
+    "r", "");
+PARAM_STRING("distances_file", "File to output distances into.", "d", "");
+PARAM_STRING("neighbors_file", "File to output neighbors into.", "n", "");
 
 PARAM_INT_REQ("k", "Number of nearest neighbors to find.", "k");
 
 PARAM_STRING("query_file", "File containing query points (optional).", "q", "");
 
+PARAM_STRING("input_tree_file", "File containing a reference kd-tree saved "
+    "with --output_tree_file, to use instead of --reference_file.", "i", "");
+PARAM_STRING("output_tree_file", "If specified, the reference kd-tree will be "
+    "saved to this file.", "o", "");
+
 PARAM_INT("leaf_size", "Leaf size for tree building.", "l", 20);
 PARAM_FLAG("naive", "If true, O(n^2) naive mode is used for computation.", "N");
 PARAM_FLAG("single_mode", "If true, single-tree search is used (as opposed to "
     "dual-tree search).", "S");
+PARAM_INT("single_batch_size", "With --single_mode, if nonzero, the query "
+    "points are ordered along the Hilbert curve and searched in batches of "
+    "this many nearby points, which are searched in parallel with "
+    "--num_threads threads.", "", 0);
 PARAM_FLAG("cover_tree", "If true, use cover trees to perform the search "
     "(experimental, may be slow).", "c");
 PARAM_FLAG("r_tree", "If true, use an R-Tree to perform the search "
     "(experimental, may be slow.).", "T");
+PARAM_FLAG("ball_tree", "If true, use ball trees to perform the search "
+    "(instead of kd-trees).", "b");
+PARAM_INT("num_threads", "Number of threads to use for dual-tree search, and "
+    "for single-tree search with --single_batch_size (0 uses all available "
+    "threads).  This has no effect unless mlpack was built "
+    "with OpenMP.", "t", 1);
+PARAM_INT("reference_offset", "Number added to each neighbor index in the "
+    "output (the index of the first point of the reference set, if it is a "
+    "shard of a larger set).", "", 0);
+PARAM_DOUBLE("epsilon", "Relative error allowed in the neighbor distances, for "
+    "approximate search (0 is exact search).", "e", 0.0);
 PARAM_FLAG("random_basis", "Before tree-building, project the data onto a "
     "random orthogonal basis.", "R");
+PARAM_STRING("mahalanobis_file", "File containing the matrix of a "
+    "Mahalanobis distance to search with (optional).", "m", "");
 PARAM_INT("seed", "Random seed (if 0, std::time(NULL) is used).", "s", 0);
+PARAM_FLAG("float", "If true, load the data in single precision and compute "
+    "the neighbors with single-precision kd-trees; this halves the memory used "
+    "by the data and the distances.", "f");
+PARAM_STRING("graph_file", "If specified, save the k-nearest-neighbor graph of "
+    "the reference set to this file (only without a query set).", "G", "");
+PARAM_FLAG("mutual", "If true, the graph saved with --graph_file connects "
+    "points only if each is a neighbor of the other.", "M");
+PARAM_FLAG("auto", "If true, choose the tree type, leaf size, and search mode "
+    "by timing trial searches of a sample of the query points.", "a");
+PARAM_STRING("server", "If specified, keep the reference tree in memory and "
+    "serve search requests on the standard input and output ('-') or on a "
+    "Unix socket created at this path.", "", "");
+PARAM_STRING("curve_order", "Space-filling curve to rearrange the query points "
+    "along before the search: 'none', 'morton', or 'hilbert'.", "", "none");
+PARAM_INT("query_block_size", "If nonzero, read the query file in blocks of "
+    "this many points and search them one at a time (see above).", "", 0);
+PARAM_FLAG("lazy_tree", "If true, build the reference kd-tree lazily: each "
+    "node is split the first time a search reaches it.  This is faster when "
+    "the query points only reach a small part of a large reference set (for "
+    "instance, with --server).", "");
+
+typedef BinarySpaceTree<bound::HRectBound<2>,
+    NeighborSearchStat<NearestNeighborSort> > TreeType;
+
+/**
+ * Answers 'search' requests for the Server with the reference kd-tree: a
+ * kd-tree is built on each batch of query points, and the batch is searched
+ * with dual-tree search.
+ */
+class SearchHandler
+{
+ public:
+  SearchHandler(TreeType& referenceTree,
+                const arma::mat& referenceData,
+                const std::vector<size_t>& oldFromNewRefs,
+                const size_t k,
+                const size_t leafSize,
+                const size_t numThreads,
+                const double epsilon) :
+      referenceTree(referenceTree),
+      referenceData(referenceData),
+      oldFromNewRefs(oldFromNewRefs),
+      k(k),
+      leafSize(leafSize),
+      numThreads(numThreads),
+      epsilon(epsilon)
+  { }
+
+  bool Handle(const ServerRequest& request, ServerResponse& response)
+  {
+    if (request.command != "search")
+    {
+      response.error = "unknown command '" + request.command + "'; the only "
+          "command is 'search'";
+      return false;
+    }
+
+    size_t searchK = k;
+    if (!request.GetOption("k", searchK) || searchK == 0 ||
+        searchK > referenceData.n_cols)
+    {
+      ostringstream error;
+      error << "invalid k; must be between 1 and the number of reference "
+          << "points (" << referenceData.n_cols << ")";
+      response.error = error.str();
+      return false;
+    }
+
+    if (request.data.n_cols == 0)
+      return true;
+
+    if (request.data.n_rows != referenceData.n_rows)
+    {
+      ostringstream error;
+      error << "query points have " << request.data.n_rows << " dimensions, "
+          << "but the reference points have " << referenceData.n_rows;
+      response.error = error.str();
+      return false;
+    }
+
+    // The query tree rearranges the points, so it needs its own copy.
+    arma::mat queryData(request.data);
+    std::vector<size_t> oldFromNewQueries;
+    TreeType queryTree(queryData, oldFromNewQueries, leafSize);
+
+    AllkNN allknn(&referenceTree, &queryTree, referenceData, queryData);
+    allknn.NumThreads() = numThreads;
+    allknn.Epsilon() = epsilon;
+
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    allknn.Search(searchK, neighbors, distances);
+    UnmapInPlace(neighbors, distances, oldFromNewRefs, oldFromNewQueries,
+        false, numThreads);
+
+    response.data.set_size(2 * searchK, neighbors.n_cols);
+    for (size_t i = 0; i < neighbors.n_cols; ++i)
+    {
+      for (size_t j = 0; j < searchK; ++j)
+      {
+        response.data(j, i) = neighbors(j, i);
+        response.data(searchK + j, i) = distances(j, i);
+      }
+    }
+
+    return true;
+  }
+
+ private:
+  //! The reference tree.
+  TreeType& referenceTree;
+  //! The (rearranged) reference points.
+  const arma::mat& referenceData;
+  //! The original index of each rearranged reference point.
+  const std::vector<size_t>& oldFromNewRefs;
+  //! The default number of neighbors.
+  size_t k;
+  //! The leaf size of the query trees.
+  size_t leafSize;
+  //! The number of threads for each search.
+  size_t numThreads;
+  //! The relative error allowed in each search.
+  double epsilon;
+};
+
+/**
+ * Save the results of the search: the neighbors (with --reference_offset added)
+ * and the distances, if files were given for them, and the neighbor graph, if
+ * --graph_file was given.
+ */
+template<typename ElemType>
+void SaveResults(arma::Mat<size_t>& neighbors,
+                 const arma::Mat<ElemType>& distances,
+                 const size_t referenceOffset)
+{
+  const string graphFile = CLI::GetParam<string>("graph_file");
+  if (graphFile != "")
+  {
+    arma::Mat<size_t> edges;
+    arma::Col<ElemType> weights;
+    Timer::Start("graph_building");
+    NeighborGraph(neighbors, distances, edges, weights,
+        CLI::HasParam("mutual"));
+    Timer::Stop("graph_building");
+    Log::Info << "The neighbor graph has " << edges.n_cols / 2 << " edges."
+        << endl;
+
+    // One line for each edge: the two points and the distance.  This is in
+    // double precision even with --float, so that the indices are exact.
+    arma::mat graph(3, edges.n_cols);
+    for (size_t e = 0; e < edges.n_cols; ++e)
+    {
+      graph(0, e) = (double) edges(0, e);
+      graph(1, e) = (double) edges(1, e);
+      graph(2, e) = (double) weights[e];
+    }
+    data::Save(graphFile, graph);
+  }
+
+  if (referenceOffset != 0)
+    neighbors += referenceOffset;
+
+  if (CLI::GetParam<string>("distances_file") != "")
+    data::Save(CLI::GetParam<string>("distances_file"), distances);
+  if (CLI::GetParam<string>("neighbors_file") != "")
+    data::Save(CLI::GetParam<string>("neighbors_file"), neighbors);
+}
+
+/**
+ * Run the search with kd-trees on single-precision data, loaded directly from
+ * the given files, and save the results.
+ */
+void FloatSearch(const string& referenceFile,
+                 const string& queryFile,
+                 const size_t k,
+                 size_t leafSize,
+                 const bool naive,
+                 const bool singleMode,
+                 const size_t numThreads,
+                 const double epsilon,
+                 const size_t singleBatchSize,
+                 const size_t referenceOffset)
+{
+  typedef BinarySpaceTree<bound::HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort>, arma::fmat> FloatTreeType;
+  typedef NeighborSearch<NearestNeighborSort, metric::EuclideanDistance,
+      FloatTreeType> FloatAllkNN;
+
+  arma::fmat referenceData;
+  arma::fmat queryData;
+
+  data::Load(referenceFile, referenceData, true);
+  Log::Info << "Loaded reference data from '" << referenceFile << "' ("
+      << referenceData.n_rows << " x " << referenceData.n_cols << ")." << endl;
+
+  if (queryFile != "")
+  {
+    data::Load(queryFile, queryData, true);
+    Log::Info << "Loaded query data from '" << queryFile << "' ("
+        << queryData.n_rows << " x " << queryData.n_cols << ")." << endl;
+  }
+
+  if (k > referenceData.n_cols)
+  {
+    Log::Fatal << "Invalid k: " << k << "; must be greater than 0 and less "
+        << "than or equal to the number of reference points ("
+        << referenceData.n_cols << ")." << endl;
+  }
+
+  if (naive)
+  {
+    // The matrices are not needed after the search, so they are moved into the
+    // object instead of copied.
+    FloatAllkNN* allknn = (queryFile != "") ?
+        new FloatAllkNN(std::move(referenceData), std::move(queryData), true) :
+        new FloatAllkNN(std::move(referenceData), true);
+
+    arma::fmat distances;
+    arma::Mat<size_t> neighbors;
+    Log::Info << "Computing " << k << " nearest neighbors by brute force..."
+        << endl;
+    allknn->NumThreads() = numThreads;
+    allknn->Search(k, neighbors, distances);
+    Log::Info << "Neighbors computed." << endl;
+    delete allknn;
+
+    SaveResults(neighbors, distances, referenceOffset);
+    return;
+  }
+
+  // As in the double-precision search, build the trees by hand so that the
+  // matrices are not copied.
+  Log::Info << "Building reference tree..." << endl;
+  Timer::Start("tree_building");
+  std::vector<size_t> oldFromNewRefs;
+  FloatTreeType refTree(referenceData, oldFromNewRefs, leafSize);
+  Timer::Stop("tree_building");
+
+  FloatTreeType* queryTree = NULL;
+  std::vector<size_t> oldFromNewQueries;
+  FloatAllkNN* allknn = NULL;
+  if (queryFile != "")
+  {
+    if (!singleMode)
+    {
+      Log::Info << "Building query tree..." << endl;
+      Timer::Start("tree_building");
+      queryTree = new FloatTreeType(queryData, oldFromNewQueries, leafSize);
+      Timer::Stop("tree_building");
+    }
+
+    allknn = new FloatAllkNN(&refTree, queryTree, referenceData, queryData,
+        singleMode);
+  }
+  else
+  {
+    allknn = new FloatAllkNN(&refTree, referenceData, singleMode);
+  }
+
+  arma::fmat distances;
+  arma::Mat<size_t> neighbors;
+
+  Log::Info << "Computing " << k << " nearest neighbors..." << endl;
+  allknn->NumThreads() = numThreads;
+  allknn->Epsilon() = epsilon;
+  allknn->SingleBatchSize() = singleBatchSize;
+  allknn->Search(k, neighbors, distances);
+  Log::Info << "Neighbors computed." << endl;
+
+  if ((queryFile != "") && !singleMode)
+    UnmapInPlace(neighbors, distances, oldFromNewRefs, oldFromNewQueries,
+        false, numThreads);
+  else if (queryFile != "")
+    UnmapInPlace(neighbors, distances, oldFromNewRefs, false, numThreads);
+  else
+    UnmapInPlace(neighbors, distances, oldFromNewRefs, oldFromNewRefs, false,
+        numThreads);
+
+  delete allknn;
+  if (queryTree)
+    delete queryTree;
+
+  SaveResults(neighbors, distances, referenceOffset);
+}
+
+typedef BinarySpaceTree<bound::BallBound<>,
+    NeighborSearchStat<NearestNeighborSort> > BallTreeType;
+
+/**
+ * Run the search with ball trees.  The trees are built in parallel, like
+ * kd-trees, and the results are put back in the original order of the points.
+ */
+void BallTreeSearch(arma::mat& referenceData,
+                    arma::mat& queryData,
+                    const bool hasQueries,
+                    const size_t k,
+                    const size_t leafSize,
+                    const bool singleMode,
+                    const size_t numThreads,
+                    const double epsilon,
+                    const size_t singleBatchSize,
+                    arma::Mat<size_t>& neighbors,
+                    arma::mat& distances)
+{
+  typedef NeighborSearch<NearestNeighborSort, metric::EuclideanDistance,
+      BallTreeType> BallAllkNN;
+
+  Log::Info << "Using ball trees for nearest-neighbor calculation." << endl;
+
+  Log::Info << "Building reference tree..." << endl;
+  Timer::Start("tree_building");
+  std::vector<size_t> oldFromNewRefs;
+  BallTreeType refTree(referenceData, oldFromNewRefs, leafSize);
+  Timer::Stop("tree_building");
+
+  BallTreeType* queryTree = NULL;
+  std::vector<size_t> oldFromNewQueries;
+  BallAllkNN* allknn = NULL;
+  if (hasQueries)
+  {
+    if (!singleMode)
+    {
+      Log::Info << "Building query tree..." << endl;
+      Timer::Start("tree_building");
+      queryTree = new BallTreeType(queryData, oldFromNewQueries, leafSize);
+      Timer::Stop("tree_building");
+    }
+
+    allknn = new BallAllkNN(&refTree, queryTree, referenceData, queryData,
+        singleMode);
+  }
+  else
+  {
+    allknn = new BallAllkNN(&refTree, referenceData, singleMode);
+  }
+
+  Log::Info << "Computing " << k << " nearest neighbors..." << endl;
+  allknn->NumThreads() = numThreads;
+  allknn->Epsilon() = epsilon;
+  allknn->SingleBatchSize() = singleBatchSize;
+  allknn->Search(k, neighbors, distances);
+  Log::Info << "Neighbors computed." << endl;
+
+  if (hasQueries && !singleMode)
+    UnmapInPlace(neighbors, distances, oldFromNewRefs, oldFromNewQueries,
+        false, numThreads);
+  else if (hasQueries)
+    UnmapInPlace(neighbors, distances, oldFromNewRefs, false, numThreads);
+  else
+    UnmapInPlace(neighbors, distances, oldFromNewRefs, oldFromNewRefs, false,
+        numThreads);
+
+  delete allknn;
+  if (queryTree)
+    delete queryTree;
+}
+
+typedef CoverTree<metric::LMetric<2, true>, tree::FirstPointIsRoot,
+    NeighborSearchStat<NearestNeighborSort> > CoverTreeType;
+
+//! The search settings chosen by AutoTune().
+struct SearchSettings
+{
+  //! If true, use brute-force search.
+  bool naive;
+  //! If true, use single-tree search.
+  bool singleMode;
+  //! If true, use cover trees instead of kd-trees.
+  bool coverTree;
+  //! The leaf size of the kd-trees.
+  size_t leafSize;
+  //! The estimated time of the full search, in seconds.
+  double time;
+};
+
+//! Get the number of seconds since the given time of ScopedTimer::Now().
+double SecondsSince(const uint64_t start)
+{
+  return (ScopedTimer::Now() - start) * 1e-9;
+}
+
+/**
+ * Estimate the intrinsic dimension of a dataset from the distances of some of
+ * its points to their nearest neighbors (sorted, one column for each point),
+ * with the maximum likelihood estimator of Levina and Bickel, averaged over
+ * the points as suggested by MacKay and Ghahramani.  Zero distances (to the
+ * point itself, or to duplicates) are skipped; if no point has two nonzero
+ * distances, 0 is returned.
+ */
+double IntrinsicDimension(const arma::mat& distances)
+{
+  double inverseSum = 0.0;
+  size_t points = 0;
+  for (size_t i = 0; i < distances.n_cols; ++i)
+  {
+    size_t first = 0;
+    while (first < distances.n_rows && distances(first, i) <= 0.0)
+      ++first;
+
+    const double last = distances(distances.n_rows - 1, i);
+    if (distances.n_rows - first < 2 || last == DBL_MAX)
+      continue;
+
+    double sum = 0.0;
+    for (size_t j = first; j < distances.n_rows - 1; ++j)
+      sum += std::log(last / distances(j, i));
+
+    inverseSum += sum / (distances.n_rows - first - 1);
+    ++points;
+  }
+
+  return (inverseSum > 0.0) ? points / inverseSum : 0.0;
+}
+
+/**
+ * Time the search of a sample of the query points, log the number of base
+ * cases and scores of the traversal, and return the time in seconds.
+ */
+template<typename SearchType>
+double TimeSearch(SearchType& search,
+                  const size_t k,
+                  const size_t numThreads,
+                  const double epsilon,
+                  arma::mat& distances)
+{
+  arma::Mat<size_t> neighbors;
+  search.NumThreads() = numThreads;
+  search.Epsilon() = epsilon;
+
+  const uint64_t start = ScopedTimer::Now();
+  search.Search(k, neighbors, distances);
+  const double time = SecondsSince(start);
+
+  Log::Info << "  " << search.BaseCases() << " base cases and "
+      << search.Scores() << " scores in " << time << "s." << endl;
+  return time;
+}
+
+//! Log the estimated time of a trial, and keep it if it is the fastest yet.
+void Consider(SearchSettings& best,
+              const SearchSettings& trial,
+              const string& description)
+{
+  Log::Info << "Estimated time with " << description << ": " << trial.time
+      << "s." << endl;
+  if (trial.time < best.time)
+    best = trial;
+}
+
+/**
+ * Choose the tree type, leaf size, and single-tree or dual-tree (or
+ * brute-force) search, by timing trial searches of a sample of the query
+ * points with each and extrapolating to the whole query set.  Each trial
+ * includes building the reference tree on the whole reference set.  The
+ * intrinsic dimension of the data is estimated from the first trial; if it is
+ * so high that trees can prune little, only kd-trees with the default leaf
+ * size are compared with brute-force search.
+ *
+ * @param referenceData The reference set.
+ * @param queryData The query set (empty if the reference set is searched).
+ * @param k Number of neighbors to search for.
+ * @param numThreads Number of threads for each search.
+ * @param epsilon Relative error allowed in each search.
+ */
+SearchSettings AutoTune(const arma::mat& referenceData,
+                        const arma::mat& queryData,
+                        const size_t k,
+                        const size_t numThreads,
+                        const double epsilon)
+{
+  Timer::Start("auto_tuning");
+
+  // The sample is spread evenly over the query points.
+  const bool monochromatic = (queryData.n_cols == 0);
+  const arma::mat& queries = monochromatic ? referenceData : queryData;
+  const size_t sampleSize = std::min((size_t) queries.n_cols, (size_t) 1000);
+  arma::mat sample(queries.n_rows, sampleSize);
+  for (size_t i = 0; i < sampleSize; ++i)
+    sample.col(i) = queries.col(i * queries.n_cols / sampleSize);
+  const double scale = (double) queries.n_cols / sampleSize;
+
+  Log::Info << "Tuning the search on " << sampleSize << " of the "
+      << queries.n_cols << " query points..." << endl;
+
+  SearchSettings best;
+  best.naive = false;
+  best.singleMode = false;
+  best.coverTree = false;
+  best.leafSize = 20;
+  best.time = DBL_MAX;
+
+  SearchSettings trial = best;
+  arma::mat distances;
+  double intrinsicDimension = 0.0;
+  const size_t leafSizes[] = { 20, 10, 40, 80 };
+  for (size_t l = 0; l < 4; ++l)
+  {
+    // When trees prune little, their leaf size hardly matters.
+    if (l > 0 && intrinsicDimension > 20.0)
+      break;
+
+    arma::mat referenceCopy(referenceData);
+    std::vector<size_t> oldFromNewRefs;
+    uint64_t start = ScopedTimer::Now();
+    TreeType referenceTree(referenceCopy, oldFromNewRefs, leafSizes[l]);
+    const double referenceBuildTime = SecondsSince(start);
+
+    arma::mat sampleCopy(sample);
+    std::vector<size_t> oldFromNewQueries;
+    start = ScopedTimer::Now();
+    TreeType queryTree(sampleCopy, oldFromNewQueries, leafSizes[l]);
+    const double queryBuildTime = SecondsSince(start);
+
+    trial.leafSize = leafSizes[l];
+    std::ostringstream description;
+    description << "kd-trees (leaf size " << leafSizes[l] << ")";
+
+    AllkNN dualTree(&referenceTree, &queryTree, referenceCopy, sampleCopy);
+    trial.singleMode = false;
+    trial.time = referenceBuildTime + scale * TimeSearch(dualTree, k,
+        numThreads, epsilon, distances);
+    // A monochromatic search uses the reference tree as the query tree.
+    if (!monochromatic)
+      trial.time += scale * queryBuildTime;
+    Consider(best, trial, description.str() + ", dual-tree search");
+
+    if (l == 0)
+    {
+      intrinsicDimension = IntrinsicDimension(distances);
+      Log::Info << "Estimated intrinsic dimension: " << intrinsicDimension
+          << " (of " << referenceData.n_rows << ")." << endl;
+    }
+
+    AllkNN singleTree(&referenceTree, NULL, referenceCopy, sample, true);
+    trial.singleMode = true;
+    trial.time = referenceBuildTime + scale * TimeSearch(singleTree, k,
+        numThreads, epsilon, distances);
+    Consider(best, trial, description.str() + ", single-tree search");
+  }
+
+  if (intrinsicDimension <= 20.0)
+  {
+    uint64_t start = ScopedTimer::Now();
+    CoverTreeType referenceTree(referenceData, 1.3);
+    const double referenceBuildTime = SecondsSince(start);
+
+    start = ScopedTimer::Now();
+    CoverTreeType queryTree(sample, 1.3);
+    const double queryBuildTime = SecondsSince(start);
+
+    trial.coverTree = true;
+    trial.leafSize = 20;
+
+    NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>,
+        CoverTreeType> dualTree(&referenceTree, &queryTree, referenceData,
+        sample);
+    trial.singleMode = false;
+    trial.time = referenceBuildTime + scale * TimeSearch(dualTree, k,
+        numThreads, epsilon, distances);
+    if (!monochromatic)
+      trial.time += scale * queryBuildTime;
+    Consider(best, trial, "cover trees, dual-tree search");
+
+    NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>,
+        CoverTreeType> singleTree(&referenceTree, NULL, referenceData, sample,
+        true);
+    trial.singleMode = true;
+    trial.time = referenceBuildTime + scale * TimeSearch(singleTree, k,
+        numThreads, epsilon, distances);
+    Consider(best, trial, "cover trees, single-tree search");
+  }
+
+  // The time of brute-force search is proportional to the number of queries,
+  // so a smaller sample is enough.
+  const size_t naiveSize = std::min(sampleSize, (size_t) 256);
+  arma::mat naiveSample(sample.cols(0, naiveSize - 1));
+  AllkNN naive(referenceData, naiveSample, true);
+  trial.naive = true;
+  trial.singleMode = false;
+  trial.coverTree = false;
+  trial.time = ((double) queries.n_cols / naiveSize) * TimeSearch(naive, k,
+      numThreads, epsilon, distances);
+  Consider(best, trial, "brute-force search");
+
+  Timer::Stop("auto_tuning");
+  return best;
+}
 
 int main(int argc, char *argv[])
 {
@@ -75,10 +757,13 @@ int main(int argc, char *argv[])
 
   // Get all the parameters.
   const string referenceFile = CLI::GetParam<string>("reference_file");
+  const string inputTreeFile = CLI::GetParam<string>("input_tree_file");
+  const string outputTreeFile = CLI::GetParam<string>("output_tree_file");
   const string queryFile = CLI::GetParam<string>("query_file");
 
   const string distancesFile = CLI::GetParam<string>("distances_file");
   const string neighborsFile = CLI::GetParam<string>("neighbors_file");
+  const string graphFile = CLI::GetParam<string>("graph_file");
 
   int lsInt = CLI::GetParam<int>("leaf_size");
 
@@ -86,16 +771,219 @@ int main(int argc, char *argv[])
 
   bool naive = CLI::HasParam("naive");
   bool singleMode = CLI::HasParam("single_mode");
+  bool coverTree = CLI::HasParam("cover_tree");
+  bool rTree = CLI::HasParam("r_tree");
+  bool ballTree = CLI::HasParam("ball_tree");
+  const bool autoTune = CLI::HasParam("auto");
+
+  // In server mode, the results are sent to the clients instead of saved.
+  const bool serve = CLI::HasParam("server");
+  if (serve)
+  {
+    if (naive || CLI::HasParam("cover_tree") || CLI::HasParam("r_tree") ||
+        ballTree || CLI::HasParam("random_basis") ||
+        CLI::HasParam("mahalanobis_file") || CLI::HasParam("float") ||
+        queryFile != "" || graphFile != "")
+      Log::Fatal << "--server cannot be used with --naive, --cover_tree, "
+          << "--r_tree, --ball_tree, --random_basis, --mahalanobis_file, "
+          << "--float, --query_file, or --graph_file." << endl;
+    if (distancesFile != "" || neighborsFile != "")
+      Log::Warn << "--distances_file and --neighbors_file ignored because "
+          << "--server is present." << endl;
+  }
+  else if (graphFile != "")
+  {
+    if (queryFile != "")
+      Log::Fatal << "--graph_file cannot be used with --query_file." << endl;
+    if (CLI::GetParam<int>("reference_offset") != 0)
+      Log::Fatal << "--graph_file cannot be used with --reference_offset."
+          << endl;
+  }
+  else if (distancesFile == "" || neighborsFile == "")
+  {
+    Log::Fatal << "--distances_file and --neighbors_file are required unless "
+        << "--server or --graph_file is given." << endl;
+  }
+
+  if (CLI::HasParam("mutual") && graphFile == "")
+    Log::Warn << "--mutual ignored because --graph_file is not given." << endl;
+
+  // The points of a lazily built tree move during the search, so they can't be
+  // the query points.
+  const bool lazyTree = CLI::HasParam("lazy_tree");
+  if (lazyTree)
+  {
+    if (naive || CLI::HasParam("cover_tree") || CLI::HasParam("r_tree") ||
+        ballTree || CLI::HasParam("float") || autoTune ||
+        CLI::HasParam("input_tree_file") || CLI::HasParam("output_tree_file"))
+      Log::Fatal << "--lazy_tree cannot be used with --naive, --cover_tree, "
+          << "--r_tree, --ball_tree, --float, --auto, --input_tree_file, or "
+          << "--output_tree_file." << endl;
+    if (queryFile == "" && !serve)
+      Log::Fatal << "--lazy_tree requires --query_file or --server." << endl;
+  }
+
+  // Streamed queries are searched with kd-trees on the unmodified points, and
+  // the results are appended to the output files as they are found.
+  if (CLI::GetParam<int>("query_block_size") < 0)
+  {
+    Log::Fatal << "Invalid query block size: "
+        << CLI::GetParam<int>("query_block_size") << ".  Must be greater than "
+        << "or equal to 0." << endl;
+  }
+  const size_t queryBlockSize = (size_t) CLI::GetParam<int>("query_block_size");
+  if (queryBlockSize != 0)
+  {
+    if (queryFile == "")
+      Log::Fatal << "--query_block_size requires --query_file." << endl;
+    if (naive || CLI::HasParam("cover_tree") || CLI::HasParam("r_tree") ||
+        ballTree || CLI::HasParam("float") || autoTune || lazyTree ||
+        CLI::HasParam("random_basis") || CLI::HasParam("mahalanobis_file"))
+      Log::Fatal << "--query_block_size cannot be used with --naive, "
+          << "--cover_tree, --r_tree, --ball_tree, --float, --auto, "
+          << "--lazy_tree, --random_basis, or --mahalanobis_file." << endl;
+  }
+
+  // Sanity check on the number of threads.
+  if (CLI::GetParam<int>("num_threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: "
+        << CLI::GetParam<int>("num_threads") << ".  Must be greater than or "
+        << "equal to 0." << endl;
+  }
+  const size_t numThreads = (size_t) CLI::GetParam<int>("num_threads");
+
+  // Sanity check on epsilon.
+  const double epsilon = CLI::GetParam<double>("epsilon");
+  if (epsilon < 0)
+  {
+    Log::Fatal << "Invalid epsilon: " << epsilon << ".  Must be greater "
+        << "than or equal to 0." << endl;
+  }
+
+  // Sanity check on the single-tree batch size.
+  if (CLI::GetParam<int>("single_batch_size") < 0)
+  {
+    Log::Fatal << "Invalid single-tree batch size: "
+        << CLI::GetParam<int>("single_batch_size") << ".  Must be greater "
+        << "than or equal to 0." << endl;
+  }
+  const size_t singleBatchSize =
+      (size_t) CLI::GetParam<int>("single_batch_size");
+
+  // Sanity check on the reference offset.
+  if (CLI::GetParam<int>("reference_offset") < 0)
+  {
+    Log::Fatal << "Invalid reference offset: "
+        << CLI::GetParam<int>("reference_offset") << ".  Must be greater than "
+        << "or equal to 0." << endl;
+  }
+  const size_t referenceOffset =
+      (size_t) CLI::GetParam<int>("reference_offset");
   const bool randomBasis = CLI::HasParam("random_basis");
+  const string mahalanobisFile = CLI::GetParam<string>("mahalanobis_file");
+
+  // A saved tree can only be used as a kd-tree on the unprojected data.
+  if (inputTreeFile != "")
+  {
+    if (referenceFile != "")
+      Log::Warn << "--reference_file ignored because --input_tree_file is "
+          << "present." << endl;
+    if (naive || CLI::HasParam("cover_tree") || CLI::HasParam("r_tree") ||
+        ballTree || randomBasis || mahalanobisFile != "")
+      Log::Fatal << "--input_tree_file cannot be used with --naive, "
+          << "--cover_tree, --r_tree, --ball_tree, --random_basis, or "
+          << "--mahalanobis_file." << endl;
+  }
+  else if (referenceFile == "")
+  {
+    Log::Fatal << "Either --reference_file or --input_tree_file must be "
+        << "specified." << endl;
+  }
+
+  if (outputTreeFile != "" && (naive || CLI::HasParam("cover_tree") ||
+      CLI::HasParam("r_tree") || ballTree))
+    Log::Warn << "--output_tree_file ignored because only kd-trees can be "
+        << "saved." << endl;
+
+  // Sanity check on leaf size.
+  if (lsInt < 1)
+  {
+    Log::Fatal << "Invalid leaf size: " << lsInt << ".  Must be greater "
+        "than 0." << endl;
+  }
+
+  const string curveOrder = CLI::GetParam<string>("curve_order");
+  if (curveOrder != "none" && curveOrder != "morton" && curveOrder != "hilbert")
+  {
+    Log::Fatal << "Invalid curve order: '" << curveOrder << "'; must be "
+        << "'none', 'morton', or 'hilbert'." << endl;
+  }
+  if (curveOrder != "none" && (queryFile == "" || serve ||
+      CLI::HasParam("float") || queryBlockSize != 0))
+    Log::Warn << "--curve_order ignored because there is no --query_file, or "
+        << "--server, --float or --query_block_size is present." << endl;
+
+  if (autoTune)
+  {
+    if (serve || inputTreeFile != "" || outputTreeFile != "" ||
+        CLI::HasParam("float"))
+      Log::Fatal << "--auto cannot be used with --server, --input_tree_file, "
+          << "--output_tree_file, or --float." << endl;
+    if (naive || singleMode || coverTree || rTree || ballTree ||
+        CLI::HasParam("leaf_size"))
+      Log::Warn << "--naive, --single_mode, --cover_tree, --r_tree, "
+          << "--ball_tree, and --leaf_size ignored because --auto is present."
+          << endl;
+  }
+
+  if (CLI::HasParam("float"))
+  {
+    if (inputTreeFile != "" || CLI::HasParam("cover_tree") ||
+        CLI::HasParam("r_tree") || ballTree || randomBasis ||
+        mahalanobisFile != "")
+      Log::Fatal << "--float cannot be used with --input_tree_file, "
+          << "--cover_tree, --r_tree, --ball_tree, --random_basis, or "
+          << "--mahalanobis_file." << endl;
+    if (outputTreeFile != "")
+      Log::Warn << "--output_tree_file ignored because --float is present."
+          << endl;
+    if (singleMode && naive)
+      Log::Warn << "--single_mode ignored because --naive is present." << endl;
+
+    FloatSearch(referenceFile, queryFile, k, (size_t) lsInt, naive,
+        singleMode && !naive, numThreads, epsilon, singleBatchSize,
+        referenceOffset);
+    return 0;
+  }
 
   arma::mat referenceData;
   arma::mat queryData; // So it doesn't go out of scope.
-  data::Load(referenceFile, referenceData, true);
 
-  Log::Info << "Loaded reference data from '" << referenceFile << "' ("
-      << referenceData.n_rows << " x " << referenceData.n_cols << ")." << endl;
+  // The reference kd-tree and its mapping, if we load it from a file.
+  TreeType* refTree = NULL;
+  std::vector<size_t> oldFromNewRefs;
 
-  if (queryFile != "")
+  if (inputTreeFile != "")
+  {
+    Timer::Start("tree_loading");
+    refTree = new TreeType(inputTreeFile, referenceData, oldFromNewRefs);
+    Timer::Stop("tree_loading");
+
+    Log::Info << "Loaded reference tree and data from '" << inputTreeFile
+        << "' (" << referenceData.n_rows << " x " << referenceData.n_cols
+        << ")." << endl;
+  }
+  else
+  {
+    data::Load(referenceFile, referenceData, true);
+
+    Log::Info << "Loaded reference data from '" << referenceFile << "' ("
+        << referenceData.n_rows << " x " << referenceData.n_cols << ")."
+        << endl;
+  }
+
+  if (queryFile != "" && queryBlockSize == 0)
   {
     data::Load(queryFile, queryData, true);
     Log::Info << "Loaded query data from '" << queryFile << "' ("
@@ -111,12 +999,6 @@ int main(int argc, char *argv[])
     Log::Fatal << referenceData.n_cols << ")." << endl;
   }
 
-  // Sanity check on leaf size.
-  if (lsInt < 1)
-  {
-    Log::Fatal << "Invalid leaf size: " << lsInt << ".  Must be greater "
-        "than 0." << endl;
-  }
   size_t leafSize = lsInt;
 
   // Naive mode overrides single mode.
@@ -130,73 +1012,177 @@ int main(int argc, char *argv[])
   {
     Log::Warn << "--cover_tree overrides --r_tree." << endl;
   }
+
+  if (ballTree && (coverTree || rTree))
+  {
+    Log::Fatal << "--ball_tree cannot be used with --cover_tree or --r_tree."
+        << endl;
+  }
+
+  if (ballTree && naive)
+  {
+    Log::Warn << "--ball_tree ignored because --naive is present." << endl;
+    ballTree = false;
+  }
   
   if (naive)
     leafSize = referenceData.n_cols;
 
+  // The Euclidean distance between the transformed points is the Mahalanobis
+  // distance between the original points.
+  if (mahalanobisFile != "")
+  {
+    metric::MahalanobisDistance<> mahalanobis;
+    data::Load(mahalanobisFile, mahalanobis.Covariance(), true);
+    if (mahalanobis.Covariance().n_rows != referenceData.n_rows ||
+        mahalanobis.Covariance().n_cols != referenceData.n_rows)
+    {
+      Log::Fatal << "The Mahalanobis matrix in '" << mahalanobisFile
+          << "' must be " << referenceData.n_rows << " x "
+          << referenceData.n_rows << "!" << endl;
+    }
+
+    mahalanobis.Transform(referenceData, referenceData);
+    if (queryFile != "")
+      mahalanobis.Transform(queryData, queryData);
+
+    Log::Info << "Transformed the data by the factor of the Mahalanobis "
+        << "matrix (" << referenceData.n_rows << " dimensions)." << endl;
+  }
+
   // See if we want to project onto a random basis.
   if (randomBasis)
   {
-    // Generate the random basis.
-    while (true)
-    {
-      // [Q, R] = qr(randn(d, d));
-      // Q = Q * diag(sign(diag(R)));
-      arma::mat q, r;
-      if (arma::qr(q, r, arma::randn<arma::mat>(referenceData.n_rows,
-          referenceData.n_rows)))
-      {
-        arma::vec rDiag(r.n_rows);
-        for (size_t i = 0; i < rDiag.n_elem; ++i)
-        {
-          if (r(i, i) < 0)
-            rDiag(i) = -1;
-          else if (r(i, i) > 0)
-            rDiag(i) = 1;
-          else
-            rDiag(i) = 0;
-        }
+    arma::mat q;
+    math::RandomBasis(q, referenceData.n_rows);
 
-        q *= arma::diagmat(rDiag);
+    referenceData = q * referenceData;
+    if (queryFile != "")
+      queryData = q * queryData;
+  }
 
-        // Check if the determinant is positive.
-        if (arma::det(q) >= 0)
-        {
-          referenceData = q * referenceData;
-          if (queryFile != "")
-            queryData = q * queryData;
-          break;
-        }
-      }
-    }
+  if (autoTune)
+  {
+    const SearchSettings settings = AutoTune(referenceData, queryData, k,
+        numThreads, epsilon);
+    naive = settings.naive;
+    singleMode = settings.singleMode;
+    coverTree = settings.coverTree;
+    rTree = false;
+    ballTree = false;
+    leafSize = settings.leafSize;
+
+    Log::Info << "Using " << (naive ? "brute-force" : singleMode ?
+        "single-tree" : "dual-tree") << " search";
+    if (coverTree)
+      Log::Info << " with cover trees";
+    else if (!naive)
+      Log::Info << " with kd-trees (leaf size " << leafSize << ")";
+    Log::Info << "." << endl;
+  }
+
+  // Rearrange the query points along the space-filling curve; the results are
+  // put back in the original order before they are saved.
+  std::vector<size_t> oldFromNewCurve;
+  if (curveOrder != "none" && queryFile != "" && !serve &&
+      queryBlockSize == 0)
+  {
+    Timer::Start("curve_ordering");
+    if (curveOrder == "morton")
+      data::MortonOrder(queryData, oldFromNewCurve);
+    else
+      data::HilbertOrder(queryData, oldFromNewCurve);
+    data::ReorderColumns(queryData, oldFromNewCurve);
+    Timer::Stop("curve_ordering");
   }
 
   arma::Mat<size_t> neighbors;
   arma::mat distances;
 
-  if (!CLI::HasParam("cover_tree"))
+  if (ballTree)
+  {
+    BallTreeSearch(referenceData, queryData, queryFile != "", k, leafSize,
+        singleMode, numThreads, epsilon, singleBatchSize, neighbors,
+        distances);
+  }
+  else if (!coverTree)
   {
-    if(!CLI::HasParam("r_tree"))
+    if (!rTree && naive)
+    {
+      // Brute-force search needs no trees, so the points are not rearranged.
+      AllkNN* allknn = (queryFile != "") ?
+          new AllkNN(referenceData, queryData, true) :
+          new AllkNN(referenceData, true);
+
+      Log::Info << "Computing " << k << " nearest neighbors by brute force..."
+          << endl;
+      allknn->NumThreads() = numThreads;
+      allknn->Search(k, neighbors, distances);
+      Log::Info << "Neighbors computed." << endl;
+
+      delete allknn;
+    }
+    else if (!rTree)
     {
       // Because we may construct it differently, we need a pointer.
       AllkNN* allknn = NULL;
 
-      // Mappings for when we build the tree.
-      std::vector<size_t> oldFromNewRefs;
-
       // Build trees by hand, so we can save memory: if we pass a tree to
-      // NeighborSearch, it does not copy the matrix.
-      Log::Info << "Building reference tree..." << endl;
-      Timer::Start("tree_building");
+      // NeighborSearch, it does not copy the matrix.  If the reference tree
+      // was loaded from a file, there is nothing to build.
+      if (!refTree)
+      {
+        Log::Info << "Building reference tree..." << endl;
+        Timer::Start("tree_building");
 
-      BinarySpaceTree<bound::HRectBound<2>,
-	  NeighborSearchStat<NearestNeighborSort> >
-	  refTree(referenceData, oldFromNewRefs, leafSize);
-      BinarySpaceTree<bound::HRectBound<2>,
-	  NeighborSearchStat<NearestNeighborSort> >*
-	  queryTree = NULL; // Empty for now.
+        refTree = new TreeType(referenceData, oldFromNewRefs, leafSize,
+            lazyTree);
 
-      Timer::Stop("tree_building");
+        Timer::Stop("tree_building");
+      }
+
+      if (outputTreeFile != "" && !naive)
+      {
+        refTree->Save(outputTreeFile, oldFromNewRefs);
+        Log::Info << "Saved reference tree to '" << outputTreeFile << "'."
+            << endl;
+      }
+
+      if (serve)
+      {
+        SearchHandler handler(*refTree, referenceData, oldFromNewRefs, k,
+            leafSize, numThreads, epsilon);
+        Server<SearchHandler> server(handler);
+        server.Run(CLI::GetParam<string>("server"));
+
+        delete refTree;
+        return 0;
+      }
+
+      if (queryBlockSize != 0)
+      {
+        data::StreamingReader queries(queryFile, queryBlockSize);
+        ofstream neighborsOut(neighborsFile.c_str());
+        ofstream distancesOut(distancesFile.c_str());
+        if (!neighborsOut.is_open() || !distancesOut.is_open())
+          Log::Fatal << "Could not open '" << neighborsFile << "' and '"
+              << distancesFile << "' for writing." << endl;
+
+        Log::Info << "Computing " << k << " nearest neighbors of the points in "
+            << "'" << queryFile << "' in blocks of " << queryBlockSize
+            << " points..." << endl;
+        const size_t points = StreamSearch<NearestNeighborSort>(*refTree,
+            referenceData, oldFromNewRefs, queries, k, neighborsOut,
+            distancesOut, leafSize, singleMode, numThreads, epsilon,
+            singleBatchSize, referenceOffset);
+        Log::Info << "Neighbors of " << points << " query points computed."
+            << endl;
+
+        delete refTree;
+        return 0;
+      }
+
+      TreeType* queryTree = NULL; // Empty for now.
 
       std::vector<size_t> oldFromNewQueries;
 
@@ -216,30 +1202,28 @@ int main(int argc, char *argv[])
 	{
 	  Timer::Start("tree_building");
 
-	  queryTree = new BinarySpaceTree<bound::HRectBound<2>,
-	      NeighborSearchStat<NearestNeighborSort> >(queryData,
-	      oldFromNewQueries, leafSize);
+	  queryTree = new TreeType(queryData, oldFromNewQueries, leafSize);
 
 	  Timer::Stop("tree_building");
 	}
 
-	allknn = new AllkNN(&refTree, queryTree, referenceData, queryData,
+	allknn = new AllkNN(refTree, queryTree, referenceData, queryData,
 	    singleMode);
 
 	Log::Info << "Tree built." << endl;
       }
       else
       {
-	allknn = new AllkNN(&refTree, referenceData, singleMode);
+	allknn = new AllkNN(refTree, referenceData, singleMode);
 
 	Log::Info << "Trees built." << endl;
       }
 
-      arma::mat distancesOut;
-      arma::Mat<size_t> neighborsOut;
-
       Log::Info << "Computing " << k << " nearest neighbors..." << endl;
-      allknn->Search(k, neighborsOut, distancesOut);
+      allknn->NumThreads() = numThreads;
+      allknn->Epsilon() = epsilon;
+      allknn->SingleBatchSize() = singleBatchSize;
+      allknn->Search(k, neighbors, distances);
 
       Log::Info << "Neighbors computed." << endl;
 
@@ -249,19 +1233,20 @@ int main(int argc, char *argv[])
 
       // Map the results back to the correct places.
       if ((CLI::GetParam<string>("query_file") != "") && !singleMode)
-	Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewQueries,
-	    neighbors, distances);
+	UnmapInPlace(neighbors, distances, oldFromNewRefs, oldFromNewQueries,
+	    false, numThreads);
       else if ((CLI::GetParam<string>("query_file") != "") && singleMode)
-	Unmap(neighborsOut, distancesOut, oldFromNewRefs, neighbors, distances);
+	UnmapInPlace(neighbors, distances, oldFromNewRefs, false, numThreads);
       else
-	Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewRefs,
-	    neighbors, distances);
+	UnmapInPlace(neighbors, distances, oldFromNewRefs, oldFromNewRefs, false,
+	    numThreads);
 
       // Clean up.
       if (queryTree)
 	delete queryTree;
 
       delete allknn;
+      delete refTree;
     } else { // R tree.
       // Make sure to notify the user that they are using an r tree.
       Log::Info << "Using R tree for nearest-neighbor calculation." << endl;
@@ -333,6 +1318,9 @@ int main(int argc, char *argv[])
       //arma::Mat<size_t> neighborsOut;
 
       Log::Info << "Computing " << k << " nearest neighbors..." << endl;
+      allknn->NumThreads() = numThreads;
+      allknn->Epsilon() = epsilon;
+      allknn->SingleBatchSize() = singleBatchSize;
       allknn->Search(k, neighbors, distances);
 
       Log::Info << "Neighbors computed." << endl;
@@ -389,6 +1377,9 @@ int main(int argc, char *argv[])
     }
 
     Log::Info << "Computing " << k << " nearest neighbors..." << endl;
+    allknn->NumThreads() = numThreads;
+    allknn->Epsilon() = epsilon;
+    allknn->SingleBatchSize() = singleBatchSize;
     allknn->Search(k, neighbors, distances);
 
     Log::Info << "Neighbors computed." << endl;
@@ -399,7 +1390,11 @@ int main(int argc, char *argv[])
       delete queryTree;
   }
 
-  // Save put.
-  data::Save(distancesFile, distances);
-  data::Save(neighborsFile, neighbors);
+  if (!oldFromNewCurve.empty())
+  {
+    data::UnmapColumns(neighbors, oldFromNewCurve);
+    data::UnmapColumns(distances, oldFromNewCurve);
+  }
+
+  SaveResults(neighbors, distances, referenceOffset);
 }
@@ -0,0 +1,136 @@
+/**
+ * @file allknn_merge_main.cpp
+ *
+ * Merge the results of allknn (or allkfn) runs which searched the same query
+ * points in different shards of a reference set.
+ */
+#include <mlpack/core.hpp>
+
+#include <string>
+#include <vector>
+
+#include "sort_policies/nearest_neighbor_sort.hpp"
+#include "sort_policies/furthest_neighbor_sort.hpp"
+#include "merge_neighbors.hpp"
+
+using namespace std;
+using namespace mlpack;
+using namespace mlpack::neighbor;
+
+// Information about the program itself.
+PROGRAM_INFO("All K-Nearest-Neighbors Merge",
+    "This program merges the results of several runs of allknn which found the "
+    "neighbors of the same query points in different shards of a reference "
+    "set, into the k nearest neighbors of each query point in the whole "
+    "reference set.  Each run should be given the index of the first point of "
+    "its shard with --reference_offset, so that its neighbor indices refer to "
+    "the whole reference set."
+    "\n\n"
+    "The results to merge are given as comma-separated lists of distances and "
+    "neighbors files, in the same order.  For example, the following merges "
+    "the results of two shards:"
+    "\n\n"
+    "$ allknn_merge --k=5 --input_distances_files=d0.csv,d1.csv\n"
+    "  --input_neighbors_files=n0.csv,n1.csv --distances_file=distances.csv\n"
+    "  --neighbors_file=neighbors.csv"
+    "\n\n"
+    "The output of allknn_merge can itself be merged, so the results of many "
+    "shards can be merged in a tree of merges.  With --furthest, the results "
+    "of allkfn are merged.");
+
+PARAM_STRING_REQ("input_distances_files", "Comma-separated list of the "
+    "distances files of the runs to merge.", "D");
+PARAM_STRING_REQ("input_neighbors_files", "Comma-separated list of the "
+    "neighbors files of the runs to merge.", "N");
+PARAM_INT_REQ("k", "Number of neighbors to keep.", "k");
+PARAM_STRING_REQ("distances_file", "File to output the merged distances into.",
+    "d");
+PARAM_STRING_REQ("neighbors_file", "File to output the merged neighbors into.",
+    "n");
+PARAM_FLAG("furthest", "If true, merge furthest neighbors (from allkfn) "
+    "instead of nearest neighbors.", "f");
+
+//! Split a comma-separated list of filenames.
+vector<string> SplitFiles(const string& list)
+{
+  vector<string> files;
+  size_t begin = 0;
+  while (begin <= list.size())
+  {
+    size_t end = list.find(',', begin);
+    if (end == string::npos)
+      end = list.size();
+
+    if (end > begin)
+      files.push_back(list.substr(begin, end - begin));
+    begin = end + 1;
+  }
+
+  return files;
+}
+
+int main(int argc, char *argv[])
+{
+  // Give CLI the command line parameters the user passed in.
+  CLI::ParseCommandLine(argc, argv);
+
+  const vector<string> distancesFiles =
+      SplitFiles(CLI::GetParam<string>("input_distances_files"));
+  const vector<string> neighborsFiles =
+      SplitFiles(CLI::GetParam<string>("input_neighbors_files"));
+
+  if (distancesFiles.size() != neighborsFiles.size())
+  {
+    Log::Fatal << "There are " << distancesFiles.size() << " distances files "
+        << "but " << neighborsFiles.size() << " neighbors files." << endl;
+  }
+  if (distancesFiles.size() == 0)
+    Log::Fatal << "No results to merge were given." << endl;
+
+  if (CLI::GetParam<int>("k") <= 0)
+  {
+    Log::Fatal << "Invalid k: " << CLI::GetParam<int>("k") << "; must be "
+        << "greater than 0." << endl;
+  }
+  const size_t k = (size_t) CLI::GetParam<int>("k");
+
+  vector<arma::Mat<size_t> > neighborSets(neighborsFiles.size());
+  vector<arma::mat> distanceSets(distancesFiles.size());
+  for (size_t i = 0; i < distancesFiles.size(); ++i)
+  {
+    data::Load(distancesFiles[i], distanceSets[i], true);
+    data::Load(neighborsFiles[i], neighborSets[i], true);
+
+    if (neighborSets[i].n_rows != distanceSets[i].n_rows ||
+        neighborSets[i].n_cols != distanceSets[i].n_cols)
+    {
+      Log::Fatal << "The neighbors in '" << neighborsFiles[i] << "' do not "
+          << "match the distances in '" << distancesFiles[i] << "'." << endl;
+    }
+
+    if (neighborSets[i].n_cols != neighborSets[0].n_cols)
+    {
+      Log::Fatal << "The results in '" << neighborsFiles[i] << "' are for "
+          << neighborSets[i].n_cols << " query points, but the results in '"
+          << neighborsFiles[0] << "' are for " << neighborSets[0].n_cols
+          << "." << endl;
+    }
+  }
+
+  Log::Info << "Merging the results of " << neighborSets.size() << " runs..."
+      << endl;
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  Timer::Start("merging");
+  if (CLI::HasParam("furthest"))
+    MergeNeighbors<FurthestNeighborSort>(neighborSets, distanceSets, k,
+        neighbors, distances);
+  else
+    MergeNeighbors<NearestNeighborSort>(neighborSets, distanceSets, k,
+        neighbors, distances);
+  Timer::Stop("merging");
+
+  data::Save(CLI::GetParam<string>("distances_file"), distances);
+  data::Save(CLI::GetParam<string>("neighbors_file"), neighbors);
+}
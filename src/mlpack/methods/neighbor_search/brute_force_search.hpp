@@ -0,0 +1,77 @@
+/**
+ * @file brute_force_search.hpp
+ *
+ * Brute-force neighbor search for the Euclidean distance with matrix products.
+ * For high-dimensional data, where trees prune little, this is the fastest way
+ * to find the exact neighbors.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_BRUTE_FORCE_SEARCH_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_BRUTE_FORCE_SEARCH_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/metrics/lmetric.hpp>
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * Find the neighbors of every query point among all the reference points, for
+ * a metric and matrix type which have no faster brute-force search.  This does
+ * nothing and returns false, so that the caller evaluates the metric for every
+ * pair instead.
+ */
+template<typename SortPolicy,
+         typename CandidateListType,
+         typename MetricType,
+         typename MatType,
+         typename ElemType>
+bool BruteForceSearch(const MatType& /* referenceSet */,
+                      const MatType& /* querySet */,
+                      const MetricType& /* metric */,
+                      arma::Mat<size_t>& /* neighbors */,
+                      arma::Mat<ElemType>& /* distances */,
+                      const size_t /* numThreads */)
+{
+  return false;
+}
+
+/**
+ * Find the neighbors of every query point among all the reference points with
+ * the (squared or not) Euclidean distance.  The query and reference points are
+ * split into tiles, and the squared distances of each pair of tiles are
+ * computed at once as ||q||^2 + ||r||^2 - 2 q^T r, with one matrix product
+ * (done by BLAS, if Armadillo uses it).  Each candidate which may be good
+ * enough is then inserted into the candidate lists with its exact distance, so
+ * the results are the same as if every distance were evaluated directly.  The
+ * query tiles are searched in parallel.
+ *
+ * The candidate lists must be initialized as for NeighborSearchRules.  If the
+ * query set is the reference set (the same object), points are not their own
+ * neighbors.
+ *
+ * @param referenceSet Set of reference points.
+ * @param querySet Set of query points.
+ * @param metric The metric (unused; its distance is computed directly).
+ * @param neighbors Candidate neighbor lists.
+ * @param distances Candidate distance lists.
+ * @param numThreads Number of threads (0 means util::NumThreads()).
+ * @return true.
+ */
+template<typename SortPolicy,
+         typename CandidateListType,
+         bool TakeRoot,
+         typename eT>
+bool BruteForceSearch(const arma::Mat<eT>& referenceSet,
+                      const arma::Mat<eT>& querySet,
+                      const metric::LMetric<2, TakeRoot>& metric,
+                      arma::Mat<size_t>& neighbors,
+                      arma::Mat<eT>& distances,
+                      const size_t numThreads);
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+// Include implementation.
+#include "brute_force_search_impl.hpp"
+
+#endif
@@ -0,0 +1,159 @@
+/**
+ * @file brute_force_search_impl.hpp
+ *
+ * Implementation of brute-force neighbor search with matrix products.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_BRUTE_FORCE_SEARCH_IMPL_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_BRUTE_FORCE_SEARCH_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "brute_force_search.hpp"
+
+namespace mlpack {
+namespace neighbor {
+namespace aux {
+
+/**
+ * Searches one tile of query points against all the reference points, one tile
+ * of reference points at a time.  The tiles of query points hold disjoint
+ * columns of the candidate lists, so they can be searched in parallel.
+ */
+template<typename SortPolicy,
+         typename CandidateListType,
+         bool TakeRoot,
+         typename eT>
+class BruteForceTile
+{
+ public:
+  //! Number of query points in a tile.
+  static const size_t QueryBlock = 256;
+  //! Number of reference points in a tile.
+  static const size_t ReferenceBlock = 1024;
+
+  BruteForceTile(const arma::Mat<eT>& referenceSet,
+                 const arma::Mat<eT>& querySet,
+                 const arma::vec& referenceNorms,
+                 const arma::vec& queryNorms,
+                 arma::Mat<size_t>& neighbors,
+                 arma::Mat<eT>& distances) :
+      referenceSet(referenceSet),
+      querySet(querySet),
+      referenceNorms(referenceNorms),
+      queryNorms(queryNorms),
+      neighbors(neighbors),
+      distances(distances),
+      sameSet(&referenceSet == &querySet),
+      // A bound on the rounding error of each entry of the product, relative
+      // to the squared norms.
+      tolerance((referenceSet.n_rows + 4) * std::numeric_limits<eT>::epsilon())
+  { }
+
+  void operator()(const size_t tile)
+  {
+    const size_t queryBegin = tile * QueryBlock;
+    const size_t queryEnd = std::min(queryBegin + QueryBlock,
+        (size_t) querySet.n_cols);
+
+    arma::Mat<eT> products;
+    for (size_t refBegin = 0; refBegin < referenceSet.n_cols;
+         refBegin += ReferenceBlock)
+    {
+      const size_t refEnd = std::min(refBegin + ReferenceBlock,
+          (size_t) referenceSet.n_cols);
+
+      // products(r, q) is the inner product of reference point r and query
+      // point q of the tiles.
+      products = trans(referenceSet.cols(refBegin, refEnd - 1)) *
+          querySet.cols(queryBegin, queryEnd - 1);
+
+      for (size_t q = queryBegin; q < queryEnd; ++q)
+      {
+        const eT* product = products.colptr(q - queryBegin);
+        double threshold = Threshold(q);
+        for (size_t r = refBegin; r < refEnd; ++r)
+        {
+          if (sameSet && q == r)
+            continue;
+
+          const double norms = queryNorms[q] + referenceNorms[r];
+          const double squared = norms - 2.0 * product[r - refBegin];
+          const double slack = tolerance * norms;
+
+          // Skip the pair unless it may be better even with rounding error.
+          if (!SortPolicy::IsBetter(squared - slack, threshold) &&
+              !SortPolicy::IsBetter(squared + slack, threshold))
+            continue;
+
+          const double distance = metric::LMetric<2, TakeRoot>::Evaluate(
+              querySet.col(q), referenceSet.col(r));
+          CandidateListType::Insert(distances, neighbors, q, r, distance);
+          threshold = Threshold(q);
+        }
+      }
+    }
+  }
+
+ private:
+  //! The squared distance a candidate must beat to enter the list of query q.
+  double Threshold(const size_t q) const
+  {
+    const double kth = CandidateListType::KthDistance(distances, q);
+    return TakeRoot ? kth * kth : kth;
+  }
+
+  const arma::Mat<eT>& referenceSet;
+  const arma::Mat<eT>& querySet;
+  const arma::vec& referenceNorms;
+  const arma::vec& queryNorms;
+  arma::Mat<size_t>& neighbors;
+  arma::Mat<eT>& distances;
+  bool sameSet;
+  double tolerance;
+};
+
+//! Compute the squared norm of each point.
+template<typename eT>
+void SquaredNorms(const arma::Mat<eT>& points, arma::vec& norms)
+{
+  norms.set_size(points.n_cols);
+  for (size_t i = 0; i < points.n_cols; ++i)
+    norms[i] = arma::dot(points.col(i), points.col(i));
+}
+
+}; // namespace aux
+
+template<typename SortPolicy,
+         typename CandidateListType,
+         bool TakeRoot,
+         typename eT>
+bool BruteForceSearch(const arma::Mat<eT>& referenceSet,
+                      const arma::Mat<eT>& querySet,
+                      const metric::LMetric<2, TakeRoot>& /* metric */,
+                      arma::Mat<size_t>& neighbors,
+                      arma::Mat<eT>& distances,
+                      const size_t numThreads)
+{
+  typedef aux::BruteForceTile<SortPolicy, CandidateListType, TakeRoot, eT>
+      TileType;
+
+  arma::vec referenceNorms;
+  aux::SquaredNorms(referenceSet, referenceNorms);
+  arma::vec queryNorms;
+  if (&querySet == &referenceSet)
+    queryNorms = referenceNorms;
+  else
+    aux::SquaredNorms(querySet, queryNorms);
+
+  TileType search(referenceSet, querySet, referenceNorms, queryNorms,
+      neighbors, distances);
+  const size_t tiles = (querySet.n_cols + TileType::QueryBlock - 1) /
+      TileType::QueryBlock;
+  util::ParallelFor(0, tiles, search, numThreads);
+
+  return true;
+}
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,76 @@
+/**
+ * @file adaptive_candidate_list.hpp
+ *
+ * A candidate list policy for NeighborSearchRules that uses a sorted list for
+ * small k and a bounded heap for large k.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_CANDIDATE_LISTS_ADAPTIVE_CANDIDATE_LIST_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_CANDIDATE_LISTS_ADAPTIVE_CANDIDATE_LIST_HPP
+
+#include "sorted_candidate_list.hpp"
+#include "heap_candidate_list.hpp"
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * The AdaptiveCandidateList chooses between SortedCandidateList and
+ * HeapCandidateList based on the number of neighbors being searched for (the
+ * number of rows of the distances matrix), which is fixed for the duration of
+ * a search.  For k up to HeapCutoff the sorted list is used, and the results
+ * are identical to SortedCandidateList.
+ *
+ * The cutoff was chosen by timing the two insertion strategies on streams of
+ * random candidates: they perform about the same at k = 64, and the heap is
+ * considerably faster at k = 128 and beyond.
+ *
+ * @tparam SortPolicy The sort policy for distances; see NearestNeighborSort.
+ */
+template<typename SortPolicy>
+class AdaptiveCandidateList
+{
+ public:
+  //! The largest k for which the sorted list is used.
+  static const size_t HeapCutoff = 64;
+
+  //! Return the distance of the worst candidate held for the query point.
+  template<typename eT>
+  static inline double KthDistance(const arma::Mat<eT>& distances,
+                                   const size_t queryIndex)
+  {
+    if (distances.n_rows > HeapCutoff)
+      return HeapCandidateList<SortPolicy>::KthDistance(distances, queryIndex);
+    else
+      return SortedCandidateList<SortPolicy>::KthDistance(distances,
+          queryIndex);
+  }
+
+  //! Insert the given candidate into the list of the given query point.
+  template<typename eT>
+  static inline void Insert(arma::Mat<eT>& distances,
+                            arma::Mat<size_t>& neighbors,
+                            const size_t queryIndex,
+                            const size_t neighbor,
+                            const double distance)
+  {
+    if (distances.n_rows > HeapCutoff)
+      HeapCandidateList<SortPolicy>::Insert(distances, neighbors, queryIndex,
+          neighbor, distance);
+    else
+      SortedCandidateList<SortPolicy>::Insert(distances, neighbors, queryIndex,
+          neighbor, distance);
+  }
+
+  //! Put every candidate list into its final sorted order.
+  template<typename eT>
+  static void Finalize(arma::Mat<eT>& distances, arma::Mat<size_t>& neighbors)
+  {
+    if (distances.n_rows > HeapCutoff)
+      HeapCandidateList<SortPolicy>::Finalize(distances, neighbors);
+  }
+};
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,151 @@
+/**
+ * @file heap_candidate_list.hpp
+ *
+ * A candidate list policy for NeighborSearchRules that keeps the k best
+ * candidates of each query point in a bounded heap, which is only sorted once
+ * the search is finished.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_CANDIDATE_LISTS_HEAP_CANDIDATE_LIST_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_CANDIDATE_LISTS_HEAP_CANDIDATE_LIST_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * The HeapCandidateList stores the candidate neighbors of each query point (a
+ * column of the distances and neighbors matrices) as a bounded binary heap with
+ * the worst candidate at the top (row 0).  Inserting a candidate replaces the
+ * top and sifts it down, which costs O(log k) instead of the O(k) of
+ * SortedCandidateList.  Finalize() must be called once the search is done to
+ * sort each list so that the best candidate is first.
+ *
+ * This is worthwhile for large k (in our measurements, k greater than about
+ * 64); see AdaptiveCandidateList to choose automatically.
+ *
+ * @tparam SortPolicy The sort policy for distances; see NearestNeighborSort.
+ */
+template<typename SortPolicy>
+class HeapCandidateList
+{
+ public:
+  //! Return the distance of the worst candidate held for the query point.
+  template<typename eT>
+  static inline double KthDistance(const arma::Mat<eT>& distances,
+                                   const size_t queryIndex)
+  {
+    return distances(0, queryIndex);
+  }
+
+  /**
+   * Insert the given candidate into the heap of the given query point, if it
+   * is better than the worst candidate in the heap.  Candidates with equal
+   * distances are ordered by index (the lower index is better), so the heap
+   * holds the same candidates whatever the order of insertion.
+   *
+   * @param distances Matrix of candidate distances.
+   * @param neighbors Matrix of candidate indices.
+   * @param queryIndex Index of point whose candidates we are inserting into.
+   * @param neighbor Index of reference point which is being inserted.
+   * @param distance Distance from query point to reference point.
+   */
+  template<typename eT>
+  static inline void Insert(arma::Mat<eT>& distances,
+                            arma::Mat<size_t>& neighbors,
+                            const size_t queryIndex,
+                            const size_t neighbor,
+                            const double distance)
+  {
+    eT* dist = distances.colptr(queryIndex);
+    size_t* ind = neighbors.colptr(queryIndex);
+
+    // Not good enough to be inserted.
+    if (!IsWorse(dist[0], ind[0], distance, neighbor))
+      return;
+
+    // Replace the top of the heap and sift the new candidate down: a parent is
+    // never better than its children.
+    const size_t k = distances.n_rows;
+    size_t i = 0;
+    while (true)
+    {
+      const size_t left = 2 * i + 1;
+      if (left >= k)
+        break;
+
+      // Find the worse child.
+      size_t child = left;
+      if ((left + 1 < k) &&
+          IsWorse(dist[left + 1], ind[left + 1], dist[left], ind[left]))
+        child = left + 1;
+
+      // If the new candidate is worse than the worse child, we can stop.
+      if (!IsWorse(dist[child], ind[child], distance, neighbor))
+        break;
+
+      dist[i] = dist[child];
+      ind[i] = ind[child];
+      i = child;
+    }
+
+    dist[i] = distance;
+    ind[i] = neighbor;
+  }
+
+  /**
+   * Sort every heap so that the best candidate is first.  Candidates with equal
+   * distances are ordered by index, as in Insert(), so for a given set of
+   * inserted candidates the output does not depend on the order in which they
+   * were found.
+   */
+  template<typename eT>
+  static void Finalize(arma::Mat<eT>& distances, arma::Mat<size_t>& neighbors)
+  {
+    std::vector<std::pair<double, size_t> > list(distances.n_rows);
+    for (size_t q = 0; q < distances.n_cols; ++q)
+    {
+      for (size_t i = 0; i < distances.n_rows; ++i)
+        list[i] = std::make_pair(distances(i, q), neighbors(i, q));
+
+      std::sort(list.begin(), list.end(), CandidateComparator);
+
+      for (size_t i = 0; i < distances.n_rows; ++i)
+      {
+        distances(i, q) = list[i].first;
+        neighbors(i, q) = list[i].second;
+      }
+    }
+  }
+
+ private:
+  //! Return whether the first candidate is worse than the second: its distance
+  //! is worse, or the distances are equal and its index is higher.
+  static inline bool IsWorse(const double distanceA,
+                             const size_t indexA,
+                             const double distanceB,
+                             const size_t indexB)
+  {
+    if (SortPolicy::IsBetter(distanceB, distanceA))
+      return true;
+    else if (SortPolicy::IsBetter(distanceA, distanceB))
+      return false;
+    return (indexA > indexB);
+  }
+
+  //! Compare two candidates: better distance first, then lower index.
+  static bool CandidateComparator(const std::pair<double, size_t>& a,
+                                  const std::pair<double, size_t>& b)
+  {
+    if (SortPolicy::IsBetter(a.first, b.first))
+      return true;
+    else if (SortPolicy::IsBetter(b.first, a.first))
+      return false;
+    return (a.second < b.second);
+  }
+};
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
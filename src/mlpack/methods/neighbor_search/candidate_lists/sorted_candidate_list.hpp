@@ -0,0 +1,104 @@
+/**
+ * @file sorted_candidate_list.hpp
+ *
+ * A candidate list policy for NeighborSearchRules that keeps the k best
+ * candidates of each query point sorted at all times.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_CANDIDATE_LISTS_SORTED_CANDIDATE_LIST_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_CANDIDATE_LISTS_SORTED_CANDIDATE_LIST_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * The SortedCandidateList keeps the list of candidate neighbors of each query
+ * point (a column of the distances and neighbors matrices) sorted, with the
+ * best candidate first.  Each insertion finds the right position with a linear
+ * scan and then shifts the worse candidates down with memmove(), so insertion
+ * costs O(k).  This is the fastest option for small k.
+ *
+ * This class also serves as a guide for implementing other candidate lists;
+ * all of the methods implemented here must be implemented by any other
+ * CandidateListType classes.
+ *
+ * @tparam SortPolicy The sort policy for distances; see NearestNeighborSort.
+ */
+template<typename SortPolicy>
+class SortedCandidateList
+{
+ public:
+  /**
+   * Return the distance of the worst candidate currently held for the given
+   * query point; a new candidate must be at least this good to be inserted.
+   *
+   * @param distances Matrix of candidate distances.
+   * @param queryIndex Index of query point.
+   */
+  template<typename eT>
+  static inline double KthDistance(const arma::Mat<eT>& distances,
+                                   const size_t queryIndex)
+  {
+    return distances(distances.n_rows - 1, queryIndex);
+  }
+
+  /**
+   * Insert the given candidate into the list of the given query point, if it
+   * is good enough.
+   *
+   * @param distances Matrix of candidate distances.
+   * @param neighbors Matrix of candidate indices.
+   * @param queryIndex Index of point whose candidates we are inserting into.
+   * @param neighbor Index of reference point which is being inserted.
+   * @param distance Distance from query point to reference point.
+   */
+  template<typename eT>
+  static inline void Insert(arma::Mat<eT>& distances,
+                            arma::Mat<size_t>& neighbors,
+                            const size_t queryIndex,
+                            const size_t neighbor,
+                            const double distance)
+  {
+    // If this distance is better than any of the current candidates, the
+    // SortDistance() function will give us the position to insert it into.
+    arma::Col<eT> queryDist = distances.unsafe_col(queryIndex);
+    arma::Col<size_t> queryIndices = neighbors.unsafe_col(queryIndex);
+    const size_t pos = SortPolicy::SortDistance(queryDist, queryIndices,
+        distance);
+
+    // SortDistance() returns (size_t() - 1) if we shouldn't add it.
+    if (pos == (size_t() - 1))
+      return;
+
+    // We only memmove() if there is actually a need to shift something.
+    if (pos < (distances.n_rows - 1))
+    {
+      const size_t len = (distances.n_rows - 1) - pos;
+      memmove(distances.colptr(queryIndex) + (pos + 1),
+          distances.colptr(queryIndex) + pos,
+          sizeof(eT) * len);
+      memmove(neighbors.colptr(queryIndex) + (pos + 1),
+          neighbors.colptr(queryIndex) + pos,
+          sizeof(size_t) * len);
+    }
+
+    // Now put the new information in the right index.
+    distances(pos, queryIndex) = distance;
+    neighbors(pos, queryIndex) = neighbor;
+  }
+
+  /**
+   * Put every candidate list into its final sorted order (best candidate
+   * first).  The lists are always sorted, so there is nothing to do.
+   */
+  template<typename eT>
+  static inline void Finalize(arma::Mat<eT>& /* distances */,
+                              arma::Mat<size_t>& /* neighbors */)
+  { }
+};
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
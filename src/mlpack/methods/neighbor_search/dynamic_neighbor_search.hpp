@@ -0,0 +1,171 @@
+/**
+ * @file dynamic_neighbor_search.hpp
+ *
+ * Defines the DynamicNeighborSearch class, which answers k-nearest-neighbor
+ * queries on a reference set that changes between queries.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_DYNAMIC_NEIGHBOR_SEARCH_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_DYNAMIC_NEIGHBOR_SEARCH_HPP
+
+#include <mlpack/core.hpp>
+#include <map>
+
+#include <mlpack/core/tree/rectangle_tree.hpp>
+
+#include "neighbor_search.hpp"
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * The DynamicNeighborSearch class holds a reference set in a RectangleTree and
+ * allows points to be inserted and deleted between searches, so the tree never
+ * has to be rebuilt from scratch for each change.
+ *
+ * Each point is identified by the id returned by Insert() (the points of the
+ * initial reference set have ids 0 to n - 1); ids never change, and the results
+ * of Search() are given as ids.  The points are stored in an append-only
+ * matrix: a deleted point is removed from the tree, but its column is only
+ * marked as deleted (a tombstone).  Once more than CompactionThreshold() of the
+ * columns are tombstones, the matrix is compacted and the tree is rebuilt with
+ * Sort-Tile-Recursive bulk loading, so the cost of a rebuild is spread over
+ * many deletions.
+ *
+ * @tparam SortPolicy The sort policy for distances; see NearestNeighborSort.
+ * @tparam MetricType The metric to use for computation.
+ * @tparam SplitType The split method of the RectangleTree.
+ * @tparam DescentType The descent heuristic of the RectangleTree.
+ */
+template<typename SortPolicy = NearestNeighborSort,
+         typename MetricType = mlpack::metric::EuclideanDistance,
+         typename SplitType = tree::RStarTreeSplit<
+             tree::RStarTreeDescentHeuristic, NeighborSearchStat<SortPolicy>,
+             arma::mat>,
+         typename DescentType = tree::RStarTreeDescentHeuristic>
+class DynamicNeighborSearch
+{
+ public:
+  //! The type of tree the reference points are held in.
+  typedef tree::RectangleTree<SplitType, DescentType,
+      NeighborSearchStat<SortPolicy>, arma::mat> TreeType;
+
+  /**
+   * Build the search object on the given reference set (which is copied); the
+   * points get the ids 0 to referenceSet.n_cols - 1.  The reference set may
+   * have no columns, but its number of rows sets the dimensionality of the
+   * points.
+   *
+   * @param referenceSet Initial set of reference points.
+   * @param compactionThreshold Compact the points once more than this fraction
+   *      of the stored columns are deleted points.
+   * @param maxLeafSize Maximum size of each leaf in the tree.
+   * @param minLeafSize Minimum size of each leaf in the tree.
+   * @param maxNumChildren Maximum number of children of a non-leaf node.
+   * @param minNumChildren Minimum number of children of a non-leaf node.
+   * @param metric An optional instance of the MetricType class.
+   */
+  DynamicNeighborSearch(const arma::mat& referenceSet,
+                        const double compactionThreshold = 0.25,
+                        const size_t maxLeafSize = 20,
+                        const size_t minLeafSize = 8,
+                        const size_t maxNumChildren = 5,
+                        const size_t minNumChildren = 2,
+                        const MetricType metric = MetricType());
+
+  //! Delete the tree.
+  ~DynamicNeighborSearch();
+
+  /**
+   * Insert a point, and return its id.
+   *
+   * @param point The point to insert.
+   */
+  size_t Insert(const arma::vec& point);
+
+  /**
+   * Delete the point with the given id.  This may compact the points (see
+   * CompactionThreshold()).  Returns false if there is no point with that id.
+   *
+   * @param id Id of the point to delete.
+   */
+  bool Delete(const size_t id);
+
+  /**
+   * Find the k nearest neighbors (according to the sort policy) of each query
+   * point among the current points.  The ids of the neighbors are stored in
+   * the k x n matrix resultingNeighbors and their distances in distances.
+   *
+   * @param querySet Set of query points.
+   * @param k Number of neighbors to search for.
+   * @param resultingNeighbors Matrix to store the ids of the neighbors in.
+   * @param distances Matrix to store the distances of the neighbors in.
+   */
+  void Search(const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& resultingNeighbors,
+              arma::mat& distances);
+
+  /**
+   * Remove the tombstones from the stored points and rebuild the tree with
+   * bulk loading.  The ids of the points do not change.  This is called
+   * automatically by Delete() once CompactionThreshold() is exceeded.
+   */
+  void Compact();
+
+  //! Return whether the point with the given id is currently held.
+  bool Contains(const size_t id) const { return columns.count(id) > 0; }
+
+  //! Return the number of points currently held.
+  size_t NumPoints() const { return numColumns - numDeleted; }
+  //! Return the number of deleted points that have not been compacted yet.
+  size_t NumDeleted() const { return numDeleted; }
+
+  //! Get the fraction of deleted columns above which Delete() compacts.
+  double CompactionThreshold() const { return compactionThreshold; }
+  //! Modify the fraction of deleted columns above which Delete() compacts.
+  double& CompactionThreshold() { return compactionThreshold; }
+
+  //! Get the tree.
+  const TreeType& Tree() const { return *tree; }
+
+ private:
+  //! The stored points; only the first numColumns columns are used, and some
+  //! of those may be deleted.
+  arma::mat dataset;
+  //! The number of used columns of the dataset.
+  size_t numColumns;
+  //! The number of used columns that hold deleted points.
+  size_t numDeleted;
+  //! The id of the point in each used column (for deleted points, the id the
+  //! point had).
+  std::vector<size_t> ids;
+  //! The column of each point that has not been deleted, by id.
+  std::map<size_t, size_t> columns;
+  //! The id the next inserted point will get.
+  size_t nextId;
+
+  //! The tree holding the points that have not been deleted.
+  TreeType* tree;
+
+  //! The fraction of deleted columns above which Delete() compacts.
+  double compactionThreshold;
+  //! The maximum leaf size of the tree.
+  size_t maxLeafSize;
+  //! The minimum leaf size of the tree.
+  size_t minLeafSize;
+  //! The maximum number of children of non-leaf nodes of the tree.
+  size_t maxNumChildren;
+  //! The minimum number of children of non-leaf nodes of the tree.
+  size_t minNumChildren;
+
+  //! Instantiation of metric.
+  MetricType metric;
+};
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+// Include implementation.
+#include "dynamic_neighbor_search_impl.hpp"
+
+#endif
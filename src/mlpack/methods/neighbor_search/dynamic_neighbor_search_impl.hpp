@@ -0,0 +1,201 @@
+/**
+ * @file dynamic_neighbor_search_impl.hpp
+ *
+ * Implementation of the DynamicNeighborSearch class.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_DYNAMIC_NEIGHBOR_SEARCH_IMPL_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_DYNAMIC_NEIGHBOR_SEARCH_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "dynamic_neighbor_search.hpp"
+
+namespace mlpack {
+namespace neighbor {
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename SplitType,
+         typename DescentType>
+DynamicNeighborSearch<SortPolicy, MetricType, SplitType, DescentType>::
+DynamicNeighborSearch(const arma::mat& referenceSet,
+                      const double compactionThreshold,
+                      const size_t maxLeafSize,
+                      const size_t minLeafSize,
+                      const size_t maxNumChildren,
+                      const size_t minNumChildren,
+                      const MetricType metric) :
+    dataset(referenceSet),
+    numColumns(referenceSet.n_cols),
+    numDeleted(0),
+    ids(referenceSet.n_cols),
+    nextId(referenceSet.n_cols),
+    tree(NULL),
+    compactionThreshold(compactionThreshold),
+    maxLeafSize(maxLeafSize),
+    minLeafSize(minLeafSize),
+    maxNumChildren(maxNumChildren),
+    minNumChildren(minNumChildren),
+    metric(metric)
+{
+  for (size_t i = 0; i < numColumns; ++i)
+  {
+    ids[i] = i;
+    columns.insert(columns.end(), std::make_pair(i, i));
+  }
+
+  Timer::Start("tree_building");
+  tree = new TreeType(dataset, maxLeafSize, minLeafSize, maxNumChildren,
+      minNumChildren, 0, true);
+  Timer::Stop("tree_building");
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename SplitType,
+         typename DescentType>
+DynamicNeighborSearch<SortPolicy, MetricType, SplitType, DescentType>::
+~DynamicNeighborSearch()
+{
+  delete tree;
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename SplitType,
+         typename DescentType>
+size_t DynamicNeighborSearch<SortPolicy, MetricType, SplitType, DescentType>::
+Insert(const arma::vec& point)
+{
+  if (point.n_elem != dataset.n_rows)
+  {
+    Log::Fatal << "DynamicNeighborSearch::Insert(): point has " << point.n_elem
+        << " dimensions, but the reference set has " << dataset.n_rows << "!"
+        << std::endl;
+  }
+
+  // Grow the matrix geometrically, so that appending is cheap.  The tree holds
+  // a reference to the matrix object, which stays the same.
+  if (numColumns == dataset.n_cols)
+    dataset.resize(dataset.n_rows, std::max(2 * numColumns, (size_t) 16));
+
+  const size_t id = nextId++;
+  dataset.col(numColumns) = point;
+  ids.push_back(id);
+  columns.insert(columns.end(), std::make_pair(id, numColumns));
+
+  tree->InsertPoint(numColumns++);
+
+  return id;
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename SplitType,
+         typename DescentType>
+bool DynamicNeighborSearch<SortPolicy, MetricType, SplitType, DescentType>::
+Delete(const size_t id)
+{
+  std::map<size_t, size_t>::iterator it = columns.find(id);
+  if (it == columns.end())
+    return false;
+
+  // The column stays in the matrix as a tombstone until the next compaction.
+  tree->DeletePoint(it->second);
+  columns.erase(it);
+  ++numDeleted;
+
+  if (numDeleted > compactionThreshold * numColumns)
+    Compact();
+
+  return true;
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename SplitType,
+         typename DescentType>
+void DynamicNeighborSearch<SortPolicy, MetricType, SplitType, DescentType>::
+Search(const arma::mat& querySet,
+       const size_t k,
+       arma::Mat<size_t>& resultingNeighbors,
+       arma::mat& distances)
+{
+  if (querySet.n_rows != dataset.n_rows)
+  {
+    Log::Fatal << "DynamicNeighborSearch::Search(): query points have "
+        << querySet.n_rows << " dimensions, but the reference set has "
+        << dataset.n_rows << "!" << std::endl;
+  }
+
+  if (k > NumPoints())
+  {
+    Log::Fatal << "DynamicNeighborSearch::Search(): requested value of k ("
+        << k << ") is greater than the number of points (" << NumPoints()
+        << ")!" << std::endl;
+  }
+
+  if (tree->IsLeaf())
+  {
+    // Single-tree search needs a root that is not a leaf, so search the few
+    // points there are naively.
+    arma::mat points(dataset.n_rows, tree->Count());
+    for (size_t i = 0; i < tree->Count(); ++i)
+      points.col(i) = dataset.col(tree->Point(i));
+
+    NeighborSearch<SortPolicy, MetricType, TreeType> search(points, querySet,
+        true, false, metric);
+    search.Search(k, resultingNeighbors, distances);
+
+    for (size_t i = 0; i < resultingNeighbors.n_elem; ++i)
+      resultingNeighbors[i] = ids[tree->Point(resultingNeighbors[i])];
+  }
+  else
+  {
+    NeighborSearch<SortPolicy, MetricType, TreeType> search(tree, NULL,
+        dataset, querySet, true, metric);
+    search.Search(k, resultingNeighbors, distances);
+
+    for (size_t i = 0; i < resultingNeighbors.n_elem; ++i)
+      resultingNeighbors[i] = ids[resultingNeighbors[i]];
+  }
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename SplitType,
+         typename DescentType>
+void DynamicNeighborSearch<SortPolicy, MetricType, SplitType, DescentType>::
+Compact()
+{
+  Timer::Start("tree_building");
+
+  // Ids increase with the column, so iterating over the map in order of id
+  // keeps the points in the order of their columns.
+  arma::mat live(dataset.n_rows, NumPoints());
+  std::vector<size_t> liveIds(NumPoints());
+  size_t column = 0;
+  for (std::map<size_t, size_t>::iterator it = columns.begin();
+       it != columns.end(); ++it, ++column)
+  {
+    live.col(column) = dataset.col(it->second);
+    liveIds[column] = it->first;
+    it->second = column;
+  }
+
+  // The old tree refers to the matrix, so it must go first.
+  delete tree;
+  dataset = live;
+  ids.swap(liveIds);
+  numColumns = column;
+  numDeleted = 0;
+
+  tree = new TreeType(dataset, maxLeafSize, minLeafSize, maxNumChildren,
+      minNumChildren, 0, true);
+
+  Timer::Stop("tree_building");
+}
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
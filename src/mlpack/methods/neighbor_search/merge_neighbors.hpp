@@ -0,0 +1,72 @@
+/**
+ * @file merge_neighbors.hpp
+ *
+ * Merge the results of neighbor searches of the same query points in different
+ * shards of a reference set, so that a reference set which is too large for
+ * one machine can be split up and searched piece by piece.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_MERGE_NEIGHBORS_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_MERGE_NEIGHBORS_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * Merge two sets of neighbor search results for the same query points into
+ * the k best neighbors of each query point.  Each column of the inputs must
+ * be sorted from the best neighbor to the worst (as NeighborSearch::Search()
+ * returns them), and the neighbor indices of both must refer to the same
+ * reference set (for shards, add the index of the first point of the shard to
+ * the results of searching it).  The inputs may have different numbers of
+ * neighbors; if there are fewer than k in total, the remaining neighbors have
+ * index size_t() - 1 and distance SortPolicy::WorstDistance().  Ties are broken
+ * in favor of the first set of results.
+ *
+ * The outputs must not be the same matrices as the inputs.
+ *
+ * @param neighborsA Neighbors from the first search.
+ * @param distancesA Distances from the first search.
+ * @param neighborsB Neighbors from the second search.
+ * @param distancesB Distances from the second search.
+ * @param k Number of neighbors to keep.
+ * @param neighbors Matrix to store the merged neighbors in.
+ * @param distances Matrix to store the merged distances in.
+ */
+template<typename SortPolicy, typename ElemType>
+void MergeNeighbors(const arma::Mat<size_t>& neighborsA,
+                    const arma::Mat<ElemType>& distancesA,
+                    const arma::Mat<size_t>& neighborsB,
+                    const arma::Mat<ElemType>& distancesB,
+                    const size_t k,
+                    arma::Mat<size_t>& neighbors,
+                    arma::Mat<ElemType>& distances);
+
+/**
+ * Merge any number of sets of neighbor search results for the same query
+ * points (one set for each shard of the reference set) into the k best
+ * neighbors of each query point.  The sets are merged pairwise, in a tree of
+ * log2(n) rounds; the pairs of a round are merged in parallel.  The inputs are
+ * overwritten.
+ *
+ * @param neighborSets Neighbors from each search.
+ * @param distanceSets Distances from each search.
+ * @param k Number of neighbors to keep.
+ * @param neighbors Matrix to store the merged neighbors in.
+ * @param distances Matrix to store the merged distances in.
+ */
+template<typename SortPolicy, typename ElemType>
+void MergeNeighbors(std::vector<arma::Mat<size_t> >& neighborSets,
+                    std::vector<arma::Mat<ElemType> >& distanceSets,
+                    const size_t k,
+                    arma::Mat<size_t>& neighbors,
+                    arma::Mat<ElemType>& distances);
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+// Include implementation.
+#include "merge_neighbors_impl.hpp"
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * @file merge_neighbors_impl.hpp
+ *
+ * Implementation of the merging of neighbor search results.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_MERGE_NEIGHBORS_IMPL_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_MERGE_NEIGHBORS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "merge_neighbors.hpp"
+
+namespace mlpack {
+namespace neighbor {
+
+template<typename SortPolicy, typename ElemType>
+void MergeNeighbors(const arma::Mat<size_t>& neighborsA,
+                    const arma::Mat<ElemType>& distancesA,
+                    const arma::Mat<size_t>& neighborsB,
+                    const arma::Mat<ElemType>& distancesB,
+                    const size_t k,
+                    arma::Mat<size_t>& neighbors,
+                    arma::Mat<ElemType>& distances)
+{
+  Log::Assert(neighborsA.n_cols == neighborsB.n_cols);
+  Log::Assert(distancesA.n_rows == neighborsA.n_rows &&
+      distancesA.n_cols == neighborsA.n_cols);
+  Log::Assert(distancesB.n_rows == neighborsB.n_rows &&
+      distancesB.n_cols == neighborsB.n_cols);
+
+  // As in NeighborSearch::Search(), the worst distance is clamped to ElemType.
+  const ElemType worstDistance = (ElemType) std::min(
+      SortPolicy::WorstDistance(),
+      (double) std::numeric_limits<ElemType>::max());
+
+  neighbors.set_size(k, neighborsA.n_cols);
+  distances.set_size(k, neighborsA.n_cols);
+  for (size_t col = 0; col < neighborsA.n_cols; ++col)
+  {
+    size_t a = 0;
+    size_t b = 0;
+    for (size_t i = 0; i < k; ++i)
+    {
+      bool takeA;
+      if (a < neighborsA.n_rows && b < neighborsB.n_rows)
+        takeA = !SortPolicy::IsBetter(distancesB(b, col), distancesA(a, col));
+      else if (a < neighborsA.n_rows || b < neighborsB.n_rows)
+        takeA = (a < neighborsA.n_rows);
+      else
+      {
+        // Both lists are exhausted.
+        neighbors(i, col) = size_t() - 1;
+        distances(i, col) = worstDistance;
+        continue;
+      }
+
+      if (takeA)
+      {
+        neighbors(i, col) = neighborsA(a, col);
+        distances(i, col) = distancesA(a, col);
+        ++a;
+      }
+      else
+      {
+        neighbors(i, col) = neighborsB(b, col);
+        distances(i, col) = distancesB(b, col);
+        ++b;
+      }
+    }
+  }
+}
+
+namespace aux {
+
+//! Merges one pair of sets in a round of the tree reduction.
+template<typename SortPolicy, typename ElemType>
+struct MergePair
+{
+  MergePair(std::vector<arma::Mat<size_t> >& neighborSets,
+            std::vector<arma::Mat<ElemType> >& distanceSets,
+            const size_t stride,
+            const size_t k) :
+      neighborSets(neighborSets),
+      distanceSets(distanceSets),
+      stride(stride),
+      k(k)
+  { }
+
+  //! Merge set (2 * stride * pair + stride) into set (2 * stride * pair).
+  void operator()(const size_t pair)
+  {
+    const size_t first = 2 * stride * pair;
+    const size_t second = first + stride;
+
+    arma::Mat<size_t> mergedNeighbors;
+    arma::Mat<ElemType> mergedDistances;
+    MergeNeighbors<SortPolicy>(neighborSets[first], distanceSets[first],
+        neighborSets[second], distanceSets[second], k, mergedNeighbors,
+        mergedDistances);
+
+    neighborSets[first].steal_mem(mergedNeighbors);
+    distanceSets[first].steal_mem(mergedDistances);
+    neighborSets[second].reset();
+    distanceSets[second].reset();
+  }
+
+  std::vector<arma::Mat<size_t> >& neighborSets;
+  std::vector<arma::Mat<ElemType> >& distanceSets;
+  size_t stride;
+  size_t k;
+};
+
+}; // namespace aux
+
+template<typename SortPolicy, typename ElemType>
+void MergeNeighbors(std::vector<arma::Mat<size_t> >& neighborSets,
+                    std::vector<arma::Mat<ElemType> >& distanceSets,
+                    const size_t k,
+                    arma::Mat<size_t>& neighbors,
+                    arma::Mat<ElemType>& distances)
+{
+  Log::Assert(neighborSets.size() == distanceSets.size());
+  if (neighborSets.size() == 0)
+  {
+    neighbors.reset();
+    distances.reset();
+    return;
+  }
+
+  // In each round, set i (a multiple of 2 * stride) absorbs set i + stride, so
+  // that the results of neighboring shards are merged first, and ties are
+  // broken in favor of earlier shards.
+  for (size_t stride = 1; stride < neighborSets.size(); stride *= 2)
+  {
+    const size_t pairs = (neighborSets.size() + stride - 1) / (2 * stride);
+    aux::MergePair<SortPolicy, ElemType> merge(neighborSets, distanceSets,
+        stride, k);
+    util::ParallelFor(0, pairs, merge);
+  }
+
+  // A single set may still have a different number of neighbors than k.
+  if (neighborSets.size() == 1)
+  {
+    const arma::Mat<size_t> noNeighbors(0, neighborSets[0].n_cols);
+    const arma::Mat<ElemType> noDistances(0, neighborSets[0].n_cols);
+    MergeNeighbors<SortPolicy>(neighborSets[0], distanceSets[0], noNeighbors,
+        noDistances, k, neighbors, distances);
+    return;
+  }
+
+  neighbors.steal_mem(neighborSets[0]);
+  distances.steal_mem(distanceSets[0]);
+}
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
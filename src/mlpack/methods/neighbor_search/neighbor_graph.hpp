@@ -0,0 +1,70 @@
+/**
+ * @file neighbor_graph.hpp
+ *
+ * Build the symmetric k-nearest-neighbor graph of a set of points from the
+ * results of a monochromatic neighbor search, as used by spectral methods.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_NEIGHBOR_GRAPH_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_NEIGHBOR_GRAPH_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * Build the undirected k-nearest-neighbor graph of a set of points from the
+ * results of searching the set against itself (NeighborSearch::Search() with
+ * only a reference set).  In the union graph, points i and j are connected if
+ * j is one of the neighbors of i or i is one of the neighbors of j; in the
+ * mutual graph, both must hold.  The weight of an edge is the distance between
+ * its points, taken from the search results, so no distance is computed
+ * again.  Neighbors with index size_t() - 1 (missing neighbors, as from
+ * MergeNeighbors()) and self-loops are ignored.
+ *
+ * The graph is returned as a list of edges: column e of edges holds the two
+ * points of edge e, and weights[e] is its weight.  Each edge is listed twice,
+ * once in each direction, so the list is the coordinate list of the symmetric
+ * adjacency matrix; it is sorted by the first point, then the second.  The
+ * memory used is proportional to the number of points times k.
+ *
+ * @param neighbors Neighbors of each point, from the search.
+ * @param distances Distances to the neighbors of each point, from the search.
+ * @param edges Matrix to store the points of each edge in (2 x edges).
+ * @param weights Vector to store the weight of each edge in.
+ * @param mutual If true, build the mutual graph instead of the union graph.
+ */
+template<typename ElemType>
+void NeighborGraph(const arma::Mat<size_t>& neighbors,
+                   const arma::Mat<ElemType>& distances,
+                   arma::Mat<size_t>& edges,
+                   arma::Col<ElemType>& weights,
+                   const bool mutual = false);
+
+/**
+ * Build the undirected k-nearest-neighbor graph of a set of points from the
+ * results of searching the set against itself, as a symmetric sparse adjacency
+ * matrix whose entries are the distances between the connected points.  See
+ * the edge list overload above for the definition of the graph.
+ *
+ * A sparse matrix does not store zeros, so edges between identical points are
+ * lost; use the edge list overload if the data may have duplicate points.
+ *
+ * @param neighbors Neighbors of each point, from the search.
+ * @param distances Distances to the neighbors of each point, from the search.
+ * @param graph Sparse matrix to store the adjacency matrix of the graph in.
+ * @param mutual If true, build the mutual graph instead of the union graph.
+ */
+template<typename ElemType>
+void NeighborGraph(const arma::Mat<size_t>& neighbors,
+                   const arma::Mat<ElemType>& distances,
+                   arma::SpMat<ElemType>& graph,
+                   const bool mutual = false);
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+// Include implementation.
+#include "neighbor_graph_impl.hpp"
+
+#endif
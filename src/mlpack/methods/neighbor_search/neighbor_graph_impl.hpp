@@ -0,0 +1,140 @@
+/**
+ * @file neighbor_graph_impl.hpp
+ *
+ * Implementation of the construction of k-nearest-neighbor graphs.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_NEIGHBOR_GRAPH_IMPL_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_NEIGHBOR_GRAPH_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "neighbor_graph.hpp"
+
+#include <algorithm>
+
+namespace mlpack {
+namespace neighbor {
+namespace aux {
+
+//! A directed edge of a neighbor graph.
+template<typename ElemType>
+struct GraphEdge
+{
+  size_t from;
+  size_t to;
+  ElemType weight;
+
+  //! Order edges by their first point, then their second.
+  bool operator<(const GraphEdge& other) const
+  {
+    return (from < other.from) || (from == other.from && to < other.to);
+  }
+};
+
+}; // namespace aux
+
+template<typename ElemType>
+void NeighborGraph(const arma::Mat<size_t>& neighbors,
+                   const arma::Mat<ElemType>& distances,
+                   arma::Mat<size_t>& edges,
+                   arma::Col<ElemType>& weights,
+                   const bool mutual)
+{
+  Log::Assert(distances.n_rows == neighbors.n_rows &&
+      distances.n_cols == neighbors.n_cols);
+
+  // Each neighbor gives an edge in each direction.  After sorting, an edge
+  // found from both of its points appears twice in a row.
+  std::vector<aux::GraphEdge<ElemType> > directed;
+  directed.reserve(2 * neighbors.n_elem);
+  for (size_t i = 0; i < neighbors.n_cols; ++i)
+  {
+    for (size_t j = 0; j < neighbors.n_rows; ++j)
+    {
+      const size_t neighbor = neighbors(j, i);
+      if (neighbor == i || neighbor >= neighbors.n_cols)
+        continue;
+
+      aux::GraphEdge<ElemType> edge;
+      edge.from = i;
+      edge.to = neighbor;
+      edge.weight = distances(j, i);
+      directed.push_back(edge);
+
+      edge.from = neighbor;
+      edge.to = i;
+      directed.push_back(edge);
+    }
+  }
+
+  std::sort(directed.begin(), directed.end());
+
+  // Count the distinct edges to keep, then store them.
+  size_t count = 0;
+  for (size_t e = 0; e < directed.size(); )
+  {
+    size_t end = e + 1;
+    while (end < directed.size() && !(directed[e] < directed[end]))
+      ++end;
+
+    if (!mutual || end - e > 1)
+      ++count;
+    e = end;
+  }
+
+  edges.set_size(2, count);
+  weights.set_size(count);
+  size_t edge = 0;
+  for (size_t e = 0; e < directed.size(); )
+  {
+    ElemType weight = directed[e].weight;
+    size_t end = e + 1;
+    while (end < directed.size() && !(directed[e] < directed[end]))
+      weight = std::min(weight, directed[end++].weight);
+
+    if (!mutual || end - e > 1)
+    {
+      edges(0, edge) = directed[e].from;
+      edges(1, edge) = directed[e].to;
+      weights[edge] = weight;
+      ++edge;
+    }
+    e = end;
+  }
+}
+
+template<typename ElemType>
+void NeighborGraph(const arma::Mat<size_t>& neighbors,
+                   const arma::Mat<ElemType>& distances,
+                   arma::SpMat<ElemType>& graph,
+                   const bool mutual)
+{
+  arma::Mat<size_t> edges;
+  arma::Col<ElemType> weights;
+  NeighborGraph(neighbors, distances, edges, weights, mutual);
+
+  // Zero weights can't be stored in the sparse matrix.
+  const size_t nonzero = arma::accu(weights != 0);
+  arma::umat locations(2, nonzero);
+  arma::Col<ElemType> values(nonzero);
+  size_t entry = 0;
+  for (size_t e = 0; e < edges.n_cols; ++e)
+  {
+    if (weights[e] == 0)
+      continue;
+
+    // The edges are sorted by their first point; taking it as the column
+    // gives column-major order.
+    locations(0, entry) = (arma::uword) edges(1, e);
+    locations(1, entry) = (arma::uword) edges(0, e);
+    values[entry] = weights[e];
+    ++entry;
+  }
+
+  graph = arma::SpMat<ElemType>(locations, values, neighbors.n_cols,
+      neighbors.n_cols);
+}
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
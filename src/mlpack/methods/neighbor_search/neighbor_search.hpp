@@ -14,10 +14,12 @@
 
 #include <mlpack/core/tree/binary_space_tree.hpp>
 #include <mlpack/core/tree/rectangle_tree.hpp>
+#include <mlpack/core/tree/cover_tree.hpp>
 
 #include <mlpack/core/metrics/lmetric.hpp>
 #include "neighbor_search_stat.hpp"
 #include "sort_policies/nearest_neighbor_sort.hpp"
+#include "candidate_lists/adaptive_candidate_list.hpp"
 
 namespace mlpack {
 namespace neighbor /** Neighbor-search routines.  These include
@@ -38,17 +40,29 @@ namespace neighbor /** Neighbor-search routines.  These include
  * can be found in the NearestNeighborSort class and the kernel::ExampleKernel
  * class.
  *
+ * The CandidateListType template parameter controls how the list of candidate
+ * neighbors of each query point is maintained during the search; by default a
+ * sorted list is used for small k and a bounded heap is used for large k (see
+ * AdaptiveCandidateList).
+ *
  * @tparam SortPolicy The sort policy for distances; see NearestNeighborSort.
  * @tparam MetricType The metric to use for computation.
  * @tparam TreeType The tree type to use.
+ * @tparam CandidateListType The candidate list policy; see
+ *     SortedCandidateList.
  */
 template<typename SortPolicy = NearestNeighborSort,
          typename MetricType = mlpack::metric::SquaredEuclideanDistance,
          typename TreeType = tree::BinarySpaceTree<bound::HRectBound<2>,
-             NeighborSearchStat<SortPolicy> > >
+             NeighborSearchStat<SortPolicy> >,
+         typename CandidateListType = AdaptiveCandidateList<SortPolicy> >
 class NeighborSearch
 {
  public:
+  //! The type of the elements of the dataset.  Distances are stored with the
+  //! same type, so a single-precision dataset gives single-precision results.
+  typedef typename TreeType::Mat::elem_type ElemType;
+
   /**
    * Initialize the NeighborSearch object, passing both a query and reference
    * dataset.  Optionally, perform the computation in naive mode or single-tree
@@ -57,8 +71,14 @@ class NeighborSearch
    * (i.e. the distance::MahalanobisDistance class).
    *
    * This method will copy the matrices to internal copies, which are rearranged
-   * during tree-building.  You can avoid this extra copy by pre-constructing
-   * the trees and passing them using a diferent constructor.
+   * during tree-building.  You can avoid this extra copy by letting the object
+   * rearrange the matrices in place, by pre-constructing the trees, or by
+   * moving the matrices into the object, with a different constructor.  The
+   * matrices are copied in naive mode too (even if the same matrix is given
+   * twice), so the object never refers to them.  For the Euclidean distance on
+   * dense matrices, naive search is done in blocks with matrix products (see
+   * BruteForceSearch()), which is the fastest exact search for
+   * high-dimensional data.
    *
    * @param referenceSet Set of reference points.
    * @param querySet Set of query points.
@@ -101,6 +121,94 @@ class NeighborSearch
                  const bool singleMode = false,
                  const MetricType metric = MetricType());
 
+  /**
+   * Initialize the NeighborSearch object, building the trees on the given
+   * query and reference datasets in place, so that no copy of either is made.
+   * If the tree type rearranges the dataset during tree-building, the matrices
+   * are rearranged, and the original index of each point is stored in
+   * oldFromNewReferences and oldFromNewQueries (which are otherwise left
+   * empty).  The results of Search() still use the original indices.  The
+   * matrices must not be modified or destroyed while this object exists.  In
+   * single-tree mode, no query tree is built, so the query set is not
+   * modified.
+   *
+   * @param referenceSet Set of reference points (rearranged in place).
+   * @param querySet Set of query points (rearranged in place).
+   * @param oldFromNewReferences Filled with the original index of each
+   *      rearranged reference point.
+   * @param oldFromNewQueries Filled with the original index of each rearranged
+   *      query point.
+   * @param singleMode If true, single-tree search will be used (as opposed to
+   *      dual-tree search).
+   * @param metric An optional instance of the MetricType class.
+   */
+  NeighborSearch(typename TreeType::Mat& referenceSet,
+                 typename TreeType::Mat& querySet,
+                 std::vector<size_t>& oldFromNewReferences,
+                 std::vector<size_t>& oldFromNewQueries,
+                 const bool singleMode = false,
+                 const MetricType metric = MetricType());
+
+  /**
+   * Initialize the NeighborSearch object, building the tree on the given
+   * dataset in place, so that no copy of it is made; the dataset is used as
+   * both the query and the reference dataset.  If the tree type rearranges the
+   * dataset during tree-building, the matrix is rearranged, and the original
+   * index of each point is stored in oldFromNewReferences (which is otherwise
+   * left empty).  The results of Search() still use the original indices.  The
+   * matrix must not be modified or destroyed while this object exists.
+   *
+   * @param referenceSet Set of reference points (rearranged in place).
+   * @param oldFromNewReferences Filled with the original index of each
+   *      rearranged point.
+   * @param singleMode If true, single-tree search will be used (as opposed to
+   *      dual-tree search).
+   * @param metric An optional instance of the MetricType class.
+   */
+  NeighborSearch(typename TreeType::Mat& referenceSet,
+                 std::vector<size_t>& oldFromNewReferences,
+                 const bool singleMode = false,
+                 const MetricType metric = MetricType());
+
+  /**
+   * Initialize the NeighborSearch object, taking ownership of the given query
+   * and reference datasets, so that neither is copied; the trees are built on
+   * the moved matrices.  The results of Search() use the original indices.
+   * Otherwise, this is the same as the constructor which copies the datasets.
+   *
+   * @param referenceSet Set of reference points (moved into this object).
+   * @param querySet Set of query points (moved into this object).
+   * @param naive If true, O(n^2) naive search will be used (as opposed to
+   *      dual-tree search).  This overrides singleMode (if it is set to true).
+   * @param singleMode If true, single-tree search will be used (as opposed to
+   *      dual-tree search).
+   * @param metric An optional instance of the MetricType class.
+   */
+  NeighborSearch(typename TreeType::Mat&& referenceSet,
+                 typename TreeType::Mat&& querySet,
+                 const bool naive = false,
+                 const bool singleMode = false,
+                 const MetricType metric = MetricType());
+
+  /**
+   * Initialize the NeighborSearch object, taking ownership of the given
+   * dataset, which is used as both the query and the reference dataset, so
+   * that it is not copied; the tree is built on the moved matrix.  The results
+   * of Search() use the original indices.  Otherwise, this is the same as the
+   * constructor which copies the dataset.
+   *
+   * @param referenceSet Set of reference points (moved into this object).
+   * @param naive If true, O(n^2) naive search will be used (as opposed to
+   *      dual-tree search).  This overrides singleMode (if it is set to true).
+   * @param singleMode If true, single-tree search will be used (as opposed to
+   *      dual-tree search).
+   * @param metric An optional instance of the MetricType class.
+   */
+  NeighborSearch(typename TreeType::Mat&& referenceSet,
+                 const bool naive = false,
+                 const bool singleMode = false,
+                 const MetricType metric = MetricType());
+
   /**
    * Initialize the NeighborSearch object with the given datasets and
    * pre-constructed trees.  It is assumed that the points in referenceSet and
@@ -182,6 +290,17 @@ class NeighborSearch
    * number of points in the query dataset and k is the number of neighbors
    * being searched for.
    *
+   * If dual-tree search is being used and NumThreads() is not 1, the top levels
+   * of the query tree are split into disjoint subtrees which are traversed in
+   * parallel; each thread then owns a disjoint set of columns in the output
+   * matrices, so no locking is necessary.  For the cover tree, whose nodes all
+   * hold points, the top of the query tree is traversed first and the cover
+   * tree's own parallel traverser splits off the subtrees below it.
+   *
+   * If Epsilon() is not 0, tree-based search is approximate (see Epsilon()).
+   * If single-tree search is being used and SingleBatchSize() is not 0, the
+   * query points are searched in batches (see SingleBatchSize()).
+   *
    * @param k Number of neighbors to search for.
    * @param resultingNeighbors Matrix storing lists of neighbors for each query
    *     point.
@@ -190,7 +309,37 @@ class NeighborSearch
    */
   void Search(const size_t k,
               arma::Mat<size_t>& resultingNeighbors,
-              arma::mat& distances);
+              arma::Mat<ElemType>& distances);
+
+  /**
+   * Compute the nearest neighbors of the given query points in the reference
+   * set, without modifying this object, so that several threads can search the
+   * same reference tree at once (for instance, the request threads of a
+   * server).  Everything the search needs (the query tree, the rules, and the
+   * results before they are mapped) is local to the call, which runs in the
+   * calling thread, and nothing is timed, logged or added to BaseCases() and
+   * Scores().  The settings of the object (naive or single-tree search, and
+   * Epsilon()) are used; in single-tree mode the query points are searched
+   * one at a time (or in batches, in the calling thread, if SingleBatchSize()
+   * is not 0), and otherwise a query tree is built on a copy of them.
+   * Trees which cache distances in the reference nodes during single-tree
+   * search (the cover tree) are always searched with dual-tree search here.
+   *
+   * The neighbor indices are indices of the reference set given to the
+   * constructor (mapped back to the original order if this object built the
+   * reference tree), and column i of the results belongs to query point i.
+   *
+   * @param querySet Set of query points.
+   * @param k Number of neighbors to search for.
+   * @param resultingNeighbors Matrix storing lists of neighbors for each query
+   *     point.
+   * @param distances Matrix storing distances of neighbors for each query
+   *     point.
+   */
+  void Search(const typename TreeType::Mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& resultingNeighbors,
+              arma::Mat<ElemType>& distances) const;
 
   //! Returns a string representation of this object.
   std::string ToString() const;
@@ -206,6 +355,54 @@ class NeighborSearch
   //! Modify the number of node combination scores.
   size_t& Scores() { return scores; }
 
+  //! Get the number of threads used for dual-tree, naive and batched
+  //! single-tree search (0 means all available threads).
+  size_t NumThreads() const { return numThreads; }
+  //! Modify the number of threads used for dual-tree, naive and batched
+  //! single-tree search (0 means all available threads).  This only has an
+  //! effect if OpenMP is available; naive search is only parallel for the
+  //! Euclidean distance on dense data.
+  size_t& NumThreads() { return numThreads; }
+
+  //! Get the relative error allowed in tree-based search (0 means exact
+  //! search).
+  double Epsilon() const { return epsilon; }
+  //! Modify the relative error allowed in tree-based search.  With a nonzero
+  //! epsilon, nodes are pruned unless they can improve the current k'th
+  //! neighbor by more than a factor of (1 + epsilon); for nearest neighbor
+  //! search, each returned distance is then at most (1 + epsilon) times the
+  //! true distance of that neighbor, and for furthest neighbor search at least
+  //! (1 - epsilon) times it (so epsilon must be less than 1).  Naive search is
+  //! always exact.
+  double& Epsilon() { return epsilon; }
+
+  //! Get the number of query points searched together in single-tree mode (0
+  //! means each query point is searched on its own, in the given order).
+  size_t SingleBatchSize() const { return singleBatchSize; }
+  //! Modify the number of query points searched together in single-tree mode.
+  //! If it is not 0, the query points are ordered along the Hilbert curve and
+  //! split into batches of this many consecutive points, so that the points of
+  //! a batch are near each other and reach mostly the same reference nodes,
+  //! which are then still in the cache.  While a point is searched, the
+  //! neighbors found for the previous point of its batch are prefetched.  The
+  //! batches are searched in parallel with NumThreads() threads (except for
+  //! trees which cache distances in the reference nodes, like the cover tree).
+  //! The results are the same; a few dozen points per batch is a good start.
+  size_t& SingleBatchSize() { return singleBatchSize; }
+
+  //! Get whether parallel dual-tree search uses a copy of the reference set
+  //! and tree on each NUMA node.
+  bool ReplicateReferences() const { return replicateReferences; }
+  //! Modify whether parallel dual-tree search uses a copy of the reference set
+  //! and tree on each NUMA node (see util::NodeReplicas), so that the threads
+  //! of each node only read memory of their own node.  The copies are made by
+  //! the first search which needs them and kept until the object is destroyed;
+  //! this costs a copy of the reference set and tree for each node, and only
+  //! helps if the threads are pinned to cores (see util::PinThreads()).  The
+  //! copies are only used with a separate query set, and not by the cover
+  //! tree's own parallel traverser.
+  bool& ReplicateReferences() { return replicateReferences; }
+
  private:
   //! Copy of reference dataset (if we need it, because tree building modifies
   //! it).
@@ -246,6 +443,65 @@ class NeighborSearch
   //! The total number of scores (applicable for non-naive search).
   size_t scores;
 
+  //! The number of threads to use for dual-tree search.
+  size_t numThreads;
+  //! The relative error allowed in tree-based search.
+  double epsilon;
+  //! The number of query points searched together in single-tree mode.
+  size_t singleBatchSize;
+
+  /**
+   * Search the given query points with single-tree search, in batches of
+   * SingleBatchSize() points along the Hilbert curve, with the given number of
+   * threads.  The candidate lists must be initialized as for
+   * NeighborSearchRules.
+   *
+   * @param queries Set of query points.
+   * @param neighbors Candidate neighbor lists.
+   * @param distances Candidate distance lists.
+   * @param threads Number of threads to search the batches with.
+   * @param batchScores Incremented by the number of node scores.
+   * @param batchBaseCases Incremented by the number of base cases.
+   */
+  void BatchedSingleTreeSearch(const typename TreeType::Mat& queries,
+                               arma::Mat<size_t>& neighbors,
+                               arma::Mat<ElemType>& distances,
+                               const size_t threads,
+                               size_t& batchScores,
+                               size_t& batchBaseCases) const;
+
+  //! A copy of the reference set and its tree, on one NUMA node.
+  struct ReferenceReplica
+  {
+    ReferenceReplica() : tree(NULL) { }
+    ~ReferenceReplica() { delete tree; }
+
+    //! The copy of the reference set.
+    typename TreeType::Mat dataset;
+    //! The tree built on the copy.
+    TreeType* tree;
+  };
+
+  //! Makes a ReferenceReplica of the reference set (for util::NodeReplicas).
+  struct ReplicaFactory
+  {
+    ReplicaFactory(const typename TreeType::Mat& referenceSet) :
+        referenceSet(referenceSet) { }
+
+    //! Copy the reference set and build a tree on the copy; return NULL if the
+    //! tree does not keep the points in the same order as the original tree.
+    ReferenceReplica* operator()() const;
+
+    const typename TreeType::Mat& referenceSet;
+  };
+
+  //! Whether parallel dual-tree search uses a copy of the references on each
+  //! NUMA node.
+  bool replicateReferences;
+  //! The copies of the references on each node (NULL until a search needs
+  //! them).
+  util::NodeReplicas<ReferenceReplica>* referenceReplicas;
+
 }; // class NeighborSearch
 
 }; // namespace neighbor
@@ -9,8 +9,11 @@
 #define __MLPACK_METHODS_NEIGHBOR_SEARCH_NEIGHBOR_SEARCH_IMPL_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/tree/gather_subtrees.hpp>
 
 #include "neighbor_search_rules.hpp"
+#include "brute_force_search.hpp"
+#include "unmap.hpp"
 
 namespace mlpack {
 namespace neighbor {
@@ -39,9 +42,142 @@ TreeType* BuildTree(
   return new TreeType(dataset);
 }
 
+//! Get the memory account of the results of neighbor searches.
+inline size_t ResultsMemoryAccount()
+{
+  static const size_t account =
+      MemoryUsage::Register("neighbor_search_results");
+  return account;
+}
+
+/**
+ * Run a parallel dual-tree traversal with the tree's own parallel traverser, if
+ * it has one, and return whether it did.  The cover tree and the RectangleTree
+ * have one; for other trees this returns false, and the query tree is split
+ * with tree::GatherQuerySubtrees() instead.
+ */
+template<typename TreeType, typename RuleType>
+bool TreeParallelTraverse(TreeType& /* queryTree */,
+                          TreeType& /* referenceTree */,
+                          RuleType& /* rules */,
+                          const size_t /* numThreads */)
+{
+  return false;
+}
+
+//! The cover tree traverses the top of the query tree itself.
+template<typename MetricType,
+         typename RootPointPolicy,
+         typename StatisticType,
+         typename RuleType>
+bool TreeParallelTraverse(
+    tree::CoverTree<MetricType, RootPointPolicy, StatisticType>& queryTree,
+    tree::CoverTree<MetricType, RootPointPolicy, StatisticType>& referenceTree,
+    RuleType& rules,
+    const size_t numThreads)
+{
+  typename tree::CoverTree<MetricType, RootPointPolicy, StatisticType>::
+      template DualTreeTraverser<RuleType> traverser(rules);
+  traverser.Traverse(queryTree, referenceTree, numThreads);
+  return true;
+}
+
+//! The RectangleTree traverses the top of the query tree itself, so that the
+//! children of its (possibly very wide) nodes are split across the tasks.
+template<typename SplitType,
+         typename DescentType,
+         typename StatisticType,
+         typename MatType,
+         typename RuleType>
+bool TreeParallelTraverse(
+    tree::RectangleTree<SplitType, DescentType, StatisticType, MatType>&
+        queryTree,
+    tree::RectangleTree<SplitType, DescentType, StatisticType, MatType>&
+        referenceTree,
+    RuleType& rules,
+    const size_t numThreads)
+{
+  typename tree::RectangleTree<SplitType, DescentType, StatisticType,
+      MatType>::template DualTreeTraverser<RuleType> traverser(rules);
+  traverser.Traverse(queryTree, referenceTree, numThreads);
+  return true;
+}
+
+/**
+ * Find the order in which batched single-tree search visits the query points.
+ * Sparse query points are not ordered along a curve, so they are visited in
+ * their own order.
+ */
+template<typename MatType>
+void SingleTreeQueryOrder(const MatType& queries, std::vector<size_t>& order)
+{
+  order.resize(queries.n_cols);
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+}
+
+//! Dense query points are visited along the Hilbert curve.
+template<typename eT>
+void SingleTreeQueryOrder(const arma::Mat<eT>& queries,
+                          std::vector<size_t>& order)
+{
+  data::HilbertOrder(queries, order);
+}
+
+//! Prefetching the points of a sparse matrix is not worth it.
+template<typename MatType>
+void PrefetchPoint(const MatType& /* dataset */, const size_t /* index */)
+{
+}
+
+//! Prefetch the first cache line of a dense point.
+template<typename eT>
+void PrefetchPoint(const arma::Mat<eT>& dataset, const size_t index)
+{
+#ifdef __GNUC__
+  __builtin_prefetch(dataset.colptr(index));
+#endif
+}
+
+// Make a copy of the reference set and its tree on the calling thread's node.
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType>
+typename NeighborSearch<SortPolicy, MetricType, TreeType, CandidateListType>::
+    ReferenceReplica*
+NeighborSearch<SortPolicy, MetricType, TreeType, CandidateListType>::
+ReplicaFactory::operator()() const
+{
+  // The calling thread writes the copy, so it is placed on its node.
+  ReferenceReplica* replica = new ReferenceReplica();
+  replica->dataset = referenceSet;
+
+  std::vector<size_t> oldFromNew;
+  replica->tree = BuildTree<TreeType>(replica->dataset, oldFromNew);
+
+  // The reference set is already in the order of the original tree, so
+  // building the same tree on it should not move any points.  If it does (for
+  // instance, if the original tree was built with a different leaf size), the
+  // indices of the copy would not match, so it can't be used.
+  for (size_t i = 0; i < oldFromNew.size(); ++i)
+  {
+    if (oldFromNew[i] != i)
+    {
+      delete replica;
+      return NULL;
+    }
+  }
+
+  return replica;
+}
+
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType>
+NeighborSearch<SortPolicy, MetricType, TreeType, CandidateListType>::
 NeighborSearch(const typename TreeType::Mat& referenceSetIn,
                const typename TreeType::Mat& querySetIn,
                const bool naive,
@@ -59,7 +195,12 @@ NeighborSearch(const typename TreeType::Mat& referenceSetIn,
     singleMode(!naive && singleMode), // No single mode if naive.
     metric(metric),
     baseCases(0),
-    scores(0)
+    scores(0),
+    numThreads(1),
+    epsilon(0.0),
+    singleBatchSize(0),
+    replicateReferences(false),
+    referenceReplicas(NULL)
 {
   // C++11 will allow us to call out to other constructors so we can avoid this
   // copypasta problem.
@@ -67,7 +208,11 @@ NeighborSearch(const typename TreeType::Mat& referenceSetIn,
   // We'll time tree building, but only if we are building trees.
   Timer::Start("tree_building");
 
-  // Copy the datasets, if they will be modified during tree building.
+  // Copy the datasets, if they will be modified during tree building.  They are
+  // copied in naive mode too, so that the object never refers to matrices the
+  // caller may destroy, and so that the query set is never the reference set
+  // (each query point is then found as its own neighbor, as with trees, even
+  // if the same matrix is given twice).
   if (tree::TreeTraits<TreeType>::RearrangesDataset)
   {
     referenceCopy = referenceSetIn;
@@ -94,8 +239,11 @@ NeighborSearch(const typename TreeType::Mat& referenceSetIn,
 }
 
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType>
+NeighborSearch<SortPolicy, MetricType, TreeType, CandidateListType>::
 NeighborSearch(const typename TreeType::Mat& referenceSetIn,
                const bool naive,
                const bool singleMode,
@@ -112,12 +260,19 @@ NeighborSearch(const typename TreeType::Mat& referenceSetIn,
     singleMode(!naive && singleMode), // No single mode if naive.
     metric(metric),
     baseCases(0),
-    scores(0)
+    scores(0),
+    numThreads(1),
+    epsilon(0.0),
+    singleBatchSize(0),
+    replicateReferences(false),
+    referenceReplicas(NULL)
 {
   // We'll time tree building, but only if we are building trees.
   Timer::Start("tree_building");
 
-  // Copy the dataset, if it will be modified during tree building.
+  // Copy the dataset, if it will be modified during tree building (in naive
+  // mode too, so that the object never refers to a matrix the caller may
+  // destroy).
   if (tree::TreeTraits<TreeType>::RearrangesDataset)
     referenceCopy = referenceSetIn;
 
@@ -139,9 +294,178 @@ NeighborSearch(const typename TreeType::Mat& referenceSetIn,
   Timer::Stop("tree_building");
 }
 
+// Construct the object, building the trees on the given matrices.
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType>
+NeighborSearch<SortPolicy, MetricType, TreeType, CandidateListType>::
+NeighborSearch(typename TreeType::Mat& referenceSetIn,
+               typename TreeType::Mat& querySetIn,
+               std::vector<size_t>& oldFromNewReferencesOut,
+               std::vector<size_t>& oldFromNewQueriesOut,
+               const bool singleMode,
+               const MetricType metric) :
+    referenceSet(referenceSetIn),
+    querySet(querySetIn),
+    referenceTree(NULL),
+    queryTree(NULL),
+    treeOwner(true),
+    hasQuerySet(true),
+    naive(false),
+    singleMode(singleMode),
+    metric(metric),
+    baseCases(0),
+    scores(0),
+    numThreads(1),
+    epsilon(0.0),
+    singleBatchSize(0),
+    replicateReferences(false),
+    referenceReplicas(NULL)
+{
+  Timer::Start("tree_building");
+
+  referenceTree = BuildTree<TreeType>(referenceSetIn, oldFromNewReferences);
+  if (!singleMode)
+    queryTree = BuildTree<TreeType>(querySetIn, oldFromNewQueries);
+
+  Timer::Stop("tree_building");
+
+  // The mappings are kept to map the results of Search().
+  oldFromNewReferencesOut = oldFromNewReferences;
+  oldFromNewQueriesOut = oldFromNewQueries;
+}
+
+// Construct the object, building the tree on the given matrix.
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType>
+NeighborSearch<SortPolicy, MetricType, TreeType, CandidateListType>::
+NeighborSearch(typename TreeType::Mat& referenceSetIn,
+               std::vector<size_t>& oldFromNewReferencesOut,
+               const bool singleMode,
+               const MetricType metric) :
+    referenceSet(referenceSetIn),
+    querySet(referenceSetIn),
+    referenceTree(NULL),
+    queryTree(NULL),
+    treeOwner(true),
+    hasQuerySet(false),
+    naive(false),
+    singleMode(singleMode),
+    metric(metric),
+    baseCases(0),
+    scores(0),
+    numThreads(1),
+    epsilon(0.0),
+    singleBatchSize(0),
+    replicateReferences(false),
+    referenceReplicas(NULL)
+{
+  Timer::Start("tree_building");
+
+  referenceTree = BuildTree<TreeType>(referenceSetIn, oldFromNewReferences);
+  if (!singleMode)
+    queryTree = new TreeType(*referenceTree);
+
+  Timer::Stop("tree_building");
+
+  // The mapping is kept to map the results of Search().
+  oldFromNewReferencesOut = oldFromNewReferences;
+}
+
+// Construct the object, taking ownership of the given matrices.
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType>
+NeighborSearch<SortPolicy, MetricType, TreeType, CandidateListType>::
+NeighborSearch(typename TreeType::Mat&& referenceSetIn,
+               typename TreeType::Mat&& querySetIn,
+               const bool naive,
+               const bool singleMode,
+               const MetricType metric) :
+    referenceCopy(std::move(referenceSetIn)),
+    queryCopy(std::move(querySetIn)),
+    referenceSet(referenceCopy),
+    querySet(queryCopy),
+    referenceTree(NULL),
+    queryTree(NULL),
+    treeOwner(!naive), // If naive, then we are not building any trees.
+    hasQuerySet(true),
+    naive(naive),
+    singleMode(!naive && singleMode), // No single mode if naive.
+    metric(metric),
+    baseCases(0),
+    scores(0),
+    numThreads(1),
+    epsilon(0.0),
+    singleBatchSize(0),
+    replicateReferences(false),
+    referenceReplicas(NULL)
+{
+  Timer::Start("tree_building");
+
+  // The matrices are our own, so the trees are built on them in place.
+  if (!naive)
+  {
+    referenceTree = BuildTree<TreeType>(referenceCopy, oldFromNewReferences);
+    if (!singleMode)
+      queryTree = BuildTree<TreeType>(queryCopy, oldFromNewQueries);
+  }
+
+  Timer::Stop("tree_building");
+}
+
+// Construct the object, taking ownership of the given matrix.
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType>
+NeighborSearch<SortPolicy, MetricType, TreeType, CandidateListType>::
+NeighborSearch(typename TreeType::Mat&& referenceSetIn,
+               const bool naive,
+               const bool singleMode,
+               const MetricType metric) :
+    referenceCopy(std::move(referenceSetIn)),
+    referenceSet(referenceCopy),
+    querySet(referenceCopy),
+    referenceTree(NULL),
+    queryTree(NULL),
+    treeOwner(!naive), // If naive, then we are not building any trees.
+    hasQuerySet(false),
+    naive(naive),
+    singleMode(!naive && singleMode), // No single mode if naive.
+    metric(metric),
+    baseCases(0),
+    scores(0),
+    numThreads(1),
+    epsilon(0.0),
+    singleBatchSize(0),
+    replicateReferences(false),
+    referenceReplicas(NULL)
+{
+  Timer::Start("tree_building");
+
+  // The matrix is our own, so the tree is built on it in place.
+  if (!naive)
+  {
+    referenceTree = BuildTree<TreeType>(referenceCopy, oldFromNewReferences);
+    if (!singleMode)
+      queryTree = new TreeType(*referenceTree);
+  }
+
+  Timer::Stop("tree_building");
+}
+
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::NeighborSearch(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType>
+NeighborSearch<SortPolicy, MetricType, TreeType, CandidateListType>::
+NeighborSearch(
     TreeType* referenceTree,
     TreeType* queryTree,
     const typename TreeType::Mat& referenceSet,
@@ -158,14 +482,23 @@ NeighborSearch<SortPolicy, MetricType, TreeType>::NeighborSearch(
     singleMode(singleMode),
     metric(metric),
     baseCases(0),
-    scores(0)
+    scores(0),
+    numThreads(1),
+    epsilon(0.0),
+    singleBatchSize(0),
+    replicateReferences(false),
+    referenceReplicas(NULL)
 {
   // Nothing else to initialize.
 }
 
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::NeighborSearch(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType>
+NeighborSearch<SortPolicy, MetricType, TreeType, CandidateListType>::
+NeighborSearch(
     TreeType* referenceTree,
     const typename TreeType::Mat& referenceSet,
     const bool singleMode,
@@ -180,7 +513,12 @@ NeighborSearch<SortPolicy, MetricType, TreeType>::NeighborSearch(
     singleMode(singleMode),
     metric(metric),
     baseCases(0),
-    scores(0)
+    scores(0),
+    numThreads(1),
+    epsilon(0.0),
+    singleBatchSize(0),
+    replicateReferences(false),
+    referenceReplicas(NULL)
 {
   Timer::Start("tree_building");
 
@@ -195,8 +533,12 @@ NeighborSearch<SortPolicy, MetricType, TreeType>::NeighborSearch(
  * The tree is the only member we may be responsible for deleting.  The others
  * will take care of themselves.
  */
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::~NeighborSearch()
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType>
+NeighborSearch<SortPolicy, MetricType, TreeType, CandidateListType>::
+~NeighborSearch()
 {
   if (treeOwner)
   {
@@ -210,53 +552,59 @@ NeighborSearch<SortPolicy, MetricType, TreeType>::~NeighborSearch()
     // We replicated the reference tree to create a query tree.
     delete queryTree;
   }
+
+  delete referenceReplicas;
 }
 
 /**
  * Computes the best neighbors and stores them in resultingNeighbors and
  * distances.
  */
-template<typename SortPolicy, typename MetricType, typename TreeType>
-void NeighborSearch<SortPolicy, MetricType, TreeType>::Search(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType>
+void NeighborSearch<SortPolicy, MetricType, TreeType, CandidateListType>::
+Search(
     const size_t k,
     arma::Mat<size_t>& resultingNeighbors,
-    arma::mat& distances)
+    arma::Mat<ElemType>& distances)
 {
   Timer::Start("computing_neighbors");
 
-  // If we have built the trees ourselves, then we will have to map all the
-  // indices back to their original indices when this computation is finished.
-  // To avoid an extra copy, we will store the neighbors and distances in a
-  // separate matrix.
-  arma::Mat<size_t>* neighborPtr = &resultingNeighbors;
-  arma::mat* distancePtr = &distances;
-
-  // Mapping is only necessary if the tree rearranges points.
-  if (tree::TreeTraits<TreeType>::RearrangesDataset)
-  {
-    if (treeOwner && !(singleMode && hasQuerySet))
-      distancePtr = new arma::mat; // Query indices need to be mapped.
-
-    if (treeOwner)
-      neighborPtr = new arma::Mat<size_t>; // All indices need mapping.
-  }
-
-  // Set the size of the neighbor and distance matrices.
-  neighborPtr->set_size(k, querySet.n_cols);
-  neighborPtr->fill(size_t() - 1);
-  distancePtr->set_size(k, querySet.n_cols);
-  distancePtr->fill(SortPolicy::WorstDistance());
+  // The results belong to the caller after the search, so they are only
+  // accounted while it runs.
+  ScopedMemory resultsMemory(ResultsMemoryAccount(),
+      k * querySet.n_cols * (sizeof(size_t) + sizeof(ElemType)));
+
+  // Set the size of the neighbor and distance matrices.  If we have built the
+  // trees ourselves, the results are mapped back to the original indices in
+  // place when the search is finished, so no second copy of them is made.
+  resultingNeighbors.set_size(k, querySet.n_cols);
+  resultingNeighbors.fill(size_t() - 1);
+  distances.set_size(k, querySet.n_cols);
+  // The worst distance may not be representable in ElemType (DBL_MAX is not a
+  // float), so it is clamped; it only has to be worse than any real distance.
+  distances.fill(std::min(SortPolicy::WorstDistance(),
+      (double) std::numeric_limits<ElemType>::max()));
 
   // Create the helper object for the tree traversal.
-  typedef NeighborSearchRules<SortPolicy, MetricType, TreeType> RuleType;
-  RuleType rules(referenceSet, querySet, *neighborPtr, *distancePtr, metric);
+  typedef NeighborSearchRules<SortPolicy, MetricType, TreeType,
+      CandidateListType> RuleType;
+  RuleType rules(referenceSet, querySet, resultingNeighbors, distances, metric,
+      epsilon);
 
   if (naive)
   {
-    // The naive brute-force traversal.
-    for (size_t i = 0; i < querySet.n_cols; ++i)
-      for (size_t j = 0; j < referenceSet.n_cols; ++j)
-        rules.BaseCase(i, j);
+    // Euclidean distances on dense matrices are computed in blocks with matrix
+    // products; otherwise, the naive brute-force traversal is used.
+    if (!BruteForceSearch<SortPolicy, CandidateListType>(referenceSet,
+        querySet, metric, resultingNeighbors, distances, numThreads))
+    {
+      for (size_t i = 0; i < querySet.n_cols; ++i)
+        for (size_t j = 0; j < referenceSet.n_cols; ++j)
+          rules.BaseCase(i, j);
+    }
 
     baseCases += querySet.n_cols * referenceSet.n_cols;
   }
@@ -266,20 +614,46 @@ void NeighborSearch<SortPolicy, MetricType, TreeType>::Search(
     // If this is the case, it is suggested that you use the naive method.
     Log::Assert(!(referenceTree->IsLeaf()));
 
-    // Create the traverser.
-    typename TreeType::template SingleTreeTraverser<RuleType> traverser(rules);
+    if (singleBatchSize > 0)
+    {
+      // Trees which cache distances in the reference nodes can't be searched
+      // by several threads at once.
+#ifdef _OPENMP
+      const size_t threads = tree::TreeTraits<TreeType>::HasSelfChildren ? 1 :
+          util::NumThreads(numThreads);
+#else
+      const size_t threads = 1;
+#endif
 
-    // Now have it traverse for each point.
-    for (size_t i = 0; i < querySet.n_cols; ++i)
-      traverser.Traverse(i, *referenceTree);
+      size_t batchScores = 0;
+      size_t batchBaseCases = 0;
+      BatchedSingleTreeSearch(querySet, resultingNeighbors, distances, threads,
+          batchScores, batchBaseCases);
 
-    scores += rules.Scores();
-    baseCases += rules.BaseCases();
+      scores += batchScores;
+      baseCases += batchBaseCases;
 
-    Log::Info << rules.Scores() << " node combinations were scored.\n";
-    Log::Info << rules.BaseCases() << " base cases were calculated.\n";
+      Log::Info << batchScores << " node combinations were scored.\n";
+      Log::Info << batchBaseCases << " base cases were calculated.\n";
+    }
+    else
+    {
+      // Create the traverser.
+      typename TreeType::template SingleTreeTraverser<RuleType>
+          traverser(rules);
+
+      // Now have it traverse for each point.
+      for (size_t i = 0; i < querySet.n_cols; ++i)
+        traverser.Traverse(i, *referenceTree);
+
+      scores += rules.Scores();
+      baseCases += rules.BaseCases();
+
+      Log::Info << rules.Scores() << " node combinations were scored.\n";
+      Log::Info << rules.BaseCases() << " base cases were calculated.\n";
+    }
   }
-  else // Dual-tree recursion.
+  else if (numThreads == 1) // Dual-tree recursion.
   {
     // Create the traverser.
     typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
@@ -292,83 +666,283 @@ void NeighborSearch<SortPolicy, MetricType, TreeType>::Search(
     Log::Info << rules.Scores() << " node combinations were scored.\n";
     Log::Info << rules.BaseCases() << " base cases were calculated.\n";
   }
-
-  Timer::Stop("computing_neighbors");
-
-  // Now, do we need to do mapping of indices?
-  if (!treeOwner || !tree::TreeTraits<TreeType>::RearrangesDataset)
+  else if (TreeParallelTraverse(*queryTree, *referenceTree, rules,
+      numThreads)) // Parallel dual-tree recursion with the tree's traverser.
   {
-    // No mapping needed.  We are done.
-    return;
+    scores += rules.Scores();
+    baseCases += rules.BaseCases();
+
+    Log::Info << rules.Scores() << " node combinations were scored.\n";
+    Log::Info << rules.BaseCases() << " base cases were calculated.\n";
   }
-  else if (treeOwner && hasQuerySet && !singleMode) // Map both sets.
+  else // Parallel dual-tree recursion.
   {
-    // Set size of output matrices correctly.
-    resultingNeighbors.set_size(k, querySet.n_cols);
-    distances.set_size(k, querySet.n_cols);
+#ifdef _OPENMP
+    const size_t threads = util::NumThreads(numThreads);
+#else
+    const size_t threads = 1;
+#endif
 
-    for (size_t i = 0; i < distances.n_cols; i++)
+    // Split the query tree into disjoint subtrees.  We ask for a few more
+    // subtrees than threads so that the load is balanced when some subtrees
+    // are much more expensive than others.
+    std::vector<TreeType*> querySubtrees;
+    tree::GatherQuerySubtrees(*queryTree, 4 * threads, querySubtrees);
+
+    Log::Info << "Traversing " << querySubtrees.size() << " query subtrees "
+        << "with " << threads << " threads.\n";
+
+    // Make the copies of the references on each node, if they are wanted and
+    // haven't been made by an earlier search.  (When the query set is the
+    // reference set, the rules recognize a point by its address in the
+    // reference set, so the copies can't be used.)
+    const bool replicate = replicateReferences && hasQuerySet;
+    if (replicate && referenceReplicas == NULL)
     {
-      // Map distances (copy a column).
-      distances.col(oldFromNewQueries[i]) = distancePtr->col(i);
+      Timer::Start("replicating_references");
+      referenceReplicas = new util::NodeReplicas<ReferenceReplica>();
+      ReplicaFactory factory(referenceSet);
+      referenceReplicas->Build(factory, threads);
+      Timer::Stop("replicating_references");
+    }
 
-      // Map indices of neighbors.
-      for (size_t j = 0; j < distances.n_rows; j++)
-      {
-        resultingNeighbors(j, oldFromNewQueries[i]) =
-            oldFromNewReferences[(*neighborPtr)(j, i)];
-      }
+    // Each traversal gets its own rules object.  The query subtrees hold
+    // disjoint sets of points, so each rules object only ever writes to its own
+    // columns of the neighbor and distance matrices.
+    size_t totalScores = 0;
+    size_t totalBaseCases = 0;
+    #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+        reduction(+:totalScores, totalBaseCases)
+    for (size_t i = 0; i < querySubtrees.size(); ++i)
+    {
+      // Use the copy of the references on this thread's node, if there is one.
+      const ReferenceReplica* replica = (replicate) ?
+          referenceReplicas->Local() : NULL;
+      const typename TreeType::Mat& threadReferences = (replica != NULL) ?
+          replica->dataset : referenceSet;
+      TreeType& threadReferenceTree = (replica != NULL) ? *replica->tree :
+          *referenceTree;
+
+      MetricType threadMetric(metric);
+      RuleType threadRules(threadReferences, querySet, resultingNeighbors,
+          distances, threadMetric, epsilon);
+      typename TreeType::template DualTreeTraverser<RuleType>
+          traverser(threadRules);
+
+      traverser.Traverse(*querySubtrees[i], threadReferenceTree);
+
+      totalScores += threadRules.Scores();
+      totalBaseCases += threadRules.BaseCases();
     }
 
-    // Finished with temporary matrices.
-    delete neighborPtr;
-    delete distancePtr;
+    scores += totalScores;
+    baseCases += totalBaseCases;
+
+    Log::Info << totalScores << " node combinations were scored.\n";
+    Log::Info << totalBaseCases << " base cases were calculated.\n";
   }
-  else if (treeOwner && !hasQuerySet)
-  {
-    resultingNeighbors.set_size(k, querySet.n_cols);
-    distances.set_size(k, querySet.n_cols);
 
-    for (size_t i = 0; i < distances.n_cols; i++)
-    {
-      // Map distances (copy a column).
-      distances.col(oldFromNewReferences[i]) = distancePtr->col(i);
+  // Put the candidate lists into their final order.
+  CandidateListType::Finalize(distances, resultingNeighbors);
+
+  Timer::Stop("computing_neighbors");
+
+  // Now, do we need to do mapping of indices?
+  if (!treeOwner || !tree::TreeTraits<TreeType>::RearrangesDataset)
+    return; // No mapping needed.  We are done.
+
+  Timer::Start("unmapping_neighbors");
+  if (hasQuerySet && !singleMode) // Map both sets.
+    UnmapInPlace(resultingNeighbors, distances, oldFromNewReferences,
+        oldFromNewQueries, false, numThreads);
+  else if (!hasQuerySet)
+    UnmapInPlace(resultingNeighbors, distances, oldFromNewReferences,
+        oldFromNewReferences, false, numThreads);
+  else // Map only references.
+    UnmapInPlace(resultingNeighbors, distances, oldFromNewReferences, false,
+        numThreads);
+  Timer::Stop("unmapping_neighbors");
+} // Search
 
-      // Map indices of neighbors.
-      for (size_t j = 0; j < distances.n_rows; j++)
-      {
-        resultingNeighbors(j, oldFromNewReferences[i]) =
-            oldFromNewReferences[(*neighborPtr)(j, i)];
-      }
-    }
 
-    // Finished with temporary matrices.
-    delete neighborPtr;
-    delete distancePtr;
+/**
+ * Computes the best neighbors of a separate set of query points, with all of
+ * the state of the search local to the call.
+ */
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType>
+void NeighborSearch<SortPolicy, MetricType, TreeType, CandidateListType>::
+Search(
+    const typename TreeType::Mat& querySetIn,
+    const size_t k,
+    arma::Mat<size_t>& resultingNeighbors,
+    arma::Mat<ElemType>& distances) const
+{
+  // Trees whose nodes share points with their children cache distances in the
+  // reference nodes during single-tree search, so another thread may be
+  // writing to them.
+  const bool single = singleMode && !tree::TreeTraits<TreeType>::HasSelfChildren
+      && !referenceTree->IsLeaf();
+  const bool dual = !naive && !single;
+
+  // The query tree may rearrange its points, so it is built on a copy.
+  typename TreeType::Mat queryCopy;
+  if (dual && tree::TreeTraits<TreeType>::RearrangesDataset)
+    queryCopy = querySetIn;
+  const typename TreeType::Mat& queries =
+      (dual && tree::TreeTraits<TreeType>::RearrangesDataset) ? queryCopy :
+      querySetIn;
+
+  std::vector<size_t> oldFromNewQueries;
+  TreeType* localQueryTree = NULL;
+  if (dual)
+    localQueryTree = BuildTree<TreeType>(
+        const_cast<typename TreeType::Mat&>(queries), oldFromNewQueries);
+
+  // The results are found in the output matrices, and mapped in place.
+  ScopedMemory resultsMemory(ResultsMemoryAccount(),
+      k * queries.n_cols * (sizeof(size_t) + sizeof(ElemType)));
+  resultingNeighbors.set_size(k, queries.n_cols);
+  resultingNeighbors.fill(size_t() - 1);
+  distances.set_size(k, queries.n_cols);
+  distances.fill(std::min(SortPolicy::WorstDistance(),
+      (double) std::numeric_limits<ElemType>::max()));
+
+  // The rules need a metric they can modify.
+  MetricType localMetric(metric);
+  typedef NeighborSearchRules<SortPolicy, MetricType, TreeType,
+      CandidateListType> RuleType;
+  RuleType rules(referenceSet, queries, resultingNeighbors, distances,
+      localMetric, epsilon);
+
+  if (naive)
+  {
+    if (!BruteForceSearch<SortPolicy, CandidateListType>(referenceSet, queries,
+        localMetric, resultingNeighbors, distances, 1))
+    {
+      for (size_t i = 0; i < queries.n_cols; ++i)
+        for (size_t j = 0; j < referenceSet.n_cols; ++j)
+          rules.BaseCase(i, j);
+    }
+  }
+  else if (single && singleBatchSize > 0)
+  {
+    size_t batchScores = 0;
+    size_t batchBaseCases = 0;
+    BatchedSingleTreeSearch(queries, resultingNeighbors, distances, 1,
+        batchScores, batchBaseCases);
+  }
+  else if (single)
+  {
+    typename TreeType::template SingleTreeTraverser<RuleType> traverser(rules);
+    for (size_t i = 0; i < queries.n_cols; ++i)
+      traverser.Traverse(i, *referenceTree);
   }
-  else if (treeOwner && hasQuerySet && singleMode) // Map only references.
+  else
   {
-    // Set size of neighbor indices matrix correctly.
-    resultingNeighbors.set_size(k, querySet.n_cols);
+    typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
+    traverser.Traverse(*localQueryTree, *referenceTree);
+  }
+
+  delete localQueryTree;
+
+  CandidateListType::Finalize(distances, resultingNeighbors);
+
+  // Map the results back to the original query and reference indices.
+  const bool mapQueries = dual && tree::TreeTraits<TreeType>::RearrangesDataset;
+  const bool mapReferences = treeOwner &&
+      tree::TreeTraits<TreeType>::RearrangesDataset;
 
-    // Map indices of neighbors.
-    for (size_t i = 0; i < resultingNeighbors.n_cols; i++)
+  // An empty reference mapping leaves the neighbor indices as they are.
+  const std::vector<size_t> noMapping;
+  const std::vector<size_t>& referenceMap = mapReferences ?
+      oldFromNewReferences : noMapping;
+  if (mapQueries)
+    UnmapInPlace(resultingNeighbors, distances, referenceMap,
+        oldFromNewQueries, false, 1);
+  else if (mapReferences)
+    UnmapInPlace(resultingNeighbors, distances, referenceMap, false, 1);
+}
+
+// Search the query points in batches along the Hilbert curve.
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType>
+void NeighborSearch<SortPolicy, MetricType, TreeType, CandidateListType>::
+BatchedSingleTreeSearch(
+    const typename TreeType::Mat& queries,
+    arma::Mat<size_t>& neighbors,
+    arma::Mat<ElemType>& distances,
+    const size_t threads,
+    size_t& batchScores,
+    size_t& batchBaseCases) const
+{
+  std::vector<size_t> order;
+  SingleTreeQueryOrder(queries, order);
+
+  const size_t numBatches = (queries.n_cols + singleBatchSize - 1) /
+      singleBatchSize;
+
+  typedef NeighborSearchRules<SortPolicy, MetricType, TreeType,
+      CandidateListType> RuleType;
+
+  // Each thread gets its own rules object.  The batches hold disjoint sets of
+  // points, so each thread only ever writes to its own columns of the neighbor
+  // and distance matrices.
+  size_t totalScores = 0;
+  size_t totalBaseCases = 0;
+  #pragma omp parallel num_threads(threads) \
+      reduction(+:totalScores, totalBaseCases)
+  {
+    MetricType threadMetric(metric);
+    RuleType threadRules(referenceSet, queries, neighbors, distances,
+        threadMetric, epsilon);
+    typename TreeType::template SingleTreeTraverser<RuleType>
+        traverser(threadRules);
+
+    #pragma omp for schedule(dynamic)
+    for (size_t b = 0; b < numBatches; ++b)
     {
-      for (size_t j = 0; j < resultingNeighbors.n_rows; j++)
+      const size_t begin = b * singleBatchSize;
+      const size_t end = std::min(begin + singleBatchSize, (size_t)
+          queries.n_cols);
+      for (size_t i = begin; i < end; ++i)
       {
-        resultingNeighbors(j, i) = oldFromNewReferences[(*neighborPtr)(j, i)];
+        // The neighbors of the previous point of the batch are probably
+        // among the neighbors of this one, so they are loaded while the
+        // traversal descends to them.
+        if (i > begin)
+        {
+          for (size_t j = 0; j < neighbors.n_rows; ++j)
+          {
+            const size_t neighbor = neighbors(j, order[i - 1]);
+            if (neighbor < referenceSet.n_cols)
+              PrefetchPoint(referenceSet, neighbor);
+          }
+        }
+
+        traverser.Traverse(order[i], *referenceTree);
       }
     }
 
-    // Finished with temporary matrix.
-    delete neighborPtr;
+    totalScores += threadRules.Scores();
+    totalBaseCases += threadRules.BaseCases();
   }
-} // Search
 
+  batchScores += totalScores;
+  batchBaseCases += totalBaseCases;
+}
 
 //Return a String of the Object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-std::string NeighborSearch<SortPolicy, MetricType, TreeType>::ToString() const
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType>
+std::string NeighborSearch<SortPolicy, MetricType, TreeType,
+    CandidateListType>::ToString() const
 {
   std::ostringstream convert;
   convert << "NeighborSearch [" << this << "]" << std::endl;
@@ -9,19 +9,55 @@
 #define __MLPACK_METHODS_NEIGHBOR_SEARCH_NEIGHBOR_SEARCH_RULES_HPP
 
 #include "ns_traversal_info.hpp"
+#include "candidate_lists/sorted_candidate_list.hpp"
 
 namespace mlpack {
 namespace neighbor {
 
-template<typename SortPolicy, typename MetricType, typename TreeType>
+/**
+ * The pruning rules and base case for NeighborSearch.  The candidate neighbors
+ * of each query point are held in the given neighbors and distances matrices,
+ * and the way each column of those matrices is organized during the search is
+ * controlled by CandidateListType (see SortedCandidateList).
+ *
+ * @tparam SortPolicy The sort policy for distances; see NearestNeighborSort.
+ * @tparam MetricType The metric to use for computation.
+ * @tparam TreeType The tree type to use.
+ * @tparam CandidateListType The candidate list policy; see
+ *     SortedCandidateList.
+ */
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename CandidateListType = SortedCandidateList<SortPolicy> >
 class NeighborSearchRules
 {
  public:
+  //! The type of the elements of the dataset, which distances are stored as.
+  typedef typename TreeType::Mat::elem_type ElemType;
+
+  /**
+   * Create the rules for a search of the given sets, which stores its results
+   * in the given matrices.  With a nonzero epsilon, the search is approximate:
+   * a node is pruned unless it may hold a point which is better than the
+   * current k'th candidate by a factor of (1 + epsilon) (see
+   * SortPolicy::Relax()), so for nearest neighbor search each returned
+   * distance is at most (1 + epsilon) times the true distance of that
+   * neighbor.
+   *
+   * @param referenceSet Set of reference points.
+   * @param querySet Set of query points.
+   * @param neighbors Matrix to store the neighbor indices in.
+   * @param distances Matrix to store the neighbor distances in.
+   * @param metric Instantiated metric.
+   * @param epsilon Relative error allowed (0 for exact search).
+   */
   NeighborSearchRules(const typename TreeType::Mat& referenceSet,
                       const typename TreeType::Mat& querySet,
                       arma::Mat<size_t>& neighbors,
-                      arma::mat& distances,
-                      MetricType& metric);
+                      arma::Mat<ElemType>& distances,
+                      MetricType& metric,
+                      const double epsilon = 0.0);
   /**
    * Get the distance from the query point to the reference point.
    * This will update the "neighbor" matrix with the new point if appropriate
@@ -92,6 +128,9 @@ class NeighborSearchRules
   //! Modify the number of scores that have been performed.
   size_t& Scores() { return scores; }
 
+  //! Get the relative error allowed (0 for exact search).
+  double Epsilon() const { return epsilon; }
+
   //! Convenience typedef.
   typedef NeighborSearchTraversalInfo<TreeType> TraversalInfoType;
 
@@ -111,11 +150,14 @@ class NeighborSearchRules
   arma::Mat<size_t>& neighbors;
 
   //! The matrix the resultant neighbor distances should be stored in.
-  arma::mat& distances;
+  arma::Mat<ElemType>& distances;
 
   //! The instantiated metric.
   MetricType& metric;
 
+  //! The relative error allowed.
+  double epsilon;
+
   //! The last query point BaseCase() was called with.
   size_t lastQueryIndex;
   //! The last reference point BaseCase() was called with.
@@ -133,23 +175,9 @@ class NeighborSearchRules
   TraversalInfoType traversalInfo;
 
   /**
-   * Recalculate the bound for a given query node.
+   * Recalculate the bound for a given query node, relaxed by epsilon.
    */
   double CalculateBound(TreeType& queryNode) const;
-
-  /**
-   * Insert a point into the neighbors and distances matrices; this is a helper
-   * function.
-   *
-   * @param queryIndex Index of point whose neighbors we are inserting into.
-   * @param pos Position in list to insert into.
-   * @param neighbor Index of reference point which is being inserted.
-   * @param distance Distance from query point to reference point.
-   */
-  void InsertNeighbor(const size_t queryIndex,
-                      const size_t pos,
-                      const size_t neighbor,
-                      const double distance);
 };
 
 }; // namespace neighbor
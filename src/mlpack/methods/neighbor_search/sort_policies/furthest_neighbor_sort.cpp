@@ -8,9 +8,13 @@
 
 using namespace mlpack::neighbor;
 
-size_t FurthestNeighborSort::SortDistance(const arma::vec& list,
-                                          const arma::Col<size_t>& indices,
-                                          double newDistance)
+namespace {
+
+// The search is the same for lists of doubles and of floats.
+template<typename VecType>
+size_t SortDistanceImpl(const VecType& list,
+                        const arma::Col<size_t>& indices,
+                        const double newDistance)
 {
   // The first element in the list is the nearest neighbor.  We only want to
   // insert if the new distance is greater than the last element in the list.
@@ -25,3 +29,19 @@ size_t FurthestNeighborSort::SortDistance(const arma::vec& list,
   // Control should never reach here.
   return (size_t() - 1);
 }
+
+} // anonymous namespace
+
+size_t FurthestNeighborSort::SortDistance(const arma::vec& list,
+                                          const arma::Col<size_t>& indices,
+                                          double newDistance)
+{
+  return SortDistanceImpl(list, indices, newDistance);
+}
+
+size_t FurthestNeighborSort::SortDistance(const arma::fvec& list,
+                                          const arma::Col<size_t>& indices,
+                                          double newDistance)
+{
+  return SortDistanceImpl(list, indices, newDistance);
+}
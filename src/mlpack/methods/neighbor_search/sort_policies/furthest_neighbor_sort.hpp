@@ -40,6 +40,12 @@ class FurthestNeighborSort
                              const arma::Col<size_t>& indices,
                              double newDistance);
 
+  //! Return the insertion position in a list of single-precision distances;
+  //! see the overload for double-precision distances.
+  static size_t SortDistance(const arma::fvec& list,
+                             const arma::Col<size_t>& indices,
+                             double newDistance);
+
   /**
    * Return whether or not value is "better" than ref.  In this case, that means
    * that the value is greater than the reference.
@@ -145,6 +151,21 @@ class FurthestNeighborSort
    */
   static inline double CombineWorst(const double a, const double b)
   { return std::max(a - b, 0.0); }
+
+  /**
+   * Return the pruning bound for (1 - epsilon)-approximate search, given the
+   * distance of the current k'th best candidate: a node is only visited if it
+   * may hold a point further than distance / (1 - epsilon).  epsilon must be
+   * less than 1.
+   */
+  static inline double Relax(const double value, const double epsilon)
+  {
+    if (value == 0.0)
+      return 0.0;
+    if (epsilon >= 1.0)
+      return DBL_MAX;
+    return value / (1 - epsilon);
+  }
 };
 
 }; // namespace neighbor
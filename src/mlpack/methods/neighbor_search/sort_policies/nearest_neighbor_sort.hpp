@@ -44,6 +44,12 @@ class NearestNeighborSort
                              const arma::Col<size_t>& indices,
                              double newDistance);
 
+  //! Return the insertion position in a list of single-precision distances;
+  //! see the overload for double-precision distances.
+  static size_t SortDistance(const arma::fvec& list,
+                             const arma::Col<size_t>& indices,
+                             double newDistance);
+
   /**
    * Return whether or not value is "better" than ref.  In this case, that means
    * that the value is less than the reference.
@@ -150,6 +156,18 @@ class NearestNeighborSort
       return DBL_MAX;
     return a + b;
   }
+
+  /**
+   * Return the pruning bound for (1 + epsilon)-approximate search, given the
+   * distance of the current k'th best candidate: a node is only visited if it
+   * may hold a point closer than distance / (1 + epsilon).
+   */
+  static inline double Relax(const double value, const double epsilon)
+  {
+    if (value == DBL_MAX)
+      return DBL_MAX;
+    return value / (1 + epsilon);
+  }
 };
 
 }; // namespace neighbor
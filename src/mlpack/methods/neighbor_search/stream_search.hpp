@@ -0,0 +1,88 @@
+/**
+ * @file stream_search.hpp
+ *
+ * Search the points of a query file against a reference tree in blocks, so
+ * that query sets which do not fit in memory can be searched.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_STREAM_SEARCH_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_STREAM_SEARCH_HPP
+
+#include <mlpack/core.hpp>
+#include <iostream>
+
+#include "neighbor_search.hpp"
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * Search the query points read by the given StreamingReader against a
+ * reference tree, one block at a time, and append the results of each block to
+ * the given streams.  Only one block of query points and its results are in
+ * memory at once; if the reader prefetches, the next block is read while the
+ * current one is searched.
+ *
+ * Each block is searched with dual-tree search (with a query tree built on the
+ * block), or with single-tree search if singleMode is true.  The results are
+ * mapped back to the original indices of the reference points, and written as
+ * CSV with one line for each query point, in the order of the query file: the
+ * indices of its k neighbors (with referenceOffset added) to neighborsOut, and
+ * the k distances to distancesOut.  The results are formatted with
+ * data::WriteText(), so the output is the same as that of data::Save() for
+ * the results of NeighborSearch::Search().
+ *
+ * The reference tree and the reference set are not modified, so they can be
+ * used for any number of searches.  A fatal error is issued if the query
+ * points and the reference points have different dimensionalities, or if a
+ * stream cannot be written to.
+ *
+ * @code
+ * std::vector<size_t> oldFromNew;
+ * KDTree referenceTree(referenceData, oldFromNew);
+ * data::StreamingReader queries("queries.csv", 100000);
+ * std::ofstream neighbors("neighbors.csv"), distances("distances.csv");
+ * StreamSearch<NearestNeighborSort>(referenceTree, referenceData, oldFromNew,
+ *     queries, 5, neighbors, distances);
+ * @endcode
+ *
+ * @tparam SortPolicy Sort policy of the search (nearest or furthest).
+ * @tparam TreeType Type of BinarySpaceTree (a kd-tree or a ball tree).
+ * @param referenceTree Tree built on the reference points.
+ * @param referenceData Reference points, as rearranged by referenceTree.
+ * @param oldFromNewReferences Original index of each rearranged reference
+ *     point.
+ * @param queries Reader of the query points (it is reset first).
+ * @param k Number of neighbors to find.
+ * @param neighborsOut Stream to write the neighbors of each point to.
+ * @param distancesOut Stream to write the distances of each point to.
+ * @param leafSize Leaf size of the query trees.
+ * @param singleMode If true, use single-tree search instead of dual-tree.
+ * @param numThreads Number of threads for the search of each block.
+ * @param epsilon Relative error allowed in the distances.
+ * @param singleBatchSize Batch size of single-tree search (see
+ *     NeighborSearch::SingleBatchSize()).
+ * @param referenceOffset Number added to each neighbor index.
+ * @return The number of query points searched.
+ */
+template<typename SortPolicy, typename TreeType>
+size_t StreamSearch(TreeType& referenceTree,
+                    const arma::mat& referenceData,
+                    const std::vector<size_t>& oldFromNewReferences,
+                    data::StreamingReader& queries,
+                    const size_t k,
+                    std::ostream& neighborsOut,
+                    std::ostream& distancesOut,
+                    const size_t leafSize = 20,
+                    const bool singleMode = false,
+                    const size_t numThreads = 1,
+                    const double epsilon = 0.0,
+                    const size_t singleBatchSize = 0,
+                    const size_t referenceOffset = 0);
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+// Include implementation.
+#include "stream_search_impl.hpp"
+
+#endif
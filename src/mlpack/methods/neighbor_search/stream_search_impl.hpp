@@ -0,0 +1,108 @@
+/**
+ * @file stream_search_impl.hpp
+ *
+ * Implementation of the search of a query file in blocks.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_STREAM_SEARCH_IMPL_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_STREAM_SEARCH_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "stream_search.hpp"
+
+#include <mlpack/core/data/write_text.hpp>
+#include "unmap.hpp"
+
+namespace mlpack {
+namespace neighbor {
+
+template<typename SortPolicy, typename TreeType>
+size_t StreamSearch(TreeType& referenceTree,
+                    const arma::mat& referenceData,
+                    const std::vector<size_t>& oldFromNewReferences,
+                    data::StreamingReader& queries,
+                    const size_t k,
+                    std::ostream& neighborsOut,
+                    std::ostream& distancesOut,
+                    const size_t leafSize,
+                    const bool singleMode,
+                    const size_t numThreads,
+                    const double epsilon,
+                    const size_t singleBatchSize,
+                    const size_t referenceOffset)
+{
+  typedef NeighborSearch<SortPolicy, metric::EuclideanDistance, TreeType>
+      SearchType;
+
+  if (queries.Dimensionality() != referenceData.n_rows)
+  {
+    Log::Fatal << "StreamSearch(): the query points in '"
+        << queries.Filename() << "' have " << queries.Dimensionality()
+        << " dimensions, but the reference points have "
+        << referenceData.n_rows << "!" << std::endl;
+  }
+
+  // These keep their memory from block to block.
+  arma::mat block;
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  std::vector<size_t> oldFromNewQueries;
+
+  size_t points = 0;
+  size_t blocks = 0;
+  queries.Reset();
+  while (queries.NextBlock(block))
+  {
+    // The query tree rearranges the block, which is not needed afterwards.
+    TreeType* queryTree = NULL;
+    if (!singleMode)
+    {
+      Timer::Start("tree_building");
+      queryTree = new TreeType(block, oldFromNewQueries, leafSize);
+      Timer::Stop("tree_building");
+    }
+
+    SearchType search(&referenceTree, queryTree, referenceData, block,
+        singleMode);
+    search.NumThreads() = numThreads;
+    search.Epsilon() = epsilon;
+    search.SingleBatchSize() = singleBatchSize;
+    search.Search(k, neighbors, distances);
+
+    if (singleMode)
+    {
+      UnmapInPlace(neighbors, distances, oldFromNewReferences, false,
+          numThreads);
+    }
+    else
+    {
+      UnmapInPlace(neighbors, distances, oldFromNewReferences,
+          oldFromNewQueries, false, numThreads);
+      delete queryTree;
+    }
+
+    if (referenceOffset != 0)
+      neighbors += referenceOffset;
+
+    // One line for each query point, written by the same formatter as
+    // data::Save(), so no transposed copy of the results is needed.
+    if (!data::WriteText(neighborsOut, neighbors, true, true) ||
+        !data::WriteText(distancesOut, distances, true, true) ||
+        !neighborsOut.good() || !distancesOut.good())
+    {
+      Log::Fatal << "StreamSearch(): error writing the results of block "
+          << blocks << "." << std::endl;
+    }
+
+    points += block.n_cols;
+    ++blocks;
+    Log::Debug << "Searched " << points << " query points (" << blocks
+        << " blocks)." << std::endl;
+  }
+
+  return points;
+}
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
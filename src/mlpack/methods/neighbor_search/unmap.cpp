@@ -6,17 +6,22 @@
  */
 #include "unmap.hpp"
 
+#include <algorithm>
+
 namespace mlpack {
 namespace neighbor {
 
-// Useful in the dual-tree setting.
-void Unmap(const arma::Mat<size_t>& neighbors,
-           const arma::mat& distances,
-           const std::vector<size_t>& referenceMap,
-           const std::vector<size_t>& queryMap,
-           arma::Mat<size_t>& neighborsOut,
-           arma::mat& distancesOut,
-           const bool squareRoot)
+namespace {
+
+// The unmapping is the same for double and single-precision distances.
+template<typename MatType>
+void UnmapImpl(const arma::Mat<size_t>& neighbors,
+               const MatType& distances,
+               const std::vector<size_t>& referenceMap,
+               const std::vector<size_t>& queryMap,
+               arma::Mat<size_t>& neighborsOut,
+               MatType& distancesOut,
+               const bool squareRoot)
 {
   // Set matrices to correct size.
   neighborsOut.set_size(neighbors.n_rows, neighbors.n_cols);
@@ -38,13 +43,13 @@ void Unmap(const arma::Mat<size_t>& neighbors,
   }
 }
 
-// Useful in the single-tree setting.
-void Unmap(const arma::Mat<size_t>& neighbors,
-           const arma::mat& distances,
-           const std::vector<size_t>& referenceMap,
-           arma::Mat<size_t>& neighborsOut,
-           arma::mat& distancesOut,
-           const bool squareRoot)
+template<typename MatType>
+void UnmapImpl(const arma::Mat<size_t>& neighbors,
+               const MatType& distances,
+               const std::vector<size_t>& referenceMap,
+               arma::Mat<size_t>& neighborsOut,
+               MatType& distancesOut,
+               const bool squareRoot)
 {
   // Set matrices to correct size.
   neighborsOut.set_size(neighbors.n_rows, neighbors.n_cols);
@@ -60,5 +65,203 @@ void Unmap(const arma::Mat<size_t>& neighbors,
     neighborsOut[j] = referenceMap[neighbors[j]];
 }
 
+// Map the neighbor indices and take the square roots of the distances; each
+// column is independent.
+template<typename MatType>
+void MapEntries(arma::Mat<size_t>& neighbors,
+                MatType& distances,
+                const std::vector<size_t>& referenceMap,
+                const bool squareRoot,
+                const size_t threads)
+{
+  typedef typename MatType::elem_type ElemType;
+
+  #pragma omp parallel for schedule(static) num_threads(threads) \
+      if(threads > 1)
+  for (size_t i = 0; i < neighbors.n_cols; ++i)
+  {
+    size_t* neighborCol = neighbors.colptr(i);
+    for (size_t j = 0; j < neighbors.n_rows; ++j)
+      if (neighborCol[j] < referenceMap.size())
+        neighborCol[j] = referenceMap[neighborCol[j]];
+
+    if (squareRoot)
+    {
+      ElemType* distanceCol = distances.colptr(i);
+      for (size_t j = 0; j < distances.n_rows; ++j)
+        distanceCol[j] = std::sqrt(distanceCol[j]);
+    }
+  }
+}
+
+// Move column i of both matrices to column queryMap[i], following the cycles
+// of the permutation.  The cycles hold disjoint sets of columns, so they are
+// moved in parallel.
+template<typename MatType>
+void PermuteColumns(arma::Mat<size_t>& neighbors,
+                    MatType& distances,
+                    const std::vector<size_t>& queryMap,
+                    const size_t threads)
+{
+  typedef typename MatType::elem_type ElemType;
+
+  Log::Assert(queryMap.size() == neighbors.n_cols);
+
+  // Find one column of each cycle longer than one column.
+  std::vector<size_t> cycleStarts;
+  std::vector<char> visited(queryMap.size(), 0);
+  for (size_t i = 0; i < queryMap.size(); ++i)
+  {
+    if (visited[i])
+      continue;
+
+    if (queryMap[i] != i)
+      cycleStarts.push_back(i);
+    for (size_t j = i; !visited[j]; j = queryMap[j])
+      visited[j] = 1;
+  }
+
+  const size_t k = neighbors.n_rows;
+  #pragma omp parallel num_threads(threads) if(threads > 1)
+  {
+    // The column being moved along the cycle.
+    std::vector<size_t> neighborColumn(k);
+    std::vector<ElemType> distanceColumn(k);
+
+    #pragma omp for schedule(dynamic)
+    for (size_t c = 0; c < cycleStarts.size(); ++c)
+    {
+      const size_t start = cycleStarts[c];
+      std::copy(neighbors.colptr(start), neighbors.colptr(start) + k,
+          neighborColumn.begin());
+      std::copy(distances.colptr(start), distances.colptr(start) + k,
+          distanceColumn.begin());
+
+      // Each step puts the column in hand into its place, and picks up the
+      // column that was there; the last step puts a column into the first
+      // place.
+      size_t current = start;
+      do
+      {
+        current = queryMap[current];
+        std::swap_ranges(neighborColumn.begin(), neighborColumn.end(),
+            neighbors.colptr(current));
+        std::swap_ranges(distanceColumn.begin(), distanceColumn.end(),
+            distances.colptr(current));
+      } while (current != start);
+    }
+  }
+}
+
+template<typename MatType>
+void UnmapInPlaceImpl(arma::Mat<size_t>& neighbors,
+                      MatType& distances,
+                      const std::vector<size_t>& referenceMap,
+                      const std::vector<size_t>* queryMap,
+                      const bool squareRoot,
+                      const size_t numThreads)
+{
+  Log::Assert(neighbors.n_rows == distances.n_rows &&
+      neighbors.n_cols == distances.n_cols);
+
+  const size_t threads = util::NumThreads(numThreads);
+  MapEntries(neighbors, distances, referenceMap, squareRoot, threads);
+  if (queryMap)
+    PermuteColumns(neighbors, distances, *queryMap, threads);
+}
+
+} // anonymous namespace
+
+// Useful in the dual-tree setting.
+void Unmap(const arma::Mat<size_t>& neighbors,
+           const arma::mat& distances,
+           const std::vector<size_t>& referenceMap,
+           const std::vector<size_t>& queryMap,
+           arma::Mat<size_t>& neighborsOut,
+           arma::mat& distancesOut,
+           const bool squareRoot)
+{
+  UnmapImpl(neighbors, distances, referenceMap, queryMap, neighborsOut,
+      distancesOut, squareRoot);
+}
+
+void Unmap(const arma::Mat<size_t>& neighbors,
+           const arma::fmat& distances,
+           const std::vector<size_t>& referenceMap,
+           const std::vector<size_t>& queryMap,
+           arma::Mat<size_t>& neighborsOut,
+           arma::fmat& distancesOut,
+           const bool squareRoot)
+{
+  UnmapImpl(neighbors, distances, referenceMap, queryMap, neighborsOut,
+      distancesOut, squareRoot);
+}
+
+// Useful in the single-tree setting.
+void Unmap(const arma::Mat<size_t>& neighbors,
+           const arma::mat& distances,
+           const std::vector<size_t>& referenceMap,
+           arma::Mat<size_t>& neighborsOut,
+           arma::mat& distancesOut,
+           const bool squareRoot)
+{
+  UnmapImpl(neighbors, distances, referenceMap, neighborsOut, distancesOut,
+      squareRoot);
+}
+
+void Unmap(const arma::Mat<size_t>& neighbors,
+           const arma::fmat& distances,
+           const std::vector<size_t>& referenceMap,
+           arma::Mat<size_t>& neighborsOut,
+           arma::fmat& distancesOut,
+           const bool squareRoot)
+{
+  UnmapImpl(neighbors, distances, referenceMap, neighborsOut, distancesOut,
+      squareRoot);
+}
+
+// Unmapping in place.
+void UnmapInPlace(arma::Mat<size_t>& neighbors,
+                  arma::mat& distances,
+                  const std::vector<size_t>& referenceMap,
+                  const std::vector<size_t>& queryMap,
+                  const bool squareRoot,
+                  const size_t numThreads)
+{
+  UnmapInPlaceImpl(neighbors, distances, referenceMap, &queryMap, squareRoot,
+      numThreads);
+}
+
+void UnmapInPlace(arma::Mat<size_t>& neighbors,
+                  arma::fmat& distances,
+                  const std::vector<size_t>& referenceMap,
+                  const std::vector<size_t>& queryMap,
+                  const bool squareRoot,
+                  const size_t numThreads)
+{
+  UnmapInPlaceImpl(neighbors, distances, referenceMap, &queryMap, squareRoot,
+      numThreads);
+}
+
+void UnmapInPlace(arma::Mat<size_t>& neighbors,
+                  arma::mat& distances,
+                  const std::vector<size_t>& referenceMap,
+                  const bool squareRoot,
+                  const size_t numThreads)
+{
+  UnmapInPlaceImpl(neighbors, distances, referenceMap,
+      (const std::vector<size_t>*) NULL, squareRoot, numThreads);
+}
+
+void UnmapInPlace(arma::Mat<size_t>& neighbors,
+                  arma::fmat& distances,
+                  const std::vector<size_t>& referenceMap,
+                  const bool squareRoot,
+                  const size_t numThreads)
+{
+  UnmapInPlaceImpl(neighbors, distances, referenceMap,
+      (const std::vector<size_t>*) NULL, squareRoot, numThreads);
+}
+
 }; // namespace neighbor
 }; // namespace mlpack
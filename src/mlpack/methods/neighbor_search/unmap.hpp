@@ -35,6 +35,15 @@ void Unmap(const arma::Mat<size_t>& neighbors,
            arma::mat& distancesOut,
            const bool squareRoot = false);
 
+//! The same, for single-precision distances.
+void Unmap(const arma::Mat<size_t>& neighbors,
+           const arma::fmat& distances,
+           const std::vector<size_t>& referenceMap,
+           const std::vector<size_t>& queryMap,
+           arma::Mat<size_t>& neighborsOut,
+           arma::fmat& distancesOut,
+           const bool squareRoot = false);
+
 /**
  * Assuming that the datasets have been mapped using referenceMap (such as
  * during kd-tree construction), unmap the columns of the distances and
@@ -55,6 +64,73 @@ void Unmap(const arma::Mat<size_t>& neighbors,
            arma::mat& distancesOut,
            const bool squareRoot = false);
 
+//! The same, for single-precision distances.
+void Unmap(const arma::Mat<size_t>& neighbors,
+           const arma::fmat& distances,
+           const std::vector<size_t>& referenceMap,
+           arma::Mat<size_t>& neighborsOut,
+           arma::fmat& distancesOut,
+           const bool squareRoot = false);
+
+/**
+ * Unmap the results of a neighbor search in place, without the second copy of
+ * the results that the other overloads need: the entries of neighbors are
+ * mapped with referenceMap, and the columns of both matrices are moved to the
+ * places given by queryMap (column i is moved to column queryMap[i]).  The
+ * columns are moved along the cycles of the permutation; the mapping of the
+ * entries and the cycles are spread over numThreads threads (0 means all
+ * available threads).  Neighbor indices which are not valid indices of
+ * referenceMap (missing neighbors) are left as they are.
+ *
+ * @param neighbors Matrix of neighbors resulting from neighbor search; it is
+ *     unmapped in place.
+ * @param distances Matrix of distances resulting from neighbor search; it is
+ *     unmapped in place.
+ * @param referenceMap Mapping of reference set to old points.
+ * @param queryMap Mapping of query set to old points.
+ * @param squareRoot If true, take the square root of the distances.
+ * @param numThreads Number of threads to use.
+ */
+void UnmapInPlace(arma::Mat<size_t>& neighbors,
+                  arma::mat& distances,
+                  const std::vector<size_t>& referenceMap,
+                  const std::vector<size_t>& queryMap,
+                  const bool squareRoot = false,
+                  const size_t numThreads = 1);
+
+//! The same, for single-precision distances.
+void UnmapInPlace(arma::Mat<size_t>& neighbors,
+                  arma::fmat& distances,
+                  const std::vector<size_t>& referenceMap,
+                  const std::vector<size_t>& queryMap,
+                  const bool squareRoot = false,
+                  const size_t numThreads = 1);
+
+/**
+ * Unmap the results of a single-tree neighbor search in place: only the
+ * entries of neighbors are mapped with referenceMap (and the square root of
+ * the distances is taken, if requested), so the columns stay where they are.
+ *
+ * @param neighbors Matrix of neighbors resulting from neighbor search; it is
+ *     unmapped in place.
+ * @param distances Matrix of distances resulting from neighbor search.
+ * @param referenceMap Mapping of reference set to old points.
+ * @param squareRoot If true, take the square root of the distances.
+ * @param numThreads Number of threads to use.
+ */
+void UnmapInPlace(arma::Mat<size_t>& neighbors,
+                  arma::mat& distances,
+                  const std::vector<size_t>& referenceMap,
+                  const bool squareRoot = false,
+                  const size_t numThreads = 1);
+
+//! The same, for single-precision distances.
+void UnmapInPlace(arma::Mat<size_t>& neighbors,
+                  arma::fmat& distances,
+                  const std::vector<size_t>& referenceMap,
+                  const bool squareRoot = false,
+                  const size_t numThreads = 1);
+
 }; // namespace neighbor
 }; // namespace mlpack
 
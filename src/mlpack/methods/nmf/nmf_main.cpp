@@ -41,7 +41,13 @@ PROGRAM_INFO("Non-negative Matrix Factorization", "This program performs "
     "\n\n"
     "The maximum number of iterations is specified with --max_iterations, and "
     "the minimum residue required for algorithm termination is specified with "
-    "--min_residue.");
+    "--min_residue."
+    "\n\n"
+    "If --sparse (-z) is specified, the input dataset is a coordinate list: "
+    "each line holds the row index, the column index and the value of one "
+    "nonzero element of the (transposed) dataset, or it is a file in the "
+    "mlpack sparse matrix format.  The dataset is then factorized as a sparse "
+    "matrix, without ever being stored densely.");
 
 // Parameters for program.
 PARAM_STRING_REQ("input_file", "Input dataset to perform NMF on.", "i");
@@ -57,6 +63,53 @@ PARAM_DOUBLE("min_residue", "The minimum root mean square residue allowed for "
 
 PARAM_STRING("update_rules", "Update rules for each iteration; ( multdist | "
     "multdiv | als ).", "u", "multdist");
+PARAM_FLAG("sparse", "The input dataset is a sparse coordinate list (see "
+    "above).", "z");
+
+/**
+ * Perform NMF on the given dataset (dense or sparse) with the given update
+ * rules.
+ */
+template<typename MatType>
+void ApplyNMF(const MatType& V,
+              const string& updateRules,
+              const size_t r,
+              const size_t maxIterations,
+              const double minResidue,
+              arma::mat& W,
+              arma::mat& H)
+{
+  // Perform NMF with the specified update rules.
+  if (updateRules == "multdist")
+  {
+    Log::Info << "Performing NMF with multiplicative distance-based update "
+        << "rules." << std::endl;
+
+    SimpleResidueTermination srt(minResidue, maxIterations);
+    AMF<> amf(srt);
+    amf.Apply(V, r, W, H);
+  }
+  else if (updateRules == "multdiv")
+  {
+    Log::Info << "Performing NMF with multiplicative divergence-based update "
+        << "rules." << std::endl;
+    SimpleResidueTermination srt(minResidue, maxIterations);
+    AMF<SimpleResidueTermination,
+        RandomInitialization,
+        NMFMultiplicativeDivergenceUpdate> amf(srt);
+    amf.Apply(V, r, W, H);
+  }
+  else if (updateRules == "als")
+  {
+    Log::Info << "Performing NMF with alternating least squared update rules."
+        << std::endl;
+    SimpleResidueTermination srt(minResidue, maxIterations);
+    AMF<SimpleResidueTermination,
+        RandomInitialization,
+        NMFALSUpdate> amf(srt);
+    amf.Apply(V, r, W, H);
+  }
+}
 
 int main(int argc, char** argv)
 {
@@ -93,42 +146,21 @@ int main(int argc, char** argv)
         << "multdist', 'multdiv', or 'als'." << std::endl;
   }
 
-  // Load input dataset.
-  arma::mat V;
-  data::Load(inputFile, V, true);
-
   arma::mat W;
   arma::mat H;
 
-  // Perform NMF with the specified update rules.
-  if (updateRules == "multdist")
+  // Load input dataset, and factorize it.
+  if (CLI::HasParam("sparse"))
   {
-    Log::Info << "Performing NMF with multiplicative distance-based update "
-        << "rules." << std::endl;
-
-    SimpleResidueTermination srt(minResidue, maxIterations);
-    AMF<> amf(srt);
-    amf.Apply(V, r, W, H);
+    arma::sp_mat V;
+    data::Load(inputFile, V, true);
+    ApplyNMF(V, updateRules, r, maxIterations, minResidue, W, H);
   }
-  else if (updateRules == "multdiv")
-  {
-    Log::Info << "Performing NMF with multiplicative divergence-based update "
-        << "rules." << std::endl;
-    SimpleResidueTermination srt(minResidue, maxIterations);
-    AMF<SimpleResidueTermination, 
-        RandomInitialization, 
-        NMFMultiplicativeDivergenceUpdate> amf(srt);
-    amf.Apply(V, r, W, H);
-  }
-  else if (updateRules == "als")
+  else
   {
-    Log::Info << "Performing NMF with alternating least squared update rules."
-        << std::endl;
-    SimpleResidueTermination srt(minResidue, maxIterations);
-    AMF<SimpleResidueTermination,
-        RandomInitialization, 
-        NMFALSUpdate> amf(srt);
-    amf.Apply(V, r, W, H);
+    arma::mat V;
+    data::Load(inputFile, V, true);
+    ApplyNMF(V, updateRules, r, maxIterations, minResidue, W, H);
   }
 
   // Save results.
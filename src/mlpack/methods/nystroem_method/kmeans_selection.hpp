@@ -10,17 +10,23 @@
 
 #include <mlpack/core.hpp>
 #include <mlpack/methods/kmeans/kmeans.hpp>
+#include <mlpack/methods/kmeans/kmeans_parallel.hpp>
 
 namespace mlpack {
 namespace kernel {
 
 /**
- * Implementation of the kmeans sampling scheme.
+ * Implementation of the kmeans sampling scheme.  By default, the initial
+ * centroids are found with the k-means|| seeding (see kmeans::KMeansParallel),
+ * and both the seeding and the Lloyd iterations run in parallel if OpenMP is
+ * available.
  *
  * @tparam ClusteringType Type of clustering.
  * @tparam maxIterations Maximum number of iterations allowed before giving up.
  */
-template<typename ClusteringType = kmeans::KMeans<>, size_t maxIterations = 5>
+template<typename ClusteringType = kmeans::KMeans<metric::EuclideanDistance,
+             kmeans::KMeansParallel>,
+         size_t maxIterations = 5>
 class KMeansSelection
 {
  public:
@@ -0,0 +1,94 @@
+/**
+ * @file nystroem_approximation.hpp
+ *
+ * The factored Nystroem approximation of a kernel: the landmark points and the
+ * inverse square root of their kernel matrix, which can map any points.
+ */
+#ifndef __MLPACK_METHODS_NYSTROEM_METHOD_NYSTROEM_APPROXIMATION_HPP
+#define __MLPACK_METHODS_NYSTROEM_METHOD_NYSTROEM_APPROXIMATION_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kernel {
+
+/**
+ * The Nystroem approximation of a kernel with the given landmarks.  The kernel
+ * matrix W of the landmarks is computed, and its inverse square root (from
+ * its SVD) is kept, so that any points can later be mapped to the rows of
+ * G = C W^(-1/2), where C is the kernel matrix between the points and the
+ * landmarks; the kernel matrix of the points is approximated by G G^T.  The
+ * kernel matrices are computed in parallel, if OpenMP is available.
+ *
+ * @code
+ * // Fit the approximation on the training set...
+ * NystroemMethod<GaussianKernel> nm(data, kernel, 100);
+ * NystroemApproximation<GaussianKernel> approximation;
+ * nm.Factor(approximation);
+ *
+ * // ...and map new points with it, without computing W again.
+ * arma::mat features;
+ * approximation.Apply(newPoints, features);
+ * @endcode
+ */
+template<typename KernelType>
+class NystroemApproximation
+{
+ public:
+  //! Create an empty approximation; use Factor() to set the landmarks.
+  NystroemApproximation(KernelType kernel = KernelType());
+
+  /**
+   * Create the approximation with the given landmarks, computing the inverse
+   * square root of their kernel matrix.
+   *
+   * @param landmarks Landmark points (one per column).
+   * @param kernel Kernel to be used for computation.
+   */
+  NystroemApproximation(const arma::mat& landmarks,
+                        KernelType kernel = KernelType());
+
+  /**
+   * Set the landmarks and compute the inverse square root of their kernel
+   * matrix.
+   *
+   * @param landmarks Landmark points (one per column).
+   */
+  void Factor(const arma::mat& landmarks);
+
+  /**
+   * Map the given points with the approximation: each row of the output is
+   * the image of one point, so the kernel matrix of the points is
+   * approximated by output * output^T.
+   *
+   * @param points Points to map (one per column).
+   * @param output Matrix to store the mapped points in.
+   */
+  void Apply(const arma::mat& points, arma::mat& output) const;
+
+  //! Get the landmarks.
+  const arma::mat& Landmarks() const { return landmarks; }
+  //! Get the inverse square root of the kernel matrix of the landmarks.
+  const arma::mat& Normalization() const { return normalization; }
+
+  //! Get the kernel.
+  const KernelType& Kernel() const { return kernel; }
+  //! Modify the kernel (call Factor() again afterwards).
+  KernelType& Kernel() { return kernel; }
+
+ private:
+  //! The kernel.
+  KernelType kernel;
+  //! The landmark points.
+  arma::mat landmarks;
+  //! The inverse square root of the kernel matrix of the landmarks.
+  arma::mat normalization;
+};
+
+}; // namespace kernel
+}; // namespace mlpack
+
+// Include implementation.
+#include "nystroem_approximation_impl.hpp"
+
+#endif
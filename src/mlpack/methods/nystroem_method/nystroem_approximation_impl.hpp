@@ -0,0 +1,85 @@
+/**
+ * @file nystroem_approximation_impl.hpp
+ *
+ * Implementation of the factored Nystroem approximation.
+ */
+#ifndef __MLPACK_METHODS_NYSTROEM_METHOD_NYSTROEM_APPROXIMATION_IMPL_HPP
+#define __MLPACK_METHODS_NYSTROEM_METHOD_NYSTROEM_APPROXIMATION_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "nystroem_approximation.hpp"
+
+namespace mlpack {
+namespace kernel {
+
+template<typename KernelType>
+NystroemApproximation<KernelType>::NystroemApproximation(KernelType kernel) :
+    kernel(kernel)
+{ }
+
+template<typename KernelType>
+NystroemApproximation<KernelType>::NystroemApproximation(
+    const arma::mat& landmarks,
+    KernelType kernel) :
+    kernel(kernel)
+{
+  Factor(landmarks);
+}
+
+template<typename KernelType>
+void NystroemApproximation<KernelType>::Factor(const arma::mat& newLandmarks)
+{
+  landmarks = newLandmarks;
+  const size_t rank = landmarks.n_cols;
+
+  // Assemble the mini-kernel matrix; it is symmetric, so only the upper
+  // triangle is evaluated.
+  arma::mat miniKernel(rank, rank);
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t j = 0; j < rank; ++j)
+  {
+    for (size_t i = 0; i <= j; ++i)
+    {
+      const double value = kernel.Evaluate(landmarks.unsafe_col(i),
+                                           landmarks.unsafe_col(j));
+      miniKernel(i, j) = value;
+      miniKernel(j, i) = value;
+    }
+  }
+
+  // Singular value decomposition mini-kernel matrix.
+  arma::mat U, V;
+  arma::vec s;
+  arma::svd(U, s, V, miniKernel);
+
+  normalization = U * arma::diagmat(1.0 / sqrt(s)) * V;
+}
+
+template<typename KernelType>
+void NystroemApproximation<KernelType>::Apply(const arma::mat& points,
+                                              arma::mat& output) const
+{
+  if (points.n_rows != landmarks.n_rows)
+    Log::Fatal << "NystroemApproximation::Apply(): points have dimensionality "
+        << points.n_rows << ", but the landmarks have dimensionality "
+        << landmarks.n_rows << "!" << std::endl;
+
+  // Construct the semi-kernel matrix with interactions between the points and
+  // the landmarks (transposed, so each point fills one column).
+  static const size_t kernelAccount = MemoryUsage::Register("kernel_matrix");
+  ScopedMemory kernelMemory(kernelAccount,
+      landmarks.n_cols * points.n_cols * sizeof(double));
+  arma::mat semiKernel(landmarks.n_cols, points.n_cols);
+  #pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < points.n_cols; ++i)
+    for (size_t j = 0; j < landmarks.n_cols; ++j)
+      semiKernel(j, i) = kernel.Evaluate(points.unsafe_col(i),
+                                         landmarks.unsafe_col(j));
+
+  output = arma::trans(semiKernel) * normalization;
+}
+
+}; // namespace kernel
+}; // namespace mlpack
+
+#endif
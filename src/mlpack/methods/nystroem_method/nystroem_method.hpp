@@ -12,6 +12,7 @@
 
 #include <mlpack/core.hpp>
 #include "kmeans_selection.hpp"
+#include "nystroem_approximation.hpp"
 
 namespace mlpack {
 namespace kernel {
@@ -41,6 +42,15 @@ class NystroemMethod
    */
   void Apply(arma::mat& output);
 
+  /**
+   * Select the landmarks and compute the factored approximation, which can
+   * then map points other than the dataset without computing the kernel
+   * matrix of the landmarks again.
+   *
+   * @param approximation Object to store the approximation in.
+   */
+  void Factor(NystroemApproximation<KernelType>& approximation);
+
   /**
    * Construct the kernel matrix with matrix that contains the selected points.
    *
@@ -63,6 +73,22 @@ class NystroemMethod
                        arma::mat& miniKernel, 
                        arma::mat& semiKernel);
 
+  /**
+   * Get the landmarks from the matrix returned by the point selection policy,
+   * and delete it.
+   */
+  static void Landmarks(const arma::mat& data,
+                        const arma::mat* selectedData,
+                        arma::mat& landmarks);
+
+  /**
+   * Get the landmarks from the indices returned by the point selection
+   * policy.
+   */
+  static void Landmarks(const arma::mat& data,
+                        const arma::Col<size_t>& selectedPoints,
+                        arma::mat& landmarks);
+
  private:
   //! The reference dataset.
   const arma::mat& data;
@@ -31,6 +31,7 @@ void NystroemMethod<KernelType, PointSelectionPolicy>::GetKernelMatrix(
     arma::mat& semiKernel)
 {
   // Assemble mini-kernel matrix.
+  #pragma omp parallel for schedule(static)
   for (size_t i = 0; i < rank; ++i)
     for (size_t j = 0; j < rank; ++j)
       miniKernel(i, j) = kernel.Evaluate(selectedData->col(i),
@@ -38,6 +39,7 @@ void NystroemMethod<KernelType, PointSelectionPolicy>::GetKernelMatrix(
 
   // Construct semi-kernel matrix with interactions between selected data and
   // all points.
+  #pragma omp parallel for schedule(static)
   for (size_t i = 0; i < data.n_cols; ++i)
     for (size_t j = 0; j < rank; ++j)
       semiKernel(i, j) = kernel.Evaluate(data.col(i), 
@@ -53,6 +55,7 @@ void NystroemMethod<KernelType, PointSelectionPolicy>::GetKernelMatrix(
     arma::mat& semiKernel)
 {
   // Assemble mini-kernel matrix.
+  #pragma omp parallel for schedule(static)
   for (size_t i = 0; i < rank; ++i)
     for (size_t j = 0; j < rank; ++j)
       miniKernel(i, j) = kernel.Evaluate(data.col(selectedPoints(i)),
@@ -60,6 +63,7 @@ void NystroemMethod<KernelType, PointSelectionPolicy>::GetKernelMatrix(
 
   // Construct semi-kernel matrix with interactions between selected points and
   // all points.
+  #pragma omp parallel for schedule(static)
   for (size_t i = 0; i < data.n_cols; ++i)
     for (size_t j = 0; j < rank; ++j)
       semiKernel(i, j) = kernel.Evaluate(data.col(i),
@@ -67,22 +71,47 @@ void NystroemMethod<KernelType, PointSelectionPolicy>::GetKernelMatrix(
 }
 
 template<typename KernelType, typename PointSelectionPolicy>
-void NystroemMethod<KernelType, PointSelectionPolicy>::Apply(arma::mat& output)
+void NystroemMethod<KernelType, PointSelectionPolicy>::Landmarks(
+    const arma::mat& /* data */,
+    const arma::mat* selectedData,
+    arma::mat& landmarks)
+{
+  landmarks = *selectedData;
+
+  // Clean the memory.
+  delete selectedData;
+}
+
+template<typename KernelType, typename PointSelectionPolicy>
+void NystroemMethod<KernelType, PointSelectionPolicy>::Landmarks(
+    const arma::mat& data,
+    const arma::Col<size_t>& selectedPoints,
+    arma::mat& landmarks)
 {
-  arma::mat miniKernel(rank, rank);
-  arma::mat semiKernel(data.n_cols, rank);
+  landmarks.set_size(data.n_rows, selectedPoints.n_elem);
+  for (size_t i = 0; i < selectedPoints.n_elem; ++i)
+    landmarks.col(i) = data.col(selectedPoints[i]);
+}
 
-  GetKernelMatrix(PointSelectionPolicy::Select(data, rank), miniKernel,
-                  semiKernel);
+template<typename KernelType, typename PointSelectionPolicy>
+void NystroemMethod<KernelType, PointSelectionPolicy>::Factor(
+    NystroemApproximation<KernelType>& approximation)
+{
+  arma::mat landmarks;
+  Landmarks(data, PointSelectionPolicy::Select(data, rank), landmarks);
 
-  // Singular value decomposition mini-kernel matrix.
-  arma::mat U, V;
-  arma::vec s;
-  arma::svd(U, s, V, miniKernel);
+  approximation.Kernel() = kernel;
+  approximation.Factor(landmarks);
+}
+
+template<typename KernelType, typename PointSelectionPolicy>
+void NystroemMethod<KernelType, PointSelectionPolicy>::Apply(arma::mat& output)
+{
+  NystroemApproximation<KernelType> approximation(kernel);
+  Factor(approximation);
 
   // Construct the output matrix.
-  arma::mat normalization = arma::diagmat(1.0 / sqrt(s));
-  output = semiKernel * U * normalization * V;
+  approximation.Apply(data, output);
 }
 
 }; // namespace kernel
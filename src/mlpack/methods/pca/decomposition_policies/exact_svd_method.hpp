@@ -0,0 +1,67 @@
+/**
+ * @file exact_svd_method.hpp
+ *
+ * Implementation of the exact SVD policy for PCA.
+ */
+#ifndef __MLPACK_METHODS_PCA_DECOMPOSITION_POLICIES_EXACT_SVD_METHOD_HPP
+#define __MLPACK_METHODS_PCA_DECOMPOSITION_POLICIES_EXACT_SVD_METHOD_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace pca {
+
+/**
+ * Implementation of the exact SVD policy: the principal components are found
+ * with a full (or, with more points than dimensions, economical) singular
+ * value decomposition of the centered data.  The rank is ignored: all
+ * components are computed.
+ */
+class ExactSVDPolicy
+{
+ public:
+  /**
+   * Find the principal components of the given centered data.
+   *
+   * @param centeredData Centered data matrix.
+   * @param transformedData Matrix to put the projected data into.
+   * @param eigVal Vector to put the eigenvalues into.
+   * @param eigvec Matrix to put the eigenvectors (loadings) into.
+   * @param rank Number of components to compute (ignored).
+   */
+  void Apply(const arma::mat& centeredData,
+             arma::mat& transformedData,
+             arma::vec& eigVal,
+             arma::mat& eigvec,
+             const size_t /* rank */) const
+  {
+    // This matrix will store the right singular values; we do not need them.
+    arma::mat v;
+
+    // Do singular value decomposition.  Use the economical singular value
+    // decomposition if the columns are much larger than the rows.
+    if (centeredData.n_rows < centeredData.n_cols)
+    {
+      // Do economical singular value decomposition and compute only the left
+      // singular vectors.
+      arma::svd_econ(eigvec, eigVal, v, centeredData, 'l');
+    }
+    else
+    {
+      arma::svd(eigvec, eigVal, v, centeredData);
+    }
+
+    // Now we must square the singular values to get the eigenvalues.
+    // In addition we must divide by the number of points, because the
+    // covariance matrix is X * X' / (N - 1).
+    eigVal %= eigVal / (centeredData.n_cols - 1);
+
+    // Project the samples to the principals.
+    transformedData = arma::trans(eigvec) * centeredData;
+  }
+};
+
+}; // namespace pca
+}; // namespace mlpack
+
+#endif
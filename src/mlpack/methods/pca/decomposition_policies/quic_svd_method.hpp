@@ -0,0 +1,87 @@
+/**
+ * @file quic_svd_method.hpp
+ *
+ * Implementation of the QUIC-SVD policy for PCA.
+ */
+#ifndef __MLPACK_METHODS_PCA_DECOMPOSITION_POLICIES_QUIC_SVD_METHOD_HPP
+#define __MLPACK_METHODS_PCA_DECOMPOSITION_POLICIES_QUIC_SVD_METHOD_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/methods/quic_svd/quic_svd.hpp>
+
+namespace mlpack {
+namespace pca {
+
+/**
+ * Implementation of the QUIC-SVD policy: the principal components are found
+ * with svd::QUIC_SVD, in a subspace whose size is chosen by the relative error
+ * tolerance.  At most the requested number of components are kept.
+ */
+class QUICSVDPolicy
+{
+ public:
+  /**
+   * Create the policy.
+   *
+   * @param epsilon Error tolerance fraction for the calculated subspace.
+   * @param delta Cumulative probability for the Monte Carlo error lower bound.
+   */
+  QUICSVDPolicy(const double epsilon = 0.03, const double delta = 0.1) :
+      epsilon(epsilon),
+      delta(delta)
+  {
+    // Nothing to do.
+  }
+
+  /**
+   * Find the principal components of the given centered data.
+   *
+   * @param centeredData Centered data matrix.
+   * @param transformedData Matrix to put the projected data into.
+   * @param eigVal Vector to put the eigenvalues into.
+   * @param eigvec Matrix to put the eigenvectors (loadings) into.
+   * @param rank Maximum number of components to keep.
+   */
+  void Apply(const arma::mat& centeredData,
+             arma::mat& transformedData,
+             arma::vec& eigVal,
+             arma::mat& eigvec,
+             const size_t rank) const
+  {
+    arma::mat v, sigma;
+    svd::QUIC_SVD quicsvd(centeredData, eigvec, v, sigma, epsilon, delta);
+
+    // The covariance matrix is X * X' / (N - 1).
+    eigVal = arma::square(sigma.diag()) / (centeredData.n_cols - 1);
+
+    if (rank > 0 && rank < eigVal.n_elem)
+    {
+      eigVal = eigVal.subvec(0, rank - 1);
+      eigvec = eigvec.cols(0, rank - 1);
+    }
+
+    // Project the samples to the principals.
+    transformedData = arma::trans(eigvec) * centeredData;
+  }
+
+  //! Get the error tolerance fraction.
+  double Epsilon() const { return epsilon; }
+  //! Modify the error tolerance fraction.
+  double& Epsilon() { return epsilon; }
+
+  //! Get the cumulative probability for the Monte Carlo error lower bound.
+  double Delta() const { return delta; }
+  //! Modify the cumulative probability for the Monte Carlo error lower bound.
+  double& Delta() { return delta; }
+
+ private:
+  //! Error tolerance fraction for the calculated subspace.
+  double epsilon;
+  //! Cumulative probability for the Monte Carlo error lower bound.
+  double delta;
+};
+
+}; // namespace pca
+}; // namespace mlpack
+
+#endif
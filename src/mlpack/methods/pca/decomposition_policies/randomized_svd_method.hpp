@@ -0,0 +1,75 @@
+/**
+ * @file randomized_svd_method.hpp
+ *
+ * Implementation of the randomized SVD policy for PCA.
+ */
+#ifndef __MLPACK_METHODS_PCA_DECOMPOSITION_POLICIES_RANDOMIZED_SVD_METHOD_HPP
+#define __MLPACK_METHODS_PCA_DECOMPOSITION_POLICIES_RANDOMIZED_SVD_METHOD_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/methods/randomized_svd/randomized_svd.hpp>
+
+namespace mlpack {
+namespace pca {
+
+/**
+ * Implementation of the randomized SVD policy: only the requested number of
+ * principal components are computed, with svd::RandomizedSVD, in
+ * O(d N rank) time for d dimensions and N points.
+ */
+class RandomizedSVDPolicy
+{
+ public:
+  /**
+   * Create the policy.
+   *
+   * @param iteratedPower Number of power iterations.
+   * @param oversampling Number of columns of the random matrix beyond the rank.
+   */
+  RandomizedSVDPolicy(const size_t iteratedPower = 2,
+                      const size_t oversampling = 10) :
+      rsvd(iteratedPower, oversampling)
+  {
+    // Nothing to do.
+  }
+
+  /**
+   * Find the given number of principal components of the given centered data.
+   *
+   * @param centeredData Centered data matrix.
+   * @param transformedData Matrix to put the projected data into.
+   * @param eigVal Vector to put the eigenvalues into.
+   * @param eigvec Matrix to put the eigenvectors (loadings) into.
+   * @param rank Number of components to compute.
+   */
+  void Apply(const arma::mat& centeredData,
+             arma::mat& transformedData,
+             arma::vec& eigVal,
+             arma::mat& eigvec,
+             const size_t rank) const
+  {
+    arma::mat v;
+    rsvd.Apply(centeredData, eigvec, eigVal, v, std::min(rank,
+        (size_t) std::min(centeredData.n_rows, centeredData.n_cols)));
+
+    // The covariance matrix is X * X' / (N - 1).
+    eigVal %= eigVal / (centeredData.n_cols - 1);
+
+    // Project the samples to the principals.
+    transformedData = arma::trans(eigvec) * centeredData;
+  }
+
+  //! Get the randomized SVD object.
+  const svd::RandomizedSVD& RSVD() const { return rsvd; }
+  //! Modify the randomized SVD object.
+  svd::RandomizedSVD& RSVD() { return rsvd; }
+
+ private:
+  //! The randomized SVD object.
+  svd::RandomizedSVD rsvd;
+};
+
+}; // namespace pca
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,189 @@
+/**
+ * @file incremental_pca.cpp
+ *
+ * Implementation of the IncrementalPCA class.
+ */
+#include "incremental_pca.hpp"
+
+using namespace mlpack;
+using namespace mlpack::pca;
+
+IncrementalPCA::IncrementalPCA(const size_t rank, const bool scaleData) :
+    rank(rank),
+    scaleData(scaleData),
+    points(0),
+    sumSquares(0.0)
+{
+  if (rank == 0)
+    Log::Fatal << "IncrementalPCA::IncrementalPCA(): rank cannot be zero!"
+        << std::endl;
+}
+
+void IncrementalPCA::Fit(data::StreamingReader& reader)
+{
+  points = 0;
+  mean.reset();
+  components.reset();
+  singularValues.reset();
+  sumSquares = 0.0;
+  stdDev.reset();
+
+  arma::mat block;
+  if (scaleData)
+  {
+    // First find the standard deviation of each dimension, merging the
+    // statistics of each block (Chan et al.) for numerical stability.
+    reader.Reset();
+    size_t n = 0;
+    arma::vec runningMean = arma::zeros<arma::vec>(reader.Dimensionality());
+    arma::vec squares = arma::zeros<arma::vec>(reader.Dimensionality());
+    while (reader.NextBlock(block))
+    {
+      const double m = (double) block.n_cols;
+      const arma::vec blockMean = arma::mean(block, 1);
+      block.each_col() -= blockMean;
+
+      const arma::vec delta = blockMean - runningMean;
+      squares += arma::sum(arma::square(block), 1) + arma::square(delta) *
+          (n * m / (n + m));
+      runningMean += delta * (m / (n + m));
+      n += block.n_cols;
+    }
+
+    if (n > 1)
+    {
+      stdDev = arma::sqrt(squares / (n - 1));
+
+      // If there are any zeroes, make them very small.
+      for (size_t i = 0; i < stdDev.n_elem; ++i)
+        if (stdDev[i] == 0)
+          stdDev[i] = 1e-50;
+    }
+  }
+
+  reader.Reset();
+  while (reader.NextBlock(block))
+    Update(block);
+
+  Log::Info << "IncrementalPCA::Fit(): " << points << " points in '"
+      << reader.Filename() << "'." << std::endl;
+}
+
+void IncrementalPCA::Update(const arma::mat& block)
+{
+  if (block.n_cols == 0)
+    return;
+
+  if (points > 0 && block.n_rows != mean.n_elem)
+    Log::Fatal << "IncrementalPCA::Update(): points have dimensionality "
+        << block.n_rows << ", but the model has dimensionality " << mean.n_elem
+        << "!" << std::endl;
+
+  // Scale and center the block.
+  arma::mat centeredBlock = block;
+  if (scaleData && !stdDev.is_empty())
+    centeredBlock.each_col() /= stdDev;
+  const arma::vec blockMean = arma::mean(centeredBlock, 1);
+  centeredBlock.each_col() -= blockMean;
+
+  if (points == 0)
+    mean = arma::zeros<arma::vec>(block.n_rows);
+
+  // The scatter of the merged points is that of the current approximation,
+  // plus that of the block, plus a term for the difference of the means; so
+  // its square root is found from the thin SVD of this matrix.
+  const double n = (double) points;
+  const double m = (double) block.n_cols;
+  const arma::vec meanShift = blockMean - mean;
+  const double shiftScale = std::sqrt(n * m / (n + m));
+
+  arma::mat merged(block.n_rows, components.n_cols + block.n_cols + 1);
+  if (components.n_cols > 0)
+  {
+    merged.cols(0, components.n_cols - 1) = components *
+        arma::diagmat(singularValues);
+  }
+  merged.cols(components.n_cols, components.n_cols + block.n_cols - 1) =
+      centeredBlock;
+  merged.col(merged.n_cols - 1) = shiftScale * meanShift;
+
+  arma::mat u, v;
+  arma::vec s;
+  arma::svd_econ(u, s, v, merged, 'l');
+
+  const size_t keep = std::min(rank, (size_t) s.n_elem);
+  components = u.cols(0, keep - 1);
+  singularValues = s.subvec(0, keep - 1);
+
+  sumSquares += arma::accu(arma::square(centeredBlock)) +
+      std::pow(shiftScale, 2.0) * arma::dot(meanShift, meanShift);
+  mean += (m / (n + m)) * meanShift;
+  points += block.n_cols;
+}
+
+void IncrementalPCA::Transform(const arma::mat& data,
+                               arma::mat& transformedData) const
+{
+  if (points == 0)
+    Log::Fatal << "IncrementalPCA::Transform(): no points have been seen!"
+        << std::endl;
+  if (data.n_rows != mean.n_elem)
+    Log::Fatal << "IncrementalPCA::Transform(): points have dimensionality "
+        << data.n_rows << ", but the model has dimensionality " << mean.n_elem
+        << "!" << std::endl;
+
+  arma::mat centeredData = data;
+  if (scaleData && !stdDev.is_empty())
+    centeredData.each_col() /= stdDev;
+  centeredData.each_col() -= mean;
+
+  transformedData = arma::trans(components) * centeredData;
+}
+
+void IncrementalPCA::Transform(data::StreamingReader& reader,
+                               const std::string& outputFile) const
+{
+  std::ofstream output(outputFile.c_str());
+  if (!output.is_open())
+    Log::Fatal << "IncrementalPCA::Transform(): could not open '" << outputFile
+        << "' for writing." << std::endl;
+
+  reader.Reset();
+  // save() is only defined on matrices, so each block is transposed into a
+  // buffer first (one point per row, as data::Save() writes).
+  arma::mat block, transformedBlock, outputBlock;
+  while (reader.NextBlock(block))
+  {
+    Transform(block, transformedBlock);
+    outputBlock = arma::trans(transformedBlock);
+    if (!outputBlock.save(output, arma::csv_ascii))
+      Log::Fatal << "IncrementalPCA::Transform(): error writing to '"
+          << outputFile << "'." << std::endl;
+  }
+}
+
+arma::vec IncrementalPCA::EigenValues() const
+{
+  // The covariance matrix is X * X' / (N - 1).
+  if (points < 2)
+    return arma::zeros<arma::vec>(singularValues.n_elem);
+  return arma::square(singularValues) / (points - 1);
+}
+
+double IncrementalPCA::VarianceRetained() const
+{
+  if (sumSquares == 0.0)
+    return 1.0;
+  return arma::accu(arma::square(singularValues)) / sumSquares;
+}
+
+std::string IncrementalPCA::ToString() const
+{
+  std::ostringstream convert;
+  convert << "IncrementalPCA [" << this << "]" << std::endl;
+  convert << "  Rank: " << rank << std::endl;
+  if (scaleData)
+    convert << "  Scaling Data: TRUE" << std::endl;
+  convert << "  Points: " << points << std::endl;
+  return convert.str();
+}
@@ -0,0 +1,132 @@
+/**
+ * @file incremental_pca.hpp
+ *
+ * Defines the IncrementalPCA class, which performs principal components
+ * analysis on a dataset one block of points at a time.
+ */
+#ifndef __MLPACK_METHODS_PCA_INCREMENTAL_PCA_HPP
+#define __MLPACK_METHODS_PCA_INCREMENTAL_PCA_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace pca {
+
+/**
+ * This class performs incremental principal components analysis: the
+ * principal components are updated with each block of points, so the dataset
+ * never has to be in memory at once, and can be read from a file with a
+ * data::StreamingReader.  Only the running mean of the points and a rank-k
+ * approximation of the centered data (its k largest singular values and left
+ * singular vectors) are kept.  Each block of m points is merged into the
+ * approximation with a thin SVD of a d x (k + m + 1) matrix, which accounts
+ * for the shift of the mean (Ross et al., "Incremental learning for robust
+ * visual tracking", 2008).  When the data has rank at most k, the result is
+ * that of PCA; otherwise the smaller components are approximated.
+ *
+ * The data may also be scaled so that the variance of each dimension is 1;
+ * since the standard deviations must be known before the first block is
+ * merged, this takes an extra pass over the data (see Fit()).
+ *
+ * @code
+ * // Find the 10 largest principal components of a dataset which does not fit
+ * // in memory, and project the dataset onto them.
+ * IncrementalPCA p(10);
+ * data::StreamingReader reader("dataset.csv", 10000);
+ * p.Fit(reader);
+ * p.Transform(reader, "transformed.csv");
+ * @endcode
+ */
+class IncrementalPCA
+{
+ public:
+  /**
+   * Create the IncrementalPCA object, with no points.
+   *
+   * @param rank Number of principal components to keep.
+   * @param scaleData Whether or not to scale the data.
+   */
+  IncrementalPCA(const size_t rank, const bool scaleData = false);
+
+  /**
+   * Find the principal components of the points read by the given reader
+   * (which is reset first), forgetting any points given before.  If the data
+   * is scaled, this takes two passes over the data.
+   *
+   * @param reader Reader of the points.
+   */
+  void Fit(data::StreamingReader& reader);
+
+  /**
+   * Update the principal components with the given block of points.  If the
+   * data is scaled, the points are scaled with the standard deviations found
+   * by the last call to Fit().
+   *
+   * @param block Block of points (one per column).
+   */
+  void Update(const arma::mat& block);
+
+  /**
+   * Project the given points onto the principal components.  It is safe to
+   * pass the same matrix reference for both data and transformedData.
+   *
+   * @param data Points to project.
+   * @param transformedData Matrix to store the projected points in.
+   */
+  void Transform(const arma::mat& data, arma::mat& transformedData) const;
+
+  /**
+   * Project each block of points read by the given reader (which is reset
+   * first) onto the principal components, and write the projected points to
+   * the given file as CSV, one point per line, block by block.
+   *
+   * @param reader Reader of the points.
+   * @param outputFile File to write the projected points to.
+   */
+  void Transform(data::StreamingReader& reader,
+                 const std::string& outputFile) const;
+
+  //! Get the number of principal components kept.
+  size_t Rank() const { return rank; }
+  //! Get whether or not the data is scaled.
+  bool ScaleData() const { return scaleData; }
+
+  //! Get the number of points seen.
+  size_t Points() const { return points; }
+  //! Get the mean of the points seen.
+  const arma::vec& Mean() const { return mean; }
+  //! Get the principal components (one per column).
+  const arma::mat& Components() const { return components; }
+  //! Get the eigenvalues of the principal components, in decreasing order.
+  arma::vec EigenValues() const;
+  //! Get the fraction (between 0 and 1) of the variance of the data retained
+  //! by the principal components.
+  double VarianceRetained() const;
+
+  // Returns a string representation of this object.
+  std::string ToString() const;
+
+ private:
+  //! Number of principal components to keep.
+  size_t rank;
+  //! Whether or not the data is scaled by standard deviation.
+  bool scaleData;
+  //! Standard deviation of each dimension (if the data is scaled).
+  arma::vec stdDev;
+
+  //! Number of points seen.
+  size_t points;
+  //! Mean of the points seen.
+  arma::vec mean;
+  //! The principal components.
+  arma::mat components;
+  //! Singular values of the centered points, for each principal component.
+  arma::vec singularValues;
+  //! Sum of squared distances (after scaling) of the points to their mean.
+  double sumSquares;
+};
+
+}; // namespace pca
+}; // namespace mlpack
+
+#endif
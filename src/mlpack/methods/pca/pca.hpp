@@ -9,6 +9,9 @@
 #define __MLPACK_METHODS_PCA_PCA_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/methods/pca/decomposition_policies/exact_svd_method.hpp>
+#include <mlpack/methods/pca/decomposition_policies/randomized_svd_method.hpp>
+#include <mlpack/methods/pca/decomposition_policies/quic_svd_method.hpp>
 
 namespace mlpack {
 namespace pca {
@@ -19,8 +22,25 @@ namespace pca {
  * or transforming data into a better basis.  Further information on PCA can be
  * found in almost any statistics or machine learning textbook, and all over the
  * internet.
+ *
+ * The principal components are found with the given DecompositionPolicy:
+ * ExactSVDPolicy (the default) computes all of them; RandomizedSVDPolicy and
+ * QUICSVDPolicy compute only (about) as many as are kept, which is much faster
+ * when the new dimension is much smaller than the dimensionality of the data.
+ * The PCA typedef uses ExactSVDPolicy.
+ *
+ * @code
+ * arma::mat data; // 5000-dimensional data.
+ *
+ * // Reduce to 10 dimensions with a randomized SVD.
+ * PCAType<RandomizedSVDPolicy> p;
+ * p.Apply(data, 10);
+ * @endcode
+ *
+ * @tparam DecompositionPolicy Method used to find the principal components.
  */
-class PCA
+template<typename DecompositionPolicy = ExactSVDPolicy>
+class PCAType
 {
  public:
   /**
@@ -28,8 +48,10 @@ class PCA
    * dimension by standard deviation when PCA is performed.
    *
    * @param scaleData Whether or not to scale the data.
+   * @param decomposition Object which finds the principal components.
    */
-  PCA(const bool scaleData = false);
+  PCAType(const bool scaleData = false,
+          const DecompositionPolicy& decomposition = DecompositionPolicy());
 
   /**
    * Apply Principal Component Analysis to the provided data set.  It is safe to
@@ -100,17 +122,41 @@ class PCA
   //! the data when PCA is performed.
   bool& ScaleData() { return scaleData; }
 
+  //! Get the decomposition policy.
+  const DecompositionPolicy& Decomposition() const { return decomposition; }
+  //! Modify the decomposition policy.
+  DecompositionPolicy& Decomposition() { return decomposition; }
+
   // Returns a string representation of this object. 
   std::string ToString() const;
 
  private:
+  /**
+   * Center (and possibly scale) the data, find the (given number of)
+   * principal components, and project the data onto them; return the total
+   * variance of the data (the sum of all the eigenvalues).
+   */
+  double Apply(const arma::mat& data,
+               arma::mat& transformedData,
+               arma::vec& eigVal,
+               arma::mat& eigvec,
+               const size_t rank) const;
+
   //! Whether or not the data will be scaled by standard deviation when PCA is
   //! performed.
   bool scaleData;
+  //! The object which finds the principal components.
+  DecompositionPolicy decomposition;
 
-}; // class PCA
+}; // class PCAType
+
+//! PCA with an exact SVD.
+typedef PCAType<ExactSVDPolicy> PCA;
 
 }; // namespace pca
 }; // namespace mlpack
 
+// Include implementation.
+#include "pca_impl.hpp"
+
 #endif
@@ -7,6 +7,7 @@
 #include <mlpack/core.hpp>
 
 #include "pca.hpp"
+#include "incremental_pca.hpp"
 
 using namespace mlpack;
 using namespace mlpack::pca;
@@ -17,7 +18,21 @@ PROGRAM_INFO("Principal Components Analysis", "This program performs principal "
     "components analysis on the given dataset.  It will transform the data "
     "onto its principal components, optionally performing dimensionality "
     "reduction by ignoring the principal components with the smallest "
-    "eigenvalues.");
+    "eigenvalues."
+    "\n\n"
+    "By default, the principal components are found with an exact singular "
+    "value decomposition.  When the new dimensionality is much smaller than "
+    "the dimensionality of the data, a randomized SVD ('randomized') or "
+    "QUIC-SVD ('quic') is much faster; specify it with --decomposition_method."
+    "  With those methods only the kept components are computed, except when "
+    "--var_to_retain is given."
+    "\n\n"
+    "If --incremental is given, the dataset is never loaded into memory: it is "
+    "read in blocks of --batch_size points to find the principal components "
+    "incrementally, then read again to project it, and the projected points "
+    "are written to --output_file (as CSV) block by block.  --var_to_retain "
+    "and --decomposition_method are not supported in that mode, and "
+    "--new_dimensionality must be given.");
 
 // Parameters for program.
 PARAM_STRING_REQ("input_file", "Input dataset to perform PCA on.", "i");
@@ -27,16 +42,88 @@ PARAM_INT("new_dimensionality", "Desired dimensionality of output dataset.  If "
 PARAM_DOUBLE("var_to_retain", "Amount of variance to retain; should be between "
     "0 and 1.  If 1, all variance is retained.  Overrides -d.", "V", 0);
 
+PARAM_STRING("decomposition_method", "Method used to find the principal "
+    "components: 'exact', 'randomized', or 'quic'.", "c", "exact");
+
+PARAM_FLAG("incremental", "If set, the dataset will be read and transformed "
+    "in blocks, with incremental PCA.", "I");
+PARAM_INT("batch_size", "Number of points read at a time, with --incremental.",
+    "b", 10000);
+
 PARAM_FLAG("scale", "If set, the data will be scaled before running PCA, such "
     "that the variance of each feature is 1.", "s");
 
+//! Run PCA on the given dataset with the given decomposition policy.
+template<typename DecompositionPolicy>
+void RunPCA(arma::mat& dataset, const size_t newDimension, const bool scale)
+{
+  PCAType<DecompositionPolicy> p(scale);
+  Log::Info << "Performing PCA on dataset..." << endl;
+  double varRetained;
+  if (CLI::GetParam<double>("var_to_retain") != 0)
+  {
+    if (CLI::GetParam<int>("new_dimensionality") != 0)
+      Log::Warn << "New dimensionality (-d) ignored because -V was specified."
+          << endl;
+
+    varRetained = p.Apply(dataset, CLI::GetParam<double>("var_to_retain"));
+  }
+  else
+  {
+    varRetained = p.Apply(dataset, newDimension);
+  }
+
+  Log::Info << (varRetained * 100) << "% of variance retained (" <<
+      dataset.n_rows << " dimensions)." << endl;
+}
+
+//! Run incremental PCA on the given file, without loading it.
+void RunIncrementalPCA(const string& inputFile, const string& outputFile)
+{
+  if (CLI::GetParam<int>("new_dimensionality") <= 0)
+    Log::Fatal << "The new dimensionality (-d) must be given with "
+        << "--incremental." << endl;
+  if (CLI::GetParam<double>("var_to_retain") != 0)
+    Log::Warn << "Variance to retain (-V) ignored with --incremental." << endl;
+  if (CLI::GetParam<string>("decomposition_method") != "exact")
+    Log::Warn << "Decomposition method (-c) ignored with --incremental."
+        << endl;
+
+  const int batchSize = CLI::GetParam<int>("batch_size");
+  if (batchSize < 1)
+    Log::Fatal << "Invalid batch size (" << batchSize << ")! Must be greater "
+        << "than or equal to 1." << endl;
+
+  data::StreamingReader reader(inputFile, (size_t) batchSize);
+  const size_t newDimension = (size_t) CLI::GetParam<int>("new_dimensionality");
+  if (newDimension > reader.Dimensionality())
+    Log::Fatal << "New dimensionality (" << newDimension << ") cannot be "
+        << "greater than existing dimensionality (" << reader.Dimensionality()
+        << ")!" << endl;
+
+  IncrementalPCA p(newDimension, CLI::HasParam("scale"));
+  Log::Info << "Performing incremental PCA on dataset..." << endl;
+  p.Fit(reader);
+
+  Log::Info << (p.VarianceRetained() * 100) << "% of variance retained ("
+      << p.Components().n_cols << " dimensions)." << endl;
+
+  p.Transform(reader, outputFile);
+}
+
 int main(int argc, char** argv)
 {
   // Parse commandline.
   CLI::ParseCommandLine(argc, argv);
 
-  // Load input dataset.
   string inputFile = CLI::GetParam<string>("input_file");
+  if (CLI::HasParam("incremental"))
+  {
+    RunIncrementalPCA(inputFile, CLI::GetParam<string>("output_file"));
+    return 0;
+  }
+
+  // Load input dataset.
   arma::mat dataset;
   data::Load(inputFile, dataset);
 
@@ -55,28 +142,29 @@ int main(int argc, char** argv)
   }
 
   // Get the options for running PCA.
-  const size_t scale = CLI::HasParam("scale");
+  const bool scale = CLI::HasParam("scale");
 
   // Perform PCA.
-  PCA p(scale);
-  Log::Info << "Performing PCA on dataset..." << endl;
-  double varRetained;
-  if (CLI::GetParam<double>("var_to_retain") != 0)
+  const string decompositionMethod =
+      CLI::GetParam<string>("decomposition_method");
+  if (decompositionMethod == "exact")
   {
-    if (CLI::GetParam<int>("new_dimensionality") != 0)
-      Log::Warn << "New dimensionality (-d) ignored because -V was specified."
-          << endl;
-
-    varRetained = p.Apply(dataset, CLI::GetParam<double>("var_to_retain"));
+    RunPCA<ExactSVDPolicy>(dataset, newDimension, scale);
+  }
+  else if (decompositionMethod == "randomized")
+  {
+    RunPCA<RandomizedSVDPolicy>(dataset, newDimension, scale);
+  }
+  else if (decompositionMethod == "quic")
+  {
+    RunPCA<QUICSVDPolicy>(dataset, newDimension, scale);
   }
   else
   {
-    varRetained = p.Apply(dataset, newDimension);
+    Log::Fatal << "Invalid decomposition method ('" << decompositionMethod
+        << "'); valid choices are 'exact', 'randomized', and 'quic'." << endl;
   }
 
-  Log::Info << (varRetained * 100) << "% of variance retained (" <<
-      dataset.n_rows << " dimensions)." << endl;
-
   // Now save the results.
   string outputFile = CLI::GetParam<string>("output_file");
   data::Save(outputFile, dataset);
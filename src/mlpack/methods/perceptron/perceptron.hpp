@@ -21,6 +21,12 @@ namespace perceptron {
  * network).  It converges if the supplied training dataset is linearly
  * separable.
  *
+ * The perceptron can be trained in parallel with iterative parameter mixing
+ * (McDonald, Hall and Mann, 2010): the dataset is split into shards, and in
+ * each iteration, every shard is trained on (in parallel) from the current
+ * weights, after which the weights are replaced by the average of the weights
+ * of the shards.  If the dataset is linearly separable, this also converges.
+ *
  * @tparam LearnPolicy Options of SimpleWeightUpdate and GradientDescent.
  * @tparam WeightInitializationPolicy Option of ZeroInitialization and
  *      RandomInitialization.
@@ -40,12 +46,20 @@ class Perceptron
    * @param labels Labels of dataset.
    * @param iterations Maximum number of iterations for the perceptron learning
    *     algorithm.
+   * @param shards Number of shards of the dataset trained on in parallel, with
+   *     iterative parameter mixing; with 1 shard, the perceptron is trained
+   *     serially.
    */
-  Perceptron(const MatType& data, const arma::Row<size_t>& labels, int iterations);
+  Perceptron(const MatType& data,
+             const arma::Row<size_t>& labels,
+             int iterations,
+             const size_t shards = 1);
 
   /**
    * Classification function. After training, use the weightVectors matrix to
-   * classify test, and put the predicted classes in predictedLabels.
+   * classify test, and put the predicted classes in predictedLabels.  The
+   * points are classified in blocks, in parallel, with one matrix
+   * multiplication per block.
    *
    * @param test Testing data or data to classify.
    * @param predictedLabels Vector to store the predicted classes after
@@ -63,12 +77,24 @@ class Perceptron
    *  @param D Weight vector to use while training. For boosting purposes.
    *  @param labels The labels of data.
    */
-  Perceptron(const Perceptron<>& other, MatType& data, const arma::rowvec& D, const arma::Row<size_t>& labels);
+  Perceptron(const Perceptron<>& other, const MatType& data, const arma::rowvec& D, const arma::Row<size_t>& labels);
+
+  //! Get the number of shards trained on in parallel.
+  size_t Shards() const { return shards; }
+
+  //! Get the weight vectors (one row per class; the first column is the bias).
+  const arma::mat& Weights() const { return weightVectors; }
 
 private:
+  //! The number of points classified together by one thread.
+  static const size_t PointBlockSize = 256;
+
   //! To store the number of iterations
   size_t iter;
 
+  //! The number of shards trained on in parallel.
+  size_t shards;
+
   //! Stores the class labels for the input data.
   arma::Row<size_t> classLabels;
 
@@ -22,6 +22,7 @@ namespace perceptron {
  * @param labels Labels of dataset.
  * @param iterations Maximum number of iterations for the perceptron learning
  *      algorithm.
+ * @param shards Number of shards of the dataset trained on in parallel.
  */
 template<
     typename LearnPolicy,
@@ -31,7 +32,9 @@ template<
 Perceptron<LearnPolicy, WeightInitializationPolicy, MatType>::Perceptron(
     const MatType& data,
     const arma::Row<size_t>& labels,
-    int iterations)
+    int iterations,
+    const size_t shards) :
+    shards(std::max(shards, (size_t) 1))
 {
   WeightInitializationPolicy WIP;
   WIP.Initialize(weightVectors, arma::max(labels) + 1, data.n_rows + 1);
@@ -66,18 +69,37 @@ void Perceptron<LearnPolicy, WeightInitializationPolicy, MatType>::Classify(
     const MatType& test,
     arma::Row<size_t>& predictedLabels)
 {
-  arma::mat tempLabelMat;
-  arma::uword maxIndexRow, maxIndexCol;
+  predictedLabels.set_size(test.n_cols);
 
-  for (size_t i = 0; i < test.n_cols; i++)
+  // The weights without the bias, and the bias.
+  const arma::mat weights = weightVectors.cols(1, weightVectors.n_cols - 1);
+  const arma::vec bias = weightVectors.col(0);
+
+  const size_t numBlocks = (test.n_cols + PointBlockSize - 1) / PointBlockSize;
+
+  #pragma omp parallel for schedule(static)
+  for (size_t b = 0; b < numBlocks; b++)
   {
-    tempLabelMat = weightVectors.submat(0, 1, weightVectors.n_rows - 1,
-                                        weightVectors.n_cols - 1) * 
-                                        test.col(i) + weightVectors.col(0);
-    tempLabelMat.max(maxIndexRow, maxIndexCol);
-    predictedLabels(0, i) = maxIndexRow;
+    const size_t begin = b * PointBlockSize;
+    const size_t size = std::min(begin + PointBlockSize,
+        (size_t) test.n_cols) - begin;
+
+    // An alias of the block of points, to avoid a copy.
+    const MatType block(const_cast<typename MatType::elem_type*>(
+        test.colptr(begin)), test.n_rows, size, false, true);
+    const arma::mat scores = weights * block;
+
+    for (size_t i = 0; i < size; i++)
+    {
+      const double* pointScores = scores.colptr(i);
+      size_t maxIndex = 0;
+      for (size_t k = 1; k < scores.n_rows; k++)
+        if (pointScores[k] + bias[k] > pointScores[maxIndex] + bias[maxIndex])
+          maxIndex = k;
+
+      predictedLabels(0, begin + i) = maxIndex;
+    }
   }
-  // predictedLabels.print("These are the labels predicted by the perceptron");
 }
 
 /**
@@ -92,12 +114,13 @@ void Perceptron<LearnPolicy, WeightInitializationPolicy, MatType>::Classify(
  */
 template <typename LearnPolicy, typename WeightInitializationPolicy, typename MatType>
 Perceptron<LearnPolicy, WeightInitializationPolicy, MatType>::Perceptron(
-  const Perceptron<>& other, MatType& data, const arma::rowvec& D, const arma::Row<size_t>& labels)
+  const Perceptron<>& other, const MatType& data, const arma::rowvec& D, const arma::Row<size_t>& labels)
 {
   
   classLabels = labels;
   trainData = data;
   iter = other.iter;
+  shards = other.Shards();
 
   // Insert a row of ones at the top of the training data set.
   MatType zOnes(1, data.n_cols);
@@ -123,42 +146,67 @@ template<
 void Perceptron<LearnPolicy, WeightInitializationPolicy, MatType>::Train(
      const arma::rowvec& D)
 {
-  size_t j, i = 0;
+  size_t i = 0;
   bool converged = false;
-  size_t tempLabel;
-  arma::uword maxIndexRow, maxIndexCol;
-  arma::mat tempLabelMat;
 
-  LearnPolicy LP;
+  // The shards are contiguous ranges of points; there are no empty shards.
+  const size_t numShards = std::max(std::min(shards,
+      (size_t) trainData.n_cols), (size_t) 1);
+  std::vector<arma::mat> shardWeights(numShards);
 
   while ((i < iter) && (!converged))
   {
     // This outer loop is for each iteration, and we use the 'converged'
     // variable for noting whether or not convergence has been reached.
     i++;
-    converged = true;
+    size_t mistakes = 0;
 
-    // Now this inner loop is for going through the dataset in each iteration.
-    for (j = 0; j < trainData.n_cols; j++)
+    // Each shard is trained on from the current weights.
+    #pragma omp parallel for schedule(static) reduction(+:mistakes)
+    for (size_t s = 0; s < numShards; s++)
     {
-      // Multiply for each variable and check whether the current weight vector
-      // correctly classifies this.
-      tempLabelMat = weightVectors * trainData.col(j);
-
-      tempLabelMat.max(maxIndexRow, maxIndexCol);
-      
-      // Check whether prediction is correct.
-      if (maxIndexRow != classLabels(0, j))
+      const size_t begin = s * trainData.n_cols / numShards;
+      const size_t end = (s + 1) * trainData.n_cols / numShards;
+
+      arma::mat& weights = shardWeights[s];
+      weights = weightVectors;
+
+      LearnPolicy LP;
+      arma::mat tempLabelMat;
+      arma::uword maxIndexRow, maxIndexCol;
+
+      // Now this inner loop is for going through the shard in each iteration.
+      for (size_t j = begin; j < end; j++)
       {
-        // Due to incorrect prediction, convergence set to false.
-        converged = false;
-        tempLabel = classLabels(0, j);
-        // Send maxIndexRow for knowing which weight to update, send j to know
-        // the value of the vector to update it with.  Send tempLabel to know
-        // the correct class.
-        LP.UpdateWeights(trainData, weightVectors, j, tempLabel, maxIndexRow, D);
+        // Multiply for each variable and check whether the current weight
+        // vector correctly classifies this.
+        tempLabelMat = weights * trainData.col(j);
+
+        tempLabelMat.max(maxIndexRow, maxIndexCol);
+
+        // Check whether prediction is correct.
+        if (maxIndexRow != classLabels(0, j))
+        {
+          // Due to incorrect prediction, convergence is not reached.
+          ++mistakes;
+          const size_t tempLabel = classLabels(0, j);
+          // Send maxIndexRow for knowing which weight to update, send j to
+          // know the value of the vector to update it with.  Send tempLabel to
+          // know the correct class.
+          LP.UpdateWeights(trainData, weights, j, tempLabel, maxIndexRow, D);
+        }
       }
     }
+
+    converged = (mistakes == 0);
+
+    // Mix the weights of the shards uniformly.  With one shard, these are just
+    // the weights after a serial pass over the dataset.
+    weightVectors = shardWeights[0];
+    for (size_t s = 1; s < numShards; s++)
+      weightVectors += shardWeights[s];
+    if (numShards > 1)
+      weightVectors /= numShards;
   }
 }
 
@@ -37,6 +37,12 @@ PROGRAM_INFO("Perceptron",
     "A test file is given through the --test_file (-T) parameter.  The "
     "predicted labels for the test set will be stored in the file specified by "
     "the --output_file (-o) parameter."
+    "\n"
+    "For large datasets, the perceptron can be trained in parallel with "
+    "iterative parameter mixing: the training set is split into the number of "
+    "shards given by the --shards (-s) parameter, each shard is trained on in "
+    "parallel in every iteration, and the weights of the shards are then "
+    "averaged."
     );
 
 // Necessary parameters
@@ -50,6 +56,8 @@ PARAM_STRING("output", "The file in which the predicted labels for the test set"
     " will be written.", "o", "output.csv");
 PARAM_INT("iterations","The maximum number of iterations the perceptron is "
   "to be run", "i", 1000);
+PARAM_INT("shards", "The number of shards of the training set trained on in "
+  "parallel.", "s", 1);
 
 int main(int argc, char** argv)
 {
@@ -102,10 +110,17 @@ int main(int argc, char** argv)
   }
 
   int iterations = CLI::GetParam<int>("iterations");
+
+  const int shards = CLI::GetParam<int>("shards");
+  if (shards < 1)
+  {
+    Log::Fatal << "Invalid number of shards (" << shards << ") specified! "
+        << "Must be greater than 0." << std::endl;
+  }
   
   // Create and train the classifier.
   Timer::Start("Training");
-  Perceptron<> p(trainingData, labels.t(), iterations);
+  Perceptron<> p(trainingData, labels.t(), iterations, (size_t) shards);
   Timer::Stop("Training");
 
   // Time the running of the Perceptron Classifier.
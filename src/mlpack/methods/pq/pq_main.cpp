@@ -0,0 +1,218 @@
+/**
+ * @file pq_main.cpp
+ *
+ * Executable for approximate nearest neighbor search with product
+ * quantization.
+ */
+#include <mlpack/core.hpp>
+
+#include "pq_search.hpp"
+
+using namespace std;
+using namespace mlpack;
+using namespace mlpack::neighbor;
+
+// Information about the program itself.
+PROGRAM_INFO("Approximate K-Nearest-Neighbor Search with Product Quantization",
+    "This program will calculate the k approximate nearest neighbors of a set "
+    "of query points in a set of reference points with product quantization.  "
+    "The dimensions are split into --subspaces groups, a codebook of "
+    "--centroids centroids is trained with k-means for each group, and each "
+    "reference point is stored as the index of its nearest centroid in each "
+    "group, in one byte per group.  The distance from a query point to each "
+    "reference point is then approximated with one table lookup per group.  "
+    "If no query file is given, the neighbors of the reference points are "
+    "found (and each point is usually its own nearest neighbor)."
+    "\n\n"
+    "For example, the following will return 5 neighbors from 'input.csv' for "
+    "each point in 'queries.csv', with 8 groups, and store the distances in "
+    "'distances.csv' and the neighbors in 'neighbors.csv':"
+    "\n\n"
+    "$ pq -k 5 -r input.csv -q queries.csv -m 8 -d distances.csv "
+    "-n neighbors.csv"
+    "\n\n"
+    "The output files are organized such that row i and column j in the "
+    "neighbors output file corresponds to the index of the point in the "
+    "reference set which is the i'th nearest neighbor from the point in the "
+    "query set with index j.  Row i and column j in the distances output file "
+    "corresponds to the distance between those two points."
+    "\n\n"
+    "The codebooks can be trained on --training_size evenly spaced reference "
+    "points instead of the whole reference set.  With --rerank, that many "
+    "candidates are found for each query with the approximate distances, and "
+    "the k nearest of them with the exact distances are returned.  With "
+    "--map_reference, the reference file (in the mlpack mapped matrix format "
+    "or arma_binary, with one point per column) is memory-mapped instead of "
+    "loaded, so that a reference set larger than memory can be encoded and "
+    "used for reranking.");
+
+// Define our input parameters that this program will take.
+PARAM_STRING_REQ("reference_file", "File containing the reference dataset.",
+    "r");
+PARAM_STRING("distances_file", "File to output distances into.", "d", "");
+PARAM_STRING("neighbors_file", "File to output neighbors into.", "n", "");
+
+PARAM_INT_REQ("k", "Number of nearest neighbors to find.", "k");
+
+PARAM_STRING("query_file", "File containing query points (optional).", "q", "");
+
+PARAM_INT("subspaces", "Number of groups the dimensions are split into (the "
+    "number of bytes each reference point is stored in).", "m", 8);
+PARAM_INT("centroids", "Number of centroids in the codebook of each group "
+    "(at most 256).", "c", 256);
+PARAM_INT("training_size", "Number of reference points to train the codebooks "
+    "on (0 uses every reference point).", "T", 0);
+PARAM_INT("rerank", "Number of candidates to rerank with the exact distances "
+    "for each query (0 does not rerank).", "R", 0);
+PARAM_FLAG("map_reference", "If true, memory-map the reference file instead "
+    "of loading it.", "M");
+PARAM_INT("seed", "Random seed.  If 0, 'std::time(NULL)' is used.", "s", 0);
+PARAM_INT("num_threads", "Number of threads to use (0 uses all available "
+    "threads).  This has no effect unless mlpack was built with OpenMP.", "t",
+    1);
+
+int main(int argc, char *argv[])
+{
+  // Give CLI the command line parameters the user passed in.
+  CLI::ParseCommandLine(argc, argv);
+
+  if (CLI::GetParam<int>("seed") != 0)
+    math::RandomSeed((size_t) CLI::GetParam<int>("seed"));
+  else
+    math::RandomSeed((size_t) time(NULL));
+
+  const string referenceFile = CLI::GetParam<string>("reference_file");
+  const string queryFile = CLI::GetParam<string>("query_file");
+  const size_t k = (size_t) CLI::GetParam<int>("k");
+
+  // Sanity checks on the parameters.
+  if (CLI::GetParam<int>("k") <= 0)
+  {
+    Log::Fatal << "Invalid k: " << CLI::GetParam<int>("k") << ".  Must be "
+        << "greater than 0." << endl;
+  }
+
+  if (CLI::GetParam<int>("subspaces") <= 0)
+  {
+    Log::Fatal << "Invalid number of subspaces: "
+        << CLI::GetParam<int>("subspaces") << ".  Must be greater than 0."
+        << endl;
+  }
+
+  if (CLI::GetParam<int>("centroids") <= 0 ||
+      CLI::GetParam<int>("centroids") > 256)
+  {
+    Log::Fatal << "Invalid number of centroids: "
+        << CLI::GetParam<int>("centroids") << ".  Must be between 1 and 256."
+        << endl;
+  }
+
+  if (CLI::GetParam<int>("training_size") < 0)
+  {
+    Log::Fatal << "Invalid training size: "
+        << CLI::GetParam<int>("training_size") << ".  Must be greater than or "
+        << "equal to 0." << endl;
+  }
+
+  if (CLI::GetParam<int>("rerank") < 0 ||
+      (CLI::GetParam<int>("rerank") > 0 &&
+       (size_t) CLI::GetParam<int>("rerank") < k))
+  {
+    Log::Fatal << "Invalid number of candidates to rerank: "
+        << CLI::GetParam<int>("rerank") << ".  Must be 0, or at least k."
+        << endl;
+  }
+
+  if (CLI::GetParam<int>("num_threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: "
+        << CLI::GetParam<int>("num_threads") << ".  Must be greater than or "
+        << "equal to 0." << endl;
+  }
+
+  const size_t subspaces = (size_t) CLI::GetParam<int>("subspaces");
+  const size_t centroids = (size_t) CLI::GetParam<int>("centroids");
+  const size_t rerank = (size_t) CLI::GetParam<int>("rerank");
+
+  // The reference set is either loaded or mapped; only one of these is used.
+  arma::mat loadedReferences;
+  data::MappedMatrix<double>* mappedReferences = NULL;
+  if (CLI::HasParam("map_reference"))
+  {
+    mappedReferences = new data::MappedMatrix<double>(referenceFile);
+  }
+  else
+  {
+    data::Load(referenceFile, loadedReferences, true);
+  }
+  const arma::mat& referenceData = (mappedReferences != NULL) ?
+      mappedReferences->Matrix() : loadedReferences;
+
+  Log::Info << "Loaded reference data from '" << referenceFile << "' ("
+      << referenceData.n_rows << " x " << referenceData.n_cols << ")." << endl;
+
+  if (k > referenceData.n_cols)
+  {
+    Log::Fatal << "Invalid k: " << k << "; must be less than or equal to the "
+        << "number of reference points (" << referenceData.n_cols << ")."
+        << endl;
+  }
+
+  arma::mat queryData;
+  if (queryFile != "")
+  {
+    data::Load(queryFile, queryData, true);
+    Log::Info << "Loaded query data from '" << queryFile << "' ("
+        << queryData.n_rows << " x " << queryData.n_cols << ")." << endl;
+  }
+
+  PQSearch<> pq(subspaces, centroids);
+  pq.NumThreads() = (size_t) CLI::GetParam<int>("num_threads");
+
+  // Train the codebooks on evenly spaced reference points, if there are more
+  // than the training size.
+  const size_t trainingSize = (size_t) CLI::GetParam<int>("training_size");
+  if (trainingSize != 0 && trainingSize < referenceData.n_cols)
+  {
+    arma::mat trainingData(referenceData.n_rows, trainingSize);
+    for (size_t i = 0; i < trainingSize; ++i)
+      trainingData.col(i) = referenceData.col((i * referenceData.n_cols) /
+          trainingSize);
+
+    Log::Info << "Training codebooks on " << trainingSize << " points..."
+        << endl;
+    pq.Train(trainingData);
+  }
+  else
+  {
+    Log::Info << "Training codebooks..." << endl;
+    pq.Train(referenceData);
+  }
+
+  Log::Info << "Encoding reference points..." << endl;
+  Timer::Start("encoding");
+  pq.Add(referenceData);
+  Timer::Stop("encoding");
+  Log::Info << "The codes take " << pq.Codes().n_elem << " bytes." << endl;
+
+  const arma::mat& querySet = (queryFile != "") ? queryData : referenceData;
+
+  Log::Info << "Computing " << k << " approximate nearest neighbors..."
+      << endl;
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  if (rerank > 0)
+    pq.Search(querySet, k, neighbors, distances, referenceData, rerank);
+  else
+    pq.Search(querySet, k, neighbors, distances);
+  Log::Info << "Neighbors computed." << endl;
+
+  // Save output.
+  if (CLI::GetParam<string>("distances_file") != "")
+    data::Save(CLI::GetParam<string>("distances_file"), distances);
+
+  if (CLI::GetParam<string>("neighbors_file") != "")
+    data::Save(CLI::GetParam<string>("neighbors_file"), neighbors);
+
+  delete mappedReferences;
+}
@@ -0,0 +1,239 @@
+/**
+ * @file pq_search.hpp
+ *
+ * Defines the PQSearch class, which finds approximate nearest neighbors with a
+ * product-quantized (compressed) copy of the reference set.
+ *
+ * The details of this method can be found in the following paper:
+ *
+ * @article{jegou2011product,
+ *  title={Product quantization for nearest neighbor search},
+ *  author={J{\'e}gou, H. and Douze, M. and Schmid, C.},
+ *  journal={IEEE Transactions on Pattern Analysis and Machine Intelligence},
+ *  volume={33},
+ *  number={1},
+ *  pages={117--128},
+ *  year={2011}
+ * }
+ */
+#ifndef __MLPACK_METHODS_PQ_PQ_SEARCH_HPP
+#define __MLPACK_METHODS_PQ_PQ_SEARCH_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/methods/kmeans/kmeans.hpp>
+#include <vector>
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * The PQSearch class finds approximate nearest neighbors (under the Euclidean
+ * distance) with product quantization.  The dimensions are split into
+ * Subspaces() groups of consecutive dimensions, and the part of the points in
+ * each group is clustered with k-means into Centroids() centroids (at most
+ * 256), which form the codebook of the group.  Each reference point is then
+ * stored only as the index of the nearest centroid in each group: one byte per
+ * group, instead of eight bytes per dimension.  A 96-dimensional point with 8
+ * groups takes 8 bytes instead of 768.
+ *
+ * To search, the squared distances between each part of the query and every
+ * centroid of its group are computed once per query, and the (asymmetric)
+ * distance to each reference point is the sum of one table lookup per group.
+ * The distances are therefore approximate, and so are the neighbors; if the
+ * original reference points are still available (for instance, in a
+ * memory-mapped file, with data::MappedMatrix), a larger number of candidates
+ * can be reranked with their exact distances.
+ *
+ * @code
+ * extern arma::mat references, queries;
+ * PQSearch<> pq(references, 8); // 8 groups, 256 centroids each.
+ *
+ * arma::Mat<size_t> neighbors;
+ * arma::mat distances;
+ * pq.Search(queries, 10, neighbors, distances);
+ *
+ * // Rerank 100 candidates for each query with the original points.
+ * pq.Search(queries, 10, neighbors, distances, references, 100);
+ * @endcode
+ *
+ * The codebooks can be trained on a sample of the reference set with Train(),
+ * and the reference set can then be encoded in several parts with Add(), so
+ * that it never has to be in memory at once.
+ *
+ * If OpenMP is available, the points are encoded and the queries are searched
+ * in parallel, with NumThreads() threads.
+ *
+ * @tparam KMeansType Type of k-means clustering used to train the codebooks.
+ */
+template<typename KMeansType = kmeans::KMeans<> >
+class PQSearch
+{
+ public:
+  /**
+   * Create an empty index, which must be trained with Train() before points
+   * can be added to it with Add().
+   *
+   * @param subspaces Number of groups the dimensions are split into (the number
+   *     of bytes each point is encoded in).
+   * @param centroids Number of centroids in the codebook of each group (at most
+   *     256).
+   * @param kmeans Object used to train the codebooks.
+   */
+  PQSearch(const size_t subspaces,
+           const size_t centroids = 256,
+           const KMeansType& kmeans = KMeansType());
+
+  /**
+   * Train the codebooks on the given reference set, and encode it.
+   *
+   * @param referenceSet Set of reference points.
+   * @param subspaces Number of groups the dimensions are split into (the number
+   *     of bytes each point is encoded in).
+   * @param centroids Number of centroids in the codebook of each group (at most
+   *     256).
+   * @param kmeans Object used to train the codebooks.
+   */
+  PQSearch(const arma::mat& referenceSet,
+           const size_t subspaces,
+           const size_t centroids = 256,
+           const KMeansType& kmeans = KMeansType());
+
+  /**
+   * Train the codebooks on the given points (usually a sample of the reference
+   * set, with at least Centroids() points), and remove any points which were
+   * already encoded.
+   *
+   * @param trainingSet Points to train the codebooks on.
+   */
+  void Train(const arma::mat& trainingSet);
+
+  /**
+   * Encode the given points and add them to the index; their indices follow
+   * those of the points already in the index.
+   *
+   * @param points Points to add.
+   */
+  void Add(const arma::mat& points);
+
+  /**
+   * Encode the given points with the codebooks: codes(s, i) is the index of
+   * the centroid of group s nearest to point i.
+   *
+   * @param points Points to encode.
+   * @param codes Matrix to store the codes in.
+   */
+  void Encode(const arma::mat& points, arma::Mat<unsigned char>& codes) const;
+
+  /**
+   * Find the approximate k nearest neighbors of each query point among the
+   * points of the index, with the distances computed from the codes.  The
+   * neighbors and distances of query point i are stored in column i of the
+   * given matrices, nearest first.
+   *
+   * @param querySet Set of query points.
+   * @param k Number of neighbors to find.
+   * @param neighbors Matrix to store the indices of the neighbors in.
+   * @param distances Matrix to store the (approximate) distances in.
+   */
+  void Search(const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& neighbors,
+              arma::mat& distances) const;
+
+  /**
+   * Find the approximate k nearest neighbors of each query point, by finding
+   * the nearest 'rerank' points with the distances computed from the codes,
+   * and then keeping the k of those which are nearest with the exact distances
+   * to the given reference points.  The returned distances are exact.
+   *
+   * @param querySet Set of query points.
+   * @param k Number of neighbors to find.
+   * @param neighbors Matrix to store the indices of the neighbors in.
+   * @param distances Matrix to store the distances in.
+   * @param referenceSet The original points of the index (which may be a
+   *     memory-mapped matrix).
+   * @param rerank Number of candidates to rerank for each query (at least k).
+   */
+  void Search(const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& neighbors,
+              arma::mat& distances,
+              const arma::mat& referenceSet,
+              const size_t rerank) const;
+
+  //! Get the number of groups the dimensions are split into.
+  size_t Subspaces() const { return subspaces; }
+  //! Get the number of centroids in each codebook.
+  size_t Centroids() const { return centroids; }
+  //! Get the dimensionality of the points (0 if the index is not trained).
+  size_t Dimensionality() const { return offsets.back(); }
+  //! Get the number of points in the index.
+  size_t Size() const { return codes.n_cols; }
+
+  //! Get the codebook of the given group (one centroid per column).
+  const arma::mat& Codebook(const size_t subspace) const
+  { return codebooks[subspace]; }
+  //! Get the first dimension of the given group (the group ends where the next
+  //! one starts; Subspace(Subspaces()) is the dimensionality).
+  size_t Subspace(const size_t subspace) const { return offsets[subspace]; }
+  //! Get the codes of the points in the index (one point per column).
+  const arma::Mat<unsigned char>& Codes() const { return codes; }
+
+  //! Get the k-means object used to train the codebooks.
+  const KMeansType& Clusterer() const { return kmeans; }
+  //! Modify the k-means object used to train the codebooks.
+  KMeansType& Clusterer() { return kmeans; }
+
+  //! Get the number of threads used (0 means all available threads).
+  size_t NumThreads() const { return numThreads; }
+  //! Modify the number of threads used (0 means all available threads).  This
+  //! only has an effect if OpenMP is available.
+  size_t& NumThreads() { return numThreads; }
+
+ private:
+  /**
+   * Find the 'count' points of the index nearest to each query point with the
+   * distances computed from the codes, nearest first.  The distances are
+   * squared.
+   */
+  void SearchCodes(const arma::mat& querySet,
+                   const size_t count,
+                   arma::Mat<size_t>& neighbors,
+                   arma::mat& distances) const;
+
+  /**
+   * Insert the given neighbor into the list of the best 'count' neighbors (in
+   * increasing order of distance), if it belongs there.
+   */
+  static void InsertNeighbor(double* distances,
+                             size_t* neighbors,
+                             const size_t count,
+                             const double distance,
+                             const size_t neighbor);
+
+  //! The number of points encoded or searched together.
+  static const size_t BlockSize = 256;
+
+  //! The number of groups the dimensions are split into.
+  size_t subspaces;
+  //! The number of centroids in each codebook.
+  size_t centroids;
+  //! The first dimension of each group, and the dimensionality at the end.
+  std::vector<size_t> offsets;
+  //! The codebook of each group.
+  std::vector<arma::mat> codebooks;
+  //! The codes of the points in the index.
+  arma::Mat<unsigned char> codes;
+  //! The k-means object used to train the codebooks.
+  KMeansType kmeans;
+  //! The number of threads used.
+  size_t numThreads;
+};
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+// Include implementation.
+#include "pq_search_impl.hpp"
+
+#endif
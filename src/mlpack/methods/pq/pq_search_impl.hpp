@@ -0,0 +1,333 @@
+/**
+ * @file pq_search_impl.hpp
+ *
+ * Implementation of the PQSearch class.
+ */
+#ifndef __MLPACK_METHODS_PQ_PQ_SEARCH_IMPL_HPP
+#define __MLPACK_METHODS_PQ_PQ_SEARCH_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "pq_search.hpp"
+
+#include <mlpack/core/metrics/lmetric.hpp>
+#include <mlpack/core/metrics/lmetric_kernels.hpp>
+
+namespace mlpack {
+namespace neighbor {
+
+template<typename KMeansType>
+PQSearch<KMeansType>::PQSearch(const size_t subspaces,
+                               const size_t centroids,
+                               const KMeansType& kmeans) :
+    subspaces(subspaces),
+    centroids(centroids),
+    offsets(subspaces + 1, 0),
+    codebooks(subspaces),
+    kmeans(kmeans),
+    numThreads(1)
+{
+  if (subspaces == 0)
+    Log::Fatal << "PQSearch: the number of subspaces must be positive."
+        << std::endl;
+
+  if (centroids == 0 || centroids > 256)
+    Log::Fatal << "PQSearch: the number of centroids must be between 1 and "
+        << "256." << std::endl;
+}
+
+template<typename KMeansType>
+PQSearch<KMeansType>::PQSearch(const arma::mat& referenceSet,
+                               const size_t subspaces,
+                               const size_t centroids,
+                               const KMeansType& kmeans) :
+    subspaces(subspaces),
+    centroids(centroids),
+    offsets(subspaces + 1, 0),
+    codebooks(subspaces),
+    kmeans(kmeans),
+    numThreads(1)
+{
+  if (subspaces == 0)
+    Log::Fatal << "PQSearch: the number of subspaces must be positive."
+        << std::endl;
+
+  if (centroids == 0 || centroids > 256)
+    Log::Fatal << "PQSearch: the number of centroids must be between 1 and "
+        << "256." << std::endl;
+
+  Train(referenceSet);
+  Add(referenceSet);
+}
+
+template<typename KMeansType>
+void PQSearch<KMeansType>::Train(const arma::mat& trainingSet)
+{
+  if (trainingSet.n_rows < subspaces)
+  {
+    Log::Fatal << "PQSearch::Train(): cannot split " << trainingSet.n_rows
+        << " dimensions into " << subspaces << " subspaces." << std::endl;
+  }
+
+  if (trainingSet.n_cols < centroids)
+  {
+    Log::Fatal << "PQSearch::Train(): at least " << centroids << " points are "
+        << "needed to train the codebooks, but " << trainingSet.n_cols
+        << " were given." << std::endl;
+  }
+
+  // The groups have consecutive dimensions, and their sizes differ by at most
+  // one.
+  for (size_t s = 0; s <= subspaces; ++s)
+    offsets[s] = (s * trainingSet.n_rows) / subspaces;
+
+  Timer::Start("pq_training");
+  for (size_t s = 0; s < subspaces; ++s)
+  {
+    const arma::mat part = trainingSet.rows(offsets[s], offsets[s + 1] - 1);
+    kmeans.Cluster(part, centroids, codebooks[s]);
+  }
+  Timer::Stop("pq_training");
+
+  codes.reset();
+}
+
+template<typename KMeansType>
+void PQSearch<KMeansType>::Add(const arma::mat& points)
+{
+  arma::Mat<unsigned char> newCodes;
+  Encode(points, newCodes);
+
+  if (codes.n_cols == 0)
+    codes.swap(newCodes);
+  else
+    codes.insert_cols(codes.n_cols, newCodes);
+}
+
+template<typename KMeansType>
+void PQSearch<KMeansType>::Encode(const arma::mat& points,
+                                  arma::Mat<unsigned char>& pointCodes) const
+{
+  if (points.n_rows != Dimensionality())
+  {
+    Log::Fatal << "PQSearch::Encode(): the points have " << points.n_rows
+        << " dimensions, but the index has " << Dimensionality() << " (was it "
+        << "trained?)." << std::endl;
+  }
+
+  pointCodes.set_size(subspaces, points.n_cols);
+  const size_t numBlocks = (points.n_cols + BlockSize - 1) / BlockSize;
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads(numThreads);
+#else
+  const size_t threads = 1;
+#endif
+
+  // Each block of points is compared with each codebook at once.
+  #pragma omp parallel num_threads(threads) if(threads > 1)
+  {
+    arma::mat distances;
+
+    #pragma omp for schedule(static)
+    for (size_t block = 0; block < numBlocks; ++block)
+    {
+      const size_t begin = block * BlockSize;
+      const size_t end = std::min(begin + BlockSize, (size_t) points.n_cols);
+
+      for (size_t s = 0; s < subspaces; ++s)
+      {
+        const arma::mat part = points.submat(offsets[s], begin,
+            offsets[s + 1] - 1, end - 1);
+        metric::SquaredDistanceBlock(codebooks[s], part, distances);
+
+        for (size_t i = begin; i < end; ++i)
+        {
+          arma::uword nearest;
+          distances.unsafe_col(i - begin).min(nearest);
+          pointCodes(s, i) = (unsigned char) nearest;
+        }
+      }
+    }
+  }
+}
+
+template<typename KMeansType>
+void PQSearch<KMeansType>::Search(const arma::mat& querySet,
+                                  const size_t k,
+                                  arma::Mat<size_t>& neighbors,
+                                  arma::mat& distances) const
+{
+  SearchCodes(querySet, k, neighbors, distances);
+  distances = arma::sqrt(distances);
+}
+
+template<typename KMeansType>
+void PQSearch<KMeansType>::Search(const arma::mat& querySet,
+                                  const size_t k,
+                                  arma::Mat<size_t>& neighbors,
+                                  arma::mat& distances,
+                                  const arma::mat& referenceSet,
+                                  const size_t rerank) const
+{
+  if (referenceSet.n_cols != Size() || referenceSet.n_rows != Dimensionality())
+  {
+    Log::Fatal << "PQSearch::Search(): the reference set is "
+        << referenceSet.n_rows << " x " << referenceSet.n_cols << ", but the "
+        << "index holds " << Size() << " points of dimensionality "
+        << Dimensionality() << "." << std::endl;
+  }
+
+  if (rerank < k)
+  {
+    Log::Fatal << "PQSearch::Search(): cannot rerank " << rerank << " "
+        << "candidates to find " << k << " neighbors." << std::endl;
+  }
+
+  arma::Mat<size_t> candidates;
+  arma::mat candidateDistances;
+  SearchCodes(querySet, rerank, candidates, candidateDistances);
+
+  neighbors.set_size(k, querySet.n_cols);
+  distances.set_size(k, querySet.n_cols);
+  neighbors.fill(Size());
+  distances.fill(DBL_MAX);
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads(numThreads);
+#else
+  const size_t threads = 1;
+#endif
+
+  Timer::Start("pq_reranking");
+
+  // Compute the exact distances to the candidates.
+  #pragma omp parallel for num_threads(threads) if(threads > 1) \
+      schedule(dynamic, 16)
+  for (size_t q = 0; q < querySet.n_cols; ++q)
+  {
+    for (size_t j = 0; j < rerank; ++j)
+    {
+      const size_t candidate = candidates(j, q);
+      if (candidate >= Size())
+        break; // There are fewer points than candidates.
+
+      const double distance = metric::SquaredEuclideanDistance::Evaluate(
+          querySet.unsafe_col(q), referenceSet.unsafe_col(candidate));
+      InsertNeighbor(distances.colptr(q), neighbors.colptr(q), k, distance,
+          candidate);
+    }
+  }
+
+  Timer::Stop("pq_reranking");
+
+  distances = arma::sqrt(distances);
+}
+
+template<typename KMeansType>
+void PQSearch<KMeansType>::SearchCodes(const arma::mat& querySet,
+                                       const size_t count,
+                                       arma::Mat<size_t>& neighbors,
+                                       arma::mat& distances) const
+{
+  if (querySet.n_rows != Dimensionality())
+  {
+    Log::Fatal << "PQSearch::Search(): the query points have "
+        << querySet.n_rows << " dimensions, but the index has "
+        << Dimensionality() << "." << std::endl;
+  }
+
+  if (count == 0)
+    Log::Fatal << "PQSearch::Search(): k must be positive." << std::endl;
+
+  // Missing neighbors (if count is larger than the index) have the index
+  // Size() and the largest distance.
+  neighbors.set_size(count, querySet.n_cols);
+  distances.set_size(count, querySet.n_cols);
+  neighbors.fill(Size());
+  distances.fill(DBL_MAX);
+
+  const size_t numBlocks = (querySet.n_cols + BlockSize - 1) / BlockSize;
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads(numThreads);
+#else
+  const size_t threads = 1;
+#endif
+
+  Timer::Start("computing_neighbors");
+
+  #pragma omp parallel num_threads(threads) if(threads > 1)
+  {
+    // tables[s](c, q) is the squared distance between the part of query q in
+    // group s and centroid c of that group.
+    std::vector<arma::mat> tables(subspaces);
+    std::vector<const double*> queryTables(subspaces);
+
+    #pragma omp for schedule(dynamic)
+    for (size_t block = 0; block < numBlocks; ++block)
+    {
+      const size_t begin = block * BlockSize;
+      const size_t end = std::min(begin + BlockSize,
+          (size_t) querySet.n_cols);
+
+      for (size_t s = 0; s < subspaces; ++s)
+      {
+        const arma::mat part = querySet.submat(offsets[s], begin,
+            offsets[s + 1] - 1, end - 1);
+        metric::SquaredDistanceBlock(codebooks[s], part, tables[s]);
+      }
+
+      for (size_t q = begin; q < end; ++q)
+      {
+        for (size_t s = 0; s < subspaces; ++s)
+          queryTables[s] = tables[s].colptr(q - begin);
+
+        double* queryDistances = distances.colptr(q);
+        size_t* queryNeighbors = neighbors.colptr(q);
+
+        // The distance to each point is a sum of table lookups; the codes of
+        // the points are read in order.
+        const unsigned char* code = codes.memptr();
+        for (size_t i = 0; i < codes.n_cols; ++i, code += subspaces)
+        {
+          double distance = 0.0;
+          for (size_t s = 0; s < subspaces; ++s)
+            distance += queryTables[s][code[s]];
+
+          if (distance < queryDistances[count - 1])
+            InsertNeighbor(queryDistances, queryNeighbors, count, distance, i);
+        }
+      }
+    }
+  }
+
+  Timer::Stop("computing_neighbors");
+}
+
+template<typename KMeansType>
+inline void PQSearch<KMeansType>::InsertNeighbor(double* distances,
+                                                 size_t* neighbors,
+                                                 const size_t count,
+                                                 const double distance,
+                                                 const size_t neighbor)
+{
+  if (count == 0 || distance >= distances[count - 1])
+    return;
+
+  // Shift the farther neighbors down to make room.
+  size_t pos = count - 1;
+  while (pos > 0 && distances[pos - 1] > distance)
+  {
+    distances[pos] = distances[pos - 1];
+    neighbors[pos] = neighbors[pos - 1];
+    --pos;
+  }
+
+  distances[pos] = distance;
+  neighbors[pos] = neighbor;
+}
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
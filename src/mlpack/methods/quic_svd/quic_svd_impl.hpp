@@ -15,35 +15,38 @@ using namespace mlpack::tree;
 namespace mlpack {
 namespace svd {
 
-QUIC_SVD::QUIC_SVD(const arma::mat& dataset,
-                   arma::mat& u,
-                   arma::mat& v,
-                   arma::mat& sigma,
-                   const double epsilon,
-                   const double delta) :
+inline QUIC_SVD::QUIC_SVD(const arma::mat& dataset,
+                          arma::mat& u,
+                          arma::mat& v,
+                          arma::mat& sigma,
+                          const double epsilon,
+                          const double delta) :
     dataset(dataset),
     epsilon(epsilon),
     delta(delta)
 {
   // Since columns are sample in the implementation, the matrix is transposed if
-  // necessary for maximum speedup.
-  CosineTree* ctree;
+  // necessary for maximum speedup.  The tree is only needed for its basis.
   if (dataset.n_cols > dataset.n_rows)
-    ctree = new CosineTree(dataset, epsilon, delta);
+  {
+    CosineTree ctree(dataset, epsilon, delta);
+    ctree.GetFinalBasis(basis);
+  }
   else
-    ctree = new CosineTree(dataset.t(), epsilon, delta);
-
-  // Get subspace basis by creating the cosine tree.
-  ctree->GetFinalBasis(basis);
+  {
+    const arma::mat transposedDataset = trans(dataset);
+    CosineTree ctree(transposedDataset, epsilon, delta);
+    ctree.GetFinalBasis(basis);
+  }
 
   // Use the ExtractSVD algorithm mentioned in the paper to extract the SVD of
   // the original dataset in the obtained subspace.
   ExtractSVD(u, v, sigma);
 }
 
-void QUIC_SVD::ExtractSVD(arma::mat& u,
-                          arma::mat& v,
-                          arma::mat& sigma)
+inline void QUIC_SVD::ExtractSVD(arma::mat& u,
+                                 arma::mat& v,
+                                 arma::mat& sigma)
 {
   // Calculate A * V_hat, necessary for further calculations.
   arma::mat projectedMat;
@@ -36,9 +36,25 @@ void Radical::CopyAndPerturb(mat& xNew, const mat& x) const
 }
 
 
+void Radical::CopyAndPerturb(mat& xNew,
+                             const mat& x,
+                             boost::mt19937& generator) const
+{
+  // This does not reallocate if xNew already has the right size.
+  xNew.set_size(replicates * x.n_rows, x.n_cols);
+
+  boost::normal_distribution<> normal;
+  for (size_t c = 0; c < x.n_cols; c++)
+    for (size_t r = 0; r < replicates; r++)
+      for (size_t i = 0; i < x.n_rows; i++)
+        xNew(r * x.n_rows + i, c) = x(i, c) + noiseStdDev * normal(generator);
+}
+
+
 double Radical::Vasicek(vec& z) const
 {
-  z = sort(z);
+  // Sort in place, without a temporary copy.
+  std::sort(z.begin(), z.end());
 
   // Apparently slower.
   /*
@@ -63,6 +79,12 @@ double Radical::DoRadical2D(const mat& matX)
 {
   CopyAndPerturb(perturbed, matX);
 
+  return Radical2D(perturbed, candidate);
+}
+
+
+double Radical::Radical2D(const mat& xPerturbed, mat& xRotated) const
+{
   mat::fixed<2, 2> matJacobi;
 
   vec values(angles);
@@ -78,9 +100,11 @@ double Radical::DoRadical2D(const mat& matX)
     matJacobi(0, 1) = sinTheta;
     matJacobi(1, 1) = cosTheta;
 
-    candidate = perturbed * matJacobi;
-    vec candidateY1 = candidate.unsafe_col(0);
-    vec candidateY2 = candidate.unsafe_col(1);
+    // The rotated data has the same size for every angle, so it is not
+    // reallocated, and its columns are sorted in place by Vasicek().
+    xRotated = xPerturbed * matJacobi;
+    vec candidateY1 = xRotated.unsafe_col(0);
+    vec candidateY2 = xRotated.unsafe_col(1);
 
     values(i) = Vasicek(candidateY1) + Vasicek(candidateY2);
   }
@@ -125,42 +149,82 @@ void Radical::DoRadical(const mat& matXT, mat& matY, mat& matW)
   Timer::Start("radical_do_radical");
   matW = matWhitening;
 
-  mat matYSubspace(nPoints, 2);
-
-  mat matJ = eye(nDims, nDims);
+  // Each sweep visits every pair of dimensions once, in the rounds of a
+  // round-robin tournament (the circle method): with an even number of players
+  // (a dummy dimension is added if nDims is odd), the last player meets player
+  // r in round r, and the other players are paired around a circle.  The pairs
+  // of a round have no dimension in common, so their rotations are
+  // independent.
+  const size_t players = nDims + (nDims % 2);
+  std::vector<std::pair<size_t, size_t> > pairs;
+  std::vector<double> thetas;
 
   for (size_t sweepNum = 0; sweepNum < sweeps; sweepNum++)
   {
     Log::Info << "RADICAL: sweep " << sweepNum << "." << std::endl;
 
-    for (size_t i = 0; i < nDims - 1; i++)
+    for (size_t round = 0; round + 1 < players; round++)
     {
-      for (size_t j = i + 1; j < nDims; j++)
+      pairs.clear();
+      for (size_t k = 0; k < players / 2; k++)
       {
-        Log::Debug << "RADICAL 2D on dimensions " << i << " and " << j << "."
-            << std::endl;
+        const size_t a = (k == 0) ? players - 1 :
+            (round + k) % (players - 1);
+        const size_t b = (round + players - 1 - k) % (players - 1);
 
-        matYSubspace.col(0) = matY.col(i);
-        matYSubspace.col(1) = matY.col(j);
-
-        const double thetaOpt = DoRadical2D(matYSubspace);
-
-        const double cosThetaOpt = cos(thetaOpt);
-        const double sinThetaOpt = sin(thetaOpt);
+        // Skip the dummy dimension.
+        if ((a < nDims) && (b < nDims))
+          pairs.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+      }
 
-        // Set elements of transformation matrix.
-        matJ(i, i) = cosThetaOpt;
-        matJ(j, i) = -sinThetaOpt;
-        matJ(i, j) = sinThetaOpt;
-        matJ(j, j) = cosThetaOpt;
+      // Each pair has its own random number stream, so that the results do not
+      // depend on the order the pairs are run in.
+      thetas.resize(pairs.size());
+      const uint64_t streamKey = math::NewStreamKey();
+      for (size_t p = 0; p < pairs.size(); p++)
+      {
+        Log::Debug << "RADICAL 2D on dimensions " << pairs[p].first << " and "
+            << pairs[p].second << "." << std::endl;
+      }
 
-        matY *= matJ;
+      #pragma omp parallel
+      {
+        mat matYSubspace(nPoints, 2);
+        mat threadPerturbed, threadCandidate;
+
+        #pragma omp for schedule(dynamic)
+        for (size_t p = 0; p < pairs.size(); p++)
+        {
+          matYSubspace.col(0) = matY.col(pairs[p].first);
+          matYSubspace.col(1) = matY.col(pairs[p].second);
+
+          boost::mt19937 generator(math::StreamSeed(streamKey, p));
+          CopyAndPerturb(threadPerturbed, matYSubspace, generator);
+          thetas[p] = Radical2D(threadPerturbed, threadCandidate);
+        }
+      }
 
-        // Unset elements of transformation matrix, so matJ = eye() again.
-        matJ(i, i) = 1;
-        matJ(j, i) = 0;
-        matJ(i, j) = 0;
-        matJ(j, j) = 1;
+      // Rotate each pair of dimensions; this is matY *= matJ, where matJ is the
+      // identity except for the rotation of dimensions i and j, but only the
+      // two columns which change are computed.
+      #pragma omp parallel for schedule(static)
+      for (size_t p = 0; p < pairs.size(); p++)
+      {
+        const size_t i = pairs[p].first;
+        const size_t j = pairs[p].second;
+
+        const double cosThetaOpt = cos(thetas[p]);
+        const double sinThetaOpt = sin(thetas[p]);
+
+        double* yi = matY.colptr(i);
+        double* yj = matY.colptr(j);
+        for (size_t n = 0; n < nPoints; n++)
+        {
+          const double valueI = yi[n];
+          const double valueJ = yj[n];
+          yi[n] = cosThetaOpt * valueI - sinThetaOpt * valueJ;
+          yj[n] = sinThetaOpt * valueI + cosThetaOpt * valueJ;
+        }
       }
     }
   }
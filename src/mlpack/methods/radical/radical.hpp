@@ -58,7 +58,9 @@ class Radical
           const size_t m = 0);
 
   /**
-   * Run RADICAL.
+   * Run RADICAL.  Each sweep is split into rounds of disjoint pairs of
+   * dimensions (a round-robin tournament schedule), and the pairs of a round,
+   * which rotate independent coordinates, are processed in parallel.
    *
    * @param matX Input data into the algorithm - a matrix where each column is
    *    a point and each row is a dimension.
@@ -70,7 +72,7 @@ class Radical
 
   /**
    * Vasicek's m-spacing estimator of entropy, with overlap modification from
-   * (Learned-Miller and Fisher, 2003).
+   * (Learned-Miller and Fisher, 2003).  The sample is sorted in place.
    *
    * @param x Empirical sample (one-dimensional) over which to estimate entropy.
    */
@@ -131,6 +133,24 @@ class Radical
   arma::mat perturbed;
   //! Internal matrix, held as member variable to prevent memory reallocations.
   arma::mat candidate;
+
+  /**
+   * Make replicates of each data point and perturb them with Gaussian noise,
+   * drawn from the given generator (so that several threads can do this at
+   * once).
+   */
+  void CopyAndPerturb(arma::mat& xNew,
+                      const arma::mat& x,
+                      boost::mt19937& generator) const;
+
+  /**
+   * Find the rotation angle which minimizes the sum of the entropies of the two
+   * dimensions of the given perturbed data, by brute-force search.
+   *
+   * @param xPerturbed Perturbed replicates of the two-dimensional data.
+   * @param xRotated Buffer for the rotated data.
+   */
+  double Radical2D(const arma::mat& xPerturbed, arma::mat& xRotated) const;
 };
 
 void WhitenFeatureMajorMatrix(const arma::mat& matX,
@@ -0,0 +1,59 @@
+/**
+ * @file randomized_svd.cpp
+ *
+ * Implementation of the randomized truncated SVD.
+ */
+#include "randomized_svd.hpp"
+
+using namespace mlpack;
+using namespace mlpack::svd;
+
+RandomizedSVD::RandomizedSVD(const size_t iteratedPower,
+                             const size_t oversampling) :
+    iteratedPower(iteratedPower),
+    oversampling(oversampling)
+{
+  // Nothing to do.
+}
+
+void RandomizedSVD::Apply(const arma::mat& data,
+                          arma::mat& u,
+                          arma::vec& sigma,
+                          arma::mat& v,
+                          const size_t rank) const
+{
+  const size_t maxRank = std::min(data.n_rows, data.n_cols);
+  if (rank == 0 || rank > maxRank)
+    Log::Fatal << "RandomizedSVD::Apply(): rank (" << rank << ") must be "
+        << "between 1 and " << maxRank << "!" << std::endl;
+
+  const size_t l = std::min(rank + oversampling, maxRank);
+
+  // Find an orthonormal basis of the range of the data, and refine it with
+  // the power iterations.
+  arma::mat q, r, z;
+  arma::qr_econ(q, r, data * arma::randn<arma::mat>(data.n_cols, l));
+  for (size_t i = 0; i < iteratedPower; ++i)
+  {
+    arma::qr_econ(z, r, arma::trans(data) * q);
+    arma::qr_econ(q, r, data * z);
+  }
+
+  // Decompose the projection of the data onto the basis, which is only l x n.
+  arma::mat b = arma::trans(q) * data;
+  arma::mat uB;
+  arma::svd_econ(uB, sigma, v, b);
+
+  u = q * uB.cols(0, rank - 1);
+  sigma = sigma.subvec(0, rank - 1);
+  v = v.cols(0, rank - 1);
+}
+
+std::string RandomizedSVD::ToString() const
+{
+  std::ostringstream convert;
+  convert << "RandomizedSVD [" << this << "]" << std::endl;
+  convert << "  Power iterations: " << iteratedPower << std::endl;
+  convert << "  Oversampling: " << oversampling << std::endl;
+  return convert.str();
+}
@@ -0,0 +1,105 @@
+/**
+ * @file randomized_svd.hpp
+ *
+ * An implementation of the randomized truncated SVD of Halko, Martinsson and
+ * Tropp.
+ */
+#ifndef __MLPACK_METHODS_RANDOMIZED_SVD_RANDOMIZED_SVD_HPP
+#define __MLPACK_METHODS_RANDOMIZED_SVD_RANDOMIZED_SVD_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace svd {
+
+/**
+ * Randomized SVD computes an approximation of the largest singular values and
+ * the corresponding singular vectors of a matrix, without decomposing the
+ * full matrix.  An orthonormal basis Q of the range of A is found by
+ * multiplying A with a random Gaussian matrix with (rank + oversampling)
+ * columns; the basis is refined with a few power iterations (with
+ * re-orthonormalization after each product), which help when the singular
+ * values decay slowly.  Then the small matrix Q^T A is decomposed exactly.
+ * For an m x n matrix, this takes O(m n (rank + oversampling)) time, instead
+ * of the O(m n min(m, n)) of a full SVD.  Technical details can be found in
+ * the following paper:
+ *
+ * @code
+ * @article{halko2011finding,
+ *   title={Finding structure with randomness: Probabilistic algorithms for
+ *       constructing approximate matrix decompositions},
+ *   author={Halko, Nathan and Martinsson, Per-Gunnar and Tropp, Joel A},
+ *   journal={SIAM Review},
+ *   volume={53},
+ *   number={2},
+ *   pages={217--288},
+ *   year={2011}
+ * }
+ * @endcode
+ *
+ * An example of how to use the interface is shown below:
+ *
+ * @code
+ * arma::mat data; // Data matrix.
+ *
+ * arma::mat u, v; // data is approximately u * diagmat(sigma) * v.t().
+ * arma::vec sigma;
+ *
+ * // Compute the 10 largest singular values with 2 power iterations.
+ * RandomizedSVD rsvd(2);
+ * rsvd.Apply(data, u, sigma, v, 10);
+ * @endcode
+ */
+class RandomizedSVD
+{
+ public:
+  /**
+   * Create the RandomizedSVD object.
+   *
+   * @param iteratedPower Number of power iterations.
+   * @param oversampling Number of columns of the random matrix beyond the rank.
+   */
+  RandomizedSVD(const size_t iteratedPower = 2,
+                const size_t oversampling = 10);
+
+  /**
+   * Compute an approximation of the given number of largest singular values
+   * of the given matrix, and of the corresponding singular vectors.  The
+   * singular values are in decreasing order.
+   *
+   * @param data Matrix to decompose.
+   * @param u Matrix to store the left singular vectors in (one per column).
+   * @param sigma Vector to store the singular values in.
+   * @param v Matrix to store the right singular vectors in (one per column).
+   * @param rank Number of singular values to compute.
+   */
+  void Apply(const arma::mat& data,
+             arma::mat& u,
+             arma::vec& sigma,
+             arma::mat& v,
+             const size_t rank) const;
+
+  //! Get the number of power iterations.
+  size_t IteratedPower() const { return iteratedPower; }
+  //! Modify the number of power iterations.
+  size_t& IteratedPower() { return iteratedPower; }
+
+  //! Get the oversampling.
+  size_t Oversampling() const { return oversampling; }
+  //! Modify the oversampling.
+  size_t& Oversampling() { return oversampling; }
+
+  // Returns a string representation of this object.
+  std::string ToString() const;
+
+ private:
+  //! Number of power iterations.
+  size_t iteratedPower;
+  //! Number of columns of the random matrix beyond the rank.
+  size_t oversampling;
+};
+
+}; // namespace svd
+}; // namespace mlpack
+
+#endif
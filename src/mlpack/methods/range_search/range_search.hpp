@@ -36,8 +36,9 @@ class RangeSearch
    * distance metric holds data.
    *
    * This method will copy the matrices to internal copies, which are rearranged
-   * during tree-building.  You can avoid this extra copy by pre-constructing
-   * the trees and passing them using a different constructor.
+   * during tree-building.  You can avoid this extra copy by letting the object
+   * rearrange the matrices in place, or by pre-constructing the trees, with a
+   * different constructor.
    *
    * @param referenceSet Reference dataset.
    * @param querySet Query dataset.
@@ -77,6 +78,95 @@ class RangeSearch
               const bool singleMode = false,
               const MetricType metric = MetricType());
 
+  /**
+   * Initialize the RangeSearch object, building the trees on the given query
+   * and reference datasets in place, so that no copy of either is made.  If
+   * the tree type rearranges the dataset during tree-building, the matrices are
+   * rearranged, and the original index of each point is stored in
+   * oldFromNewReferences and oldFromNewQueries (which are otherwise left
+   * empty).  The results of Search() still use the original indices.  The
+   * matrices must not be modified or destroyed while this object exists.  In
+   * single-tree mode, no query tree is built, so the query set is not modified.
+   *
+   * @param referenceSet Reference dataset (rearranged in place).
+   * @param querySet Query dataset (rearranged in place).
+   * @param oldFromNewReferences Filled with the original index of each
+   *      rearranged reference point.
+   * @param oldFromNewQueries Filled with the original index of each rearranged
+   *      query point.
+   * @param singleMode Whether single-tree computation should be used (as
+   *      opposed to dual-tree computation).
+   * @param metric Instantiated distance metric.
+   */
+  RangeSearch(typename TreeType::Mat& referenceSet,
+              typename TreeType::Mat& querySet,
+              std::vector<size_t>& oldFromNewReferences,
+              std::vector<size_t>& oldFromNewQueries,
+              const bool singleMode = false,
+              const MetricType metric = MetricType());
+
+  /**
+   * Initialize the RangeSearch object, building the tree on the given dataset
+   * in place, so that no copy of it is made; the dataset is also used as the
+   * query set.  If the tree type rearranges the dataset during tree-building,
+   * the matrix is rearranged, and the original index of each point is stored in
+   * oldFromNewReferences (which is otherwise left empty).  The results of
+   * Search() still use the original indices.  The matrix must not be modified
+   * or destroyed while this object exists.
+   *
+   * @param referenceSet Reference dataset (rearranged in place).
+   * @param oldFromNewReferences Filled with the original index of each
+   *      rearranged point.
+   * @param singleMode Whether single-tree computation should be used (as
+   *      opposed to dual-tree computation).
+   * @param metric Instantiated distance metric.
+   */
+  RangeSearch(typename TreeType::Mat& referenceSet,
+              std::vector<size_t>& oldFromNewReferences,
+              const bool singleMode = false,
+              const MetricType metric = MetricType());
+
+  /**
+   * Initialize the RangeSearch object, taking ownership of the given query and
+   * reference datasets, so that neither is copied; the trees are built on the
+   * moved matrices.  The results of Search() use the original indices.
+   * Otherwise, this is the same as the constructor which copies the datasets.
+   *
+   * @param referenceSet Reference dataset (moved into this object).
+   * @param querySet Query dataset (moved into this object).
+   * @param naive If true, brute force naive search will be used (as opposed
+   *      to dual-tree search).  This overrides singleMode (if it is set to
+   *      true).
+   * @param singleMode If true, single-tree search will be used (as opposed to
+   *      dual-tree search).
+   * @param metric Instantiated distance metric.
+   */
+  RangeSearch(typename TreeType::Mat&& referenceSet,
+              typename TreeType::Mat&& querySet,
+              const bool naive = false,
+              const bool singleMode = false,
+              const MetricType metric = MetricType());
+
+  /**
+   * Initialize the RangeSearch object, taking ownership of the given dataset,
+   * which is used as both the query and the reference dataset, so that it is
+   * not copied; the tree is built on the moved matrix.  The results of
+   * Search() use the original indices.  Otherwise, this is the same as the
+   * constructor which copies the dataset.
+   *
+   * @param referenceSet Reference dataset (moved into this object).
+   * @param naive If true, brute force naive search will be used (as opposed
+   *      to dual-tree search).  This overrides singleMode (if it is set to
+   *      true).
+   * @param singleMode If true, single-tree search will be used (as opposed to
+   *      dual-tree search).
+   * @param metric Instantiated distance metric.
+   */
+  RangeSearch(typename TreeType::Mat&& referenceSet,
+              const bool naive = false,
+              const bool singleMode = false,
+              const MetricType metric = MetricType());
+
   /**
    * Initialize the RangeSearch object with the given datasets and
    * pre-constructed trees.  It is assumed that the points in referenceSet and
@@ -181,6 +271,70 @@ class RangeSearch
               std::vector<std::vector<size_t> >& neighbors,
               std::vector<std::vector<double> >& distances);
 
+  /**
+   * Search for all points in the given range, returning the results in
+   * compressed sparse row form.  This takes much less memory and time than the
+   * other overload of Search() when there are many query points, because no
+   * vector is allocated for each query point.
+   *
+   * That is:
+   *
+   * - offsets.n_elem equals the number of query points plus one, and
+   *   neighbors.n_elem and distances.n_elem both equal offsets[n_queries], the
+   *   total number of results.
+   *
+   * - neighbors[offsets[i]] to neighbors[offsets[i + 1] - 1] are the indices
+   *   of all the points in the reference set which have distances inside the
+   *   given range to query point i.
+   *
+   * - distances[j] is the distance corresponding to the index neighbors[j].
+   *
+   * - The results of each query point are not sorted in any particular order.
+   *
+   * @param range Range of distances in which to search.
+   * @param offsets Object which will hold the offset of the results of each
+   *      query point in neighbors and distances.
+   * @param neighbors Object which will hold the indices of the points which
+   *      fell into the given range, for each query point.
+   * @param distances Object which will hold the distances of the points which
+   *      fell into the given range, for each query point.
+   */
+  void Search(const math::Range& range,
+              arma::Col<size_t>& offsets,
+              arma::Col<size_t>& neighbors,
+              arma::vec& distances);
+
+  /**
+   * Count the points in the given range of each query point, without storing
+   * them.  A reference node which lies entirely inside the range is counted
+   * without visiting its points or computing any distances, so this is much
+   * faster than Search() when the counts are all that is needed (as in density
+   * estimation).
+   *
+   * @param range Range of distances in which to search.
+   * @param counts Object which will hold the number of reference points in the
+   *      given range of each query point.
+   */
+  void Count(const math::Range& range, arma::Col<size_t>& counts);
+
+  /**
+   * Search for all points in the given range, passing each result to the
+   * given visitor as soon as it is found instead of storing it.  The visitor
+   * is called as
+   *
+   * @code
+   * visitor(queryIndex, referenceIndex, distance);
+   * @endcode
+   *
+   * with the same indices the other overloads of Search() return, for each
+   * pair of query and reference points in range, in no particular order.
+   *
+   * @param range Range of distances in which to search.
+   * @param visitor Functor to call for each result.
+   */
+  template<typename VisitorType>
+  void Search(const math::Range& range, VisitorType& visitor);
+
   // Returns a string representation of this object. 
   std::string ToString() const;
 
@@ -221,6 +375,16 @@ class RangeSearch
 
   //! The number of pruned nodes during computation.
   size_t numPrunes;
+
+  //! Run the search with the given rules, in naive, single-tree, or dual-tree
+  //! mode.
+  template<typename RuleType>
+  void Traverse(RuleType& rules);
+
+  //! Get the mappings to apply to the query and reference indices of results
+  //! (each is NULL if no mapping is needed).
+  void IndexMappings(const std::vector<size_t>*& queryMap,
+                     const std::vector<size_t>*& referenceMap) const;
 };
 
 }; // namespace range
@@ -126,6 +126,129 @@ RangeSearch<MetricType, TreeType>::RangeSearch(
   Timer::Stop("range_search/tree_building");
 }
 
+template<typename MetricType, typename TreeType>
+RangeSearch<MetricType, TreeType>::RangeSearch(
+    typename TreeType::Mat& referenceSetIn,
+    typename TreeType::Mat& querySetIn,
+    std::vector<size_t>& oldFromNewReferencesOut,
+    std::vector<size_t>& oldFromNewQueriesOut,
+    const bool singleMode,
+    const MetricType metric) :
+    referenceSet(referenceSetIn),
+    querySet(querySetIn),
+    queryTree(NULL),
+    treeOwner(true),
+    hasQuerySet(true),
+    naive(false),
+    singleMode(singleMode),
+    metric(metric),
+    numPrunes(0)
+{
+  // Build the trees on the given matrices.
+  Timer::Start("range_search/tree_building");
+
+  referenceTree = BuildTree<TreeType>(referenceSetIn, oldFromNewReferences);
+  if (!singleMode)
+    queryTree = BuildTree<TreeType>(querySetIn, oldFromNewQueries);
+
+  Timer::Stop("range_search/tree_building");
+
+  // The mappings are kept to map the results of Search().
+  oldFromNewReferencesOut = oldFromNewReferences;
+  oldFromNewQueriesOut = oldFromNewQueries;
+}
+
+template<typename MetricType, typename TreeType>
+RangeSearch<MetricType, TreeType>::RangeSearch(
+    typename TreeType::Mat& referenceSetIn,
+    std::vector<size_t>& oldFromNewReferencesOut,
+    const bool singleMode,
+    const MetricType metric) :
+    referenceSet(referenceSetIn),
+    querySet(referenceSetIn),
+    queryTree(NULL),
+    treeOwner(true),
+    hasQuerySet(false),
+    naive(false),
+    singleMode(singleMode),
+    metric(metric),
+    numPrunes(0)
+{
+  // Build the tree on the given matrix.
+  Timer::Start("range_search/tree_building");
+
+  referenceTree = BuildTree<TreeType>(referenceSetIn, oldFromNewReferences);
+  if (!singleMode)
+    queryTree = new TreeType(*referenceTree);
+
+  Timer::Stop("range_search/tree_building");
+
+  // The mapping is kept to map the results of Search().
+  oldFromNewReferencesOut = oldFromNewReferences;
+}
+
+template<typename MetricType, typename TreeType>
+RangeSearch<MetricType, TreeType>::RangeSearch(
+    typename TreeType::Mat&& referenceSetIn,
+    typename TreeType::Mat&& querySetIn,
+    const bool naive,
+    const bool singleMode,
+    const MetricType metric) :
+    referenceCopy(std::move(referenceSetIn)),
+    queryCopy(std::move(querySetIn)),
+    referenceSet(referenceCopy),
+    querySet(queryCopy),
+    queryTree(NULL),
+    treeOwner(!naive), // If in naive mode, we are not building any trees.
+    hasQuerySet(true),
+    naive(naive),
+    singleMode(!naive && singleMode), // Naive overrides single mode.
+    metric(metric),
+    numPrunes(0)
+{
+  // Build the trees on the matrices, which are our own.
+  Timer::Start("range_search/tree_building");
+
+  if (!naive)
+  {
+    referenceTree = BuildTree<TreeType>(referenceCopy, oldFromNewReferences);
+    if (!singleMode)
+      queryTree = BuildTree<TreeType>(queryCopy, oldFromNewQueries);
+  }
+
+  Timer::Stop("range_search/tree_building");
+}
+
+template<typename MetricType, typename TreeType>
+RangeSearch<MetricType, TreeType>::RangeSearch(
+    typename TreeType::Mat&& referenceSetIn,
+    const bool naive,
+    const bool singleMode,
+    const MetricType metric) :
+    referenceCopy(std::move(referenceSetIn)),
+    referenceSet(referenceCopy),
+    querySet(referenceCopy),
+    queryTree(NULL),
+    treeOwner(!naive), // If in naive mode, we are not building any trees.
+    hasQuerySet(false),
+    naive(naive),
+    singleMode(!naive && singleMode), // Naive overrides single mode.
+    metric(metric),
+    numPrunes(0)
+{
+  // Build the tree on the matrix, which is our own.
+  Timer::Start("range_search/tree_building");
+
+  if (!naive)
+  {
+    referenceTree = BuildTree<TreeType>(referenceCopy, oldFromNewReferences);
+    if (!singleMode)
+      queryTree = new TreeType(*referenceTree);
+  }
+
+  Timer::Stop("range_search/tree_building");
+}
+
 template<typename MetricType, typename TreeType>
 RangeSearch<MetricType, TreeType>::RangeSearch(
     TreeType* referenceTree,
@@ -221,37 +344,11 @@ void RangeSearch<MetricType, TreeType>::Search(
   distancePtr->resize(querySet.n_cols);
 
   // Create the helper object for the traversal.
-  typedef RangeSearchRules<MetricType, TreeType> RuleType;
-  RuleType rules(referenceSet, querySet, range, *neighborPtr, *distancePtr,
-      metric);
-
-  if (naive)
-  {
-    // The naive brute-force solution.
-    for (size_t i = 0; i < querySet.n_cols; ++i)
-      for (size_t j = 0; j < referenceSet.n_cols; ++j)
-        rules.BaseCase(i, j);
-  }
-  else if (singleMode)
-  {
-    // Create the traverser.
-    typename TreeType::template SingleTreeTraverser<RuleType> traverser(rules);
-
-    // Now have it traverse for each point.
-    for (size_t i = 0; i < querySet.n_cols; ++i)
-      traverser.Traverse(i, *referenceTree);
-
-    numPrunes = traverser.NumPrunes();
-  }
-  else // Dual-tree recursion.
-  {
-    // Create the traverser.
-    typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
+  NestedRangeResults results(*neighborPtr, *distancePtr);
+  RangeSearchRules<MetricType, TreeType> rules(referenceSet, querySet, range,
+      results, metric);
 
-    traverser.Traverse(*queryTree, *referenceTree);
-
-    numPrunes = traverser.NumPrunes();
-  }
+  Traverse(rules);
 
   Timer::Stop("range_search/computing_neighbors");
 
@@ -336,6 +433,157 @@ void RangeSearch<MetricType, TreeType>::Search(
   }
 }
 
+template<typename MetricType, typename TreeType>
+void RangeSearch<MetricType, TreeType>::Search(
+    const math::Range& range,
+    arma::Col<size_t>& offsets,
+    arma::Col<size_t>& neighbors,
+    arma::vec& distances)
+{
+  Timer::Start("range_search/computing_neighbors");
+
+  // Set size of prunes to 0.
+  numPrunes = 0;
+
+  FlatRangeResults results;
+  RangeSearchRules<MetricType, TreeType, FlatRangeResults> rules(referenceSet,
+      querySet, range, results, metric);
+
+  Traverse(rules);
+
+  Log::Info << "Number of pruned nodes during computation: " << numPrunes
+      << "." << std::endl;
+
+  // The indices are mapped back while the results are grouped by query point.
+  const std::vector<size_t>* queryMap;
+  const std::vector<size_t>* referenceMap;
+  IndexMappings(queryMap, referenceMap);
+
+  results.Finalize(querySet.n_cols, queryMap, referenceMap, offsets, neighbors,
+      distances);
+
+  Timer::Stop("range_search/computing_neighbors");
+}
+
+template<typename MetricType, typename TreeType>
+void RangeSearch<MetricType, TreeType>::Count(const math::Range& range,
+                                              arma::Col<size_t>& counts)
+{
+  Timer::Start("range_search/computing_neighbors");
+
+  // Set size of prunes to 0.
+  numPrunes = 0;
+
+  // Count into a temporary vector if the query points must be mapped.
+  const std::vector<size_t>* queryMap;
+  const std::vector<size_t>* referenceMap;
+  IndexMappings(queryMap, referenceMap);
+
+  arma::Col<size_t> unmappedCounts;
+  arma::Col<size_t>& countsOut = (queryMap) ? unmappedCounts : counts;
+  countsOut.zeros(querySet.n_cols);
+
+  CountRangeResults results(countsOut);
+  RangeSearchRules<MetricType, TreeType, CountRangeResults> rules(referenceSet,
+      querySet, range, results, metric);
+
+  Traverse(rules);
+
+  if (queryMap)
+  {
+    counts.set_size(querySet.n_cols);
+    for (size_t i = 0; i < unmappedCounts.n_elem; ++i)
+      counts[(*queryMap)[i]] = unmappedCounts[i];
+  }
+
+  Timer::Stop("range_search/computing_neighbors");
+
+  Log::Info << "Number of pruned nodes during computation: " << numPrunes
+      << "." << std::endl;
+}
+
+template<typename MetricType, typename TreeType>
+template<typename VisitorType>
+void RangeSearch<MetricType, TreeType>::Search(const math::Range& range,
+                                               VisitorType& visitor)
+{
+  Timer::Start("range_search/computing_neighbors");
+
+  // Set size of prunes to 0.
+  numPrunes = 0;
+
+  // The visitor is given the original indices of the points.
+  const std::vector<size_t>* queryMap;
+  const std::vector<size_t>* referenceMap;
+  IndexMappings(queryMap, referenceMap);
+
+  typedef CallbackRangeResults<VisitorType> ResultsType;
+  ResultsType results(visitor, queryMap, referenceMap);
+  RangeSearchRules<MetricType, TreeType, ResultsType> rules(referenceSet,
+      querySet, range, results, metric);
+
+  Traverse(rules);
+
+  Timer::Stop("range_search/computing_neighbors");
+
+  Log::Info << "Number of pruned nodes during computation: " << numPrunes
+      << "." << std::endl;
+}
+
+template<typename MetricType, typename TreeType>
+void RangeSearch<MetricType, TreeType>::IndexMappings(
+    const std::vector<size_t>*& queryMap,
+    const std::vector<size_t>*& referenceMap) const
+{
+  queryMap = NULL;
+  referenceMap = NULL;
+
+  // Mapping is only necessary if we built the trees, and they rearranged the
+  // points.
+  if (!treeOwner || !tree::TreeTraits<TreeType>::RearrangesDataset)
+    return;
+
+  referenceMap = &oldFromNewReferences;
+  if (!hasQuerySet)
+    queryMap = &oldFromNewReferences;
+  else if (!singleMode)
+    queryMap = &oldFromNewQueries;
+}
+
+template<typename MetricType, typename TreeType>
+template<typename RuleType>
+void RangeSearch<MetricType, TreeType>::Traverse(RuleType& rules)
+{
+  if (naive)
+  {
+    // The naive brute-force solution.
+    for (size_t i = 0; i < querySet.n_cols; ++i)
+      for (size_t j = 0; j < referenceSet.n_cols; ++j)
+        rules.BaseCase(i, j);
+  }
+  else if (singleMode)
+  {
+    // Create the traverser.
+    typename TreeType::template SingleTreeTraverser<RuleType> traverser(rules);
+
+    // Now have it traverse for each point.
+    for (size_t i = 0; i < querySet.n_cols; ++i)
+      traverser.Traverse(i, *referenceTree);
+
+    numPrunes = traverser.NumPrunes();
+  }
+  else // Dual-tree recursion.
+  {
+    // Create the traverser.
+    typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
+
+    traverser.Traverse(*queryTree, *referenceTree);
+
+    numPrunes = traverser.NumPrunes();
+  }
+
+}
+
 template<typename MetricType, typename TreeType>
 std::string RangeSearch<MetricType, TreeType>::ToString() const
 {
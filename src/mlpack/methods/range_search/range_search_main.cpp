@@ -9,6 +9,7 @@
 #include <mlpack/core.hpp>
 #include <mlpack/core/metrics/lmetric.hpp>
 #include <mlpack/core/tree/cover_tree.hpp>
+#include <mlpack/core/tree/rectangle_tree.hpp>
 
 #include "range_search.hpp"
 
@@ -45,11 +46,20 @@ PROGRAM_INFO("Range Search",
     " resultant CSV-like files may not be loadable by many programs.  However, "
     "at this time a better way to store this non-square result is not known.  "
     "As a result, any output files will be written as CSVs in this manner, "
-    "regardless of the given extension.");
+    "regardless of the given extension."
+    "\n\n"
+    "The reference kd-tree can be saved with --output_tree_file.  A saved tree "
+    "(from range_search or allknn) can be given with --input_tree_file instead "
+    "of --reference_file; then the reference set is loaded from the tree file "
+    "and the tree is not rebuilt."
+    "\n\n"
+    "With --ball_tree, ball trees are used instead of kd-trees: each node is "
+    "bounded by a ball instead of a hyperrectangle, which often prunes better "
+    "for high-dimensional data.");
 
 // Define our input parameters that this program will take.
-PARAM_STRING_REQ("reference_file", "File containing the reference dataset.",
-    "r");
+PARAM_STRING("reference_file", "File containing the reference dataset.",
+    "r", "");
 PARAM_STRING_REQ("distances_file", "File to output distances into.", "d");
 PARAM_STRING_REQ("neighbors_file", "File to output neighbors into.", "n");
 
@@ -58,17 +68,195 @@ PARAM_DOUBLE("min", "Lower bound in range.", "m", 0.0);
 
 PARAM_STRING("query_file", "File containing query points (optional).", "q", "");
 
+PARAM_STRING("input_tree_file", "File containing a reference kd-tree saved "
+    "with --output_tree_file, to use instead of --reference_file.", "i", "");
+PARAM_STRING("output_tree_file", "If specified, the reference kd-tree will be "
+    "saved to this file.", "o", "");
+
 PARAM_INT("leaf_size", "Leaf size for tree building.", "l", 20);
 PARAM_FLAG("naive", "If true, O(n^2) naive mode is used for computation.", "N");
 PARAM_FLAG("single_mode", "If true, single-tree search is used (as opposed to "
     "dual-tree search).", "s");
 PARAM_FLAG("cover_tree", "If true, use a cover tree for range searching "
     "(instead of a kd-tree).", "c");
+PARAM_FLAG("ball_tree", "If true, use ball trees for range searching (instead "
+    "of kd-trees).", "b");
+PARAM_FLAG("r_tree", "If true, use R*-trees for range searching (instead of "
+    "kd-trees).", "T");
 
 typedef RangeSearch<> RSType;
+typedef BinarySpaceTree<bound::HRectBound<2>, RangeSearchStat> TreeType;
 typedef CoverTree<metric::EuclideanDistance, tree::FirstPointIsRoot,
     RangeSearchStat> CoverTreeType;
 typedef RangeSearch<metric::EuclideanDistance, CoverTreeType> RSCoverType;
+typedef BinarySpaceTree<bound::BallBound<>, RangeSearchStat> BallTreeType;
+typedef RangeSearch<metric::EuclideanDistance, BallTreeType> RSBallType;
+typedef RectangleTree<RStarTreeSplit<RStarTreeDescentHeuristic,
+    RangeSearchStat, arma::mat>, RStarTreeDescentHeuristic, RangeSearchStat,
+    arma::mat> RTreeType;
+typedef RangeSearch<metric::EuclideanDistance, RTreeType> RSRType;
+
+/**
+ * Write range search results to a CSV-like file, one line per point, directly
+ * from their compressed sparse row form.
+ *
+ * @param filename File to write to.
+ * @param description What the values are, for warning messages.
+ * @param offsets Offsets of the rows in values.
+ * @param values Values of all rows.
+ * @param rowOfPoint Row to write on each line, or empty for row i on line i.
+ */
+template<typename eT>
+void WriteResults(const string& filename,
+                  const string& description,
+                  const arma::Col<size_t>& offsets,
+                  const arma::Col<eT>& values,
+                  const vector<size_t>& rowOfPoint)
+{
+  fstream stream(filename.c_str(), fstream::out);
+  if (!stream.is_open())
+  {
+    Log::Warn << "Cannot open file '" << filename << "' to save output "
+        << description << " to!" << endl;
+    return;
+  }
+
+  // Loop over each point.  We may have 0 values to store for a point, so we
+  // must account for that possibility.
+  const size_t numPoints = (offsets.n_elem == 0) ? 0 : offsets.n_elem - 1;
+  for (size_t i = 0; i < numPoints; ++i)
+  {
+    const size_t row = rowOfPoint.empty() ? i : rowOfPoint[i];
+    for (size_t j = offsets[row]; j < offsets[row + 1]; ++j)
+    {
+      if (j != offsets[row])
+        stream << ", ";
+      stream << values[j];
+    }
+
+    stream << "\n";
+  }
+
+  stream.close();
+}
+
+/**
+ * Run the search with ball trees.  The trees are built in parallel, like
+ * kd-trees.  The neighbor indices are mapped back to the original order of the
+ * reference points, and the row of the results for each point is stored in
+ * rowOfPoint.
+ */
+void BallTreeSearch(arma::mat& referenceData,
+                    arma::mat& queryData,
+                    const size_t leafSize,
+                    const bool singleMode,
+                    const math::Range& range,
+                    arma::Col<size_t>& offsets,
+                    arma::Col<size_t>& neighbors,
+                    arma::vec& distances,
+                    vector<size_t>& rowOfPoint)
+{
+  Log::Info << "Using ball trees." << endl;
+
+  Log::Info << "Building reference tree..." << endl;
+  Timer::Start("tree_building");
+  vector<size_t> oldFromNewRefs;
+  BallTreeType referenceTree(referenceData, oldFromNewRefs, leafSize);
+  Timer::Stop("tree_building");
+
+  RSBallType* rangeSearch = NULL;
+  BallTreeType* queryTree = NULL;
+  vector<size_t> oldFromNewQueries;
+
+  if (CLI::GetParam<string>("query_file") == "")
+  {
+    rangeSearch = new RSBallType(&referenceTree, referenceData, singleMode);
+  }
+  else
+  {
+    const string queryFile = CLI::GetParam<string>("query_file");
+    data::Load(queryFile, queryData, true);
+
+    Log::Info << "Building query tree..." << endl;
+    Timer::Start("tree_building");
+    queryTree = new BallTreeType(queryData, oldFromNewQueries, leafSize);
+    Timer::Stop("tree_building");
+
+    rangeSearch = new RSBallType(&referenceTree, queryTree, referenceData,
+        queryData, singleMode);
+  }
+
+  Log::Info << "Trees built." << endl;
+
+  rangeSearch->Search(range, offsets, neighbors, distances);
+
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+    neighbors[i] = oldFromNewRefs[neighbors[i]];
+
+  const vector<size_t>& oldFromNewRows = (queryTree != NULL) ?
+      oldFromNewQueries : oldFromNewRefs;
+  rowOfPoint.resize(oldFromNewRows.size());
+  for (size_t i = 0; i < oldFromNewRows.size(); ++i)
+    rowOfPoint[oldFromNewRows[i]] = i;
+
+  if (queryTree)
+    delete queryTree;
+  delete rangeSearch;
+}
+
+/**
+ * Run the search with R*-trees.  R*-trees hold the indices of the points, so
+ * nothing has to be mapped back to the original order.
+ */
+void RTreeSearch(arma::mat& referenceData,
+                 arma::mat& queryData,
+                 const size_t leafSize,
+                 const bool singleMode,
+                 const math::Range& range,
+                 arma::Col<size_t>& offsets,
+                 arma::Col<size_t>& neighbors,
+                 arma::vec& distances)
+{
+  Log::Info << "Using R*-trees." << endl;
+
+  Log::Info << "Building reference tree..." << endl;
+  Timer::Start("tree_building");
+  RTreeType referenceTree(referenceData, leafSize, leafSize * 0.4, 5, 2, 0);
+  Timer::Stop("tree_building");
+
+  RSRType* rangeSearch = NULL;
+  RTreeType* queryTree = NULL;
+
+  if (CLI::GetParam<string>("query_file") == "")
+  {
+    rangeSearch = new RSRType(&referenceTree, referenceData, singleMode);
+  }
+  else
+  {
+    const string queryFile = CLI::GetParam<string>("query_file");
+    data::Load(queryFile, queryData, true);
+
+    // The query tree is not used in single-tree mode.
+    if (!singleMode)
+    {
+      Log::Info << "Building query tree..." << endl;
+      Timer::Start("tree_building");
+      queryTree = new RTreeType(queryData, leafSize, leafSize * 0.4, 5, 2, 0);
+      Timer::Stop("tree_building");
+    }
+
+    rangeSearch = new RSRType(&referenceTree, queryTree, referenceData,
+        queryData, singleMode);
+  }
+
+  Log::Info << "Trees built." << endl;
+
+  rangeSearch->Search(range, offsets, neighbors, distances);
+
+  if (queryTree)
+    delete queryTree;
+  delete rangeSearch;
+}
 
 int main(int argc, char *argv[])
 {
@@ -77,6 +265,8 @@ int main(int argc, char *argv[])
 
   // Get all the parameters.
   string referenceFile = CLI::GetParam<string>("reference_file");
+  const string inputTreeFile = CLI::GetParam<string>("input_tree_file");
+  const string outputTreeFile = CLI::GetParam<string>("output_tree_file");
 
   string distancesFile = CLI::GetParam<string>("distances_file");
   string neighborsFile = CLI::GetParam<string>("neighbors_file");
@@ -89,13 +279,53 @@ int main(int argc, char *argv[])
   const bool naive = CLI::HasParam("naive");
   const bool singleMode = CLI::HasParam("single_mode");
   bool coverTree = CLI::HasParam("cover_tree");
+  bool ballTree = CLI::HasParam("ball_tree");
+  bool rTree = CLI::HasParam("r_tree");
+
+  // A saved tree can only be used as a kd-tree.
+  if (inputTreeFile != "")
+  {
+    if (referenceFile != "")
+      Log::Warn << "--reference_file ignored because --input_tree_file is "
+          << "present." << endl;
+    if (naive || coverTree || ballTree || rTree)
+      Log::Fatal << "--input_tree_file cannot be used with --naive, "
+          << "--cover_tree, --ball_tree, or --r_tree." << endl;
+  }
+  else if (referenceFile == "")
+  {
+    Log::Fatal << "Either --reference_file or --input_tree_file must be "
+        << "specified." << endl;
+  }
+
+  if (outputTreeFile != "" && (naive || coverTree || ballTree || rTree))
+    Log::Warn << "--output_tree_file ignored because only kd-trees can be "
+        << "saved." << endl;
 
   arma::mat referenceData;
   arma::mat queryData; // So it doesn't go out of scope.
-  if (!data::Load(referenceFile, referenceData))
-    Log::Fatal << "Reference file " << referenceFile << "not found." << endl;
 
-  Log::Info << "Loaded reference data from '" << referenceFile << "'." << endl;
+  // The reference kd-tree and its mapping, if we load it from a file.
+  TreeType* refTree = NULL;
+  vector<size_t> oldFromNewRefs;
+
+  if (inputTreeFile != "")
+  {
+    Timer::Start("tree_loading");
+    refTree = new TreeType(inputTreeFile, referenceData, oldFromNewRefs);
+    Timer::Stop("tree_loading");
+
+    Log::Info << "Loaded reference tree and data from '" << inputTreeFile
+        << "'." << endl;
+  }
+  else
+  {
+    if (!data::Load(referenceFile, referenceData))
+      Log::Fatal << "Reference file " << referenceFile << "not found." << endl;
+
+    Log::Info << "Loaded reference data from '" << referenceFile << "'."
+        << endl;
+  }
 
   // Sanity check on range value: max must be greater than min.
   if (max <= min)
@@ -127,11 +357,51 @@ int main(int argc, char *argv[])
     coverTree = false;
   }
 
-  vector<vector<size_t> > neighbors;
-  vector<vector<double> > distances;
+  if (ballTree && naive)
+  {
+    Log::Warn << "--ball_tree ignored because --naive is present." << endl;
+    ballTree = false;
+  }
+
+  if (rTree && naive)
+  {
+    Log::Warn << "--r_tree ignored because --naive is present." << endl;
+    rTree = false;
+  }
 
-  // The cover tree implies different types, so we must split this section.
-  if (coverTree)
+  if (ballTree && coverTree)
+  {
+    Log::Fatal << "--ball_tree cannot be used with --cover_tree." << endl;
+  }
+
+  if (rTree && (coverTree || ballTree))
+  {
+    Log::Fatal << "--r_tree cannot be used with --cover_tree or --ball_tree."
+        << endl;
+  }
+
+  // The results, in compressed sparse row form (see RangeSearch::Search()).
+  arma::Col<size_t> offsets;
+  arma::Col<size_t> neighbors;
+  arma::vec distances;
+
+  // Line i of the output files holds row rowOfPoint[i] of the results; if this
+  // is empty, line i holds row i.
+  vector<size_t> rowOfPoint;
+
+  // The cover tree, ball tree and R*-tree imply different types, so we must
+  // split this section.
+  if (ballTree)
+  {
+    BallTreeSearch(referenceData, queryData, leafSize, singleMode,
+        math::Range(min, max), offsets, neighbors, distances, rowOfPoint);
+  }
+  else if (rTree)
+  {
+    RTreeSearch(referenceData, queryData, leafSize, singleMode,
+        math::Range(min, max), offsets, neighbors, distances);
+  }
+  else if (coverTree)
   {
     Log::Info << "Using cover trees." << endl;
 
@@ -160,7 +430,7 @@ int main(int argc, char *argv[])
     Log::Info << "Trees built." << endl;
 
     const math::Range r(min, max);
-    rangeSearch->Search(r, neighbors, distances);
+    rangeSearch->Search(r, offsets, neighbors, distances);
 
     if (queryTree)
       delete queryTree;
@@ -171,20 +441,27 @@ int main(int argc, char *argv[])
     // Because we may construct it differently, we need a pointer.
     RSType* rangeSearch = NULL;
 
-    // Mappings for when we build the tree.
-    vector<size_t> oldFromNewRefs;
-
     // Build trees by hand, so we can save memory: if we pass a tree to
-    // NeighborSearch, it does not copy the matrix.
-    Log::Info << "Building reference tree..." << endl;
-    Timer::Start("tree_building");
+    // NeighborSearch, it does not copy the matrix.  If the reference tree was
+    // loaded from a file, there is nothing to build.
+    if (!refTree)
+    {
+      Log::Info << "Building reference tree..." << endl;
+      Timer::Start("tree_building");
 
-    BinarySpaceTree<bound::HRectBound<2>, RangeSearchStat>
-        refTree(referenceData, oldFromNewRefs, leafSize);
-    BinarySpaceTree<bound::HRectBound<2>, RangeSearchStat>*
-        queryTree = NULL; // Empty for now.
+      refTree = new TreeType(referenceData, oldFromNewRefs, leafSize);
 
-    Timer::Stop("tree_building");
+      Timer::Stop("tree_building");
+    }
+
+    if (outputTreeFile != "" && !naive)
+    {
+      refTree->Save(outputTreeFile, oldFromNewRefs);
+      Log::Info << "Saved reference tree to '" << outputTreeFile << "'."
+          << endl;
+    }
+
+    TreeType* queryTree = NULL; // Empty for now.
 
     vector<size_t> oldFromNewQueries;
 
@@ -204,19 +481,18 @@ int main(int argc, char *argv[])
       // NeighborSearch, it does not copy the matrix.
       Timer::Start("tree_building");
 
-      queryTree = new BinarySpaceTree<bound::HRectBound<2>,
-          RangeSearchStat>(queryData, oldFromNewQueries, leafSize);
+      queryTree = new TreeType(queryData, oldFromNewQueries, leafSize);
 
       Timer::Stop("tree_building");
 
-      rangeSearch = new RSType(&refTree, queryTree, referenceData, queryData,
+      rangeSearch = new RSType(refTree, queryTree, referenceData, queryData,
           singleMode);
 
       Log::Info << "Tree built." << endl;
     }
     else
     {
-      rangeSearch = new RSType(&refTree, referenceData, singleMode);
+      rangeSearch = new RSType(refTree, referenceData, singleMode);
 
       Log::Info << "Trees built." << endl;
     }
@@ -224,113 +500,35 @@ int main(int argc, char *argv[])
     Log::Info << "Computing neighbors within range [" << min << ", " << max
         << "]." << endl;
 
-    // Collect the results in these vectors before remapping.
-    vector<vector<double> > distancesOut;
-    vector<vector<size_t> > neighborsOut;
-
     const math::Range r(min, max);
-    rangeSearch->Search(r, neighborsOut, distancesOut);
+    rangeSearch->Search(r, offsets, neighbors, distances);
 
     Log::Info << "Neighbors computed." << endl;
 
     // We have to map back to the original indices from before the tree
-    // construction.
+    // construction.  The neighbor indices are mapped in place, and the rows are
+    // reordered while they are written.
     Log::Info << "Re-mapping indices..." << endl;
 
-    distances.resize(distancesOut.size());
-    neighbors.resize(neighborsOut.size());
+    for (size_t i = 0; i < neighbors.n_elem; ++i)
+      neighbors[i] = oldFromNewRefs[neighbors[i]];
 
-    // Do the actual remapping.
-    if (CLI::GetParam<string>("query_file") != "")
-    {
-      for (size_t i = 0; i < distances.size(); ++i)
-      {
-        // Map distances (copy a column).
-        distances[oldFromNewQueries[i]] = distancesOut[i];
-
-        // Map indices of neighbors.
-        neighbors[oldFromNewQueries[i]].resize(neighborsOut[i].size());
-        for (size_t j = 0; j < distancesOut[i].size(); ++j)
-        {
-          neighbors[oldFromNewQueries[i]][j] =
-              oldFromNewRefs[neighborsOut[i][j]];
-        }
-      }
-    }
-    else
-    {
-      for (size_t i = 0; i < distances.size(); ++i)
-      {
-        // Map distances (copy a column).
-        distances[oldFromNewRefs[i]] = distancesOut[i];
-
-        // Map indices of neighbors.
-        neighbors[oldFromNewRefs[i]].resize(neighborsOut[i].size());
-        for (size_t j = 0; j < distancesOut[i].size(); ++j)
-        {
-          neighbors[oldFromNewRefs[i]][j] = oldFromNewRefs[neighborsOut[i][j]];
-        }
-      }
-    }
+    const vector<size_t>& oldFromNewRows =
+        (CLI::GetParam<string>("query_file") != "") ? oldFromNewQueries :
+        oldFromNewRefs;
+    rowOfPoint.resize(oldFromNewRows.size());
+    for (size_t i = 0; i < oldFromNewRows.size(); ++i)
+      rowOfPoint[oldFromNewRows[i]] = i;
 
     // Clean up.
     if (queryTree)
       delete queryTree;
     delete rangeSearch;
+    delete refTree;
   }
 
   // Save output.  We have to do this by hand.
-  fstream distancesStr(distancesFile.c_str(), fstream::out);
-  if (!distancesStr.is_open())
-  {
-    Log::Warn << "Cannot open file '" << distancesFile << "' to save output "
-        << "distances to!" << endl;
-  }
-  else
-  {
-    // Loop over each point.
-    for (size_t i = 0; i < distances.size(); ++i)
-    {
-      // Store the distances of each point.  We may have 0 points to store, so
-      // we must account for that possibility.
-      for (size_t j = 0; j + 1 < distances[i].size(); ++j)
-      {
-        distancesStr << distances[i][j] << ", ";
-      }
-
-      if (distances[i].size() > 0)
-        distancesStr << distances[i][distances[i].size() - 1];
-
-      distancesStr << endl;
-    }
-
-    distancesStr.close();
-  }
-
-  fstream neighborsStr(neighborsFile.c_str(), fstream::out);
-  if (!neighborsStr.is_open())
-  {
-    Log::Warn << "Cannot open file '" << neighborsFile << "' to save output "
-        << "neighbor indices to!" << endl;
-  }
-  else
-  {
-    // Loop over each point.
-    for (size_t i = 0; i < neighbors.size(); ++i)
-    {
-      // Store the neighbors of each point.  We may have 0 points to store, so
-      // we must account for that possibility.
-      for (size_t j = 0; j + 1 < neighbors[i].size(); ++j)
-      {
-        neighborsStr << neighbors[i][j] << ", ";
-      }
-
-      if (neighbors[i].size() > 0)
-        neighborsStr << neighbors[i][neighbors[i].size() - 1];
-
-      neighborsStr << endl;
-    }
-
-    neighborsStr.close();
-  }
+  WriteResults(distancesFile, "distances", offsets, distances, rowOfPoint);
+  WriteResults(neighborsFile, "neighbor indices", offsets, neighbors,
+      rowOfPoint);
 }
@@ -0,0 +1,263 @@
+/**
+ * @file range_search_results.hpp
+ *
+ * Result containers for RangeSearchRules.  NestedRangeResults stores the
+ * results of each query point in its own std::vector; FlatRangeResults stores
+ * all results in a few flat buffers, which are converted to compressed sparse
+ * row (CSR) form once the search is finished.  CountRangeResults only counts
+ * the results of each query point, and CallbackRangeResults passes each result
+ * to a visitor without storing it.
+ *
+ * Each class has an Add() method for a single result and a Reserve() hint, and
+ * sets CountsOnly; if CountsOnly is true, the class also has AddCount(), and
+ * RangeSearchRules uses it to add whole nodes without computing any distances.
+ */
+#ifndef __MLPACK_METHODS_RANGE_SEARCH_RANGE_SEARCH_RESULTS_HPP
+#define __MLPACK_METHODS_RANGE_SEARCH_RANGE_SEARCH_RESULTS_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace range {
+
+/**
+ * Store range search results as one vector of neighbors and one vector of
+ * distances for each query point.
+ */
+class NestedRangeResults
+{
+ public:
+  //! Every result is stored.
+  static const bool CountsOnly = false;
+
+  /**
+   * Store results in the given objects, which must already have one element
+   * for each query point.
+   *
+   * @param neighbors Vector to store the neighbors of each query point in.
+   * @param distances Vector to store the distances of each query point in.
+   */
+  NestedRangeResults(std::vector<std::vector<size_t> >& neighbors,
+                     std::vector<std::vector<double> >& distances) :
+      neighbors(neighbors),
+      distances(distances)
+  { /* Nothing to do. */ }
+
+  //! Prepare to add up to the given number of results for the query point.
+  void Reserve(const size_t queryIndex, const size_t count)
+  {
+    neighbors[queryIndex].reserve(neighbors[queryIndex].size() + count);
+    distances[queryIndex].reserve(distances[queryIndex].size() + count);
+  }
+
+  //! Add a result for the given query point.
+  void Add(const size_t queryIndex,
+           const size_t referenceIndex,
+           const double distance)
+  {
+    neighbors[queryIndex].push_back(referenceIndex);
+    distances[queryIndex].push_back(distance);
+  }
+
+ private:
+  //! The neighbors of each query point.
+  std::vector<std::vector<size_t> >& neighbors;
+  //! The distances of each query point.
+  std::vector<std::vector<double> >& distances;
+};
+
+/**
+ * Store range search results in flat buffers, in the order they are found, and
+ * convert them to compressed sparse row form afterwards with Finalize().  This
+ * avoids one allocation (and its regrowth) per query point, which dominates the
+ * cost of the search when there are many query points with few results each.
+ *
+ * Each RangeSearchRules object holds its own FlatRangeResults, so when several
+ * searches run at once, each one grows its own buffers.
+ */
+class FlatRangeResults
+{
+ public:
+  //! Every result is stored.
+  static const bool CountsOnly = false;
+
+  //! Create an empty result set.
+  FlatRangeResults() { /* Nothing to do. */ }
+
+  //! Results are not grouped by query point, so there is nothing to reserve.
+  void Reserve(const size_t /* queryIndex */, const size_t /* count */) { }
+
+  //! Add a result for the given query point.
+  void Add(const size_t queryIndex,
+           const size_t referenceIndex,
+           const double distance)
+  {
+    queries.push_back(queryIndex);
+    references.push_back(referenceIndex);
+    resultDistances.push_back(distance);
+  }
+
+  //! Get the number of results found so far.
+  size_t Size() const { return queries.size(); }
+
+  /**
+   * Convert the results to compressed sparse row form: the neighbors of query
+   * point i are neighbors[offsets[i]] to neighbors[offsets[i + 1] - 1], and
+   * their distances are the corresponding elements of distances.  The results
+   * of each query point keep the order they were found in.  The buffers of
+   * this object are emptied.
+   *
+   * If queryMap (or referenceMap) is not NULL, every query (or reference)
+   * index i is replaced with (*queryMap)[i] (or (*referenceMap)[i]).
+   *
+   * @param numQueries Number of query points.
+   * @param queryMap Mapping to apply to query indices, or NULL.
+   * @param referenceMap Mapping to apply to reference indices, or NULL.
+   * @param offsets Vector to store the numQueries + 1 row offsets in.
+   * @param neighbors Vector to store the neighbor indices in.
+   * @param distances Vector to store the neighbor distances in.
+   */
+  void Finalize(const size_t numQueries,
+                const std::vector<size_t>* queryMap,
+                const std::vector<size_t>* referenceMap,
+                arma::Col<size_t>& offsets,
+                arma::Col<size_t>& neighbors,
+                arma::vec& distances)
+  {
+    // Count the results of each query point.
+    offsets.zeros(numQueries + 1);
+    for (size_t i = 0; i < queries.size(); ++i)
+    {
+      if (queryMap)
+        queries[i] = (*queryMap)[queries[i]];
+      ++offsets[queries[i] + 1];
+    }
+
+    for (size_t i = 0; i < numQueries; ++i)
+      offsets[i + 1] += offsets[i];
+
+    // Now scatter each result into its row, in order.
+    neighbors.set_size(queries.size());
+    distances.set_size(queries.size());
+    std::vector<size_t> next(offsets.memptr(), offsets.memptr() + numQueries);
+    for (size_t i = 0; i < queries.size(); ++i)
+    {
+      const size_t position = next[queries[i]]++;
+      neighbors[position] = (referenceMap) ? (*referenceMap)[references[i]] :
+          references[i];
+      distances[position] = resultDistances[i];
+    }
+
+    // Release the buffers.
+    std::vector<size_t>().swap(queries);
+    std::vector<size_t>().swap(references);
+    std::vector<double>().swap(resultDistances);
+  }
+
+ private:
+  //! The query index of each result.
+  std::vector<size_t> queries;
+  //! The reference index of each result.
+  std::vector<size_t> references;
+  //! The distance of each result.
+  std::vector<double> resultDistances;
+};
+
+/**
+ * Only count the results of each query point.  Because no distances are
+ * needed, a reference node that lies entirely inside the range is counted with
+ * AddCount() in one step, without visiting its points.
+ */
+class CountRangeResults
+{
+ public:
+  //! Only the number of results is kept.
+  static const bool CountsOnly = true;
+
+  /**
+   * Count results in the given vector, which must already have one element
+   * (initially zero) for each query point.
+   *
+   * @param counts Vector to count the results of each query point in.
+   */
+  CountRangeResults(arma::Col<size_t>& counts) : counts(counts)
+  { /* Nothing to do. */ }
+
+  //! There is nothing to reserve.
+  void Reserve(const size_t /* queryIndex */, const size_t /* count */) { }
+
+  //! Count a result for the given query point.
+  void Add(const size_t queryIndex,
+           const size_t /* referenceIndex */,
+           const double /* distance */)
+  {
+    ++counts[queryIndex];
+  }
+
+  //! Count the given number of results for the given query point.
+  void AddCount(const size_t queryIndex, const size_t count)
+  {
+    counts[queryIndex] += count;
+  }
+
+ private:
+  //! The number of results of each query point.
+  arma::Col<size_t>& counts;
+};
+
+/**
+ * Pass each result to a visitor as soon as it is found, without storing it.
+ * The visitor is called as visitor(queryIndex, referenceIndex, distance); the
+ * indices can be mapped (for instance, back to the order of the points before
+ * tree building) before the call.
+ */
+template<typename VisitorType>
+class CallbackRangeResults
+{
+ public:
+  //! Every result is passed to the visitor.
+  static const bool CountsOnly = false;
+
+  /**
+   * Pass results to the given visitor.  If queryMap (or referenceMap) is not
+   * NULL, every query (or reference) index i is replaced with (*queryMap)[i]
+   * (or (*referenceMap)[i]) first.
+   *
+   * @param visitor Visitor to call for each result.
+   * @param queryMap Mapping to apply to query indices, or NULL.
+   * @param referenceMap Mapping to apply to reference indices, or NULL.
+   */
+  CallbackRangeResults(VisitorType& visitor,
+                       const std::vector<size_t>* queryMap = NULL,
+                       const std::vector<size_t>* referenceMap = NULL) :
+      visitor(visitor),
+      queryMap(queryMap),
+      referenceMap(referenceMap)
+  { /* Nothing to do. */ }
+
+  //! Nothing is stored, so there is nothing to reserve.
+  void Reserve(const size_t /* queryIndex */, const size_t /* count */) { }
+
+  //! Pass a result to the visitor.
+  void Add(const size_t queryIndex,
+           const size_t referenceIndex,
+           const double distance)
+  {
+    visitor((queryMap) ? (*queryMap)[queryIndex] : queryIndex,
+        (referenceMap) ? (*referenceMap)[referenceIndex] : referenceIndex,
+        distance);
+  }
+
+ private:
+  //! The visitor.
+  VisitorType& visitor;
+  //! Mapping of query indices (may be NULL).
+  const std::vector<size_t>* queryMap;
+  //! Mapping of reference indices (may be NULL).
+  const std::vector<size_t>* referenceMap;
+};
+
+}; // namespace range
+}; // namespace mlpack
+
+#endif
@@ -7,13 +7,17 @@
 #ifndef __MLPACK_METHODS_RANGE_SEARCH_RANGE_SEARCH_RULES_HPP
 #define __MLPACK_METHODS_RANGE_SEARCH_RANGE_SEARCH_RULES_HPP
 
+#include <boost/type_traits/integral_constant.hpp>
 #include "../neighbor_search/ns_traversal_info.hpp"
+#include "range_search_results.hpp"
 
 namespace mlpack {
 namespace range {
 
 
-template<typename MetricType, typename TreeType>
+template<typename MetricType,
+         typename TreeType,
+         typename ResultsType = NestedRangeResults>
 class RangeSearchRules
 {
  public:
@@ -24,15 +28,14 @@ class RangeSearchRules
    * @param referenceSet Set of reference data.
    * @param querySet Set of query data.
    * @param range Range to search for.
-   * @param neighbors Vector to store resulting neighbors in.
-   * @param distances Vector to store resulting distances in.
+   * @param results Object to store the resulting neighbors and distances in
+   *      (see NestedRangeResults and FlatRangeResults).
    * @param metric Instantiated metric.
    */
   RangeSearchRules(const arma::mat& referenceSet,
                    const arma::mat& querySet,
                    const math::Range& range,
-                   std::vector<std::vector<size_t> >& neighbors,
-                   std::vector<std::vector<double> >& distances,
+                   ResultsType& results,
                    MetricType& metric);
 
   /**
@@ -108,11 +111,8 @@ class RangeSearchRules
   //! The range of distances for which we are searching.
   const math::Range& range;
 
-  //! The vector the resultant neighbor indices should be stored in.
-  std::vector<std::vector<size_t> >& neighbors;
-
-  //! The vector the resultant neighbor distances should be stored in.
-  std::vector<std::vector<double> >& distances;
+  //! The object the resultant neighbors and distances should be stored in.
+  ResultsType& results;
 
   //! The instantiated metric.
   MetricType& metric;
@@ -128,6 +128,20 @@ class RangeSearchRules
   void AddResult(const size_t queryIndex,
                  TreeType& referenceNode);
 
+  //! Add the points of the given node, from the given descendant on, to the
+  //! results for the given query point, computing each distance.
+  void AddDescendants(const size_t queryIndex,
+                      TreeType& referenceNode,
+                      const size_t firstDescendant,
+                      const boost::false_type& /* countsOnly */);
+
+  //! Count the points of the given node, from the given descendant on, in the
+  //! results for the given query point, without computing any distances.
+  void AddDescendants(const size_t queryIndex,
+                      TreeType& referenceNode,
+                      const size_t firstDescendant,
+                      const boost::true_type& /* countsOnly */);
+
   TraversalInfoType traversalInfo;
 };
 
@@ -13,19 +13,17 @@
 namespace mlpack {
 namespace range {
 
-template<typename MetricType, typename TreeType>
-RangeSearchRules<MetricType, TreeType>::RangeSearchRules(
+template<typename MetricType, typename TreeType, typename ResultsType>
+RangeSearchRules<MetricType, TreeType, ResultsType>::RangeSearchRules(
     const arma::mat& referenceSet,
     const arma::mat& querySet,
     const math::Range& range,
-    std::vector<std::vector<size_t> >& neighbors,
-    std::vector<std::vector<double> >& distances,
+    ResultsType& results,
     MetricType& metric) :
     referenceSet(referenceSet),
     querySet(querySet),
     range(range),
-    neighbors(neighbors),
-    distances(distances),
+    results(results),
     metric(metric),
     lastQueryIndex(querySet.n_cols),
     lastReferenceIndex(referenceSet.n_cols)
@@ -35,9 +33,9 @@ RangeSearchRules<MetricType, TreeType>::RangeSearchRules(
 
 //! The base case.  Evaluate the distance between the two points and add to the
 //! results if necessary.
-template<typename MetricType, typename TreeType>
+template<typename MetricType, typename TreeType, typename ResultsType>
 inline force_inline
-double RangeSearchRules<MetricType, TreeType>::BaseCase(
+double RangeSearchRules<MetricType, TreeType, ResultsType>::BaseCase(
     const size_t queryIndex,
     const size_t referenceIndex)
 {
@@ -57,18 +55,16 @@ double RangeSearchRules<MetricType, TreeType>::BaseCase(
   lastReferenceIndex = referenceIndex;
 
   if (range.Contains(distance))
-  {
-    neighbors[queryIndex].push_back(referenceIndex);
-    distances[queryIndex].push_back(distance);
-  }
+    results.Add(queryIndex, referenceIndex, distance);
 
   return distance;
 }
 
 //! Single-tree scoring function.
-template<typename MetricType, typename TreeType>
-double RangeSearchRules<MetricType, TreeType>::Score(const size_t queryIndex,
-                                                     TreeType& referenceNode)
+template<typename MetricType, typename TreeType, typename ResultsType>
+double RangeSearchRules<MetricType, TreeType, ResultsType>::Score(
+    const size_t queryIndex,
+    TreeType& referenceNode)
 {
   // We must get the minimum and maximum distances and store them in this
   // object.
@@ -125,8 +121,8 @@ double RangeSearchRules<MetricType, TreeType>::Score(const size_t queryIndex,
 }
 
 //! Single-tree rescoring function.
-template<typename MetricType, typename TreeType>
-double RangeSearchRules<MetricType, TreeType>::Rescore(
+template<typename MetricType, typename TreeType, typename ResultsType>
+double RangeSearchRules<MetricType, TreeType, ResultsType>::Rescore(
     const size_t /* queryIndex */,
     TreeType& /* referenceNode */,
     const double oldScore) const
@@ -136,9 +132,10 @@ double RangeSearchRules<MetricType, TreeType>::Rescore(
 }
 
 //! Dual-tree scoring function.
-template<typename MetricType, typename TreeType>
-double RangeSearchRules<MetricType, TreeType>::Score(TreeType& queryNode,
-                                                     TreeType& referenceNode)
+template<typename MetricType, typename TreeType, typename ResultsType>
+double RangeSearchRules<MetricType, TreeType, ResultsType>::Score(
+    TreeType& queryNode,
+    TreeType& referenceNode)
 {
   math::Range distances;
   if (tree::TreeTraits<TreeType>::FirstPointIsCentroid)
@@ -184,7 +181,8 @@ double RangeSearchRules<MetricType, TreeType>::Score(TreeType& queryNode,
   // the results for each point in the query node.
   if ((distances.Lo() >= range.Lo()) && (distances.Hi() <= range.Hi()))
   {
-    for (size_t i = 0; i < queryNode.NumDescendants(); ++i)
+    const size_t numDescendants = queryNode.NumDescendants();
+    for (size_t i = 0; i < numDescendants; ++i)
       AddResult(queryNode.Descendant(i), referenceNode);
     return DBL_MAX; // We don't need to go any deeper.
   }
@@ -197,8 +195,8 @@ double RangeSearchRules<MetricType, TreeType>::Score(TreeType& queryNode,
 }
 
 //! Dual-tree rescoring function.
-template<typename MetricType, typename TreeType>
-double RangeSearchRules<MetricType, TreeType>::Rescore(
+template<typename MetricType, typename TreeType, typename ResultsType>
+double RangeSearchRules<MetricType, TreeType, ResultsType>::Rescore(
     TreeType& /* queryNode */,
     TreeType& /* referenceNode */,
     const double oldScore) const
@@ -209,9 +207,10 @@ double RangeSearchRules<MetricType, TreeType>::Rescore(
 
 //! Add all the points in the given node to the results for the given query
 //! point.
-template<typename MetricType, typename TreeType>
-void RangeSearchRules<MetricType, TreeType>::AddResult(const size_t queryIndex,
-                                                       TreeType& referenceNode)
+template<typename MetricType, typename TreeType, typename ResultsType>
+void RangeSearchRules<MetricType, TreeType, ResultsType>::AddResult(
+    const size_t queryIndex,
+    TreeType& referenceNode)
 {
   // Some types of trees calculate the base case evaluation before Score() is
   // called, so if the base case has already been calculated, then we must avoid
@@ -224,29 +223,60 @@ void RangeSearchRules<MetricType, TreeType>::AddResult(const size_t queryIndex,
     baseCaseMod = 1;
   }
 
-  // Resize distances and neighbors vectors appropriately.  We have to use
-  // reserve() and not resize(), because we don't know if we will encounter the
-  // case where the datasets and points are the same (and we skip in that case).
-  const size_t oldSize = neighbors[queryIndex].size();
-  neighbors[queryIndex].reserve(oldSize + referenceNode.NumDescendants() -
-      baseCaseMod);
-  distances[queryIndex].reserve(oldSize + referenceNode.NumDescendants() -
-      baseCaseMod);
+  AddDescendants(queryIndex, referenceNode, baseCaseMod,
+      boost::integral_constant<bool, ResultsType::CountsOnly>());
+}
 
-  for (size_t i = baseCaseMod; i < referenceNode.NumDescendants(); ++i)
+template<typename MetricType, typename TreeType, typename ResultsType>
+void RangeSearchRules<MetricType, TreeType, ResultsType>::AddDescendants(
+    const size_t queryIndex,
+    TreeType& referenceNode,
+    const size_t firstDescendant,
+    const boost::false_type& /* countsOnly */)
+{
+  // Reserve space for the results.  This is only an upper bound, because we
+  // don't know if we will encounter the case where the datasets and points are
+  // the same (and we skip in that case).
+  const size_t numDescendants = referenceNode.NumDescendants();
+  results.Reserve(queryIndex, numDescendants - firstDescendant);
+
+  // Descendant() is not constant-time for every type of tree (for a
+  // RectangleTree it walks down to the leaf), so it is called once per point.
+  for (size_t i = firstDescendant; i < numDescendants; ++i)
   {
-    if ((&referenceSet == &querySet) &&
-        (queryIndex == referenceNode.Descendant(i)))
+    const size_t descendant = referenceNode.Descendant(i);
+    if ((&referenceSet == &querySet) && (queryIndex == descendant))
       continue;
 
     const double distance = metric.Evaluate(querySet.unsafe_col(queryIndex),
-        referenceNode.Dataset().unsafe_col(referenceNode.Descendant(i)));
+        referenceNode.Dataset().unsafe_col(descendant));
 
-    neighbors[queryIndex].push_back(referenceNode.Descendant(i));
-    distances[queryIndex].push_back(distance);
+    results.Add(queryIndex, descendant, distance);
   }
 }
 
+template<typename MetricType, typename TreeType, typename ResultsType>
+void RangeSearchRules<MetricType, TreeType, ResultsType>::AddDescendants(
+    const size_t queryIndex,
+    TreeType& referenceNode,
+    const size_t firstDescendant,
+    const boost::true_type& /* countsOnly */)
+{
+  const size_t numDescendants = referenceNode.NumDescendants();
+  size_t count = numDescendants - firstDescendant;
+
+  // The query point is not in its own range.  It can only be a descendant of a
+  // node entirely inside the range if the range contains zero.
+  if ((&referenceSet == &querySet) && (range.Lo() <= 0.0))
+  {
+    for (size_t i = firstDescendant; i < numDescendants; ++i)
+      if (referenceNode.Descendant(i) == queryIndex)
+        --count;
+  }
+
+  results.AddCount(queryIndex, count);
+}
+
 }; // namespace range
 }; // namespace mlpack
 
@@ -9,6 +9,7 @@
 
 #include <mlpack/core.hpp>
 #include <mlpack/core/tree/cover_tree.hpp>
+#include <mlpack/core/tree/rectangle_tree.hpp>
 
 #include <string>
 #include <fstream>
@@ -70,6 +71,7 @@ PARAM_FLAG("single_mode", "If true, single-tree search is used (as opposed to "
            "dual-tree search.", "s");
 PARAM_FLAG("cover_tree", "If true, use cover trees to perform the search.",
            "c");
+PARAM_FLAG("r_tree", "If true, use R*-trees to perform the search.", "E");
 
 PARAM_FLAG("sample_at_leaves", "The flag to trigger sampling at leaves.", "L");
 PARAM_FLAG("first_leaf_exact", "The flag to trigger sampling only after "
@@ -77,11 +79,167 @@ PARAM_FLAG("first_leaf_exact", "The flag to trigger sampling only after "
 PARAM_INT("single_sample_limit", "The limit on the maximum number of "
     "samples (and hence the largest node you can approximate).", "S", 20);
 
+PARAM_INT("num_threads", "Number of threads to use for naive and single-tree "
+    "search (0 uses all available threads).  This has no effect unless mlpack "
+    "was built with OpenMP.", "T", 1);
+PARAM_INT("chunk_size", "If positive, search the query points in chunks of "
+    "this many points (with single-tree search), writing the results of each "
+    "chunk as soon as it is finished.  Requires --query_file.", "C", 0);
+PARAM_INT("seed", "Random seed (if 0, std::time(NULL) is used).", "R", 0);
+
+/**
+ * Write the results of each chunk of a chunked search to the distances and
+ * neighbors files, one line per query point, as data::Save() would.  The chunks
+ * must be given in order and hold consecutive query points.
+ */
+class ChunkWriter
+{
+ public:
+  /**
+   * Open the output files (an empty filename means that output is not saved).
+   * The given mapping, if not NULL, is applied to the neighbor indices.
+   */
+  ChunkWriter(const string& distancesFile,
+              const string& neighborsFile,
+              const vector<size_t>* oldFromNewRefs) :
+      oldFromNewRefs(oldFromNewRefs)
+  {
+    Open(distancesFile, distancesStream);
+    Open(neighborsFile, neighborsStream);
+  }
+
+  //! Write the results of one chunk.
+  void operator()(const arma::Col<size_t>& /* queryIndices */,
+                  const arma::Mat<size_t>& neighbors,
+                  const arma::mat& distances)
+  {
+    for (size_t i = 0; i < neighbors.n_cols; ++i)
+    {
+      for (size_t j = 0; j < neighbors.n_rows; ++j)
+      {
+        if (distancesStream.is_open())
+          distancesStream << ((j == 0) ? "" : ",") << distances(j, i);
+        if (neighborsStream.is_open())
+          neighborsStream << ((j == 0) ? "" : ",") << ((oldFromNewRefs) ?
+              (*oldFromNewRefs)[neighbors(j, i)] : neighbors(j, i));
+      }
+
+      if (distancesStream.is_open())
+        distancesStream << "\n";
+      if (neighborsStream.is_open())
+        neighborsStream << "\n";
+    }
+  }
+
+ private:
+  //! Open the given file for writing, unless the filename is empty.
+  static void Open(const string& filename, fstream& stream)
+  {
+    if (filename == "")
+      return;
+
+    stream.open(filename.c_str(), fstream::out);
+    if (!stream.is_open())
+      Log::Fatal << "Cannot open file '" << filename << "' for writing."
+          << endl;
+    stream.precision(12);
+  }
+
+  //! Mapping to apply to neighbor indices (may be NULL).
+  const vector<size_t>* oldFromNewRefs;
+  //! Output stream for distances.
+  fstream distancesStream;
+  //! Output stream for neighbors.
+  fstream neighborsStream;
+};
+
+typedef RectangleTree<RStarTreeSplit<RStarTreeDescentHeuristic,
+    RAQueryStat<NearestNeighborSort>, arma::mat>, RStarTreeDescentHeuristic,
+    RAQueryStat<NearestNeighborSort>, arma::mat> RTreeType;
+
+/**
+ * Run the search with R*-trees.  R*-trees hold the indices of the points, so
+ * the results do not have to be mapped back to the original order.
+ */
+void RTreeSearch(arma::mat& referenceData,
+                 arma::mat& queryData,
+                 const size_t k,
+                 const size_t leafSize,
+                 const bool singleMode,
+                 const size_t numThreads,
+                 const double tau,
+                 const double alpha,
+                 const bool sampleAtLeaves,
+                 const bool firstLeafExact,
+                 const size_t singleSampleLimit,
+                 arma::Mat<size_t>& neighbors,
+                 arma::mat& distances)
+{
+  typedef RASearch<NearestNeighborSort, metric::EuclideanDistance,
+      RTreeType> RTreeRANN;
+
+  Log::Info << "Using R*-trees." << endl;
+
+  Log::Info << "Building reference tree..." << endl;
+  Timer::Start("tree_building");
+  RTreeType refTree(referenceData, leafSize, leafSize * 0.4, 5, 2, 0);
+  Timer::Stop("tree_building");
+
+  RTreeRANN* allkrann = NULL;
+  RTreeType* queryTree = NULL;
+
+  if (CLI::GetParam<string>("query_file") != "")
+  {
+    const string queryFile = CLI::GetParam<string>("query_file");
+    data::Load(queryFile, queryData, true);
+
+    Log::Info << "Loaded query data from '" << queryFile << "' (" <<
+      queryData.n_rows << " x " << queryData.n_cols << ")." << endl;
+
+    // The query tree is not used in single-tree mode.
+    if (!singleMode)
+    {
+      Log::Info << "Building query tree..." << endl;
+      Timer::Start("tree_building");
+      queryTree = new RTreeType(queryData, leafSize, leafSize * 0.4, 5, 2, 0);
+      Timer::Stop("tree_building");
+    }
+
+    allkrann = new RTreeRANN(&refTree, queryTree, referenceData, queryData,
+        singleMode);
+  }
+  else
+  {
+    allkrann = new RTreeRANN(&refTree, referenceData, singleMode);
+  }
+  Log::Info << "Trees built." << endl;
+  allkrann->NumThreads() = numThreads;
+
+  Log::Info << "Computing " << k << " nearest neighbors " << "with " <<
+    tau << "% rank approximation..." << endl;
+  allkrann->Search(k, neighbors, distances, tau, alpha, sampleAtLeaves,
+      firstLeafExact, singleSampleLimit);
+
+  // The bounds of an R*-tree hold Euclidean distances, so the search is done
+  // with the Euclidean distance; the other trees give squared distances.
+  distances %= distances;
+
+  Log::Info << "Neighbors computed." << endl;
+
+  if (queryTree)
+    delete queryTree;
+  delete allkrann;
+}
+
 int main(int argc, char *argv[])
 {
   // Give CLI the command line parameters the user passed in.
   CLI::ParseCommandLine(argc, argv);
-  math::RandomSeed(time(NULL));
+
+  if (CLI::GetParam<int>("seed") != 0)
+    math::RandomSeed((size_t) CLI::GetParam<int>("seed"));
+  else
+    math::RandomSeed((size_t) time(NULL));
 
   // Get all the parameters.
   string referenceFile = CLI::GetParam<string>("reference_file");
@@ -136,6 +294,78 @@ int main(int argc, char *argv[])
   if (singleMode && naive)
     Log::Warn << "--single_mode ignored because --naive is present." << endl;
 
+  if (CLI::HasParam("r_tree") && naive)
+    Log::Warn << "--r_tree ignored because --naive is present." << endl;
+
+  if (CLI::HasParam("r_tree") && CLI::HasParam("cover_tree"))
+    Log::Fatal << "--r_tree cannot be used with --cover_tree." << endl;
+
+  // Sanity checks on the number of threads and the chunk size.
+  if (CLI::GetParam<int>("num_threads") < 0)
+    Log::Fatal << "Invalid number of threads: "
+        << CLI::GetParam<int>("num_threads") << ".  Must be greater than or "
+        << "equal to 0." << endl;
+  const size_t numThreads = (size_t) CLI::GetParam<int>("num_threads");
+
+  if (CLI::GetParam<int>("chunk_size") < 0)
+    Log::Fatal << "Invalid chunk size: " << CLI::GetParam<int>("chunk_size")
+        << ".  Must be greater than or equal to 0." << endl;
+  const size_t chunkSize = (size_t) CLI::GetParam<int>("chunk_size");
+
+  if (chunkSize > 0)
+  {
+    // The query points are not put in a tree, so they stay in their original
+    // order and each chunk can be written as soon as it is finished.
+    if (CLI::GetParam<string>("query_file") == "")
+      Log::Fatal << "--chunk_size requires --query_file." << endl;
+    if (CLI::HasParam("cover_tree") || CLI::HasParam("r_tree"))
+      Log::Fatal << "--chunk_size cannot be used with --cover_tree or "
+          << "--r_tree." << endl;
+
+    const string queryFile = CLI::GetParam<string>("query_file");
+    data::Load(queryFile, queryData, true);
+
+    Log::Info << "Loaded query data from '" << queryFile << "' (" <<
+      queryData.n_rows << " x " << queryData.n_cols << ")." << endl;
+
+    typedef BinarySpaceTree<bound::HRectBound<2, false>,
+        RAQueryStat<NearestNeighborSort> > TreeType;
+    TreeType* refTree = NULL;
+    std::vector<size_t> oldFromNewRefs;
+    AllkRANN* allkrann;
+    if (naive)
+    {
+      allkrann = new AllkRANN(referenceData, queryData, naive);
+    }
+    else
+    {
+      Log::Info << "Building reference tree..." << endl;
+      Timer::Start("tree_building");
+      refTree = new TreeType(referenceData, oldFromNewRefs, leafSize);
+      Timer::Stop("tree_building");
+
+      allkrann = new AllkRANN(refTree, NULL, referenceData, queryData, true);
+    }
+    allkrann->NumThreads() = numThreads;
+
+    Log::Info << "Computing " << k << " nearest neighbors " << "with " <<
+      tau << "% rank approximation in chunks of " << chunkSize << " query "
+      << "points..." << endl;
+
+    ChunkWriter writer(distancesFile, neighborsFile,
+        (naive ? NULL : &oldFromNewRefs));
+    allkrann->Search(k, writer, chunkSize, tau, alpha, sampleAtLeaves,
+        firstLeafExact, singleSampleLimit);
+
+    Log::Info << "Neighbors computed." << endl;
+
+    delete allkrann;
+    if (refTree)
+      delete refTree;
+
+    return 0;
+  }
+
   // The actual output after the remapping.
   arma::Mat<size_t> neighbors;
   arma::mat distances;
@@ -157,6 +387,8 @@ int main(int argc, char *argv[])
     else
       allkrann = new AllkRANN(referenceData, naive);
 
+    allkrann->NumThreads() = numThreads;
+
     Log::Info << "Computing " << k << " nearest neighbors " << "with " <<
       tau << "% rank approximation..." << endl;
 
@@ -173,7 +405,13 @@ int main(int argc, char *argv[])
     arma::Mat<size_t> neighborsOut;
     arma::mat distancesOut;
 
-    if (!CLI::HasParam("cover_tree"))
+    if (CLI::HasParam("r_tree"))
+    {
+      RTreeSearch(referenceData, queryData, k, leafSize, singleMode,
+          numThreads, tau, alpha, sampleAtLeaves, firstLeafExact,
+          singleSampleLimit, neighbors, distances);
+    }
+    else if (!CLI::HasParam("cover_tree"))
     {
       // Because we may construct it differently, we need a pointer.
       AllkRANN* allkrann = NULL;
@@ -230,6 +468,7 @@ int main(int argc, char *argv[])
         allkrann = new AllkRANN(&refTree, referenceData, singleMode);
         Log::Info << "Trees built." << endl;
       }
+      allkrann->NumThreads() = numThreads;
 
       Log::Info << "Computing " << k << " nearest neighbors " << "with " <<
         tau << "% rank approximation..." << endl;
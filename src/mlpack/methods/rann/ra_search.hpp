@@ -64,8 +64,9 @@ class RASearch
    * distance::MahalanobisDistance class).
    *
    * This method will copy the matrices to internal copies, which are rearranged
-   * during tree-building.  You can avoid this extra copy by pre-constructing
-   * the trees and passing them using a diferent constructor.
+   * during tree-building.  You can avoid this extra copy by letting the object
+   * rearrange the matrices in place, or by pre-constructing the trees, with a
+   * different constructor.
    *
    * @param referenceSet Set of reference points.
    * @param querySet Set of query points.
@@ -110,6 +111,95 @@ class RASearch
            const bool singleMode = false,
            const MetricType metric = MetricType());
 
+  /**
+   * Initialize the RASearch object, building the trees on the given query and
+   * reference datasets in place, so that no copy of either is made.  If the
+   * tree type rearranges the dataset during tree-building, the matrices are
+   * rearranged, and the original index of each point is stored in
+   * oldFromNewReferences and oldFromNewQueries (which are otherwise left
+   * empty).  The results of Search() still use the original indices.  The
+   * matrices must not be modified or destroyed while this object exists.  In
+   * single-tree mode, no query tree is built, so the query set is not modified.
+   *
+   * @param referenceSet Set of reference points (rearranged in place).
+   * @param querySet Set of query points (rearranged in place).
+   * @param oldFromNewReferences Filled with the original index of each
+   *      rearranged reference point.
+   * @param oldFromNewQueries Filled with the original index of each rearranged
+   *      query point.
+   * @param singleMode If true, single-tree search will be used (as opposed to
+   *      dual-tree search).
+   * @param metric An optional instance of the MetricType class.
+   */
+  RASearch(typename TreeType::Mat& referenceSet,
+           typename TreeType::Mat& querySet,
+           std::vector<size_t>& oldFromNewReferences,
+           std::vector<size_t>& oldFromNewQueries,
+           const bool singleMode = false,
+           const MetricType metric = MetricType());
+
+  /**
+   * Initialize the RASearch object, building the tree on the given dataset in
+   * place, so that no copy of it is made; the dataset is used as both the
+   * query and the reference dataset.  If the tree type rearranges the dataset
+   * during tree-building, the matrix is rearranged, and the original index of
+   * each point is stored in oldFromNewReferences (which is otherwise left
+   * empty).  The results of Search() still use the original indices.  The
+   * matrix must not be modified or destroyed while this object exists.
+   *
+   * @param referenceSet Set of reference points (rearranged in place).
+   * @param oldFromNewReferences Filled with the original index of each
+   *      rearranged point.
+   * @param singleMode If true, single-tree search will be used (as opposed to
+   *      dual-tree search).
+   * @param metric An optional instance of the MetricType class.
+   */
+  RASearch(typename TreeType::Mat& referenceSet,
+           std::vector<size_t>& oldFromNewReferences,
+           const bool singleMode = false,
+           const MetricType metric = MetricType());
+
+  /**
+   * Initialize the RASearch object, taking ownership of the given query and
+   * reference datasets, so that neither is copied; the trees are built on the
+   * moved matrices.  The results of Search() use the original indices.
+   * Otherwise, this is the same as the constructor which copies the datasets.
+   *
+   * @param referenceSet Set of reference points (moved into this object).
+   * @param querySet Set of query points (moved into this object).
+   * @param naive If true, the rank-approximate search will be performed by
+   *      directly sampling the whole set instead of using the stratified
+   *      sampling on the tree.
+   * @param singleMode If true, single-tree search will be used (as opposed to
+   *      dual-tree search).
+   * @param metric An optional instance of the MetricType class.
+   */
+  RASearch(typename TreeType::Mat&& referenceSet,
+           typename TreeType::Mat&& querySet,
+           const bool naive = false,
+           const bool singleMode = false,
+           const MetricType metric = MetricType());
+
+  /**
+   * Initialize the RASearch object, taking ownership of the given dataset,
+   * which is used as both the query and the reference dataset, so that it is
+   * not copied; the tree is built on the moved matrix.  The results of
+   * Search() use the original indices.  Otherwise, this is the same as the
+   * constructor which copies the dataset.
+   *
+   * @param referenceSet Set of reference points (moved into this object).
+   * @param naive If true, the rank-approximate search will be performed by
+   *      directly sampling the whole set instead of using the stratified
+   *      sampling on the tree.
+   * @param singleMode If true, single-tree search will be used (as opposed to
+   *      dual-tree search).
+   * @param metric An optional instance of the MetricType class.
+   */
+  RASearch(typename TreeType::Mat&& referenceSet,
+           const bool naive = false,
+           const bool singleMode = false,
+           const MetricType metric = MetricType());
+
   /**
    * Initialize the RASearch object with the given datasets and
    * pre-constructed trees.  It is assumed that the points in referenceSet and
@@ -219,6 +309,10 @@ class RASearch
    *     if there exists one.  This defaults to 'false' for now.
    * @param singleSampleLimit The limit on the largest node that can be
    *     approximated by sampling. This defaults to 20.
+   *
+   * In naive and single-tree mode, if NumThreads() is not 1, the query points
+   * are processed in chunks of QueryChunkSize points in parallel (see the
+   * other overload of Search()).  Dual-tree search is not parallelized.
    */
   void Search(const size_t k,
               arma::Mat<size_t>& resultingNeighbors,
@@ -229,6 +323,53 @@ class RASearch
               const bool firstLeafExact = false,
               const size_t singleSampleLimit = 20);
 
+  /**
+   * Compute the rank approximate nearest neighbors chunk by chunk, giving the
+   * results of each chunk of query points to a visitor as soon as the chunk is
+   * finished, so that they never all have to be held in memory.  The visitor is
+   * called as
+   *
+   * @code
+   * visitor(queryIndices, neighbors, distances);
+   * @endcode
+   *
+   * where queryIndices (an arma::Col<size_t>) holds the indices of the query
+   * points of the chunk, and column i of neighbors (an arma::Mat<size_t>) and
+   * distances (an arma::mat) holds the results for query point queryIndices[i],
+   * as in the other overload of Search().  The chunks are given to the visitor
+   * in order, one at a time, so the visitor does not need to be thread-safe.
+   * Unless this object rearranged the query set while building a tree, the
+   * chunks hold consecutive query points.
+   *
+   * Each chunk is searched with single-tree search (or naive sampling, if this
+   * object is in naive mode), and the chunks are searched in parallel if
+   * NumThreads() is not 1.  Each chunk samples with its own random number
+   * generator, whose seed is taken from the global mlpack random number
+   * generator before the search starts, so the results only depend on the seed
+   * given to math::RandomSeed() and the chunk size (not the number of
+   * threads).
+   *
+   * @param k Number of neighbors to search for.
+   * @param visitor Functor to give the results of each chunk to.
+   * @param chunkSize Number of query points in each chunk.
+   * @param tau The rank-approximation in percentile of the data.
+   * @param alpha The desired success probability.
+   * @param sampleAtLeaves Sample at leaves for faster but less accurate
+   *      computation.
+   * @param firstLeafExact Traverse to the first leaf without approximation.
+   * @param singleSampleLimit The limit on the largest node that can be
+   *     approximated by sampling.
+   */
+  template<typename VisitorType>
+  void Search(const size_t k,
+              VisitorType& visitor,
+              const size_t chunkSize = QueryChunkSize,
+              const double tau = 5,
+              const double alpha = 0.95,
+              const bool sampleAtLeaves = false,
+              const bool firstLeafExact = false,
+              const size_t singleSampleLimit = 20);
+
   /**
    * This function recursively resets the RAQueryStat of the queryTree to set
    * 'bound' to WorstDistance and the 'numSamplesMade' to 0. This allows a user
@@ -241,6 +382,17 @@ class RASearch
   // Returns a string representation of this object.
   std::string ToString() const;
 
+  //! Get the number of threads used for naive and single-tree search (0 means
+  //! all available threads).
+  size_t NumThreads() const { return numThreads; }
+  //! Modify the number of threads used for naive and single-tree search (0
+  //! means all available threads).  This only has an effect if OpenMP is
+  //! available.
+  size_t& NumThreads() { return numThreads; }
+
+  //! The number of query points in each chunk of a parallel search.
+  static const size_t QueryChunkSize = 1024;
+
  private:
   //! Copy of reference dataset (if we need it, because tree building modifies
   //! it).
@@ -279,6 +431,45 @@ class RASearch
   //! Total number of pruned nodes during the neighbor search.
   size_t numberOfPrunes;
 
+  //! Number of threads to use for searching (0 means all available).
+  size_t numThreads;
+
+  /**
+   * Search for the neighbors of the query points begin to begin +
+   * neighbors.n_cols - 1, with single-tree search or, in naive mode, with naive
+   * sampling.  The query points are used through a view of the query set, so
+   * that the rules still recognize a query point as a reference point when the
+   * query set is the reference set.  This is used by the parallel searches.
+   *
+   * @param begin Index of the first query point of the chunk.
+   * @param neighbors Matrix (k x number of query points of the chunk) to store
+   *     the neighbors in.
+   * @param distances Matrix (k x number of query points of the chunk) to store
+   *     the distances in.
+   * @param seed Seed for the random number generator of the chunk.
+   * @param numSamplesReqd Minimum number of samples required per query.
+   * @param numPrunes Incremented by the number of pruned nodes.
+   * @param numDistComputations Incremented by the number of distance
+   *     computations.
+   */
+  void SearchChunk(const size_t begin,
+                   arma::Mat<size_t>& neighbors,
+                   arma::mat& distances,
+                   const uint32_t seed,
+                   const size_t numSamplesReqd,
+                   const double tau,
+                   const double alpha,
+                   const bool sampleAtLeaves,
+                   const bool firstLeafExact,
+                   const size_t singleSampleLimit,
+                   size_t& numPrunes,
+                   size_t& numDistComputations);
+
+  //! Compute the minimum number of samples required per query, validating tau.
+  size_t NumSamplesReqd(const size_t k,
+                        const double tau,
+                        const double alpha) const;
+
   /**
    * @param treeNode The node of the tree whose RAQueryStat is reset
    *     and whose children are to be explored recursively.
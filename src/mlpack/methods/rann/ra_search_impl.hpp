@@ -62,7 +62,8 @@ RASearch(const typename TreeType::Mat& referenceSetIn,
     naive(naive),
     singleMode(!naive && singleMode), // No single mode if naive.
     metric(metric),
-    numberOfPrunes(0)
+    numberOfPrunes(0),
+    numThreads(1)
 {
   // We'll time tree building.
   Timer::Start("tree_building");
@@ -107,7 +108,8 @@ RASearch(const typename TreeType::Mat& referenceSetIn,
     naive(naive),
     singleMode(!naive && singleMode), // No single mode if naive.
     metric(metric),
-    numberOfPrunes(0)
+    numberOfPrunes(0),
+    numThreads(1)
 {
   // We'll time tree building.
   Timer::Start("tree_building");
@@ -124,6 +126,145 @@ RASearch(const typename TreeType::Mat& referenceSetIn,
   Timer::Stop("tree_building");
 }
 
+// Construct the object, building the trees on the given matrices.
+template<typename SortPolicy, typename MetricType, typename TreeType>
+RASearch<SortPolicy, MetricType, TreeType>::
+RASearch(typename TreeType::Mat& referenceSetIn,
+         typename TreeType::Mat& querySetIn,
+         std::vector<size_t>& oldFromNewReferencesOut,
+         std::vector<size_t>& oldFromNewQueriesOut,
+         const bool singleMode,
+         const MetricType metric) :
+    referenceSet(referenceSetIn),
+    querySet(querySetIn),
+    referenceTree(NULL),
+    queryTree(NULL),
+    treeOwner(true),
+    hasQuerySet(true),
+    naive(false),
+    singleMode(singleMode),
+    metric(metric),
+    numberOfPrunes(0),
+    numThreads(1)
+{
+  // We'll time tree building.
+  Timer::Start("tree_building");
+
+  referenceTree = aux::BuildTree<TreeType>(referenceSetIn,
+      oldFromNewReferences);
+  if (!singleMode)
+    queryTree = aux::BuildTree<TreeType>(querySetIn, oldFromNewQueries);
+
+  // Stop the timer we started above.
+  Timer::Stop("tree_building");
+
+  // The mappings are kept to map the results of Search().
+  oldFromNewReferencesOut = oldFromNewReferences;
+  oldFromNewQueriesOut = oldFromNewQueries;
+}
+
+// Construct the object, building the tree on the given matrix.
+template<typename SortPolicy, typename MetricType, typename TreeType>
+RASearch<SortPolicy, MetricType, TreeType>::
+RASearch(typename TreeType::Mat& referenceSetIn,
+         std::vector<size_t>& oldFromNewReferencesOut,
+         const bool singleMode,
+         const MetricType metric) :
+    referenceSet(referenceSetIn),
+    querySet(referenceSetIn),
+    referenceTree(NULL),
+    queryTree(NULL),
+    treeOwner(true),
+    hasQuerySet(false),
+    naive(false),
+    singleMode(singleMode),
+    metric(metric),
+    numberOfPrunes(0),
+    numThreads(1)
+{
+  // We'll time tree building.
+  Timer::Start("tree_building");
+
+  referenceTree = aux::BuildTree<TreeType>(referenceSetIn,
+      oldFromNewReferences);
+
+  // Stop the timer we started above.
+  Timer::Stop("tree_building");
+
+  // The mapping is kept to map the results of Search().
+  oldFromNewReferencesOut = oldFromNewReferences;
+}
+
+// Construct the object, taking ownership of the given matrices.
+template<typename SortPolicy, typename MetricType, typename TreeType>
+RASearch<SortPolicy, MetricType, TreeType>::
+RASearch(typename TreeType::Mat&& referenceSetIn,
+         typename TreeType::Mat&& querySetIn,
+         const bool naive,
+         const bool singleMode,
+         const MetricType metric) :
+    referenceCopy(std::move(referenceSetIn)),
+    queryCopy(std::move(querySetIn)),
+    referenceSet(referenceCopy),
+    querySet(queryCopy),
+    referenceTree(NULL),
+    queryTree(NULL),
+    treeOwner(!naive),
+    hasQuerySet(true),
+    naive(naive),
+    singleMode(!naive && singleMode), // No single mode if naive.
+    metric(metric),
+    numberOfPrunes(0),
+    numThreads(1)
+{
+  // We'll time tree building.
+  Timer::Start("tree_building");
+
+  // The matrices are our own, so the trees are built on them in place.
+  if (!naive)
+  {
+    referenceTree = aux::BuildTree<TreeType>(referenceCopy,
+        oldFromNewReferences);
+    if (!singleMode)
+      queryTree = aux::BuildTree<TreeType>(queryCopy, oldFromNewQueries);
+  }
+
+  // Stop the timer we started above.
+  Timer::Stop("tree_building");
+}
+
+// Construct the object, taking ownership of the given matrix.
+template<typename SortPolicy, typename MetricType, typename TreeType>
+RASearch<SortPolicy, MetricType, TreeType>::
+RASearch(typename TreeType::Mat&& referenceSetIn,
+         const bool naive,
+         const bool singleMode,
+         const MetricType metric) :
+    referenceCopy(std::move(referenceSetIn)),
+    referenceSet(referenceCopy),
+    querySet(referenceCopy),
+    referenceTree(NULL),
+    queryTree(NULL),
+    treeOwner(!naive),
+    hasQuerySet(false),
+    naive(naive),
+    singleMode(!naive && singleMode), // No single mode if naive.
+    metric(metric),
+    numberOfPrunes(0),
+    numThreads(1)
+{
+  // We'll time tree building.
+  Timer::Start("tree_building");
+
+  // The matrix is our own, so the tree is built on it in place.
+  if (!naive)
+    referenceTree = aux::BuildTree<TreeType>(referenceCopy,
+        oldFromNewReferences);
+
+  // Stop the timer we started above.
+  Timer::Stop("tree_building");
+}
+
 // Construct the object.
 template<typename SortPolicy, typename MetricType, typename TreeType>
 RASearch<SortPolicy, MetricType, TreeType>::
@@ -142,7 +283,8 @@ RASearch(TreeType* referenceTree,
     naive(false),
     singleMode(singleMode),
     metric(metric),
-    numberOfPrunes(0)
+    numberOfPrunes(0),
+    numThreads(1)
 // Nothing else to initialize.
 {  }
 
@@ -162,7 +304,8 @@ RASearch(TreeType* referenceTree,
     naive(false),
     singleMode(singleMode),
     metric(metric),
-    numberOfPrunes(0)
+    numberOfPrunes(0),
+    numThreads(1)
 // Nothing else to initialize.
 { }
 
@@ -224,7 +367,50 @@ Search(const size_t k,
 
   size_t numPrunes = 0;
 
-  if (naive)
+  if ((naive || singleMode) && numThreads != 1)
+  {
+#ifdef _OPENMP
+    const size_t threads = util::NumThreads(numThreads);
+#else
+    const size_t threads = 1;
+#endif
+
+    const size_t numSamplesReqd = NumSamplesReqd(k, tau, alpha);
+    const size_t numChunks = (querySet.n_cols + QueryChunkSize - 1) /
+        QueryChunkSize;
+
+    // Each chunk has its own random number stream, so that the results do not
+    // depend on the order the chunks are run in.
+    const uint64_t streamKey = math::NewStreamKey();
+
+    Log::Info << "Searching " << numChunks << " chunks of query points with "
+        << threads << " threads..." << std::endl;
+
+    // Each chunk writes only to its own columns of the neighbor and distance
+    // matrices, through views of them.
+    size_t numDistComputations = 0;
+    #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+        reduction(+:numPrunes, numDistComputations)
+    for (size_t i = 0; i < numChunks; ++i)
+    {
+      const size_t begin = i * QueryChunkSize;
+      const size_t count = std::min((size_t) QueryChunkSize,
+          querySet.n_cols - begin);
+      arma::Mat<size_t> chunkNeighbors(neighborPtr->colptr(begin), k, count,
+          false, true);
+      arma::mat chunkDistances(distancePtr->colptr(begin), k, count, false,
+          true);
+
+      SearchChunk(begin, chunkNeighbors, chunkDistances,
+          math::StreamSeed(streamKey, i), numSamplesReqd, tau, alpha,
+          sampleAtLeaves, firstLeafExact, singleSampleLimit, numPrunes,
+          numDistComputations);
+    }
+
+    Log::Info << "Average number of distance calculations per query point: "
+        << (numDistComputations / querySet.n_cols) << "." << std::endl;
+  }
+  else if (naive)
   {
     // We don't need to run the base case on every possible combination of
     // points; we can achieve the rank approximation guarantee with probability
@@ -380,6 +566,163 @@ Search(const size_t k,
   }
 } // Search
 
+template<typename SortPolicy, typename MetricType, typename TreeType>
+template<typename VisitorType>
+void RASearch<SortPolicy, MetricType, TreeType>::
+Search(const size_t k,
+       VisitorType& visitor,
+       const size_t chunkSize,
+       const double tau,
+       const double alpha,
+       const bool sampleAtLeaves,
+       const bool firstLeafExact,
+       const size_t singleSampleLimit)
+{
+  if (chunkSize == 0)
+    Log::Fatal << "RASearch::Search(): chunk size must be positive."
+        << std::endl;
+
+  Timer::Start("computing_neighbors");
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads(numThreads);
+#else
+  const size_t threads = 1;
+#endif
+
+  const size_t numSamplesReqd = NumSamplesReqd(k, tau, alpha);
+  const size_t numChunks = (querySet.n_cols + chunkSize - 1) / chunkSize;
+
+  // Each chunk has its own random number stream, so that the results do not
+  // depend on the order the chunks are run in.
+  const uint64_t streamKey = math::NewStreamKey();
+
+  // Indices have to be mapped if we built a tree that rearranged the points.
+  // The query set is only rearranged if we built a tree on it.
+  const bool mapReferences = (treeOwner &&
+      tree::TreeTraits<TreeType>::RearrangesDataset);
+  const std::vector<size_t>* queryMap = NULL;
+  if (mapReferences && !hasQuerySet)
+    queryMap = &oldFromNewReferences;
+  else if (mapReferences && !singleMode)
+    queryMap = &oldFromNewQueries;
+
+  Log::Info << "Searching " << numChunks << " chunks of query points with "
+      << threads << " threads..." << std::endl;
+
+  // The chunks are searched in parallel, but given to the visitor in order;
+  // a thread that finishes a chunk early waits for the chunks before it, so at
+  // most one chunk per thread is held in memory.
+  size_t numPrunes = 0;
+  size_t numDistComputations = 0;
+  #pragma omp parallel for ordered schedule(dynamic) num_threads(threads) \
+      reduction(+:numPrunes, numDistComputations)
+  for (size_t i = 0; i < numChunks; ++i)
+  {
+    const size_t begin = i * chunkSize;
+    const size_t count = std::min(chunkSize, querySet.n_cols - begin);
+    arma::Mat<size_t> neighbors(k, count);
+    arma::mat distances(k, count);
+
+    SearchChunk(begin, neighbors, distances, math::StreamSeed(streamKey, i),
+        numSamplesReqd, tau, alpha, sampleAtLeaves, firstLeafExact,
+        singleSampleLimit, numPrunes, numDistComputations);
+
+    arma::Col<size_t> queryIndices(count);
+    for (size_t j = 0; j < count; ++j)
+      queryIndices[j] = (queryMap) ? (*queryMap)[begin + j] : begin + j;
+
+    if (mapReferences)
+    {
+      for (size_t j = 0; j < neighbors.n_elem; ++j)
+        neighbors[j] = oldFromNewReferences[neighbors[j]];
+    }
+
+    #pragma omp ordered
+    visitor(queryIndices, neighbors, distances);
+  }
+
+  Timer::Stop("computing_neighbors");
+
+  Log::Info << "Pruned " << numPrunes << " nodes." << std::endl;
+  if (querySet.n_cols > 0)
+    Log::Info << "Average number of distance calculations per query point: "
+        << (numDistComputations / querySet.n_cols) << "." << std::endl;
+}
+
+template<typename SortPolicy, typename MetricType, typename TreeType>
+void RASearch<SortPolicy, MetricType, TreeType>::
+SearchChunk(const size_t begin,
+            arma::Mat<size_t>& neighbors,
+            arma::mat& distances,
+            const uint32_t seed,
+            const size_t numSamplesReqd,
+            const double tau,
+            const double alpha,
+            const bool sampleAtLeaves,
+            const bool firstLeafExact,
+            const size_t singleSampleLimit,
+            size_t& numPrunes,
+            size_t& numDistComputations)
+{
+  const arma::mat queries(const_cast<double*>(querySet.colptr(begin)),
+      querySet.n_rows, neighbors.n_cols, false, true);
+  distances.fill(SortPolicy::WorstDistance());
+
+  // Each chunk samples with its own generator.
+  boost::mt19937 generator(seed);
+  typedef RASearchRules<SortPolicy, MetricType, TreeType> RuleType;
+  MetricType chunkMetric(metric);
+  RuleType rules(referenceSet, queries, neighbors, distances, chunkMetric, tau,
+      alpha, false, sampleAtLeaves, firstLeafExact, singleSampleLimit,
+      numSamplesReqd);
+  rules.RandomGenerator() = &generator;
+
+  if (naive)
+  {
+    // Sample the reference set once for the whole chunk, as in the serial
+    // naive search.
+    arma::uvec distinctSamples;
+    rules.ObtainDistinctSamples(numSamplesReqd, referenceSet.n_cols,
+        distinctSamples);
+
+    for (size_t i = 0; i < queries.n_cols; ++i)
+      for (size_t j = 0; j < distinctSamples.n_elem; ++j)
+        rules.BaseCase(i, (size_t) distinctSamples[j]);
+  }
+  else
+  {
+    typename TreeType::template SingleTreeTraverser<RuleType>
+        traverser(rules);
+
+    for (size_t i = 0; i < queries.n_cols; ++i)
+      traverser.Traverse(i, *referenceTree);
+
+    numPrunes += traverser.NumPrunes();
+  }
+
+  numDistComputations += rules.NumDistComputations();
+}
+
+template<typename SortPolicy, typename MetricType, typename TreeType>
+size_t RASearch<SortPolicy, MetricType, TreeType>::NumSamplesReqd(
+    const size_t k,
+    const double tau,
+    const double alpha) const
+{
+  // Constructing a rules object with no query points validates tau and
+  // computes the number of samples, which is the same for every query point.
+  const arma::mat noQueries(querySet.n_rows, 0);
+  arma::Mat<size_t> noNeighbors(k, 0);
+  arma::mat noDistances(k, 0);
+  MetricType metricCopy(metric);
+
+  RASearchRules<SortPolicy, MetricType, TreeType> rules(referenceSet,
+      noQueries, noNeighbors, noDistances, metricCopy, tau, alpha);
+
+  return rules.numSamplesReqd;
+}
+
 template<typename SortPolicy, typename MetricType, typename TreeType>
 void RASearch<SortPolicy, MetricType, TreeType>::ResetQueryTree()
 {
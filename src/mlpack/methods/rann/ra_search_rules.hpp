@@ -19,6 +19,16 @@ template<typename SortPolicy, typename MetricType, typename TreeType>
 class RASearchRules
 {
  public:
+  /**
+   * Construct the RASearchRules object.  Sampling uses the global mlpack random
+   * number generator unless another one is set with RandomGenerator().  If the
+   * minimum number of samples required per query has already been computed
+   * (with MinimumSamplesReqd()), it can be given, so that it is not computed
+   * again and tau is not validated again.
+   *
+   * @param numSamplesReqd Minimum number of samples required per query, or 0
+   *     to compute it from tau and alpha.
+   */
   RASearchRules(const arma::mat& referenceSet,
                 const arma::mat& querySet,
                 arma::Mat<size_t>& neighbors,
@@ -29,7 +39,8 @@ class RASearchRules
                 const bool naive = false,
                 const bool sampleAtLeaves = false,
                 const bool firstLeafExact = false,
-                const size_t singleSampleLimit = 20);
+                const size_t singleSampleLimit = 20,
+                const size_t numSamplesReqd = 0);
 
 
 
@@ -179,6 +190,11 @@ class RASearchRules
 
 
   size_t NumDistComputations() { return numDistComputations; }
+
+  //! Modify the random number generator used for sampling (by default, the
+  //! global mlpack generator math::randGen).
+  boost::mt19937*& RandomGenerator() { return randomGenerator; }
+
   size_t NumEffectiveSamples()
   {
     if (numSamplesMade.n_elem == 0)
@@ -229,6 +245,10 @@ class RASearchRules
   // TO REMOVE: just for testing
   size_t numDistComputations;
 
+  //! The random number generator used for sampling.  Searches that run at the
+  //! same time must each use their own.
+  boost::mt19937* randomGenerator;
+
   TraversalInfoType traversalInfo;
 
   /**
@@ -25,7 +25,8 @@ RASearchRules(const arma::mat& referenceSet,
               const bool naive,
               const bool sampleAtLeaves,
               const bool firstLeafExact,
-              const size_t singleSampleLimit) :
+              const size_t singleSampleLimit,
+              const size_t numSamplesReqd) :
   referenceSet(referenceSet),
   querySet(querySet),
   neighbors(neighbors),
@@ -33,38 +34,45 @@ RASearchRules(const arma::mat& referenceSet,
   metric(metric),
   sampleAtLeaves(sampleAtLeaves),
   firstLeafExact(firstLeafExact),
-  singleSampleLimit(singleSampleLimit)
+  singleSampleLimit(singleSampleLimit),
+  numSamplesReqd(numSamplesReqd),
+  randomGenerator(&math::randGen)
 {
-  // Validate tau to make sure that the rank approximation is greater than the
-  // number of neighbors requested.
-
-  // The rank approximation.
   const size_t n = referenceSet.n_cols;
-  const size_t k = neighbors.n_rows;
-  const size_t t = (size_t) std::ceil(tau * (double) n / 100.0);
-  if (t < k)
+  if (numSamplesReqd == 0)
   {
-    Log::Warn << "Rank-approximation percentile " << tau << " corresponds to "
-        << t << " points, which is less than k (" << k << ").";
-    Log::Fatal << "Cannot return " << k << " approximate nearest neighbors "
-        << "from the nearest " << t << " points.  Increase tau!" << std::endl;
-  }
-  else if (t == k)
-    Log::Warn << "Rank-approximation percentile " << tau << " corresponds to "
-        << t << " points; because k = " << k << ", this is exact search!"
-        << std::endl;
+    // Validate tau to make sure that the rank approximation is greater than
+    // the number of neighbors requested.
 
-  Timer::Start("computing_number_of_samples_reqd");
-  numSamplesReqd = MinimumSamplesReqd(n, k, tau, alpha);
-  Timer::Stop("computing_number_of_samples_reqd");
+    // The rank approximation.
+    const size_t k = neighbors.n_rows;
+    const size_t t = (size_t) std::ceil(tau * (double) n / 100.0);
+    if (t < k)
+    {
+      Log::Warn << "Rank-approximation percentile " << tau << " corresponds to "
+          << t << " points, which is less than k (" << k << ").";
+      Log::Fatal << "Cannot return " << k << " approximate nearest neighbors "
+          << "from the nearest " << t << " points.  Increase tau!"
+          << std::endl;
+    }
+    else if (t == k)
+      Log::Warn << "Rank-approximation percentile " << tau << " corresponds to "
+          << t << " points; because k = " << k << ", this is exact search!"
+          << std::endl;
+
+    Timer::Start("computing_number_of_samples_reqd");
+    this->numSamplesReqd = MinimumSamplesReqd(n, k, tau, alpha);
+    Timer::Stop("computing_number_of_samples_reqd");
+  }
 
   // Initialize some statistics to be collected during the search.
   numSamplesMade = arma::zeros<arma::Col<size_t> >(querySet.n_cols);
   numDistComputations = 0;
-  samplingRatio = (double) numSamplesReqd / (double) n;
+  samplingRatio = (double) this->numSamplesReqd / (double) n;
 
-  Log::Info << "Minimum samples required per query: " << numSamplesReqd <<
-    ", sampling ratio: " << samplingRatio << std::endl;
+  if (numSamplesReqd == 0)
+    Log::Info << "Minimum samples required per query: " << this->numSamplesReqd
+        << ", sampling ratio: " << samplingRatio << std::endl;
 
   if (naive) // No tree traversal; just do naive sampling here.
   {
@@ -72,7 +80,7 @@ RASearchRules(const arma::mat& referenceSet,
     for (size_t i = 0; i < querySet.n_cols; ++i)
     {
       arma::uvec distinctSamples;
-      ObtainDistinctSamples(numSamplesReqd, n, distinctSamples);
+      ObtainDistinctSamples(this->numSamplesReqd, n, distinctSamples);
       for (size_t j = 0; j < distinctSamples.n_elem; j++)
         BaseCase(i, (size_t) distinctSamples[j]);
     }
@@ -91,8 +99,11 @@ ObtainDistinctSamples(const size_t numSamples,
   arma::Col<size_t> sampledPoints;
   sampledPoints.zeros(rangeUpperBound);
 
+  // The generator gives uniform 32-bit integers, so this is a uniform integer
+  // in [0, rangeUpperBound), computed the same way as math::RandInt().
   for (size_t i = 0; i < numSamples; i++)
-    sampledPoints[(size_t) math::RandInt(rangeUpperBound)]++;
+    sampledPoints[(size_t) std::floor((double) rangeUpperBound *
+        ((double) (*randomGenerator)() / 4294967296.0))]++;
 
   distinctSamples = arma::find(sampledPoints > 0);
   return;
@@ -268,7 +279,9 @@ double RASearchRules<SortPolicy, MetricType, TreeType>::BaseCase(
 {
   // If the datasets are the same, then this search is only using one dataset
   // and we should not return identical points.
-  if ((&querySet == &referenceSet) && (queryIndex == referenceIndex))
+  // The points are compared by address, so that this also works when the query
+  // set is a view of part of the reference set.
+  if (querySet.colptr(queryIndex) == referenceSet.colptr(referenceIndex))
     return 0.0;
 
   double distance = metric.Evaluate(querySet.unsafe_col(queryIndex),
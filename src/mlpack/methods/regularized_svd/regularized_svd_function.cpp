@@ -23,6 +23,29 @@ RegularizedSVDFunction::RegularizedSVDFunction(const arma::mat& data,
   
   // Initialize the parameters.
   initialPoint.randu(rank, numUsers + numItems);
+
+  // Group the examples by user and by item, for the full gradient.
+  GroupExamples(0, numUsers, userStart, userExamples);
+  GroupExamples(1, numItems, itemStart, itemExamples);
+}
+
+void RegularizedSVDFunction::GroupExamples(const size_t row,
+                                           const size_t numGroups,
+                                           arma::Col<size_t>& start,
+                                           arma::Col<size_t>& examples) const
+{
+  // Count the examples of each group, then place each example after the
+  // examples of the preceding groups.
+  start.zeros(numGroups + 1);
+  for (size_t i = 0; i < data.n_cols; ++i)
+    ++start[(size_t) data(row, i) + 1];
+  for (size_t g = 0; g < numGroups; ++g)
+    start[g + 1] += start[g];
+
+  examples.set_size(data.n_cols);
+  arma::Col<size_t> next = start.subvec(0, numGroups - 1);
+  for (size_t i = 0; i < data.n_cols; ++i)
+    examples[next[(size_t) data(row, i)]++] = i;
 }
 
 double RegularizedSVDFunction::Evaluate(const arma::mat& parameters) const
@@ -36,27 +59,10 @@ double RegularizedSVDFunction::Evaluate(const arma::mat& parameters) const
 
   double cost = 0.0;
 
-  for(size_t i = 0; i < data.n_cols; i++)
-  {
-    // Indices for accessing the the correct parameter columns.
-    const size_t user = data(0, i);
-    const size_t item = data(1, i) + numUsers;
+  #pragma omp parallel for schedule(static) reduction(+:cost)
+  for (size_t i = 0; i < data.n_cols; ++i)
+    cost += Evaluate(parameters, i);
 
-    // Calculate the squared error in the prediction.
-    const double rating = data(2, i);
-    double ratingError = rating - arma::dot(parameters.col(user),
-                                            parameters.col(item));
-    double ratingErrorSquared = ratingError * ratingError;
-  
-    // Calculate the regularization penalty corresponding to the parameters.
-    double userVecNorm = arma::norm(parameters.col(user), 2);
-    double itemVecNorm = arma::norm(parameters.col(item), 2);
-    double regularizationError = lambda * (userVecNorm * userVecNorm +
-                                           itemVecNorm * itemVecNorm);
-                                           
-    cost += (ratingErrorSquared + regularizationError);
-  }
-  
   return cost;
 }
 
@@ -67,18 +73,23 @@ double RegularizedSVDFunction::Evaluate(const arma::mat& parameters,
   const size_t user = data(0, i);
   const size_t item = data(1, i) + numUsers;
   
-  // Calculate the squared error in the prediction.
-  const double rating = data(2, i);
-  double ratingError = rating - arma::dot(parameters.col(user),
-                                          parameters.col(item));
-  double ratingErrorSquared = ratingError * ratingError;
-  
-  // Calculate the regularization penalty corresponding to the parameters.
-  double userVecNorm = arma::norm(parameters.col(user), 2);
-  double itemVecNorm = arma::norm(parameters.col(item), 2);
-  double regularizationError = lambda * (userVecNorm * userVecNorm +
-                                         itemVecNorm * itemVecNorm);
-                                         
+  // Calculate the squared error in the prediction, and the regularization
+  // penalty corresponding to the parameters.
+  const double* userVec = parameters.colptr(user);
+  const double* itemVec = parameters.colptr(item);
+  double ratingError = data(2, i);
+  double userVecNormSquared = 0.0;
+  double itemVecNormSquared = 0.0;
+  for (size_t r = 0; r < rank; ++r)
+  {
+    ratingError -= userVec[r] * itemVec[r];
+    userVecNormSquared += userVec[r] * userVec[r];
+    itemVecNormSquared += itemVec[r] * itemVec[r];
+  }
+  const double ratingErrorSquared = ratingError * ratingError;
+  const double regularizationError = lambda * (userVecNormSquared +
+                                               itemVecNormSquared);
+
   return (ratingErrorSquared + regularizationError);
 }
 
@@ -94,25 +105,85 @@ void RegularizedSVDFunction::Gradient(const arma::mat& parameters,
   // The full gradient is calculated by summing the contributions over all the
   // training examples.
 
-  gradient.zeros(rank, numUsers + numItems);
-
-  for(size_t i = 0; i < data.n_cols; i++)
+  // Prediction error for each example.
+  arma::vec ratingErrors(data.n_cols);
+  #pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < data.n_cols; ++i)
   {
-    // Indices for accessing the the correct parameter columns.
     const size_t user = data(0, i);
     const size_t item = data(1, i) + numUsers;
+    ratingErrors[i] = data(2, i) - arma::dot(parameters.col(user),
+                                             parameters.col(item));
+  }
 
-    // Prediction error for the example.
-    const double rating = data(2, i);
-    double ratingError = rating - arma::dot(parameters.col(user),
-                                            parameters.col(item));
+  gradient.set_size(rank, numUsers + numItems);
 
-    // Gradient is non-zero only for the parameter columns corresponding to the
-    // example.
-    gradient.col(user) += 2 * (lambda * parameters.col(user) -
-                               ratingError * parameters.col(item));
-    gradient.col(item) += 2 * (lambda * parameters.col(item) -
-                               ratingError * parameters.col(user));
+  // The gradient for a user column only depends on the examples of that user,
+  // so every column is accumulated on its own.
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (size_t user = 0; user < numUsers; ++user)
+  {
+    double* grad = gradient.colptr(user);
+    const double* userVec = parameters.colptr(user);
+    const size_t count = userStart[user + 1] - userStart[user];
+    for (size_t r = 0; r < rank; ++r)
+      grad[r] = 2 * lambda * count * userVec[r];
+
+    for (size_t k = userStart[user]; k < userStart[user + 1]; ++k)
+    {
+      const size_t i = userExamples[k];
+      const double* itemVec = parameters.colptr(data(1, i) + numUsers);
+      for (size_t r = 0; r < rank; ++r)
+        grad[r] -= 2 * ratingErrors[i] * itemVec[r];
+    }
+  }
+
+  // Likewise for the item columns.
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (size_t item = 0; item < numItems; ++item)
+  {
+    double* grad = gradient.colptr(item + numUsers);
+    const double* itemVec = parameters.colptr(item + numUsers);
+    const size_t count = itemStart[item + 1] - itemStart[item];
+    for (size_t r = 0; r < rank; ++r)
+      grad[r] = 2 * lambda * count * itemVec[r];
+
+    for (size_t k = itemStart[item]; k < itemStart[item + 1]; ++k)
+    {
+      const size_t i = itemExamples[k];
+      const double* userVec = parameters.colptr(data(0, i));
+      for (size_t r = 0; r < rank; ++r)
+        grad[r] -= 2 * ratingErrors[i] * userVec[r];
+    }
+  }
+}
+
+void RegularizedSVDFunction::Gradient(const arma::mat& parameters,
+                                      const size_t i,
+                                      arma::uvec& indices,
+                                      arma::vec& values) const
+{
+  // Indices for accessing the the correct parameter columns.
+  const size_t user = data(0, i);
+  const size_t item = data(1, i) + numUsers;
+
+  // Prediction error for the example.
+  const double* userVec = parameters.colptr(user);
+  const double* itemVec = parameters.colptr(item);
+  double ratingError = data(2, i);
+  for (size_t r = 0; r < rank; ++r)
+    ratingError -= userVec[r] * itemVec[r];
+
+  // Gradient is non-zero only for the parameter columns corresponding to the
+  // example.
+  indices.set_size(2 * rank);
+  values.set_size(2 * rank);
+  for (size_t r = 0; r < rank; ++r)
+  {
+    indices[r] = user * rank + r;
+    values[r] = 2 * (lambda * userVec[r] - ratingError * itemVec[r]);
+    indices[rank + r] = item * rank + r;
+    values[rank + r] = 2 * (lambda * itemVec[r] - ratingError * userVec[r]);
   }
 }
 
@@ -124,7 +195,8 @@ namespace mlpack {
 namespace optimization {
 
 template<>
-double SGD<mlpack::svd::RegularizedSVDFunction>::Optimize(arma::mat& parameters)
+double SGDType<mlpack::svd::RegularizedSVDFunction, VanillaUpdate>::Optimize(
+    arma::mat& parameters)
 {
   // Find the number of functions to use.
   const size_t numFunctions = function.NumFunctions();
@@ -137,7 +209,10 @@ double SGD<mlpack::svd::RegularizedSVDFunction>::Optimize(arma::mat& parameters)
   for(size_t i = 0; i < numFunctions; i++)
     overallObjective += function.Evaluate(parameters, i);
     
-  const arma::mat data = function.Dataset();
+  const arma::mat& data = function.Dataset();
+  const size_t numUsers = function.NumUsers();
+  const size_t rank = function.Rank();
+  const double lambda = function.Lambda();
 
   // Now iterate!
   for(size_t i = 1; i != maxIterations; i++, currentFunction++)
@@ -150,8 +225,6 @@ double SGD<mlpack::svd::RegularizedSVDFunction>::Optimize(arma::mat& parameters)
       currentFunction = 0;
     }
 
-    const size_t numUsers = function.NumUsers();
-
     // Indices for accessing the the correct parameter columns.
     const size_t user = data(0, currentFunction);
     const size_t item = data(1, currentFunction) + numUsers;
@@ -160,15 +233,17 @@ double SGD<mlpack::svd::RegularizedSVDFunction>::Optimize(arma::mat& parameters)
     const double rating = data(2, currentFunction);
     double ratingError = rating - arma::dot(parameters.col(user),
                                             parameters.col(item));
-                                            
-    double lambda = function.Lambda();
 
     // Gradient is non-zero only for the parameter columns corresponding to the
-    // example.
-    parameters.col(user) -= stepSize * (lambda * parameters.col(user) -
-                                        ratingError * parameters.col(item));
-    parameters.col(item) -= stepSize * (lambda * parameters.col(item) -
-                                        ratingError * parameters.col(user));
+    // example, so only those two columns are updated, in place.  (The item
+    // column is updated with the new user column.)
+    double* userVec = parameters.colptr(user);
+    double* itemVec = parameters.colptr(item);
+    for (size_t r = 0; r < rank; ++r)
+    {
+      userVec[r] -= stepSize * (lambda * userVec[r] - ratingError * itemVec[r]);
+      itemVec[r] -= stepSize * (lambda * itemVec[r] - ratingError * userVec[r]);
+    }
 
     // Now add that to the overall objective function.
     overallObjective += function.Evaluate(parameters, currentFunction);
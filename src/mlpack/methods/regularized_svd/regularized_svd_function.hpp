@@ -32,7 +32,8 @@ class RegularizedSVDFunction
                          const double lambda);
   
   /**
-   * Evaluates the cost function over all examples in the data.
+   * Evaluates the cost function over all examples in the data.  The examples
+   * are summed in parallel, if OpenMP is available.
    *
    * @param parameters Parameters(user/item matrices) of the decomposition.
    */
@@ -50,13 +51,31 @@ class RegularizedSVDFunction
   
   /**
    * Evaluates the full gradient of the cost function over all the training
-   * examples.
+   * examples.  The prediction errors are computed in parallel, and then each
+   * parameter column sums the contributions of its own examples, so that the
+   * columns can be filled in parallel without per-thread copies of the
+   * gradient.  Columns of users and items with no examples are zero.
    *
    * @param parameters Parameters(user/item matrices) of the decomposition.
    * @param gradient Calculated gradient for the parameters.
    */
   void Gradient(const arma::mat& parameters,
                 arma::mat& gradient) const;
+
+  /**
+   * Evaluates the gradient of the cost function for one training example, as a
+   * sparse gradient: only the parameter columns of the user and the item of the
+   * example are nonzero.  This is used by the ParallelSGD optimizer.
+   *
+   * @param parameters Parameters(user/item matrices) of the decomposition.
+   * @param i Index of the training example to be used.
+   * @param indices Linear indices of the nonzero elements of the gradient.
+   * @param values Values of the nonzero elements of the gradient.
+   */
+  void Gradient(const arma::mat& parameters,
+                const size_t i,
+                arma::uvec& indices,
+                arma::vec& values) const;
   
   //! Return the initial point for the optimization.
   const arma::mat& GetInitialPoint() const { return initialPoint; }
@@ -92,6 +111,26 @@ class RegularizedSVDFunction
   size_t numUsers;
   //! Number of items in the given dataset.
   size_t numItems;
+
+  //! Index of the first example of each user in userExamples (and the number
+  //! of examples, last).
+  arma::Col<size_t> userStart;
+  //! Indices of the examples, grouped by user.
+  arma::Col<size_t> userExamples;
+  //! Index of the first example of each item in itemExamples (and the number
+  //! of examples, last).
+  arma::Col<size_t> itemStart;
+  //! Indices of the examples, grouped by item.
+  arma::Col<size_t> itemExamples;
+
+  /**
+   * Group the examples by the value of the given row of the data (0 for users,
+   * 1 for items).
+   */
+  void GroupExamples(const size_t row,
+                     const size_t numGroups,
+                     arma::Col<size_t>& start,
+                     arma::Col<size_t>& examples) const;
 };
 
 }; // namespace svd
@@ -106,7 +145,7 @@ namespace optimization {
    * abstraction does not work as fast as we might like it to.
    */
   template<>
-  double SGD<mlpack::svd::RegularizedSVDFunction>::Optimize(
+  double SGDType<mlpack::svd::RegularizedSVDFunction, VanillaUpdate>::Optimize(
       arma::mat& parameters);
 
 }; // namespace optimization
@@ -11,6 +11,7 @@
 #include <mlpack/core/optimizers/lbfgs/lbfgs.hpp>
 
 #include "softmax_regression_function.hpp"
+#include "softmax_regression_scorer.hpp"
 
 namespace mlpack {
 namespace regression {
@@ -53,10 +54,17 @@ namespace regression {
  * regressor1.Predict(test_data, predictions1);
  * regressor2.Predict(test_data, predictions2);
  * @endcode
+ *
+ * Sparse training and test data (arma::sp_mat) can be used by setting the
+ * MatType template parameter, e.g. SoftmaxRegression<L_BFGS, arma::sp_mat>.
+ *
+ * @tparam OptimizerType Optimizer used to train the model.
+ * @tparam MatType Type of the data matrices (arma::mat or arma::sp_mat).
  */
 
 template<
-  template<typename> class OptimizerType = mlpack::optimization::L_BFGS
+  template<typename> class OptimizerType = mlpack::optimization::L_BFGS,
+  typename MatType = arma::mat
 >
 class SoftmaxRegression
 {
@@ -74,7 +82,7 @@ class SoftmaxRegression
    * @param numClasses Number of classes for classification.
    * @param lambda L2-regularization constant.
    */
-  SoftmaxRegression(const arma::mat& data,
+  SoftmaxRegression(const MatType& data,
                     const arma::vec& labels,
                     const size_t inputSize,
                     const size_t numClasses,
@@ -89,7 +97,8 @@ class SoftmaxRegression
    *
    * @param optimizer Instantiated optimizer with instantiated error function.
    */
-  SoftmaxRegression(OptimizerType<SoftmaxRegressionFunction>& optimizer);
+  SoftmaxRegression(
+      OptimizerType<SoftmaxRegressionFunctionType<MatType> >& optimizer);
   
   /**
    * Predict the class labels for the provided feature points. The function
@@ -99,7 +108,7 @@ class SoftmaxRegression
    * @param testData Matrix of data points for which predictions are to be made.
    * @param predictions Vector to store the predictions in.
    */
-  void Predict(const arma::mat& testData, arma::vec& predictions);
+  void Predict(const MatType& testData, arma::vec& predictions);
   
   /**
    * Computes accuracy of the learned model given the feature data and the
@@ -109,8 +118,13 @@ class SoftmaxRegression
    * @param testData Matrix of data points using which predictions are made.
    * @param labels Vector of labels associated with the data.
    */
-  double ComputeAccuracy(const arma::mat& testData, const arma::vec& labels);
+  double ComputeAccuracy(const MatType& testData, const arma::vec& labels);
                     
+  //! Get the parameters of the model (one row per class).
+  const arma::mat& Parameters() const { return parameters; }
+  //! Modify the parameters of the model (one row per class).
+  arma::mat& Parameters() { return parameters; }
+
   //! Sets the size of the input vector.
   void InputSize(const size_t input)
   {
@@ -13,7 +13,16 @@
 namespace mlpack {
 namespace regression {
 
-class SoftmaxRegressionFunction
+/**
+ * The objective function of softmax regression.  The training data may be dense
+ * (arma::mat; see the SoftmaxRegressionFunction typedef) or sparse
+ * (arma::sp_mat; see SparseSoftmaxRegressionFunction), in which case the memory
+ * and the time scale with the number of nonzero features.
+ *
+ * @tparam MatType Type of the training data (arma::mat or arma::sp_mat).
+ */
+template<typename MatType = arma::mat>
+class SoftmaxRegressionFunctionType
 {
  public:
   /**
@@ -26,11 +35,11 @@ class SoftmaxRegressionFunction
    * @param numClasses Number of classes for classification.
    * @param lambda L2-regularization constant.
    */
-  SoftmaxRegressionFunction(const arma::mat& data,
-                            const arma::vec& labels,
-                            const size_t inputSize,
-                            const size_t numClasses,
-                            const double lambda = 0.0001);
+  SoftmaxRegressionFunctionType(const MatType& data,
+                                const arma::vec& labels,
+                                const size_t inputSize,
+                                const size_t numClasses,
+                                const double lambda = 0.0001);
                             
   //! Initializes the parameters of the model to suitable values.
   const arma::mat InitializeWeights();
@@ -64,6 +73,18 @@ class SoftmaxRegressionFunction
    * @param gradient Matrix where gradient values will be stored.
    */
   void Gradient(const arma::mat& parameters, arma::mat& gradient) const;
+
+  /**
+   * Evaluates the objective function and its gradient given the current set
+   * of parameters.  The class probabilities are only calculated once, so this
+   * is faster than calling Evaluate() and Gradient(); L_BFGS uses it when it is
+   * available.
+   *
+   * @param parameters Current values of the model parameters.
+   * @param gradient Matrix where gradient values will be stored.
+   */
+  double EvaluateWithGradient(const arma::mat& parameters,
+                              arma::mat& gradient) const;
   
   //! Return the initial point for the optimization.
   const arma::mat& GetInitialPoint() const { return initialPoint; }
@@ -105,12 +126,42 @@ class SoftmaxRegressionFunction
   }
                             
  private:
+  /**
+   * Computes the objective function with the given parameters, and the
+   * gradient too if the given pointer is not NULL.  The training examples are
+   * processed in blocks, in parallel (with OpenMP).  If the gradient is
+   * requested for a model larger than ClassBlockedSize, this calls
+   * AccumulateByClass() instead.
+   *
+   * @param parameters Current values of the model parameters.
+   * @param gradient Matrix where gradient values will be stored, or NULL.
+   */
+  double Accumulate(const arma::mat& parameters, arma::mat* gradient) const;
+
+  /**
+   * Computes the objective function and the gradient with the threads
+   * splitting the classes instead of the training examples: the blocks of
+   * examples are processed one after the other, and for each block, each
+   * thread computes the scores and the gradient of its own blocks of classes.
+   * So no thread needs a gradient accumulator of its own, which matters with
+   * many classes (a model with 10000 classes of 1000 features takes 80 MB).
+   *
+   * @param parameters Current values of the model parameters.
+   * @param gradient Matrix where gradient values will be stored.
+   */
+  double AccumulateByClass(const arma::mat& parameters,
+                           arma::mat& gradient) const;
+
+  //! The number of parameters above which the gradient is computed with the
+  //! threads splitting the classes (see AccumulateByClass()).
+  static const size_t ClassBlockedSize = 1 << 20;
+  //! The number of classes each thread handles at once in AccumulateByClass().
+  static const size_t ClassBlockSize = 64;
+
   //! Training data matrix.
-  const arma::mat& data;
+  const MatType& data;
   //! Labels associated with the training data.
   const arma::vec& labels;
-  //! Label matrix for the provided data.
-  arma::sp_mat groundTruth;
   //! Initial parameter point.
   arma::mat initialPoint;
   //! Size of input feature vector.
@@ -121,7 +172,16 @@ class SoftmaxRegressionFunction
   double lambda;
 };
 
+//! The softmax regression function, with dense data.
+typedef SoftmaxRegressionFunctionType<arma::mat> SoftmaxRegressionFunction;
+//! The softmax regression function, with sparse data.
+typedef SoftmaxRegressionFunctionType<arma::sp_mat>
+    SparseSoftmaxRegressionFunction;
+
 }; // namespace regression
 }; // namespace mlpack
 
+// Include implementation.
+#include "softmax_regression_function_impl.hpp"
+
 #endif
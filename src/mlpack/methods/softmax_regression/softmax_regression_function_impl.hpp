@@ -0,0 +1,297 @@
+/**
+ * @file softmax_regression_function_impl.hpp
+ * @author Siddharth Agrawal
+ *
+ * Implementation of function to be optimized for softmax regression.
+ */
+#ifndef __MLPACK_METHODS_SOFTMAX_REGRESSION_SOFTMAX_REGRESSION_FUNCTION_IMPL_HPP
+#define __MLPACK_METHODS_SOFTMAX_REGRESSION_SOFTMAX_REGRESSION_FUNCTION_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "softmax_regression_function.hpp"
+
+namespace mlpack {
+namespace regression {
+
+template<typename MatType>
+SoftmaxRegressionFunctionType<MatType>::SoftmaxRegressionFunctionType(
+    const MatType& data,
+    const arma::vec& labels,
+    const size_t inputSize,
+    const size_t numClasses,
+    const double lambda) :
+    data(data),
+    labels(labels),
+    inputSize(inputSize),
+    numClasses(numClasses),
+    lambda(lambda)
+{
+  // Intialize the parameters to suitable values.
+  initialPoint = InitializeWeights();
+}
+
+/**
+ * Initializes parameter weights to random values taken from a scaled standard
+ * normal distribution. The weights cannot be initialized to zero, as that will
+ * lead to each class output being the same.
+ */
+template<typename MatType>
+const arma::mat SoftmaxRegressionFunctionType<MatType>::InitializeWeights()
+{
+  // Initialize values to 0.005 * r. 'r' is a matrix of random values taken from
+  // a Gaussian distribution with mean zero and variance one.
+  arma::mat parameters;
+  parameters.randn(numClasses, inputSize);
+  parameters = 0.005 * parameters;
+  
+  return parameters;
+}
+
+/** 
+ * This is equivalent to applying the indicator function to the training
+ * labels. The output is in the form of a matrix.  Evaluate() and Gradient() do
+ * not use it; they index the probabilities with the labels directly.
+ */
+template<typename MatType>
+void SoftmaxRegressionFunctionType<MatType>::GetGroundTruthMatrix(
+    const arma::vec& labels,
+    arma::sp_mat& groundTruth)
+{
+  // Calculate the ground truth matrix according to the labels passed. The
+  // ground truth matrix is a matrix of dimensions 'numClasses * numExamples',
+  // where each column contains a single entry of '1', marking the label
+  // corresponding to that example.
+  
+  // Row pointers and column pointers corresponding to the entries.
+  arma::uvec rowPointers(labels.n_elem);
+  arma::uvec colPointers(labels.n_elem + 1);
+  
+  // Row pointers are the labels of the examples, and column pointers are the
+  // number of cumulative entries made uptil that column.
+  for(size_t i = 0; i < labels.n_elem; i++)
+  {
+    rowPointers(i) = labels(i, 0);
+    colPointers(i+1) = i + 1;
+  }
+  
+  // All entries are '1'.
+  arma::vec values;
+  values.ones(labels.n_elem);
+  
+  // Calculate the matrix.
+  groundTruth = arma::sp_mat(rowPointers, colPointers, values, numClasses,
+                             labels.n_elem);
+}
+
+/**
+ * Evaluates the objective function given the parameters.
+ */
+template<typename MatType>
+double SoftmaxRegressionFunctionType<MatType>::Evaluate(
+    const arma::mat& parameters) const
+{
+  // The objective function is the negative log likelihood of the model
+  // calculated over all the training examples. Mathematically it is as follows:
+  // log likelihood = sum(1{y_i = j} * log(probability(j))) / m
+  // The sum is over all 'i's and 'j's, where 'i' points to a training example
+  // and 'j' points to a particular class. 1{x} is an indicator function whose
+  // value is 1 only when 'x' is satisfied, otherwise it is 0.
+  // 'm' is the number of training examples.
+  // The cost also takes into account the regularization to control the
+  // parameter weights.
+  return Accumulate(parameters, NULL);
+}
+
+/**
+ * Calculates and stores the gradient values given a set of parameters.
+ */
+template<typename MatType>
+void SoftmaxRegressionFunctionType<MatType>::Gradient(
+    const arma::mat& parameters,
+    arma::mat& gradient) const
+{
+  Accumulate(parameters, &gradient);
+}
+
+/**
+ * Evaluates the objective function and stores the gradient values, sharing the
+ * class probabilities between the two.
+ */
+template<typename MatType>
+double SoftmaxRegressionFunctionType<MatType>::EvaluateWithGradient(
+    const arma::mat& parameters,
+    arma::mat& gradient) const
+{
+  return Accumulate(parameters, &gradient);
+}
+
+/**
+ * Computes the objective function (and the gradient, if requested) over blocks
+ * of training examples, in parallel.  Each thread sums the gradient of its
+ * blocks into its own accumulator, and the labels are used directly to index
+ * the probabilities instead of a ground truth matrix.  With sparse data, both
+ * products with the data are sparse-dense products.
+ */
+template<typename MatType>
+double SoftmaxRegressionFunctionType<MatType>::Accumulate(
+    const arma::mat& parameters,
+    arma::mat* gradient) const
+{
+  // A gradient accumulator for each thread would take too much memory with a
+  // large model, so then the threads split the classes instead.
+  if (gradient && parameters.n_elem > ClassBlockedSize &&
+      util::NumThreads() > 1)
+    return AccumulateByClass(parameters, *gradient);
+
+  // Enough examples per block to make the matrix operations efficient, and few
+  // enough that the probabilities of the block stay in cache.
+  const size_t blockSize = 1024;
+  const size_t numBlocks = (data.n_cols + blockSize - 1) / blockSize;
+
+  if (gradient)
+    gradient->zeros(parameters.n_rows, parameters.n_cols);
+
+  double logLikelihood = 0;
+  #pragma omp parallel reduction(+:logLikelihood)
+  {
+    arma::mat threadGradient, probabilities;
+    if (gradient)
+      threadGradient.zeros(parameters.n_rows, parameters.n_cols);
+
+    #pragma omp for schedule(static)
+    for (size_t b = 0; b < numBlocks; ++b)
+    {
+      const size_t begin = b * blockSize;
+      const size_t end = std::min(begin + blockSize, (size_t) data.n_cols) - 1;
+
+      // Calculate the class probabilities for each training example of the
+      // block.  The probabilities for each of the classes are given by:
+      // p_j = exp(theta_j' * x_i) / sum(exp(theta_k' * x_i))
+      // The sum is calculated over all the classes.  The largest exponent of
+      // each example is subtracted first, which does not change the result
+      // but avoids overflow.
+      probabilities = parameters * data.cols(begin, end);
+      for (size_t i = 0; i < probabilities.n_cols; ++i)
+      {
+        double* column = probabilities.colptr(i);
+        const double maxExponent = arma::max(probabilities.col(i));
+
+        double sum = 0;
+        for (size_t j = 0; j < probabilities.n_rows; ++j)
+        {
+          column[j] = std::exp(column[j] - maxExponent);
+          sum += column[j];
+        }
+        for (size_t j = 0; j < probabilities.n_rows; ++j)
+          column[j] /= sum;
+
+        // Only the probability of the true class contributes to the log
+        // likelihood; subtracting 1 from it gives (probabilities - ground
+        // truth) for the gradient.
+        const size_t label = (size_t) labels(begin + i);
+        logLikelihood += std::log(column[label]);
+        column[label] -= 1;
+      }
+
+      if (gradient)
+        threadGradient += probabilities * data.cols(begin, end).t();
+    }
+
+    if (gradient)
+    {
+      #pragma omp critical
+      *gradient += threadGradient;
+    }
+  }
+
+  // Add the regularization terms.
+  if (gradient)
+    *gradient = *gradient / data.n_cols + lambda * parameters;
+
+  // The cost is the sum of the negative log likelihood and the regularization
+  // terms.
+  return -logLikelihood / data.n_cols + 0.5 * lambda *
+      arma::accu(parameters % parameters);
+}
+
+/**
+ * Computes the objective function and the gradient with the threads splitting
+ * the classes of each block of training examples.
+ */
+template<typename MatType>
+double SoftmaxRegressionFunctionType<MatType>::AccumulateByClass(
+    const arma::mat& parameters,
+    arma::mat& gradient) const
+{
+  // The probabilities of a block of examples take at most about 8 MB.
+  const size_t blockSize = std::max((size_t) 16, std::min((size_t) 1024,
+      (size_t) (1 << 20) / parameters.n_rows));
+  const size_t numClassBlocks = (parameters.n_rows + ClassBlockSize - 1) /
+      ClassBlockSize;
+
+  gradient.zeros(parameters.n_rows, parameters.n_cols);
+  arma::mat probabilityBuffer(parameters.n_rows, blockSize);
+
+  double logLikelihood = 0;
+  for (size_t begin = 0; begin < data.n_cols; begin += blockSize)
+  {
+    const size_t end = std::min(begin + blockSize, (size_t) data.n_cols) - 1;
+    const MatType block = data.cols(begin, end);
+    const MatType blockT = block.t();
+    arma::mat probabilities(probabilityBuffer.memptr(), parameters.n_rows,
+        end - begin + 1, false, true);
+
+    // The scores of each block of classes.
+    #pragma omp parallel for schedule(static)
+    for (size_t c = 0; c < numClassBlocks; ++c)
+    {
+      const size_t first = c * ClassBlockSize;
+      const size_t last = std::min(first + ClassBlockSize,
+          (size_t) parameters.n_rows) - 1;
+      probabilities.rows(first, last) = parameters.rows(first, last) * block;
+    }
+
+    // Normalize the probabilities of each example (as in Accumulate()), and
+    // subtract the ground truth.
+    #pragma omp parallel for schedule(static) reduction(+:logLikelihood)
+    for (size_t i = 0; i < probabilities.n_cols; ++i)
+    {
+      double* column = probabilities.colptr(i);
+      const double maxExponent = arma::max(probabilities.col(i));
+
+      double sum = 0;
+      for (size_t j = 0; j < probabilities.n_rows; ++j)
+      {
+        column[j] = std::exp(column[j] - maxExponent);
+        sum += column[j];
+      }
+      for (size_t j = 0; j < probabilities.n_rows; ++j)
+        column[j] /= sum;
+
+      const size_t label = (size_t) labels(begin + i);
+      logLikelihood += std::log(column[label]);
+      column[label] -= 1;
+    }
+
+    // Each thread adds to the rows of the gradient of its blocks of classes.
+    #pragma omp parallel for schedule(static)
+    for (size_t c = 0; c < numClassBlocks; ++c)
+    {
+      const size_t first = c * ClassBlockSize;
+      const size_t last = std::min(first + ClassBlockSize,
+          (size_t) parameters.n_rows) - 1;
+      gradient.rows(first, last) += probabilities.rows(first, last) * blockT;
+    }
+  }
+
+  // Add the regularization terms.
+  gradient = gradient / data.n_cols + lambda * parameters;
+
+  return -logLikelihood / data.n_cols + 0.5 * lambda *
+      arma::accu(parameters % parameters);
+}
+
+}; // namespace regression
+}; // namespace mlpack
+
+#endif
@@ -13,19 +13,20 @@
 namespace mlpack {
 namespace regression {
 
-template<template<typename> class OptimizerType>
-SoftmaxRegression<OptimizerType>::SoftmaxRegression(const arma::mat& data,
-                                                    const arma::vec& labels,
-                                                    const size_t inputSize,
-                                                    const size_t numClasses,
-                                                    const double lambda) :
+template<template<typename> class OptimizerType, typename MatType>
+SoftmaxRegression<OptimizerType, MatType>::SoftmaxRegression(
+    const MatType& data,
+    const arma::vec& labels,
+    const size_t inputSize,
+    const size_t numClasses,
+    const double lambda) :
     inputSize(inputSize),
     numClasses(numClasses),
     lambda(lambda)
 {
-  SoftmaxRegressionFunction regressor(data, labels, inputSize, numClasses,
-                                      lambda);
-  OptimizerType<SoftmaxRegressionFunction> optimizer(regressor);
+  SoftmaxRegressionFunctionType<MatType> regressor(data, labels, inputSize,
+                                                   numClasses, lambda);
+  OptimizerType<SoftmaxRegressionFunctionType<MatType> > optimizer(regressor);
   
   parameters = regressor.GetInitialPoint();
 
@@ -38,9 +39,9 @@ SoftmaxRegression<OptimizerType>::SoftmaxRegression(const arma::mat& data,
       << "trained model is " << out << "." << std::endl;
 }
 
-template<template<typename> class OptimizerType>
-SoftmaxRegression<OptimizerType>::SoftmaxRegression(
-    OptimizerType<SoftmaxRegressionFunction>& optimizer) :
+template<template<typename> class OptimizerType, typename MatType>
+SoftmaxRegression<OptimizerType, MatType>::SoftmaxRegression(
+    OptimizerType<SoftmaxRegressionFunctionType<MatType> >& optimizer) :
     parameters(optimizer.Function().GetInitialPoint()),
     inputSize(optimizer.Function().InputSize()),
     numClasses(optimizer.Function().NumClasses()),
@@ -55,43 +56,43 @@ SoftmaxRegression<OptimizerType>::SoftmaxRegression(
       << "trained model is " << out << "." << std::endl;
 }
 
-template<template<typename> class OptimizerType>
-void SoftmaxRegression<OptimizerType>::Predict(const arma::mat& testData,
-                                               arma::vec& predictions)
+template<template<typename> class OptimizerType, typename MatType>
+void SoftmaxRegression<OptimizerType, MatType>::Predict(
+    const MatType& testData,
+    arma::vec& predictions)
 {
-  // Calculate the probabilities for each test input.
-  arma::mat hypothesis, probabilities;
-  
-  hypothesis = arma::exp(parameters * testData);
-  probabilities = hypothesis / arma::repmat(arma::sum(hypothesis, 0),
-                                            numClasses, 1);
-  
-  // Prepare necessary data.
-  predictions.zeros(testData.n_cols);
-  double maxProbability = 0;
-  
-  // For each test input.
-  for(size_t i = 0; i < testData.n_cols; i++)
+  // The class with the highest probability is the class with the highest
+  // score, so neither the exponentials nor the normalization are needed.  The
+  // scores of each block of points are computed with one matrix
+  // multiplication, and the blocks are handled in parallel.
+  const size_t blockSize = 256;
+  const size_t numBlocks = (testData.n_cols + blockSize - 1) / blockSize;
+  predictions.set_size(testData.n_cols);
+
+  #pragma omp parallel for schedule(static)
+  for (size_t b = 0; b < numBlocks; ++b)
   {
-    // For each class.
-    for(size_t j = 0; j < numClasses; j++)
+    const size_t begin = b * blockSize;
+    const size_t end = std::min(begin + blockSize, (size_t) testData.n_cols) -
+        1;
+    const arma::mat scores = parameters * testData.cols(begin, end);
+
+    for (size_t i = 0; i < scores.n_cols; ++i)
     {
-      // If a higher class probability is encountered, change prediction.
-      if(probabilities(j, i) > maxProbability)
-      {
-        maxProbability = probabilities(j, i);
-        predictions(i) = j;
-      }
+      const double* column = scores.colptr(i);
+      size_t best = 0;
+      for (size_t j = 1; j < scores.n_rows; ++j)
+        if (column[j] > column[best])
+          best = j;
+
+      predictions[begin + i] = best;
     }
-    
-    // Set maximum probability to zero for the next input.
-    maxProbability = 0;
   }
 }
 
-template<template<typename> class OptimizerType>
-double SoftmaxRegression<OptimizerType>::ComputeAccuracy(
-    const arma::mat& testData,
+template<template<typename> class OptimizerType, typename MatType>
+double SoftmaxRegression<OptimizerType, MatType>::ComputeAccuracy(
+    const MatType& testData,
     const arma::vec& labels)
 {
   arma::vec predictions;
@@ -0,0 +1,97 @@
+/**
+ * @file softmax_regression_scorer.hpp
+ *
+ * The SoftmaxRegressionScorer class, which predicts with a trained softmax
+ * regression model, for online scoring of batches of points.
+ */
+#ifndef __MLPACK_METHODS_SOFTMAX_REGRESSION_SOFTMAX_REGRESSION_SCORER_HPP
+#define __MLPACK_METHODS_SOFTMAX_REGRESSION_SOFTMAX_REGRESSION_SCORER_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace regression {
+
+/**
+ * A throughput-oriented predictor for a trained softmax regression model (see
+ * SoftmaxRegression).  The model parameters are copied once, at construction,
+ * into the given element type; with ElemType = float, the parameters and the
+ * points are single precision, which halves the memory bandwidth of the
+ * prediction.
+ *
+ * The points are processed in blocks, in parallel (with OpenMP), and the class
+ * scores of a block are computed with one matrix multiplication.  The results
+ * are written into a vector or matrix owned by the caller: if it already has
+ * the right size, no memory is allocated (the per-thread buffers for the
+ * scores are allocated once, at construction).
+ *
+ * Predict() uses the buffers of the scorer, so it must not be called from
+ * several threads at once; each caller thread should have its own scorer.
+ *
+ * @code
+ * SoftmaxRegression<> sr(trainingData, labels, inputSize, numClasses);
+ * SoftmaxRegressionScorer<float> scorer(sr.Parameters());
+ *
+ * arma::fmat batch; // Points to classify, one per column.
+ * arma::Col<size_t> predictions(batch.n_cols);
+ * scorer.Predict(batch, predictions);
+ * @endcode
+ *
+ * @tparam ElemType Element type of the parameters and the points (double or
+ *     float).
+ */
+template<typename ElemType = double>
+class SoftmaxRegressionScorer
+{
+ public:
+  /**
+   * Create the scorer from the parameters of a trained model (see
+   * SoftmaxRegression::Parameters()).
+   *
+   * @param parameters Parameters of the model, one row per class.
+   */
+  SoftmaxRegressionScorer(const arma::mat& parameters);
+
+  /**
+   * Compute the probabilities of each class for the given points.
+   *
+   * @param testData Points to score, one per column.
+   * @param probabilities Matrix to store the probabilities in (one row per
+   *     class, one column per point).
+   */
+  void Probabilities(const arma::Mat<ElemType>& testData,
+                     arma::Mat<ElemType>& probabilities) const;
+
+  /**
+   * Predict the class of each of the given points (the class with the highest
+   * probability).
+   *
+   * @param testData Points to classify, one per column.
+   * @param predictions Vector to store the predicted classes in.
+   */
+  void Predict(const arma::Mat<ElemType>& testData,
+               arma::Col<size_t>& predictions);
+
+  //! Get the parameters of the model.
+  const arma::Mat<ElemType>& Parameters() const { return parameters; }
+
+ private:
+  //! The number of points scored together by one thread.
+  static const size_t PointBlockSize = 256;
+
+  //! Check that the points have the dimensionality of the model.
+  void CheckDimensions(const arma::Mat<ElemType>& testData) const;
+
+  //! The parameters of the model.
+  arma::Mat<ElemType> parameters;
+  //! The class scores of a block of points, for each thread.
+  std::vector<arma::Mat<ElemType> > threadScores;
+};
+
+}; // namespace regression
+}; // namespace mlpack
+
+// Include implementation.
+#include "softmax_regression_scorer_impl.hpp"
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * @file softmax_regression_scorer_impl.hpp
+ *
+ * Implementation of the SoftmaxRegressionScorer class.
+ */
+#ifndef __MLPACK_METHODS_SOFTMAX_REGRESSION_SOFTMAX_REGRESSION_SCORER_IMPL_HPP
+#define __MLPACK_METHODS_SOFTMAX_REGRESSION_SOFTMAX_REGRESSION_SCORER_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "softmax_regression_scorer.hpp"
+
+namespace mlpack {
+namespace regression {
+
+template<typename ElemType>
+SoftmaxRegressionScorer<ElemType>::SoftmaxRegressionScorer(
+    const arma::mat& parameters) :
+    parameters(arma::conv_to<arma::Mat<ElemType> >::from(parameters))
+{
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  threadScores.resize(threads);
+  for (size_t t = 0; t < threads; ++t)
+    threadScores[t].set_size(parameters.n_rows, PointBlockSize);
+}
+
+template<typename ElemType>
+void SoftmaxRegressionScorer<ElemType>::Probabilities(
+    const arma::Mat<ElemType>& testData,
+    arma::Mat<ElemType>& probabilities) const
+{
+  CheckDimensions(testData);
+
+  // This does not reallocate if the caller's matrix already has the right
+  // size.
+  probabilities.set_size(parameters.n_rows, testData.n_cols);
+
+  const size_t numBlocks = (testData.n_cols + PointBlockSize - 1) /
+      PointBlockSize;
+
+  #pragma omp parallel for schedule(static)
+  for (size_t b = 0; b < numBlocks; ++b)
+  {
+    const size_t begin = b * PointBlockSize;
+    const size_t size = std::min(begin + PointBlockSize,
+        (size_t) testData.n_cols) - begin;
+
+    // Aliases of the block of points and of its probabilities, so the product
+    // is computed in place, without copies.
+    const arma::Mat<ElemType> block(const_cast<ElemType*>(
+        testData.colptr(begin)), testData.n_rows, size, false, true);
+    arma::Mat<ElemType> blockProbabilities(probabilities.colptr(begin),
+        parameters.n_rows, size, false, true);
+
+    blockProbabilities = parameters * block;
+
+    // Normalize each column; the largest score is subtracted first, which does
+    // not change the result but avoids overflow.
+    for (size_t i = 0; i < size; ++i)
+    {
+      ElemType* column = blockProbabilities.colptr(i);
+      const ElemType maxScore = blockProbabilities.col(i).max();
+
+      ElemType sum = 0;
+      for (size_t j = 0; j < parameters.n_rows; ++j)
+      {
+        column[j] = std::exp(column[j] - maxScore);
+        sum += column[j];
+      }
+      for (size_t j = 0; j < parameters.n_rows; ++j)
+        column[j] /= sum;
+    }
+  }
+}
+
+template<typename ElemType>
+void SoftmaxRegressionScorer<ElemType>::Predict(
+    const arma::Mat<ElemType>& testData,
+    arma::Col<size_t>& predictions)
+{
+  CheckDimensions(testData);
+
+  // This does not reallocate if the caller's vector already has the right
+  // size.
+  predictions.set_size(testData.n_cols);
+
+  const size_t numBlocks = (testData.n_cols + PointBlockSize - 1) /
+      PointBlockSize;
+
+  // The class with the highest probability is the class with the highest
+  // score, so the exponentials are not needed.
+  #pragma omp parallel num_threads(threadScores.size())
+  {
+#ifdef _OPENMP
+    const size_t thread = omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+
+    #pragma omp for schedule(static)
+    for (size_t b = 0; b < numBlocks; ++b)
+    {
+      const size_t begin = b * PointBlockSize;
+      const size_t size = std::min(begin + PointBlockSize,
+          (size_t) testData.n_cols) - begin;
+
+      const arma::Mat<ElemType> block(const_cast<ElemType*>(
+          testData.colptr(begin)), testData.n_rows, size, false, true);
+      arma::Mat<ElemType> scores(threadScores[thread].memptr(),
+          parameters.n_rows, size, false, true);
+
+      scores = parameters * block;
+
+      for (size_t i = 0; i < size; ++i)
+      {
+        const ElemType* column = scores.colptr(i);
+        size_t best = 0;
+        for (size_t j = 1; j < parameters.n_rows; ++j)
+          if (column[j] > column[best])
+            best = j;
+
+        predictions[begin + i] = best;
+      }
+    }
+  }
+}
+
+template<typename ElemType>
+void SoftmaxRegressionScorer<ElemType>::CheckDimensions(
+    const arma::Mat<ElemType>& testData) const
+{
+  if (testData.n_rows != parameters.n_cols)
+  {
+    Log::Fatal << "SoftmaxRegressionScorer: points have " << testData.n_rows
+        << " dimensions, but the model has " << parameters.n_cols << "!"
+        << std::endl;
+  }
+}
+
+}; // namespace regression
+}; // namespace mlpack
+
+#endif
@@ -11,6 +11,7 @@
 #include <mlpack/core/optimizers/lbfgs/lbfgs.hpp>
 
 #include "sparse_autoencoder_function.hpp"
+#include "sparse_autoencoder_sgd.hpp"
 
 namespace mlpack {
 namespace nn {
@@ -52,7 +53,9 @@ namespace nn {
  * @endcode
  *
  * This implementation allows the use of arbitrary mlpack optimizers via the
- * OptimizerType template parameter.
+ * OptimizerType template parameter.  For large datasets, SparseAutoencoderSGD
+ * (or SparseAutoencoderAdam) trains with mini-batches instead, on data held in
+ * memory or streamed from a file; see SparseAutoencoderSGDType.
  *
  * @tparam OptimizerType The optimizer to use; by default this is L-BFGS.  Any
  *     mlpack optimizer can be used here.
@@ -21,7 +21,9 @@ SparseAutoencoderFunction::SparseAutoencoderFunction(const arma::mat& data,
     hiddenSize(hiddenSize),
     lambda(lambda),
     beta(beta),
-    rho(rho)
+    rho(rho),
+    lastObjective(0),
+    cached(false)
 {
   // Initialize the parameters to suitable values.
   initialPoint = InitializeWeights();
@@ -78,44 +80,214 @@ double SparseAutoencoderFunction::Evaluate(const arma::mat& parameters) const
   // The cost also takes into account the regularization and KL divergence terms
   // to control the parameter weights and sparsity of the model respectively.
 
-  // Compute the limits for the parameters w1, w2, b1 and b2.
-  const size_t l1 = hiddenSize;
-  const size_t l2 = visibleSize;
-  const size_t l3 = 2 * hiddenSize;
+  // If the gradient was just computed at these parameters, the objective is
+  // already known.
+  if (IsCached(parameters))
+    return lastObjective;
 
-  // w1, w2, b1 and b2 are not extracted separately, 'parameters' is directly
-  // used in their place to avoid copying data. The following representations
-  // are used:
-  // w1 <- parameters.submat(0, 0, l1-1, l2-1)
-  // w2 <- parameters.submat(l1, 0, l3-1, l2-1).t()
-  // b1 <- parameters.submat(0, l2, l1-1, l2)
-  // b2 <- parameters.submat(l3, 0, l3, l2-1).t()
+  return Accumulate(parameters, NULL);
+}
 
-  arma::mat hiddenLayer, outputLayer;
+/** Calculates and stores the gradient values given a set of parameters.
+  */
+void SparseAutoencoderFunction::Gradient(const arma::mat& parameters,
+                                         arma::mat& gradient) const
+{
+  // Performs a feedforward pass of the neural network, and computes the
+  // activations of the output layer as in the Evaluate() method. It uses the
+  // Backpropagation algorithm to calculate the delta values at each layer,
+  // except for the input layer. The delta values are then used with input layer
+  // and hidden layer activations to get the parameter gradients.
+  if (!IsCached(parameters))
+    Accumulate(parameters, &lastGradient);
 
-  // Compute activations of the hidden and output layers.
-  Sigmoid(parameters.submat(0, 0, l1 - 1, l2 - 1) * data +
-      arma::repmat(parameters.submat(0, l2, l1 - 1, l2), 1, data.n_cols),
-      hiddenLayer);
+  gradient = lastGradient;
+}
 
-  Sigmoid(parameters.submat(l1, 0, l3 - 1, l2 - 1).t() * hiddenLayer +
-      arma::repmat(parameters.submat(l3, 0, l3, l2 - 1).t(), 1, data.n_cols),
-      outputLayer);
+/** Evaluates the objective function and stores the gradient values, sharing
+  * the feedforward pass between the two.
+  */
+double SparseAutoencoderFunction::EvaluateWithGradient(
+    const arma::mat& parameters,
+    arma::mat& gradient) const
+{
+  if (!IsCached(parameters))
+    Accumulate(parameters, &lastGradient);
 
-  arma::mat rhoCap, diff;
+  gradient = lastGradient;
+  return lastObjective;
+}
 
-  // Average activations of the hidden layer.
-  rhoCap = arma::sum(hiddenLayer, 1) / data.n_cols;
-  // Difference between the reconstructed data and the original data.
-  diff = outputLayer - data;
+/** Returns true if the objective and the gradient at the given parameters are
+  * stored in lastObjective and lastGradient.
+  */
+bool SparseAutoencoderFunction::IsCached(const arma::mat& parameters) const
+{
+  return cached && (parameters.n_rows == lastParameters.n_rows) &&
+      (parameters.n_cols == lastParameters.n_cols) &&
+      std::equal(parameters.memptr(), parameters.memptr() + parameters.n_elem,
+                 lastParameters.memptr());
+}
 
-  double wL2SquaredNorm;
+/** Computes the objective function, and the gradient too if the given pointer
+  * is not NULL, with a single pass over blocks of points, in parallel.
+  *
+  * The KL divergence term of the hidden layer deltas depends on the average
+  * activations of the whole dataset, which are only known at the end of the
+  * pass. Since that term is the same for every point, it is factored out: with
+  * g = f'(z) = h % (1 - h) for the hidden activations h, the hidden deltas are
+  *   delHid = (w2' * delOut) % g + klDivGrad % g,
+  * so each thread accumulates ((w2' * delOut) % g) * data' and g * data'
+  * separately, and the two are combined after the pass.
+  */
+double SparseAutoencoderFunction::Accumulate(const arma::mat& parameters,
+                                             arma::mat* gradient) const
+{
+  // Compute the limits for the parameters w1, w2, b1 and b2.
+  const size_t l1 = hiddenSize;
+  const size_t l2 = visibleSize;
+  const size_t l3 = 2 * hiddenSize;
 
-  // Calculate squared L2-norms of w1 and w2.
-  wL2SquaredNorm = arma::accu(parameters.submat(0, 0, l3 - 1, l2 - 1) %
-      parameters.submat(0, 0, l3 - 1, l2 - 1));
+  // Extract the weights and biases once, so the products of each block do not
+  // copy them.  The matrices are reused between calls.
+  w1 = parameters.submat(0, 0, l1 - 1, l2 - 1);
+  w2 = parameters.submat(l1, 0, l3 - 1, l2 - 1).t();
+  b1 = parameters.submat(0, l2, l1 - 1, l2);
+  b2 = parameters.submat(l3, 0, l3, l2 - 1).t();
+
+#ifdef _OPENMP
+  const size_t threads = util::NumThreads();
+#else
+  const size_t threads = 1;
+#endif
+
+  // Prepare the workspaces of each thread; after the first call, nothing is
+  // allocated here unless the sizes changed.
+  workspaces.resize(threads);
+  for (size_t t = 0; t < threads; ++t)
+  {
+    Workspace& w = workspaces[t];
+    w.hidden.set_size(l1, PointBlockSize);
+    w.output.set_size(l2, PointBlockSize);
+    w.hiddenSum.zeros(l1);
+    if (gradient)
+    {
+      w.backHidden.set_size(l1, PointBlockSize);
+      w.derivative.set_size(l1, PointBlockSize);
+      w.w1Gradient.zeros(l1, l2);
+      w.w1KLGradient.zeros(l1, l2);
+      w.w2Gradient.zeros(l2, l1);
+      w.b1Gradient.zeros(l1);
+      w.b1KLGradient.zeros(l1);
+      w.b2Gradient.zeros(l2);
+    }
+  }
+
+  const size_t numBlocks = (data.n_cols + PointBlockSize - 1) / PointBlockSize;
+
+  double sumOfSquares = 0;
+  #pragma omp parallel num_threads(threads) reduction(+:sumOfSquares)
+  {
+#ifdef _OPENMP
+    const size_t thread = omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+    Workspace& w = workspaces[thread];
+
+    #pragma omp for schedule(static)
+    for (size_t b = 0; b < numBlocks; ++b)
+    {
+      const size_t begin = b * PointBlockSize;
+      const size_t size = std::min(begin + PointBlockSize,
+          (size_t) data.n_cols) - begin;
+
+      // Aliases of the block of points and of the workspaces, so that nothing
+      // is copied or allocated.
+      const arma::mat block(const_cast<double*>(data.colptr(begin)), l2, size,
+          false, true);
+      arma::mat hidden(w.hidden.memptr(), l1, size, false, true);
+      arma::mat output(w.output.memptr(), l2, size, false, true);
+
+      // Compute activations of the hidden layer.
+      hidden = w1 * block;
+      for (size_t i = 0; i < size; ++i)
+      {
+        double* h = hidden.colptr(i);
+        for (size_t j = 0; j < l1; ++j)
+        {
+          h[j] = 1.0 / (1.0 + std::exp(-(h[j] + b1[j])));
+          w.hiddenSum[j] += h[j];
+        }
+      }
+
+      // Compute activations of the output layer, and the reconstruction
+      // error.  The activations are replaced by the delta values of the output
+      // layer, diff * f'(z), where f'(z) = f(z) * (1 - f(z)).
+      output = w2 * hidden;
+      for (size_t i = 0; i < size; ++i)
+      {
+        double* o = output.colptr(i);
+        const double* x = block.colptr(i);
+        for (size_t j = 0; j < l2; ++j)
+        {
+          const double activation = 1.0 / (1.0 + std::exp(-(o[j] + b2[j])));
+          const double diff = activation - x[j];
+          sumOfSquares += diff * diff;
+          o[j] = diff * activation * (1.0 - activation);
+        }
+      }
+
+      if (!gradient)
+        continue;
+
+      // Backpropagate to the hidden layer, without the KL divergence term.
+      arma::mat backHidden(w.backHidden.memptr(), l1, size, false, true);
+      arma::mat derivative(w.derivative.memptr(), l1, size, false, true);
+
+      backHidden = w2.t() * output;
+      for (size_t i = 0; i < size; ++i)
+      {
+        const double* h = hidden.colptr(i);
+        double* back = backHidden.colptr(i);
+        double* d = derivative.colptr(i);
+        for (size_t j = 0; j < l1; ++j)
+        {
+          d[j] = h[j] * (1.0 - h[j]);
+          back[j] *= d[j];
+          w.b1Gradient[j] += back[j];
+          w.b1KLGradient[j] += d[j];
+        }
+
+        const double* o = output.colptr(i);
+        for (size_t j = 0; j < l2; ++j)
+          w.b2Gradient[j] += o[j];
+      }
+
+      w.w1Gradient += backHidden * block.t();
+      w.w1KLGradient += derivative * block.t();
+      w.w2Gradient += output * hidden.t();
+    }
+  }
+
+  // Sum the accumulators of the threads.
+  for (size_t t = 1; t < threads; ++t)
+  {
+    workspaces[0].hiddenSum += workspaces[t].hiddenSum;
+    if (gradient)
+    {
+      workspaces[0].w1Gradient += workspaces[t].w1Gradient;
+      workspaces[0].w1KLGradient += workspaces[t].w1KLGradient;
+      workspaces[0].w2Gradient += workspaces[t].w2Gradient;
+      workspaces[0].b1Gradient += workspaces[t].b1Gradient;
+      workspaces[0].b1KLGradient += workspaces[t].b1KLGradient;
+      workspaces[0].b2Gradient += workspaces[t].b2Gradient;
+    }
+  }
+  const Workspace& total = workspaces[0];
 
-  double sumOfSquaresError, weightDecay, klDivergence, cost;
+  // Average activations of the hidden layer.
+  const arma::vec rhoCap = total.hiddenSum / data.n_cols;
 
   // Calculate the reconstruction error, the regularization cost and the KL
   // divergence cost terms. 'sumOfSquaresError' is the average squared l2-norm
@@ -123,83 +295,147 @@ double SparseAutoencoderFunction::Evaluate(const arma::mat& parameters) const
   // of the weights w1 and w2. 'klDivergence' is the cost of the hidden layer
   // activations not being low. It is given by the following formula:
   // KL = sum_over_hSize(rho*log(rho/rhoCaq) + (1-rho)*log((1-rho)/(1-rhoCap)))
-  sumOfSquaresError = 0.5 * arma::accu(diff % diff) / data.n_cols;
-  weightDecay = 0.5 * lambda * wL2SquaredNorm;
-  klDivergence = beta * arma::accu(rho * arma::log(rho / rhoCap) + (1 - rho) *
-      arma::log((1 - rho) / (1 - rhoCap)));
+  const double sumOfSquaresError = 0.5 * sumOfSquares / data.n_cols;
+  const double weightDecay = 0.5 * lambda * (arma::accu(w1 % w1) +
+      arma::accu(w2 % w2));
+  const double klDivergence = beta * arma::accu(rho * arma::log(rho / rhoCap) +
+      (1 - rho) * arma::log((1 - rho) / (1 - rhoCap)));
 
   // The cost is the sum of the terms calculated above.
-  cost = sumOfSquaresError + weightDecay + klDivergence;
+  const double cost = sumOfSquaresError + weightDecay + klDivergence;
+
+  if (gradient)
+  {
+    // Now that the average activations are known, add the KL divergence term
+    // to the hidden layer deltas.
+    const arma::vec klDivGrad = beta * (-(rho / rhoCap) + (1 - rho) /
+        (1 - rhoCap));
+
+    gradient->zeros(2 * hiddenSize + 1, visibleSize + 1);
+
+    // The formula also accounts for the regularization terms in the objective
+    // function.
+    gradient->submat(0, 0, l1 - 1, l2 - 1) = (total.w1Gradient +
+        arma::diagmat(klDivGrad) * total.w1KLGradient) / data.n_cols +
+        lambda * w1;
+    gradient->submat(l1, 0, l3 - 1, l2 - 1) = (total.w2Gradient / data.n_cols +
+        lambda * w2).t();
+    gradient->submat(0, l2, l1 - 1, l2) = (total.b1Gradient + klDivGrad %
+        total.b1KLGradient) / data.n_cols;
+    gradient->submat(l3, 0, l3, l2 - 1) = (total.b2Gradient /
+        data.n_cols).t();
+
+    // Remember the result, for calls to Evaluate() or Gradient() at the same
+    // point.
+    lastParameters = parameters;
+    lastObjective = cost;
+    cached = (gradient == &lastGradient);
+  }
 
   return cost;
 }
 
-/** Calculates and stores the gradient values given a set of parameters.
+/** Evaluates the objective function and the gradient on a batch of points, in
+  * single precision, with a running average of the hidden activations.
+  *
+  * The running average is used like the averages over the whole dataset in
+  * Accumulate(): its dependence on the parameters through this batch is
+  * handled as there, by adding klDivGrad to the hidden deltas of each point.
   */
-void SparseAutoencoderFunction::Gradient(const arma::mat& parameters,
-                                         arma::mat& gradient) const
+double SparseAutoencoderFunction::BatchEvaluateWithGradient(
+    const arma::mat& parameters,
+    const arma::mat& batch,
+    arma::mat& gradient,
+    const double decay)
 {
-  // Performs a feedforward pass of the neural network, and computes the
-  // activations of the output layer as in the Evaluate() method. It uses the
-  // Backpropagation algorithm to calculate the delta values at each layer,
-  // except for the input layer. The delta values are then used with input layer
-  // and hidden layer activations to get the parameter gradients.
-
-  // Compute the limits for the parameters w1, w2, b1 and b2.
   const size_t l1 = hiddenSize;
   const size_t l2 = visibleSize;
   const size_t l3 = 2 * hiddenSize;
-
-  // w1, w2, b1 and b2 are not extracted separately, 'parameters' is directly
-  // used in their place to avoid copying data. The following representations
-  // are used:
-  // w1 <- parameters.submat(0, 0, l1-1, l2-1)
-  // w2 <- parameters.submat(l1, 0, l3-1, l2-1).t()
-  // b1 <- parameters.submat(0, l2, l1-1, l2)
-  // b2 <- parameters.submat(l3, 0, l3, l2-1).t()
-
-  arma::mat hiddenLayer, outputLayer;
-
-  // Compute activations of the hidden and output layers.
-  Sigmoid(parameters.submat(0, 0, l1 - 1, l2 - 1) * data +
-      arma::repmat(parameters.submat(0, l2, l1 - 1, l2), 1, data.n_cols),
-      hiddenLayer);
-
-  Sigmoid(parameters.submat(l1, 0, l3 - 1, l2 - 1).t() * hiddenLayer +
-      arma::repmat(parameters.submat(l3, 0, l3, l2 - 1).t(), 1, data.n_cols),
-      outputLayer);
-
-  arma::mat rhoCap, diff;
-
-  // Average activations of the hidden layer.
-  rhoCap = arma::sum(hiddenLayer, 1) / data.n_cols;
-  // Difference between the reconstructed data and the original data.
-  diff = outputLayer - data;
-
-  arma::mat klDivGrad, delOut, delHid;
-
-  // The delta vector for the output layer is given by diff * f'(z), where z is
-  // the preactivation and f is the activation function. The derivative of the
-  // sigmoid function turns out to be f(z) * (1 - f(z)). For every other layer
-  // in the neural network which comes before the output layer, the delta values
-  // are given del_n = w_n' * del_(n+1) * f'(z_n). Since our cost function also
-  // includes the KL divergence term, we adjust for that in the formula below.
-  klDivGrad = beta * (-(rho / rhoCap) + (1 - rho) / (1 - rhoCap));
-  delOut = diff % outputLayer % (1 - outputLayer);
-  delHid = (parameters.submat(l1, 0, l3 - 1, l2 - 1) * delOut +
-      arma::repmat(klDivGrad, 1, data.n_cols)) % hiddenLayer %
-      (1 - hiddenLayer);
+  const size_t points = batch.n_cols;
+
+  // The conversions are linear in the sizes of the parameters and of the
+  // batch; the products below are not.  floatW2 keeps the layout of the
+  // parameters, so it is w2'.
+  floatW1 = arma::conv_to<arma::fmat>::from(
+      parameters.submat(0, 0, l1 - 1, l2 - 1));
+  floatW2 = arma::conv_to<arma::fmat>::from(
+      parameters.submat(l1, 0, l3 - 1, l2 - 1));
+  floatB1 = arma::conv_to<arma::fvec>::from(
+      parameters.submat(0, l2, l1 - 1, l2));
+  floatB2 = arma::conv_to<arma::fvec>::from(
+      parameters.submat(l3, 0, l3, l2 - 1));
+  floatBatch = arma::conv_to<arma::fmat>::from(batch);
+
+  // Compute activations of the hidden layer, and their averages.
+  arma::vec batchActivations(l1);
+  batchActivations.zeros();
+  floatHidden = floatW1 * floatBatch;
+  for (size_t i = 0; i < points; ++i)
+  {
+    float* h = floatHidden.colptr(i);
+    for (size_t j = 0; j < l1; ++j)
+    {
+      h[j] = 1.0f / (1.0f + std::exp(-(h[j] + floatB1[j])));
+      batchActivations[j] += h[j];
+    }
+  }
+  batchActivations /= points;
+
+  if (averageActivations.n_elem != l1)
+    averageActivations = batchActivations;
+  else
+    averageActivations = decay * averageActivations + (1 - decay) *
+        batchActivations;
+  const arma::vec& rhoCap = averageActivations;
+
+  // Compute activations of the output layer and the reconstruction error, and
+  // replace the activations by the delta values of the output layer.
+  double sumOfSquares = 0;
+  floatOutput = floatW2.t() * floatHidden;
+  for (size_t i = 0; i < points; ++i)
+  {
+    float* o = floatOutput.colptr(i);
+    const float* x = floatBatch.colptr(i);
+    for (size_t j = 0; j < l2; ++j)
+    {
+      const float activation = 1.0f / (1.0f + std::exp(-(o[j] +
+          floatB2[j])));
+      const float diff = activation - x[j];
+      sumOfSquares += diff * diff;
+      o[j] = diff * activation * (1.0f - activation);
+    }
+  }
+
+  // Backpropagate to the hidden layer, with the KL divergence term.
+  const arma::fvec klDivGrad = arma::conv_to<arma::fvec>::from(beta *
+      (-(rho / rhoCap) + (1 - rho) / (1 - rhoCap)));
+  floatBackHidden = floatW2 * floatOutput;
+  for (size_t i = 0; i < points; ++i)
+  {
+    const float* h = floatHidden.colptr(i);
+    float* back = floatBackHidden.colptr(i);
+    for (size_t j = 0; j < l1; ++j)
+      back[j] = (back[j] + klDivGrad[j]) * h[j] * (1.0f - h[j]);
+  }
+
+  // w1 and w2' are the first l3 rows of the parameters.
+  const double weightDecay = 0.5 * lambda * arma::accu(arma::square(
+      parameters.submat(0, 0, l3 - 1, l2 - 1)));
+  const double klDivergence = beta * arma::accu(rho * arma::log(rho / rhoCap) +
+      (1 - rho) * arma::log((1 - rho) / (1 - rhoCap)));
+  const double cost = 0.5 * sumOfSquares / points + weightDecay + klDivergence;
 
   gradient.zeros(2 * hiddenSize + 1, visibleSize + 1);
-
-  // Compute the gradient values using the activations and the delta values. The
-  // formula also accounts for the regularization terms in the objective.
-  // function.
-  gradient.submat(0, 0, l1 - 1, l2 - 1) = delHid * data.t() / data.n_cols +
+  gradient.submat(0, 0, l1 - 1, l2 - 1) = arma::conv_to<arma::mat>::from(
+      floatBackHidden * floatBatch.t()) / points +
       lambda * parameters.submat(0, 0, l1 - 1, l2 - 1);
-  gradient.submat(l1, 0, l3 - 1, l2 - 1) =
-      (delOut * hiddenLayer.t() / data.n_cols +
-      lambda * parameters.submat(l1, 0, l3 - 1, l2 - 1).t()).t();
-  gradient.submat(0, l2, l1 - 1, l2) = arma::sum(delHid, 1) / data.n_cols;
-  gradient.submat(l3, 0, l3, l2 - 1) = (arma::sum(delOut, 1) / data.n_cols).t();
+  gradient.submat(l1, 0, l3 - 1, l2 - 1) = arma::conv_to<arma::mat>::from(
+      floatHidden * floatOutput.t()) / points +
+      lambda * parameters.submat(l1, 0, l3 - 1, l2 - 1);
+  gradient.submat(0, l2, l1 - 1, l2) = arma::conv_to<arma::mat>::from(
+      arma::sum(floatBackHidden, 1)) / points;
+  gradient.submat(l3, 0, l3, l2 - 1) = arma::conv_to<arma::mat>::from(
+      arma::sum(floatOutput, 1)).t() / points;
+
+  return cost;
 }
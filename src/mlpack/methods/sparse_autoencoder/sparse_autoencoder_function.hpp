@@ -65,6 +65,56 @@ class SparseAutoencoderFunction
    */
   void Gradient(const arma::mat& parameters, arma::mat& gradient) const;
 
+  /**
+   * Evaluates the objective function and its gradient given the current set of
+   * parameters, with a single feedforward pass.  This is faster than calling
+   * Evaluate() and Gradient(); L_BFGS uses it when it is available.
+   *
+   * The result is cached, so that a following call to Evaluate() or Gradient()
+   * with the same parameters does not compute anything (Gradient() caches its
+   * result too).  The data is processed in blocks of points, in parallel, and
+   * the work buffers are reused between calls.
+   *
+   * @param parameters Current values of the model parameters.
+   * @param gradient Matrix where gradient values will be stored.
+   */
+  double EvaluateWithGradient(const arma::mat& parameters,
+                              arma::mat& gradient) const;
+
+  /**
+   * Evaluates the objective function and its gradient on the given batch of
+   * points, instead of the whole dataset, for mini-batch training (see
+   * SparseAutoencoderSGDType).  The average activations of the hidden layer
+   * used by the sparsity term are not computed over the whole dataset, but kept
+   * as a running average over the batches: after each batch,
+   *   rhoCap = decay * rhoCap + (1 - decay) * (average activations of batch),
+   * and the KL divergence terms of the objective and of the gradient use the
+   * updated rhoCap.  The first batch after ResetActivations() (or after the
+   * size of the hidden layer changed) sets rhoCap to its own averages.
+   *
+   * The weights and the points are converted to single precision, so the
+   * products and the activations of the batch are all computed in float32; the
+   * objective and the gradient are returned in double precision.
+   *
+   * @param parameters Current values of the model parameters.
+   * @param batch Points of the batch, one per column.
+   * @param gradient Matrix where the gradient on the batch will be stored.
+   * @param decay Weight of the previous running average activations.
+   */
+  double BatchEvaluateWithGradient(const arma::mat& parameters,
+                                   const arma::mat& batch,
+                                   arma::mat& gradient,
+                                   const double decay = 0.99);
+
+  //! Forget the running average activations of the hidden layer.
+  void ResetActivations() { averageActivations.reset(); }
+
+  //! Get the running average activations of the hidden layer.
+  const arma::vec& AverageActivations() const { return averageActivations; }
+
+  //! Get the data matrix.
+  const arma::mat& Data() const { return data; }
+
   /**
    * Returns the elementwise sigmoid of the passed matrix, where the sigmoid
    * function of a real number 'x' is [1 / (1 + exp(-x))].
@@ -140,6 +190,49 @@ class SparseAutoencoderFunction
   }
 
  private:
+  //! The number of points processed together by one thread.
+  static const size_t PointBlockSize = 256;
+
+  //! The buffers and the accumulators of one thread, reused between calls.
+  struct Workspace
+  {
+    //! Activations of the hidden layer, for a block.
+    arma::mat hidden;
+    //! Activations (then delta values) of the output layer, for a block.
+    arma::mat output;
+    //! Delta values of the hidden layer without the KL divergence term.
+    arma::mat backHidden;
+    //! Derivatives of the hidden activations, for a block.
+    arma::mat derivative;
+    //! Sum of the hidden activations.
+    arma::vec hiddenSum;
+    //! Gradient of w1, without the KL divergence term.
+    arma::mat w1Gradient;
+    //! Sum of derivative * data', for the KL divergence term of w1.
+    arma::mat w1KLGradient;
+    //! Gradient of w2 (not transposed).
+    arma::mat w2Gradient;
+    //! Gradient of b1, without the KL divergence term.
+    arma::vec b1Gradient;
+    //! Sum of the derivatives, for the KL divergence term of b1.
+    arma::vec b1KLGradient;
+    //! Gradient of b2.
+    arma::vec b2Gradient;
+  };
+
+  /**
+   * Computes the objective function, and the gradient too if the given pointer
+   * is not NULL, with a single pass over blocks of points, in parallel (with
+   * OpenMP).  If the gradient is stored in lastGradient, the result is cached.
+   *
+   * @param parameters Current values of the model parameters.
+   * @param gradient Matrix where gradient values will be stored, or NULL.
+   */
+  double Accumulate(const arma::mat& parameters, arma::mat* gradient) const;
+
+  //! Returns true if the results for these parameters are cached.
+  bool IsCached(const arma::mat& parameters) const;
+
   //! The matrix of data points.
   const arma::mat& data;
   //! Intial parameter vector.
@@ -154,6 +247,31 @@ class SparseAutoencoderFunction
   double beta;
   //! Sparsity parameter.
   double rho;
+
+  //! The weights and biases, extracted from the parameters for a pass.
+  mutable arma::mat w1, w2;
+  //! The biases, extracted from the parameters for a pass.
+  mutable arma::vec b1, b2;
+  //! The workspaces of each thread.
+  mutable std::vector<Workspace> workspaces;
+
+  //! Parameters of the last computation of the gradient.
+  mutable arma::mat lastParameters;
+  //! Objective at lastParameters.
+  mutable double lastObjective;
+  //! Gradient at lastParameters.
+  mutable arma::mat lastGradient;
+  //! Whether lastObjective and lastGradient are valid.
+  mutable bool cached;
+
+  //! Running average activations of the hidden layer, for mini-batches.
+  arma::vec averageActivations;
+  //! The weights, in single precision, for mini-batches.
+  arma::fmat floatW1, floatW2;
+  //! The biases, in single precision, for mini-batches.
+  arma::fvec floatB1, floatB2;
+  //! The points, activations and deltas of a mini-batch.
+  arma::fmat floatBatch, floatHidden, floatOutput, floatBackHidden;
 };
 
 }; // namespace nn
@@ -0,0 +1,201 @@
+/**
+ * @file sparse_autoencoder_sgd.hpp
+ *
+ * Mini-batch stochastic gradient descent for sparse autoencoders, on data held
+ * in memory or streamed from disk.
+ */
+#ifndef __MLPACK_METHODS_SPARSE_AUTOENCODER_SPARSE_AUTOENCODER_SGD_HPP
+#define __MLPACK_METHODS_SPARSE_AUTOENCODER_SPARSE_AUTOENCODER_SGD_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/optimizers/sgd/sgd.hpp>
+
+#include "sparse_autoencoder_function.hpp"
+
+namespace mlpack {
+namespace nn {
+
+/**
+ * An optimizer which trains a sparse autoencoder with mini-batch stochastic
+ * gradient descent, so that datasets much larger than what L-BFGS can handle
+ * (which evaluates the objective on the whole dataset at each step) can be
+ * used.  Each step uses the gradient on one batch of points, computed by
+ * SparseAutoencoderFunction::BatchEvaluateWithGradient(): the products are done
+ * in single precision, and the average activations of the hidden layer in the
+ * sparsity term are a running average over the batches.  The step itself is
+ * taken by the update policy, as for SGDType (see VanillaUpdate, AdamUpdate,
+ * and the others).
+ *
+ * The points are either the dataset of the function, or are read from a file
+ * with a data::StreamingReader, a block at a time, so that the dataset never
+ * has to fit in memory.  Each pass over the points visits the batches of the
+ * dataset (or of each block read from the file) in a random order, or in order
+ * if shuffling is disabled.  The optimization stops after the given number of
+ * passes; the objective returned by Optimize() is the average of the
+ * objectives of the batches of the last pass.
+ *
+ * This can be used as the optimizer of SparseAutoencoder:
+ *
+ * @code
+ * // Train on the data held in memory.
+ * SparseAutoencoder<SparseAutoencoderSGD> encoder1(data, vSize, hSize);
+ *
+ * // Train on the data in a file, with Adam steps.
+ * SparseAutoencoderFunction saf(sample, vSize, hSize);
+ * data::StreamingReader reader("patches.bin", 100000);
+ * SparseAutoencoderAdam<SparseAutoencoderFunction> optimizer(saf, reader,
+ *     0.001, 256, 5);
+ * SparseAutoencoder<SparseAutoencoderAdam> encoder2(optimizer);
+ * @endcode
+ *
+ * @tparam FunctionType Objective function to be minimized; it must implement
+ *     BatchEvaluateWithGradient() and ResetActivations() like
+ *     SparseAutoencoderFunction.
+ * @tparam UpdatePolicyType Step rule (see VanillaUpdate).
+ */
+template<typename FunctionType,
+         typename UpdatePolicyType = optimization::VanillaUpdate>
+class SparseAutoencoderSGDType
+{
+ public:
+  /**
+   * Construct the optimizer, to train on the dataset of the given function.
+   *
+   * @param function Function to be optimized (minimized).
+   * @param stepSize Step size for each batch.
+   * @param batchSize Number of points in each batch.
+   * @param passes Number of passes over the dataset.
+   * @param decay Weight of the previous running average activations, when
+   *     the activations of a batch are added to it.
+   * @param shuffle If true, the batches are visited in a random order.
+   * @param updatePolicy Instantiated step rule.
+   */
+  SparseAutoencoderSGDType(FunctionType& function,
+                           const double stepSize = 0.01,
+                           const size_t batchSize = 256,
+                           const size_t passes = 10,
+                           const double decay = 0.99,
+                           const bool shuffle = true,
+                           const UpdatePolicyType& updatePolicy =
+                               UpdatePolicyType());
+
+  /**
+   * Construct the optimizer, to train on the points read from the given
+   * reader, instead of the dataset of the function (which is then only used
+   * for the initial point).  The reader is rewound before each pass.
+   *
+   * @param function Function to be optimized (minimized).
+   * @param reader Reader of the points to train on.
+   * @param stepSize Step size for each batch.
+   * @param batchSize Number of points in each batch.
+   * @param passes Number of passes over the points.
+   * @param decay Weight of the previous running average activations, when
+   *     the activations of a batch are added to it.
+   * @param shuffle If true, the batches of each block are visited in a random
+   *     order.
+   * @param updatePolicy Instantiated step rule.
+   */
+  SparseAutoencoderSGDType(FunctionType& function,
+                           data::StreamingReader& reader,
+                           const double stepSize = 0.01,
+                           const size_t batchSize = 256,
+                           const size_t passes = 10,
+                           const double decay = 0.99,
+                           const bool shuffle = true,
+                           const UpdatePolicyType& updatePolicy =
+                               UpdatePolicyType());
+
+  /**
+   * Optimize the function.  The given starting point will be modified to store
+   * the finishing point of the algorithm, and the average objective of the
+   * batches of the last pass is returned.
+   *
+   * @param iterate Starting point (will be modified).
+   * @return Average objective of the batches of the last pass.
+   */
+  double Optimize(arma::mat& iterate);
+
+  //! Get the instantiated function to be optimized.
+  const FunctionType& Function() const { return function; }
+  //! Modify the instantiated function.
+  FunctionType& Function() { return function; }
+
+  //! Get the step size.
+  double StepSize() const { return stepSize; }
+  //! Modify the step size.
+  double& StepSize() { return stepSize; }
+
+  //! Get the batch size.
+  size_t BatchSize() const { return batchSize; }
+  //! Modify the batch size.
+  size_t& BatchSize() { return batchSize; }
+
+  //! Get the number of passes over the points.
+  size_t Passes() const { return passes; }
+  //! Modify the number of passes over the points.
+  size_t& Passes() { return passes; }
+
+  //! Get the weight of the previous running average activations.
+  double Decay() const { return decay; }
+  //! Modify the weight of the previous running average activations.
+  double& Decay() { return decay; }
+
+  //! Get whether or not the batches are shuffled.
+  bool Shuffle() const { return shuffle; }
+  //! Modify whether or not the batches are shuffled.
+  bool& Shuffle() { return shuffle; }
+
+  //! Get the step rule.
+  const UpdatePolicyType& UpdatePolicy() const { return updatePolicy; }
+  //! Modify the step rule.
+  UpdatePolicyType& UpdatePolicy() { return updatePolicy; }
+
+ private:
+  /**
+   * Take a step for each batch of the given points.  The objectives of the
+   * batches, weighted by their numbers of points, are added to objective.
+   *
+   * @param points Points to train on.
+   * @param iterate Current point (will be modified).
+   * @param objective Sum of the objectives (will be modified).
+   */
+  void Steps(const arma::mat& points, arma::mat& iterate, double& objective);
+
+  //! The instantiated function.
+  FunctionType& function;
+  //! The reader of the points, or NULL to train on the dataset of the
+  //! function.
+  data::StreamingReader* reader;
+  //! The step size for each batch.
+  double stepSize;
+  //! The number of points in each batch.
+  size_t batchSize;
+  //! The number of passes over the points.
+  size_t passes;
+  //! The weight of the previous running average activations.
+  double decay;
+  //! Controls whether or not the batches are shuffled.
+  bool shuffle;
+  //! The step rule.
+  UpdatePolicyType updatePolicy;
+  //! The gradient on the current batch.
+  arma::mat gradient;
+};
+
+//! Mini-batch training of sparse autoencoders with the plain update.
+template<typename FunctionType>
+using SparseAutoencoderSGD = SparseAutoencoderSGDType<FunctionType,
+    optimization::VanillaUpdate>;
+
+//! Mini-batch training of sparse autoencoders with Adam steps.
+template<typename FunctionType>
+using SparseAutoencoderAdam = SparseAutoencoderSGDType<FunctionType,
+    optimization::AdamUpdate>;
+
+}; // namespace nn
+}; // namespace mlpack
+
+// Include implementation.
+#include "sparse_autoencoder_sgd_impl.hpp"
+
+#endif
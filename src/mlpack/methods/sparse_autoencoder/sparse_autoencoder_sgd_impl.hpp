@@ -0,0 +1,142 @@
+/**
+ * @file sparse_autoencoder_sgd_impl.hpp
+ *
+ * Implementation of mini-batch stochastic gradient descent for sparse
+ * autoencoders.
+ */
+#ifndef __MLPACK_METHODS_SPARSE_AUTOENCODER_SPARSE_AUTOENCODER_SGD_IMPL_HPP
+#define __MLPACK_METHODS_SPARSE_AUTOENCODER_SPARSE_AUTOENCODER_SGD_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "sparse_autoencoder_sgd.hpp"
+
+namespace mlpack {
+namespace nn {
+
+template<typename FunctionType, typename UpdatePolicyType>
+SparseAutoencoderSGDType<FunctionType, UpdatePolicyType>::
+SparseAutoencoderSGDType(FunctionType& function,
+                         const double stepSize,
+                         const size_t batchSize,
+                         const size_t passes,
+                         const double decay,
+                         const bool shuffle,
+                         const UpdatePolicyType& updatePolicy) :
+    function(function),
+    reader(NULL),
+    stepSize(stepSize),
+    batchSize(batchSize),
+    passes(passes),
+    decay(decay),
+    shuffle(shuffle),
+    updatePolicy(updatePolicy)
+{ /* Nothing to do. */ }
+
+template<typename FunctionType, typename UpdatePolicyType>
+SparseAutoencoderSGDType<FunctionType, UpdatePolicyType>::
+SparseAutoencoderSGDType(FunctionType& function,
+                         data::StreamingReader& reader,
+                         const double stepSize,
+                         const size_t batchSize,
+                         const size_t passes,
+                         const double decay,
+                         const bool shuffle,
+                         const UpdatePolicyType& updatePolicy) :
+    function(function),
+    reader(&reader),
+    stepSize(stepSize),
+    batchSize(batchSize),
+    passes(passes),
+    decay(decay),
+    shuffle(shuffle),
+    updatePolicy(updatePolicy)
+{ /* Nothing to do. */ }
+
+template<typename FunctionType, typename UpdatePolicyType>
+double SparseAutoencoderSGDType<FunctionType, UpdatePolicyType>::Optimize(
+    arma::mat& iterate)
+{
+  if (batchSize == 0)
+  {
+    Log::Fatal << "SparseAutoencoderSGD: the batch size must be positive!"
+        << std::endl;
+  }
+
+  if (reader && reader->Dimensionality() != function.VisibleSize())
+  {
+    Log::Fatal << "SparseAutoencoderSGD: the points in '" << reader->Filename()
+        << "' have " << reader->Dimensionality() << " dimensions, but the "
+        << "visible layer has size " << function.VisibleSize() << "!"
+        << std::endl;
+  }
+
+  updatePolicy.Initialize(iterate.n_rows, iterate.n_cols);
+  function.ResetActivations();
+
+  double objective = 0;
+  size_t points = 0;
+  arma::mat block;
+  for (size_t pass = 0; pass < passes; ++pass)
+  {
+    objective = 0;
+    points = 0;
+    if (reader)
+    {
+      reader->Reset();
+      while (reader->NextBlock(block))
+      {
+        Steps(block, iterate, objective);
+        points += block.n_cols;
+      }
+    }
+    else
+    {
+      Steps(function.Data(), iterate, objective);
+      points = function.Data().n_cols;
+    }
+
+    if (points > 0)
+      objective /= points;
+
+    Log::Info << "SparseAutoencoderSGD: pass " << pass + 1 << ", average "
+        << "objective " << objective << "." << std::endl;
+  }
+
+  return objective;
+}
+
+template<typename FunctionType, typename UpdatePolicyType>
+void SparseAutoencoderSGDType<FunctionType, UpdatePolicyType>::Steps(
+    const arma::mat& points,
+    arma::mat& iterate,
+    double& objective)
+{
+  const size_t numBatches = (points.n_cols + batchSize - 1) / batchSize;
+  if (numBatches == 0)
+    return;
+
+  arma::Col<size_t> order = arma::linspace<arma::Col<size_t> >(0,
+      numBatches - 1, numBatches);
+  if (shuffle)
+    order = arma::shuffle(order);
+
+  for (size_t b = 0; b < numBatches; ++b)
+  {
+    const size_t begin = order[b] * batchSize;
+    const size_t size = std::min(begin + batchSize, (size_t) points.n_cols) -
+        begin;
+
+    // An alias of the batch, so that nothing is copied.
+    const arma::mat batch(const_cast<double*>(points.colptr(begin)),
+        points.n_rows, size, false, true);
+
+    objective += size * function.BatchEvaluateWithGradient(iterate, batch,
+        gradient, decay);
+    updatePolicy.Update(iterate, stepSize, gradient);
+  }
+}
+
+}; // namespace nn
+}; // namespace mlpack
+
+#endif
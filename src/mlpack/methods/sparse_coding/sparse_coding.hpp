@@ -133,16 +133,20 @@ class SparseCoding
               const double newtonTolerance = 1e-6);
 
   /**
-   * Sparse code each point via LARS.
+   * Sparse code each point via LARS.  The points are coded in parallel (with
+   * OpenMP).
    */
   void OptimizeCode();
 
   /**
-   * Learn dictionary via Newton method based on Lagrange dual.
+   * Learn dictionary via Newton method based on Lagrange dual.  The statistics
+   * of the codes are accumulated from the nonzero codes only, in parallel over
+   * the atoms.
    *
    * @param adjacencies Indices of entries (unrolled column by column) of
    *    the coding matrix Z that are non-zero (the adjacency matrix for the
-   *    bipartite graph of points and atoms).
+   *    bipartite graph of points and atoms), in increasing order, as given by
+   *    find(Codes()).
    * @param newtonTolerance Tolerance of the Newton's method optimizer.
    * @param maxIterations Maximum number of iterations to run the Newton's method.
    *     If 0, the method will run until convergence (or forever).
@@ -13,6 +13,112 @@
 
 namespace mlpack {
 namespace sparse_coding {
+namespace aux {
+
+/**
+ * Accumulate the statistics of the dictionary step, Z Z^T and X Z^T, for each
+ * active atom.  Only the nonzero codes are visited: for active atom a, column a
+ * of Z Z^T is the sum of z_a(p) z(p) and column a of X Z^T is the sum of
+ * z_a(p) x(p), over the points p which use the atom.  Each call fills the
+ * columns of one atom, so the atoms can be handled by different threads.
+ */
+class DictionaryStatistics
+{
+ public:
+  DictionaryStatistics(const arma::mat& data,
+                       const arma::mat& codes,
+                       const arma::uvec& adjacencies,
+                       const std::vector<size_t>& pointStart,
+                       const std::vector<size_t>& atomStart,
+                       const std::vector<size_t>& atomPoints,
+                       const std::vector<size_t>& activeAtoms,
+                       const std::vector<size_t>& activeIndex,
+                       arma::mat& codesZT,
+                       arma::mat& dataZT) :
+      data(data),
+      codes(codes),
+      adjacencies(adjacencies),
+      pointStart(pointStart),
+      atomStart(atomStart),
+      atomPoints(atomPoints),
+      activeAtoms(activeAtoms),
+      activeIndex(activeIndex),
+      codesZT(codesZT),
+      dataZT(dataZT) { }
+
+  void operator()(const size_t a)
+  {
+    const size_t atom = activeAtoms[a];
+    const size_t atoms = codes.n_rows;
+    arma::vec zzt = codesZT.unsafe_col(a);
+    arma::vec xzt = dataZT.unsafe_col(a);
+
+    for (size_t l = atomStart[atom]; l < atomStart[atom + 1]; ++l)
+    {
+      const size_t point = atomPoints[l];
+      const double z = codes(atom, point);
+
+      xzt += z * data.unsafe_col(point);
+      for (size_t m = pointStart[point]; m < pointStart[point + 1]; ++m)
+        zzt[activeIndex[adjacencies[m] % atoms]] += z * codes[adjacencies[m]];
+    }
+  }
+
+ private:
+  const arma::mat& data;
+  const arma::mat& codes;
+  const arma::uvec& adjacencies;
+  const std::vector<size_t>& pointStart;
+  const std::vector<size_t>& atomStart;
+  const std::vector<size_t>& atomPoints;
+  const std::vector<size_t>& activeAtoms;
+  const std::vector<size_t>& activeIndex;
+  arma::mat& codesZT;
+  arma::mat& dataZT;
+};
+
+/**
+ * Solve A X = B for a symmetric matrix A through its Cholesky factorization
+ * A = R^T R, which is stored in factor.  If A is not positive definite, a
+ * general solver is used instead, and factor is left empty.
+ */
+inline void SolveSymmetric(const arma::mat& a,
+                           const arma::mat& b,
+                           arma::mat& x,
+                           arma::mat& factor)
+{
+  if (arma::chol(factor, a))
+  {
+    x = arma::solve(arma::trimatu(factor),
+        arma::solve(arma::trimatl(arma::trans(factor)), b));
+  }
+  else
+  {
+    factor.reset();
+    x = arma::solve(a, b);
+  }
+}
+
+/**
+ * Invert a symmetric matrix, given the Cholesky factor found by
+ * SolveSymmetric() (or an empty factor, if it was not positive definite).
+ */
+inline void InvertSymmetric(const arma::mat& a,
+                            const arma::mat& factor,
+                            arma::mat& inverse)
+{
+  if (factor.n_elem == 0)
+  {
+    inverse = arma::inv(a);
+  }
+  else
+  {
+    const arma::mat factorInverse = arma::inv(arma::trimatu(factor));
+    inverse = factorInverse * arma::trans(factorInverse);
+  }
+}
+
+}; // namespace aux
 
 template<typename DictionaryInitializer>
 SparseCoding<DictionaryInitializer>::SparseCoding(const arma::mat& data,
@@ -98,20 +204,27 @@ void SparseCoding<DictionaryInitializer>::OptimizeCode()
   // lambda2 > 0.
   arma::mat matGram = trans(dictionary) * dictionary;
 
-  for (size_t i = 0; i < data.n_cols; ++i)
-  {
-    // Report progress.
-    if ((i % 100) == 0)
-      Log::Debug << "Optimization at point " << i << "." << std::endl;
+  Log::Debug << "Optimizing the codes of " << data.n_cols << " points."
+      << std::endl;
 
+  // The points are coded independently, so they are split between the threads.
+  // Each thread reuses one LARS object (and its buffers) for all its points,
+  // and they all share the Gram matrix.  The number of LARS iterations varies
+  // between points, hence the dynamic schedule.
+  #pragma omp parallel
+  {
     bool useCholesky = true;
     regression::LARS lars(useCholesky, matGram, lambda1, lambda2);
 
-    // Create an alias of the code (using the same memory), and then LARS will
-    // place the result directly into that; then we will not need to have an
-    // extra copy.
-    arma::vec code = codes.unsafe_col(i);
-    lars.Regress(dictionary, data.unsafe_col(i), code, false);
+    #pragma omp for schedule(dynamic, 16)
+    for (size_t i = 0; i < data.n_cols; ++i)
+    {
+      // Create an alias of the code (using the same memory), and then LARS will
+      // place the result directly into that; then we will not need to have an
+      // extra copy.
+      arma::vec code = codes.unsafe_col(i);
+      lars.Regress(dictionary, data.unsafe_col(i), code, false);
+    }
   }
 }
 
@@ -122,60 +235,70 @@ double SparseCoding<DictionaryInitializer>::OptimizeDictionary(
     const double newtonTolerance,
     const size_t maxIterations)
 {
-  // Count the number of atomic neighbors for each point x^i.
-  arma::uvec neighborCounts = arma::zeros<arma::uvec>(data.n_cols, 1);
-
-  if (adjacencies.n_elem > 0)
+  // Group the nonzero codes by point and by atom.  The adjacencies are sorted
+  // (column by column), so the codes of each point are contiguous; pointStart
+  // holds where each point starts.  Then atomStart and atomPoints hold the
+  // points which use each atom, in the same way.
+  std::vector<size_t> pointStart(data.n_cols + 1, 0);
+  std::vector<size_t> atomStart(atoms + 1, 0);
+  for (size_t l = 0; l < adjacencies.n_elem; ++l)
   {
-    // This gets the column index.  Intentional integer division.
-    size_t curPointInd = (size_t) (adjacencies(0) / atoms);
-
-    size_t nextColIndex = (curPointInd + 1) * atoms;
-    for (size_t l = 1; l < adjacencies.n_elem; ++l)
-    {
-      // If l no longer refers to an element in this column, advance the column
-      // number accordingly.
-      if (adjacencies(l) >= nextColIndex)
-      {
-        curPointInd = (size_t) (adjacencies(l) / atoms);
-        nextColIndex = (curPointInd + 1) * atoms;
-      }
-
-      ++neighborCounts(curPointInd);
-    }
+    ++pointStart[adjacencies[l] / atoms + 1];
+    ++atomStart[adjacencies[l] % atoms + 1];
   }
+  for (size_t i = 0; i < data.n_cols; ++i)
+    pointStart[i + 1] += pointStart[i];
 
-  // Handle the case of inactive atoms (atoms not used in the given coding).
+  // Atoms not used in the given coding are inactive.
   std::vector<size_t> inactiveAtoms;
-
+  std::vector<size_t> activeAtoms;
+  std::vector<size_t> activeIndex(atoms, 0);
   for (size_t j = 0; j < atoms; ++j)
   {
-    if (arma::accu(codes.row(j) != 0) == 0)
+    if (atomStart[j + 1] == 0)
+    {
       inactiveAtoms.push_back(j);
+    }
+    else
+    {
+      activeIndex[j] = activeAtoms.size();
+      activeAtoms.push_back(j);
+    }
+    atomStart[j + 1] += atomStart[j];
   }
 
+  std::vector<size_t> atomPoints(adjacencies.n_elem);
+  std::vector<size_t> atomFill(atomStart.begin(), atomStart.end() - 1);
+  for (size_t l = 0; l < adjacencies.n_elem; ++l)
+    atomPoints[atomFill[adjacencies[l] % atoms]++] = adjacencies[l] / atoms;
+
   const size_t nInactiveAtoms = inactiveAtoms.size();
   const size_t nActiveAtoms = atoms - nInactiveAtoms;
 
-  // Efficient construction of Z restricted to active atoms.
-  arma::mat matActiveZ;
-  if (nInactiveAtoms > 0)
-  {
-    math::RemoveRows(codes, inactiveAtoms, matActiveZ);
-  }
-
   if (nInactiveAtoms > 0)
   {
     Log::Warn << "There are " << nInactiveAtoms
         << " inactive atoms. They will be re-initialized randomly.\n";
   }
 
+  // Z Z^T and X Z^T, restricted to the active atoms, computed in parallel from
+  // the nonzero codes only.  X Z^T is built by columns (one per atom), and then
+  // transposed to Z X^T.
+  arma::mat codesZT = arma::zeros<arma::mat>(nActiveAtoms, nActiveAtoms);
+  arma::mat dataZT = arma::zeros<arma::mat>(data.n_rows, nActiveAtoms);
+  aux::DictionaryStatistics statistics(data, codes, adjacencies, pointStart,
+      atomStart, atomPoints, activeAtoms, activeIndex, codesZT, dataZT);
+  util::ParallelFor(0, nActiveAtoms, statistics);
+  const arma::mat codesXT = trans(dataZT);
+
   Log::Debug << "Solving Dual via Newton's Method.\n";
 
   // Solve using Newton's method in the dual - note that the final dot
-  // multiplication with inv(A) seems to be unavoidable. Although more
-  // expensive, the code written this way (we use solve()) should be more
-  // numerically stable than just using inv(A) for everything.
+  // multiplication with inv(A) seems to be unavoidable.  A = Z Z^T + diag(dual)
+  // and the Hessian are symmetric, so their systems are solved with Cholesky
+  // factorizations (falling back to a general solver if one is not positive
+  // definite).  The factorization of A found by the line search is kept for
+  // the next iteration, so A is factored once per step.
   arma::vec dualVars = arma::zeros<arma::vec>(nActiveAtoms);
 
   //vec dualVars = 1e-14 * ones<vec>(nActiveAtoms);
@@ -192,35 +315,26 @@ double SparseCoding<DictionaryInitializer>::OptimizeDictionary(
 
   bool converged = false;
 
-  // If we have any inactive atoms, we must construct these differently.
-  arma::mat codesXT;
-  arma::mat codesZT;
-
-  if (inactiveAtoms.empty())
-  {
-    codesXT = codes * trans(data);
-    codesZT = codes * trans(codes);
-  }
-  else
-  {
-    codesXT = matActiveZ * trans(data);
-    codesZT = matActiveZ * trans(matActiveZ);
-  }
+  arma::mat A = codesZT;
+  arma::mat factor;
+  arma::mat matAInvZXT;
+  aux::SolveSymmetric(A, codesXT, matAInvZXT, factor);
 
   double normGradient = 0;
   double improvement = 0;
   for (size_t t = 1; (t != maxIterations) && !converged; ++t)
   {
-    arma::mat A = codesZT + diagmat(dualVars);
-
-    arma::mat matAInvZXT = solve(A, codesXT);
-
     arma::vec gradient = -arma::sum(arma::square(matAInvZXT), 1);
     gradient += 1;
 
-    arma::mat hessian = -(-2 * (matAInvZXT * trans(matAInvZXT)) % inv(A));
+    arma::mat aInv;
+    aux::InvertSymmetric(A, factor, aInv);
+    arma::mat hessian = 2 * (matAInvZXT * trans(matAInvZXT)) % aInv;
 
-    arma::vec searchDirection = -solve(hessian, gradient);
+    arma::mat hessianFactor;
+    arma::vec searchDirection;
+    aux::SolveSymmetric(hessian, gradient, searchDirection, hessianFactor);
+    searchDirection *= -1;
     //printf("%e\n", norm(searchDirection, 2));
 
     // Armijo line search.
@@ -229,21 +343,32 @@ double SparseCoding<DictionaryInitializer>::OptimizeDictionary(
     const double rho = 0.9;
     double sufficientDecrease = c * dot(gradient, searchDirection);
 
+    // The objective is Tr((Z X^T)^T A^{-1} Z X^T) + sum(dual), and the trace
+    // is the sum of the elementwise product.
+    const double sumDualVars = arma::sum(dualVars);
+    const double fOld = arma::accu(codesXT % matAInvZXT) + sumDualVars;
+
     // A maxIterations parameter for the Armijo line search may be a good idea,
     // but it doesn't seem to be causing any problems for now.
     while (true)
     {
       // Calculate objective.
-      double sumDualVars = arma::sum(dualVars);
-      double fOld = -(-trace(trans(codesXT) * matAInvZXT) - sumDualVars);
-      double fNew = -(-trace(trans(codesXT) * solve(codesZT +
-          diagmat(dualVars + alpha * searchDirection), codesXT)) -
-          (sumDualVars + alpha * arma::sum(searchDirection)));
+      arma::mat trialA = codesZT + diagmat(dualVars + alpha * searchDirection);
+      arma::mat trialFactor;
+      arma::mat trialAInvZXT;
+      aux::SolveSymmetric(trialA, codesXT, trialAInvZXT, trialFactor);
+      const double fNew = arma::accu(codesXT % trialAInvZXT) +
+          (sumDualVars + alpha * arma::sum(searchDirection));
 
       if (fNew <= fOld + alpha * sufficientDecrease)
       {
         searchDirection = alpha * searchDirection;
         improvement = fOld - fNew;
+
+        // The next iteration solves with this matrix.
+        A = trialA;
+        factor = trialFactor;
+        matAInvZXT = trialAInvZXT;
         break;
       }
 
@@ -262,21 +387,22 @@ double SparseCoding<DictionaryInitializer>::OptimizeDictionary(
       converged = true;
   }
 
+  // The solution for the final dual variables was found by the last step.
   if (inactiveAtoms.empty())
   {
     // Directly update dictionary.
-    dictionary = trans(solve(codesZT + diagmat(dualVars), codesXT));
+    dictionary = trans(matAInvZXT);
   }
   else
   {
-    arma::mat activeDictionary = trans(solve(codesZT +
-        diagmat(dualVars), codesXT));
+    arma::mat activeDictionary = trans(matAInvZXT);
 
     // Update all atoms.
     size_t currentInactiveIndex = 0;
     for (size_t i = 0; i < atoms; ++i)
     {
-      if (inactiveAtoms[currentInactiveIndex] == i)
+      if (currentInactiveIndex < nInactiveAtoms &&
+          inactiveAtoms[currentInactiveIndex] == i)
       {
         // This atom is inactive.  Reinitialize it randomly.
         dictionary.col(i) = (data.col(math::RandInt(data.n_cols)) +
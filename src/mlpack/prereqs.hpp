@@ -45,6 +45,12 @@ problems.  It should only be necessary to include <mlpack/core.hpp> and not\
   #define force_inline __forceinline
 #endif
 
+// If OpenMP is available, include its runtime functions.  Code using them must
+// be guarded with #ifdef _OPENMP so that mlpack still builds without OpenMP.
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
 // Now include Armadillo through the special mlpack extensions.
 #include <mlpack/core/arma_extend/arma_extend.hpp>
 
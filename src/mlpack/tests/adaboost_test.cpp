@@ -717,4 +717,52 @@ BOOST_AUTO_TEST_CASE(ClassifyTest_IRIS)
   BOOST_REQUIRE(lError <= 0.30);
 }
 
+/**
+ *  This test case runs the AdaBoost.mh algorithm with decision stumps on the
+ *  training part of the UCI Iris Dataset, and checks that classifying the
+ *  points in two batches gives the same predictions as classifying all of them
+ *  at once.
+ */
+BOOST_AUTO_TEST_CASE(ClassifyBatchTest_IRIS_DS)
+{
+  arma::mat inputData;
+
+  if (!data::Load("iris_train.csv", inputData))
+    BOOST_FAIL("Cannot load test dataset iris_train.csv!");
+
+  arma::Mat<size_t> labels;
+
+  if (!data::Load("iris_train_labels.csv",labels))
+    BOOST_FAIL("Cannot load labels for iris_train_labels.csv");
+
+  const size_t numClasses = 3;
+  const size_t inpBucketSize = 6;
+
+  decision_stump::DecisionStump<> ds(inputData, labels.row(0),
+                                     numClasses, inpBucketSize);
+
+  int iterations = 50;
+  double tolerance = 1e-10;
+
+  AdaBoost<arma::mat, mlpack::decision_stump::DecisionStump<> > a(inputData,
+           labels.row(0), iterations, tolerance, ds);
+
+  // The output does not need to have the right size.
+  arma::Row<size_t> predictedLabels;
+  a.Classify(inputData, predictedLabels);
+  BOOST_REQUIRE_EQUAL(predictedLabels.n_cols, inputData.n_cols);
+
+  const size_t half = inputData.n_cols / 2;
+  const arma::mat first = inputData.cols(0, half - 1);
+  const arma::mat second = inputData.cols(half, inputData.n_cols - 1);
+  arma::Row<size_t> firstLabels, secondLabels;
+  a.Classify(first, firstLabels);
+  a.Classify(second, secondLabels);
+
+  for (size_t i = 0; i < half; i++)
+    BOOST_REQUIRE_EQUAL(predictedLabels(i), firstLabels(i));
+  for (size_t i = half; i < inputData.n_cols; i++)
+    BOOST_REQUIRE_EQUAL(predictedLabels(i), secondLabels(i - half));
+}
+
 BOOST_AUTO_TEST_SUITE_END();
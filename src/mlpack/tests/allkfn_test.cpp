@@ -441,6 +441,40 @@ BOOST_AUTO_TEST_CASE(SingleTreeVsNaive)
   }
 }
 
+/**
+ * Make sure that approximate search (with a nonzero epsilon) returns, for each
+ * rank, a distance which is within a factor of (1 - epsilon) of the true
+ * distance of that rank.  Both single-tree and dual-tree search are tested.
+ */
+BOOST_AUTO_TEST_CASE(ApproximateVsNaive)
+{
+  arma::mat dataset;
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  AllkFN naive(dataset, true);
+  arma::Mat<size_t> neighborsNaive;
+  arma::mat distancesNaive;
+  naive.Search(15, neighborsNaive, distancesNaive);
+
+  const double epsilon = 0.2;
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    AllkFN approx(dataset, false, (mode == 1));
+    approx.Epsilon() = epsilon;
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    approx.Search(15, neighbors, distances);
+
+    for (size_t i = 0; i < distances.n_elem; ++i)
+    {
+      BOOST_REQUIRE_LE(distances[i], distancesNaive[i] * (1 + 1e-10));
+      BOOST_REQUIRE_GE(distances[i], (1 - epsilon) * distancesNaive[i] *
+          (1 - 1e-10));
+    }
+  }
+}
+
 /**
  * Test the cover tree single-tree furthest-neighbors method against the naive
  * method.  This uses only a random reference dataset.
@@ -6,6 +6,10 @@
 #include <mlpack/core.hpp>
 #include <mlpack/methods/neighbor_search/neighbor_search.hpp>
 #include <mlpack/methods/neighbor_search/unmap.hpp>
+#include <mlpack/methods/neighbor_search/dynamic_neighbor_search.hpp>
+#include <mlpack/methods/neighbor_search/merge_neighbors.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_graph.hpp>
+#include <mlpack/methods/neighbor_search/stream_search.hpp>
 #include <mlpack/core/tree/cover_tree.hpp>
 #include <mlpack/core/tree/example_tree.hpp>
 #include <boost/test/unit_test.hpp>
@@ -160,6 +164,60 @@ BOOST_AUTO_TEST_CASE(SingleTreeUnmapTest)
   }
 }
 
+/**
+ * Check that UnmapInPlace() gives the same results as Unmap() on random
+ * mappings, with and without a query mapping and with several threads.
+ */
+BOOST_AUTO_TEST_CASE(UnmapInPlaceTest)
+{
+  const size_t k = 4;
+  const size_t n = 500;
+
+  // Random permutations of the points.
+  arma::uvec refOrder = arma::shuffle(arma::linspace<arma::uvec>(0, n - 1, n));
+  arma::uvec queryOrder = arma::shuffle(arma::linspace<arma::uvec>(0, n - 1,
+      n));
+  std::vector<size_t> refMap(n), queryMap(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    refMap[i] = refOrder[i];
+    queryMap[i] = queryOrder[i];
+  }
+
+  arma::Mat<size_t> neighbors(k, n);
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+    neighbors[i] = (size_t) math::RandInt(n);
+  arma::mat distances = arma::randu<arma::mat>(k, n);
+
+  for (size_t threads = 1; threads <= 4; threads += 3)
+  {
+    // Dual-tree case.
+    arma::Mat<size_t> neighborsOut, neighborsIn(neighbors);
+    arma::mat distancesOut, distancesIn(distances);
+    Unmap(neighbors, distances, refMap, queryMap, neighborsOut, distancesOut,
+        true);
+    UnmapInPlace(neighborsIn, distancesIn, refMap, queryMap, true, threads);
+
+    for (size_t i = 0; i < neighborsOut.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(neighborsIn[i], neighborsOut[i]);
+      BOOST_REQUIRE_CLOSE(distancesIn[i], distancesOut[i], 1e-5);
+    }
+
+    // Single-tree case.
+    neighborsIn = neighbors;
+    distancesIn = distances;
+    Unmap(neighbors, distances, refMap, neighborsOut, distancesOut);
+    UnmapInPlace(neighborsIn, distancesIn, refMap, false, threads);
+
+    for (size_t i = 0; i < neighborsOut.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(neighborsIn[i], neighborsOut[i]);
+      BOOST_REQUIRE_CLOSE(distancesIn[i], distancesOut[i], 1e-5);
+    }
+  }
+}
+
 /**
  * Simple nearest-neighbors test with small, synthetic dataset.  This is an
  * exhaustive test, which checks that each method for performing the calculation
@@ -548,6 +606,242 @@ BOOST_AUTO_TEST_CASE(DualTreeVsNaive2)
   }
 }
 
+/**
+ * Test the parallel dual-tree nearest-neighbors method with the naive method,
+ * using both a query and reference dataset and then only a reference dataset.
+ * If mlpack was built without OpenMP this is just a serial traversal over
+ * query subtrees, which should still give identical results.
+ */
+BOOST_AUTO_TEST_CASE(ParallelDualTreeVsNaive)
+{
+  arma::mat dataForTree;
+
+  if (!data::Load("test_data_3_1000.csv", dataForTree))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  arma::mat dualQuery(dataForTree);
+  arma::mat dualReferences(dataForTree);
+  arma::mat monoReferences(dataForTree);
+  arma::mat naiveQuery(dataForTree);
+
+  AllkNN allknn(dualReferences, dualQuery);
+  allknn.NumThreads() = 4;
+  AllkNN monoAllknn(monoReferences);
+  monoAllknn.NumThreads() = 0; // Use all available threads.
+
+  AllkNN naive(naiveQuery, true);
+
+  arma::Mat<size_t> resultingNeighborsTree;
+  arma::mat distancesTree;
+  allknn.Search(15, resultingNeighborsTree, distancesTree);
+
+  arma::Mat<size_t> resultingNeighborsMono;
+  arma::mat distancesMono;
+  monoAllknn.Search(15, resultingNeighborsMono, distancesMono);
+
+  arma::Mat<size_t> resultingNeighborsNaive;
+  arma::mat distancesNaive;
+  naive.Search(15, resultingNeighborsNaive, distancesNaive);
+
+  for (size_t i = 0; i < resultingNeighborsNaive.n_elem; i++)
+  {
+    BOOST_REQUIRE(resultingNeighborsMono[i] == resultingNeighborsNaive[i]);
+    BOOST_REQUIRE_CLOSE(distancesMono[i], distancesNaive[i], 1e-5);
+  }
+
+  // The query set is not the reference set object here, so the query point
+  // itself will be returned; compare against the naive search with separate
+  // query and reference sets instead.
+  arma::mat naiveReferences(dataForTree);
+  AllkNN naiveDual(naiveReferences, naiveQuery, true);
+  naiveDual.Search(15, resultingNeighborsNaive, distancesNaive);
+
+  for (size_t i = 0; i < resultingNeighborsNaive.n_elem; i++)
+  {
+    BOOST_REQUIRE(resultingNeighborsTree[i] == resultingNeighborsNaive[i]);
+    BOOST_REQUIRE_CLOSE(distancesTree[i], distancesNaive[i], 1e-5);
+  }
+}
+
+/**
+ * Make sure that parallel dual-tree search with a copy of the references on
+ * each NUMA node gives the same results as without copies, and that the copies
+ * are reused by a second search.
+ */
+BOOST_AUTO_TEST_CASE(ReplicateReferencesTest)
+{
+  arma::mat dataset;
+
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  arma::mat queries(dataset);
+  arma::mat references(dataset);
+  arma::mat replicatedQueries(dataset);
+  arma::mat replicatedReferences(dataset);
+
+  AllkNN allknn(references, queries);
+  allknn.NumThreads() = 4;
+  AllkNN replicated(replicatedReferences, replicatedQueries);
+  replicated.NumThreads() = 4;
+  replicated.ReplicateReferences() = true;
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  allknn.Search(10, neighbors, distances);
+
+  for (size_t trial = 0; trial < 2; ++trial)
+  {
+    arma::Mat<size_t> replicatedNeighbors;
+    arma::mat replicatedDistances;
+    replicated.Search(10, replicatedNeighbors, replicatedDistances);
+
+    for (size_t i = 0; i < neighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(replicatedNeighbors[i], neighbors[i]);
+      BOOST_REQUIRE_CLOSE(replicatedDistances[i], distances[i], 1e-5);
+    }
+  }
+}
+
+/**
+ * Run the nearest neighbor rules with the breadth-first dual-tree traverser,
+ * serially and with several threads evaluating the base cases, and compare the
+ * results with the naive method.
+ */
+BOOST_AUTO_TEST_CASE(BreadthFirstTraverserVsNaive)
+{
+  arma::mat dataset;
+
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  typedef BinarySpaceTree<HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > TreeType;
+  typedef NeighborSearchRules<NearestNeighborSort, EuclideanDistance, TreeType>
+      RuleType;
+
+  // The tree rearranges the dataset, so the naive search is run on the
+  // rearranged points.
+  TreeType tree(dataset, 20);
+  arma::mat naiveData(dataset);
+  AllkNN naive(naiveData, true);
+
+  arma::Mat<size_t> neighborsNaive;
+  arma::mat distancesNaive;
+  naive.Search(10, neighborsNaive, distancesNaive);
+
+  const size_t threads[] = { 1, 4 };
+  for (size_t t = 0; t < 2; ++t)
+  {
+    arma::Mat<size_t> neighbors(10, dataset.n_cols);
+    arma::mat distances(10, dataset.n_cols);
+    neighbors.fill(size_t() - 1);
+    distances.fill(DBL_MAX);
+
+    EuclideanDistance metric;
+    RuleType rules(dataset, dataset, neighbors, distances, metric);
+    TreeType::BreadthFirstDualTreeTraverser<RuleType> traverser(rules);
+    traverser.Traverse(tree, tree, threads[t]);
+    SortedCandidateList<NearestNeighborSort>::Finalize(distances, neighbors);
+
+    for (size_t i = 0; i < neighborsNaive.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors[i], neighborsNaive[i]);
+      BOOST_REQUIRE_CLOSE(distances[i], distancesNaive[i], 1e-5);
+    }
+  }
+}
+
+/**
+ * Test that the heap-based and adaptive candidate lists give the same results
+ * as the sorted candidate list, for a k large enough that the adaptive list
+ * switches to the heap.
+ */
+BOOST_AUTO_TEST_CASE(HeapCandidateListTest)
+{
+  arma::mat dataForTree;
+
+  if (!data::Load("test_data_3_1000.csv", dataForTree))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  typedef NeighborSearch<NearestNeighborSort, EuclideanDistance,
+      BinarySpaceTree<HRectBound<2>, NeighborSearchStat<NearestNeighborSort> >,
+      HeapCandidateList<NearestNeighborSort> > HeapAllkNN;
+  typedef NeighborSearch<NearestNeighborSort, EuclideanDistance,
+      BinarySpaceTree<HRectBound<2>, NeighborSearchStat<NearestNeighborSort> >,
+      SortedCandidateList<NearestNeighborSort> > SortedAllkNN;
+
+  const size_t k = AdaptiveCandidateList<NearestNeighborSort>::HeapCutoff + 36;
+
+  HeapAllkNN heapDual(dataForTree);
+  HeapAllkNN heapSingle(dataForTree, false, true);
+  AllkNN adaptive(dataForTree);
+  SortedAllkNN naive(dataForTree, true);
+
+  arma::Mat<size_t> heapDualNeighbors, heapSingleNeighbors, adaptiveNeighbors,
+      naiveNeighbors;
+  arma::mat heapDualDistances, heapSingleDistances, adaptiveDistances,
+      naiveDistances;
+  heapDual.Search(k, heapDualNeighbors, heapDualDistances);
+  heapSingle.Search(k, heapSingleNeighbors, heapSingleDistances);
+  adaptive.Search(k, adaptiveNeighbors, adaptiveDistances);
+  naive.Search(k, naiveNeighbors, naiveDistances);
+
+  for (size_t i = 0; i < naiveNeighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(heapDualNeighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(heapDualDistances[i], naiveDistances[i], 1e-5);
+    BOOST_REQUIRE_EQUAL(heapSingleNeighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(heapSingleDistances[i], naiveDistances[i], 1e-5);
+    BOOST_REQUIRE_EQUAL(adaptiveNeighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(adaptiveDistances[i], naiveDistances[i], 1e-5);
+  }
+}
+
+/**
+ * Make sure that the heap candidate list breaks ties by index, so that the
+ * candidates it keeps do not depend on the order in which they are inserted.
+ */
+BOOST_AUTO_TEST_CASE(HeapCandidateListTieTest)
+{
+  // Ten candidates, in groups of equal distances.
+  const size_t k = 5;
+  const double candidateDistances[10] = { 3.0, 1.0, 2.0, 2.0, 1.0, 2.0, 3.0,
+      2.0, 1.0, 2.0 };
+
+  arma::Mat<size_t> forwardNeighbors(k, 1), backwardNeighbors(k, 1);
+  arma::mat forwardDistances(k, 1), backwardDistances(k, 1);
+  forwardNeighbors.fill(size_t() - 1);
+  backwardNeighbors.fill(size_t() - 1);
+  forwardDistances.fill(DBL_MAX);
+  backwardDistances.fill(DBL_MAX);
+
+  for (size_t i = 0; i < 10; ++i)
+  {
+    HeapCandidateList<NearestNeighborSort>::Insert(forwardDistances,
+        forwardNeighbors, 0, i, candidateDistances[i]);
+    HeapCandidateList<NearestNeighborSort>::Insert(backwardDistances,
+        backwardNeighbors, 0, 9 - i, candidateDistances[9 - i]);
+  }
+  HeapCandidateList<NearestNeighborSort>::Finalize(forwardDistances,
+      forwardNeighbors);
+  HeapCandidateList<NearestNeighborSort>::Finalize(backwardDistances,
+      backwardNeighbors);
+
+  // The three candidates at distance 1, then the two lowest indices at
+  // distance 2.
+  const size_t expected[k] = { 1, 4, 8, 2, 3 };
+  for (size_t i = 0; i < k; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(forwardNeighbors[i], expected[i]);
+    BOOST_REQUIRE_EQUAL(backwardNeighbors[i], expected[i]);
+    BOOST_REQUIRE_EQUAL(forwardDistances[i], candidateDistances[expected[i]]);
+    BOOST_REQUIRE_EQUAL(backwardDistances[i],
+        candidateDistances[expected[i]]);
+  }
+}
+
 /**
  * Test the single-tree nearest-neighbors method with the naive method.  This
  * uses only a reference dataset.
@@ -587,6 +881,538 @@ BOOST_AUTO_TEST_CASE(SingleTreeVsNaive)
   }
 }
 
+/**
+ * Make sure that batched single-tree search, serial and parallel, gives the
+ * same results as naive search, with and without a separate query set, for
+ * batch sizes which do and do not divide the number of query points.
+ */
+BOOST_AUTO_TEST_CASE(BatchedSingleTreeVsNaive)
+{
+  arma::mat referenceData;
+  referenceData.randu(3, 2000);
+  arma::mat queryData;
+  queryData.randu(3, 500);
+
+  AllkNN naive(referenceData, queryData, true);
+  arma::Mat<size_t> neighborsNaive;
+  arma::mat distancesNaive;
+  naive.Search(5, neighborsNaive, distancesNaive);
+
+  AllkNN naiveMono(referenceData, true);
+  arma::Mat<size_t> neighborsNaiveMono;
+  arma::mat distancesNaiveMono;
+  naiveMono.Search(5, neighborsNaiveMono, distancesNaiveMono);
+
+  const size_t batchSizes[] = { 1, 7, 64, 1000 };
+  for (size_t b = 0; b < 4; ++b)
+  {
+    for (size_t threads = 0; threads < 2; ++threads)
+    {
+      AllkNN allknn(referenceData, queryData, false, true);
+      allknn.SingleBatchSize() = batchSizes[b];
+      allknn.NumThreads() = threads;
+
+      arma::Mat<size_t> neighbors;
+      arma::mat distances;
+      allknn.Search(5, neighbors, distances);
+
+      BOOST_REQUIRE_EQUAL(neighbors.n_cols, queryData.n_cols);
+      for (size_t i = 0; i < neighbors.n_elem; ++i)
+      {
+        BOOST_REQUIRE_EQUAL(neighbors[i], neighborsNaive[i]);
+        BOOST_REQUIRE_CLOSE(distances[i], distancesNaive[i], 1e-5);
+      }
+
+      AllkNN allknnMono(referenceData, false, true);
+      allknnMono.SingleBatchSize() = batchSizes[b];
+      allknnMono.NumThreads() = threads;
+      allknnMono.Search(5, neighbors, distances);
+
+      for (size_t i = 0; i < neighbors.n_elem; ++i)
+      {
+        BOOST_REQUIRE_EQUAL(neighbors[i], neighborsNaiveMono[i]);
+        BOOST_REQUIRE_CLOSE(distances[i], distancesNaiveMono[i], 1e-5);
+      }
+
+      // The const search of the same object gives the same results.
+      allknn.Search(queryData, 5, neighbors, distances);
+      for (size_t i = 0; i < neighbors.n_elem; ++i)
+      {
+        BOOST_REQUIRE_EQUAL(neighbors[i], neighborsNaive[i]);
+        BOOST_REQUIRE_CLOSE(distances[i], distancesNaive[i], 1e-5);
+      }
+    }
+  }
+}
+
+/**
+ * Make sure that naive search with the Euclidean distance, which is done with
+ * matrix products, gives the same results as dual-tree search, in high
+ * dimensions and with more points than fit in one block.
+ */
+BOOST_AUTO_TEST_CASE(BruteForceVsTreeTest)
+{
+  arma::mat referenceData;
+  referenceData.randu(100, 1500);
+  arma::mat queryData;
+  queryData.randu(100, 400);
+
+  for (size_t threads = 1; threads <= 4; threads *= 4)
+  {
+    AllkNN bruteForce(referenceData, queryData, true);
+    bruteForce.NumThreads() = threads;
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    bruteForce.Search(7, neighbors, distances);
+
+    AllkNN tree(referenceData, queryData);
+    arma::Mat<size_t> neighborsTree;
+    arma::mat distancesTree;
+    tree.Search(7, neighborsTree, distancesTree);
+
+    for (size_t i = 0; i < neighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors[i], neighborsTree[i]);
+      BOOST_REQUIRE_CLOSE(distances[i], distancesTree[i], 1e-5);
+    }
+
+    // Now with one set; points must not be their own neighbors.
+    AllkNN bruteForceMono(referenceData, true);
+    bruteForceMono.NumThreads() = threads;
+    bruteForceMono.Search(7, neighbors, distances);
+
+    AllkNN treeMono(referenceData);
+    treeMono.Search(7, neighborsTree, distancesTree);
+
+    for (size_t i = 0; i < neighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors[i], neighborsTree[i]);
+      BOOST_REQUIRE_CLOSE(distances[i], distancesTree[i], 1e-5);
+    }
+  }
+
+  // Furthest neighbors, in single precision.
+  const arma::fmat referenceFloat =
+      arma::conv_to<arma::fmat>::from(referenceData);
+  typedef NeighborSearch<FurthestNeighborSort, EuclideanDistance,
+      BinarySpaceTree<HRectBound<2>, NeighborSearchStat<FurthestNeighborSort>,
+      arma::fmat> > FloatAllkFN;
+  FloatAllkFN bruteForce(referenceFloat, true);
+  arma::Mat<size_t> neighbors;
+  arma::fmat distances;
+  bruteForce.Search(3, neighbors, distances);
+
+  FloatAllkFN tree(referenceFloat);
+  arma::Mat<size_t> neighborsTree;
+  arma::fmat distancesTree;
+  tree.Search(3, neighborsTree, distancesTree);
+
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i], neighborsTree[i]);
+    BOOST_REQUIRE_CLOSE(distances[i], distancesTree[i], 1e-3);
+  }
+}
+
+/**
+ * Make sure that naive search does not refer to the matrices it was given,
+ * which may be destroyed after construction, and that giving the same matrix
+ * as both sets finds each point as its own neighbor, as with trees.
+ */
+BOOST_AUTO_TEST_CASE(NaiveCopiesDataTest)
+{
+  arma::mat* dataset = new arma::mat(10, 500);
+  dataset->randu();
+
+  AllkNN naive(*dataset, *dataset, true);
+  AllkNN tree(*dataset, *dataset);
+  delete dataset;
+
+  arma::Mat<size_t> neighbors, neighborsTree;
+  arma::mat distances, distancesTree;
+  naive.Search(3, neighbors, distances);
+  tree.Search(3, neighborsTree, distancesTree);
+
+  for (size_t i = 0; i < neighbors.n_cols; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors(0, i), i);
+    BOOST_REQUIRE_SMALL(distances(0, i), 1e-5);
+  }
+
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i], neighborsTree[i]);
+    if (distancesTree[i] < 1e-5)
+      BOOST_REQUIRE_SMALL(distances[i], 1e-5);
+    else
+      BOOST_REQUIRE_CLOSE(distances[i], distancesTree[i], 1e-5);
+  }
+}
+
+/**
+ * Build the union and mutual neighbor graphs of a dataset and compare them with
+ * graphs built directly from the neighbor lists.
+ */
+BOOST_AUTO_TEST_CASE(NeighborGraphTest)
+{
+  arma::mat dataset;
+  dataset.randu(4, 300);
+
+  AllkNN allknn(dataset);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  allknn.Search(5, neighbors, distances);
+
+  // The dense adjacency matrix of the directed neighbor relation.
+  arma::mat directed(dataset.n_cols, dataset.n_cols);
+  directed.zeros();
+  for (size_t i = 0; i < neighbors.n_cols; ++i)
+    for (size_t j = 0; j < neighbors.n_rows; ++j)
+      directed(neighbors(j, i), i) = distances(j, i);
+
+  for (size_t m = 0; m < 2; ++m)
+  {
+    const bool mutual = (m == 1);
+
+    arma::Mat<size_t> edges;
+    arma::vec weights;
+    NeighborGraph(neighbors, distances, edges, weights, mutual);
+    arma::sp_mat graph;
+    NeighborGraph(neighbors, distances, graph, mutual);
+
+    BOOST_REQUIRE_EQUAL(edges.n_cols, weights.n_elem);
+    BOOST_REQUIRE_EQUAL(graph.n_rows, dataset.n_cols);
+    BOOST_REQUIRE_EQUAL(graph.n_cols, dataset.n_cols);
+    BOOST_REQUIRE_EQUAL(graph.n_nonzero, edges.n_cols);
+
+    size_t expectedEdges = 0;
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+    {
+      for (size_t j = 0; j < dataset.n_cols; ++j)
+      {
+        const bool connected = mutual ?
+            (directed(i, j) != 0 && directed(j, i) != 0) :
+            (directed(i, j) != 0 || directed(j, i) != 0);
+        if (!connected)
+        {
+          BOOST_REQUIRE_SMALL((double) graph(i, j), 1e-20);
+          continue;
+        }
+
+        ++expectedEdges;
+        const double distance = EuclideanDistance::Evaluate(
+            dataset.col(i), dataset.col(j));
+        BOOST_REQUIRE_CLOSE((double) graph(i, j), distance, 1e-5);
+      }
+    }
+    BOOST_REQUIRE_EQUAL(edges.n_cols, expectedEdges);
+
+    // The edge list is sorted and matches the sparse matrix.
+    for (size_t e = 0; e < edges.n_cols; ++e)
+    {
+      if (e > 0)
+        BOOST_REQUIRE(edges(0, e - 1) < edges(0, e) ||
+            (edges(0, e - 1) == edges(0, e) && edges(1, e - 1) < edges(1, e)));
+      BOOST_REQUIRE_CLOSE((double) graph(edges(0, e), edges(1, e)), weights[e],
+          1e-5);
+    }
+  }
+}
+
+/**
+ * Split the reference set into shards, search each shard separately, and make
+ * sure that merging the results of the shards gives the results of searching
+ * the whole reference set.
+ */
+BOOST_AUTO_TEST_CASE(MergeShardedResultsTest)
+{
+  arma::mat referenceData;
+  referenceData.randu(3, 1000);
+  arma::mat queryData;
+  queryData.randu(3, 200);
+
+  AllkNN naive(referenceData, queryData, true);
+  arma::Mat<size_t> neighborsNaive;
+  arma::mat distancesNaive;
+  naive.Search(10, neighborsNaive, distancesNaive);
+
+  // Five shards of different sizes (the last has fewer than k points).
+  const size_t bounds[] = { 0, 300, 500, 800, 995, 1000 };
+  std::vector<arma::Mat<size_t> > neighborSets(5);
+  std::vector<arma::mat> distanceSets(5);
+  for (size_t i = 0; i < 5; ++i)
+  {
+    const arma::mat shard = referenceData.cols(bounds[i], bounds[i + 1] - 1);
+    AllkNN allknn(shard, queryData);
+    allknn.Search(std::min((size_t) 10, shard.n_cols), neighborSets[i],
+        distanceSets[i]);
+    neighborSets[i] += bounds[i];
+  }
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  MergeNeighbors<NearestNeighborSort>(neighborSets, distanceSets, 10,
+      neighbors, distances);
+
+  BOOST_REQUIRE_EQUAL(neighbors.n_rows, 10);
+  BOOST_REQUIRE_EQUAL(neighbors.n_cols, queryData.n_cols);
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i], neighborsNaive[i]);
+    BOOST_REQUIRE_CLOSE(distances[i], distancesNaive[i], 1e-5);
+  }
+}
+
+/**
+ * Search several query batches at once with the const Search() of one object,
+ * in single-tree, dual-tree and naive mode, and make sure the results match
+ * naive search on each batch.
+ */
+BOOST_AUTO_TEST_CASE(ConcurrentConstSearchTest)
+{
+  arma::mat referenceData;
+  referenceData.randu(3, 1000);
+
+  std::vector<arma::mat> batches(8);
+  for (size_t i = 0; i < batches.size(); ++i)
+    batches[i].randu(3, 50 + 10 * i);
+
+  for (size_t mode = 0; mode < 3; ++mode)
+  {
+    const AllkNN allknn(referenceData, (mode == 2), (mode == 1));
+
+    std::vector<arma::Mat<size_t> > neighbors(batches.size());
+    std::vector<arma::mat> distances(batches.size());
+
+    #pragma omp parallel for
+    for (int i = 0; i < (int) batches.size(); ++i)
+      allknn.Search(batches[i], 5, neighbors[i], distances[i]);
+
+    for (size_t i = 0; i < batches.size(); ++i)
+    {
+      AllkNN naive(referenceData, batches[i], true);
+      arma::Mat<size_t> neighborsNaive;
+      arma::mat distancesNaive;
+      naive.Search(5, neighborsNaive, distancesNaive);
+
+      BOOST_REQUIRE_EQUAL(neighbors[i].n_cols, batches[i].n_cols);
+      for (size_t j = 0; j < neighborsNaive.n_elem; ++j)
+      {
+        BOOST_REQUIRE_EQUAL(neighbors[i][j], neighborsNaive[j]);
+        BOOST_REQUIRE_CLOSE(distances[i][j], distancesNaive[j], 1e-5);
+      }
+    }
+  }
+}
+
+/**
+ * Make sure that building the trees in place on the caller's matrices gives
+ * the same results as building them on copies, and that the matrices are
+ * rearranged as the returned mappings say.
+ */
+BOOST_AUTO_TEST_CASE(InPlaceTreeBuildingTest)
+{
+  arma::mat referenceData;
+  referenceData.randu(3, 500);
+  arma::mat queryData;
+  queryData.randu(3, 300);
+
+  AllkNN copying(referenceData, queryData);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  copying.Search(5, neighbors, distances);
+
+  AllkNN copyingMono(referenceData);
+  arma::Mat<size_t> neighborsMono;
+  arma::mat distancesMono;
+  copyingMono.Search(5, neighborsMono, distancesMono);
+
+  arma::mat references(referenceData);
+  arma::mat queries(queryData);
+  std::vector<size_t> oldFromNewReferences;
+  std::vector<size_t> oldFromNewQueries;
+  AllkNN inPlace(references, queries, oldFromNewReferences, oldFromNewQueries);
+
+  BOOST_REQUIRE_EQUAL(oldFromNewReferences.size(), referenceData.n_cols);
+  BOOST_REQUIRE_EQUAL(oldFromNewQueries.size(), queryData.n_cols);
+  for (size_t i = 0; i < references.n_cols; ++i)
+    for (size_t d = 0; d < references.n_rows; ++d)
+      BOOST_REQUIRE_EQUAL(references(d, i),
+          referenceData(d, oldFromNewReferences[i]));
+  for (size_t i = 0; i < queries.n_cols; ++i)
+    for (size_t d = 0; d < queries.n_rows; ++d)
+      BOOST_REQUIRE_EQUAL(queries(d, i), queryData(d, oldFromNewQueries[i]));
+
+  arma::Mat<size_t> neighborsInPlace;
+  arma::mat distancesInPlace;
+  inPlace.Search(5, neighborsInPlace, distancesInPlace);
+
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighborsInPlace[i], neighbors[i]);
+    BOOST_REQUIRE_CLOSE(distancesInPlace[i], distances[i], 1e-5);
+  }
+
+  std::vector<size_t> oldFromNew;
+  AllkNN inPlaceMono(references, oldFromNew);
+  inPlaceMono.Search(5, neighborsInPlace, distancesInPlace);
+
+  // The references were already rearranged once, so the results are mapped to
+  // those indices.
+  for (size_t i = 0; i < neighborsMono.n_cols; ++i)
+  {
+    for (size_t j = 0; j < neighborsMono.n_rows; ++j)
+    {
+      BOOST_REQUIRE_EQUAL(oldFromNewReferences[neighborsInPlace(j, i)],
+          neighborsMono(j, oldFromNewReferences[i]));
+      BOOST_REQUIRE_CLOSE(distancesInPlace(j, i),
+          distancesMono(j, oldFromNewReferences[i]), 1e-5);
+    }
+  }
+}
+
+/**
+ * Search a lazily built reference tree with several query batches at once, in
+ * single-tree and dual-tree mode, and make sure that the results match naive
+ * search, and that a few small batches do not split the whole tree.
+ */
+BOOST_AUTO_TEST_CASE(LazyTreeSearchTest)
+{
+  typedef BinarySpaceTree<HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > TreeType;
+
+  arma::mat referenceData;
+  referenceData.randu(3, 10000);
+
+  std::vector<arma::mat> batches(4);
+  for (size_t i = 0; i < batches.size(); ++i)
+    batches[i].randu(3, 20);
+
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    arma::mat references(referenceData);
+    std::vector<size_t> oldFromNew;
+    TreeType tree(references, oldFromNew, 20, true);
+    const AllkNN allknn(&tree, references, (mode == 0));
+
+    std::vector<arma::Mat<size_t> > neighbors(batches.size());
+    std::vector<arma::mat> distances(batches.size());
+
+    #pragma omp parallel for
+    for (int i = 0; i < (int) batches.size(); ++i)
+      allknn.Search(batches[i], 5, neighbors[i], distances[i]);
+
+    // Only the nodes near the queries should have been split.
+    arma::mat eagerReferences(referenceData);
+    TreeType eagerTree(eagerReferences, 20);
+    BOOST_REQUIRE_LT(tree.TreeSize(), eagerTree.TreeSize());
+
+    for (size_t i = 0; i < batches.size(); ++i)
+    {
+      AllkNN naive(referenceData, batches[i], true);
+      arma::Mat<size_t> neighborsNaive;
+      arma::mat distancesNaive;
+      naive.Search(5, neighborsNaive, distancesNaive);
+
+      BOOST_REQUIRE_EQUAL(neighbors[i].n_cols, batches[i].n_cols);
+      for (size_t j = 0; j < neighborsNaive.n_elem; ++j)
+      {
+        BOOST_REQUIRE_EQUAL(oldFromNew[neighbors[i][j]], neighborsNaive[j]);
+        BOOST_REQUIRE_CLOSE(distances[i][j], distancesNaive[j], 1e-5);
+      }
+    }
+  }
+}
+
+/**
+ * Make sure that moving the matrices into the object gives the same results as
+ * copying them.
+ */
+BOOST_AUTO_TEST_CASE(MoveConstructorTest)
+{
+  arma::mat referenceData;
+  referenceData.randu(3, 500);
+  arma::mat queryData;
+  queryData.randu(3, 300);
+
+  AllkNN copying(referenceData, queryData);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  copying.Search(5, neighbors, distances);
+
+  AllkNN copyingMono(referenceData);
+  arma::Mat<size_t> neighborsMono;
+  arma::mat distancesMono;
+  copyingMono.Search(5, neighborsMono, distancesMono);
+
+  arma::mat references(referenceData);
+  arma::mat queries(queryData);
+  AllkNN moving(std::move(references), std::move(queries));
+  arma::Mat<size_t> neighborsMoved;
+  arma::mat distancesMoved;
+  moving.Search(5, neighborsMoved, distancesMoved);
+
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighborsMoved[i], neighbors[i]);
+    BOOST_REQUIRE_CLOSE(distancesMoved[i], distances[i], 1e-5);
+  }
+
+  references = referenceData;
+  AllkNN movingMono(std::move(references));
+  movingMono.Search(5, neighborsMoved, distancesMoved);
+
+  for (size_t i = 0; i < neighborsMono.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighborsMoved[i], neighborsMono[i]);
+    BOOST_REQUIRE_CLOSE(distancesMoved[i], distancesMono[i], 1e-5);
+  }
+}
+
+/**
+ * Make sure that approximate search (with a nonzero epsilon) returns, for each
+ * rank, a distance which is within a factor of (1 + epsilon) of the true
+ * distance of that rank, and does less work than exact search.  Both single-tree
+ * and dual-tree search are tested.
+ */
+BOOST_AUTO_TEST_CASE(ApproximateVsNaive)
+{
+  arma::mat dataset;
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  AllkNN naive(dataset, true);
+  arma::Mat<size_t> neighborsNaive;
+  arma::mat distancesNaive;
+  naive.Search(15, neighborsNaive, distancesNaive);
+
+  const double epsilon = 0.5;
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    const bool singleMode = (mode == 1);
+
+    AllkNN exact(dataset, false, singleMode);
+    arma::Mat<size_t> neighborsExact;
+    arma::mat distancesExact;
+    exact.Search(15, neighborsExact, distancesExact);
+
+    AllkNN approx(dataset, false, singleMode);
+    approx.Epsilon() = epsilon;
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    approx.Search(15, neighbors, distances);
+
+    for (size_t i = 0; i < distances.n_elem; ++i)
+    {
+      BOOST_REQUIRE_GE(distances[i], distancesNaive[i] * (1 - 1e-10));
+      BOOST_REQUIRE_LE(distances[i], (1 + epsilon) * distancesNaive[i] *
+          (1 + 1e-10));
+    }
+
+    BOOST_REQUIRE_LE(approx.BaseCases(), exact.BaseCases());
+  }
+}
+
 /**
  * Test the cover tree single-tree nearest-neighbors method against the naive
  * method.  This uses only a random reference dataset.
@@ -663,6 +1489,42 @@ BOOST_AUTO_TEST_CASE(DualCoverTreeTest)
   }
 }
 
+/**
+ * Test the parallel cover tree dual-tree traversal against the naive method.
+ * The dataset is large enough that the distances are computed in parallel
+ * while the tree is built, too.
+ */
+BOOST_AUTO_TEST_CASE(ParallelDualCoverTreeTest)
+{
+  arma::mat dataset;
+  dataset.randu(10, 2000);
+
+  arma::mat naiveData(dataset);
+  AllkNN naive(naiveData, true);
+
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  naive.Search(5, naiveNeighbors, naiveDistances);
+
+  typedef CoverTree<LMetric<2, true>, FirstPointIsRoot,
+      NeighborSearchStat<NearestNeighborSort> > TreeType;
+  TreeType referenceTree(dataset);
+
+  NeighborSearch<NearestNeighborSort, LMetric<2, true>, TreeType>
+      coverTreeSearch(&referenceTree, dataset);
+  coverTreeSearch.NumThreads() = 4;
+
+  arma::Mat<size_t> coverNeighbors;
+  arma::mat coverDistances;
+  coverTreeSearch.Search(5, coverNeighbors, coverDistances);
+
+  for (size_t i = 0; i < coverNeighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(coverNeighbors(i), naiveNeighbors(i));
+    BOOST_REQUIRE_CLOSE(coverDistances(i), naiveDistances(i), 1e-5);
+  }
+}
+
 /**
  * Test the ball tree single-tree nearest-neighbors method against the naive
  * method.  This uses only a random reference dataset.
@@ -736,6 +1598,225 @@ BOOST_AUTO_TEST_CASE(DualBallTreeTest)
   }
 }
 
+/**
+ * Test single-precision kd-tree search: dual-tree and single-tree search must
+ * give the same results as naive single-precision search, and distances close
+ * to those of double-precision search.
+ */
+BOOST_AUTO_TEST_CASE(FloatAllkNNTest)
+{
+  arma::mat dataset;
+  dataset.randu(10, 1000);
+  const arma::fmat floatDataset = arma::conv_to<arma::fmat>::from(dataset);
+
+  typedef NeighborSearch<NearestNeighborSort, EuclideanDistance,
+      BinarySpaceTree<HRectBound<2>, NeighborSearchStat<NearestNeighborSort>,
+      arma::fmat> > FloatAllkNN;
+
+  FloatAllkNN naive(floatDataset, true);
+  FloatAllkNN dualTree(floatDataset);
+  FloatAllkNN singleTree(floatDataset, false, true);
+
+  arma::Mat<size_t> naiveNeighbors, dualNeighbors, singleNeighbors;
+  arma::fmat naiveDistances, dualDistances, singleDistances;
+  naive.Search(5, naiveNeighbors, naiveDistances);
+  dualTree.Search(5, dualNeighbors, dualDistances);
+  singleTree.Search(5, singleNeighbors, singleDistances);
+
+  AllkNN doubleNaive(dataset, true);
+  arma::Mat<size_t> doubleNeighbors;
+  arma::mat doubleDistances;
+  doubleNaive.Search(5, doubleNeighbors, doubleDistances);
+
+  for (size_t i = 0; i < naiveNeighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(dualNeighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_EQUAL(dualDistances[i], naiveDistances[i]);
+    BOOST_REQUIRE_EQUAL(singleNeighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_EQUAL(singleDistances[i], naiveDistances[i]);
+
+    BOOST_REQUIRE_CLOSE((double) naiveDistances[i], doubleDistances[i], 1e-3);
+  }
+}
+
+/**
+ * Make sure that compacting the trees does not change the results of dual-tree
+ * or single-tree search.
+ */
+BOOST_AUTO_TEST_CASE(CompactTreeTest)
+{
+  arma::mat dataset;
+  data::Load("test_data_3_1000.csv", dataset);
+  arma::mat compactDataset(dataset);
+
+  typedef BinarySpaceTree<HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > TreeType;
+  TreeType tree(dataset, 10);
+  TreeType compactTree(compactDataset, 10);
+  compactTree.Compact();
+
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    const bool singleMode = (mode == 1);
+    AllkNN allknn(&tree, dataset, singleMode);
+    AllkNN compactAllknn(&compactTree, compactDataset, singleMode);
+
+    arma::Mat<size_t> neighbors, compactNeighbors;
+    arma::mat distances, compactDistances;
+    allknn.Search(5, neighbors, distances);
+    compactAllknn.Search(5, compactNeighbors, compactDistances);
+
+    for (size_t i = 0; i < neighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors[i], compactNeighbors[i]);
+      BOOST_REQUIRE_CLOSE(distances[i], compactDistances[i], 1e-5);
+    }
+  }
+}
+
+/**
+ * Make sure that kd-trees with bounds of fixed dimensionality (compacted or
+ * not) find the same neighbors as kd-trees with bounds of any dimensionality.
+ */
+BOOST_AUTO_TEST_CASE(FixedDimensionalityTreeTest)
+{
+  arma::mat dataset;
+  data::Load("test_data_3_1000.csv", dataset);
+  arma::mat fixedDataset(dataset);
+  arma::mat compactDataset(dataset);
+
+  typedef BinarySpaceTree<HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > TreeType;
+  typedef BinarySpaceTree<HRectBound<2, true, 3>,
+      NeighborSearchStat<NearestNeighborSort> > FixedTreeType;
+  typedef NeighborSearch<NearestNeighborSort, EuclideanDistance,
+      FixedTreeType> FixedAllkNN;
+
+  TreeType tree(dataset, 10);
+  FixedTreeType fixedTree(fixedDataset, 10);
+  FixedTreeType compactTree(compactDataset, 10);
+  compactTree.Compact();
+
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    const bool singleMode = (mode == 1);
+    AllkNN allknn(&tree, dataset, singleMode);
+    FixedAllkNN fixedAllknn(&fixedTree, fixedDataset, singleMode);
+    FixedAllkNN compactAllknn(&compactTree, compactDataset, singleMode);
+
+    arma::Mat<size_t> neighbors, fixedNeighbors, compactNeighbors;
+    arma::mat distances, fixedDistances, compactDistances;
+    allknn.Search(5, neighbors, distances);
+    fixedAllknn.Search(5, fixedNeighbors, fixedDistances);
+    compactAllknn.Search(5, compactNeighbors, compactDistances);
+
+    for (size_t i = 0; i < neighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors[i], fixedNeighbors[i]);
+      BOOST_REQUIRE_EQUAL(neighbors[i], compactNeighbors[i]);
+      BOOST_REQUIRE_CLOSE(distances[i], fixedDistances[i], 1e-5);
+      BOOST_REQUIRE_CLOSE(distances[i], compactDistances[i], 1e-5);
+    }
+  }
+}
+
+/**
+ * Insert and delete points in a DynamicNeighborSearch object (enough deletions
+ * to trigger compaction) and make sure that each search gives the same results
+ * as a naive search on the points that are currently held.
+ */
+BOOST_AUTO_TEST_CASE(DynamicNeighborSearchTest)
+{
+  arma::mat dataset;
+  dataset.randu(3, 500);
+
+  DynamicNeighborSearch<> search(dataset, 0.2);
+
+  // Keep our own copy of the current points, by id.
+  std::map<size_t, size_t> columnOfId;
+  arma::mat points = dataset;
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    columnOfId[i] = i;
+
+  arma::mat querySet;
+  querySet.randu(3, 100);
+
+  for (size_t round = 0; round < 4; ++round)
+  {
+    // Delete about a quarter of the points.
+    std::vector<size_t> deleted;
+    for (std::map<size_t, size_t>::iterator it = columnOfId.begin();
+         it != columnOfId.end(); ++it)
+      if (math::RandInt(4) == 0)
+        deleted.push_back(it->first);
+
+    for (size_t i = 0; i < deleted.size(); ++i)
+    {
+      BOOST_REQUIRE(search.Delete(deleted[i]));
+      BOOST_REQUIRE(!search.Contains(deleted[i]));
+      columnOfId.erase(deleted[i]);
+    }
+    if (!deleted.empty())
+      BOOST_REQUIRE(!search.Delete(deleted[0]));
+
+    // Insert some new points.
+    arma::mat newPoints;
+    newPoints.randu(3, 100);
+    points.resize(3, points.n_cols + 100);
+    for (size_t i = 0; i < 100; ++i)
+    {
+      const size_t id = search.Insert(newPoints.col(i));
+      points.col(points.n_cols - 100 + i) = newPoints.col(i);
+      columnOfId[id] = points.n_cols - 100 + i;
+    }
+
+    BOOST_REQUIRE_EQUAL(search.NumPoints(), columnOfId.size());
+    BOOST_REQUIRE_LE(search.NumDeleted(), 0.2 * (search.NumPoints() +
+        search.NumDeleted()) + 1);
+
+    // Now build the current set of points and run a naive search on it.
+    arma::mat current(3, columnOfId.size());
+    std::vector<size_t> idOfColumn(columnOfId.size());
+    size_t c = 0;
+    for (std::map<size_t, size_t>::iterator it = columnOfId.begin();
+         it != columnOfId.end(); ++it, ++c)
+    {
+      current.col(c) = points.col(it->second);
+      idOfColumn[c] = it->first;
+    }
+
+    AllkNN naive(current, querySet, true);
+    arma::Mat<size_t> naiveNeighbors;
+    arma::mat naiveDistances;
+    naive.Search(5, naiveNeighbors, naiveDistances);
+
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    search.Search(querySet, 5, neighbors, distances);
+
+    BOOST_REQUIRE_EQUAL(neighbors.n_rows, 5);
+    BOOST_REQUIRE_EQUAL(neighbors.n_cols, querySet.n_cols);
+    for (size_t i = 0; i < neighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors[i], idOfColumn[naiveNeighbors[i]]);
+      BOOST_REQUIRE_CLOSE(distances[i], naiveDistances[i], 1e-5);
+    }
+  }
+
+  // Explicit compaction must not change the results.
+  arma::Mat<size_t> neighbors, compactNeighbors;
+  arma::mat distances, compactDistances;
+  search.Search(querySet, 3, neighbors, distances);
+  search.Compact();
+  BOOST_REQUIRE_EQUAL(search.NumDeleted(), 0);
+  search.Search(querySet, 3, compactNeighbors, compactDistances);
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i], compactNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(distances[i], compactDistances[i], 1e-5);
+  }
+}
+
 // Make sure sparse nearest neighbors works with kd trees.
 BOOST_AUTO_TEST_CASE(SparseAllkNNKDTreeTest)
 {
@@ -777,6 +1858,67 @@ BOOST_AUTO_TEST_CASE(SparseAllkNNKDTreeTest)
   }
 }
 
+/**
+ * Search a query file in blocks with StreamSearch(), with dual-tree and
+ * single-tree search, and make sure the results are the same as the results of
+ * brute-force search of the whole query set.
+ */
+BOOST_AUTO_TEST_CASE(StreamSearchTest)
+{
+  typedef BinarySpaceTree<HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > TreeType;
+
+  arma::mat referenceData = arma::randu<arma::mat>(3, 500);
+  arma::mat queryData = arma::randu<arma::mat>(3, 237);
+  data::Save("test_stream_queries.csv", queryData);
+
+  AllkNN naive(referenceData, queryData, true);
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  naive.Search(5, naiveNeighbors, naiveDistances);
+
+  std::vector<size_t> oldFromNewRefs;
+  arma::mat treeData(referenceData);
+  TreeType referenceTree(treeData, oldFromNewRefs, 10);
+
+  for (size_t single = 0; single < 2; ++single)
+  {
+    // The block size does not divide the number of points.
+    data::StreamingReader queries("test_stream_queries.csv", 50);
+    std::ofstream neighborsOut("test_stream_neighbors.csv");
+    std::ofstream distancesOut("test_stream_distances.csv");
+    const size_t points = StreamSearch<NearestNeighborSort>(referenceTree,
+        treeData, oldFromNewRefs, queries, 5, neighborsOut, distancesOut, 10,
+        (single == 1));
+    neighborsOut.close();
+    distancesOut.close();
+
+    BOOST_REQUIRE_EQUAL(points, 237);
+
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    data::Load("test_stream_neighbors.csv", neighbors, true);
+    data::Load("test_stream_distances.csv", distances, true);
+
+    BOOST_REQUIRE_EQUAL(neighbors.n_rows, 5);
+    BOOST_REQUIRE_EQUAL(neighbors.n_cols, 237);
+    BOOST_REQUIRE_EQUAL(distances.n_rows, 5);
+    BOOST_REQUIRE_EQUAL(distances.n_cols, 237);
+    for (size_t i = 0; i < neighbors.n_cols; ++i)
+    {
+      for (size_t j = 0; j < neighbors.n_rows; ++j)
+      {
+        BOOST_REQUIRE_EQUAL(neighbors(j, i), naiveNeighbors(j, i));
+        BOOST_REQUIRE_CLOSE(distances(j, i), naiveDistances(j, i), 1e-3);
+      }
+    }
+  }
+
+  remove("test_stream_queries.csv");
+  remove("test_stream_neighbors.csv");
+  remove("test_stream_distances.csv");
+}
+
 /*
 BOOST_AUTO_TEST_CASE(SparseAllkNNCoverTreeTest)
 {
@@ -8,6 +8,7 @@
 #include <mlpack/core.hpp>
 #include <mlpack/core/metrics/lmetric.hpp>
 #include <mlpack/core/tree/cover_tree.hpp>
+#include <mlpack/core/tree/rectangle_tree.hpp>
 
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
@@ -591,4 +592,135 @@ BOOST_AUTO_TEST_CASE(DualBallTreeTest)
 }
 */
 
+// Test single-tree and dual-tree rank-approximate search with R*-trees.
+BOOST_AUTO_TEST_CASE(RTreeTest)
+{
+  arma::mat refData;
+  arma::mat queryData;
+
+  data::Load("rann_test_r_3_900.csv", refData, true);
+  data::Load("rann_test_q_3_100.csv", queryData, true);
+
+  typedef RectangleTree<RStarTreeSplit<RStarTreeDescentHeuristic,
+      RAQueryStat<NearestNeighborSort>, arma::mat>, RStarTreeDescentHeuristic,
+      RAQueryStat<NearestNeighborSort>, arma::mat> TreeType;
+  typedef RASearch<NearestNeighborSort, metric::EuclideanDistance, TreeType>
+      RARTreeSearch;
+
+  TreeType refTree(refData, 20, 6, 5, 2, 0);
+  TreeType queryTree(queryData, 20, 6, 5, 2, 0);
+
+  // The relative ranks for the given query reference pair.
+  arma::Mat<size_t> qrRanks;
+  data::Load("rann_test_qr_ranks.csv", qrRanks, true, false); // No transpose.
+
+  // 1% of 900 is 9, so the rank is expected to be less than 10.
+  const size_t expectedRankErrorUB = 10;
+  const size_t numRounds = 30;
+
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    const bool singleMode = (mode == 0);
+    RARTreeSearch rann(&refTree, singleMode ? NULL : &queryTree, refData,
+        queryData, singleMode);
+
+    arma::Col<size_t> numSuccessRounds(queryData.n_cols);
+    numSuccessRounds.fill(0);
+
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    for (size_t rounds = 0; rounds < numRounds; rounds++)
+    {
+      rann.Search(1, neighbors, distances, 1.0, 0.95, false, false, 5);
+
+      for (size_t i = 0; i < queryData.n_cols; i++)
+        if (qrRanks(i, neighbors(0, i)) < expectedRankErrorUB)
+          numSuccessRounds[i]++;
+
+      rann.ResetQueryTree();
+    }
+
+    // Find the 95%-tile threshold so that 95% of the queries should pass this
+    // threshold.
+    const size_t threshold = floor(numRounds *
+        (0.95 - (1.96 * sqrt(0.95 * 0.05 / numRounds))));
+    size_t numQueriesFail = 0;
+    for (size_t i = 0; i < queryData.n_cols; i++)
+      if (numSuccessRounds[i] < threshold)
+        numQueriesFail++;
+
+    Log::Warn << "RANN (R*-tree, " << (singleMode ? "single" : "dual")
+        << "): RANN guarantee fails on " << numQueriesFail << " queries."
+        << endl;
+
+    // Assert that at most 5% of the queries fall out of this threshold.
+    BOOST_REQUIRE_LT(numQueriesFail, 6);
+  }
+}
+
+// Visitor for RASearch::Search() that checks that the chunks are given in order
+// and stores their results.
+class ChunkCollector
+{
+ public:
+  ChunkCollector(const size_t k, const size_t numQueries) :
+      neighbors(k, numQueries), distances(k, numQueries), nextQuery(0) { }
+
+  void operator()(const arma::Col<size_t>& queryIndices,
+                  const arma::Mat<size_t>& chunkNeighbors,
+                  const arma::mat& chunkDistances)
+  {
+    for (size_t i = 0; i < queryIndices.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(queryIndices[i], nextQuery++);
+      neighbors.col(queryIndices[i]) = chunkNeighbors.col(i);
+      distances.col(queryIndices[i]) = chunkDistances.col(i);
+    }
+  }
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  size_t nextQuery;
+};
+
+// Make sure that parallel single-tree and naive searches give the same results
+// with any number of threads when the seed is the same, and that chunked
+// searches give the same results as the parallel search with the same chunks.
+BOOST_AUTO_TEST_CASE(ParallelAndChunkedSearchTest)
+{
+  arma::mat refData;
+  arma::mat queryData;
+  refData.randu(3, 1000);
+  queryData.randu(3, 3000);
+
+  for (size_t naive = 0; naive < 2; ++naive)
+  {
+    RASearch<> search(refData, queryData, (naive == 1), true);
+
+    arma::Mat<size_t> neighbors2, neighbors3;
+    arma::mat distances2, distances3;
+
+    math::RandomSeed(12);
+    search.NumThreads() = 2;
+    search.Search(3, neighbors2, distances2, 5.0);
+    math::RandomSeed(12);
+    search.NumThreads() = 3;
+    search.Search(3, neighbors3, distances3, 5.0);
+
+    ChunkCollector collector(3, queryData.n_cols);
+    math::RandomSeed(12);
+    search.Search(3, collector, RASearch<>::QueryChunkSize, 5.0);
+    BOOST_REQUIRE_EQUAL(collector.nextQuery, queryData.n_cols);
+
+    for (size_t i = 0; i < neighbors2.n_elem; ++i)
+    {
+      BOOST_REQUIRE_LT(neighbors2[i], refData.n_cols);
+      BOOST_REQUIRE_EQUAL(neighbors2[i], neighbors3[i]);
+      BOOST_REQUIRE_EQUAL(neighbors2[i], collector.neighbors[i]);
+      BOOST_REQUIRE_CLOSE(distances2[i], distances3[i], 1e-10);
+      BOOST_REQUIRE_CLOSE(distances2[i], collector.distances[i], 1e-10);
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -61,5 +61,73 @@ BOOST_AUTO_TEST_CASE(GockenbachFunctionTest)
   BOOST_REQUIRE_CLOSE(coords[2], 0.015099932, 1e-3);
 }
 
+/**
+ * Make sure the augmented Lagrangian and its gradient, whose constraint terms
+ * are computed in parallel blocks, match a serial computation, with enough
+ * constraints for several blocks.
+ */
+BOOST_AUTO_TEST_CASE(ParallelConstraintTermsTest)
+{
+  // A random graph with 600 edges between 80 vertices.
+  arma::mat edges(2, 600);
+  for (size_t i = 0; i < edges.n_cols; ++i)
+  {
+    edges(0, i) = math::RandInt(80);
+    edges(1, i) = math::RandInt(80);
+  }
+  edges(0, 0) = 79;
+
+  LovaszThetaSDP f(edges);
+  arma::vec lambda(f.NumConstraints());
+  lambda.randu();
+  AugLagrangianFunction<LovaszThetaSDP> augfunc(f, lambda, 3.0);
+
+  arma::mat coordinates(5, 80);
+  coordinates.randu();
+
+  // Compute everything serially.
+  double objective = f.Evaluate(coordinates);
+  arma::mat gradient;
+  f.Gradient(coordinates, gradient);
+  arma::vec constraints(f.NumConstraints());
+  for (size_t i = 0; i < f.NumConstraints(); ++i)
+  {
+    constraints[i] = f.EvaluateConstraint(i, coordinates);
+    objective += -lambda[i] * constraints[i] +
+        1.5 * constraints[i] * constraints[i];
+
+    arma::mat constraintGradient;
+    f.GradientConstraint(i, coordinates, constraintGradient);
+    gradient += (-lambda[i] + 3.0 * constraints[i]) * constraintGradient;
+  }
+
+  for (size_t threads = 1; threads <= 4; threads += 3)
+  {
+    util::SetNumThreads(threads);
+
+    arma::vec parallelConstraints;
+    augfunc.EvaluateConstraints(coordinates, parallelConstraints);
+    BOOST_REQUIRE_EQUAL(parallelConstraints.n_elem, constraints.n_elem);
+    for (size_t i = 0; i < constraints.n_elem; ++i)
+      BOOST_REQUIRE_CLOSE(parallelConstraints[i], constraints[i], 1e-10);
+
+    BOOST_REQUIRE_CLOSE(augfunc.Evaluate(coordinates), objective, 1e-8);
+
+    arma::mat parallelGradient;
+    augfunc.Gradient(coordinates, parallelGradient);
+    BOOST_REQUIRE_EQUAL(parallelGradient.n_rows, gradient.n_rows);
+    BOOST_REQUIRE_EQUAL(parallelGradient.n_cols, gradient.n_cols);
+    for (size_t i = 0; i < gradient.n_elem; ++i)
+    {
+      if (std::abs(gradient[i]) < 1e-8)
+        BOOST_REQUIRE_SMALL(parallelGradient[i], 1e-8);
+      else
+        BOOST_REQUIRE_CLOSE(parallelGradient[i], gradient[i], 1e-8);
+    }
+  }
+
+  util::SetNumThreads(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 
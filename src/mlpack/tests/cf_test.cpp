@@ -7,6 +7,10 @@
 
 #include <mlpack/core.hpp>
 #include <mlpack/methods/cf/cf.hpp>
+#include <mlpack/methods/cf/neighbor_search_policies/cover_tree_search_policy.hpp>
+#include <mlpack/methods/cf/neighbor_search_policies/brute_force_search_policy.hpp>
+#include <mlpack/methods/cf/neighbor_search_policies/ra_search_policy.hpp>
+#include <mlpack/methods/cf/neighbor_search_policies/lsh_search_policy.hpp>
 #include <iostream>
 
 #include <boost/test/unit_test.hpp>
@@ -175,4 +179,194 @@ BOOST_AUTO_TEST_CASE(RecommendationAccuracyTest)
   BOOST_REQUIRE_LT(failures, 100);
 }
 
+/**
+ * The recommendations computed from the factors should be the same as those
+ * computed from the dense matrix of estimated ratings.
+ */
+BOOST_AUTO_TEST_CASE(FactoredRecommendationsTest)
+{
+  arma::mat dataset;
+  data::Load("GroupLens100k.csv", dataset);
+
+  CF<> c(dataset);
+
+  arma::Col<size_t> users(10);
+  for (size_t i = 0; i < users.n_elem; ++i)
+    users(i) = 10 * i;
+
+  const size_t numRecs = 10;
+  arma::Mat<size_t> recommendations;
+  c.GetRecommendations(numRecs, recommendations, users);
+  BOOST_REQUIRE_EQUAL(recommendations.n_rows, numRecs);
+  BOOST_REQUIRE_EQUAL(recommendations.n_cols, users.n_elem);
+
+  // Compute the recommendations by brute force from the dense ratings.
+  const arma::mat rating = c.W() * c.H();
+  for (size_t i = 0; i < users.n_elem; ++i)
+  {
+    arma::vec distances(rating.n_cols);
+    for (size_t u = 0; u < rating.n_cols; ++u)
+      distances[u] = arma::norm(rating.col(u) - rating.col(users(i)), 2);
+    const arma::uvec order = arma::sort_index(distances);
+
+    arma::vec average = arma::zeros<arma::vec>(rating.n_rows);
+    for (size_t j = 0; j < c.NumUsersForSimilarity(); ++j)
+      average += rating.col(order[j]);
+    average /= c.NumUsersForSimilarity();
+
+    // Rated items can't be recommended.
+    for (size_t j = 0; j < average.n_elem; ++j)
+      if (c.CleanedData()(j, users(i)) != 0.0)
+        average[j] = -DBL_MAX;
+
+    const arma::uvec best = arma::sort_index(average, 1);
+    for (size_t j = 0; j < numRecs; ++j)
+      BOOST_REQUIRE_EQUAL(recommendations(j, i), best[j]);
+  }
+}
+
+/**
+ * Fold in the ratings of a user which was not in the dataset, and make sure
+ * the user's latent vector fits those ratings.
+ */
+BOOST_AUTO_TEST_CASE(AddRatingsNewUserTest)
+{
+  arma::mat dataset;
+  data::Load("GroupLens100k.csv", dataset);
+
+  // Take out the ratings of the last user.
+  const size_t newUser = (size_t) arma::max(dataset.row(0));
+  arma::uvec oldRatings = arma::find(dataset.row(0) != newUser);
+  arma::uvec newRatings = arma::find(dataset.row(0) == newUser);
+  arma::mat oldData = dataset.cols(oldRatings);
+  const arma::mat newData = dataset.cols(newRatings);
+
+  CF<> c(oldData);
+  BOOST_REQUIRE_EQUAL(c.H().n_cols, newUser);
+
+  c.AddRatings(newData, 0.01, 5);
+  BOOST_REQUIRE_EQUAL(c.H().n_cols, newUser + 1);
+  BOOST_REQUIRE_EQUAL(c.CleanedData().n_cols, newUser + 1);
+  BOOST_REQUIRE_EQUAL(c.CleanedData().n_nonzero, dataset.n_cols);
+
+  // The estimated ratings of the new user's items should be reasonable.
+  double squaredError = 0.0;
+  for (size_t i = 0; i < newData.n_cols; ++i)
+  {
+    const size_t item = (size_t) newData(1, i);
+    BOOST_REQUIRE_EQUAL(c.CleanedData()(item, newUser), newData(2, i));
+    squaredError += std::pow(newData(2, i) - arma::as_scalar(c.W().row(item) *
+        c.H().col(newUser)), 2.0);
+  }
+  BOOST_REQUIRE_LT(std::sqrt(squaredError / newData.n_cols), 1.5);
+
+  // Recommendations for the new user should not include the items it rated.
+  arma::Col<size_t> users(1);
+  users[0] = newUser;
+  arma::Mat<size_t> recommendations;
+  c.GetRecommendations(10, recommendations, users);
+  for (size_t i = 0; i < recommendations.n_rows; ++i)
+    BOOST_REQUIRE_EQUAL(c.CleanedData()(recommendations(i, 0), newUser), 0.0);
+}
+
+/**
+ * The exact neighbor search policies should find the same neighborhoods, and
+ * the approximate ones should only return valid users.
+ */
+BOOST_AUTO_TEST_CASE(NeighborSearchPolicyTest)
+{
+  math::RandomSeed(0);
+  const arma::mat latent = arma::randu<arma::mat>(4, 500);
+  const arma::mat query = latent.cols(0, 99);
+
+  arma::Mat<size_t> kdNeighbors, coverNeighbors, bruteNeighbors;
+  arma::mat kdDistances, coverDistances, bruteDistances;
+  KDTreeSearchPolicy().Search(latent, query, 5, kdNeighbors, kdDistances);
+  CoverTreeSearchPolicy().Search(latent, query, 5, coverNeighbors,
+      coverDistances);
+  BruteForceSearchPolicy().Search(latent, query, 5, bruteNeighbors,
+      bruteDistances);
+
+  BOOST_REQUIRE_EQUAL(kdNeighbors.n_rows, 5);
+  BOOST_REQUIRE_EQUAL(kdNeighbors.n_cols, 100);
+  for (size_t i = 0; i < kdNeighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(kdNeighbors[i], bruteNeighbors[i]);
+    BOOST_REQUIRE_EQUAL(coverNeighbors[i], bruteNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(kdDistances[i], bruteDistances[i], 1e-5);
+  }
+
+  // Each user is its own nearest neighbor.
+  for (size_t i = 0; i < query.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(bruteNeighbors(0, i), i);
+
+  arma::Mat<size_t> raNeighbors, lshNeighbors;
+  arma::mat raDistances, lshDistances;
+  RASearchPolicy(10, 0.95).Search(latent, query, 5, raNeighbors,
+      raDistances);
+  LSHSearchPolicy(4, 10).Search(latent, query, 5, lshNeighbors, lshDistances);
+
+  BOOST_REQUIRE_EQUAL(raNeighbors.n_cols, 100);
+  BOOST_REQUIRE_EQUAL(lshNeighbors.n_cols, 100);
+  for (size_t i = 0; i < raNeighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_LT(raNeighbors[i], latent.n_cols);
+    BOOST_REQUIRE_LE(lshNeighbors[i], latent.n_cols);
+  }
+}
+
+/**
+ * CF with an approximate neighbor search policy should still generate valid
+ * recommendations for every user.
+ */
+BOOST_AUTO_TEST_CASE(CFLSHSearchPolicyTest)
+{
+  arma::mat dataset;
+  data::Load("GroupLens100k.csv", dataset);
+
+  CF<amf::NMFALSFactorizer, LSHSearchPolicy> c(dataset,
+      amf::NMFALSFactorizer(), 5, 0, LSHSearchPolicy(5, 10));
+  BOOST_REQUIRE_EQUAL(c.SearchPolicy().NumTables(), 10);
+
+  arma::Mat<size_t> recommendations;
+  c.GetRecommendations(3, recommendations);
+
+  BOOST_REQUIRE_EQUAL(recommendations.n_rows, 3);
+  BOOST_REQUIRE_EQUAL(recommendations.n_cols, 943);
+  for (size_t i = 0; i < recommendations.n_elem; ++i)
+    BOOST_REQUIRE_LT(recommendations[i], c.W().n_rows);
+}
+
+/**
+ * CF built from the sparse rating matrix loaded by data::Load() should be the
+ * same as CF built from the dense (user, item, rating) table.
+ */
+BOOST_AUTO_TEST_CASE(CFSparseRatingMatrixTest)
+{
+  arma::mat dataset;
+  data::Load("GroupLens100k.csv", dataset);
+  arma::sp_mat ratings;
+  data::Load("GroupLens100k.csv", ratings);
+
+  math::RandomSeed(10);
+  CF<> dense(dataset, amf::NMFALSFactorizer(), 5, 10);
+  math::RandomSeed(10);
+  CF<> sparse(ratings, amf::NMFALSFactorizer(), 5, 10);
+
+  BOOST_REQUIRE_EQUAL(sparse.CleanedData().n_rows,
+      dense.CleanedData().n_rows);
+  BOOST_REQUIRE_EQUAL(sparse.CleanedData().n_cols,
+      dense.CleanedData().n_cols);
+  BOOST_REQUIRE_EQUAL(sparse.CleanedData().n_nonzero,
+      dense.CleanedData().n_nonzero);
+  for (arma::sp_mat::const_iterator it = dense.CleanedData().begin();
+       it != dense.CleanedData().end(); ++it)
+    BOOST_REQUIRE_EQUAL((double) sparse.CleanedData()(it.row(), it.col()),
+        (double) *it);
+
+  BOOST_REQUIRE_EQUAL(sparse.W().n_elem, dense.W().n_elem);
+  for (size_t i = 0; i < dense.W().n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(sparse.W()[i], dense.W()[i], 1e-5);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -5,6 +5,9 @@
  * Test for the CLI input parameter system.
  */
 
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #ifndef _WIN32
@@ -17,6 +20,7 @@
 #endif
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/util/server.hpp>
 
 #define DEFAULT_INT 42
 
@@ -221,6 +225,98 @@ BOOST_AUTO_TEST_CASE(TestPrefixedOutStreamModifiers)
       "I have a precise number which is 000156");
 }
 
+/**
+ * Lines written from several threads at once must not be mixed, even if each
+ * thread writes them in pieces.
+ */
+BOOST_AUTO_TEST_CASE(TestPrefixedOutStreamThreads)
+{
+  std::stringstream ss;
+  PrefixedOutStream pss(ss, "[INFO ] ");
+
+  #pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < 1000; ++i)
+  {
+    pss << "line " << i;
+    pss << " of " << 1000 << std::endl;
+  }
+
+  std::vector<bool> found(1000, false);
+  std::string line;
+  while (std::getline(ss, line))
+  {
+    int i;
+    BOOST_REQUIRE_EQUAL(sscanf(line.c_str(), "[INFO ] line %d of 1000", &i),
+        1);
+    BOOST_REQUIRE(i >= 0 && i < 1000);
+    BOOST_REQUIRE_EQUAL(found[i], false);
+    found[i] = true;
+  }
+
+  for (size_t i = 0; i < found.size(); ++i)
+    BOOST_REQUIRE_EQUAL(found[i], true);
+}
+
+/**
+ * With the background thread, everything must still be written, in order.
+ */
+BOOST_AUTO_TEST_CASE(TestPrefixedOutStreamAsynchronous)
+{
+  std::stringstream ss;
+  PrefixedOutStream pss(ss, "[INFO ] ");
+
+  const bool started = PrefixedOutStream::StartAsynchronousOutput();
+  pss << "first ";
+  pss << "line" << std::endl;
+  pss << "second line" << std::endl;
+  PrefixedOutStream::Flush();
+  PrefixedOutStream::StopAsynchronousOutput();
+
+  BOOST_REQUIRE_EQUAL(ss.str(), "[INFO ] first line\n[INFO ] second line\n");
+
+  // Only Windows has no background thread.
+#ifndef _WIN32
+  BOOST_REQUIRE_EQUAL(started, true);
+#else
+  BOOST_REQUIRE_EQUAL(started, false);
+#endif
+}
+
+/**
+ * An object which counts how many times it was converted to a string.
+ */
+class CountingObject
+{
+ public:
+  CountingObject() : calls(0) { }
+
+  std::string ToString() const { ++calls; return "counted"; }
+
+  mutable size_t calls;
+};
+
+/**
+ * Nothing should be formatted for a stream which ignores its input.
+ */
+BOOST_AUTO_TEST_CASE(TestPrefixedOutStreamIgnored)
+{
+  std::stringstream ss;
+  PrefixedOutStream pss(ss, "[INFO ] ", true);
+
+  CountingObject object;
+  pss << "object " << object << " and number " << 3.0 << std::endl;
+
+  BOOST_REQUIRE_EQUAL(object.calls, 0);
+  BOOST_REQUIRE_EQUAL(ss.str(), "");
+
+  // Once the stream is enabled, the object is formatted.
+  pss.ignoreInput = false;
+  pss << object << std::endl;
+
+  BOOST_REQUIRE_EQUAL(object.calls, 1);
+  BOOST_REQUIRE_EQUAL(ss.str(), "[INFO ] counted\n");
+}
+
 /**
  * We should be able to start and then stop a timer multiple times and it should
  * save the value.
@@ -269,4 +365,484 @@ BOOST_AUTO_TEST_CASE(MultiRunTimerTest)
   BOOST_REQUIRE_GE(Timer::Get("test_timer").tv_usec, 40000);
 }
 
+/**
+ * A scoped timer must count each outermost scope once, from every thread, and
+ * registering the same name twice must give the same handle.
+ */
+BOOST_AUTO_TEST_CASE(ScopedTimerTest)
+{
+  const size_t handle = ScopedTimer::Register("test_scoped_timer");
+  BOOST_REQUIRE_EQUAL(ScopedTimer::Register("test_scoped_timer"), handle);
+  BOOST_REQUIRE_EQUAL(ScopedTimer::Name(handle), "test_scoped_timer");
+  ScopedTimer::Reset(handle);
+
+  {
+    ScopedTimer outer(handle);
+    {
+      // Nested scopes of the same timer are not counted again.
+      ScopedTimer inner(handle);
+
+      #ifdef _WIN32
+      Sleep(10);
+      #else
+      usleep(10000);
+      #endif
+    }
+  }
+
+  TimerStatistics statistics = ScopedTimer::Statistics(handle);
+  BOOST_REQUIRE_EQUAL(statistics.count, 1);
+  BOOST_REQUIRE_GE(statistics.total, 0.01);
+  BOOST_REQUIRE_CLOSE(statistics.min, statistics.total, 1e-5);
+  BOOST_REQUIRE_CLOSE(statistics.max, statistics.total, 1e-5);
+
+  ScopedTimer::Reset(handle);
+
+  // Time many short scopes in parallel.
+  #pragma omp parallel for
+  for (int i = 0; i < 1000; ++i)
+  {
+    ScopedTimer t(handle);
+  }
+
+  statistics = ScopedTimer::Statistics(handle);
+  BOOST_REQUIRE_EQUAL(statistics.count, 1000);
+  BOOST_REQUIRE_LE(statistics.min, statistics.Mean());
+  BOOST_REQUIRE_LE(statistics.Mean(), statistics.max);
+}
+
+/**
+ * A handler for the server tests, which answers 'sum' requests with the sum of
+ * each point, multiplied by the 'scale' option.
+ */
+class SumHandler
+{
+ public:
+  bool Handle(const ServerRequest& request, ServerResponse& response)
+  {
+    if (request.command != "sum")
+    {
+      response.error = "unknown command";
+      return false;
+    }
+
+    double scale = 1.0;
+    if (!request.GetOption("scale", scale))
+    {
+      response.error = "invalid scale";
+      return false;
+    }
+
+    response.data = scale * arma::sum(request.data, 0);
+    return true;
+  }
+};
+
+/**
+ * Make sure requests are parsed, with their options and points, and that
+ * malformed requests are reported without losing track of the next request.
+ */
+BOOST_AUTO_TEST_CASE(ServerReadRequestTest)
+{
+  std::istringstream input("\n# comment\nsum 2 scale=2\n1,2,3\n4 5 6\n"
+      "sum 2\n1,2\n3\nping\n");
+
+  ServerRequest request;
+  std::string error;
+  BOOST_REQUIRE(ReadRequest(input, request, error));
+  BOOST_REQUIRE_EQUAL(error, "");
+  BOOST_REQUIRE_EQUAL(request.command, "sum");
+  BOOST_REQUIRE_EQUAL(request.data.n_rows, 3);
+  BOOST_REQUIRE_EQUAL(request.data.n_cols, 2);
+  BOOST_REQUIRE_CLOSE(request.data(2, 0), 3.0, 1e-5);
+  BOOST_REQUIRE_CLOSE(request.data(0, 1), 4.0, 1e-5);
+
+  double scale = 1.0;
+  BOOST_REQUIRE(request.GetOption("scale", scale));
+  BOOST_REQUIRE_CLOSE(scale, 2.0, 1e-5);
+  size_t missing = 7;
+  BOOST_REQUIRE(request.GetOption("missing", missing));
+  BOOST_REQUIRE_EQUAL(missing, 7);
+
+  // The points have different dimensionalities.
+  BOOST_REQUIRE(ReadRequest(input, request, error));
+  BOOST_REQUIRE_NE(error, "");
+
+  BOOST_REQUIRE(ReadRequest(input, request, error));
+  BOOST_REQUIRE_EQUAL(error, "");
+  BOOST_REQUIRE_EQUAL(request.command, "ping");
+  BOOST_REQUIRE_EQUAL(request.data.n_cols, 0);
+
+  BOOST_REQUIRE(!ReadRequest(input, request, error));
+}
+
+/**
+ * Make sure the server answers requests with the handler, reports errors, and
+ * stops at 'quit'.
+ */
+BOOST_AUTO_TEST_CASE(ServerServeTest)
+{
+  std::istringstream input("sum 2 scale=2\n1,2\n3,4\nsum 1 scale=x\n1\n"
+      "unknown\nping\nquit\nsum 1\n1\n");
+  std::ostringstream output;
+
+  SumHandler handler;
+  Server<SumHandler> server(handler);
+  BOOST_REQUIRE(!server.Serve(input, output));
+  BOOST_REQUIRE_EQUAL(server.Requests(), 4);
+  BOOST_REQUIRE_EQUAL(output.str(), "OK 2\n6\n14\nERROR invalid scale\n"
+      "ERROR unknown command\nOK 0\nOK 0\n");
+
+  std::istringstream shutdownInput("shutdown\n");
+  BOOST_REQUIRE(server.Serve(shutdownInput, output));
+}
+
+//! Square each element of a vector, for ParallelForTest.
+class SquareElements
+{
+ public:
+  SquareElements(arma::vec& values) : values(values) { }
+  void operator()(const size_t i) { values[i] *= values[i]; }
+
+ private:
+  arma::vec& values;
+};
+
+/**
+ * Make sure ParallelFor() calls the function once for each index, with any
+ * number of threads.
+ */
+BOOST_AUTO_TEST_CASE(ParallelForTest)
+{
+  for (size_t threads = 0; threads < 4; ++threads)
+  {
+    arma::vec values = arma::linspace<arma::vec>(0, 999, 1000);
+    SquareElements square(values);
+    ParallelFor(0, values.n_elem, square, threads);
+
+    for (size_t i = 0; i < values.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(values[i], double(i * i));
+  }
+
+  // An empty range does nothing.
+  arma::vec values;
+  SquareElements square(values);
+  ParallelFor(5, 5, square);
+}
+
+//! Add the square of an index to a partial sum, for ParallelReduceTest.
+class SumSquares
+{
+ public:
+  void operator()(const size_t i, size_t& sum) { sum += i * i; }
+};
+
+/**
+ * Make sure ParallelReduce() combines the results of all indices.
+ */
+BOOST_AUTO_TEST_CASE(ParallelReduceTest)
+{
+  SumSquares sumSquares;
+  for (size_t threads = 0; threads < 4; ++threads)
+  {
+    BOOST_REQUIRE_EQUAL(ParallelReduce(0, 1000, sumSquares, size_t(0),
+        threads), size_t(999 * 1000 * 1999 / 6));
+    BOOST_REQUIRE_EQUAL(ParallelReduce(10, 10, sumSquares, size_t(3),
+        threads), size_t(3));
+  }
+}
+
+//! Run a parallel loop inside a parallel loop, recording how many threads the
+//! inner loop was allowed, for NestedParallelForTest.
+class NestedLoop
+{
+ public:
+  NestedLoop(arma::mat& values, arma::Col<size_t>& innerThreads) :
+      values(values), innerThreads(innerThreads) { }
+
+  void operator()(const size_t i)
+  {
+    innerThreads[i] = NumThreads();
+
+    arma::vec column(values.colptr(i), values.n_rows, false, true);
+    SquareElements square(column);
+    ParallelFor(0, column.n_elem, square, 4);
+  }
+
+ private:
+  arma::mat& values;
+  arma::Col<size_t>& innerThreads;
+};
+
+/**
+ * A parallel loop inside a parallel loop must run serially in the thread of the
+ * outer loop, and still give the right results.
+ */
+BOOST_AUTO_TEST_CASE(NestedParallelForTest)
+{
+  arma::mat values(20, 50);
+  for (size_t i = 0; i < values.n_elem; ++i)
+    values[i] = i;
+  arma::Col<size_t> innerThreads(values.n_cols);
+
+  NestedLoop loop(values, innerThreads);
+  ParallelFor(0, values.n_cols, loop, 4);
+
+  for (size_t i = 0; i < values.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(values[i], double(i * i));
+  for (size_t i = 0; i < innerThreads.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(innerThreads[i], 1);
+}
+
+//! Sum a range of a vector recursively with tasks, for TaskGroupTest.
+class RecursiveSum
+{
+ public:
+  RecursiveSum(const arma::vec& values,
+               const size_t begin,
+               const size_t end,
+               double& sum) :
+      values(&values), begin(begin), end(end), sum(&sum) { }
+
+  void operator()()
+  {
+    if (end - begin <= 16)
+    {
+      *sum = arma::accu(values->subvec(begin, end - 1));
+      return;
+    }
+
+    const size_t middle = (begin + end) / 2;
+    double leftSum, rightSum;
+    TaskGroup group;
+    group.Run(RecursiveSum(*values, begin, middle, leftSum));
+    RecursiveSum(*values, middle, end, rightSum)();
+    group.Wait();
+
+    *sum = leftSum + rightSum;
+  }
+
+ private:
+  const arma::vec* values;
+  size_t begin;
+  size_t end;
+  double* sum;
+};
+
+/**
+ * Make sure that the tasks started by a TaskGroup have all finished after
+ * Wait(), with and without a team of threads.
+ */
+BOOST_AUTO_TEST_CASE(TaskGroupTest)
+{
+  arma::vec values = arma::linspace<arma::vec>(1, 10000, 10000);
+
+  for (size_t threads = 1; threads <= 4; threads += 3)
+  {
+    double sum = 0.0;
+    RecursiveSum task(values, 0, values.n_elem, sum);
+    RunTasks(task, threads);
+    BOOST_REQUIRE_CLOSE(sum, 10000.0 * 10001.0 / 2.0, 1e-10);
+  }
+
+  // Without RunTasks(), the tasks run immediately.
+  double sum = 0.0;
+  RecursiveSum(values, 0, values.n_elem, sum)();
+  BOOST_REQUIRE_CLOSE(sum, 10000.0 * 10001.0 / 2.0, 1e-10);
+}
+
+/**
+ * Make sure the number of threads can be set, and that 0 restores the default.
+ */
+BOOST_AUTO_TEST_CASE(SetNumThreadsTest)
+{
+  const size_t defaultThreads = NumThreads();
+  BOOST_REQUIRE_GE(defaultThreads, 1);
+
+#ifdef _OPENMP
+  BOOST_REQUIRE_EQUAL(NumThreads(3), 3);
+  SetNumThreads(2);
+  BOOST_REQUIRE_EQUAL(NumThreads(), 2);
+  BOOST_REQUIRE_EQUAL(NumThreads(5), 5);
+#endif
+
+  SetNumThreads(0);
+  BOOST_REQUIRE_EQUAL(NumThreads(), defaultThreads);
+}
+
+/**
+ * Make sure FirstTouchCopy() copies a matrix, with one thread and several.
+ */
+BOOST_AUTO_TEST_CASE(FirstTouchCopyTest)
+{
+  arma::mat source;
+  source.randu(7, 1000);
+
+  for (size_t threads = 1; threads <= 4; threads += 3)
+  {
+    arma::mat dest;
+    FirstTouchCopy(source, dest, threads);
+
+    BOOST_REQUIRE_EQUAL(dest.n_rows, source.n_rows);
+    BOOST_REQUIRE_EQUAL(dest.n_cols, source.n_cols);
+    for (size_t i = 0; i < source.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(dest[i], source[i]);
+  }
+}
+
+//! Makes a copy of a vector, counting the copies.
+struct CopyVector
+{
+  CopyVector(const arma::vec& vector) : vector(vector), copies(0) { }
+
+  arma::vec* operator()()
+  {
+    #pragma omp atomic
+    ++copies;
+    return new arma::vec(vector);
+  }
+
+  const arma::vec& vector;
+  size_t copies;
+};
+
+/**
+ * Make sure NodeReplicas makes at most one copy per node, and that the threads
+ * of a single-node machine find the copy.
+ */
+BOOST_AUTO_TEST_CASE(NodeReplicasTest)
+{
+  BOOST_REQUIRE_GE(NumNodes(), 1);
+  BOOST_REQUIRE_LT(CurrentNode(), NumNodes());
+
+  arma::vec vector = arma::linspace<arma::vec>(1, 100, 100);
+  CopyVector factory(vector);
+
+  NodeReplicas<arma::vec> replicas;
+  BOOST_REQUIRE(replicas.Empty());
+  BOOST_REQUIRE(replicas.Local() == NULL);
+
+  replicas.Build(factory, 4);
+  BOOST_REQUIRE(!replicas.Empty());
+  BOOST_REQUIRE_GE(factory.copies, 1);
+  BOOST_REQUIRE_LE(factory.copies, NumNodes());
+
+  if (NumNodes() == 1)
+  {
+    BOOST_REQUIRE(replicas.Local() != NULL);
+    BOOST_REQUIRE_EQUAL(replicas.Local()->n_elem, 100);
+    BOOST_REQUIRE_EQUAL((*replicas.Local())[99], 100.0);
+  }
+
+  replicas.Clear();
+  BOOST_REQUIRE(replicas.Empty());
+}
+
+/**
+ * Make sure huge pages are only used when they are enabled, and that memory
+ * allocated with them can be used.
+ */
+BOOST_AUTO_TEST_CASE(HugePagesTest)
+{
+  const size_t size = 3 * HugePageSize() + 100;
+  BOOST_REQUIRE(!HugePages());
+  BOOST_REQUIRE(AllocateHugePages(size) == NULL);
+
+  SetHugePages(true);
+  BOOST_REQUIRE(HugePages());
+
+  // A buffer smaller than a huge page can't use them.
+  double small[10];
+  BOOST_REQUIRE(!AdviseHugePages(small, sizeof(small)));
+
+  // Huge pages may not be available, in which case NULL is returned.
+  char* memory = (char*) AllocateHugePages(size);
+  if (memory != NULL)
+  {
+    memset(memory, 1, size);
+    BOOST_REQUIRE_EQUAL(memory[size - 1], 1);
+    FreeHugePages(memory, size);
+  }
+
+  SetHugePages(false);
+
+#ifdef __linux__
+  BOOST_REQUIRE_GT(PeakMemory(), 0);
+#endif
+}
+
+/**
+ * Make sure the memory accounts track the current and peak usage, and that a
+ * ScopedMemory object frees its bytes.
+ */
+BOOST_AUTO_TEST_CASE(MemoryUsageTest)
+{
+  const size_t handle = MemoryUsage::Register("memory_usage_test");
+  BOOST_REQUIRE_EQUAL(MemoryUsage::Register("memory_usage_test"), handle);
+  BOOST_REQUIRE_EQUAL(MemoryUsage::Name(handle), "memory_usage_test");
+  BOOST_REQUIRE_LT(handle, MemoryUsage::NumAccounts());
+
+  const size_t current = MemoryUsage::Current();
+  MemoryUsage::Allocate(handle, 1000);
+  {
+    ScopedMemory memory(handle, 500);
+    BOOST_REQUIRE_EQUAL(MemoryUsage::Statistics(handle).current, 1500);
+    BOOST_REQUIRE_EQUAL(MemoryUsage::Current(), current + 1500);
+  }
+  MemoryUsage::Free(handle, 1000);
+
+  const MemoryStatistics statistics = MemoryUsage::Statistics(handle);
+  BOOST_REQUIRE_EQUAL(statistics.current, 0);
+  BOOST_REQUIRE_EQUAL(statistics.peak, 1500);
+  BOOST_REQUIRE_EQUAL(statistics.total, 1500);
+  BOOST_REQUIRE_EQUAL(statistics.count, 2);
+  BOOST_REQUIRE_EQUAL(MemoryUsage::Current(), current);
+  BOOST_REQUIRE_GE(MemoryUsage::Peak(), current + 1500);
+
+  // Resetting the peaks forgets the bytes that were freed.
+  MemoryUsage::ResetPeak();
+  BOOST_REQUIRE_EQUAL(MemoryUsage::Statistics(handle).peak, 0);
+  BOOST_REQUIRE_EQUAL(MemoryUsage::Peak(), MemoryUsage::Current());
+
+  BOOST_REQUIRE_EQUAL(MemoryUsage::Format(100), "100 B");
+  BOOST_REQUIRE_EQUAL(MemoryUsage::Format(3 * 1024 * 1024 / 2), "1.5 MB");
+}
+
+/**
+ * Make sure a trace records the regions of each thread, and is written in the
+ * Chrome trace format.
+ */
+BOOST_AUTO_TEST_CASE(TraceTest)
+{
+  BOOST_REQUIRE(!Trace::Enabled());
+  BOOST_REQUIRE(Trace::Open("trace_test.json"));
+  BOOST_REQUIRE(Trace::Enabled());
+
+  // A region that ends without starting is ignored.
+  Trace::End("never_started");
+
+  Trace::Begin("trace_test");
+  #pragma omp parallel num_threads(2)
+  {
+    TraceScope scope("trace_test_thread");
+  }
+  Trace::End("trace_test");
+
+  Trace::Close();
+  BOOST_REQUIRE(!Trace::Enabled());
+
+  std::ifstream stream("trace_test.json");
+  std::stringstream contents;
+  contents << stream.rdbuf();
+  const std::string trace = contents.str();
+  remove("trace_test.json");
+
+  BOOST_REQUIRE_EQUAL(trace.find("{\"displayTimeUnit\""), 0);
+  BOOST_REQUIRE(trace.find("\"name\":\"trace_test\",\"ph\":\"X\"") !=
+      std::string::npos);
+  BOOST_REQUIRE(trace.find("\"name\":\"trace_test_thread\"") !=
+      std::string::npos);
+  BOOST_REQUIRE(trace.find("never_started") == std::string::npos);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
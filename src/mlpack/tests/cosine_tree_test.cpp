@@ -177,4 +177,33 @@ BOOST_AUTO_TEST_CASE(CosineTreeModifiedGramSchmidt)
   }
 }
 
+/**
+ * Checks that the basis of a cosine tree built on a dataset large enough for
+ * the work on the nodes to be done in parallel is orthonormal.
+ */
+BOOST_AUTO_TEST_CASE(CosineTreeParallelBasisOrthonormal)
+{
+  // Make a random dataset with more columns than CosineTree handles serially.
+  arma::mat data = arma::randu(20, 25000);
+
+  CosineTree ctree(data, 0.3, 0.1);
+  arma::mat basis;
+  ctree.GetFinalBasis(basis);
+
+  BOOST_REQUIRE_GT(basis.n_cols, 1);
+  BOOST_REQUIRE_EQUAL(basis.n_rows, data.n_rows);
+
+  const arma::mat gram = trans(basis) * basis;
+  for (size_t i = 0; i < gram.n_rows; i++)
+  {
+    for (size_t j = 0; j < gram.n_cols; j++)
+    {
+      if (i == j)
+        BOOST_REQUIRE_CLOSE(gram(i, j), 1.0, 1e-5);
+      else
+        BOOST_REQUIRE_SMALL(gram(i, j), 1e-5);
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
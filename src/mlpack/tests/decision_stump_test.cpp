@@ -307,4 +307,91 @@ BOOST_AUTO_TEST_CASE(DimensionSelectionTest)
   }
 }
 
+/**
+ * Make sure a weighted stump trained from another stump gives the same result
+ * whether the sorted orders of the other stump can be reused or not.
+ */
+BOOST_AUTO_TEST_CASE(WeightedStumpSortedOrderReuse)
+{
+  const size_t numClasses = 3;
+  const size_t inpBucketSize = 4;
+
+  arma::mat dataset;
+  dataset.randu(4, 300);
+  // Add some ties.
+  dataset.row(2) = arma::floor(10 * dataset.row(2));
+
+  arma::Row<size_t> labels(dataset.n_cols);
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    labels[i] = (size_t) (3 * dataset(1, i)) % numClasses;
+
+  arma::rowvec weights;
+  weights.randu(dataset.n_cols);
+  weights /= arma::accu(weights);
+
+  DecisionStump<> ds(dataset, labels, numClasses, inpBucketSize);
+  BOOST_REQUIRE_EQUAL(ds.SortedIndices().n_rows, dataset.n_cols);
+  BOOST_REQUIRE_EQUAL(ds.SortedIndices().n_cols, dataset.n_rows);
+
+  // This stump reuses the sorted orders of ds.
+  DecisionStump<> reused(ds, dataset, weights, labels);
+
+  // The sorted orders of this stump are not those of the dataset, so they must
+  // not be reused.
+  arma::mat otherDataset(dataset);
+  otherDataset.row(1) = -otherDataset.row(1);
+  DecisionStump<> other(otherDataset, labels, numClasses, inpBucketSize);
+  DecisionStump<> sorted(other, dataset, weights, labels);
+
+  BOOST_REQUIRE_EQUAL(reused.SplitAttribute(), sorted.SplitAttribute());
+  BOOST_REQUIRE_EQUAL(reused.Split().n_elem, sorted.Split().n_elem);
+  for (size_t i = 0; i < reused.Split().n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(reused.Split()[i], sorted.Split()[i]);
+    BOOST_REQUIRE_EQUAL(reused.BinLabels()[i], sorted.BinLabels()[i]);
+  }
+}
+
+/**
+ * Train a stump with bins on a dataset where one attribute with few values
+ * separates the classes, and make sure it is chosen and that the stumps
+ * trained from it with weights use the same bins.
+ */
+BOOST_AUTO_TEST_CASE(HistogramStump)
+{
+  const size_t numClasses = 2;
+  const size_t inpBucketSize = 5;
+
+  arma::mat dataset;
+  dataset.randu(3, 200);
+  arma::Row<size_t> labels(dataset.n_cols);
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+  {
+    dataset(1, i) = (double) (i % 10);
+    labels[i] = (i % 10 < 5) ? 0 : 1;
+  }
+
+  DecisionStump<> ds(dataset, labels, numClasses, inpBucketSize, 32);
+  BOOST_REQUIRE_EQUAL(ds.Quantizer().Dimensionality(), dataset.n_rows);
+  BOOST_REQUIRE_EQUAL(ds.SortedIndices().n_elem, 0);
+  BOOST_REQUIRE_EQUAL(ds.SplitAttribute(), 1);
+
+  arma::Row<size_t> predictedLabels(dataset.n_cols);
+  ds.Classify(dataset, predictedLabels);
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(predictedLabels[i], labels[i]);
+
+  arma::rowvec weights;
+  weights.randu(dataset.n_cols);
+  weights /= arma::accu(weights);
+
+  DecisionStump<> weighted(ds, dataset, weights, labels);
+  BOOST_REQUIRE_EQUAL(weighted.Quantizer().Dimensionality(), dataset.n_rows);
+  BOOST_REQUIRE_EQUAL(weighted.SplitAttribute(), 1);
+
+  weighted.Classify(dataset, predictedLabels);
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(predictedLabels[i], labels[i]);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
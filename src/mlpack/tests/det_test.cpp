@@ -18,6 +18,7 @@
 
 #include <mlpack/methods/det/dtree.hpp>
 #include <mlpack/methods/det/dt_utils.hpp>
+#include <mlpack/methods/det/dtree_scorer.hpp>
 
 #ifndef _WIN32
   #undef protected
@@ -310,6 +311,173 @@ BOOST_AUTO_TEST_CASE(TestVariableImportance)
   BOOST_REQUIRE_CLOSE((double) (rootError - (lError + rError)), imps[2], 1e-10);
 }
 
+#ifndef _WIN32
+// Check that the split of each node of the tree is the split that FindSplit()
+// finds by sorting the points of the node, and that the points are on the
+// right side of the splits.
+void CheckSplits(const DTree* node,
+                 const arma::mat& data,
+                 const size_t minLeafSize)
+{
+  if (node->Left() == NULL)
+    return;
+
+  size_t dim;
+  double splitValue, leftError, rightError;
+  BOOST_REQUIRE(node->FindSplit(data, dim, splitValue, leftError, rightError,
+      minLeafSize));
+  BOOST_REQUIRE_EQUAL(dim, node->SplitDim());
+  BOOST_REQUIRE_EQUAL(splitValue, node->SplitValue());
+
+  for (size_t i = node->Left()->Start(); i < node->Left()->End(); ++i)
+    BOOST_REQUIRE_LE(data(dim, i), splitValue);
+  for (size_t i = node->Right()->Start(); i < node->Right()->End(); ++i)
+    BOOST_REQUIRE_GT(data(dim, i), splitValue);
+
+  CheckSplits(node->Left(), data, minLeafSize);
+  CheckSplits(node->Right(), data, minLeafSize);
+}
+
+/**
+ * Grow a tree on a dataset large enough for the nodes to be split in parallel,
+ * and make sure the sorted orders kept during the growth give the same splits
+ * as sorting the points of each node.
+ */
+BOOST_AUTO_TEST_CASE(TestGrowSortedSplits)
+{
+  arma::mat data;
+  data.randn(3, 25000);
+  const arma::mat originalData = data;
+
+  arma::Col<size_t> oldFromNew(data.n_cols);
+  for (size_t i = 0; i < oldFromNew.n_elem; ++i)
+    oldFromNew[i] = i;
+
+  DTree tree(data);
+  tree.Grow(data, oldFromNew, false, 1000, 100);
+
+  BOOST_REQUIRE_GT(tree.SubtreeLeaves(), 1);
+
+  // The points must only have been reordered.
+  for (size_t i = 0; i < data.n_cols; ++i)
+    for (size_t d = 0; d < data.n_rows; ++d)
+      BOOST_REQUIRE_EQUAL(data(d, i), originalData(d, oldFromNew[i]));
+
+  CheckSplits(&tree, data, 100);
+}
+
+// Check that the split of each node of the tree is one of the bin edges, that
+// the points are on the right side of the splits, and that no leaf is too
+// small.
+void CheckHistogramSplits(const DTree* node,
+                          const arma::mat& data,
+                          const math::QuantileBins& quantizer,
+                          const size_t minLeafSize)
+{
+  BOOST_REQUIRE_GE(node->End() - node->Start(), minLeafSize);
+  if (node->Left() == NULL)
+    return;
+
+  const size_t dim = node->SplitDim();
+  const double splitValue = node->SplitValue();
+  const arma::vec& edges = quantizer.Edges(dim);
+  BOOST_REQUIRE(std::find(edges.begin(), edges.end(), splitValue) !=
+      edges.end());
+
+  for (size_t i = node->Left()->Start(); i < node->Left()->End(); ++i)
+    BOOST_REQUIRE_LE(data(dim, i), splitValue);
+  for (size_t i = node->Right()->Start(); i < node->Right()->End(); ++i)
+    BOOST_REQUIRE_GT(data(dim, i), splitValue);
+
+  CheckHistogramSplits(node->Left(), data, quantizer, minLeafSize);
+  CheckHistogramSplits(node->Right(), data, quantizer, minLeafSize);
+}
+
+/**
+ * Grow a tree with histogram splits, and make sure the splits are on the bin
+ * edges, and that the histograms obtained by subtraction count the points of
+ * each node correctly (so that no leaf is smaller than the minimum size).
+ */
+BOOST_AUTO_TEST_CASE(TestGrowHistogramSplits)
+{
+  arma::mat data;
+  data.randn(3, 25000);
+  const arma::mat originalData = data;
+
+  arma::Col<size_t> oldFromNew(data.n_cols);
+  for (size_t i = 0; i < oldFromNew.n_elem; ++i)
+    oldFromNew[i] = i;
+
+  DTree tree(data);
+  tree.Grow(data, oldFromNew, false, 1000, 100, 64);
+
+  BOOST_REQUIRE_GT(tree.SubtreeLeaves(), 1);
+
+  // The points must only have been reordered.
+  for (size_t i = 0; i < data.n_cols; ++i)
+    for (size_t d = 0; d < data.n_rows; ++d)
+      BOOST_REQUIRE_EQUAL(data(d, i), originalData(d, oldFromNew[i]));
+
+  const math::QuantileBins quantizer(originalData, 64);
+  CheckHistogramSplits(&tree, data, quantizer, 100);
+}
+#endif
+
+/**
+ * Make sure the compiled tree gives the same densities and tags as the tree,
+ * for points inside and outside of the bounding box of the tree.
+ */
+BOOST_AUTO_TEST_CASE(TestDTreeScorer)
+{
+  arma::mat data;
+  data.randn(3, 2000);
+
+  arma::Col<size_t> oldFromNew(data.n_cols);
+  for (size_t i = 0; i < oldFromNew.n_elem; ++i)
+    oldFromNew[i] = i;
+
+  DTree tree(data);
+  tree.Grow(data, oldFromNew, false, 50, 10);
+  tree.TagTree();
+
+  DTreeScorer scorer(tree);
+  BOOST_REQUIRE_EQUAL(scorer.NumNodes(), 2 * tree.SubtreeLeaves() - 1);
+
+  // Some of these points are outside of the bounding box; the number of points
+  // is not a multiple of the block size.
+  arma::mat queries;
+  queries.randn(3, 1001);
+  queries *= 2;
+
+  arma::vec densities;
+  arma::Col<int> tags;
+  scorer.ComputeValues(queries, densities);
+  scorer.FindBuckets(queries, tags);
+
+  BOOST_REQUIRE_EQUAL(densities.n_elem, queries.n_cols);
+  BOOST_REQUIRE_EQUAL(tags.n_elem, queries.n_cols);
+
+  size_t outside = 0;
+  for (size_t i = 0; i < queries.n_cols; ++i)
+  {
+    const arma::vec query = queries.col(i);
+    const double density = tree.ComputeValue(query);
+    if (density == 0.0)
+    {
+      BOOST_REQUIRE_SMALL(densities[i], 1e-15);
+      ++outside;
+    }
+    else
+    {
+      BOOST_REQUIRE_CLOSE(densities[i], density, 1e-10);
+    }
+
+    BOOST_REQUIRE_EQUAL(tags[i], tree.FindBucket(query));
+  }
+
+  BOOST_REQUIRE_GT(outside, 0);
+}
+
 /**
  * These are not yet implemented.
  *
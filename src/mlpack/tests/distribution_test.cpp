@@ -45,6 +45,32 @@ BOOST_AUTO_TEST_CASE(DiscreteDistributionProbabilityTest)
   BOOST_REQUIRE_CLOSE(d.Probability("4"), 0.2, 1e-5);
 }
 
+/**
+ * Make sure the batch probabilities and log-probabilities are the same as the
+ * probabilities of each observation.
+ */
+BOOST_AUTO_TEST_CASE(DiscreteDistributionBatchProbabilityTest)
+{
+  DiscreteDistribution d(5);
+
+  d.Probabilities() = "0.2 0.4 0.1 0.1 0.2";
+
+  arma::mat observations("4 0 1 3 2 1 1 0");
+  arma::vec probabilities, logProbabilities;
+  d.Probability(observations, probabilities);
+  d.LogProbability(observations, logProbabilities);
+
+  BOOST_REQUIRE_EQUAL(probabilities.n_elem, 8);
+  BOOST_REQUIRE_EQUAL(logProbabilities.n_elem, 8);
+  for (size_t i = 0; i < 8; ++i)
+  {
+    const arma::vec observation = observations.col(i);
+    BOOST_REQUIRE_CLOSE(probabilities[i], d.Probability(observation), 1e-5);
+    BOOST_REQUIRE_CLOSE(logProbabilities[i], d.LogProbability(observation),
+        1e-5);
+  }
+}
+
 /**
  * Make sure we get random observations correct.
  */
@@ -187,16 +213,16 @@ BOOST_AUTO_TEST_CASE(GaussianUnivariateProbabilityTest)
       1e-5);
 
   // A few more cases...
-  g.Covariance().fill(2.0);
+  g.Covariance(arma::mat("2.0"));
   BOOST_REQUIRE_CLOSE(g.Probability(arma::vec("0.0")), 0.282094791773878, 1e-5);
   BOOST_REQUIRE_CLOSE(g.Probability(arma::vec("1.0")), 0.219695644733861, 1e-5);
   BOOST_REQUIRE_CLOSE(g.Probability(arma::vec("-1.0")), 0.219695644733861,
       1e-5);
 
   g.Mean().fill(1.0);
-  g.Covariance().fill(1.0);
+  g.Covariance(arma::mat("1.0"));
   BOOST_REQUIRE_CLOSE(g.Probability(arma::vec("1.0")), 0.398942280401433, 1e-5);
-  g.Covariance().fill(2.0);
+  g.Covariance(arma::mat("2.0"));
   BOOST_REQUIRE_CLOSE(g.Probability(arma::vec("-1.0")), 0.103776874355149,
       1e-5);
 }
@@ -215,7 +241,7 @@ BOOST_AUTO_TEST_CASE(GaussianMultivariateProbabilityTest)
 
   BOOST_REQUIRE_CLOSE(g.Probability(x), 0.159154943091895, 1e-5);
 
-  g.Covariance() = "2 0; 0 2";
+  g.Covariance(arma::mat("2 0; 0 2"));
 
   BOOST_REQUIRE_CLOSE(g.Probability(x), 0.0795774715459477, 1e-5);
 
@@ -230,7 +256,7 @@ BOOST_AUTO_TEST_CASE(GaussianMultivariateProbabilityTest)
   BOOST_REQUIRE_CLOSE(g.Probability(-x), 0.0795774715459477, 1e-5);
 
   g.Mean() = "1 1";
-  g.Covariance() = "2 1.5; 1 4";
+  g.Covariance(arma::mat("2 1.5; 1 4"));
 
   BOOST_REQUIRE_CLOSE(g.Probability(x), 0.0624257046546403, 1e-5);
   g.Mean() *= -1;
@@ -245,11 +271,11 @@ BOOST_AUTO_TEST_CASE(GaussianMultivariateProbabilityTest)
   // Higher-dimensional case.
   x = "0 1 2 3 4";
   g.Mean() = "5 6 3 3 2";
-  g.Covariance() = "6 1 1 0 2;"
-                   "0 7 1 0 1;"
-                   "1 1 4 1 1;"
-                   "1 0 1 7 0;"
-                   "2 0 1 1 6";
+  g.Covariance(arma::mat("6 1 1 0 2;"
+                         "0 7 1 0 1;"
+                         "1 1 4 1 1;"
+                         "1 0 1 7 0;"
+                         "2 0 1 1 6"));
 
   BOOST_REQUIRE_CLOSE(g.Probability(x), 1.02531207499358e-6, 1e-5);
   BOOST_REQUIRE_CLOSE(g.Probability(-x), 1.06784794079363e-8, 1e-5);
@@ -290,6 +316,46 @@ BOOST_AUTO_TEST_CASE(GaussianMultipointMultivariateProbabilityTest)
   BOOST_REQUIRE_CLOSE(phis(5), 4.57951032485297e-7, 1e-5);
 }
 
+/**
+ * Make sure that the batched log-probabilities, which use the cached
+ * factorization of the covariance, match the log of the probability of each
+ * point computed directly, for a symmetric positive definite covariance and
+ * for a diagonal covariance.
+ */
+BOOST_AUTO_TEST_CASE(GaussianLogProbabilityTest)
+{
+  arma::mat factor(6, 6);
+  factor.randu();
+  arma::mat covariances[2];
+  covariances[0] = factor * trans(factor) + arma::eye<arma::mat>(6, 6);
+  covariances[1] = arma::diagmat(arma::vec("0.5 1 2 3 4 5"));
+
+  arma::vec mean(6);
+  mean.randu();
+  arma::mat points(6, 100);
+  points.randn();
+
+  for (size_t t = 0; t < 2; ++t)
+  {
+    GaussianDistribution g(mean, covariances[t]);
+    arma::vec logPhis;
+    g.LogProbability(points, logPhis);
+
+    BOOST_REQUIRE_EQUAL(logPhis.n_elem, 100);
+    for (size_t i = 0; i < points.n_cols; ++i)
+    {
+      const arma::vec diff = points.col(i) - mean;
+      const double expected = -0.5 * (6 * std::log(2 * M_PI) +
+          std::log(arma::det(covariances[t])) +
+          arma::as_scalar(trans(diff) * inv(covariances[t]) * diff));
+
+      BOOST_REQUIRE_CLOSE(logPhis[i], expected, 1e-5);
+      BOOST_REQUIRE_CLOSE(g.LogProbability(arma::vec(points.col(i))),
+          expected, 1e-5);
+    }
+  }
+}
+
 /**
  * Make sure random observations follow the probability distribution correctly.
  */
@@ -356,4 +422,35 @@ BOOST_AUTO_TEST_CASE(GaussianDistributionEstimateTest)
       BOOST_REQUIRE_SMALL(d.Covariance()(i, j) - actualCov(i, j), 1e-5);
 }
 
+/**
+ * Make sure the Laplace distribution has the right density, and that the batch
+ * probabilities and log-probabilities agree with it.
+ */
+BOOST_AUTO_TEST_CASE(LaplaceDistributionProbabilityTest)
+{
+  LaplaceDistribution d(arma::vec("1.0 -1.0"), 2.0);
+
+  // The density is largest at the mean.
+  BOOST_REQUIRE_CLOSE(d.Probability(arma::vec("1.0 -1.0")), 0.25, 1e-5);
+  BOOST_REQUIRE_CLOSE(d.Probability(arma::vec("4.0 3.0")),
+      0.25 * std::exp(-2.5), 1e-5);
+  BOOST_REQUIRE_CLOSE(d.LogProbability(arma::vec("4.0 3.0")),
+      std::log(0.25) - 2.5, 1e-5);
+
+  arma::mat observations = arma::randn<arma::mat>(2, 20);
+  arma::vec probabilities, logProbabilities;
+  d.Probability(observations, probabilities);
+  d.LogProbability(observations, logProbabilities);
+
+  BOOST_REQUIRE_EQUAL(probabilities.n_elem, 20);
+  BOOST_REQUIRE_EQUAL(logProbabilities.n_elem, 20);
+  for (size_t i = 0; i < 20; ++i)
+  {
+    const arma::vec observation = observations.col(i);
+    BOOST_REQUIRE_CLOSE(probabilities[i], d.Probability(observation), 1e-5);
+    BOOST_REQUIRE_CLOSE(logProbabilities[i], d.LogProbability(observation),
+        1e-5);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
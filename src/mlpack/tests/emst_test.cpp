@@ -5,6 +5,7 @@
  */
 #include <mlpack/core.hpp>
 #include <mlpack/methods/emst/dtb.hpp>
+#include <mlpack/methods/emst/single_linkage.hpp>
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
 
@@ -277,4 +278,82 @@ BOOST_AUTO_TEST_CASE(BallTreeTest)
 
 }
 
+/**
+ * On a dataset big enough that the edges are sorted in several runs (when
+ * OpenMP is available), the edges should be sorted by distance and should
+ * connect every point.
+ */
+BOOST_AUTO_TEST_CASE(LargeSortedEdgesTest)
+{
+  arma::mat inputData = arma::randu<arma::mat>(2, 25000);
+
+  DualTreeBoruvka<> dtb(inputData);
+  arma::mat results;
+  dtb.ComputeMST(results);
+
+  BOOST_REQUIRE_EQUAL(results.n_cols, 24999);
+
+  UnionFind connections(inputData.n_cols);
+  for (size_t i = 0; i < results.n_cols; ++i)
+  {
+    if (i > 0)
+      BOOST_REQUIRE_LE(results(2, i - 1), results(2, i));
+
+    // Each edge must join two components.
+    const size_t lesser = (size_t) results(0, i);
+    const size_t greater = (size_t) results(1, i);
+    BOOST_REQUIRE_NE(connections.Find(lesser), connections.Find(greater));
+    connections.Union(lesser, greater);
+  }
+}
+
+/**
+ * Check the single-linkage dendrogram and flat clusterings of a small
+ * one-dimensional dataset, computed from the edges of its MST.
+ */
+BOOST_AUTO_TEST_CASE(SingleLinkageTest)
+{
+  arma::mat data("0.0 1.0 3.0 10.0 11.5");
+
+  DualTreeBoruvka<> dtb(data);
+  dtb.ComputeMST();
+  BOOST_REQUIRE_EQUAL(dtb.Edges().size(), 4);
+
+  SingleLinkage linkage(dtb.Edges(), data.n_cols);
+
+  // The merges are {0, 1}, {3, 4}, {0, 1, 2}, and everything.
+  arma::mat merges;
+  linkage.Dendrogram(merges);
+  BOOST_REQUIRE_EQUAL(merges.n_rows, 4);
+  BOOST_REQUIRE_EQUAL(merges.n_cols, 4);
+
+  const double expected[4][4] = { { 0, 1, 1.0, 2 },
+                                  { 3, 4, 1.5, 2 },
+                                  { 2, 5, 2.0, 3 },
+                                  { 6, 7, 7.0, 5 } };
+  for (size_t i = 0; i < 4; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(merges(0, i), expected[i][0]);
+    BOOST_REQUIRE_EQUAL(merges(1, i), expected[i][1]);
+    BOOST_REQUIRE_CLOSE(merges(2, i), expected[i][2], 1e-5);
+    BOOST_REQUIRE_EQUAL(merges(3, i), expected[i][3]);
+  }
+
+  arma::Col<size_t> assignments;
+  linkage.Cluster((size_t) 2, assignments);
+  BOOST_REQUIRE_EQUAL(assignments.n_elem, 5);
+  BOOST_REQUIRE_EQUAL(assignments[0], 0);
+  BOOST_REQUIRE_EQUAL(assignments[1], 0);
+  BOOST_REQUIRE_EQUAL(assignments[2], 0);
+  BOOST_REQUIRE_EQUAL(assignments[3], 1);
+  BOOST_REQUIRE_EQUAL(assignments[4], 1);
+
+  BOOST_REQUIRE_EQUAL(linkage.Cluster(1.5, assignments), 3);
+  BOOST_REQUIRE_EQUAL(assignments[0], 0);
+  BOOST_REQUIRE_EQUAL(assignments[1], 0);
+  BOOST_REQUIRE_EQUAL(assignments[2], 1);
+  BOOST_REQUIRE_EQUAL(assignments[3], 2);
+  BOOST_REQUIRE_EQUAL(assignments[4], 2);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -121,4 +121,157 @@ BOOST_AUTO_TEST_CASE(DualTreeVsSingleTree)
   }
 }
 
+/**
+ * Search batches of queries against the same FastMKS object, in naive,
+ * single-tree, and dual-tree mode, and compare with naive search of all the
+ * queries at once.
+ */
+BOOST_AUTO_TEST_CASE(BatchSearchTest)
+{
+  arma::mat referenceData;
+  referenceData.randn(5, 1000);
+  arma::mat queryData;
+  queryData.randn(5, 200);
+  LinearKernel lk;
+
+  FastMKS<LinearKernel> naive(referenceData, queryData, lk, false, true);
+
+  arma::Mat<size_t> naiveIndices;
+  arma::mat naiveProducts;
+  naive.Search(10, naiveIndices, naiveProducts);
+
+  FastMKS<LinearKernel> batchNaive(referenceData, lk, false, true);
+  FastMKS<LinearKernel> batchSingle(referenceData, lk, true);
+  FastMKS<LinearKernel> batchDual(referenceData, lk);
+
+  arma::Mat<size_t> indices;
+  arma::mat products;
+  for (size_t begin = 0; begin < queryData.n_cols; begin += 50)
+  {
+    const arma::mat batch = queryData.cols(begin, begin + 49);
+
+    for (size_t mode = 0; mode < 3; ++mode)
+    {
+      if (mode == 0)
+        batchNaive.Search(batch, 10, indices, products);
+      else if (mode == 1)
+        batchSingle.Search(batch, 10, indices, products);
+      else
+        batchDual.Search(batch, 10, indices, products);
+
+      BOOST_REQUIRE_EQUAL(indices.n_rows, 10);
+      BOOST_REQUIRE_EQUAL(indices.n_cols, 50);
+      for (size_t q = 0; q < indices.n_cols; ++q)
+      {
+        for (size_t r = 0; r < indices.n_rows; ++r)
+        {
+          BOOST_REQUIRE_EQUAL(indices(r, q), naiveIndices(r, begin + q));
+          BOOST_REQUIRE_CLOSE(products(r, q), naiveProducts(r, begin + q),
+              1e-5);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Approximate search should give kernels within the relative error of the
+ * exact kernels, and an error of zero should give the exact results.
+ */
+BOOST_AUTO_TEST_CASE(ApproximateSearchTest)
+{
+  arma::mat data;
+  data.randu(10, 2000);
+  LinearKernel lk;
+
+  FastMKS<LinearKernel> naive(data, lk, false, true);
+  arma::Mat<size_t> naiveIndices;
+  arma::mat naiveProducts;
+  naive.Search(5, naiveIndices, naiveProducts);
+
+  const double epsilon = 0.05;
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    FastMKS<LinearKernel> approx(data, lk, (mode == 0));
+
+    approx.Epsilon() = epsilon;
+    arma::Mat<size_t> indices;
+    arma::mat products;
+    approx.Search(5, indices, products);
+
+    // The linear kernel is positive on this data.
+    for (size_t q = 0; q < products.n_cols; ++q)
+      for (size_t r = 0; r < products.n_rows; ++r)
+        BOOST_REQUIRE_GE(products(r, q) + 1e-8,
+            (1.0 - epsilon) * naiveProducts(r, q));
+
+    approx.Epsilon() = 0.0;
+    approx.Search(5, indices, products);
+    for (size_t q = 0; q < products.n_cols; ++q)
+    {
+      for (size_t r = 0; r < products.n_rows; ++r)
+      {
+        BOOST_REQUIRE_EQUAL(indices(r, q), naiveIndices(r, q));
+        BOOST_REQUIRE_CLOSE(products(r, q), naiveProducts(r, q), 1e-5);
+      }
+    }
+  }
+
+  // With a limit on the base cases, single-tree search still gives valid
+  // candidates (kernels of the reference points it returns).
+  FastMKS<LinearKernel> limited(data, lk, true);
+  limited.MaxBaseCases() = 50;
+  arma::Mat<size_t> indices;
+  arma::mat products;
+  limited.Search(5, indices, products);
+  for (size_t q = 0; q < products.n_cols; ++q)
+  {
+    for (size_t r = 0; r < products.n_rows; ++r)
+    {
+      BOOST_REQUIRE_LE(products(r, q), naiveProducts(r, q) + 1e-8);
+      if (products(r, q) != -DBL_MAX)
+        BOOST_REQUIRE_CLOSE(products(r, q), arma::dot(data.col(q),
+            data.col(indices(r, q))), 1e-5);
+    }
+  }
+}
+
+/**
+ * With a kernel cache, the searches must give the same results, and a second
+ * search must find its kernel evaluations in the cache.
+ */
+BOOST_AUTO_TEST_CASE(CachedSearchTest)
+{
+  arma::mat data;
+  data.randu(5, 500);
+  PolynomialKernel pk(2.0);
+
+  FastMKS<PolynomialKernel> naive(data, pk, false, true);
+  arma::Mat<size_t> naiveIndices;
+  arma::mat naiveProducts;
+  naive.Search(5, naiveIndices, naiveProducts);
+
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    FastMKS<PolynomialKernel> cached(data, pk, (mode == 0));
+    cached.CacheSize() = 500 * 500;
+
+    arma::Mat<size_t> indices;
+    arma::mat products;
+    for (size_t trial = 0; trial < 2; ++trial)
+    {
+      cached.Search(5, indices, products);
+
+      for (size_t q = 0; q < products.n_cols; ++q)
+      {
+        for (size_t r = 0; r < products.n_rows; ++r)
+        {
+          BOOST_REQUIRE_EQUAL(indices(r, q), naiveIndices(r, q));
+          BOOST_REQUIRE_CLOSE(products(r, q), naiveProducts(r, q), 1e-5);
+        }
+      }
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
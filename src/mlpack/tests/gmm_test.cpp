@@ -8,6 +8,8 @@
 #include <mlpack/core.hpp>
 
 #include <mlpack/methods/gmm/gmm.hpp>
+#include <mlpack/methods/gmm/online_em_fit.hpp>
+#include <mlpack/methods/gmm/mrkd_em_fit.hpp>
 
 #include <mlpack/methods/gmm/no_constraint.hpp>
 #include <mlpack/methods/gmm/positive_definite_constraint.hpp>
@@ -481,6 +483,52 @@ BOOST_AUTO_TEST_CASE(GMMClassifyTest)
   BOOST_REQUIRE_EQUAL(classes[12], 2);
 }
 
+/**
+ * Make sure the blocked LogProbability() and Classify() agree with the
+ * probabilities of the individual observations, across several blocks, and
+ * that LogProbability() does not underflow far from the components.
+ */
+BOOST_AUTO_TEST_CASE(GMMBatchScoringTest)
+{
+  GMM<> gmm(3, 2);
+  gmm.Component(0) = distribution::GaussianDistribution("0 0", "1 0; 0 1");
+  gmm.Component(1) = distribution::GaussianDistribution("1 3", "3 2; 2 3");
+  gmm.Component(2) = distribution::GaussianDistribution("-2 -2",
+      "2.2 1.4; 1.4 5.1");
+  gmm.Weights() = "0.6 0.25 0.15";
+
+  arma::mat observations = 4.0 * arma::randn<arma::mat>(2, 2500);
+
+  arma::vec logProbabilities, probabilities;
+  arma::Col<size_t> classes;
+  gmm.LogProbability(observations, logProbabilities);
+  gmm.Probability(observations, probabilities);
+  gmm.Classify(observations, classes);
+
+  BOOST_REQUIRE_EQUAL(logProbabilities.n_elem, 2500);
+  BOOST_REQUIRE_EQUAL(probabilities.n_elem, 2500);
+  BOOST_REQUIRE_EQUAL(classes.n_elem, 2500);
+  for (size_t i = 0; i < observations.n_cols; ++i)
+  {
+    const arma::vec observation = observations.col(i);
+    const double probability = gmm.Probability(observation);
+    BOOST_REQUIRE_CLOSE(probabilities[i], probability, 1e-5);
+    BOOST_REQUIRE_CLOSE(logProbabilities[i], std::log(probability), 1e-5);
+
+    size_t best = 0;
+    for (size_t j = 1; j < 3; ++j)
+      if (gmm.Probability(observation, j) > gmm.Probability(observation, best))
+        best = j;
+    BOOST_REQUIRE_EQUAL(classes[i], best);
+  }
+
+  // The probability of this point underflows, but not its log-probability.
+  gmm.LogProbability(arma::mat("100; -100"), logProbabilities);
+  BOOST_REQUIRE_EQUAL(logProbabilities.n_elem, 1);
+  BOOST_REQUIRE_LT(logProbabilities[0], -1000.0);
+  BOOST_REQUIRE_GT(logProbabilities[0], -std::numeric_limits<double>::max());
+}
+
 BOOST_AUTO_TEST_CASE(GMMLoadSaveTest)
 {
   // Create a GMM, save it, and load it.
@@ -490,7 +538,7 @@ BOOST_AUTO_TEST_CASE(GMMLoadSaveTest)
   for (size_t i = 0; i < gmm.Gaussians(); ++i)
   {
     gmm.Component(i).Mean().randu();
-    gmm.Component(i).Covariance().randu();
+    gmm.Component(i).Covariance(arma::randu<arma::mat>(4, 4));
   }
 
   gmm.Save("test-gmm-save.xml");
@@ -524,6 +572,43 @@ BOOST_AUTO_TEST_CASE(GMMLoadSaveTest)
   }
 }
 
+/**
+ * A GMM saved in the binary format must be loaded exactly.
+ */
+BOOST_AUTO_TEST_CASE(GMMLoadSaveBinaryTest)
+{
+  GMM<> gmm(5, 3);
+  gmm.Weights().randu();
+
+  for (size_t i = 0; i < gmm.Gaussians(); ++i)
+  {
+    gmm.Component(i).Mean().randu();
+    arma::mat cov = arma::randu<arma::mat>(3, 3);
+    gmm.Component(i).Covariance(cov * trans(cov) + arma::eye<arma::mat>(3, 3));
+  }
+
+  gmm.Save("test-gmm-save.bin");
+
+  GMM<> gmm2;
+  gmm2.Load("test-gmm-save.bin");
+
+  remove("test-gmm-save.bin");
+
+  BOOST_REQUIRE_EQUAL(gmm.Gaussians(), gmm2.Gaussians());
+  BOOST_REQUIRE_EQUAL(gmm.Dimensionality(), gmm2.Dimensionality());
+
+  for (size_t i = 0; i < gmm.Gaussians(); ++i)
+  {
+    BOOST_REQUIRE_EQUAL(gmm.Weights()[i], gmm2.Weights()[i]);
+    for (size_t j = 0; j < gmm.Dimensionality(); ++j)
+      BOOST_REQUIRE_EQUAL(gmm.Component(i).Mean()[j],
+          gmm2.Component(i).Mean()[j]);
+    for (size_t j = 0; j < gmm.Component(i).Covariance().n_elem; ++j)
+      BOOST_REQUIRE_EQUAL(gmm.Component(i).Covariance()[j],
+          gmm2.Component(i).Covariance()[j]);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(NoConstraintTest)
 {
   // Generate random matrices and make sure they end up the same.
@@ -758,5 +843,355 @@ BOOST_AUTO_TEST_CASE(UseExistingModelTest)
   }
 }
 
+/**
+ * Make sure that the trials of EMFit give the same model whatever the number
+ * of threads, that the best trial is kept, and that abandoning trials still
+ * gives a valid model.
+ */
+BOOST_AUTO_TEST_CASE(EMFitTrialsTest)
+{
+  // Three well-separated clusters.
+  arma::mat data(2, 1500);
+  data.cols(0, 499) = arma::randn<arma::mat>(2, 500);
+  data.cols(500, 999) = arma::randn<arma::mat>(2, 500) + 8.0;
+  data.cols(1000, 1499) = arma::randn<arma::mat>(2, 500) - 8.0;
+
+  double likelihoods[2];
+  arma::vec weights[2];
+  for (size_t i = 0; i < 2; ++i)
+  {
+    util::SetNumThreads((i == 0) ? 1 : 4);
+    math::RandomSeed(42);
+
+    GMM<> gmm(3, 2);
+    likelihoods[i] = gmm.Estimate(data, 5);
+    weights[i] = arma::sort(gmm.Weights());
+
+    // The returned log-likelihood is that of the model.
+    arma::vec logProbabilities;
+    gmm.LogProbability(data, logProbabilities);
+    BOOST_REQUIRE_CLOSE(likelihoods[i], arma::accu(logProbabilities), 1e-5);
+
+    // The best trial can't be worse than a single trial from the same start.
+    math::RandomSeed(42);
+    GMM<> single(3, 2);
+    BOOST_REQUIRE_GE(likelihoods[i], single.Estimate(data, 1) - 1e-5);
+  }
+  util::SetNumThreads(0);
+
+  BOOST_REQUIRE_CLOSE(likelihoods[0], likelihoods[1], 1e-5);
+  for (size_t j = 0; j < 3; ++j)
+    BOOST_REQUIRE_CLOSE(weights[0][j], weights[1][j], 1e-5);
+
+  // With no margin, every trial but the best after two iterations is
+  // abandoned.
+  EMFit<> em;
+  em.AbandonIterations() = 2;
+  em.AbandonMargin() = 0.0;
+  GMM<> gmm(3, 2, em);
+  const double likelihood = gmm.Estimate(data, 5);
+  BOOST_REQUIRE_CLOSE(arma::accu(gmm.Weights()), 1.0, 1e-5);
+  BOOST_REQUIRE_LT(likelihood, 0.0);
+  BOOST_REQUIRE_GT(likelihood, -DBL_MAX);
+}
+
+/**
+ * Make sure that EM still works when the density of every point under every
+ * component underflows in linear space, because the responsibilities are
+ * computed in log-space.  The data has more than one block of points.
+ */
+BOOST_AUTO_TEST_CASE(EMFitUnderflowTest)
+{
+  const size_t dimension = 60;
+  arma::mat data(dimension, 3000);
+  data.randn();
+  data.cols(1500, 2999) += 100.0;
+
+  // exp(-0.5 * dimension / 0.01) is far below the smallest double.
+  std::vector<distribution::GaussianDistribution> dists(2,
+      distribution::GaussianDistribution(dimension));
+  dists[0].Mean().fill(0.5);
+  dists[1].Mean().fill(99.5);
+  for (size_t i = 0; i < 2; ++i)
+    dists[i].Covariance(0.01 * arma::eye<arma::mat>(dimension, dimension));
+  arma::vec weights("0.5 0.5");
+
+  EMFit<> em;
+  em.Estimate(data, dists, weights, true);
+
+  const arma::vec mean0 = arma::mean(data.cols(0, 1499), 1);
+  const arma::vec mean1 = arma::mean(data.cols(1500, 2999), 1);
+  for (size_t j = 0; j < dimension; ++j)
+  {
+    BOOST_REQUIRE_SMALL(dists[0].Mean()[j] - mean0[j], 1e-5);
+    BOOST_REQUIRE_SMALL(dists[1].Mean()[j] - mean1[j], 1e-5);
+  }
+
+  BOOST_REQUIRE_CLOSE(weights[0], 0.5, 1e-5);
+  BOOST_REQUIRE_CLOSE(weights[1], 0.5, 1e-5);
+}
+
+/**
+ * EM with the fast exponential should fit the same model as with std::exp(),
+ * from the same initial model.
+ */
+BOOST_AUTO_TEST_CASE(EMFitFastExpTest)
+{
+  arma::mat data(3, 2000);
+  data.randn();
+  data.cols(1000, 1999) *= 2.0;
+  data.cols(1000, 1999) += 4.0;
+
+  std::vector<distribution::GaussianDistribution> dists(2,
+      distribution::GaussianDistribution(3));
+  dists[0].Mean().fill(1.0);
+  dists[1].Mean().fill(3.0);
+  arma::vec weights("0.5 0.5");
+  std::vector<distribution::GaussianDistribution> fastDists(dists);
+  arma::vec fastWeights(weights);
+
+  EMFit<> em;
+  em.Estimate(data, dists, weights, true);
+  EMFit<kmeans::KMeans<>, PositiveDefiniteConstraint, math::FastExp<> >
+      fastEm;
+  fastEm.Estimate(data, fastDists, fastWeights, true);
+
+  for (size_t i = 0; i < 2; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(fastWeights[i], weights[i], 1e-3);
+    for (size_t j = 0; j < 3; ++j)
+      BOOST_REQUIRE_SMALL(fastDists[i].Mean()[j] - dists[i].Mean()[j], 1e-5);
+    for (size_t j = 0; j < 9; ++j)
+      BOOST_REQUIRE_SMALL(fastDists[i].Covariance()[j] -
+          dists[i].Covariance()[j], 1e-5);
+  }
+}
+
+/**
+ * Make sure that EM gives the same model for observations in single precision
+ * as for the same observations in double precision.
+ */
+BOOST_AUTO_TEST_CASE(EMFitFloatTest)
+{
+  arma::fmat floatData(3, 2000);
+  floatData.randn();
+  floatData.cols(1000, 1999) *= 2.0;
+  floatData.cols(1000, 1999) += 4.0;
+  const arma::mat data = arma::conv_to<arma::mat>::from(floatData);
+
+  std::vector<distribution::GaussianDistribution> dists(2,
+      distribution::GaussianDistribution(3));
+  dists[0].Mean().fill(1.0);
+  dists[1].Mean().fill(3.0);
+  arma::vec weights("0.5 0.5");
+  std::vector<distribution::GaussianDistribution> floatDists(dists);
+  arma::vec floatWeights(weights);
+
+  EMFit<> em;
+  em.Estimate(data, dists, weights, true);
+  EMFit<kmeans::KMeans<metric::EuclideanDistance, kmeans::RandomPartition,
+      kmeans::MaxVarianceNewCluster, kmeans::NaiveKMeans, arma::fmat> >
+      floatEm;
+  floatEm.Estimate(floatData, floatDists, floatWeights, true);
+
+  for (size_t i = 0; i < 2; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(floatWeights[i], weights[i], 1e-5);
+    for (size_t j = 0; j < 3; ++j)
+      BOOST_REQUIRE_SMALL(floatDists[i].Mean()[j] - dists[i].Mean()[j], 1e-5);
+    for (size_t j = 0; j < 9; ++j)
+      BOOST_REQUIRE_SMALL(floatDists[i].Covariance()[j] -
+          dists[i].Covariance()[j], 1e-5);
+  }
+}
+
+/**
+ * Make sure that stepwise EM finds two well-separated Gaussians, both when the
+ * observations are in memory and when they are read from a file in blocks,
+ * and that updating the model with more observations continues the steps.
+ */
+BOOST_AUTO_TEST_CASE(OnlineEMFitTest)
+{
+  arma::mat data(3, 10000);
+  data.randn();
+  data.cols(5000, 9999) += 10.0;
+  data = arma::shuffle(data, 1);
+
+  for (size_t useReader = 0; useReader < 2; ++useReader)
+  {
+    OnlineEMFit<> em(250, 2);
+    GMM<OnlineEMFit<> > gmm(2, 3, em);
+    if (useReader == 1)
+    {
+      data::Save("test_online_em.csv", data);
+      data::StreamingReader reader("test_online_em.csv", 250);
+      gmm.Estimate(reader);
+    }
+    else
+    {
+      gmm.Estimate(data);
+    }
+
+    // Two passes over 40 batches.
+    BOOST_REQUIRE_EQUAL(gmm.Fitter().Steps(), 80);
+
+    // The components may be in either order.
+    const size_t first = (gmm.Component(0).Mean()[0] < 5.0) ? 0 : 1;
+    for (size_t c = 0; c < 2; ++c)
+    {
+      const size_t component = (c == 0) ? first : 1 - first;
+      for (size_t d = 0; d < 3; ++d)
+      {
+        BOOST_REQUIRE_SMALL(gmm.Component(component).Mean()[d] - 10.0 * c,
+            0.15);
+        for (size_t e = 0; e < 3; ++e)
+          BOOST_REQUIRE_SMALL(gmm.Component(component).Covariance()(d, e) -
+              ((d == e) ? 1.0 : 0.0), 0.15);
+      }
+      BOOST_REQUIRE_SMALL(gmm.Weights()[component] - 0.5, 0.05);
+    }
+
+    // Updating the model with the same observations must not move it much.
+    const arma::vec mean = gmm.Component(first).Mean();
+    gmm.Estimate(data, 1, true);
+    BOOST_REQUIRE_EQUAL(gmm.Fitter().Steps(), 160);
+    for (size_t d = 0; d < 3; ++d)
+      BOOST_REQUIRE_SMALL(gmm.Component(first).Mean()[d] - mean[d], 0.15);
+  }
+
+  remove("test_online_em.csv");
+}
+
+/**
+ * EM with an mrkd-tree must give the same model as EMFit when nothing is
+ * summarized, and nearly the same model with far fewer responsibilities
+ * computed when nodes are summarized; with and without probabilities.
+ */
+BOOST_AUTO_TEST_CASE(MRKDEMFitTest)
+{
+  const size_t n = 20000;
+  arma::mat data(2, n);
+  data.randn();
+  data.cols(0, 7999) *= 0.5;
+  data.cols(8000, 13999) += 8.0;
+  data.submat(0, 14000, 0, n - 1) -= 8.0;
+  data.submat(1, 14000, 1, n - 1) += 8.0;
+  data = arma::shuffle(data, 1);
+
+  arma::vec probabilities = 0.5 + 0.5 * arma::randu<arma::vec>(n);
+
+  // Start every fit from the same model.
+  std::vector<distribution::GaussianDistribution> initialDists(3,
+      distribution::GaussianDistribution(2));
+  initialDists[0].Mean() = arma::vec("0.5 0.5");
+  initialDists[1].Mean() = arma::vec("7.0 7.0");
+  initialDists[2].Mean() = arma::vec("-7.0 7.0");
+  const arma::vec initialWeights("0.3 0.3 0.4");
+
+  for (size_t weighted = 0; weighted < 2; ++weighted)
+  {
+    std::vector<distribution::GaussianDistribution> emDists(initialDists);
+    arma::vec emWeights(initialWeights);
+    EMFit<> em(20, 0.0);
+    if (weighted == 1)
+      em.Estimate(data, probabilities, emDists, emWeights, true);
+    else
+      em.Estimate(data, emDists, emWeights, true);
+
+    for (size_t exact = 0; exact < 2; ++exact)
+    {
+      std::vector<distribution::GaussianDistribution> dists(initialDists);
+      arma::vec weights(initialWeights);
+      MRKDEMFit<> mrkd(20, 0.0, (exact == 1) ? 0.0 : 1e-3);
+      if (weighted == 1)
+        mrkd.Estimate(data, probabilities, dists, weights, true);
+      else
+        mrkd.Estimate(data, dists, weights, true);
+
+      const double tolerance = (exact == 1) ? 1e-6 : 0.02;
+      for (size_t c = 0; c < 3; ++c)
+      {
+        BOOST_REQUIRE_SMALL(weights[c] - emWeights[c], tolerance);
+        for (size_t d = 0; d < 2; ++d)
+        {
+          BOOST_REQUIRE_SMALL(dists[c].Mean()[d] - emDists[c].Mean()[d],
+              tolerance);
+          for (size_t e = 0; e < 2; ++e)
+            BOOST_REQUIRE_SMALL(dists[c].Covariance()(d, e) -
+                emDists[c].Covariance()(d, e), tolerance);
+        }
+      }
+
+      if (exact == 1)
+      {
+        BOOST_REQUIRE_EQUAL(mrkd.Prunes(), 0);
+      }
+      else
+      {
+        BOOST_REQUIRE_GT(mrkd.Prunes(), 0);
+        BOOST_REQUIRE_LT(mrkd.BaseCases(), 20 * n / 2);
+      }
+    }
+  }
+}
+
+/**
+ * Draw many observations from a GMM at once, in parallel, and make sure that
+ * each component gets its share of the observations with the right mean and
+ * covariance, and that the observations do not depend on the number of
+ * threads.
+ */
+BOOST_AUTO_TEST_CASE(GMMBatchRandomTest)
+{
+  GMM<> gmm(2, 2);
+  gmm.Weights() = arma::vec("0.30 0.70");
+  gmm.Component(0) = distribution::GaussianDistribution("-5.0 3.0",
+      "1.00 0.60; 0.60 0.89");
+  gmm.Component(1) = distribution::GaussianDistribution("5.0 -1.0",
+      "1.00 0.70; 0.70 1.01");
+
+  math::RandomSeed(17);
+  util::SetNumThreads(4);
+  arma::mat observations;
+  gmm.Random(20000, observations);
+  util::SetNumThreads(0);
+
+  BOOST_REQUIRE_EQUAL(observations.n_rows, 2);
+  BOOST_REQUIRE_EQUAL(observations.n_cols, 20000);
+
+  // The components are far apart, so each observation can be assigned to the
+  // component it came from by its first coordinate.
+  for (size_t c = 0; c < 2; ++c)
+  {
+    arma::mat componentObservations(2, 20000);
+    size_t count = 0;
+    for (size_t i = 0; i < observations.n_cols; ++i)
+      if ((observations(0, i) > 0.0) == (c == 1))
+        componentObservations.col(count++) = observations.col(i);
+    componentObservations.resize(2, count);
+
+    BOOST_REQUIRE_CLOSE(count / 20000.0, gmm.Weights()[c], 5.0);
+
+    const arma::vec mean = arma::mean(componentObservations, 1);
+    const arma::mat covariance = ccov(componentObservations);
+    for (size_t i = 0; i < 2; ++i)
+    {
+      BOOST_REQUIRE_CLOSE(mean[i], gmm.Component(c).Mean()[i], 5.0);
+      for (size_t j = 0; j < 2; ++j)
+        BOOST_REQUIRE_CLOSE(covariance(i, j),
+            gmm.Component(c).Covariance()(i, j), 10.0);
+    }
+  }
+
+  // With the same seed, one thread draws the same observations.
+  math::RandomSeed(17);
+  util::SetNumThreads(1);
+  arma::mat serialObservations;
+  gmm.Random(20000, serialObservations);
+  util::SetNumThreads(0);
+
+  for (size_t i = 0; i < observations.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(observations[i], serialObservations[i]);
+}
 
 BOOST_AUTO_TEST_SUITE_END();
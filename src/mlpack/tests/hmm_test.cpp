@@ -5,6 +5,8 @@
  */
 #include <mlpack/core.hpp>
 #include <mlpack/methods/hmm/hmm.hpp>
+#include <mlpack/methods/hmm/hmm_regression.hpp>
+#include <mlpack/methods/hmm/hmm_filter.hpp>
 #include <mlpack/methods/gmm/gmm.hpp>
 
 #include <boost/test/unit_test.hpp>
@@ -517,6 +519,70 @@ BOOST_AUTO_TEST_CASE(DiscreteHMMLogLikelihoodTest)
       -24.51556128368, 1e-5);
 }
 
+/**
+ * Make sure that a discrete HMM gives the same results for sequences of packed
+ * symbols as for the same sequences stored as arma::mat.
+ */
+BOOST_AUTO_TEST_CASE(DiscreteHMMPackedSymbolsTest)
+{
+  arma::vec initial("0.5 0.2 0.3");
+  arma::mat transition("0.5 0.0 0.1;"
+                       "0.2 0.6 0.2;"
+                       "0.3 0.4 0.7");
+  std::vector<DiscreteDistribution> emission(3);
+  emission[0].Probabilities() = "0.75 0.25 0.00 0.00";
+  emission[1].Probabilities() = "0.00 0.25 0.25 0.50";
+  emission[2].Probabilities() = "0.10 0.40 0.40 0.10";
+
+  HMM<DiscreteDistribution> hmm(initial, transition, emission);
+
+  std::vector<arma::mat> sequences;
+  std::vector<arma::Col<size_t> > states;
+  hmm.Generate(10, 200, sequences, states);
+
+  std::vector<arma::Row<uint32_t> > packed(sequences.size());
+  for (size_t seq = 0; seq < sequences.size(); ++seq)
+    packed[seq] = arma::conv_to<arma::Row<uint32_t> >::from(sequences[seq]);
+
+  for (size_t seq = 0; seq < sequences.size(); ++seq)
+  {
+    BOOST_REQUIRE_CLOSE(hmm.LogLikelihood(packed[seq]),
+        hmm.LogLikelihood(sequences[seq]), 1e-8);
+
+    arma::mat stateProb, packedStateProb;
+    hmm.Estimate(sequences[seq], stateProb);
+    hmm.Estimate(packed[seq], packedStateProb);
+    BOOST_REQUIRE_EQUAL(packedStateProb.n_rows, 3);
+    BOOST_REQUIRE_EQUAL(packedStateProb.n_cols, 200);
+    for (size_t i = 0; i < stateProb.n_elem; ++i)
+      BOOST_REQUIRE_SMALL(packedStateProb[i] - stateProb[i], 1e-10);
+
+    arma::Col<size_t> stateSeq, packedStateSeq;
+    const double logLikelihood = hmm.Predict(sequences[seq], stateSeq);
+    BOOST_REQUIRE_CLOSE(hmm.Predict(packed[seq], packedStateSeq),
+        logLikelihood, 1e-8);
+    for (size_t t = 0; t < stateSeq.n_elem; ++t)
+      BOOST_REQUIRE_EQUAL(packedStateSeq[t], stateSeq[t]);
+  }
+
+  // Baum-Welch training from the same starting point gives the same model.
+  HMM<DiscreteDistribution> start(3, DiscreteDistribution(4));
+  start.Emission()[0].Probabilities() = "0.4 0.3 0.2 0.1";
+  start.Emission()[1].Probabilities() = "0.1 0.2 0.3 0.4";
+  start.Emission()[2].Probabilities() = "0.25 0.25 0.3 0.2";
+  HMM<DiscreteDistribution> trained(start), packedTrained(start);
+  trained.Train(sequences);
+  packedTrained.Train(packed);
+
+  for (size_t i = 0; i < 9; ++i)
+    BOOST_REQUIRE_SMALL(packedTrained.Transition()[i] -
+        trained.Transition()[i], 1e-6);
+  for (size_t state = 0; state < 3; ++state)
+    for (size_t j = 0; j < 4; ++j)
+      BOOST_REQUIRE_SMALL(packedTrained.Emission()[state].Probabilities()[j] -
+          trained.Emission()[state].Probabilities()[j], 1e-6);
+}
+
 /**
  * A simple test to make sure HMMs with Gaussian output distributions work.
  */
@@ -580,6 +646,210 @@ BOOST_AUTO_TEST_CASE(GaussianHMMSimpleTest)
   }
 }
 
+/**
+ * A Gaussian distribution which can only evaluate one observation at a time,
+ * so the HMM does not use the batched emission probabilities.
+ */
+class PointwiseGaussian
+{
+ public:
+  PointwiseGaussian(const GaussianDistribution& g) : g(g) { }
+
+  size_t Dimensionality() const { return g.Dimensionality(); }
+
+  double Probability(const arma::vec& observation) const
+  {
+    return g.Probability(observation);
+  }
+
+ private:
+  GaussianDistribution g;
+};
+
+/**
+ * Make sure that the batched emission probabilities give the same results as
+ * evaluating one observation at a time, for Estimate(), Predict(), and
+ * LogLikelihood().
+ */
+BOOST_AUTO_TEST_CASE(GaussianHMMBatchEmissionTest)
+{
+  GaussianDistribution g1("1.0 1.0", "1.0 0.2; 0.2 1.5");
+  GaussianDistribution g2("-1.0 0.0", "0.5 0.0; 0.0 0.5");
+  GaussianDistribution g3("0.0 -2.0", "2.0 -0.3; -0.3 1.0");
+
+  arma::vec initial("0.5 0.3 0.2");
+  arma::mat transition("0.6 0.3 0.2; 0.3 0.5 0.2; 0.1 0.2 0.6");
+
+  std::vector<GaussianDistribution> emission;
+  emission.push_back(g1);
+  emission.push_back(g2);
+  emission.push_back(g3);
+  std::vector<PointwiseGaussian> pointwiseEmission;
+  for (size_t i = 0; i < 3; ++i)
+    pointwiseEmission.push_back(PointwiseGaussian(emission[i]));
+
+  HMM<GaussianDistribution> hmm(initial, transition, emission);
+  HMM<PointwiseGaussian> pointwiseHMM(initial, transition, pointwiseEmission);
+
+  arma::mat observations(2, 300);
+  observations.randn();
+  observations *= 2.0;
+
+  arma::mat stateProb, forwardProb, backwardProb;
+  arma::vec scales;
+  arma::mat pointwiseStateProb, pointwiseForwardProb, pointwiseBackwardProb;
+  arma::vec pointwiseScales;
+  const double logLikelihood = hmm.Estimate(observations, stateProb,
+      forwardProb, backwardProb, scales);
+  const double pointwiseLogLikelihood = pointwiseHMM.Estimate(observations,
+      pointwiseStateProb, pointwiseForwardProb, pointwiseBackwardProb,
+      pointwiseScales);
+
+  BOOST_REQUIRE_CLOSE(logLikelihood, pointwiseLogLikelihood, 1e-8);
+  BOOST_REQUIRE_CLOSE(hmm.LogLikelihood(observations), logLikelihood, 1e-8);
+  for (size_t i = 0; i < stateProb.n_elem; ++i)
+  {
+    BOOST_REQUIRE_SMALL(stateProb[i] - pointwiseStateProb[i], 1e-10);
+    BOOST_REQUIRE_SMALL(forwardProb[i] - pointwiseForwardProb[i], 1e-10);
+    BOOST_REQUIRE_CLOSE(backwardProb[i], pointwiseBackwardProb[i], 1e-8);
+  }
+
+  arma::Col<size_t> stateSeq, pointwiseStateSeq;
+  const double logProb = hmm.Predict(observations, stateSeq);
+  const double pointwiseLogProb = pointwiseHMM.Predict(observations,
+      pointwiseStateSeq);
+
+  BOOST_REQUIRE_CLOSE(logProb, pointwiseLogProb, 1e-8);
+  for (size_t i = 0; i < stateSeq.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(stateSeq[i], pointwiseStateSeq[i]);
+}
+
+/**
+ * Make sure that beam-pruned Viterbi gives the exact result without limits,
+ * and the right states with a narrow beam when the states are well separated.
+ */
+BOOST_AUTO_TEST_CASE(GaussianHMMBeamPredictTest)
+{
+  // Four states in a ring; each state can only stay or move to the next one.
+  std::vector<GaussianDistribution> emission;
+  for (size_t i = 0; i < 4; ++i)
+  {
+    arma::vec mean(2);
+    mean[0] = 10.0 * std::cos(i * M_PI / 2.0);
+    mean[1] = 10.0 * std::sin(i * M_PI / 2.0);
+    emission.push_back(GaussianDistribution(mean,
+        arma::eye<arma::mat>(2, 2)));
+  }
+
+  arma::vec initial("0.25 0.25 0.25 0.25");
+  arma::mat transition("0.8 0.0 0.0 0.2;"
+                       "0.2 0.8 0.0 0.0;"
+                       "0.0 0.2 0.8 0.0;"
+                       "0.0 0.0 0.2 0.8");
+  HMM<GaussianDistribution> hmm(initial, transition, emission);
+
+  arma::mat observations;
+  arma::Col<size_t> states;
+  hmm.Generate(500, observations, states, 1);
+
+  arma::Col<size_t> exactStates, beamStates;
+  const double exact = hmm.Predict(observations, exactStates);
+
+  // No limits.
+  double beam = hmm.BeamPredict(observations, beamStates, 0);
+  BOOST_REQUIRE_CLOSE(beam, exact, 1e-8);
+  for (size_t t = 0; t < observations.n_cols; ++t)
+    BOOST_REQUIRE_EQUAL(beamStates[t], exactStates[t]);
+
+  // A beam of two states, and a margin.
+  beam = hmm.BeamPredict(observations, beamStates, 2, 20.0);
+  BOOST_REQUIRE_CLOSE(beam, exact, 1e-8);
+  for (size_t t = 0; t < observations.n_cols; ++t)
+  {
+    BOOST_REQUIRE_EQUAL(beamStates[t], exactStates[t]);
+    BOOST_REQUIRE_EQUAL(beamStates[t], states[t]);
+  }
+}
+
+/**
+ * Make sure that an HMM with a sparse transition matrix gives the same results
+ * as with a dense one, for inference and for both kinds of training, and that
+ * training keeps the sparsity pattern.
+ */
+BOOST_AUTO_TEST_CASE(SparseTransitionHMMTest)
+{
+  std::vector<GaussianDistribution> emission;
+  for (size_t i = 0; i < 4; ++i)
+  {
+    arma::vec mean(2);
+    mean[0] = 3.0 * std::cos(i * M_PI / 2.0);
+    mean[1] = 3.0 * std::sin(i * M_PI / 2.0);
+    emission.push_back(GaussianDistribution(mean,
+        arma::eye<arma::mat>(2, 2)));
+  }
+
+  arma::vec initial("0.4 0.3 0.2 0.1");
+  arma::mat transition("0.7 0.0 0.0 0.3;"
+                       "0.3 0.6 0.0 0.0;"
+                       "0.0 0.4 0.9 0.0;"
+                       "0.0 0.0 0.1 0.7");
+  HMM<GaussianDistribution> hmm(initial, transition, emission);
+  HMM<GaussianDistribution, arma::sp_mat> sparseHMM(initial,
+      arma::sp_mat(transition), emission);
+
+  std::vector<arma::mat> observations(10);
+  std::vector<arma::Col<size_t> > states(10);
+  for (size_t i = 0; i < 10; ++i)
+    hmm.Generate(200, observations[i], states[i], i % 4);
+
+  // Inference.
+  arma::mat stateProb, sparseStateProb;
+  BOOST_REQUIRE_CLOSE(hmm.Estimate(observations[0], stateProb),
+      sparseHMM.Estimate(observations[0], sparseStateProb), 1e-8);
+  for (size_t i = 0; i < stateProb.n_elem; ++i)
+    BOOST_REQUIRE_SMALL(stateProb[i] - sparseStateProb[i], 1e-10);
+
+  BOOST_REQUIRE_CLOSE(hmm.LogLikelihood(observations[0]),
+      sparseHMM.LogLikelihood(observations[0]), 1e-8);
+
+  arma::Col<size_t> stateSeq, sparseStateSeq;
+  BOOST_REQUIRE_CLOSE(hmm.Predict(observations[0], stateSeq),
+      sparseHMM.Predict(observations[0], sparseStateSeq), 1e-8);
+  for (size_t t = 0; t < stateSeq.n_elem; ++t)
+    BOOST_REQUIRE_EQUAL(stateSeq[t], sparseStateSeq[t]);
+
+  // Unlabeled training.
+  hmm.Train(observations);
+  sparseHMM.Train(observations);
+
+  BOOST_REQUIRE_EQUAL(sparseHMM.Transition().n_nonzero, 8);
+  for (size_t i = 0; i < 4; ++i)
+  {
+    for (size_t j = 0; j < 4; ++j)
+    {
+      if (transition(i, j) == 0.0)
+      {
+        BOOST_REQUIRE_SMALL(hmm.Transition()(i, j), 1e-10);
+        BOOST_REQUIRE_SMALL((double) sparseHMM.Transition()(i, j), 1e-10);
+      }
+      else
+      {
+        BOOST_REQUIRE_CLOSE(hmm.Transition()(i, j),
+            (double) sparseHMM.Transition()(i, j), 1e-3);
+      }
+    }
+  }
+
+  // Labeled training.
+  hmm.Train(observations, states);
+  sparseHMM.Train(observations, states);
+
+  for (size_t i = 0; i < 4; ++i)
+    for (size_t j = 0; j < 4; ++j)
+      BOOST_REQUIRE_SMALL(hmm.Transition()(i, j) -
+          (double) sparseHMM.Transition()(i, j), 1e-10);
+}
+
 /**
  * Ensure that Gaussian HMMs can be trained properly, for the labeled training
  * case and also for the unlabeled training case.
@@ -992,7 +1262,10 @@ BOOST_AUTO_TEST_CASE(GMMHMMLoadSaveTest)
     for (size_t i = 0; i < hmm.Emission()[j].Gaussians(); ++i)
     {
       hmm.Emission()[j].Component(i).Mean().randu();
-      hmm.Emission()[j].Component(i).Covariance().randu();
+      const size_t dimensionality =
+          hmm.Emission()[j].Component(i).Dimensionality();
+      hmm.Emission()[j].Component(i).Covariance(
+          arma::randu<arma::mat>(dimensionality, dimensionality));
     }
   }
 
@@ -1048,7 +1321,9 @@ BOOST_AUTO_TEST_CASE(GaussianHMMLoadSaveTest)
   for(size_t j = 0; j < hmm.Emission().size(); ++j)
   {
     hmm.Emission()[j].Mean().randu();
-    hmm.Emission()[j].Covariance().randu();
+    const size_t dimensionality = hmm.Emission()[j].Dimensionality();
+    hmm.Emission()[j].Covariance(arma::randu<arma::mat>(dimensionality,
+        dimensionality));
   }
 
   util::SaveRestoreUtility sr;
@@ -1132,5 +1407,245 @@ BOOST_AUTO_TEST_CASE(DiscreteHMMLoadSaveTest)
   }
 }
 
+/**
+ * Train an HMM regression on labeled sequences from two regimes, with the
+ * emissions estimated in parallel, and make sure that the regressions are
+ * recovered and that the batch Predict() and Filter() agree with the
+ * single-sequence versions.
+ */
+BOOST_AUTO_TEST_CASE(HMMRegressionBatchTest)
+{
+  // Regime 0 is y = 1 + 2x and regime 1 is y = -3 - x, with a little noise.
+  std::vector<arma::mat> predictors(6);
+  std::vector<arma::vec> responses(6);
+  std::vector<arma::Col<size_t> > states(6);
+  for (size_t seq = 0; seq < 6; ++seq)
+  {
+    const size_t length = 200 + 50 * seq;
+    predictors[seq] = arma::randu<arma::mat>(1, length);
+    responses[seq].set_size(length);
+    states[seq].set_size(length);
+
+    size_t state = seq % 2;
+    for (size_t t = 0; t < length; ++t)
+    {
+      if (math::Random() < 0.05)
+        state = 1 - state;
+      states[seq][t] = state;
+
+      const double x = predictors[seq](0, t);
+      responses[seq][t] = ((state == 0) ? (1.0 + 2.0 * x) : (-3.0 - x)) +
+          0.05 * math::RandNormal();
+    }
+  }
+
+  RegressionDistribution emission(arma::randu<arma::mat>(1, 10),
+      arma::randu<arma::vec>(10));
+  HMMRegression hmmr(2, emission);
+
+  util::SetNumThreads(4);
+  hmmr.Train(predictors, responses, states);
+
+  BOOST_REQUIRE_CLOSE(hmmr.Emission()[0].Parameters()[0], 1.0, 2.0);
+  BOOST_REQUIRE_CLOSE(hmmr.Emission()[0].Parameters()[1], 2.0, 2.0);
+  BOOST_REQUIRE_CLOSE(hmmr.Emission()[1].Parameters()[0], -3.0, 2.0);
+  BOOST_REQUIRE_CLOSE(hmmr.Emission()[1].Parameters()[1], -1.0, 2.0);
+
+  std::vector<arma::Col<size_t> > stateSeq;
+  arma::vec logLikelihoods;
+  hmmr.Predict(predictors, responses, stateSeq, logLikelihoods);
+
+  std::vector<arma::vec> filterSeq;
+  hmmr.Filter(predictors, responses, filterSeq, 1);
+  util::SetNumThreads(0);
+
+  BOOST_REQUIRE_EQUAL(stateSeq.size(), 6);
+  BOOST_REQUIRE_EQUAL(logLikelihoods.n_elem, 6);
+  BOOST_REQUIRE_EQUAL(filterSeq.size(), 6);
+  for (size_t seq = 0; seq < 6; ++seq)
+  {
+    arma::Col<size_t> singleStateSeq;
+    const double logLikelihood = hmmr.Predict(predictors[seq], responses[seq],
+        singleStateSeq);
+    BOOST_REQUIRE_CLOSE(logLikelihoods[seq], logLikelihood, 1e-5);
+    BOOST_REQUIRE_EQUAL(stateSeq[seq].n_elem, singleStateSeq.n_elem);
+    for (size_t t = 0; t < singleStateSeq.n_elem; ++t)
+      BOOST_REQUIRE_EQUAL(stateSeq[seq][t], singleStateSeq[t]);
+
+    arma::vec singleFilterSeq;
+    hmmr.Filter(predictors[seq], responses[seq], singleFilterSeq, 1);
+    BOOST_REQUIRE_EQUAL(filterSeq[seq].n_elem, singleFilterSeq.n_elem);
+    for (size_t t = 0; t < singleFilterSeq.n_elem; ++t)
+      BOOST_REQUIRE_CLOSE(filterSeq[seq][t], singleFilterSeq[t], 1e-5);
+  }
+}
+
+/**
+ * Filter a sequence from a Gaussian HMM one observation at a time and in
+ * blocks, and make sure that the forward probabilities, the log-likelihood and
+ * the predictive probabilities match those of the Forward algorithm.
+ */
+BOOST_AUTO_TEST_CASE(HMMFilterTest)
+{
+  std::vector<GaussianDistribution> emission;
+  emission.push_back(GaussianDistribution("0.0 0.0", "1.0 0.2; 0.2 1.5"));
+  emission.push_back(GaussianDistribution("2.0 1.0", "0.7 0.3; 0.3 2.6"));
+  emission.push_back(GaussianDistribution("1.0 3.0", "1.0 0.0; 0.0 1.0"));
+
+  arma::mat transition("0.3 0.5 0.7;"
+                       "0.3 0.4 0.1;"
+                       "0.4 0.1 0.2");
+  arma::vec initial("0.2 0.5 0.3");
+
+  HMM<GaussianDistribution> hmm(initial, transition, emission);
+
+  arma::mat dataSeq;
+  arma::Col<size_t> stateSeq;
+  hmm.Generate(200, dataSeq, stateSeq);
+
+  arma::mat stateProb, forwardProb, backwardProb;
+  arma::vec scales;
+  hmm.Estimate(dataSeq, stateProb, forwardProb, backwardProb, scales);
+
+  HMMFilter<HMM<GaussianDistribution> > filter(hmm);
+  BOOST_REQUIRE_EQUAL(filter.Steps(), 0);
+
+  // Before any observations, the next state follows the initial
+  // probabilities.
+  arma::vec prediction;
+  filter.Predict(prediction);
+  for (size_t i = 0; i < 3; ++i)
+    BOOST_REQUIRE_CLOSE(prediction[i], initial[i], 1e-5);
+
+  for (size_t t = 0; t < dataSeq.n_cols; ++t)
+  {
+    // The predictive probability of the next observation is its scaling
+    // factor in the Forward algorithm.
+    BOOST_REQUIRE_CLOSE(filter.Probability(dataSeq.col(t)), scales[t], 1e-5);
+
+    const arma::vec& forward = filter.Update(dataSeq.col(t));
+    BOOST_REQUIRE_EQUAL(forward.n_elem, 3);
+    for (size_t i = 0; i < 3; ++i)
+      BOOST_REQUIRE_CLOSE(forward[i] + 1.0, forwardProb(i, t) + 1.0, 1e-5);
+  }
+
+  BOOST_REQUIRE_EQUAL(filter.Steps(), dataSeq.n_cols);
+  BOOST_REQUIRE_CLOSE(filter.LogLikelihood(), hmm.LogLikelihood(dataSeq),
+      1e-5);
+
+  // Two steps ahead, the state distribution is the forward probabilities
+  // after two transitions.
+  filter.Predict(prediction, 2);
+  const arma::vec expected = transition * transition *
+      forwardProb.col(dataSeq.n_cols - 1);
+  for (size_t i = 0; i < 3; ++i)
+    BOOST_REQUIRE_CLOSE(prediction[i], expected[i], 1e-5);
+
+  // Now filter the same sequence again in blocks of 7 observations.
+  filter.Reset();
+  BOOST_REQUIRE_EQUAL(filter.Steps(), 0);
+  for (size_t t = 0; t < dataSeq.n_cols; t += 7)
+  {
+    const size_t end = std::min(t + 7, (size_t) dataSeq.n_cols);
+    const arma::vec& forward = filter.Update(dataSeq.cols(t, end - 1));
+    for (size_t i = 0; i < 3; ++i)
+      BOOST_REQUIRE_CLOSE(forward[i] + 1.0, forwardProb(i, end - 1) + 1.0,
+          1e-5);
+  }
+
+  BOOST_REQUIRE_CLOSE(filter.LogLikelihood(), hmm.LogLikelihood(dataSeq),
+      1e-5);
+}
+
+/**
+ * Generate many sequences from a Gaussian HMM at once, in parallel, and make
+ * sure that the transitions and emissions follow the model, and that the
+ * sequences do not depend on the number of threads.
+ */
+BOOST_AUTO_TEST_CASE(HMMBatchGenerateTest)
+{
+  std::vector<GaussianDistribution> emission;
+  emission.push_back(GaussianDistribution("0.0 0.0", "1.0 0.2; 0.2 1.5"));
+  emission.push_back(GaussianDistribution("6.0 3.0", "0.7 0.3; 0.3 2.6"));
+  emission.push_back(GaussianDistribution("2.0 9.0", "1.0 0.0; 0.0 1.0"));
+
+  // The transition from state 2 to state 1 is impossible.
+  arma::mat transition("0.3 0.5 0.7;"
+                       "0.3 0.4 0.0;"
+                       "0.4 0.1 0.3");
+  HMM<GaussianDistribution> hmm(arma::vec("1.0 0.0 0.0"), transition,
+      emission);
+
+  math::RandomSeed(23);
+  util::SetNumThreads(4);
+  std::vector<arma::mat> dataSequences;
+  std::vector<arma::Col<size_t> > stateSequences;
+  hmm.Generate(20, 1000, dataSequences, stateSequences, 1);
+  util::SetNumThreads(0);
+
+  BOOST_REQUIRE_EQUAL(dataSequences.size(), 20);
+  BOOST_REQUIRE_EQUAL(stateSequences.size(), 20);
+
+  arma::mat transitionCounts(3, 3);
+  transitionCounts.zeros();
+  arma::mat sums(2, 3);
+  sums.zeros();
+  arma::vec counts(3);
+  counts.zeros();
+  for (size_t seq = 0; seq < 20; ++seq)
+  {
+    BOOST_REQUIRE_EQUAL(dataSequences[seq].n_rows, 2);
+    BOOST_REQUIRE_EQUAL(dataSequences[seq].n_cols, 1000);
+    BOOST_REQUIRE_EQUAL(stateSequences[seq].n_elem, 1000);
+    BOOST_REQUIRE_EQUAL(stateSequences[seq][0], 1);
+
+    for (size_t t = 0; t < 1000; ++t)
+    {
+      const size_t state = stateSequences[seq][t];
+      sums.col(state) += dataSequences[seq].col(t);
+      ++counts[state];
+      if (t > 0)
+        ++transitionCounts(state, stateSequences[seq][t - 1]);
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL(transitionCounts(1, 2), 0.0);
+  for (size_t j = 0; j < 3; ++j)
+  {
+    const double total = arma::accu(transitionCounts.col(j));
+    for (size_t i = 0; i < 3; ++i)
+    {
+      if (transition(i, j) > 0.0)
+        BOOST_REQUIRE_CLOSE(transitionCounts(i, j) / total, transition(i, j),
+            15.0);
+    }
+
+    for (size_t d = 0; d < 2; ++d)
+    {
+      if (emission[j].Mean()[d] == 0.0)
+        BOOST_REQUIRE_SMALL(sums(d, j) / counts[j], 0.1);
+      else
+        BOOST_REQUIRE_CLOSE(sums(d, j) / counts[j], emission[j].Mean()[d],
+            3.0);
+    }
+  }
+
+  // With the same seed, one thread generates the same sequences.
+  math::RandomSeed(23);
+  util::SetNumThreads(1);
+  std::vector<arma::mat> serialDataSequences;
+  std::vector<arma::Col<size_t> > serialStateSequences;
+  hmm.Generate(20, 1000, serialDataSequences, serialStateSequences, 1);
+  util::SetNumThreads(0);
+
+  for (size_t seq = 0; seq < 20; ++seq)
+  {
+    for (size_t t = 0; t < 1000; ++t)
+      BOOST_REQUIRE_EQUAL(stateSequences[seq][t], serialStateSequences[seq][t]);
+    for (size_t i = 0; i < dataSequences[seq].n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(dataSequences[seq][i], serialDataSequences[seq][i]);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 
@@ -0,0 +1,199 @@
+/**
+ * @file kde_test.cpp
+ *
+ * Tests for the KDE class.
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/methods/kde/kde.hpp>
+#include <mlpack/core/kernels/epanechnikov_kernel.hpp>
+#include <mlpack/core/kernels/triangular_kernel.hpp>
+#include <mlpack/core/kernels/spherical_kernel.hpp>
+#include <mlpack/core/tree/cover_tree.hpp>
+#include <boost/test/unit_test.hpp>
+#include "old_boost_test_definitions.hpp"
+
+using namespace mlpack;
+using namespace mlpack::kde;
+using namespace mlpack::kernel;
+using namespace mlpack::tree;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(KDETest);
+
+typedef CoverTree<metric::EuclideanDistance, FirstPointIsRoot, KDEStat>
+    KDECoverTree;
+
+// Make sure that every estimate is within the error bounds of the naive
+// estimate.
+void CheckBounds(const arma::vec& estimations,
+                 const arma::vec& naiveEstimations,
+                 const double relError,
+                 const double absError)
+{
+  BOOST_REQUIRE_EQUAL(estimations.n_elem, naiveEstimations.n_elem);
+  for (size_t i = 0; i < estimations.n_elem; ++i)
+  {
+    BOOST_REQUIRE_LE(fabs(estimations[i] - naiveEstimations[i]),
+        relError * naiveEstimations[i] + absError + 1e-12);
+  }
+}
+
+/**
+ * Compute a tiny density by hand.
+ */
+BOOST_AUTO_TEST_CASE(NaiveHandTest)
+{
+  arma::mat reference("0 1");
+  arma::mat query("0");
+
+  KDE<> kde(reference, GaussianKernel(1.0), 0.0, 0.0, true);
+  arma::vec estimations;
+  kde.Evaluate(query, estimations);
+
+  BOOST_REQUIRE_EQUAL(estimations.n_elem, 1);
+  BOOST_REQUIRE_CLOSE(estimations[0],
+      (1.0 + exp(-0.5)) / (2.0 * sqrt(2.0 * M_PI)), 1e-8);
+
+  // Each reference point contributes to its own estimate.
+  kde.Evaluate(estimations);
+
+  BOOST_REQUIRE_EQUAL(estimations.n_elem, 2);
+  BOOST_REQUIRE_CLOSE(estimations[0], estimations[1], 1e-8);
+  BOOST_REQUIRE_CLOSE(estimations[0],
+      (1.0 + exp(-0.5)) / (2.0 * sqrt(2.0 * M_PI)), 1e-8);
+}
+
+/**
+ * Dual-tree and single-tree estimates with kd-trees are within the error
+ * bounds of the naive estimates, and in the original order of the points.
+ */
+BOOST_AUTO_TEST_CASE(KDTreeVsNaiveTest)
+{
+  arma::mat reference = arma::randu<arma::mat>(3, 1000);
+  arma::mat query = arma::randu<arma::mat>(3, 300);
+
+  KDE<> naive(reference, GaussianKernel(0.2), 0.0, 0.0, true);
+  arma::vec naiveMono, naiveBi;
+  naive.Evaluate(naiveMono);
+  naive.Evaluate(query, naiveBi);
+
+  for (size_t single = 0; single < 2; ++single)
+  {
+    KDE<> kde(reference, GaussianKernel(0.2), 0.05, 0.0, false,
+        (single == 1));
+    arma::vec estimations;
+
+    kde.Evaluate(estimations);
+    CheckBounds(estimations, naiveMono, 0.05, 0.0);
+
+    kde.Evaluate(query, estimations);
+    CheckBounds(estimations, naiveBi, 0.05, 0.0);
+
+    // Something must have been pruned.
+    BOOST_REQUIRE_LT(kde.BaseCases(), 1300 * 1000);
+  }
+}
+
+/**
+ * The absolute error bound is respected, and with no error allowed the
+ * estimates are exact.
+ */
+BOOST_AUTO_TEST_CASE(ErrorBoundTest)
+{
+  arma::mat reference = arma::randu<arma::mat>(2, 800);
+
+  KDE<EpanechnikovKernel> naive(reference, EpanechnikovKernel(0.1), 0.0, 0.0,
+      true);
+  arma::vec naiveEstimations;
+  naive.Evaluate(naiveEstimations);
+
+  KDE<EpanechnikovKernel> absolute(reference, EpanechnikovKernel(0.1), 0.0,
+      0.5);
+  arma::vec estimations;
+  absolute.Evaluate(estimations);
+  CheckBounds(estimations, naiveEstimations, 0.0, 0.5);
+
+  KDE<EpanechnikovKernel> exact(reference, EpanechnikovKernel(0.1), 0.0, 0.0);
+  exact.Evaluate(estimations);
+  for (size_t i = 0; i < estimations.n_elem; ++i)
+  {
+    if (naiveEstimations[i] < 1e-10)
+      BOOST_REQUIRE_SMALL(estimations[i], 1e-10);
+    else
+      BOOST_REQUIRE_CLOSE(estimations[i], naiveEstimations[i], 1e-8);
+  }
+}
+
+/**
+ * Estimates with cover trees are within the error bounds of the naive
+ * estimates, for the triangular and spherical kernels.
+ */
+BOOST_AUTO_TEST_CASE(CoverTreeVsNaiveTest)
+{
+  arma::mat reference = arma::randu<arma::mat>(3, 500);
+  arma::mat query = arma::randu<arma::mat>(3, 200);
+
+  KDE<TriangularKernel> naive(reference, TriangularKernel(0.3), 0.0, 0.0,
+      true);
+  arma::vec naiveEstimations;
+  naive.Evaluate(query, naiveEstimations);
+
+  for (size_t single = 0; single < 2; ++single)
+  {
+    KDE<TriangularKernel, KDECoverTree> kde(reference, TriangularKernel(0.3),
+        0.1, 0.0, false, (single == 1));
+    arma::vec estimations;
+    kde.Evaluate(query, estimations);
+    CheckBounds(estimations, naiveEstimations, 0.1, 0.0);
+  }
+
+  KDE<SphericalKernel> naiveSpherical(reference, SphericalKernel(0.3), 0.0,
+      0.0, true);
+  naiveSpherical.Evaluate(naiveEstimations);
+
+  KDE<SphericalKernel, KDECoverTree> kde(reference, SphericalKernel(0.3), 0.0,
+      0.0);
+  arma::vec estimations;
+  kde.Evaluate(estimations);
+  CheckBounds(estimations, naiveEstimations, 1e-8, 0.0);
+}
+
+/**
+ * Parallel evaluation gives estimates within the error bounds, with kd-trees
+ * and cover trees.
+ */
+BOOST_AUTO_TEST_CASE(ParallelKDETest)
+{
+  arma::mat reference = arma::randu<arma::mat>(3, 2000);
+
+  KDE<> naive(reference, GaussianKernel(0.2), 0.0, 0.0, true);
+  naive.NumThreads() = 4;
+  arma::vec naiveEstimations;
+  naive.Evaluate(naiveEstimations);
+
+  KDE<> kde(reference, GaussianKernel(0.2), 0.05, 0.0);
+  kde.NumThreads() = 4;
+  arma::vec estimations;
+  kde.Evaluate(estimations);
+  CheckBounds(estimations, naiveEstimations, 0.05, 0.0);
+
+  KDE<GaussianKernel, KDECoverTree> coverKDE(reference, GaussianKernel(0.2),
+      0.05, 0.0);
+  coverKDE.NumThreads() = 4;
+  coverKDE.Evaluate(estimations);
+  CheckBounds(estimations, naiveEstimations, 0.05, 0.0);
+}
+
+/**
+ * The triangular kernel is normalized to integrate to 1.
+ */
+BOOST_AUTO_TEST_CASE(TriangularNormalizerTest)
+{
+  TriangularKernel kernel(2.0);
+
+  BOOST_REQUIRE_CLOSE(kernel.Evaluate(1.0), 0.5, 1e-8);
+  BOOST_REQUIRE_CLOSE(kernel.Normalizer(1), 2.0, 1e-8);
+  BOOST_REQUIRE_CLOSE(kernel.Normalizer(2), M_PI * 4.0 / 3.0, 1e-8);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -6,7 +6,11 @@
  */
 #include <mlpack/core.hpp>
 #include <mlpack/core/kernels/gaussian_kernel.hpp>
+#include <mlpack/core/kernels/linear_kernel.hpp>
+#include <mlpack/core/kernels/polynomial_kernel.hpp>
+#include <mlpack/core/kernels/laplacian_kernel.hpp>
 #include <mlpack/methods/kernel_pca/kernel_rules/nystroem_method.hpp>
+#include <mlpack/methods/kernel_pca/kernel_rules/randomized_method.hpp>
 #include <mlpack/methods/kernel_pca/kernel_pca.hpp>
 
 #include <boost/test/unit_test.hpp>
@@ -145,4 +149,147 @@ BOOST_AUTO_TEST_CASE(CircleTransformationTestNystroem)
   BOOST_REQUIRE_EQUAL(ranges[1].Contains(ranges[2]), false);
 }
 
+/**
+ * Make sure that the kernel matrices built from the Gram matrix of the data
+ * (for the linear, polynomial and Gaussian kernels) are the same as the kernel
+ * matrices built with one kernel evaluation for each pair of points.  The
+ * dataset is bigger than one block, so that the blocked construction is
+ * checked too.
+ */
+BOOST_AUTO_TEST_CASE(NaiveKernelMatrixTest)
+{
+  arma::mat data = arma::randu<arma::mat>(5, 150);
+
+  arma::mat fastMatrix, naiveMatrix;
+
+  LinearKernel linear;
+  NaiveKernelRule<LinearKernel>::KernelMatrix(data, linear, fastMatrix);
+  NaiveKernelRule<LinearKernel>::KernelMatrix<LinearKernel>(data, linear,
+      naiveMatrix);
+  for (size_t i = 0; i < fastMatrix.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(fastMatrix[i], naiveMatrix[i], 1e-5);
+
+  PolynomialKernel polynomial(2.0, 1.0);
+  NaiveKernelRule<PolynomialKernel>::KernelMatrix(data, polynomial,
+      fastMatrix);
+  NaiveKernelRule<PolynomialKernel>::KernelMatrix<PolynomialKernel>(data,
+      polynomial, naiveMatrix);
+  for (size_t i = 0; i < fastMatrix.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(fastMatrix[i], naiveMatrix[i], 1e-5);
+
+  GaussianKernel gaussian(0.5);
+  NaiveKernelRule<GaussianKernel>::KernelMatrix(data, gaussian, fastMatrix);
+  NaiveKernelRule<GaussianKernel>::KernelMatrix<GaussianKernel>(data,
+      gaussian, naiveMatrix);
+  BOOST_REQUIRE_EQUAL(fastMatrix.n_rows, 150);
+  BOOST_REQUIRE_EQUAL(fastMatrix.n_cols, 150);
+  for (size_t i = 0; i < fastMatrix.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(fastMatrix[i], naiveMatrix[i], 1e-5);
+}
+
+/**
+ * The Gaussian kernel matrix built with the fast exponential should be within
+ * the accuracy of the approximation of the exact one.
+ */
+BOOST_AUTO_TEST_CASE(FastExpKernelMatrixTest)
+{
+  arma::mat data = arma::randu<arma::mat>(5, 150);
+  GaussianKernel gaussian(0.3);
+
+  arma::mat exactMatrix, fastMatrix;
+  NaiveKernelRule<GaussianKernel>::KernelMatrix(data, gaussian, exactMatrix);
+  NaiveKernelRule<GaussianKernel, FastExp<> >::KernelMatrix(data, gaussian,
+      fastMatrix);
+  BOOST_REQUIRE_EQUAL(fastMatrix.n_rows, 150);
+  BOOST_REQUIRE_EQUAL(fastMatrix.n_cols, 150);
+  for (size_t i = 0; i < fastMatrix.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(fastMatrix[i], exactMatrix[i], 1e-5);
+
+  // The projections should not change either.
+  KernelPCA<GaussianKernel> kpca(gaussian);
+  KernelPCA<GaussianKernel, NaiveKernelRule<GaussianKernel, FastExp<> > >
+      fastKpca(gaussian);
+  arma::mat transformedData, fastData, eigvec;
+  arma::vec eigval, fastEigval;
+  kpca.Apply(data, transformedData, eigval, eigvec, 1);
+  fastKpca.Apply(data, fastData, fastEigval, eigvec, 1);
+  for (size_t i = 0; i < 3; ++i)
+    BOOST_REQUIRE_CLOSE(fastEigval[i], eigval[i], 1e-4);
+
+  // The eigenvectors are only defined up to their sign.
+  const double sign = (arma::dot(fastData.row(0), transformedData.row(0)) <
+      0.0) ? -1.0 : 1.0;
+  for (size_t i = 0; i < data.n_cols; ++i)
+    BOOST_REQUIRE_SMALL(sign * fastData(0, i) - transformedData(0, i), 1e-5);
+}
+
+/**
+ * A kernel matrix built with a cache must be the same as without it, and a
+ * second KernelPCA run on the same data must take all the kernel evaluations
+ * from the cache.
+ */
+BOOST_AUTO_TEST_CASE(CachedKernelMatrixTest)
+{
+  arma::mat data = arma::randu<arma::mat>(3, 100);
+  LaplacianKernel laplacian(0.5);
+
+  arma::mat kernelMatrix, cachedMatrix;
+  NaiveKernelRule<LaplacianKernel>::KernelMatrix(data, laplacian,
+      kernelMatrix);
+
+  // The upper triangle (with the diagonal) of 100 points has 5050 pairs.
+  KernelCache cache(10000);
+  NaiveKernelRule<LaplacianKernel>::KernelMatrix(data, laplacian,
+      cachedMatrix, &cache);
+  BOOST_REQUIRE_EQUAL(cache.Size(), 5050);
+  BOOST_REQUIRE_EQUAL(cache.Hits(), 0);
+  for (size_t i = 0; i < kernelMatrix.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(cachedMatrix[i], kernelMatrix[i], 1e-5);
+
+  KernelPCA<LaplacianKernel> kpca(laplacian);
+  kpca.Cache() = &cache;
+  arma::mat transformedData, cachedData;
+  arma::vec eigval;
+  kpca.Apply(data, cachedData, eigval);
+  BOOST_REQUIRE_EQUAL(cache.Hits(), 5050);
+  BOOST_REQUIRE_EQUAL(cache.Misses(), 5050);
+
+  kpca.Cache() = NULL;
+  kpca.Apply(data, transformedData, eigval);
+  for (size_t i = 0; i < transformedData.n_elem; ++i)
+  {
+    if (std::abs(transformedData[i]) < 1e-8)
+      BOOST_REQUIRE_SMALL(cachedData[i], 1e-8);
+    else
+      BOOST_REQUIRE_CLOSE(cachedData[i], transformedData[i], 1e-5);
+  }
+}
+
+/**
+ * The randomized kernel rule should find the same largest eigenvalues of the
+ * kernel matrix as the naive rule.
+ */
+BOOST_AUTO_TEST_CASE(RandomizedKernelRuleTest)
+{
+  arma::mat data = arma::randu<arma::mat>(3, 200);
+
+  KernelPCA<GaussianKernel> naive(GaussianKernel(2.0));
+  arma::mat transformedData, eigvec;
+  arma::vec eigval;
+  naive.Apply(data, transformedData, eigval, eigvec, 5);
+
+  KernelPCA<GaussianKernel, RandomizedKernelRule<GaussianKernel> >
+      randomized(GaussianKernel(2.0));
+  arma::mat randomizedTransformedData, randomizedEigvec;
+  arma::vec randomizedEigval;
+  randomized.Apply(data, randomizedTransformedData, randomizedEigval,
+      randomizedEigvec, 5);
+
+  BOOST_REQUIRE_EQUAL(randomizedEigval.n_elem, 5);
+  BOOST_REQUIRE_EQUAL(randomizedTransformedData.n_rows, 5);
+  BOOST_REQUIRE_EQUAL(randomizedTransformedData.n_cols, 200);
+  for (size_t i = 0; i < 5; ++i)
+    BOOST_REQUIRE_CLOSE(randomizedEigval[i], eigval[i], 1.0);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
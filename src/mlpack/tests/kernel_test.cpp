@@ -15,6 +15,7 @@
 #include <mlpack/core/kernels/polynomial_kernel.hpp>
 #include <mlpack/core/kernels/spherical_kernel.hpp>
 #include <mlpack/core/kernels/pspectrum_string_kernel.hpp>
+#include <mlpack/core/kernels/kernel_cache.hpp>
 #include <mlpack/core/metrics/lmetric.hpp>
 #include <mlpack/core/metrics/mahalanobis_distance.hpp>
 
@@ -203,6 +204,59 @@ BOOST_AUTO_TEST_CASE(md_full_covariance)
   BOOST_REQUIRE_CLOSE(md.Evaluate(b, a), 15.7, 1e-5);
 }
 
+/**
+ * The Euclidean distance between points transformed by the factor of the
+ * covariance matrix must be the Mahalanobis distance; a non-symmetric matrix
+ * only contributes its symmetric part.
+ */
+BOOST_AUTO_TEST_CASE(md_transformed_euclidean)
+{
+  arma::mat factor = arma::randu<arma::mat>(5, 5);
+  arma::mat cov = trans(factor) * factor;
+  cov(0, 1) += 0.3;
+  cov(1, 0) -= 0.3;
+  MahalanobisDistance<> md(cov);
+
+  arma::mat data = arma::randu<arma::mat>(5, 20);
+  arma::mat transformed;
+  md.Transform(data, transformed);
+
+  BOOST_REQUIRE(md.Factored());
+  BOOST_REQUIRE_EQUAL(transformed.n_cols, data.n_cols);
+
+  for (size_t i = 0; i < data.n_cols; ++i)
+    for (size_t j = i + 1; j < data.n_cols; ++j)
+      BOOST_REQUIRE_CLOSE(EuclideanDistance::Evaluate(transformed.col(i),
+          transformed.col(j)), md.Evaluate(data.col(i), data.col(j)), 1e-5);
+
+  // Modifying the covariance matrix discards the factor.
+  md.Covariance() *= 2.0;
+  BOOST_REQUIRE(!md.Factored());
+  md.Transform(data, transformed);
+  BOOST_REQUIRE_CLOSE(EuclideanDistance::Evaluate(transformed.col(0),
+      transformed.col(1)), md.Evaluate(data.col(0), data.col(1)), 1e-5);
+}
+
+/**
+ * A low-rank covariance matrix gives a factor with fewer rows, so the
+ * transformed points have fewer dimensions.
+ */
+BOOST_AUTO_TEST_CASE(md_low_rank_transformation)
+{
+  arma::mat factor = arma::randu<arma::mat>(2, 6);
+  MahalanobisDistance<false> md(trans(factor) * factor);
+  md.Factor();
+
+  BOOST_REQUIRE_EQUAL(md.Transformation().n_rows, 2);
+  BOOST_REQUIRE_EQUAL(md.Transformation().n_cols, 6);
+
+  arma::vec a = arma::randu<arma::vec>(6);
+  arma::vec b = arma::randu<arma::vec>(6);
+  BOOST_REQUIRE_CLOSE(SquaredEuclideanDistance::Evaluate(
+      arma::vec(md.Transformation() * a), arma::vec(md.Transformation() * b)),
+      md.Evaluate(a, b), 1e-5);
+}
+
 /**
  * Simple test case for the cosine distance.
  */
@@ -590,4 +644,90 @@ BOOST_AUTO_TEST_CASE(PSpectrumStringEvaluateTest)
   BOOST_REQUIRE_CLOSE(p.Evaluate(b, a), 11.0, 1e-5);
 }
 
+/**
+ * Ensure that the p-spectrum kernel gives each distinct substring one ID, and
+ * that BuildIndex() picks up modified substring counts.
+ */
+BOOST_AUTO_TEST_CASE(PSpectrumStringBuildIndexTest)
+{
+  std::vector<std::vector<std::string> > dataset;
+  dataset.push_back(std::vector<std::string>());
+  dataset[0].push_back("hello");
+  dataset[0].push_back("jello");
+
+  PSpectrumStringKernel p(dataset, 3);
+
+  // hel, ell, llo, jel.
+  BOOST_REQUIRE_EQUAL(p.NumSubstrings(), 4);
+
+  arma::vec a("0 0");
+  arma::vec b("0 1");
+  BOOST_REQUIRE_CLOSE(p.Evaluate(a, b), 2.0, 1e-5);
+
+  // Pretend that "jello" contains "hel" twice.
+  p.Counts()[0][1]["hel"] = 2;
+  p.BuildIndex();
+
+  BOOST_REQUIRE_EQUAL(p.NumSubstrings(), 4);
+  BOOST_REQUIRE_CLOSE(p.Evaluate(a, b), 4.0, 1e-5);
+  BOOST_REQUIRE_CLOSE(p.Evaluate(b, a), 4.0, 1e-5);
+  BOOST_REQUIRE_CLOSE(p.Evaluate(b, b), 7.0, 1e-5);
+}
+
+/**
+ * The kernel cache must drop the least recently used evaluation when it is
+ * full, count its hits and misses, and be cleared when it is bound to other
+ * data.
+ */
+BOOST_AUTO_TEST_CASE(KernelCacheTest)
+{
+  KernelCache cache(3, 1);
+  BOOST_REQUIRE_EQUAL(cache.Capacity(), 3);
+
+  double value = 0.0;
+  BOOST_REQUIRE(!cache.Lookup(0, 1, value));
+  cache.Insert(0, 1, 1.0);
+  cache.Insert(0, 2, 2.0);
+  cache.Insert(1, 2, 3.0);
+  BOOST_REQUIRE_EQUAL(cache.Size(), 3);
+
+  // (0, 1) is now the most recently used, so (0, 2) is dropped next.
+  BOOST_REQUIRE(cache.Lookup(0, 1, value));
+  BOOST_REQUIRE_CLOSE(value, 1.0, 1e-5);
+  cache.Insert(2, 2, 4.0);
+  BOOST_REQUIRE_EQUAL(cache.Size(), 3);
+  BOOST_REQUIRE(!cache.Lookup(0, 2, value));
+  BOOST_REQUIRE(cache.Lookup(1, 2, value));
+  BOOST_REQUIRE_CLOSE(value, 3.0, 1e-5);
+  BOOST_REQUIRE(cache.Lookup(2, 2, value));
+  BOOST_REQUIRE_CLOSE(value, 4.0, 1e-5);
+
+  // The pairs are ordered.
+  BOOST_REQUIRE(!cache.Lookup(1, 0, value));
+
+  BOOST_REQUIRE_EQUAL(cache.Hits(), 3);
+  BOOST_REQUIRE_EQUAL(cache.Misses(), 3);
+  BOOST_REQUIRE_CLOSE(cache.HitRate(), 0.5, 1e-5);
+
+  // Binding twice to the same data keeps the evaluations.
+  arma::mat a(2, 5), b(2, 6);
+  cache.Bind(a);
+  cache.Insert(3, 4, 5.0);
+  cache.Bind(a);
+  BOOST_REQUIRE(cache.Lookup(3, 4, value));
+  cache.Bind(b);
+  BOOST_REQUIRE_EQUAL(cache.Size(), 0);
+
+  // A sharded cache holds as many evaluations in total.
+  KernelCache sharded(100, 8);
+  for (size_t i = 0; i < 50; ++i)
+    for (size_t j = 0; j < 50; ++j)
+      sharded.Insert(i, j, (double) (i + j));
+  BOOST_REQUIRE_LE(sharded.Size(), 100);
+  for (size_t i = 0; i < 50; ++i)
+    for (size_t j = 0; j < 50; ++j)
+      if (sharded.Lookup(i, j, value))
+        BOOST_REQUIRE_EQUAL(value, (double) (i + j));
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -7,14 +7,21 @@
 #include <mlpack/methods/kmeans/kmeans.hpp>
 #include <mlpack/methods/kmeans/allow_empty_clusters.hpp>
 #include <mlpack/methods/kmeans/refined_start.hpp>
+#include <mlpack/methods/kmeans/kmeans_plus_plus.hpp>
+#include <mlpack/methods/kmeans/kmeans_parallel.hpp>
 #include <mlpack/methods/kmeans/elkan_kmeans.hpp>
 #include <mlpack/methods/kmeans/hamerly_kmeans.hpp>
 #include <mlpack/methods/kmeans/pelleg_moore_kmeans.hpp>
 #include <mlpack/methods/kmeans/dtnn_kmeans.hpp>
 #include <mlpack/methods/kmeans/dual_tree_kmeans.hpp>
+#include <mlpack/methods/kmeans/mini_batch_kmeans.hpp>
+#include <mlpack/methods/kmeans/kmeans_model.hpp>
+#include <mlpack/methods/kmeans/sharded_kmeans.hpp>
 
 #include <mlpack/core/tree/cover_tree/cover_tree.hpp>
 
+#include <ctime>
+
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
 
@@ -111,7 +118,7 @@ BOOST_AUTO_TEST_CASE(AllowEmptyClusterTest)
   // Make sure the method doesn't modify any points.
   metric::LMetric<2, true> metric;
   BOOST_REQUIRE_EQUAL(AllowEmptyClusters::EmptyCluster(kMeansData, 2, centroids,
-      counts, metric), 0);
+      counts, metric, 0), 0);
 
   // Make sure no assignments were changed.
   for (size_t i = 0; i < assignments.n_elem; i++)
@@ -145,8 +152,9 @@ BOOST_AUTO_TEST_CASE(MaxVarianceNewClusterTest)
   metric::LMetric<2, true> metric;
 
   // This should only change one point.
-  BOOST_REQUIRE_EQUAL(MaxVarianceNewCluster::EmptyCluster(data, 2, centroids,
-      counts, metric), 1);
+  MaxVarianceNewCluster mvnc;
+  BOOST_REQUIRE_EQUAL(mvnc.EmptyCluster(data, 2, centroids, counts, metric, 0),
+      1);
 
   // Add the variance of each point's distance away from the cluster.  I think
   // this is the sensible thing to do.
@@ -182,6 +190,94 @@ BOOST_AUTO_TEST_CASE(MaxVarianceNewClusterTest)
   BOOST_REQUIRE_EQUAL(counts[2], 1);
 }
 
+/**
+ * Make sure that when several clusters are empty in the same iteration, the
+ * cached variances are updated, so that each empty cluster gets a different
+ * point from the cluster with the largest variance at that time.
+ */
+BOOST_AUTO_TEST_CASE(MaxVarianceNewClusterRepeatTest)
+{
+  // Points 2 and 5 are far from the centroids of their clusters.
+  arma::mat data("0.0 0.1 3.0 10.0 10.1 15.0 10.2;"
+                 "0.0 0.1 0.0  0.0  0.1  0.0  0.1;");
+
+  arma::mat centroids(2, 4);
+  centroids.col(0) = (1.0 / 3.0) * (data.col(0) + data.col(1) + data.col(2));
+  centroids.col(1) = 0.25 * (data.col(3) + data.col(4) + data.col(5) +
+      data.col(6));
+  centroids.col(2).fill(DBL_MAX);
+  centroids.col(3).fill(DBL_MAX);
+
+  arma::Col<size_t> counts("3 4 0 0");
+  metric::LMetric<2, true> metric;
+
+  MaxVarianceNewCluster mvnc;
+  BOOST_REQUIRE_EQUAL(mvnc.EmptyCluster(data, 2, centroids, counts, metric, 0),
+      1);
+  BOOST_REQUIRE_EQUAL(mvnc.EmptyCluster(data, 3, centroids, counts, metric, 0),
+      1);
+
+  // Cluster 1 has the largest variance, so it gives up point 5 first; then
+  // cluster 0 has the largest variance and gives up point 2.
+  BOOST_REQUIRE_CLOSE(centroids(0, 2), 15.0, 1e-5);
+  BOOST_REQUIRE_CLOSE(centroids(0, 3), 3.0, 1e-5);
+  BOOST_REQUIRE_CLOSE(centroids(0, 0), 0.05, 1e-5);
+  BOOST_REQUIRE_CLOSE(centroids(0, 1), 10.1, 1e-5);
+
+  BOOST_REQUIRE_EQUAL(counts[0], 2);
+  BOOST_REQUIRE_EQUAL(counts[1], 3);
+  BOOST_REQUIRE_EQUAL(counts[2], 1);
+  BOOST_REQUIRE_EQUAL(counts[3], 1);
+}
+
+/**
+ * Make sure that a KMeans object with MaxVarianceNewCluster can be used to
+ * cluster a second dataset: the variances cached during the first run must not
+ * be used in the second, which counts its iterations from zero again.
+ */
+BOOST_AUTO_TEST_CASE(MaxVarianceNewClusterReuseTest)
+{
+  // Two groups of points; the third initial centroid is far from all of them,
+  // so its cluster is empty in the first iteration of each run.
+  arma::mat firstData(2, 60);
+  for (size_t i = 0; i < firstData.n_cols; ++i)
+  {
+    firstData(0, i) = ((i % 2 == 0) ? 0.0 : 10.0) + 0.01 * i;
+    firstData(1, i) = 0.1 * (i % 7);
+  }
+
+  arma::mat secondData(2, 10);
+  for (size_t i = 0; i < secondData.n_cols; ++i)
+  {
+    secondData(0, i) = ((i % 2 == 0) ? 1.0 : 11.0) + 0.3 * i;
+    secondData(1, i) = 0.2 * (i % 3);
+  }
+
+  arma::mat initialCentroids("0.0 10.0 1000.0;"
+                             "0.0  0.0 1000.0;");
+
+  KMeans<> kmeans;
+  arma::Col<size_t> assignments;
+  arma::mat centroids(initialCentroids);
+  kmeans.Cluster(firstData, 3, assignments, centroids, false, true);
+
+  centroids = initialCentroids;
+  kmeans.Cluster(secondData, 3, assignments, centroids, false, true);
+
+  // The second run must give the same results as a new KMeans object.
+  KMeans<> newKMeans;
+  arma::Col<size_t> newAssignments;
+  arma::mat newCentroids(initialCentroids);
+  newKMeans.Cluster(secondData, 3, newAssignments, newCentroids, false, true);
+
+  BOOST_REQUIRE_EQUAL(assignments.n_elem, secondData.n_cols);
+  for (size_t i = 0; i < assignments.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], newAssignments[i]);
+
+  for (size_t i = 0; i < centroids.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(centroids[i], newCentroids[i], 1e-5);
+}
+
 /**
  * Make sure the random partitioner seems to return valid results.
  */
@@ -560,6 +656,172 @@ BOOST_AUTO_TEST_CASE(HamerlyTest)
   }
 }
 
+/**
+ * Make sure that, over several iterations on a dataset large enough to be
+ * split between threads, the Elkan and Hamerly steps compute the same
+ * centroids and counts as the naive step.
+ */
+BOOST_AUTO_TEST_CASE(BoundedKMeansIterateTest)
+{
+  arma::mat dataset = arma::randu<arma::mat>(5, 20000);
+  arma::mat centroids = dataset.cols(0, 99);
+
+  metric::EuclideanDistance metric;
+  NaiveKMeans<metric::EuclideanDistance, arma::mat> naive(dataset, metric);
+  ElkanKMeans<metric::EuclideanDistance, arma::mat> elkan(dataset, metric);
+  HamerlyKMeans<metric::EuclideanDistance, arma::mat> hamerly(dataset, metric);
+
+  arma::mat naiveCentroids(centroids), elkanCentroids(centroids),
+      hamerlyCentroids(centroids);
+  arma::mat newCentroids;
+  arma::Col<size_t> naiveCounts, elkanCounts, hamerlyCounts;
+  for (size_t iteration = 0; iteration < 4; ++iteration)
+  {
+    naive.Iterate(naiveCentroids, newCentroids, naiveCounts);
+    naiveCentroids = newCentroids;
+    elkan.Iterate(elkanCentroids, newCentroids, elkanCounts);
+    elkanCentroids = newCentroids;
+    hamerly.Iterate(hamerlyCentroids, newCentroids, hamerlyCounts);
+    hamerlyCentroids = newCentroids;
+
+    for (size_t c = 0; c < centroids.n_cols; ++c)
+    {
+      BOOST_REQUIRE_EQUAL(elkanCounts[c], naiveCounts[c]);
+      BOOST_REQUIRE_EQUAL(hamerlyCounts[c], naiveCounts[c]);
+    }
+
+    for (size_t i = 0; i < naiveCentroids.n_elem; ++i)
+    {
+      BOOST_REQUIRE_CLOSE(elkanCentroids[i], naiveCentroids[i], 1e-5);
+      BOOST_REQUIRE_CLOSE(hamerlyCentroids[i], naiveCentroids[i], 1e-5);
+    }
+  }
+
+  // The bounds should prune some distance calculations after the first
+  // iteration.
+  BOOST_REQUIRE_LT(elkan.DistanceCalculations(),
+      naive.DistanceCalculations());
+  BOOST_REQUIRE_LT(hamerly.DistanceCalculations(),
+      naive.DistanceCalculations());
+}
+
+/**
+ * Make sure that ShardedKMeans, in a single process, finds the same clusters as
+ * KMeans with the same step type.
+ */
+template<template<class, class> class LloydStepType>
+void ShardedLocalTest()
+{
+  arma::mat dataset = arma::randu<arma::mat>(10, 1000);
+  arma::mat centroids = dataset.cols(0, 19);
+
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      LloydStepType> km;
+  arma::Col<size_t> assignments;
+  arma::mat kmCentroids(centroids);
+  km.Cluster(dataset, 20, assignments, kmCentroids, false, true);
+
+  util::LocalCommunicator communicator;
+  ShardedKMeans<util::LocalCommunicator, metric::EuclideanDistance,
+      RandomPartition, LloydStepType> sharded(communicator);
+  arma::Col<size_t> shardedAssignments;
+  arma::mat shardedCentroids(centroids);
+  sharded.Cluster(dataset, 20, shardedAssignments, shardedCentroids, true);
+
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(shardedAssignments[i], assignments[i]);
+  for (size_t i = 0; i < kmCentroids.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(shardedCentroids[i], kmCentroids[i], 1e-5);
+}
+
+BOOST_AUTO_TEST_CASE(ShardedNaiveKMeansTest)
+{
+  ShardedLocalTest<NaiveKMeans>();
+}
+
+BOOST_AUTO_TEST_CASE(ShardedHamerlyKMeansTest)
+{
+  ShardedLocalTest<HamerlyKMeans>();
+}
+
+#ifdef _OPENMP
+/**
+ * Run four ranks of FileCommunicator in four threads, each with a quarter of
+ * the dataset, and make sure that the sums are right and that ShardedKMeans
+ * finds the same clusters as KMeans on the whole dataset.
+ */
+BOOST_AUTO_TEST_CASE(ShardedFileCommunicatorTest)
+{
+  const size_t size = 4;
+  arma::mat dataset = arma::randu<arma::mat>(5, 2000);
+  arma::mat centroids = dataset.cols(0, 9);
+
+  KMeans<> km;
+  arma::Col<size_t> assignments;
+  arma::mat kmCentroids(centroids);
+  km.Cluster(dataset, 10, assignments, kmCentroids, false, true);
+
+  std::vector<arma::mat> shardedCentroids(size, centroids);
+  std::vector<arma::Col<size_t> > shardedAssignments(size);
+  std::vector<arma::mat> sums(size);
+  std::vector<size_t> rounds(size);
+
+  // Files left by an earlier run of this test must not be read.
+  std::ostringstream id;
+  id << "test" << std::time(NULL) << "-" << math::RandInt(1000000);
+
+  // Every rank must run at the same time, or the others wait for it.
+  bool ran = true;
+  #pragma omp parallel num_threads(size)
+  {
+    const size_t r = (size_t) omp_get_thread_num();
+    if ((size_t) omp_get_num_threads() != size)
+    {
+      ran = false;
+    }
+    else
+    {
+      util::FileCommunicator communicator(".", r, size, id.str(), 60.0);
+
+      sums[r].set_size(2, 3);
+      sums[r].fill(r + 1);
+      communicator.AllReduce(sums[r]);
+
+      const arma::mat shard = dataset.cols(r * 500, (r + 1) * 500 - 1);
+      ShardedKMeans<util::FileCommunicator> sharded(communicator);
+      sharded.Cluster(shard, 10, shardedAssignments[r], shardedCentroids[r],
+          true);
+      rounds[r] = communicator.Rounds();
+    }
+  }
+
+  // The threads could not all be started.
+  if (!ran)
+    return;
+
+  for (size_t r = 0; r < size; ++r)
+  {
+    BOOST_REQUIRE_EQUAL(rounds[r], rounds[0]);
+
+    // 1 + 2 + 3 + 4.
+    for (size_t i = 0; i < sums[r].n_elem; ++i)
+      BOOST_REQUIRE_CLOSE(sums[r][i], 10.0, 1e-10);
+
+    for (size_t i = 0; i < kmCentroids.n_elem; ++i)
+      BOOST_REQUIRE_CLOSE(shardedCentroids[r][i], kmCentroids[i], 1e-5);
+
+    for (size_t i = 0; i < 500; ++i)
+      BOOST_REQUIRE_EQUAL(shardedAssignments[r][i], assignments[r * 500 + i]);
+
+    // The files of the last round are left in the directory.
+    std::ostringstream name;
+    name << "./allreduce-" << id.str() << "-" << size << "-" << (rounds[r] - 1)
+        << "-" << r << ".bin";
+    std::remove(name.str().c_str());
+  }
+}
+#endif
+
 BOOST_AUTO_TEST_CASE(PellegMooreTest)
 {
   const size_t trials = 5;
@@ -690,4 +952,474 @@ BOOST_AUTO_TEST_CASE(DualTreeKMeansTest)
   }
 }
 
+/**
+ * Make sure that DualTreeKMeans, which skips the nodes whose owner cannot have
+ * changed since the last iteration, gives the same centroids and counts as
+ * NaiveKMeans at every iteration on well-separated clusters, where many nodes
+ * have an owner.
+ */
+BOOST_AUTO_TEST_CASE(DualTreeKMeansSkipOwnedNodesTest)
+{
+  arma::mat dataset(3, 4000);
+  dataset.randn();
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    dataset.col(i) += 20.0 * (i % 4) * arma::ones<arma::vec>(3);
+
+  arma::mat centroids(3, 4);
+  for (size_t c = 0; c < 4; ++c)
+    centroids.col(c) = dataset.col(c) + 0.5;
+
+  metric::EuclideanDistance metric;
+  NaiveKMeans<metric::EuclideanDistance, arma::mat> naive(dataset, metric);
+  DefaultDualTreeKMeans<metric::EuclideanDistance, arma::mat> dualTree(dataset,
+      metric);
+
+  for (size_t iteration = 0; iteration < 5; ++iteration)
+  {
+    arma::mat naiveCentroids;
+    arma::Col<size_t> naiveCounts;
+    naive.Iterate(centroids, naiveCentroids, naiveCounts);
+
+    // The centroid tree may rearrange the centroids it is given.
+    arma::mat dualTreeInput(centroids);
+    arma::mat dualTreeCentroids;
+    arma::Col<size_t> dualTreeCounts;
+    dualTree.Iterate(dualTreeInput, dualTreeCentroids, dualTreeCounts);
+
+    for (size_t c = 0; c < 4; ++c)
+      BOOST_REQUIRE_EQUAL(naiveCounts[c], dualTreeCounts[c]);
+    for (size_t i = 0; i < naiveCentroids.n_elem; ++i)
+      BOOST_REQUIRE_CLOSE(naiveCentroids[i], dualTreeCentroids[i], 1e-5);
+
+    centroids = naiveCentroids;
+  }
+}
+
+/**
+ * Make sure that KMeansModel assigns each point to its closest centroid, both
+ * with few centroids (when every centroid is checked) and with many (when a
+ * tree is built on the centroids).
+ */
+BOOST_AUTO_TEST_CASE(KMeansModelAssignTest)
+{
+  arma::mat points(4, 3000);
+  points.randu();
+
+  const size_t clusters[] = { 5, 200 };
+  for (size_t t = 0; t < 2; ++t)
+  {
+    arma::mat centroids(4, clusters[t]);
+    centroids.randu();
+
+    KMeansModel model(centroids);
+    arma::Col<size_t> assignments;
+    arma::vec distances;
+    model.Assign(points, assignments, distances);
+
+    BOOST_REQUIRE_EQUAL(assignments.n_elem, points.n_cols);
+    BOOST_REQUIRE_EQUAL(distances.n_elem, points.n_cols);
+    for (size_t i = 0; i < points.n_cols; ++i)
+    {
+      double minDistance = DBL_MAX;
+      size_t closest = 0;
+      for (size_t c = 0; c < centroids.n_cols; ++c)
+      {
+        const double distance = metric::EuclideanDistance::Evaluate(
+            points.col(i), centroids.col(c));
+        if (distance < minDistance)
+        {
+          minDistance = distance;
+          closest = c;
+        }
+      }
+
+      BOOST_REQUIRE_EQUAL(assignments[i], closest);
+      BOOST_REQUIRE_CLOSE(distances[i], minDistance, 1e-5);
+    }
+  }
+}
+
+/**
+ * Make sure that a KMeansModel is the same after it is saved and loaded, and
+ * that a copy gives the same assignments.
+ */
+BOOST_AUTO_TEST_CASE(KMeansModelSaveLoadTest)
+{
+  arma::mat centroids(3, 50);
+  centroids.randu();
+
+  KMeansModel model(centroids);
+  model.Save("test-kmeans-model.xml");
+
+  KMeansModel loaded;
+  loaded.Load("test-kmeans-model.xml");
+  remove("test-kmeans-model.xml");
+
+  BOOST_REQUIRE_EQUAL(loaded.Clusters(), (size_t) 50);
+  BOOST_REQUIRE_EQUAL(loaded.Dimensionality(), (size_t) 3);
+  for (size_t i = 0; i < centroids.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(loaded.Centroids()[i], centroids[i], 1e-5);
+
+  arma::mat points(3, 500);
+  points.randu();
+  arma::Col<size_t> assignments, loadedAssignments, copyAssignments;
+  model.Assign(points, assignments);
+  loaded.Assign(points, loadedAssignments);
+  KMeansModel copy(loaded);
+  copy.Assign(points, copyAssignments);
+
+  for (size_t i = 0; i < points.n_cols; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(loadedAssignments[i], assignments[i]);
+    BOOST_REQUIRE_EQUAL(copyAssignments[i], assignments[i]);
+  }
+}
+
+/**
+ * Make sure that an iteration of NaiveKMeans (which is parallel, and uses a
+ * matrix multiplication for the Euclidean distance) gives the same centroids
+ * and counts as a simple serial computation, for several blocks of points.
+ */
+BOOST_AUTO_TEST_CASE(NaiveKMeansIterateTest)
+{
+  arma::mat dataset(8, 5000);
+  dataset.randu();
+  arma::mat centroids(8, 12);
+  centroids.randu();
+
+  // Compute the new centroids the simple way.
+  metric::EuclideanDistance metric;
+  arma::mat expectedCentroids(arma::zeros<arma::mat>(8, 12));
+  arma::Col<size_t> expectedCounts(arma::zeros<arma::Col<size_t> >(12));
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+  {
+    double minDistance = std::numeric_limits<double>::infinity();
+    size_t closestCluster = centroids.n_cols;
+    for (size_t j = 0; j < centroids.n_cols; ++j)
+    {
+      const double distance = metric.Evaluate(dataset.col(i),
+          centroids.col(j));
+      if (distance < minDistance)
+      {
+        minDistance = distance;
+        closestCluster = j;
+      }
+    }
+
+    expectedCentroids.col(closestCluster) += dataset.col(i);
+    expectedCounts[closestCluster]++;
+  }
+
+  for (size_t j = 0; j < centroids.n_cols; ++j)
+    if (expectedCounts[j] != 0)
+      expectedCentroids.col(j) /= expectedCounts[j];
+
+  NaiveKMeans<metric::EuclideanDistance, arma::mat> naive(dataset, metric);
+  arma::mat newCentroids;
+  arma::Col<size_t> counts;
+  naive.Iterate(centroids, newCentroids, counts);
+
+  for (size_t j = 0; j < centroids.n_cols; ++j)
+  {
+    BOOST_REQUIRE_EQUAL(counts[j], expectedCounts[j]);
+    if (counts[j] == 0)
+      continue;
+
+    for (size_t d = 0; d < centroids.n_rows; ++d)
+      BOOST_REQUIRE_CLOSE(newCentroids(d, j), expectedCentroids(d, j), 1e-8);
+  }
+
+  // The same, with a metric Iterate() can only call Evaluate() for.
+  metric::ManhattanDistance manhattan;
+  NaiveKMeans<metric::ManhattanDistance, arma::mat> manhattanNaive(dataset,
+      manhattan);
+  arma::Col<size_t> manhattanCounts;
+  manhattanNaive.Iterate(centroids, newCentroids, manhattanCounts);
+
+  BOOST_REQUIRE_EQUAL(accu(manhattanCounts), dataset.n_cols);
+  BOOST_REQUIRE_EQUAL(manhattanNaive.DistanceCalculations(),
+      (dataset.n_cols + 1) * centroids.n_cols);
+}
+
+/**
+ * Create a dataset of three well-separated Gaussian clusters (around 0, 10 and
+ * 20 in every dimension) in random order, and store the cluster of each point.
+ */
+void BlobDataset(arma::mat& dataset, arma::Col<size_t>& labels)
+{
+  dataset.randn(3, 3000);
+  labels.set_size(3000);
+  for (size_t i = 0; i < 3000; ++i)
+  {
+    labels[i] = math::RandInt(3);
+    dataset.col(i) = 0.5 * dataset.col(i) + 10.0 * labels[i];
+  }
+}
+
+/**
+ * Make sure mini-batch k-means, as the step type of KMeans, finds three
+ * well-separated clusters.
+ */
+BOOST_AUTO_TEST_CASE(MiniBatchKMeansTest)
+{
+  arma::mat dataset;
+  arma::Col<size_t> labels;
+  BlobDataset(dataset, labels);
+
+  arma::mat centroids("1 9 21; 1 11 19; -1 9 21");
+  arma::Col<size_t> assignments;
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      MiniBatchKMeans> kmeans(100);
+  kmeans.Cluster(dataset, 3, assignments, centroids, false, true);
+
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], labels[i]);
+
+  for (size_t j = 0; j < 3; ++j)
+    for (size_t d = 0; d < 3; ++d)
+      BOOST_REQUIRE_SMALL(centroids(d, j) - 10.0 * j, 0.2);
+}
+
+/**
+ * Make sure mini-batch k-means finds three well-separated clusters in a
+ * dataset that is read in blocks.
+ */
+BOOST_AUTO_TEST_CASE(MiniBatchClusterTest)
+{
+  arma::mat dataset;
+  arma::Col<size_t> labels;
+  BlobDataset(dataset, labels);
+  data::Save("test_blobs.csv", dataset);
+
+  arma::mat centroids("1 9 21; 1 11 19; -1 9 21");
+  metric::EuclideanDistance metric;
+  {
+    data::StreamingReader reader("test_blobs.csv", 100);
+    MiniBatchCluster(reader, 3, centroids, 2, true, metric);
+
+    arma::Col<size_t> assignments;
+    MiniBatchAssign(reader, centroids, assignments, metric);
+
+    BOOST_REQUIRE_EQUAL(assignments.n_elem, dataset.n_cols);
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+      BOOST_REQUIRE_EQUAL(assignments[i], labels[i]);
+  }
+
+  for (size_t j = 0; j < 3; ++j)
+    for (size_t d = 0; d < 3; ++d)
+      BOOST_REQUIRE_SMALL(centroids(d, j) - 10.0 * j, 0.2);
+
+  remove("test_blobs.csv");
+}
+
+/**
+ * Return true if the given assignments put the points of each cluster of
+ * BlobDataset() together, and the points of different clusters apart.
+ */
+bool SameBlobPartition(const arma::Col<size_t>& labels,
+                       const arma::Col<size_t>& assignments)
+{
+  arma::Col<size_t> mapping(3);
+  mapping.fill(3);
+  for (size_t i = 0; i < labels.n_elem; ++i)
+  {
+    if (mapping[labels[i]] == 3)
+      mapping[labels[i]] = assignments[i];
+    else if (mapping[labels[i]] != assignments[i])
+      return false;
+  }
+
+  return (mapping[0] != mapping[1]) && (mapping[0] != mapping[2]) &&
+      (mapping[1] != mapping[2]);
+}
+
+/**
+ * Make sure the given initial partition already finds the three well-separated
+ * clusters of BlobDataset(), and that KMeans with it does too.  (Two initial
+ * centers are drawn in the same cluster with a probability of about 0.1%.)
+ */
+template<typename InitialPartitionPolicy>
+void SeedingTest(const InitialPartitionPolicy& ipp)
+{
+  arma::mat dataset;
+  arma::Col<size_t> labels;
+  BlobDataset(dataset, labels);
+
+  arma::Col<size_t> assignments;
+  ipp.Cluster(dataset, 3, assignments);
+  BOOST_REQUIRE_EQUAL(assignments.n_elem, dataset.n_cols);
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    BOOST_REQUIRE_LT(assignments[i], 3);
+  BOOST_REQUIRE(SameBlobPartition(labels, assignments));
+
+  KMeans<metric::EuclideanDistance, InitialPartitionPolicy> kmeans(1000,
+      metric::EuclideanDistance(), ipp);
+  arma::mat centroids;
+  kmeans.Cluster(dataset, 3, assignments, centroids);
+  BOOST_REQUIRE(SameBlobPartition(labels, assignments));
+}
+
+BOOST_AUTO_TEST_CASE(KMeansPlusPlusTest)
+{
+  SeedingTest(KMeansPlusPlus());
+}
+
+BOOST_AUTO_TEST_CASE(KMeansParallelTest)
+{
+  SeedingTest(KMeansParallel());
+
+  // With no rounds the candidates are only the first random point and those
+  // drawn with the k-means++ rule, which should still work.
+  SeedingTest(KMeansParallel(2.0, 0));
+}
+
+/**
+ * Make sure k-means++ does not fail when there are fewer distinct points than
+ * clusters.
+ */
+BOOST_AUTO_TEST_CASE(KMeansPlusPlusDuplicatePointsTest)
+{
+  arma::mat dataset(2, 10);
+  dataset.cols(0, 4).fill(1.0);
+  dataset.cols(5, 9).fill(-1.0);
+
+  arma::Col<size_t> assignments;
+  KMeansPlusPlus::Cluster(dataset, 4, assignments);
+
+  BOOST_REQUIRE_EQUAL(assignments.n_elem, 10);
+  for (size_t i = 0; i < 10; ++i)
+    BOOST_REQUIRE_LT(assignments[i], 4);
+  for (size_t i = 1; i < 5; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(assignments[i], assignments[0]);
+    BOOST_REQUIRE_EQUAL(assignments[i + 5], assignments[5]);
+  }
+  BOOST_REQUIRE_NE(assignments[0], assignments[5]);
+}
+
+/**
+ * Make sure the given step type gives the same clustering for a dataset in
+ * single precision as for the same dataset in double precision.
+ */
+template<template<class, class> class LloydStepType>
+void FloatDoubleTest()
+{
+  // Five well-separated clusters, so that the rounding of the distances can't
+  // change the assignments.
+  arma::fmat floatData(4, 500);
+  floatData.randn();
+  for (size_t c = 0; c < 5; ++c)
+    floatData.cols(100 * c, 100 * c + 99) += 20.0 * c;
+  const arma::mat doubleData = arma::conv_to<arma::mat>::from(floatData);
+  const arma::mat initialCentroids = doubleData.cols(0, 4);
+
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      LloydStepType> doubleKMeans;
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      LloydStepType, arma::fmat> floatKMeans;
+
+  arma::Col<size_t> doubleAssignments, floatAssignments;
+  arma::mat doubleCentroids(initialCentroids), floatCentroids(initialCentroids);
+  doubleKMeans.Cluster(doubleData, 5, doubleAssignments, doubleCentroids,
+      false, true);
+  floatKMeans.Cluster(floatData, 5, floatAssignments, floatCentroids, false,
+      true);
+
+  for (size_t i = 0; i < doubleData.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(floatAssignments[i], doubleAssignments[i]);
+  for (size_t i = 0; i < doubleCentroids.n_elem; ++i)
+  {
+    if (std::abs(doubleCentroids[i]) < 1e-3)
+      BOOST_REQUIRE_SMALL(floatCentroids[i], 1e-3);
+    else
+      BOOST_REQUIRE_CLOSE(floatCentroids[i], doubleCentroids[i], 1e-3);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FloatNaiveKMeansTest)
+{
+  FloatDoubleTest<NaiveKMeans>();
+}
+
+BOOST_AUTO_TEST_CASE(FloatElkanKMeansTest)
+{
+  FloatDoubleTest<ElkanKMeans>();
+}
+
+BOOST_AUTO_TEST_CASE(FloatHamerlyKMeansTest)
+{
+  FloatDoubleTest<HamerlyKMeans>();
+}
+
+#ifdef ARMA_HAS_SPMAT
+// Can't do this test on Armadillo 3.4; var(SpBase) is not implemented.
+#if !((ARMA_VERSION_MAJOR == 3) && (ARMA_VERSION_MINOR == 4))
+
+/**
+ * Make sure the given step type gives the same clustering for a sparse dataset
+ * as for the same dataset stored densely.
+ */
+template<template<class, class> class LloydStepType>
+void SparseDenseTest()
+{
+  arma::sp_mat sparseData = arma::sprandu<arma::sp_mat>(500, 300, 0.02);
+  arma::mat denseData(sparseData);
+  const arma::mat initialCentroids = denseData.cols(0, 4);
+
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      LloydStepType> denseKMeans;
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      LloydStepType, arma::sp_mat> sparseKMeans;
+
+  arma::Col<size_t> denseAssignments, sparseAssignments;
+  arma::mat denseCentroids(initialCentroids), sparseCentroids(initialCentroids);
+  denseKMeans.Cluster(denseData, 5, denseAssignments, denseCentroids, false,
+      true);
+  sparseKMeans.Cluster(sparseData, 5, sparseAssignments, sparseCentroids,
+      false, true);
+
+  for (size_t i = 0; i < denseData.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(sparseAssignments[i], denseAssignments[i]);
+  for (size_t i = 0; i < denseCentroids.n_elem; ++i)
+  {
+    if (std::abs(denseCentroids[i]) < 1e-10)
+      BOOST_REQUIRE_SMALL(sparseCentroids[i], 1e-10);
+    else
+      BOOST_REQUIRE_CLOSE(sparseCentroids[i], denseCentroids[i], 1e-5);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SparseNaiveKMeansTest)
+{
+  SparseDenseTest<NaiveKMeans>();
+}
+
+BOOST_AUTO_TEST_CASE(SparseHamerlyKMeansTest)
+{
+  SparseDenseTest<HamerlyKMeans>();
+}
+
+/**
+ * Make sure the cached-norm Euclidean distance for sparse data is the same as
+ * the metric's.
+ */
+BOOST_AUTO_TEST_CASE(SparseCentroidDistanceTest)
+{
+  arma::sp_mat data = arma::sprandu<arma::sp_mat>(100, 20, 0.1);
+  arma::mat centroids = arma::randu<arma::mat>(100, 3);
+
+  metric::EuclideanDistance metric;
+  CentroidDistance<metric::EuclideanDistance, arma::sp_mat> distance(data,
+      metric);
+  distance.Centroids(centroids);
+
+  for (size_t i = 0; i < data.n_cols; ++i)
+    for (size_t j = 0; j < centroids.n_cols; ++j)
+      BOOST_REQUIRE_CLOSE(distance.Evaluate(i, j), metric.Evaluate(
+          arma::vec(data.col(i)), centroids.col(j)), 1e-5);
+}
+
+#endif // Exclude Armadillo 3.4.
+#endif // ARMA_HAS_SPMAT
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -155,4 +155,222 @@ BOOST_AUTO_TEST_CASE(NoCholeskySingularityTest)
   }
 }
 
+/**
+ * Make sure that a LARS object used for several regressions gives the same
+ * results as a new LARS object for each regression.
+ */
+BOOST_AUTO_TEST_CASE(LARSReuseTest)
+{
+  const double lambda1 = 1.0;
+  const double lambda2 = 0.5;
+
+  arma::mat X;
+  arma::vec y;
+  GenerateProblem(X, y, 100, 10);
+  const arma::mat gram = X * trans(X);
+
+  LARS reusedLars(true, gram, lambda1, lambda2);
+  for (size_t i = 0; i < 10; ++i)
+  {
+    // Use a different response vector each time.
+    const arma::vec response = y + arma::randn<arma::vec>(y.n_elem);
+
+    arma::vec reusedBeta, beta;
+    reusedLars.Regress(X, response, reusedBeta);
+
+    LARS lars(true, gram, lambda1, lambda2);
+    lars.Regress(X, response, beta);
+
+    BOOST_REQUIRE_EQUAL(reusedLars.BetaPath().size(), lars.BetaPath().size());
+    BOOST_REQUIRE_EQUAL(reusedLars.ActiveSet().size(),
+        lars.ActiveSet().size());
+    BOOST_REQUIRE_EQUAL(reusedBeta.n_elem, beta.n_elem);
+    for (size_t j = 0; j < beta.n_elem; ++j)
+    {
+      if (std::abs(beta[j]) < 1e-10)
+        BOOST_REQUIRE_SMALL(reusedBeta[j], 1e-10);
+      else
+        BOOST_REQUIRE_CLOSE(reusedBeta[j], beta[j], 1e-8);
+    }
+  }
+}
+
+/**
+ * Make sure that the solutions interpolated from the path are the solutions of
+ * separate regressions, and that the Gram matrix is recomputed for new data.
+ */
+BOOST_AUTO_TEST_CASE(LARSRegressPathTest)
+{
+  arma::mat X;
+  arma::vec y;
+  GenerateProblem(X, y, 100, 10);
+
+  arma::vec sortedAbsCorr = sort(abs(X * y));
+  const double minLambda = sortedAbsCorr(2);
+
+  arma::vec lambdas(4);
+  lambdas[0] = minLambda;
+  lambdas[1] = sortedAbsCorr(5);
+  lambdas[2] = 0.5 * (sortedAbsCorr(7) + sortedAbsCorr(8));
+  lambdas[3] = 2 * sortedAbsCorr(9); // The solution is 0 here.
+
+  LARS pathLars(true, minLambda);
+  arma::mat betas;
+  pathLars.RegressPath(X, y, lambdas, betas);
+
+  BOOST_REQUIRE_EQUAL(betas.n_rows, 10);
+  BOOST_REQUIRE_EQUAL(betas.n_cols, 4);
+  for (size_t i = 0; i < lambdas.n_elem; ++i)
+  {
+    LARS lars(true, lambdas[i]);
+    arma::vec beta;
+    lars.Regress(X, y, beta);
+
+    for (size_t j = 0; j < beta.n_elem; ++j)
+    {
+      if (std::abs(beta[j]) < 1e-8)
+        BOOST_REQUIRE_SMALL(betas(j, i), 1e-8);
+      else
+        BOOST_REQUIRE_CLOSE(betas(j, i), beta[j], 1e-5);
+    }
+  }
+
+  // Now regress on other data with the same object; the Gram matrix must be
+  // recomputed.
+  arma::mat X2;
+  arma::vec y2;
+  GenerateProblem(X2, y2, 100, 10);
+
+  arma::vec beta, otherBeta;
+  pathLars.Regress(X2, y2, beta);
+  LARS otherLars(true, minLambda);
+  otherLars.Regress(X2, y2, otherBeta);
+
+  for (size_t j = 0; j < beta.n_elem; ++j)
+  {
+    if (std::abs(otherBeta[j]) < 1e-8)
+      BOOST_REQUIRE_SMALL(beta[j], 1e-8);
+    else
+      BOOST_REQUIRE_CLOSE(beta[j], otherBeta[j], 1e-5);
+  }
+}
+
+/**
+ * Make sure that the columns of the Gram matrix are recomputed when the data
+ * matrix is modified in place between two calls (the memory and the size of
+ * the data are then the same).
+ */
+BOOST_AUTO_TEST_CASE(LARSModifiedDataTest)
+{
+  const double lambda1 = 0.1;
+
+  arma::mat X;
+  arma::vec y;
+  GenerateProblem(X, y, 100, 10);
+
+  LARS reusedLars(true, lambda1);
+  arma::vec reusedBeta;
+  reusedLars.Regress(X, y, reusedBeta);
+
+  // Overwrite the data, keeping the same memory.
+  const double* memory = X.memptr();
+  X.randu();
+  X *= 2.0;
+  BOOST_REQUIRE_EQUAL(X.memptr(), memory);
+
+  reusedLars.Regress(X, y, reusedBeta);
+
+  LARS lars(true, lambda1);
+  arma::vec beta;
+  lars.Regress(X, y, beta);
+
+  BOOST_REQUIRE_EQUAL(reusedLars.ActiveSet().size(), lars.ActiveSet().size());
+  BOOST_REQUIRE_EQUAL(reusedBeta.n_elem, beta.n_elem);
+  for (size_t j = 0; j < beta.n_elem; ++j)
+  {
+    if (std::abs(beta[j]) < 1e-10)
+      BOOST_REQUIRE_SMALL(reusedBeta[j], 1e-10);
+    else
+      BOOST_REQUIRE_CLOSE(reusedBeta[j], beta[j], 1e-8);
+  }
+}
+
+/**
+ * Make sure that LARS on a wide sparse design gives the same solution as on the
+ * same design made dense, and that the solution satisfies the KKT conditions,
+ * with the columns of the Gram matrix computed lazily or given.
+ */
+BOOST_AUTO_TEST_CASE(LARSSparseTest)
+{
+  for (size_t i = 0; i < 4; ++i)
+  {
+    const bool useCholesky = (i % 2 == 0);
+    const bool elasticNet = (i >= 2);
+
+    arma::sp_mat X;
+    X.sprandu(400, 60, 0.05);
+    const arma::mat denseX(X);
+    const arma::vec y = arma::randn<arma::vec>(60);
+
+    arma::vec sortedAbsCorr = sort(abs(denseX * y));
+    const double lambda1 = sortedAbsCorr(390);
+    const double lambda2 = elasticNet ? lambda1 / 2 : 0.0;
+
+    LARS sparseLars(useCholesky, lambda1, lambda2);
+    arma::vec sparseBeta;
+    sparseLars.Regress(X, y, sparseBeta);
+
+    LARS denseLars(useCholesky, lambda1, lambda2);
+    arma::vec denseBeta;
+    denseLars.Regress(denseX, y, denseBeta);
+
+    arma::mat gram = denseX * trans(denseX);
+    if (elasticNet && !useCholesky)
+      gram += lambda2 * arma::eye<arma::mat>(400, 400);
+    LARS gramLars(useCholesky, gram, lambda1, lambda2);
+    arma::vec gramBeta;
+    gramLars.Regress(denseX, y, gramBeta);
+
+    BOOST_REQUIRE_EQUAL(sparseBeta.n_elem, 400);
+    for (size_t j = 0; j < sparseBeta.n_elem; ++j)
+    {
+      BOOST_REQUIRE_SMALL(sparseBeta[j] - denseBeta[j], 1e-10);
+      BOOST_REQUIRE_SMALL(sparseBeta[j] - gramBeta[j], 1e-10);
+    }
+
+    arma::vec errCorr = (denseX * trans(denseX) + lambda2 *
+        arma::eye(400, 400)) * sparseBeta - denseX * y;
+    LARSVerifyCorrectness(sparseBeta, errCorr, lambda1);
+  }
+}
+
+/**
+ * Make sure that keeping the columns of the Gram matrix between calls on the
+ * same data (reuseGram = true) gives the same results as computing them again.
+ */
+BOOST_AUTO_TEST_CASE(LARSReuseGramTest)
+{
+  arma::sp_mat X;
+  X.sprandu(200, 60, 0.1);
+
+  LARS reusedLars(true, 0.05, 0.01);
+  for (size_t i = 0; i < 5; ++i)
+  {
+    // Use a different response vector each time.
+    const arma::vec y = arma::randn<arma::vec>(60);
+
+    arma::vec reusedBeta, beta;
+    reusedLars.Regress(X, y, reusedBeta, true, (i > 0));
+
+    LARS lars(true, 0.05, 0.01);
+    lars.Regress(X, y, beta);
+
+    BOOST_REQUIRE_EQUAL(reusedLars.ActiveSet().size(),
+        lars.ActiveSet().size());
+    BOOST_REQUIRE_EQUAL(reusedBeta.n_elem, beta.n_elem);
+    for (size_t j = 0; j < beta.n_elem; ++j)
+      BOOST_REQUIRE_SMALL(reusedBeta[j] - beta[j], 1e-10);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
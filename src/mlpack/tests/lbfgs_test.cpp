@@ -112,4 +112,66 @@ BOOST_AUTO_TEST_CASE(RosenbrockWoodFunctionTest)
   }
 }
 
+/**
+ * Make sure a warm-started run, which starts from the memory of the previous
+ * run, still converges to the minimum.
+ */
+BOOST_AUTO_TEST_CASE(WarmStartTest)
+{
+  GeneralizedRosenbrockFunction f(10);
+  L_BFGS<GeneralizedRosenbrockFunction> lbfgs(f);
+  lbfgs.MaxIterations() = 10000;
+
+  arma::vec coords = f.GetInitialPoint();
+  lbfgs.Optimize(coords);
+
+  // Start again from a nearby point, with the memory of the first run.
+  lbfgs.WarmStart() = true;
+  coords += 0.1;
+  lbfgs.Optimize(coords);
+
+  BOOST_REQUIRE_SMALL(f.Evaluate(coords), 1e-5);
+  for (size_t j = 0; j < 10; ++j)
+    BOOST_REQUIRE_CLOSE(coords[j], 1.0, 1e-3);
+}
+
+/**
+ * Make sure that storing the curvature pairs in single precision still finds
+ * the minimum, on both a vector and a matrix of coordinates, and that an
+ * optimizer can be reused for several runs.
+ */
+BOOST_AUTO_TEST_CASE(FloatHistoryTest)
+{
+  GeneralizedRosenbrockFunction f(64);
+  L_BFGS<GeneralizedRosenbrockFunction> lbfgs(f, 20);
+  lbfgs.MaxIterations() = 10000;
+  lbfgs.FloatHistory() = true;
+
+  for (size_t run = 0; run < 2; ++run)
+  {
+    arma::vec coords = f.GetInitialPoint();
+    const double objective = lbfgs.Optimize(coords);
+
+    BOOST_REQUIRE_SMALL(objective, 1e-5);
+    BOOST_REQUIRE_SMALL(f.Evaluate(coords), 1e-5);
+    for (size_t j = 0; j < 64; ++j)
+      BOOST_REQUIRE_CLOSE(coords[j], 1.0, 1e-3);
+  }
+
+  RosenbrockWoodFunction g;
+  L_BFGS<RosenbrockWoodFunction> matrixLbfgs(g);
+  matrixLbfgs.MaxIterations() = 10000;
+  matrixLbfgs.FloatHistory() = true;
+
+  arma::mat coords = g.GetInitialPoint();
+  matrixLbfgs.Optimize(coords);
+
+  BOOST_REQUIRE_SMALL(g.Evaluate(coords), 1e-5);
+  for (size_t row = 0; row < 4; ++row)
+  {
+    BOOST_REQUIRE_CLOSE((coords(row, 0)), 1.0, 1e-3);
+    BOOST_REQUIRE_CLOSE((coords(row, 1)), 1.0, 1e-3);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
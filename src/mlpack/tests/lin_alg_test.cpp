@@ -132,6 +132,121 @@ BOOST_AUTO_TEST_CASE(TestOrthogonalize)
   }
 }
 
+/**
+ * Mean() and Covariance() must match Armadillo on a matrix large enough to be
+ * processed in parallel blocks, and centering in-place must match centering
+ * into a second matrix.
+ */
+BOOST_AUTO_TEST_CASE(TestBlockedMeanCovariance)
+{
+  mat x = randu<mat>(20, 6001);
+  x.row(3) += 100.0;
+
+  vec m;
+  Mean(x, m);
+  vec armaMean = mean(x, 1);
+  for (size_t i = 0; i < m.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(m[i], armaMean[i], 1e-8);
+
+  mat c;
+  Covariance(x, c);
+  mat armaCov = ccov(x);
+  BOOST_REQUIRE_EQUAL(c.n_rows, 20);
+  BOOST_REQUIRE_EQUAL(c.n_cols, 20);
+  for (size_t i = 0; i < c.n_elem; ++i)
+  {
+    if (std::abs(armaCov[i]) < 1e-5)
+      BOOST_REQUIRE_SMALL(c[i], 1e-5);
+    else
+      BOOST_REQUIRE_CLOSE(c[i], armaCov[i], 1e-5);
+  }
+
+  mat centered;
+  Center(x, centered);
+  Center(x);
+  for (size_t i = 0; i < x.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(x[i], centered[i]);
+
+  Mean(x, m);
+  for (size_t i = 0; i < m.n_elem; ++i)
+    BOOST_REQUIRE_SMALL(m[i], 1e-10);
+}
+
+/**
+ * With integer weights, the weighted Mean() and Covariance() must match the
+ * (maximum likelihood) mean and covariance of the dataset with each point
+ * repeated as many times as its weight.
+ */
+BOOST_AUTO_TEST_CASE(TestWeightedMeanCovariance)
+{
+  mat x = randu<mat>(10, 5000);
+  x.row(2) += 50.0;
+
+  vec weights(x.n_cols);
+  size_t repeatedCols = 0;
+  for (size_t i = 0; i < x.n_cols; ++i)
+  {
+    weights[i] = RandInt(4);
+    repeatedCols += (size_t) weights[i];
+  }
+
+  mat repeated(x.n_rows, repeatedCols);
+  size_t col = 0;
+  for (size_t i = 0; i < x.n_cols; ++i)
+    for (size_t j = 0; j < (size_t) weights[i]; ++j)
+      repeated.col(col++) = x.col(i);
+
+  vec m;
+  Mean(x, weights, m);
+  vec armaMean = mean(repeated, 1);
+  for (size_t i = 0; i < m.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(m[i], armaMean[i], 1e-8);
+
+  mat c;
+  Covariance(x, weights, m, c);
+  mat armaCov = ccov(repeated, 1);
+  for (size_t i = 0; i < m.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(m[i], armaMean[i], 1e-8);
+  for (size_t i = 0; i < c.n_elem; ++i)
+  {
+    if (std::abs(armaCov[i]) < 1e-5)
+      BOOST_REQUIRE_SMALL(c[i], 1e-5);
+    else
+      BOOST_REQUIRE_CLOSE(c[i], armaCov[i], 1e-5);
+  }
+
+  // If the weights are all zero, so are the mean and covariance.
+  weights.zeros();
+  Covariance(x, weights, m, c);
+  BOOST_REQUIRE_EQUAL(accu(m != 0.0), 0);
+  BOOST_REQUIRE_EQUAL(accu(c != 0.0), 0);
+}
+
+/**
+ * RandomBasis() must give an orthogonal matrix with determinant 1.
+ */
+BOOST_AUTO_TEST_CASE(TestRandomBasis)
+{
+  mat basis;
+  RandomBasis(basis, 7);
+
+  BOOST_REQUIRE_EQUAL(basis.n_rows, 7);
+  BOOST_REQUIRE_EQUAL(basis.n_cols, 7);
+  BOOST_REQUIRE_CLOSE(det(basis), 1.0, 1e-5);
+
+  mat identity = trans(basis) * basis;
+  for (size_t row = 0; row < 7; ++row)
+  {
+    for (size_t col = 0; col < 7; ++col)
+    {
+      if (row == col)
+        BOOST_REQUIRE_CLOSE(identity(row, col), 1.0, 1e-5);
+      else
+        BOOST_REQUIRE_SMALL(identity(row, col), 1e-10);
+    }
+  }
+}
+
 // Test RemoveRows().
 BOOST_AUTO_TEST_CASE(TestRemoveRows)
 {
@@ -173,4 +173,41 @@ BOOST_AUTO_TEST_CASE(RidgeRegressionTestCase)
     BOOST_REQUIRE_SMALL(predictions(i) - responses(i), .05);
 }
 
+/**
+ * Make sure the streaming solver (the normal equations accumulated over blocks
+ * of points) gives the same parameters as the QR solver, with and without an
+ * intercept, weights and ridge regularization.
+ */
+BOOST_AUTO_TEST_CASE(StreamingLinearRegressionTest)
+{
+  arma::mat predictors;
+  predictors.randu(5, 20000);
+  arma::vec coeffs;
+  coeffs.randu(5);
+  arma::vec responses = trans(trans(coeffs) * predictors) + 3.0;
+  for (size_t i = 0; i < responses.n_elem; ++i)
+    responses[i] += math::Random() / 10.0;
+
+  arma::vec weights;
+  weights.randu(20000);
+  weights += 0.5;
+
+  for (size_t config = 0; config < 4; ++config)
+  {
+    const double lambda = (config % 2 == 0) ? 0.0 : 0.5;
+    const bool intercept = (config < 2);
+    const arma::vec w = (config == 1) ? weights : arma::vec();
+
+    LinearRegression qr(predictors, responses, lambda, intercept, w);
+    LinearRegression streaming(predictors, responses, lambda, intercept, w,
+        true);
+
+    BOOST_REQUIRE_EQUAL(streaming.Parameters().n_elem,
+        qr.Parameters().n_elem);
+    for (size_t i = 0; i < qr.Parameters().n_elem; ++i)
+      BOOST_REQUIRE_SMALL(streaming.Parameters()[i] - qr.Parameters()[i],
+          1e-8);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -4,6 +4,7 @@
  *
  * Tests for data::Load() and data::Save().
  */
+#include <iterator>
 #include <sstream>
 
 #include <mlpack/core.hpp>
@@ -11,6 +12,10 @@
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
 
+#ifdef MLPACK_HAS_ZLIB
+  #include <zlib.h>
+#endif
+
 using namespace mlpack;
 
 BOOST_AUTO_TEST_SUITE(LoadSaveTest);
@@ -493,6 +498,60 @@ BOOST_AUTO_TEST_CASE(SaveHDF5Test)
   remove("test_file.hdf5");
   remove("test_file.he5");
 }
+
+/**
+ * Make sure selected columns of an HDF5 file, with and without transposing,
+ * are the same as the columns of the whole loaded matrix, and that the file
+ * can be streamed in blocks.
+ */
+BOOST_AUTO_TEST_CASE(LoadHDF5ColumnsTest)
+{
+  arma::mat test = arma::randu<arma::mat>(5, 40);
+  BOOST_REQUIRE(data::Save("test_file.h5", test));
+
+  arma::Col<size_t> columns("3 4 5 17 0 4 39");
+  for (size_t t = 0; t < 2; ++t)
+  {
+    const bool transpose = (t == 0);
+    arma::mat all, selected;
+    BOOST_REQUIRE(data::Load("test_file.h5", all, false, transpose));
+    BOOST_REQUIRE(data::Load("test_file.h5", selected, columns, false,
+        transpose));
+
+    BOOST_REQUIRE_EQUAL(selected.n_rows, all.n_rows);
+    BOOST_REQUIRE_EQUAL(selected.n_cols, columns.n_elem);
+    for (size_t i = 0; i < columns.n_elem; ++i)
+      for (size_t j = 0; j < all.n_rows; ++j)
+        BOOST_REQUIRE_EQUAL(selected(j, i), all(j, columns[i]));
+
+    BOOST_REQUIRE(data::Load("test_file.h5", selected, arma::span(2, 4),
+        false, transpose));
+    BOOST_REQUIRE_EQUAL(selected.n_cols, 3);
+    for (size_t i = 0; i < 3; ++i)
+      for (size_t j = 0; j < all.n_rows; ++j)
+        BOOST_REQUIRE_EQUAL(selected(j, i), all(j, i + 2));
+  }
+
+  // Out-of-range columns are an error.
+  arma::mat selected;
+  BOOST_REQUIRE(!data::Load("test_file.h5", selected, arma::span(0, 40)));
+
+  data::StreamingReader reader("test_file.h5", 16);
+  BOOST_REQUIRE_EQUAL(reader.Dimensionality(), 5);
+  size_t points = 0;
+  arma::mat block;
+  while (reader.NextBlock(block))
+  {
+    BOOST_REQUIRE_EQUAL(block.n_rows, 5);
+    for (size_t i = 0; i < block.n_cols; ++i)
+      for (size_t j = 0; j < block.n_rows; ++j)
+        BOOST_REQUIRE_EQUAL(block(j, i), test(j, points + i));
+    points += block.n_cols;
+  }
+  BOOST_REQUIRE_EQUAL(points, 40);
+
+  remove("test_file.h5");
+}
 #else
 /**
  * Ensure saving as HDF5 fails.
@@ -563,4 +622,764 @@ BOOST_AUTO_TEST_CASE(NormalizeLabelTest)
     BOOST_REQUIRE_EQUAL(randLabels[i], revertedLabels[i]);
 }
 
+/**
+ * Labels which are spread over a large range (like user IDs) are numbered in
+ * the order they first appear in.
+ */
+BOOST_AUTO_TEST_CASE(NormalizeSparseLabelTest)
+{
+  arma::Col<size_t> ids(10000);
+  for (size_t i = 0; i < ids.n_elem; ++i)
+    ids[i] = 1000003 * (size_t) math::RandInt(0, 3000);
+
+  arma::Col<size_t> newLabels;
+  arma::Col<size_t> mappings;
+  data::NormalizeLabels(ids, newLabels, mappings);
+
+  // Each new label is at most one more than any earlier label.
+  size_t nextLabel = 0;
+  for (size_t i = 0; i < ids.n_elem; ++i)
+  {
+    BOOST_REQUIRE_LE(newLabels[i], nextLabel);
+    if (newLabels[i] == nextLabel)
+      ++nextLabel;
+    BOOST_REQUIRE_EQUAL(mappings[newLabels[i]], ids[i]);
+  }
+  BOOST_REQUIRE_EQUAL(mappings.n_elem, nextLabel);
+
+  arma::Col<size_t> revertedLabels;
+  data::RevertLabels(newLabels, mappings, revertedLabels);
+  for (size_t i = 0; i < ids.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(ids[i], revertedLabels[i]);
+}
+
+/**
+ * Make sure a matrix saved with SaveMapped() is mapped correctly.
+ */
+BOOST_AUTO_TEST_CASE(MappedMatrixTest)
+{
+  arma::mat test = arma::randu<arma::mat>(7, 31);
+
+  BOOST_REQUIRE(data::SaveMapped("test_file.bin", test));
+
+  {
+    data::MappedMatrix<double> mapped("test_file.bin");
+    const arma::mat& m = mapped.Matrix();
+
+    BOOST_REQUIRE(mapped.InPlace());
+    BOOST_REQUIRE_EQUAL(m.n_rows, 7);
+    BOOST_REQUIRE_EQUAL(m.n_cols, 31);
+    for (size_t i = 0; i < test.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(m[i], test[i]);
+  }
+
+  // Single-precision matrices work too.
+  arma::fmat ftest = arma::conv_to<arma::fmat>::from(test);
+  BOOST_REQUIRE(data::SaveMapped("test_file.bin", ftest));
+
+  {
+    data::MappedMatrix<float> mapped("test_file.bin");
+    const arma::fmat& m = mapped.Matrix();
+
+    BOOST_REQUIRE_EQUAL(m.n_rows, 7);
+    BOOST_REQUIRE_EQUAL(m.n_cols, 31);
+    for (size_t i = 0; i < ftest.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(m[i], ftest[i]);
+  }
+
+  // Remove the file.
+  remove("test_file.bin");
+}
+
+/**
+ * Make sure an Armadillo binary file is mapped correctly.
+ */
+BOOST_AUTO_TEST_CASE(MappedArmaBinaryTest)
+{
+  arma::mat test = arma::randu<arma::mat>(5, 120);
+
+  BOOST_REQUIRE(test.quiet_save("test_file.bin", arma::arma_binary));
+
+  {
+    data::MappedMatrix<double> mapped("test_file.bin");
+    const arma::mat& m = mapped.Matrix();
+
+    BOOST_REQUIRE_EQUAL(m.n_rows, 5);
+    BOOST_REQUIRE_EQUAL(m.n_cols, 120);
+    for (size_t i = 0; i < test.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(m[i], test[i]);
+  }
+
+  // Remove the file.
+  remove("test_file.bin");
+}
+
+/**
+ * Make sure matrices written by the parallel text writer are read back
+ * exactly, for doubles, floats and integers, transposed or not.
+ */
+BOOST_AUTO_TEST_CASE(SaveTextExactTest)
+{
+  arma::mat test = arma::randn<arma::mat>(6, 2000);
+  test.col(0).fill(3.0); // Integral values are formatted separately.
+  test(1, 1) = -1e-300;
+  test(2, 1) = 1e300;
+
+  const char* filenames[] = { "test_file.csv", "test_file.txt" };
+  for (size_t i = 0; i < 2; ++i)
+  {
+    for (size_t transpose = 0; transpose < 2; ++transpose)
+    {
+      BOOST_REQUIRE(data::Save(filenames[i], test, false, transpose == 1));
+      arma::mat loaded;
+      BOOST_REQUIRE(data::Load(filenames[i], loaded, false, transpose == 1));
+
+      BOOST_REQUIRE_EQUAL(loaded.n_rows, test.n_rows);
+      BOOST_REQUIRE_EQUAL(loaded.n_cols, test.n_cols);
+      for (size_t j = 0; j < test.n_elem; ++j)
+        BOOST_REQUIRE_EQUAL(loaded[j], test[j]);
+    }
+
+    remove(filenames[i]);
+  }
+
+  arma::fmat ftest = arma::conv_to<arma::fmat>::from(test.cols(1, 100));
+  BOOST_REQUIRE(data::Save("test_file.csv", ftest));
+  arma::fmat floaded;
+  BOOST_REQUIRE(data::Load("test_file.csv", floaded));
+  BOOST_REQUIRE_EQUAL(floaded.n_elem, ftest.n_elem);
+  for (size_t j = 0; j < ftest.n_elem; ++j)
+    BOOST_REQUIRE_EQUAL(floaded[j], ftest[j]);
+
+  arma::Mat<size_t> neighbors = arma::conv_to<arma::Mat<size_t> >::from(
+      100000 * arma::randu<arma::mat>(5, 300));
+  neighbors(0, 0) = 0;
+  BOOST_REQUIRE(data::Save("test_file.csv", neighbors));
+  arma::Mat<size_t> nloaded;
+  BOOST_REQUIRE(data::Load("test_file.csv", nloaded));
+  BOOST_REQUIRE_EQUAL(nloaded.n_elem, neighbors.n_elem);
+  for (size_t j = 0; j < neighbors.n_elem; ++j)
+    BOOST_REQUIRE_EQUAL(nloaded[j], neighbors[j]);
+
+  remove("test_file.csv");
+}
+
+/**
+ * Make sure a matrix saved with the .mapped extension can be mapped (without
+ * transposition) and loaded again.
+ */
+BOOST_AUTO_TEST_CASE(SaveMappedExtensionTest)
+{
+  arma::Mat<size_t> test = arma::conv_to<arma::Mat<size_t> >::from(
+      1000 * arma::randu<arma::mat>(4, 50));
+
+  BOOST_REQUIRE(data::Save("test_file.mapped", test));
+
+  {
+    data::MappedMatrix<size_t> mapped("test_file.mapped");
+    const arma::Mat<size_t>& m = mapped.Matrix();
+
+    BOOST_REQUIRE_EQUAL(m.n_rows, 4);
+    BOOST_REQUIRE_EQUAL(m.n_cols, 50);
+    for (size_t i = 0; i < test.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(m[i], test[i]);
+  }
+
+  arma::Mat<size_t> loaded;
+  BOOST_REQUIRE(data::Load("test_file.mapped", loaded));
+  BOOST_REQUIRE_EQUAL(loaded.n_rows, 4);
+  BOOST_REQUIRE_EQUAL(loaded.n_cols, 50);
+  for (size_t i = 0; i < test.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(loaded[i], test[i]);
+
+  // The element type must match.
+  arma::mat wrongType;
+  BOOST_REQUIRE(!data::Load("test_file.mapped", wrongType));
+
+  // Remove the file.
+  remove("test_file.mapped");
+}
+
+#ifdef MLPACK_HAS_ZLIB
+/**
+ * Make sure a gzip-compressed CSV file (here of two concatenated gzip members)
+ * is loaded as the uncompressed file is.
+ */
+BOOST_AUTO_TEST_CASE(LoadGzipCSVTest)
+{
+  arma::mat test = arma::randu<arma::mat>(3, 200);
+  BOOST_REQUIRE(data::Save("test_file.csv", test));
+
+  std::ifstream f("test_file.csv");
+  const std::string text((std::istreambuf_iterator<char>(f)),
+      std::istreambuf_iterator<char>());
+  f.close();
+  const size_t half = text.find('\n', text.size() / 2) + 1;
+
+  for (size_t i = 0; i < 2; ++i)
+  {
+    gzFile gz = gzopen("test_file.csv.gz", (i == 0) ? "wb" : "ab");
+    BOOST_REQUIRE(gz != NULL);
+    const std::string part = (i == 0) ? text.substr(0, half) :
+        text.substr(half);
+    BOOST_REQUIRE_EQUAL(gzwrite(gz, part.data(), unsigned(part.size())),
+        int(part.size()));
+    gzclose(gz);
+  }
+
+  arma::mat loaded, compressed;
+  BOOST_REQUIRE(data::Load("test_file.csv", loaded));
+  BOOST_REQUIRE(data::Load("test_file.csv.gz", compressed));
+
+  BOOST_REQUIRE_EQUAL(compressed.n_rows, loaded.n_rows);
+  BOOST_REQUIRE_EQUAL(compressed.n_cols, loaded.n_cols);
+  for (size_t i = 0; i < loaded.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(compressed[i], loaded[i]);
+
+  // Remove the files.
+  remove("test_file.csv");
+  remove("test_file.csv.gz");
+}
+#endif
+
+/**
+ * Make sure a file with a compression extension which is not compressed fails
+ * to load.
+ */
+BOOST_AUTO_TEST_CASE(LoadInvalidCompressedTest)
+{
+  std::fstream f;
+  f.open("test_file.csv.gz", std::fstream::out);
+  f << "1, 2, 3" << std::endl;
+  f.close();
+
+  arma::mat test;
+  BOOST_REQUIRE(!data::Load("test_file.csv.gz", test));
+
+  // Remove the file.
+  remove("test_file.csv.gz");
+}
+
+/**
+ * Make sure selected columns of a file which cannot be read in parts are the
+ * same as the columns of the whole loaded matrix.
+ */
+BOOST_AUTO_TEST_CASE(LoadColumnsCSVTest)
+{
+  arma::mat test = arma::randu<arma::mat>(4, 30);
+  BOOST_REQUIRE(data::Save("test_file.csv", test));
+
+  arma::mat all, selected;
+  BOOST_REQUIRE(data::Load("test_file.csv", all));
+  arma::Col<size_t> columns("29 1 1 7");
+  BOOST_REQUIRE(data::Load("test_file.csv", selected, columns));
+
+  BOOST_REQUIRE_EQUAL(selected.n_rows, 4);
+  BOOST_REQUIRE_EQUAL(selected.n_cols, 4);
+  for (size_t i = 0; i < columns.n_elem; ++i)
+    for (size_t j = 0; j < 4; ++j)
+      BOOST_REQUIRE_EQUAL(selected(j, i), all(j, columns[i]));
+
+  columns[0] = 30;
+  BOOST_REQUIRE(!data::Load("test_file.csv", selected, columns));
+
+  // Remove the file.
+  remove("test_file.csv");
+}
+
+/**
+ * Make sure a point-major buffer of the matrix's element type is used in place,
+ * and that point-major buffers of another type and feature-major buffers give
+ * the same matrix.
+ */
+BOOST_AUTO_TEST_CASE(ColumnarMatrixTest)
+{
+  // Enough points for several transpose blocks.
+  arma::mat test = arma::randu<arma::mat>(3, 1000);
+
+  data::ColumnarMatrix<double> inPlace(test.memptr(), 3, 1000);
+  BOOST_REQUIRE(inPlace.InPlace());
+  BOOST_REQUIRE_EQUAL(inPlace.Matrix().memptr(), test.memptr());
+  BOOST_REQUIRE_EQUAL(inPlace.Matrix().n_rows, 3);
+  BOOST_REQUIRE_EQUAL(inPlace.Matrix().n_cols, 1000);
+
+  arma::fmat singles = arma::conv_to<arma::fmat>::from(test);
+  data::ColumnarMatrix<double> converted(singles.memptr(), 3, 1000);
+  BOOST_REQUIRE(!converted.InPlace());
+  for (size_t i = 0; i < test.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(converted.Matrix()[i], (double) singles[i]);
+
+  // Each row of the transposed matrix is a contiguous buffer of one feature.
+  arma::mat features = trans(test);
+  std::vector<const double*> buffers;
+  for (size_t d = 0; d < 3; ++d)
+    buffers.push_back(features.colptr(d));
+
+  data::ColumnarMatrix<double> gathered(buffers, 1000);
+  BOOST_REQUIRE(!gathered.InPlace());
+  BOOST_REQUIRE_EQUAL(gathered.Matrix().n_rows, 3);
+  BOOST_REQUIRE_EQUAL(gathered.Matrix().n_cols, 1000);
+  for (size_t i = 0; i < test.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(gathered.Matrix()[i], test[i]);
+}
+
+/**
+ * Make sure numbers in various notations are parsed exactly, and that spaces
+ * and Windows line endings are handled.
+ */
+BOOST_AUTO_TEST_CASE(LoadCSVNotationTest)
+{
+  std::fstream f;
+  f.open("test_file.csv", std::fstream::out);
+
+  f << "1.5, -2e3,+0.25 ,3.0E-2\r\n";
+  f << "  0.1,12345678901234567890,1e-300,-0.0\r\n";
+  f << "\n";
+  f.close();
+
+  arma::mat test;
+  BOOST_REQUIRE(data::Load("test_file.csv", test) == true);
+
+  BOOST_REQUIRE_EQUAL(test.n_rows, 4);
+  BOOST_REQUIRE_EQUAL(test.n_cols, 2);
+
+  BOOST_REQUIRE_EQUAL(test(0, 0), 1.5);
+  BOOST_REQUIRE_EQUAL(test(1, 0), -2000.0);
+  BOOST_REQUIRE_EQUAL(test(2, 0), 0.25);
+  BOOST_REQUIRE_EQUAL(test(3, 0), strtod("3.0E-2", NULL));
+  BOOST_REQUIRE_EQUAL(test(0, 1), strtod("0.1", NULL));
+  BOOST_REQUIRE_EQUAL(test(1, 1), strtod("12345678901234567890", NULL));
+  BOOST_REQUIRE_EQUAL(test(2, 1), strtod("1e-300", NULL));
+  BOOST_REQUIRE_EQUAL(test(3, 1), 0.0);
+
+  // Remove the file.
+  remove("test_file.csv");
+}
+
+/**
+ * Make sure a large file (which is parsed in several chunks) is loaded
+ * correctly, both transposed and not transposed.
+ */
+BOOST_AUTO_TEST_CASE(LoadLargeASCIITest)
+{
+  arma::mat data = arma::randu<arma::mat>(6, 50000);
+
+  std::fstream f;
+  f.open("test_file.txt", std::fstream::out);
+  f.precision(17);
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    for (size_t j = 0; j < data.n_rows; ++j)
+      f << data(j, i) << ((j == data.n_rows - 1) ? "\n" : " ");
+  }
+  f.close();
+
+  arma::mat test;
+  BOOST_REQUIRE(data::Load("test_file.txt", test) == true);
+
+  BOOST_REQUIRE_EQUAL(test.n_rows, data.n_rows);
+  BOOST_REQUIRE_EQUAL(test.n_cols, data.n_cols);
+  for (size_t i = 0; i < data.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(test[i], data[i]);
+
+  arma::fmat ftest;
+  BOOST_REQUIRE(data::Load("test_file.txt", ftest, false, false) == true);
+
+  BOOST_REQUIRE_EQUAL(ftest.n_rows, data.n_cols);
+  BOOST_REQUIRE_EQUAL(ftest.n_cols, data.n_rows);
+  for (size_t i = 0; i < data.n_rows; ++i)
+    for (size_t j = 0; j < data.n_cols; ++j)
+      BOOST_REQUIRE_EQUAL(ftest(j, i), (float) data(i, j));
+
+  // Remove the file.
+  remove("test_file.txt");
+}
+
+/**
+ * Make sure a CSV with a different number of columns on some line is still
+ * loaded as Armadillo loads it.
+ */
+BOOST_AUTO_TEST_CASE(LoadRaggedCSVTest)
+{
+  std::fstream f;
+  f.open("test_file.csv", std::fstream::out);
+
+  f << "1, 2, 3" << std::endl;
+  f << "4, 5" << std::endl;
+  f.close();
+
+  arma::mat expected;
+  expected.load("test_file.csv", arma::csv_ascii);
+
+  arma::mat test;
+  BOOST_REQUIRE(data::Load("test_file.csv", test) == true);
+
+  BOOST_REQUIRE_EQUAL(test.n_rows, expected.n_cols);
+  BOOST_REQUIRE_EQUAL(test.n_cols, expected.n_rows);
+  for (size_t i = 0; i < expected.n_rows; ++i)
+    for (size_t j = 0; j < expected.n_cols; ++j)
+      BOOST_REQUIRE_EQUAL(test(j, i), expected(i, j));
+
+  // Remove the file.
+  remove("test_file.csv");
+}
+
+/**
+ * Read every block of the given reader, checking their sizes, and return the
+ * points.
+ */
+arma::mat ReadAllBlocks(data::StreamingReader& reader)
+{
+  arma::mat points(reader.Dimensionality(), 0);
+  arma::mat block;
+  bool lastBlock = false;
+  while (reader.NextBlock(block))
+  {
+    // Only the last block may be smaller than the block size.
+    BOOST_REQUIRE(!lastBlock);
+    BOOST_REQUIRE_EQUAL(block.n_rows, reader.Dimensionality());
+    BOOST_REQUIRE_LE(block.n_cols, reader.BlockSize());
+    lastBlock = (block.n_cols < reader.BlockSize());
+
+    points.insert_cols(points.n_cols, block);
+  }
+
+  return points;
+}
+
+/**
+ * Make sure the blocks of a CSV file hold the same points as the matrix
+ * loaded by data::Load(), with and without prefetching, over two passes.
+ */
+BOOST_AUTO_TEST_CASE(StreamingReaderCSVTest)
+{
+  arma::mat data = arma::randu<arma::mat>(4, 103);
+  data::Save("test_file.csv", data);
+
+  arma::mat loaded;
+  data::Load("test_file.csv", loaded);
+
+  for (size_t prefetch = 0; prefetch < 2; ++prefetch)
+  {
+    data::StreamingReader reader("test_file.csv", 10, true, (prefetch == 1));
+    BOOST_REQUIRE_EQUAL(reader.Dimensionality(), 4);
+
+    for (size_t pass = 0; pass < 2; ++pass)
+    {
+      arma::mat points = ReadAllBlocks(reader);
+
+      BOOST_REQUIRE_EQUAL(points.n_rows, loaded.n_rows);
+      BOOST_REQUIRE_EQUAL(points.n_cols, loaded.n_cols);
+      for (size_t i = 0; i < loaded.n_elem; ++i)
+        BOOST_REQUIRE_EQUAL(points[i], loaded[i]);
+
+      reader.Reset();
+    }
+  }
+
+  // Remove the file.
+  remove("test_file.csv");
+}
+
+/**
+ * Make sure the blocks of binary files hold the right points, both for
+ * Armadillo binary files written by data::Save() (which are transposed) and
+ * for mapped matrix files (which are not).
+ */
+BOOST_AUTO_TEST_CASE(StreamingReaderBinaryTest)
+{
+  arma::mat data = arma::randu<arma::mat>(5, 64);
+
+  data::Save("test_file.bin", data);
+  {
+    data::StreamingReader reader("test_file.bin", 16);
+    arma::mat points = ReadAllBlocks(reader);
+
+    BOOST_REQUIRE_EQUAL(points.n_rows, data.n_rows);
+    BOOST_REQUIRE_EQUAL(points.n_cols, data.n_cols);
+    for (size_t i = 0; i < data.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(points[i], data[i]);
+  }
+
+  data::SaveMapped("test_file.bin", data);
+  {
+    data::StreamingReader reader("test_file.bin", 9, false);
+    arma::mat points = ReadAllBlocks(reader);
+
+    BOOST_REQUIRE_EQUAL(points.n_rows, data.n_rows);
+    BOOST_REQUIRE_EQUAL(points.n_cols, data.n_cols);
+    for (size_t i = 0; i < data.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(points[i], data[i]);
+  }
+
+  // Remove the file.
+  remove("test_file.bin");
+}
+
+/**
+ * Make sure coordinate lists are loaded into sparse matrices, transposed or
+ * not.
+ */
+BOOST_AUTO_TEST_CASE(LoadSparseCoordinatesTest)
+{
+  std::fstream f;
+  f.open("test_file.csv", std::fstream::out);
+  f << "0, 1, 2.5" << std::endl;
+  f << "3, 0, -1" << std::endl;
+  f << std::endl;
+  f << "2, 4, 0.5" << std::endl;
+  f.close();
+
+  arma::sp_mat matrix;
+  BOOST_REQUIRE(data::Load("test_file.csv", matrix));
+
+  BOOST_REQUIRE_EQUAL(matrix.n_rows, 5);
+  BOOST_REQUIRE_EQUAL(matrix.n_cols, 4);
+  BOOST_REQUIRE_EQUAL(matrix.n_nonzero, 3);
+  BOOST_REQUIRE_CLOSE((double) matrix(1, 0), 2.5, 1e-5);
+  BOOST_REQUIRE_CLOSE((double) matrix(0, 3), -1.0, 1e-5);
+  BOOST_REQUIRE_CLOSE((double) matrix(4, 2), 0.5, 1e-5);
+
+  f.open("test_file.txt", std::fstream::out);
+  f << "0 1 2.5" << std::endl;
+  f << "3 0 -1" << std::endl;
+  f.close();
+
+  BOOST_REQUIRE(data::Load("test_file.txt", matrix, false, false));
+
+  BOOST_REQUIRE_EQUAL(matrix.n_rows, 4);
+  BOOST_REQUIRE_EQUAL(matrix.n_cols, 2);
+  BOOST_REQUIRE_EQUAL(matrix.n_nonzero, 2);
+  BOOST_REQUIRE_CLOSE((double) matrix(0, 1), 2.5, 1e-5);
+  BOOST_REQUIRE_CLOSE((double) matrix(3, 0), -1.0, 1e-5);
+
+  // A negative index is an error.
+  f.open("test_file.txt", std::fstream::out);
+  f << "0 -1 2.5" << std::endl;
+  f.close();
+
+  BOOST_REQUIRE(!data::Load("test_file.txt", matrix));
+
+  // Remove the files.
+  remove("test_file.csv");
+  remove("test_file.txt");
+}
+
+/**
+ * A location given twice is an error, and elements whose value is zero are not
+ * stored.
+ */
+BOOST_AUTO_TEST_CASE(LoadSparseCoordinatesDuplicateTest)
+{
+  std::fstream f;
+  f.open("test_file.txt", std::fstream::out);
+  f << "0 1 2.5" << std::endl;
+  f << "2 2 0" << std::endl;
+  f << "3 0 -1" << std::endl;
+  f.close();
+
+  arma::sp_mat matrix;
+  BOOST_REQUIRE(data::Load("test_file.txt", matrix));
+
+  BOOST_REQUIRE_EQUAL(matrix.n_rows, 3);
+  BOOST_REQUIRE_EQUAL(matrix.n_cols, 4);
+  BOOST_REQUIRE_EQUAL(matrix.n_nonzero, 2);
+
+  f.open("test_file.txt", std::fstream::out);
+  f << "0 1 2.5" << std::endl;
+  f << "3 0 -1" << std::endl;
+  f << "0 1 1.5" << std::endl;
+  f.close();
+
+  BOOST_REQUIRE(!data::Load("test_file.txt", matrix));
+
+  // Remove the file.
+  remove("test_file.txt");
+}
+
+/**
+ * Make sure sparse matrices survive being saved and loaded again, as
+ * coordinate lists and in the sparse matrix format, transposed or not.
+ */
+BOOST_AUTO_TEST_CASE(SaveLoadSparseTest)
+{
+  arma::sp_mat matrix;
+  matrix.sprandu(50, 80, 0.1);
+
+  const char* filenames[] = { "test_file.csv", "test_file.txt",
+      "test_file.bin" };
+  for (size_t i = 0; i < 3; ++i)
+  {
+    for (size_t transpose = 0; transpose < 2; ++transpose)
+    {
+      BOOST_REQUIRE(data::Save(filenames[i], matrix, false, transpose == 1));
+
+      arma::sp_mat loaded;
+      BOOST_REQUIRE(data::Load(filenames[i], loaded, false, transpose == 1));
+
+      // The size is given by the largest indices of a coordinate list, so it
+      // may be smaller.
+      BOOST_REQUIRE_LE(loaded.n_rows, matrix.n_rows);
+      BOOST_REQUIRE_LE(loaded.n_cols, matrix.n_cols);
+      BOOST_REQUIRE_EQUAL(loaded.n_nonzero, matrix.n_nonzero);
+      for (arma::sp_mat::const_iterator it = matrix.begin();
+           it != matrix.end(); ++it)
+        BOOST_REQUIRE_CLOSE((double) loaded(it.row(), it.col()), *it, 1e-10);
+    }
+
+    remove(filenames[i]);
+  }
+}
+
+/**
+ * Make sure the sparse matrix format is recognized by its contents, and that
+ * its arrays are read exactly; a truncated file is an error.
+ */
+BOOST_AUTO_TEST_CASE(MappedSparseTest)
+{
+  arma::sp_mat matrix;
+  matrix.sprandu(100, 30, 0.05);
+
+  BOOST_REQUIRE(data::SaveMapped("test_file.spm", matrix));
+
+  arma::sp_mat loaded;
+  BOOST_REQUIRE(data::Load("test_file.spm", loaded));
+
+  BOOST_REQUIRE_EQUAL(loaded.n_rows, matrix.n_rows);
+  BOOST_REQUIRE_EQUAL(loaded.n_cols, matrix.n_cols);
+  BOOST_REQUIRE_EQUAL(loaded.n_nonzero, matrix.n_nonzero);
+  for (size_t i = 0; i <= matrix.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(loaded.col_ptrs[i], matrix.col_ptrs[i]);
+  for (size_t i = 0; i < matrix.n_nonzero; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(loaded.row_indices[i], matrix.row_indices[i]);
+    BOOST_REQUIRE_EQUAL(loaded.values[i], matrix.values[i]);
+  }
+
+  // Cut off the last value.
+  std::vector<char> contents;
+  {
+    std::ifstream in("test_file.spm", std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(in),
+        std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream out("test_file.spm", std::ios::binary);
+    out.write(&contents[0], contents.size() - sizeof(double));
+  }
+
+  BOOST_REQUIRE(!data::Load("test_file.spm", loaded));
+
+  remove("test_file.spm");
+}
+
+/**
+ * Make sure the Morton and Hilbert orders are permutations of the points, and
+ * that UnmapColumns() undoes ReorderColumns().
+ */
+BOOST_AUTO_TEST_CASE(SpaceFillingCurvePermutationTest)
+{
+  arma::mat dataset(3, 1000);
+  dataset.randn();
+
+  for (size_t curve = 0; curve < 2; ++curve)
+  {
+    std::vector<size_t> oldFromNew;
+    if (curve == 0)
+      data::MortonOrder(dataset, oldFromNew);
+    else
+      data::HilbertOrder(dataset, oldFromNew);
+
+    BOOST_REQUIRE_EQUAL(oldFromNew.size(), dataset.n_cols);
+    std::vector<bool> seen(dataset.n_cols, false);
+    for (size_t i = 0; i < oldFromNew.size(); ++i)
+    {
+      BOOST_REQUIRE_LT(oldFromNew[i], dataset.n_cols);
+      BOOST_REQUIRE(!seen[oldFromNew[i]]);
+      seen[oldFromNew[i]] = true;
+    }
+
+    arma::mat reordered(dataset);
+    data::ReorderColumns(reordered, oldFromNew);
+    for (size_t i = 0; i < oldFromNew.size(); ++i)
+      BOOST_REQUIRE_EQUAL(reordered(1, i), dataset(1, oldFromNew[i]));
+
+    data::UnmapColumns(reordered, oldFromNew);
+    for (size_t i = 0; i < dataset.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(reordered[i], dataset[i]);
+  }
+}
+
+/**
+ * The Morton order of a 2x2 grid is the Z shape, with the first dimension most
+ * significant.
+ */
+BOOST_AUTO_TEST_CASE(MortonOrderGridTest)
+{
+  arma::mat dataset("1 1 0 0;"
+                    "1 0 1 0");
+
+  std::vector<size_t> oldFromNew;
+  data::MortonOrder(dataset, oldFromNew, 1);
+
+  BOOST_REQUIRE_EQUAL(oldFromNew[0], 3);
+  BOOST_REQUIRE_EQUAL(oldFromNew[1], 2);
+  BOOST_REQUIRE_EQUAL(oldFromNew[2], 1);
+  BOOST_REQUIRE_EQUAL(oldFromNew[3], 0);
+}
+
+/**
+ * Consecutive cells of the Hilbert curve are adjacent, so every step along the
+ * Hilbert order of a full grid has length 1, in two and three dimensions.
+ */
+BOOST_AUTO_TEST_CASE(HilbertOrderGridTest)
+{
+  for (size_t d = 2; d <= 3; ++d)
+  {
+    const size_t side = (d == 2) ? 8 : 4;
+    const size_t bits = (d == 2) ? 3 : 2;
+    const size_t n = (d == 2) ? side * side : side * side * side;
+
+    // Shuffle the grid points, so the order is not the input order.
+    arma::mat dataset(d, n);
+    const arma::uvec shuffle = arma::shuffle(arma::linspace<arma::uvec>(0,
+        n - 1, n));
+    for (size_t i = 0; i < n; ++i)
+    {
+      size_t cell = shuffle[i];
+      for (size_t j = 0; j < d; ++j, cell /= side)
+        dataset(j, i) = (double) (cell % side);
+    }
+
+    std::vector<size_t> oldFromNew;
+    data::HilbertOrder(dataset, oldFromNew, bits);
+    for (size_t i = 1; i < n; ++i)
+    {
+      const double step = arma::accu(arma::abs(
+          dataset.col(oldFromNew[i]) - dataset.col(oldFromNew[i - 1])));
+      BOOST_REQUIRE_CLOSE(step, 1.0, 1e-5);
+    }
+  }
+}
+
+/**
+ * UnmapIndices() maps indices into the rearranged points to the original
+ * indices, and leaves indices of missing points alone.
+ */
+BOOST_AUTO_TEST_CASE(UnmapIndicesTest)
+{
+  std::vector<size_t> oldFromNew;
+  oldFromNew.push_back(2);
+  oldFromNew.push_back(0);
+  oldFromNew.push_back(1);
+
+  arma::Mat<size_t> indices("0 1; 2 3");
+  data::UnmapIndices(indices, oldFromNew);
+
+  BOOST_REQUIRE_EQUAL(indices(0, 0), 2);
+  BOOST_REQUIRE_EQUAL(indices(0, 1), 0);
+  BOOST_REQUIRE_EQUAL(indices(1, 0), 1);
+  BOOST_REQUIRE_EQUAL(indices(1, 1), 3);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -465,6 +465,148 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionRegularizationSeparableGradient)
   }
 }
 
+/**
+ * Make sure EvaluateWithGradient() gives the same results as separate calls to
+ * Evaluate() and Gradient().
+ */
+BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionEvaluateWithGradient)
+{
+  arma::mat data;
+  data.randu(10, 50);
+  arma::vec responses(50);
+  for (size_t i = 0; i < 50; ++i)
+    responses[i] = (data(0, i) > 0.5) ? 1 : 0;
+
+  LogisticRegressionFunction lrf(data, responses, 0.4);
+  const arma::mat parameters = arma::randu<arma::mat>(11, 1);
+
+  arma::mat gradient, fusedGradient;
+  for (size_t i = 0; i < 50; ++i)
+  {
+    lrf.Gradient(parameters, i, gradient);
+    const double objective = lrf.EvaluateWithGradient(parameters, i,
+        fusedGradient);
+
+    BOOST_REQUIRE_CLOSE(objective, lrf.Evaluate(parameters, i), 1e-5);
+    BOOST_REQUIRE_EQUAL(fusedGradient.n_elem, gradient.n_elem);
+    for (size_t j = 0; j < gradient.n_elem; ++j)
+      BOOST_REQUIRE_CLOSE(fusedGradient[j], gradient[j], 1e-5);
+  }
+}
+
+/**
+ * The full objective and gradient are computed over blocks of points; check
+ * them against the sums of the separable ones on a dataset with several blocks.
+ */
+BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionBlockedGradient)
+{
+  const size_t points = 10000;
+  arma::mat data;
+  data.randu(5, points);
+  arma::vec responses(points);
+  for (size_t i = 0; i < points; ++i)
+    responses[i] = (data(1, i) > 0.5) ? 1 : 0;
+
+  LogisticRegressionFunction lrf(data, responses, 0.3);
+  const arma::mat parameters = arma::randu<arma::mat>(6, 1) - 0.5;
+
+  double objective = 0;
+  arma::mat sumGradient(6, 1), pointGradient;
+  sumGradient.zeros();
+  for (size_t i = 0; i < points; ++i)
+  {
+    objective += lrf.Evaluate(parameters, i);
+    lrf.Gradient(parameters, i, pointGradient);
+    sumGradient += pointGradient;
+  }
+
+  BOOST_REQUIRE_CLOSE(lrf.Evaluate(parameters), objective, 1e-5);
+
+  arma::mat gradient;
+  lrf.Gradient(parameters, gradient);
+  BOOST_REQUIRE_EQUAL(gradient.n_elem, 6);
+  for (size_t j = 0; j < 6; ++j)
+    BOOST_REQUIRE_CLOSE(gradient[j], sumGradient[j], 1e-5);
+}
+
+/**
+ * Make sure the full-data EvaluateWithGradient() gives the same results as
+ * Evaluate() and Gradient().
+ */
+BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionFullEvaluateWithGradient)
+{
+  arma::mat data;
+  data.randu(10, 50);
+  arma::vec responses(50);
+  for (size_t i = 0; i < 50; ++i)
+    responses[i] = (data(0, i) > 0.5) ? 1 : 0;
+
+  LogisticRegressionFunction lrf(data, responses, 0.4);
+  const arma::mat parameters = arma::randu<arma::mat>(11, 1);
+
+  arma::mat gradient, fusedGradient;
+  lrf.Gradient(parameters, gradient);
+  const double objective = lrf.EvaluateWithGradient(parameters, fusedGradient);
+
+  BOOST_REQUIRE_CLOSE(objective, lrf.Evaluate(parameters), 1e-5);
+  BOOST_REQUIRE_EQUAL(fusedGradient.n_elem, gradient.n_elem);
+  for (size_t j = 0; j < gradient.n_elem; ++j)
+    BOOST_REQUIRE_CLOSE(fusedGradient[j], gradient[j], 1e-5);
+}
+
+/**
+ * With sparse predictors, the objective and the gradients should be the same as
+ * with the same predictors stored densely.
+ */
+BOOST_AUTO_TEST_CASE(SparseLogisticRegressionFunctionTest)
+{
+  const size_t points = 5000;
+  arma::sp_mat sparseData;
+  sparseData.sprandu(100, points, 0.05);
+  const arma::mat data(sparseData);
+
+  arma::vec responses(points);
+  for (size_t i = 0; i < points; ++i)
+    responses[i] = (data(3, i) > 0.0) ? 1 : 0;
+
+  LogisticRegressionFunction lrf(data, responses, 0.2);
+  SparseLogisticRegressionFunction sparseLrf(sparseData, responses, 0.2);
+
+  const arma::mat parameters = arma::randu<arma::mat>(101, 1) - 0.5;
+
+  BOOST_REQUIRE_CLOSE(sparseLrf.Evaluate(parameters), lrf.Evaluate(parameters),
+      1e-5);
+
+  arma::mat gradient, sparseGradient;
+  lrf.Gradient(parameters, gradient);
+  sparseLrf.Gradient(parameters, sparseGradient);
+  BOOST_REQUIRE_EQUAL(sparseGradient.n_elem, gradient.n_elem);
+  for (size_t j = 0; j < gradient.n_elem; ++j)
+  {
+    if (std::abs(gradient[j]) < 1e-10)
+      BOOST_REQUIRE_SMALL(sparseGradient[j], 1e-10);
+    else
+      BOOST_REQUIRE_CLOSE(sparseGradient[j], gradient[j], 1e-5);
+  }
+
+  // Check some of the separable objectives and gradients too.
+  for (size_t i = 0; i < points; i += 97)
+  {
+    BOOST_REQUIRE_CLOSE(sparseLrf.Evaluate(parameters, i),
+        lrf.Evaluate(parameters, i), 1e-5);
+
+    lrf.Gradient(parameters, i, gradient);
+    sparseLrf.Gradient(parameters, i, sparseGradient);
+    for (size_t j = 0; j < gradient.n_elem; ++j)
+    {
+      if (std::abs(gradient[j]) < 1e-10)
+        BOOST_REQUIRE_SMALL(sparseGradient[j], 1e-10);
+      else
+        BOOST_REQUIRE_CLOSE(sparseGradient[j], gradient[j], 1e-5);
+    }
+  }
+}
+
 // Test training of logistic regression on a simple dataset.
 BOOST_AUTO_TEST_CASE(LogisticRegressionLBFGSSimpleTest)
 {
@@ -696,4 +838,46 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionInstantiatedOptimizer)
   BOOST_REQUIRE_SMALL(sigmoids[2], 0.1);
 }
 
+/**
+ * The batch scorer should give the same predictions as the model, in double
+ * precision, and very close probabilities in single precision.
+ */
+BOOST_AUTO_TEST_CASE(LogisticRegressionScorerTest)
+{
+  const size_t points = 10000;
+  arma::mat data;
+  data.randn(8, points);
+
+  const arma::vec parameters = arma::randn<arma::vec>(9);
+  LogisticRegression<> lr(parameters);
+
+  arma::vec responses;
+  lr.Predict(data, responses, 0.3);
+
+  LogisticRegressionScorer<> scorer(parameters);
+  arma::vec batchResponses(points);
+  scorer.Predict(data, batchResponses, 0.3);
+  BOOST_REQUIRE_EQUAL(batchResponses.n_elem, points);
+
+  // Ignore points whose probability is too close to the decision boundary.
+  arma::vec probabilities;
+  scorer.Probabilities(data, probabilities);
+  for (size_t i = 0; i < points; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(probabilities[i], 1.0 / (1.0 + std::exp(-parameters[0]
+        - arma::dot(data.col(i), parameters.subvec(1, 8)))), 1e-5);
+    if (std::abs(probabilities[i] - 0.3) > 1e-8)
+      BOOST_REQUIRE_EQUAL(batchResponses[i], responses[i]);
+  }
+
+  // Single precision.
+  LogisticRegressionScorer<float> floatScorer(parameters);
+  const arma::fmat floatData = arma::conv_to<arma::fmat>::from(data);
+  arma::fvec floatProbabilities;
+  floatScorer.Probabilities(floatData, floatProbabilities);
+  BOOST_REQUIRE_EQUAL(floatProbabilities.n_elem, points);
+  for (size_t i = 0; i < points; ++i)
+    BOOST_REQUIRE_SMALL(floatProbabilities[i] - probabilities[i], 1e-4);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
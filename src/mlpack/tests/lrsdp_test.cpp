@@ -131,6 +131,105 @@ BOOST_AUTO_TEST_CASE(Johnson844LovaszThetaSDP)
   }
 }
 
+/**
+ * Make sure that constraints stored as dense matrices, as lists of entries and
+ * as sparse matrices give the same augmented Lagrangian objective and gradient,
+ * and that these match the expressions computed with R R^T.
+ */
+BOOST_AUTO_TEST_CASE(SparseConstraintModesTest)
+{
+  const size_t n = 20;
+  const size_t r = 3;
+  arma::mat coordinates(n, r);
+  coordinates.randu();
+
+  // Each constraint is a random symmetric matrix with a few nonzero entries.
+  arma::mat c(n, n);
+  c.randn();
+  c += trans(c);
+  std::vector<arma::mat> denseA(3);
+  for (size_t i = 0; i < denseA.size(); ++i)
+  {
+    denseA[i].zeros(n, n);
+    for (size_t k = 0; k < 5; ++k)
+    {
+      const size_t row = math::RandInt(n);
+      const size_t col = math::RandInt(n);
+      const double value = math::Random(-1.0, 1.0);
+      denseA[i](row, col) += value;
+      if (row != col)
+        denseA[i](col, row) += value;
+    }
+  }
+
+  arma::vec b(3);
+  b.randu();
+  arma::vec lambda(3);
+  lambda.randn();
+
+  // Mode 0 with a dense objective, mode 1 and mode 2 with a sparse objective.
+  LRSDPFunction dense(3, coordinates);
+  LRSDPFunction entries(3, coordinates);
+  LRSDPFunction sparse(3, coordinates);
+  dense.C() = c;
+  entries.SparseC() = arma::sp_mat(c);
+  sparse.SparseC() = arma::sp_mat(c);
+  dense.B() = b;
+  entries.B() = b;
+  sparse.B() = b;
+  dense.AModes().zeros();
+  entries.AModes().ones();
+  sparse.AModes().fill(2);
+
+  for (size_t i = 0; i < denseA.size(); ++i)
+  {
+    dense.A()[i] = denseA[i];
+    sparse.SparseA()[i] = arma::sp_mat(denseA[i]);
+
+    const arma::uvec nonzeros = arma::find(denseA[i]);
+    entries.A()[i].set_size(3, nonzeros.n_elem);
+    for (size_t k = 0; k < nonzeros.n_elem; ++k)
+    {
+      entries.A()[i](0, k) = nonzeros[k] % n;
+      entries.A()[i](1, k) = nonzeros[k] / n;
+      entries.A()[i](2, k) = denseA[i][nonzeros[k]];
+    }
+  }
+
+  // The objective and the gradient, computed with R R^T.
+  const arma::mat rrt = coordinates * trans(coordinates);
+  double objective = trace(c * rrt);
+  arma::mat s = c;
+  for (size_t i = 0; i < denseA.size(); ++i)
+  {
+    const double constraint = trace(denseA[i] * rrt) - b[i];
+    objective += -lambda[i] * constraint + 5.0 * std::pow(constraint, 2.0);
+    s -= (lambda[i] - 10.0 * constraint) * denseA[i];
+  }
+  const arma::mat gradient = 2 * s * coordinates;
+
+  AugLagrangianFunction<LRSDPFunction> denseAug(dense, lambda, 10.0);
+  AugLagrangianFunction<LRSDPFunction> entriesAug(entries, lambda, 10.0);
+  AugLagrangianFunction<LRSDPFunction> sparseAug(sparse, lambda, 10.0);
+
+  BOOST_REQUIRE_CLOSE(denseAug.Evaluate(coordinates), objective, 1e-5);
+  BOOST_REQUIRE_CLOSE(entriesAug.Evaluate(coordinates), objective, 1e-5);
+  BOOST_REQUIRE_CLOSE(sparseAug.Evaluate(coordinates), objective, 1e-5);
+  BOOST_REQUIRE_CLOSE(sparse.Evaluate(coordinates), trace(c * rrt), 1e-5);
+
+  arma::mat denseGradient, entriesGradient, sparseGradient;
+  denseAug.Gradient(coordinates, denseGradient);
+  entriesAug.Gradient(coordinates, entriesGradient);
+  sparseAug.Gradient(coordinates, sparseGradient);
+
+  for (size_t i = 0; i < gradient.n_elem; ++i)
+  {
+    BOOST_REQUIRE_SMALL(denseGradient[i] - gradient[i], 1e-8);
+    BOOST_REQUIRE_SMALL(entriesGradient[i] - gradient[i], 1e-8);
+    BOOST_REQUIRE_SMALL(sparseGradient[i] - gradient[i], 1e-8);
+  }
+}
+
 /**
  * keller4.co test case for Lovasz-Theta LRSDP.
  * This is commented out because it takes a long time to run.
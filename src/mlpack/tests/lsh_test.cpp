@@ -9,6 +9,8 @@
 #include "old_boost_test_definitions.hpp"
 
 #include <mlpack/methods/lsh/lsh_search.hpp>
+#include <mlpack/methods/lsh/simhash_search.hpp>
+#include <mlpack/methods/lsh/dynamic_lsh_search.hpp>
 
 using namespace std;
 using namespace mlpack;
@@ -108,4 +110,274 @@ BOOST_AUTO_TEST_CASE(LSHSearchTest)
   }
 }
 
+/**
+ * Make sure that searching with several threads (and thus several query blocks
+ * at once) gives the same results as a serial search with the same hash.
+ */
+BOOST_AUTO_TEST_CASE(ParallelLSHSearchTest)
+{
+  arma::mat rdata(5, 3000);
+  rdata.randu();
+
+  LSHSearch<> lsh(rdata, 5, 10);
+
+  arma::Mat<size_t> serialNeighbors, parallelNeighbors;
+  arma::mat serialDistances, parallelDistances;
+
+  lsh.Search(3, serialNeighbors, serialDistances);
+
+  lsh.NumThreads() = 4;
+  lsh.Search(3, parallelNeighbors, parallelDistances);
+
+  BOOST_REQUIRE_EQUAL(serialNeighbors.n_rows, parallelNeighbors.n_rows);
+  BOOST_REQUIRE_EQUAL(serialNeighbors.n_cols, parallelNeighbors.n_cols);
+  for (size_t i = 0; i < serialNeighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(serialNeighbors[i], parallelNeighbors[i]);
+    if (serialDistances[i] == DBL_MAX)
+      BOOST_REQUIRE_EQUAL(parallelDistances[i], DBL_MAX);
+    else
+      BOOST_REQUIRE_CLOSE(serialDistances[i], parallelDistances[i], 1e-5);
+  }
+}
+
+/**
+ * Multiprobe LSH searches a superset of the buckets searched by standard LSH,
+ * so every neighbor distance it returns must be at least as good.
+ */
+BOOST_AUTO_TEST_CASE(MultiprobeLSHSearchTest)
+{
+  arma::mat rdata(4, 1000);
+  rdata.randu();
+
+  LSHSearch<> lsh(rdata, 6, 3);
+
+  arma::Mat<size_t> neighbors, probeNeighbors;
+  arma::mat distances, probeDistances;
+
+  lsh.Search(5, neighbors, distances);
+  lsh.Search(5, probeNeighbors, probeDistances, 0, 8);
+
+  for (size_t i = 0; i < distances.n_elem; ++i)
+    BOOST_REQUIRE_LE(probeDistances[i], distances[i]);
+}
+
+/**
+ * Save a hash to a file, load it again (memory-mapped), and make sure that the
+ * loaded hash gives exactly the same results as the original one.
+ */
+BOOST_AUTO_TEST_CASE(LSHSaveLoadTest)
+{
+  arma::mat rdata(5, 2000);
+  rdata.randu();
+  arma::mat qdata(5, 200);
+  qdata.randu();
+
+  LSHSearch<> lsh(rdata, qdata, 5, 10);
+  lsh.Save("lsh_index_test.bin");
+
+  arma::Mat<size_t> neighbors, loadedNeighbors;
+  arma::mat distances, loadedDistances;
+  lsh.Search(4, neighbors, distances, 0, 2);
+
+  {
+    LSHSearch<> loaded(rdata, qdata, "lsh_index_test.bin");
+    loaded.Search(4, loadedNeighbors, loadedDistances, 0, 2);
+  }
+
+  remove("lsh_index_test.bin");
+
+  BOOST_REQUIRE_EQUAL(neighbors.n_rows, loadedNeighbors.n_rows);
+  BOOST_REQUIRE_EQUAL(neighbors.n_cols, loadedNeighbors.n_cols);
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i], loadedNeighbors[i]);
+    if (distances[i] == DBL_MAX)
+      BOOST_REQUIRE_EQUAL(loadedDistances[i], DBL_MAX);
+    else
+      BOOST_REQUIRE_CLOSE(distances[i], loadedDistances[i], 1e-5);
+  }
+}
+
+/**
+ * Make sure that the Hamming distance counts the differing bits of every word.
+ */
+BOOST_AUTO_TEST_CASE(SimHashHammingDistanceTest)
+{
+  uint64_t a[2] = { 0, 0xFF };
+  uint64_t b[2] = { 0, 0x0F };
+  BOOST_REQUIRE_EQUAL(SimHashSearch::HammingDistance(a, b, 2), 4);
+
+  a[0] = ~uint64_t(0);
+  BOOST_REQUIRE_EQUAL(SimHashSearch::HammingDistance(a, b, 2), 68);
+  BOOST_REQUIRE_EQUAL(SimHashSearch::HammingDistance(a, a, 2), 0);
+}
+
+/**
+ * The codes depend only on the direction of the points, and each reference
+ * point finds a point with the same code (at least itself).
+ */
+BOOST_AUTO_TEST_CASE(SimHashCodeTest)
+{
+  math::RandomSeed(0);
+
+  arma::mat rdata = arma::randn<arma::mat>(10, 200);
+  SimHashSearch simhash(rdata, 3, 20);
+
+  BOOST_REQUIRE_EQUAL(simhash.Size(), 200);
+  BOOST_REQUIRE_EQUAL(simhash.Codes().size(), 600);
+  BOOST_REQUIRE_EQUAL(simhash.Projections().n_rows, 60);
+
+  std::vector<uint64_t> scaledCodes;
+  simhash.Hash(3.5 * rdata, scaledCodes);
+  for (size_t i = 0; i < scaledCodes.size(); ++i)
+  {
+    BOOST_REQUIRE_EQUAL(scaledCodes[i], simhash.Codes()[i]);
+    BOOST_REQUIRE_LT(scaledCodes[i], uint64_t(1) << 20);
+  }
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  simhash.Search(rdata, 1, neighbors, distances);
+  for (size_t i = 0; i < rdata.n_cols; ++i)
+  {
+    BOOST_REQUIRE_LT(neighbors(0, i), rdata.n_cols);
+    BOOST_REQUIRE_SMALL(distances(0, i), 1e-10);
+  }
+}
+
+/**
+ * Points around 20 random directions should find neighbors around the same
+ * direction, and probing more keys should never give worse neighbors.
+ */
+BOOST_AUTO_TEST_CASE(SimHashClusterTest)
+{
+  math::RandomSeed(0);
+
+  const arma::mat directions = arma::randn<arma::mat>(10, 20);
+  arma::mat rdata(10, 1000);
+  arma::mat qdata(10, 100);
+  for (size_t i = 0; i < rdata.n_cols; ++i)
+    rdata.col(i) = directions.col(i % 20) + 0.05 * arma::randn<arma::vec>(10);
+  for (size_t i = 0; i < qdata.n_cols; ++i)
+    qdata.col(i) = directions.col(i % 20) + 0.05 * arma::randn<arma::vec>(10);
+
+  SimHashSearch simhash(rdata, 4, 16);
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  simhash.Search(qdata, 5, neighbors, distances);
+
+  arma::Mat<size_t> probedNeighbors;
+  arma::mat probedDistances;
+  simhash.Search(qdata, 5, probedNeighbors, probedDistances, 1);
+
+  size_t correct = 0;
+  for (size_t q = 0; q < qdata.n_cols; ++q)
+  {
+    if (neighbors(0, q) < rdata.n_cols && neighbors(0, q) % 20 == q % 20)
+      ++correct;
+
+    for (size_t j = 0; j < 5; ++j)
+    {
+      BOOST_REQUIRE_LE(probedDistances(j, q), distances(j, q));
+      if (j > 0)
+        BOOST_REQUIRE_GE(probedDistances(j, q), probedDistances(j - 1, q));
+    }
+  }
+
+  BOOST_REQUIRE_GE(correct, 95);
+}
+
+/**
+ * With a huge hash width, every point lands in the same bucket of each table,
+ * so the search is exhaustive; adding the points in several batches (which
+ * fill the buckets past many blocks) should give the naive results.
+ */
+BOOST_AUTO_TEST_CASE(DynamicLSHAddTest)
+{
+  math::RandomSeed(0);
+
+  arma::mat rdata;
+  if (!data::Load("test_data_3_1000.csv", rdata))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+  arma::mat qdata = rdata.cols(0, 49) + 0.01;
+
+  DynamicLSHSearch<> lsh(rdata.cols(0, 99), 5, 3, 1e8);
+  lsh.Add(rdata.cols(100, 549));
+  lsh.Add(arma::mat(3, 0));
+  lsh.Add(rdata.cols(550, 999));
+  BOOST_REQUIRE_EQUAL(lsh.Size(), 1000);
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  lsh.Search(qdata, 5, neighbors, distances);
+
+  for (size_t q = 0; q < qdata.n_cols; ++q)
+  {
+    arma::vec naive(rdata.n_cols);
+    for (size_t i = 0; i < rdata.n_cols; ++i)
+      naive[i] = metric::SquaredEuclideanDistance::Evaluate(qdata.col(q),
+          rdata.col(i));
+    const arma::uvec order = arma::sort_index(naive);
+
+    for (size_t j = 0; j < 5; ++j)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors(j, q), order[j]);
+      BOOST_REQUIRE_CLOSE(distances(j, q), naive[order[j]], 1e-5);
+    }
+  }
+}
+
+/**
+ * Removed points should never be returned, and the results should not depend
+ * on the number of threads used to add the points.
+ */
+BOOST_AUTO_TEST_CASE(DynamicLSHRemoveTest)
+{
+  arma::mat rdata;
+  if (!data::Load("test_data_3_1000.csv", rdata))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  math::RandomSeed(0);
+  DynamicLSHSearch<> lsh(3, 4, 5, 1.0, 1009);
+  lsh.Add(rdata);
+
+  math::RandomSeed(0);
+  DynamicLSHSearch<> parallelLSH(3, 4, 5, 1.0, 1009);
+  parallelLSH.NumThreads() = 0;
+  parallelLSH.Add(rdata);
+
+  arma::Mat<size_t> neighbors, parallelNeighbors;
+  arma::mat distances, parallelDistances;
+  lsh.Search(rdata, 3, neighbors, distances);
+  parallelLSH.Search(rdata, 3, parallelNeighbors, parallelDistances);
+  BOOST_REQUIRE_EQUAL(arma::accu(neighbors != parallelNeighbors), 0);
+
+  size_t total = 0;
+  for (size_t b = 0; b < lsh.SecondHashSize(); ++b)
+    total += lsh.BucketSize(b);
+  BOOST_REQUIRE_EQUAL(total, 5 * rdata.n_cols);
+
+  // Each point finds itself first; once removed, it is never found.
+  for (size_t i = 0; i < rdata.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(neighbors(0, i), i);
+
+  for (size_t i = 0; i < rdata.n_cols; i += 2)
+    lsh.Remove(i);
+  lsh.Remove(0);
+  BOOST_REQUIRE_EQUAL(lsh.NumRemoved(), 500);
+  BOOST_REQUIRE(lsh.Removed(0));
+  BOOST_REQUIRE(!lsh.Removed(1));
+
+  lsh.Search(rdata, 3, neighbors, distances);
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    if (neighbors[i] == lsh.Size())
+      continue; // Not found.
+
+    BOOST_REQUIRE_EQUAL(neighbors[i] % 2, 1);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
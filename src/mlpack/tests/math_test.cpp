@@ -4,7 +4,9 @@
  *
  * Tests for everything in the math:: namespace.
  */
+#include <mlpack/core/math/alias_table.hpp>
 #include <mlpack/core/math/clamp.hpp>
+#include <mlpack/core/math/fast_exp.hpp>
 #include <mlpack/core/math/random.hpp>
 #include <mlpack/core/math/range.hpp>
 #include <boost/test/unit_test.hpp>
@@ -578,4 +580,191 @@ BOOST_AUTO_TEST_CASE(RangeContainsRange)
   BOOST_REQUIRE_EQUAL(b.Contains(a), true);
 }
 
+/**
+ * Random number streams only depend on the key and their index, so creating
+ * them in a different order (as threads would) gives the same numbers, and the
+ * key is reproducible from the global seed.
+ */
+BOOST_AUTO_TEST_CASE(RandomStreamReproducibility)
+{
+  RandomSeed(42);
+  const uint64_t key = NewStreamKey();
+  RandomSeed(42);
+  BOOST_REQUIRE(NewStreamKey() == key);
+
+  std::vector<double> forward(8), backward(8);
+  for (size_t i = 0; i < 8; ++i)
+  {
+    RandomStream stream(key, i);
+    forward[i] = stream.Random();
+  }
+  for (size_t i = 8; i > 0; --i)
+  {
+    RandomStream stream(key, i - 1);
+    backward[i - 1] = stream.Random();
+  }
+
+  for (size_t i = 0; i < 8; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(forward[i], backward[i]);
+    BOOST_REQUIRE_GE(forward[i], 0.0);
+    BOOST_REQUIRE_LT(forward[i], 1.0);
+    for (size_t j = 0; j < i; ++j)
+    {
+      BOOST_REQUIRE_NE(forward[i], forward[j]);
+      BOOST_REQUIRE_NE(StreamSeed(key, i), StreamSeed(key, j));
+    }
+  }
+
+  // The same stream of another family is different.
+  BOOST_REQUIRE_NE(StreamSeed(key, 0), StreamSeed(key + 1, 0));
+
+  RandomStream stream(key, 3);
+  for (size_t i = 0; i < 100; ++i)
+  {
+    const int value = stream.RandInt(5, 10);
+    BOOST_REQUIRE_GE(value, 5);
+    BOOST_REQUIRE_LT(value, 10);
+  }
+}
+
+/**
+ * An alias table draws each outcome with its probability, never draws
+ * outcomes with zero weight, and gives the same samples for the same stream.
+ */
+BOOST_AUTO_TEST_CASE(AliasTableTest)
+{
+  const arma::vec weights("0.0 1.0 0.0 3.0 6.0");
+  AliasTable table(weights);
+  BOOST_REQUIRE_EQUAL(table.Outcomes(), 3);
+
+  const uint64_t key = NewStreamKey();
+  RandomStream stream(key, 0);
+  arma::vec counts(5);
+  counts.zeros();
+  for (size_t i = 0; i < 100000; ++i)
+    ++counts[table.Sample(stream)];
+
+  BOOST_REQUIRE_EQUAL(counts[0], 0.0);
+  BOOST_REQUIRE_EQUAL(counts[2], 0.0);
+  BOOST_REQUIRE_CLOSE(counts[1] / 100000.0, 0.1, 5.0);
+  BOOST_REQUIRE_CLOSE(counts[3] / 100000.0, 0.3, 2.0);
+  BOOST_REQUIRE_CLOSE(counts[4] / 100000.0, 0.6, 2.0);
+
+  RandomStream first(key, 1), second(key, 1);
+  for (size_t i = 0; i < 100; ++i)
+    BOOST_REQUIRE_EQUAL(table.Sample(first), table.Sample(second));
+}
+
+/**
+ * The quantile bins of a dimension hold about the same number of points, a
+ * dimension with few values gets a bin for each value, and the bins of the
+ * values agree with the edges.
+ */
+BOOST_AUTO_TEST_CASE(QuantileBinsTest)
+{
+  arma::mat data(2, 1000);
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    data(0, i) = (double) i;
+    data(1, i) = (double) (i % 3);
+  }
+
+  // All of the points are sampled.
+  QuantileBins quantizer(data, 10);
+  BOOST_REQUIRE_EQUAL(quantizer.Dimensionality(), 2);
+  BOOST_REQUIRE_EQUAL(quantizer.NumBins(0), 10);
+  BOOST_REQUIRE_EQUAL(quantizer.NumBins(1), 3);
+  BOOST_REQUIRE_EQUAL(quantizer.MaxNumBins(), 10);
+  for (size_t b = 0; b < 9; ++b)
+    BOOST_REQUIRE_EQUAL(quantizer.Edges(0)[b], 100.0 * b + 99.0);
+
+  BOOST_REQUIRE_EQUAL(quantizer.Bin(0, -1.0), 0);
+  BOOST_REQUIRE_EQUAL(quantizer.Bin(0, 99.0), 0);
+  BOOST_REQUIRE_EQUAL(quantizer.Bin(0, 99.5), 1);
+  BOOST_REQUIRE_EQUAL(quantizer.Bin(0, 2000.0), 9);
+  BOOST_REQUIRE_EQUAL(quantizer.Bin(1, 1.0), 1);
+
+  arma::Mat<unsigned char> bins;
+  quantizer.Quantize(data, bins);
+  BOOST_REQUIRE_EQUAL(bins.n_rows, 2);
+  BOOST_REQUIRE_EQUAL(bins.n_cols, 1000);
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(bins(0, i), i / 100);
+    BOOST_REQUIRE_EQUAL(bins(1, i), i % 3);
+  }
+
+  // With a sample of a tenth of the points, the bins are still about even.
+  QuantileBins sampled(data, 10, 100);
+  BOOST_REQUIRE_EQUAL(sampled.NumBins(0), 10);
+  sampled.Quantize(data, bins);
+  arma::Col<size_t> counts(10);
+  counts.zeros();
+  for (size_t i = 0; i < data.n_cols; ++i)
+    ++counts[bins(0, i)];
+  for (size_t b = 0; b < 10; ++b)
+  {
+    BOOST_REQUIRE_GE(counts[b], 90);
+    BOOST_REQUIRE_LE(counts[b], 110);
+  }
+}
+
+/**
+ * The fast exponential should be as accurate as documented for each degree,
+ * exact at 0, and handle the values outside of its range like std::exp()
+ * (apart from the subnormal results, which are 0).
+ */
+BOOST_AUTO_TEST_CASE(FastExpTest)
+{
+  arma::vec x = 1400.0 * arma::randu<arma::vec>(10000) - 700.0;
+  x.subvec(0, 999) = 10.0 * arma::randu<arma::vec>(1000) - 5.0;
+
+  for (size_t i = 0; i < x.n_elem; ++i)
+  {
+    const double exact = std::exp(x[i]);
+    BOOST_REQUIRE_CLOSE(FastExp<4>::Evaluate(x[i]), exact, 1e-2);
+    BOOST_REQUIRE_CLOSE(FastExp<>::Evaluate(x[i]), exact, 2e-6);
+    BOOST_REQUIRE_CLOSE(FastExp<12>::Evaluate(x[i]), exact, 1e-12);
+  }
+
+  BOOST_REQUIRE_EQUAL(FastExp<>::Evaluate(0.0), 1.0);
+  BOOST_REQUIRE_EQUAL(FastExp<>::Evaluate(-800.0), 0.0);
+  BOOST_REQUIRE_EQUAL(FastExp<>::Evaluate(-DBL_MAX), 0.0);
+  BOOST_REQUIRE_EQUAL(FastExp<>::Evaluate(-std::numeric_limits<double>::
+      infinity()), 0.0);
+  BOOST_REQUIRE_EQUAL(FastExp<>::Evaluate(800.0), std::exp(800.0));
+  BOOST_REQUIRE(FastExp<>::Evaluate(std::numeric_limits<double>::quiet_NaN())
+      != FastExp<>::Evaluate(std::numeric_limits<double>::quiet_NaN()));
+}
+
+/**
+ * FastExp::Apply() should give the same values as FastExp::Evaluate(), both
+ * when all the values are in range and when some are not, and ExactExp should
+ * give the values of std::exp().
+ */
+BOOST_AUTO_TEST_CASE(FastExpApplyTest)
+{
+  arma::mat x = 100.0 * arma::randu<arma::mat>(20, 30) - 50.0;
+  x[3] = -1000.0;
+
+  arma::mat values(x);
+  FastExp<>::Apply(values);
+  for (size_t i = 0; i < x.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(values[i], FastExp<>::Evaluate(x[i]), 1e-12);
+
+  x[7] = 1000.0;
+  values = x;
+  FastExp<>::Apply(values);
+  BOOST_REQUIRE_EQUAL(values[7], std::exp(1000.0));
+  for (size_t i = 0; i < x.n_elem; ++i)
+    if (i != 7)
+      BOOST_REQUIRE_CLOSE(values[i], FastExp<>::Evaluate(x[i]), 1e-12);
+
+  values = x;
+  ExactExp::Apply(values);
+  for (size_t i = 0; i < x.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(values[i], std::exp(x[i]));
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -59,6 +59,72 @@ BOOST_AUTO_TEST_CASE(L2MetricTest)
                       lMetric.Evaluate(a2, b2), 1e-5);
 }
 
+/**
+ * Make sure the vectorized squared Euclidean distance kernels give the same
+ * results as the Armadillo expressions, for dense columns, rows, and column
+ * views of doubles and floats, for every remainder of the vector length.
+ */
+BOOST_AUTO_TEST_CASE(SquaredEuclideanKernelTest)
+{
+  for (size_t dim = 1; dim < 70; ++dim)
+  {
+    arma::mat a(dim, 3);
+    a.randn();
+    arma::mat b(dim, 3);
+    b.randn();
+
+    const double expected = arma::accu(arma::square(a.col(1) - b.col(2)));
+
+    BOOST_REQUIRE_CLOSE(SquaredEuclideanDistance::Evaluate(a.col(1), b.col(2)),
+        expected, 1e-10);
+    BOOST_REQUIRE_CLOSE(SquaredEuclideanDistance::Evaluate(
+        a.unsafe_col(1), b.unsafe_col(2)), expected, 1e-10);
+
+    const arma::vec av = a.col(1);
+    const arma::rowvec ar = arma::trans(a.col(1));
+    const arma::rowvec br = arma::trans(b.col(2));
+    BOOST_REQUIRE_CLOSE(SquaredEuclideanDistance::Evaluate(av, b.col(2)),
+        expected, 1e-10);
+    BOOST_REQUIRE_CLOSE(SquaredEuclideanDistance::Evaluate(ar, br), expected,
+        1e-10);
+    BOOST_REQUIRE_CLOSE(EuclideanDistance::Evaluate(a.col(1), b.col(2)),
+        sqrt(expected), 1e-10);
+
+    const arma::fmat af = arma::conv_to<arma::fmat>::from(a);
+    const arma::fmat bf = arma::conv_to<arma::fmat>::from(b);
+    BOOST_REQUIRE_CLOSE(SquaredEuclideanDistance::Evaluate(af.col(1),
+        bf.col(2)), expected, 1e-3);
+  }
+}
+
+/**
+ * Make sure the block kernel gives the same distances as computing each one
+ * separately.
+ */
+BOOST_AUTO_TEST_CASE(SquaredDistanceBlockTest)
+{
+  arma::mat a(7, 30);
+  a.randu();
+  arma::mat b(7, 45);
+  b.randu();
+
+  arma::mat distances;
+  SquaredDistanceBlock(a, b, distances);
+
+  BOOST_REQUIRE_EQUAL(distances.n_rows, a.n_cols);
+  BOOST_REQUIRE_EQUAL(distances.n_cols, b.n_cols);
+  for (size_t i = 0; i < a.n_cols; ++i)
+    for (size_t j = 0; j < b.n_cols; ++j)
+      BOOST_REQUIRE_CLOSE(distances(i, j),
+          SquaredEuclideanDistance::Evaluate(a.col(i), b.col(j)), 1e-5);
+
+  // The distance between a point and itself must not be negative.
+  SquaredDistanceBlock(a, a, distances);
+  for (size_t i = 0; i < a.n_cols; ++i)
+    BOOST_REQUIRE_SMALL(distances(i, i), 1e-10);
+  BOOST_REQUIRE_GE(distances.min(), 0.0);
+}
+
 BOOST_AUTO_TEST_CASE(LINFMetricTest)
 {
   arma::vec a1(5);
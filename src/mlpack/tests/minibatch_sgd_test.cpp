@@ -0,0 +1,78 @@
+/**
+ * @file minibatch_sgd_test.cpp
+ *
+ * Test file for mini-batch SGD (stochastic gradient descent).
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/core/optimizers/minibatch_sgd/minibatch_sgd.hpp>
+#include <mlpack/core/optimizers/sgd/test_function.hpp>
+#include <mlpack/methods/logistic_regression/logistic_regression.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include "old_boost_test_definitions.hpp"
+
+using namespace std;
+using namespace arma;
+using namespace mlpack;
+using namespace mlpack::optimization;
+using namespace mlpack::optimization::test;
+using namespace mlpack::regression;
+
+BOOST_AUTO_TEST_SUITE(MiniBatchSGDTest);
+
+/**
+ * Optimize the SGD test function, which has no batch Gradient(), so the
+ * individual gradients are used.
+ */
+BOOST_AUTO_TEST_CASE(SimpleMiniBatchSGDTestFunction)
+{
+  SGDTestFunction f;
+  MiniBatchSGD<SGDTestFunction> s(f, 0.0003, 1, 5000000, 1e-9, true);
+
+  arma::mat coordinates = f.GetInitialPoint();
+  double result = s.Optimize(coordinates);
+
+  BOOST_REQUIRE_CLOSE(result, -1.0, 0.05);
+  BOOST_REQUIRE_SMALL(coordinates[0], 1e-3);
+  BOOST_REQUIRE_SMALL(coordinates[1], 1e-7);
+  BOOST_REQUIRE_SMALL(coordinates[2], 1e-7);
+}
+
+/**
+ * Make sure the batch Evaluate() and Gradient() of LogisticRegressionFunction
+ * are the sums of the individual ones.
+ */
+BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionBatchTest)
+{
+  const arma::mat data = arma::randu<arma::mat>(5, 40);
+  arma::vec responses(40);
+  for (size_t i = 0; i < 40; ++i)
+    responses[i] = (data(0, i) > 0.5) ? 1 : 0;
+
+  LogisticRegressionFunction lrf(data, responses, 0.3);
+  const arma::mat parameters = arma::randu<arma::mat>(6, 1);
+
+  const size_t begin = 7;
+  const size_t batchSize = 20;
+
+  double objective = 0.0;
+  arma::mat gradient = arma::zeros<arma::mat>(6, 1);
+  arma::mat pointGradient;
+  for (size_t i = begin; i < begin + batchSize; ++i)
+  {
+    objective += lrf.Evaluate(parameters, i);
+    lrf.Gradient(parameters, i, pointGradient);
+    gradient += pointGradient;
+  }
+
+  BOOST_REQUIRE_CLOSE(lrf.Evaluate(parameters, begin, batchSize), objective,
+      1e-5);
+
+  arma::mat batchGradient;
+  lrf.Gradient(parameters, begin, batchSize, batchGradient);
+  BOOST_REQUIRE_EQUAL(batchGradient.n_elem, 6);
+  for (size_t i = 0; i < 6; ++i)
+    BOOST_REQUIRE_CLOSE(batchGradient[i], gradient[i], 1e-5);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,44 @@
+/**
+ * @file mvu_test.cpp
+ *
+ * Tests for Maximum Variance Unfolding (methods/mvu/).
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/methods/mvu/mvu.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include "old_boost_test_definitions.hpp"
+
+using namespace mlpack;
+using namespace mlpack::mvu;
+
+BOOST_AUTO_TEST_SUITE(MVUTest);
+
+/**
+ * Points on a line in three dimensions are already unfolded: the embedding in
+ * one dimension must be centered and keep the distances between neighbors.
+ */
+BOOST_AUTO_TEST_CASE(MVULineTest)
+{
+  arma::vec direction("1.0 2.0 3.0");
+  direction /= arma::norm(direction, 2);
+
+  arma::mat dataset(3, 30);
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    dataset.col(i) = double(i) * direction + 1.0;
+
+  MVU mvu(dataset);
+  arma::mat output;
+  mvu.Unfold(1, 2, output);
+
+  BOOST_REQUIRE_EQUAL(output.n_rows, 1);
+  BOOST_REQUIRE_EQUAL(output.n_cols, dataset.n_cols);
+
+  BOOST_REQUIRE_SMALL(arma::accu(output) / output.n_cols, 1e-2);
+
+  // Consecutive points are neighbors, at distance 1.
+  for (size_t i = 0; i + 1 < output.n_cols; ++i)
+    BOOST_REQUIRE_CLOSE(std::abs(output[i + 1] - output[i]), 1.0, 1.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -122,4 +122,67 @@ BOOST_AUTO_TEST_CASE(NaiveBayesClassifierIncrementalTest)
     BOOST_REQUIRE_EQUAL(testRes(i), calcVec(i));
 }
 
+/**
+ * Train the classifier on the training set in several batches, and make sure
+ * the model and the predictions are the same as when it is trained on the whole
+ * training set at once.
+ */
+BOOST_AUTO_TEST_CASE(NaiveBayesClassifierBatchTrainTest)
+{
+  const char* trainFilename = "trainSet.csv";
+  const char* testFilename = "testSet.csv";
+  size_t classes = 2;
+
+  arma::mat trainData;
+  data::Load(trainFilename, trainData, true);
+
+  arma::Col<size_t> labels(trainData.n_cols);
+  for (size_t i = 0; i < trainData.n_cols; ++i)
+    labels[i] = trainData(trainData.n_rows - 1, i);
+  trainData.shed_row(trainData.n_rows - 1);
+
+  NaiveBayesClassifier<> nbc(trainData, labels, classes);
+
+  // Train on three batches of different sizes.
+  NaiveBayesClassifier<> batchNbc(trainData.n_rows, classes);
+  const size_t first = trainData.n_cols / 5;
+  const size_t second = trainData.n_cols / 2;
+  for (size_t b = 0; b < 3; ++b)
+  {
+    const size_t begin = (b == 0) ? 0 : (b == 1) ? first : second;
+    const size_t end = (b == 0) ? first : (b == 1) ? second : trainData.n_cols;
+
+    const arma::mat batch = trainData.cols(begin, end - 1);
+    const arma::Col<size_t> batchLabels = labels.subvec(begin, end - 1);
+    batchNbc.Train(batch, batchLabels);
+  }
+
+  BOOST_REQUIRE_EQUAL(batchNbc.TrainingPoints(), trainData.n_cols);
+  for (size_t i = 0; i < nbc.Means().n_elem; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(batchNbc.Means()[i], nbc.Means()[i], 1e-8);
+    BOOST_REQUIRE_CLOSE(batchNbc.Variances()[i], nbc.Variances()[i], 1e-8);
+  }
+  for (size_t i = 0; i < classes; ++i)
+    BOOST_REQUIRE_CLOSE(batchNbc.Probabilities()[i], nbc.Probabilities()[i],
+        1e-8);
+
+  arma::mat testData;
+  data::Load(testFilename, testData, true);
+  testData.shed_row(testData.n_rows - 1); // Remove the labels.
+
+  arma::Col<size_t> results, batchResults;
+  nbc.Classify(testData, results);
+  batchNbc.Classify(testData, batchResults);
+
+  for (size_t i = 0; i < testData.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(results[i], batchResults[i]);
+
+  // Training again without the incremental option forgets the old points.
+  batchNbc.Train(trainData, labels, false);
+  BOOST_REQUIRE_EQUAL(batchNbc.TrainingPoints(), trainData.n_cols);
+  for (size_t i = 0; i < nbc.Means().n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(batchNbc.Means()[i], nbc.Means()[i], 1e-8);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
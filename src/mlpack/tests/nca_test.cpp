@@ -9,6 +9,7 @@
 #include <mlpack/core/metrics/lmetric.hpp>
 #include <mlpack/methods/nca/nca.hpp>
 #include <mlpack/core/optimizers/lbfgs/lbfgs.hpp>
+#include <mlpack/core/optimizers/minibatch_sgd/minibatch_sgd.hpp>
 
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
@@ -244,6 +245,60 @@ BOOST_AUTO_TEST_CASE(SoftmaxSeparableGradient)
   BOOST_REQUIRE_CLOSE(gradient(1, 1), -2.0 * -0.1435886, 0.01);
 }
 
+/**
+ * The batch objective and gradient must be the sums of the separable ones, and
+ * the whole dataset as a batch must give the non-separable ones, even when the
+ * separable functions are called with other coordinates in between.
+ */
+BOOST_AUTO_TEST_CASE(SoftmaxBatchSum)
+{
+  arma::mat data;
+  data.randu(3, 100);
+  arma::Col<size_t> labels(100);
+  for (size_t i = 0; i < 100; ++i)
+    labels[i] = i % 3;
+
+  SoftmaxErrorFunction<SquaredEuclideanDistance> sef(data, labels);
+
+  arma::mat coordinates = 2 * arma::eye<arma::mat>(3, 3);
+  coordinates(0, 1) = 0.5;
+
+  // The sum over a batch in the middle of the dataset.
+  double separableObjective = 0;
+  arma::mat separableGradient, pointGradient;
+  separableGradient.zeros(3, 3);
+  for (size_t i = 10; i < 40; ++i)
+  {
+    separableObjective += sef.Evaluate(coordinates, i);
+    sef.Gradient(coordinates, i, pointGradient);
+    separableGradient += pointGradient;
+  }
+
+  arma::mat batchGradient;
+  BOOST_REQUIRE_CLOSE(sef.Evaluate(coordinates, 10, 30), separableObjective,
+      1e-5);
+  sef.Gradient(coordinates, 10, 30, batchGradient);
+  for (size_t i = 0; i < batchGradient.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(batchGradient[i], separableGradient[i], 1e-5);
+
+  // The whole dataset.  The non-separable gradient is computed first, and the
+  // separable functions are then called with the identity, so the second
+  // non-separable gradient must not use the identity's stretched dataset.
+  arma::mat gradient;
+  const double objective = sef.EvaluateWithGradient(coordinates, gradient);
+  sef.Evaluate(arma::eye<arma::mat>(3, 3), 0);
+  arma::mat secondGradient;
+  sef.Gradient(coordinates, secondGradient);
+
+  BOOST_REQUIRE_CLOSE(sef.Evaluate(coordinates, 0, 100), objective, 1e-5);
+  sef.Gradient(coordinates, 0, 100, batchGradient);
+  for (size_t i = 0; i < gradient.n_elem; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(secondGradient[i], gradient[i], 1e-5);
+    BOOST_REQUIRE_CLOSE(batchGradient[i], gradient[i], 1e-5);
+  }
+}
+
 //
 // Tests for the NCA algorithm.
 //
@@ -286,6 +341,36 @@ BOOST_AUTO_TEST_CASE(NCASGDSimpleDataset)
   BOOST_REQUIRE_LT(arma::norm(finalGradient, 2), 1e-4);
 }
 
+/**
+ * NCA with mini-batch SGD must also separate the points of our simple dataset.
+ */
+BOOST_AUTO_TEST_CASE(NCAMiniBatchSGDSimpleDataset)
+{
+  // Useful but simple dataset with six points and two classes.
+  arma::mat data           = "-0.1 -0.1 -0.1  0.1  0.1  0.1;"
+                             " 1.0  0.0 -1.0  1.0  0.0 -1.0 ";
+  arma::Col<size_t> labels = " 0    0    0    1    1    1   ";
+
+  NCA<SquaredEuclideanDistance, MiniBatchSGD> nca(data, labels);
+  nca.Optimizer().StepSize() = 1.2;
+  nca.Optimizer().BatchSize() = 2;
+  nca.Optimizer().MaxIterations() = 100000;
+  nca.Optimizer().Tolerance() = 0;
+
+  arma::mat outputMatrix;
+  nca.LearnDistance(outputMatrix);
+
+  // Evaluate the result with the non-separable objective function.
+  SoftmaxErrorFunction<SquaredEuclideanDistance> sef(data, labels);
+
+  double initObj = sef.Evaluate(arma::eye<arma::mat>(2, 2));
+  double finalObj = sef.Evaluate(outputMatrix);
+
+  // finalObj must be less than initObj, and close to optimal.
+  BOOST_REQUIRE_LT(finalObj, initObj);
+  BOOST_REQUIRE_CLOSE(finalObj, -6.0, 0.1);
+}
+
 BOOST_AUTO_TEST_CASE(NCALBFGSSimpleDataset)
 {
   // Useful but simple dataset with six points and two classes.
@@ -318,4 +403,127 @@ BOOST_AUTO_TEST_CASE(NCALBFGSSimpleDataset)
 
 }
 
+//
+// Tests for the TruncatedSoftmaxErrorFunction.
+//
+
+/**
+ * With every other point as a neighbor, the truncated softmax error function
+ * must be equal to the softmax error function.
+ */
+BOOST_AUTO_TEST_CASE(TruncatedSoftmaxAllNeighbors)
+{
+  arma::mat data;
+  data.randu(3, 20);
+  arma::Col<size_t> labels(20);
+  for (size_t i = 0; i < 20; ++i)
+    labels[i] = i % 3;
+
+  SoftmaxErrorFunction<SquaredEuclideanDistance> sef(data, labels);
+  TruncatedSoftmaxErrorFunction<SquaredEuclideanDistance> tsef(data, labels,
+      SquaredEuclideanDistance(), 19);
+
+  for (size_t trial = 0; trial < 3; ++trial)
+  {
+    arma::mat coordinates;
+    coordinates.randu(3, 3);
+
+    BOOST_REQUIRE_CLOSE(tsef.Evaluate(coordinates), sef.Evaluate(coordinates),
+        1e-5);
+
+    arma::mat gradient, truncatedGradient;
+    sef.Gradient(coordinates, gradient);
+    tsef.Gradient(coordinates, truncatedGradient);
+
+    BOOST_REQUIRE_EQUAL(truncatedGradient.n_rows, 3);
+    BOOST_REQUIRE_EQUAL(truncatedGradient.n_cols, 3);
+    for (size_t i = 0; i < gradient.n_elem; ++i)
+    {
+      if (std::abs(gradient[i]) < 1e-8)
+        BOOST_REQUIRE_SMALL(truncatedGradient[i], 1e-8);
+      else
+        BOOST_REQUIRE_CLOSE(truncatedGradient[i], gradient[i], 1e-5);
+    }
+
+    // The separable objectives must be equal too.
+    for (size_t i = 0; i < data.n_cols; ++i)
+      BOOST_REQUIRE_CLOSE(tsef.Evaluate(coordinates, i),
+          sef.Evaluate(coordinates, i), 1e-5);
+  }
+}
+
+/**
+ * The separable objectives and gradients of the truncated softmax error
+ * function must sum to the non-separable ones, and only the nearest neighbors
+ * may be used.
+ */
+BOOST_AUTO_TEST_CASE(TruncatedSoftmaxSeparableSum)
+{
+  arma::mat data;
+  data.randu(4, 200);
+  arma::Col<size_t> labels(200);
+  for (size_t i = 0; i < 200; ++i)
+    labels[i] = i % 2;
+
+  TruncatedSoftmaxErrorFunction<SquaredEuclideanDistance> tsef(data, labels,
+      SquaredEuclideanDistance(), 10);
+
+  const arma::mat coordinates = 2 * arma::eye<arma::mat>(4, 4);
+
+  arma::mat gradient;
+  const double objective = tsef.EvaluateWithGradient(coordinates, gradient);
+  BOOST_REQUIRE_EQUAL(tsef.NeighborIndices().n_rows, 10);
+  BOOST_REQUIRE_EQUAL(tsef.NeighborIndices().n_cols, 200);
+
+  double separableObjective = 0;
+  arma::mat separableGradient, pointGradient;
+  separableGradient.zeros(4, 4);
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    separableObjective += tsef.Evaluate(coordinates, i);
+    tsef.Gradient(coordinates, i, pointGradient);
+    separableGradient += pointGradient;
+  }
+
+  BOOST_REQUIRE_CLOSE(separableObjective, objective, 1e-5);
+  for (size_t i = 0; i < gradient.n_elem; ++i)
+  {
+    if (std::abs(gradient[i]) < 1e-8)
+      BOOST_REQUIRE_SMALL(separableGradient[i], 1e-8);
+    else
+      BOOST_REQUIRE_CLOSE(separableGradient[i], gradient[i], 1e-5);
+  }
+}
+
+/**
+ * NCA with the truncated objective must also separate the points of our simple
+ * dataset.
+ */
+BOOST_AUTO_TEST_CASE(NCALBFGSTruncatedSimpleDataset)
+{
+  // Useful but simple dataset with six points and two classes.
+  arma::mat data           = "-0.1 -0.1 -0.1  0.1  0.1  0.1;"
+                             " 1.0  0.0 -1.0  1.0  0.0 -1.0 ";
+  arma::Col<size_t> labels = " 0    0    0    1    1    1   ";
+
+  NCA<SquaredEuclideanDistance, L_BFGS, TruncatedSoftmaxErrorFunction>
+      nca(data, labels);
+  nca.ErrorFunction().Neighbors() = 3;
+  nca.ErrorFunction().RefreshInterval() = 5;
+  nca.Optimizer().NumBasis() = 5;
+
+  arma::mat outputMatrix;
+  nca.LearnDistance(outputMatrix);
+
+  // Evaluate the result with the exact objective function.
+  SoftmaxErrorFunction<SquaredEuclideanDistance> sef(data, labels);
+
+  double initObj = sef.Evaluate(arma::eye<arma::mat>(2, 2));
+  double finalObj = sef.Evaluate(outputMatrix);
+
+  // finalObj must be less than initObj, and close to optimal.
+  BOOST_REQUIRE_LT(finalObj, initObj);
+  BOOST_REQUIRE_CLOSE(finalObj, -6.0, 0.1);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
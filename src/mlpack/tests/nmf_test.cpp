@@ -10,6 +10,7 @@
 #include <mlpack/methods/amf/update_rules/nmf_mult_div.hpp>
 #include <mlpack/methods/amf/update_rules/nmf_als.hpp>
 #include <mlpack/methods/amf/update_rules/nmf_mult_dist.hpp>
+#include <mlpack/methods/amf/update_rules/sparse_als.hpp>
 
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
@@ -165,6 +166,38 @@ BOOST_AUTO_TEST_CASE(SparseNMFAcolDistTest)
       1e-5);
 }
 
+/**
+ * The divergence update gives the same factorization for a sparse input
+ * matrix, where WH is only evaluated at the nonzero entries, as for the same
+ * matrix stored densely.
+ */
+BOOST_AUTO_TEST_CASE(SparseNMFRandomDivTest)
+{
+  sp_mat v;
+  v.sprandu(30, 25, 0.3);
+  // Ensure there is at least one nonzero element in every row and column.
+  for (size_t i = 0; i < 25; ++i)
+    v(i, i) += 0.1;
+  mat dv(v);
+
+  mat w, h, dw, dh;
+  SimpleResidueTermination srt(1e-10, 200);
+  AMF<SimpleResidueTermination, RandomInitialization,
+      NMFMultiplicativeDivergenceUpdate> nmf(srt);
+
+  util::SetNumThreads(4);
+  mlpack::math::RandomSeed(42);
+  nmf.Apply(v, 8, w, h);
+  util::SetNumThreads(0);
+  mlpack::math::RandomSeed(42);
+  nmf.Apply(dv, 8, dw, dh);
+
+  const mat vp = w * h;
+  const mat dvp = dw * dh;
+  BOOST_REQUIRE_SMALL(arma::norm(vp - dvp, "fro") / arma::norm(dvp, "fro"),
+      1e-5);
+}
+
 /**
  * Check that the product of the calculated factorization is close to the
  * input matrix, with a sparse input matrix.  This uses the random
@@ -213,4 +246,63 @@ BOOST_AUTO_TEST_CASE(SparseNMFALSTest)
       1e-5);
 }
 
+/**
+ * Factorize the observed entries of a low-rank matrix with SparseALSUpdate, and
+ * make sure the factorization fits them.
+ */
+BOOST_AUTO_TEST_CASE(SparseALSUpdateTest)
+{
+  mlpack::math::RandomSeed(std::time(NULL));
+
+  const mat w0 = randu<mat>(30, 3) + 0.5;
+  const mat h0 = randu<mat>(3, 40) + 0.5;
+  const mat full = w0 * h0;
+
+  // Observe about half of the entries, and at least one in each row and
+  // column.
+  sp_mat v(30, 40);
+  for (size_t i = 0; i < full.n_rows; ++i)
+    for (size_t j = 0; j < full.n_cols; ++j)
+      if (mlpack::math::Random() < 0.5 || i == (j % full.n_rows))
+        v(i, j) = full(i, j);
+
+  SimpleToleranceTermination<sp_mat> stt(1e-10, 500);
+  AMF<SimpleToleranceTermination<sp_mat>, RandomInitialization,
+      SparseALSUpdate> als(stt, RandomInitialization(), SparseALSUpdate(1e-6));
+  mat w, h;
+  als.Apply(v, 3, w, h);
+
+  BOOST_REQUIRE_EQUAL(w.n_rows, 30);
+  BOOST_REQUIRE_EQUAL(w.n_cols, 3);
+  BOOST_REQUIRE_EQUAL(h.n_rows, 3);
+  BOOST_REQUIRE_EQUAL(h.n_cols, 40);
+
+  const mat wh = w * h;
+  double squaredError = 0.0;
+  for (sp_mat::const_iterator it = v.begin(); it != v.end(); ++it)
+    squaredError += std::pow((*it) - wh(it.row(), it.col()), 2.0);
+  BOOST_REQUIRE_SMALL(std::sqrt(squaredError / v.n_nonzero), 0.01);
+}
+
+/**
+ * Make sure the residue computed by SimpleResidueTermination without forming
+ * WH matches the one computed from the full product.
+ */
+BOOST_AUTO_TEST_CASE(SimpleResidueTerminationNormTest)
+{
+  mat w1 = randu<mat>(40, 4);
+  mat h1 = randu<mat>(4, 30);
+  mat w2 = randu<mat>(40, 4);
+  mat h2 = randu<mat>(4, 30);
+
+  SimpleResidueTermination srt;
+  srt.Initialize(mat(40, 30));
+  srt.IsConverged(w1, h1);
+  srt.IsConverged(w2, h2);
+
+  const double norm1 = norm(w1 * h1, "fro");
+  const double norm2 = norm(w2 * h2, "fro");
+  BOOST_REQUIRE_CLOSE(srt.Index(), fabs(norm1 - norm2) / norm1, 1e-5);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
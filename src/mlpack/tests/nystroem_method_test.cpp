@@ -179,4 +179,42 @@ BOOST_AUTO_TEST_CASE(GermanTest)
   }
 }
 
+/**
+ * The factored approximation should give the same output as Apply(), and,
+ * with every point of the dataset as a landmark, map new points so that their
+ * products with the mapped dataset are the exact kernel values.
+ */
+BOOST_AUTO_TEST_CASE(FactoredApproximationTest)
+{
+  arma::mat data;
+  data.randu(5, 20);
+  arma::mat newPoints;
+  newPoints.randu(5, 3);
+
+  GaussianKernel gk;
+  NystroemMethod<GaussianKernel, OrderedSelection> nm(data, gk, 20);
+
+  arma::mat g;
+  nm.Apply(g);
+
+  NystroemApproximation<GaussianKernel> approximation;
+  nm.Factor(approximation);
+  BOOST_REQUIRE_EQUAL(approximation.Landmarks().n_cols, 20);
+
+  arma::mat factoredG;
+  approximation.Apply(data, factoredG);
+  BOOST_REQUIRE_EQUAL(factoredG.n_rows, g.n_rows);
+  BOOST_REQUIRE_EQUAL(factoredG.n_cols, g.n_cols);
+  for (size_t i = 0; i < g.n_elem; ++i)
+    BOOST_REQUIRE_SMALL(factoredG[i] - g[i], 1e-8);
+
+  arma::mat newG;
+  approximation.Apply(newPoints, newG);
+  const arma::mat crossKernel = newG * g.t();
+  for (size_t i = 0; i < newPoints.n_cols; ++i)
+    for (size_t j = 0; j < data.n_cols; ++j)
+      BOOST_REQUIRE_SMALL(crossKernel(i, j) - gk.Evaluate(newPoints.col(i),
+          data.col(j)), 1e-3);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
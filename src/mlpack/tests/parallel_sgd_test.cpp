@@ -0,0 +1,105 @@
+/**
+ * @file parallel_sgd_test.cpp
+ *
+ * Test file for parallel SGD (stochastic gradient descent).
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/core/optimizers/parallel_sgd/parallel_sgd.hpp>
+#include <mlpack/core/optimizers/sgd/test_function.hpp>
+#include <mlpack/methods/regularized_svd/regularized_svd.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include "old_boost_test_definitions.hpp"
+
+using namespace std;
+using namespace arma;
+using namespace mlpack;
+using namespace mlpack::optimization;
+using namespace mlpack::optimization::test;
+using namespace mlpack::svd;
+
+BOOST_AUTO_TEST_SUITE(ParallelSGDTest);
+
+/**
+ * Optimize the SGD test function (which has a dense gradient) with the
+ * averaging scheme, and make sure two runs with the same seed give the same
+ * result.  With three workers, each epoch is a gradient descent step with a
+ * third of the step size, so the step size is three times that of the SGD
+ * test.
+ */
+BOOST_AUTO_TEST_CASE(AveragedParallelSGDTestFunction)
+{
+  SGDTestFunction f;
+
+  math::RandomSeed(42);
+  ParallelSGD<SGDTestFunction> s(f, 0.0009, 5000000, 1e-9, true, 3);
+  arma::mat coordinates = f.GetInitialPoint();
+  const double result = s.Optimize(coordinates);
+
+  BOOST_REQUIRE_CLOSE(result, -1.0, 0.05);
+  BOOST_REQUIRE_SMALL(coordinates[0], 1e-3);
+
+  math::RandomSeed(42);
+  ParallelSGD<SGDTestFunction> s2(f, 0.0009, 5000000, 1e-9, true, 3);
+  arma::mat coordinates2 = f.GetInitialPoint();
+  const double result2 = s2.Optimize(coordinates2);
+
+  BOOST_REQUIRE_EQUAL(result, result2);
+  for (size_t i = 0; i < coordinates.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(coordinates[i], coordinates2[i]);
+}
+
+/**
+ * Make sure the sparse gradient of RegularizedSVDFunction for one example is
+ * the full gradient of a dataset with only that example.
+ */
+BOOST_AUTO_TEST_CASE(RegularizedSVDFunctionSparseGradient)
+{
+  arma::mat data("3; 4; 2.5");
+  RegularizedSVDFunction f(data, 5, 0.3);
+  const arma::mat parameters = arma::randu<arma::mat>(5, 4 + 5);
+
+  arma::mat gradient;
+  f.Gradient(parameters, gradient);
+
+  arma::uvec indices;
+  arma::vec values;
+  f.Gradient(parameters, 0, indices, values);
+
+  arma::mat sparseGradient = arma::zeros<arma::mat>(5, 4 + 5);
+  for (size_t k = 0; k < indices.n_elem; ++k)
+    sparseGradient[indices[k]] += values[k];
+
+  for (size_t i = 0; i < gradient.n_elem; ++i)
+    BOOST_REQUIRE_SMALL(gradient[i] - sparseGradient[i], 1e-10);
+}
+
+/**
+ * Factorize a random rating dataset with Hogwild! and make sure the objective
+ * decreases.
+ */
+BOOST_AUTO_TEST_CASE(HogwildRegularizedSVD)
+{
+  const size_t numUsers = 50;
+  const size_t numItems = 50;
+  const size_t numRatings = 2000;
+
+  arma::mat data = arma::randu(3, numRatings);
+  data.row(0) = floor(data.row(0) * numUsers);
+  data.row(1) = floor(data.row(1) * numItems);
+  data.row(2) = floor(data.row(2) * 5 + 0.5);
+  data(0, numRatings - 1) = numUsers - 1;
+  data(1, numRatings - 1) = numItems - 1;
+
+  RegularizedSVDFunction f(data, 3, 0.01);
+  arma::mat parameters = f.GetInitialPoint();
+  const double initialObjective = f.Evaluate(parameters);
+
+  ParallelSGD<RegularizedSVDFunction> s(f, 0.01, 50 * numRatings, 1e-5);
+  const double result = s.Optimize(parameters);
+
+  BOOST_REQUIRE_CLOSE(result, f.Evaluate(parameters), 1e-5);
+  BOOST_REQUIRE_LT(result, 0.5 * initialObjective);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -6,6 +6,7 @@
  */
 #include <mlpack/core.hpp>
 #include <mlpack/methods/pca/pca.hpp>
+#include <mlpack/methods/pca/incremental_pca.hpp>
 
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
@@ -198,4 +199,97 @@ BOOST_AUTO_TEST_CASE(PCAScalingTest)
 }
 
 
+/**
+ * The randomized SVD policy should find the same largest principal components
+ * as the exact SVD, and the same amount of variance retained, on data that
+ * is nearly low-rank.
+ */
+BOOST_AUTO_TEST_CASE(RandomizedSVDPCATest)
+{
+  // 40-dimensional data that lies mostly in 3 dimensions.
+  mat data = randn<mat>(40, 3) * randn<mat>(3, 500) +
+      0.01 * randn<mat>(40, 500);
+  mat randomizedData = data;
+
+  PCA exact;
+  const double varRetained = exact.Apply(data, 3);
+
+  PCAType<RandomizedSVDPolicy> randomized;
+  const double randomizedVarRetained = randomized.Apply(randomizedData, 3);
+
+  BOOST_REQUIRE_EQUAL(randomizedData.n_rows, 3);
+  BOOST_REQUIRE_EQUAL(randomizedData.n_cols, 500);
+  BOOST_REQUIRE_CLOSE(randomizedVarRetained, varRetained, 1e-3);
+
+  // The projections may have opposite signs.
+  for (size_t i = 0; i < 3; ++i)
+  {
+    if (dot(data.row(i), randomizedData.row(i)) < 0)
+      randomizedData.row(i) *= -1;
+
+    for (size_t j = 0; j < data.n_cols; ++j)
+      BOOST_REQUIRE_SMALL(randomizedData(i, j) - data(i, j), 1e-3);
+  }
+}
+
+/**
+ * Incremental PCA, with all the components kept, should find the same
+ * eigenvalues as PCA, however the data is split into blocks; the scaled data
+ * should also give the same eigenvalues.
+ */
+BOOST_AUTO_TEST_CASE(IncrementalPCATest)
+{
+  mat data = randn<mat>(5, 1000);
+  data.row(1) += 2.0 * data.row(0);
+  data.row(3) *= 3.0;
+  data.each_col() += vec("1.0 -2.0 3.0 0.5 10.0");
+
+  for (size_t scale = 0; scale < 2; ++scale)
+  {
+    PCA exact(scale == 1);
+    mat transformed, eigvec;
+    vec eigval;
+    exact.Apply(data, transformed, eigval, eigvec);
+
+    // Update with blocks of uneven size.
+    IncrementalPCA p(5, scale == 1);
+    if (scale == 1)
+    {
+      // The standard deviations are only found by Fit(), so write the data.
+      data::Save("incremental_pca_test.csv", data);
+      data::StreamingReader reader("incremental_pca_test.csv", 300);
+      p.Fit(reader);
+    }
+    else
+    {
+      for (size_t begin = 0; begin < data.n_cols; begin += 173)
+        p.Update(data.cols(begin, std::min(begin + 172,
+            (size_t) data.n_cols - 1)));
+    }
+
+    BOOST_REQUIRE_EQUAL(p.Points(), 1000);
+    BOOST_REQUIRE_CLOSE(p.VarianceRetained(), 1.0, 1e-5);
+
+    const vec incrementalEigval = p.EigenValues();
+    BOOST_REQUIRE_EQUAL(incrementalEigval.n_elem, 5);
+    for (size_t i = 0; i < 5; ++i)
+      BOOST_REQUIRE_CLOSE(incrementalEigval[i], eigval[i], 1e-5);
+
+    // The projections may have opposite signs.
+    mat incrementalTransformed;
+    p.Transform(data, incrementalTransformed);
+    for (size_t i = 0; i < 5; ++i)
+    {
+      if (dot(transformed.row(i), incrementalTransformed.row(i)) < 0)
+        incrementalTransformed.row(i) *= -1;
+
+      for (size_t j = 0; j < data.n_cols; ++j)
+        BOOST_REQUIRE_SMALL(incrementalTransformed(i, j) - transformed(i, j),
+            1e-5);
+    }
+  }
+
+  remove("incremental_pca_test.csv");
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -166,4 +166,39 @@ BOOST_AUTO_TEST_CASE(SecondaryConstructor)
   Perceptron<> p2(p1);
 }
 
+/**
+ * Train the perceptron in parallel on shards of a linearly separable dataset,
+ * and make sure it converges to weights which separate the dataset; with one
+ * shard, the result must be the result of the serial algorithm.
+ */
+BOOST_AUTO_TEST_CASE(ParameterMixing)
+{
+  // Two separated clusters, with alternating labels.
+  mat trainData;
+  trainData.randu(3, 2000);
+  trainData *= 0.4;
+  Row<size_t> labels(trainData.n_cols);
+  for (size_t i = 0; i < trainData.n_cols; ++i)
+  {
+    labels[i] = i % 2;
+    if (labels[i] == 1)
+      trainData.col(i) += 0.6;
+  }
+
+  Perceptron<> p(trainData, labels, 1000, 4);
+  BOOST_REQUIRE_EQUAL(p.Shards(), 4);
+
+  Row<size_t> predictedLabels;
+  p.Classify(trainData, predictedLabels);
+
+  BOOST_REQUIRE_EQUAL(predictedLabels.n_elem, trainData.n_cols);
+  for (size_t i = 0; i < trainData.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(predictedLabels[i], labels[i]);
+
+  Perceptron<> serial(trainData, labels, 1000);
+  Perceptron<> oneShard(trainData, labels, 1000, 1);
+  for (size_t i = 0; i < serial.Weights().n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(serial.Weights()[i], oneShard.Weights()[i]);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
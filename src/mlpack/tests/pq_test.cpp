@@ -0,0 +1,172 @@
+/**
+ * @file pq_test.cpp
+ *
+ * Tests for the PQSearch class (approximate nearest neighbor search with
+ * product quantization).
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/methods/pq/pq_search.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+#include <boost/test/unit_test.hpp>
+#include "old_boost_test_definitions.hpp"
+
+using namespace mlpack;
+using namespace mlpack::neighbor;
+
+BOOST_AUTO_TEST_SUITE(PQTest);
+
+/**
+ * Make sure that each point is stored in Subspaces() bytes, that the codes
+ * refer to existing centroids, and that they are the codes of the nearest
+ * centroids.
+ */
+BOOST_AUTO_TEST_CASE(PQEncodeTest)
+{
+  math::RandomSeed(0);
+
+  arma::mat dataset;
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  PQSearch<> pq(dataset, 2, 16);
+
+  BOOST_REQUIRE_EQUAL(pq.Size(), dataset.n_cols);
+  BOOST_REQUIRE_EQUAL(pq.Dimensionality(), dataset.n_rows);
+  BOOST_REQUIRE_EQUAL(pq.Codes().n_rows, 2);
+  BOOST_REQUIRE_EQUAL(pq.Codes().n_cols, dataset.n_cols);
+  BOOST_REQUIRE_EQUAL(pq.Subspace(0), 0);
+  BOOST_REQUIRE_EQUAL(pq.Subspace(1), 1);
+  BOOST_REQUIRE_EQUAL(pq.Subspace(2), 3);
+
+  for (size_t s = 0; s < 2; ++s)
+  {
+    const arma::mat& codebook = pq.Codebook(s);
+    BOOST_REQUIRE_EQUAL(codebook.n_cols, 16);
+    BOOST_REQUIRE_EQUAL(codebook.n_rows, pq.Subspace(s + 1) - pq.Subspace(s));
+
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+    {
+      const size_t code = pq.Codes()(s, i);
+      BOOST_REQUIRE_LT(code, 16);
+
+      const arma::vec part = dataset.submat(pq.Subspace(s), i,
+          pq.Subspace(s + 1) - 1, i);
+      const double distance = metric::SquaredEuclideanDistance::Evaluate(part,
+          codebook.col(code));
+      for (size_t c = 0; c < 16; ++c)
+      {
+        BOOST_REQUIRE_LE(distance, metric::SquaredEuclideanDistance::Evaluate(
+            part, codebook.col(c)) + 1e-10);
+      }
+    }
+  }
+
+  // Encoding the points again, or adding them in parts, gives the same codes.
+  arma::Mat<unsigned char> codes;
+  pq.Encode(dataset, codes);
+  BOOST_REQUIRE_EQUAL(arma::accu(codes != pq.Codes()), 0);
+
+  PQSearch<> parts(2, 16);
+  parts.Train(dataset);
+  parts.Add(dataset.cols(0, 499));
+  parts.Add(dataset.cols(500, 999));
+  BOOST_REQUIRE_EQUAL(parts.Size(), dataset.n_cols);
+}
+
+/**
+ * With 256 centroids for each single dimension, the approximate distances are
+ * close to the exact ones, so the true nearest neighbor should almost always
+ * be among the approximate nearest neighbors.
+ */
+BOOST_AUTO_TEST_CASE(PQRecallTest)
+{
+  math::RandomSeed(0);
+
+  arma::mat dataset;
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  arma::mat naiveQuery(dataset);
+  arma::mat naiveReferences(dataset);
+  AllkNN naive(naiveQuery, naiveReferences, true);
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  naive.Search(1, naiveNeighbors, naiveDistances);
+
+  PQSearch<> pq(dataset, 3);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  pq.Search(dataset, 10, neighbors, distances);
+
+  BOOST_REQUIRE_EQUAL(neighbors.n_rows, 10);
+  BOOST_REQUIRE_EQUAL(neighbors.n_cols, dataset.n_cols);
+
+  size_t found = 0;
+  for (size_t q = 0; q < dataset.n_cols; ++q)
+  {
+    for (size_t j = 0; j < 10; ++j)
+    {
+      BOOST_REQUIRE_LT(neighbors(j, q), dataset.n_cols);
+      if (j > 0)
+        BOOST_REQUIRE_GE(distances(j, q), distances(j - 1, q));
+    }
+
+    for (size_t j = 0; j < 10; ++j)
+    {
+      if (neighbors(j, q) == naiveNeighbors(0, q))
+      {
+        ++found;
+        break;
+      }
+    }
+  }
+
+  BOOST_REQUIRE_GE(found, 900);
+}
+
+/**
+ * If every point is reranked, the results are exactly those of the naive
+ * search.
+ */
+BOOST_AUTO_TEST_CASE(PQRerankTest)
+{
+  math::RandomSeed(0);
+
+  arma::mat dataset;
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  arma::mat queries = dataset.cols(0, 99);
+
+  arma::mat naiveQuery(queries);
+  arma::mat naiveReferences(dataset);
+  AllkNN naive(naiveQuery, naiveReferences, true);
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  naive.Search(5, naiveNeighbors, naiveDistances);
+
+  PQSearch<> pq(dataset, 3, 8);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  pq.Search(queries, 5, neighbors, distances, dataset, dataset.n_cols);
+
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(distances[i], naiveDistances[i], 1e-5);
+  }
+
+  // With fewer candidates the distances are still exact.
+  pq.Search(queries, 5, neighbors, distances, dataset, 20);
+  for (size_t q = 0; q < queries.n_cols; ++q)
+  {
+    for (size_t j = 0; j < 5; ++j)
+    {
+      BOOST_REQUIRE_CLOSE(distances(j, q),
+          metric::EuclideanDistance::Evaluate(queries.col(q),
+          dataset.col(neighbors(j, q))), 1e-5);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,142 @@
+/**
+ * @file qdafn_test.cpp
+ *
+ * Tests for the QDAFN class (approximate furthest neighbor search with random
+ * projections).
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/methods/approx_kfn/qdafn.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+#include <boost/test/unit_test.hpp>
+#include "old_boost_test_definitions.hpp"
+
+using namespace mlpack;
+using namespace mlpack::neighbor;
+
+BOOST_AUTO_TEST_SUITE(QDAFNTest);
+
+/**
+ * Make sure that the candidates of each projection are the reference points
+ * with the largest projections onto its direction, in decreasing order.
+ */
+BOOST_AUTO_TEST_CASE(QDAFNCandidateTest)
+{
+  math::RandomSeed(0);
+
+  arma::mat dataset;
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  QDAFN qdafn(dataset, 5, 20);
+
+  BOOST_REQUIRE_EQUAL(qdafn.NumProjections(), 5);
+  BOOST_REQUIRE_EQUAL(qdafn.NumCandidates(), 20);
+  BOOST_REQUIRE_EQUAL(qdafn.Size(), dataset.n_cols);
+  BOOST_REQUIRE_EQUAL(qdafn.Lines().n_rows, dataset.n_rows);
+
+  for (size_t p = 0; p < 5; ++p)
+  {
+    const arma::rowvec projections = arma::trans(qdafn.Lines().col(p)) *
+        dataset;
+    const arma::rowvec sorted = arma::sort(projections);
+
+    for (size_t j = 0; j < 20; ++j)
+    {
+      // The j'th largest projection.
+      const double value = sorted[sorted.n_elem - 1 - j];
+      const size_t candidate = qdafn.CandidateIndices()(j, p);
+      BOOST_REQUIRE_LT(candidate, dataset.n_cols);
+      BOOST_REQUIRE_CLOSE(qdafn.CandidateValues()(j, p), value, 1e-5);
+      BOOST_REQUIRE_CLOSE(projections[candidate], value, 1e-5);
+    }
+  }
+}
+
+/**
+ * With one projection whose candidates are all of the reference points, every
+ * point is examined, so the results must be exact.
+ */
+BOOST_AUTO_TEST_CASE(QDAFNExactTest)
+{
+  arma::mat references = arma::randu<arma::mat>(4, 200);
+  arma::mat queries = arma::randu<arma::mat>(4, 50);
+
+  QDAFN qdafn(references, 1, 200);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  qdafn.Search(queries, 5, neighbors, distances);
+
+  AllkFN exact(references, queries, true);
+  arma::Mat<size_t> exactNeighbors;
+  arma::mat exactDistances;
+  exact.Search(5, exactNeighbors, exactDistances);
+
+  BOOST_REQUIRE_EQUAL(neighbors.n_rows, 5);
+  BOOST_REQUIRE_EQUAL(neighbors.n_cols, 50);
+  for (size_t i = 0; i < neighbors.n_cols; ++i)
+  {
+    for (size_t j = 0; j < neighbors.n_rows; ++j)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors(j, i), exactNeighbors(j, i));
+      BOOST_REQUIRE_CLOSE(distances(j, i), exactDistances(j, i), 1e-5);
+    }
+  }
+
+  BOOST_REQUIRE_CLOSE(QDAFN::ApproximationRatio(distances, exactDistances),
+      1.0, 1e-5);
+}
+
+/**
+ * With a small candidate budget, the results must still be distinct reference
+ * points, furthest first, with their true distances, and close to the exact
+ * furthest neighbors.  The results must not depend on the number of threads.
+ */
+BOOST_AUTO_TEST_CASE(QDAFNApproximateTest)
+{
+  math::RandomSeed(0);
+
+  arma::mat dataset;
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  arma::mat queries = arma::randu<arma::mat>(3, 100);
+
+  QDAFN qdafn(dataset, 10, 100);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  qdafn.Search(queries, 3, neighbors, distances);
+
+  for (size_t i = 0; i < neighbors.n_cols; ++i)
+  {
+    for (size_t j = 0; j < neighbors.n_rows; ++j)
+    {
+      BOOST_REQUIRE_LT(neighbors(j, i), dataset.n_cols);
+      BOOST_REQUIRE_CLOSE(distances(j, i), metric::EuclideanDistance::Evaluate(
+          queries.col(i), dataset.col(neighbors(j, i))), 1e-5);
+      if (j > 0)
+      {
+        BOOST_REQUIRE_NE(neighbors(j, i), neighbors(j - 1, i));
+        BOOST_REQUIRE_GE(distances(j - 1, i), distances(j, i));
+      }
+    }
+  }
+
+  AllkFN exact(dataset, queries, true);
+  arma::Mat<size_t> exactNeighbors;
+  arma::mat exactDistances;
+  exact.Search(3, exactNeighbors, exactDistances);
+
+  const double ratio = QDAFN::ApproximationRatio(distances, exactDistances);
+  BOOST_REQUIRE_GE(ratio, 1.0 - 1e-10);
+  BOOST_REQUIRE_LT(ratio, 1.1);
+
+  arma::Mat<size_t> parallelNeighbors;
+  arma::mat parallelDistances;
+  qdafn.NumThreads() = 4;
+  qdafn.Search(queries, 3, parallelNeighbors, parallelDistances);
+
+  BOOST_REQUIRE_EQUAL(arma::accu(parallelNeighbors != neighbors), 0);
+  BOOST_REQUIRE_EQUAL(arma::accu(parallelDistances != distances), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -52,4 +52,26 @@ BOOST_AUTO_TEST_CASE(Radical_Test_Radical3D)
   BOOST_REQUIRE_CLOSE(valBest, valEst, 0.25);
 }
 
+/**
+ * Make sure Vasicek() sorts the sample in place and gives the m-spacing
+ * estimate of the sorted sample.
+ */
+BOOST_AUTO_TEST_CASE(Radical_Test_Vasicek)
+{
+  Radical rad(0.175, 5, 100, 0, 4);
+
+  vec x = randu<vec>(500);
+  const vec sorted = sort(x);
+
+  double expected = 0;
+  for (uword i = 0; i + 4 < sorted.n_elem; i++)
+    expected += log(sorted(i + 4) - sorted(i));
+
+  const double value = rad.Vasicek(x);
+
+  BOOST_REQUIRE_CLOSE(value, expected, 1e-10);
+  for (uword i = 0; i < x.n_elem; i++)
+    BOOST_REQUIRE_EQUAL(x(i), sorted(i));
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,50 @@
+/**
+ * @file randomized_svd_test.cpp
+ *
+ * Test file for the RandomizedSVD class.
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/methods/randomized_svd/randomized_svd.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include "old_boost_test_definitions.hpp"
+
+BOOST_AUTO_TEST_SUITE(RandomizedSVDTest);
+
+using namespace mlpack;
+using namespace mlpack::svd;
+
+/**
+ * The singular values of a low-rank matrix should be those of the exact SVD,
+ * and the matrix should be reconstructed from the truncated SVD.
+ */
+BOOST_AUTO_TEST_CASE(RandomizedSVDLowRankTest)
+{
+  // A 50 x 200 matrix of rank 5.
+  const arma::mat data = arma::randn<arma::mat>(50, 5) *
+      arma::randn<arma::mat>(5, 200);
+
+  arma::mat u, v;
+  arma::vec sigma;
+  RandomizedSVD rsvd;
+  rsvd.Apply(data, u, sigma, v, 5);
+
+  BOOST_REQUIRE_EQUAL(u.n_rows, 50);
+  BOOST_REQUIRE_EQUAL(u.n_cols, 5);
+  BOOST_REQUIRE_EQUAL(sigma.n_elem, 5);
+  BOOST_REQUIRE_EQUAL(v.n_rows, 200);
+  BOOST_REQUIRE_EQUAL(v.n_cols, 5);
+
+  arma::mat exactU, exactV;
+  arma::vec exactSigma;
+  arma::svd_econ(exactU, exactSigma, exactV, data);
+  for (size_t i = 0; i < 5; ++i)
+    BOOST_REQUIRE_CLOSE(sigma[i], exactSigma[i], 1e-5);
+
+  const arma::mat reconstruct = u * arma::diagmat(sigma) * v.t();
+  const double relativeError = arma::norm(data - reconstruct, "fro") /
+      arma::norm(data, "fro");
+  BOOST_REQUIRE_SMALL(relativeError, 1e-5);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -7,6 +7,7 @@
 #include <mlpack/core.hpp>
 #include <mlpack/methods/range_search/range_search.hpp>
 #include <mlpack/core/tree/cover_tree.hpp>
+#include <mlpack/core/tree/rectangle_tree.hpp>
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
 
@@ -37,6 +38,22 @@ void SortResults(const vector<vector<size_t> >& neighbors,
   }
 }
 
+// Visitor which collects every result it is given, for the callback tests.
+class CollectingVisitor
+{
+ public:
+  CollectingVisitor(const size_t numQueries) : results(numQueries) { }
+
+  void operator()(const size_t queryIndex,
+                  const size_t referenceIndex,
+                  const double distance)
+  {
+    results[queryIndex].push_back(make_pair(distance, referenceIndex));
+  }
+
+  vector<vector<pair<double, size_t> > > results;
+};
+
 // Clean a tree's statistics.
 template<typename TreeType>
 void CleanTree(TreeType& node)
@@ -587,6 +604,111 @@ BOOST_AUTO_TEST_CASE(SingleTreeVsNaive)
   }
 }
 
+/**
+ * Make sure that dual-tree range search with a lazily built reference tree
+ * gives the same results as naive search.  The range is wide, so whole
+ * reference nodes which are still to be split are found to be in range, and
+ * their descendants must still map to the right points once the search is
+ * done.
+ */
+BOOST_AUTO_TEST_CASE(LazyReferenceTreeTest)
+{
+  typedef BinarySpaceTree<HRectBound<2>, RangeSearchStat> TreeType;
+
+  arma::mat referenceData;
+  referenceData.randu(3, 2000);
+  arma::mat queryData;
+  queryData.randu(3, 200);
+
+  arma::mat references(referenceData);
+  std::vector<size_t> oldFromNewReferences;
+  TreeType referenceTree(references, oldFromNewReferences, 20, true);
+  arma::mat queries(queryData);
+  std::vector<size_t> oldFromNewQueries;
+  TreeType queryTree(queries, oldFromNewQueries, 20);
+
+  RangeSearch<> lazy(&referenceTree, &queryTree, references, queries);
+  vector<vector<size_t> > neighbors;
+  vector<vector<double> > distances;
+  lazy.Search(Range(0.0, 0.6), neighbors, distances);
+
+  // Map the results back to the original indices, now that the search (and
+  // the splitting of the reference tree) is done.
+  vector<vector<size_t> > mappedNeighbors(neighbors.size());
+  vector<vector<double> > mappedDistances(distances.size());
+  for (size_t i = 0; i < neighbors.size(); ++i)
+  {
+    const size_t query = oldFromNewQueries[i];
+    mappedDistances[query] = distances[i];
+    for (size_t j = 0; j < neighbors[i].size(); ++j)
+      mappedNeighbors[query].push_back(oldFromNewReferences[neighbors[i][j]]);
+  }
+  vector<vector<pair<double, size_t> > > sortedLazy;
+  SortResults(mappedNeighbors, mappedDistances, sortedLazy);
+
+  RangeSearch<> naive(referenceData, queryData, true);
+  naive.Search(Range(0.0, 0.6), neighbors, distances);
+  vector<vector<pair<double, size_t> > > sortedNaive;
+  SortResults(neighbors, distances, sortedNaive);
+
+  BOOST_REQUIRE_EQUAL(sortedLazy.size(), sortedNaive.size());
+  for (size_t i = 0; i < sortedLazy.size(); ++i)
+  {
+    BOOST_REQUIRE_EQUAL(sortedLazy[i].size(), sortedNaive[i].size());
+    for (size_t j = 0; j < sortedLazy[i].size(); ++j)
+    {
+      BOOST_REQUIRE_EQUAL(sortedLazy[i][j].second, sortedNaive[i][j].second);
+      BOOST_REQUIRE_CLOSE(sortedLazy[i][j].first, sortedNaive[i][j].first,
+          1e-5);
+    }
+  }
+}
+
+/**
+ * Make sure that building the trees in place on the caller's matrices gives the
+ * same results as building them on copies.
+ */
+BOOST_AUTO_TEST_CASE(InPlaceTreeBuildingTest)
+{
+  arma::mat referenceData;
+  referenceData.randu(3, 500);
+  arma::mat queryData;
+  queryData.randu(3, 300);
+
+  RangeSearch<> copying(referenceData, queryData);
+  vector<vector<size_t> > neighbors;
+  vector<vector<double> > distances;
+  copying.Search(Range(0.1, 0.3), neighbors, distances);
+  vector<vector<pair<double, size_t> > > sortedCopying;
+  SortResults(neighbors, distances, sortedCopying);
+
+  arma::mat references(referenceData);
+  arma::mat queries(queryData);
+  vector<size_t> oldFromNewReferences;
+  vector<size_t> oldFromNewQueries;
+  RangeSearch<> inPlace(references, queries, oldFromNewReferences,
+      oldFromNewQueries);
+  BOOST_REQUIRE_EQUAL(oldFromNewReferences.size(), referenceData.n_cols);
+  BOOST_REQUIRE_EQUAL(oldFromNewQueries.size(), queryData.n_cols);
+
+  inPlace.Search(Range(0.1, 0.3), neighbors, distances);
+  vector<vector<pair<double, size_t> > > sortedInPlace;
+  SortResults(neighbors, distances, sortedInPlace);
+
+  BOOST_REQUIRE_EQUAL(sortedInPlace.size(), sortedCopying.size());
+  for (size_t i = 0; i < sortedInPlace.size(); ++i)
+  {
+    BOOST_REQUIRE_EQUAL(sortedInPlace[i].size(), sortedCopying[i].size());
+    for (size_t j = 0; j < sortedInPlace[i].size(); ++j)
+    {
+      BOOST_REQUIRE_EQUAL(sortedInPlace[i][j].second,
+          sortedCopying[i][j].second);
+      BOOST_REQUIRE_CLOSE(sortedInPlace[i][j].first, sortedCopying[i][j].first,
+          1e-5);
+    }
+  }
+}
+
 /**
  * Ensure that dual tree range search with cover trees works by comparing 
  * with the kd-tree implementation.
@@ -1060,4 +1182,177 @@ BOOST_AUTO_TEST_CASE(DualBallTreeTest2)
   }
 }
 
+/**
+ * Ensure that single-tree and dual-tree range search with R*-trees gives the
+ * same results as the kd-tree implementation, with one and with two datasets.
+ */
+BOOST_AUTO_TEST_CASE(RTreeTest)
+{
+  arma::mat data;
+  data.randu(8, 1000); // 1000 points in 8 dimensions.
+  arma::mat queryData;
+  queryData.randu(8, 200);
+
+  typedef RectangleTree<RStarTreeSplit<RStarTreeDescentHeuristic,
+      RangeSearchStat, arma::mat>, RStarTreeDescentHeuristic, RangeSearchStat,
+      arma::mat> TreeType;
+  TreeType tree(data, 20, 6, 5, 2, 0);
+  TreeType queryTree(queryData, 20, 6, 5, 2, 0);
+
+  const Range range(0.5, 1.0);
+
+  // Run each combination of single-tree/dual-tree and one/two datasets.
+  for (size_t r = 0; r < 4; ++r)
+  {
+    const bool singleMode = (r % 2 == 0);
+    const bool twoDatasets = (r >= 2);
+
+    RangeSearch<> kdsearch(data, twoDatasets ? queryData : data, false,
+        singleMode);
+    RangeSearch<metric::EuclideanDistance, TreeType>* rsearch = twoDatasets ?
+        new RangeSearch<metric::EuclideanDistance, TreeType>(&tree,
+        singleMode ? NULL : &queryTree, data, queryData, singleMode) :
+        new RangeSearch<metric::EuclideanDistance, TreeType>(&tree, data,
+        singleMode);
+
+    CleanTree(tree);
+    CleanTree(queryTree);
+
+    vector<vector<size_t> > kdNeighbors;
+    vector<vector<double> > kdDistances;
+    vector<vector<size_t> > rNeighbors;
+    vector<vector<double> > rDistances;
+    kdsearch.Search(range, kdNeighbors, kdDistances);
+    rsearch->Search(range, rNeighbors, rDistances);
+    delete rsearch;
+
+    vector<vector<pair<double, size_t> > > kdSorted;
+    vector<vector<pair<double, size_t> > > rSorted;
+    SortResults(kdNeighbors, kdDistances, kdSorted);
+    SortResults(rNeighbors, rDistances, rSorted);
+
+    BOOST_REQUIRE_EQUAL(kdSorted.size(), rSorted.size());
+    for (size_t i = 0; i < kdSorted.size(); ++i)
+    {
+      BOOST_REQUIRE_EQUAL(kdSorted[i].size(), rSorted[i].size());
+      for (size_t j = 0; j < kdSorted[i].size(); ++j)
+      {
+        BOOST_REQUIRE_EQUAL(kdSorted[i][j].second, rSorted[i][j].second);
+        BOOST_REQUIRE_CLOSE(kdSorted[i][j].first, rSorted[i][j].first, 1e-5);
+      }
+    }
+  }
+}
+
+/**
+ * Make sure that the compressed sparse row overload of Search() gives the same
+ * results, in the same order, as the nested vector overload, for each search
+ * mode and with and without a query set.
+ */
+BOOST_AUTO_TEST_CASE(CompressedSparseRowSearchTest)
+{
+  arma::mat data;
+  data.randu(3, 500);
+  arma::mat queries;
+  queries.randu(3, 300);
+
+  const Range range(0.1, 0.3);
+
+  for (size_t mode = 0; mode < 6; ++mode)
+  {
+    const bool naive = (mode % 3 == 0);
+    const bool singleMode = (mode % 3 == 1);
+
+    RangeSearch<>* rs;
+    if (mode < 3)
+      rs = new RangeSearch<>(data, queries, naive, singleMode);
+    else
+      rs = new RangeSearch<>(data, naive, singleMode);
+
+    vector<vector<size_t> > neighbors;
+    vector<vector<double> > distances;
+    rs->Search(range, neighbors, distances);
+
+    arma::Col<size_t> offsets;
+    arma::Col<size_t> csrNeighbors;
+    arma::vec csrDistances;
+    rs->Search(range, offsets, csrNeighbors, csrDistances);
+
+    BOOST_REQUIRE_EQUAL(offsets.n_elem, neighbors.size() + 1);
+    BOOST_REQUIRE_EQUAL(offsets[0], (size_t) 0);
+    BOOST_REQUIRE_EQUAL(csrNeighbors.n_elem, offsets[neighbors.size()]);
+    BOOST_REQUIRE_EQUAL(csrDistances.n_elem, offsets[neighbors.size()]);
+
+    for (size_t i = 0; i < neighbors.size(); ++i)
+    {
+      BOOST_REQUIRE_EQUAL(offsets[i + 1] - offsets[i], neighbors[i].size());
+      for (size_t j = 0; j < neighbors[i].size(); ++j)
+      {
+        BOOST_REQUIRE_EQUAL(csrNeighbors[offsets[i] + j], neighbors[i][j]);
+        BOOST_REQUIRE_CLOSE(csrDistances[offsets[i] + j], distances[i][j],
+            1e-10);
+      }
+    }
+
+    delete rs;
+  }
+}
+
+/**
+ * Make sure that Count() gives the number of results Search() finds, and that
+ * the visitor overload of Search() is given exactly the results Search()
+ * stores, for each search mode and with and without a query set.  A range
+ * starting at 0 is also used, so whole nodes containing the query point are
+ * counted.
+ */
+BOOST_AUTO_TEST_CASE(CountAndVisitorSearchTest)
+{
+  arma::mat data;
+  data.randu(3, 500);
+  arma::mat queries;
+  queries.randu(3, 300);
+
+  for (size_t mode = 0; mode < 12; ++mode)
+  {
+    const bool naive = (mode % 3 == 0);
+    const bool singleMode = (mode % 3 == 1);
+    const Range range((mode < 6) ? 0.0 : 0.1, 0.3);
+
+    RangeSearch<>* rs;
+    if (mode % 6 < 3)
+      rs = new RangeSearch<>(data, queries, naive, singleMode);
+    else
+      rs = new RangeSearch<>(data, naive, singleMode);
+
+    vector<vector<size_t> > neighbors;
+    vector<vector<double> > distances;
+    rs->Search(range, neighbors, distances);
+    vector<vector<pair<double, size_t> > > sorted;
+    SortResults(neighbors, distances, sorted);
+
+    arma::Col<size_t> counts;
+    rs->Count(range, counts);
+
+    CollectingVisitor visitor(neighbors.size());
+    rs->Search(range, visitor);
+
+    BOOST_REQUIRE_EQUAL(counts.n_elem, neighbors.size());
+    for (size_t i = 0; i < neighbors.size(); ++i)
+    {
+      BOOST_REQUIRE_EQUAL(counts[i], neighbors[i].size());
+
+      sort(visitor.results[i].begin(), visitor.results[i].end());
+      BOOST_REQUIRE_EQUAL(visitor.results[i].size(), sorted[i].size());
+      for (size_t j = 0; j < sorted[i].size(); ++j)
+      {
+        BOOST_REQUIRE_EQUAL(visitor.results[i][j].second, sorted[i][j].second);
+        BOOST_REQUIRE_CLOSE(visitor.results[i][j].first, sorted[i][j].first,
+            1e-10);
+      }
+    }
+
+    delete rs;
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -48,6 +48,17 @@ BOOST_AUTO_TEST_CASE(RectangeTreeTraitsTest)
           NeighborSearchStat<NearestNeighborSort>,
           arma::mat> >::HasSelfChildren;
   BOOST_REQUIRE_EQUAL(b, false);
+
+  // The tree holds the indices of the points, so the dataset is not
+  // rearranged.
+  b = TreeTraits<RectangleTree<
+          RTreeSplit<RTreeDescentHeuristic,
+                     NeighborSearchStat<NearestNeighborSort>,
+                     arma::mat>,
+          RTreeDescentHeuristic,
+          NeighborSearchStat<NearestNeighborSort>,
+          arma::mat> >::RearrangesDataset;
+  BOOST_REQUIRE_EQUAL(b, false);
 }
 
 // Test to make sure the tree can be contains the correct number of points after
@@ -578,6 +589,165 @@ BOOST_AUTO_TEST_CASE(PointDynamicAdd)
   }
 }
 
+/**
+ * Check every structural property of the given tree: containment, tight bounds,
+ * parent pointers, sync with the dataset, fills, and balance.
+ */
+template<typename TreeType>
+void CheckTreeStructure(const TreeType& tree)
+{
+  CheckContainment(tree);
+  CheckExactContainment(tree);
+  CheckHierarchy(tree);
+  CheckSync(tree);
+  CheckFills(tree);
+  BOOST_REQUIRE_EQUAL(GetMinLevel(tree), GetMaxLevel(tree));
+  BOOST_REQUIRE_EQUAL(tree.TreeDepth(), GetMinLevel(tree));
+}
+
+/**
+ * Build a bulk-loaded tree of the given type, check its structure, make sure
+ * points can be deleted and inserted again, and compare nearest neighbor
+ * search results with a naive search.
+ */
+template<typename TreeType>
+void CheckBulkLoadedTree()
+{
+  const int numIter = 50;
+  arma::mat dataset;
+  dataset.randu(8, 1000); // 1000 points in 8 dimensions.
+
+  TreeType tree(dataset, 20, 6, 5, 2, 0, true);
+  BOOST_REQUIRE_EQUAL(tree.NumDescendants(), 1000);
+  CheckTreeStructure(tree);
+
+  for (int i = 0; i < numIter; i++)
+    BOOST_REQUIRE(tree.DeletePoint(999 - i));
+
+  BOOST_REQUIRE_EQUAL(tree.NumDescendants(), 1000 - numIter);
+  CheckContainment(tree);
+  CheckSync(tree);
+  CheckExactContainment(tree);
+
+  for (int i = 0; i < numIter; i++)
+    tree.InsertPoint(999 - i);
+
+  BOOST_REQUIRE_EQUAL(tree.NumDescendants(), 1000);
+  CheckContainment(tree);
+  CheckSync(tree);
+  CheckExactContainment(tree);
+
+  arma::Mat<size_t> neighbors1;
+  arma::mat distances1;
+  arma::Mat<size_t> neighbors2;
+  arma::mat distances2;
+
+  NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>, TreeType>
+      allknn1(&tree, dataset, true);
+  allknn1.Search(5, neighbors1, distances1);
+
+  AllkNN allknn2(dataset, true, true);
+  allknn2.Search(5, neighbors2, distances2);
+
+  for (size_t i = 0; i < neighbors1.size(); i++)
+  {
+    BOOST_REQUIRE_EQUAL(distances1[i], distances2[i]);
+    BOOST_REQUIRE_EQUAL(neighbors1[i], neighbors2[i]);
+  }
+}
+
+/**
+ * Collect the points of the leaves below the given node, in order, and check
+ * that NumDescendants() and Descendant() of every node agree with them.
+ */
+template<typename TreeType>
+void CheckDescendants(TreeType& node, std::vector<size_t>& points)
+{
+  const size_t first = points.size();
+  if (node.IsLeaf())
+  {
+    for (size_t i = 0; i < node.Count(); ++i)
+      points.push_back(node.Point(i));
+  }
+  else
+  {
+    for (size_t i = 0; i < node.NumChildren(); ++i)
+      CheckDescendants(node.Child(i), points);
+  }
+
+  BOOST_REQUIRE_EQUAL(node.NumDescendants(), points.size() - first);
+  for (size_t i = 0; i < node.NumDescendants(); ++i)
+    BOOST_REQUIRE_EQUAL(node.Descendant(i), points[first + i]);
+}
+
+// Make sure that NumDescendants() and Descendant() are right in every node
+// (not only in the leaves), after the tree is built and after points are
+// deleted and inserted.
+BOOST_AUTO_TEST_CASE(DescendantTest)
+{
+  arma::mat dataset;
+  dataset.randu(8, 1000); // 1000 points in 8 dimensions.
+
+  typedef RectangleTree<RStarTreeSplit<RStarTreeDescentHeuristic,
+      NeighborSearchStat<NearestNeighborSort>, arma::mat>,
+      RStarTreeDescentHeuristic, NeighborSearchStat<NearestNeighborSort>,
+      arma::mat> TreeType;
+  TreeType tree(dataset, 20, 6, 5, 2, 0);
+
+  std::vector<size_t> points;
+  CheckDescendants(tree, points);
+  BOOST_REQUIRE_EQUAL(points.size(), 1000);
+
+  for (size_t i = 0; i < 100; ++i)
+    BOOST_REQUIRE(tree.DeletePoint(999 - 3 * i));
+
+  points.clear();
+  CheckDescendants(tree, points);
+  BOOST_REQUIRE_EQUAL(points.size(), 900);
+
+  for (size_t i = 0; i < 100; ++i)
+    tree.InsertPoint(999 - 3 * i);
+
+  points.clear();
+  CheckDescendants(tree, points);
+  BOOST_REQUIRE_EQUAL(points.size(), 1000);
+}
+
+// Test that Sort-Tile-Recursive bulk loading builds a valid R tree and R* tree
+// that still supports deletion and insertion.
+BOOST_AUTO_TEST_CASE(BulkLoadTest)
+{
+  CheckBulkLoadedTree<RectangleTree<
+      RTreeSplit<RTreeDescentHeuristic,
+                 NeighborSearchStat<NearestNeighborSort>,
+                 arma::mat>,
+      RTreeDescentHeuristic,
+      NeighborSearchStat<NearestNeighborSort>,
+      arma::mat> >();
+
+  CheckBulkLoadedTree<RectangleTree<
+      RStarTreeSplit<RStarTreeDescentHeuristic,
+                     NeighborSearchStat<NearestNeighborSort>,
+                     arma::mat>,
+      RStarTreeDescentHeuristic,
+      NeighborSearchStat<NearestNeighborSort>,
+      arma::mat> >();
+
+  // A dataset small enough for one leaf.
+  arma::mat small;
+  small.randu(3, 15);
+  RectangleTree<
+      RTreeSplit<RTreeDescentHeuristic,
+                 NeighborSearchStat<NearestNeighborSort>,
+                 arma::mat>,
+      RTreeDescentHeuristic,
+      NeighborSearchStat<NearestNeighborSort>,
+      arma::mat> smallTree(small, 20, 6, 5, 2, 0, true);
+  BOOST_REQUIRE(smallTree.IsLeaf());
+  BOOST_REQUIRE_EQUAL(smallTree.Count(), 15);
+  CheckTreeStructure(smallTree);
+}
+
 // A test to ensure that the SingleTreeTraverser is working correctly by
 // comparing its results to the results of a naive search.
 BOOST_AUTO_TEST_CASE(SingleTreeTraverserTest)
@@ -624,6 +794,48 @@ BOOST_AUTO_TEST_CASE(SingleTreeTraverserTest)
 }
 
 
+// Make sure that the parallel dual-tree traversal gives the same results as
+// the serial traversal and a naive search.
+BOOST_AUTO_TEST_CASE(ParallelDualTreeTraverserTest)
+{
+  arma::mat referenceData;
+  referenceData.randu(3, 2000);
+  arma::mat queryData;
+  queryData.randu(3, 1000);
+
+  typedef RectangleTree<
+      RStarTreeSplit<RStarTreeDescentHeuristic,
+                     NeighborSearchStat<NearestNeighborSort>,
+                     arma::mat>,
+      RStarTreeDescentHeuristic,
+      NeighborSearchStat<NearestNeighborSort>,
+      arma::mat> TreeType;
+  TreeType referenceTree(referenceData, 20, 6, 5, 2, 0);
+
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  AllkNN naive(referenceData, queryData, true);
+  naive.Search(5, naiveNeighbors, naiveDistances);
+
+  for (size_t threads = 1; threads <= 4; threads += 3)
+  {
+    TreeType queryTree(queryData, 20, 6, 5, 2, 0);
+    NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>, TreeType>
+        allknn(&referenceTree, &queryTree, referenceData, queryData);
+    allknn.NumThreads() = threads;
+
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    allknn.Search(5, neighbors, distances);
+
+    for (size_t i = 0; i < neighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors[i], naiveNeighbors[i]);
+      BOOST_REQUIRE_CLOSE(distances[i], naiveDistances[i], 1e-5);
+    }
+  }
+}
+
 // A test to ensure that the SingleTreeTraverser is working correctly by
 // comparing its results to the results of a naive search.
 /** This is known to not work: see #368.
@@ -125,4 +125,87 @@ BOOST_AUTO_TEST_CASE(RastrigrinFunctionTest)
   BOOST_REQUIRE_GE(successes, 1);
 }
 
+/**
+ * Parallel tempering with several chains should also escape from the local
+ * minima of the Rastrigrin function.
+ */
+BOOST_AUTO_TEST_CASE(RastrigrinFunctionMultiChainTest)
+{
+  size_t successes = 0;
+
+  for (size_t trial = 0; trial < 3; ++trial)
+  {
+    RastrigrinFunction f;
+    ExponentialSchedule schedule(3e-6);
+    SA<RastrigrinFunction> sa(f, schedule, 20000000, 100, 50, 1000, 1e-12, 2,
+        0.2, 0.01, 0.1, 4, 10);
+    arma::mat coordinates = f.GetInitialPoint();
+
+    const double result = sa.Optimize(coordinates);
+
+    if ((std::abs(result) < 1e-3) &&
+        (std::abs(coordinates[0]) < 1e-3) &&
+        (std::abs(coordinates[1]) < 1e-3))
+      ++successes;
+  }
+
+  BOOST_REQUIRE_GE(successes, 1);
+}
+
+/**
+ * A separable quadratic function, f(x) = \sum_i (x_i - i)^2, which can give the
+ * change of its value for a move of one coordinate without being evaluated
+ * fully.  The number of full evaluations is counted.
+ */
+class SeparableQuadraticFunction
+{
+ public:
+  SeparableQuadraticFunction() : evaluations(0) { }
+
+  double Evaluate(const arma::mat& coordinates)
+  {
+    ++evaluations;
+    double objective = 0;
+    for (size_t i = 0; i < coordinates.n_elem; ++i)
+      objective += std::pow(coordinates[i] - double(i), 2.0);
+
+    return objective;
+  }
+
+  double EvaluateDelta(const arma::mat& coordinates,
+                       const size_t i,
+                       const double move) const
+  {
+    return std::pow(coordinates[i] + move - double(i), 2.0) -
+        std::pow(coordinates[i] - double(i), 2.0);
+  }
+
+  arma::mat GetInitialPoint() const { return arma::zeros<arma::mat>(5, 1); }
+
+  size_t Evaluations() const { return evaluations; }
+
+ private:
+  size_t evaluations;
+};
+
+/**
+ * When the function implements EvaluateDelta(), SA should only evaluate it
+ * fully once, and still find the minimum.
+ */
+BOOST_AUTO_TEST_CASE(EvaluateDeltaTest)
+{
+  SeparableQuadraticFunction f;
+  ExponentialSchedule schedule(1e-5);
+  SA<SeparableQuadraticFunction> sa(f, schedule, 10000000, 1000., 1000, 100,
+      1e-11, 3, 20, 0.3, 0.3);
+  arma::mat coordinates = f.GetInitialPoint();
+
+  const double result = sa.Optimize(coordinates);
+
+  BOOST_REQUIRE_EQUAL(f.Evaluations(), (size_t) 1);
+  BOOST_REQUIRE_SMALL(result, 1e-4);
+  for (size_t i = 0; i < coordinates.n_elem; ++i)
+    BOOST_REQUIRE_SMALL(coordinates[i] - double(i), 1e-2);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
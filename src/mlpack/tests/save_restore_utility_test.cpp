@@ -149,6 +149,63 @@ BOOST_AUTO_TEST_CASE(SaveArmaMat)
   delete sRM;
 }
 
+/**
+ * Test the binary format, chosen by the .bin extension: matrices must be
+ * restored exactly, along with the other parameters and the children.
+ */
+BOOST_AUTO_TEST_CASE(SaveRestoreBinary)
+{
+  arma::mat matrix = arma::randu<arma::mat>(7, 13);
+  arma::vec vector = arma::randn<arma::vec>(5);
+  double d = 3.14159;
+  std::string cc = "Hello world!";
+
+  SaveRestoreUtility child;
+  child.SaveParameter(ARGSTR(vector));
+
+  SaveRestoreUtility sRM;
+  sRM.SaveParameter(ARGSTR(matrix));
+  sRM.SaveParameter(ARGSTR(d));
+  sRM.SaveParameter(ARGSTR(cc));
+  sRM.AddChild(child, "child");
+  BOOST_REQUIRE(sRM.WriteFile("test_binary.bin"));
+
+  SaveRestoreUtility loaded;
+  BOOST_REQUIRE(loaded.ReadFile("test_binary.bin"));
+
+  arma::mat matrix2;
+  loaded.LoadParameter(matrix2, "matrix");
+  BOOST_REQUIRE_EQUAL(matrix2.n_rows, matrix.n_rows);
+  BOOST_REQUIRE_EQUAL(matrix2.n_cols, matrix.n_cols);
+  for (size_t i = 0; i < matrix.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(matrix[i], matrix2[i]);
+
+  double d2;
+  std::string cc2;
+  loaded.LoadParameter(d2, "d");
+  loaded.LoadParameter(cc2, "cc");
+  BOOST_REQUIRE_CLOSE(d, d2, 1e-5);
+  BOOST_REQUIRE(cc == cc2);
+
+  BOOST_REQUIRE_EQUAL(loaded.Children().size(), 1);
+  arma::vec vector2;
+  loaded.Children()["child"].LoadParameter(vector2, "vector");
+  BOOST_REQUIRE_EQUAL(vector2.n_elem, vector.n_elem);
+  for (size_t i = 0; i < vector.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(vector[i], vector2[i]);
+
+  // The matrices are in the mapped file; writing the model back to the same
+  // file must copy them out first.
+  BOOST_REQUIRE(loaded.WriteFile("test_binary.bin"));
+  SaveRestoreUtility reloaded;
+  BOOST_REQUIRE(reloaded.ReadFile("test_binary.bin"));
+  reloaded.LoadParameter(matrix2, "matrix");
+  for (size_t i = 0; i < matrix.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(matrix[i], matrix2[i]);
+
+  remove("test_binary.bin");
+}
+
 /**
  * Test SaveRestoreModel proper usage in child classes and loading from
  *   separately defined objects
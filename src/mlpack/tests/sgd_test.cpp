@@ -39,6 +39,96 @@ BOOST_AUTO_TEST_CASE(SimpleSGDTestFunction)
   BOOST_REQUIRE_SMALL(coordinates[2], 1e-7);
 }
 
+/**
+ * Optimize the SGD test function with the objective estimated from a sample of
+ * the functions, and with the objective not tracked at all.
+ */
+BOOST_AUTO_TEST_CASE(SGDObjectiveTrackingTest)
+{
+  SGDTestFunction f;
+  SGD<SGDTestFunction> s(f, 0.0003, 5000000, 1e-9, true, 2);
+
+  arma::mat coordinates = f.GetInitialPoint();
+  double result = s.Optimize(coordinates);
+
+  BOOST_REQUIRE_CLOSE(result, -1.0, 0.05);
+  BOOST_REQUIRE_SMALL(coordinates[0], 1e-3);
+
+  // Without the objective, the optimization runs for all the iterations; the
+  // final objective is still computed.
+  SGD<SGDTestFunction> s2(f, 0.0003, 3000000, 1e-9, true, 0, false);
+
+  coordinates = f.GetInitialPoint();
+  result = s2.Optimize(coordinates);
+
+  BOOST_REQUIRE_CLOSE(result, -1.0, 0.05);
+  BOOST_REQUIRE_SMALL(coordinates[0], 1e-3);
+  BOOST_REQUIRE_SMALL(coordinates[1], 1e-7);
+  BOOST_REQUIRE_SMALL(coordinates[2], 1e-7);
+}
+
+/**
+ * Optimize the SGD test function with the adaptive update policies.  Adam,
+ * AdaGrad and RMSProp take steps of about the step size whatever the scale of
+ * the gradient, so they oscillate around the optimum at that scale.
+ */
+BOOST_AUTO_TEST_CASE(SGDUpdatePolicyTestFunction)
+{
+  SGDTestFunction f;
+
+  MomentumSGD<SGDTestFunction> momentum(f, 0.0003, 5000000, 1e-9, true, 0,
+      true, MomentumUpdate(0.5, true));
+  arma::mat coordinates = f.GetInitialPoint();
+  BOOST_REQUIRE_CLOSE(momentum.Optimize(coordinates), -1.0, 0.1);
+  BOOST_REQUIRE_SMALL(coordinates[0], 2e-3);
+
+  AdamSGD<SGDTestFunction> adam(f, 0.001, 1000000, 1e-12);
+  coordinates = f.GetInitialPoint();
+  BOOST_REQUIRE_CLOSE(adam.Optimize(coordinates), -1.0, 1.0);
+  BOOST_REQUIRE_SMALL(coordinates[1], 0.01);
+  BOOST_REQUIRE_SMALL(coordinates[2], 0.01);
+
+  RMSPropSGD<SGDTestFunction> rmsprop(f, 0.001, 1000000, 1e-12);
+  coordinates = f.GetInitialPoint();
+  BOOST_REQUIRE_CLOSE(rmsprop.Optimize(coordinates), -1.0, 1.0);
+  BOOST_REQUIRE_SMALL(coordinates[1], 0.01);
+  BOOST_REQUIRE_SMALL(coordinates[2], 0.01);
+}
+
+/**
+ * Make sure the sparse (lazy) updates of each policy are the same as the dense
+ * updates when every coordinate is touched.
+ */
+template<typename UpdatePolicyType>
+void CheckSparseUpdate(UpdatePolicyType dense, UpdatePolicyType sparse)
+{
+  arma::mat denseIterate = arma::randu<arma::mat>(4, 3);
+  arma::mat sparseIterate = denseIterate;
+  dense.Initialize(4, 3);
+  sparse.Initialize(4, 3);
+
+  const arma::uvec indices = arma::linspace<arma::uvec>(0, 11, 12);
+  for (size_t step = 0; step < 5; ++step)
+  {
+    const arma::mat gradient = arma::randn<arma::mat>(4, 3);
+    dense.Update(denseIterate, 0.1, gradient);
+    sparse.Update(sparseIterate, 0.1, indices, arma::vectorise(gradient));
+  }
+
+  for (size_t i = 0; i < denseIterate.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(denseIterate[i], sparseIterate[i], 1e-8);
+}
+
+BOOST_AUTO_TEST_CASE(SGDSparseUpdatePolicyTest)
+{
+  CheckSparseUpdate(VanillaUpdate(), VanillaUpdate());
+  CheckSparseUpdate(MomentumUpdate(), MomentumUpdate());
+  CheckSparseUpdate(MomentumUpdate(0.8, true), MomentumUpdate(0.8, true));
+  CheckSparseUpdate(AdaGradUpdate(), AdaGradUpdate());
+  CheckSparseUpdate(RMSPropUpdate(), RMSPropUpdate());
+  CheckSparseUpdate(AdamUpdate(), AdamUpdate());
+}
+
 BOOST_AUTO_TEST_CASE(GeneralizedRosenbrockTest)
 {
   // Loop over several variants.
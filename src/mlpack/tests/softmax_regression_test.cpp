@@ -61,6 +61,133 @@ BOOST_AUTO_TEST_CASE(SoftmaxRegressionFunctionEvaluate)
   }
 }
 
+/**
+ * Check the objective and the gradient on a dataset which is split into several
+ * blocks (and the last block is partial).
+ */
+BOOST_AUTO_TEST_CASE(SoftmaxRegressionFunctionBlockedEvaluate)
+{
+  const size_t points = 2500;
+  const size_t inputSize = 10;
+  const size_t numClasses = 5;
+
+  arma::mat data;
+  data.randu(inputSize, points);
+
+  arma::vec labels(points);
+  for (size_t i = 0; i < points; i++)
+    labels(i) = math::RandInt(0, numClasses);
+
+  SoftmaxRegressionFunction srf(data, labels, inputSize, numClasses, 0.1);
+
+  arma::mat parameters;
+  parameters.randu(numClasses, inputSize);
+
+  // Compute the objective and the gradient naively.
+  double logLikelihood = 0;
+  arma::mat naiveGradient(numClasses, inputSize);
+  naiveGradient.zeros();
+  for (size_t j = 0; j < points; j++)
+  {
+    arma::vec probabilities = arma::exp(parameters * data.col(j));
+    probabilities /= arma::accu(probabilities);
+
+    logLikelihood += log(probabilities((size_t) labels(j)));
+    probabilities((size_t) labels(j)) -= 1;
+    naiveGradient += probabilities * data.col(j).t();
+  }
+  naiveGradient = naiveGradient / points + 0.1 * parameters;
+
+  BOOST_REQUIRE_CLOSE(srf.Evaluate(parameters), -logLikelihood / points +
+      0.05 * arma::accu(parameters % parameters), 1e-5);
+
+  arma::mat gradient;
+  srf.Gradient(parameters, gradient);
+  BOOST_REQUIRE_EQUAL(gradient.n_rows, numClasses);
+  BOOST_REQUIRE_EQUAL(gradient.n_cols, inputSize);
+  for (size_t i = 0; i < gradient.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(gradient[i], naiveGradient[i], 1e-5);
+}
+
+/**
+ * With a model large enough that the threads split the classes instead of the
+ * examples, the objective and the gradient should not change.
+ */
+BOOST_AUTO_TEST_CASE(SoftmaxRegressionFunctionClassBlockedGradient)
+{
+  const size_t points = 300;
+  const size_t inputSize = 500;
+  const size_t numClasses = 2100;
+
+  arma::mat data;
+  data.randu(inputSize, points);
+
+  arma::vec labels(points);
+  for (size_t i = 0; i < points; i++)
+    labels(i) = math::RandInt(0, numClasses);
+
+  SoftmaxRegressionFunction srf(data, labels, inputSize, numClasses, 0.1);
+
+  arma::mat parameters;
+  parameters.randu(numClasses, inputSize);
+  parameters *= 0.01;
+
+  // With one thread, the examples are split into blocks.
+  util::SetNumThreads(1);
+  arma::mat gradient;
+  const double objective = srf.EvaluateWithGradient(parameters, gradient);
+
+  // With several threads, the classes are.
+  util::SetNumThreads(4);
+  arma::mat classGradient;
+  const double classObjective = srf.EvaluateWithGradient(parameters,
+      classGradient);
+  util::SetNumThreads(0);
+
+  BOOST_REQUIRE_CLOSE(classObjective, objective, 1e-8);
+  BOOST_REQUIRE_EQUAL(classGradient.n_rows, numClasses);
+  BOOST_REQUIRE_EQUAL(classGradient.n_cols, inputSize);
+  BOOST_REQUIRE_SMALL(arma::norm(classGradient - gradient, "fro") /
+      arma::norm(gradient, "fro"), 1e-10);
+}
+
+/**
+ * With sparse data, the objective and the gradient should be the same as with
+ * the same data stored densely.
+ */
+BOOST_AUTO_TEST_CASE(SparseSoftmaxRegressionFunctionTest)
+{
+  const size_t points = 2000;
+  const size_t inputSize = 50;
+  const size_t numClasses = 4;
+
+  arma::sp_mat sparseData;
+  sparseData.sprandu(inputSize, points, 0.1);
+  const arma::mat data(sparseData);
+
+  arma::vec labels(points);
+  for (size_t i = 0; i < points; i++)
+    labels(i) = math::RandInt(0, numClasses);
+
+  SoftmaxRegressionFunction srf(data, labels, inputSize, numClasses, 0.1);
+  SparseSoftmaxRegressionFunction sparseSrf(sparseData, labels, inputSize,
+      numClasses, 0.1);
+
+  arma::mat parameters;
+  parameters.randu(numClasses, inputSize);
+
+  BOOST_REQUIRE_CLOSE(sparseSrf.Evaluate(parameters), srf.Evaluate(parameters),
+      1e-5);
+
+  arma::mat gradient, sparseGradient;
+  srf.Gradient(parameters, gradient);
+  sparseSrf.Gradient(parameters, sparseGradient);
+  BOOST_REQUIRE_EQUAL(sparseGradient.n_rows, gradient.n_rows);
+  BOOST_REQUIRE_EQUAL(sparseGradient.n_cols, gradient.n_cols);
+  for (size_t i = 0; i < gradient.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(sparseGradient[i], gradient[i], 1e-5);
+}
+
 BOOST_AUTO_TEST_CASE(SoftmaxRegressionFunctionRegularizationEvaluate)
 {
   const size_t points = 1000;
@@ -166,6 +293,39 @@ BOOST_AUTO_TEST_CASE(SoftmaxRegressionFunctionGradient)
   }
 }
 
+/**
+ * Make sure EvaluateWithGradient() gives the same results as Evaluate() and
+ * Gradient().
+ */
+BOOST_AUTO_TEST_CASE(SoftmaxRegressionFunctionEvaluateWithGradient)
+{
+  const size_t points = 1000;
+  const size_t inputSize = 10;
+  const size_t numClasses = 5;
+
+  arma::mat data;
+  data.randu(inputSize, points);
+
+  arma::vec labels(points);
+  for (size_t i = 0; i < points; i++)
+    labels(i) = math::RandInt(0, numClasses);
+
+  SoftmaxRegressionFunction srf(data, labels, inputSize, numClasses, 0.5);
+
+  arma::mat parameters;
+  parameters.randu(numClasses, inputSize);
+
+  arma::mat gradient, fusedGradient;
+  srf.Gradient(parameters, gradient);
+  const double objective = srf.EvaluateWithGradient(parameters, fusedGradient);
+
+  BOOST_REQUIRE_CLOSE(objective, srf.Evaluate(parameters), 1e-5);
+  BOOST_REQUIRE_EQUAL(fusedGradient.n_rows, gradient.n_rows);
+  BOOST_REQUIRE_EQUAL(fusedGradient.n_cols, gradient.n_cols);
+  for (size_t i = 0; i < gradient.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(fusedGradient[i], gradient[i], 1e-5);
+}
+
 BOOST_AUTO_TEST_CASE(SoftmaxRegressionTwoClasses)
 {
   const size_t points = 1000;
@@ -298,4 +458,84 @@ BOOST_AUTO_TEST_CASE(SoftmaxRegressionMultipleClasses)
   BOOST_REQUIRE_CLOSE(testAcc, 100.0, 2.0);
 }
 
+/**
+ * Predict() should choose the class with the highest probability, for several
+ * blocks of points (the last of which is partial).
+ */
+BOOST_AUTO_TEST_CASE(SoftmaxRegressionPredictTest)
+{
+  const size_t points = 600;
+  const size_t inputSize = 10;
+  const size_t numClasses = 7;
+
+  arma::mat data;
+  data.randn(inputSize, points);
+  arma::vec labels(points);
+  for (size_t i = 0; i < points; i++)
+    labels(i) = math::RandInt(0, numClasses);
+
+  SoftmaxRegression<> sr(data, labels, inputSize, numClasses);
+  sr.Parameters().randn(numClasses, inputSize);
+
+  arma::vec predictions;
+  sr.Predict(data, predictions);
+
+  BOOST_REQUIRE_EQUAL(predictions.n_elem, points);
+  for (size_t i = 0; i < points; ++i)
+  {
+    arma::vec probabilities = arma::exp(sr.Parameters() * data.col(i));
+    probabilities /= arma::accu(probabilities);
+
+    arma::uword best;
+    probabilities.max(best);
+    BOOST_REQUIRE_EQUAL((size_t) predictions[i], (size_t) best);
+  }
+}
+
+/**
+ * The batch scorer should give the same probabilities and classes as a direct
+ * computation, in double precision, and very close probabilities in single
+ * precision.
+ */
+BOOST_AUTO_TEST_CASE(SoftmaxRegressionScorerTest)
+{
+  const size_t points = 1000;
+  const size_t inputSize = 10;
+  const size_t numClasses = 5;
+
+  arma::mat data;
+  data.randn(inputSize, points);
+  arma::mat parameters;
+  parameters.randn(numClasses, inputSize);
+
+  SoftmaxRegressionScorer<> scorer(parameters);
+  arma::mat probabilities;
+  arma::Col<size_t> predictions(points);
+  scorer.Probabilities(data, probabilities);
+  scorer.Predict(data, predictions);
+
+  BOOST_REQUIRE_EQUAL(probabilities.n_rows, numClasses);
+  BOOST_REQUIRE_EQUAL(probabilities.n_cols, points);
+  BOOST_REQUIRE_EQUAL(predictions.n_elem, points);
+  for (size_t i = 0; i < points; ++i)
+  {
+    arma::vec expected = arma::exp(parameters * data.col(i));
+    expected /= arma::accu(expected);
+
+    arma::uword best;
+    expected.max(best);
+    BOOST_REQUIRE_EQUAL(predictions[i], (size_t) best);
+    for (size_t j = 0; j < numClasses; ++j)
+      BOOST_REQUIRE_CLOSE(probabilities(j, i), expected[j], 1e-5);
+  }
+
+  // Single precision.
+  SoftmaxRegressionScorer<float> floatScorer(parameters);
+  const arma::fmat floatData = arma::conv_to<arma::fmat>::from(data);
+  arma::fmat floatProbabilities;
+  floatScorer.Probabilities(floatData, floatProbabilities);
+  for (size_t i = 0; i < probabilities.n_elem; ++i)
+    BOOST_REQUIRE_SMALL(floatProbabilities[i] - probabilities[i], 1e-4);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
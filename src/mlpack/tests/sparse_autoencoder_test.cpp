@@ -263,4 +263,208 @@ BOOST_AUTO_TEST_CASE(SparseAutoencoderFunctionGradient)
   }
 }
 
+/**
+ * Make sure EvaluateWithGradient() gives the same results as Evaluate() and
+ * Gradient().
+ */
+BOOST_AUTO_TEST_CASE(SparseAutoencoderFunctionEvaluateWithGradient)
+{
+  const size_t points = 1000;
+  const size_t vSize = 20;
+  const size_t hSize = 10;
+
+  arma::mat data;
+  data.randu(vSize, points);
+
+  SparseAutoencoderFunction saf(data, vSize, hSize, 20, 20);
+
+  arma::mat parameters;
+  parameters.randu(2 * hSize + 1, vSize + 1);
+
+  arma::mat gradient, fusedGradient;
+  saf.Gradient(parameters, gradient);
+  const double objective = saf.EvaluateWithGradient(parameters, fusedGradient);
+
+  BOOST_REQUIRE_CLOSE(objective, saf.Evaluate(parameters), 1e-5);
+  BOOST_REQUIRE_EQUAL(fusedGradient.n_rows, gradient.n_rows);
+  BOOST_REQUIRE_EQUAL(fusedGradient.n_cols, gradient.n_cols);
+  for (size_t i = 0; i < gradient.n_elem; ++i)
+  {
+    if (std::abs(gradient[i]) < 1e-10)
+      BOOST_REQUIRE_SMALL(fusedGradient[i], 1e-10);
+    else
+      BOOST_REQUIRE_CLOSE(fusedGradient[i], gradient[i], 1e-5);
+  }
+}
+
+/**
+ * Make sure the objective and the gradient are right when the points span
+ * several blocks, and that the cached results are not used once the parameters
+ * change.
+ */
+BOOST_AUTO_TEST_CASE(SparseAutoencoderFunctionBlockedEvaluate)
+{
+  const size_t points = 1000;
+  const size_t vSize = 8;
+  const size_t hSize = 5;
+  const size_t l1 = hSize;
+  const size_t l2 = vSize;
+  const size_t l3 = 2 * hSize;
+
+  arma::mat data;
+  data.randu(vSize, points);
+
+  SparseAutoencoderFunction saf(data, vSize, hSize, 0.01, 2, 0.1);
+
+  for (size_t trial = 0; trial < 3; ++trial)
+  {
+    arma::mat parameters;
+    parameters.randn(2 * hSize + 1, vSize + 1);
+    parameters *= 0.1;
+
+    // Compute the objective naively.
+    const arma::mat w1 = parameters.submat(0, 0, l1 - 1, l2 - 1);
+    const arma::mat w2 = parameters.submat(l1, 0, l3 - 1, l2 - 1);
+    const arma::mat b1 = parameters.submat(0, l2, l1 - 1, l2);
+    const arma::mat b2 = parameters.submat(l3, 0, l3, l2 - 1);
+
+    const arma::mat hidden = 1.0 / (1.0 + arma::exp(-(w1 * data +
+        arma::repmat(b1, 1, points))));
+    const arma::mat output = 1.0 / (1.0 + arma::exp(-(w2.t() * hidden +
+        arma::repmat(b2.t(), 1, points))));
+    const arma::vec rhoCap = arma::sum(hidden, 1) / points;
+
+    const double objective = 0.5 * arma::accu(arma::square(output - data)) /
+        points + 0.5 * 0.01 * (arma::accu(w1 % w1) + arma::accu(w2 % w2)) +
+        2 * arma::accu(0.1 * arma::log(0.1 / rhoCap) + 0.9 *
+        arma::log(0.9 / (1 - rhoCap)));
+
+    arma::mat gradient;
+    BOOST_REQUIRE_CLOSE(saf.EvaluateWithGradient(parameters, gradient),
+        objective, 1e-5);
+    BOOST_REQUIRE_CLOSE(saf.Evaluate(parameters), objective, 1e-5);
+
+    // Check a few entries of the gradient with finite differences.
+    const double epsilon = 1e-5;
+    for (size_t k = 0; k < 10; ++k)
+    {
+      const size_t i = k * (parameters.n_elem / 10);
+      const double original = parameters[i];
+
+      parameters[i] = original + epsilon;
+      const double costPlus = saf.Evaluate(parameters);
+      parameters[i] = original - epsilon;
+      const double costMinus = saf.Evaluate(parameters);
+      parameters[i] = original;
+
+      const double numGradient = (costPlus - costMinus) / (2 * epsilon);
+      if (std::abs(gradient[i]) < 1e-7)
+        BOOST_REQUIRE_SMALL(numGradient, 1e-6);
+      else
+        BOOST_REQUIRE_CLOSE(numGradient, gradient[i], 1e-2);
+    }
+  }
+}
+
+/**
+ * Make sure that the objective and the gradient on a batch match those of the
+ * whole dataset when the batch is the whole dataset and the running average
+ * activations are not kept, and that the running average is updated with the
+ * given decay.
+ */
+BOOST_AUTO_TEST_CASE(SparseAutoencoderFunctionBatchEvaluate)
+{
+  const size_t vSize = 8;
+  const size_t hSize = 5;
+
+  arma::mat data;
+  data.randu(vSize, 300);
+
+  SparseAutoencoderFunction saf(data, vSize, hSize, 0.01, 2, 0.1);
+
+  arma::mat parameters;
+  parameters.randn(2 * hSize + 1, vSize + 1);
+  parameters *= 0.1;
+
+  arma::mat gradient, batchGradient;
+  const double objective = saf.EvaluateWithGradient(parameters, gradient);
+  const double batchObjective = saf.BatchEvaluateWithGradient(parameters, data,
+      batchGradient, 0.0);
+
+  // The batch is computed in single precision.
+  BOOST_REQUIRE_CLOSE(batchObjective, objective, 1e-3);
+  BOOST_REQUIRE_EQUAL(batchGradient.n_rows, gradient.n_rows);
+  BOOST_REQUIRE_EQUAL(batchGradient.n_cols, gradient.n_cols);
+  for (size_t i = 0; i < gradient.n_elem; ++i)
+    BOOST_REQUIRE_SMALL(batchGradient[i] - gradient[i], 1e-4);
+
+  // Now keep half of the previous average activations.
+  const arma::vec previous = saf.AverageActivations();
+  const arma::mat batch = data.cols(0, 99);
+  saf.BatchEvaluateWithGradient(parameters, batch, batchGradient, 0.5);
+
+  const arma::mat hidden = 1.0 / (1.0 + arma::exp(-(parameters.submat(0, 0,
+      hSize - 1, vSize - 1) * batch + arma::repmat(parameters.submat(0, vSize,
+      hSize - 1, vSize), 1, batch.n_cols))));
+  const arma::vec expected = 0.5 * previous + 0.5 * arma::sum(hidden, 1) /
+      batch.n_cols;
+  for (size_t j = 0; j < hSize; ++j)
+    BOOST_REQUIRE_CLOSE(saf.AverageActivations()[j], expected[j], 1e-3);
+
+  // Resetting forgets the running average.
+  saf.ResetActivations();
+  BOOST_REQUIRE_EQUAL(saf.AverageActivations().n_elem, 0);
+}
+
+/**
+ * Train with mini-batches, on data in memory and on the same data streamed from
+ * a file, and make sure that both reduce the objective and end at the same
+ * parameters when the batches are visited in order.
+ */
+BOOST_AUTO_TEST_CASE(SparseAutoencoderSGDTest)
+{
+  const size_t vSize = 8;
+  const size_t hSize = 5;
+
+  arma::mat data;
+  data.randu(vSize, 2000);
+  data::Save("test_sae_stream.bin", data);
+
+  SparseAutoencoderFunction saf(data, vSize, hSize);
+  const arma::mat initial = saf.GetInitialPoint();
+  const double initialObjective = saf.Evaluate(initial);
+
+  arma::mat parameters(initial);
+  SparseAutoencoderAdam<SparseAutoencoderFunction> optimizer(saf, 0.01, 100,
+      10, 0.9, false);
+  optimizer.Optimize(parameters);
+  BOOST_REQUIRE_LT(saf.Evaluate(parameters), initialObjective);
+
+  // Blocks of 500 points hold whole batches, so the steps are the same.
+  arma::mat streamParameters(initial);
+  {
+    data::StreamingReader reader("test_sae_stream.bin", 500, true, false);
+    SparseAutoencoderAdam<SparseAutoencoderFunction> streamOptimizer(saf,
+        reader, 0.01, 100, 10, 0.9, false);
+    streamOptimizer.Optimize(streamParameters);
+  }
+
+  for (size_t i = 0; i < parameters.n_elem; ++i)
+  {
+    if (std::abs(parameters[i]) < 1e-8)
+      BOOST_REQUIRE_SMALL(streamParameters[i], 1e-8);
+    else
+      BOOST_REQUIRE_CLOSE(streamParameters[i], parameters[i], 1e-5);
+  }
+
+  // The optimizer can also be used by SparseAutoencoder.
+  SparseAutoencoder<SparseAutoencoderSGD> encoder(data, vSize, hSize);
+  arma::mat features;
+  encoder.GetNewFeatures(data, features);
+  BOOST_REQUIRE_EQUAL(features.n_rows, hSize);
+  BOOST_REQUIRE_EQUAL(features.n_cols, data.n_cols);
+
+  remove("test_sae_stream.bin");
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -128,6 +128,65 @@ BOOST_AUTO_TEST_CASE(SparseCodingTestDictionaryStep)
   BOOST_REQUIRE_SMALL(normGradient, tol);
 }
 
+/**
+ * Make sure the dictionary step handles an inactive atom (one no point uses),
+ * and that its result does not depend on the number of threads.
+ */
+BOOST_AUTO_TEST_CASE(SparseCodingTestDictionaryStepInactiveAtom)
+{
+  const double tol = 1e-6;
+
+  double lambda1 = 0.1;
+  uword nAtoms = 25;
+
+  mat X;
+  X.load("mnist_first250_training_4s_and_9s.arm");
+  uword nPoints = X.n_cols;
+
+  // Normalize each point since these are images.
+  for (uword i = 0; i < nPoints; ++i)
+    X.col(i) /= norm(X.col(i), 2);
+
+  SparseCoding<> sc(X, nAtoms, lambda1);
+  sc.OptimizeCode();
+  sc.Codes().row(3).zeros();
+
+  const mat D = sc.Dictionary();
+  const mat Z = sc.Codes();
+  uvec adjacencies = find(Z);
+
+  mat dictionaries[2];
+  for (size_t run = 0; run < 2; ++run)
+  {
+    util::SetNumThreads((run == 0) ? 1 : 4);
+    sc.Dictionary() = D;
+    sc.Codes() = Z;
+
+    double normGradient = sc.OptimizeDictionary(adjacencies, 1e-15);
+    BOOST_REQUIRE_SMALL(normGradient, tol);
+
+    // The inactive atom is reinitialized to a random unit vector.
+    BOOST_REQUIRE_CLOSE(norm(sc.Dictionary().col(3), 2), 1.0, 1e-5);
+    dictionaries[run] = sc.Dictionary();
+  }
+  util::SetNumThreads(0);
+
+  for (uword j = 0; j < nAtoms; ++j)
+  {
+    if (j == 3)
+      continue;
+
+    for (uword i = 0; i < X.n_rows; ++i)
+    {
+      if (std::abs(dictionaries[0](i, j)) < 1e-8)
+        BOOST_REQUIRE_SMALL(dictionaries[1](i, j), 1e-8);
+      else
+        BOOST_REQUIRE_CLOSE(dictionaries[1](i, j), dictionaries[0](i, j),
+            1e-6);
+    }
+  }
+}
+
 /*
 BOOST_AUTO_TEST_CASE(SparseCodingTestWhole)
 {
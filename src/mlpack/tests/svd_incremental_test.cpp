@@ -2,6 +2,7 @@
 #include <mlpack/methods/amf/amf.hpp>
 #include <mlpack/methods/amf/update_rules/svd_incomplete_incremental_learning.hpp>
 #include <mlpack/methods/amf/update_rules/svd_complete_incremental_learning.hpp>
+#include <mlpack/methods/amf/update_rules/svd_parallel_sgd_learning.hpp>
 #include <mlpack/methods/amf/init_rules/random_init.hpp>
 #include <mlpack/methods/amf/termination_policies/incomplete_incremental_termination.hpp>
 #include <mlpack/methods/amf/termination_policies/complete_incremental_termination.hpp>
@@ -116,4 +117,41 @@ BOOST_AUTO_TEST_CASE(SVDIncompleteIncrementalRegularizationTest)
   BOOST_REQUIRE_LT(RMSE_2, RMSE_1);
 }
 
+/**
+ * Factorize the nonzero entries of a low-rank matrix with the parallel SGD
+ * update rule, with more strata than threads, and make sure the factorization
+ * fits them.
+ */
+BOOST_AUTO_TEST_CASE(SVDParallelSGDLearningTest)
+{
+  mlpack::math::RandomSeed(10);
+
+  const mat w0 = randu<mat>(60, 2) + 0.5;
+  const mat h0 = randu<mat>(2, 80) + 0.5;
+  const mat full = w0 * h0;
+
+  sp_mat data(60, 80);
+  for (size_t i = 0; i < full.n_rows; ++i)
+    for (size_t j = 0; j < full.n_cols; ++j)
+      if (mlpack::math::Random() < 0.5 || i == (j % full.n_rows))
+        data(i, j) = full(i, j);
+
+  SimpleToleranceTermination<sp_mat> stt(1e-8, 2000);
+  AMF<SimpleToleranceTermination<sp_mat>,
+      RandomInitialization,
+      SVDParallelSGDLearning> amf(stt, RandomInitialization(),
+                                  SVDParallelSGDLearning(0.02, 0, 0, 4));
+  mat w, h;
+  amf.Apply(data, 2, w, h);
+
+  BOOST_REQUIRE_EQUAL(w.n_rows, 60);
+  BOOST_REQUIRE_EQUAL(h.n_cols, 80);
+
+  const mat wh = w * h;
+  double squaredError = 0.0;
+  for (sp_mat::const_iterator it = data.begin(); it != data.end(); ++it)
+    squaredError += std::pow((*it) - wh(it.row(), it.col()), 2.0);
+  BOOST_REQUIRE_SMALL(std::sqrt(squaredError / data.n_nonzero), 0.05);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -664,6 +664,73 @@ BOOST_AUTO_TEST_CASE(TestBallBound)
   BOOST_REQUIRE_CLOSE(b1.MaxDistance(b2.Center()), 1 + 0.3, 1e-5);
 }
 
+/**
+ * Ensure that the union of two balls is the smallest ball containing both.
+ */
+BOOST_AUTO_TEST_CASE(BallBoundUnionTest)
+{
+  BallBound<> b1(0.5, arma::vec("0.0 0.0 0.0"));
+  BallBound<> b2(1.0, arma::vec("0.0 0.0 2.0"));
+
+  // Neither ball contains the other, so the new ball goes from z = -0.5 to
+  // z = 3.
+  BallBound<> b(b1);
+  b |= b2;
+  BOOST_REQUIRE_CLOSE(b.Radius(), 1.75, 1e-5);
+  BOOST_REQUIRE_SMALL(b.Center()[0], 1e-5);
+  BOOST_REQUIRE_SMALL(b.Center()[1], 1e-5);
+  BOOST_REQUIRE_CLOSE(b.Center()[2], 1.25, 1e-5);
+
+  // A ball inside of the bound does not change it.
+  b |= BallBound<>(0.1, arma::vec("0.0 0.0 1.0"));
+  BOOST_REQUIRE_CLOSE(b.Radius(), 1.75, 1e-5);
+  BOOST_REQUIRE_CLOSE(b.Center()[2], 1.25, 1e-5);
+
+  // An empty bound becomes the other ball, and so does a ball inside of it.
+  BallBound<> empty(3);
+  empty |= b2;
+  BOOST_REQUIRE_CLOSE(empty.Radius(), 1.0, 1e-5);
+  BOOST_REQUIRE_CLOSE(empty.Center()[2], 2.0, 1e-5);
+
+  BallBound<> inside(b1);
+  inside |= BallBound<>(5.0, arma::vec("1.0 1.0 1.0"));
+  BOOST_REQUIRE_CLOSE(inside.Radius(), 5.0, 1e-5);
+  BOOST_REQUIRE_CLOSE(inside.Center()[0], 1.0, 1e-5);
+
+  // Assignment copies the ball.
+  BallBound<> assigned;
+  assigned = b2;
+  BOOST_REQUIRE_CLOSE(assigned.Radius(), 1.0, 1e-5);
+  BOOST_REQUIRE_CLOSE(assigned.Center()[2], 2.0, 1e-5);
+}
+
+/**
+ * Ensure that the bound of the root of a ball tree built on enough points that
+ * it is computed in chunks contains every point, and that the tree is the same
+ * with any number of threads.
+ */
+BOOST_AUTO_TEST_CASE(LargeBallTreeTest)
+{
+  typedef BinarySpaceTree<BallBound<> > TreeType;
+
+  arma::mat dataset(5, 25000);
+  dataset.randn();
+  arma::mat datacopy(dataset);
+
+  util::SetNumThreads(1);
+  TreeType single(datacopy);
+  util::SetNumThreads(0);
+  TreeType root(dataset);
+
+  BOOST_REQUIRE_CLOSE(root.Bound().Radius(), single.Bound().Radius(), 1e-10);
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+  {
+    BOOST_REQUIRE_LE(metric::EuclideanDistance::Evaluate(root.Bound().Center(),
+        dataset.col(i)), root.Bound().Radius() * (1 + 1e-10));
+    BOOST_REQUIRE_EQUAL(dataset(0, i), datacopy(0, i));
+  }
+}
+
 /**
  * Ensure that we calculate the correct minimum distance between a point and a
  * bound.
@@ -999,6 +1066,94 @@ BOOST_AUTO_TEST_CASE(HRectBoundDiameter)
   BOOST_REQUIRE_SMALL(d.Diameter(), 1e-5);
 }
 
+/**
+ * Make sure the batch forms of MinDistance() and MaxDistance() give the same
+ * distances as computing them one bound at a time, for the specialized powers
+ * and the general one.
+ */
+template<int Power, bool TakeRoot>
+void CheckBatchDistances()
+{
+  HRectBound<Power, TakeRoot> query(3);
+  const arma::mat queryPoints(arma::randu<arma::mat>(3, 10));
+  query |= queryPoints;
+
+  std::vector<HRectBound<Power, TakeRoot> > others(5,
+      HRectBound<Power, TakeRoot>(3));
+  std::vector<const HRectBound<Power, TakeRoot>*> pointers;
+  for (size_t i = 0; i < others.size(); ++i)
+  {
+    // Some of the bounds overlap the query bound, and some don't.
+    const arma::mat points = arma::randu<arma::mat>(3, 10) + 0.5 * i;
+    others[i] |= points;
+    pointers.push_back(&others[i]);
+  }
+
+  double minDistances[5];
+  double maxDistances[5];
+  query.MinDistance(&pointers[0], 5, minDistances);
+  query.MaxDistance(&pointers[0], 5, maxDistances);
+
+  for (size_t i = 0; i < others.size(); ++i)
+  {
+    if (query.MinDistance(others[i]) == 0.0)
+      BOOST_REQUIRE_SMALL(minDistances[i], 1e-10);
+    else
+      BOOST_REQUIRE_CLOSE(minDistances[i], query.MinDistance(others[i]),
+          1e-10);
+    BOOST_REQUIRE_CLOSE(maxDistances[i], query.MaxDistance(others[i]), 1e-10);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(HRectBoundBatchDistances)
+{
+  CheckBatchDistances<1, true>();
+  CheckBatchDistances<2, true>();
+  CheckBatchDistances<2, false>();
+  CheckBatchDistances<3, true>();
+}
+
+/**
+ * Make sure a bound of fixed dimensionality gives the same distances as a bound
+ * of any dimensionality built on the same points.
+ */
+BOOST_AUTO_TEST_CASE(HRectBoundFixedDimensionality)
+{
+  HRectBound<2, true, 3> fixed;
+  HRectBound<2, true, 3> fixedOther(3);
+  HRectBound<2> dynamic(3);
+  HRectBound<2> dynamicOther(3);
+  BOOST_REQUIRE_EQUAL(fixed.Dim(), 3);
+
+  const arma::mat points(arma::randu<arma::mat>(3, 20));
+  const arma::mat otherPoints(arma::randu<arma::mat>(3, 20) + 0.8);
+  fixed |= points;
+  dynamic |= points;
+  fixedOther |= otherPoints;
+  dynamicOther |= otherPoints;
+
+  for (size_t d = 0; d < 3; ++d)
+  {
+    BOOST_REQUIRE_EQUAL(fixed[d].Lo(), dynamic[d].Lo());
+    BOOST_REQUIRE_EQUAL(fixed[d].Hi(), dynamic[d].Hi());
+  }
+  BOOST_REQUIRE_EQUAL(fixed.MinWidth(), dynamic.MinWidth());
+
+  BOOST_REQUIRE_CLOSE(fixed.MinDistance(fixedOther),
+      dynamic.MinDistance(dynamicOther), 1e-10);
+  BOOST_REQUIRE_CLOSE(fixed.MaxDistance(fixedOther),
+      dynamic.MaxDistance(dynamicOther), 1e-10);
+
+  const arma::vec point("1.5 0.2 -0.4");
+  BOOST_REQUIRE_CLOSE(fixed.MinDistance(point), dynamic.MinDistance(point),
+      1e-10);
+  BOOST_REQUIRE_CLOSE(fixed.MaxDistance(point), dynamic.MaxDistance(point),
+      1e-10);
+  BOOST_REQUIRE_CLOSE(fixed.RangeDistance(point).Lo(),
+      dynamic.RangeDistance(point).Lo(), 1e-10);
+  BOOST_REQUIRE_CLOSE(fixed.Diameter(), dynamic.Diameter(), 1e-10);
+}
+
 /**
  * It seems as though Bill has stumbled across a bug where
  * BinarySpaceTree<>::count() returns something different than
@@ -1734,6 +1889,61 @@ BOOST_AUTO_TEST_CASE(CoverTreeConstructionTest)
   CheckSeparation<CoverTree<>, LMetric<2, true> >(tree, tree);
 }
 
+/**
+ * Count the nodes of the given cover tree, make sure that none of them is an
+ * implicit node (with only one child), and count the children which are more
+ * than one scale below their parent.
+ */
+template<typename TreeType>
+void CheckExplicitNodes(const TreeType& node,
+                        size_t& nodes,
+                        size_t& skippedScales)
+{
+  ++nodes;
+  BOOST_REQUIRE_NE(node.NumChildren(), 1);
+
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+  {
+    if (node.Child(i).NumChildren() > 0 &&
+        node.Child(i).Scale() < node.Scale() - 1)
+      ++skippedScales;
+
+    CheckExplicitNodes(node.Child(i), nodes, skippedScales);
+  }
+}
+
+/**
+ * Make sure that the cover tree is built without implicit nodes, even when the
+ * data has clusters at very different scales: the children of a node are
+ * created directly at the scale of the points they cover, so there are fewer
+ * than two nodes for each point.
+ */
+BOOST_AUTO_TEST_CASE(CoverTreeExplicitNodesTest)
+{
+  // Ten tight clusters, far apart.
+  arma::mat dataset(3, 500);
+  dataset.randu();
+  dataset *= 1e-3;
+  for (size_t c = 0; c < 10; ++c)
+    dataset.cols(50 * c, 50 * c + 49) += 100.0 * c;
+
+  CoverTree<> tree(dataset);
+
+  size_t nodes = 0;
+  size_t skippedScales = 0;
+  CheckExplicitNodes(tree, nodes, skippedScales);
+
+  // Every non-leaf has at least two children, and there is one leaf for each
+  // point.
+  BOOST_REQUIRE_LT(nodes, 2 * dataset.n_cols);
+
+  // The nodes inside the clusters are many scales below the nodes between
+  // them, and none of the scales in between is stored.
+  BOOST_REQUIRE_GT(skippedScales, 0);
+
+  CheckCovering<CoverTree<>, LMetric<2, true> >(tree);
+}
+
 /**
  * Test the manual constructor.
  */
@@ -1881,6 +2091,279 @@ BOOST_AUTO_TEST_CASE(BinarySpaceTreeCopyConstructor)
   BOOST_REQUIRE_EQUAL(b.Right()->Right(), c.Right()->Right());
 }
 
+//! Check that two binary space trees have the same structure and bounds.
+template<typename TreeType>
+void CheckSameTree(const TreeType& a, const TreeType& b)
+{
+  BOOST_REQUIRE_EQUAL(a.Begin(), b.Begin());
+  BOOST_REQUIRE_EQUAL(a.Count(), b.Count());
+  BOOST_REQUIRE_EQUAL(a.NumChildren(), b.NumChildren());
+  BOOST_REQUIRE_EQUAL(a.ParentDistance(), b.ParentDistance());
+  BOOST_REQUIRE_EQUAL(a.FurthestDescendantDistance(),
+      b.FurthestDescendantDistance());
+  BOOST_REQUIRE_EQUAL(a.Bound().MinWidth(), b.Bound().MinWidth());
+  for (size_t i = 0; i < a.Bound().Dim(); ++i)
+  {
+    BOOST_REQUIRE_EQUAL(a.Bound()[i].Lo(), b.Bound()[i].Lo());
+    BOOST_REQUIRE_EQUAL(a.Bound()[i].Hi(), b.Bound()[i].Hi());
+  }
+
+  if (a.NumChildren() > 0)
+    BOOST_REQUIRE_EQUAL(a.SplitDimension(), b.SplitDimension());
+  for (size_t i = 0; i < a.NumChildren(); ++i)
+  {
+    BOOST_REQUIRE_EQUAL(b.Child(i).Parent(), &b);
+    CheckSameTree(a.Child(i), b.Child(i));
+  }
+}
+
+/**
+ * Save a kd-tree to a file and load it again, and make sure that the dataset,
+ * the mapping, and every node are the same.
+ */
+BOOST_AUTO_TEST_CASE(BinarySpaceTreeSaveLoadTest)
+{
+  arma::mat data = arma::randu<arma::mat>(4, 1000);
+  std::vector<size_t> oldFromNew;
+  BinarySpaceTree<HRectBound<2> > tree(data, oldFromNew, 10);
+
+  tree.Save("bsp_tree_test.bin", oldFromNew);
+
+  arma::mat loadedData;
+  std::vector<size_t> loadedOldFromNew;
+  BinarySpaceTree<HRectBound<2> > loadedTree("bsp_tree_test.bin", loadedData,
+      loadedOldFromNew);
+
+  remove("bsp_tree_test.bin");
+
+  BOOST_REQUIRE_EQUAL(loadedData.n_rows, data.n_rows);
+  BOOST_REQUIRE_EQUAL(loadedData.n_cols, data.n_cols);
+  for (size_t i = 0; i < data.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(loadedData[i], data[i]);
+
+  BOOST_REQUIRE_EQUAL(loadedOldFromNew.size(), oldFromNew.size());
+  for (size_t i = 0; i < oldFromNew.size(); ++i)
+    BOOST_REQUIRE_EQUAL(loadedOldFromNew[i], oldFromNew[i]);
+
+  BOOST_REQUIRE_EQUAL(&loadedTree.Dataset(), &loadedData);
+  BOOST_REQUIRE_EQUAL(loadedTree.MaxLeafSize(), tree.MaxLeafSize());
+  CheckSameTree(tree, loadedTree);
+}
+
+/**
+ * Make sure that a tree that is large enough to be built in parallel is the
+ * same as the tree built with only one thread.
+ */
+BOOST_AUTO_TEST_CASE(ParallelBinarySpaceTreeBuildTest)
+{
+  typedef BinarySpaceTree<HRectBound<2> > TreeType;
+
+  arma::mat data = arma::randu<arma::mat>(5, 8 *
+      TreeType::ParallelBuildThreshold);
+  arma::mat serialData(data);
+  std::vector<size_t> oldFromNew, serialOldFromNew;
+
+#ifdef _OPENMP
+  const int threads = omp_get_max_threads();
+  omp_set_num_threads(1);
+#endif
+
+  TreeType serialTree(serialData, serialOldFromNew);
+
+#ifdef _OPENMP
+  omp_set_num_threads(std::max(threads, 4));
+#endif
+
+  TreeType tree(data, oldFromNew);
+
+#ifdef _OPENMP
+  omp_set_num_threads(threads);
+#endif
+
+  for (size_t i = 0; i < data.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(data[i], serialData[i]);
+  for (size_t i = 0; i < oldFromNew.size(); ++i)
+    BOOST_REQUIRE_EQUAL(oldFromNew[i], serialOldFromNew[i]);
+
+  CheckSameTree(serialTree, tree);
+}
+
+//! Collect the nodes of a tree in depth-first order.
+template<typename TreeType>
+void DepthFirstNodes(TreeType& node, std::vector<TreeType*>& nodes)
+{
+  nodes.push_back(&node);
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+    DepthFirstNodes(node.Child(i), nodes);
+}
+
+/**
+ * Make sure that a compacted tree is the same as the original tree, and that
+ * its nodes and bounds are laid out contiguously in depth-first order.
+ */
+BOOST_AUTO_TEST_CASE(BinarySpaceTreeCompactTest)
+{
+  arma::mat data = arma::randu<arma::mat>(3, 1000);
+  BinarySpaceTree<HRectBound<2> > tree(data, 5);
+  BinarySpaceTree<HRectBound<2> > copy(tree);
+
+  tree.Compact();
+  CheckSameTree(copy, tree);
+
+  std::vector<BinarySpaceTree<HRectBound<2> >*> nodes;
+  DepthFirstNodes(tree, nodes);
+  BOOST_REQUIRE_GT(nodes.size(), 2);
+  for (size_t i = 1; i < nodes.size(); ++i)
+  {
+    BOOST_REQUIRE_EQUAL(nodes[i], nodes[1] + (i - 1));
+    BOOST_REQUIRE_EQUAL(&nodes[i]->Bound()[0], &nodes[0]->Bound()[0] +
+        i * data.n_rows);
+  }
+
+  // Compacting again should not change anything.
+  tree.Compact();
+  CheckSameTree(copy, tree);
+}
+
+/**
+ * Make sure that a tree built serially has its nodes in its arena in
+ * depth-first order, each followed by the ranges of its bound, and that it can
+ * still be copied and compacted.
+ */
+BOOST_AUTO_TEST_CASE(BinarySpaceTreeArenaTest)
+{
+  typedef BinarySpaceTree<HRectBound<2> > TreeType;
+
+  arma::mat data = arma::randu<arma::mat>(3, 1000);
+  TreeType tree(data, 10);
+  TreeType copy(tree);
+  CheckSameTree(copy, tree);
+
+  std::vector<TreeType*> nodes;
+  DepthFirstNodes(tree, nodes);
+  BOOST_REQUIRE_GT(nodes.size(), 2);
+
+  const size_t nodeSize = NodeArena::Align(sizeof(TreeType));
+  const size_t slotSize = nodeSize + data.n_rows * sizeof(math::Range);
+  for (size_t i = 1; i < nodes.size(); ++i)
+  {
+    BOOST_REQUIRE((char*) nodes[i] == (char*) nodes[1] + (i - 1) * slotSize);
+    BOOST_REQUIRE((char*) &nodes[i]->Bound()[0] ==
+        (char*) nodes[i] + nodeSize);
+  }
+
+  // Every point is inside the bound of each node which holds it.
+  for (size_t i = 0; i < nodes.size(); ++i)
+    for (size_t j = nodes[i]->Begin(); j < nodes[i]->End(); ++j)
+      BOOST_REQUIRE(nodes[i]->Bound().Contains(data.unsafe_col(j)));
+
+  tree.Compact();
+  CheckSameTree(copy, tree);
+}
+
+/**
+ * Make sure that a lazily built kd-tree is only split when its nodes are
+ * expanded, and that once it is fully expanded it is the same as the tree
+ * built at once, with the same dataset and mapping.
+ */
+BOOST_AUTO_TEST_CASE(LazyBinarySpaceTreeTest)
+{
+  typedef BinarySpaceTree<HRectBound<2> > TreeType;
+
+  arma::mat data = arma::randu<arma::mat>(3, 10000);
+  arma::mat lazyData(data);
+
+  std::vector<size_t> oldFromNew;
+  TreeType tree(data, oldFromNew, 20);
+  std::vector<size_t> lazyOldFromNew;
+  TreeType lazyTree(lazyData, lazyOldFromNew, 20, true);
+
+  // Only the root exists yet.
+  BOOST_REQUIRE(lazyTree.PendingSplit());
+  BOOST_REQUIRE_EQUAL(lazyTree.TreeSize(), 1);
+  BOOST_REQUIRE_EQUAL(lazyTree.Count(), data.n_cols);
+
+  // Expanding the root splits it, but not its children.
+  lazyTree.Expand();
+  BOOST_REQUIRE(!lazyTree.PendingSplit());
+  BOOST_REQUIRE_EQUAL(lazyTree.NumChildren(), 2);
+  BOOST_REQUIRE_EQUAL(lazyTree.TreeSize(), 3);
+  BOOST_REQUIRE(lazyTree.Child(0).PendingSplit());
+  BOOST_REQUIRE(lazyTree.Child(1).PendingSplit());
+
+  lazyTree.ExpandAll();
+  CheckSameTree(tree, lazyTree);
+  BOOST_REQUIRE_EQUAL(lazyTree.TreeSize(), tree.TreeSize());
+
+  BOOST_REQUIRE_EQUAL(lazyOldFromNew.size(), oldFromNew.size());
+  for (size_t i = 0; i < oldFromNew.size(); ++i)
+    BOOST_REQUIRE_EQUAL(lazyOldFromNew[i], oldFromNew[i]);
+  for (size_t i = 0; i < data.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(lazyData[i], data[i]);
+}
+
+/**
+ * Make sure that points inserted into a kd-tree end up in leaves no larger
+ * than the max leaf size, inside of the bounds of all of the nodes holding
+ * them, and with the mapping updated; and that inserting a cluster of points
+ * far away from the rest makes the tree less balanced.
+ */
+BOOST_AUTO_TEST_CASE(BinarySpaceTreeInsertTest)
+{
+  typedef BinarySpaceTree<HRectBound<2> > TreeType;
+
+  arma::mat data = arma::randu<arma::mat>(3, 1000);
+  arma::mat uniform = arma::randu<arma::mat>(3, 500);
+  arma::mat cluster = 0.01 * arma::randu<arma::mat>(3, 1000) + 2.0;
+  arma::mat all = arma::join_rows(arma::join_rows(data, uniform), cluster);
+
+  std::vector<size_t> oldFromNew;
+  TreeType tree(data, oldFromNew, 10);
+  const double imbalance = tree.Imbalance();
+
+  tree.Insert(uniform, oldFromNew);
+  tree.Insert(cluster, oldFromNew);
+
+  BOOST_REQUIRE_EQUAL(data.n_cols, all.n_cols);
+  BOOST_REQUIRE_EQUAL(tree.Count(), all.n_cols);
+  BOOST_REQUIRE_GT(tree.Imbalance(), imbalance);
+
+  // The mapping is a permutation which gives the points in their new order.
+  BOOST_REQUIRE_EQUAL(oldFromNew.size(), all.n_cols);
+  std::vector<bool> seen(all.n_cols, false);
+  for (size_t i = 0; i < oldFromNew.size(); ++i)
+  {
+    BOOST_REQUIRE_LT(oldFromNew[i], all.n_cols);
+    BOOST_REQUIRE(!seen[oldFromNew[i]]);
+    seen[oldFromNew[i]] = true;
+    for (size_t d = 0; d < data.n_rows; ++d)
+      BOOST_REQUIRE_EQUAL(data(d, i), all(d, oldFromNew[i]));
+  }
+
+  std::vector<TreeType*> nodes;
+  DepthFirstNodes(tree, nodes);
+  for (size_t i = 0; i < nodes.size(); ++i)
+  {
+    TreeType& node = *nodes[i];
+    if (node.IsLeaf())
+    {
+      BOOST_REQUIRE_LE(node.Count(), 10);
+    }
+    else
+    {
+      // The children hold the points of the node, in order.
+      BOOST_REQUIRE_EQUAL(node.Left()->Begin(), node.Begin());
+      BOOST_REQUIRE_EQUAL(node.Right()->Begin(), node.Left()->End());
+      BOOST_REQUIRE_EQUAL(node.Right()->End(), node.End());
+    }
+
+    BOOST_REQUIRE_CLOSE(node.FurthestDescendantDistance(),
+        0.5 * node.Bound().Diameter(), 1e-5);
+    for (size_t j = node.Begin(); j < node.End(); ++j)
+      BOOST_REQUIRE(node.Bound().Contains(data.unsafe_col(j)));
+  }
+}
+
 //! Count the number of leaves under this node.
 template<typename TreeType>
 size_t NumLeaves(TreeType* node)
@@ -1997,4 +2480,104 @@ BOOST_AUTO_TEST_CASE(CoverTreeDescendantTest)
   CheckDescendants(&tree);
 }
 
+/**
+ * A rule for the single-tree traversal that either prunes every node or none.
+ */
+class PruneAllRules
+{
+ public:
+  PruneAllRules(const bool prune) : prune(prune) { }
+
+  double BaseCase(const size_t /* queryIndex */, const size_t /* refIndex */)
+  { return 0.0; }
+
+  template<typename TreeType>
+  double Score(const size_t /* queryIndex */, TreeType& /* node */)
+  { return prune ? DBL_MAX : 0.0; }
+
+  template<typename TreeType>
+  double Rescore(const size_t /* queryIndex */,
+                 TreeType& /* node */,
+                 const double oldScore)
+  { return oldScore; }
+
+ private:
+  bool prune;
+};
+
+/**
+ * Make sure the traversal statistics of the single-tree traverser count every
+ * node, base case and score, and the prunes by level, when they are compiled
+ * in; and that they are all 0 otherwise.
+ */
+BOOST_AUTO_TEST_CASE(TraversalStatisticsTest)
+{
+  arma::mat dataset;
+  dataset.randu(3, 200);
+
+  typedef BinarySpaceTree<HRectBound<2> > TreeType;
+  TreeType tree(dataset, 10);
+
+  TraversalStatistics::ResetTotal();
+
+  {
+    PruneAllRules rules(false);
+    TreeType::SingleTreeTraverser<PruneAllRules> traverser(rules);
+    traverser.Traverse(0, tree);
+
+    const TraversalStatistics& statistics = traverser.Statistics();
+    if (TraversalStatistics::Enabled)
+    {
+      // Every internal node scores its two children.
+      BOOST_REQUIRE_EQUAL(statistics.Visits(), tree.TreeSize());
+      BOOST_REQUIRE_EQUAL(statistics.BaseCases(), dataset.n_cols);
+      BOOST_REQUIRE_EQUAL(statistics.Scores(), tree.TreeSize() - 1);
+      BOOST_REQUIRE_EQUAL(statistics.Prunes(), 0);
+    }
+    else
+    {
+      BOOST_REQUIRE_EQUAL(statistics.Visits(), 0);
+      BOOST_REQUIRE_EQUAL(statistics.BaseCases(), 0);
+      BOOST_REQUIRE_EQUAL(statistics.Scores(), 0);
+      BOOST_REQUIRE_EQUAL(statistics.Prunes(), 0);
+    }
+  }
+
+  {
+    PruneAllRules rules(true);
+    TreeType::SingleTreeTraverser<PruneAllRules> traverser(rules);
+    traverser.Traverse(0, tree);
+
+    // Both children of the root are pruned, at level 1.
+    const TraversalStatistics& statistics = traverser.Statistics();
+    BOOST_REQUIRE_EQUAL(traverser.NumPrunes(), 2);
+    if (TraversalStatistics::Enabled)
+    {
+      BOOST_REQUIRE_EQUAL(statistics.Visits(), 1);
+      BOOST_REQUIRE_EQUAL(statistics.BaseCases(), 0);
+      BOOST_REQUIRE_EQUAL(statistics.Prunes(), 2);
+      BOOST_REQUIRE_EQUAL(statistics.PrunesByLevel().size(), 2);
+      BOOST_REQUIRE_EQUAL(statistics.PrunesByLevel()[0], 0);
+      BOOST_REQUIRE_EQUAL(statistics.PrunesByLevel()[1], 2);
+    }
+    else
+    {
+      BOOST_REQUIRE_EQUAL(statistics.Prunes(), 0);
+    }
+  }
+
+  // Both traversers were recorded in the total when they were destroyed.
+  const TraversalStatistics total = TraversalStatistics::Total();
+  if (TraversalStatistics::Enabled)
+  {
+    BOOST_REQUIRE_EQUAL(total.Visits(), tree.TreeSize() + 1);
+    BOOST_REQUIRE_EQUAL(total.BaseCases(), dataset.n_cols);
+    BOOST_REQUIRE_EQUAL(total.Prunes(), 2);
+  }
+  else
+  {
+    BOOST_REQUIRE_EQUAL(total.Visits(), 0);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
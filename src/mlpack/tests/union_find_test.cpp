@@ -46,4 +46,20 @@ BOOST_AUTO_TEST_CASE(TestUnion)
   BOOST_REQUIRE(testUnionFind_.Find(6) == testUnionFind_.Find(3));
 }
 
+BOOST_AUTO_TEST_CASE(TestConstFind)
+{
+  static const size_t testSize_ = 10;
+  UnionFind testUnionFind_(testSize_);
+
+  testUnionFind_.Union(0, 1);
+  testUnionFind_.Union(2, 3);
+  testUnionFind_.Union(0, 2);
+  testUnionFind_.Union(5, 0);
+
+  // The const Find() does not compress paths, but finds the same components.
+  const UnionFind& constUnionFind_ = testUnionFind_;
+  for (size_t i = 0; i < testSize_; i++)
+    BOOST_REQUIRE(constUnionFind_.Find(i) == testUnionFind_.Find(i));
+}
+
 BOOST_AUTO_TEST_SUITE_END();